@@ -59,6 +59,15 @@ CameraMetadata &CameraMetadata::operator=(const camera_metadata_t *buffer) {
     }
 
     if (CC_LIKELY(buffer != mBuffer)) {
+        // Copy into our own buffer when it's large enough, as frames of a
+        // stream are assigned over each other at the frame rate
+        if (mBuffer != NULL && buffer != NULL &&
+                get_camera_metadata_compact_size(buffer) <=
+                        get_camera_metadata_size(mBuffer)) {
+            copy_camera_metadata(mBuffer, get_camera_metadata_size(mBuffer),
+                    buffer);
+            return *this;
+        }
         camera_metadata_t *newBuffer = clone_camera_metadata(buffer);
         clear();
         mBuffer = newBuffer;
@@ -129,7 +138,10 @@ void CameraMetadata::acquire(CameraMetadata &other) {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return;
     }
-    acquire(other.release());
+    // The buffer of another CameraMetadata has been validated already
+    camera_metadata_t *buffer = other.release();
+    clear();
+    mBuffer = buffer;
 }
 
 status_t CameraMetadata::append(const CameraMetadata &other) {
@@ -518,11 +530,14 @@ status_t CameraMetadata::writeToParcel(Parcel& data,
             }
         }
 
-        // Not too big of a problem since receiving side does hard validation
+        // Not too big of a problem since receiving side does hard validation,
+        // so it's only checked when logging verbosely, instead of every frame
         // Don't check the size since the compact size could be larger
-        if (validate_camera_metadata_structure(metadata, /*size*/NULL) != OK) {
-            ALOGW("%s: Failed to validate metadata %p before writing blob",
-                   __FUNCTION__, metadata);
+        IF_ALOGV() {
+            if (validate_camera_metadata_structure(metadata, /*size*/NULL) != OK) {
+                ALOGW("%s: Failed to validate metadata %p before writing blob",
+                       __FUNCTION__, metadata);
+            }
         }
 
     } while(false);
@@ -61,6 +61,8 @@ static uint32_t gVideoWidth = 0;            // default width+height
 static uint32_t gVideoHeight = 0;
 static uint32_t gBitRate = 4000000;         // 4Mbps
 static uint32_t gTimeLimitSec = kMaxTimeLimitSec;
+static float gMaxFps = 0.0f;                 // 0 means the display rate
+static bool gDropDuplicates = false;         // skip unchanged frames
 
 // Set by signal handler to stop recording.
 static bool gStopRequested;
@@ -146,6 +148,12 @@ static status_t prepareEncoder(float displayFps, sp<MediaCodec>* pCodec,
     format->setInt32("bitrate", gBitRate);
     format->setFloat("frame-rate", displayFps);
     format->setInt32("i-frame-interval", 10);
+    if (gMaxFps > 0.0f) {
+        format->setFloat("max-fps-to-encoder", gMaxFps);
+    }
+    if (gDropDuplicates) {
+        format->setInt32("drop-duplicate-frames", 1);
+    }
 
     sp<ALooper> looper = new ALooper;
     looper->setName("screenrecord_looper");
@@ -630,6 +638,11 @@ static void usage() {
         "    Set the maximum recording time, in seconds.  Default / maximum is %d.\n"
         "--rotate\n"
         "    Rotate the output 90 degrees.\n"
+        "--max-fps FPS\n"
+        "    Encode at most FPS frames per second.  Default is the display rate.\n"
+        "--drop-duplicates\n"
+        "    Don't encode frames that are identical to the previous one.  Saves\n"
+        "    power and bit rate when the screen is mostly static.\n"
         "--verbose\n"
         "    Display interesting information on stdout.\n"
         "--help\n"
@@ -652,6 +665,8 @@ int main(int argc, char* const argv[]) {
         { "bit-rate",   required_argument,  NULL, 'b' },
         { "time-limit", required_argument,  NULL, 't' },
         { "rotate",     no_argument,        NULL, 'r' },
+        { "max-fps",    required_argument,  NULL, 'f' },
+        { "drop-duplicates", no_argument,   NULL, 'd' },
         { NULL,         0,                  NULL, 0 }
     };
 
@@ -704,6 +719,16 @@ int main(int argc, char* const argv[]) {
         case 'r':
             gRotate = true;
             break;
+        case 'f':
+            gMaxFps = atof(optarg);
+            if (gMaxFps <= 0.0f) {
+                fprintf(stderr, "Invalid max fps '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'd':
+            gDropDuplicates = true;
+            break;
         default:
             if (ic != '?') {
                 fprintf(stderr, "getopt_long returned unexpected value 0x%x\n", ic);
@@ -389,6 +389,18 @@ static void playSource(OMXClient *client, sp<MediaSource> &source) {
         printf("avg. %.2f KB/sec\n", totalBytes / 1024 * 1E6 / delay);
 
         printf("decoded a total of %lld bytes\n", totalBytes);
+
+        // Decode speed relative to playback, comparable across decoders
+        int32_t sampleRate, channelCount;
+        sp<MetaData> format = rawSource->getFormat();
+        if (format->findInt32(kKeySampleRate, &sampleRate)
+                && format->findInt32(kKeyChannelCount, &channelCount)
+                && sampleRate > 0 && channelCount > 0) {
+            double durationSecs =
+                (double)totalBytes / (sampleRate * channelCount * sizeof(int16_t));
+            printf("decoded %.2f secs of audio at %.1fx realtime\n",
+                   durationSecs, durationSecs * 1E6 / delay);
+        }
     }
 }
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "transcoder"
+#include <utils/Log.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/TranscodePipeline.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-b video bitrate] [-a audio bitrate]\n"
+                    "\t\t[-r frame rate] [-i i-frame interval in secs]\n"
+                    "\t\t[-q queue depth] input output\n",
+                    me);
+
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+
+    TranscodePipeline::Options options;
+
+    int res;
+    while ((res = getopt(argc, argv, "hb:a:r:i:q:")) >= 0) {
+        switch (res) {
+            case 'b':
+            {
+                options.mVideoBitrate = atoi(optarg);
+                break;
+            }
+
+            case 'a':
+            {
+                options.mAudioBitrate = atoi(optarg);
+                break;
+            }
+
+            case 'r':
+            {
+                options.mFrameRate = atoi(optarg);
+                break;
+            }
+
+            case 'i':
+            {
+                options.mIFrameIntervalSecs = atoi(optarg);
+                break;
+            }
+
+            case 'q':
+            {
+                int depth = atoi(optarg);
+                if (depth <= 0) {
+                    usage(me);
+                }
+                options.mQueueDepth = depth;
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 2) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    sp<TranscodePipeline> pipeline = new TranscodePipeline;
+
+    status_t err = pipeline->init(argv[0], argv[1], options);
+    if (err == OK) {
+        err = pipeline->start();
+    }
+    if (err == OK) {
+        err = pipeline->waitForCompletion();
+    }
+
+    if (err != OK) {
+        fprintf(stderr, "transcoding failed (err=%d)\n", err);
+        return 1;
+    }
+
+    Vector<TranscodePipeline::StageStats> stats;
+    int64_t elapsedUs;
+    pipeline->getStats(&stats, &elapsedUs);
+
+    printf("transcoded in %.2f secs\n", elapsedUs / 1E6);
+
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const TranscodePipeline::StageStats &stageStats = stats.itemAt(i);
+
+        printf("%-14s %8lld buffers, %5.2f buffers/sec, busy %5.1f%%\n",
+               stageStats.mName.c_str(),
+               stageStats.mNumBuffers,
+               elapsedUs > 0 ? stageStats.mNumBuffers * 1E6 / elapsedUs : 0.0,
+               elapsedUs > 0 ? stageStats.mBusyUs * 100.0 / elapsedUs : 0.0);
+    }
+
+    return 0;
+}
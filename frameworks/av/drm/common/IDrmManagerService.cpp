@@ -787,6 +787,47 @@ ssize_t BpDrmManagerService::pread(
     return result;
 }
 
+status_t BpDrmManagerService::startReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap) {
+    ALOGV("startReadAhead");
+    Parcel data, reply;
+
+    data.writeInterfaceToken(IDrmManagerService::getInterfaceDescriptor());
+    data.writeInt32(uniqueId);
+
+    writeDecryptHandleToParcelData(decryptHandle, &data);
+
+    status_t status = remote()->transact(START_READ_AHEAD, data, &reply);
+    if (NO_ERROR != status) {
+        return status;
+    }
+
+    status = reply.readInt32();
+    if (DRM_NO_ERROR == status) {
+        *heap = interface_cast<IMemoryHeap>(reply.readStrongBinder());
+        if (NULL == heap->get()) {
+            status = DRM_ERROR_UNKNOWN;
+        }
+    }
+    return status;
+}
+
+ssize_t BpDrmManagerService::fillReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, off64_t offset) {
+    ALOGV("fillReadAhead");
+    Parcel data, reply;
+
+    data.writeInterfaceToken(IDrmManagerService::getInterfaceDescriptor());
+    data.writeInt32(uniqueId);
+
+    writeDecryptHandleToParcelData(decryptHandle, &data);
+
+    data.writeInt64(offset);
+
+    remote()->transact(FILL_READ_AHEAD, data, &reply);
+    return reply.readInt32();
+}
+
 IMPLEMENT_META_INTERFACE(DrmManagerService, "drm.IDrmManagerService");
 
 status_t BnDrmManagerService::onTransact(
@@ -1493,6 +1534,45 @@ status_t BnDrmManagerService::onTransact(
         return DRM_NO_ERROR;
     }
 
+    case START_READ_AHEAD:
+    {
+        ALOGV("BnDrmManagerService::onTransact :START_READ_AHEAD");
+        CHECK_INTERFACE(IDrmManagerService, data, reply);
+
+        const int uniqueId = data.readInt32();
+
+        DecryptHandle handle;
+        readDecryptHandleFromParcelData(&handle, data);
+
+        sp<IMemoryHeap> heap;
+        const status_t status = startReadAhead(uniqueId, &handle, &heap);
+        reply->writeInt32(status);
+        if (DRM_NO_ERROR == status) {
+            reply->writeStrongBinder(heap->asBinder());
+        }
+
+        clearDecryptHandle(&handle);
+        return DRM_NO_ERROR;
+    }
+
+    case FILL_READ_AHEAD:
+    {
+        ALOGV("BnDrmManagerService::onTransact :FILL_READ_AHEAD");
+        CHECK_INTERFACE(IDrmManagerService, data, reply);
+
+        const int uniqueId = data.readInt32();
+
+        DecryptHandle handle;
+        readDecryptHandleFromParcelData(&handle, data);
+
+        const off64_t offset = data.readInt64();
+
+        reply->writeInt32(fillReadAhead(uniqueId, &handle, offset));
+
+        clearDecryptHandle(&handle);
+        return DRM_NO_ERROR;
+    }
+
     default:
         return BBinder::onTransact(code, data, reply, flags);
     }
@@ -19,7 +19,8 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES:= \
     main_drmserver.cpp \
     DrmManager.cpp \
-    DrmManagerService.cpp
+    DrmManagerService.cpp \
+    ReadAheadSession.cpp
 
 LOCAL_SHARED_LIBRARIES := \
     libmedia \
@@ -490,6 +490,9 @@ DecryptHandle* DrmManager::openDecryptSession(
 }
 
 status_t DrmManager::closeDecryptSession(int uniqueId, DecryptHandle* decryptHandle) {
+    // The read-ahead thread takes mDecryptLock, stop it first.
+    stopReadAhead(decryptHandle);
+
     Mutex::Autolock _l(mDecryptLock);
     status_t result = DRM_ERROR_UNKNOWN;
     if (mDecryptSessionMap.indexOfKey(decryptHandle->decryptId) != NAME_NOT_FOUND) {
@@ -549,6 +552,69 @@ ssize_t DrmManager::pread(int uniqueId, DecryptHandle* decryptHandle,
     return result;
 }
 
+status_t DrmManager::startReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap) {
+    {
+        Mutex::Autolock _l(mDecryptLock);
+        if (mDecryptSessionMap.indexOfKey(decryptHandle->decryptId) == NAME_NOT_FOUND) {
+            return DRM_ERROR_UNKNOWN;
+        }
+    }
+
+    Mutex::Autolock _l(mReadAheadLock);
+    ssize_t index = mReadAheadSessionMap.indexOfKey(decryptHandle->decryptId);
+    if (index >= 0) {
+        const sp<ReadAheadSession>& session = mReadAheadSessionMap.valueAt(index);
+        if (session->getUniqueId() != uniqueId) {
+            return DRM_ERROR_UNKNOWN;
+        }
+        *heap = session->getHeap();
+        return DRM_NO_ERROR;
+    }
+
+    sp<ReadAheadSession> session = new ReadAheadSession(this, uniqueId, *decryptHandle);
+    status_t result = session->start();
+    if (DRM_NO_ERROR != result) {
+        return result;
+    }
+    mReadAheadSessionMap.add(decryptHandle->decryptId, session);
+    *heap = session->getHeap();
+    return DRM_NO_ERROR;
+}
+
+ssize_t DrmManager::fillReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, off64_t offset) {
+    sp<ReadAheadSession> session;
+    {
+        Mutex::Autolock _l(mReadAheadLock);
+        ssize_t index = mReadAheadSessionMap.indexOfKey(decryptHandle->decryptId);
+        if (index >= 0) {
+            session = mReadAheadSessionMap.valueAt(index);
+        }
+    }
+
+    if (NULL == session.get() || session->getUniqueId() != uniqueId) {
+        return DECRYPT_FILE_ERROR;
+    }
+    return session->fill(offset);
+}
+
+void DrmManager::stopReadAhead(DecryptHandle* decryptHandle) {
+    sp<ReadAheadSession> session;
+    {
+        Mutex::Autolock _l(mReadAheadLock);
+        ssize_t index = mReadAheadSessionMap.indexOfKey(decryptHandle->decryptId);
+        if (index >= 0) {
+            session = mReadAheadSessionMap.valueAt(index);
+            mReadAheadSessionMap.removeItemsAt(index);
+        }
+    }
+
+    if (NULL != session.get()) {
+        session->stop();
+    }
+}
+
 String8 DrmManager::getSupportedPlugInId(
             int uniqueId, const String8& path, const String8& mimeType) {
     String8 plugInId("");
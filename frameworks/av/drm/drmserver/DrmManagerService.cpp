@@ -269,6 +269,24 @@ ssize_t DrmManagerService::pread(int uniqueId, DecryptHandle* decryptHandle,
     return mDrmManager->pread(uniqueId, decryptHandle, buffer, numBytes, offset);
 }
 
+status_t DrmManagerService::startReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap) {
+    ALOGV("Entering startReadAhead");
+    if (!isProtectedCallAllowed()) {
+        return DRM_ERROR_NO_PERMISSION;
+    }
+    return mDrmManager->startReadAhead(uniqueId, decryptHandle, heap);
+}
+
+ssize_t DrmManagerService::fillReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, off64_t offset) {
+    ALOGV("Entering fillReadAhead");
+    if (!isProtectedCallAllowed()) {
+        return DRM_ERROR_NO_PERMISSION;
+    }
+    return mDrmManager->fillReadAhead(uniqueId, decryptHandle, offset);
+}
+
 status_t DrmManagerService::dump(int fd, const Vector<String16>& args)
 {
     const size_t SIZE = 256;
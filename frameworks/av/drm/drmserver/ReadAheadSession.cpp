@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ReadAheadSession"
+#include "utils/Log.h"
+
+#include <cutils/atomic.h>
+
+#include "DrmManager.h"
+#include "ReadAheadSession.h"
+
+#define DECRYPT_FILE_ERROR -1
+
+using namespace android;
+
+ReadAheadSession::ReadAheadSession(
+        DrmManager* drmManager, int uniqueId, const DecryptHandle& handle) :
+    Thread(false),
+    mDrmManager(drmManager),
+    mUniqueId(uniqueId),
+    mRing(NULL),
+    mNextChunk(0),
+    mLastChunk(-1),
+    mEndChunk(-1) {
+    // The engines find their session by id, the rest of the handle is not
+    // needed for reading.
+    mHandle.decryptId = handle.decryptId;
+    mHandle.mimeType = handle.mimeType;
+    mHandle.decryptApiType = handle.decryptApiType;
+    mHandle.status = handle.status;
+}
+
+ReadAheadSession::~ReadAheadSession() {
+}
+
+status_t ReadAheadSession::start() {
+    // The client only gets to read the ring
+    mHeap = new MemoryHeapBase(
+            DrmReadAheadRing::totalSize(), MemoryHeapBase::READ_ONLY, "DrmReadAhead");
+    if (mHeap->getHeapID() < 0) {
+        ALOGE("Failed to allocate the read-ahead ring");
+        mHeap.clear();
+        return DRM_ERROR_UNKNOWN;
+    }
+
+    mRing = static_cast<DrmReadAheadRing*>(mHeap->getBase());
+    for (int i = 0; i < DrmReadAheadRing::kNumSlots; ++i) {
+        mRing->slots[i].seq = 0;
+        mRing->slots[i].length = 0;
+        mRing->slots[i].chunk = -1;
+    }
+
+    if (run("DrmReadAhead", PRIORITY_AUDIO) != NO_ERROR) {
+        ALOGE("Failed to start the read-ahead thread");
+        return DRM_ERROR_UNKNOWN;
+    }
+    return DRM_NO_ERROR;
+}
+
+void ReadAheadSession::stop() {
+    {
+        Mutex::Autolock _l(mLock);
+        requestExit();
+        mCondition.signal();
+    }
+    requestExitAndWait();
+}
+
+ssize_t ReadAheadSession::fill(off64_t offset) {
+    if (offset < 0 || NULL == mRing) {
+        return DECRYPT_FILE_ERROR;
+    }
+
+    Mutex::Autolock _l(mLock);
+    const int64_t chunk = offset / DrmReadAheadRing::kChunkSize;
+    const ssize_t result = fillChunk_l(chunk);
+
+    // Restart the window from here, which also follows seeks backwards.
+    mNextChunk = chunk + 1;
+    mLastChunk = chunk + kPrefetchChunks;
+    mCondition.signal();
+
+    return result;
+}
+
+bool ReadAheadSession::threadLoop() {
+    Mutex::Autolock _l(mLock);
+    while (!exitPending()
+            && (mNextChunk > mLastChunk || (0 <= mEndChunk && mNextChunk >= mEndChunk))) {
+        mCondition.wait(mLock);
+    }
+    if (exitPending()) {
+        return false;
+    }
+
+    if (fillChunk_l(mNextChunk) < 0) {
+        // Let the client see the error on its next miss.
+        mLastChunk = mNextChunk - 1;
+    } else {
+        ++mNextChunk;
+    }
+    return true;
+}
+
+ssize_t ReadAheadSession::fillChunk_l(int64_t chunk) {
+    const int index = chunk % DrmReadAheadRing::kNumSlots;
+    DrmReadAheadRing::Slot* slot = &mRing->slots[index];
+
+    // This is the only writer, so the slot can be checked without the
+    // sequence number.
+    if (slot->chunk == chunk) {
+        return slot->length;
+    }
+
+    android_atomic_inc(&slot->seq);
+
+    const ssize_t result = mDrmManager->pread(
+            mUniqueId, &mHandle, mRing->slotData(index), DrmReadAheadRing::kChunkSize,
+            chunk * DrmReadAheadRing::kChunkSize);
+
+    if (0 > result) {
+        slot->chunk = -1;
+        slot->length = 0;
+    } else {
+        slot->chunk = chunk;
+        slot->length = result;
+
+        // A short read usually means the end of the content. Readers fall
+        // back to pread() past the valid data, so this is only a hint.
+        if (DrmReadAheadRing::kChunkSize > result) {
+            mEndChunk = chunk + 1;
+        }
+    }
+
+    android_atomic_inc(&slot->seq);
+
+    ALOGV("Filled chunk %lld: %d", chunk, (int) result);
+    return result;
+}
@@ -18,11 +18,15 @@
 #define LOG_TAG "DrmManagerClientImpl(Native)"
 #include <utils/Log.h>
 
+#include <sys/mman.h>
+
+#include <cutils/atomic.h>
 #include <utils/String8.h>
 #include <utils/Vector.h>
 #include <binder/IServiceManager.h>
 
 #include "DrmManagerClientImpl.h"
+#include "DrmReadAheadRing.h"
 
 using namespace android;
 
@@ -272,6 +276,10 @@ status_t DrmManagerClientImpl::closeDecryptSession(
         int uniqueId, sp<DecryptHandle> &decryptHandle) {
     status_t status = DRM_ERROR_UNKNOWN;
     if (NULL != decryptHandle.get()) {
+        {
+            Mutex::Autolock _l(mReadAheadLock);
+            mReadAheadRings.removeItem(decryptHandle->decryptId);
+        }
         status = getDrmManagerService()->closeDecryptSession(
                 uniqueId, decryptHandle.get());
     }
@@ -317,12 +325,96 @@ ssize_t DrmManagerClientImpl::pread(int uniqueId, sp<DecryptHandle> &decryptHand
             void* buffer, ssize_t numBytes, off64_t offset) {
     ssize_t retCode = INVALID_VALUE;
     if ((NULL != decryptHandle.get()) && (NULL != buffer) && (0 < numBytes)) {
-        retCode = getDrmManagerService()->pread(
-                uniqueId, decryptHandle.get(), buffer, numBytes, offset);
+        sp<IMemoryHeap> ring = getReadAheadRing(uniqueId, decryptHandle);
+        if (NULL == ring.get()) {
+            return getDrmManagerService()->pread(
+                    uniqueId, decryptHandle.get(), buffer, numBytes, offset);
+        }
+
+        ssize_t numRead = 0;
+        while (numRead < numBytes) {
+            char* data = static_cast<char*>(buffer) + numRead;
+            const off64_t position = offset + numRead;
+
+            ssize_t result = readFromRing(ring, data, numBytes - numRead, position);
+            if (0 == result) {
+                // Have drmserver decrypt the chunk, and prefetch what follows
+                if (0 < getDrmManagerService()->fillReadAhead(
+                        uniqueId, decryptHandle.get(), position)) {
+                    result = readFromRing(ring, data, numBytes - numRead, position);
+                }
+            }
+            if (0 == result) {
+                // Past the end of the content, on errors, or if the chunk was
+                // replaced again before it could be read
+                result = getDrmManagerService()->pread(
+                        uniqueId, decryptHandle.get(), data, numBytes - numRead, position);
+                if (0 < result) {
+                    numRead += result;
+                } else if (0 == numRead) {
+                    return result;
+                }
+                break;
+            }
+            numRead += result;
+        }
+        retCode = numRead;
     }
     return retCode;
 }
 
+sp<IMemoryHeap> DrmManagerClientImpl::getReadAheadRing(
+        int uniqueId, sp<DecryptHandle> &decryptHandle) {
+    Mutex::Autolock _l(mReadAheadLock);
+    const ssize_t index = mReadAheadRings.indexOfKey(decryptHandle->decryptId);
+    if (0 <= index) {
+        return mReadAheadRings.valueAt(index);
+    }
+
+    sp<IMemoryHeap> ring;
+    if (DRM_NO_ERROR != getDrmManagerService()->startReadAhead(
+                uniqueId, decryptHandle.get(), &ring)
+            || MAP_FAILED == ring->getBase()
+            || DrmReadAheadRing::totalSize() > ring->getSize()) {
+        ALOGV("No read-ahead ring for decrypt session %d", decryptHandle->decryptId);
+        ring.clear();
+    }
+
+    // Also remember sessions without a ring, so they are not asked again.
+    mReadAheadRings.add(decryptHandle->decryptId, ring);
+    return ring;
+}
+
+ssize_t DrmManagerClientImpl::readFromRing(const sp<IMemoryHeap>& heap,
+        void* buffer, ssize_t numBytes, off64_t offset) {
+    DrmReadAheadRing* ring = static_cast<DrmReadAheadRing*>(heap->getBase());
+
+    const int64_t chunk = offset / DrmReadAheadRing::kChunkSize;
+    const int32_t offsetInChunk = offset % DrmReadAheadRing::kChunkSize;
+    const int index = chunk % DrmReadAheadRing::kNumSlots;
+    DrmReadAheadRing::Slot* slot = &ring->slots[index];
+
+    const int32_t seq = android_atomic_acquire_load(&slot->seq);
+    const int32_t length = slot->length;
+    if ((seq & 1) || slot->chunk != chunk || length <= offsetInChunk) {
+        return 0;
+    }
+
+    // length never exceeds the chunk size, so the copy stays in the slot
+    // even if drmserver is rewriting it.
+    ssize_t result = length - offsetInChunk;
+    if (result > numBytes) {
+        result = numBytes;
+    }
+    memcpy(buffer, ring->slotData(index) + offsetInChunk, result);
+
+    android_memory_barrier();
+    if (slot->seq != seq) {
+        return 0;
+    }
+    return result;
+}
+
 status_t DrmManagerClientImpl::notify(const DrmInfoEvent& event) {
     if (NULL != mOnInfoListener.get()) {
         Mutex::Autolock _l(mLock);
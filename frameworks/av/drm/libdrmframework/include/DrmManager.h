@@ -19,10 +19,12 @@
 
 #include <utils/Errors.h>
 #include <utils/threads.h>
+#include <binder/IMemory.h>
 #include <drm/drm_framework_common.h>
 #include "IDrmEngine.h"
 #include "PlugInManager.h"
 #include "IDrmServiceListener.h"
+#include "ReadAheadSession.h"
 
 namespace android {
 
@@ -130,6 +132,10 @@ public:
     ssize_t pread(int uniqueId, DecryptHandle* decryptHandle,
             void* buffer, ssize_t numBytes, off64_t offset);
 
+    status_t startReadAhead(int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap);
+
+    ssize_t fillReadAhead(int uniqueId, DecryptHandle* decryptHandle, off64_t offset);
+
     void onInfo(const DrmInfoEvent& event);
 
 private:
@@ -141,6 +147,8 @@ private:
 
     bool canHandle(int uniqueId, const String8& path);
 
+    void stopReadAhead(DecryptHandle* decryptHandle);
+
 private:
     enum {
         kMaxNumUniqueIds = 0x1000,
@@ -155,11 +163,13 @@ private:
     Mutex mListenerLock;
     Mutex mDecryptLock;
     Mutex mConvertLock;
+    Mutex mReadAheadLock;
     TPlugInManager<IDrmEngine> mPlugInManager;
     KeyedVector< DrmSupportInfo, String8 > mSupportInfoToPlugInIdMap;
     KeyedVector< int, IDrmEngine*> mConvertSessionMap;
     KeyedVector< int, sp<IDrmServiceListener> > mServiceListeners;
     KeyedVector< int, IDrmEngine*> mDecryptSessionMap;
+    KeyedVector< int, sp<ReadAheadSession> > mReadAheadSessionMap;
 };
 
 };
@@ -19,6 +19,7 @@
 
 #include <binder/IMemory.h>
 #include <utils/threads.h>
+#include <utils/KeyedVector.h>
 #include <drm/DrmManagerClient.h>
 
 #include "IDrmManagerService.h"
@@ -409,10 +410,29 @@ public:
      */
     status_t notify(const DrmInfoEvent& event);
 
+private:
+    /**
+     * Returns the read-ahead ring of a decrypt session, starting the
+     * read-ahead session on first use. Returns NULL if drmserver does not
+     * provide one for the session.
+     */
+    sp<IMemoryHeap> getReadAheadRing(int uniqueId, sp<DecryptHandle> &decryptHandle);
+
+    /**
+     * Copies up to numBytes from the read-ahead ring. Returns the number of
+     * bytes copied, 0 if the data at offset is not in the ring.
+     */
+    static ssize_t readFromRing(const sp<IMemoryHeap>& ring,
+            void* buffer, ssize_t numBytes, off64_t offset);
+
 private:
     Mutex mLock;
     sp<DrmManagerClient::OnInfoListener> mOnInfoListener;
 
+    Mutex mReadAheadLock;
+    // Read-ahead rings by decrypt id, NULL for sessions without one
+    KeyedVector<int, sp<IMemoryHeap> > mReadAheadRings;
+
     class DeathNotifier: public IBinder::DeathRecipient {
         public:
             DeathNotifier() {}
@@ -118,6 +118,10 @@ public:
     ssize_t pread(int uniqueId, DecryptHandle* decryptHandle,
             void* buffer, ssize_t numBytes, off64_t offset);
 
+    status_t startReadAhead(int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap);
+
+    ssize_t fillReadAhead(int uniqueId, DecryptHandle* decryptHandle, off64_t offset);
+
     virtual status_t dump(int fd, const Vector<String16>& args);
 
 private:
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DRM_READ_AHEAD_RING_H__
+#define __DRM_READ_AHEAD_RING_H__
+
+#include <stdint.h>
+
+namespace android {
+
+/**
+ * Layout of the shared memory of a read-ahead decrypt session.
+ *
+ * The decrypted content is cut into chunks of kChunkSize bytes. Chunk n of
+ * the content is only ever stored in slot (n % kNumSlots), so a reader finds
+ * the data for an offset without searching. The slot headers are followed
+ * by kNumSlots * kChunkSize bytes of data.
+ *
+ * drmserver is the only writer. Each slot is guarded by a sequence number,
+ * which is odd while the slot is being rewritten. Readers copy the data out
+ * and only use it if the sequence number was even and did not change.
+ */
+struct DrmReadAheadRing {
+    enum {
+        kNumSlots = 8,
+        kChunkSize = 32 * 1024,
+    };
+
+    struct Slot {
+        volatile int32_t seq;
+        // Number of valid bytes, less than kChunkSize at the end of the content
+        volatile int32_t length;
+        // Index of the chunk held by the slot, -1 if none
+        int64_t chunk;
+    };
+
+    Slot slots[kNumSlots];
+
+    static size_t totalSize() {
+        return sizeof(DrmReadAheadRing) + kNumSlots * kChunkSize;
+    }
+
+    uint8_t* slotData(int slot) {
+        return reinterpret_cast<uint8_t*>(this + 1) + slot * kChunkSize;
+    }
+};
+
+};
+
+#endif /* __DRM_READ_AHEAD_RING_H__ */
@@ -19,6 +19,7 @@
 
 #include <utils/RefBase.h>
 #include <binder/IInterface.h>
+#include <binder/IMemory.h>
 #include <binder/Parcel.h>
 #include <drm/drm_framework_common.h>
 #include "IDrmServiceListener.h"
@@ -75,7 +76,9 @@ public:
         INITIALIZE_DECRYPT_UNIT,
         DECRYPT,
         FINALIZE_DECRYPT_UNIT,
-        PREAD
+        PREAD,
+        START_READ_AHEAD,
+        FILL_READ_AHEAD
     };
 
 public:
@@ -161,6 +164,12 @@ public:
 
     virtual ssize_t pread(int uniqueId, DecryptHandle* decryptHandle,
             void* buffer, ssize_t numBytes,off64_t offset) = 0;
+
+    virtual status_t startReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap) = 0;
+
+    virtual ssize_t fillReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, off64_t offset) = 0;
 };
 
 /**
@@ -248,6 +257,12 @@ public:
 
     virtual ssize_t pread(int uniqueId, DecryptHandle* decryptHandle,
             void* buffer, ssize_t numBytes, off64_t offset);
+
+    virtual status_t startReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, sp<IMemoryHeap>* heap);
+
+    virtual ssize_t fillReadAhead(
+            int uniqueId, DecryptHandle* decryptHandle, off64_t offset);
 };
 
 /**
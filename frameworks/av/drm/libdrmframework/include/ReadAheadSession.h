@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __READ_AHEAD_SESSION_H__
+#define __READ_AHEAD_SESSION_H__
+
+#include <binder/MemoryHeapBase.h>
+#include <utils/threads.h>
+#include <drm/drm_framework_common.h>
+
+#include "DrmReadAheadRing.h"
+
+namespace android {
+
+class DrmManager;
+
+/**
+ * A read-ahead session decrypts the content of an open decrypt session in
+ * large chunks into a shared DrmReadAheadRing, which the client reads
+ * directly. The chunk a client asks for is decrypted synchronously, and the
+ * chunks following it are decrypted on the session's own thread.
+ */
+class ReadAheadSession : public Thread {
+public:
+    ReadAheadSession(DrmManager* drmManager, int uniqueId, const DecryptHandle& handle);
+    virtual ~ReadAheadSession();
+
+    /**
+     * Allocates the shared memory and starts the prefetch thread.
+     *
+     * @return status_t
+     *     Returns DRM_NO_ERROR for success, DRM_ERROR_UNKNOWN for failure
+     */
+    status_t start();
+
+    /**
+     * Stops the prefetch thread. No chunks are written afterwards.
+     */
+    void stop();
+
+    int getUniqueId() const { return mUniqueId; }
+
+    sp<IMemoryHeap> getHeap() const { return mHeap; }
+
+    /**
+     * Makes sure the chunk holding the given offset is in the ring, and
+     * schedules the chunks following it.
+     *
+     * @param[in] offset Offset of the content to be read
+     * @return Number of bytes in the chunk, 0 past the end of the content,
+     *     or a negative error
+     */
+    ssize_t fill(off64_t offset);
+
+private:
+    virtual bool threadLoop();
+
+    ssize_t fillChunk_l(int64_t chunk);
+
+    enum {
+        // Chunks decrypted ahead of the one being read. The ring keeps the
+        // chunk being read and the one before it.
+        kPrefetchChunks = DrmReadAheadRing::kNumSlots - 2,
+    };
+
+    DrmManager* mDrmManager;
+    const int mUniqueId;
+    DecryptHandle mHandle;
+
+    sp<MemoryHeapBase> mHeap;
+    DrmReadAheadRing* mRing;
+
+    // Guards the engine calls and the prefetch window
+    Mutex mLock;
+    Condition mCondition;
+    int64_t mNextChunk;
+    int64_t mLastChunk;
+    // Index of the first chunk past the end of the content, -1 if unknown
+    int64_t mEndChunk;
+};
+
+};
+
+#endif /* __READ_AHEAD_SESSION_H__ */
@@ -44,7 +44,8 @@ class CameraMetadata {
     CameraMetadata(const CameraMetadata &other);
 
     /**
-     * Assignment clones metadata buffer.
+     * Assignment clones metadata buffer, reusing the current buffer when the
+     * other metadata fits in it.
      */
     CameraMetadata &operator=(const CameraMetadata &other);
     CameraMetadata &operator=(const camera_metadata_t *buffer);
@@ -89,7 +90,8 @@ class CameraMetadata {
 
     /**
      * Acquires raw buffer from other CameraMetadata object. After the call, the argument
-     * object no longer has any metadata.
+     * object no longer has any metadata. Unlike acquiring a raw buffer, this doesn't
+     * validate the buffer again.
      */
     void acquire(CameraMetadata &other);
 
@@ -302,6 +302,9 @@ private:
 
     static sp<IAudioPolicyService> gAudioPolicyService;
 
+    // returns the output for the stream with default parameters, from gStreamOutputMap if cached
+    static audio_io_handle_t getDefaultOutput(audio_stream_type_t stream);
+
     // mapping between stream types and outputs
     static DefaultKeyedVector<audio_stream_type_t, audio_io_handle_t> gStreamOutputMap;
     // list of output descriptors containing cached parameters
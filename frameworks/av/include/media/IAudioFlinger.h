@@ -34,11 +34,29 @@
 #include <media/IEffect.h>
 #include <media/IEffectClient.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
 // ----------------------------------------------------------------------------
 
+// Timing breakdown of one fast mixer cycle, see IAudioFlinger::getFastMixerTimings().
+// All durations are in nanoseconds, and saturate at 0xFFFFFFFF.
+struct FastMixerCycleTiming {
+    enum {
+        FLAG_UNDERRUN = 0x1,    // the cycle took longer than the underrun threshold
+        FLAG_OVERRUN  = 0x2,    // the cycle was shorter than the overrun threshold
+    };
+    uint32_t    mSequence;      // cycle number, modulo 2^32
+    uint32_t    mCycleNs;       // wall clock time between the end of previous cycle and this one
+    uint32_t    mTracksNs;      // time spent to prepare the fast tracks, including framesReady()
+    uint32_t    mMixNs;         // time spent in AudioMixer::process(), which pulls the tracks
+    uint32_t    mWriteNs;       // time spent in the write() to the output sink
+    int32_t     mSlowestTrack;  // index of the fast track which took longest to prepare, or -1
+    uint32_t    mSlowestTrackNs; // preparation time of that fast track
+    uint32_t    mFlags;         // FLAG_*
+};
+
 class IAudioFlinger : public IInterface
 {
 public:
@@ -209,6 +227,14 @@ public:
     // and should be called at most once.  For a definition of what "low RAM" means, see
     // android.app.ActivityManager.isLowRamDevice().
     virtual status_t setLowRamDevice(bool isLowRamDevice) = 0;
+
+    // Return the timings of the most recent fast mixer cycles of an output, for continuous
+    // monitoring.  On input *cursor is the mSequence following the last cycle returned by the
+    // previous call, or 0 initially; on output it is updated for the next call.  Cycles that
+    // were overwritten before they could be read are skipped, which shows up as a gap in
+    // mSequence.  Returns INVALID_OPERATION if the output has no fast mixer.
+    virtual status_t getFastMixerTimings(audio_io_handle_t output, uint32_t *cursor,
+                                    Vector<FastMixerCycleTiming> *timings) = 0;
 };
 
 
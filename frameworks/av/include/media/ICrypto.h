@@ -15,6 +15,7 @@
  */
 
 #include <binder/IInterface.h>
+#include <binder/IMemory.h>
 #include <media/stagefright/foundation/ABase.h>
 #include <media/hardware/CryptoAPI.h>
 
@@ -51,6 +52,39 @@ struct ICrypto : public IInterface {
             void *dstPtr,
             AString *errorDetailMsg) = 0;
 
+    // One access unit of a decryptBatch() call.
+    struct DecryptUnit {
+        DecryptUnit();
+
+        CryptoPlugin::Mode mMode;
+        uint8_t mKey[16];
+        uint8_t mIV[16];
+        const void *mSrcPtr;
+        const CryptoPlugin::SubSample *mSubSamples;
+        size_t mNumSubSamples;
+
+        // In secure mode, mDstPtr is the opaque handle of the destination.
+        // Otherwise, if mDstHeap is set, the decrypted data is written
+        // straight into that shared memory at mDstOffset, and mDstPtr must
+        // point to the same memory in the caller. Without a heap, the data
+        // is copied back to mDstPtr.
+        void *mDstPtr;
+        sp<IMemoryHeap> mDstHeap;
+        size_t mDstOffset;
+
+        // Number of bytes decrypted, or an error.
+        ssize_t mResult;
+    };
+
+    // Decrypts several access units in a single transaction. Units are
+    // decrypted in order, and those following a failed unit are skipped
+    // with -ECANCELED as their result. Returns OK or the first error.
+    // All the units together must fit into a single binder transaction.
+    virtual status_t decryptBatch(
+            bool secure,
+            DecryptUnit *units, size_t numUnits,
+            AString *errorDetailMsg) = 0;
+
 private:
     DISALLOW_EVIL_CONSTRUCTORS(ICrypto);
 };
@@ -55,6 +55,11 @@ public:
     virtual status_t         decode(int fd, int64_t offset, int64_t length, uint32_t *pSampleRate,
                                     int* pNumChannels, audio_format_t* pFormat,
                                     const sp<IMemoryHeap>& heap, size_t *pSize) = 0;
+    // Like decode(), but the PCM is returned in read-only memory owned by
+    // the service, and shared with every client decoding the same content.
+    virtual status_t         decodeCached(int fd, int64_t offset, int64_t length,
+                                    uint32_t *pSampleRate, int* pNumChannels,
+                                    audio_format_t* pFormat, sp<IMemory>* pMem) = 0;
     virtual sp<IOMX>            getOMX() = 0;
     virtual sp<ICrypto>         makeCrypto() = 0;
     virtual sp<IDrm>            makeDrm() = 0;
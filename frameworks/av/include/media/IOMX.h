@@ -23,6 +23,7 @@
 #include <ui/GraphicBuffer.h>
 #include <utils/List.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 #include <OMX_Core.h>
 #include <OMX_Video.h>
@@ -134,6 +135,25 @@ public:
             OMX_U32 range_offset, OMX_U32 range_length,
             OMX_U32 flags, OMX_TICKS timestamp) = 0;
 
+    // One fillBuffer (mIsEmpty == false) or emptyBuffer (mIsEmpty == true)
+    // request, see submitBuffers. The range, flags and timestamp are only
+    // used by emptyBuffer requests.
+    struct BufferRequest {
+        buffer_id mBuffer;
+        bool mIsEmpty;
+        OMX_U32 mRangeOffset;
+        OMX_U32 mRangeLength;
+        OMX_U32 mFlags;
+        OMX_TICKS mTimestamp;
+    };
+
+    // Hands a number of buffers to the component in one call, in order,
+    // which saves one binder transaction per buffer over calling fillBuffer
+    // and emptyBuffer for each of them. Stops at the first request that
+    // fails and returns its error.
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferRequest> &requests) = 0;
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -143,6 +163,9 @@ public:
         INTERNAL_OPTION_SUSPEND,  // data is a bool
         INTERNAL_OPTION_REPEAT_PREVIOUS_FRAME_DELAY,  // data is an int64_t
         INTERNAL_OPTION_MAX_TIMESTAMP_GAP, // data is int64_t
+        INTERNAL_OPTION_MAX_FPS, // data is a float
+        INTERNAL_OPTION_DROP_DUPLICATE_FRAMES, // data is a bool
+        INTERNAL_OPTION_MAX_FRAME_LATENCY, // data is an int64_t
     };
     virtual status_t setInternalOption(
             node_id node,
@@ -194,6 +217,11 @@ public:
     DECLARE_META_INTERFACE(OMXObserver);
 
     virtual void onMessage(const omx_message &msg) = 0;
+
+    // Delivers all the messages that were pending for a node at once, in
+    // order. Remote observers receive them in a single transaction; the
+    // default implementation calls onMessage for each of them.
+    virtual void onMessages(const List<omx_message> &messages);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -139,6 +139,7 @@ public:
     int state() { return mState; }
     void setPriority(int priority) { mPriority = priority; }
     void setLoop(int loop);
+    bool hasTrackFor(const sp<Sample>& sample);
     int numChannels() { return mNumChannels; }
     void clearNextEvent() { mNextEvent.clear(); }
     void nextEvent();
@@ -149,6 +150,7 @@ private:
     static void callback(int event, void* user, void *info);
     void process(int event, void *info, unsigned long toggle);
     bool doStop_l();
+    bool reuseTrack_l(const sp<Sample>& sample, uint32_t sampleRate, uint32_t frameCount);
 
     SoundPool*          mSoundPool;
     sp<AudioTrack>      mAudioTrack;
@@ -203,7 +205,7 @@ private:
     sp<Sample> findSample(int sampleID) { return mSamples.valueFor(sampleID); }
     SoundChannel* findChannel (int channelID);
     SoundChannel* findNextChannel (int channelID);
-    SoundChannel* allocateChannel_l(int priority);
+    SoundChannel* allocateChannel_l(int priority, const sp<Sample>& sample);
     void moveToFront_l(SoundChannel* channel);
     void notify(SoundPoolEvent event);
     void dump();
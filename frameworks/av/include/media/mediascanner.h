@@ -59,17 +59,29 @@ struct MediaScanner {
 protected:
     const char *locale() const;
 
+    // When enabled, processDirectory() reads each directory twice and hands
+    // the regular files in it to prefetchFile() before reporting any of them
+    // to the client.
+    void setPrefetchEnabled(bool enabled);
+
+    // Called with files that processFile() is likely to be asked about
+    // shortly, so that their metadata can be extracted ahead of time.
+    virtual void prefetchFile(
+            const char *path, long long lastModified, long long fileSize);
+
 private:
     // current locale (like "ja_JP"), created/destroyed with strdup()/free()
     char *mLocale;
     char *mSkipList;
     int *mSkipIndex;
+    bool mPrefetchEnabled;
 
     MediaScanResult doProcessDirectory(
             char *path, int pathRemaining, MediaScannerClient &client, bool noMedia);
     MediaScanResult doProcessDirectoryEntry(
             char *path, int pathRemaining, MediaScannerClient &client, bool noMedia,
             struct dirent* entry, char* fileSpot);
+    void prefetchDirectory(char *path, int pathRemaining, char *fileSpot);
     void loadSkipList();
     bool shouldSkipDirectory(char *path);
 
@@ -94,6 +94,33 @@ public:
             // Return NO_ERROR if there is a timestamp available
             status_t getTimestamp(AudioTimestamp& timestamp);
 
+            // Adaptive setpoint mode, for a blocking write side.  The setpoint of the throttle in
+            // write() then follows the jitter observed between writer and reader instead of
+            // staying where setAvgFrames() put it: it is raised as soon as the reader underruns,
+            // and lowered when the pipe never drained below the margin needed for the observed
+            // write jitter during the last kAdaptWindowMs.  The setpoint stays within
+            // [minSetpoint, maxSetpoint]; maxSetpoint is clamped to maxFrames().
+            // Only the effective depth is adapted, the buffer itself is not reallocated.
+            // Changes are applied at the start of write(), so this must be called by the writer.
+            // Calling setAvgFrames() leaves adaptive mode.
+            void    setAdaptiveSetpoint(size_t minSetpoint, size_t maxSetpoint);
+            bool    isAdaptive() const { return mAdaptive; }
+
+            // Latency statistics of adaptive mode, maintained by the writer.
+            struct AdaptiveStats {
+                size_t   mSetpoint;         // current setpoint, in frames
+                size_t   mMinFill;          // lowest fill seen by write() in the last window
+                uint32_t mMaxJitterUs;      // worst write() period deviation in the last window
+                uint32_t mUnderruns;        // reader underruns since adaptive mode was enabled
+                uint32_t mRaises;           // number of setpoint increases
+                uint32_t mLowers;           // number of setpoint decreases
+            };
+            // Valid for the writer; other threads get a snapshot that may not be consistent.
+            const AdaptiveStats& adaptiveStats() const { return mAdaptiveStats; }
+
+            // duration of the observation window before the setpoint is lowered
+            static const uint32_t kAdaptWindowMs = 2000;
+
 private:
     // A pair of methods and a helper variable which allows the reader and the
     // writer to update and observe the values of mFront and mNextRdPTS in an
@@ -134,6 +161,21 @@ private:
 
     bool            mIsShutdown;    // whether shutdown(true) was called, no barriers are needed
 
+    // adaptive setpoint, see setAdaptiveSetpoint(); all but mReaderUnderruns are writer only
+    void            adaptSetpoint();
+    bool            mAdaptive;
+    size_t          mMinSetpoint;
+    size_t          mMaxSetpoint;
+    size_t          mWindowMinFill;     // lowest fill at the start of write() in this window
+    size_t          mWindowFrames;      // frames written in this window
+    uint32_t        mWindowMaxJitterNs;
+    size_t          mLastWriteFrames;   // frames written by the previous write()
+    bool            mAdaptTsValid;
+    struct timespec mAdaptTs;           // time that the previous write() started
+    int32_t         mReaderUnderrunsSeen;
+    volatile int32_t mReaderUnderruns;  // written by the reader with android_atomic_release_store
+    AdaptiveStats   mAdaptiveStats;
+
     AudioTimestampSingleStateQueue::Shared      mTimestampShared;
     AudioTimestampSingleStateQueue::Mutator     mTimestampMutator;
     AudioTimestampSingleStateQueue::Observer    mTimestampObserver;
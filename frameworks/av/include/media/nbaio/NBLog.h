@@ -21,6 +21,7 @@
 
 #include <binder/IMemory.h>
 #include <utils/Mutex.h>
+#include <utils/Vector.h>
 #include <media/nbaio/roundup.h>
 
 namespace android {
@@ -38,6 +39,7 @@ enum Event {
     EVENT_RESERVED,
     EVENT_STRING,               // ASCII string, not NUL-terminated
     EVENT_TIMESTAMP,            // clock_gettime(CLOCK_MONOTONIC)
+    EVENT_ID,                   // IdEvent, only the used arguments are stored
 };
 
 // ---------------------------------------------------------------------------
@@ -79,6 +81,52 @@ struct Shared {
 
 public:
 
+// Identifiers of the structured events.  New identifiers must be added at the end,
+// along with their name in NBLog.cpp, as they are stored in the logs.
+enum EventId {
+    EVENT_ID_ACODEC_EMPTY_BUFFER,       // arg0 = buffer id, arg1 = size in bytes
+    EVENT_ID_ACODEC_EMPTY_BUFFER_DONE,  // arg0 = buffer id
+    EVENT_ID_ACODEC_FILL_BUFFER_DONE,   // arg0 = buffer id, arg1 = size in bytes
+    EVENT_ID_ACODEC_OUTPUT_DRAINED,     // arg0 = buffer id, arg1 = whether rendered
+    EVENT_ID_NUPLAYER_FEED_INPUT,       // arg0 = whether audio
+    EVENT_ID_NUPLAYER_RENDER_BUFFER,    // arg0 = whether audio
+    EVENT_ID_NUPLAYER_DRAIN_AUDIO,      // arg0 = frames the sink can take
+    EVENT_ID_NUPLAYER_DRAIN_VIDEO,      // arg0 = lateness in ms, arg1 = whether rendered
+    EVENT_ID_CAMERA_CAPTURE_RESULT,     // arg0 = frame number, arg1 = number of buffers
+    EVENT_ID_RECORD_READ,               // begin/end, arg0 = bytes read at end
+    EVENT_ID_COUNT
+};
+
+enum Phase {
+    PHASE_INSTANT,
+    PHASE_BEGIN,
+    PHASE_END,
+};
+
+// Payload of an EVENT_ID entry.  The events are fixed size binary records, so writing one
+// costs a clock read and a copy, with no formatting.
+struct IdEvent {
+    static const size_t kMaxArgs = 2;
+
+    int64_t     mTimeNs;        // CLOCK_MONOTONIC
+    int32_t     mTid;           // thread which logged the event
+    uint16_t    mId;            // EventId
+    uint8_t     mPhase;         // Phase
+    uint8_t     mNumArgs;       // number of valid entries in mArgs
+    int32_t     mArgs[kMaxArgs];
+};
+
+static const char *eventName(int id);
+
+// Formats the name, phase, thread and arguments of an event, without its timestamp
+static void formatEvent(char *buffer, size_t size, const IdEvent& event);
+
+// Returns the writer shared by all threads of the named service in this process.  The
+// writer is registered with media.log, whose dump merges the events of all writers into a
+// single time-ordered stream.  A disabled writer is returned outside of mediaserver, or when
+// media.log is not running.
+static sp<Writer> getServiceWriter(const char *name);
+
 // ---------------------------------------------------------------------------
 
 // FIXME Timeline was intended to wrap Writer and Reader, but isn't actually used yet.
@@ -126,6 +174,11 @@ public:
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
 
+    // Log a structured event, with a timestamp taken now
+    virtual void    logEvent(EventId id, int32_t arg0 = 0, int32_t arg1 = 0);
+    virtual void    logBegin(EventId id);
+    virtual void    logEnd(EventId id, int32_t arg0 = 0);
+
     virtual bool    isEnabled() const;
 
     // return value for all of these is the previous isEnabled()
@@ -135,10 +188,15 @@ public:
 
     sp<IMemory>     getIMemory() const  { return mIMemory; }
 
-private:
+protected:
     void    log(Event event, const void *data, size_t length);
     void    log(const Entry *entry, bool trusted = false);
 
+    // Fills in an IdEvent for the current time and thread, and returns its logged length
+    static size_t makeIdEvent(IdEvent *event, EventId id, Phase phase, size_t numArgs,
+                              int32_t arg0, int32_t arg1);
+
+private:
     const size_t    mSize;      // circular buffer size in bytes, must be a power of 2
     Shared* const   mShared;    // raw pointer to shared memory
     const sp<IMemory> mIMemory; // ref-counted version
@@ -153,6 +211,7 @@ class LockedWriter : public Writer {
 public:
     LockedWriter();
     LockedWriter(size_t size, void *shared);
+    LockedWriter(size_t size, const sp<IMemory>& iMemory);
 
     virtual void    log(const char *string);
     virtual void    logf(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
@@ -160,6 +219,10 @@ public:
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
 
+    virtual void    logEvent(EventId id, int32_t arg0 = 0, int32_t arg1 = 0);
+    virtual void    logBegin(EventId id);
+    virtual void    logEnd(EventId id, int32_t arg0 = 0);
+
     virtual bool    isEnabled() const;
     virtual bool    setEnabled(bool enabled);
 
@@ -182,7 +245,17 @@ public:
     void    dump(int fd, size_t indent = 0);
     bool    isIMemory(const sp<IMemory>& iMemory) const;
 
+    // Appends the structured events logged since the last dump or read to 'events',
+    // oldest first, and skips the other entries.
+    void    readEvents(Vector<IdEvent>& events);
+
 private:
+    // Copies the entries logged since the last dump or read, and advances past them.
+    // Returns NULL if there are none, otherwise a buffer of 'avail' bytes to be deleted by
+    // the caller, in which the first complete entry starts at 'first'.  The number of bytes
+    // of entries overwritten before they could be read is returned in 'lost'.
+    uint8_t *copyEntries(size_t& avail, size_t& first, size_t& lost, time_t& maxSec);
+
     const size_t    mSize;      // circular buffer size in bytes, must be a power of 2
     const Shared* const mShared; // raw pointer to shared memory
     const sp<IMemory> mIMemory; // ref-counted version
@@ -20,9 +20,12 @@
 
 #include <stdint.h>
 #include <android/native_window.h>
+#include <binder/IMemory.h>
 #include <media/IOMX.h>
+#include <media/nbaio/NBLog.h>
 #include <media/stagefright/foundation/AHierarchicalStateMachine.h>
 #include <media/stagefright/SkipCutBuffer.h>
+#include <utils/Mutex.h>
 #include <OMX_Audio.h>
 
 #define TRACK_BUFFER_TIMING     0
@@ -69,19 +72,39 @@ struct ACodec : public AHierarchicalStateMachine {
 
     bool isConfiguredForAdaptivePlayback() { return mIsConfiguredForAdaptivePlayback; }
 
+    // Decode to display latency of the frames rendered in tunneled mode,
+    // since the codec was configured.
+    struct RenderStats {
+        size_t mNumFrames;
+        size_t mNumLateFrames;
+        int64_t mTotalLatencyUs;
+        int64_t mMaxLatencyUs;
+    };
+
+    // Can be called from any thread. Returns false if the codec is not
+    // configured for tunneled rendering.
+    bool getRenderStats(RenderStats *stats) const;
+
     struct PortDescription : public RefBase {
         size_t countBuffers();
         IOMX::buffer_id bufferIDAt(size_t index) const;
         sp<ABuffer> bufferAt(size_t index) const;
 
+        // The shared memory backing the buffer, or NULL if the buffer does
+        // not live in shared memory of this process.
+        sp<IMemory> memoryAt(size_t index) const;
+
     private:
         friend struct ACodec;
 
         Vector<IOMX::buffer_id> mBufferIDs;
         Vector<sp<ABuffer> > mBuffers;
+        Vector<sp<IMemory> > mMemories;
 
         PortDescription();
-        void addBuffer(IOMX::buffer_id id, const sp<ABuffer> &buffer);
+        void addBuffer(
+                IOMX::buffer_id id, const sp<ABuffer> &buffer,
+                const sp<IMemory> &mem);
 
         DISALLOW_EVIL_CONSTRUCTORS(PortDescription);
     };
@@ -119,6 +142,7 @@ private:
         kWhatRequestIDRFrame         = 'ridr',
         kWhatSetParameters           = 'setP',
         kWhatSubmitOutputMetaDataBufferIfEOS = 'subm',
+        kWhatDeliverTunneledEOS      = 'tEOS',
     };
 
     enum {
@@ -145,6 +169,7 @@ private:
         unsigned mDequeuedAt;
 
         sp<ABuffer> mData;
+        sp<IMemory> mMemRef;
         sp<GraphicBuffer> mGraphicBuffer;
     };
 
@@ -183,11 +208,18 @@ private:
     bool mPortEOS[2];
     status_t mInputEOSResult;
 
+    // Buffer flow events, shared with the other codecs of mediaserver
+    sp<NBLog::Writer> mNBLogWriter;
+
     List<sp<AMessage> > mDeferredQueue;
 
     bool mSentFormat;
     bool mIsEncoder;
     bool mUseMetadataOnEncoderOutput;
+
+    // Set for encoders configured with "mbs-per-slice": output buffers
+    // lacking OMX_BUFFERFLAG_ENDOFFRAME then hold part of a frame.
+    bool mReportPartialFrames;
     bool mShutdownInProgress;
     bool mIsConfiguredForAdaptivePlayback;
 
@@ -206,6 +238,30 @@ private:
 
     int64_t mRepeatFrameDelayUs;
     int64_t mMaxPtsGapUs;
+    float mMaxFps;
+    bool mDropDuplicateFrames;
+    int64_t mMaxFrameLatencyUs;
+
+    // In tunneled mode ("tunneled-render" set at configure time) decoded
+    // video frames are queued to the native window at their presentation
+    // time without being handed to the client. Media time maps to real time
+    // through the "render-media-time-us"/"render-real-time-us" parameters;
+    // until they are set, frames are rendered as soon as they are decoded.
+    bool mTunneledRender;
+    int32_t mTunnelGeneration;
+    int64_t mRenderMediaTimeUs;
+    int64_t mRenderRealTimeUs;
+
+    // Also logged (verbose) every kRenderStatsPeriod frames.
+    enum {
+        kRenderStatsPeriod = 300,
+    };
+    mutable Mutex mRenderStatsLock;
+    bool mRenderStatsEnabled;
+    RenderStats mRenderStats;
+
+    int64_t getRenderDelayUs(int64_t timeUs) const;
+    void updateRenderStats(int64_t fillDoneUs, int64_t dueUs);
 
     status_t setCyclicIntraMacroblockRefresh(const sp<AMessage> &msg, int32_t mode);
     status_t allocateBuffersOnPort(OMX_U32 portIndex);
@@ -27,6 +27,9 @@
 
 namespace android {
 
+// Converts YUV frames to OMX_COLOR_Format16bitRGB565 or
+// OMX_COLOR_Format32BitRGBA8888. Large frames are split into bands of rows
+// converted on several threads.
 struct ColorConverter {
     ColorConverter(OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to);
     ~ColorConverter();
@@ -59,11 +62,21 @@ private:
         size_t mCropLeft, mCropTop, mCropRight, mCropBottom;
     };
 
+    struct Frame;
+    struct ThreadPool;
+
     OMX_COLOR_FORMATTYPE mSrcFormat, mDstFormat;
     uint8_t *mClip;
+    bool mUseNeon;
+    ThreadPool *mThreadPool;
 
     uint8_t *initClip();
 
+    size_t bytesPerDstPixel() const;
+    void initFrame(const BitmapParams &dst, bool swapRB, Frame *frame);
+    void convertFrame(const Frame &frame);
+    static void ConvertRows(const Frame &frame, size_t firstRow, size_t endRow);
+
     status_t convertCbYCrY(
             const BitmapParams &src, const BitmapParams &dst);
 
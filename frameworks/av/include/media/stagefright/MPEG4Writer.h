@@ -23,6 +23,7 @@
 #include <media/stagefright/MediaWriter.h>
 #include <utils/List.h>
 #include <utils/threads.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -97,6 +98,14 @@ private:
     bool mAreGeoTagsAvailable;
     int32_t mStartTimeOffsetMs;
 
+    // In a fragmented file the moov box right after ftyp has no samples,
+    // they are described by the moof box in front of each chunk instead.
+    int64_t mFragmentDurationUs;  // 0 if the file is not fragmented
+    bool mMoovBoxWritten;
+    uint32_t mFragmentSequenceNumber;
+    int64_t mMovieStartTimestampUs;  // Fragment decoding times start here
+    off64_t mFragmentDurationOffset;  // Of the duration field in mehd
+
     Mutex mLock;
 
     List<Track *> mTracks;
@@ -114,11 +123,16 @@ private:
         int64_t             mTimeStampUs;   // Timestamp of the 1st sample
         List<MediaBuffer *> mSamples;       // Sample data
 
+        // Fragmented files only
+        int64_t             mDecodingTimeTicks;  // Of the 1st sample
+        Vector<uint32_t>    mRunEntries;    // trun entries in network byte order
+
         // Convenient constructor
-        Chunk(): mTrack(NULL), mTimeStampUs(0) {}
+        Chunk(): mTrack(NULL), mTimeStampUs(0), mDecodingTimeTicks(0) {}
 
         Chunk(Track *track, int64_t timeUs, List<MediaBuffer *> samples)
-            : mTrack(track), mTimeStampUs(timeUs), mSamples(samples) {
+            : mTrack(track), mTimeStampUs(timeUs), mSamples(samples),
+              mDecodingTimeTicks(0) {
         }
 
     };
@@ -159,6 +173,11 @@ private:
     // Actually write the given chunk to the file.
     void writeChunkToFile(Chunk* chunk);
 
+    // Write the given chunk as a movie fragment, preceded by the moov box
+    // if this is the first one.
+    void writeFragment(Chunk* chunk);
+    bool writeFragmentedMoovBox();
+
     // Adjust other track media clock (presumably wall clock)
     // based on audio track media clock with the drift time.
     int64_t mDriftTimeUs;
@@ -183,14 +202,38 @@ private:
     off64_t addSample_l(MediaBuffer *buffer);
     off64_t addLengthPrefixedSample_l(MediaBuffer *buffer);
 
+    // Sample data is collected in mWriteBuffer and written out with a
+    // single pwrite() once the buffer is full, or as soon as the writer
+    // thread runs out of chunks to write.
+    Mutex mWriteBufferLock;
+    uint8_t *mWriteBuffer;
+    size_t mWriteBufferLength;
+    off64_t mWriteBufferOffset;  // File offset of mWriteBuffer[0]
+
+    // Write latency statistics, reported when the recording stops.
+    size_t mNumWrites;
+    int64_t mNumBytesWritten;
+    int64_t mTotalWriteTimeUs;
+    int64_t mMaxWriteTimeUs;
+
+    // Appends to the sample data at mOffset.
+    void writeSampleData(const void *data, size_t size);
+
+    // Returns true if anything had to be written.
+    bool flushWriteBuffer();
+    void pwriteFully_l(const void *data, size_t size, off64_t offset);
+
     bool exceedsFileSizeLimit();
     bool use32BitFileOffset() const;
     bool exceedsFileDurationLimit();
     bool isFileStreamable() const;
+    bool isFragmented() const { return mFragmentDurationUs > 0; }
+    int64_t fragmentDuration() const { return mFragmentDurationUs; }
     void trackProgressStatus(size_t trackId, int64_t timeUs, status_t err = OK);
     void writeCompositionMatrix(int32_t degrees);
     void writeMvhdBox(int64_t durationUs);
     void writeMoovBox(int64_t durationUs);
+    void writeMvexBox();
     void writeFtypBox(MetaData *param);
     void writeUdtaBox();
     void writeGeoDataBox();
@@ -34,9 +34,21 @@ public:
 
     void add_buffer(MediaBuffer *buffer);
 
-    // Blocks until a buffer is available and returns it to the caller,
-    // the returned buffer will have a reference count of 1.
-    status_t acquire_buffer(MediaBuffer **buffer);
+    // Returns an unused buffer to the caller, the returned buffer will have
+    // a reference count of 1. If all buffers are in use, blocks until one
+    // is returned, for at most timeoutUs if it is not negative. Returns
+    // WOULD_BLOCK if timeoutUs is 0 and TIMED_OUT if the timeout expired.
+    status_t acquire_buffer(MediaBuffer **buffer, int64_t timeoutUs = -1);
+
+    struct Stats {
+        // Number of acquire_buffer() calls that had to wait for a buffer
+        uint32_t mStarvedCount;
+        // Total and longest time spent waiting for a buffer
+        int64_t mStarvedTimeUs;
+        int64_t mMaxStarvedTimeUs;
+    };
+
+    void getStats(Stats *stats);
 
 protected:
     virtual void signalBufferReturned(MediaBuffer *buffer);
@@ -49,6 +61,14 @@ private:
 
     MediaBuffer *mFirstBuffer, *mLastBuffer;
 
+    // Number of threads waiting in acquire_buffer(), buffers returned
+    // while there are none do not need to take mLock.
+    volatile int32_t mWaiters;
+
+    Stats mStats;
+
+    MediaBuffer *tryAcquire();
+
     MediaBufferGroup(const MediaBufferGroup &);
     MediaBufferGroup &operator=(const MediaBufferGroup &);
 };
@@ -18,6 +18,7 @@
 
 #define MEDIA_CODEC_H_
 
+#include <binder/IMemory.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <media/hardware/CryptoAPI.h>
 #include <media/stagefright/foundation/AHandler.h>
@@ -42,6 +43,10 @@ struct MediaCodec : public AHandler {
         BUFFER_FLAG_SYNCFRAME   = 1,
         BUFFER_FLAG_CODECCONFIG = 2,
         BUFFER_FLAG_EOS         = 4,
+        // Output only: the buffer holds some of the slices of a frame,
+        // the rest follows with the same timestamp. Only encoders
+        // configured with "mbs-per-slice" produce these.
+        BUFFER_FLAG_PARTIAL_FRAME = 8,
     };
 
     static sp<MediaCodec> CreateByType(
@@ -101,10 +106,47 @@ struct MediaCodec : public AHandler {
             int64_t timeoutUs = 0ll);
 
     status_t renderOutputBufferAndRelease(size_t index);
+
+    // Same as above, the buffer is presented at timestampNs instead of the
+    // time it is rendered at.
+    status_t renderOutputBufferAndRelease(size_t index, int64_t timestampNs);
     status_t releaseOutputBuffer(size_t index);
 
+    // Batched variants of the above, for codecs whose buffers are small
+    // enough that the round trip to the looper dominates.
+    struct BufferEntry {
+        size_t mIndex;
+        size_t mOffset;
+        size_t mSize;
+        int64_t mPresentationTimeUs;
+        uint32_t mFlags;
+    };
+
+    // Queues non-secure input buffers in order, stopping at the first one
+    // that fails. "numQueued" is set to the number of buffers queued.
+    status_t queueInputBuffers(
+            const BufferEntry *entries, size_t count, size_t *numQueued,
+            AString *errorDetailMsg = NULL);
+
+    // Waits up to "timeoutUs" for an output buffer like dequeueOutputBuffer,
+    // then also takes the ones that are ready behind it, up to "maxCount".
+    // "entries" is only filled in if OK is returned.
+    status_t dequeueOutputBuffers(
+            Vector<BufferEntry> *entries, size_t maxCount,
+            int64_t timeoutUs = 0ll);
+
+    // Releases output buffers in order, stopping at the first one that
+    // fails. "numReleased" is set to the number of buffers released.
+    status_t releaseOutputBuffers(
+            const size_t *indices, size_t count, bool render,
+            size_t *numReleased);
+
     status_t signalEndOfInputStream();
 
+    // In tunneled render mode the format also carries the decode to display
+    // statistics since configure(): "tunneled-render-frames" and
+    // "tunneled-render-late-frames" (int32), "tunneled-render-avg-latency-us"
+    // and "tunneled-render-max-latency-us" (int64).
     status_t getOutputFormat(sp<AMessage> *format) const;
 
     status_t getInputBuffers(Vector<sp<ABuffer> > *buffers) const;
@@ -153,8 +195,10 @@ private:
         kWhatRelease                        = 'rele',
         kWhatDequeueInputBuffer             = 'deqI',
         kWhatQueueInputBuffer               = 'queI',
+        kWhatQueueInputBuffers              = 'quIs',
         kWhatDequeueOutputBuffer            = 'deqO',
         kWhatReleaseOutputBuffer            = 'relO',
+        kWhatReleaseOutputBuffers           = 'rlOs',
         kWhatSignalEndOfInputStream         = 'eois',
         kWhatGetBuffers                     = 'getB',
         kWhatFlush                          = 'flus',
@@ -185,6 +229,7 @@ private:
         void *mBufferID;
         sp<ABuffer> mData;
         sp<ABuffer> mEncryptedData;
+        sp<IMemory> mSharedMemory;
         sp<AMessage> mNotify;
         bool mOwnedByClient;
     };
@@ -209,6 +254,10 @@ private:
     int32_t mDequeueOutputTimeoutGeneration;
     uint32_t mDequeueOutputReplyID;
 
+    // Where a pending dequeueOutputBuffers() collects its buffers, or NULL.
+    Vector<BufferEntry> *mDequeueOutputEntries;
+    size_t mDequeueOutputMaxCount;
+
     sp<ICrypto> mCrypto;
 
     List<sp<ABuffer> > mCSD;
@@ -234,6 +283,7 @@ private:
 
     bool handleDequeueInputBuffer(uint32_t replyID, bool newRequest = false);
     bool handleDequeueOutputBuffer(uint32_t replyID, bool newRequest = false);
+    void getOutputBufferEntry(size_t index, BufferEntry *entry) const;
     void cancelPendingDequeueOperations();
 
     void extractCSD(const sp<AMessage> &format);
@@ -21,9 +21,11 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AString.h>
 
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
+#include <utils/threads.h>
 #include <utils/Vector.h>
 
 namespace android {
@@ -69,6 +71,12 @@ private:
         uint32_t mQuirks;
     };
 
+    struct Capabilities {
+        Vector<ProfileLevel> mProfileLevels;
+        Vector<uint32_t> mColorFormats;
+        uint32_t mFlags;
+    };
+
     static MediaCodecList *sCodecList;
 
     status_t mInitCheck;
@@ -79,12 +87,21 @@ private:
     KeyedVector<AString, size_t> mCodecQuirks;
     KeyedVector<AString, size_t> mTypes;
 
+    // Querying a codec means instantiating it, remember the answers.
+    mutable Mutex mCapabilitiesLock;
+    mutable KeyedVector<AString, Capabilities> mCapabilities;
+
     MediaCodecList();
     ~MediaCodecList();
 
     status_t initCheck() const;
     void parseXMLFile(FILE *file);
 
+    // The parsed configuration is kept in a binary file that is mapped by
+    // every process instead of parsing the xml file again.
+    bool loadCache(const struct stat &xmlStat);
+    void writeCache(const struct stat &xmlStat) const;
+
     static void StartElementHandlerWrapper(
             void *me, const char *name, const char **attrs);
 
@@ -44,6 +44,14 @@ public:
     // returns an empty metadata object.
     virtual sp<MetaData> getMetaData();
 
+    enum GetMetaDataFlags {
+        kIncludeAlbumArt = 1
+    };
+    // Like getMetaData(), but extractors that have to read album art
+    // separately leave it out unless kIncludeAlbumArt is set. The default
+    // implementation returns getMetaData().
+    virtual sp<MetaData> getMetaDataWithFlags(uint32_t flags);
+
     enum Flags {
         CAN_SEEK_BACKWARD  = 1,  // the "seek 10secs back button"
         CAN_SEEK_FORWARD   = 2,  // the "seek 10secs forward button"
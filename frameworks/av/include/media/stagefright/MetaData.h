@@ -113,6 +113,10 @@ enum {
     kKeyTrackTimeStatus   = 'tktm',  // int64_t
 
     kKeyRealTimeRecording = 'rtrc',  // bool (int32_t)
+
+    // Set this key to author a fragmented file, with a movie fragment
+    // about every so many usecs
+    kKeyMovieFragmentDuration = 'mfrd',  // int64_t (usecs)
     kKeyNumBuffers        = 'nbbf',  // int32_t
 
     // Ogg files can be tagged to be automatically looping...
@@ -217,6 +221,11 @@ public:
 
     void dumpToLog() const;
 
+    // MetaData objects are allocated from a small free list, as every
+    // MediaBuffer carries one.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
 protected:
     virtual ~MetaData();
 
@@ -237,9 +246,12 @@ private:
         uint32_t mType;
         size_t mSize;
 
+        // Values of up to 16 bytes, which covers all scalars and rects, are
+        // stored inline. Larger values live in a SharedBuffer that copies
+        // of the item share, as values are never modified in place.
         union {
             void *ext_data;
-            float reservoir;
+            int64_t reservoir[2];
         } u;
 
         bool usesReservoir() const {
@@ -248,6 +260,7 @@ private:
 
         void allocateStorage(size_t size);
         void freeStorage();
+        void copyFrom(const typed_data &from);
 
         void *storage() {
             return usesReservoir() ? &u.reservoir : u.ext_data;
@@ -262,8 +275,19 @@ private:
         int32_t mLeft, mTop, mRight, mBottom;
     };
 
+    // The first few items are kept inline, any further ones in mItems.
+    // Buffers typically carry no more than a time stamp and a few flags.
+    enum {
+        kNumInlineItems = 4,
+    };
+    size_t mNumInlineItems;
+    uint32_t mInlineKeys[kNumInlineItems];
+    typed_data mInlineItems[kNumInlineItems];
+
     KeyedVector<uint32_t, typed_data> mItems;
 
+    ssize_t indexOfInlineKey(uint32_t key) const;
+
     // MetaData &operator=(const MetaData &);
 };
 
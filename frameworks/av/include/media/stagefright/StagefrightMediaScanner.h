@@ -19,6 +19,8 @@
 #define STAGEFRIGHT_MEDIA_SCANNER_H_
 
 #include <media/mediascanner.h>
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
 
 namespace android {
 
@@ -30,15 +32,46 @@ struct StagefrightMediaScanner : public MediaScanner {
             const char *path, const char *mimeType,
             MediaScannerClient &client);
 
+    virtual MediaScanResult processDirectory(
+            const char *path, MediaScannerClient &client);
+
     virtual char *extractAlbumArt(int fd);
 
+protected:
+    virtual void prefetchFile(
+            const char *path, long long lastModified, long long fileSize);
+
 private:
+    struct Prefetcher;
+
+    // What a file looked like when its metadata was last handed to a client.
+    struct JournalEntry {
+        long long mLastModified;
+        long long mFileSize;
+        bool mSeen;
+    };
+
+    // Extracts metadata on worker threads if "media.scanner.threads" > 1.
+    Prefetcher *mPrefetcher;
+
+    // Persisted in "media.scanner.journal", if set, so that files that did
+    // not change since the last scan are not prefetched.
+    String8 mJournalPath;
+    KeyedVector<String8, JournalEntry> mJournal;
+    bool mJournalDirty;
+
     StagefrightMediaScanner(const StagefrightMediaScanner &);
     StagefrightMediaScanner &operator=(const StagefrightMediaScanner &);
 
     MediaScanResult processFileInternal(
             const char *path, const char *mimeType,
             MediaScannerClient &client);
+
+    void loadJournal();
+    void saveJournal();
+    void updateJournal(
+            const char *path, long long lastModified, long long fileSize);
+    void pruneJournal(const char *dir);
 };
 
 }  // namespace android
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRANSCODE_PIPELINE_H_
+
+#define TRANSCODE_PIPELINE_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct AMessage;
+struct MediaMuxer;
+struct NuMediaExtractor;
+
+// Transcodes the first audio and the first video track of a file into an
+// MPEG4 file.
+//
+// Extraction, decoding, encoding and muxing each run on their own looper and
+// hand buffers on through bounded queues; a full queue stalls the stage that
+// feeds it. A stage runs while it makes progress, then sleeps until one of its
+// queues or its codec's activity notification wakes it up. Video goes from the
+// decoder to the encoder through the encoder's input surface, so decoded
+// frames are never copied; each is rendered with its presentation time, which
+// the encoder carries over to its output.
+struct TranscodePipeline : public RefBase {
+    struct Options {
+        Options();
+
+        AString mVideoMime;
+        int32_t mVideoBitrate;
+        int32_t mFrameRate;
+        int32_t mIFrameIntervalSecs;
+
+        AString mAudioMime;
+        int32_t mAudioBitrate;
+
+        // capacity of each queue between two stages, in buffers
+        size_t mQueueDepth;
+    };
+
+    struct StageStats {
+        AString mName;
+        int64_t mBusyUs;
+        int64_t mNumBuffers;
+    };
+
+    TranscodePipeline();
+
+    status_t init(
+            const char *inputPath, const char *outputPath,
+            const Options &options);
+
+    status_t start();
+
+    // Blocks until every track is written out or a stage fails.
+    status_t waitForCompletion();
+
+    // Only meaningful once waitForCompletion() has returned.
+    void getStats(Vector<StageStats> *stats, int64_t *elapsedUs) const;
+
+protected:
+    virtual ~TranscodePipeline();
+
+private:
+    struct BufferQueue;
+    struct Track;
+    struct Stage;
+    struct ExtractStage;
+    struct DecodeStage;
+    struct EncodeStage;
+    struct MuxStage;
+
+    mutable Mutex mLock;
+    Condition mCondition;
+
+    Options mOptions;
+    sp<NuMediaExtractor> mExtractor;
+    sp<MediaMuxer> mMuxer;
+    Vector<Track *> mTracks;
+    Vector<sp<Stage> > mStages;
+    sp<Stage> mMuxStage;
+
+    size_t mNumStagesDone;
+    bool mDone;
+    status_t mFinalStatus;
+    int64_t mStartTimeUs;
+    int64_t mElapsedUs;
+
+    status_t addTrack(size_t index, const sp<AMessage> &format, bool isVideo);
+    Track *trackForSource(size_t sourceIndex) const;
+
+    void setOutputFormat(Track *track, const sp<AMessage> &format);
+    bool getOutputFormats(Vector<sp<AMessage> > *formats) const;
+
+    void onStageDone(Stage *stage);
+    void onStageError(Stage *stage, status_t err);
+
+    void stopStages();
+    void releaseCodecs();
+
+    DISALLOW_EVIL_CONSTRUCTORS(TranscodePipeline);
+};
+
+}  // namespace android
+
+#endif  // TRANSCODE_PIPELINE_H_
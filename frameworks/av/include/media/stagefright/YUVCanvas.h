@@ -67,6 +67,11 @@ public:
             int32_t skipX, int32_t skipY,
             const YUVImage &srcImage);
 
+    // Rotates srcImage clockwise by degrees (0, 90, 180 or 270) into the
+    // canvas' target image (mYUVImage), whose width and height must be those
+    // of srcImage after rotation.
+    void rotate(int32_t degrees, const YUVImage &srcImage);
+
 private:
     YUVImage& mYUVImage;
 
@@ -105,6 +105,28 @@ public:
             int32_t destStartX, int32_t destStartY,
             const YUVImage &srcImage, YUVImage &destImage);
 
+    // Fills the rectangle with the given YUV values a data row at a time.
+    // Gives the same result as calling setPixelValue() on every pixel in it.
+    // Returns false if the format is not supported.
+    bool fastFillRectangle(const Rect& rect,
+            uint8_t yValue, uint8_t uValue, uint8_t vValue);
+
+    // Same as YUVCanvas::downsample() but works on the data planes directly
+    // rather than pixel by pixel. Returns false if the formats are not
+    // supported.
+    static bool fastDownsample(
+            int32_t srcOffsetX, int32_t srcOffsetY,
+            int32_t skipX, int32_t skipY,
+            const YUVImage &srcImage, YUVImage &destImage);
+
+    // Rotates srcImage clockwise by degrees (0, 90, 180 or 270) into
+    // destImage, which must be of the rotated size. Returns false if this
+    // is not possible plane by plane, i.e. for odd dimensions or
+    // unsupported formats.
+    static bool fastRotate(
+            int32_t degrees,
+            const YUVImage &srcImage, YUVImage &destImage);
+
     // Convert the given YUV value to RGB.
     void yuv2rgb(uint8_t yValue, uint8_t uValue, uint8_t vValue,
         uint8_t *r, uint8_t *g, uint8_t *b) const;
@@ -158,6 +180,9 @@ private:
         int32_t *uDataOffsetIncrement,
         int32_t *vDataOffsetIncrement) const;
 
+    // Returns the distance between two neighbouring U (or V) values in a data row.
+    int32_t getUVStep() const;
+
     // Given the offset return the address of the corresponding channel's data.
     uint8_t* getYAddress(int32_t offset) const;
     uint8_t* getUAddress(int32_t offset) const;
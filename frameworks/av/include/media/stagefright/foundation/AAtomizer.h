@@ -34,14 +34,25 @@ struct AAtomizer {
 private:
     static AAtomizer gAtomizer;
 
+    enum {
+        kNumCacheEntries = 256,
+    };
+
     Mutex mLock;
     Vector<List<AString> > mAtoms;
 
+    // Atoms recently returned, indexed by the address of the name they were
+    // looked up with, so that the same string literal is found without mLock.
+    // Entries are only hints and are checked against the name.
+    const char *volatile mCache[kNumCacheEntries];
+
     AAtomizer();
 
     const char *atomize(const char *name);
+    const char *atomizeLocked(const char *name);
 
     static uint32_t Hash(const char *s);
+    static size_t CacheIndex(const char *name);
 
     DISALLOW_EVIL_CONSTRUCTORS(AAtomizer);
 };
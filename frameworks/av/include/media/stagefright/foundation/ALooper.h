@@ -61,6 +61,7 @@ private:
 
     struct Event {
         int64_t mWhenUs;
+        uint32_t mSeqNo;    // orders events due at the same time by posting order
         sp<AMessage> mMessage;
     };
 
@@ -69,7 +70,10 @@ private:
 
     AString mName;
 
-    List<Event> mEventQueue;
+    // Binary min-heap on (mWhenUs, mSeqNo), so that posting is O(log n)
+    // even with many delayed messages pending.
+    Vector<Event> mEventQueue;
+    uint32_t mNextSeqNo;
 
     struct LooperThread;
     sp<LooperThread> mThread;
@@ -78,6 +82,10 @@ private:
     void post(const sp<AMessage> &msg, int64_t delayUs);
     bool loop();
 
+    static bool EventBefore(const Event &a, const Event &b);
+    void pushEvent_l(const Event &event);
+    void popEvent_l(Event *event);
+
     DISALLOW_EVIL_CONSTRUCTORS(ALooper);
 };
 
@@ -25,14 +25,19 @@
 
 #include <netinet/in.h>
 
+struct iovec;
+
 namespace android {
 
 struct AMessage;
 
 // Helper class to manage a number of live sockets (datagram and stream-based)
-// on a single thread. Clients are notified about activity through AMessages.
+// on one or more threads. Clients are notified about activity through
+// AMessages.
 struct ANetworkSession : public RefBase {
-    ANetworkSession();
+    // Sessions are spread over "numThreads" network threads by session id,
+    // each waiting on the sockets it serves through its own epoll set.
+    ANetworkSession(size_t numThreads = 1);
 
     status_t start();
     status_t stop();
@@ -77,6 +82,15 @@ struct ANetworkSession : public RefBase {
             int32_t sessionID, const void *data, ssize_t size = -1,
             bool timeValid = false, int64_t timeUs = -1ll);
 
+    // Queues a single datagram gathered from "iov" without copying it on
+    // UDP sessions. "owner" is kept until the datagram has been sent and
+    // must keep the memory referenced by "iov" alive and unchanged until
+    // then. Other sessions get a copy as with sendRequest().
+    status_t sendDatagram(
+            int32_t sessionID, const struct iovec *iov, size_t iovCount,
+            const sp<RefBase> &owner,
+            bool timeValid = false, int64_t timeUs = -1ll);
+
     status_t switchToWebSocketMode(int32_t sessionID);
 
     enum NotificationReason {
@@ -96,15 +110,13 @@ protected:
 private:
     struct NetworkThread;
     struct Session;
+    struct Shard;
 
-    Mutex mLock;
-    sp<Thread> mThread;
-
+    Mutex mLock;  // Guards mNextSessionID and mStarted.
     int32_t mNextSessionID;
+    bool mStarted;
 
-    int mPipeFd[2];
-
-    KeyedVector<int32_t, sp<Session> > mSessions;
+    Vector<sp<Shard> > mShards;
 
     enum Mode {
         kModeCreateUDPSession,
@@ -122,8 +134,9 @@ private:
             const sp<AMessage> &notify,
             int32_t *sessionID);
 
-    void threadLoop();
-    void interrupt();
+    int32_t newSessionID();
+    const sp<Shard> &shardFor(int32_t sessionID) const;
+    void addSession(const sp<Session> &session);
 
     static status_t MakeSocketNonBlocking(int s);
 
@@ -105,6 +105,8 @@ struct audio_track_cblk_t
     volatile    int32_t     mFutex;     // event flag: down (P) by client,
                                         // up (V) by server or binderDied() or interrupt()
 #define CBLK_FUTEX_WAKE 1               // if event flag bit is set, then a deferred wake is pending
+#define CBLK_FUTEX_WAITING 2            // set by client before it blocks in a futex wait, so that
+                                        // the server only makes a wake syscall when needed
 
 private:
 
@@ -230,6 +232,26 @@ public:
     //  buffer->mRaw is NULL.
     void        releaseBuffer(Buffer* buffer);
 
+    // Batched obtain and release, so that a client can claim several periods at once and
+    // publish them with a single store-release.  Together with setMinimum(batch frame count)
+    // the server then wakes the client at most once per batch, rather than once per period.
+    struct Batch {
+        Buffer  mParts[2];              // mParts[0] at the current position; mParts[1] the part
+                                        // that wraps around to the start of the buffer, if any
+        size_t  mFrameCount;            // total of mParts[0].mFrameCount and mParts[1].mFrameCount
+    };
+
+    // Like obtainBuffer(), except that up to frameCount frames are obtained, including
+    // the frames that are non-contiguous because of the wrap-around.  frameCount must be > 0.
+    // The timeout and return status are those of obtainBuffer().
+    // On exit, batch->mFrameCount is the number of frames obtained, 0 if status != NO_ERROR.
+    status_t    obtainBatch(Batch* batch, size_t frameCount,
+            const struct timespec *requested = NULL, struct timespec *elapsed = NULL);
+
+    // Release the first batch->mFrameCount frames of the batch, which may be lowered by the
+    // caller if it used fewer frames than obtained.  On exit the batch is cleared.
+    void        releaseBatch(Batch* batch);
+
     // Call after detecting server's death
     void        binderDied();
 
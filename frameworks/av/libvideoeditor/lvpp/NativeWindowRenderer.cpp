@@ -62,10 +62,14 @@ static const char vSrcNormal[] =
     "attribute vec2 vTexPos;\n"
     "uniform mat4 texMatrix;\n"
     "varying vec2 texCoords;\n"
+    "varying vec2 texPos;\n"
+    "varying vec2 texStepY;\n"
     "varying float topDown;\n"
     "void main() {\n"
     "  gl_Position = vPosition;\n"
     "  texCoords = (texMatrix * vec4(vTexPos, 0.0, 1.0)).xy;\n"
+    "  texPos = vTexPos;\n"
+    "  texStepY = (texMatrix * vec4(0.0, 1.0, 0.0, 0.0)).xy;\n"
     "  topDown = vTexPos.y;\n"
     "}\n";
 
@@ -78,49 +82,62 @@ static const char fSrcNormal[] =
     "  gl_FragColor = texture2D(texSampler, texCoords);\n"
     "}\n";
 
-static const char fSrcSepia[] =
-    "#extension GL_OES_EGL_image_external : require\n"
-    "precision mediump float;\n"
-    "uniform samplerExternalOES texSampler;\n"
-    "varying vec2 texCoords;\n"
-    RGB2YUV_MATRIX
-    YUV2RGB_MATRIX
-    "void main() {\n"
-    "  vec4 rgb = texture2D(texSampler, texCoords);\n"
-    "  vec4 yuv = rgb2yuv * rgb;\n"
-    "  yuv = vec4(yuv.x, 117.0, 139.0, 1.0);\n"
-    "  gl_FragColor = yuv2rgb * yuv;\n"
-    "}\n";
-
-static const char fSrcNegative[] =
-    "#extension GL_OES_EGL_image_external : require\n"
-    "precision mediump float;\n"
-    "uniform samplerExternalOES texSampler;\n"
-    "varying vec2 texCoords;\n"
-    RGB2YUV_MATRIX
-    YUV2RGB_MATRIX
-    "void main() {\n"
-    "  vec4 rgb = texture2D(texSampler, texCoords);\n"
-    "  vec4 yuv = rgb2yuv * rgb;\n"
-    "  yuv = vec4(255.0 - yuv.x, yuv.y, yuv.z, 1.0);\n"
-    "  gl_FragColor = yuv2rgb * yuv;\n"
-    "}\n";
-
-static const char fSrcGradient[] =
+// Applies any combination of the color effects in a single pass, in the
+// same order as applyEffectsAndRenderingMode() does on the CPU:
+//
+// - negative inverts the luma.
+// - chromaMode 1 replaces the chroma with a constant, chromaMode 2 with the
+//   chroma of chromaColor, faded to black towards the bottom if
+//   chromaGradient is 1.
+// - fifties (roll, stripe x, stripe width, band height) rolls the frame
+//   vertically and draws a dark band and a vertical stripe when fiftiesOn
+//   is 1.
+// - fade scales the luma, and fades the chroma out when it is nearly black.
+static const char fSrcEffects[] =
     "#extension GL_OES_EGL_image_external : require\n"
     "precision mediump float;\n"
     "uniform samplerExternalOES texSampler;\n"
+    "uniform float negative;\n"
+    "uniform int chromaMode;\n"
+    "uniform vec2 chroma;\n"
+    "uniform vec3 chromaColor;\n"
+    "uniform float chromaGradient;\n"
+    "uniform float fiftiesOn;\n"
+    "uniform vec4 fifties;\n"
+    "uniform float fade;\n"
     "varying vec2 texCoords;\n"
+    "varying vec2 texPos;\n"
+    "varying vec2 texStepY;\n"
     "varying float topDown;\n"
     RGB2YUV_MATRIX
     YUV2RGB_MATRIX
     "void main() {\n"
-    "  vec4 rgb = texture2D(texSampler, texCoords);\n"
-    "  vec4 yuv = rgb2yuv * rgb;\n"
-    "  vec4 mixin = vec4(15.0/31.0, 59.0/63.0, 31.0/31.0, 1.0);\n"
-    "  vec4 yuv2 = rgb2yuv * vec4((mixin.xyz * topDown), 1);\n"
-    "  yuv = vec4(yuv.x, yuv2.y, yuv2.z, 1);\n"
-    "  gl_FragColor = yuv2rgb * yuv;\n"
+    "  vec2 coords = texCoords;\n"
+    "  float row = 1.0 - texPos.y;\n"
+    "  if (fiftiesOn > 0.0) {\n"
+    "    row = fract(row + fifties.x);\n"
+    "    coords += texStepY * ((1.0 - row) - texPos.y);\n"
+    "  }\n"
+    "  vec4 yuv = rgb2yuv * texture2D(texSampler, coords);\n"
+    "  yuv.x = mix(yuv.x, 255.0 - yuv.x, negative);\n"
+    "  if (chromaMode == 1) {\n"
+    "    yuv.yz = chroma;\n"
+    "  } else if (chromaMode == 2) {\n"
+    "    float scale = mix(1.0, topDown, chromaGradient);\n"
+    "    yuv.yz = (rgb2yuv * vec4(chromaColor * scale, 1.0)).yz;\n"
+    "  }\n"
+    "  if (fiftiesOn > 0.0) {\n"
+    "    if (row > 1.0 - fifties.w) {\n"
+    "      yuv.x = 40.0;\n"
+    "    } else if (abs(texPos.x - fifties.y) < fifties.z) {\n"
+    "      yuv.x = 90.0;\n"
+    "    }\n"
+    "  }\n"
+    "  yuv.x *= fade;\n"
+    "  if (fade <= 0.25) {\n"
+    "    yuv.yz = mix(vec2(128.0), yuv.yz, fade);\n"
+    "  }\n"
+    "  gl_FragColor = yuv2rgb * vec4(yuv.xyz, 1.0);\n"
     "}\n";
 
 namespace android {
@@ -130,7 +147,7 @@ NativeWindowRenderer::NativeWindowRenderer(sp<ANativeWindow> nativeWindow,
     : mNativeWindow(nativeWindow)
     , mDstWidth(width)
     , mDstHeight(height)
-    , mLastVideoEffect(-1)
+    , mCurrentProgram(-1)
     , mNextTextureId(100)
     , mActiveInputs(0)
     , mThreadCmd(CMD_IDLE) {
@@ -230,7 +247,7 @@ void NativeWindowRenderer::createPrograms() {
     loadShader(GL_VERTEX_SHADER, vSrcNormal, &vShader);
 
     const char* fSrc[NUMBER_OF_EFFECTS] = {
-        fSrcNormal, fSrcSepia, fSrcNegative, fSrcGradient
+        fSrcNormal, fSrcEffects
     };
 
     for (int i = 0; i < NUMBER_OF_EFFECTS; i++) {
@@ -340,6 +357,10 @@ void NativeWindowRenderer::render(RenderInput* input) {
     };
 
     updateProgramAndHandle(input->mVideoEffect);
+    if (mCurrentProgram == EFFECT_COLOR) {
+        updateEffectUniforms(input->mVideoEffect, input->mEffectParams,
+            input->mWidth, input->mHeight);
+    }
 
     glVertexAttribPointer(mPositionHandle, 2, GL_FLOAT, GL_FALSE, 0,
         mPositionCoordinates);
@@ -439,35 +460,85 @@ void NativeWindowRenderer::copyI420Buffer(MediaBuffer* src, uint8_t* dst,
 }
 
 void NativeWindowRenderer::updateProgramAndHandle(uint32_t videoEffect) {
-    if (mLastVideoEffect == videoEffect) {
+    // Framing is drawn by the application on top of the preview
+    int program = (videoEffect & ~VIDEO_EFFECT_FRAMING) == VIDEO_EFFECT_NONE ?
+        EFFECT_NORMAL : EFFECT_COLOR;
+    if (mCurrentProgram == program) {
         return;
     }
 
-    mLastVideoEffect = videoEffect;
-    int i;
-    switch (mLastVideoEffect) {
-        case VIDEO_EFFECT_NONE:
-            i = 0;
-            break;
-        case VIDEO_EFFECT_SEPIA:
-            i = 1;
-            break;
-        case VIDEO_EFFECT_NEGATIVE:
-            i = 2;
-            break;
-        case VIDEO_EFFECT_GRADIENT:
-            i = 3;
-            break;
-        default:
-            i = 0;
-            break;
-    }
-    glUseProgram(mProgram[i]);
+    mCurrentProgram = program;
+    GLuint pgm = mProgram[program];
+    glUseProgram(pgm);
+    CHECK_GL_ERROR;
+
+    mPositionHandle = glGetAttribLocation(pgm, "vPosition");
+    mTexPosHandle = glGetAttribLocation(pgm, "vTexPos");
+    mTexMatrixHandle = glGetUniformLocation(pgm, "texMatrix");
+    mNegativeHandle = glGetUniformLocation(pgm, "negative");
+    mChromaModeHandle = glGetUniformLocation(pgm, "chromaMode");
+    mChromaHandle = glGetUniformLocation(pgm, "chroma");
+    mChromaColorHandle = glGetUniformLocation(pgm, "chromaColor");
+    mChromaGradientHandle = glGetUniformLocation(pgm, "chromaGradient");
+    mFiftiesOnHandle = glGetUniformLocation(pgm, "fiftiesOn");
+    mFiftiesHandle = glGetUniformLocation(pgm, "fifties");
+    mFadeHandle = glGetUniformLocation(pgm, "fade");
     CHECK_GL_ERROR;
+}
+
+void NativeWindowRenderer::updateEffectUniforms(uint32_t videoEffect,
+        const veVideoEffectParams& params, int srcWidth, int srcHeight) {
+    // Each chroma effect overwrites the chroma of the previous ones, so
+    // only the last one applied on the CPU matters.
+    GLint chromaMode = 1;
+    GLfloat u = 128, v = 128;
+    uint16_t rgb16 = 0;
+    GLfloat gradient = 0;
+    if (videoEffect & VIDEO_EFFECT_FIFTIES) {
+        u = 117;
+        v = 139;
+    } else if (videoEffect & VIDEO_EFFECT_COLOR_RGB16) {
+        chromaMode = 2;
+        rgb16 = params.colorRgb16;
+    } else if (videoEffect & VIDEO_EFFECT_GRADIENT) {
+        chromaMode = 2;
+        rgb16 = params.gradientRgb16;
+        gradient = 1;
+    } else if (videoEffect & VIDEO_EFFECT_SEPIA) {
+        u = 117;
+        v = 139;
+    } else if (videoEffect & VIDEO_EFFECT_GREEN) {
+        u = 0;
+        v = 0;
+    } else if (videoEffect & VIDEO_EFFECT_PINK) {
+        u = 255;
+        v = 255;
+    } else if (!(videoEffect & VIDEO_EFFECT_BLACKANDWHITE)) {
+        chromaMode = 0;
+    }
 
-    mPositionHandle = glGetAttribLocation(mProgram[i], "vPosition");
-    mTexPosHandle = glGetAttribLocation(mProgram[i], "vTexPos");
-    mTexMatrixHandle = glGetUniformLocation(mProgram[i], "texMatrix");
+    glUniform1f(mNegativeHandle,
+        (videoEffect & VIDEO_EFFECT_NEGATIVE) ? 1.0f : 0.0f);
+    glUniform1i(mChromaModeHandle, chromaMode);
+    glUniform2f(mChromaHandle, u, v);
+    glUniform3f(mChromaColorHandle,
+        ((rgb16 & 0xf800) >> 11) / 31.0f,
+        ((rgb16 & 0x07e0) >> 5) / 63.0f,
+        (rgb16 & 0x001f) / 31.0f);
+    glUniform1f(mChromaGradientHandle, gradient);
+
+    // The band and the stripe are a few source pixels wide, as in
+    // M4VSS3GPP_externalVideoEffectFifties().
+    glUniform1f(mFiftiesOnHandle,
+        (videoEffect & VIDEO_EFFECT_FIFTIES) ? 1.0f : 0.0f);
+    glUniform4f(mFiftiesHandle, params.fiftiesShift, params.fiftiesStripe,
+        0.5f / srcWidth, 3.0f / srcHeight);
+
+    GLfloat fade = 1.0f;
+    if (videoEffect & (VIDEO_EFFECT_FADEFROMBLACK | VIDEO_EFFECT_FADETOBLACK)) {
+        fade = params.fadeLevel;
+    }
+    glUniform1f(mFadeHandle, fade);
     CHECK_GL_ERROR;
 }
 
@@ -606,8 +677,10 @@ void RenderInput::updateVideoSize(sp<MetaData> meta) {
 }
 
 void RenderInput::render(MediaBuffer* buffer, uint32_t videoEffect,
+        const veVideoEffectParams& effectParams,
         M4xVSS_MediaRendering renderingMode, bool isExternalBuffer) {
     mVideoEffect = videoEffect;
+    mEffectParams = effectParams;
     mRenderingMode = renderingMode;
     mIsExternalBuffer = isExternalBuffer;
     mBuffer = buffer;
@@ -25,12 +25,14 @@
 #include <utils/threads.h>
 
 #include "M4xVSS_API.h"
+#include "VideoEditorTools.h"
 
 // The NativeWindowRenderer draws video frames stored in MediaBuffers to
 // an ANativeWindow.  It can apply "rendering mode" and color effects to
 // the frames. "Rendering mode" is the option to do resizing, cropping,
 // or black-bordering when the source and destination aspect ratio are
-// different. Color effects include sepia, negative, and gradient.
+// different. Color effects include all the effects of VideoEditorTools.h
+// except framing, which the application draws on top of the preview.
 //
 // The input to NativeWindowRenderer is provided by the RenderInput class,
 // and there can be multiple active RenderInput at the same time. Although
@@ -79,6 +81,8 @@ private:
     void copyI420Buffer(MediaBuffer* src, uint8_t* dst,
             int srcWidth, int srcHeight, int stride);
     void updateProgramAndHandle(uint32_t videoEffect);
+    void updateEffectUniforms(uint32_t videoEffect,
+            const veVideoEffectParams& params, int srcWidth, int srcHeight);
     void calculatePositionCoordinates(M4xVSS_MediaRendering renderingMode,
             int srcWidth, int srcHeight);
 
@@ -90,20 +94,27 @@ private:
     EGLContext mEglContext;
     enum {
         EFFECT_NORMAL,
-        EFFECT_SEPIA,
-        EFFECT_NEGATIVE,
-        EFFECT_GRADIENT,
+        EFFECT_COLOR,
         NUMBER_OF_EFFECTS
     };
     GLuint mProgram[NUMBER_OF_EFFECTS];
 
-    // We use one shader program for each effect. mLastVideoEffect remembers
-    // the program used for the last frame. when the effect used changes,
-    // we change the program used and update the handles.
-    uint32_t mLastVideoEffect;
+    // Frames without effects use a plain copy program, all the other frames
+    // use one program driven by uniforms. mCurrentProgram remembers the
+    // program used for the last frame. When it changes, we change the
+    // program used and update the handles.
+    int mCurrentProgram;
     GLint mPositionHandle;
     GLint mTexPosHandle;
     GLint mTexMatrixHandle;
+    GLint mNegativeHandle;
+    GLint mChromaModeHandle;
+    GLint mChromaHandle;
+    GLint mChromaColorHandle;
+    GLint mChromaGradientHandle;
+    GLint mFiftiesOnHandle;
+    GLint mFiftiesHandle;
+    GLint mFadeHandle;
 
     // This is the vertex coordinates used for the frame texture.
     // It's calculated according the the rendering mode and the source and
@@ -154,10 +165,12 @@ public:
     void updateVideoSize(sp<MetaData> meta);
 
     // Renders the buffer with the given video effect and rending mode.
-    // The video effets are defined in VideoEditorTools.h
+    // The video effets are defined in VideoEditorTools.h, and effectParams
+    // holds their values for this frame.
     // Set isExternalBuffer to true only when the buffer given is not
     // provided by the Surface.
     void render(MediaBuffer *buffer, uint32_t videoEffect,
+        const veVideoEffectParams& effectParams,
         M4xVSS_MediaRendering renderingMode, bool isExternalBuffer);
 private:
     RenderInput(NativeWindowRenderer* renderer, GLuint textureId);
@@ -170,6 +183,7 @@ private:
 
     // These are only valid during render() calls
     uint32_t mVideoEffect;
+    veVideoEffectParams mEffectParams;
     M4xVSS_MediaRendering mRenderingMode;
     bool mIsExternalBuffer;
     MediaBuffer* mBuffer;
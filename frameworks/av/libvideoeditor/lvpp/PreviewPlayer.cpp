@@ -105,6 +105,9 @@ PreviewPlayer::PreviewPlayer(NativeWindowRenderer* renderer)
     mDecodedVideoTs = 0;
     mDecVideoTsStoryBoard = 0;
     mCurrentVideoEffect = VIDEO_EFFECT_NONE;
+    memset(&mEffectParams, 0, sizeof(mEffectParams));
+    mEffectParams.fadeLevel = 1.0;
+    mEffectParams.fiftiesTimeMs = -1;
     mProgressCbInterval = 0;
     mNumberDecVideoFrames = 0;
     mOverlayUpdateEventPosted = false;
@@ -1062,8 +1065,16 @@ void PreviewPlayer::onVideoEvent() {
     }
 
     if (mVideoRenderer != NULL) {
+        if (mIsFiftiesEffectStarted) {
+            mEffectParams.fiftiesTimeMs = -1;
+            mIsFiftiesEffectStarted = false;
+        }
+        computeVideoEffectParams(mEffectsSettings, mNumberEffects,
+                mCurrentVideoEffect,
+                ((timeUs+mDecVideoTsStoryBoard)/1000)-mPlayBeginTimeMsec,
+                &mEffectParams);
         mVideoRenderer->render(mVideoBuffer, mCurrentVideoEffect,
-                mRenderingMode, mIsVideoSourceJpg);
+                mEffectParams, mRenderingMode, mIsVideoSourceJpg);
     }
 
     mVideoBuffer->release();
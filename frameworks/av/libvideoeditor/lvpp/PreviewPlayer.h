@@ -212,6 +212,7 @@ private:
     uint64_t mDecodedVideoTs; // timestamp of current decoded video frame buffer
     uint64_t mDecVideoTsStoryBoard; // timestamp of frame relative to storyboard
     uint32_t mCurrentVideoEffect;
+    veVideoEffectParams mEffectParams;
     uint32_t mProgressCbInterval;
     uint32_t mNumberDecVideoFrames; // Counter of number of video frames decoded
     sp<TimedEventQueue::Event> mProgressCbEvent;
@@ -19,6 +19,8 @@
 #include <utils/Log.h>
 
 #include <gui/Surface.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MetaData.h>
 
 #include "VideoEditorAudioPlayer.h"
 #include "PreviewRenderer.h"
@@ -48,6 +50,10 @@ VideoEditorPreviewController::VideoEditorPreviewController()
       mBackgroundAudioSetting(NULL),
       mAudioMixPCMFileHandle(NULL),
       mTarget(NULL),
+      mFrameRenderer(NULL),
+      mFrameRenderInput(NULL),
+      mFrameRendererWidth(0),
+      mFrameRendererHeight(0),
       mJniCookie(NULL),
       mJniCallback(NULL),
       mCurrentPlayedDuration(0),
@@ -144,6 +150,8 @@ VideoEditorPreviewController::~VideoEditorPreviewController() {
         mTarget = NULL;
     }
 
+    releaseFrameRenderer();
+
     mOverlayState = OVERLAY_CLEAR;
 
     ALOGV("~VideoEditorPreviewController returns");
@@ -459,6 +467,7 @@ M4OSA_ERR VideoEditorPreviewController::startPreview(
         delete mTarget;
         mTarget = NULL;
     }
+    releaseFrameRenderer();
 
     // Create Audio player to be used for entire
     // storyboard duration
@@ -741,11 +750,12 @@ M4OSA_ERR VideoEditorPreviewController::clearSurface(
 
     Mutex::Autolock autoLock(mLock);
 
-    // Delete previous renderer instance
+    // Delete previous renderer instances
     if(mTarget != NULL) {
         delete mTarget;
         mTarget = NULL;
     }
+    releaseFrameRenderer();
 
     outputBufferWidth = pFrameStr->uiFrameWidth;
     outputBufferHeight = pFrameStr->uiFrameHeight;
@@ -796,9 +806,8 @@ M4OSA_ERR VideoEditorPreviewController::renderPreviewFrame(
             VideoEditorCurretEditInfo *pCurrEditInfo) {
 
     M4OSA_ERR err = M4NO_ERROR;
-    M4OSA_UInt32 i = 0, iIncrementedDuration = 0, tnTimeMs=0, framesize =0;
+    M4OSA_UInt32 i = 0;
     VideoEditor_renderPreviewFrameStr* pFrameStr = pFrameInfo;
-    M4VIFI_UInt8 *pixelArray = NULL;
     Mutex::Autolock autoLock(mLock);
 
     if (pCurrEditInfo != NULL) {
@@ -818,19 +827,22 @@ M4OSA_ERR VideoEditorPreviewController::renderPreviewFrame(
         mOutputVideoHeight = pFrameStr->uiFrameHeight;
     }
 
-    // Initialize the renderer
-    if(mTarget == NULL) {
-         mTarget = PreviewRenderer::CreatePreviewRenderer(
-            surface,
-            mOutputVideoWidth, mOutputVideoHeight);
-
-        if(mTarget == NULL) {
-            ALOGE("renderPreviewFrame: cannot create PreviewRenderer");
-            return M4ERR_ALLOC;
-        }
+    // Effects and rendering mode are applied by the GL renderer, which is
+    // kept while the frames go to the same surface at the same size
+    if((mFrameRenderer != NULL) && ((mFrameRendererSurface != surface) ||
+        (mFrameRendererWidth != mOutputVideoWidth) ||
+        (mFrameRendererHeight != mOutputVideoHeight))) {
+        releaseFrameRenderer();
     }
 
-    pixelArray = NULL;
+    if(mFrameRenderer == NULL) {
+        mFrameRenderer = new NativeWindowRenderer(surface,
+            mOutputVideoWidth, mOutputVideoHeight);
+        mFrameRenderInput = mFrameRenderer->createRenderInput();
+        mFrameRendererSurface = surface;
+        mFrameRendererWidth = mOutputVideoWidth;
+        mFrameRendererHeight = mOutputVideoHeight;
+    }
 
     // Apply rotation if required
     if (pFrameStr->videoRotationDegree != 0) {
@@ -839,8 +851,6 @@ M4OSA_ERR VideoEditorPreviewController::renderPreviewFrame(
                   pFrameStr->videoRotationDegree);
         if (M4NO_ERROR != err) {
             ALOGE("renderPreviewFrame: cannot rotate video, err 0x%x", (unsigned int)err);
-            delete mTarget;
-            mTarget = NULL;
             return err;
         } else {
            // Video rotation done.
@@ -852,7 +862,13 @@ M4OSA_ERR VideoEditorPreviewController::renderPreviewFrame(
            }
         }
     }
-    // Postprocessing (apply video effect)
+
+    veVideoEffectParams effectParams;
+    memset(&effectParams, 0, sizeof(effectParams));
+    effectParams.fadeLevel = 1.0;
+    effectParams.fiftiesTimeMs = -1;
+
+    // Postprocessing (find the video effects)
     if(pFrameStr->bApplyEffect == M4OSA_TRUE) {
 
         for(i=0;i<mNumberEffects;i++) {
@@ -898,58 +914,35 @@ M4OSA_ERR VideoEditorPreviewController::renderPreviewFrame(
             }
         }
 
-        if(mCurrentVideoEffect != VIDEO_EFFECT_NONE) {
-            err = applyVideoEffect((M4OSA_Void *)pFrameStr->pBuffer,
-             OMX_COLOR_FormatYUV420Planar, pFrameStr->uiFrameWidth,
-             pFrameStr->uiFrameHeight, pFrameStr->timeMs,
-             (M4OSA_Void *)pixelArray);
-
-            if(err != M4NO_ERROR) {
-                ALOGE("renderPreviewFrame: applyVideoEffect error 0x%x", (unsigned int)err);
-                delete mTarget;
-                mTarget = NULL;
-                free(pixelArray);
-                pixelArray = NULL;
-                return err;
-           }
-           mCurrentVideoEffect = VIDEO_EFFECT_NONE;
-        }
-        else {
-            // Apply the rendering mode
-            err = doImageRenderingMode((M4OSA_Void *)pFrameStr->pBuffer,
-             OMX_COLOR_FormatYUV420Planar, pFrameStr->uiFrameWidth,
-             pFrameStr->uiFrameHeight, (M4OSA_Void *)pixelArray);
-
-            if(err != M4NO_ERROR) {
-                ALOGE("renderPreviewFrame:doImageRenderingMode error 0x%x", (unsigned int)err);
-                delete mTarget;
-                mTarget = NULL;
-                free(pixelArray);
-                pixelArray = NULL;
-                return err;
-            }
-        }
+        computeVideoEffectParams(mEffectsSettings, mNumberEffects,
+            mCurrentVideoEffect, pFrameStr->timeMs, &effectParams);
     }
-    else {
-        // Apply the rendering mode
-        err = doImageRenderingMode((M4OSA_Void *)pFrameStr->pBuffer,
-         OMX_COLOR_FormatYUV420Planar, pFrameStr->uiFrameWidth,
-         pFrameStr->uiFrameHeight, (M4OSA_Void *)pixelArray);
 
-        if(err != M4NO_ERROR) {
-            ALOGE("renderPreviewFrame: doImageRenderingMode error 0x%x", (unsigned int)err);
-            delete mTarget;
-            mTarget = NULL;
-            free(pixelArray);
-            pixelArray = NULL;
-            return err;
-        }
-    }
+    sp<MetaData> meta = new MetaData;
+    meta->setInt32(kKeyWidth, pFrameStr->uiFrameWidth);
+    meta->setInt32(kKeyHeight, pFrameStr->uiFrameHeight);
+    mFrameRenderInput->updateVideoSize(meta);
 
-    mTarget->renderYV12();
+    MediaBuffer* buffer = new MediaBuffer(pFrameStr->pBuffer,
+        (pFrameStr->uiFrameWidth * pFrameStr->uiFrameHeight * 3) >> 1);
+    mFrameRenderInput->render(buffer, mCurrentVideoEffect, effectParams,
+        mRenderingMode, true);
+    buffer->release();
+
+    mCurrentVideoEffect = VIDEO_EFFECT_NONE;
     return err;
 }
 
+void VideoEditorPreviewController::releaseFrameRenderer() {
+    if(mFrameRenderer != NULL) {
+        mFrameRenderer->destroyRenderInput(mFrameRenderInput);
+        mFrameRenderInput = NULL;
+        delete mFrameRenderer;
+        mFrameRenderer = NULL;
+        mFrameRendererSurface.clear();
+    }
+}
+
 M4OSA_Void VideoEditorPreviewController::setJniCallback(void* cookie,
     jni_progress_callback_fct callbackFct) {
     //ALOGV("setJniCallback");
@@ -1374,41 +1367,6 @@ void VideoEditorPreviewController::setVideoEffectType(
 }
 
 
-M4OSA_ERR VideoEditorPreviewController::applyVideoEffect(
-    M4OSA_Void * dataPtr, M4OSA_UInt32 colorFormat, M4OSA_UInt32 videoWidth,
-    M4OSA_UInt32 videoHeight, M4OSA_UInt32 timeMs, M4OSA_Void* outPtr) {
-
-    M4OSA_ERR err = M4NO_ERROR;
-    vePostProcessParams postProcessParams;
-
-    postProcessParams.vidBuffer = (M4VIFI_UInt8*)dataPtr;
-    postProcessParams.videoWidth = videoWidth;
-    postProcessParams.videoHeight = videoHeight;
-    postProcessParams.timeMs = timeMs;
-    postProcessParams.timeOffset = 0; //Since timeMS already takes care of offset in this case
-    postProcessParams.effectsSettings = mEffectsSettings;
-    postProcessParams.numberEffects = mNumberEffects;
-    postProcessParams.outVideoWidth = mOutputVideoWidth;
-    postProcessParams.outVideoHeight = mOutputVideoHeight;
-    postProcessParams.currentVideoEffect = mCurrentVideoEffect;
-    postProcessParams.renderingMode = mRenderingMode;
-    if(mIsFiftiesEffectStarted == M4OSA_TRUE) {
-        postProcessParams.isFiftiesEffectStarted = M4OSA_TRUE;
-        mIsFiftiesEffectStarted = M4OSA_FALSE;
-    }
-    else {
-       postProcessParams.isFiftiesEffectStarted = M4OSA_FALSE;
-    }
-    //postProcessParams.renderer = mTarget;
-    postProcessParams.overlayFrameRGBBuffer = NULL;
-    postProcessParams.overlayFrameYUVBuffer = NULL;
-
-    mTarget->getBufferYV12(&(postProcessParams.pOutBuffer), &(postProcessParams.outBufferStride));
-
-    err = applyEffectsAndRenderingMode(&postProcessParams, videoWidth, videoHeight);
-    return err;
-}
-
 status_t VideoEditorPreviewController::setPreviewFrameRenderingMode(
     M4xVSS_MediaRendering mode, M4VIDEOEDITING_VideoFrameSize outputVideoSize) {
 
@@ -1423,45 +1381,4 @@ status_t VideoEditorPreviewController::setPreviewFrameRenderingMode(
     return err;
 }
 
-M4OSA_ERR VideoEditorPreviewController::doImageRenderingMode(
-    M4OSA_Void * dataPtr, M4OSA_UInt32 colorFormat, M4OSA_UInt32 videoWidth,
-    M4OSA_UInt32 videoHeight, M4OSA_Void* outPtr) {
-
-    M4OSA_ERR err = M4NO_ERROR;
-    M4VIFI_ImagePlane planeIn[3], planeOut[3];
-    M4VIFI_UInt8 *inBuffer = M4OSA_NULL;
-    M4OSA_UInt32 outputBufferWidth =0, outputBufferHeight=0;
-
-    //frameSize = (videoWidth*videoHeight*3) >> 1;
-    inBuffer = (M4OSA_UInt8 *)dataPtr;
-
-    // In plane
-    prepareYUV420ImagePlane(planeIn, videoWidth,
-      videoHeight, (M4VIFI_UInt8 *)inBuffer, videoWidth, videoHeight);
-
-    outputBufferWidth = mOutputVideoWidth;
-    outputBufferHeight = mOutputVideoHeight;
-
-    // Out plane
-    uint8_t* outBuffer;
-    size_t outBufferStride = 0;
-
-    ALOGV("doMediaRendering CALL getBuffer()");
-    mTarget->getBufferYV12(&outBuffer, &outBufferStride);
-
-    // Set the output YUV420 plane to be compatible with YV12 format
-    //In YV12 format, sizes must be even
-    M4OSA_UInt32 yv12PlaneWidth = ((mOutputVideoWidth +1)>>1)<<1;
-    M4OSA_UInt32 yv12PlaneHeight = ((mOutputVideoHeight+1)>>1)<<1;
-
-    prepareYV12ImagePlane(planeOut, yv12PlaneWidth, yv12PlaneHeight,
-     (M4OSA_UInt32)outBufferStride, (M4VIFI_UInt8 *)outBuffer);
-
-    err = applyRenderingMode(planeIn, planeOut, mRenderingMode);
-    if(err != M4NO_ERROR) {
-        ALOGE("doImageRenderingMode: applyRenderingMode returned err=0x%x", (unsigned int)err);
-    }
-    return err;
-}
-
 } //namespace android
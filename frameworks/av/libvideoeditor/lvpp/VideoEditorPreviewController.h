@@ -102,6 +102,12 @@ private:
     M4xVSS_AudioMixingSettings* mBackgroundAudioSetting;
     M4OSA_Context mAudioMixPCMFileHandle;
     PreviewRenderer *mTarget;
+    // Draws the frames of renderPreviewFrame() and their effects with GL
+    NativeWindowRenderer* mFrameRenderer;
+    RenderInput* mFrameRenderInput;
+    sp<Surface> mFrameRendererSurface;
+    uint32_t mFrameRendererWidth;
+    uint32_t mFrameRendererHeight;
     M4OSA_Context mJniCookie;
     jni_progress_callback_fct mJniCallback;
     VideoEditor_renderPreviewFrameStr mFrameStr;
@@ -136,15 +142,7 @@ private:
 
     void setVideoEffectType(M4VSS3GPP_VideoEffectType type, M4OSA_Bool enable);
 
-    M4OSA_ERR applyVideoEffect(
-            M4OSA_Void * dataPtr, M4OSA_UInt32 colorFormat,
-            M4OSA_UInt32 videoWidth, M4OSA_UInt32 videoHeight,
-            M4OSA_UInt32 timeMs, M4OSA_Void* outPtr);
-
-    M4OSA_ERR doImageRenderingMode(
-            M4OSA_Void * dataPtr,
-            M4OSA_UInt32 colorFormat, M4OSA_UInt32 videoWidth,
-            M4OSA_UInt32 videoHeight, M4OSA_Void* outPtr);
+    void releaseFrameRenderer();
 
     // Don't call me!
     VideoEditorPreviewController(const VideoEditorPreviewController &);
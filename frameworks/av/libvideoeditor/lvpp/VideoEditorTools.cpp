@@ -3576,6 +3576,83 @@ M4OSA_ERR applyEffectsAndRenderingMode(vePostProcessParams *params,
     return M4NO_ERROR;
 }
 
+M4OSA_Void computeVideoEffectParams(M4VSS3GPP_EffectSettings* effectsSettings,
+    M4OSA_UInt32 numberEffects, M4OSA_UInt32 currentVideoEffect,
+    M4OSA_UInt32 timeMs, veVideoEffectParams *effectParams) {
+
+    M4OSA_Double percentageDone = 0;
+    M4OSA_UInt32 i;
+
+    effectParams->fadeLevel = 1.0;
+
+    for(i=0;i<numberEffects;i++) {
+        M4VSS3GPP_EffectSettings* effect = &effectsSettings[i];
+
+        // Only the effects covering this frame are used
+        if((effect->uiStartTime > timeMs) ||
+         (effect->uiStartTime + effect->uiDuration < timeMs)) {
+            continue;
+        }
+
+        switch((M4OSA_UInt32)effect->VideoEffectType) {
+            case M4xVSS_kVideoEffectType_ColorRGB16:
+                if(currentVideoEffect & VIDEO_EFFECT_COLOR_RGB16) {
+                    effectParams->colorRgb16 = effect->xVSS.uiRgb16InputColor;
+                }
+                break;
+
+            case M4xVSS_kVideoEffectType_Gradient:
+                if(currentVideoEffect & VIDEO_EFFECT_GRADIENT) {
+                    effectParams->gradientRgb16 = effect->xVSS.uiRgb16InputColor;
+                }
+                break;
+
+            case M4VSS3GPP_kVideoEffectType_FadeFromBlack:
+                if(currentVideoEffect & VIDEO_EFFECT_FADEFROMBLACK) {
+                    computePercentageDone(timeMs, effect->uiStartTime,
+                     effect->uiDuration, &percentageDone);
+                    effectParams->fadeLevel *= (M4OSA_Float)percentageDone;
+                }
+                break;
+
+            case M4VSS3GPP_kVideoEffectType_FadeToBlack:
+                if(currentVideoEffect & VIDEO_EFFECT_FADETOBLACK) {
+                    computePercentageDone(timeMs, effect->uiStartTime,
+                     effect->uiDuration, &percentageDone);
+                    effectParams->fadeLevel *= (M4OSA_Float)(1.0 - percentageDone);
+                }
+                break;
+
+            case M4xVSS_kVideoEffectType_Fifties:
+                if(currentVideoEffect & VIDEO_EFFECT_FIFTIES) {
+                    // Same draws as M4VSS3GPP_externalVideoEffectFifties(),
+                    // scaled to a 1024 line frame
+                    M4OSA_Int32 randomValue = 0;
+                    M4OSA_UInt32 duration = 1000;
+                    if(effect->xVSS.uiFiftiesOutFrameRate != 0) {
+                        duration /= effect->xVSS.uiFiftiesOutFrameRate;
+                    }
+                    if(effectParams->fiftiesTimeMs < 0) {
+                        M4OSA_randInit();
+                    }
+                    if((effectParams->fiftiesTimeMs < 0) ||
+                     (timeMs - effectParams->fiftiesTimeMs > duration)) {
+                        M4OSA_rand(&randomValue, 1024 >> 4);
+                        effectParams->fiftiesShift = (0 == (randomValue % 5)) ?
+                         randomValue / 1024.0f : (1024 - randomValue) / 1024.0f;
+                        M4OSA_rand(&randomValue, 1024 << 2);
+                        effectParams->fiftiesStripe = randomValue / 1024.0f;
+                        effectParams->fiftiesTimeMs = timeMs;
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
 android::status_t getVideoSizeByResolution(
                       M4VIDEOEDITING_VideoFrameSize resolution,
                       uint32_t *pWidth, uint32_t *pHeight) {
@@ -70,6 +70,16 @@ typedef struct {
     M4VIFI_UInt8*  overlayFrameYUVBuffer;
 } vePostProcessParams;
 
+/* Per-frame parameters of the video effects drawn by NativeWindowRenderer */
+typedef struct {
+    M4OSA_UInt16 colorRgb16;      /* RGB565 color of VIDEO_EFFECT_COLOR_RGB16 */
+    M4OSA_UInt16 gradientRgb16;   /* RGB565 top color of VIDEO_EFFECT_GRADIENT */
+    M4OSA_Float fadeLevel;        /* Luma scale of the fades, 0 is black */
+    M4OSA_Int32 fiftiesTimeMs;    /* Time of the last fifties draw, -1 for none */
+    M4OSA_Float fiftiesShift;     /* Fifties roll, in frame heights */
+    M4OSA_Float fiftiesStripe;    /* Fifties stripe position, in frame widths */
+} veVideoEffectParams;
+
 M4VIFI_UInt8 M4VIFI_YUV420PlanarToYUV420Semiplanar(void *user_data, M4VIFI_ImagePlane *PlaneIn, M4VIFI_ImagePlane *PlaneOut );
 M4VIFI_UInt8 M4VIFI_SemiplanarYUV420toYUV420(void *user_data, M4VIFI_ImagePlane *PlaneIn, M4VIFI_ImagePlane *PlaneOut );
 
@@ -136,6 +146,10 @@ M4OSA_ERR applyLumaEffect(M4VSS3GPP_VideoEffectType videoEffect,
 M4OSA_ERR applyEffectsAndRenderingMode(vePostProcessParams *params,
     M4OSA_UInt32 reportedWidth, M4OSA_UInt32 reportedHeight);
 
+M4OSA_Void computeVideoEffectParams(M4VSS3GPP_EffectSettings* effectsSettings,
+    M4OSA_UInt32 numberEffects, M4OSA_UInt32 currentVideoEffect,
+    M4OSA_UInt32 timeMs, veVideoEffectParams *effectParams);
+
 android::status_t getVideoSizeByResolution(M4VIDEOEDITING_VideoFrameSize resolution,
     uint32_t *pWidth, uint32_t *pHeight);
 
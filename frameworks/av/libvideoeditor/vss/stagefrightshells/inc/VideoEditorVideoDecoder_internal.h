@@ -73,12 +73,16 @@ typedef enum {
 
 typedef M4VS_Bitstream_ctxt VIDEOEDITOR_VIDEO_Bitstream_ctxt;
 
+struct MediaBufferPuller;
+
 typedef struct {
 
     /** Stagefrigth params */
     OMXClient               mClient; /**< OMX Client session instance. */
     sp<MediaSource>         mVideoDecoder; /**< Stagefright decoder instance */
     sp<MediaSource>         mReaderSource; /**< Reader access > */
+    MediaBufferPuller*      mDecodeAhead; /**< Decodes the next frames while
+                                               the current one is processed */
 
     /* READER */
     M4READER_GlobalInterface *m_pReaderGlobal;
@@ -26,8 +26,10 @@
 namespace android {
 
 
-MediaBufferPuller::MediaBufferPuller(const sp<MediaSource>& source)
+MediaBufferPuller::MediaBufferPuller(
+        const sp<MediaSource>& source, size_t maxBuffers)
     : mSource(source),
+      mMaxBuffers(maxBuffers),
       mAskToStart(false),
       mAskToStop(false),
       mAcquireStopped(false),
@@ -46,6 +48,12 @@ bool MediaBufferPuller::hasMediaSourceReturnedError() const {
     Mutex::Autolock autolock(mLock);
     return ((mSourceError != OK) ? true : false);
 }
+
+status_t MediaBufferPuller::getMediaSourceError() const {
+    Mutex::Autolock autolock(mLock);
+    return mSourceError;
+}
+
 void MediaBufferPuller::start() {
     Mutex::Autolock autolock(mLock);
     mAskToStart = true;
@@ -82,6 +90,7 @@ MediaBuffer* MediaBufferPuller::getBufferNonBlocking() {
     } else {
         MediaBuffer* b = mBuffers.itemAt(0);
         mBuffers.removeAt(0);
+        mAcquireCond.signal();
         return b;
     }
 }
@@ -97,6 +106,7 @@ MediaBuffer* MediaBufferPuller::getBufferBlocking() {
     } else {
         MediaBuffer* b = mBuffers.itemAt(0);
         mBuffers.removeAt(0);
+        mAcquireCond.signal();
         return b;
     }
 }
@@ -129,6 +139,10 @@ void MediaBufferPuller::acquireThreadFunc() {
 
     // Loop until we are asked to stop, or there is nothing more to read
     while (!mAskToStop) {
+        if (mMaxBuffers > 0 && mBuffers.size() >= mMaxBuffers) {
+            mAcquireCond.wait(mLock);
+            continue;
+        }
         MediaBuffer* pBuffer;
         mLock.unlock();
         status_t result = mSource->read(&pBuffer, NULL);
@@ -33,7 +33,9 @@ struct MediaBuffer;
  */
 struct MediaBufferPuller {
 public:
-    MediaBufferPuller(const sp<MediaSource>& source);
+    // If maxBuffers is not 0, the puller stops reading from the source
+    // while that many buffers are waiting in the list.
+    MediaBufferPuller(const sp<MediaSource>& source, size_t maxBuffers = 0);
     ~MediaBufferPuller();
 
     // Start to build up the list of the buffers.
@@ -58,6 +60,9 @@ public:
     // Check whether the source returned an error or not.
     bool hasMediaSourceReturnedError() const;
 
+    // Get the error returned by the source, OK if there was none.
+    status_t getMediaSourceError() const;
+
 private:
     static int acquireThreadStart(void* arg);
     void acquireThreadFunc();
@@ -66,6 +71,7 @@ private:
     void releaseThreadFunc();
 
     sp<MediaSource> mSource;
+    size_t mMaxBuffers;
     Vector<MediaBuffer*> mBuffers;
     Vector<MediaBuffer*> mReleaseBuffers;
 
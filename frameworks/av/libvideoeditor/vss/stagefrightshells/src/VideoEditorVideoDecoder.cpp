@@ -26,6 +26,7 @@
  *******************/
 
 #include "VideoEditorVideoDecoder_internal.h"
+#include "MediaBufferPuller.h"
 #include "VideoEditorUtils.h"
 #include "M4VD_Tools.h"
 
@@ -44,6 +45,11 @@ using namespace android;
 static M4OSA_ERR copyBufferToQueue(
     VideoEditorVideoDecoder_Context* pDecShellContext,
     MediaBuffer* pDecodedBuffer);
+static status_t readDecodedBuffer(
+    VideoEditorVideoDecoder_Context* pDecShellContext,
+    MediaBuffer** pDecodedBuffer);
+static void stopDecodeAhead(
+    VideoEditorVideoDecoder_Context* pDecShellContext);
 
 class VideoEditorVideoDecoderSource : public MediaSource {
     public:
@@ -890,6 +896,9 @@ M4OSA_ERR VideoEditorVideoDecoder_destroy(M4OSA_Context pContext) {
     // Release the color converter
     delete pDecShellContext->mI420ColorConverter;
 
+    // The decode ahead thread reads from the decoder, stop it first
+    stopDecodeAhead(pDecShellContext);
+
     // Destroy the graph
     if( pDecShellContext->mVideoDecoder != NULL ) {
         ALOGV("### VideoEditorVideoDecoder_destroy : releasing decoder");
@@ -1376,13 +1385,16 @@ M4OSA_ERR VideoEditorVideoDecoder_decode(M4OSA_Context context,
 
         // Read the buffer from the stagefright decoder
         if (needSeek) {
+            // Frames decoded ahead are from before the jump
+            stopDecodeAhead(pDecShellContext);
+
             MediaSource::ReadOptions options;
             int64_t time_us = *pTime * 1000;
             options.setSeekTo(time_us, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
             errStatus = pDecShellContext->mVideoDecoder->read(&pNextBuffer, &options);
             needSeek = false;
         } else {
-            errStatus = pDecShellContext->mVideoDecoder->read(&pNextBuffer);
+            errStatus = readDecodedBuffer(pDecShellContext, &pNextBuffer);
         }
 
         // Handle EOS and format change
@@ -1477,6 +1489,44 @@ VIDEOEDITOR_VideoDecode_cleanUP:
     return lerr;
 }
 
+/*
+ * Reads the next decoded frame. The frames are read from the decoder on
+ * a separate thread, one frame ahead of the caller, so that decoding
+ * overlaps with the effects and the encoding of the current frame. The
+ * decoder error that ends the decode ahead (end of stream or format
+ * change) is returned after the frames that preceded it.
+ */
+static status_t readDecodedBuffer(
+    VideoEditorVideoDecoder_Context* pDecShellContext,
+    MediaBuffer** pDecodedBuffer) {
+
+    // Holding one more frame keeps as many decoder buffers out as the
+    // synchronous read did, with the previous frame still in use.
+    const size_t kDecodeAheadFrames = 1;
+
+    if (pDecShellContext->mDecodeAhead == NULL) {
+        pDecShellContext->mDecodeAhead = new MediaBufferPuller(
+            pDecShellContext->mVideoDecoder, kDecodeAheadFrames);
+        pDecShellContext->mDecodeAhead->start();
+    }
+
+    *pDecodedBuffer = pDecShellContext->mDecodeAhead->getBufferBlocking();
+    if (*pDecodedBuffer != NULL) {
+        return OK;
+    }
+
+    status_t err = pDecShellContext->mDecodeAhead->getMediaSourceError();
+    stopDecodeAhead(pDecShellContext);
+    return err;
+}
+
+static void stopDecodeAhead(
+    VideoEditorVideoDecoder_Context* pDecShellContext) {
+    // Also releases the frames that were not read
+    delete pDecShellContext->mDecodeAhead;
+    pDecShellContext->mDecodeAhead = NULL;
+}
+
 static M4OSA_ERR copyBufferToQueue(
     VideoEditorVideoDecoder_Context* pDecShellContext,
     MediaBuffer* pDecoderBuffer) {
@@ -43,6 +43,9 @@ const effect_descriptor_t gLEDescriptor = {
         "The Android Open Source Project",
 };
 
+// number of frames converted to float and compressed at a time by LE_process()
+#define LE_PROCESS_BLOCK_FRAMES 256
+
 enum le_state_e {
     LOUDNESS_ENHANCER_STATE_UNINITIALIZED,
     LOUDNESS_ENHANCER_STATE_INITIALIZED,
@@ -280,16 +283,24 @@ int LE_process(
     }
 
     //ALOGV("LE about to process %d samples", inBuffer->frameCount);
-    uint16_t inIdx;
     float inputAmp = pow(10, pContext->mTargetGainmB/2000.0f);
-    float leftSample, rightSample;
-    for (inIdx = 0 ; inIdx < inBuffer->frameCount ; inIdx++) {
+    float samples[2 * LE_PROCESS_BLOCK_FRAMES];
+    size_t inIdx = 0;
+    while (inIdx < inBuffer->frameCount) {
+        size_t frames = inBuffer->frameCount - inIdx;
+        if (frames > LE_PROCESS_BLOCK_FRAMES) {
+            frames = LE_PROCESS_BLOCK_FRAMES;
+        }
+        int16_t *s16 = inBuffer->s16 + 2 * inIdx;
         // makeup gain is applied on the input of the compressor
-        leftSample  = inputAmp * (float)inBuffer->s16[2*inIdx];
-        rightSample = inputAmp * (float)inBuffer->s16[2*inIdx +1];
-        pContext->mCompressor->Compress(&leftSample, &rightSample);
-        inBuffer->s16[2*inIdx]    = (int16_t) leftSample;
-        inBuffer->s16[2*inIdx +1] = (int16_t) rightSample;
+        for (size_t i = 0; i < 2 * frames; i++) {
+            samples[i] = inputAmp * (float)s16[i];
+        }
+        pContext->mCompressor->CompressStereo(samples, frames);
+        for (size_t i = 0; i < 2 * frames; i++) {
+            s16[i] = (int16_t) samples[i];
+        }
+        inIdx += frames;
     }
 
     if (inBuffer->raw != outBuffer->raw) {
@@ -16,6 +16,12 @@
 
 #include <cmath>
 
+#if defined(ARCH_ARM_HAVE_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "common/core/math.h"
 #include "common/core/types.h"
 #include "dsp/core/basic.h"
@@ -137,5 +143,138 @@ void AdaptiveDynamicRangeCompression::Compress(float *x1, float *x2) {
   }
 }
 
+void AdaptiveDynamicRangeCompression::CompressStereo(float *x,
+                                                     int num_frames) {
+  float cv[kBlockSize];
+  float gains[kBlockSize];
+  while (num_frames > 0) {
+    const int n = num_frames < kBlockSize ? num_frames : kBlockSize;
+    ComputeControlValues(x, n, cv);
+    // The envelope detector depends on the previous frame
+    for (int i = 0; i < n; ++i) {
+      const float prev_state = state_;
+      if (cv[i] <= state_) {
+        state_ = alpha_attack_ * state_ + (1.0f - alpha_attack_) * cv[i];
+      } else {
+        state_ = alpha_release_ * state_ + (1.0f - alpha_release_) * cv[i];
+      }
+      compressor_gain_ *=
+          math::ExpApproximationViaTaylorExpansionOrder5(state_ - prev_state);
+      gains[i] = compressor_gain_;
+    }
+    ApplyGains(x, n, gains);
+    x += 2 * n;
+    num_frames -= n;
+  }
+}
+
+// The SIMD versions of fast_log2(.) below follow the scalar one operation by
+// operation, so that the results are identical.
+void AdaptiveDynamicRangeCompression::ComputeControlValues(
+    const float *x, int num_frames, float *cv) const {
+  int i = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+  const float32x4_t min_value = vdupq_n_f32(kMinLogAbsValue);
+  const float32x4_t knee = vdupq_n_f32(knee_threshold_);
+  const float32x4_t slope = vdupq_n_f32(slope_);
+  for (; i + 4 <= num_frames; i += 4) {
+    const float32x4x2_t lr = vld2q_f32(x + 2 * i);
+    const float32x4_t max_abs_x = vmaxq_f32(vabsq_f32(lr.val[0]),
+        vmaxq_f32(vabsq_f32(lr.val[1]), min_value));
+    int32x4_t bits = vreinterpretq_s32_f32(max_abs_x);
+    const int32x4_t log_2 = vsubq_s32(
+        vandq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(255)), vdupq_n_s32(128));
+    bits = vandq_s32(bits, vdupq_n_s32(~(255 << 23)));
+    bits = vaddq_s32(bits, vdupq_n_s32(127 << 23));
+    const float32x4_t mantissa = vreinterpretq_f32_s32(bits);
+    float32x4_t val = vaddq_f32(vmulq_f32(vdupq_n_f32(-1.0f / 3), mantissa),
+                                vdupq_n_f32(2.0f));
+    val = vsubq_f32(vmulq_f32(val, mantissa), vdupq_n_f32(2.0f / 3));
+    val = vaddq_f32(val, vcvtq_f32_s32(log_2));
+    const float32x4_t max_abs_x_dB = vmulq_f32(val,
+        vdupq_n_f32(0.693147180559945286226763982995180413126945495605468750f));
+    const float32x4_t rect = vmaxq_f32(vsubq_f32(max_abs_x_dB, knee),
+                                       vdupq_n_f32(0.0f));
+    vst1q_f32(cv + i, vmulq_f32(rect, slope));
+  }
+#elif defined(__SSE2__)
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 min_value = _mm_set1_ps(kMinLogAbsValue);
+  const __m128 knee = _mm_set1_ps(knee_threshold_);
+  const __m128 slope = _mm_set1_ps(slope_);
+  for (; i + 4 <= num_frames; i += 4) {
+    const __m128 a = _mm_and_ps(_mm_loadu_ps(x + 2 * i), abs_mask);
+    const __m128 b = _mm_and_ps(_mm_loadu_ps(x + 2 * i + 4), abs_mask);
+    const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    const __m128 max_abs_x = _mm_max_ps(left, _mm_max_ps(right, min_value));
+    __m128i bits = _mm_castps_si128(max_abs_x);
+    const __m128i log_2 = _mm_sub_epi32(
+        _mm_and_si128(_mm_srai_epi32(bits, 23), _mm_set1_epi32(255)),
+        _mm_set1_epi32(128));
+    bits = _mm_and_si128(bits, _mm_set1_epi32(~(255 << 23)));
+    bits = _mm_add_epi32(bits, _mm_set1_epi32(127 << 23));
+    const __m128 mantissa = _mm_castsi128_ps(bits);
+    __m128 val = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.0f / 3), mantissa),
+                            _mm_set1_ps(2.0f));
+    val = _mm_sub_ps(_mm_mul_ps(val, mantissa), _mm_set1_ps(2.0f / 3));
+    val = _mm_add_ps(val, _mm_cvtepi32_ps(log_2));
+    const __m128 max_abs_x_dB = _mm_mul_ps(val,
+        _mm_set1_ps(0.693147180559945286226763982995180413126945495605468750f));
+    const __m128 rect = _mm_max_ps(_mm_sub_ps(max_abs_x_dB, knee),
+                                   _mm_setzero_ps());
+    _mm_storeu_ps(cv + i, _mm_mul_ps(rect, slope));
+  }
+#endif
+  for (; i < num_frames; ++i) {
+    const float max_abs_x = std::max(std::fabs(x[2 * i]),
+      std::max(std::fabs(x[2 * i + 1]), kMinLogAbsValue));
+    const float max_abs_x_dB = math::fast_log(max_abs_x);
+    const float overshoot = max_abs_x_dB - knee_threshold_;
+    const float rect = std::max(overshoot, 0.0f);
+    cv[i] = rect * slope_;
+  }
+}
+
+void AdaptiveDynamicRangeCompression::ApplyGains(
+    float *x, int num_frames, const float *gains) const {
+  int i = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+  const float32x4_t upper = vdupq_n_f32(kFixedPointLimit);
+  const float32x4_t lower = vdupq_n_f32(-kFixedPointLimit);
+  for (; i + 4 <= num_frames; i += 4) {
+    float32x4x2_t lr = vld2q_f32(x + 2 * i);
+    const float32x4_t g = vld1q_f32(gains + i);
+    lr.val[0] = vmaxq_f32(vminq_f32(vmulq_f32(lr.val[0], g), upper), lower);
+    lr.val[1] = vmaxq_f32(vminq_f32(vmulq_f32(lr.val[1], g), upper), lower);
+    vst2q_f32(x + 2 * i, lr);
+  }
+#elif defined(__SSE2__)
+  const __m128 upper = _mm_set1_ps(kFixedPointLimit);
+  const __m128 lower = _mm_set1_ps(-kFixedPointLimit);
+  for (; i + 4 <= num_frames; i += 4) {
+    const __m128 g = _mm_loadu_ps(gains + i);
+    const __m128 g_lo = _mm_unpacklo_ps(g, g);
+    const __m128 g_hi = _mm_unpackhi_ps(g, g);
+    const __m128 a = _mm_mul_ps(_mm_loadu_ps(x + 2 * i), g_lo);
+    const __m128 b = _mm_mul_ps(_mm_loadu_ps(x + 2 * i + 4), g_hi);
+    _mm_storeu_ps(x + 2 * i, _mm_max_ps(_mm_min_ps(a, upper), lower));
+    _mm_storeu_ps(x + 2 * i + 4, _mm_max_ps(_mm_min_ps(b, upper), lower));
+  }
+#endif
+  for (; i < num_frames; ++i) {
+    for (int c = 0; c < 2; ++c) {
+      float y = x[2 * i + c] * gains[i];
+      if (y > kFixedPointLimit) {
+        y = kFixedPointLimit;
+      }
+      if (y < -kFixedPointLimit) {
+        y = -kFixedPointLimit;
+      }
+      x[2 * i + c] = y;
+    }
+  }
+}
+
 }  // namespace le_fx
 
@@ -58,6 +58,13 @@ class AdaptiveDynamicRangeCompression {
   // Stereo channel version of the compressor
   void Compress(float *x1, float *x2);
 
+  // Block version of the stereo compressor, which compresses `num_frames`
+  // interleaved stereo frames in place. The results are the same as those of
+  // Compress(float *, float *) on each frame, but the log-domain overshoot and
+  // the gain are computed for several frames at once, with SIMD where
+  // available. Only the envelope detector runs one frame at a time.
+  void CompressStereo(float *x, int num_frames);
+
   // This version is slower than Compress(.) but faster than CompressSlow(.)
   float CompressNormalSpeed(float x);
 
@@ -109,6 +116,14 @@ class AdaptiveDynamicRangeCompression {
   // threshold.
   sigmod::InterpolatorLinear<float> target_gain_to_knee_threshold_;
 
+  // Number of frames CompressStereo(.) handles per pass
+  static const int kBlockSize = 64;
+
+  // Computes the rectified and sloped overshoot of each stereo frame.
+  void ComputeControlValues(const float *x, int num_frames, float *cv) const;
+  // Applies the per-frame gains to stereo frames, with saturation.
+  void ApplyGains(float *x, int num_frames, const float *gains) const;
+
   LE_FX_DISALLOW_COPY_AND_ASSIGN(AdaptiveDynamicRangeCompression);
 };
 
@@ -20,6 +20,9 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 /**********************************************************************************
    FUNCTION COPY_16
@@ -33,6 +36,16 @@ void Copy_16( const LVM_INT16 *src,
 
     if (src > dst)
     {
+#ifdef __ARM_NEON__
+        /* Each block is loaded before it is stored, so overlap is handled as below */
+        for (ii = n >> 3; ii != 0; ii--)
+        {
+            vst1q_s16(dst, vld1q_s16(src));
+            dst += 8;
+            src += 8;
+        }
+        n &= 7;
+#endif
         for (ii = n; ii != 0; ii--)
         {
             *dst = *src;
@@ -42,6 +55,13 @@ void Copy_16( const LVM_INT16 *src,
     }
     else
     {
+#ifdef __ARM_NEON__
+        for (ii = n >> 3; ii != 0; ii--)
+        {
+            n -= 8;
+            vst1q_s16(dst + n, vld1q_s16(src + n));
+        }
+#endif
         src += n - 1;
         dst += n - 1;
         for (ii = n; ii != 0; ii--)
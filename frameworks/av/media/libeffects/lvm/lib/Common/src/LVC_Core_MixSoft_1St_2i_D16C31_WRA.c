@@ -22,6 +22,9 @@
 #include "LVC_Mixer_Private.h"
 #include "ScalarArithmetic.h"
 #include "LVM_Macros.h"
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 /**********************************************************************************
    FUNCTION LVC_Core_MixSoft_1St_2i_D16C31_WRA
@@ -127,6 +130,17 @@ void LVC_Core_MixSoft_1St_2i_D16C31_WRA( LVMixer3_st        *ptrInstance1,
         CurrentShortL = (LVM_INT16)(CurrentL>>16);                                 /* From Q31 to Q15*/
         CurrentShortR = (LVM_INT16)(CurrentR>>16);                                 /* From Q31 to Q15*/
 
+#ifdef __ARM_NEON__
+        {
+            const LVM_INT16 GainsLR[4] = {CurrentShortL, CurrentShortR, CurrentShortL, CurrentShortR};
+            int16x4_t   Gains = vld1_s16(GainsLR);
+            int16x8_t   Samples = vld1q_s16(src);                                  /* L R L R L R L R */
+            vst1_s16(dst, vshrn_n_s32(vmull_s16(vget_low_s16(Samples), Gains), 15));     /* Q15*Q15>>15 into Q15 */
+            vst1_s16(dst + 4, vshrn_n_s32(vmull_s16(vget_high_s16(Samples), Gains), 15));
+            src += 8;
+            dst += 8;
+        }
+#else
         *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShortL)>>15);    /* Q15*Q15>>15 into Q15 */
         *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShortR)>>15);    /* Q15*Q15>>15 into Q15 */
         *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShortL)>>15);
@@ -135,6 +149,7 @@ void LVC_Core_MixSoft_1St_2i_D16C31_WRA( LVMixer3_st        *ptrInstance1,
         *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShortR)>>15);
         *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShortL)>>15);
         *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShortR)>>15);
+#endif
     }
     pInstanceL->Current=CurrentL;
     pInstanceR->Current=CurrentR;
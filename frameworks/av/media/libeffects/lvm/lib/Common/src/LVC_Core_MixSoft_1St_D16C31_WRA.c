@@ -22,6 +22,9 @@
 #include "LVC_Mixer_Private.h"
 #include "LVM_Macros.h"
 #include "ScalarArithmetic.h"
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 /**********************************************************************************
    FUNCTION LVCore_MIXSOFT_1ST_D16C31_WRA
@@ -67,10 +70,16 @@ void LVC_Core_MixSoft_1St_D16C31_WRA( LVMixer3_st *ptrInstance,
 
             CurrentShort = (LVM_INT16)(Current>>16);                                 /* From Q31 to Q15*/
 
+#ifdef __ARM_NEON__
+            vst1_s16(dst, vshrn_n_s32(vmull_n_s16(vld1_s16(src), CurrentShort), 15));  /* Q15*Q15>>15 into Q15 */
+            src += 4;
+            dst += 4;
+#else
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);    /* Q15*Q15>>15 into Q15 */
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);
+#endif
         }
     }
     else{
@@ -93,10 +102,16 @@ void LVC_Core_MixSoft_1St_D16C31_WRA( LVMixer3_st *ptrInstance,
 
             CurrentShort = (LVM_INT16)(Current>>16);                                 /* From Q31 to Q15*/
 
+#ifdef __ARM_NEON__
+            vst1_s16(dst, vshrn_n_s32(vmull_n_s16(vld1_s16(src), CurrentShort), 15));  /* Q15*Q15>>15 into Q15 */
+            src += 4;
+            dst += 4;
+#else
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);    /* Q15*Q15>>15 into Q15 */
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);
             *(dst++) = (LVM_INT16)(((LVM_INT32)*(src++) * (LVM_INT32)CurrentShort)>>15);
+#endif
         }
     }
     pInstance->Current=Current;
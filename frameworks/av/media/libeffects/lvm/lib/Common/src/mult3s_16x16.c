@@ -20,6 +20,9 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 /**********************************************************************************
    FUNCTION MULT3S_16X16
@@ -33,6 +36,19 @@ void Mult3s_16x16( const LVM_INT16 *src,
     LVM_INT16 ii;
     LVM_INT32 temp;
 
+#ifdef __ARM_NEON__
+    /* Eight samples at a time, bit exact with the loop below */
+    for (ii = n >> 3; ii != 0; ii--)
+    {
+        int16x8_t in = vld1q_s16(src);
+        vst1_s16(dst, vshrn_n_s32(vmull_n_s16(vget_low_s16(in), val), 15));
+        vst1_s16(dst + 4, vshrn_n_s32(vmull_n_s16(vget_high_s16(in), val), 15));
+        src += 8;
+        dst += 8;
+    }
+    n &= 7;
+#endif
+
     for (ii = n; ii != 0; ii--)
     {
         temp = (LVM_INT32)(*src) * (LVM_INT32)val;
@@ -8,6 +8,10 @@ LOCAL_SRC_FILES:= \
 
 LOCAL_CFLAGS+= -O2 -fvisibility=hidden
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -DARCH_ARM_HAVE_NEON
+endif
+
 LOCAL_SHARED_LIBRARIES := \
 	libcutils \
 	liblog \
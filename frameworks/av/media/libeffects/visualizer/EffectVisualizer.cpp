@@ -25,6 +25,16 @@
 #include <math.h>
 #include <audio_effects/effect_visualizer.h>
 
+#if defined(ARCH_ARM_HAVE_NEON)
+#include <arm_neon.h>
+#define VISUALIZER_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VISUALIZER_SIMD 1
+#else
+#define VISUALIZER_SIMD 0
+#endif
+
 
 extern "C" {
 
@@ -302,6 +312,131 @@ static inline int16_t clamp16(int32_t sample)
     return sample;
 }
 
+// The per buffer loops below run on the mixer thread for every buffer played, and handle
+// 8 samples or frames per iteration where SIMD is available.
+
+// Returns the largest sample magnitude in the buffer, with negative samples s counted as
+// -s - 1 so that the result fits 15 bits.
+static int32_t Visualizer_maxMagnitude(const int16_t *in, size_t count)
+{
+    size_t i = 0;
+    int32_t maxMag = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+    int16x8_t vmax = vdupq_n_s16(0);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        vmax = vmaxq_s16(vmax, veorq_s16(v, vshrq_n_s16(v, 15)));
+    }
+    int16x4_t m = vmax_s16(vget_low_s16(vmax), vget_high_s16(vmax));
+    m = vpmax_s16(m, m);
+    m = vpmax_s16(m, m);
+    maxMag = vget_lane_s16(m, 0);
+#elif VISUALIZER_SIMD
+    __m128i vmax = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+        vmax = _mm_max_epi16(vmax, _mm_xor_si128(v, _mm_srai_epi16(v, 15)));
+    }
+    vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 8));
+    vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 4));
+    vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 2));
+    maxMag = (int16_t) _mm_cvtsi128_si32(vmax);
+#endif
+    for (; i < count; i++) {
+        int32_t smp = in[i];
+        if (smp < 0) smp = -smp - 1;
+        if (smp > maxMag) maxMag = smp;
+    }
+    return maxMag;
+}
+
+// Computes the peak absolute value, saturated to 32767, and the mean square of the samples.
+static void Visualizer_measure(const int16_t *in, size_t count,
+        uint16_t *peakU16, float *rmsSquared)
+{
+    size_t i = 0;
+    int32_t peak = 0;
+    int64_t sumSquares = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+    int16x8_t vpeak = vdupq_n_s16(0);
+    int64x2_t vsum = vdupq_n_s64(0);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        vpeak = vmaxq_s16(vpeak, vqabsq_s16(v));
+        vsum = vpadalq_s32(vsum, vmull_s16(vget_low_s16(v), vget_low_s16(v)));
+        vsum = vpadalq_s32(vsum, vmull_s16(vget_high_s16(v), vget_high_s16(v)));
+    }
+    int16x4_t m = vmax_s16(vget_low_s16(vpeak), vget_high_s16(vpeak));
+    m = vpmax_s16(m, m);
+    m = vpmax_s16(m, m);
+    peak = vget_lane_s16(m, 0);
+    sumSquares = vgetq_lane_s64(vsum, 0) + vgetq_lane_s64(vsum, 1);
+#elif VISUALIZER_SIMD
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vpeak = zero;
+    __m128i vsum = zero;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+        vpeak = _mm_max_epi16(vpeak, _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+        // pairs of squares add up to at most 2^31, which fits when taken as unsigned
+        __m128i sq = _mm_madd_epi16(v, v);
+        vsum = _mm_add_epi64(vsum, _mm_unpacklo_epi32(sq, zero));
+        vsum = _mm_add_epi64(vsum, _mm_unpackhi_epi32(sq, zero));
+    }
+    vpeak = _mm_max_epi16(vpeak, _mm_srli_si128(vpeak, 8));
+    vpeak = _mm_max_epi16(vpeak, _mm_srli_si128(vpeak, 4));
+    vpeak = _mm_max_epi16(vpeak, _mm_srli_si128(vpeak, 2));
+    peak = (int16_t) _mm_cvtsi128_si32(vpeak);
+    int64_t sums[2];
+    _mm_storeu_si128((__m128i *) sums, vsum);
+    sumSquares = sums[0] + sums[1];
+#endif
+    for (; i < count; i++) {
+        int32_t smp = in[i];
+        sumSquares += smp * smp;
+        if (smp < 0) smp = -smp;
+        if (smp > 32767) smp = 32767;
+        if (smp > peak) peak = smp;
+    }
+    *peakU16 = (uint16_t) peak;
+    *rmsSquared = (float) sumSquares / count;
+}
+
+// Writes the scaled mono downmix of stereo frames as unsigned 8 bit samples. shift must be
+// at least 1.
+static void Visualizer_downmix(const int16_t *in, uint8_t *out, size_t frames, int32_t shift)
+{
+    size_t i = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+    // the halving add does the first bit of the shift
+    const int16x8_t vshift = vdupq_n_s16(-(shift - 1));
+    const uint8x8_t bias = vdup_n_u8(0x80);
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t lr = vld2q_s16(in + 2 * i);
+        int16x8_t smp = vshlq_s16(vhaddq_s16(lr.val[0], lr.val[1]), vshift);
+        vst1_u8(out + i, veor_u8(vreinterpret_u8_s8(vmovn_s16(smp)), bias));
+    }
+#elif VISUALIZER_SIMD
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    const __m128i lowByte = _mm_set1_epi16(0xff);
+    const __m128i bias = _mm_set1_epi8((char) 0x80);
+    for (; i + 8 <= frames; i += 8) {
+        __m128i lo = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (in + 2 * i)), ones);
+        __m128i hi = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (in + 2 * i + 8)), ones);
+        // in 16 bit range after a shift of at least 1, then truncated to 8 bits
+        __m128i smp = _mm_packs_epi32(_mm_sra_epi32(lo, vshift), _mm_sra_epi32(hi, vshift));
+        smp = _mm_packus_epi16(_mm_and_si128(smp, lowByte), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i *) (out + i), _mm_xor_si128(smp, bias));
+    }
+#endif
+    for (; i < frames; i++) {
+        int32_t smp = in[2 * i] + in[2 * i + 1];
+        smp = smp >> shift;
+        out[i] = ((uint8_t)smp)^0x80;
+    }
+}
+
 int Visualizer_process(
         effect_handle_t self,audio_buffer_t *inBuffer, audio_buffer_t *outBuffer)
 {
@@ -320,22 +455,10 @@ int Visualizer_process(
 
     // perform measurements if needed
     if (pContext->mMeasurementMode & MEASUREMENT_MODE_PEAK_RMS) {
-        // find the peak and RMS squared for the new buffer
-        uint32_t inIdx;
-        int16_t maxSample = 0;
-        float rmsSqAcc = 0;
-        for (inIdx = 0 ; inIdx < inBuffer->frameCount * pContext->mChannelCount ; inIdx++) {
-            if (inBuffer->s16[inIdx] > maxSample) {
-                maxSample = inBuffer->s16[inIdx];
-            } else if (-inBuffer->s16[inIdx] > maxSample) {
-                maxSample = -inBuffer->s16[inIdx];
-            }
-            rmsSqAcc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
-        }
-        // store the measurement
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mPeakU16 = (uint16_t)maxSample;
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mRmsSquared =
-                rmsSqAcc / (inBuffer->frameCount * pContext->mChannelCount);
+        // find the peak and RMS squared for the new buffer, and store the measurement
+        BufferStats *stats = &pContext->mPastMeasurements[pContext->mMeasurementBufferIdx];
+        Visualizer_measure(inBuffer->s16, inBuffer->frameCount * pContext->mChannelCount,
+                &stats->mPeakU16, &stats->mRmsSquared);
         pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mIsValid = true;
         if (++pContext->mMeasurementBufferIdx >= pContext->mMeasurementWindowSizeInBuffers) {
             pContext->mMeasurementBufferIdx = 0;
@@ -348,14 +471,9 @@ int Visualizer_process(
     if (pContext->mScalingMode == VISUALIZER_SCALING_MODE_NORMALIZED) {
         // derive capture scaling factor from peak value in current buffer
         // this gives more interesting captures for display.
-        shift = 32;
-        int len = inBuffer->frameCount * 2;
-        for (int i = 0; i < len; i++) {
-            int32_t smp = inBuffer->s16[i];
-            if (smp < 0) smp = -smp - 1; // take care to keep the max negative in range
-            int32_t clz = __builtin_clz(smp);
-            if (shift > clz) shift = clz;
-        }
+        // take care to keep the max negative in range
+        int32_t maxMag = Visualizer_maxMagnitude(inBuffer->s16, inBuffer->frameCount * 2);
+        shift = maxMag == 0 ? 32 : __builtin_clz(maxMag);
         // A maximum amplitude signal will have 17 leading zeros, which we want to
         // translate to a shift of 8 (for converting 16 bit to 8 bit)
         shift = 25 - shift;
@@ -370,19 +488,21 @@ int Visualizer_process(
         shift = 9;
     }
 
-    uint32_t captIdx;
-    uint32_t inIdx;
+    uint32_t captIdx = pContext->mCaptureIdx;
+    uint32_t inIdx = 0;
     uint8_t *buf = pContext->mCaptureBuf;
-    for (inIdx = 0, captIdx = pContext->mCaptureIdx;
-         inIdx < inBuffer->frameCount;
-         inIdx++, captIdx++) {
+    while (inIdx < inBuffer->frameCount) {
         if (captIdx >= CAPTURE_BUF_SIZE) {
             // wrap around
             captIdx = 0;
         }
-        int32_t smp = inBuffer->s16[2 * inIdx] + inBuffer->s16[2 * inIdx + 1];
-        smp = smp >> shift;
-        buf[captIdx] = ((uint8_t)smp)^0x80;
+        uint32_t frames = inBuffer->frameCount - inIdx;
+        if (frames > CAPTURE_BUF_SIZE - captIdx) {
+            frames = CAPTURE_BUF_SIZE - captIdx;
+        }
+        Visualizer_downmix(inBuffer->s16 + 2 * inIdx, buf + captIdx, frames, shift);
+        inIdx += frames;
+        captIdx += frames;
     }
 
     // XXX the following two should really be atomic, though it probably doesn't
@@ -37,6 +37,7 @@ sp<AudioSystem::AudioFlingerClient> AudioSystem::gAudioFlingerClient;
 audio_error_callback AudioSystem::gAudioErrorCallback = NULL;
 // Cached values
 
+DefaultKeyedVector<audio_stream_type_t, audio_io_handle_t> AudioSystem::gStreamOutputMap(0);
 DefaultKeyedVector<audio_io_handle_t, AudioSystem::OutputDescriptor *> AudioSystem::gOutputs(0);
 
 // Cached values for recording queries, all protected by gLock
@@ -222,7 +223,7 @@ status_t AudioSystem::getOutputSamplingRate(uint32_t* samplingRate, audio_stream
         streamType = AUDIO_STREAM_MUSIC;
     }
 
-    output = getOutput(streamType);
+    output = getDefaultOutput(streamType);
     if (output == 0) {
         return PERMISSION_DENIED;
     }
@@ -230,6 +231,33 @@ status_t AudioSystem::getOutputSamplingRate(uint32_t* samplingRate, audio_stream
     return getSamplingRate(output, streamType, samplingRate);
 }
 
+// The output selected for a stream with default parameters is cached in gStreamOutputMap, so
+// that the getOutputXxx() queries made for every new track do not need to go through binder.
+// The cache is kept current by ioConfigChanged().
+audio_io_handle_t AudioSystem::getDefaultOutput(audio_stream_type_t stream)
+{
+    // registers our AudioFlingerClient, which receives the output events
+    get_audio_flinger();
+
+    gLock.lock();
+    audio_io_handle_t output = gStreamOutputMap.valueFor(stream);
+    gLock.unlock();
+    if (output != 0) {
+        return output;
+    }
+
+    output = getOutput(stream);
+    if (output != 0) {
+        // only cache outputs known from an OUTPUT_OPENED event, so that
+        // the OUTPUT_CLOSED event is not missed
+        Mutex::Autolock _l(gLock);
+        if (gOutputs.indexOfKey(output) >= 0) {
+            gStreamOutputMap.add(stream, output);
+        }
+    }
+    return output;
+}
+
 status_t AudioSystem::getSamplingRate(audio_io_handle_t output,
                                       audio_stream_type_t streamType,
                                       uint32_t* samplingRate)
@@ -264,7 +292,7 @@ status_t AudioSystem::getOutputFrameCount(size_t* frameCount, audio_stream_type_
         streamType = AUDIO_STREAM_MUSIC;
     }
 
-    output = getOutput(streamType);
+    output = getDefaultOutput(streamType);
     if (output == 0) {
         return PERMISSION_DENIED;
     }
@@ -304,7 +332,7 @@ status_t AudioSystem::getOutputLatency(uint32_t* latency, audio_stream_type_t st
         streamType = AUDIO_STREAM_MUSIC;
     }
 
-    output = getOutput(streamType);
+    output = getDefaultOutput(streamType);
     if (output == 0) {
         return PERMISSION_DENIED;
     }
@@ -424,6 +452,7 @@ void AudioSystem::AudioFlingerClient::binderDied(const wp<IBinder>& who) {
 
     AudioSystem::gAudioFlinger.clear();
     // clear output handles and stream to output map caches
+    AudioSystem::gStreamOutputMap.clear();
     AudioSystem::gOutputs.clear();
 
     if (gAudioErrorCallback) {
@@ -443,9 +472,17 @@ void AudioSystem::AudioFlingerClient::ioConfigChanged(int event, audio_io_handle
     Mutex::Autolock _l(AudioSystem::gLock);
 
     switch (event) {
-    case STREAM_CONFIG_CHANGED:
-        break;
+    case STREAM_CONFIG_CHANGED: {
+        // the stream has been moved to another output
+        if (param2 == NULL) break;
+        stream = *(const audio_stream_type_t *)param2;
+        ALOGV("ioConfigChanged() new output %d for stream %d", ioHandle, stream);
+        gStreamOutputMap.removeItem(stream);
+        } break;
     case OUTPUT_OPENED: {
+        // the policy may now select the new output for some streams
+        gStreamOutputMap.clear();
+
         if (gOutputs.indexOfKey(ioHandle) >= 0) {
             ALOGV("ioConfigChanged() opening already existing output! %d", ioHandle);
             break;
@@ -467,6 +504,11 @@ void AudioSystem::AudioFlingerClient::ioConfigChanged(int event, audio_io_handle
         }
         ALOGV("ioConfigChanged() output %d closed", ioHandle);
 
+        for (int i = gStreamOutputMap.size() - 1; i >= 0 ; i--) {
+            if (gStreamOutputMap.valueAt(i) == ioHandle) {
+                gStreamOutputMap.removeItemsAt(i);
+            }
+        }
         gOutputs.removeItem(ioHandle);
         } break;
 
@@ -791,6 +833,7 @@ void AudioSystem::clearAudioConfigCache()
 {
     Mutex::Autolock _l(gLock);
     ALOGV("clearAudioConfigCache()");
+    gStreamOutputMap.clear();
     gOutputs.clear();
 }
 
@@ -807,6 +850,7 @@ bool AudioSystem::isOffloadSupported(const audio_offload_info_t& info)
 void AudioSystem::AudioPolicyServiceClient::binderDied(const wp<IBinder>& who) {
     Mutex::Autolock _l(AudioSystem::gLock);
     AudioSystem::gAudioPolicyService.clear();
+    AudioSystem::gStreamOutputMap.clear();
 
     ALOGW("AudioPolicyService server died!");
 }
@@ -205,6 +205,10 @@ status_t ClientProxy::obtainBuffer(Buffer* buffer, const struct timespec *reques
             break;
         }
         int32_t old = android_atomic_and(~CBLK_FUTEX_WAKE, &cblk->mFutex);
+        if (!(old & CBLK_FUTEX_WAKE)) {
+            // let the server know that it must wake us, unless it already posted a wake
+            old = android_atomic_or(CBLK_FUTEX_WAITING, &cblk->mFutex);
+        }
         if (!(old & CBLK_FUTEX_WAKE)) {
             int rc;
             if (measure && !beforeIsValid) {
@@ -212,7 +216,9 @@ status_t ClientProxy::obtainBuffer(Buffer* buffer, const struct timespec *reques
                 beforeIsValid = true;
             }
             int ret = __futex_syscall4(&cblk->mFutex,
-                    mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, old & ~CBLK_FUTEX_WAKE, ts);
+                    mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, old | CBLK_FUTEX_WAITING,
+                    ts);
+            android_atomic_and(~CBLK_FUTEX_WAITING, &cblk->mFutex);
             // update total elapsed time spent waiting
             if (measure) {
                 struct timespec after;
@@ -290,6 +296,49 @@ void ClientProxy::releaseBuffer(Buffer* buffer)
     }
 }
 
+status_t ClientProxy::obtainBatch(Batch* batch, size_t frameCount,
+        const struct timespec *requested, struct timespec *elapsed)
+{
+    LOG_ALWAYS_FATAL_IF(batch == NULL || frameCount == 0);
+    Buffer& part1 = batch->mParts[0];
+    Buffer& part2 = batch->mParts[1];
+    part1.mFrameCount = frameCount;
+    status_t status = obtainBuffer(&part1, requested, elapsed);
+    part2.mFrameCount = 0;
+    part2.mRaw = NULL;
+    part2.mNonContig = 0;
+    if (status == NO_ERROR && part1.mFrameCount < frameCount && part1.mNonContig > 0) {
+        // the non-contiguous frames always continue at the start of the buffer
+        size_t count = frameCount - part1.mFrameCount;
+        if (count > part1.mNonContig) {
+            count = part1.mNonContig;
+        }
+        part2.mFrameCount = count;
+        part2.mRaw = mBuffers;
+        part2.mNonContig = part1.mNonContig - count;
+        mUnreleased += count;
+    }
+    batch->mFrameCount = part1.mFrameCount + part2.mFrameCount;
+    return status;
+}
+
+void ClientProxy::releaseBatch(Batch* batch)
+{
+    LOG_ALWAYS_FATAL_IF(batch == NULL);
+    // one store-release of mRear (or mFront) for all the frames of the batch
+    Buffer buffer;
+    buffer.mFrameCount = batch->mFrameCount;
+    buffer.mRaw = batch->mParts[0].mRaw;
+    buffer.mNonContig = 0;
+    releaseBuffer(&buffer);
+    for (size_t i = 0; i < 2; i++) {
+        batch->mParts[i].mFrameCount = 0;
+        batch->mParts[i].mRaw = NULL;
+        batch->mParts[i].mNonContig = 0;
+    }
+    batch->mFrameCount = 0;
+}
+
 void ClientProxy::binderDied()
 {
     audio_track_cblk_t* cblk = mCblk;
@@ -434,10 +483,15 @@ status_t AudioTrackClientProxy::waitStreamEndDone(const struct timespec *request
             break;
         }
         int32_t old = android_atomic_and(~CBLK_FUTEX_WAKE, &cblk->mFutex);
+        if (!(old & CBLK_FUTEX_WAKE)) {
+            old = android_atomic_or(CBLK_FUTEX_WAITING, &cblk->mFutex);
+        }
         if (!(old & CBLK_FUTEX_WAKE)) {
             int rc;
             int ret = __futex_syscall4(&cblk->mFutex,
-                    mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, old & ~CBLK_FUTEX_WAKE, ts);
+                    mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, old | CBLK_FUTEX_WAITING,
+                    ts);
+            android_atomic_and(~CBLK_FUTEX_WAITING, &cblk->mFutex);
             switch (ret) {
             case 0:             // normal wakeup by server, or by binderDied()
             case -EWOULDBLOCK:  // benign race condition with server
@@ -529,7 +583,7 @@ status_t ServerProxy::obtainBuffer(Buffer* buffer, bool ackFlush)
             android_atomic_release_store(rear, &cblk->u.mStreaming.mFront);
             if (front != rear) {
                 int32_t old = android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
-                if (!(old & CBLK_FUTEX_WAKE)) {
+                if (!(old & CBLK_FUTEX_WAKE) && (old & CBLK_FUTEX_WAITING)) {
                     (void) __futex_syscall3(&cblk->mFutex,
                             mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, 1);
                 }
@@ -629,10 +683,12 @@ void ServerProxy::releaseBuffer(Buffer* buffer)
         minimum = half;
     }
     // FIXME AudioRecord wakeup needs to be optimized; it currently wakes up client every time
+    // Unless the client is blocked, posting the wake is enough and there is no need for a syscall;
+    // this is the usual case for a client that obtains in batches, see ClientProxy::obtainBatch().
     if (!mIsOut || (mAvailToClient + stepCount >= minimum)) {
         ALOGV("mAvailToClient=%u stepCount=%u minimum=%u", mAvailToClient, stepCount, minimum);
         int32_t old = android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
-        if (!(old & CBLK_FUTEX_WAKE)) {
+        if (!(old & CBLK_FUTEX_WAKE) && (old & CBLK_FUTEX_WAITING)) {
             (void) __futex_syscall3(&cblk->mFutex,
                     mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, 1);
         }
@@ -74,6 +74,7 @@ enum {
     GET_PRIMARY_OUTPUT_SAMPLING_RATE,
     GET_PRIMARY_OUTPUT_FRAME_COUNT,
     SET_LOW_RAM_DEVICE,
+    GET_FAST_MIXER_TIMINGS,
 };
 
 class BpAudioFlinger : public BpInterface<IAudioFlinger>
@@ -738,6 +739,38 @@ public:
         return reply.readInt32();
     }
 
+    virtual status_t getFastMixerTimings(audio_io_handle_t output, uint32_t *cursor,
+                                    Vector<FastMixerCycleTiming> *timings)
+    {
+        if (cursor == NULL || timings == NULL) {
+            return BAD_VALUE;
+        }
+        Parcel data, reply;
+        data.writeInterfaceToken(IAudioFlinger::getInterfaceDescriptor());
+        data.writeInt32((int32_t) output);
+        data.writeInt32(*cursor);
+        status_t status = remote()->transact(GET_FAST_MIXER_TIMINGS, data, &reply);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        status = reply.readInt32();
+        if (status != NO_ERROR) {
+            return status;
+        }
+        *cursor = reply.readInt32();
+        size_t count = reply.readInt32();
+        timings->clear();
+        timings->setCapacity(count);
+        for (size_t i = 0; i < count; i++) {
+            FastMixerCycleTiming timing;
+            if (reply.read(&timing, sizeof(timing)) != NO_ERROR) {
+                break;
+            }
+            timings->add(timing);
+        }
+        return NO_ERROR;
+    }
+
 };
 
 IMPLEMENT_META_INTERFACE(AudioFlinger, "android.media.IAudioFlinger");
@@ -1128,6 +1161,22 @@ status_t BnAudioFlinger::onTransact(
             reply->writeInt32(setLowRamDevice(isLowRamDevice));
             return NO_ERROR;
         } break;
+        case GET_FAST_MIXER_TIMINGS: {
+            CHECK_INTERFACE(IAudioFlinger, data, reply);
+            audio_io_handle_t output = (audio_io_handle_t) data.readInt32();
+            uint32_t cursor = data.readInt32();
+            Vector<FastMixerCycleTiming> timings;
+            status_t status = getFastMixerTimings(output, &cursor, &timings);
+            reply->writeInt32(status);
+            if (status == NO_ERROR) {
+                reply->writeInt32(cursor);
+                reply->writeInt32(timings.size());
+                for (size_t i = 0; i < timings.size(); i++) {
+                    reply->write(&timings[i], sizeof(FastMixerCycleTiming));
+                }
+            }
+            return NO_ERROR;
+        } break;
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -17,6 +17,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "ICrypto"
 #include <utils/Log.h>
+#include <sys/mman.h>
 
 #include <binder/Parcel.h>
 #include <media/ICrypto.h>
@@ -33,8 +34,50 @@ enum {
     DESTROY_PLUGIN,
     REQUIRES_SECURE_COMPONENT,
     DECRYPT,
+    DECRYPT_BATCH,
 };
 
+ICrypto::DecryptUnit::DecryptUnit()
+    : mMode(CryptoPlugin::kMode_Unencrypted),
+      mSrcPtr(NULL),
+      mSubSamples(NULL),
+      mNumSubSamples(0),
+      mDstPtr(NULL),
+      mDstOffset(0),
+      mResult(0) {
+    memset(mKey, 0, sizeof(mKey));
+    memset(mIV, 0, sizeof(mIV));
+}
+
+static size_t totalSizeOfSubSamples(
+        const CryptoPlugin::SubSample *subSamples, size_t numSubSamples) {
+    size_t totalSize = 0;
+    for (size_t i = 0; i < numSubSamples; ++i) {
+        totalSize += subSamples[i].mNumBytesOfEncryptedData;
+        totalSize += subSamples[i].mNumBytesOfClearData;
+    }
+    return totalSize;
+}
+
+// Returns true if the subsamples describe exactly totalSize bytes.
+static bool subSamplesMatchSize(
+        const CryptoPlugin::SubSample *subSamples, size_t numSubSamples,
+        size_t totalSize) {
+    size_t size = 0;
+    for (size_t i = 0; i < numSubSamples; ++i) {
+        const CryptoPlugin::SubSample &subSample = subSamples[i];
+        if (subSample.mNumBytesOfClearData > totalSize - size) {
+            return false;
+        }
+        size += subSample.mNumBytesOfClearData;
+        if (subSample.mNumBytesOfEncryptedData > totalSize - size) {
+            return false;
+        }
+        size += subSample.mNumBytesOfEncryptedData;
+    }
+    return size == totalSize;
+}
+
 struct BpCrypto : public BpInterface<ICrypto> {
     BpCrypto(const sp<IBinder> &impl)
         : BpInterface<ICrypto>(impl) {
@@ -118,11 +161,7 @@ struct BpCrypto : public BpInterface<ICrypto> {
         data.write(key, 16);
         data.write(iv, 16);
 
-        size_t totalSize = 0;
-        for (size_t i = 0; i < numSubSamples; ++i) {
-            totalSize += subSamples[i].mNumBytesOfEncryptedData;
-            totalSize += subSamples[i].mNumBytesOfClearData;
-        }
+        size_t totalSize = totalSizeOfSubSamples(subSamples, numSubSamples);
 
         data.writeInt32(totalSize);
         data.write(srcPtr, totalSize);
@@ -149,6 +188,72 @@ struct BpCrypto : public BpInterface<ICrypto> {
         return result;
     }
 
+    virtual status_t decryptBatch(
+            bool secure,
+            DecryptUnit *units, size_t numUnits,
+            AString *errorDetailMsg) {
+        Parcel data, reply;
+        data.writeInterfaceToken(ICrypto::getInterfaceDescriptor());
+        data.writeInt32(secure);
+        data.writeInt32(numUnits);
+
+        for (size_t i = 0; i < numUnits; ++i) {
+            const DecryptUnit &unit = units[i];
+
+            data.writeInt32(unit.mMode);
+            data.write(unit.mKey, 16);
+            data.write(unit.mIV, 16);
+
+            size_t totalSize =
+                totalSizeOfSubSamples(unit.mSubSamples, unit.mNumSubSamples);
+
+            data.writeInt32(totalSize);
+            data.write(unit.mSrcPtr, totalSize);
+
+            data.writeInt32(unit.mNumSubSamples);
+            data.write(
+                    unit.mSubSamples,
+                    sizeof(CryptoPlugin::SubSample) * unit.mNumSubSamples);
+
+            if (secure) {
+                data.writeIntPtr((intptr_t)unit.mDstPtr);
+            } else if (unit.mDstHeap != NULL) {
+                data.writeInt32(1);
+                data.writeStrongBinder(unit.mDstHeap->asBinder());
+                data.writeInt32(unit.mDstOffset);
+            } else {
+                data.writeInt32(0);
+            }
+        }
+
+        status_t err = remote()->transact(DECRYPT_BATCH, data, &reply);
+
+        if (err != OK) {
+            for (size_t i = 0; i < numUnits; ++i) {
+                units[i].mResult = err;
+            }
+            return err;
+        }
+
+        status_t result = reply.readInt32();
+
+        if (result >= ERROR_DRM_VENDOR_MIN && result <= ERROR_DRM_VENDOR_MAX) {
+            errorDetailMsg->setTo(reply.readCString());
+        }
+
+        for (size_t i = 0; i < numUnits; ++i) {
+            DecryptUnit *unit = &units[i];
+            unit->mResult = reply.readInt32();
+
+            // Data written to shared memory does not need to be copied.
+            if (!secure && unit->mDstHeap == NULL && unit->mResult >= 0) {
+                reply.read(unit->mDstPtr, unit->mResult);
+            }
+        }
+
+        return result;
+    }
+
 private:
     DISALLOW_EVIL_CONSTRUCTORS(BpCrypto);
 };
@@ -290,6 +395,125 @@ status_t BnCrypto::onTransact(
             return OK;
         }
 
+        case DECRYPT_BATCH:
+        {
+            CHECK_INTERFACE(ICrypto, data, reply);
+
+            bool secure = data.readInt32() != 0;
+            size_t numUnits = data.readInt32();
+
+            // Every unit takes more than its keys, so this also bounds the
+            // allocation below.
+            if (numUnits > data.dataAvail() / 32) {
+                return BAD_VALUE;
+            }
+
+            DecryptUnit *units = new DecryptUnit[numUnits];
+            Vector<size_t> totalSizes;
+            status_t err = OK;
+
+            for (size_t i = 0; i < numUnits && err == OK; ++i) {
+                DecryptUnit *unit = &units[i];
+
+                unit->mMode = (CryptoPlugin::Mode)data.readInt32();
+                data.read(unit->mKey, sizeof(unit->mKey));
+                data.read(unit->mIV, sizeof(unit->mIV));
+
+                // Source data and subsamples are used in place, without
+                // copying them out of the parcel.
+                size_t totalSize = data.readInt32();
+                unit->mSrcPtr = data.readInplace(totalSize);
+
+                totalSizes.push(totalSize);
+
+                unit->mNumSubSamples = data.readInt32();
+                if (unit->mNumSubSamples
+                        > SIZE_MAX / sizeof(CryptoPlugin::SubSample)) {
+                    err = BAD_VALUE;
+                    break;
+                }
+                unit->mSubSamples =
+                    (const CryptoPlugin::SubSample *)data.readInplace(
+                            sizeof(CryptoPlugin::SubSample)
+                                * unit->mNumSubSamples);
+
+                if ((totalSize > 0 && unit->mSrcPtr == NULL)
+                        || (unit->mNumSubSamples > 0
+                                && unit->mSubSamples == NULL)) {
+                    err = BAD_VALUE;
+                    break;
+                }
+
+                // The plugin reads and writes as many bytes as the
+                // subsamples describe, the buffers are totalSize bytes.
+                if (!subSamplesMatchSize(
+                            unit->mSubSamples, unit->mNumSubSamples,
+                            totalSize)) {
+                    err = BAD_VALUE;
+                    break;
+                }
+
+                if (secure) {
+                    unit->mDstPtr = (void *)data.readIntPtr();
+                } else if (data.readInt32() != 0) {
+                    unit->mDstHeap =
+                        interface_cast<IMemoryHeap>(data.readStrongBinder());
+                    unit->mDstOffset = data.readInt32();
+
+                    void *base = (unit->mDstHeap != NULL)
+                        ? unit->mDstHeap->getBase() : MAP_FAILED;
+
+                    if (base == MAP_FAILED
+                            || unit->mDstOffset > unit->mDstHeap->getSize()
+                            || totalSize > unit->mDstHeap->getSize()
+                                    - unit->mDstOffset) {
+                        unit->mDstHeap.clear();
+                        err = BAD_VALUE;
+                        break;
+                    }
+
+                    unit->mDstPtr = (uint8_t *)base + unit->mDstOffset;
+                } else {
+                    unit->mDstPtr = malloc(totalSize);
+                }
+            }
+
+            AString errorDetailMsg;
+            if (err == OK) {
+                err = decryptBatch(secure, units, numUnits, &errorDetailMsg);
+            } else {
+                for (size_t i = 0; i < numUnits; ++i) {
+                    units[i].mResult = err;
+                }
+            }
+
+            reply->writeInt32(err);
+
+            if (err >= ERROR_DRM_VENDOR_MIN && err <= ERROR_DRM_VENDOR_MAX) {
+                reply->writeCString(errorDetailMsg.c_str());
+            }
+
+            for (size_t i = 0; i < numUnits; ++i) {
+                DecryptUnit *unit = &units[i];
+                reply->writeInt32(unit->mResult);
+
+                if (!secure && unit->mDstHeap == NULL) {
+                    if (unit->mResult >= 0) {
+                        CHECK_LE(unit->mResult,
+                                 static_cast<ssize_t>(totalSizes[i]));
+                        reply->write(unit->mDstPtr, unit->mResult);
+                    }
+                    free(unit->mDstPtr);
+                    unit->mDstPtr = NULL;
+                }
+            }
+
+            delete[] units;
+            units = NULL;
+
+            return OK;
+        }
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -49,6 +49,7 @@ enum {
     PULL_BATTERY_DATA,
     LISTEN_FOR_REMOTE_DISPLAY,
     UPDATE_PROXY_CONFIG,
+    DECODE_FD_CACHED,
 };
 
 class BpMediaPlayerService: public BpInterface<IMediaPlayerService>
@@ -130,6 +131,31 @@ public:
         return status;
     }
 
+    virtual status_t decodeCached(int fd, int64_t offset, int64_t length,
+                               uint32_t *pSampleRate, int* pNumChannels,
+                               audio_format_t* pFormat, sp<IMemory>* pMem)
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(IMediaPlayerService::getInterfaceDescriptor());
+        data.writeFileDescriptor(fd);
+        data.writeInt64(offset);
+        data.writeInt64(length);
+        status_t status = remote()->transact(DECODE_FD_CACHED, data, &reply);
+        if (status == NO_ERROR) {
+            status = (status_t)reply.readInt32();
+            if (status == NO_ERROR) {
+                *pSampleRate = uint32_t(reply.readInt32());
+                *pNumChannels = reply.readInt32();
+                *pFormat = (audio_format_t)reply.readInt32();
+                *pMem = interface_cast<IMemory>(reply.readStrongBinder());
+                if (*pMem == 0) {
+                    status = UNKNOWN_ERROR;
+                }
+            }
+        }
+        return status;
+    }
+
     virtual sp<IOMX> getOMX() {
         Parcel data, reply;
         data.writeInterfaceToken(IMediaPlayerService::getInterfaceDescriptor());
@@ -259,6 +285,26 @@ status_t BnMediaPlayerService::onTransact(
             }
             return NO_ERROR;
         } break;
+        case DECODE_FD_CACHED: {
+            CHECK_INTERFACE(IMediaPlayerService, data, reply);
+            int fd = dup(data.readFileDescriptor());
+            int64_t offset = data.readInt64();
+            int64_t length = data.readInt64();
+            uint32_t sampleRate;
+            int numChannels;
+            audio_format_t format;
+            sp<IMemory> mem;
+            status_t status = decodeCached(fd, offset, length, &sampleRate, &numChannels,
+                                           &format, &mem);
+            reply->writeInt32(status);
+            if (status == NO_ERROR) {
+                reply->writeInt32(sampleRate);
+                reply->writeInt32(numChannels);
+                reply->writeInt32((int32_t)format);
+                reply->writeStrongBinder(mem->asBinder());
+            }
+            return NO_ERROR;
+        } break;
         case CREATE_MEDIA_RECORDER: {
             CHECK_INTERFACE(IMediaPlayerService, data, reply);
             sp<IMediaRecorder> recorder = createMediaRecorder();
@@ -54,6 +54,8 @@ enum {
     GET_GRAPHIC_BUFFER_USAGE,
     SET_INTERNAL_OPTION,
     UPDATE_GRAPHIC_BUFFER_IN_META,
+    SUBMIT_BUFFERS,
+    OBSERVER_ON_MSGS,
 };
 
 class BpOMX : public BpInterface<IOMX> {
@@ -453,6 +455,26 @@ public:
         return reply.readInt32();
     }
 
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferRequest> &requests) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IOMX::getInterfaceDescriptor());
+        data.writeIntPtr((intptr_t)node);
+        data.writeInt32(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const BufferRequest &request = requests[i];
+            data.writeIntPtr((intptr_t)request.mBuffer);
+            data.writeInt32(request.mIsEmpty);
+            data.writeInt32(request.mRangeOffset);
+            data.writeInt32(request.mRangeLength);
+            data.writeInt32(request.mFlags);
+            data.writeInt64(request.mTimestamp);
+        }
+        remote()->transact(SUBMIT_BUFFERS, data, &reply);
+
+        return reply.readInt32();
+    }
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -890,6 +912,35 @@ status_t BnOMX::onTransact(
             return NO_ERROR;
         }
 
+        case SUBMIT_BUFFERS:
+        {
+            CHECK_OMX_INTERFACE(IOMX, data, reply);
+
+            node_id node = (void*)data.readIntPtr();
+            int32_t count = data.readInt32();
+            if (count < 0 || (size_t)count > data.dataAvail()) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+
+            Vector<BufferRequest> requests;
+            requests.setCapacity(count);
+            for (int32_t i = 0; i < count; ++i) {
+                BufferRequest request;
+                request.mBuffer = (void*)data.readIntPtr();
+                request.mIsEmpty = data.readInt32() != 0;
+                request.mRangeOffset = data.readInt32();
+                request.mRangeLength = data.readInt32();
+                request.mFlags = data.readInt32();
+                request.mTimestamp = data.readInt64();
+                requests.push(request);
+            }
+
+            reply->writeInt32(submitBuffers(node, requests));
+
+            return NO_ERROR;
+        }
+
         case GET_EXTENSION_INDEX:
         {
             CHECK_OMX_INTERFACE(IOMX, data, reply);
@@ -929,10 +980,29 @@ public:
 
         remote()->transact(OBSERVER_ON_MSG, data, &reply, IBinder::FLAG_ONEWAY);
     }
+
+    virtual void onMessages(const List<omx_message> &messages) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IOMXObserver::getInterfaceDescriptor());
+        data.writeInt32(messages.size());
+        for (List<omx_message>::const_iterator it = messages.begin();
+                it != messages.end(); ++it) {
+            data.write(&*it, sizeof(omx_message));
+        }
+
+        remote()->transact(OBSERVER_ON_MSGS, data, &reply, IBinder::FLAG_ONEWAY);
+    }
 };
 
 IMPLEMENT_META_INTERFACE(OMXObserver, "android.hardware.IOMXObserver");
 
+void IOMXObserver::onMessages(const List<omx_message> &messages) {
+    for (List<omx_message>::const_iterator it = messages.begin();
+            it != messages.end(); ++it) {
+        onMessage(*it);
+    }
+}
+
 status_t BnOMXObserver::onTransact(
     uint32_t code, const Parcel &data, Parcel *reply, uint32_t flags) {
     switch (code) {
@@ -949,6 +1019,28 @@ status_t BnOMXObserver::onTransact(
             return NO_ERROR;
         }
 
+        case OBSERVER_ON_MSGS:
+        {
+            CHECK_OMX_INTERFACE(IOMXObserver, data, reply);
+
+            int32_t count = data.readInt32();
+            if (count < 0
+                    || (size_t)count > data.dataAvail() / sizeof(omx_message)) {
+                return BAD_VALUE;
+            }
+
+            List<omx_message> messages;
+            for (int32_t i = 0; i < count; ++i) {
+                omx_message msg;
+                data.read(&msg, sizeof(msg));
+                messages.push_back(msg);
+            }
+
+            onMessages(messages);
+
+            return NO_ERROR;
+        }
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
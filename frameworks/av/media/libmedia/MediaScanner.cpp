@@ -27,7 +27,7 @@
 namespace android {
 
 MediaScanner::MediaScanner()
-    : mLocale(NULL), mSkipList(NULL), mSkipIndex(NULL) {
+    : mLocale(NULL), mSkipList(NULL), mSkipIndex(NULL), mPrefetchEnabled(false) {
     loadSkipList();
 }
 
@@ -51,6 +51,15 @@ const char *MediaScanner::locale() const {
     return mLocale;
 }
 
+void MediaScanner::setPrefetchEnabled(bool enabled) {
+    mPrefetchEnabled = enabled;
+}
+
+void MediaScanner::prefetchFile(
+        const char * /* path */, long long /* lastModified */,
+        long long /* fileSize */) {
+}
+
 void MediaScanner::loadSkipList() {
     mSkipList = (char *)malloc(PROPERTY_VALUE_MAX * sizeof(char));
     if (mSkipList) {
@@ -151,6 +160,10 @@ MediaScanResult MediaScanner::doProcessDirectory(
         fileSpot[0] = 0;
     }
 
+    if (mPrefetchEnabled && !noMedia) {
+        prefetchDirectory(path, pathRemaining, fileSpot);
+    }
+
     DIR* dir = opendir(path);
     if (!dir) {
         ALOGW("Error opening directory '%s', skipping: %s.", path, strerror(errno));
@@ -169,6 +182,39 @@ MediaScanResult MediaScanner::doProcessDirectory(
     return result;
 }
 
+void MediaScanner::prefetchDirectory(
+        char *path, int pathRemaining, char *fileSpot) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        const char* name = entry->d_name;
+
+        // skip ".", ".." and hidden files, and anything that is not a file
+        if (name[0] == '.'
+                || (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)) {
+            continue;
+        }
+
+        if ((int)strlen(name) + 1 > pathRemaining) {
+            continue;
+        }
+        strcpy(fileSpot, name);
+
+        struct stat statbuf;
+        if (stat(path, &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+            prefetchFile(path, statbuf.st_mtime, statbuf.st_size);
+        }
+    }
+    closedir(dir);
+
+    // restore path
+    fileSpot[0] = 0;
+}
+
 MediaScanResult MediaScanner::doProcessDirectoryEntry(
         char *path, int pathRemaining, MediaScannerClient &client, bool noMedia,
         struct dirent* entry, char* fileSpot) {
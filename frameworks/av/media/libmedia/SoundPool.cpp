@@ -258,7 +258,7 @@ int SoundPool::play(int sampleID, float leftVolume, float rightVolume,
     dump();
 
     // allocate a channel
-    channel = allocateChannel_l(priority);
+    channel = allocateChannel_l(priority, sample);
 
     // no channel allocated - return 0
     if (!channel) {
@@ -273,13 +273,26 @@ int SoundPool::play(int sampleID, float leftVolume, float rightVolume,
     return channelID;
 }
 
-SoundChannel* SoundPool::allocateChannel_l(int priority)
+SoundChannel* SoundPool::allocateChannel_l(int priority, const sp<Sample>& sample)
 {
     List<SoundChannel*>::iterator iter;
     SoundChannel* channel = NULL;
 
+    // prefer an idle channel whose track already plays this sample
+    for (iter = mChannels.begin(); iter != mChannels.end(); ++iter) {
+        if ((*iter)->priority() != IDLE_PRIORITY) {
+            break;
+        }
+        if ((*iter)->hasTrackFor(sample)) {
+            channel = *iter;
+            mChannels.erase(iter);
+            ALOGV("Allocated idle channel with matching track");
+            break;
+        }
+    }
+
     // allocate a channel
-    if (!mChannels.empty()) {
+    if (!channel && !mChannels.empty()) {
         iter = mChannels.begin();
         if (priority >= (*iter)->priority()) {
             channel = *iter;
@@ -492,14 +505,23 @@ status_t Sample::doLoad()
     int numChannels;
     audio_format_t format;
     status_t status;
-    mHeap = new MemoryHeapBase(kDefaultHeapSize);
+    sp<IMemory> data;
 
     ALOGV("Start decode");
     if (mUrl) {
+        mHeap = new MemoryHeapBase(kDefaultHeapSize);
         status = MediaPlayer::decode(mUrl, &sampleRate, &numChannels, &format, mHeap, &mSize);
+        if (status == NO_ERROR) {
+            data = new MemoryBase(mHeap, 0, mSize);
+        }
     } else {
-        status = MediaPlayer::decode(mFd, mOffset, mLength, &sampleRate, &numChannels, &format,
-                                     mHeap, &mSize);
+        // The media server keeps the decoded content, and shares it with every
+        // process loading the same asset.
+        status = MediaPlayer::decodeCached(mFd, mOffset, mLength, &sampleRate, &numChannels,
+                                           &format, &data);
+        if (status == NO_ERROR) {
+            mSize = data->size();
+        }
         ALOGV("close(%d)", mFd);
         ::close(mFd);
         mFd = -1;
@@ -509,7 +531,7 @@ status_t Sample::doLoad()
         goto error;
     }
     ALOGV("pointer = %p, size = %u, sampleRate = %u, numChannels = %d",
-          mHeap->getBase(), mSize, sampleRate, numChannels);
+          data->pointer(), mSize, sampleRate, numChannels);
 
     if (sampleRate > kMaxSampleRate) {
        ALOGE("Sample rate (%u) out of range", sampleRate);
@@ -523,7 +545,7 @@ status_t Sample::doLoad()
         goto error;
     }
 
-    mData = new MemoryBase(mHeap, 0, mSize);
+    mData = data;
     mSampleRate = sampleRate;
     mNumChannels = numChannels;
     mFormat = format;
@@ -547,7 +569,7 @@ void SoundChannel::play(const sp<Sample>& sample, int nextChannelID, float leftV
 {
     sp<AudioTrack> oldTrack;
     sp<AudioTrack> newTrack;
-    status_t status;
+    status_t status = NO_ERROR;
 
     { // scope for the lock
         Mutex::Autolock lock(&mLock);
@@ -598,25 +620,36 @@ void SoundChannel::play(const sp<Sample>& sample, int nextChannelID, float leftV
         // as callback user data. This enables the detection of callbacks received from the old
         // audio track while the new one is being started and avoids processing them with
         // wrong audio audio buffer size  (mAudioBufferSize)
-        unsigned long toggle = mToggle ^ 1;
-        void *userData = (void *)((unsigned long)this | toggle);
-        uint32_t channels = (numChannels == 2) ?
-                AUDIO_CHANNEL_OUT_STEREO : AUDIO_CHANNEL_OUT_MONO;
+        unsigned long toggle = mToggle;
 
         // do not create a new audio track if current track is compatible with sample parameters
+        if (reuseTrack_l(sample, sampleRate, frameCount)) {
+            ALOGV("reuse track %p", mAudioTrack.get());
+            newTrack = mAudioTrack;
+        } else {
+            toggle ^= 1;
+            void *userData = (void *)((unsigned long)this | toggle);
+            uint32_t channels = (numChannels == 2) ?
+                    AUDIO_CHANNEL_OUT_STEREO : AUDIO_CHANNEL_OUT_MONO;
+
+            // The fast mixer does not resample, AudioFlinger denies fast tracks at other rates
+            audio_output_flags_t flags = (sampleRate == afSampleRate) ?
+                    AUDIO_OUTPUT_FLAG_FAST : AUDIO_OUTPUT_FLAG_NONE;
+
 #ifdef USE_SHARED_MEM_BUFFER
-        newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
-                channels, sample->getIMemory(), AUDIO_OUTPUT_FLAG_FAST, callback, userData);
+            newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
+                    channels, sample->getIMemory(), flags, callback, userData);
 #else
-        newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
-                channels, frameCount, AUDIO_OUTPUT_FLAG_FAST, callback, userData,
-                bufferFrames);
+            newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
+                    channels, frameCount, flags, callback, userData,
+                    bufferFrames);
 #endif
-        oldTrack = mAudioTrack;
-        status = newTrack->initCheck();
-        if (status != NO_ERROR) {
-            ALOGE("Error creating AudioTrack");
-            goto exit;
+            oldTrack = mAudioTrack;
+            status = newTrack->initCheck();
+            if (status != NO_ERROR) {
+                ALOGE("Error creating AudioTrack");
+                goto exit;
+            }
         }
         ALOGV("setVolume %p", newTrack.get());
         newTrack->setVolume(leftVolume, rightVolume);
@@ -647,6 +680,57 @@ exit:
     }
 }
 
+bool SoundChannel::hasTrackFor(const sp<Sample>& sample)
+{
+    Mutex::Autolock lock(&mLock);
+    if (mState != IDLE || mAudioTrack == 0) {
+        return false;
+    }
+#ifdef USE_SHARED_MEM_BUFFER
+    return mAudioTrack->sharedBuffer() == sample->getIMemory();
+#else
+    return mAudioTrack->format() == sample->format() &&
+            (int)mAudioTrack->channelCount() == sample->numChannels();
+#endif
+}
+
+// call with lock held
+bool SoundChannel::reuseTrack_l(const sp<Sample>& sample, uint32_t sampleRate,
+        uint32_t frameCount)
+{
+    if (mAudioTrack == 0 || mState != IDLE) {
+        return false;
+    }
+
+#ifdef USE_SHARED_MEM_BUFFER
+    // A static track plays a single buffer
+    if (mAudioTrack->sharedBuffer() != sample->getIMemory()) {
+        return false;
+    }
+#else
+    if (mAudioTrack->format() != sample->format() ||
+            (int)mAudioTrack->channelCount() != sample->numChannels() ||
+            mAudioTrack->frameCount() != frameCount) {
+        return false;
+    }
+#endif
+
+    // Fast tracks play at the output rate only
+    if (mAudioTrack->getSampleRate() != sampleRate) {
+        if ((mAudioTrack->getFlags() & AUDIO_OUTPUT_FLAG_FAST) ||
+                mAudioTrack->setSampleRate(sampleRate) != NO_ERROR) {
+            return false;
+        }
+    }
+
+#ifdef USE_SHARED_MEM_BUFFER
+    return mAudioTrack->reload() == NO_ERROR;
+#else
+    mAudioTrack->flush();
+    return true;
+#endif
+}
+
 void SoundChannel::nextEvent()
 {
     sp<Sample> sample;
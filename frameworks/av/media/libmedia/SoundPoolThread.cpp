@@ -18,6 +18,8 @@
 #define LOG_TAG "SoundPoolThread"
 #include "utils/Log.h"
 
+#include <unistd.h>
+
 #include "SoundPoolThread.h"
 
 namespace android {
@@ -31,7 +33,7 @@ void SoundPoolThread::write(SoundPoolMsg msg) {
     // if thread is quitting, don't add to queue
     if (mRunning) {
         mMsgQueue.push(msg);
-        mCondition.signal();
+        mCondition.broadcast();
     }
 }
 
@@ -42,7 +44,7 @@ const SoundPoolMsg SoundPoolThread::read() {
     }
     SoundPoolMsg msg = mMsgQueue[0];
     mMsgQueue.removeAt(0);
-    mCondition.signal();
+    mCondition.broadcast();
     return msg;
 }
 
@@ -51,20 +53,34 @@ void SoundPoolThread::quit() {
     if (mRunning) {
         mRunning = false;
         mMsgQueue.clear();
-        mMsgQueue.push(SoundPoolMsg(SoundPoolMsg::KILL, 0));
-        mCondition.signal();
-        mCondition.wait(mLock);
+        for (int i = 0; i < mThreadCount; i++) {
+            mMsgQueue.push(SoundPoolMsg(SoundPoolMsg::KILL, 0));
+        }
+        mCondition.broadcast();
+        while (mThreadCount > 0) {
+            mCondition.wait(mLock);
+        }
     }
     ALOGV("return from quit");
 }
 
 SoundPoolThread::SoundPoolThread(SoundPool* soundPool) :
-    mSoundPool(soundPool)
+    mSoundPool(soundPool), mRunning(false), mThreadCount(0)
 {
     mMsgQueue.setCapacity(maxMessages);
-    if (createThreadEtc(beginThread, this, "SoundPoolThread")) {
-        mRunning = true;
+
+    // samples are decoded in parallel, each load is independent
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (cpus < 1) ? 1 : (cpus > maxThreads ? maxThreads : cpus);
+
+    Mutex::Autolock lock(&mLock);
+    for (int i = 0; i < threads; i++) {
+        if (!createThreadEtc(beginThread, this, "SoundPoolThread")) {
+            break;
+        }
+        mThreadCount++;
     }
+    mRunning = mThreadCount > 0;
 }
 
 SoundPoolThread::~SoundPoolThread()
@@ -84,9 +100,13 @@ int SoundPoolThread::run() {
         SoundPoolMsg msg = read();
         ALOGV("Got message m=%d, mData=%d", msg.mMessageType, msg.mData);
         switch (msg.mMessageType) {
-        case SoundPoolMsg::KILL:
+        case SoundPoolMsg::KILL: {
             ALOGV("goodbye");
+            Mutex::Autolock lock(&mLock);
+            mThreadCount--;
+            mCondition.broadcast();
             return NO_ERROR;
+        }
         case SoundPoolMsg::LOAD_SAMPLE:
             doLoadSample(msg.mData);
             break;
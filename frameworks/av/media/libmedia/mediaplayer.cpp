@@ -818,6 +818,23 @@ void MediaPlayer::died()
 
 }
 
+/*static*/ status_t MediaPlayer::decodeCached(int fd, int64_t offset, int64_t length,
+                                              uint32_t *pSampleRate, int* pNumChannels,
+                                              audio_format_t* pFormat, sp<IMemory>* pMem)
+{
+    ALOGV("decodeCached(%d, %lld, %lld)", fd, offset, length);
+    status_t status;
+    const sp<IMediaPlayerService>& service = getMediaPlayerService();
+    if (service != 0) {
+        status = service->decodeCached(fd, offset, length, pSampleRate,
+                                       pNumChannels, pFormat, pMem);
+    } else {
+        ALOGE("Unable to locate media service");
+        status = DEAD_OBJECT;
+    }
+    return status;
+}
+
 status_t MediaPlayer::setNextMediaPlayer(const sp<MediaPlayer>& next) {
     if (mPlayer == NULL) {
         return NO_INIT;
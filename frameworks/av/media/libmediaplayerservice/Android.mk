@@ -9,6 +9,7 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES:=               \
     ActivityManager.cpp         \
     Crypto.cpp                  \
+    DecodedSampleCache.cpp      \
     Drm.cpp                     \
     HDCP.cpp                    \
     MediaPlayerFactory.cpp      \
@@ -26,11 +27,13 @@ LOCAL_SRC_FILES:=               \
 LOCAL_SHARED_LIBRARIES :=       \
     libbinder                   \
     libcamera_client            \
+    libcrypto                   \
     libcutils                   \
     liblog                      \
     libdl                       \
     libgui                      \
     libmedia                    \
+    libnbaio                    \
     libsonivox                  \
     libstagefright              \
     libstagefright_foundation   \
@@ -51,6 +54,7 @@ LOCAL_C_INCLUDES :=                                                 \
     $(TOP)/frameworks/av/media/libstagefright/wifi-display          \
     $(TOP)/frameworks/native/include/media/openmax                  \
     $(TOP)/external/tremolo/Tremolo                                 \
+    $(TOP)/external/openssl/include                                 \
 
 LOCAL_MODULE:= libmediaplayerservice
 
@@ -24,6 +24,7 @@
 
 #include <media/hardware/CryptoAPI.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/MediaErrors.h>
@@ -33,6 +34,8 @@ namespace android {
 KeyedVector<Vector<uint8_t>, String8> Crypto::mUUIDToLibraryPathMap;
 KeyedVector<String8, wp<SharedLibrary> > Crypto::mLibraryPathToOpenLibraryMap;
 Mutex Crypto::mMapLock;
+Crypto::Stats Crypto::mStats;
+Mutex Crypto::mStatsLock;
 
 static bool operator<(const Vector<uint8_t> &lhs, const Vector<uint8_t> &rhs) {
     if (lhs.size() < rhs.size()) {
@@ -252,9 +255,193 @@ ssize_t Crypto::decrypt(
         return -EINVAL;
     }
 
-    return mPlugin->decrypt(
+    int64_t pluginTimeUs;
+    ssize_t result = decrypt_l(
+            secure, key, iv, mode, srcPtr, subSamples, numSubSamples, dstPtr,
+            errorDetailMsg, &pluginTimeUs);
+
+    recordDecrypt(1, result > 0 ? result : 0, pluginTimeUs, pluginTimeUs);
+
+    return result;
+}
+
+// Checks that the subsamples of a unit add up without overflowing, and that
+// the decrypted data fits into the shared memory it is written to.
+static bool isValidUnit(const ICrypto::DecryptUnit &unit) {
+    size_t totalSize = 0;
+    for (size_t i = 0; i < unit.mNumSubSamples; ++i) {
+        const CryptoPlugin::SubSample &subSample = unit.mSubSamples[i];
+        if (subSample.mNumBytesOfClearData > SIZE_MAX - totalSize) {
+            return false;
+        }
+        totalSize += subSample.mNumBytesOfClearData;
+        if (subSample.mNumBytesOfEncryptedData > SIZE_MAX - totalSize) {
+            return false;
+        }
+        totalSize += subSample.mNumBytesOfEncryptedData;
+    }
+
+    if (unit.mDstHeap != NULL) {
+        size_t heapSize = unit.mDstHeap->getSize();
+        if (unit.mDstOffset > heapSize
+                || totalSize > heapSize - unit.mDstOffset) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+status_t Crypto::decryptBatch(
+        bool secure,
+        DecryptUnit *units, size_t numUnits,
+        AString *errorDetailMsg) {
+    Mutex::Autolock autoLock(mLock);
+
+    status_t err = OK;
+    if (mInitCheck != OK) {
+        err = mInitCheck;
+    } else if (mPlugin == NULL) {
+        err = -EINVAL;
+    } else {
+        for (size_t i = 0; i < numUnits; ++i) {
+            if (!isValidUnit(units[i])) {
+                err = BAD_VALUE;
+                break;
+            }
+        }
+    }
+
+    if (err != OK) {
+        for (size_t i = 0; i < numUnits; ++i) {
+            units[i].mResult = err;
+        }
+        return err;
+    }
+
+    size_t numBytes = 0;
+    int64_t totalTimeUs = 0;
+    int64_t maxTimeUs = 0;
+
+    for (size_t i = 0; i < numUnits; ++i) {
+        DecryptUnit *unit = &units[i];
+
+        if (err != OK) {
+            unit->mResult = -ECANCELED;
+            continue;
+        }
+
+        int64_t pluginTimeUs;
+        unit->mResult = decrypt_l(
+                secure, unit->mKey, unit->mIV, unit->mMode,
+                unit->mSrcPtr, unit->mSubSamples, unit->mNumSubSamples,
+                unit->mDstPtr, errorDetailMsg, &pluginTimeUs);
+
+        totalTimeUs += pluginTimeUs;
+        if (pluginTimeUs > maxTimeUs) {
+            maxTimeUs = pluginTimeUs;
+        }
+
+        if (unit->mResult < 0) {
+            err = unit->mResult;
+        } else {
+            numBytes += unit->mResult;
+        }
+
+        if (unit->mDstHeap != NULL) {
+            mLastDstHeap = unit->mDstHeap;
+        }
+    }
+
+    recordDecrypt(numUnits, numBytes, totalTimeUs, maxTimeUs);
+
+    return err;
+}
+
+ssize_t Crypto::decrypt_l(
+        bool secure,
+        const uint8_t key[16],
+        const uint8_t iv[16],
+        CryptoPlugin::Mode mode,
+        const void *srcPtr,
+        const CryptoPlugin::SubSample *subSamples, size_t numSubSamples,
+        void *dstPtr,
+        AString *errorDetailMsg,
+        int64_t *pluginTimeUs) {
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    ssize_t result = mPlugin->decrypt(
             secure, key, iv, mode, srcPtr, subSamples, numSubSamples, dstPtr,
             errorDetailMsg);
+
+    *pluginTimeUs = ALooper::GetNowUs() - startTimeUs;
+
+    return result;
+}
+
+status_t Crypto::onTransact(
+        uint32_t code, const Parcel &data, Parcel *reply, uint32_t flags) {
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    status_t err = BnCrypto::onTransact(code, data, reply, flags);
+
+    int64_t transactionTimeUs = ALooper::GetNowUs() - startTimeUs;
+
+    Mutex::Autolock autoLock(mStatsLock);
+    ++mStats.mNumTransactions;
+    mStats.mTransactionTimeUs += transactionTimeUs;
+
+    return err;
+}
+
+// static
+void Crypto::recordDecrypt(
+        size_t numUnits, size_t numBytes, int64_t pluginTimeUs,
+        int64_t maxPluginTimeUs) {
+    Mutex::Autolock autoLock(mStatsLock);
+
+    ++mStats.mNumDecryptCalls;
+    mStats.mNumUnits += numUnits;
+    mStats.mNumBytes += numBytes;
+    mStats.mPluginTimeUs += pluginTimeUs;
+    if (maxPluginTimeUs > mStats.mMaxPluginTimeUs) {
+        mStats.mMaxPluginTimeUs = maxPluginTimeUs;
+    }
+}
+
+// static
+void Crypto::dumpStats(String8 &result) {
+    Mutex::Autolock autoLock(mStatsLock);
+
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+
+    result.append(" Crypto:\n");
+
+    snprintf(buffer, SIZE,
+            "  transactions: %lld, %lld us total\n",
+            mStats.mNumTransactions, mStats.mTransactionTimeUs);
+    result.append(buffer);
+
+    snprintf(buffer, SIZE,
+            "  decrypt calls: %lld, units: %lld, bytes: %lld\n",
+            mStats.mNumDecryptCalls, mStats.mNumUnits, mStats.mNumBytes);
+    result.append(buffer);
+
+    snprintf(buffer, SIZE,
+            "  plugin time: %lld us total, %lld us max per unit\n",
+            mStats.mPluginTimeUs, mStats.mMaxPluginTimeUs);
+    result.append(buffer);
+
+    if (mStats.mNumDecryptCalls > 0) {
+        // Non decrypt transactions are rare enough to be ignored here.
+        snprintf(buffer, SIZE,
+                "  units per call: %.2f, overhead per call: %lld us\n",
+                (double)mStats.mNumUnits / mStats.mNumDecryptCalls,
+                (mStats.mTransactionTimeUs - mStats.mPluginTimeUs)
+                    / mStats.mNumDecryptCalls);
+        result.append(buffer);
+    }
 }
 
 }  // namespace android
@@ -55,7 +55,32 @@ struct Crypto : public BnCrypto {
             void *dstPtr,
             AString *errorDetailMsg);
 
+    virtual status_t decryptBatch(
+            bool secure,
+            DecryptUnit *units, size_t numUnits,
+            AString *errorDetailMsg);
+
+    virtual status_t onTransact(
+            uint32_t code, const Parcel &data, Parcel *reply,
+            uint32_t flags = 0);
+
+    // Appends the decrypt statistics of all Crypto instances.
+    static void dumpStats(String8 &result);
+
 private:
+    // Decrypt statistics, accumulated over all instances. The difference
+    // between transaction time and plugin time is the per call overhead of
+    // marshalling and copying the data.
+    struct Stats {
+        int64_t mNumTransactions;
+        int64_t mTransactionTimeUs;
+        int64_t mNumDecryptCalls;
+        int64_t mNumUnits;
+        int64_t mNumBytes;
+        int64_t mPluginTimeUs;
+        int64_t mMaxPluginTimeUs;
+    };
+
     mutable Mutex mLock;
 
     status_t mInitCheck;
@@ -63,14 +88,36 @@ private:
     CryptoFactory *mFactory;
     CryptoPlugin *mPlugin;
 
+    // The shared memory most recently decrypted into. Holding on to it keeps
+    // the heap mapped between transactions.
+    sp<IMemoryHeap> mLastDstHeap;
+
     static KeyedVector<Vector<uint8_t>, String8> mUUIDToLibraryPathMap;
     static KeyedVector<String8, wp<SharedLibrary> > mLibraryPathToOpenLibraryMap;
     static Mutex mMapLock;
 
+    static Stats mStats;
+    static Mutex mStatsLock;
+
     void findFactoryForScheme(const uint8_t uuid[16]);
     bool loadLibraryForScheme(const String8 &path, const uint8_t uuid[16]);
     void closeFactory();
 
+    ssize_t decrypt_l(
+            bool secure,
+            const uint8_t key[16],
+            const uint8_t iv[16],
+            CryptoPlugin::Mode mode,
+            const void *srcPtr,
+            const CryptoPlugin::SubSample *subSamples, size_t numSubSamples,
+            void *dstPtr,
+            AString *errorDetailMsg,
+            int64_t *pluginTimeUs);
+
+    static void recordDecrypt(
+            size_t numUnits, size_t numBytes, int64_t pluginTimeUs,
+            int64_t maxPluginTimeUs);
+
     DISALLOW_EVIL_CONSTRUCTORS(Crypto);
 };
 
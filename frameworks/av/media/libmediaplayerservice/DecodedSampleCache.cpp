@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "DecodedSampleCache"
+#include <utils/Log.h>
+
+#include "DecodedSampleCache.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <openssl/sha.h>
+
+namespace android {
+
+// Compressed assets larger than this are decoded without the cache, digesting
+// them would cost more than it saves.
+static const int64_t kMaxHashedLength = 16 * 1024 * 1024;
+
+static const size_t kHashChunkSize = 64 * 1024;
+
+bool DecodedSampleCache::Key::operator<(const Key &other) const {
+    if (mLength != other.mLength) {
+        return mLength < other.mLength;
+    }
+    return memcmp(mDigest, other.mDigest, sizeof(mDigest)) < 0;
+}
+
+DecodedSampleCache::DecodedSampleCache(size_t maxBytes)
+    : mMaxBytes(maxBytes),
+      mTotalBytes(0),
+      mUseCounter(0),
+      mNumHits(0),
+      mNumMisses(0) {
+}
+
+// static
+bool DecodedSampleCache::ComputeKey(
+        int fd, int64_t offset, int64_t length, Key *key) {
+    if (offset < 0 || length <= 0 || length > kMaxHashedLength) {
+        return false;
+    }
+
+    uint8_t *buffer = new uint8_t[kHashChunkSize];
+
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    int64_t done = 0;
+    while (done < length) {
+        size_t size = kHashChunkSize;
+        if (length - done < (int64_t)size) {
+            size = length - done;
+        }
+        ssize_t n = pread64(fd, buffer, size, offset + done);
+        if (n <= 0) {
+            break;
+        }
+        SHA256_Update(&ctx, buffer, n);
+        done += n;
+    }
+
+    delete[] buffer;
+
+    if (done != length) {
+        ALOGV("could only read %lld of %lld bytes", done, length);
+        return false;
+    }
+
+    key->mLength = length;
+    SHA256_Final(key->mDigest, &ctx);
+    return true;
+}
+
+bool DecodedSampleCache::lookup(const Key &key, Entry *entry) {
+    Mutex::Autolock autoLock(mLock);
+
+    ssize_t index = mItems.indexOfKey(key);
+    if (index < 0) {
+        ++mNumMisses;
+        return false;
+    }
+
+    ++mNumHits;
+    Item &item = mItems.editValueAt(index);
+    item.mLastUse = ++mUseCounter;
+    *entry = item.mEntry;
+    return true;
+}
+
+void DecodedSampleCache::insert(const Key &key, const Entry &entry) {
+    size_t size = entry.mPCM->size();
+    if (size > mMaxBytes) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    // Another client may have decoded the same content meanwhile.
+    ssize_t index = mItems.indexOfKey(key);
+    if (index >= 0) {
+        mTotalBytes -= mItems.valueAt(index).mEntry.mPCM->size();
+        mItems.removeItemsAt(index);
+    }
+
+    Item item;
+    item.mEntry = entry;
+    item.mLastUse = ++mUseCounter;
+    mItems.add(key, item);
+    mTotalBytes += size;
+
+    evict_l();
+}
+
+void DecodedSampleCache::evict_l() {
+    // Clients keep their memory mapped, evicting only drops our reference.
+    while (mTotalBytes > mMaxBytes && !mItems.isEmpty()) {
+        size_t oldest = 0;
+        for (size_t i = 1; i < mItems.size(); ++i) {
+            if (mItems.valueAt(i).mLastUse < mItems.valueAt(oldest).mLastUse) {
+                oldest = i;
+            }
+        }
+        mTotalBytes -= mItems.valueAt(oldest).mEntry.mPCM->size();
+        mItems.removeItemsAt(oldest);
+    }
+}
+
+void DecodedSampleCache::dump(String8 &result) const {
+    Mutex::Autolock autoLock(mLock);
+
+    result.appendFormat(
+            " Decoded sample cache: %u samples, %u of %u bytes, %u hits, %u misses\n",
+            mItems.size(), mTotalBytes, mMaxBytes, mNumHits, mNumMisses);
+}
+
+}  // namespace android
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DECODED_SAMPLE_CACHE_H_
+
+#define DECODED_SAMPLE_CACHE_H_
+
+#include <binder/IMemory.h>
+#include <media/stagefright/foundation/ABase.h>
+#include <system/audio.h>
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+
+namespace android {
+
+// Keeps the PCM of recently decoded sound samples, keyed by a SHA-256 digest
+// of their compressed content. The PCM lives in read-only shared memory, so
+// every process that loads the same asset maps the same decoded copy. The
+// cache is shared by all clients, so the digest must be one no client can
+// collide on purpose.
+struct DecodedSampleCache {
+    enum {
+        kDigestSize = 32,   // SHA-256
+    };
+
+    struct Key {
+        int64_t mLength;
+        uint8_t mDigest[kDigestSize];
+
+        bool operator<(const Key &other) const;
+    };
+
+    struct Entry {
+        sp<IMemory> mPCM;
+        uint32_t mSampleRate;
+        int mNumChannels;
+        audio_format_t mFormat;
+    };
+
+    DecodedSampleCache(size_t maxBytes);
+
+    // Digests the content in [offset, offset + length) of fd. Returns false
+    // if the content could not be read or is too large to be worth caching.
+    static bool ComputeKey(int fd, int64_t offset, int64_t length, Key *key);
+
+    bool lookup(const Key &key, Entry *entry);
+    void insert(const Key &key, const Entry &entry);
+
+    void dump(String8 &result) const;
+
+private:
+    struct Item {
+        Entry mEntry;
+        uint64_t mLastUse;
+    };
+
+    mutable Mutex mLock;
+    KeyedVector<Key, Item> mItems;
+    size_t mMaxBytes;
+    size_t mTotalBytes;
+    uint64_t mUseCounter;
+    uint32_t mNumHits;
+    uint32_t mNumMisses;
+
+    void evict_l();
+
+    DISALLOW_EVIL_CONSTRUCTORS(DecodedSampleCache);
+};
+
+}  // namespace android
+
+#endif  // DECODED_SAMPLE_CACHE_H_
@@ -90,6 +90,12 @@ using android::Parcel;
 // Max number of entries in the filter.
 const int kMaxFilterSize = 64;  // I pulled that out of thin air.
 
+// Decoded PCM kept for sharing between SoundPool clients.
+const size_t kMaxCachedSampleBytes = 8 * 1024 * 1024;
+
+// Same limit as the heap SoundPool decodes into.
+const size_t kMaxDecodedSampleSize = 1024 * 1024;
+
 // FIXME: Move all the metadata related function in the Metadata.cpp
 
 
@@ -207,6 +213,7 @@ void MediaPlayerService::instantiate() {
 }
 
 MediaPlayerService::MediaPlayerService()
+    : mSampleCache(kMaxCachedSampleBytes)
 {
     ALOGV("MediaPlayerService created");
     mNextConnId = 1;
@@ -409,6 +416,9 @@ status_t MediaPlayerService::dump(int fd, const Vector<String16>& args)
             }
         }
 
+        Crypto::dumpStats(result);
+        mSampleCache.dump(result);
+
         result.append(" Files opened and/or mapped:\n");
         snprintf(buffer, SIZE, "/proc/%d/maps", gettid());
         FILE *f = fopen(buffer, "r");
@@ -1293,6 +1303,52 @@ Exit:
     return status;
 }
 
+status_t MediaPlayerService::decodeCached(int fd, int64_t offset, int64_t length,
+                                             uint32_t *pSampleRate, int* pNumChannels,
+                                             audio_format_t* pFormat, sp<IMemory>* pMem)
+{
+    ALOGV("decodeCached(%d, %lld, %lld)", fd, offset, length);
+    DecodedSampleCache::Key key;
+    DecodedSampleCache::Entry entry;
+    bool cacheable = DecodedSampleCache::ComputeKey(fd, offset, length, &key);
+    if (cacheable && mSampleCache.lookup(key, &entry)) {
+        ALOGV("found decoded sample in cache");
+        ::close(fd);
+        *pSampleRate = entry.mSampleRate;
+        *pNumChannels = entry.mNumChannels;
+        *pFormat = entry.mFormat;
+        *pMem = entry.mPCM;
+        return NO_ERROR;
+    }
+
+    // decode() closes fd
+    sp<MemoryHeapBase> scratch = new MemoryHeapBase(kMaxDecodedSampleSize);
+    size_t size;
+    status_t status = decode(fd, offset, length, pSampleRate, pNumChannels, pFormat,
+                             scratch, &size);
+    if (status != NO_ERROR) {
+        return status;
+    }
+
+    // Clients only get to read the samples, they are shared.
+    sp<MemoryHeapBase> heap = new MemoryHeapBase(size, MemoryHeapBase::READ_ONLY,
+                                                 "DecodedSample");
+    if (heap->getHeapID() < 0) {
+        return NO_MEMORY;
+    }
+    memcpy(heap->getBase(), scratch->getBase(), size);
+    *pMem = new MemoryBase(heap, 0, size);
+
+    if (cacheable) {
+        entry.mPCM = *pMem;
+        entry.mSampleRate = *pSampleRate;
+        entry.mNumChannels = *pNumChannels;
+        entry.mFormat = *pFormat;
+        mSampleCache.insert(key, entry);
+    }
+    return NO_ERROR;
+}
+
 
 #undef LOG_TAG
 #define LOG_TAG "AudioSink"
@@ -1391,6 +1447,12 @@ status_t MediaPlayerService::AudioOutput::getFramesWritten(uint32_t *frameswritt
     return OK;
 }
 
+status_t MediaPlayerService::AudioOutput::getTimestamp(AudioTimestamp &ts) const
+{
+    if (mTrack == 0) return NO_INIT;
+    return mTrack->getTimestamp(ts);
+}
+
 status_t MediaPlayerService::AudioOutput::setParameters(const String8& keyValuePairs)
 {
     if (mTrack == 0) return NO_INIT;
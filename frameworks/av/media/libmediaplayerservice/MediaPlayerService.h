@@ -32,6 +32,8 @@
 
 #include <system/audio.h>
 
+#include "DecodedSampleCache.h"
+
 namespace android {
 
 class AudioTrack;
@@ -85,6 +87,7 @@ class MediaPlayerService : public BnMediaPlayerService
         virtual float           msecsPerFrame() const;
         virtual status_t        getPosition(uint32_t *position) const;
         virtual status_t        getFramesWritten(uint32_t *frameswritten) const;
+        virtual status_t        getTimestamp(AudioTimestamp &ts) const;
         virtual int             getSessionId() const;
         virtual uint32_t        getSampleRate() const;
 
@@ -263,6 +266,9 @@ public:
                                        uint32_t *pSampleRate, int* pNumChannels,
                                        audio_format_t* pFormat,
                                        const sp<IMemoryHeap>& heap, size_t *pSize);
+    virtual status_t            decodeCached(int fd, int64_t offset, int64_t length,
+                                       uint32_t *pSampleRate, int* pNumChannels,
+                                       audio_format_t* pFormat, sp<IMemory>* pMem);
     virtual sp<IOMX>            getOMX();
     virtual sp<ICrypto>         makeCrypto();
     virtual sp<IDrm>            makeDrm();
@@ -448,6 +454,7 @@ private:
                 int32_t                     mNextConnId;
                 sp<IOMX>                    mOMX;
                 sp<ICrypto>                 mCrypto;
+                DecodedSampleCache          mSampleCache;
 };
 
 // ----------------------------------------------------------------------------
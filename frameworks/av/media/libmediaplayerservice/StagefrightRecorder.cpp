@@ -455,6 +455,16 @@ status_t StagefrightRecorder::setParam64BitFileOffset(bool use64Bit) {
     return OK;
 }
 
+status_t StagefrightRecorder::setParamMovieFragmentDuration(int64_t timeUs) {
+    ALOGV("setParamMovieFragmentDuration: %lld us", timeUs);
+    if (timeUs < 0) {
+        ALOGE("Movie fragment duration is negative: %lld us", timeUs);
+        return BAD_VALUE;
+    }
+    mMovieFragmentDurationUs = timeUs;
+    return OK;
+}
+
 status_t StagefrightRecorder::setParamVideoCameraId(int32_t cameraId) {
     ALOGV("setParamVideoCameraId: %d", cameraId);
     if (cameraId < 0) {
@@ -604,6 +614,11 @@ status_t StagefrightRecorder::setParameter(
         if (safe_strtoi32(value.string(), &use64BitOffset)) {
             return setParam64BitFileOffset(use64BitOffset != 0);
         }
+    } else if (key == "param-movie-fragment-duration-us") {
+        int64_t fragmentDurationUs;
+        if (safe_strtoi64(value.string(), &fragmentDurationUs)) {
+            return setParamMovieFragmentDuration(fragmentDurationUs);
+        }
     } else if (key == "param-geotag-longitude") {
         int64_t longitudex10000;
         if (safe_strtoi64(value.string(), &longitudex10000)) {
@@ -1565,6 +1580,9 @@ void StagefrightRecorder::setupMPEG4MetaData(int64_t startTimeUs, int32_t totalB
     (*meta)->setInt32(kKeyFileType, mOutputFormat);
     (*meta)->setInt32(kKeyBitRate, totalBitRate);
     (*meta)->setInt32(kKey64BitFileOffset, mUse64BitFileOffset);
+    if (mMovieFragmentDurationUs > 0) {
+        (*meta)->setInt64(kKeyMovieFragmentDuration, mMovieFragmentDurationUs);
+    }
     if (mMovieTimeScale > 0) {
         (*meta)->setInt32(kKeyTimeScale, mMovieTimeScale);
     }
@@ -1689,6 +1707,7 @@ status_t StagefrightRecorder::reset() {
     mIFramesIntervalSec = 1;
     mAudioSourceNode = 0;
     mUse64BitFileOffset = false;
+    mMovieFragmentDurationUs = 0;
     mMovieTimeScale  = -1;
     mAudioTimeScale  = -1;
     mVideoTimeScale  = -1;
@@ -1753,6 +1772,8 @@ status_t StagefrightRecorder::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     File offset length (bits): %d\n", mUse64BitFileOffset? 64: 32);
     result.append(buffer);
+    snprintf(buffer, SIZE, "     Movie fragment duration (us): %lld\n", mMovieFragmentDurationUs);
+    result.append(buffer);
     snprintf(buffer, SIZE, "     Interleave duration (us): %d\n", mInterleaveDurationUs);
     result.append(buffer);
     snprintf(buffer, SIZE, "     Progress notification: %lld us\n", mTrackEveryTimeDurationUs);
@@ -160,7 +160,20 @@ NuPlayer::NuPlayer()
       mNumFramesTotal(0ll),
       mNumFramesDropped(0ll),
       mVideoScalingMode(NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW),
-      mStarted(false) {
+      mStarted(false),
+      mFastStart(false),
+      mSourceStarted(false),
+      mPrepareTimeUs(-1ll),
+      mPreparedTimeUs(-1ll),
+      mVideoDecoderReadyTimeUs(-1ll),
+      mFirstFrameDecodedTimeUs(-1ll),
+      mStartTimeUs(-1ll) {
+    char prop[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.fast-start", prop, NULL)
+            && (!strcmp(prop, "1") || !strcasecmp(prop, "true"))) {
+        mFastStart = true;
+    }
+    mNBLogWriter = NBLog::getServiceWriter("MediaPlayerService");
 }
 
 NuPlayer::~NuPlayer() {
@@ -336,6 +349,12 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
 
         case kWhatPrepare:
         {
+            mPrepareTimeUs = ALooper::GetNowUs();
+            mPreparedTimeUs = -1;
+            mVideoDecoderReadyTimeUs = -1;
+            mFirstFrameDecodedTimeUs = -1;
+            mStartTimeUs = -1;
+
             mSource->prepareAsync();
             break;
         }
@@ -443,7 +462,11 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
         {
             ALOGV("kWhatStart");
 
-            mVideoIsAVC = false;
+            mStartTimeUs = ALooper::GetNowUs();
+
+            if (mVideoDecoder == NULL) {
+                mVideoIsAVC = false;
+            }
             mAudioEOS = false;
             mVideoEOS = false;
             mSkipRenderingAudioUntilMediaTimeUs = -1;
@@ -453,7 +476,10 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
             mNumFramesDropped = 0;
             mStarted = true;
 
-            mSource->start();
+            if (!mSourceStarted) {
+                mSource->start();
+                mSourceStarted = true;
+            }
 
             uint32_t flags = 0;
 
@@ -468,6 +494,14 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
 
             looper()->registerHandler(mRenderer);
 
+            // Hand over what the decoders produced while prerolling.
+            while (!mPrerollQueue.empty()) {
+                sp<AMessage> notify = *mPrerollQueue.begin();
+                mPrerollQueue.erase(mPrerollQueue.begin());
+
+                onMessageReceived(notify);
+            }
+
             postScanSources();
             break;
         }
@@ -540,6 +574,30 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
             int32_t what;
             CHECK(codecRequest->findInt32("what", &what));
 
+            if (!audio) {
+                if (what == ACodec::kWhatBuffersAllocated
+                        && mVideoDecoderReadyTimeUs < 0) {
+                    mVideoDecoderReadyTimeUs = ALooper::GetNowUs();
+                } else if (what == ACodec::kWhatDrainThisBuffer
+                        && mFirstFrameDecodedTimeUs < 0) {
+                    mFirstFrameDecodedTimeUs = ALooper::GetNowUs();
+                }
+            }
+
+            if (mRenderer == NULL
+                    && (what == ACodec::kWhatDrainThisBuffer
+                        || what == ACodec::kWhatEOS
+                        || what == ACodec::kWhatError)) {
+                // Still prerolling, there's no renderer until start().
+                if (!IsFlushingState(audio ? mFlushingAudio : mFlushingVideo)) {
+                    mPrerollQueue.push_back(msg);
+                } else if (what == ACodec::kWhatDrainThisBuffer) {
+                    // Returns the buffer to the decoder right away.
+                    renderBuffer(audio, codecRequest);
+                }
+                break;
+            }
+
             if (what == ACodec::kWhatFillThisBuffer) {
                 status_t err = feedDecoderInputData(
                         audio, codecRequest);
@@ -638,7 +696,9 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
                              (status_t)OK);
                     mAudioSink->start();
 
-                    mRenderer->signalAudioSinkChanged();
+                    if (mRenderer != NULL) {
+                        mRenderer->signalAudioSinkChanged();
+                    }
                 } else {
                     // video
 
@@ -762,6 +822,18 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
 
                         driver->notifyFrameStats(
                                 mNumFramesTotal, mNumFramesDropped);
+
+                        int64_t numRendered, numLate, numDroppedLate;
+                        if (msg->findInt64(
+                                    "numVideoFramesRendered", &numRendered)
+                                && msg->findInt64(
+                                    "numVideoFramesLate", &numLate)
+                                && msg->findInt64(
+                                    "numVideoFramesDropped",
+                                    &numDroppedLate)) {
+                            driver->notifyRenderStats(
+                                    numRendered, numLate, numDroppedLate);
+                        }
                     }
                 }
             } else if (what == Renderer::kWhatFlushComplete) {
@@ -771,6 +843,7 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
                 ALOGV("renderer %s flush completed.", audio ? "audio" : "video");
             } else if (what == Renderer::kWhatVideoRenderingStart) {
                 notifyListener(MEDIA_INFO, MEDIA_INFO_RENDERING_START, 0);
+                notifyStartupTimings();
             } else if (what == Renderer::kWhatMediaRenderingStart) {
                 ALOGV("media rendering started");
                 notifyListener(MEDIA_STARTED, 0, 0);
@@ -854,7 +927,9 @@ void NuPlayer::finishFlushIfPossible() {
     ALOGV("both audio and video are flushed now.");
 
     if (mTimeDiscontinuityPending) {
-        mRenderer->signalTimeDiscontinuity();
+        if (mRenderer != NULL) {
+            mRenderer->signalTimeDiscontinuity();
+        }
         mTimeDiscontinuityPending = false;
     }
 
@@ -884,6 +959,61 @@ void NuPlayer::postScanSources() {
     mScanSourcesPending = true;
 }
 
+void NuPlayer::startPreroll() {
+    if (mStarted || mSourceStarted) {
+        return;
+    }
+
+    ALOGV("prerolling");
+
+    mSource->start();
+    mSourceStarted = true;
+
+    postScanSources();
+}
+
+void NuPlayer::releasePrerollQueue(bool audio) {
+    List<sp<AMessage> >::iterator it = mPrerollQueue.begin();
+    while (it != mPrerollQueue.end()) {
+        if (((*it)->what() == kWhatAudioNotify) != audio) {
+            ++it;
+            continue;
+        }
+
+        sp<AMessage> codecRequest;
+        CHECK((*it)->findMessage("codec-request", &codecRequest));
+
+        int32_t what;
+        CHECK(codecRequest->findInt32("what", &what));
+
+        if (what == ACodec::kWhatDrainThisBuffer) {
+            sp<AMessage> reply;
+            CHECK(codecRequest->findMessage("reply", &reply));
+            reply->post();
+        }
+
+        it = mPrerollQueue.erase(it);
+    }
+}
+
+void NuPlayer::notifyStartupTimings() {
+    sp<NuPlayerDriver> driver = mDriver.promote();
+    if (driver == NULL || mStartTimeUs < 0) {
+        return;
+    }
+
+    sp<AMessage> timings = new AMessage;
+    timings->setInt32("fast-start", mFastStart);
+    timings->setInt64("prepare", mPrepareTimeUs);
+    timings->setInt64("prepared", mPreparedTimeUs);
+    timings->setInt64("decoder-ready", mVideoDecoderReadyTimeUs);
+    timings->setInt64("first-frame-decoded", mFirstFrameDecodedTimeUs);
+    timings->setInt64("start", mStartTimeUs);
+    timings->setInt64("first-frame-rendered", ALooper::GetNowUs());
+
+    driver->notifyStartupTimings(timings);
+}
+
 status_t NuPlayer::instantiateDecoder(bool audio, sp<Decoder> *decoder) {
     if (*decoder != NULL) {
         return OK;
@@ -915,6 +1045,8 @@ status_t NuPlayer::instantiateDecoder(bool audio, sp<Decoder> *decoder) {
 }
 
 status_t NuPlayer::feedDecoderInputData(bool audio, const sp<AMessage> &msg) {
+    mNBLogWriter->logEvent(NBLog::EVENT_ID_NUPLAYER_FEED_INPUT, audio);
+
     sp<AMessage> reply;
     CHECK(msg->findMessage("reply", &reply));
 
@@ -1048,6 +1180,7 @@ status_t NuPlayer::feedDecoderInputData(bool audio, const sp<AMessage> &msg) {
 
 void NuPlayer::renderBuffer(bool audio, const sp<AMessage> &msg) {
     // ALOGV("renderBuffer %s", audio ? "audio" : "video");
+    mNBLogWriter->logEvent(NBLog::EVENT_ID_NUPLAYER_RENDER_BUFFER, audio);
 
     sp<AMessage> reply;
     CHECK(msg->findMessage("reply", &reply));
@@ -1120,7 +1253,10 @@ void NuPlayer::flushDecoder(bool audio, bool needShutdown) {
     mScanSourcesPending = false;
 
     (audio ? mAudioDecoder : mVideoDecoder)->signalFlush();
-    mRenderer->flush(audio);
+    releasePrerollQueue(audio);
+    if (mRenderer != NULL) {
+        mRenderer->flush(audio);
+    }
 
     FlushStatus newStatus =
         needShutdown ? FLUSHING_DECODER_SHUTDOWN : FLUSHING_DECODER;
@@ -1319,6 +1455,7 @@ void NuPlayer::performReset() {
     mScanSourcesPending = false;
 
     mRenderer.clear();
+    mPrerollQueue.clear();
 
     if (mSource != NULL) {
         mSource->stop();
@@ -1336,6 +1473,7 @@ void NuPlayer::performReset() {
     }
 
     mStarted = false;
+    mSourceStarted = false;
 }
 
 void NuPlayer::performScanSources() {
@@ -1383,11 +1521,19 @@ void NuPlayer::onSourceNotify(const sp<AMessage> &msg) {
             int32_t err;
             CHECK(msg->findInt32("err", &err));
 
+            mPreparedTimeUs = ALooper::GetNowUs();
+
             sp<NuPlayerDriver> driver = mDriver.promote();
             if (driver != NULL) {
                 driver->notifyPrepareCompleted(err);
             }
 
+            if (err == OK && mFastStart) {
+                // Get the decoders going while the client gets around to
+                // calling start().
+                startPreroll();
+            }
+
             int64_t durationUs;
             if (mDriver != NULL && mSource->getDuration(&durationUs) == OK) {
                 sp<NuPlayerDriver> driver = mDriver.promote();
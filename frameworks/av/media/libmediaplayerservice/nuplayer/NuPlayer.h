@@ -19,6 +19,7 @@
 #define NU_PLAYER_H_
 
 #include <media/MediaPlayerInterface.h>
+#include <media/nbaio/NBLog.h>
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/NativeWindowWrapper.h>
 
@@ -156,8 +157,29 @@ private:
 
     bool mStarted;
 
+    // In fast start mode the source is started and the decoders are set
+    // up as soon as the source is prepared, and decode up to the point
+    // where they run out of output buffers. What they hand to the
+    // renderer is held in mPrerollQueue until start().
+    bool mFastStart;
+    bool mSourceStarted;
+    List<sp<AMessage> > mPrerollQueue;
+
+    // Startup milestones, in ALooper::GetNowUs() time, -1 if not reached.
+    int64_t mPrepareTimeUs;
+    int64_t mPreparedTimeUs;
+    int64_t mVideoDecoderReadyTimeUs;
+    int64_t mFirstFrameDecodedTimeUs;
+    int64_t mStartTimeUs;
+
+    sp<NBLog::Writer> mNBLogWriter;
+
     status_t instantiateDecoder(bool audio, sp<Decoder> *decoder);
 
+    void startPreroll();
+    void releasePrerollQueue(bool audio);
+    void notifyStartupTimings();
+
     status_t feedDecoderInputData(bool audio, const sp<AMessage> &msg);
     void renderBuffer(bool audio, const sp<AMessage> &msg);
 
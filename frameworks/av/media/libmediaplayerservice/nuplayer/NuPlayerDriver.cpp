@@ -25,6 +25,7 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MetaData.h>
 
 namespace android {
@@ -38,6 +39,9 @@ NuPlayerDriver::NuPlayerDriver()
       mPositionUs(-1),
       mNumFramesTotal(0),
       mNumFramesDropped(0),
+      mNumFramesRendered(0),
+      mNumFramesLate(0),
+      mNumFramesDroppedLate(0),
       mLooper(new ALooper),
       mPlayerFlags(0),
       mAtEOS(false),
@@ -493,6 +497,58 @@ void NuPlayerDriver::notifyFrameStats(
     mNumFramesDropped = numFramesDropped;
 }
 
+void NuPlayerDriver::notifyRenderStats(
+        int64_t numFramesRendered, int64_t numFramesLate,
+        int64_t numFramesDroppedLate) {
+    Mutex::Autolock autoLock(mLock);
+    mNumFramesRendered = numFramesRendered;
+    mNumFramesLate = numFramesLate;
+    mNumFramesDroppedLate = numFramesDroppedLate;
+}
+
+void NuPlayerDriver::notifyStartupTimings(const sp<AMessage> &timings) {
+    int64_t startUs, renderedUs;
+    if (timings->findInt64("start", &startUs)
+            && timings->findInt64("first-frame-rendered", &renderedUs)) {
+        ALOGI("first frame rendered %lld ms after start",
+              (renderedUs - startUs) / 1000);
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    mStartupTimings = timings;
+}
+
+// Prints the time of each startup milestone relative to prepare.
+static void DumpStartupTimings(FILE *out, const sp<AMessage> &timings) {
+    static const char *kMilestones[] = {
+        "prepared",
+        "decoder-ready",
+        "first-frame-decoded",
+        "start",
+        "first-frame-rendered",
+    };
+
+    int32_t fastStart;
+    int64_t prepareUs;
+    if (!timings->findInt32("fast-start", &fastStart)
+            || !timings->findInt64("prepare", &prepareUs) || prepareUs < 0) {
+        return;
+    }
+
+    fprintf(out, "  startup (ms after prepare, fastStart(%d)):", fastStart);
+    size_t numMilestones = sizeof(kMilestones) / sizeof(kMilestones[0]);
+    for (size_t i = 0; i < numMilestones; ++i) {
+        int64_t timeUs;
+        if (timings->findInt64(kMilestones[i], &timeUs) && timeUs >= 0) {
+            fprintf(out, " %s(%lld)",
+                    kMilestones[i], (timeUs - prepareUs) / 1000);
+        } else {
+            fprintf(out, " %s(n/a)", kMilestones[i]);
+        }
+    }
+    fprintf(out, "\n");
+}
+
 status_t NuPlayerDriver::dump(int fd, const Vector<String16> &args) const {
     Mutex::Autolock autoLock(mLock);
 
@@ -505,6 +561,15 @@ status_t NuPlayerDriver::dump(int fd, const Vector<String16> &args) const {
                  mNumFramesDropped,
                  mNumFramesTotal == 0
                     ? 0.0 : (double)mNumFramesDropped / mNumFramesTotal);
+    fprintf(out, "  numFramesRendered(%lld), numFramesLate(%lld), "
+                 "numFramesDroppedLate(%lld)\n",
+                 mNumFramesRendered,
+                 mNumFramesLate,
+                 mNumFramesDroppedLate);
+
+    if (mStartupTimings != NULL) {
+        DumpStartupTimings(out, mStartupTimings);
+    }
 
     fclose(out);
     out = NULL;
@@ -21,6 +21,7 @@
 namespace android {
 
 struct ALooper;
+struct AMessage;
 struct NuPlayer;
 
 struct NuPlayerDriver : public MediaPlayerInterface {
@@ -69,6 +70,12 @@ struct NuPlayerDriver : public MediaPlayerInterface {
     void notifyPosition(int64_t positionUs);
     void notifySeekComplete();
     void notifyFrameStats(int64_t numFramesTotal, int64_t numFramesDropped);
+    void notifyRenderStats(
+            int64_t numFramesRendered, int64_t numFramesLate,
+            int64_t numFramesDroppedLate);
+
+    // "timings" holds the startup milestones, see NuPlayer.
+    void notifyStartupTimings(const sp<AMessage> &timings);
     void notifyListener(int msg, int ext1 = 0, int ext2 = 0, const Parcel *in = NULL);
     void notifyFlagsChanged(uint32_t flags);
 
@@ -102,6 +109,10 @@ private:
     int64_t mPositionUs;
     int64_t mNumFramesTotal;
     int64_t mNumFramesDropped;
+    int64_t mNumFramesRendered;
+    int64_t mNumFramesLate;
+    int64_t mNumFramesDroppedLate;
+    sp<AMessage> mStartupTimings;
     // <<<
 
     sp<ALooper> mLooper;
@@ -29,6 +29,19 @@ namespace android {
 // static
 const int64_t NuPlayer::Renderer::kMinPositionUpdateDelayUs = 100000ll;
 
+// Video frames are handed to the native window this long before they're
+// due, about two vsyncs, with the time they're due attached, so that a late
+// wakeup of the looper doesn't make them miss their vsync.
+// static
+const int64_t NuPlayer::Renderer::kVideoPrerollUs = 33000ll;
+
+// static
+const int64_t NuPlayer::Renderer::kMaxVideoLateUs = 40000ll;
+
+// Audio clock errors above this are corrected at once instead of smoothly.
+// static
+const int64_t NuPlayer::Renderer::kMaxClockErrorUs = 40000ll;
+
 NuPlayer::Renderer::Renderer(
         const sp<MediaPlayerBase::AudioSink> &sink,
         const sp<AMessage> &notify,
@@ -43,6 +56,11 @@ NuPlayer::Renderer::Renderer(
       mVideoQueueGeneration(0),
       mAnchorTimeMediaUs(-1),
       mAnchorTimeRealUs(-1),
+      mClockRate(1.0),
+      mAudioAnchorMediaUs(-1),
+      mAudioAnchorFrame(0),
+      mDriftSampleMediaUs(-1),
+      mDriftSampleRealUs(-1),
       mFlushingAudio(false),
       mFlushingVideo(false),
       mHasAudio(false),
@@ -53,7 +71,11 @@ NuPlayer::Renderer::Renderer(
       mVideoRenderingStartGeneration(0),
       mAudioRenderingStartGeneration(0),
       mLastPositionUpdateUs(-1ll),
-      mVideoLateByUs(0ll) {
+      mVideoLateByUs(0ll),
+      mNumVideoFramesRendered(0ll),
+      mNumVideoFramesLate(0ll),
+      mNumVideoFramesDropped(0ll),
+      mNBLogWriter(NBLog::getServiceWriter("MediaPlayerService")) {
 }
 
 NuPlayer::Renderer::~Renderer() {
@@ -101,6 +123,8 @@ void NuPlayer::Renderer::signalTimeDiscontinuity() {
     // CHECK(mVideoQueue.empty());
     mAnchorTimeMediaUs = -1;
     mAnchorTimeRealUs = -1;
+    mAudioAnchorMediaUs = -1;
+    mDriftSampleMediaUs = -1;
     mSyncQueues = false;
 }
 
@@ -247,6 +271,7 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
 
     ssize_t numFramesAvailableToWrite =
         mAudioSink->frameCount() - (mNumFramesWritten - numFramesPlayed);
+    mNBLogWriter->logEvent(NBLog::EVENT_ID_NUPLAYER_DRAIN_AUDIO, numFramesAvailableToWrite);
 
 #if 0
     if (numFramesAvailableToWrite == mAudioSink->frameCount()) {
@@ -279,23 +304,8 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
 
             ALOGV("rendering audio at media time %.2f secs", mediaTimeUs / 1E6);
 
-            mAnchorTimeMediaUs = mediaTimeUs;
-
-            uint32_t numFramesPlayed;
-            CHECK_EQ(mAudioSink->getPosition(&numFramesPlayed), (status_t)OK);
-
-            uint32_t numFramesPendingPlayout =
-                mNumFramesWritten - numFramesPlayed;
-
-            int64_t realTimeOffsetUs =
-                (mAudioSink->latency() / 2  /* XXX */
-                    + numFramesPendingPlayout
-                        * mAudioSink->msecsPerFrame()) * 1000ll;
-
-            // ALOGI("realTimeOffsetUs = %lld us", realTimeOffsetUs);
-
-            mAnchorTimeRealUs =
-                ALooper::GetNowUs() + realTimeOffsetUs;
+            mAudioAnchorMediaUs = mediaTimeUs;
+            mAudioAnchorFrame = mNumFramesWritten;
         }
 
         size_t copy = entry->mBuffer->size() - entry->mOffset;
@@ -322,11 +332,87 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
         notifyIfMediaRenderingStarted();
     }
 
+    updateAudioClock();
+
     notifyPosition();
 
     return !mAudioQueue.empty();
 }
 
+// Samples the audio sink's position and moves the clock towards it.
+void NuPlayer::Renderer::updateAudioClock() {
+    if (mAudioAnchorMediaUs < 0) {
+        return;
+    }
+
+    // Find out which frame is being presented when.
+    uint32_t numFramesPlayed;
+    int64_t playedAtUs;
+    AudioTimestamp ts;
+    if (mAudioSink->getTimestamp(ts) == OK
+            && (ts.mTime.tv_sec != 0 || ts.mTime.tv_nsec != 0)) {
+        numFramesPlayed = ts.mPosition;
+        playedAtUs = ts.mTime.tv_sec * 1000000ll + ts.mTime.tv_nsec / 1000;
+    } else if (mAudioSink->getPosition(&numFramesPlayed) == OK) {
+        playedAtUs = ALooper::GetNowUs()
+            + mAudioSink->latency() / 2 * 1000ll;  /* XXX */
+    } else {
+        return;
+    }
+
+    int32_t framesSinceAnchor = numFramesPlayed - mAudioAnchorFrame;
+    int64_t mediaUs = mAudioAnchorMediaUs
+        + (int64_t)(framesSinceAnchor * mAudioSink->msecsPerFrame() * 1000);
+
+    if (mAnchorTimeMediaUs < 0) {
+        mAnchorTimeMediaUs = mediaUs;
+        mAnchorTimeRealUs = playedAtUs;
+        mDriftSampleMediaUs = mediaUs;
+        mDriftSampleRealUs = playedAtUs;
+        return;
+    }
+
+    int64_t errorUs = playedAtUs - getRealTimeUs(mediaUs);
+
+    if (errorUs > kMaxClockErrorUs || errorUs < -kMaxClockErrorUs) {
+        ALOGV("audio clock off by %lld us, resyncing", errorUs);
+
+        mAnchorTimeMediaUs = mediaUs;
+        mAnchorTimeRealUs = playedAtUs;
+        mDriftSampleMediaUs = mediaUs;
+        mDriftSampleRealUs = playedAtUs;
+        return;
+    }
+
+    // The sink's clock and ours drift apart slowly, measure the rate over
+    // a second or more so that the jitter of the samples averages out.
+    if (mDriftSampleMediaUs < 0) {
+        mDriftSampleMediaUs = mediaUs;
+        mDriftSampleRealUs = playedAtUs;
+    } else if (mediaUs - mDriftSampleMediaUs >= 1000000ll) {
+        double rate = (double)(playedAtUs - mDriftSampleRealUs)
+            / (mediaUs - mDriftSampleMediaUs);
+
+        if (rate > 0.95 && rate < 1.05) {
+            mClockRate += (rate - mClockRate) / 8;
+        }
+
+        mDriftSampleMediaUs = mediaUs;
+        mDriftSampleRealUs = playedAtUs;
+    }
+
+    // Only take out part of the error each time, the video frames
+    // scheduled from the clock would jitter along with the samples
+    // otherwise.
+    mAnchorTimeRealUs = getRealTimeUs(mediaUs) + errorUs / 8;
+    mAnchorTimeMediaUs = mediaUs;
+}
+
+int64_t NuPlayer::Renderer::getRealTimeUs(int64_t mediaTimeUs) const {
+    return mAnchorTimeRealUs
+        + (int64_t)((mediaTimeUs - mAnchorTimeMediaUs) * mClockRate);
+}
+
 void NuPlayer::Renderer::postDrainVideoQueue() {
     if (mDrainVideoQueuePending || mSyncQueues || mPaused) {
         return;
@@ -350,7 +436,7 @@ void NuPlayer::Renderer::postDrainVideoQueue() {
         int64_t mediaTimeUs;
         CHECK(entry.mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
 
-        delayUs = mediaTimeUs - ALooper::GetNowUs();
+        delayUs = mediaTimeUs - ALooper::GetNowUs() - kVideoPrerollUs;
     } else {
         int64_t mediaTimeUs;
         CHECK(entry.mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
@@ -363,10 +449,9 @@ void NuPlayer::Renderer::postDrainVideoQueue() {
                 mAnchorTimeRealUs = ALooper::GetNowUs();
             }
         } else {
-            int64_t realTimeUs =
-                (mediaTimeUs - mAnchorTimeMediaUs) + mAnchorTimeRealUs;
+            int64_t realTimeUs = getRealTimeUs(mediaTimeUs);
 
-            delayUs = realTimeUs - ALooper::GetNowUs();
+            delayUs = realTimeUs - ALooper::GetNowUs() - kVideoPrerollUs;
         }
     }
 
@@ -392,30 +477,48 @@ void NuPlayer::Renderer::onDrainVideoQueue() {
 
         mVideoLateByUs = 0ll;
 
+        ALOGV("video done, %lld frames rendered, %lld late, %lld dropped",
+              mNumVideoFramesRendered, mNumVideoFramesLate,
+              mNumVideoFramesDropped);
+
         notifyPosition();
         return;
     }
 
+    int64_t mediaTimeUs;
+    CHECK(entry->mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
+
     int64_t realTimeUs;
     if (mFlags & FLAG_REAL_TIME) {
-        CHECK(entry->mBuffer->meta()->findInt64("timeUs", &realTimeUs));
+        realTimeUs = mediaTimeUs;
     } else {
-        int64_t mediaTimeUs;
-        CHECK(entry->mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
-
-        realTimeUs = mediaTimeUs - mAnchorTimeMediaUs + mAnchorTimeRealUs;
+        realTimeUs = getRealTimeUs(mediaTimeUs);
     }
 
     mVideoLateByUs = ALooper::GetNowUs() - realTimeUs;
-    bool tooLate = (mVideoLateByUs > 40000);
+    bool tooLate = (mVideoLateByUs > kMaxVideoLateUs);
 
     if (tooLate) {
         ALOGV("video late by %lld us (%.2f secs)",
              mVideoLateByUs, mVideoLateByUs / 1E6);
+
+        ++mNumVideoFramesDropped;
     } else {
         ALOGV("rendering video at media time %.2f secs", mediaTimeUs / 1E6);
+
+        // Frames normally go out ahead of time, the native window holds
+        // on to them until they're due.
+        entry->mNotifyConsumed->setInt64("timestampNs", realTimeUs * 1000ll);
+
+        ++mNumVideoFramesRendered;
+        if (mVideoLateByUs > 0) {
+            ++mNumVideoFramesLate;
+        }
     }
 
+    mNBLogWriter->logEvent(NBLog::EVENT_ID_NUPLAYER_DRAIN_VIDEO,
+            (int32_t)(mVideoLateByUs / 1000ll), !tooLate);
+
     entry->mNotifyConsumed->setInt32("render", !tooLate);
     entry->mNotifyConsumed->post();
     mVideoQueue.erase(mVideoQueue.begin());
@@ -648,6 +751,7 @@ bool NuPlayer::Renderer::dropBufferWhileFlushing(
 
 void NuPlayer::Renderer::onAudioSinkChanged() {
     CHECK(!mDrainAudioQueuePending);
+    mAudioAnchorMediaUs = -1;
     mNumFramesWritten = 0;
     uint32_t written;
     if (mAudioSink->getFramesWritten(&written) == OK) {
@@ -668,12 +772,17 @@ void NuPlayer::Renderer::notifyPosition() {
     }
     mLastPositionUpdateUs = nowUs;
 
-    int64_t positionUs = (nowUs - mAnchorTimeRealUs) + mAnchorTimeMediaUs;
+    int64_t positionUs =
+        (int64_t)((nowUs - mAnchorTimeRealUs) / mClockRate)
+            + mAnchorTimeMediaUs;
 
     sp<AMessage> notify = mNotify->dup();
     notify->setInt32("what", kWhatPosition);
     notify->setInt64("positionUs", positionUs);
     notify->setInt64("videoLateByUs", mVideoLateByUs);
+    notify->setInt64("numVideoFramesRendered", mNumVideoFramesRendered);
+    notify->setInt64("numVideoFramesLate", mNumVideoFramesLate);
+    notify->setInt64("numVideoFramesDropped", mNumVideoFramesDropped);
     notify->post();
 }
 
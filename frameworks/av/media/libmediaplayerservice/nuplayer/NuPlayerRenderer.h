@@ -81,6 +81,9 @@ private:
     };
 
     static const int64_t kMinPositionUpdateDelayUs;
+    static const int64_t kVideoPrerollUs;
+    static const int64_t kMaxVideoLateUs;
+    static const int64_t kMaxClockErrorUs;
 
     sp<MediaPlayerBase::AudioSink> mAudioSink;
     sp<AMessage> mNotify;
@@ -94,8 +97,21 @@ private:
     int32_t mAudioQueueGeneration;
     int32_t mVideoQueueGeneration;
 
+    // The clock: media time mAnchorTimeMediaUs is presented at (system)
+    // time mAnchorTimeRealUs, and media time runs mClockRate times slower
+    // than real time from there on. With audio it follows the audio sink.
     int64_t mAnchorTimeMediaUs;
     int64_t mAnchorTimeRealUs;
+    double mClockRate;
+
+    // The audio frame mAudioAnchorFrame, counted like mNumFramesWritten,
+    // has media time mAudioAnchorMediaUs.
+    int64_t mAudioAnchorMediaUs;
+    uint32_t mAudioAnchorFrame;
+
+    // The audio clock sample the clock rate is next measured against.
+    int64_t mDriftSampleMediaUs;
+    int64_t mDriftSampleRealUs;
 
     Mutex mFlushLock;  // protects the following 2 member vars.
     bool mFlushingAudio;
@@ -113,12 +129,21 @@ private:
     int64_t mLastPositionUpdateUs;
     int64_t mVideoLateByUs;
 
+    int64_t mNumVideoFramesRendered;
+    int64_t mNumVideoFramesLate;  // rendered, but released after their time
+    int64_t mNumVideoFramesDropped;  // too late to be rendered at all
+
+    sp<NBLog::Writer> mNBLogWriter;
+
     bool onDrainAudioQueue();
     void postDrainAudioQueue(int64_t delayUs = 0);
 
     void onDrainVideoQueue();
     void postDrainVideoQueue();
 
+    void updateAudioClock();
+    int64_t getRealTimeUs(int64_t mediaTimeUs) const;
+
     void prepareForMediaRenderingStart();
     void notifyIfMediaRenderingStarted();
 
@@ -43,6 +43,18 @@ MonoPipe::MonoPipe(size_t reqFrames, NBAIO_Format format, bool writeCanBlock) :
         mSetpoint((reqFrames * 11) / 16),
         mWriteCanBlock(writeCanBlock),
         mIsShutdown(false),
+        mAdaptive(false),
+        mMinSetpoint(0),
+        mMaxSetpoint(0),
+        mWindowMinFill(0),
+        mWindowFrames(0),
+        mWindowMaxJitterNs(0),
+        mLastWriteFrames(0),
+        mAdaptTsValid(false),
+        // mAdaptTs
+        mReaderUnderrunsSeen(0),
+        mReaderUnderruns(0),
+        // mAdaptiveStats
         // mTimestampShared
         mTimestampMutator(&mTimestampShared),
         mTimestampObserver(&mTimestampShared)
@@ -52,6 +64,7 @@ MonoPipe::MonoPipe(size_t reqFrames, NBAIO_Format format, bool writeCanBlock) :
     uint64_t N, D;
 
     mNextRdPTS = AudioBufferProvider::kInvalidPTS;
+    memset(&mAdaptiveStats, 0, sizeof(mAdaptiveStats));
 
     mSamplesToLocalTime.a_zero = 0;
     mSamplesToLocalTime.b_zero = 0;
@@ -101,6 +114,9 @@ ssize_t MonoPipe::write(const void *buffer, size_t count)
     if (CC_UNLIKELY(!mNegotiated)) {
         return NEGOTIATE;
     }
+    if (mAdaptive) {
+        adaptSetpoint();
+    }
     size_t totalFramesWritten = 0;
     while (count > 0) {
         // can't return a negative value, as we already checked for !mNegotiated
@@ -197,12 +213,130 @@ ssize_t MonoPipe::write(const void *buffer, size_t count)
         mWriteTsValid = nowTsValid;
     }
     mFramesWritten += totalFramesWritten;
+    mLastWriteFrames = totalFramesWritten;
     return totalFramesWritten;
 }
 
 void MonoPipe::setAvgFrames(size_t setpoint)
 {
     mSetpoint = setpoint;
+    mAdaptive = false;
+}
+
+void MonoPipe::setAdaptiveSetpoint(size_t minSetpoint, size_t maxSetpoint)
+{
+    if (maxSetpoint > mMaxFrames) {
+        maxSetpoint = mMaxFrames;
+    }
+    if (minSetpoint > maxSetpoint) {
+        minSetpoint = maxSetpoint;
+    }
+    if (!mAdaptive) {
+        mAdaptive = true;
+        mWindowMinFill = mMaxFrames;
+        mWindowFrames = 0;
+        mWindowMaxJitterNs = 0;
+        mAdaptTsValid = false;
+        mReaderUnderrunsSeen = android_atomic_acquire_load(&mReaderUnderruns);
+        memset(&mAdaptiveStats, 0, sizeof(mAdaptiveStats));
+        // start from the deepest setting and let the pipe find its way down
+        mSetpoint = maxSetpoint;
+    }
+    mMinSetpoint = minSetpoint;
+    mMaxSetpoint = maxSetpoint;
+    if (mSetpoint < minSetpoint) {
+        mSetpoint = minSetpoint;
+    } else if (mSetpoint > maxSetpoint) {
+        mSetpoint = maxSetpoint;
+    }
+    mAdaptiveStats.mSetpoint = mSetpoint;
+}
+
+// Called at the start of write(), a safe point since only the writer uses the setpoint.
+void MonoPipe::adaptSetpoint()
+{
+    const uint32_t sampleRate = Format_sampleRate(mFormat);
+    const size_t filled = mRear - android_atomic_acquire_load(&mFront);
+    const int32_t underruns = android_atomic_acquire_load(&mReaderUnderruns);
+
+    // Measure how far the period between two writes deviates from the duration of the
+    // previous write.  A period of more than 4 times that duration is a gap, such as a
+    // standby of the writer, rather than jitter: the reader underruns that it caused are
+    // not held against the setpoint, and observation starts over.
+    struct timespec nowTs;
+    bool nowTsValid = !clock_gettime(CLOCK_MONOTONIC, &nowTs);
+    bool gap = true;
+    uint32_t jitterNs = 0;
+    if (nowTsValid && mAdaptTsValid && mLastWriteFrames > 0) {
+        int64_t elapsedNs = (nowTs.tv_sec - mAdaptTs.tv_sec) * 1000000000LL +
+                (nowTs.tv_nsec - mAdaptTs.tv_nsec);
+        int64_t expectedNs = (int64_t) mLastWriteFrames * 1000000000LL / sampleRate;
+        if (elapsedNs >= 0 && elapsedNs <= expectedNs * 4) {
+            gap = false;
+            int64_t deltaNs = elapsedNs - expectedNs;
+            jitterNs = (uint32_t) (deltaNs < 0 ? -deltaNs : deltaNs);
+        }
+    }
+    mAdaptTs = nowTs;
+    mAdaptTsValid = nowTsValid;
+
+    if (gap) {
+        mReaderUnderrunsSeen = underruns;
+        mWindowMinFill = mMaxFrames;
+        mWindowFrames = 0;
+        mWindowMaxJitterNs = 0;
+        return;
+    }
+
+    if (jitterNs > mWindowMaxJitterNs) {
+        mWindowMaxJitterNs = jitterNs;
+    }
+    if (filled < mWindowMinFill) {
+        mWindowMinFill = filled;
+    }
+    mWindowFrames += mLastWriteFrames;
+
+    size_t setpoint = mSetpoint;
+    if (underruns != mReaderUnderrunsSeen) {
+        // the reader ran dry, back off quickly by a quarter or at least one write
+        mAdaptiveStats.mUnderruns += (uint32_t) (underruns - mReaderUnderrunsSeen);
+        mReaderUnderrunsSeen = underruns;
+        size_t step = setpoint / 4;
+        if (step < mLastWriteFrames) {
+            step = mLastWriteFrames;
+        }
+        setpoint += step;
+        if (setpoint > mMaxSetpoint) {
+            setpoint = mMaxSetpoint;
+        }
+        if (setpoint != mSetpoint) {
+            mAdaptiveStats.mRaises++;
+        }
+    } else if (mWindowFrames >= (size_t) ((uint64_t) sampleRate * kAdaptWindowMs / 1000)) {
+        // keep a margin of the worst jitter plus a quarter of the minimum setpoint,
+        // and converge slowly by lowering the setpoint by half of the excess
+        size_t margin = (size_t) ((uint64_t) mWindowMaxJitterNs * sampleRate / 1000000000) +
+                mMinSetpoint / 4;
+        if (mWindowMinFill > margin) {
+            size_t step = (mWindowMinFill - margin) / 2;
+            setpoint = setpoint > mMinSetpoint + step ? setpoint - step : mMinSetpoint;
+            if (setpoint != mSetpoint) {
+                mAdaptiveStats.mLowers++;
+            }
+        }
+        mAdaptiveStats.mMinFill = mWindowMinFill;
+        mAdaptiveStats.mMaxJitterUs = mWindowMaxJitterNs / 1000;
+        mWindowMinFill = mMaxFrames;
+        mWindowFrames = 0;
+        mWindowMaxJitterNs = 0;
+    } else {
+        return;
+    }
+    if (setpoint != mSetpoint) {
+        ALOGV("adaptive setpoint %u -> %u frames", mSetpoint, setpoint);
+        mSetpoint = setpoint;
+    }
+    mAdaptiveStats.mSetpoint = mSetpoint;
 }
 
 status_t MonoPipe::getNextWriteTimestamp(int64_t *timestamp)
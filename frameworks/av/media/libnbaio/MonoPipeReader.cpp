@@ -17,6 +17,7 @@
 #define LOG_TAG "MonoPipeReader"
 //#define LOG_NDEBUG 0
 
+#include <cutils/atomic.h>
 #include <cutils/compiler.h>
 #include <utils/Log.h>
 #include <media/nbaio/MonoPipeReader.h>
@@ -62,6 +63,10 @@ ssize_t MonoPipeReader::read(void *buffer, size_t count, int64_t readPTS)
         // Uh-oh, looks like we are underflowing.  Update the next read PTS and
         // get out.
         mPipe->updateFrontAndNRPTS(mPipe->mFront, nextReadPTS);
+        // let an adaptive writer know; only the reader writes this value
+        if (count > 0 && mFramesRead > 0) {
+            android_atomic_release_store(mPipe->mReaderUnderruns + 1, &mPipe->mReaderUnderruns);
+        }
         return red;
     }
     if (CC_LIKELY((size_t) red > count)) {
@@ -17,18 +17,110 @@
 #define LOG_TAG "NBLog"
 //#define LOG_NDEBUG 0
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <new>
+#include <binder/IServiceManager.h>
+#include <binder/MemoryBase.h>
+#include <binder/MemoryHeapBase.h>
 #include <cutils/atomic.h>
+#include <media/IMediaLogService.h>
 #include <media/nbaio/NBLog.h>
+#include <private/android_filesystem_config.h>
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
+#include <utils/String8.h>
 
 namespace android {
 
+static const char * const kEventNames[NBLog::EVENT_ID_COUNT] = {
+    "ACodec.emptyBuffer",
+    "ACodec.emptyBufferDone",
+    "ACodec.fillBufferDone",
+    "ACodec.outputDrained",
+    "NuPlayer.feedInput",
+    "NuPlayer.renderBuffer",
+    "NuPlayer.drainAudio",
+    "NuPlayer.drainVideo",
+    "Camera.captureResult",
+    "RecordThread.read",
+};
+
+/*static*/
+const char *NBLog::eventName(int id)
+{
+    if (id < 0 || id >= EVENT_ID_COUNT) {
+        return "unknown";
+    }
+    return kEventNames[id];
+}
+
+// gettid() is a system call, so the thread id is cached per thread
+static pthread_key_t sTidKey;
+static pthread_once_t sTidKeyOnce = PTHREAD_ONCE_INIT;
+
+static void createTidKey()
+{
+    pthread_key_create(&sTidKey, NULL);
+}
+
+static pid_t getCachedTid()
+{
+    pthread_once(&sTidKeyOnce, createTidKey);
+    pid_t tid = (pid_t) (intptr_t) pthread_getspecific(sTidKey);
+    if (tid == 0) {
+        tid = gettid();
+        pthread_setspecific(sTidKey, (void *) (intptr_t) tid);
+    }
+    return tid;
+}
+
+// ---------------------------------------------------------------------------
+
+static const size_t kServiceLogSize = 0x10000;  // the largest size accepted by media.log
+
+static Mutex gServiceWritersLock;
+static KeyedVector<String8, sp<NBLog::Writer> > gServiceWriters;
+
+/*static*/
+sp<NBLog::Writer> NBLog::getServiceWriter(const char *name)
+{
+    Mutex::Autolock _l(gServiceWritersLock);
+    ssize_t index = gServiceWriters.indexOfKey(String8(name));
+    if (index >= 0) {
+        return gServiceWriters.valueAt(index);
+    }
+
+    // media.log only accepts writers from mediaserver, and checkService() doesn't
+    // wait for the service to start
+    sp<Writer> writer;
+    sp<IBinder> binder;
+    if (getuid() == AID_MEDIA) {
+        binder = defaultServiceManager()->checkService(String16("media.log"));
+    }
+    if (binder != 0) {
+        const size_t sharedSize = Timeline::sharedSize(kServiceLogSize);
+        sp<MemoryHeapBase> heap = new MemoryHeapBase(sharedSize, 0, name);
+        if (heap->getHeapID() >= 0) {
+            sp<IMemory> shared = new MemoryBase(heap, 0, sharedSize);
+            writer = new LockedWriter(kServiceLogSize, shared);
+            interface_cast<IMediaLogService>(binder)->registerWriter(shared, kServiceLogSize,
+                    name);
+        }
+    }
+    if (writer == 0) {
+        writer = new Writer();
+    }
+    gServiceWriters.add(String8(name), writer);
+    return writer;
+}
+
 int NBLog::Entry::readAt(size_t offset) const
 {
     // FIXME This is too slow, despite the name it is used during writing
@@ -146,6 +238,52 @@ void NBLog::Writer::logTimestamp(const struct timespec& ts)
     log(EVENT_TIMESTAMP, &ts, sizeof(struct timespec));
 }
 
+/*static*/
+size_t NBLog::Writer::makeIdEvent(IdEvent *event, EventId id, Phase phase, size_t numArgs,
+        int32_t arg0, int32_t arg1)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    event->mTimeNs = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    event->mTid = getCachedTid();
+    event->mId = id;
+    event->mPhase = phase;
+    event->mNumArgs = numArgs;
+    event->mArgs[0] = arg0;
+    event->mArgs[1] = arg1;
+    return offsetof(IdEvent, mArgs) + numArgs * sizeof(int32_t);
+}
+
+void NBLog::Writer::logEvent(EventId id, int32_t arg0, int32_t arg1)
+{
+    if (!mEnabled) {
+        return;
+    }
+    IdEvent event;
+    size_t length = makeIdEvent(&event, id, PHASE_INSTANT, 2, arg0, arg1);
+    log(EVENT_ID, &event, length);
+}
+
+void NBLog::Writer::logBegin(EventId id)
+{
+    if (!mEnabled) {
+        return;
+    }
+    IdEvent event;
+    size_t length = makeIdEvent(&event, id, PHASE_BEGIN, 0, 0, 0);
+    log(EVENT_ID, &event, length);
+}
+
+void NBLog::Writer::logEnd(EventId id, int32_t arg0)
+{
+    if (!mEnabled) {
+        return;
+    }
+    IdEvent event;
+    size_t length = makeIdEvent(&event, id, PHASE_END, 1, arg0, 0);
+    log(EVENT_ID, &event, length);
+}
+
 void NBLog::Writer::log(Event event, const void *data, size_t length)
 {
     if (!mEnabled) {
@@ -157,6 +295,7 @@ void NBLog::Writer::log(Event event, const void *data, size_t length)
     switch (event) {
     case EVENT_STRING:
     case EVENT_TIMESTAMP:
+    case EVENT_ID:
         break;
     case EVENT_RESERVED:
     default:
@@ -175,26 +314,25 @@ void NBLog::Writer::log(const NBLog::Entry *entry, bool trusted)
         log(entry->mEvent, entry->mData, entry->mLength);
         return;
     }
+    // Assemble the entry first, so that it is copied with at most two memcpy
+    // even when it wraps around the end of the circular buffer.
+    uint8_t buffer[255 + 3];
+    const size_t need = entry->mLength + 3;     // mEvent, mLength, data[length], mLength
+    buffer[0] = entry->mEvent;
+    buffer[1] = entry->mLength;
+    memcpy(&buffer[2], entry->mData, entry->mLength);
+    buffer[2 + entry->mLength] = entry->mLength;
+
     size_t rear = mRear & (mSize - 1);
-    size_t written = mSize - rear;      // written = number of bytes that have been written so far
-    size_t need = entry->mLength + 3;   // mEvent, mLength, data[length], mLength
-                                        // need = number of bytes remaining to write
+    size_t written = mSize - rear;      // written = number of bytes written before wraparound
     if (written > need) {
         written = need;
     }
-    size_t i;
-    // FIXME optimize this using memcpy for the data part of the Entry.
-    // The Entry could have a method copyTo(ptr, offset, size) to optimize the copy.
-    for (i = 0; i < written; ++i) {
-        mShared->mBuffer[rear + i] = entry->readAt(i);
-    }
-    if (rear + written == mSize && (need -= written) > 0)  {
-        for (i = 0; i < need; ++i) {
-            mShared->mBuffer[i] = entry->readAt(written + i);
-        }
-        written += need;
+    memcpy(&mShared->mBuffer[rear], buffer, written);
+    if (written < need) {
+        memcpy(mShared->mBuffer, &buffer[written], need - written);
     }
-    android_atomic_release_store(mRear += written, &mShared->mRear);
+    android_atomic_release_store(mRear += need, &mShared->mRear);
 }
 
 bool NBLog::Writer::isEnabled() const
@@ -221,6 +359,11 @@ NBLog::LockedWriter::LockedWriter(size_t size, void *shared)
 {
 }
 
+NBLog::LockedWriter::LockedWriter(size_t size, const sp<IMemory>& iMemory)
+    : Writer(size, iMemory)
+{
+}
+
 void NBLog::LockedWriter::log(const char *string)
 {
     Mutex::Autolock _l(mLock);
@@ -257,6 +400,43 @@ void NBLog::LockedWriter::logTimestamp(const struct timespec& ts)
     Writer::logTimestamp(ts);
 }
 
+// The event is made before taking the lock, so that the clock_gettime() syscall is not
+// done with the lock held.  Reading the enabled flag without the lock is only an early
+// out, log() checks it again.
+
+void NBLog::LockedWriter::logEvent(EventId id, int32_t arg0, int32_t arg1)
+{
+    if (!Writer::isEnabled()) {
+        return;
+    }
+    IdEvent event;
+    size_t length = makeIdEvent(&event, id, PHASE_INSTANT, 2, arg0, arg1);
+    Mutex::Autolock _l(mLock);
+    Writer::log(EVENT_ID, &event, length);
+}
+
+void NBLog::LockedWriter::logBegin(EventId id)
+{
+    if (!Writer::isEnabled()) {
+        return;
+    }
+    IdEvent event;
+    size_t length = makeIdEvent(&event, id, PHASE_BEGIN, 0, 0, 0);
+    Mutex::Autolock _l(mLock);
+    Writer::log(EVENT_ID, &event, length);
+}
+
+void NBLog::LockedWriter::logEnd(EventId id, int32_t arg0)
+{
+    if (!Writer::isEnabled()) {
+        return;
+    }
+    IdEvent event;
+    size_t length = makeIdEvent(&event, id, PHASE_END, 1, arg0, 0);
+    Mutex::Autolock _l(mLock);
+    Writer::log(EVENT_ID, &event, length);
+}
+
 bool NBLog::LockedWriter::isEnabled() const
 {
     Mutex::Autolock _l(mLock);
@@ -282,14 +462,14 @@ NBLog::Reader::Reader(size_t size, const sp<IMemory>& iMemory)
 {
 }
 
-void NBLog::Reader::dump(int fd, size_t indent)
+uint8_t *NBLog::Reader::copyEntries(size_t& avail, size_t& first, size_t& lost, time_t& maxSec)
 {
     int32_t rear = android_atomic_acquire_load(&mShared->mRear);
-    size_t avail = rear - mFront;
+    avail = rear - mFront;
     if (avail == 0) {
-        return;
+        return NULL;
     }
-    size_t lost = 0;
+    lost = 0;
     if (avail > mSize) {
         lost = avail - mSize;
         mFront += lost;
@@ -318,7 +498,7 @@ void NBLog::Reader::dump(int fd, size_t indent)
     Event event;
     size_t length;
     struct timespec ts;
-    time_t maxSec = -1;
+    maxSec = -1;
     while (i >= 3) {
         length = copy[i - 1];
         if (length + 3 > i || copy[i - length - 2] != length) {
@@ -337,8 +517,67 @@ void NBLog::Reader::dump(int fd, size_t indent)
         }
         i -= length + 3;
     }
-    if (i > 0) {
-        lost += i;
+    first = i;
+    lost += i;
+    return copy;
+}
+
+/*static*/
+void NBLog::formatEvent(char *buffer, size_t size, const IdEvent& event)
+{
+    static const char * const kPhases[] = { "", " begin", " end" };
+    int length = snprintf(buffer, size, "%s%s tid=%d", eventName(event.mId),
+            event.mPhase <= PHASE_END ? kPhases[event.mPhase] : " ?", event.mTid);
+    for (size_t j = 0; j < event.mNumArgs && j < IdEvent::kMaxArgs; j++) {
+        if (length < 0 || (size_t) length >= size) {
+            break;
+        }
+        length += snprintf(&buffer[length], size - length, " %d", event.mArgs[j]);
+    }
+}
+
+// Copies the payload of an EVENT_ID entry, returns false if it is corrupt
+static bool readIdEvent(NBLog::IdEvent *event, const void *data, size_t length)
+{
+    if (length < offsetof(NBLog::IdEvent, mArgs) || length > sizeof(NBLog::IdEvent)) {
+        return false;
+    }
+    memset(event, 0, sizeof(*event));
+    memcpy(event, data, length);
+    return event->mNumArgs * sizeof(int32_t) + offsetof(NBLog::IdEvent, mArgs) == length;
+}
+
+void NBLog::Reader::readEvents(Vector<IdEvent>& events)
+{
+    size_t avail, i, lost;
+    time_t maxSec;
+    uint8_t *copy = copyEntries(avail, i, lost, maxSec);
+    if (copy == NULL) {
+        return;
+    }
+    while (i < avail) {
+        size_t length = copy[i + 1];
+        IdEvent event;
+        if ((Event) copy[i] == EVENT_ID && readIdEvent(&event, &copy[i + 2], length)) {
+            events.add(event);
+        }
+        i += length + 3;
+    }
+    delete[] copy;
+}
+
+void NBLog::Reader::dump(int fd, size_t indent)
+{
+    size_t avail, i, lost;
+    time_t maxSec;
+    uint8_t *copy = copyEntries(avail, i, lost, maxSec);
+    if (copy == NULL) {
+        return;
+    }
+    Event event;
+    size_t length;
+    struct timespec ts;
+    if (lost > 0) {
         if (fd >= 0) {
             fdprintf(fd, "%*swarning: lost %u bytes worth of events\n", indent, "", lost);
         } else {
@@ -424,6 +663,21 @@ void NBLog::Reader::dump(int fd, size_t indent)
                         (int) (ts.tv_nsec / 1000000));
             }
             } break;
+        case EVENT_ID: {
+            IdEvent idEvent;
+            if (!readIdEvent(&idEvent, data, length)) {
+                break;
+            }
+            char description[96];
+            formatEvent(description, sizeof(description), idEvent);
+            int sec = (int) (idEvent.mTimeNs / 1000000000LL);
+            int msec = (int) (idEvent.mTimeNs / 1000000LL % 1000);
+            if (fd >= 0) {
+                fdprintf(fd, "%*s[%d.%03d] %s\n", indent, "", sec, msec, description);
+            } else {
+                ALOGI("%*s[%d.%03d] %s", indent, "", sec, msec, description);
+            }
+            } break;
         case EVENT_RESERVED:
         default:
             if (fd >= 0) {
@@ -362,6 +362,7 @@ ACodec::ACodec()
       mSentFormat(false),
       mIsEncoder(false),
       mUseMetadataOnEncoderOutput(false),
+      mReportPartialFrames(false),
       mShutdownInProgress(false),
       mIsConfiguredForAdaptivePlayback(false),
       mEncoderDelay(0),
@@ -372,7 +373,17 @@ ACodec::ACodec()
       mStoreMetaDataInOutputBuffers(false),
       mMetaDataBuffersToSubmit(0),
       mRepeatFrameDelayUs(-1ll),
-      mMaxPtsGapUs(-1l) {
+      mMaxPtsGapUs(-1l),
+      mMaxFps(-1.0f),
+      mDropDuplicateFrames(false),
+      mMaxFrameLatencyUs(-1ll),
+      mTunneledRender(false),
+      mTunnelGeneration(0),
+      mRenderStatsEnabled(false),
+      mRenderMediaTimeUs(-1ll),
+      mRenderRealTimeUs(-1ll) {
+    memset(&mRenderStats, 0, sizeof(mRenderStats));
+
     mUninitializedState = new UninitializedState(this);
     mLoadedState = new LoadedState(this);
     mLoadedToIdleState = new LoadedToIdleState(this);
@@ -389,6 +400,8 @@ ACodec::ACodec()
     mPortEOS[kPortIndexInput] = mPortEOS[kPortIndexOutput] = false;
     mInputEOSResult = OK;
 
+    mNBLogWriter = NBLog::getServiceWriter("MediaPlayerService");
+
     changeState(mUninitializedState);
 }
 
@@ -521,6 +534,18 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                             (4 + sizeof(buffer_handle_t)) : def.nBufferSize;
 
                     info.mData = new ABuffer(ptr, bufSize);
+                } else if ((mQuirks & requiresAllocateBufferBit)
+                        && mOMX->livesLocally(mNode, getpid())) {
+                    // The component's own buffers can be used directly,
+                    // which saves copying to and from backup buffers.
+                    mem.clear();
+
+                    void *ptr;
+                    err = mOMX->allocateBuffer(
+                            mNode, portIndex, def.nBufferSize, &info.mBufferID,
+                            &ptr);
+
+                    info.mData = new ABuffer(ptr, def.nBufferSize);
                 } else if (mQuirks & requiresAllocateBufferBit) {
                     err = mOMX->allocateBufferWithBackup(
                             mNode, portIndex, mem, &info.mBufferID);
@@ -530,6 +555,7 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
 
                 if (mem != NULL) {
                     info.mData = new ABuffer(mem->pointer(), def.nBufferSize);
+                    info.mMemRef = mem;
                 }
 
                 mBuffers[portIndex].push(info);
@@ -551,7 +577,7 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
     for (size_t i = 0; i < mBuffers[portIndex].size(); ++i) {
         const BufferInfo &info = mBuffers[portIndex][i];
 
-        desc->addBuffer(info.mBufferID, info.mData);
+        desc->addBuffer(info.mBufferID, info.mData, info.mMemRef);
     }
 
     notify->setObject("portDesc", desc);
@@ -1031,6 +1057,7 @@ status_t ACodec::configureCodec(
     }
 
     mIsEncoder = encoder;
+    mReportPartialFrames = false;
 
     status_t err = setComponentRole(encoder /* isEncoder */, mime);
 
@@ -1114,6 +1141,20 @@ status_t ACodec::configureCodec(
         if (!msg->findInt64("max-pts-gap-to-encoder", &mMaxPtsGapUs)) {
             mMaxPtsGapUs = -1l;
         }
+
+        if (!msg->findFloat("max-fps-to-encoder", &mMaxFps)) {
+            mMaxFps = -1.0f;
+        }
+
+        int32_t dropDuplicates;
+        mDropDuplicateFrames =
+            msg->findInt32("drop-duplicate-frames", &dropDuplicates)
+                && dropDuplicates != 0;
+
+        if (!msg->findInt64(
+                    "max-frame-latency-to-encoder", &mMaxFrameLatencyUs)) {
+            mMaxFrameLatencyUs = -1ll;
+        }
     }
 
     // Always try to enable dynamic output buffers on native surface
@@ -1183,6 +1224,17 @@ status_t ACodec::configureCodec(
         }
     }
 
+    int32_t tunneled;
+    mTunneledRender = !encoder && video && haveNativeWindow
+            && msg->findInt32("tunneled-render", &tunneled) && tunneled != 0;
+    mRenderMediaTimeUs = -1ll;
+    mRenderRealTimeUs = -1ll;
+    {
+        Mutex::Autolock autoLock(mRenderStatsLock);
+        mRenderStatsEnabled = mTunneledRender;
+        memset(&mRenderStats, 0, sizeof(mRenderStats));
+    }
+
     if (video) {
         if (encoder) {
             err = setupVideoEncoder(mime, msg);
@@ -2256,6 +2308,11 @@ status_t ACodec::setupAVCEncoderParameters(const sp<AMessage> &msg) {
     h264type.bMBAFF = OMX_FALSE;
     h264type.eLoopFilterMode = OMX_VIDEO_AVCLoopFilterEnable;
 
+    int32_t mbsPerSlice;
+    if (msg->findInt32("mbs-per-slice", &mbsPerSlice) && mbsPerSlice > 0) {
+        h264type.nSliceHeaderSpacing = mbsPerSlice;
+    }
+
     err = mOMX->setParameter(
             mNode, OMX_IndexParamVideoAvc, &h264type, sizeof(h264type));
 
@@ -2263,6 +2320,8 @@ status_t ACodec::setupAVCEncoderParameters(const sp<AMessage> &msg) {
         return err;
     }
 
+    mReportPartialFrames = h264type.nSliceHeaderSpacing > 0;
+
     return configureBitrate(bitrate, bitrateMode);
 }
 
@@ -2865,9 +2924,11 @@ status_t ACodec::requestIDRFrame() {
 }
 
 void ACodec::PortDescription::addBuffer(
-        IOMX::buffer_id id, const sp<ABuffer> &buffer) {
+        IOMX::buffer_id id, const sp<ABuffer> &buffer,
+        const sp<IMemory> &mem) {
     mBufferIDs.push_back(id);
     mBuffers.push_back(buffer);
+    mMemories.push_back(mem);
 }
 
 size_t ACodec::PortDescription::countBuffers() {
@@ -2882,6 +2943,10 @@ sp<ABuffer> ACodec::PortDescription::bufferAt(size_t index) const {
     return mBuffers.itemAt(index);
 }
 
+sp<IMemory> ACodec::PortDescription::memoryAt(size_t index) const {
+    return mMemories.itemAt(index);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 ACodec::BaseState::BaseState(ACodec *codec, const sp<AState> &parentState)
@@ -2907,6 +2972,25 @@ bool ACodec::BaseState::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatDeliverTunneledEOS:
+        {
+            sp<AMessage> notify;
+            CHECK(msg->findMessage("notify", &notify));
+
+            int32_t tunnelGeneration;
+            CHECK(msg->findInt32("tunnel-generation", &tunnelGeneration));
+            if (tunnelGeneration == mCodec->mTunnelGeneration) {
+                notify->post();
+            } else {
+                // Flushed in the meantime, take the buffer back unseen.
+                sp<AMessage> reply;
+                CHECK(notify->findMessage("reply", &reply));
+                reply->setInt32("render", 0);
+                onOutputBufferDrained(reply);
+            }
+            break;
+        }
+
         case ACodec::kWhatOMXMessage:
         {
             return onOMXMessage(msg);
@@ -3032,6 +3116,8 @@ bool ACodec::BaseState::onOMXEmptyBufferDone(IOMX::buffer_id bufferID) {
 
     CHECK_EQ((int)info->mStatus, (int)BufferInfo::OWNED_BY_COMPONENT);
     info->mStatus = BufferInfo::OWNED_BY_US;
+    mCodec->mNBLogWriter->logEvent(NBLog::EVENT_ID_ACODEC_EMPTY_BUFFER_DONE,
+            (int32_t)(intptr_t)bufferID);
 
     const sp<AMessage> &bufferMeta = info->mData->meta();
     void *mediaBuffer;
@@ -3216,6 +3302,8 @@ void ACodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                             flags,
                             timeUs),
                          (status_t)OK);
+                mCodec->mNBLogWriter->logEvent(NBLog::EVENT_ID_ACODEC_EMPTY_BUFFER,
+                        (int32_t)(intptr_t)bufferID, buffer->size());
 
                 info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
 
@@ -3302,6 +3390,8 @@ bool ACodec::BaseState::onOMXFillBufferDone(
         void *dataPtr) {
     ALOGV("[%s] onOMXFillBufferDone %p time %lld us, flags = 0x%08lx",
          mCodec->mComponentName.c_str(), bufferID, timeUs, flags);
+    mCodec->mNBLogWriter->logEvent(NBLog::EVENT_ID_ACODEC_FILL_BUFFER_DONE,
+            (int32_t)(intptr_t)bufferID, rangeLength);
 
     ssize_t index;
 
@@ -3377,17 +3467,53 @@ bool ACodec::BaseState::onOMXFillBufferDone(
             }
             info->mData->meta()->setInt64("timeUs", timeUs);
 
-            sp<AMessage> notify = mCodec->mNotify->dup();
-            notify->setInt32("what", ACodec::kWhatDrainThisBuffer);
-            notify->setPointer("buffer-id", info->mBufferID);
-            notify->setBuffer("buffer", info->mData);
-            notify->setInt32("flags", flags);
-
             reply->setPointer("buffer-id", info->mBufferID);
 
-            notify->setMessage("reply", reply);
+            if (mCodec->mTunneledRender && mCodec->mNativeWindow != NULL
+                    && (flags & OMX_BUFFERFLAG_EOS)) {
+                // The client learns about the end of the stream from this
+                // buffer, as in non-tunneled mode, once the frames before
+                // it have been shown. It renders the buffer, if it holds a
+                // frame, when it releases it.
+                sp<AMessage> notify = mCodec->mNotify->dup();
+                notify->setInt32("what", ACodec::kWhatDrainThisBuffer);
+                notify->setPointer("buffer-id", info->mBufferID);
+                notify->setBuffer("buffer", info->mData);
+                notify->setInt32("flags", flags | OMX_BUFFERFLAG_ENDOFFRAME);
+                notify->setMessage("reply", reply);
+
+                sp<AMessage> deliver =
+                    new AMessage(kWhatDeliverTunneledEOS, mCodec->id());
+                deliver->setMessage("notify", notify);
+                deliver->setInt32("tunnel-generation", mCodec->mTunnelGeneration);
+                deliver->post(mCodec->getRenderDelayUs(timeUs));
+            } else if (mCodec->mTunneledRender && mCodec->mNativeWindow != NULL) {
+                // Drain the buffer to ourselves once it is due.
+                int64_t delayUs = mCodec->getRenderDelayUs(timeUs);
+
+                reply->setInt32("render", rangeLength != 0);
+                reply->setInt32("tunnel-generation", mCodec->mTunnelGeneration);
+                reply->setInt64("timeUs", timeUs);
+                reply->setInt64("fill-done-us", ALooper::GetNowUs());
+                reply->setInt64("due-us", ALooper::GetNowUs() + delayUs);
+                reply->post(delayUs);
+            } else {
+                if (!mCodec->mReportPartialFrames) {
+                    // Plenty of components never set this, only trust its
+                    // absence if we asked for slices.
+                    flags |= OMX_BUFFERFLAG_ENDOFFRAME;
+                }
+
+                sp<AMessage> notify = mCodec->mNotify->dup();
+                notify->setInt32("what", ACodec::kWhatDrainThisBuffer);
+                notify->setPointer("buffer-id", info->mBufferID);
+                notify->setBuffer("buffer", info->mData);
+                notify->setInt32("flags", flags);
 
-            notify->post();
+                notify->setMessage("reply", reply);
+
+                notify->post();
+            }
 
             info->mStatus = BufferInfo::OWNED_BY_DOWNSTREAM;
 
@@ -3433,17 +3559,46 @@ void ACodec::BaseState::onOutputBufferDrained(const sp<AMessage> &msg) {
                 mCodec->mNativeWindow.get(), &crop));
     }
 
+    int32_t tunnelGeneration;
+    bool tunneled = msg->findInt32("tunnel-generation", &tunnelGeneration);
+    if (tunneled && tunnelGeneration != mCodec->mTunnelGeneration) {
+        // Decoded before a flush, do not show it.
+        msg->setInt32("render", 0);
+    }
+
     int32_t render;
+    if (!msg->findInt32("render", &render)) {
+        render = 0;
+    }
+    mCodec->mNBLogWriter->logEvent(NBLog::EVENT_ID_ACODEC_OUTPUT_DRAINED,
+            (int32_t)(intptr_t)bufferID, render);
     if (mCodec->mNativeWindow != NULL
-            && msg->findInt32("render", &render) && render != 0
+            && render != 0
             && (info->mData == NULL || info->mData->size() != 0)) {
         // The client wants this buffer to be rendered.
 
+        int64_t timeUs, timestampNs;
+        if (tunneled && msg->findInt64("timeUs", &timeUs)) {
+            native_window_set_buffers_timestamp(
+                    mCodec->mNativeWindow.get(), timeUs * 1000ll);
+        } else if (msg->findInt64("timestampNs", &timestampNs)) {
+            // The client queued the buffer ahead of time and wants it
+            // presented at this (monotonic) time.
+            native_window_set_buffers_timestamp(
+                    mCodec->mNativeWindow.get(), timestampNs);
+        }
+
         status_t err;
         if ((err = mCodec->mNativeWindow->queueBuffer(
                     mCodec->mNativeWindow.get(),
                     info->mGraphicBuffer.get(), -1)) == OK) {
             info->mStatus = BufferInfo::OWNED_BY_NATIVE_WINDOW;
+
+            int64_t fillDoneUs, dueUs;
+            if (tunneled && msg->findInt64("fill-done-us", &fillDoneUs)
+                    && msg->findInt64("due-us", &dueUs)) {
+                mCodec->updateRenderStats(fillDoneUs, dueUs);
+            }
         } else {
             mCodec->signalError(OMX_ErrorUndefined, err);
             info->mStatus = BufferInfo::OWNED_BY_US;
@@ -3711,6 +3866,9 @@ void ACodec::LoadedState::stateEntered() {
     mCodec->mDequeueCounter = 0;
     mCodec->mMetaDataBuffersToSubmit = 0;
     mCodec->mRepeatFrameDelayUs = -1ll;
+    mCodec->mMaxFps = -1.0f;
+    mCodec->mDropDuplicateFrames = false;
+    mCodec->mMaxFrameLatencyUs = -1ll;
     mCodec->mIsConfiguredForAdaptivePlayback = false;
 
     if (mCodec->mShutdownInProgress) {
@@ -3875,6 +4033,52 @@ void ACodec::LoadedState::onCreateInputSurface(
         }
     }
 
+    if (err == OK && mCodec->mMaxFps > 0.0f) {
+        err = mCodec->mOMX->setInternalOption(
+                mCodec->mNode,
+                kPortIndexInput,
+                IOMX::INTERNAL_OPTION_MAX_FPS,
+                &mCodec->mMaxFps,
+                sizeof(mCodec->mMaxFps));
+
+        if (err != OK) {
+            ALOGE("[%s] Unable to configure max fps (err %d)",
+                  mCodec->mComponentName.c_str(),
+                  err);
+        }
+    }
+
+    if (err == OK && mCodec->mDropDuplicateFrames) {
+        err = mCodec->mOMX->setInternalOption(
+                mCodec->mNode,
+                kPortIndexInput,
+                IOMX::INTERNAL_OPTION_DROP_DUPLICATE_FRAMES,
+                &mCodec->mDropDuplicateFrames,
+                sizeof(mCodec->mDropDuplicateFrames));
+
+        if (err != OK) {
+            ALOGE("[%s] Unable to configure dropping of duplicate frames "
+                  "(err %d)",
+                  mCodec->mComponentName.c_str(),
+                  err);
+        }
+    }
+
+    if (err == OK && mCodec->mMaxFrameLatencyUs > 0ll) {
+        err = mCodec->mOMX->setInternalOption(
+                mCodec->mNode,
+                kPortIndexInput,
+                IOMX::INTERNAL_OPTION_MAX_FRAME_LATENCY,
+                &mCodec->mMaxFrameLatencyUs,
+                sizeof(mCodec->mMaxFrameLatencyUs));
+
+        if (err != OK) {
+            ALOGE("[%s] Unable to configure max frame latency (err %d)",
+                  mCodec->mComponentName.c_str(),
+                  err);
+        }
+    }
+
     if (err == OK) {
         notify->setObject("input-surface",
                 new BufferProducerWrapper(bufferProducer));
@@ -4079,6 +4283,9 @@ void ACodec::ExecutingState::submitOutputMetaBuffers() {
 }
 
 void ACodec::ExecutingState::submitRegularOutputBuffers() {
+    // Hand all the buffers to the component in a single call.
+    Vector<IOMX::BufferRequest> requests;
+
     for (size_t i = 0; i < mCodec->mBuffers[kPortIndexOutput].size(); ++i) {
         BufferInfo *info = &mCodec->mBuffers[kPortIndexOutput].editItemAt(i);
 
@@ -4096,11 +4303,19 @@ void ACodec::ExecutingState::submitRegularOutputBuffers() {
         ALOGV("[%s] calling fillBuffer %p",
              mCodec->mComponentName.c_str(), info->mBufferID);
 
-        CHECK_EQ(mCodec->mOMX->fillBuffer(mCodec->mNode, info->mBufferID),
-                 (status_t)OK);
+        IOMX::BufferRequest request;
+        memset(&request, 0, sizeof(request));
+        request.mBuffer = info->mBufferID;
+        request.mIsEmpty = false;
+        requests.push(request);
 
         info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
     }
+
+    if (!requests.isEmpty()) {
+        CHECK_EQ(mCodec->mOMX->submitBuffers(mCodec->mNode, requests),
+                 (status_t)OK);
+    }
 }
 
 void ACodec::ExecutingState::submitOutputBuffers() {
@@ -4172,6 +4387,9 @@ bool ACodec::ExecutingState::onMessageReceived(const sp<AMessage> &msg) {
 
             mActive = false;
 
+            // Frames already scheduled for rendering are dropped.
+            ++mCodec->mTunnelGeneration;
+
             CHECK_EQ(mCodec->mOMX->sendCommand(
                         mCodec->mNode, OMX_CommandFlush, OMX_ALL),
                      (status_t)OK);
@@ -4295,9 +4513,78 @@ status_t ACodec::setParameters(const sp<AMessage> &params) {
         }
     }
 
+    int64_t mediaTimeUs, realTimeUs;
+    if (params->findInt64("render-media-time-us", &mediaTimeUs)
+            && params->findInt64("render-real-time-us", &realTimeUs)) {
+        if (!mTunneledRender) {
+            return INVALID_OPERATION;
+        }
+
+        mRenderMediaTimeUs = mediaTimeUs;
+        mRenderRealTimeUs = realTimeUs;
+    }
+
     return OK;
 }
 
+int64_t ACodec::getRenderDelayUs(int64_t timeUs) const {
+    // Do not hold on to output buffers for longer than this, whatever
+    // the clock says.
+    static const int64_t kMaxRenderDelayUs = 1000000ll;
+
+    if (mRenderMediaTimeUs < 0) {
+        return 0;
+    }
+
+    int64_t delayUs =
+        mRenderRealTimeUs + (timeUs - mRenderMediaTimeUs) - ALooper::GetNowUs();
+
+    if (delayUs < 0) {
+        return 0;
+    } else if (delayUs > kMaxRenderDelayUs) {
+        return kMaxRenderDelayUs;
+    }
+    return delayUs;
+}
+
+void ACodec::updateRenderStats(int64_t fillDoneUs, int64_t dueUs) {
+    // Frames shown later than this after they were due count as late.
+    static const int64_t kLateThresholdUs = 20000ll;
+
+    int64_t nowUs = ALooper::GetNowUs();
+    int64_t latencyUs = nowUs - fillDoneUs;
+
+    Mutex::Autolock autoLock(mRenderStatsLock);
+
+    ++mRenderStats.mNumFrames;
+    mRenderStats.mTotalLatencyUs += latencyUs;
+    if (latencyUs > mRenderStats.mMaxLatencyUs) {
+        mRenderStats.mMaxLatencyUs = latencyUs;
+    }
+    if (nowUs > dueUs + kLateThresholdUs) {
+        ++mRenderStats.mNumLateFrames;
+    }
+
+    if (mRenderStats.mNumFrames % kRenderStatsPeriod == 0) {
+        ALOGV("[%s] rendered %zu frames, decode to display latency "
+              "avg %lld us max %lld us, %zu late",
+              mComponentName.c_str(),
+              mRenderStats.mNumFrames,
+              mRenderStats.mTotalLatencyUs / (int64_t)mRenderStats.mNumFrames,
+              mRenderStats.mMaxLatencyUs,
+              mRenderStats.mNumLateFrames);
+    }
+}
+
+bool ACodec::getRenderStats(RenderStats *stats) const {
+    Mutex::Autolock autoLock(mRenderStatsLock);
+    if (!mRenderStatsEnabled) {
+        return false;
+    }
+    *stats = mRenderStats;
+    return true;
+}
+
 void ACodec::onSignalEndOfInputStream() {
     sp<AMessage> notify = mNotify->dup();
     notify->setInt32("what", ACodec::kWhatSignaledInputEOS);
@@ -32,6 +32,16 @@
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MediaBuffer.h>
 
+#if defined(ARCH_ARM_HAVE_NEON)
+#include <arm_neon.h>
+#define FLAC_COPY_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FLAC_COPY_SIMD 1
+#else
+#define FLAC_COPY_SIMD 0
+#endif
+
 namespace android {
 
 class FLACParser;
@@ -119,8 +129,13 @@ private:
     sp<MetaData> mTrackMetadata;
     bool mInitCheck;
 
-    // media buffers
+    enum {
+        kMinBufferSamples = 8192,
+    };
+
+    // media buffers, each holding up to mMaxBufferSamples samples per channel
     size_t mMaxBufferSize;
+    unsigned mMaxBufferSamples;
     MediaBufferGroup *mGroup;
     void (*mCopy)(short *dst, const int *const *src, unsigned nSamples, unsigned nChannels);
 
@@ -146,6 +161,7 @@ private:
 
     status_t init();
     MediaBuffer *readBuffer(bool doSeek, FLAC__uint64 sample);
+    bool decodeFrame(bool doSeek, FLAC__uint64 sample);
 
     // no copy constructor or assignment
     FLACParser(const FLACParser &);
@@ -378,7 +394,9 @@ void FLACParser::errorCallback(FLAC__StreamDecoderErrorStatus status)
 }
 
 // Copy samples from FLAC native 32-bit non-interleaved to 16-bit interleaved.
-// These are candidates for optimization if needed.
+// The mono and stereo copies of 16 and 24-bit samples handle 4 samples per
+// iteration where SIMD is available. Samples are in range after the shift,
+// so the saturating SSE2 packs give the same result as the scalar casts.
 
 static void copyMono8(short *dst, const int *const *src, unsigned nSamples, unsigned nChannels)
 {
@@ -404,16 +422,68 @@ static void copyMultiCh8(short *dst, const int *const *src, unsigned nSamples, u
     }
 }
 
+template<int shift>
+static inline unsigned copyMonoSimd(short *dst, const int *src, unsigned nSamples)
+{
+    unsigned i = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+    const int32x4_t vshift = vdupq_n_s32(-shift);
+    for (; i + 4 <= nSamples; i += 4) {
+        vst1_s16(dst + i, vmovn_s32(vshlq_s32(vld1q_s32(src + i), vshift)));
+    }
+#elif FLAC_COPY_SIMD
+    for (; i + 8 <= nSamples; i += 8) {
+        __m128i lo = _mm_srai_epi32(_mm_loadu_si128((const __m128i *) (src + i)), shift);
+        __m128i hi = _mm_srai_epi32(_mm_loadu_si128((const __m128i *) (src + i + 4)), shift);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    return i;
+}
+
+template<int shift>
+static inline unsigned copyStereoSimd(short *dst, const int *const *src, unsigned nSamples)
+{
+    unsigned i = 0;
+#if defined(ARCH_ARM_HAVE_NEON)
+    const int32x4_t vshift = vdupq_n_s32(-shift);
+    for (; i + 4 <= nSamples; i += 4) {
+        int16x4x2_t lr;
+        lr.val[0] = vmovn_s32(vshlq_s32(vld1q_s32(src[0] + i), vshift));
+        lr.val[1] = vmovn_s32(vshlq_s32(vld1q_s32(src[1] + i), vshift));
+        vst2_s16(dst + 2 * i, lr);
+    }
+#elif FLAC_COPY_SIMD
+    for (; i + 4 <= nSamples; i += 4) {
+        __m128i l = _mm_srai_epi32(_mm_loadu_si128((const __m128i *) (src[0] + i)), shift);
+        __m128i r = _mm_srai_epi32(_mm_loadu_si128((const __m128i *) (src[1] + i)), shift);
+        _mm_storeu_si128((__m128i *) (dst + 2 * i),
+                _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+    }
+#endif
+    return i;
+}
+
 static void copyMono16(short *dst, const int *const *src, unsigned nSamples, unsigned nChannels)
 {
-    for (unsigned i = 0; i < nSamples; ++i) {
+    unsigned i = 0;
+#if FLAC_COPY_SIMD
+    i = copyMonoSimd<0>(dst, src[0], nSamples);
+    dst += i;
+#endif
+    for (; i < nSamples; ++i) {
         *dst++ = src[0][i];
     }
 }
 
 static void copyStereo16(short *dst, const int *const *src, unsigned nSamples, unsigned nChannels)
 {
-    for (unsigned i = 0; i < nSamples; ++i) {
+    unsigned i = 0;
+#if FLAC_COPY_SIMD
+    i = copyStereoSimd<0>(dst, src, nSamples);
+    dst += 2 * i;
+#endif
+    for (; i < nSamples; ++i) {
         *dst++ = src[0][i];
         *dst++ = src[1][i];
     }
@@ -432,14 +502,24 @@ static void copyMultiCh16(short *dst, const int *const *src, unsigned nSamples,
 
 static void copyMono24(short *dst, const int *const *src, unsigned nSamples, unsigned nChannels)
 {
-    for (unsigned i = 0; i < nSamples; ++i) {
+    unsigned i = 0;
+#if FLAC_COPY_SIMD
+    i = copyMonoSimd<8>(dst, src[0], nSamples);
+    dst += i;
+#endif
+    for (; i < nSamples; ++i) {
         *dst++ = src[0][i] >> 8;
     }
 }
 
 static void copyStereo24(short *dst, const int *const *src, unsigned nSamples, unsigned nChannels)
 {
-    for (unsigned i = 0; i < nSamples; ++i) {
+    unsigned i = 0;
+#if FLAC_COPY_SIMD
+    i = copyStereoSimd<8>(dst, src, nSamples);
+    dst += 2 * i;
+#endif
+    for (; i < nSamples; ++i) {
         *dst++ = src[0][i] >> 8;
         *dst++ = src[1][i] >> 8;
     }
@@ -470,6 +550,7 @@ FLACParser::FLACParser(
       mTrackMetadata(trackMetadata),
       mInitCheck(false),
       mMaxBufferSize(0),
+      mMaxBufferSamples(0),
       mGroup(NULL),
       mCopy(copyTrespass),
       mDecoder(NULL),
@@ -612,7 +693,12 @@ void FLACParser::allocateBuffers()
 {
     CHECK(mGroup == NULL);
     mGroup = new MediaBufferGroup;
-    mMaxBufferSize = getMaxBlockSize() * getChannels() * sizeof(short);
+    // Several short frames are returned per buffer, to lower the per read overhead
+    mMaxBufferSamples = getMaxBlockSize();
+    if (mMaxBufferSamples < kMinBufferSamples) {
+        mMaxBufferSamples = (kMinBufferSamples / getMaxBlockSize()) * getMaxBlockSize();
+    }
+    mMaxBufferSize = mMaxBufferSamples * getChannels() * sizeof(short);
     mGroup->add_buffer(new MediaBuffer(mMaxBufferSize));
 }
 
@@ -623,7 +709,7 @@ void FLACParser::releaseBuffers()
     mGroup = NULL;
 }
 
-MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
+bool FLACParser::decodeFrame(bool doSeek, FLAC__uint64 sample)
 {
     mWriteRequested = true;
     mWriteCompleted = false;
@@ -631,30 +717,38 @@ MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
         // We implement the seek callback, so this works without explicit flush
         if (!FLAC__stream_decoder_seek_absolute(mDecoder, sample)) {
             ALOGE("FLACParser::readBuffer seek to sample %llu failed", sample);
-            return NULL;
+            return false;
         }
         ALOGV("FLACParser::readBuffer seek to sample %llu succeeded", sample);
     } else {
         if (!FLAC__stream_decoder_process_single(mDecoder)) {
             ALOGE("FLACParser::readBuffer process_single failed");
-            return NULL;
+            return false;
         }
     }
     if (!mWriteCompleted) {
         ALOGV("FLACParser::readBuffer write did not complete");
-        return NULL;
+        return false;
     }
     // verify that block header keeps the promises made by STREAMINFO
     unsigned blocksize = mWriteHeader.blocksize;
     if (blocksize == 0 || blocksize > getMaxBlockSize()) {
         ALOGE("FLACParser::readBuffer write invalid blocksize %u", blocksize);
-        return NULL;
+        return false;
     }
     if (mWriteHeader.sample_rate != getSampleRate() ||
         mWriteHeader.channels != getChannels() ||
         mWriteHeader.bits_per_sample != getBitsPerSample()) {
         ALOGE("FLACParser::readBuffer write changed parameters mid-stream");
     }
+    return true;
+}
+
+MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
+{
+    if (!decodeFrame(doSeek, sample)) {
+        return NULL;
+    }
     // acquire a media buffer
     CHECK(mGroup != NULL);
     MediaBuffer *buffer;
@@ -662,18 +756,27 @@ MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
     if (err != OK) {
         return NULL;
     }
-    size_t bufferSize = blocksize * getChannels() * sizeof(short);
-    CHECK(bufferSize <= mMaxBufferSize);
     short *data = (short *) buffer->data();
-    buffer->set_range(0, bufferSize);
-    // copy PCM from FLAC write buffer to our media buffer, with interleaving
-    (*mCopy)(data, mWriteBuffer, blocksize, getChannels());
-    // fill in buffer metadata
+    // fill in buffer metadata from the first frame
     CHECK(mWriteHeader.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
     FLAC__uint64 sampleNumber = mWriteHeader.number.sample_number;
     int64_t timeUs = (1000000LL * sampleNumber) / getSampleRate();
     buffer->meta_data()->setInt64(kKeyTime, timeUs);
     buffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+    // copy PCM from FLAC write buffer to our media buffer, with interleaving,
+    // and append the following frames while a frame of maximum size fits
+    unsigned samples = 0;
+    for (;;) {
+        unsigned blocksize = mWriteHeader.blocksize;
+        (*mCopy)(data + samples * getChannels(), mWriteBuffer, blocksize, getChannels());
+        samples += blocksize;
+        if (samples + getMaxBlockSize() > mMaxBufferSamples || !decodeFrame(false, 0LL)) {
+            break;
+        }
+    }
+    size_t bufferSize = samples * getChannels() * sizeof(short);
+    CHECK(bufferSize <= mMaxBufferSize);
+    buffer->set_range(0, bufferSize);
     return buffer;
 }
 
@@ -581,6 +581,10 @@ status_t MP3Source::read(
 }
 
 sp<MetaData> MP3Extractor::getMetaData() {
+    return getMetaDataWithFlags(kIncludeAlbumArt);
+}
+
+sp<MetaData> MP3Extractor::getMetaDataWithFlags(uint32_t flags) {
     sp<MetaData> meta = new MetaData;
 
     if (mInitCheck != OK) {
@@ -634,6 +638,11 @@ sp<MetaData> MP3Extractor::getMetaData() {
         meta->setCString(kMap[i].key, s);
     }
 
+    if (!(flags & kIncludeAlbumArt)) {
+        // The artwork frame is the large one, ID3 only reads it on access
+        return meta;
+    }
+
     size_t dataSize;
     String8 mime;
     const void *data = id3.getAlbumArt(&dataSize, &mime);
@@ -111,6 +111,26 @@ private:
     status_t parseSampleAuxiliaryInformationSizes(off64_t offset, off64_t size);
     status_t parseSampleAuxiliaryInformationOffsets(off64_t offset, off64_t size);
 
+    // Seek index of the fragments that have samples of this track, in increasing time order.
+    // It is built from the sidx box if there is one.  Otherwise it is built on the fly:
+    // every fragment reached by sequential reading is added, and a seek beyond the last
+    // indexed fragment scans the moof boxes from there, once.  Seeks are then a binary search.
+    struct FragmentIndexEntry {
+        uint64_t mTime;         // start time in mTimescale units
+        off64_t mMoofOffset;
+    };
+    Vector<FragmentIndexEntry> mFragmentIndex;
+    bool mFragmentIndexComplete;    // all the fragments of the file are indexed
+    uint64_t mFragmentIndexEndTime; // end of the last fragment, if mFragmentIndexComplete
+    off64_t mFragmentScanOffset;    // first moof not indexed yet, if !mFragmentIndexComplete
+    uint64_t mFragmentScanTime;     // and its start time
+
+    void initFragmentIndex();
+    void indexCurrentFragment(off64_t moofOffset, uint64_t time);
+    void extendFragmentIndex(uint64_t time);
+    bool findFragment(int64_t seekTimeUs, ReadOptions::SeekMode mode,
+            uint64_t *time, off64_t *moofOffset);
+
     struct TrackFragmentHeaderInfo {
         enum Flags {
             kBaseDataOffsetPresent         = 0x01,
@@ -2400,7 +2420,11 @@ MPEG4Source::MPEG4Source(
       mGroup(NULL),
       mBuffer(NULL),
       mWantsNALFragments(false),
-      mSrcBuffer(NULL) {
+      mSrcBuffer(NULL),
+      mFragmentIndexComplete(false),
+      mFragmentIndexEndTime(0),
+      mFragmentScanOffset(firstMoofOffset),
+      mFragmentScanTime(0) {
 
     mFormat->findInt32(kKeyCryptoMode, &mCryptoMode);
     mDefaultIVSize = 0;
@@ -2438,11 +2462,115 @@ MPEG4Source::MPEG4Source(
     CHECK(format->findInt32(kKeyTrackID, &mTrackId));
 
     if (mFirstMoofOffset != 0) {
+        initFragmentIndex();
         off64_t offset = mFirstMoofOffset;
         parseChunk(&offset);
+        indexCurrentFragment(mFirstMoofOffset, 0);
     }
 }
 
+void MPEG4Source::initFragmentIndex() {
+    if (mSegments.size() == 0) {
+        // built as the fragments are parsed
+        return;
+    }
+
+    uint64_t timeUs = 0;
+    off64_t offset = mFirstMoofOffset;
+    for (size_t i = 0; i < mSegments.size(); i++) {
+        FragmentIndexEntry entry;
+        entry.mTime = timeUs * mTimescale / 1000000ll;
+        entry.mMoofOffset = offset;
+        mFragmentIndex.add(entry);
+        timeUs += mSegments[i].mDurationUs;
+        offset += mSegments[i].mSize;
+    }
+    mFragmentIndexComplete = true;
+    mFragmentIndexEndTime = timeUs * mTimescale / 1000000ll;
+}
+
+// Called after the fragment at moofOffset, which starts at time, has been parsed.
+void MPEG4Source::indexCurrentFragment(off64_t moofOffset, uint64_t time) {
+    if (mFragmentIndexComplete || moofOffset != mFragmentScanOffset) {
+        return;
+    }
+    if (mNextMoofOffset <= moofOffset) {
+        // not a fragment, so the end of the fragments
+        mFragmentIndexComplete = true;
+        mFragmentIndexEndTime = mFragmentScanTime;
+        return;
+    }
+
+    uint64_t duration = 0;
+    for (size_t i = 0; i < mCurrentSamples.size(); i++) {
+        duration += mCurrentSamples[i].duration;
+    }
+    // a fragment can hold samples of other tracks only
+    if (mCurrentSamples.size() > 0) {
+        FragmentIndexEntry entry;
+        entry.mTime = time;
+        entry.mMoofOffset = moofOffset;
+        mFragmentIndex.add(entry);
+    }
+    mFragmentScanOffset = mNextMoofOffset;
+    mFragmentScanTime = time + duration;
+}
+
+// Scan the fragments that are not indexed yet, until one starts after time.
+void MPEG4Source::extendFragmentIndex(uint64_t time) {
+    while (!mFragmentIndexComplete
+            && (mFragmentIndex.isEmpty() || mFragmentIndex.top().mTime <= time)) {
+        off64_t moofOffset = mFragmentScanOffset;
+        off64_t offset = moofOffset;
+        mCurrentMoofOffset = moofOffset;
+        mCurrentSamples.clear();
+        mCurrentSampleIndex = 0;
+        mNextMoofOffset = moofOffset;
+        if (parseChunk(&offset) != OK) {
+            mNextMoofOffset = moofOffset;
+        }
+        indexCurrentFragment(moofOffset, mFragmentScanTime);
+    }
+}
+
+bool MPEG4Source::findFragment(int64_t seekTimeUs, ReadOptions::SeekMode mode,
+        uint64_t *time, off64_t *moofOffset) {
+    uint64_t seekTime = seekTimeUs > 0 ? seekTimeUs * mTimescale / 1000000ll : 0;
+    extendFragmentIndex(seekTime);
+    if (mFragmentIndex.isEmpty()) {
+        return false;
+    }
+
+    // last fragment starting at or before seekTime, or the first one
+    size_t left = 0;
+    size_t right = mFragmentIndex.size();
+    while (right - left > 1) {
+        size_t center = left + (right - left) / 2;
+        if (mFragmentIndex[center].mTime <= seekTime) {
+            left = center;
+        } else {
+            right = center;
+        }
+    }
+
+    // seeking past the end of the last fragment ends up at its start
+    if (left + 1 < mFragmentIndex.size()) {
+        uint64_t start = mFragmentIndex[left].mTime;
+        uint64_t end = mFragmentIndex[left + 1].mTime;
+        if ((mode == ReadOptions::SEEK_NEXT_SYNC && seekTime > start) ||
+                (mode == ReadOptions::SEEK_CLOSEST_SYNC && seekTime > start &&
+                seekTime - start > (end > seekTime ? end - seekTime : 0))) {
+            // requested next sync, or closest sync and it was closer to the end of
+            // this fragment
+            ++left;
+        }
+    }
+
+    *time = mFragmentIndex[left].mTime;
+    *moofOffset = mFragmentIndex[left].mMoofOffset;
+    return true;
+}
+
 MPEG4Source::~MPEG4Source() {
     if (mStarted) {
         stop();
@@ -3341,32 +3469,15 @@ status_t MPEG4Source::fragmentedRead(
     ReadOptions::SeekMode mode;
     if (options && options->getSeekTo(&seekTimeUs, &mode)) {
 
-        int numSidxEntries = mSegments.size();
-        if (numSidxEntries != 0) {
-            int64_t totalTime = 0;
-            off64_t totalOffset = mFirstMoofOffset;
-            for (int i = 0; i < numSidxEntries; i++) {
-                const SidxEntry *se = &mSegments[i];
-                if (totalTime + se->mDurationUs > seekTimeUs) {
-                    // The requested time is somewhere in this segment
-                    if ((mode == ReadOptions::SEEK_NEXT_SYNC) ||
-                        (mode == ReadOptions::SEEK_CLOSEST_SYNC &&
-                        (seekTimeUs - totalTime) > (totalTime + se->mDurationUs - seekTimeUs))) {
-                        // requested next sync, or closest sync and it was closer to the end of
-                        // this segment
-                        totalTime += se->mDurationUs;
-                        totalOffset += se->mSize;
-                    }
-                    break;
-                }
-                totalTime += se->mDurationUs;
-                totalOffset += se->mSize;
-            }
-        mCurrentMoofOffset = totalOffset;
-        mCurrentSamples.clear();
-        mCurrentSampleIndex = 0;
-        parseChunk(&totalOffset);
-        mCurrentTime = totalTime * mTimescale / 1000000ll;
+        uint64_t fragmentTime;
+        off64_t moofOffset;
+        if (findFragment(seekTimeUs, mode, &fragmentTime, &moofOffset)) {
+            off64_t offset = moofOffset;
+            mCurrentMoofOffset = moofOffset;
+            mCurrentSamples.clear();
+            mCurrentSampleIndex = 0;
+            parseChunk(&offset);
+            mCurrentTime = fragmentTime;
         }
 
         if (mBuffer != NULL) {
@@ -3393,6 +3504,7 @@ status_t MPEG4Source::fragmentedRead(
             mCurrentSamples.clear();
             mCurrentSampleIndex = 0;
             parseChunk(&nextMoof);
+            indexCurrentFragment(mCurrentMoofOffset, mCurrentTime);
                 if (mCurrentSampleIndex >= mCurrentSamples.size()) {
                     return ERROR_END_OF_STREAM;
                 }
@@ -35,6 +35,7 @@
 #include <cutils/properties.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -50,6 +51,19 @@ static const uint8_t kNalUnitTypeSeqParamSet = 0x07;
 static const uint8_t kNalUnitTypePicParamSet = 0x08;
 static const int64_t kInitialDelayTimeUs     = 700000LL;
 
+// Size of the buffer sample data is collected in before being written out.
+// Page aligned so that the kernel can copy it efficiently.
+static const size_t kWriteBufferSize = 1024 * 1024;
+static const size_t kWriteBufferAlignment = 4096;
+
+// Writes taking longer than this are likely to back up into the encoders.
+static const int64_t kSlowWriteTimeUs = 250000LL;
+
+// Sample flags in movie fragments: sample_depends_on and
+// sample_is_non_sync_sample.
+static const uint32_t kSyncSampleFlags = 0x02000000;
+static const uint32_t kNonSyncSampleFlags = 0x01010000;
+
 class MPEG4Writer::Track {
 public:
     Track(MPEG4Writer *owner, const sp<MediaSource> &source, size_t trackId);
@@ -72,6 +86,13 @@ public:
     int32_t getTrackId() const { return mTrackId; }
     status_t dump(int fd, const Vector<String16>& args) const;
 
+    // Fragmented files only
+    bool hasCodecSpecificData() const;
+    void writeTrexBox();
+    size_t getTrafBoxSize(const Chunk &chunk) const;
+    void writeTrafBox(
+            const Chunk &chunk, int32_t dataOffset, int64_t movieStartTimeUs);
+
 private:
     enum {
         kMaxCttsOffsetTimeUs = 1000000LL,  // 1 second
@@ -223,6 +244,15 @@ private:
 
     List<MediaBuffer *> mChunkSamples;
 
+    // The samples in mChunkSamples as trun entries in fragmented files,
+    // getRunEntrySize() values each.
+    Vector<uint32_t>    mRunEntries;
+    int64_t             mFragmentStartTimeUs;
+    int64_t             mFragmentStartTicks;
+
+    uint32_t            mNumSamples;
+    bool                mGotSyncSample;
+
     bool                mSamplesHaveSameSize;
     ListTableEntries<uint32_t> *mStszTableEntries;
 
@@ -301,6 +331,13 @@ private:
     void addOneSttsTableEntry(size_t sampleCount, int32_t timescaledDur);
     void addOneCttsTableEntry(size_t sampleCount, int32_t timescaledDur);
 
+    // Fragmented files only
+    size_t getRunEntrySize() const { return mIsAudio ? 2 : 4; }
+    void addFragmentSample(
+            MediaBuffer *sample, size_t sampleSize, int64_t timestampUs,
+            int64_t durationTicks, bool isSync, int64_t cttsOffsetTimeUs);
+    void bufferFragment();
+
     bool isTrackMalFormed() const;
     void sendTrackSummary(bool hasMultipleTracks);
 
@@ -350,7 +387,19 @@ MPEG4Writer::MPEG4Writer(const char *filename)
       mLatitudex10000(0),
       mLongitudex10000(0),
       mAreGeoTagsAvailable(false),
-      mStartTimeOffsetMs(-1) {
+      mStartTimeOffsetMs(-1),
+      mFragmentDurationUs(0),
+      mMoovBoxWritten(false),
+      mFragmentSequenceNumber(0),
+      mMovieStartTimestampUs(0),
+      mFragmentDurationOffset(0),
+      mWriteBuffer(NULL),
+      mWriteBufferLength(0),
+      mWriteBufferOffset(0),
+      mNumWrites(0),
+      mNumBytesWritten(0),
+      mTotalWriteTimeUs(0),
+      mMaxWriteTimeUs(0) {
 
     mFd = open(filename, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
     if (mFd >= 0) {
@@ -375,7 +424,19 @@ MPEG4Writer::MPEG4Writer(int fd)
       mLatitudex10000(0),
       mLongitudex10000(0),
       mAreGeoTagsAvailable(false),
-      mStartTimeOffsetMs(-1) {
+      mStartTimeOffsetMs(-1),
+      mFragmentDurationUs(0),
+      mMoovBoxWritten(false),
+      mFragmentSequenceNumber(0),
+      mMovieStartTimestampUs(0),
+      mFragmentDurationOffset(0),
+      mWriteBuffer(NULL),
+      mWriteBufferLength(0),
+      mWriteBufferOffset(0),
+      mNumWrites(0),
+      mNumBytesWritten(0),
+      mTotalWriteTimeUs(0),
+      mMaxWriteTimeUs(0) {
 }
 
 MPEG4Writer::~MPEG4Writer() {
@@ -621,6 +682,14 @@ status_t MPEG4Writer::start(MetaData *param) {
     CHECK_GT(mTimeScale, 0);
     ALOGV("movie time scale: %d", mTimeScale);
 
+    int64_t fragmentDurationUs;
+    if (param &&
+        param->findInt64(kKeyMovieFragmentDuration, &fragmentDurationUs) &&
+        fragmentDurationUs > 0) {
+        mFragmentDurationUs = fragmentDurationUs;
+        ALOGI("Writing a movie fragment every %lld us", mFragmentDurationUs);
+    }
+
     /*
      * When the requested file size limit is small, the priority
      * is to meet the file size limit requirement, rather than
@@ -628,7 +697,8 @@ status_t MPEG4Writer::start(MetaData *param) {
      * whether the actual recorded file is streamable or not.
      */
     mStreamableFile =
-        (mMaxFileSizeLimitBytes != 0 &&
+        (!isFragmented() &&
+         mMaxFileSizeLimitBytes != 0 &&
          mMaxFileSizeLimitBytes >= kMinStreamableFileSizeInBytes);
 
     /*
@@ -695,7 +765,12 @@ status_t MPEG4Writer::start(MetaData *param) {
 
     mOffset = mMdatOffset;
     lseek64(mFd, mMdatOffset, SEEK_SET);
-    if (mUse32BitOffset) {
+    if (isFragmented()) {
+        // The moov box follows once the codec specific data of all
+        // tracks is known, see writeFragmentedMoovBox().
+        mMoovBoxWritten = false;
+        mFragmentSequenceNumber = 0;
+    } else if (mUse32BitOffset) {
         write("????mdat", 8);
     } else {
         write("\x00\x00\x00\x01mdat????????", 16);
@@ -807,6 +882,17 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    flushWriteBuffer();
+    free(mWriteBuffer);
+    mWriteBuffer = NULL;
+
+    if (mNumWrites > 0) {
+        ALOGD("Wrote %lld bytes of samples in %d writes, "
+              "average %lld us, max %lld us",
+              mNumBytesWritten, mNumWrites,
+              mTotalWriteTimeUs / mNumWrites, mMaxWriteTimeUs);
+    }
+
     close(mFd);
     mFd = -1;
     mInitCheck = NO_INIT;
@@ -852,6 +938,7 @@ status_t MPEG4Writer::reset() {
     }
 
     stopWriterThread();
+    flushWriteBuffer();
 
     // Do not write out movie header on error.
     if (err != OK) {
@@ -859,6 +946,17 @@ status_t MPEG4Writer::reset() {
         return err;
     }
 
+    if (isFragmented()) {
+        // All that is left to do is filling in the movie duration.
+        if (mMoovBoxWritten) {
+            uint64_t duration = (maxDurationUs * mTimeScale + 5E5) / 1E6;
+            duration = hton64(duration);
+            pwrite64(mFd, &duration, 8, mFragmentDurationOffset);
+        }
+        release();
+        return err;
+    }
+
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
         lseek64(mFd, mMdatOffset, SEEK_SET);
@@ -964,9 +1062,26 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
         it != mTracks.end(); ++it, ++id) {
         (*it)->writeTrackHeader(mUse32BitOffset);
     }
+    if (isFragmented()) {
+        writeMvexBox();
+    }
     endBox();  // moov
 }
 
+void MPEG4Writer::writeMvexBox() {
+    beginBox("mvex");
+    beginBox("mehd");
+    writeInt32(0x01000000);    // version=1, flags=0
+    mFragmentDurationOffset = mOffset;
+    writeInt64(0);             // fragment duration, filled in by reset()
+    endBox();  // mehd
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        (*it)->writeTrexBox();
+    }
+    endBox();  // mvex
+}
+
 void MPEG4Writer::writeFtypBox(MetaData *param) {
     beginBox("ftyp");
 
@@ -1027,15 +1142,91 @@ void MPEG4Writer::unlock() {
     mLock.unlock();
 }
 
+void MPEG4Writer::pwriteFully_l(
+        const void *data, size_t size, off64_t offset) {
+    int64_t startTimeUs = systemTime() / 1000;
+
+    const uint8_t *ptr = (const uint8_t *)data;
+    while (size > 0) {
+        ssize_t n = pwrite64(mFd, ptr, size, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ALOGE("Failed to write %d bytes at %lld: %s",
+                  size, offset, strerror(errno));
+            break;
+        }
+
+        ptr += n;
+        size -= n;
+        offset += n;
+        mNumBytesWritten += n;
+    }
+
+    int64_t writeTimeUs = systemTime() / 1000 - startTimeUs;
+    if (writeTimeUs > kSlowWriteTimeUs) {
+        ALOGW("Writing sample data took %lld us", writeTimeUs);
+    }
+
+    ++mNumWrites;
+    mTotalWriteTimeUs += writeTimeUs;
+    if (writeTimeUs > mMaxWriteTimeUs) {
+        mMaxWriteTimeUs = writeTimeUs;
+    }
+}
+
+bool MPEG4Writer::flushWriteBuffer() {
+    Mutex::Autolock autoLock(mWriteBufferLock);
+
+    if (mWriteBufferLength == 0) {
+        return false;
+    }
+
+    pwriteFully_l(mWriteBuffer, mWriteBufferLength, mWriteBufferOffset);
+    mWriteBufferLength = 0;
+
+    return true;
+}
+
+void MPEG4Writer::writeSampleData(const void *data, size_t size) {
+    Mutex::Autolock autoLock(mWriteBufferLock);
+
+    if (mWriteBuffer == NULL) {
+        void *buffer;
+        if (posix_memalign(&buffer, kWriteBufferAlignment, kWriteBufferSize)) {
+            buffer = NULL;
+        }
+        mWriteBuffer = (uint8_t *)buffer;
+    }
+
+    if (mWriteBufferLength > 0
+            && (mWriteBufferLength + size > kWriteBufferSize
+                || mWriteBufferOffset + mWriteBufferLength != mOffset)) {
+        pwriteFully_l(mWriteBuffer, mWriteBufferLength, mWriteBufferOffset);
+        mWriteBufferLength = 0;
+    }
+
+    if (mWriteBuffer == NULL || size > kWriteBufferSize) {
+        pwriteFully_l(data, size, mOffset);
+    } else {
+        if (mWriteBufferLength == 0) {
+            mWriteBufferOffset = mOffset;
+        }
+        memcpy(mWriteBuffer + mWriteBufferLength, data, size);
+        mWriteBufferLength += size;
+    }
+
+    mOffset += size;
+}
+
 off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
     off64_t old_offset = mOffset;
 
-    ::write(mFd,
+    writeSampleData(
           (const uint8_t *)buffer->data() + buffer->range_offset(),
           buffer->range_length());
 
-    mOffset += buffer->range_length();
-
     return old_offset;
 }
 
@@ -1059,31 +1250,24 @@ off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
     size_t length = buffer->range_length();
 
     if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
-
-        mOffset += length + 4;
+        uint8_t x[4];
+        x[0] = length >> 24;
+        x[1] = (length >> 16) & 0xff;
+        x[2] = (length >> 8) & 0xff;
+        x[3] = length & 0xff;
+        writeSampleData(x, 4);
     } else {
         CHECK_LT(length, 65536);
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
-        mOffset += length + 2;
+        uint8_t x[2];
+        x[0] = length >> 8;
+        x[1] = length & 0xff;
+        writeSampleData(x, 2);
     }
 
+    writeSampleData(
+            (const uint8_t *)buffer->data() + buffer->range_offset(), length);
+
     return old_offset;
 }
 
@@ -1344,6 +1528,10 @@ MPEG4Writer::Track::Track(
       mTrackId(trackId),
       mTrackDurationUs(0),
       mEstimatedTrackSizeBytes(0),
+      mFragmentStartTimeUs(0),
+      mFragmentStartTicks(0),
+      mNumSamples(0),
+      mGotSyncSample(false),
       mSamplesHaveSameSize(true),
       mStszTableEntries(new ListTableEntries<uint32_t>(1000, 1)),
       mStcoTableEntries(new ListTableEntries<uint32_t>(1000, 1)),
@@ -1378,7 +1566,10 @@ void MPEG4Writer::Track::updateTrackSizeEstimate() {
     int64_t stszBoxSizeBytes = mSamplesHaveSameSize? 4: (mStszTableEntries->count() * 4);
 
     mEstimatedTrackSizeBytes = mMdatSizeBytes;  // media data size
-    if (!mOwner->isFileStreamable()) {
+    if (mOwner->isFragmented()) {
+        // The trun entries, the rest of the fragment headers is small
+        mEstimatedTrackSizeBytes += mNumSamples * getRunEntrySize() * 4;
+    } else if (!mOwner->isFileStreamable()) {
         // Reserved free space is not large enough to hold
         // all meta data and thus wasted.
         mEstimatedTrackSizeBytes += mStscTableEntries->count() * 12 +  // stsc box size
@@ -1554,6 +1745,11 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     ALOGV("writeChunkToFile: %lld from %s track",
         chunk->mTimeStampUs, chunk->mTrack->isAudio()? "audio": "video");
 
+    if (isFragmented()) {
+        writeFragment(chunk);
+        return;
+    }
+
     int32_t isFirstSample = true;
     while (!chunk->mSamples.empty()) {
         List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
@@ -1574,6 +1770,80 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     chunk->mSamples.clear();
 }
 
+bool MPEG4Writer::writeFragmentedMoovBox() {
+    for (List<Track *>::iterator it = mTracks.begin();
+         it != mTracks.end(); ++it) {
+        if (!(*it)->hasCodecSpecificData()) {
+            return false;
+        }
+    }
+
+    // The boxes are written straight to the file, which is behind the
+    // sample data still collected in mWriteBuffer.
+    lseek64(mFd, mOffset, SEEK_SET);
+    writeMoovBox(0);
+
+    // All tracks have buffered their first samples by now.
+    mMovieStartTimestampUs = mStartTimestampUs;
+    mMoovBoxWritten = true;
+    return true;
+}
+
+void MPEG4Writer::writeFragment(Chunk* chunk) {
+    Track *track = chunk->mTrack;
+
+    if (!mMoovBoxWritten && !writeFragmentedMoovBox()) {
+        ALOGE("Dropping %s fragment without codec specific data",
+              track->isAudio()? "audio": "video");
+
+        while (!chunk->mSamples.empty()) {
+            List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
+            (*it)->release();
+            chunk->mSamples.erase(it);
+        }
+        return;
+    }
+
+    size_t dataSize = 0;
+    for (List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
+         it != chunk->mSamples.end(); ++it) {
+        dataSize += (*it)->range_length();
+        if (track->isAvc()) {
+            dataSize += mUse4ByteNalLength ? 4 : 2;
+        }
+    }
+
+    off64_t moofOffset = mOffset;
+    size_t moofSize = 24 + track->getTrafBoxSize(*chunk);
+
+    lseek64(mFd, mOffset, SEEK_SET);
+    beginBox("moof");
+    beginBox("mfhd");
+    writeInt32(0);             // version=0, flags=0
+    writeInt32(++mFragmentSequenceNumber);
+    endBox();  // mfhd
+    track->writeTrafBox(*chunk, moofSize + 8, mMovieStartTimestampUs);
+    endBox();  // moof
+    CHECK_EQ(mOffset - moofOffset, (off64_t)moofSize);
+
+    writeInt32(8 + dataSize);
+    writeFourcc("mdat");
+
+    while (!chunk->mSamples.empty()) {
+        List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
+
+        if (track->isAvc()) {
+            addLengthPrefixedSample_l(*it);
+        } else {
+            addSample_l(*it);
+        }
+
+        (*it)->release();
+        (*it) = NULL;
+        chunk->mSamples.erase(it);
+    }
+}
+
 void MPEG4Writer::writeAllChunks() {
     ALOGV("writeAllChunks");
     size_t outstandingChunks = 0;
@@ -1592,6 +1862,18 @@ void MPEG4Writer::writeAllChunks() {
 bool MPEG4Writer::findChunkToWrite(Chunk *chunk) {
     ALOGV("findChunkToWrite");
 
+    // Writing the first fragment means writing the moov box, which needs
+    // the codec specific data of all tracks. It is there once they have
+    // buffered some samples.
+    if (isFragmented() && !mMoovBoxWritten && !mDone) {
+        for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+             it != mChunkInfos.end(); ++it) {
+            if (it->mChunks.empty() && !it->mTrack->reachedEOS()) {
+                return false;
+            }
+        }
+    }
+
     int64_t minTimestampUs = 0x7FFFFFFFFFFFFFFFLL;
     Track *track = NULL;
     for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
@@ -1645,7 +1927,15 @@ void MPEG4Writer::threadFunc() {
         bool chunkFound = false;
 
         while (!mDone && !(chunkFound = findChunkToWrite(&chunk))) {
-            mChunkReadyCondition.wait(mLock);
+            // Nothing else to do, get the collected sample data out of the
+            // way before more chunks arrive.
+            mLock.unlock();
+            bool flushed = flushWriteBuffer();
+            mLock.lock();
+
+            if (!flushed) {
+                mChunkReadyCondition.wait(mLock);
+            }
         }
 
         // In real time recording mode, write without holding the lock in order
@@ -1749,6 +2039,8 @@ status_t MPEG4Writer::Track::start(MetaData *params) {
     mEstimatedTrackSizeBytes = 0;
     mMdatSizeBytes = 0;
     mMaxChunkDurationUs = 0;
+    mNumSamples = 0;
+    mGotSyncSample = false;
 
     pthread_create(&mThread, &attr, ThreadWrapper, this);
     pthread_attr_destroy(&attr);
@@ -2185,7 +2477,7 @@ status_t MPEG4Writer::Track::threadEntry() {
         CHECK(meta_data->findInt64(kKeyTime, &timestampUs));
 
 ////////////////////////////////////////////////////////////////////////////////
-        if (mStszTableEntries->count() == 0) {
+        if (mNumSamples == 0) {
             mFirstSampleTimeRealUs = systemTime() / 1000;
             mStartTimestampUs = timestampUs;
             mOwner->setStartTimestampUs(mStartTimestampUs);
@@ -2223,7 +2515,9 @@ status_t MPEG4Writer::Track::threadEntry() {
             currCttsOffsetTimeTicks =
                     (cttsOffsetTimeUs * mTimeScale + 500000LL) / 1000000LL;
             CHECK_LE(currCttsOffsetTimeTicks, 0x0FFFFFFFFLL);
-            if (mStszTableEntries->count() == 0) {
+            if (mOwner->isFragmented()) {
+                // The offsets go into the trun entries
+            } else if (mStszTableEntries->count() == 0) {
                 // Force the first ctts table entry to have one single entry
                 // so that we can do adjustment for the initial track start
                 // time offset easily in writeCttsBox().
@@ -2241,7 +2535,7 @@ status_t MPEG4Writer::Track::threadEntry() {
             }
 
             // Update ctts time offset range
-            if (mStszTableEntries->count() == 0) {
+            if (mNumSamples == 0) {
                 mMinCttsOffsetTimeUs = currCttsOffsetTimeTicks;
                 mMaxCttsOffsetTimeUs = currCttsOffsetTimeTicks;
             } else {
@@ -2281,7 +2575,14 @@ status_t MPEG4Writer::Track::threadEntry() {
             return UNKNOWN_ERROR;
         }
 
-        mStszTableEntries->add(htonl(sampleSize));
+        if (mOwner->isFragmented()) {
+            addFragmentSample(copy, sampleSize, timestampUs,
+                    currDurationTicks, isSync, cttsOffsetTimeUs);
+            copy = NULL;
+        } else {
+            mStszTableEntries->add(htonl(sampleSize));
+        }
+        ++mNumSamples;
         if (mStszTableEntries->count() > 2) {
 
             // Force the first sample to have its own stts entry so that
@@ -2307,7 +2608,10 @@ status_t MPEG4Writer::Track::threadEntry() {
         lastTimestampUs = timestampUs;
 
         if (isSync != 0) {
-            addOneStssTableEntry(mStszTableEntries->count());
+            mGotSyncSample = true;
+            if (!mOwner->isFragmented()) {
+                addOneStssTableEntry(mStszTableEntries->count());
+            }
         }
 
         if (mTrackingProgressStatus) {
@@ -2316,6 +2620,9 @@ status_t MPEG4Writer::Track::threadEntry() {
             }
             trackProgressStatus(timestampUs);
         }
+        if (mOwner->isFragmented()) {
+            continue;
+        }
         if (!hasMultipleTracks) {
             off64_t offset = mIsAvc? mOwner->addLengthPrefixedSample_l(copy)
                                  : mOwner->addSample_l(copy);
@@ -2366,7 +2673,9 @@ status_t MPEG4Writer::Track::threadEntry() {
     mOwner->trackProgressStatus(mTrackId, -1, err);
 
     // Last chunk
-    if (!hasMultipleTracks) {
+    if (mOwner->isFragmented()) {
+        // Buffered below, once the duration of the last sample is set
+    } else if (!hasMultipleTracks) {
         addOneStscTableEntry(1, mStszTableEntries->count());
     } else if (!mChunkSamples.empty()) {
         addOneStscTableEntry(++nChunks, mChunkSamples.size());
@@ -2376,14 +2685,20 @@ status_t MPEG4Writer::Track::threadEntry() {
     // We don't really know how long the last frame lasts, since
     // there is no frame time after it, just repeat the previous
     // frame's duration.
-    if (mStszTableEntries->count() == 1) {
+    if (mNumSamples == 1) {
         lastDurationUs = 0;  // A single sample's duration
         lastDurationTicks = 0;
     } else {
         ++sampleCount;  // Count for the last sample
     }
 
-    if (mStszTableEntries->count() <= 2) {
+    if (mOwner->isFragmented()) {
+        if (!mChunkSamples.empty()) {
+            mRunEntries.editItemAt(mRunEntries.size() - getRunEntrySize()) =
+                    htonl(lastDurationTicks);
+            bufferFragment();
+        }
+    } else if (mStszTableEntries->count() <= 2) {
         addOneSttsTableEntry(1, lastDurationTicks);
         if (sampleCount - 1 > 0) {
             addOneSttsTableEntry(sampleCount - 1, lastDurationTicks);
@@ -2394,7 +2709,8 @@ status_t MPEG4Writer::Track::threadEntry() {
 
     // The last ctts box may not have been written yet, and this
     // is to make sure that we write out the last ctts box.
-    if (currCttsOffsetTimeTicks == lastCttsOffsetTimeTicks) {
+    if (currCttsOffsetTimeTicks == lastCttsOffsetTimeTicks
+            && !mOwner->isFragmented()) {
         if (cttsSampleCount > 0) {
             addOneCttsTableEntry(cttsSampleCount, lastCttsOffsetTimeTicks);
         }
@@ -2406,7 +2722,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     sendTrackSummary(hasMultipleTracks);
 
     ALOGI("Received total/0-length (%d/%d) buffers and encoded %d frames. - %s",
-            count, nZeroLengthFrames, mStszTableEntries->count(), mIsAudio? "audio": "video");
+            count, nZeroLengthFrames, mNumSamples, mIsAudio? "audio": "video");
     if (mIsAudio) {
         ALOGI("Audio track drift time: %lld us", mOwner->getDriftTimeUs());
     }
@@ -2417,13 +2733,64 @@ status_t MPEG4Writer::Track::threadEntry() {
     return err;
 }
 
+void MPEG4Writer::Track::addFragmentSample(
+        MediaBuffer *sample, size_t sampleSize, int64_t timestampUs,
+        int64_t durationTicks, bool isSync, int64_t cttsOffsetTimeUs) {
+    const int64_t fragmentDurationUs = mOwner->fragmentDuration();
+
+    if (!mChunkSamples.empty()) {
+        // The duration of the previous sample is only known now.
+        mRunEntries.editItemAt(mRunEntries.size() - getRunEntrySize()) =
+                htonl(durationTicks);
+
+        // Let video fragments start with a sync frame, unless
+        // there has not been one for too long.
+        int64_t durationUs = timestampUs - mFragmentStartTimeUs;
+        if (durationUs >= fragmentDurationUs &&
+            (mIsAudio || isSync || durationUs >= 2 * fragmentDurationUs)) {
+            bufferFragment();
+        }
+    }
+
+    if (mChunkSamples.empty()) {
+        mFragmentStartTimeUs = timestampUs;
+        mFragmentStartTicks = (timestampUs * mTimeScale + 500000LL) / 1000000LL;
+    }
+
+    mRunEntries.push(0);  // Duration, set with the next sample
+    mRunEntries.push(htonl(sampleSize));
+    if (!mIsAudio) {
+        // Offsets in version 0 trun boxes cannot be negative.
+        int64_t cttsOffsetTicks =
+            ((cttsOffsetTimeUs - kMaxCttsOffsetTimeUs) * mTimeScale
+                + 500000LL) / 1000000LL;
+        if (cttsOffsetTicks < 0) {
+            cttsOffsetTicks = 0;
+        }
+        mRunEntries.push(htonl(isSync ? kSyncSampleFlags : kNonSyncSampleFlags));
+        mRunEntries.push(htonl(cttsOffsetTicks));
+    }
+    mChunkSamples.push_back(sample);
+}
+
+void MPEG4Writer::Track::bufferFragment() {
+    ALOGV("bufferFragment");
+
+    Chunk chunk(this, mFragmentStartTimeUs, mChunkSamples);
+    chunk.mDecodingTimeTicks = mFragmentStartTicks;
+    chunk.mRunEntries = mRunEntries;
+    mOwner->bufferChunk(chunk);
+    mChunkSamples.clear();
+    mRunEntries.clear();
+}
+
 bool MPEG4Writer::Track::isTrackMalFormed() const {
-    if (mStszTableEntries->count() == 0) {                      // no samples written
+    if (mNumSamples == 0) {                      // no samples written
         ALOGE("The number of recorded samples is 0");
         return true;
     }
 
-    if (!mIsAudio && mStssTableEntries->count() == 0) {  // no sync frames for video
+    if (!mIsAudio && !mGotSyncSample) {  // no sync frames for video
         ALOGE("There are no sync frames for video track");
         return true;
     }
@@ -2454,7 +2821,7 @@ void MPEG4Writer::Track::sendTrackSummary(bool hasMultipleTracks) {
 
     mOwner->notify(MEDIA_RECORDER_TRACK_EVENT_INFO,
                     trackNum | MEDIA_RECORDER_TRACK_INFO_ENCODED_FRAMES,
-                    mStszTableEntries->count());
+                    mNumSamples);
 
     {
         // The system delay time excluding the requested initial delay that
@@ -2620,6 +2987,21 @@ void MPEG4Writer::Track::writeStblBox(bool use32BitOffset) {
         writeVideoFourCCBox();
     }
     mOwner->endBox();  // stsd
+    if (mOwner->isFragmented()) {
+        // The samples are all in movie fragments.
+        static const char *kTables[] = { "stts", "stsc", "stsz", "stco" };
+        for (size_t i = 0; i < sizeof(kTables) / sizeof(kTables[0]); ++i) {
+            mOwner->beginBox(kTables[i]);
+            mOwner->writeInt32(0);  // version=0, flags=0
+            if (!strcmp(kTables[i], "stsz")) {
+                mOwner->writeInt32(0);  // sample size
+            }
+            mOwner->writeInt32(0);  // entry count
+            mOwner->endBox();
+        }
+        mOwner->endBox();  // stbl
+        return;
+    }
     writeSttsBox();
     writeCttsBox();
     if (!mIsAudio) {
@@ -2631,6 +3013,67 @@ void MPEG4Writer::Track::writeStblBox(bool use32BitOffset) {
     mOwner->endBox();  // stbl
 }
 
+bool MPEG4Writer::Track::hasCodecSpecificData() const {
+    return checkCodecSpecificData() == OK;
+}
+
+void MPEG4Writer::Track::writeTrexBox() {
+    mOwner->beginBox("trex");
+    mOwner->writeInt32(0);             // version=0, flags=0
+    mOwner->writeInt32(mTrackId);
+    mOwner->writeInt32(1);             // default sample description index
+    mOwner->writeInt32(0);             // default sample duration
+    mOwner->writeInt32(0);             // default sample size
+    mOwner->writeInt32(0);             // default sample flags
+    mOwner->endBox();  // trex
+}
+
+size_t MPEG4Writer::Track::getTrafBoxSize(const Chunk &chunk) const {
+    size_t tfhdSize = mIsAudio ? 20 : 16;
+    size_t tfdtSize = 20;
+    size_t trunSize = 20 + chunk.mRunEntries.size() * 4;
+    return 8 + tfhdSize + tfdtSize + trunSize;
+}
+
+// "dataOffset" is that of the first sample relative to the moof box.
+void MPEG4Writer::Track::writeTrafBox(
+        const Chunk &chunk, int32_t dataOffset, int64_t movieStartTimeUs) {
+    mOwner->beginBox("traf");
+
+    mOwner->beginBox("tfhd");
+    if (mIsAudio) {
+        // default-base-is-moof, default-sample-flags-present
+        mOwner->writeInt32(0x020020);
+        mOwner->writeInt32(mTrackId);
+        mOwner->writeInt32(kSyncSampleFlags);
+    } else {
+        mOwner->writeInt32(0x020000);  // default-base-is-moof
+        mOwner->writeInt32(mTrackId);
+    }
+    mOwner->endBox();  // tfhd
+
+    // Keeps the tracks in sync like the start time offset added to the
+    // first stts entry of unfragmented files.
+    int64_t startTimeOffsetTicks =
+        ((mStartTimestampUs - movieStartTimeUs) * mTimeScale + 500000LL) / 1000000LL;
+
+    mOwner->beginBox("tfdt");
+    mOwner->writeInt32(0x01000000);    // version=1, flags=0
+    mOwner->writeInt64(chunk.mDecodingTimeTicks + startTimeOffsetTicks);
+    mOwner->endBox();  // tfdt
+
+    mOwner->beginBox("trun");
+    // data-offset, sample-duration, sample-size and for video
+    // sample-flags, sample-composition-time-offset present
+    mOwner->writeInt32(mIsAudio ? 0x000301 : 0x000f01);
+    mOwner->writeInt32(chunk.mRunEntries.size() / getRunEntrySize());
+    mOwner->writeInt32(dataOffset);
+    mOwner->write(chunk.mRunEntries.array(), 4, chunk.mRunEntries.size());
+    mOwner->endBox();  // trun
+
+    mOwner->endBox();  // traf
+}
+
 void MPEG4Writer::Track::writeVideoFourCCBox() {
     const char *mime;
     bool success = mMeta->findCString(kKeyMIMEType, &mime);
@@ -2813,7 +3256,8 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->writeInt32(now);           // modification time
     mOwner->writeInt32(mTrackId);      // track id starts with 1
     mOwner->writeInt32(0);             // reserved
-    int64_t trakDurationUs = getDurationUs();
+    // Fragmented files only have the movie duration, in the mehd box.
+    int64_t trakDurationUs = mOwner->isFragmented()? 0: getDurationUs();
     int32_t mvhdTimeScale = mOwner->getTimeScale();
     int32_t tkhdDuration =
         (trakDurationUs * mvhdTimeScale + 5E5) / 1E6;
@@ -2874,7 +3318,7 @@ void MPEG4Writer::Track::writeHdlrBox() {
 }
 
 void MPEG4Writer::Track::writeMdhdBox(uint32_t now) {
-    int64_t trakDurationUs = getDurationUs();
+    int64_t trakDurationUs = mOwner->isFragmented()? 0: getDurationUs();
     mOwner->beginBox("mdhd");
     mOwner->writeInt32(0);             // version=0, flags=0
     mOwner->writeInt32(now);           // creation time
@@ -17,18 +17,29 @@
 #define LOG_TAG "MediaBufferGroup"
 #include <utils/Log.h>
 
+#include <cutils/atomic.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
+#include <utils/Timers.h>
 
 namespace android {
 
 MediaBufferGroup::MediaBufferGroup()
     : mFirstBuffer(NULL),
-      mLastBuffer(NULL) {
+      mLastBuffer(NULL),
+      mWaiters(0) {
+    mStats.mStarvedCount = 0;
+    mStats.mStarvedTimeUs = 0;
+    mStats.mMaxStarvedTimeUs = 0;
 }
 
 MediaBufferGroup::~MediaBufferGroup() {
+    if (mStats.mStarvedCount > 0) {
+        ALOGD("ran out of buffers %u times, waited %lld us (max %lld us)",
+              mStats.mStarvedCount, mStats.mStarvedTimeUs, mStats.mMaxStarvedTimeUs);
+    }
+
     MediaBuffer *next;
     for (MediaBuffer *buffer = mFirstBuffer; buffer != NULL;
          buffer = next) {
@@ -46,6 +57,9 @@ void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
 
     buffer->setObserver(this);
 
+    // Publish the buffer before it becomes reachable by tryAcquire()
+    android_memory_barrier();
+
     if (mLastBuffer) {
         mLastBuffer->setNextBuffer(buffer);
     } else {
@@ -55,30 +69,82 @@ void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
     mLastBuffer = buffer;
 }
 
-status_t MediaBufferGroup::acquire_buffer(MediaBuffer **out) {
+// Claims an unused buffer without taking mLock. Buffers are never removed
+// from the list, and a buffer is claimed by moving its reference count from
+// 0 to 1, so concurrent callers never get the same buffer.
+MediaBuffer *MediaBufferGroup::tryAcquire() {
+    for (MediaBuffer *buffer = mFirstBuffer;
+         buffer != NULL; buffer = buffer->nextBuffer()) {
+        if (buffer->mRefCount == 0
+                && android_atomic_cmpxchg(
+                    0, 1, (volatile int32_t *)&buffer->mRefCount) == 0) {
+            buffer->reset();
+            return buffer;
+        }
+    }
+
+    return NULL;
+}
+
+status_t MediaBufferGroup::acquire_buffer(MediaBuffer **out, int64_t timeoutUs) {
+    *out = tryAcquire();
+    if (*out != NULL) {
+        return OK;
+    }
+
+    if (timeoutUs == 0) {
+        return WOULD_BLOCK;
+    }
+
     Mutex::Autolock autoLock(mLock);
 
+    const nsecs_t startNs = systemTime();
+    status_t err = OK;
+
+    android_atomic_inc(&mWaiters);
     for (;;) {
-        for (MediaBuffer *buffer = mFirstBuffer;
-             buffer != NULL; buffer = buffer->nextBuffer()) {
-            if (buffer->refcount() == 0) {
-                buffer->add_ref();
-                buffer->reset();
-
-                *out = buffer;
-                goto exit;
-            }
+        // Registered as a waiter before looking again, so that a buffer
+        // returned from now on signals us.
+        *out = tryAcquire();
+        if (*out != NULL) {
+            break;
         }
 
         // All buffers are in use. Block until one of them is returned to us.
-        mCondition.wait(mLock);
+        if (timeoutUs < 0) {
+            mCondition.wait(mLock);
+            continue;
+        }
+
+        nsecs_t remainingNs = timeoutUs * 1000ll - (systemTime() - startNs);
+        if (remainingNs <= 0) {
+            err = TIMED_OUT;
+            break;
+        }
+        mCondition.waitRelative(mLock, remainingNs);
+    }
+    android_atomic_dec(&mWaiters);
+
+    const int64_t starvedUs = (systemTime() - startNs) / 1000ll;
+    ++mStats.mStarvedCount;
+    mStats.mStarvedTimeUs += starvedUs;
+    if (starvedUs > mStats.mMaxStarvedTimeUs) {
+        mStats.mMaxStarvedTimeUs = starvedUs;
     }
 
-exit:
-    return OK;
+    return err;
+}
+
+void MediaBufferGroup::getStats(Stats *stats) {
+    Mutex::Autolock autoLock(mLock);
+    *stats = mStats;
 }
 
 void MediaBufferGroup::signalBufferReturned(MediaBuffer *) {
+    if (android_atomic_acquire_load(&mWaiters) == 0) {
+        return;
+    }
+
     Mutex::Autolock autoLock(mLock);
     mCondition.signal();
 }
@@ -74,6 +74,8 @@ MediaCodec::MediaCodec(const sp<ALooper> &looper)
       mDequeueInputReplyID(0),
       mDequeueOutputTimeoutGeneration(0),
       mDequeueOutputReplyID(0),
+      mDequeueOutputEntries(NULL),
+      mDequeueOutputMaxCount(0),
       mHaveInputSurface(false) {
 }
 
@@ -314,6 +316,57 @@ status_t MediaCodec::dequeueOutputBuffer(
     return OK;
 }
 
+status_t MediaCodec::queueInputBuffers(
+        const BufferEntry *entries, size_t count, size_t *numQueued,
+        AString *errorDetailMsg) {
+    if (errorDetailMsg != NULL) {
+        errorDetailMsg->clear();
+    }
+
+    *numQueued = 0;
+
+    sp<AMessage> msg = new AMessage(kWhatQueueInputBuffers, id());
+    msg->setPointer("entries", (void *)entries);
+    msg->setSize("count", count);
+    msg->setPointer("numQueued", numQueued);
+    msg->setPointer("errorDetailMsg", errorDetailMsg);
+
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t MediaCodec::dequeueOutputBuffers(
+        Vector<BufferEntry> *entries, size_t maxCount, int64_t timeoutUs) {
+    entries->clear();
+
+    if (maxCount == 0) {
+        return OK;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatDequeueOutputBuffer, id());
+    msg->setInt64("timeoutUs", timeoutUs);
+    msg->setPointer("entries", entries);
+    msg->setSize("maxCount", maxCount);
+
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t MediaCodec::releaseOutputBuffers(
+        const size_t *indices, size_t count, bool render,
+        size_t *numReleased) {
+    *numReleased = 0;
+
+    sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffers, id());
+    msg->setPointer("indices", (void *)indices);
+    msg->setSize("count", count);
+    msg->setInt32("render", render);
+    msg->setPointer("numReleased", numReleased);
+
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
 status_t MediaCodec::renderOutputBufferAndRelease(size_t index) {
     sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, id());
     msg->setSize("index", index);
@@ -323,6 +376,17 @@ status_t MediaCodec::renderOutputBufferAndRelease(size_t index) {
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t MediaCodec::renderOutputBufferAndRelease(
+        size_t index, int64_t timestampNs) {
+    sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, id());
+    msg->setSize("index", index);
+    msg->setInt32("render", true);
+    msg->setInt64("timestampNs", timestampNs);
+
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
 status_t MediaCodec::releaseOutputBuffer(size_t index) {
     sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, id());
     msg->setSize("index", index);
@@ -423,6 +487,7 @@ void MediaCodec::cancelPendingDequeueOperations() {
 
         ++mDequeueOutputTimeoutGeneration;
         mDequeueOutputReplyID = 0;
+        mDequeueOutputEntries = NULL;
         mFlags &= ~kFlagDequeueOutputPending;
     }
 }
@@ -474,40 +539,70 @@ bool MediaCodec::handleDequeueOutputBuffer(uint32_t replyID, bool newRequest) {
             return false;
         }
 
-        const sp<ABuffer> &buffer =
-            mPortBuffers[kPortIndexOutput].itemAt(index).mData;
+        BufferEntry entry;
+        getOutputBufferEntry(index, &entry);
 
-        response->setSize("index", index);
-        response->setSize("offset", buffer->offset());
-        response->setSize("size", buffer->size());
+        response->setSize("index", entry.mIndex);
+        response->setSize("offset", entry.mOffset);
+        response->setSize("size", entry.mSize);
+        response->setInt64("timeUs", entry.mPresentationTimeUs);
+        response->setInt32("flags", entry.mFlags);
 
-        int64_t timeUs;
-        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+        if (mDequeueOutputEntries != NULL) {
+            mDequeueOutputEntries->push(entry);
 
-        response->setInt64("timeUs", timeUs);
-
-        int32_t omxFlags;
-        CHECK(buffer->meta()->findInt32("omxFlags", &omxFlags));
+            while (mDequeueOutputEntries->size() < mDequeueOutputMaxCount
+                    && !(entry.mFlags & BUFFER_FLAG_EOS)) {
+                index = dequeuePortBuffer(kPortIndexOutput);
+                if (index < 0) {
+                    break;
+                }
 
-        uint32_t flags = 0;
-        if (omxFlags & OMX_BUFFERFLAG_SYNCFRAME) {
-            flags |= BUFFER_FLAG_SYNCFRAME;
-        }
-        if (omxFlags & OMX_BUFFERFLAG_CODECCONFIG) {
-            flags |= BUFFER_FLAG_CODECCONFIG;
-        }
-        if (omxFlags & OMX_BUFFERFLAG_EOS) {
-            flags |= BUFFER_FLAG_EOS;
+                getOutputBufferEntry(index, &entry);
+                mDequeueOutputEntries->push(entry);
+            }
         }
-
-        response->setInt32("flags", flags);
     }
 
     response->postReply(replyID);
 
+    if (!newRequest || !(mFlags & kFlagDequeueOutputPending)) {
+        mDequeueOutputEntries = NULL;
+    }
+
     return true;
 }
 
+void MediaCodec::getOutputBufferEntry(size_t index, BufferEntry *entry) const {
+    const sp<ABuffer> &buffer =
+        mPortBuffers[kPortIndexOutput].itemAt(index).mData;
+
+    entry->mIndex = index;
+    entry->mOffset = buffer->offset();
+    entry->mSize = buffer->size();
+
+    CHECK(buffer->meta()->findInt64("timeUs", &entry->mPresentationTimeUs));
+
+    int32_t omxFlags;
+    CHECK(buffer->meta()->findInt32("omxFlags", &omxFlags));
+
+    uint32_t flags = 0;
+    if (omxFlags & OMX_BUFFERFLAG_SYNCFRAME) {
+        flags |= BUFFER_FLAG_SYNCFRAME;
+    }
+    if (omxFlags & OMX_BUFFERFLAG_CODECCONFIG) {
+        flags |= BUFFER_FLAG_CODECCONFIG;
+    }
+    if (omxFlags & OMX_BUFFERFLAG_EOS) {
+        flags |= BUFFER_FLAG_EOS;
+    }
+    if (!(omxFlags & (OMX_BUFFERFLAG_ENDOFFRAME | OMX_BUFFERFLAG_EOS))) {
+        flags |= BUFFER_FLAG_PARTIAL_FRAME;
+    }
+
+    entry->mFlags = flags;
+}
+
 void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatCodecNotify:
@@ -709,6 +804,7 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                         if (portIndex == kPortIndexInput && mCrypto != NULL) {
                             info.mEncryptedData =
                                 new ABuffer(info.mData->capacity());
+                            info.mSharedMemory = portDesc->memoryAt(i);
                         }
 
                         buffers->push_back(info);
@@ -875,7 +971,9 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                 case ACodec::kWhatEOS:
                 {
                     // We already notify the client of this by using the
-                    // corresponding flag in "onOutputBufferReady".
+                    // corresponding flag in "onOutputBufferReady". In
+                    // tunneled mode the EOS buffer is the only output
+                    // buffer the client sees, handed over like any other.
                     break;
                 }
 
@@ -1177,11 +1275,73 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatQueueInputBuffers:
+        {
+            uint32_t replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            if (mState != STARTED || (mFlags & kFlagStickyError)) {
+                sp<AMessage> response = new AMessage;
+                response->setInt32("err", INVALID_OPERATION);
+
+                response->postReply(replyID);
+                break;
+            }
+
+            const BufferEntry *entries;
+            CHECK(msg->findPointer("entries", (void **)&entries));
+
+            size_t count;
+            CHECK(msg->findSize("count", &count));
+
+            size_t *numQueued;
+            CHECK(msg->findPointer("numQueued", (void **)&numQueued));
+
+            AString *errorDetailMsg;
+            CHECK(msg->findPointer("errorDetailMsg", (void **)&errorDetailMsg));
+
+            // onQueueInputBuffer() takes its arguments as a message, reuse
+            // the same one for all the buffers.
+            sp<AMessage> entryMsg = new AMessage;
+            entryMsg->setPointer("errorDetailMsg", errorDetailMsg);
+
+            status_t err = OK;
+            for (size_t i = 0; i < count; ++i) {
+                entryMsg->setSize("index", entries[i].mIndex);
+                entryMsg->setSize("offset", entries[i].mOffset);
+                entryMsg->setSize("size", entries[i].mSize);
+                entryMsg->setInt64("timeUs", entries[i].mPresentationTimeUs);
+                entryMsg->setInt32("flags", entries[i].mFlags);
+
+                err = onQueueInputBuffer(entryMsg);
+                if (err != OK) {
+                    break;
+                }
+                ++*numQueued;
+            }
+
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
+        }
+
         case kWhatDequeueOutputBuffer:
         {
             uint32_t replyID;
             CHECK(msg->senderAwaitsResponse(&replyID));
 
+            if (!(mFlags & kFlagDequeueOutputPending)) {
+                // Don't clobber the buffers of a pending request, it fails
+                // below anyway.
+                if (!msg->findPointer("entries", (void **)&mDequeueOutputEntries)) {
+                    mDequeueOutputEntries = NULL;
+                }
+                if (!msg->findSize("maxCount", &mDequeueOutputMaxCount)) {
+                    mDequeueOutputMaxCount = 1;
+                }
+            }
+
             if (handleDequeueOutputBuffer(replyID, true /* new request */)) {
                 break;
             }
@@ -1193,6 +1353,7 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                 sp<AMessage> response = new AMessage;
                 response->setInt32("err", -EAGAIN);
                 response->postReply(replyID);
+                mDequeueOutputEntries = NULL;
                 break;
             }
 
@@ -1227,6 +1388,7 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
 
             mFlags &= ~kFlagDequeueOutputPending;
             mDequeueOutputReplyID = 0;
+            mDequeueOutputEntries = NULL;
             break;
         }
 
@@ -1251,6 +1413,51 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatReleaseOutputBuffers:
+        {
+            uint32_t replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            if (mState != STARTED || (mFlags & kFlagStickyError)) {
+                sp<AMessage> response = new AMessage;
+                response->setInt32("err", INVALID_OPERATION);
+
+                response->postReply(replyID);
+                break;
+            }
+
+            const size_t *indices;
+            CHECK(msg->findPointer("indices", (void **)&indices));
+
+            size_t count;
+            CHECK(msg->findSize("count", &count));
+
+            int32_t render;
+            CHECK(msg->findInt32("render", &render));
+
+            size_t *numReleased;
+            CHECK(msg->findPointer("numReleased", (void **)&numReleased));
+
+            sp<AMessage> entryMsg = new AMessage;
+            entryMsg->setInt32("render", render);
+
+            status_t err = OK;
+            for (size_t i = 0; i < count; ++i) {
+                entryMsg->setSize("index", indices[i]);
+
+                err = onReleaseOutputBuffer(entryMsg);
+                if (err != OK) {
+                    break;
+                }
+                ++*numReleased;
+            }
+
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
+        }
+
         case kWhatSignalEndOfInputStream:
         {
             uint32_t replyID;
@@ -1339,8 +1546,21 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                 break;
             }
 
+            sp<AMessage> format = mOutputFormat;
+
+            ACodec::RenderStats stats;
+            if (mCodec->getRenderStats(&stats)) {
+                format = mOutputFormat->dup();
+                format->setInt32("tunneled-render-frames", stats.mNumFrames);
+                format->setInt32("tunneled-render-late-frames", stats.mNumLateFrames);
+                format->setInt64("tunneled-render-max-latency-us", stats.mMaxLatencyUs);
+                format->setInt64("tunneled-render-avg-latency-us",
+                        stats.mNumFrames > 0
+                            ? stats.mTotalLatencyUs / (int64_t)stats.mNumFrames : 0ll);
+            }
+
             sp<AMessage> response = new AMessage;
-            response->setMessage("format", mOutputFormat);
+            response->setMessage("format", format);
             response->postReply(replyID);
             break;
         }
@@ -1624,16 +1844,45 @@ status_t MediaCodec::onQueueInputBuffer(const sp<AMessage> &msg) {
         AString *errorDetailMsg;
         CHECK(msg->findPointer("errorDetailMsg", (void **)&errorDetailMsg));
 
-        ssize_t result = mCrypto->decrypt(
-                (mFlags & kFlagIsSecure) != 0,
-                key,
-                iv,
-                mode,
-                info->mEncryptedData->base() + offset,
-                subSamples,
-                numSubSamples,
-                info->mData->base(),
-                errorDetailMsg);
+        ssize_t result;
+        if (info->mSharedMemory != NULL && !(mFlags & kFlagIsSecure)) {
+            // Have the decrypted data written straight into the codec's
+            // shared input buffer instead of copying it back to us.
+            ICrypto::DecryptUnit unit;
+            unit.mMode = mode;
+            if (key != NULL) {
+                memcpy(unit.mKey, key, sizeof(unit.mKey));
+            }
+            if (iv != NULL) {
+                memcpy(unit.mIV, iv, sizeof(unit.mIV));
+            }
+            unit.mSrcPtr = info->mEncryptedData->base() + offset;
+            unit.mSubSamples = subSamples;
+            unit.mNumSubSamples = numSubSamples;
+            unit.mDstPtr = info->mData->base();
+
+            ssize_t heapOffset;
+            size_t heapSize;
+            unit.mDstHeap =
+                info->mSharedMemory->getMemory(&heapOffset, &heapSize);
+            unit.mDstOffset = heapOffset;
+
+            status_t err = mCrypto->decryptBatch(
+                    false /* secure */, &unit, 1, errorDetailMsg);
+
+            result = (err == OK) ? unit.mResult : err;
+        } else {
+            result = mCrypto->decrypt(
+                    (mFlags & kFlagIsSecure) != 0,
+                    key,
+                    iv,
+                    mode,
+                    info->mEncryptedData->base() + offset,
+                    subSamples,
+                    numSubSamples,
+                    info->mData->base(),
+                    errorDetailMsg);
+        }
 
         if (result < 0) {
             return result;
@@ -1677,6 +1926,11 @@ status_t MediaCodec::onReleaseOutputBuffer(const sp<AMessage> &msg) {
     if (render && (info->mData == NULL || info->mData->size() != 0)) {
         info->mNotify->setInt32("render", true);
 
+        int64_t timestampNs;
+        if (msg->findInt64("timestampNs", &timestampNs)) {
+            info->mNotify->setInt64("timestampNs", timestampNs);
+        }
+
         if (mSoftRenderer != NULL) {
             mSoftRenderer->render(
                     info->mData->data(), info->mData->size(), NULL);
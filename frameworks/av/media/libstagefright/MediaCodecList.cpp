@@ -28,10 +28,75 @@
 
 #include <libexpat/expat.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace android {
 
 static Mutex sInitMutex;
 
+static const char *kXMLPath = "/etc/media_codecs.xml";
+static const char *kCachePath = "/data/misc/media/media_codecs.cache";
+
+static const uint32_t kCacheMagic = 0x4d434c43;  // 'MCLC'
+static const uint32_t kCacheVersion = 1;
+
+// The cache file starts with this header, followed by numQuirks and numTypes
+// strings, in bit order, then numCodecs entries made of the codec name, a
+// 32 bit encoder flag and the type and quirk masks. Strings are a 32 bit
+// length followed by the characters, everything is in host byte order.
+struct CacheHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mXMLSize;
+    uint64_t mXMLMTime;
+    uint32_t mNumQuirks;
+    uint32_t mNumTypes;
+    uint32_t mNumCodecs;
+};
+
+struct CacheReader {
+    CacheReader(const uint8_t *data, size_t size)
+        : mData(data),
+          mSize(size) {
+    }
+
+    bool readU32(uint32_t *value) {
+        if (mSize < sizeof(*value)) {
+            return false;
+        }
+        memcpy(value, mData, sizeof(*value));
+        mData += sizeof(*value);
+        mSize -= sizeof(*value);
+        return true;
+    }
+
+    bool readString(AString *s) {
+        uint32_t length;
+        if (!readU32(&length) || mSize < length) {
+            return false;
+        }
+        s->setTo((const char *)mData, length);
+        mData += length;
+        mSize -= length;
+        return true;
+    }
+
+private:
+    const uint8_t *mData;
+    size_t mSize;
+};
+
+static bool WriteU32(FILE *file, uint32_t value) {
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static bool WriteString(FILE *file, const AString &s) {
+    return WriteU32(file, s.size())
+        && fwrite(s.c_str(), 1, s.size(), file) == s.size();
+}
+
 // static
 MediaCodecList *MediaCodecList::sCodecList;
 
@@ -48,14 +113,25 @@ const MediaCodecList *MediaCodecList::getInstance() {
 
 MediaCodecList::MediaCodecList()
     : mInitCheck(NO_INIT) {
-    FILE *file = fopen("/etc/media_codecs.xml", "r");
+    FILE *file = fopen(kXMLPath, "r");
 
     if (file == NULL) {
         ALOGW("unable to open media codecs configuration xml file.");
         return;
     }
 
-    parseXMLFile(file);
+    struct stat xmlStat;
+    bool haveStat = fstat(fileno(file), &xmlStat) == 0;
+
+    if (haveStat && loadCache(xmlStat)) {
+        mInitCheck = OK;
+    } else {
+        parseXMLFile(file);
+
+        if (haveStat && mInitCheck == OK) {
+            writeCache(xmlStat);
+        }
+    }
 
     if (mInitCheck == OK) {
         // These are currently still used by the video editing suite.
@@ -92,6 +168,147 @@ MediaCodecList::MediaCodecList()
 MediaCodecList::~MediaCodecList() {
 }
 
+bool MediaCodecList::loadCache(const struct stat &xmlStat) {
+    int fd = open(kCachePath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat cacheStat;
+    if (fstat(fd, &cacheStat) != 0
+            || (size_t)cacheStat.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = cacheStat.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    bool ok = header.mMagic == kCacheMagic
+        && header.mVersion == kCacheVersion
+        && header.mXMLSize == (uint64_t)xmlStat.st_size
+        && header.mXMLMTime == (uint64_t)xmlStat.st_mtime
+        && header.mNumQuirks <= 32
+        && header.mNumTypes <= 32;
+
+    CacheReader reader((const uint8_t *)data + sizeof(header),
+                       size - sizeof(header));
+
+    for (uint32_t i = 0; ok && i < header.mNumQuirks; ++i) {
+        AString name;
+        ok = reader.readString(&name);
+        if (ok) {
+            mCodecQuirks.add(name, i);
+        }
+    }
+
+    for (uint32_t i = 0; ok && i < header.mNumTypes; ++i) {
+        AString name;
+        ok = reader.readString(&name);
+        if (ok) {
+            mTypes.add(name, i);
+        }
+    }
+
+    for (uint32_t i = 0; ok && i < header.mNumCodecs; ++i) {
+        CodecInfo info;
+        uint32_t isEncoder;
+        ok = reader.readString(&info.mName)
+            && reader.readU32(&isEncoder)
+            && reader.readU32(&info.mTypes)
+            && reader.readU32(&info.mQuirks);
+        if (ok) {
+            info.mIsEncoder = isEncoder != 0;
+            mCodecInfos.push(info);
+        }
+    }
+
+    munmap(data, size);
+
+    if (!ok) {
+        ALOGW("ignoring stale or corrupt %s", kCachePath);
+
+        mCodecInfos.clear();
+        mCodecQuirks.clear();
+        mTypes.clear();
+    }
+
+    return ok;
+}
+
+void MediaCodecList::writeCache(const struct stat &xmlStat) const {
+    // Only processes allowed to write to the cache directory update it,
+    // everyone else just parses the xml file as before.
+    AString tmpPath = kCachePath;
+    tmpPath.append(StringPrintf(".%d", getpid()));
+
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    FILE *file = fdopen(fd, "w");
+    if (file == NULL) {
+        close(fd);
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mMagic = kCacheMagic;
+    header.mVersion = kCacheVersion;
+    header.mXMLSize = xmlStat.st_size;
+    header.mXMLMTime = xmlStat.st_mtime;
+    header.mNumQuirks = mCodecQuirks.size();
+    header.mNumTypes = mTypes.size();
+    header.mNumCodecs = mCodecInfos.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // The KeyedVectors are sorted by name, write the names in bit order.
+    for (uint32_t bit = 0; ok && bit < header.mNumQuirks; ++bit) {
+        for (size_t i = 0; i < mCodecQuirks.size(); ++i) {
+            if (mCodecQuirks.valueAt(i) == bit) {
+                ok = WriteString(file, mCodecQuirks.keyAt(i));
+                break;
+            }
+        }
+    }
+
+    for (uint32_t bit = 0; ok && bit < header.mNumTypes; ++bit) {
+        for (size_t i = 0; i < mTypes.size(); ++i) {
+            if (mTypes.valueAt(i) == bit) {
+                ok = WriteString(file, mTypes.keyAt(i));
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; ok && i < mCodecInfos.size(); ++i) {
+        const CodecInfo &info = mCodecInfos.itemAt(i);
+        ok = WriteString(file, info.mName)
+            && WriteU32(file, info.mIsEncoder)
+            && WriteU32(file, info.mTypes)
+            && WriteU32(file, info.mQuirks);
+    }
+
+    ok = (fclose(file) == 0) && ok;
+
+    // Readers never see a partially written cache.
+    if (!ok || rename(tmpPath.c_str(), kCachePath) != 0) {
+        unlink(tmpPath.c_str());
+    }
+}
+
 status_t MediaCodecList::initCheck() const {
     return mInitCheck;
 }
@@ -520,6 +737,22 @@ status_t MediaCodecList::getCodecCapabilities(
 
     const CodecInfo &info = mCodecInfos.itemAt(index);
 
+    AString key = StringPrintf("%u:%s", (unsigned)index, type);
+
+    {
+        Mutex::Autolock autoLock(mCapabilitiesLock);
+
+        ssize_t cached = mCapabilities.indexOfKey(key);
+        if (cached >= 0) {
+            const Capabilities &caps = mCapabilities.valueAt(cached);
+            *profileLevels = caps.mProfileLevels;
+            *colorFormats = caps.mColorFormats;
+            *flags = caps.mFlags;
+
+            return OK;
+        }
+    }
+
     OMXClient client;
     status_t err = client.connect();
     if (err != OK) {
@@ -550,6 +783,14 @@ status_t MediaCodecList::getCodecCapabilities(
 
     *flags = caps.mFlags;
 
+    Capabilities cached;
+    cached.mProfileLevels = *profileLevels;
+    cached.mColorFormats = *colorFormats;
+    cached.mFlags = *flags;
+
+    Mutex::Autolock autoLock(mCapabilitiesLock);
+    mCapabilities.add(key, cached);
+
     return OK;
 }
 
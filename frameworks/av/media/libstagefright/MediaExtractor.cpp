@@ -45,6 +45,10 @@ sp<MetaData> MediaExtractor::getMetaData() {
     return new MetaData;
 }
 
+sp<MetaData> MediaExtractor::getMetaDataWithFlags(uint32_t flags) {
+    return getMetaData();
+}
+
 uint32_t MediaExtractor::flags() const {
     return CAN_SEEK_BACKWARD | CAN_SEEK_FORWARD | CAN_PAUSE | CAN_SEEK;
 }
@@ -25,15 +25,52 @@
 #include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/MetaData.h>
+#include <utils/SharedBuffer.h>
+#include <utils/threads.h>
 
 namespace android {
 
-MetaData::MetaData() {
+// Blocks of sizeof(MetaData) kept for reuse
+static const size_t kMaxFreeMetaData = 64;
+static Mutex gFreeMetaDataLock;
+static void *gFreeMetaData[kMaxFreeMetaData];
+static size_t gNumFreeMetaData = 0;
+
+void *MetaData::operator new(size_t size) {
+    if (size == sizeof(MetaData)) {
+        Mutex::Autolock autoLock(gFreeMetaDataLock);
+        if (gNumFreeMetaData > 0) {
+            return gFreeMetaData[--gNumFreeMetaData];
+        }
+    }
+
+    return ::operator new(size);
+}
+
+void MetaData::operator delete(void *ptr, size_t size) {
+    if (ptr != NULL && size == sizeof(MetaData)) {
+        Mutex::Autolock autoLock(gFreeMetaDataLock);
+        if (gNumFreeMetaData < kMaxFreeMetaData) {
+            gFreeMetaData[gNumFreeMetaData++] = ptr;
+            return;
+        }
+    }
+
+    ::operator delete(ptr);
+}
+
+MetaData::MetaData()
+    : mNumInlineItems(0) {
 }
 
 MetaData::MetaData(const MetaData &from)
     : RefBase(),
+      mNumInlineItems(from.mNumInlineItems),
       mItems(from.mItems) {
+    for (size_t i = 0; i < mNumInlineItems; ++i) {
+        mInlineKeys[i] = from.mInlineKeys[i];
+        mInlineItems[i] = from.mInlineItems[i];
+    }
 }
 
 MetaData::~MetaData() {
@@ -41,10 +78,39 @@ MetaData::~MetaData() {
 }
 
 void MetaData::clear() {
+    for (size_t i = 0; i < mNumInlineItems; ++i) {
+        mInlineItems[i].clear();
+    }
+    mNumInlineItems = 0;
+
     mItems.clear();
 }
 
+ssize_t MetaData::indexOfInlineKey(uint32_t key) const {
+    for (size_t i = 0; i < mNumInlineItems; ++i) {
+        if (mInlineKeys[i] == key) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 bool MetaData::remove(uint32_t key) {
+    ssize_t j = indexOfInlineKey(key);
+
+    if (j >= 0) {
+        // Move the last inline item into the gap
+        --mNumInlineItems;
+        if ((size_t)j != mNumInlineItems) {
+            mInlineKeys[j] = mInlineKeys[mNumInlineItems];
+            mInlineItems[j] = mInlineItems[mNumInlineItems];
+        }
+        mInlineItems[mNumInlineItems].clear();
+
+        return true;
+    }
+
     ssize_t i = mItems.indexOfKey(key);
 
     if (i < 0) {
@@ -189,9 +255,23 @@ bool MetaData::findRect(
 
 bool MetaData::setData(
         uint32_t key, uint32_t type, const void *data, size_t size) {
+    ssize_t j = indexOfInlineKey(key);
+    if (j >= 0) {
+        mInlineItems[j].setData(type, data, size);
+        return true;
+    }
+
     bool overwrote_existing = true;
 
     ssize_t i = mItems.indexOfKey(key);
+    if (i < 0 && mNumInlineItems < kNumInlineItems) {
+        mInlineKeys[mNumInlineItems] = key;
+        mInlineItems[mNumInlineItems].setData(type, data, size);
+        ++mNumInlineItems;
+
+        return false;
+    }
+
     if (i < 0) {
         typed_data item;
         i = mItems.add(key, item);
@@ -208,6 +288,12 @@ bool MetaData::setData(
 
 bool MetaData::findData(uint32_t key, uint32_t *type,
                         const void **data, size_t *size) const {
+    ssize_t j = indexOfInlineKey(key);
+    if (j >= 0) {
+        mInlineItems[j].getData(type, data, size);
+        return true;
+    }
+
     ssize_t i = mItems.indexOfKey(key);
 
     if (i < 0) {
@@ -231,24 +317,36 @@ MetaData::typed_data::~typed_data() {
 }
 
 MetaData::typed_data::typed_data(const typed_data &from)
-    : mType(from.mType),
+    : mType(0),
       mSize(0) {
-    allocateStorage(from.mSize);
-    memcpy(storage(), from.storage(), mSize);
+    copyFrom(from);
 }
 
 MetaData::typed_data &MetaData::typed_data::operator=(
         const MetaData::typed_data &from) {
     if (this != &from) {
         clear();
-        mType = from.mType;
-        allocateStorage(from.mSize);
-        memcpy(storage(), from.storage(), mSize);
+        copyFrom(from);
     }
 
     return *this;
 }
 
+void MetaData::typed_data::copyFrom(const typed_data &from) {
+    mType = from.mType;
+    mSize = from.mSize;
+
+    if (usesReservoir()) {
+        memcpy(&u.reservoir, &from.u.reservoir, mSize);
+    } else {
+        // share the value instead of copying it
+        u.ext_data = from.u.ext_data;
+        if (u.ext_data) {
+            SharedBuffer::bufferFromData(u.ext_data)->acquire();
+        }
+    }
+}
+
 void MetaData::typed_data::clear() {
     freeStorage();
 
@@ -278,13 +376,14 @@ void MetaData::typed_data::allocateStorage(size_t size) {
         return;
     }
 
-    u.ext_data = malloc(mSize);
+    SharedBuffer *buffer = SharedBuffer::alloc(mSize);
+    u.ext_data = buffer ? buffer->data() : NULL;
 }
 
 void MetaData::typed_data::freeStorage() {
     if (!usesReservoir()) {
         if (u.ext_data) {
-            free(u.ext_data);
+            SharedBuffer::bufferFromData(u.ext_data)->release();
             u.ext_data = NULL;
         }
     }
@@ -344,6 +443,11 @@ static void MakeFourCCString(uint32_t x, char *s) {
 }
 
 void MetaData::dumpToLog() const {
+    for (size_t i = 0; i < mNumInlineItems; ++i) {
+        char cc[5];
+        MakeFourCCString(mInlineKeys[i], cc);
+        ALOGI("%s: %s", cc, mInlineItems[i].asString().string());
+    }
     for (int i = mItems.size(); --i >= 0;) {
         int32_t key = mItems.keyAt(i);
         char cc[5];
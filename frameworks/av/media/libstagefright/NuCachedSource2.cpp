@@ -186,6 +186,7 @@ NuCachedSource2::NuCachedSource2(
       mLooper(new ALooper),
       mCache(new PageCache(kPageSize)),
       mCacheOffset(0),
+      mRetainedBytes(0),
       mFinalStatus(OK),
       mLastAccessPos(0),
       mFetching(true),
@@ -225,6 +226,11 @@ NuCachedSource2::~NuCachedSource2() {
 
     delete mCache;
     mCache = NULL;
+
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        delete mRetainedRanges[i].mCache;
+    }
+    mRetainedRanges.clear();
 }
 
 status_t NuCachedSource2::getEstimatedBandwidthKbps(int32_t *kbps) {
@@ -480,6 +486,20 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         return size;
     }
 
+    ssize_t index = findRetainedRange_l(offset, size);
+    if (index >= 0) {
+        const CachedRange &range = mRetainedRanges.itemAt(index);
+        range.mCache->copy(offset - range.mOffset, data, size);
+
+        if (index > 0) {
+            CachedRange tmp = range;
+            mRetainedRanges.removeAt(index);
+            mRetainedRanges.insertAt(tmp, 0);
+        }
+
+        return size;
+    }
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector->id());
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -551,7 +571,12 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
         // trigger this seek request, the other one will request data "nearby"
         // soon, adjust the seek position so that that subsequent request
         // does not trigger another seek.
+        // No padding is needed when seeking back into a retained range, it
+        // already holds whatever was read around there.
         off64_t seekOffset = (offset > kPadding) ? offset - kPadding : 0;
+        if (findRetainedRange_l(offset, 0) >= 0) {
+            seekOffset = offset;
+        }
 
         seekInternal_l(seekOffset);
     }
@@ -593,12 +618,27 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
         return OK;
     }
 
-    ALOGI("new range: offset= %lld", offset);
+    retainCurrentRange_l();
 
-    mCacheOffset = offset;
+    ssize_t index = findRetainedRange_l(offset, 0);
+    if (index >= 0) {
+        const CachedRange &range = mRetainedRanges.itemAt(index);
 
-    size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+        ALOGI("resuming range: offset= %lld, size= %d",
+             range.mOffset, range.mCache->totalSize());
+
+        mCache = range.mCache;
+        mCacheOffset = range.mOffset;
+        mRetainedBytes -= mCache->totalSize();
+        mRetainedRanges.removeAt(index);
+    } else {
+        ALOGI("new range: offset= %lld", offset);
+
+        mCache = new PageCache(kPageSize);
+        mCacheOffset = offset;
+    }
+
+    trimRetainedRanges_l();
 
     mNumRetriesLeft = kMaxNumRetries;
     mFetching = true;
@@ -606,6 +646,81 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
     return OK;
 }
 
+// Return the index of the retained range holding [offset, offset + size),
+// where size 0 also matches the end of a range since fetching can resume
+// from there, or -1.
+ssize_t NuCachedSource2::findRetainedRange_l(off64_t offset, size_t size) const {
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        const CachedRange &range = mRetainedRanges.itemAt(i);
+        off64_t end = range.mOffset + range.mCache->totalSize();
+
+        if (offset >= range.mOffset && offset + (off64_t)size <= end) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Move the range being fetched to the retained ranges, leaving mCache NULL.
+void NuCachedSource2::retainCurrentRange_l() {
+    off64_t start = mCacheOffset;
+    off64_t end = mCacheOffset + mCache->totalSize();
+
+    // The retained ranges only hold data the current range does not.
+    for (size_t i = 0; i < mRetainedRanges.size();) {
+        const CachedRange &range = mRetainedRanges.itemAt(i);
+        off64_t rangeEnd = range.mOffset + range.mCache->totalSize();
+
+        if (range.mOffset < end && rangeEnd > start) {
+            mRetainedBytes -= range.mCache->totalSize();
+            delete range.mCache;
+            mRetainedRanges.removeAt(i);
+        } else {
+            ++i;
+        }
+    }
+
+    if (mCache->totalSize() == 0) {
+        delete mCache;
+    } else {
+        CachedRange range;
+        range.mCache = mCache;
+        range.mOffset = mCacheOffset;
+        mRetainedRanges.insertAt(range, 0);
+        mRetainedBytes += mCache->totalSize();
+    }
+
+    mCache = NULL;
+}
+
+void NuCachedSource2::trimRetainedRanges_l() {
+    while (mRetainedRanges.size() > kMaxNumRetainedRanges
+            || mRetainedBytes > kMaxRetainedBytes) {
+        size_t last = mRetainedRanges.size() - 1;
+        CachedRange &range = mRetainedRanges.editItemAt(last);
+
+        if (mRetainedRanges.size() <= kMaxNumRetainedRanges
+                && mRetainedBytes - kMaxRetainedBytes < range.mCache->totalSize()) {
+            // Keep the tail of the oldest range, data is usually read
+            // forward from where the last seek landed. Pages are released
+            // whole, at most kPageSize each.
+            size_t excess = mRetainedBytes - kMaxRetainedBytes;
+            size_t released = range.mCache->releaseFromStart(excess + kPageSize - 1);
+            range.mOffset += released;
+            mRetainedBytes -= released;
+
+            if (range.mCache->totalSize() > 0) {
+                continue;
+            }
+        }
+
+        mRetainedBytes -= range.mCache->totalSize();
+        delete range.mCache;
+        mRetainedRanges.removeAt(last);
+    }
+}
+
 void NuCachedSource2::resumeFetchingIfNecessary() {
     Mutex::Autolock autoLock(mLock);
 
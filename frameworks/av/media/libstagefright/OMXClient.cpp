@@ -116,6 +116,9 @@ struct MuxOMX : public IOMX {
             OMX_U32 range_offset, OMX_U32 range_length,
             OMX_U32 flags, OMX_TICKS timestamp);
 
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferRequest> &requests);
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -353,6 +356,11 @@ status_t MuxOMX::emptyBuffer(
             node, buffer, range_offset, range_length, flags, timestamp);
 }
 
+status_t MuxOMX::submitBuffers(
+        node_id node, const Vector<BufferRequest> &requests) {
+    return getOMX(node)->submitBuffers(node, requests);
+}
+
 status_t MuxOMX::getExtensionIndex(
         node_id node,
         const char *parameter_name,
@@ -40,64 +40,194 @@ const uint32_t SampleTable::kSampleSizeTypeCompact = FOURCC('s', 't', 'z', '2');
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// A small LRU cache of pages of the file, for the sample table boxes that are
+// accessed in place rather than loaded.  The memory used does not depend on the
+// size of the tables, and consecutive entries cost a memcpy() instead of a
+// DataSource::readAt() each.
+struct SampleTable::TableCache {
+    TableCache(const sp<DataSource> &source);
+    ~TableCache();
+
+    ssize_t readAt(off64_t offset, void *data, size_t size);
+
+private:
+    enum {
+        kPageSize = 4096,
+        kNumPages = 16,
+    };
+
+    struct Page {
+        off64_t mOffset;
+        size_t mSize;       // 0 if the page is unused
+        uint32_t mLastUse;
+        uint8_t *mData;
+    };
+
+    Mutex mLock;
+    sp<DataSource> mSource;
+    uint8_t *mStorage;
+    Page mPages[kNumPages];
+    uint32_t mUseCount;
+
+    const Page *getPage_l(off64_t pageOffset);
+
+    DISALLOW_EVIL_CONSTRUCTORS(TableCache);
+};
+
+SampleTable::TableCache::TableCache(const sp<DataSource> &source)
+    : mSource(source),
+      mStorage(new uint8_t[kNumPages * kPageSize]),
+      mUseCount(0) {
+    for (size_t i = 0; i < kNumPages; ++i) {
+        mPages[i].mOffset = -1;
+        mPages[i].mSize = 0;
+        mPages[i].mLastUse = 0;
+        mPages[i].mData = &mStorage[i * kPageSize];
+    }
+}
+
+SampleTable::TableCache::~TableCache() {
+    delete[] mStorage;
+    mStorage = NULL;
+}
+
+const SampleTable::TableCache::Page *SampleTable::TableCache::getPage_l(
+        off64_t pageOffset) {
+    Page *victim = &mPages[0];
+    for (size_t i = 0; i < kNumPages; ++i) {
+        Page *page = &mPages[i];
+        if (page->mSize > 0 && page->mOffset == pageOffset) {
+            page->mLastUse = ++mUseCount;
+            return page;
+        }
+        if (page->mSize == 0 || page->mLastUse < victim->mLastUse) {
+            victim = page;
+        }
+        if (victim->mSize == 0) {
+            break;
+        }
+    }
+
+    ssize_t n = mSource->readAt(pageOffset, victim->mData, kPageSize);
+    if (n <= 0) {
+        victim->mSize = 0;
+        return NULL;
+    }
+    victim->mOffset = pageOffset;
+    victim->mSize = n;
+    victim->mLastUse = ++mUseCount;
+    return victim;
+}
+
+ssize_t SampleTable::TableCache::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    size_t copied = 0;
+    while (copied < size) {
+        off64_t pageOffset = offset & ~(off64_t)(kPageSize - 1);
+        const Page *page = getPage_l(pageOffset);
+        if (page == NULL) {
+            break;
+        }
+        size_t inPage = offset - pageOffset;
+        if (inPage >= page->mSize) {
+            // end of file
+            break;
+        }
+        size_t n = page->mSize - inPage;
+        if (n > size - copied) {
+            n = size - copied;
+        }
+        memcpy((uint8_t *)data + copied, &page->mData[inPage], n);
+        copied += n;
+        offset += n;
+    }
+
+    return copied > 0 ? (ssize_t)copied : ERROR_IO;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct SampleTable::CompositionDeltaLookup {
     CompositionDeltaLookup();
 
     void setEntries(
-            const uint32_t *deltaEntries, size_t numDeltaEntries);
+            TableCache *cache, off64_t entriesOffset, size_t numDeltaEntries);
 
     uint32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
 private:
     Mutex mLock;
 
-    const uint32_t *mDeltaEntries;
+    TableCache *mCache;
+    off64_t mEntriesOffset;
     size_t mNumDeltaEntries;
 
     size_t mCurrentDeltaEntry;
     size_t mCurrentEntrySampleIndex;
+    // mCurrentDeltaEntry as read from the table, valid if mCurrentEntryValid
+    bool mCurrentEntryValid;
+    uint32_t mCurrentEntrySampleCount;
+    uint32_t mCurrentEntryDelta;
 
     DISALLOW_EVIL_CONSTRUCTORS(CompositionDeltaLookup);
 };
 
 SampleTable::CompositionDeltaLookup::CompositionDeltaLookup()
-    : mDeltaEntries(NULL),
+    : mCache(NULL),
+      mEntriesOffset(-1),
       mNumDeltaEntries(0),
       mCurrentDeltaEntry(0),
-      mCurrentEntrySampleIndex(0) {
+      mCurrentEntrySampleIndex(0),
+      mCurrentEntryValid(false),
+      mCurrentEntrySampleCount(0),
+      mCurrentEntryDelta(0) {
 }
 
 void SampleTable::CompositionDeltaLookup::setEntries(
-        const uint32_t *deltaEntries, size_t numDeltaEntries) {
+        TableCache *cache, off64_t entriesOffset, size_t numDeltaEntries) {
     Mutex::Autolock autolock(mLock);
 
-    mDeltaEntries = deltaEntries;
+    mCache = cache;
+    mEntriesOffset = entriesOffset;
     mNumDeltaEntries = numDeltaEntries;
     mCurrentDeltaEntry = 0;
     mCurrentEntrySampleIndex = 0;
+    mCurrentEntryValid = false;
 }
 
 uint32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
         uint32_t sampleIndex) {
     Mutex::Autolock autolock(mLock);
 
-    if (mDeltaEntries == NULL) {
+    if (mCache == NULL) {
         return 0;
     }
 
     if (sampleIndex < mCurrentEntrySampleIndex) {
         mCurrentDeltaEntry = 0;
         mCurrentEntrySampleIndex = 0;
+        mCurrentEntryValid = false;
     }
 
     while (mCurrentDeltaEntry < mNumDeltaEntries) {
-        uint32_t sampleCount = mDeltaEntries[2 * mCurrentDeltaEntry];
-        if (sampleIndex < mCurrentEntrySampleIndex + sampleCount) {
-            return mDeltaEntries[2 * mCurrentDeltaEntry + 1];
+        if (!mCurrentEntryValid) {
+            uint32_t entry[2];
+            if (mCache->readAt(mEntriesOffset + 8 * mCurrentDeltaEntry, entry, sizeof(entry))
+                    < (ssize_t)sizeof(entry)) {
+                return 0;
+            }
+            mCurrentEntrySampleCount = ntohl(entry[0]);
+            mCurrentEntryDelta = ntohl(entry[1]);
+            mCurrentEntryValid = true;
+        }
+        if (sampleIndex < mCurrentEntrySampleIndex + mCurrentEntrySampleCount) {
+            return mCurrentEntryDelta;
         }
 
-        mCurrentEntrySampleIndex += sampleCount;
+        mCurrentEntrySampleIndex += mCurrentEntrySampleCount;
         ++mCurrentDeltaEntry;
+        mCurrentEntryValid = false;
     }
 
     return 0;
@@ -107,6 +237,7 @@ uint32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
 
 SampleTable::SampleTable(const sp<DataSource> &source)
     : mDataSource(source),
+      mTableCache(new TableCache(source)),
       mChunkOffsetOffset(-1),
       mChunkOffsetType(0),
       mNumChunkOffsets(0),
@@ -119,7 +250,7 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
       mSampleTimeEntries(NULL),
-      mCompositionTimeDeltaEntries(NULL),
+      mCompositionTimeDeltaOffset(-1),
       mNumCompositionTimeDeltaEntries(0),
       mCompositionDeltaLookup(new CompositionDeltaLookup),
       mSyncSampleOffset(-1),
@@ -140,9 +271,6 @@ SampleTable::~SampleTable() {
     delete mCompositionDeltaLookup;
     mCompositionDeltaLookup = NULL;
 
-    delete[] mCompositionTimeDeltaEntries;
-    mCompositionTimeDeltaEntries = NULL;
-
     delete[] mSampleTimeEntries;
     mSampleTimeEntries = NULL;
 
@@ -151,6 +279,9 @@ SampleTable::~SampleTable() {
 
     delete mSampleIterator;
     mSampleIterator = NULL;
+
+    delete mTableCache;
+    mTableCache = NULL;
 }
 
 bool SampleTable::isValid() const {
@@ -349,7 +480,7 @@ status_t SampleTable::setCompositionTimeToSampleParams(
         off64_t data_offset, size_t data_size) {
     ALOGI("There are reordered frames present.");
 
-    if (mCompositionTimeDeltaEntries != NULL || data_size < 8) {
+    if (mCompositionTimeDeltaOffset >= 0 || data_size < 8) {
         return ERROR_MALFORMED;
     }
 
@@ -371,24 +502,12 @@ status_t SampleTable::setCompositionTimeToSampleParams(
         return ERROR_MALFORMED;
     }
 
+    mCompositionTimeDeltaOffset = data_offset + 8;
     mNumCompositionTimeDeltaEntries = numEntries;
-    mCompositionTimeDeltaEntries = new uint32_t[2 * numEntries];
-
-    if (mDataSource->readAt(
-                data_offset + 8, mCompositionTimeDeltaEntries, numEntries * 8)
-            < (ssize_t)numEntries * 8) {
-        delete[] mCompositionTimeDeltaEntries;
-        mCompositionTimeDeltaEntries = NULL;
-
-        return ERROR_IO;
-    }
-
-    for (size_t i = 0; i < 2 * numEntries; ++i) {
-        mCompositionTimeDeltaEntries[i] = ntohl(mCompositionTimeDeltaEntries[i]);
-    }
 
+    // the entries are read on demand
     mCompositionDeltaLookup->setEntries(
-            mCompositionTimeDeltaEntries, mNumCompositionTimeDeltaEntries);
+            mTableCache, mCompositionTimeDeltaOffset, mNumCompositionTimeDeltaEntries);
 
     return OK;
 }
@@ -519,8 +638,84 @@ void SampleTable::buildSampleEntriesTable() {
           CompareIncreasingTime);
 }
 
+status_t SampleTable::findSampleAtTimeInOrder(
+        uint32_t req_time, uint32_t *sample_index, uint32_t flags) {
+    if (mNumSampleSizes == 0) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    // Find the last sample at or before req_time, walking the (run length
+    // encoded) time to sample table.
+    uint32_t sampleIndex = 0;
+    uint64_t sampleTime = 0;
+    uint32_t before = 0;
+    uint64_t beforeTime = 0;
+    uint32_t delta = 0;
+    bool found = false;
+    for (uint32_t i = 0; i < mTimeToSampleCount && sampleIndex < mNumSampleSizes; ++i) {
+        uint32_t n = mTimeToSample[2 * i];
+        delta = mTimeToSample[2 * i + 1];
+        if (n == 0) {
+            continue;
+        }
+        uint64_t endTime = sampleTime + (uint64_t)n * delta;
+        if (req_time < endTime) {
+            uint32_t k = (req_time - sampleTime) / delta;
+            before = sampleIndex + k;
+            beforeTime = sampleTime + (uint64_t)k * delta;
+            found = true;
+            break;
+        }
+        before = sampleIndex + n - 1;
+        beforeTime = endTime - delta;
+        sampleIndex += n;
+        sampleTime = endTime;
+    }
+
+    if (before >= mNumSampleSizes) {
+        // malformed, the time to sample table covers more samples than stsz
+        before = mNumSampleSizes - 1;
+        found = false;
+    }
+
+    // the sample following 'before' is at beforeTime + delta, if there is one
+    bool hasAfter = found && before + 1 < mNumSampleSizes;
+
+    switch (flags) {
+        case kFlagBefore:
+            *sample_index = before;
+            break;
+
+        case kFlagAfter:
+            if (beforeTime == req_time) {
+                *sample_index = before;
+            } else if (hasAfter) {
+                *sample_index = before + 1;
+            } else {
+                return ERROR_OUT_OF_RANGE;
+            }
+            break;
+
+        default:
+            CHECK(flags == kFlagClosest);
+
+            *sample_index = before;
+            if (hasAfter && beforeTime + delta - req_time < req_time - beforeTime) {
+                *sample_index = before + 1;
+            }
+            break;
+    }
+
+    return OK;
+}
+
 status_t SampleTable::findSampleAtTime(
         uint32_t req_time, uint32_t *sample_index, uint32_t flags) {
+    if (mCompositionTimeDeltaOffset < 0) {
+        // decoding order is presentation order, no need for a sorted table
+        return findSampleAtTimeInOrder(req_time, sample_index, flags);
+    }
+
     buildSampleEntriesTable();
 
     uint32_t left = 0;
@@ -767,6 +962,10 @@ status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
     return OK;
 }
 
+ssize_t SampleTable::readTableAt(off64_t offset, void *data, size_t size) {
+    return mTableCache->readAt(offset, data, size);
+}
+
 status_t SampleTable::getSampleSize_l(
         uint32_t sampleIndex, size_t *sampleSize) {
     return mSampleIterator->getSampleSizeDirect(
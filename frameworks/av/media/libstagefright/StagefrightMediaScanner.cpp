@@ -21,21 +21,22 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 
 #include <media/stagefright/StagefrightMediaScanner.h>
 
+#include <cutils/properties.h>
 #include <media/mediametadataretriever.h>
 #include <private/media/VideoFrame.h>
+#include <utils/List.h>
 
 // Sonivox includes
 #include <libsonivox/eas.h>
 
 namespace android {
 
-StagefrightMediaScanner::StagefrightMediaScanner() {}
-
-StagefrightMediaScanner::~StagefrightMediaScanner() {}
-
 static bool FileHasAcceptableExtension(const char *extension) {
     static const char *kValidExtensions[] = {
         ".mp3", ".mp4", ".m4a", ".3gp", ".3gpp", ".3g2", ".3gpp2",
@@ -56,6 +57,18 @@ static bool FileHasAcceptableExtension(const char *extension) {
     return false;
 }
 
+static bool IsMIDIExtension(const char *extension) {
+    return !strcasecmp(extension, ".mid")
+            || !strcasecmp(extension, ".smf")
+            || !strcasecmp(extension, ".imy")
+            || !strcasecmp(extension, ".midi")
+            || !strcasecmp(extension, ".xmf")
+            || !strcasecmp(extension, ".rtttl")
+            || !strcasecmp(extension, ".rtx")
+            || !strcasecmp(extension, ".ota")
+            || !strcasecmp(extension, ".mxmf");
+}
+
 static MediaScanResult HandleMIDI(
         const char *filename, MediaScannerClient *client) {
     // get the library configuration and do sanity check
@@ -104,6 +117,475 @@ static MediaScanResult HandleMIDI(
     return MEDIA_SCAN_RESULT_OK;
 }
 
+static const size_t kMaxScanThreads = 4;
+
+// Files waiting for a worker plus results waiting for processFile(). Files
+// found beyond this are processed on the calling thread as they come.
+static const size_t kMaxPrefetchedFiles = 64;
+
+// Keeps what processFileInternal() reports, to be replayed to the real
+// client later.
+struct RecordingClient : public MediaScannerClient {
+    String8 mMimeType;
+    Vector<String8> mNames;
+    Vector<String8> mValues;
+
+    virtual status_t scanFile(const char* /* path */, long long /* lastModified */,
+            long long /* fileSize */, bool /* isDirectory */, bool /* noMedia */) {
+        return OK;
+    }
+
+    virtual status_t handleStringTag(const char* name, const char* value) {
+        mNames.push(String8(name));
+        mValues.push(String8(value));
+        return OK;
+    }
+
+    virtual status_t setMimeType(const char* mimeType) {
+        mMimeType = mimeType;
+        return OK;
+    }
+};
+
+// A bounded pool of threads running processFileInternal() on files
+// processDirectory() is about to report. The client is only ever called on
+// the thread calling processFile(), which may be a Java thread.
+struct StagefrightMediaScanner::Prefetcher {
+    Prefetcher(StagefrightMediaScanner *scanner, size_t numThreads);
+    ~Prefetcher();
+
+    // Does nothing if too many files are outstanding already.
+    void queue(const char *path, long long lastModified, long long fileSize);
+
+    // If "path" was queued, waits for its metadata and reports it to
+    // "client". Returns false if the caller needs to process the file.
+    bool replay(const char *path, MediaScannerClient &client,
+            MediaScanResult *result);
+
+    // Forgets about all files. Those done already but never asked for were
+    // found unchanged by the client and are added to the scanner's journal.
+    void flush();
+
+private:
+    enum State {
+        QUEUED,
+        RUNNING,
+        DONE,
+    };
+
+    struct Entry {
+        State mState;
+        long long mLastModified;
+        long long mFileSize;
+        MediaScanResult mResult;
+        RecordingClient mClient;
+    };
+
+    StagefrightMediaScanner *mScanner;
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mWorkCond;
+    pthread_cond_t mDoneCond;
+
+    pthread_t *mThreads;
+    size_t mNumThreads;
+    bool mExit;
+
+    KeyedVector<String8, Entry *> mEntries;
+    List<String8> mQueue;
+
+    static void *ThreadWrapper(void *me);
+    void threadEntry();
+
+    Prefetcher(const Prefetcher &);
+    Prefetcher &operator=(const Prefetcher &);
+};
+
+StagefrightMediaScanner::Prefetcher::Prefetcher(
+        StagefrightMediaScanner *scanner, size_t numThreads)
+    : mScanner(scanner),
+      mThreads(new pthread_t[numThreads]),
+      mNumThreads(0),
+      mExit(false) {
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mWorkCond, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+
+    for (size_t i = 0; i < numThreads; ++i) {
+        if (pthread_create(&mThreads[mNumThreads], NULL, ThreadWrapper, this)) {
+            ALOGW("Unable to start scanner thread, using %d", (int)mNumThreads);
+            break;
+        }
+        ++mNumThreads;
+    }
+}
+
+StagefrightMediaScanner::Prefetcher::~Prefetcher() {
+    pthread_mutex_lock(&mLock);
+    mExit = true;
+    mQueue.clear();
+    pthread_cond_broadcast(&mWorkCond);
+    pthread_mutex_unlock(&mLock);
+
+    for (size_t i = 0; i < mNumThreads; ++i) {
+        pthread_join(mThreads[i], NULL);
+    }
+
+    delete[] mThreads;
+    mThreads = NULL;
+
+    for (size_t i = 0; i < mEntries.size(); ++i) {
+        delete mEntries.valueAt(i);
+    }
+    mEntries.clear();
+
+    pthread_cond_destroy(&mDoneCond);
+    pthread_cond_destroy(&mWorkCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+void StagefrightMediaScanner::Prefetcher::queue(
+        const char *path, long long lastModified, long long fileSize) {
+    String8 key(path);
+
+    pthread_mutex_lock(&mLock);
+
+    if (mNumThreads > 0
+            && mEntries.size() < kMaxPrefetchedFiles
+            && mEntries.indexOfKey(key) < 0) {
+        Entry *entry = new Entry;
+        entry->mState = QUEUED;
+        entry->mLastModified = lastModified;
+        entry->mFileSize = fileSize;
+        entry->mResult = MEDIA_SCAN_RESULT_SKIPPED;
+
+        mEntries.add(key, entry);
+        mQueue.push_back(key);
+
+        pthread_cond_signal(&mWorkCond);
+    }
+
+    pthread_mutex_unlock(&mLock);
+}
+
+bool StagefrightMediaScanner::Prefetcher::replay(
+        const char *path, MediaScannerClient &client, MediaScanResult *result) {
+    String8 key(path);
+
+    pthread_mutex_lock(&mLock);
+
+    ssize_t index = mEntries.indexOfKey(key);
+    if (index < 0) {
+        pthread_mutex_unlock(&mLock);
+        return false;
+    }
+
+    Entry *entry = mEntries.valueAt(index);
+
+    if (entry->mState == QUEUED) {
+        // Not started yet, cheaper to do it right here.
+        for (List<String8>::iterator it = mQueue.begin();
+                it != mQueue.end(); ++it) {
+            if (*it == key) {
+                mQueue.erase(it);
+                break;
+            }
+        }
+
+        mEntries.removeItemsAt(index);
+        pthread_mutex_unlock(&mLock);
+
+        delete entry;
+        return false;
+    }
+
+    while (entry->mState != DONE) {
+        pthread_cond_wait(&mDoneCond, &mLock);
+    }
+
+    mEntries.removeItem(key);
+    pthread_mutex_unlock(&mLock);
+
+    // Same order of calls processFileInternal() made.
+    MediaScanResult res = entry->mResult;
+    status_t status = OK;
+
+    if (!entry->mClient.mMimeType.isEmpty()) {
+        status = client.setMimeType(entry->mClient.mMimeType.string());
+    }
+
+    for (size_t i = 0; status == OK && i < entry->mClient.mNames.size(); ++i) {
+        status = client.addStringTag(
+                entry->mClient.mNames[i].string(),
+                entry->mClient.mValues[i].string());
+    }
+
+    if (status != OK) {
+        res = MEDIA_SCAN_RESULT_ERROR;
+    }
+
+    delete entry;
+
+    *result = res;
+    return true;
+}
+
+void StagefrightMediaScanner::Prefetcher::flush() {
+    pthread_mutex_lock(&mLock);
+
+    mQueue.clear();
+
+    // Let the workers finish what they started, they own those entries
+    // until then.
+    for (;;) {
+        bool running = false;
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+            if (mEntries.valueAt(i)->mState == RUNNING) {
+                running = true;
+                break;
+            }
+        }
+
+        if (!running) {
+            break;
+        }
+
+        pthread_cond_wait(&mDoneCond, &mLock);
+    }
+
+    for (size_t i = 0; i < mEntries.size(); ++i) {
+        Entry *entry = mEntries.valueAt(i);
+
+        if (entry->mState == DONE && entry->mResult == MEDIA_SCAN_RESULT_OK) {
+            mScanner->updateJournal(
+                    mEntries.keyAt(i).string(),
+                    entry->mLastModified, entry->mFileSize);
+        }
+
+        delete entry;
+    }
+    mEntries.clear();
+
+    pthread_mutex_unlock(&mLock);
+}
+
+// static
+void *StagefrightMediaScanner::Prefetcher::ThreadWrapper(void *me) {
+    static_cast<Prefetcher *>(me)->threadEntry();
+
+    return NULL;
+}
+
+void StagefrightMediaScanner::Prefetcher::threadEntry() {
+    pthread_mutex_lock(&mLock);
+
+    for (;;) {
+        while (!mExit && mQueue.empty()) {
+            pthread_cond_wait(&mWorkCond, &mLock);
+        }
+
+        if (mExit) {
+            break;
+        }
+
+        String8 path = *mQueue.begin();
+        mQueue.erase(mQueue.begin());
+
+        Entry *entry = mEntries.valueFor(path);
+        entry->mState = RUNNING;
+
+        pthread_mutex_unlock(&mLock);
+
+        entry->mResult = mScanner->processFileInternal(
+                path.string(), NULL /* mimeType */, entry->mClient);
+
+        pthread_mutex_lock(&mLock);
+
+        entry->mState = DONE;
+        pthread_cond_broadcast(&mDoneCond);
+    }
+
+    pthread_mutex_unlock(&mLock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+StagefrightMediaScanner::StagefrightMediaScanner()
+    : mPrefetcher(NULL),
+      mJournalDirty(false) {
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("media.scanner.threads", value, "1");
+    long numThreads = strtol(value, NULL, 10);
+
+    if (numThreads > 1) {
+        if (numThreads > (long)kMaxScanThreads) {
+            numThreads = kMaxScanThreads;
+        }
+
+        mPrefetcher = new Prefetcher(this, numThreads);
+        setPrefetchEnabled(true);
+    }
+
+    if (property_get("media.scanner.journal", value, NULL) > 0) {
+        mJournalPath = value;
+        loadJournal();
+    }
+}
+
+StagefrightMediaScanner::~StagefrightMediaScanner() {
+    delete mPrefetcher;
+    mPrefetcher = NULL;
+
+    saveJournal();
+}
+
+void StagefrightMediaScanner::loadJournal() {
+    FILE *file = fopen(mJournalPath.string(), "r");
+    if (file == NULL) {
+        return;
+    }
+
+    // One "<lastModified> <fileSize> <path>" line per file.
+    char line[PATH_MAX + 64];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *end;
+        JournalEntry entry;
+
+        entry.mLastModified = strtoll(line, &end, 10);
+        if (*end != ' ') {
+            continue;
+        }
+        entry.mFileSize = strtoll(end + 1, &end, 10);
+        if (*end != ' ') {
+            continue;
+        }
+        entry.mSeen = false;
+
+        char *path = end + 1;
+        size_t length = strlen(path);
+        if (length == 0 || path[length - 1] != '\n') {
+            continue;
+        }
+        path[length - 1] = '\0';
+
+        mJournal.add(String8(path), entry);
+    }
+
+    fclose(file);
+
+    ALOGV("loaded %d journal entries", (int)mJournal.size());
+}
+
+void StagefrightMediaScanner::saveJournal() {
+    if (mJournalPath.isEmpty() || !mJournalDirty) {
+        return;
+    }
+
+    String8 tmpPath = mJournalPath;
+    tmpPath.append(".tmp");
+
+    FILE *file = fopen(tmpPath.string(), "w");
+    if (file == NULL) {
+        ALOGW("Unable to write scanner journal '%s'", tmpPath.string());
+        return;
+    }
+
+    for (size_t i = 0; i < mJournal.size(); ++i) {
+        const JournalEntry &entry = mJournal.valueAt(i);
+        fprintf(file, "%lld %lld %s\n",
+                entry.mLastModified, entry.mFileSize,
+                mJournal.keyAt(i).string());
+    }
+
+    bool ok = (fflush(file) == 0 && fsync(fileno(file)) == 0);
+    fclose(file);
+
+    if (!ok || rename(tmpPath.string(), mJournalPath.string()) != 0) {
+        ALOGW("Unable to write scanner journal '%s'", mJournalPath.string());
+        unlink(tmpPath.string());
+        return;
+    }
+
+    mJournalDirty = false;
+}
+
+void StagefrightMediaScanner::updateJournal(
+        const char *path, long long lastModified, long long fileSize) {
+    if (mJournalPath.isEmpty()) {
+        return;
+    }
+
+    JournalEntry entry;
+    entry.mLastModified = lastModified;
+    entry.mFileSize = fileSize;
+    entry.mSeen = true;
+
+    mJournal.replaceValueFor(String8(path), entry);
+    mJournalDirty = true;
+}
+
+void StagefrightMediaScanner::pruneJournal(const char *dir) {
+    size_t length = strlen(dir);
+
+    // Files below "dir" that were not found by this scan are gone.
+    for (size_t i = mJournal.size(); i-- > 0;) {
+        JournalEntry &entry = mJournal.editValueAt(i);
+        if (!strncmp(mJournal.keyAt(i).string(), dir, length)) {
+            if (!entry.mSeen) {
+                mJournal.removeItemsAt(i);
+                mJournalDirty = true;
+                continue;
+            }
+        }
+        entry.mSeen = false;
+    }
+}
+
+MediaScanResult StagefrightMediaScanner::processDirectory(
+        const char *path, MediaScannerClient &client) {
+    MediaScanResult result = MediaScanner::processDirectory(path, client);
+
+    if (mPrefetcher != NULL) {
+        mPrefetcher->flush();
+    }
+
+    // Only prefetching keeps track of which files are still around.
+    if (mPrefetcher != NULL && result == MEDIA_SCAN_RESULT_OK) {
+        pruneJournal(path);
+    }
+    saveJournal();
+
+    return result;
+}
+
+void StagefrightMediaScanner::prefetchFile(
+        const char *path, long long lastModified, long long fileSize) {
+    ssize_t index = mJournal.indexOfKey(String8(path));
+    if (index >= 0) {
+        JournalEntry &entry = mJournal.editValueAt(index);
+        entry.mSeen = true;
+
+        if (entry.mLastModified == lastModified
+                && entry.mFileSize == fileSize) {
+            // The client has seen this one already and won't ask again.
+            return;
+        }
+    }
+
+    // MIDI files are cheap to parse and the EAS engine is best left to a
+    // single thread.
+    const char *extension = strrchr(path, '.');
+    if (mPrefetcher == NULL
+            || extension == NULL
+            || !FileHasAcceptableExtension(extension)
+            || IsMIDIExtension(extension)) {
+        return;
+    }
+
+    mPrefetcher->queue(path, lastModified, fileSize);
+}
+
 MediaScanResult StagefrightMediaScanner::processFile(
         const char *path, const char *mimeType,
         MediaScannerClient &client) {
@@ -111,8 +593,17 @@ MediaScanResult StagefrightMediaScanner::processFile(
 
     client.setLocale(locale());
     client.beginFile();
-    MediaScanResult result = processFileInternal(path, mimeType, client);
+    MediaScanResult result;
+    if (mPrefetcher == NULL || !mPrefetcher->replay(path, client, &result)) {
+        result = processFileInternal(path, mimeType, client);
+    }
     client.endFile();
+
+    struct stat statbuf;
+    if (result == MEDIA_SCAN_RESULT_OK && stat(path, &statbuf) == 0) {
+        updateJournal(path, statbuf.st_mtime, statbuf.st_size);
+    }
+
     return result;
 }
 
@@ -129,15 +620,7 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
         return MEDIA_SCAN_RESULT_SKIPPED;
     }
 
-    if (!strcasecmp(extension, ".mid")
-            || !strcasecmp(extension, ".smf")
-            || !strcasecmp(extension, ".imy")
-            || !strcasecmp(extension, ".midi")
-            || !strcasecmp(extension, ".xmf")
-            || !strcasecmp(extension, ".rtttl")
-            || !strcasecmp(extension, ".rtx")
-            || !strcasecmp(extension, ".ota")
-            || !strcasecmp(extension, ".mxmf")) {
+    if (IsMIDIExtension(extension)) {
         return HandleMIDI(path, &client);
     }
 
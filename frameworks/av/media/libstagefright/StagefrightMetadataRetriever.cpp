@@ -28,12 +28,15 @@
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/OMXCodec.h>
 #include <media/stagefright/MediaDefs.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
 
 namespace android {
 
 StagefrightMetadataRetriever::StagefrightMetadataRetriever()
     : mParsedMetaData(false),
-      mAlbumArt(NULL) {
+      mAlbumArt(NULL),
+      mParsedAlbumArt(false) {
     ALOGV("StagefrightMetadataRetriever()");
 
     DataSource::RegisterDefaultSniffers();
@@ -46,9 +49,19 @@ StagefrightMetadataRetriever::~StagefrightMetadataRetriever() {
     delete mAlbumArt;
     mAlbumArt = NULL;
 
+    clearVideoDecoder();
+
     mClient.disconnect();
 }
 
+void StagefrightMetadataRetriever::clearVideoDecoder() {
+    if (mVideoDecoder != NULL) {
+        mVideoDecoder->stop();
+        mVideoDecoder.clear();
+    }
+    mVideoTrackMeta.clear();
+}
+
 status_t StagefrightMetadataRetriever::setDataSource(
         const char *uri, const KeyedVector<String8, String8> *headers) {
     ALOGV("setDataSource(%s)", uri);
@@ -57,6 +70,8 @@ status_t StagefrightMetadataRetriever::setDataSource(
     mMetaData.clear();
     delete mAlbumArt;
     mAlbumArt = NULL;
+    mParsedAlbumArt = false;
+    clearVideoDecoder();
 
     mSource = DataSource::CreateFromURI(uri, headers);
 
@@ -89,6 +104,8 @@ status_t StagefrightMetadataRetriever::setDataSource(
     mMetaData.clear();
     delete mAlbumArt;
     mAlbumArt = NULL;
+    mParsedAlbumArt = false;
+    clearVideoDecoder();
 
     mSource = new FileSource(fd, offset, length);
 
@@ -110,13 +127,13 @@ status_t StagefrightMetadataRetriever::setDataSource(
     return OK;
 }
 
-static bool isYUV420PlanarSupported(
-            OMXClient *client,
-            const sp<MetaData> &trackMeta) {
-
-    const char *mime;
-    CHECK(trackMeta->findCString(kKeyMIMEType, &mime));
+// QueryCodecs() instantiates every matching hardware decoder, which is far
+// too slow to do for each thumbnail of a media scan. The answer only
+// depends on the mime type, so it is kept for the life of the process.
+static Mutex gYUV420PlanarSupportLock;
+static KeyedVector<String8, bool> gYUV420PlanarSupport;
 
+static bool queryYUV420PlanarSupported(OMXClient *client, const char *mime) {
     Vector<CodecCapabilities> caps;
     if (QueryCodecs(client->interface(), mime,
                     true, /* queryDecoders */
@@ -135,13 +152,50 @@ static bool isYUV420PlanarSupported(
     return false;
 }
 
-static VideoFrame *extractVideoFrameWithCodecFlags(
+static bool isYUV420PlanarSupported(
+            OMXClient *client,
+            const sp<MetaData> &trackMeta) {
+
+    const char *mime;
+    CHECK(trackMeta->findCString(kKeyMIMEType, &mime));
+
+    String8 key(mime);
+    key.toLower();
+
+    {
+        Mutex::Autolock autoLock(gYUV420PlanarSupportLock);
+        ssize_t index = gYUV420PlanarSupport.indexOfKey(key);
+        if (index >= 0) {
+            return gYUV420PlanarSupport.valueAt(index);
+        }
+    }
+
+    bool supported = queryYUV420PlanarSupported(client, mime);
+
+    Mutex::Autolock autoLock(gYUV420PlanarSupportLock);
+    gYUV420PlanarSupport.add(key, supported);
+
+    return supported;
+}
+
+static bool isSoftwareDecoder(const sp<MediaSource> &decoder) {
+    const char *componentName;
+    if (!decoder->getFormat()->findCString(
+                kKeyDecoderComponent, &componentName)) {
+        return false;
+    }
+
+    // Same rule as OMXCodec's.
+    return !strncmp("OMX.google.", componentName, 11)
+        || strncmp("OMX.", componentName, 4);
+}
+
+// Returns a started decoder for "source", or NULL.
+static sp<MediaSource> createVideoDecoder(
         OMXClient *client,
         const sp<MetaData> &trackMeta,
         const sp<MediaSource> &source,
-        uint32_t flags,
-        int64_t frameTimeUs,
-        int seekMode) {
+        uint32_t flags) {
 
     sp<MetaData> format = source->getFormat();
 
@@ -169,6 +223,19 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         return NULL;
     }
 
+    return decoder;
+}
+
+// Decodes the frame at (or, depending on seekMode, near) frameTimeUs with
+// a started decoder and converts it to RGB565. The decoder is left running
+// so that it can be seeked again.
+static VideoFrame *extractVideoFrame(
+        const sp<MediaSource> &decoder,
+        const sp<MetaData> &trackMeta,
+        int64_t frameTimeUs,
+        int seekMode) {
+    status_t err;
+
     // Read one output buffer, ignore format change notifications
     // and spurious empty buffers.
 
@@ -189,6 +256,12 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
                 || thumbNailTime < 0) {
             thumbNailTime = 0;
         }
+
+        // Any representative frame will do, don't decode past the sync
+        // frame to get to an exact time.
+        if (mode == MediaSource::ReadOptions::SEEK_CLOSEST) {
+            mode = MediaSource::ReadOptions::SEEK_CLOSEST_SYNC;
+        }
         options.setSeekTo(thumbNailTime, mode);
     } else {
         thumbNailTime = -1;
@@ -210,7 +283,6 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         CHECK(buffer == NULL);
 
         ALOGV("decoding frame failed.");
-        decoder->stop();
 
         return NULL;
     }
@@ -226,8 +298,6 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         buffer->release();
         buffer = NULL;
 
-        decoder->stop();
-
         return NULL;
     }
 
@@ -306,8 +376,6 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
     buffer->release();
     buffer = NULL;
 
-    decoder->stop();
-
     if (err != OK) {
         ALOGE("Colorconverter failed to convert frame.");
 
@@ -323,6 +391,18 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
 
     ALOGV("getFrameAtTime: %lld us option: %d", timeUs, option);
 
+    if (mVideoDecoder != NULL) {
+        VideoFrame *frame =
+            extractVideoFrame(mVideoDecoder, mVideoTrackMeta, timeUs, option);
+
+        if (frame != NULL) {
+            return frame;
+        }
+
+        ALOGV("cached decoder failed to extract frame, starting over.");
+        clearVideoDecoder();
+    }
+
     if (mExtractor.get() == NULL) {
         ALOGV("no extractor.");
         return NULL;
@@ -380,17 +460,34 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
         memcpy(mAlbumArt->mData, data, dataSize);
     }
 
-    VideoFrame *frame =
-        extractVideoFrameWithCodecFlags(
-                &mClient, trackMeta, source, OMXCodec::kPreferSoftwareCodecs,
-                timeUs, option);
+    VideoFrame *frame = NULL;
+
+    sp<MediaSource> decoder = createVideoDecoder(
+            &mClient, trackMeta, source, OMXCodec::kPreferSoftwareCodecs);
+
+    if (decoder != NULL) {
+        frame = extractVideoFrame(decoder, trackMeta, timeUs, option);
+
+        // Hardware decoder instances are scarce, only hold on to software
+        // ones between calls.
+        if (frame != NULL && isSoftwareDecoder(decoder)) {
+            mVideoDecoder = decoder;
+            mVideoTrackMeta = trackMeta;
+        } else {
+            decoder->stop();
+        }
+    }
 
     if (frame == NULL) {
         ALOGV("Software decoder failed to extract thumbnail, "
              "trying hardware decoder.");
 
-        frame = extractVideoFrameWithCodecFlags(&mClient, trackMeta, source, 0,
-                        timeUs, option);
+        decoder = createVideoDecoder(&mClient, trackMeta, source, 0);
+
+        if (decoder != NULL) {
+            frame = extractVideoFrame(decoder, trackMeta, timeUs, option);
+            decoder->stop();
+        }
     }
 
     return frame;
@@ -409,6 +506,23 @@ MediaAlbumArt *StagefrightMetadataRetriever::extractAlbumArt() {
         mParsedMetaData = true;
     }
 
+    if (mAlbumArt == NULL && !mParsedAlbumArt) {
+        mParsedAlbumArt = true;
+
+        sp<MetaData> meta = mExtractor->getMetaDataWithFlags(
+                MediaExtractor::kIncludeAlbumArt);
+
+        const void *data;
+        uint32_t type;
+        size_t dataSize;
+        if (meta != NULL && meta->findData(kKeyAlbumArt, &type, &data, &dataSize)) {
+            mAlbumArt = new MediaAlbumArt;
+            mAlbumArt->mSize = dataSize;
+            mAlbumArt->mData = new uint8_t[dataSize];
+            memcpy(mAlbumArt->mData, data, dataSize);
+        }
+    }
+
     if (mAlbumArt) {
         return new MediaAlbumArt(*mAlbumArt);
     }
@@ -437,7 +551,8 @@ const char *StagefrightMetadataRetriever::extractMetadata(int keyCode) {
 }
 
 void StagefrightMetadataRetriever::parseMetaData() {
-    sp<MetaData> meta = mExtractor->getMetaData();
+    // Album art is only read if extractAlbumArt() asks for it
+    sp<MetaData> meta = mExtractor->getMetaDataWithFlags(0);
 
     if (meta == NULL) {
         ALOGV("extractor doesn't publish metadata, failed to initialize?");
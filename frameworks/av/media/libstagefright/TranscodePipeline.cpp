@@ -0,0 +1,1208 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TranscodePipeline"
+#include <utils/Log.h>
+
+#include <media/stagefright/TranscodePipeline.h>
+
+#include <gui/Surface.h>
+#include <media/ICrypto.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaMuxer.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/List.h>
+
+#include <OMX_IVCommon.h>
+
+namespace android {
+
+// Large enough for any compressed sample we expect to see, grown on demand.
+static const size_t kInitialSampleBufferSize = 1024 * 1024;
+
+TranscodePipeline::Options::Options()
+    : mVideoMime(MEDIA_MIMETYPE_VIDEO_AVC),
+      mVideoBitrate(4000000),
+      mFrameRate(30),
+      mIFrameIntervalSecs(1),
+      mAudioMime(MEDIA_MIMETYPE_AUDIO_AAC),
+      mAudioBitrate(128000),
+      mQueueDepth(8) {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Runs step() on its own looper for as long as it makes progress, keeping
+// track of the time actually spent doing work. A stage with nothing to do
+// sleeps until a neighbour or one of its codecs kicks it.
+struct TranscodePipeline::Stage : public AHandler {
+    Stage(TranscodePipeline *pipeline, const char *name)
+        : mPipeline(pipeline),
+          mNumBuffers(0ll),
+          mName(name),
+          mBusyUs(0ll),
+          mDone(false) {
+    }
+
+    status_t start() {
+        mLooper = new ALooper;
+        mLooper->setName(mName.c_str());
+        mLooper->registerHandler(this);
+
+        status_t err = mLooper->start();
+        if (err != OK) {
+            return err;
+        }
+
+        kick();
+        return OK;
+    }
+
+    void stop() {
+        if (mLooper == NULL) {
+            return;
+        }
+        mLooper->stop();
+        mLooper->unregisterHandler(id());
+        mLooper.clear();
+    }
+
+    // Makes the stage look for work, from any thread.
+    void kick() {
+        (new AMessage(kWhatStep, id()))->post();
+    }
+
+    void getStats(StageStats *stats) const {
+        stats->mName = mName;
+        stats->mBusyUs = mBusyUs;
+        stats->mNumBuffers = mNumBuffers;
+    }
+
+protected:
+    TranscodePipeline *mPipeline;
+    int64_t mNumBuffers;
+
+    // Returns OK if work was done, -EAGAIN if the stage is waiting on one
+    // of its neighbours, ERROR_END_OF_STREAM once it has nothing more to do.
+    // Before returning -EAGAIN, a stage waiting on a codec must call
+    // waitForCodec().
+    virtual status_t step() = 0;
+
+    // The codec kicks the stage once it has a buffer to hand out. It must
+    // not hold any buffer the stage isn't ready to take, or the stage would
+    // be kicked right away, again and again.
+    void waitForCodec(const sp<MediaCodec> &codec) {
+        codec->requestActivityNotification(new AMessage(kWhatStep, id()));
+    }
+
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        switch (msg->what()) {
+            case kWhatStep:
+            {
+                // Kicks keep coming from the neighbours once we're done.
+                if (mDone) {
+                    break;
+                }
+
+                int64_t startUs = ALooper::GetNowUs();
+                status_t err = step();
+
+                if (err == OK) {
+                    mBusyUs += ALooper::GetNowUs() - startUs;
+                    kick();
+                } else if (err == -EAGAIN) {
+                    // sleep until kicked
+                } else if (err == ERROR_END_OF_STREAM) {
+                    ALOGV("%s done", mName.c_str());
+                    mDone = true;
+                    mPipeline->onStageDone(this);
+                } else {
+                    ALOGE("%s failed (err=%d)", mName.c_str(), err);
+                    mDone = true;
+                    mPipeline->onStageError(this, err);
+                }
+                break;
+            }
+
+            default:
+                TRESPASS();
+        }
+    }
+
+    virtual ~Stage() {}
+
+private:
+    enum {
+        kWhatStep = 'step',
+    };
+
+    AString mName;
+    sp<ALooper> mLooper;
+    int64_t mBusyUs;
+    bool mDone;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Stage);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A bounded FIFO between two stages. The end of the stream is marked by an
+// empty buffer carrying the "eos" flag in its meta data. Every buffer carries
+// its presentation time as "timeUs".
+//
+// Pushing to an empty queue kicks the consumer, popping from a full one kicks
+// the producer, those are the only times either can be waiting on the queue.
+struct TranscodePipeline::BufferQueue : public RefBase {
+    BufferQueue(size_t capacity)
+        : mCapacity(capacity),
+          mCount(0),
+          mProducer(NULL),
+          mConsumer(NULL) {
+    }
+
+    // Both stages outlive the queue's use.
+    void setStages(Stage *producer, Stage *consumer) {
+        mProducer = producer;
+        mConsumer = consumer;
+    }
+
+    // Returns false, leaving the queue untouched, if it is full.
+    bool push(const sp<ABuffer> &buffer) {
+        bool wasEmpty;
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (mCount >= mCapacity) {
+                return false;
+            }
+            mBuffers.push_back(buffer);
+            wasEmpty = (mCount++ == 0);
+        }
+
+        if (wasEmpty) {
+            mConsumer->kick();
+        }
+        return true;
+    }
+
+    bool pop(sp<ABuffer> *buffer) {
+        bool wasFull;
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (mCount == 0) {
+                return false;
+            }
+            *buffer = *mBuffers.begin();
+            mBuffers.erase(mBuffers.begin());
+            wasFull = (mCount-- >= mCapacity);
+        }
+
+        if (wasFull) {
+            mProducer->kick();
+        }
+        return true;
+    }
+
+    bool isFull() const {
+        Mutex::Autolock autoLock(mLock);
+        return mCount >= mCapacity;
+    }
+
+    static sp<ABuffer> CreateEOS() {
+        sp<ABuffer> buffer = new ABuffer(0);
+        buffer->meta()->setInt32("eos", true);
+        return buffer;
+    }
+
+    static bool IsEOS(const sp<ABuffer> &buffer) {
+        int32_t eos;
+        return buffer->meta()->findInt32("eos", &eos) && eos;
+    }
+
+protected:
+    virtual ~BufferQueue() {}
+
+private:
+    mutable Mutex mLock;
+    size_t mCapacity;
+    size_t mCount;
+    List<sp<ABuffer> > mBuffers;
+
+    Stage *mProducer;
+    Stage *mConsumer;
+
+    DISALLOW_EVIL_CONSTRUCTORS(BufferQueue);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TranscodePipeline::Track {
+    Track()
+        : mSourceIndex(0),
+          mIsVideo(false),
+          mBytesPerSecond(0),
+          mMuxerTrackIndex(-1) {
+    }
+
+    size_t mSourceIndex;
+    bool mIsVideo;
+    sp<AMessage> mSourceFormat;
+
+    // MediaCodec blocks on its own looper for every call, so neither codec
+    // can share a looper with the stage that drives it.
+    sp<ALooper> mDecoderLooper;
+    sp<ALooper> mEncoderLooper;
+
+    sp<MediaCodec> mDecoder;
+    sp<MediaCodec> mEncoder;
+
+    Vector<sp<ABuffer> > mDecoderInputBuffers;
+    Vector<sp<ABuffer> > mDecoderOutputBuffers;
+    Vector<sp<ABuffer> > mEncoderInputBuffers;
+    Vector<sp<ABuffer> > mEncoderOutputBuffers;
+
+    // compressed samples, extract -> decode
+    sp<BufferQueue> mDecodeQueue;
+
+    // PCM, decode -> encode, audio only
+    sp<BufferQueue> mEncodeQueue;
+    int32_t mBytesPerSecond;
+
+    // compressed samples, encode -> mux
+    sp<BufferQueue> mMuxQueue;
+
+    // guarded by TranscodePipeline::mLock
+    sp<AMessage> mOutputFormat;
+
+    ssize_t mMuxerTrackIndex;
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(Track);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Takes every input buffer the codec has to give, so that it can only kick
+// the stage for its output afterwards.
+static status_t DequeueInputBuffers(
+        const sp<MediaCodec> &codec, List<size_t> *indices) {
+    for (;;) {
+        size_t index;
+        status_t err = codec->dequeueInputBuffer(&index);
+
+        if (err == -EAGAIN) {
+            return OK;
+        } else if (err != OK) {
+            return err;
+        }
+
+        indices->push_back(index);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TranscodePipeline::ExtractStage : public TranscodePipeline::Stage {
+    ExtractStage(TranscodePipeline *pipeline)
+        : Stage(pipeline, "extract"),
+          mScratch(new ABuffer(kInitialSampleBufferSize)),
+          mPendingTrack(NULL),
+          mReachedEOS(false) {
+    }
+
+protected:
+    virtual status_t step() {
+        if (mPendingTrack != NULL) {
+            if (!mPendingTrack->mDecodeQueue->push(mPendingBuffer)) {
+                return -EAGAIN;
+            }
+            mPendingTrack = NULL;
+            mPendingBuffer.clear();
+        }
+
+        if (mReachedEOS) {
+            return pushEOS();
+        }
+
+        size_t sourceIndex;
+        status_t err = mPipeline->mExtractor->getSampleTrackIndex(&sourceIndex);
+
+        if (err == ERROR_END_OF_STREAM) {
+            mReachedEOS = true;
+            return pushEOS();
+        } else if (err != OK) {
+            return err;
+        }
+
+        Track *track = mPipeline->trackForSource(sourceIndex);
+        CHECK(track != NULL);
+
+        for (;;) {
+            err = mPipeline->mExtractor->readSampleData(mScratch);
+            if (err != -ENOMEM) {
+                break;
+            }
+            mScratch = new ABuffer(mScratch->capacity() * 2);
+        }
+
+        if (err != OK) {
+            return err;
+        }
+
+        int64_t timeUs;
+        CHECK_EQ(mPipeline->mExtractor->getSampleTime(&timeUs), (status_t)OK);
+
+        // The scratch buffer is sized for the worst case, the queue only
+        // ever holds what the sample needs.
+        sp<ABuffer> buffer = new ABuffer(mScratch->size());
+        memcpy(buffer->data(), mScratch->data(), mScratch->size());
+        buffer->meta()->setInt64("timeUs", timeUs);
+
+        mPipeline->mExtractor->advance();
+        ++mNumBuffers;
+
+        if (!track->mDecodeQueue->push(buffer)) {
+            mPendingTrack = track;
+            mPendingBuffer = buffer;
+        }
+
+        return OK;
+    }
+
+private:
+    sp<ABuffer> mScratch;
+
+    Track *mPendingTrack;
+    sp<ABuffer> mPendingBuffer;
+
+    bool mReachedEOS;
+    Vector<Track *> mTracksSignalled;
+
+    status_t pushEOS() {
+        for (size_t i = 0; i < mPipeline->mTracks.size(); ++i) {
+            Track *track = mPipeline->mTracks.itemAt(i);
+
+            bool signalled = false;
+            for (size_t j = 0; j < mTracksSignalled.size(); ++j) {
+                if (mTracksSignalled.itemAt(j) == track) {
+                    signalled = true;
+                    break;
+                }
+            }
+
+            if (!signalled) {
+                if (!track->mDecodeQueue->push(BufferQueue::CreateEOS())) {
+                    return -EAGAIN;
+                }
+                mTracksSignalled.push(track);
+            }
+        }
+
+        return ERROR_END_OF_STREAM;
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(ExtractStage);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TranscodePipeline::DecodeStage : public TranscodePipeline::Stage {
+    DecodeStage(TranscodePipeline *pipeline, Track *track)
+        : Stage(pipeline, track->mIsVideo ? "decode-video" : "decode-audio"),
+          mTrack(track),
+          mInputDone(false) {
+    }
+
+protected:
+    virtual status_t step() {
+        bool progress = false;
+
+        status_t err = feedInput(&progress);
+        if (err != OK) {
+            return err;
+        }
+
+        bool outputBlocked = false;
+        err = drainOutput(&progress, &outputBlocked);
+        if (err != OK || progress) {
+            return err;
+        }
+
+        // While the encode queue is full the decoder is holding output we
+        // can't take, its pop will kick us instead.
+        if (!outputBlocked) {
+            waitForCodec(mTrack->mDecoder);
+        }
+        return -EAGAIN;
+    }
+
+private:
+    Track *mTrack;
+    bool mInputDone;
+
+    // decoder input buffers we own, waiting for a sample
+    List<size_t> mInputIndices;
+
+    status_t feedInput(bool *progress) {
+        Track *track = mTrack;
+
+        // Also after the end of the input, see waitForCodec().
+        status_t err = DequeueInputBuffers(track->mDecoder, &mInputIndices);
+        if (err != OK || mInputDone || mInputIndices.empty()) {
+            return err;
+        }
+
+        sp<ABuffer> buffer;
+        if (!track->mDecodeQueue->pop(&buffer)) {
+            return OK;
+        }
+
+        size_t index = *mInputIndices.begin();
+        mInputIndices.erase(mInputIndices.begin());
+        *progress = true;
+
+        if (BufferQueue::IsEOS(buffer)) {
+            mInputDone = true;
+            return track->mDecoder->queueInputBuffer(
+                    index, 0, 0, 0ll, MediaCodec::BUFFER_FLAG_EOS);
+        }
+
+        const sp<ABuffer> &dst = track->mDecoderInputBuffers.itemAt(index);
+        if (buffer->size() > dst->capacity()) {
+            ALOGE("sample of %d bytes does not fit the decoder's input buffer",
+                  buffer->size());
+            return -ERANGE;
+        }
+
+        memcpy(dst->data(), buffer->data(), buffer->size());
+
+        int64_t timeUs;
+        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+
+        return track->mDecoder->queueInputBuffer(
+                index, 0, buffer->size(), timeUs, 0);
+    }
+
+    status_t drainOutput(bool *progress, bool *blocked) {
+        Track *track = mTrack;
+
+        if (!track->mIsVideo && track->mEncodeQueue->isFull()) {
+            *blocked = true;
+            return OK;
+        }
+
+        size_t index, offset, size;
+        int64_t timeUs;
+        uint32_t flags;
+        status_t err = track->mDecoder->dequeueOutputBuffer(
+                &index, &offset, &size, &timeUs, &flags);
+
+        if (err == -EAGAIN) {
+            return OK;
+        }
+
+        *progress = true;
+
+        if (err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            return track->mDecoder->getOutputBuffers(
+                    &track->mDecoderOutputBuffers);
+        } else if (err == INFO_FORMAT_CHANGED) {
+            if (!track->mIsVideo) {
+                sp<AMessage> format;
+                err = track->mDecoder->getOutputFormat(&format);
+                if (err != OK) {
+                    return err;
+                }
+
+                int32_t sampleRate, channelCount;
+                CHECK(format->findInt32("sample-rate", &sampleRate));
+                CHECK(format->findInt32("channel-count", &channelCount));
+                track->mBytesPerSecond =
+                    sampleRate * channelCount * sizeof(int16_t);
+            }
+            return OK;
+        } else if (err != OK) {
+            return err;
+        }
+
+        if (track->mIsVideo) {
+            if (size > 0) {
+                // The encoder's input surface takes the frame's timestamp
+                // as the presentation time of what it encodes from it.
+                err = track->mDecoder->renderOutputBufferAndRelease(
+                        index, timeUs * 1000ll);
+            } else {
+                err = track->mDecoder->releaseOutputBuffer(index);
+            }
+        } else {
+            if (size > 0) {
+                const sp<ABuffer> &src =
+                    track->mDecoderOutputBuffers.itemAt(index);
+
+                sp<ABuffer> buffer = new ABuffer(size);
+                memcpy(buffer->data(), src->data() + offset, size);
+                buffer->meta()->setInt64("timeUs", timeUs);
+
+                // Checked for room above, and this stage is the only producer.
+                CHECK(track->mEncodeQueue->push(buffer));
+            }
+            err = track->mDecoder->releaseOutputBuffer(index);
+        }
+
+        if (err != OK) {
+            return err;
+        }
+
+        ++mNumBuffers;
+
+        if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+            if (track->mIsVideo) {
+                err = track->mEncoder->signalEndOfInputStream();
+            } else {
+                CHECK(track->mEncodeQueue->push(BufferQueue::CreateEOS()));
+            }
+            return err != OK ? err : ERROR_END_OF_STREAM;
+        }
+
+        return OK;
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(DecodeStage);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TranscodePipeline::EncodeStage : public TranscodePipeline::Stage {
+    EncodeStage(TranscodePipeline *pipeline, Track *track)
+        : Stage(pipeline, track->mIsVideo ? "encode-video" : "encode-audio"),
+          mTrack(track),
+          mInputDone(false) {
+    }
+
+protected:
+    virtual status_t step() {
+        bool progress = false;
+
+        // video frames reach the encoder through its input surface
+        if (!mTrack->mIsVideo) {
+            status_t err = feedInput(&progress);
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        bool outputBlocked = false;
+        status_t err = drainOutput(&progress, &outputBlocked);
+        if (err != OK || progress) {
+            return err;
+        }
+
+        // While the mux queue is full its pop kicks us instead.
+        if (!outputBlocked) {
+            waitForCodec(mTrack->mEncoder);
+        }
+        return -EAGAIN;
+    }
+
+private:
+    Track *mTrack;
+    bool mInputDone;
+
+    // encoder input buffers we own, waiting for PCM
+    List<size_t> mInputIndices;
+
+    // PCM left over from a buffer that did not fit the encoder's input
+    sp<ABuffer> mPendingPCM;
+
+    status_t feedInput(bool *progress) {
+        Track *track = mTrack;
+
+        // Also after the end of the input, see waitForCodec().
+        status_t err = DequeueInputBuffers(track->mEncoder, &mInputIndices);
+        if (err != OK || mInputDone || mInputIndices.empty()) {
+            return err;
+        }
+
+        if (mPendingPCM == NULL && !track->mEncodeQueue->pop(&mPendingPCM)) {
+            return OK;
+        }
+
+        size_t index = *mInputIndices.begin();
+        mInputIndices.erase(mInputIndices.begin());
+        *progress = true;
+
+        if (BufferQueue::IsEOS(mPendingPCM)) {
+            mPendingPCM.clear();
+            mInputDone = true;
+            return track->mEncoder->queueInputBuffer(
+                    index, 0, 0, 0ll, MediaCodec::BUFFER_FLAG_EOS);
+        }
+
+        const sp<ABuffer> &dst = track->mEncoderInputBuffers.itemAt(index);
+
+        size_t size = mPendingPCM->size();
+        if (size > dst->capacity()) {
+            size = dst->capacity();
+        }
+
+        memcpy(dst->data(), mPendingPCM->data(), size);
+
+        int64_t timeUs;
+        CHECK(mPendingPCM->meta()->findInt64("timeUs", &timeUs));
+
+        err = track->mEncoder->queueInputBuffer(index, 0, size, timeUs, 0);
+        if (err != OK) {
+            return err;
+        }
+
+        if (size == mPendingPCM->size()) {
+            mPendingPCM.clear();
+        } else {
+            mPendingPCM->setRange(
+                    mPendingPCM->offset() + size, mPendingPCM->size() - size);
+
+            if (track->mBytesPerSecond > 0) {
+                timeUs += (int64_t)size * 1000000ll / track->mBytesPerSecond;
+            }
+            mPendingPCM->meta()->setInt64("timeUs", timeUs);
+        }
+
+        return OK;
+    }
+
+    status_t drainOutput(bool *progress, bool *blocked) {
+        Track *track = mTrack;
+
+        if (track->mMuxQueue->isFull()) {
+            *blocked = true;
+            return OK;
+        }
+
+        size_t index, offset, size;
+        int64_t timeUs;
+        uint32_t flags;
+        status_t err = track->mEncoder->dequeueOutputBuffer(
+                &index, &offset, &size, &timeUs, &flags);
+
+        if (err == -EAGAIN) {
+            return OK;
+        }
+
+        *progress = true;
+
+        if (err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            return track->mEncoder->getOutputBuffers(
+                    &track->mEncoderOutputBuffers);
+        } else if (err == INFO_FORMAT_CHANGED) {
+            // The format carries the codec specific data, so the config
+            // buffers themselves need not reach the muxer.
+            sp<AMessage> format;
+            err = track->mEncoder->getOutputFormat(&format);
+            if (err != OK) {
+                return err;
+            }
+            mPipeline->setOutputFormat(track, format);
+            return OK;
+        } else if (err != OK) {
+            return err;
+        }
+
+        if (size > 0 && !(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
+            const sp<ABuffer> &src = track->mEncoderOutputBuffers.itemAt(index);
+
+            sp<ABuffer> buffer = new ABuffer(size);
+            memcpy(buffer->data(), src->data() + offset, size);
+            buffer->meta()->setInt64("timeUs", timeUs);
+            buffer->meta()->setInt32(
+                    "flags", flags & MediaCodec::BUFFER_FLAG_SYNCFRAME);
+
+            CHECK(track->mMuxQueue->push(buffer));
+            ++mNumBuffers;
+        }
+
+        err = track->mEncoder->releaseOutputBuffer(index);
+        if (err != OK) {
+            return err;
+        }
+
+        if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+            CHECK(track->mMuxQueue->push(BufferQueue::CreateEOS()));
+            return ERROR_END_OF_STREAM;
+        }
+
+        return OK;
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(EncodeStage);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TranscodePipeline::MuxStage : public TranscodePipeline::Stage {
+    MuxStage(TranscodePipeline *pipeline)
+        : Stage(pipeline, "mux"),
+          mStarted(false),
+          mNumTracksDone(0) {
+    }
+
+protected:
+    virtual status_t step() {
+        if (!mStarted) {
+            // MediaMuxer wants all of its tracks before the first sample,
+            // which means waiting for every encoder's output format.
+            Vector<sp<AMessage> > formats;
+            if (!mPipeline->getOutputFormats(&formats)) {
+                return -EAGAIN;
+            }
+
+            for (size_t i = 0; i < formats.size(); ++i) {
+                ssize_t index = mPipeline->mMuxer->addTrack(formats.itemAt(i));
+                if (index < 0) {
+                    return index;
+                }
+                mPipeline->mTracks.editItemAt(i)->mMuxerTrackIndex = index;
+                mTrackDone.push(false);
+            }
+
+            status_t err = mPipeline->mMuxer->start();
+            if (err != OK) {
+                return err;
+            }
+
+            mStarted = true;
+        }
+
+        bool progress = false;
+
+        // Take one sample from each track per pass, the muxer interleaves.
+        for (size_t i = 0; i < mPipeline->mTracks.size(); ++i) {
+            if (mTrackDone.itemAt(i)) {
+                continue;
+            }
+
+            Track *track = mPipeline->mTracks.itemAt(i);
+
+            sp<ABuffer> buffer;
+            if (!track->mMuxQueue->pop(&buffer)) {
+                continue;
+            }
+
+            progress = true;
+
+            if (BufferQueue::IsEOS(buffer)) {
+                mTrackDone.editItemAt(i) = true;
+                ++mNumTracksDone;
+                continue;
+            }
+
+            int64_t timeUs;
+            CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+
+            int32_t flags;
+            CHECK(buffer->meta()->findInt32("flags", &flags));
+
+            status_t err = mPipeline->mMuxer->writeSampleData(
+                    buffer, track->mMuxerTrackIndex, timeUs, flags);
+
+            if (err != OK) {
+                return err;
+            }
+
+            ++mNumBuffers;
+        }
+
+        if (mNumTracksDone == mPipeline->mTracks.size()) {
+            status_t err = mPipeline->mMuxer->stop();
+            return err != OK ? err : ERROR_END_OF_STREAM;
+        }
+
+        return progress ? OK : -EAGAIN;
+    }
+
+private:
+    bool mStarted;
+    Vector<bool> mTrackDone;
+    size_t mNumTracksDone;
+
+    DISALLOW_EVIL_CONSTRUCTORS(MuxStage);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+TranscodePipeline::TranscodePipeline()
+    : mNumStagesDone(0),
+      mDone(false),
+      mFinalStatus(OK),
+      mStartTimeUs(-1ll),
+      mElapsedUs(0ll) {
+}
+
+TranscodePipeline::~TranscodePipeline() {
+    stopStages();
+    releaseCodecs();
+
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        delete mTracks.itemAt(i);
+    }
+    mTracks.clear();
+}
+
+status_t TranscodePipeline::init(
+        const char *inputPath, const char *outputPath,
+        const Options &options) {
+    mOptions = options;
+
+    mExtractor = new NuMediaExtractor;
+
+    status_t err = mExtractor->setDataSource(inputPath);
+    if (err != OK) {
+        ALOGE("unable to open '%s' (err=%d)", inputPath, err);
+        mExtractor.clear();
+        return err;
+    }
+
+    bool haveAudio = false;
+    bool haveVideo = false;
+
+    for (size_t i = 0; i < mExtractor->countTracks(); ++i) {
+        sp<AMessage> format;
+        err = mExtractor->getTrackFormat(i, &format);
+        if (err != OK) {
+            return err;
+        }
+
+        AString mime;
+        CHECK(format->findString("mime", &mime));
+
+        bool isVideo = !strncasecmp(mime.c_str(), "video/", 6);
+
+        if (isVideo ? haveVideo : haveAudio) {
+            continue;
+        }
+
+        if (!isVideo && strncasecmp(mime.c_str(), "audio/", 6)) {
+            continue;
+        }
+
+        err = addTrack(i, format, isVideo);
+        if (err != OK) {
+            return err;
+        }
+
+        if (isVideo) {
+            haveVideo = true;
+        } else {
+            haveAudio = true;
+        }
+    }
+
+    if (mTracks.isEmpty()) {
+        ALOGE("no audio or video track found in '%s'", inputPath);
+        return ERROR_UNSUPPORTED;
+    }
+
+    mMuxer = new MediaMuxer(outputPath, MediaMuxer::OUTPUT_FORMAT_MPEG_4);
+
+    return OK;
+}
+
+status_t TranscodePipeline::addTrack(
+        size_t index, const sp<AMessage> &format, bool isVideo) {
+    AString mime;
+    CHECK(format->findString("mime", &mime));
+
+    sp<AMessage> encoderFormat = new AMessage;
+
+    if (isVideo) {
+        int32_t width, height;
+        CHECK(format->findInt32("width", &width));
+        CHECK(format->findInt32("height", &height));
+
+        encoderFormat->setString("mime", mOptions.mVideoMime.c_str());
+        encoderFormat->setInt32("width", width);
+        encoderFormat->setInt32("height", height);
+        encoderFormat->setInt32("bitrate", mOptions.mVideoBitrate);
+        encoderFormat->setInt32("frame-rate", mOptions.mFrameRate);
+        encoderFormat->setInt32("i-frame-interval", mOptions.mIFrameIntervalSecs);
+        encoderFormat->setInt32("color-format", OMX_COLOR_FormatAndroidOpaque);
+    } else {
+        int32_t sampleRate, channelCount;
+        CHECK(format->findInt32("sample-rate", &sampleRate));
+        CHECK(format->findInt32("channel-count", &channelCount));
+
+        encoderFormat->setString("mime", mOptions.mAudioMime.c_str());
+        encoderFormat->setInt32("aac-profile", 2);  // OMX_AUDIO_AACObjectLC
+        encoderFormat->setInt32("sample-rate", sampleRate);
+        encoderFormat->setInt32("channel-count", channelCount);
+        encoderFormat->setInt32("bitrate", mOptions.mAudioBitrate);
+    }
+
+    Track *track = new Track;
+    track->mSourceIndex = index;
+    track->mIsVideo = isVideo;
+    track->mSourceFormat = format;
+    track->mDecodeQueue = new BufferQueue(mOptions.mQueueDepth);
+    // The muxer sits on its queues until every encoder has reported its
+    // format, give them enough slack that the interleaving of the source
+    // cannot wedge the other track before that happens.
+    track->mMuxQueue = new BufferQueue(mOptions.mQueueDepth * 8);
+    if (!isVideo) {
+        track->mEncodeQueue = new BufferQueue(mOptions.mQueueDepth);
+    }
+
+    // From here on releaseCodecs() takes care of whatever was set up.
+    mTracks.push(track);
+
+    track->mDecoderLooper = new ALooper;
+    track->mDecoderLooper->setName("transcode-decoder");
+    track->mDecoderLooper->start();
+
+    track->mEncoderLooper = new ALooper;
+    track->mEncoderLooper->setName("transcode-encoder");
+    track->mEncoderLooper->start();
+
+    track->mEncoder = MediaCodec::CreateByType(
+            track->mEncoderLooper,
+            isVideo ? mOptions.mVideoMime.c_str() : mOptions.mAudioMime.c_str(),
+            true /* encoder */);
+
+    if (track->mEncoder == NULL) {
+        ALOGE("no encoder for the %s track", isVideo ? "video" : "audio");
+        return ERROR_UNSUPPORTED;
+    }
+
+    status_t err = track->mEncoder->configure(
+            encoderFormat, NULL /* nativeWindow */, NULL /* crypto */,
+            MediaCodec::CONFIGURE_FLAG_ENCODE);
+    if (err != OK) {
+        return err;
+    }
+
+    sp<Surface> surface;
+    if (isVideo) {
+        sp<IGraphicBufferProducer> bufferProducer;
+        err = track->mEncoder->createInputSurface(&bufferProducer);
+        if (err != OK) {
+            return err;
+        }
+        surface = new Surface(bufferProducer);
+    }
+
+    err = track->mEncoder->start();
+    if (err != OK) {
+        return err;
+    }
+
+    track->mDecoder = MediaCodec::CreateByType(
+            track->mDecoderLooper, mime.c_str(), false /* encoder */);
+
+    if (track->mDecoder == NULL) {
+        ALOGE("no decoder for '%s'", mime.c_str());
+        return ERROR_UNSUPPORTED;
+    }
+
+    err = track->mDecoder->configure(
+            format, surface, NULL /* crypto */, 0 /* flags */);
+    if (err != OK) {
+        return err;
+    }
+
+    err = track->mDecoder->start();
+    if (err != OK) {
+        return err;
+    }
+
+    CHECK_EQ(track->mDecoder->getInputBuffers(&track->mDecoderInputBuffers),
+             (status_t)OK);
+    CHECK_EQ(track->mDecoder->getOutputBuffers(&track->mDecoderOutputBuffers),
+             (status_t)OK);
+    if (!isVideo) {
+        CHECK_EQ(track->mEncoder->getInputBuffers(
+                    &track->mEncoderInputBuffers), (status_t)OK);
+    }
+    CHECK_EQ(track->mEncoder->getOutputBuffers(&track->mEncoderOutputBuffers),
+             (status_t)OK);
+
+    return mExtractor->selectTrack(index);
+}
+
+TranscodePipeline::Track *TranscodePipeline::trackForSource(
+        size_t sourceIndex) const {
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        if (mTracks.itemAt(i)->mSourceIndex == sourceIndex) {
+            return mTracks.itemAt(i);
+        }
+    }
+    return NULL;
+}
+
+status_t TranscodePipeline::start() {
+    CHECK(mStages.isEmpty());
+
+    sp<Stage> extractStage = new ExtractStage(this);
+    mMuxStage = new MuxStage(this);
+
+    mStages.push(extractStage);
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        Track *track = mTracks.itemAt(i);
+
+        sp<Stage> decodeStage = new DecodeStage(this, track);
+        sp<Stage> encodeStage = new EncodeStage(this, track);
+
+        track->mDecodeQueue->setStages(extractStage.get(), decodeStage.get());
+        if (track->mEncodeQueue != NULL) {
+            track->mEncodeQueue->setStages(
+                    decodeStage.get(), encodeStage.get());
+        }
+        track->mMuxQueue->setStages(encodeStage.get(), mMuxStage.get());
+
+        mStages.push(decodeStage);
+        mStages.push(encodeStage);
+    }
+    mStages.push(mMuxStage);
+
+    mStartTimeUs = ALooper::GetNowUs();
+
+    // Downstream first, so that no stage kicks one that isn't running yet.
+    for (size_t i = mStages.size(); i-- > 0;) {
+        status_t err = mStages.editItemAt(i)->start();
+        if (err != OK) {
+            stopStages();
+            return err;
+        }
+    }
+
+    return OK;
+}
+
+status_t TranscodePipeline::waitForCompletion() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        while (!mDone) {
+            mCondition.wait(mLock);
+        }
+    }
+
+    // Stages call back into us holding no locks, so they can only be torn
+    // down from outside of mLock.
+    stopStages();
+    releaseCodecs();
+
+    Mutex::Autolock autoLock(mLock);
+    return mFinalStatus;
+}
+
+void TranscodePipeline::getStats(
+        Vector<StageStats> *stats, int64_t *elapsedUs) const {
+    stats->clear();
+    for (size_t i = 0; i < mStages.size(); ++i) {
+        StageStats stageStats;
+        mStages.itemAt(i)->getStats(&stageStats);
+        stats->push(stageStats);
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    *elapsedUs = mElapsedUs;
+}
+
+void TranscodePipeline::setOutputFormat(
+        Track *track, const sp<AMessage> &format) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        track->mOutputFormat = format;
+    }
+
+    // It may be the last format the muxer is waiting for.
+    mMuxStage->kick();
+}
+
+bool TranscodePipeline::getOutputFormats(
+        Vector<sp<AMessage> > *formats) const {
+    Mutex::Autolock autoLock(mLock);
+
+    formats->clear();
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        const sp<AMessage> &format = mTracks.itemAt(i)->mOutputFormat;
+        if (format == NULL) {
+            return false;
+        }
+        formats->push(format);
+    }
+
+    return true;
+}
+
+void TranscodePipeline::onStageDone(Stage *stage) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (++mNumStagesDone == mStages.size() && !mDone) {
+        mDone = true;
+        mElapsedUs = ALooper::GetNowUs() - mStartTimeUs;
+        mCondition.signal();
+    }
+}
+
+void TranscodePipeline::onStageError(Stage *stage, status_t err) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (!mDone) {
+        mDone = true;
+        mFinalStatus = err;
+        mElapsedUs = ALooper::GetNowUs() - mStartTimeUs;
+        mCondition.signal();
+    }
+}
+
+void TranscodePipeline::stopStages() {
+    for (size_t i = 0; i < mStages.size(); ++i) {
+        mStages.editItemAt(i)->stop();
+    }
+}
+
+void TranscodePipeline::releaseCodecs() {
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        Track *track = mTracks.itemAt(i);
+
+        if (track->mDecoder != NULL) {
+            track->mDecoder->release();
+            track->mDecoder.clear();
+        }
+
+        if (track->mEncoder != NULL) {
+            track->mEncoder->release();
+            track->mEncoder.clear();
+        }
+
+        if (track->mDecoderLooper != NULL) {
+            track->mDecoderLooper->stop();
+            track->mDecoderLooper.clear();
+        }
+
+        if (track->mEncoderLooper != NULL) {
+            track->mEncoderLooper->stop();
+            track->mEncoderLooper.clear();
+        }
+    }
+}
+
+}  // namespace android
@@ -46,9 +46,9 @@ LOCAL_SRC_FILES += \
 endif
 
 ifeq ($(VOTT), v7)
+# CalcBandEnergy/CalcBandEnergyMS come from the NEON code in band_nrg.c
 LOCAL_SRC_FILES += \
 	src/asm/ARMV5E/AutoCorrelation_v5.s \
-	src/asm/ARMV5E/band_nrg_v5.s \
 	src/asm/ARMV5E/CalcWindowEnergy_v5.s \
 	src/asm/ARMV7/PrePostMDCT_v7.s \
 	src/asm/ARMV7/R4R8First_v7.s \
@@ -27,6 +27,11 @@
 #include "qc_data.h"
 #include "memalign.h"
 
+/*
+  worker thread transforming the second channel of a channel pair
+*/
+typedef struct PSY_TRANSFORM_THREAD PSY_TRANSFORM_THREAD;
+
 /*
   psy kernel
 */
@@ -37,6 +42,7 @@ typedef struct  {
   TNS_DATA                tnsData[MAX_CHANNELS]; /* Word16 size: MAX_CHANNELS*235 */
   Word32*                 pScratchTns;
   Word16				  sampleRateIdx;
+  PSY_TRANSFORM_THREAD*   transformThread;       /* NULL on single core devices */
 }PSY_KERNEL; /* Word16 size: 2587 / 4491 */
 
 
@@ -64,6 +70,7 @@ Word16 psyMain(Word16                   nChannels,   /*!< total number of channe
                PSY_OUT_CHANNEL          psyOutChannel[MAX_CHANNELS],
                PSY_OUT_ELEMENT          *psyOutElement,
                Word32                   *pScratchTns,
-			   Word32					sampleRate);
+			   Word32					sampleRate,
+               PSY_TRANSFORM_THREAD     *transformThread);
 
 #endif /* _PSYMAIN_H */
@@ -169,7 +169,8 @@ Word16 AacEncEncode(AAC_ENCODER *aacEnc,		/*!< an encoder handle */
           &aacEnc->psyOut.psyOutChannel[elInfo->ChannelIndex[0]],
           &aacEnc->psyOut.psyOutElement,
           aacEnc->psyKernel.pScratchTns,
-		  aacEnc->config.sampleRate);
+		  aacEnc->config.sampleRate,
+          aacEnc->psyKernel.transformThread);
 
   /* adjust bitrate and frame length */
   AdjustBitrate(&aacEnc->qcKernel,
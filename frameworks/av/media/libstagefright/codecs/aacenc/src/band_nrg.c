@@ -20,6 +20,10 @@
 
 *******************************************************************************/
 
+#ifdef ARMV7Neon
+#include <arm_neon.h>
+#endif
+
 #include "basic_op.h"
 #include "band_nrg.h"
 
@@ -99,4 +103,126 @@ void CalcBandEnergyMS(const Word32 *mdctSpectrumLeft,
   *bandEnergySideSum = accuSideSum;
 }
 
+#elif defined(ARMV7Neon)
+/********************************************************************************
+*
+* function name: MulHighSum
+* description:   Sum of MULHIGH(a[j], b[j]) over four lines, kept in two 64 bit
+*                lanes so that nothing saturates inside the band
+*
+**********************************************************************************/
+__inline int64x2_t MulHighSum(int64x2_t acc, int32x4_t a, int32x4_t b)
+{
+  int32x2_t lo = vshrn_n_s64(vmull_s32(vget_low_s32(a), vget_low_s32(b)), 32);
+  int32x2_t hi = vshrn_n_s64(vmull_s32(vget_high_s32(a), vget_high_s32(b)), 32);
+
+  return vpadalq_s32(acc, vcombine_s32(lo, hi));
+}
+
+/*
+  every MULHIGH(x, x) term is positive, so a chain of L_add() saturates
+  exactly when the exact sum exceeds MAX_32
+*/
+__inline Word32 SaturateSum(int64x2_t acc, Word64 tail)
+{
+  Word64 sum = vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1) + tail;
+
+  return sum > MAX_32 ? MAX_32 : (Word32)sum;
+}
+
+/********************************************************************************
+*
+* function name: CalcBandEnergy
+* description:   Calc sfb-bandwise mdct-energies for left and right channel
+*                (NEON, bit exact with the C version)
+*
+**********************************************************************************/
+void CalcBandEnergy(const Word32 *mdctSpectrum,
+                    const Word16 *bandOffset,
+                    const Word16  numBands,
+                    Word32       *bandEnergy,
+                    Word32       *bandEnergySum)
+{
+  Word32 i, j;
+  Word32 accuSum = 0;
+
+  for (i=0; i<numBands; i++) {
+    int64x2_t acc = vdupq_n_s64(0);
+    Word64 tail = 0;
+    Word32 accu;
+
+    for (j=bandOffset[i]; j+4<=bandOffset[i+1]; j+=4) {
+      int32x4_t spec = vld1q_s32(mdctSpectrum + j);
+      acc = MulHighSum(acc, spec, spec);
+    }
+    for (; j<bandOffset[i+1]; j++)
+      tail += MULHIGH(mdctSpectrum[j], mdctSpectrum[j]);
+
+    accu = SaturateSum(acc, tail);
+    accu = L_add(accu, accu);
+    accuSum = L_add(accuSum, accu);
+    bandEnergy[i] = accu;
+  }
+  *bandEnergySum = accuSum;
+}
+
+/********************************************************************************
+*
+* function name: CalcBandEnergyMS
+* description:   Calc sfb-bandwise mdct-energies for left add or minus right channel
+*                (NEON, bit exact with the C version)
+*
+**********************************************************************************/
+void CalcBandEnergyMS(const Word32 *mdctSpectrumLeft,
+                      const Word32 *mdctSpectrumRight,
+                      const Word16 *bandOffset,
+                      const Word16  numBands,
+                      Word32       *bandEnergyMid,
+                      Word32       *bandEnergyMidSum,
+                      Word32       *bandEnergySide,
+                      Word32       *bandEnergySideSum)
+{
+  Word32 i, j;
+  Word32 accuMidSum = 0;
+  Word32 accuSideSum = 0;
+
+  for(i=0; i<numBands; i++) {
+    int64x2_t accMid = vdupq_n_s64(0);
+    int64x2_t accSide = vdupq_n_s64(0);
+    Word64 tailMid = 0;
+    Word64 tailSide = 0;
+    Word32 accuMid, accuSide;
+
+    for (j=bandOffset[i]; j+4<=bandOffset[i+1]; j+=4) {
+      int32x4_t l = vshrq_n_s32(vld1q_s32(mdctSpectrumLeft + j), 1);
+      int32x4_t r = vshrq_n_s32(vld1q_s32(mdctSpectrumRight + j), 1);
+      int32x4_t specm = vaddq_s32(l, r);
+      int32x4_t specs = vsubq_s32(l, r);
+
+      accMid = MulHighSum(accMid, specm, specm);
+      accSide = MulHighSum(accSide, specs, specs);
+    }
+    for (; j<bandOffset[i+1]; j++) {
+      Word32 l = mdctSpectrumLeft[j] >> 1;
+      Word32 r = mdctSpectrumRight[j] >> 1;
+      Word32 specm = l + r;
+      Word32 specs = l - r;
+
+      tailMid += MULHIGH(specm, specm);
+      tailSide += MULHIGH(specs, specs);
+    }
+
+    accuMid = SaturateSum(accMid, tailMid);
+    accuSide = SaturateSum(accSide, tailSide);
+    accuMid = L_add(accuMid, accuMid);
+    accuSide = L_add(accuSide, accuSide);
+    bandEnergyMid[i] = accuMid;
+    accuMidSum = L_add(accuMidSum, accuMid);
+    bandEnergySide[i] = accuSide;
+    accuSideSum = L_add(accuSideSum, accuSide);
+  }
+  *bandEnergyMidSum = accuMidSum;
+  *bandEnergySideSum = accuSideSum;
+}
+
 #endif
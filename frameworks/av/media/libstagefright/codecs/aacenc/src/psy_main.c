@@ -20,6 +20,9 @@
 
 *******************************************************************************/
 
+#include <pthread.h>
+#include <unistd.h>
+
 #include "typedef.h"
 #include "basic_op.h"
 #include "oper_32b.h"
@@ -41,6 +44,24 @@
 /*                                    long       start       short       stop */
 static Word16 blockType2windowShape[] = {KBD_WINDOW,SINE_WINDOW,SINE_WINDOW,KBD_WINDOW};
 
+/*
+  The MDCT of the second channel of a channel pair runs on this worker
+  while the calling thread transforms the first one. The channels share
+  no state in Transform_Real(), so the result does not depend on it.
+*/
+struct PSY_TRANSFORM_THREAD {
+  pthread_t       thread;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  Word16          pending;       /* job posted and not finished yet */
+  Word16          exit;
+  /* job */
+  PSY_DATA       *psyData;
+  Word16         *timeSignal;
+  Word16          chIncrement;
+  Word16         *mdctScale;
+};
+
 /*
   forward definitions
 */
@@ -67,6 +88,89 @@ static Word16 advancePsychShortMS (PSY_DATA  psyData[MAX_CHANNELS],
                                    const PSY_CONFIGURATION_SHORT *hPsyConfShort);
 
 
+/*****************************************************************************
+*
+* function name: PsyTransformThread
+* description:  worker loop, transforms one channel per posted job
+*
+*****************************************************************************/
+static void *PsyTransformThread(void *arg)
+{
+  PSY_TRANSFORM_THREAD *hThread = (PSY_TRANSFORM_THREAD *)arg;
+
+  pthread_mutex_lock(&hThread->lock);
+  for (;;) {
+    while (!hThread->pending && !hThread->exit)
+      pthread_cond_wait(&hThread->cond, &hThread->lock);
+    if (hThread->exit)
+      break;
+    pthread_mutex_unlock(&hThread->lock);
+
+    Transform_Real(hThread->psyData->mdctDelayBuffer,
+                   hThread->timeSignal,
+                   hThread->chIncrement,
+                   hThread->psyData->mdctSpectrum,
+                   hThread->mdctScale,
+                   hThread->psyData->blockSwitchingControl.windowSequence);
+
+    pthread_mutex_lock(&hThread->lock);
+    hThread->pending = 0;
+    pthread_cond_broadcast(&hThread->cond);
+  }
+  pthread_mutex_unlock(&hThread->lock);
+
+  return NULL;
+}
+
+/*****************************************************************************
+*
+* function name: PsyTransformThreadNew
+* description:  starts the transform worker if there is a second core
+* returns:      the worker, or NULL to transform all channels in line
+*
+*****************************************************************************/
+static PSY_TRANSFORM_THREAD *PsyTransformThreadNew(VO_MEM_OPERATOR *pMemOP)
+{
+  PSY_TRANSFORM_THREAD *hThread;
+
+  if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+    return NULL;
+
+  hThread = (PSY_TRANSFORM_THREAD *)mem_malloc(pMemOP, sizeof(PSY_TRANSFORM_THREAD), 32, VO_INDEX_ENC_AAC);
+  if (NULL == hThread)
+    return NULL;
+
+  pthread_mutex_init(&hThread->lock, NULL);
+  pthread_cond_init(&hThread->cond, NULL);
+  if (pthread_create(&hThread->thread, NULL, PsyTransformThread, hThread) != 0) {
+    pthread_cond_destroy(&hThread->cond);
+    pthread_mutex_destroy(&hThread->lock);
+    mem_free(pMemOP, hThread, VO_INDEX_ENC_AAC);
+    return NULL;
+  }
+
+  return hThread;
+}
+
+/*****************************************************************************
+*
+* function name: PsyTransformThreadDelete
+* description:  stops the transform worker and frees it
+*
+*****************************************************************************/
+static void PsyTransformThreadDelete(PSY_TRANSFORM_THREAD *hThread, VO_MEM_OPERATOR *pMemOP)
+{
+  pthread_mutex_lock(&hThread->lock);
+  hThread->exit = 1;
+  pthread_cond_broadcast(&hThread->cond);
+  pthread_mutex_unlock(&hThread->lock);
+  pthread_join(hThread->thread, NULL);
+
+  pthread_cond_destroy(&hThread->cond);
+  pthread_mutex_destroy(&hThread->lock);
+  mem_free(pMemOP, hThread, VO_INDEX_ENC_AAC);
+}
+
 /*****************************************************************************
 *
 * function name: PsyNew
@@ -105,6 +209,9 @@ Word16 PsyNew(PSY_KERNEL *hPsy, Word32 nChan, VO_MEM_OPERATOR *pMemOP)
 
   hPsy->pScratchTns = scratchTNS;
 
+  if (nChan > 1)
+    hPsy->transformThread = PsyTransformThreadNew(pMemOP);
+
   return 0;
 }
 
@@ -122,6 +229,12 @@ Word16 PsyDelete(PSY_KERNEL  *hPsy, VO_MEM_OPERATOR *pMemOP)
 
   if(hPsy)
   {
+	if(hPsy->transformThread)
+	{
+		PsyTransformThreadDelete(hPsy->transformThread, pMemOP);
+		hPsy->transformThread = NULL;
+	}
+
 	if(hPsy->psyData[0].mdctDelayBuffer)
 		mem_free(pMemOP, hPsy->psyData[0].mdctDelayBuffer, VO_INDEX_ENC_AAC);
 
@@ -249,7 +362,8 @@ Word16 psyMain(Word16                   nChannels,
                PSY_OUT_CHANNEL          psyOutChannel[MAX_CHANNELS],
                PSY_OUT_ELEMENT         *psyOutElement,
                Word32                  *pScratchTns,
-			   Word32				   sampleRate)
+			   Word32				   sampleRate,
+               PSY_TRANSFORM_THREAD    *transformThread)
 {
   Word16 maxSfbPerGroup[MAX_CHANNELS];
   Word16 mdctScalingArray[MAX_CHANNELS];
@@ -259,6 +373,7 @@ Word16 psyMain(Word16                   nChannels,
   Word16 line; /* counts through lines             */
   Word16 channels;
   Word16 maxScale;
+  Word16 threadCh;  /* channel transformed on the worker, if any */
 
   channels = elemInfo->nChannelsInEl;
   maxScale = 0;
@@ -278,13 +393,34 @@ Word16 psyMain(Word16                   nChannels,
 
   /* transform
      and get maxScale (max mdctScaling) for all channels */
+  threadCh = channels;
+  if (channels == 2 && transformThread) {
+    threadCh = 1;
+    pthread_mutex_lock(&transformThread->lock);
+    transformThread->psyData = &psyData[threadCh];
+    transformThread->timeSignal = timeSignal+elemInfo->ChannelIndex[threadCh];
+    transformThread->chIncrement = nChannels;
+    transformThread->mdctScale = &(mdctScalingArray[threadCh]);
+    transformThread->pending = 1;
+    pthread_cond_broadcast(&transformThread->cond);
+    pthread_mutex_unlock(&transformThread->lock);
+  }
+
   for(ch=0; ch<channels; ch++) {
-    Transform_Real(psyData[ch].mdctDelayBuffer,
-                   timeSignal+elemInfo->ChannelIndex[ch],
-                   nChannels,
-                   psyData[ch].mdctSpectrum,
-                   &(mdctScalingArray[ch]),
-                   psyData[ch].blockSwitchingControl.windowSequence);
+    if (ch == threadCh) {
+      pthread_mutex_lock(&transformThread->lock);
+      while (transformThread->pending)
+        pthread_cond_wait(&transformThread->cond, &transformThread->lock);
+      pthread_mutex_unlock(&transformThread->lock);
+    }
+    else {
+      Transform_Real(psyData[ch].mdctDelayBuffer,
+                     timeSignal+elemInfo->ChannelIndex[ch],
+                     nChannels,
+                     psyData[ch].mdctSpectrum,
+                     &(mdctScalingArray[ch]),
+                     psyData[ch].blockSwitchingControl.windowSequence);
+    }
     maxScale = max(maxScale, mdctScalingArray[ch]);
   }
 
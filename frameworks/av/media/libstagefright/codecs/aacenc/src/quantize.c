@@ -20,6 +20,10 @@
 
 *******************************************************************************/
 
+#ifdef ARMV7Neon
+#include <arm_neon.h>
+#endif
+
 #include "typedef.h"
 #include "basic_op.h"
 #include "oper_32b.h"
@@ -92,6 +96,64 @@ static Word16 quantizeSingleLine(const Word16 gain, const Word32 absSpectrum)
   return qua;
 }
 
+#ifdef ARMV7Neon
+/*****************************************************************************
+*
+* function name:quantizeLinesNeon
+* description: NEON part of quantizeLines() for g >= 0, four lines at a time.
+*              Lines below the last quantizer border are classified with
+*              vector compares, the rare larger lines go through
+*              quantizeSingleLine() like in the C loop.
+* returns:     number of lines done, the caller quantizes the remainder
+*
+*****************************************************************************/
+static Word32 quantizeLinesNeon(const Word16 gain,
+                                const Word32 g,
+                                const Word16 *pquat,
+                                const Word16 noOfLines,
+                                const Word32 *mdctSpectrum,
+                                Word16 *quaSpectrum)
+{
+  const int32x4_t shift = vdupq_n_s32(-g);
+  const int32x4_t border0 = vdupq_n_s32(pquat[0]);
+  const int32x4_t border1 = vdupq_n_s32(pquat[1]);
+  const int32x4_t border2 = vdupq_n_s32(pquat[2]);
+  const int32x4_t border3 = vdupq_n_s32(pquat[3]);
+  const int32x4_t zero = vdupq_n_s32(0);
+  Word32 line, k;
+
+  for (line=0; line+4<=noOfLines; line+=4) {
+    int32x4_t spec = vld1q_s32(mdctSpectrum + line);
+    int32x4_t saShft = vshlq_s32(vqabsq_s32(spec), shift);
+    uint32x4_t large = vcgeq_s32(saShft, border3);
+    uint32x2_t anyLarge = vorr_u32(vget_low_u32(large), vget_high_u32(large));
+    /* the borders are increasing, so each passed border is one step */
+    int32x4_t negQua = vaddq_s32(vaddq_s32(vreinterpretq_s32_u32(vcgtq_s32(saShft, border0)),
+                                           vreinterpretq_s32_u32(vcgeq_s32(saShft, border1))),
+                                 vreinterpretq_s32_u32(vcgeq_s32(saShft, border2)));
+    int32x4_t qua = vbslq_s32(vcgtq_s32(spec, zero), vnegq_s32(negQua), negQua);
+
+    vst1_s16(quaSpectrum + line, vmovn_s32(qua));
+
+    if (vget_lane_u32(vpmax_u32(anyLarge, anyLarge), 0)) {
+      for (k=line; k<line+4; k++) {
+        Word32 sa = L_abs(mdctSpectrum[k]);
+
+        if ((sa >> g) >= pquat[3]) {
+          Word16 qua1 = quantizeSingleLine(gain, sa);
+
+          if (mdctSpectrum[k] < 0)
+            qua1 = -qua1;
+          quaSpectrum[k] = qua1;
+        }
+      }
+    }
+  }
+
+  return line;
+}
+#endif
+
 /*****************************************************************************
 *
 * function name:quantizeLines
@@ -119,7 +181,12 @@ static void quantizeLines(const Word16 gain,
 
   if(g >= 0)
   {
-	for (line=0; line<noOfLines; line++) {
+#ifdef ARMV7Neon
+	line = quantizeLinesNeon(gain, g, pquat, noOfLines, mdctSpectrum, quaSpectrum);
+#else
+	line = 0;
+#endif
+	for (; line<noOfLines; line++) {
 	  Word32 qua;
 	  qua = 0;
 
@@ -81,6 +81,7 @@ terms listed above has been obtained from the copyright holder.
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "typedef.h"
+#include "cnst.h"
 #include "convolve.h"
 #include "basic_op.h"
 
@@ -215,6 +216,13 @@ void Convolve(
     register Word16 i, n;
     Word32 s1, s2;
 
+#ifdef PV_ARM_NEON
+    if (!(L & 3) && L <= L_SUBFR)
+    {
+        Convolve_neon(x, h, y, L);
+        return;
+    }
+#endif
 
     for (n = 1; n < L; n = n + 2)
     {
@@ -76,6 +76,16 @@ extern "C"
         Word16 L           /* (i)  : vector size                                */
     );
 
+#ifdef PV_ARM_NEON
+    /* defined in enc_neon.cpp, L must be a multiple of 4 and at most L_SUBFR */
+    void Convolve_neon(
+        Word16 x[],        /* (i)  : input vector                               */
+        Word16 h[],        /* (i)  : impulse response                           */
+        Word16 y[],        /* (o)  : output vector                              */
+        Word16 L           /* (i)  : vector size                                */
+    );
+#endif
+
 #ifdef __cplusplus
 }
 #endif
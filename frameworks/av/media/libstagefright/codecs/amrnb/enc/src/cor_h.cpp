@@ -369,6 +369,11 @@ void cor_h(
     }
 
 
+#ifdef PV_ARM_NEON
+    cor_h_rr_neon(h2, sign, rr);
+    return;
+#endif
+
     p_rr_ref1 = rr[L_CODE-1];
 
     for (dec = 1; dec < L_CODE; dec += 2)
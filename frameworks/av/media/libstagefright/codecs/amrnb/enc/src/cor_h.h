@@ -85,6 +85,15 @@ extern "C"
         Flag  *pOverflow
     );
 
+#ifdef PV_ARM_NEON
+    /* defined in enc_neon.cpp, the off-diagonal terms of rr[][] */
+    void cor_h_rr_neon(
+        const Word16 h2[],   /* (i) : scaled impulse response                 */
+        const Word16 sign[], /* (i) : sign of d[n]                            */
+        Word16 rr[][L_CODE]  /* (o) : matrix of autocorrelation               */
+    );
+#endif
+
     /*----------------------------------------------------------------------------
     ; END
     ----------------------------------------------------------------------------*/
@@ -269,6 +269,9 @@ void cor_h_x(
         max = 0;
         for (i = k; i < L_CODE; i += STEP)      /* L_CODE = 40; STEP = 5 */
         {
+#ifdef PV_ARM_NEON
+            s = Dot16_neon(&x[i], h, L_CODE - i) << 1;
+#else
             s = 0;
             p_x = &x[i];
             p_ptr = h;
@@ -285,6 +288,7 @@ void cor_h_x(
             {
                 s += ((Word32) * (p_x++) * *(p_ptr++)) << 1;
             }
+#endif
 
             y32[i] = s;
 
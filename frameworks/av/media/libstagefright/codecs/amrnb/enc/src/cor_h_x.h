@@ -91,6 +91,11 @@ extern "C"
         Flag   *pOverflow /* (o): pointer to overflow flag                      */
     );
 
+#ifdef PV_ARM_NEON
+    /* defined in enc_neon.cpp, wrapping sum of a[i] * b[i] for i < n */
+    Word32 Dot16_neon(const Word16 *a, const Word16 *b, Word16 n);
+#endif
+
     /*----------------------------------------------------------------------------
     ; END
     ----------------------------------------------------------------------------*/
@@ -0,0 +1,191 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+ NEON versions of the correlation and convolution loops of the encoder:
+
+ Convolve_neon()   - Convolve() in convolve.cpp, four outputs at a time.
+ Dot16_neon()      - the target/impulse response correlation of cor_h_x().
+ cor_h_rr_neon()   - the off-diagonal part of the rr[][] matrix built by
+                     cor_h(), four diagonals at a time.
+
+ The C versions of these loops accumulate with wrapping 32-bit adds, not
+ saturating ones, so the sums do not depend on the order of the products.
+ The kernels are bit-exact with the C code for any input, including the
+ rounding of the rr[][] terms, which is done with a wrapping add followed
+ by a truncating shift exactly like the C code.
+
+ The files are only built, as .neon, when ARCH_ARM_HAVE_NEON is set, and
+ the C code calls them directly under PV_ARM_NEON.
+
+------------------------------------------------------------------------------
+*/
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "typedef.h"
+#include "cnst.h"
+#include "convolve.h"
+#include "cor_h.h"
+#include "cor_h_x.h"
+
+#include <arm_neon.h>
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+/* Longest vector Convolve_neon() handles, the encoder uses L_SUBFR */
+#define MAX_CONV_LEN    L_SUBFR
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+/*
+ Returns the wrapping sum of a[i] * b[i] for i = 0..n-1.
+*/
+Word32 Dot16_neon(const Word16 *a, const Word16 *b, Word16 n)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    Word32 s;
+
+    for (; n >= 8; n -= 8)
+    {
+        int16x8_t va = vld1q_s16(a);
+        int16x8_t vb = vld1q_s16(b);
+        acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+        acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+        a += 8;
+        b += 8;
+    }
+    if (n >= 4)
+    {
+        acc = vmlal_s16(acc, vld1_s16(a), vld1_s16(b));
+        a += 4;
+        b += 4;
+        n -= 4;
+    }
+
+    int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    s = vget_lane_s32(vpadd_s32(sum, sum), 0);
+
+    for (; n > 0; n--)
+    {
+        s += (Word32) * (a++) * *(b++);
+    }
+    return s;
+}
+
+/*
+ y[n] = (sum of x[i] * h[n - i] for i = 0..n) >> 12, four n at a time.
+ h[] is copied behind four zeros so that the terms with i > n read zeros.
+*/
+void Convolve_neon(
+    Word16 x[],        /* (i)     : input vector                           */
+    Word16 h[],        /* (i)     : impulse response                       */
+    Word16 y[],        /* (o)     : output vector                          */
+    Word16 L           /* (i)     : vector size, a multiple of 4           */
+)
+{
+    Word16 hz[4 + MAX_CONV_LEN];
+    Word16 i;
+    Word16 n;
+
+    vst1_s16(hz, vdup_n_s16(0));
+    for (i = 0; i < L; i += 4)
+    {
+        vst1_s16(&hz[4 + i], vld1_s16(&h[i]));
+    }
+
+    for (n = 0; n < L; n += 4)
+    {
+        int32x4_t acc = vdupq_n_s32(0);
+        const Word16 *p_h = &hz[4 + n];
+
+        for (i = 0; i < n + 4; i++)
+        {
+            acc = vmlal_n_s16(acc, vld1_s16(p_h--), x[i]);
+        }
+        vst1_s16(&y[n], vshrn_n_s32(acc, 12));
+    }
+}
+
+/*
+ Builds the off-diagonal terms of rr[][] from the scaled impulse response
+ h2[] and the signs, as cor_h() does: for the diagonal at distance d and
+ k = 0..L_CODE-1-d,
+
+   s = sum of h2[j] * h2[j + d] for j = 0..k
+   rr[r][c] = rr[c][r] = round(s) * ((sign[c] * sign[r]) >> 15) >> 15
+
+ with r = L_CODE-1-d-k and c = L_CODE-1-k. Lane l of the vectors works on
+ diagonal d + l; h2[] and sign[] are padded with zeros so the lanes past
+ the end of their diagonal read valid memory, and their results are not
+ stored.
+*/
+void cor_h_rr_neon(
+    const Word16 h2[],   /* (i) : scaled impulse response                 */
+    const Word16 sign[], /* (i) : sign of d[n]                            */
+    Word16 rr[][L_CODE]  /* (o) : matrix of autocorrelation               */
+)
+{
+    Word16 h2z[L_CODE + 4];
+    Word16 signz[4 + L_CODE];
+    Word16 out[4];
+    Word16 d;
+    Word16 k;
+    Word16 l;
+
+    for (k = 0; k < L_CODE; k += 4)
+    {
+        vst1_s16(&h2z[k], vld1_s16(&h2[k]));
+        vst1_s16(&signz[4 + k], vld1_s16(&sign[k]));
+    }
+    vst1_s16(&h2z[L_CODE], vdup_n_s16(0));
+    vst1_s16(signz, vdup_n_s16(0));
+
+    const int32x4_t round = vdupq_n_s32(0x00004000L);
+
+    for (d = 1; d < L_CODE; d += 4)
+    {
+        int32x4_t s = vdupq_n_s32(0);
+
+        for (k = 0; k <= L_CODE - 1 - d; k++)
+        {
+            s = vmlal_n_s16(s, vld1_s16(&h2z[k + d]), h2z[k]);
+
+            /* (Word16)((s + 0x4000) >> 15), with the same wraparound */
+            int16x4_t t1 = vshrn_n_s32(vaddq_s32(s, round), 15);
+
+            /* sign[r] for the four lanes, r = L_CODE-1-d-k-l */
+            int16x4_t sr = vrev64_s16(vld1_s16(&signz[4 + L_CODE - 1 - d - k - 3]));
+            int16x4_t t2 = vshrn_n_s32(vmull_n_s16(sr, sign[L_CODE - 1 - k]), 15);
+
+            vst1_s16(out, vshrn_n_s32(vmull_s16(t1, t2), 15));
+
+            for (l = 0; l < 4 && k <= L_CODE - 1 - d - l; l++)
+            {
+                rr[L_CODE - 1 - d - l - k][L_CODE - 1 - k] = out[l];
+                rr[L_CODE - 1 - k][L_CODE - 1 - d - l - k] = out[l];
+            }
+        }
+    }
+}
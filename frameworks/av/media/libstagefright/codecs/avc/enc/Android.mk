@@ -30,6 +30,11 @@ LOCAL_C_INCLUDES := \
 LOCAL_CFLAGS := \
     -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+LOCAL_SRC_FILES += src/sad_neon.cpp.neon
+LOCAL_CFLAGS += -DAVC_ARM_NEON
+endif
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
@@ -218,6 +218,12 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
         return AVCENC_MEMORY_FAIL;
     }
     encvid->functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_C;
+#ifdef AVC_ARM_NEON
+    if (AVCCpuHasNeon())
+    {
+        encvid->functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_NEON;
+    }
+#endif
     encvid->functionPointer->SAD_MB_HalfPel[0] = NULL;
     encvid->functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_Cxh;
     encvid->functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_Cyh;
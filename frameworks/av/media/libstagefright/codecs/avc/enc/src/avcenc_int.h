@@ -65,6 +65,9 @@ typedef float OsclFloat;
 #define V0Q_H2Q 2
 #define V2Q_H2Q 3
 
+/* for wavefront motion search, see motion_est.cpp */
+#define AVC_ME_MAX_THREADS 4
+
 /*
 #define V3Q_H0Q 1
 #define V3Q_H1Q 2
@@ -339,6 +342,11 @@ typedef struct tagAVCEncFuncPtr
 
 } AVCEncFuncPtr;
 
+/**
+This structure holds the motion search worker threads, it is private to motion_est.cpp.
+*/
+typedef struct tagAVCMEThreads AVCMEThreads;
+
 /**
 This structure contains information necessary for correct padding.
 */
@@ -440,6 +448,7 @@ typedef struct tagEncObject
 
     /* encoding complexity control */
     uint fullsearch_enable; /* flag to enable full-pel full-search */
+    AVCMEThreads *meThreads; /* motion search workers, NULL when single-threaded */
 
     /* misc.*/
     bool outOfBandParamSet; /* flag to enable out-of-band param set */
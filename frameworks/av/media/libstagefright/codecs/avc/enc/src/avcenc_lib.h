@@ -805,6 +805,12 @@ extern "C"
     int AVCSAD_MB_HalfPel_Cxh(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
     int AVCSAD_Macroblock_C(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
 
+#ifdef AVC_ARM_NEON
+    /*------------- sad_neon.cpp ----------------------*/
+    int AVCSAD_Macroblock_NEON(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
+    bool AVCCpuHasNeon(void);
+#endif
+
 #ifdef HTFM /*  3/2/1, Hypothesis Testing Fast Matching */
     int AVCSAD_MB_HP_HTFM_Collectxhyh(uint8 *ref, uint8 *blk, int dmin_x, void *extra_info);
     int AVCSAD_MB_HP_HTFM_Collectyh(uint8 *ref, uint8 *blk, int dmin_x, void *extra_info);
@@ -17,6 +17,9 @@
  */
 #include "avcenc_lib.h"
 
+#include <pthread.h>
+#include <unistd.h>
+
 #define MIN_GOP     1   /* minimum size of GOP, 1/23/01, need to be tested */
 
 #define DEFAULT_REF_IDX     0  /* always from the first frame in the reflist */
@@ -64,6 +67,47 @@ uint32 num_cand = 0;
 #define FIXED_SUBMB_MODE    AVC_4x4
 /*************************************************************************/
 
+/* Wavefront motion search. A macroblock takes its candidates and predicted MV
+   from the left, top-left, top and top-right neighbours of the current frame
+   and from the right and bottom neighbours of the previous one. Row j may
+   therefore search column i as soon as row j-1 is past column i+1, and the
+   result is identical to a raster-order search. Workers search on private
+   copies of the encoder and common objects, which hold the per-MB scratch
+   (currYMB, sub-pel buffers, mbNum, currMB). */
+typedef struct tagAVCMEWorker
+{
+    AVCMEThreads *me;
+    AVCEncObject encvid;
+    AVCCommonObj common;
+} AVCMEWorker;
+
+struct tagAVCMEThreads
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    /* signalled on new pass, row progress and exit */
+    pthread_t threads[AVC_ME_MAX_THREADS - 1];
+    AVCMEWorker worker[AVC_ME_MAX_THREADS - 1];
+    int numThreads;         /* including the encoding thread */
+    int exit;
+    uint passId;
+    int numWaiting;
+
+    /* current pass */
+    int *rowProgress;       /* columns finished in each MB row */
+    int rowProgressSize;
+    int mbheight;
+    int nextRow;
+    int rowsDone;
+    int start_i;            /* first column of row 0 */
+    int incr_i;
+    int type_pred;
+    int totalSAD;
+    int NumIntraSearch;
+};
+
+static void InitSubpelCandidates(AVCEncObject *encvid);
+static void *MotionSearchThread(void *arg);
+
 /* Initialize arrays necessary for motion search */
 AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
 {
@@ -75,8 +119,6 @@ AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
     int temp_bits = 0;
     uint8 *mvbits;
     int bits, imax, imin, i;
-    uint8* subpel_pred = (uint8*) encvid->subpel_pred; // all 16 sub-pel positions
-
 
     while (number_of_subpel_positions > 0)
     {
@@ -106,6 +148,50 @@ AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
         for (i = imin; i < imax; i++)   mvbits[-i] = mvbits[i] = bits;
     }
 
+    InitSubpelCandidates(encvid);
+
+    encvid->meThreads = NULL;
+#ifndef HTFM
+    /* HTFM keeps its statistics in the encoder object, so it stays single-threaded */
+    {
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int numThreads = (numCpus > AVC_ME_MAX_THREADS) ? AVC_ME_MAX_THREADS : (int)numCpus;
+        AVCMEThreads *me;
+
+        if (numThreads > 1)
+        {
+            me = (AVCMEThreads*) avcHandle->CBAVC_Malloc(encvid->avcHandle->userData,
+                    sizeof(AVCMEThreads), DEFAULT_ATTR);
+            if (me == NULL)
+            {
+                return AVCENC_MEMORY_FAIL;
+            }
+            memset(me, 0, sizeof(AVCMEThreads));
+            pthread_mutex_init(&me->lock, NULL);
+            pthread_cond_init(&me->cond, NULL);
+            encvid->meThreads = me;
+
+            for (i = 0; i < numThreads - 1; i++)
+            {
+                me->worker[i].me = me;
+                if (pthread_create(&me->threads[i], NULL, MotionSearchThread, &me->worker[i]))
+                {
+                    break;
+                }
+            }
+            me->numThreads = i + 1; /* run with whatever could be started */
+        }
+    }
+#endif
+
+    return AVCENC_SUCCESS;
+}
+
+/* Point the half-pel and quarter-pel candidates into encvid->subpel_pred */
+static void InitSubpelCandidates(AVCEncObject *encvid)
+{
+    uint8* subpel_pred = (uint8*) encvid->subpel_pred; // all 16 sub-pel positions
+
     /* initialize half-pel search */
     encvid->hpel_cand[0] = subpel_pred + REF_CENTER;
     encvid->hpel_cand[1] = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE + 1 ;
@@ -164,9 +250,6 @@ AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
     encvid->bilin_base[8][1] = subpel_pred + V0Q_H2Q * SUBPEL_PRED_BLK_SIZE;
     encvid->bilin_base[8][2] = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE;
     encvid->bilin_base[8][3] = subpel_pred + V2Q_H2Q * SUBPEL_PRED_BLK_SIZE;
-
-
-    return AVCENC_SUCCESS;
 }
 
 /* Clean-up memory */
@@ -180,6 +263,29 @@ void CleanMotionSearchModule(AVCHandle *avcHandle)
         encvid->mvbits = NULL;
     }
 
+    if (encvid->meThreads)
+    {
+        AVCMEThreads *me = encvid->meThreads;
+        int i;
+
+        pthread_mutex_lock(&me->lock);
+        me->exit = 1;
+        pthread_cond_broadcast(&me->cond);
+        pthread_mutex_unlock(&me->lock);
+        for (i = 0; i < me->numThreads - 1; i++)
+        {
+            pthread_join(me->threads[i], NULL);
+        }
+        pthread_cond_destroy(&me->cond);
+        pthread_mutex_destroy(&me->lock);
+        if (me->rowProgress)
+        {
+            avcHandle->CBAVC_Free(avcHandle->userData, me->rowProgress);
+        }
+        avcHandle->CBAVC_Free(avcHandle->userData, me);
+        encvid->meThreads = NULL;
+    }
+
     return ;
 }
 
@@ -232,45 +338,304 @@ bool IntraDecisionABE(int *min_cost, uint8 *cur, int pitch, bool ave)
     return intra;
 }
 
+/* search one macroblock, only per-MB state is written besides the two counters */
+static void AVCMotionEstimateMB(AVCEncObject *encvid, int i, int j, int type_pred,
+                                int *totalSAD, int *NumIntraSearch)
+{
+    AVCCommonObj *video = encvid->common;
+    AVCFrameIO *currInput = encvid->currInput;
+    AVCRateControl *rateCtrl = encvid->rateCtrl;
+    uint8 *intraSearch = encvid->intraSearch;
+    int mbwidth = video->PicWidthInMbs;
+    int mbheight = video->PicHeightInMbs;
+    int pitch = currInput->pitch;
+    int mbnum = j * mbwidth + i;
+    AVCMacroblock *currMB;
+    AVCMV *mot_mb_16x16 = encvid->mot16x16 + mbnum;
+    uint8 *cur, *best_cand[5];
+    int abe_cost, k;
+    int hp_guess = 0;
+    uint32 mv_uint32;
+
+    video->mbNum = mbnum;
+    video->currMB = currMB = video->mblock + mbnum;
+
+    cur = currInput->YCbCr[0] + pitch * (j << 4) + (i << 4);
+
+    if (currMB->mb_intra == 0) /* for INTER mode */
+    {
+#if defined(HTFM)
+        HTFMPrepareCurMB_AVC(encvid, &encvid->htfm_stat, cur, pitch);
+#else
+        AVCPrepareCurMB(encvid, cur, pitch);
+#endif
+        /************************************************************/
+        /******** full-pel 1MV search **********************/
+
+        AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
+                          encvid->fullsearch_enable, &hp_guess);
+
+        abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
+
+        /* set mbMode and MVs */
+        currMB->mbMode = AVC_P16;
+        currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
+        mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
+        for (k = 0; k < 32; k += 2)
+        {
+            currMB->mvL0[k>>1] = mv_uint32;
+        }
+
+        /* make a decision whether it should be tested for intra or not */
+        if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+        {
+            if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
+            {
+                intraSearch[mbnum] = 0;
+            }
+            else
+            {
+                (*NumIntraSearch)++;
+                rateCtrl->MADofMB[mbnum] = abe_cost;
+            }
+        }
+        else // boundary MBs, always do intra search
+        {
+            (*NumIntraSearch)++;
+        }
+
+        *totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
+    }
+    else    /* INTRA update, use for prediction */
+    {
+        mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
+
+        /* reset all other MVs to zero */
+        /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
+        abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
+
+        if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+        {
+            IntraDecisionABE(&abe_cost, cur, pitch, false);
+
+            rateCtrl->MADofMB[mbnum] = abe_cost;
+            *totalSAD += abe_cost;
+        }
+
+        (*NumIntraSearch)++ ;
+        /* cannot do I16 prediction here because it needs full decoding. */
+        // intraSearch[mbnum] = 1;
+
+    }
+
+    return ;
+}
+
+/* search MB row j; with me != NULL, stay two MBs behind row j-1 and publish progress */
+static void AVCMotionEstimateRow(AVCEncObject *encvid, AVCMEThreads *me, int j,
+                                 int start_i, int incr_i, int type_pred,
+                                 int *totalSAD, int *NumIntraSearch)
+{
+    int mbwidth = encvid->common->PicWidthInMbs;
+    int i, needed;
+
+    if (incr_i > 1)
+    {
+        start_i = (start_i + j) & 1; /* checkerboard, toggles every row */
+    }
+
+    for (i = start_i; i < mbwidth; i += incr_i)
+    {
+        if (me && j > 0)
+        {
+            needed = (i + 2 < mbwidth) ? i + 2 : mbwidth;
+            pthread_mutex_lock(&me->lock);
+            while (me->rowProgress[j - 1] < needed)
+            {
+                me->numWaiting++;
+                pthread_cond_wait(&me->cond, &me->lock);
+                me->numWaiting--;
+            }
+            pthread_mutex_unlock(&me->lock);
+        }
+
+        AVCMotionEstimateMB(encvid, i, j, type_pred, totalSAD, NumIntraSearch);
+
+        if (me)
+        {
+            pthread_mutex_lock(&me->lock);
+            /* the last column of a checkerboard row may be skipped */
+            me->rowProgress[j] = (i + incr_i >= mbwidth) ? mbwidth : i + 1;
+            if (me->numWaiting)
+            {
+                pthread_cond_broadcast(&me->cond);
+            }
+            pthread_mutex_unlock(&me->lock);
+        }
+    }
+
+    return ;
+}
+
+/* take rows of the current pass until none are left, called with me->lock held */
+static void AVCMotionEstimateRows(AVCMEThreads *me, AVCEncObject *encvid)
+{
+    int totalSAD = 0, NumIntraSearch = 0;
+    int j;
+
+    while (me->nextRow < me->mbheight)
+    {
+        j = me->nextRow++;
+        pthread_mutex_unlock(&me->lock);
+
+        AVCMotionEstimateRow(encvid, me, j, me->start_i, me->incr_i, me->type_pred,
+                             &totalSAD, &NumIntraSearch);
+
+        pthread_mutex_lock(&me->lock);
+        me->rowsDone++;
+        if (me->numWaiting)
+        {
+            pthread_cond_broadcast(&me->cond);
+        }
+    }
+
+    me->totalSAD += totalSAD;
+    me->NumIntraSearch += NumIntraSearch;
+
+    return ;
+}
+
+static void *MotionSearchThread(void *arg)
+{
+    AVCMEWorker *worker = (AVCMEWorker*) arg;
+    AVCMEThreads *me = worker->me;
+    uint passId = 0;
+
+    pthread_mutex_lock(&me->lock);
+    for (;;)
+    {
+        while (!me->exit && me->passId == passId)
+        {
+            me->numWaiting++;
+            pthread_cond_wait(&me->cond, &me->lock);
+            me->numWaiting--;
+        }
+        if (me->exit)
+        {
+            break;
+        }
+        passId = me->passId;
+
+        AVCMotionEstimateRows(me, &worker->encvid);
+    }
+    pthread_mutex_unlock(&me->lock);
+
+    return NULL;
+}
+
+/* one pass over the frame, on the worker threads when there are any */
+static void AVCMotionEstimatePass(AVCEncObject *encvid, int start_i, int incr_i,
+                                  int type_pred, int *totalSAD, int *NumIntraSearch)
+{
+    AVCCommonObj *video = encvid->common;
+    AVCMEThreads *me = encvid->meThreads;
+    int mbheight = video->PicHeightInMbs;
+    int j, k;
+
+    if (me == NULL || me->numThreads < 2 || mbheight < 2)
+    {
+        for (j = 0; j < mbheight; j++)
+        {
+            AVCMotionEstimateRow(encvid, NULL, j, start_i, incr_i, type_pred,
+                                 totalSAD, NumIntraSearch);
+        }
+        return ;
+    }
+
+    pthread_mutex_lock(&me->lock);
+    if (me->rowProgressSize < mbheight)
+    {
+        if (me->rowProgress)
+        {
+            encvid->avcHandle->CBAVC_Free(encvid->avcHandle->userData, me->rowProgress);
+        }
+        me->rowProgress = (int*) encvid->avcHandle->CBAVC_Malloc(encvid->avcHandle->userData,
+                          sizeof(int) * mbheight, DEFAULT_ATTR);
+        me->rowProgressSize = me->rowProgress ? mbheight : 0;
+    }
+    if (me->rowProgress == NULL)
+    {
+        pthread_mutex_unlock(&me->lock);
+        for (j = 0; j < mbheight; j++)
+        {
+            AVCMotionEstimateRow(encvid, NULL, j, start_i, incr_i, type_pred,
+                                 totalSAD, NumIntraSearch);
+        }
+        return ;
+    }
+
+    /* workers are idle between passes, refresh their copies */
+    for (k = 0; k < me->numThreads - 1; k++)
+    {
+        AVCMEWorker *worker = &me->worker[k];
+
+        memcpy(&worker->encvid, encvid, sizeof(AVCEncObject));
+        memcpy(&worker->common, video, sizeof(AVCCommonObj));
+        worker->encvid.common = &worker->common;
+        InitSubpelCandidates(&worker->encvid);
+    }
+
+    memset(me->rowProgress, 0, sizeof(int) * mbheight);
+    me->mbheight = mbheight;
+    me->nextRow = 0;
+    me->rowsDone = 0;
+    me->start_i = start_i;
+    me->incr_i = incr_i;
+    me->type_pred = type_pred;
+    me->totalSAD = 0;
+    me->NumIntraSearch = 0;
+    me->passId++;
+    pthread_cond_broadcast(&me->cond);
+
+    AVCMotionEstimateRows(me, encvid);
+
+    while (me->rowsDone < mbheight)
+    {
+        me->numWaiting++;
+        pthread_cond_wait(&me->cond, &me->lock);
+        me->numWaiting--;
+    }
+    *totalSAD += me->totalSAD;
+    *NumIntraSearch += me->NumIntraSearch;
+    pthread_mutex_unlock(&me->lock);
+
+    return ;
+}
+
 /******* main function for macroblock prediction for the entire frame ***/
 /* if turns out to be IDR frame, set video->nal_unit_type to AVC_NALTYPE_IDR */
 void AVCMotionEstimation(AVCEncObject *encvid)
 {
     AVCCommonObj *video = encvid->common;
     int slice_type = video->slice_type;
-    AVCFrameIO *currInput = encvid->currInput;
     AVCPictureData *refPic = video->RefPicList0[0];
-    int i, j, k;
-    int mbwidth = video->PicWidthInMbs;
-    int mbheight = video->PicHeightInMbs;
+    int i;
     int totalMB = video->PicSizeInMbs;
-    int pitch = currInput->pitch;
-    AVCMacroblock *currMB, *mblock = video->mblock;
-    AVCMV *mot_mb_16x16, *mot16x16 = encvid->mot16x16;
-    // AVCMV *mot_mb_16x8, *mot_mb_8x16, *mot_mb_8x8, etc;
+    AVCMacroblock *mblock = video->mblock;
     AVCRateControl *rateCtrl = encvid->rateCtrl;
     uint8 *intraSearch = encvid->intraSearch;
-    uint FS_en = encvid->fullsearch_enable;
 
     int NumIntraSearch, start_i, numLoop, incr_i;
-    int mbnum, offset;
-    uint8 *cur, *best_cand[5];
     int totalSAD = 0;   /* average SAD for rate control */
     int type_pred;
-    int abe_cost;
 
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
     int collect = 0;
-    HTFM_Stat htfm_stat;
     double newvar[16];
     double exp_lamda[15];
     /*********************************/
 #endif
-    int hp_guess = 0;
-    uint32 mv_uint32;
-
-    offset = 0;
 
     if (slice_type == AVC_I_SLICE)
     {
@@ -309,7 +674,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     encvid->sad_extra_info = NULL;
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/
-    InitHTFM(video, &htfm_stat, newvar, &collect);
+    InitHTFM(video, &encvid->htfm_stat, newvar, &collect);
     /*********************************/
 #endif
 
@@ -319,7 +684,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     {
         incr_i = 2;
         numLoop = 2;
-        start_i = 1;
+        start_i = 0; /* row 0 of the first pass starts at column 0 */
         type_pred = 0; /* for initial candidate selection */
     }
     else
@@ -336,94 +701,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     NumIntraSearch = 0; // to be intra searched in the encoding loop.
     while (numLoop--)
     {
-        for (j = 0; j < mbheight; j++)
-        {
-            if (incr_i > 1)
-                start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
-
-            offset = pitch * (j << 4) + (start_i << 4);
-
-            mbnum = j * mbwidth + start_i;
-
-            for (i = start_i; i < mbwidth; i += incr_i)
-            {
-                video->mbNum = mbnum;
-                video->currMB = currMB = mblock + mbnum;
-                mot_mb_16x16 = mot16x16 + mbnum;
-
-                cur = currInput->YCbCr[0] + offset;
-
-                if (currMB->mb_intra == 0) /* for INTER mode */
-                {
-#if defined(HTFM)
-                    HTFMPrepareCurMB_AVC(encvid, &htfm_stat, cur, pitch);
-#else
-                    AVCPrepareCurMB(encvid, cur, pitch);
-#endif
-                    /************************************************************/
-                    /******** full-pel 1MV search **********************/
-
-                    AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
-                                      FS_en, &hp_guess);
-
-                    abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
-
-                    /* set mbMode and MVs */
-                    currMB->mbMode = AVC_P16;
-                    currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
-                    mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
-                    for (k = 0; k < 32; k += 2)
-                    {
-                        currMB->mvL0[k>>1] = mv_uint32;
-                    }
-
-                    /* make a decision whether it should be tested for intra or not */
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
-                        {
-                            intraSearch[mbnum] = 0;
-                        }
-                        else
-                        {
-                            NumIntraSearch++;
-                            rateCtrl->MADofMB[mbnum] = abe_cost;
-                        }
-                    }
-                    else // boundary MBs, always do intra search
-                    {
-                        NumIntraSearch++;
-                    }
-
-                    totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
-                }
-                else    /* INTRA update, use for prediction */
-                {
-                    mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
-
-                    /* reset all other MVs to zero */
-                    /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
-                    abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
-
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        IntraDecisionABE(&abe_cost, cur, pitch, false);
-
-                        rateCtrl->MADofMB[mbnum] = abe_cost;
-                        totalSAD += abe_cost;
-                    }
-
-                    NumIntraSearch++ ;
-                    /* cannot do I16 prediction here because it needs full decoding. */
-                    // intraSearch[mbnum] = 1;
-
-                }
-
-                mbnum += incr_i;
-                offset += (incr_i << 4);
-
-            } /* for i */
-        } /* for j */
+        AVCMotionEstimatePass(encvid, start_i, incr_i, type_pred, &totalSAD, &NumIntraSearch);
 
         /* since we cannot do intra/inter decision here, the SCD has to be
         based on other criteria such as motion vectors coherency or the SAD */
@@ -453,7 +731,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
             }
         }
         /******** no scene change, continue motion search **********************/
-        start_i = 0;
+        start_i = 1; /* second pass takes the other half of the checkerboard */
         type_pred++; /* second pass */
     }
 
@@ -464,7 +742,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     if (collect)
     {
         collect = 0;
-        UpdateHTFM(encvid, newvar, exp_lamda, &htfm_stat);
+        UpdateHTFM(encvid, newvar, exp_lamda, &encvid->htfm_stat);
     }
     /*********************************/
 #endif
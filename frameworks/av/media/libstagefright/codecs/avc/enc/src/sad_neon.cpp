@@ -0,0 +1,96 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include "avcenc_lib.h"
+
+#include <arm_neon.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef AT_HWCAP
+#define AT_HWCAP    16
+#endif
+#ifndef HWCAP_NEON
+#define HWCAP_NEON  (1 << 12)
+#endif
+
+/*==================================================================
+    Function:   AVCSAD_Macroblock_NEON
+    Purpose:    NEON version of AVCSAD_Macroblock_C. The SAD is checked
+                against dmin after every row like the C version, so the
+                partial SAD returned on early exit is the same and the
+                neighbour SADs kept for the half-pel guess do not change.
+==================================================================*/
+int AVCSAD_Macroblock_NEON(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_lx >> 16;
+    int lx = dmin_lx & 0xFFFF;
+    uint16x8_t acc = vdupq_n_u16(0); /* at most 16 * 2 * 255 per lane */
+    uint64x2_t sum;
+    uint8x16_t r, b;
+    int sad = 0;
+    int i;
+
+    for (i = 16; i > 0; i--)
+    {
+        r = vld1q_u8(ref);
+        b = vld1q_u8(blk);
+        acc = vabal_u8(acc, vget_low_u8(r), vget_low_u8(b));
+        acc = vabal_u8(acc, vget_high_u8(r), vget_high_u8(b));
+
+        sum = vpaddlq_u32(vpaddlq_u16(acc));
+        sad = (int)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+        if (sad > dmin)
+        {
+            break;
+        }
+        ref += lx;
+        blk += 16;
+    }
+
+    return sad;
+}
+
+/* bionic has no getauxval(); read the aux vector directly */
+bool AVCCpuHasNeon(void)
+{
+    unsigned long entry[2];
+    bool neon = false;
+    int fd = open("/proc/self/auxv", O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+    while (read(fd, entry, sizeof(entry)) == (ssize_t) sizeof(entry))
+    {
+        if (entry[0] == AT_HWCAP)
+        {
+            neon = (entry[1] & HWCAP_NEON) != 0;
+            break;
+        }
+        if (entry[0] == 0)
+        {
+            break;
+        }
+    }
+    close(fd);
+
+    return neon;
+}
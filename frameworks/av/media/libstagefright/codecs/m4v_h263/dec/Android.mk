@@ -46,6 +46,11 @@ LOCAL_C_INCLUDES := \
 
 LOCAL_CFLAGS := -DOSCL_EXPORT_REF= -DOSCL_IMPORT_REF=
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+LOCAL_SRC_FILES += src/get_pred_adv_b_neon.cpp.neon
+LOCAL_CFLAGS += -DPV_ARM_NEON
+endif
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
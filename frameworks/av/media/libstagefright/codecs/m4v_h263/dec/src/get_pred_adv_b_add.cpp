@@ -79,6 +79,12 @@
 
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 
+int (*GetPredAdvBTable[2][2])(uint8*, uint8*, int, int) =
+{
+    {&GetPredAdvancedBy0x0, &GetPredAdvancedBy0x1},
+    {&GetPredAdvancedBy1x0, &GetPredAdvancedBy1x1}
+};
+
 int GetPredAdvancedBy0x0(
     uint8 *prev,        /* i */
     uint8 *pred_block,      /* i */
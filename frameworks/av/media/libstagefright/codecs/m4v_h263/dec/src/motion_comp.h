@@ -72,11 +72,9 @@ extern "C"
                             }
 
 
-    static int (*const GetPredAdvBTable[2][2])(uint8*, uint8*, int, int) =
-    {
-        {&GetPredAdvancedBy0x0, &GetPredAdvancedBy0x1},
-        {&GetPredAdvancedBy1x0, &GetPredAdvancedBy1x1}
-    };
+    /* defined in get_pred_adv_b_add.cpp, indexed [ypos&1][xpos&1]; */
+    /*    PVInitVideoDecoder may swap in NEON versions at runtime  */
+    extern int (*GetPredAdvBTable[2][2])(uint8*, uint8*, int, int);
 
     /*----------------------------------------------------------------------------
     ; SIMPLE TYPEDEF'S
@@ -242,6 +242,12 @@ extern "C"
         int pred_width_rnd /* i */
     );
 
+#ifdef PV_ARM_NEON
+    /*--------------------------------------------------------------------------*/
+    /* defined in get_pred_adv_b_neon.cpp */
+    void SelectNeonGetPredAdvB(void);
+#endif
+
     /*--------------------------------------------------------------------------*/
     /* defined in get_pred_outside.c */
     int GetPredOutside(
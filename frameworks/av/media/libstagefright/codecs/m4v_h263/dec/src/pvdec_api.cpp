@@ -74,6 +74,9 @@ OSCL_EXPORT_REF Bool PVInitVideoDecoder(VideoDecControls *decCtrl, uint8 *volbuf
 
 
     oscl_memset(decCtrl, 0, sizeof(VideoDecControls)); /* fix a size bug.   03/28/2001 */
+#ifdef PV_ARM_NEON
+    SelectNeonGetPredAdvB();    /* idempotent, picks MC kernels once per process */
+#endif
     decCtrl->nLayers = nLayers;
     for (idx = 0; idx < nLayers; idx++)
     {
@@ -29,9 +29,17 @@ LOCAL_SRC_FILES := \
  	src/pvmp3_reorder.cpp \
 
 ifeq ($(TARGET_ARCH),arm)
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+# the C versions carry NEON paths for the synthesis window and the IMDCT
+LOCAL_SRC_FILES += \
+	src/pvmp3_polyphase_filter_window.cpp.neon \
+ 	src/pvmp3_mdct_18.cpp.neon
+else
 LOCAL_SRC_FILES += \
 	src/asm/pvmp3_polyphase_filter_window_gcc.s \
- 	src/asm/pvmp3_mdct_18_gcc.s \
+ 	src/asm/pvmp3_mdct_18_gcc.s
+endif
+LOCAL_SRC_FILES += \
  	src/asm/pvmp3_dct_9_gcc.s \
 	src/asm/pvmp3_dct_16_gcc.s
 else
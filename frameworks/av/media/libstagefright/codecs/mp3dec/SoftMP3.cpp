@@ -195,124 +195,148 @@ void SoftMP3::onQueueFilled(OMX_U32 portIndex) {
     List<BufferInfo *> &outQueue = getPortQueue(1);
 
     while (!inQueue.empty() && !outQueue.empty()) {
-        BufferInfo *inInfo = *inQueue.begin();
-        OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
-
         BufferInfo *outInfo = *outQueue.begin();
         OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
 
-        if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-            inQueue.erase(inQueue.begin());
-            inInfo->mOwnedByUs = false;
-            notifyEmptyBufferDone(inHeader);
+        outHeader->nOffset = 0;
+        outHeader->nFilledLen = 0;
+        outHeader->nFlags = 0;
 
-            if (!mIsFirst) {
-                // pad the end of the stream with 529 samples, since that many samples
-                // were trimmed off the beginning when decoding started
-                outHeader->nFilledLen =
-                    kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+        // Decode as many of the queued frames as fit into this output
+        // buffer, so that a stream costs one fill callback per
+        // kMaxFramesPerBuffer frames instead of one per frame.
+        int32_t numFrames = 0;
+        while (!inQueue.empty() && numFrames < kMaxFramesPerBuffer) {
+            BufferInfo *inInfo = *inQueue.begin();
+            OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+
+            if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+                if (numFrames > 0) {
+                    // deliver the decoded frames first
+                    break;
+                }
+
+                inQueue.erase(inQueue.begin());
+                inInfo->mOwnedByUs = false;
+                notifyEmptyBufferDone(inHeader);
+
+                if (!mIsFirst) {
+                    // pad the end of the stream with 529 samples, since that many samples
+                    // were trimmed off the beginning when decoding started
+                    outHeader->nFilledLen =
+                        kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+
+                    memset(outHeader->pBuffer, 0, outHeader->nFilledLen);
+                } else {
+                    // Since we never discarded frames from the start, we won't have
+                    // to add any padding at the end either.
+                    outHeader->nFilledLen = 0;
+                }
+
+                outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+
+                outQueue.erase(outQueue.begin());
+                outInfo->mOwnedByUs = false;
+                notifyFillBufferDone(outHeader);
+                return;
+            }
 
-                memset(outHeader->pBuffer, 0, outHeader->nFilledLen);
-            } else {
-                // Since we never discarded frames from the start, we won't have
-                // to add any padding at the end either.
-                outHeader->nFilledLen = 0;
+            if (inHeader->nOffset == 0) {
+                mAnchorTimeUs = inHeader->nTimeStamp;
+                mNumFramesOutput = 0;
             }
 
-            outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+            uint8_t *outPtr =
+                outHeader->pBuffer + outHeader->nOffset + outHeader->nFilledLen;
 
-            outQueue.erase(outQueue.begin());
-            outInfo->mOwnedByUs = false;
-            notifyFillBufferDone(outHeader);
-            return;
-        }
+            mConfig->pInputBuffer =
+                inHeader->pBuffer + inHeader->nOffset;
 
-        if (inHeader->nOffset == 0) {
-            mAnchorTimeUs = inHeader->nTimeStamp;
-            mNumFramesOutput = 0;
-        }
+            mConfig->inputBufferCurrentLength = inHeader->nFilledLen;
+            mConfig->inputBufferMaxLength = 0;
+            mConfig->inputBufferUsedLength = 0;
+
+            mConfig->outputFrameSize = kMaxFrameSize / sizeof(int16_t);
+
+            mConfig->pOutputBuffer = reinterpret_cast<int16_t *>(outPtr);
 
-        mConfig->pInputBuffer =
-            inHeader->pBuffer + inHeader->nOffset;
+            ERROR_CODE decoderErr;
+            if ((decoderErr = pvmp3_framedecoder(mConfig, mDecoderBuf))
+                    != NO_DECODING_ERROR) {
+                ALOGV("mp3 decoder returned error %d", decoderErr);
 
-        mConfig->inputBufferCurrentLength = inHeader->nFilledLen;
-        mConfig->inputBufferMaxLength = 0;
-        mConfig->inputBufferUsedLength = 0;
+                if (decoderErr != NO_ENOUGH_MAIN_DATA_ERROR
+                            && decoderErr != SIDE_INFO_ERROR) {
+                    ALOGE("mp3 decoder returned error %d", decoderErr);
 
-        mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
+                    notify(OMX_EventError, OMX_ErrorUndefined, decoderErr, NULL);
+                    mSignalledError = true;
+                    return;
+                }
 
-        mConfig->pOutputBuffer =
-            reinterpret_cast<int16_t *>(outHeader->pBuffer);
+                if (mConfig->outputFrameSize == 0) {
+                    mConfig->outputFrameSize = kMaxFrameSize / sizeof(int16_t);
+                }
 
-        ERROR_CODE decoderErr;
-        if ((decoderErr = pvmp3_framedecoder(mConfig, mDecoderBuf))
-                != NO_DECODING_ERROR) {
-            ALOGV("mp3 decoder returned error %d", decoderErr);
+                // This is recoverable, just ignore the current frame and
+                // play silence instead.
+                memset(outPtr, 0, mConfig->outputFrameSize * sizeof(int16_t));
 
-            if (decoderErr != NO_ENOUGH_MAIN_DATA_ERROR
-                        && decoderErr != SIDE_INFO_ERROR) {
-                ALOGE("mp3 decoder returned error %d", decoderErr);
+                mConfig->inputBufferUsedLength = inHeader->nFilledLen;
+            } else if (mConfig->samplingRate != mSamplingRate
+                    || mConfig->num_channels != mNumChannels) {
+                if (numFrames > 0) {
+                    // The frames decoded so far use the old format. This frame
+                    // is decoded again once the output port is reconfigured.
+                    outQueue.erase(outQueue.begin());
+                    outInfo->mOwnedByUs = false;
+                    notifyFillBufferDone(outHeader);
+                }
 
-                notify(OMX_EventError, OMX_ErrorUndefined, decoderErr, NULL);
-                mSignalledError = true;
+                mSamplingRate = mConfig->samplingRate;
+                mNumChannels = mConfig->num_channels;
+
+                notify(OMX_EventPortSettingsChanged, 1, 0, NULL);
+                mOutputPortSettingsChange = AWAITING_DISABLED;
                 return;
             }
 
-            if (mConfig->outputFrameSize == 0) {
-                mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
+            if (numFrames == 0) {
+                outHeader->nTimeStamp =
+                    mAnchorTimeUs
+                        + (mNumFramesOutput * 1000000ll) / mConfig->samplingRate;
             }
 
-            // This is recoverable, just ignore the current frame and
-            // play silence instead.
-            memset(outHeader->pBuffer,
-                   0,
-                   mConfig->outputFrameSize * sizeof(int16_t));
-
-            mConfig->inputBufferUsedLength = inHeader->nFilledLen;
-        } else if (mConfig->samplingRate != mSamplingRate
-                || mConfig->num_channels != mNumChannels) {
-            mSamplingRate = mConfig->samplingRate;
-            mNumChannels = mConfig->num_channels;
-
-            notify(OMX_EventPortSettingsChanged, 1, 0, NULL);
-            mOutputPortSettingsChange = AWAITING_DISABLED;
-            return;
-        }
-
-        if (mIsFirst) {
-            mIsFirst = false;
-            // The decoder delay is 529 samples, so trim that many samples off
-            // the start of the first output buffer. This essentially makes this
-            // decoder have zero delay, which the rest of the pipeline assumes.
-            outHeader->nOffset =
-                kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
-
-            outHeader->nFilledLen =
-                mConfig->outputFrameSize * sizeof(int16_t) - outHeader->nOffset;
-        } else {
-            outHeader->nOffset = 0;
-            outHeader->nFilledLen = mConfig->outputFrameSize * sizeof(int16_t);
-        }
+            if (mIsFirst) {
+                mIsFirst = false;
+                // The decoder delay is 529 samples, so trim that many samples off
+                // the start of the first output buffer. This essentially makes this
+                // decoder have zero delay, which the rest of the pipeline assumes.
+                outHeader->nOffset =
+                    kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
 
-        outHeader->nTimeStamp =
-            mAnchorTimeUs
-                + (mNumFramesOutput * 1000000ll) / mConfig->samplingRate;
+                outHeader->nFilledLen =
+                    mConfig->outputFrameSize * sizeof(int16_t) - outHeader->nOffset;
+            } else {
+                outHeader->nFilledLen += mConfig->outputFrameSize * sizeof(int16_t);
+            }
 
-        outHeader->nFlags = 0;
+            CHECK_GE(inHeader->nFilledLen, mConfig->inputBufferUsedLength);
 
-        CHECK_GE(inHeader->nFilledLen, mConfig->inputBufferUsedLength);
+            inHeader->nOffset += mConfig->inputBufferUsedLength;
+            inHeader->nFilledLen -= mConfig->inputBufferUsedLength;
 
-        inHeader->nOffset += mConfig->inputBufferUsedLength;
-        inHeader->nFilledLen -= mConfig->inputBufferUsedLength;
+            mNumFramesOutput += mConfig->outputFrameSize / mNumChannels;
 
-        mNumFramesOutput += mConfig->outputFrameSize / mNumChannels;
+            if (inHeader->nFilledLen == 0) {
+                inInfo->mOwnedByUs = false;
+                inQueue.erase(inQueue.begin());
+                inInfo = NULL;
+                notifyEmptyBufferDone(inHeader);
+                inHeader = NULL;
+            }
 
-        if (inHeader->nFilledLen == 0) {
-            inInfo->mOwnedByUs = false;
-            inQueue.erase(inQueue.begin());
-            inInfo = NULL;
-            notifyEmptyBufferDone(inHeader);
-            inHeader = NULL;
+            ++numFrames;
         }
 
         outInfo->mOwnedByUs = false;
@@ -47,7 +47,9 @@ protected:
 private:
     enum {
         kNumBuffers = 4,
-        kOutputBufferSize = 4608 * 2,
+        kMaxFrameSize = 4608,   // bytes, one MPEG-1 stereo frame
+        kMaxFramesPerBuffer = 4,
+        kOutputBufferSize = kMaxFrameSize * kMaxFramesPerBuffer,
         kPVMP3DecoderDelay = 529 // frames
     };
 
@@ -71,6 +71,10 @@ Returns
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
 
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -129,6 +133,26 @@ const int32 cosTerms_1_ov_cos_phi[18] =
 
 
 
+#if defined(__ARM_NEON__)
+/*  (a*b)>>SHIFT on each lane, same truncation as the fxp_mul32_Qxx() ops */
+#define MUL32_NEON(a, b, SHIFT)                                                 \
+    vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(a), vget_low_s32(b)), SHIFT), \
+                 vshrn_n_s64(vmull_s32(vget_high_s32(a), vget_high_s32(b)), SHIFT))
+
+/*  lanes {p[3], p[2], p[1], p[0]} */
+static inline int32x4_t load_reversed(const int32 *p)
+{
+    int32x4_t v = vrev64q_s32(vld1q_s32(p));
+    return vcombine_s32(vget_high_s32(v), vget_low_s32(v));
+}
+
+static inline void store_reversed(int32 *p, int32x4_t v)
+{
+    v = vrev64q_s32(v);
+    vst1q_s32(p, vcombine_s32(vget_high_s32(v), vget_low_s32(v)));
+}
+#endif
+
 void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
 {
     int32 i;
@@ -146,8 +170,32 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     int32 *pt_vec   =  vec;
     int32 *pt_vec_o = &vec[17];
 
-
+#if defined(__ARM_NEON__)
+    /*  first 8 butterflies four at a time, pairs (i, 17-i) do not overlap */
+    for (i = 0; i < 8; i += 4)
+    {
+        int32x4_t v    = vshlq_n_s32(vld1q_s32(&vec[i]), 1);
+        int32x4_t v_o  = load_reversed(&vec[14 - i]);
+        int32x4_t c    = vld1q_s32(&cosTerms_1_ov_cos_phi[i]);
+        int32x4_t c_x  = load_reversed(&cosTerms_1_ov_cos_phi[14 - i]);
+        int32x4_t c_sp = vld1q_s32(&cosTerms_dct18[i]);
+        int32x4_t t    = MUL32_NEON(v, c, 32);
+        int32x4_t t1   = MUL32_NEON(v_o, c_x, 27);
+        int32x4_t d    = vsubq_s32(t, t1);
+
+        vst1q_s32(&vec[i], vaddq_s32(t, t1));
+        store_reversed(&vec[14 - i], MUL32_NEON(d, c_sp, 28));
+    }
+    pt_vec       += 8;
+    pt_vec_o     -= 8;
+    pt_cos       += 8;
+    pt_cos_x     -= 8;
+    pt_cos_split += 8;
+
+    for (i = 1; i != 0; i--)
+#else
     for (i = 9; i != 0; i--)
+#endif
     {
         tmp  = *(pt_vec);
         tmp1 = *(pt_vec_o);
@@ -243,6 +291,35 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
 
     /* next iteration overlap */
 
+#if defined(__ARM_NEON__)
+    /*
+     *  history[k]   = (history[8-k] << 1) * window[18+k]
+     *  history[9+k] = (history[k]   << 1) * window[27+k],   k = 0..8
+     */
+    {
+        int32x4_t h_lo = vshlq_n_s32(vld1q_s32(&history[0]), 1);
+        int32x4_t h_hi = vshlq_n_s32(vld1q_s32(&history[4]), 1);
+        int32x4_t h_lo_r = vrev64q_s32(h_lo);
+        int32x4_t h_hi_r = vrev64q_s32(h_hi);
+        int32x4_t out_1_4, out_5_8, out_9_12, out_13_16;
+
+        tmp1 = history[8] << 1;
+
+        h_lo_r = vcombine_s32(vget_high_s32(h_lo_r), vget_low_s32(h_lo_r));
+        h_hi_r = vcombine_s32(vget_high_s32(h_hi_r), vget_low_s32(h_hi_r));
+        out_1_4   = MUL32_NEON(h_hi_r, vld1q_s32(&window[19]), 32);
+        out_5_8   = MUL32_NEON(h_lo_r, vld1q_s32(&window[23]), 32);
+        out_9_12  = MUL32_NEON(h_lo,   vld1q_s32(&window[27]), 32);
+        out_13_16 = MUL32_NEON(h_hi,   vld1q_s32(&window[31]), 32);
+
+        history[ 0] = fxp_mul32_Q32(tmp1, window[18]);
+        history[17] = fxp_mul32_Q32(tmp1, window[35]);
+        vst1q_s32(&history[ 1], out_1_4);
+        vst1q_s32(&history[ 5], out_5_8);
+        vst1q_s32(&history[ 9], out_9_12);
+        vst1q_s32(&history[13], out_13_16);
+    }
+#else
     tmp1 = history[ 8];
     tmp3 = history[ 7];
     tmp2 = history[ 1];
@@ -284,6 +361,7 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     history[12] = fxp_mul32_Q32(tmp2, window[30]);
     history[ 6] = fxp_mul32_Q32(tmp,  window[24]);
     history[11] = fxp_mul32_Q32(tmp,  window[29]);
+#endif
 }
 
 #endif // If not assembly
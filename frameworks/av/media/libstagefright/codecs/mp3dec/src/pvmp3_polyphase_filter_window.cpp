@@ -76,6 +76,10 @@ Input
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
 
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 /*----------------------------------------------------------------------------
 ; MACROS
 ; Define module1 specific macros here
@@ -98,6 +102,42 @@ Input
 ; LOCAL STORE/BUFFER/POINTER DEFINITIONS
 ; Variable declaration - defined here and used outside this module1
 ----------------------------------------------------------------------------*/
+#if defined(__ARM_NEON__)
+/*
+ *  Window of the j = 1..15 outputs transposed so that four consecutive j
+ *  are contiguous: pqmfSynthWinT[m][j-1] = pqmfSynthWin[16*(j-1) + m].
+ *  Column 15 (j = 16) is zero padding for the last group of four.
+ */
+#define WIN(j, m)   pqmfSynthWin[16*((j) - 1) + (m)]
+#define WIN_ROW(m)  { WIN( 1, m), WIN( 2, m), WIN( 3, m), WIN( 4, m), \
+                      WIN( 5, m), WIN( 6, m), WIN( 7, m), WIN( 8, m), \
+                      WIN( 9, m), WIN(10, m), WIN(11, m), WIN(12, m), \
+                      WIN(13, m), WIN(14, m), WIN(15, m), 0 }
+
+static const int32 pqmfSynthWinT[16][16] =
+{
+    WIN_ROW(0), WIN_ROW(1), WIN_ROW(2),  WIN_ROW(3),  WIN_ROW(4),  WIN_ROW(5),  WIN_ROW(6),  WIN_ROW(7),
+    WIN_ROW(8), WIN_ROW(9), WIN_ROW(10), WIN_ROW(11), WIN_ROW(12), WIN_ROW(13), WIN_ROW(14), WIN_ROW(15)
+};
+
+#undef WIN_ROW
+#undef WIN
+
+/*  (a*b)>>32 on each lane, same truncation as fxp_mul32_Q32() */
+static inline int32x4_t mul32_Q32_neon(int32x4_t a, int32x4_t b)
+{
+    int64x2_t lo = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+    int64x2_t hi = vmull_s32(vget_high_s32(a), vget_high_s32(b));
+    return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+/*  lanes {p[3], p[2], p[1], p[0]} */
+static inline int32x4_t load_reversed(const int32 *p)
+{
+    int32x4_t v = vrev64q_s32(vld1q_s32(p));
+    return vcombine_s32(vget_high_s32(v), vget_low_s32(v));
+}
+#endif
 /*----------------------------------------------------------------------------
 ; EXTERNAL FUNCTION REFERENCES
 ; Declare functions defined elsewhere and referenced in this module_x
@@ -121,7 +161,56 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
     const int32 *winPtr = pqmfSynthWin;
     int32 i;
 
+#if defined(__ARM_NEON__)
+    /*
+     *  Same sums as the C loop below, four outputs j at a time. Products are
+     *  truncated one by one and wrap like the scalar code, so the output is
+     *  bit-exact. The fourth group also computes an unused j = 16 lane.
+     */
+    for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j += 4)
+    {
+        const int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + j];
+        const int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - j - 3];
+        int32x4_t vsum1 = vdupq_n_s32(0x00000020);
+        int32x4_t vsum2 = vdupq_n_s32(0x00000020);
+
+        for (i = 0; i < 4; i++)
+        {
+            int32x4_t temp1 = vld1q_s32(&pt_1[SUBBANDS_NUMBER * (2 * i)]);
+            int32x4_t temp3 = load_reversed(&pt_2[SUBBANDS_NUMBER * (15 - 2 * i)]);
+            int32x4_t temp2 = load_reversed(&pt_2[SUBBANDS_NUMBER * (2 * i + 1)]);
+            int32x4_t temp4 = vld1q_s32(&pt_1[SUBBANDS_NUMBER * (14 - 2 * i)]);
+            int32x4_t win0 = vld1q_s32(&pqmfSynthWinT[4 * i    ][j - 1]);
+            int32x4_t win1 = vld1q_s32(&pqmfSynthWinT[4 * i + 1][j - 1]);
+            int32x4_t win2 = vld1q_s32(&pqmfSynthWinT[4 * i + 2][j - 1]);
+            int32x4_t win3 = vld1q_s32(&pqmfSynthWinT[4 * i + 3][j - 1]);
+
+            vsum1 = vaddq_s32(vsum1, mul32_Q32_neon(temp1, win0));
+            vsum2 = vaddq_s32(vsum2, mul32_Q32_neon(temp3, win0));
+            vsum2 = vaddq_s32(vsum2, mul32_Q32_neon(temp1, win1));
+            vsum1 = vsubq_s32(vsum1, mul32_Q32_neon(temp3, win1));
+            vsum1 = vaddq_s32(vsum1, mul32_Q32_neon(temp2, win2));
+            vsum2 = vsubq_s32(vsum2, mul32_Q32_neon(temp4, win2));
+            vsum2 = vaddq_s32(vsum2, mul32_Q32_neon(temp2, win3));
+            vsum1 = vaddq_s32(vsum1, mul32_Q32_neon(temp4, win3));
+        }
+
+        /* saturate16(sum >> 6) */
+        int16 out1[4];
+        int16 out2[4];
+        vst1_s16(out1, vqmovn_s32(vshrq_n_s32(vsum1, 6)));
+        vst1_s16(out2, vqmovn_s32(vshrq_n_s32(vsum2, 6)));
+
+        for (i = 0; i < 4 && j + i < SUBBANDS_NUMBER / 2; i++)
+        {
+            int32 k = (j + i) << (numChannels - 1);
+            outPcm[k] = out1[i];
+            outPcm[(numChannels<<5) - k] = out2[i];
+        }
+    }
 
+    winPtr += 16 * (SUBBANDS_NUMBER / 2 - 1);
+#else
     for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
     {
         sum1 = 0x00000020;
@@ -199,6 +288,7 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
         outPcm[k] = saturate16(sum1 >> 6);
         outPcm[(numChannels<<5) - k] = saturate16(sum2 >> 6);
     }
+#endif
 
 
 
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 /*------------------------------------------------------------------------------
     Module defines
@@ -102,6 +103,9 @@ int main(int argc, char **argv)
     u32 numErrors = 0;
     u32 cropDisplay = 0;
     u32 disableOutputReordering = 0;
+    u32 numThreads = 0;
+    struct timeval startTime, endTime;
+    double decodeSeconds;
 
     FILE *finput;
 
@@ -123,7 +127,7 @@ int main(int argc, char **argv)
     if (argc < 2)
     {
         DEBUG((
-            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-T] file.h264\n",
+            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-Jn] [-T] file.h264\n",
             argv[0]));
         DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
 #if defined(_NO_OUT)
@@ -136,6 +140,7 @@ int main(int argc, char **argv)
         DEBUG(("\t-U NAL unit stream mode\n"));
         DEBUG(("\t-C display cropped image (default decoded image)\n"));
         DEBUG(("\t-R disable DPB output reordering\n"));
+        DEBUG(("\t-Jn use n threads for deblocking (default one per CPU)\n"));
         DEBUG(("\t-T to print tag name and exit\n"));
         return 0;
     }
@@ -167,6 +172,10 @@ int main(int argc, char **argv)
         {
             disableOutputReordering = 1;
         }
+        else if ( strncmp(argv[i], "-J", 2) == 0 )
+        {
+            numThreads = (u32)atoi(argv[i]+2);
+        }
     }
 
     /* open input file for reading, file name given by user. If file open
@@ -204,6 +213,9 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if (numThreads)
+        H264SwDecSetNumThreads(decInst, numThreads);
+
     /* initialize H264SwDecDecode() input structure */
     streamStop = byteStrmStart + strmLen;
     decInput.pStream = byteStrmStart;
@@ -216,6 +228,7 @@ int main(int argc, char **argv)
         decInput.dataLen = tmp;
 
     picDecodeNumber = picDisplayNumber = 1;
+    gettimeofday(&startTime, NULL);
     /* main decoding loop */
     do
     {
@@ -408,6 +421,15 @@ int main(int argc, char **argv)
         }
     }
 
+    /* report decoding speed, use -Onone to leave out output writing */
+    gettimeofday(&endTime, NULL);
+    decodeSeconds = (endTime.tv_sec - startTime.tv_sec) +
+        (endTime.tv_usec - startTime.tv_usec) / 1000000.0;
+    if (decodeSeconds > 0)
+        DEBUG(("%d pictures in %.3f s, %.2f fps (threads %d)\n",
+            picDecodeNumber - 1, decodeSeconds,
+            (picDecodeNumber - 1) / decodeSeconds, numThreads));
+
     /* release decoder instance */
     H264SwDecRelease(decInst);
 
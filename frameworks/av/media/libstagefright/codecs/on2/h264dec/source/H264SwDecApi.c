@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           H264SwDecInit
+          H264SwDecSetNumThreads
           H264SwDecGetInfo
           H264SwDecRelease
           H264SwDecDecode
@@ -175,6 +176,50 @@ H264SwDecRet H264SwDecInit(H264SwDecInst *decInst, u32 noOutputReordering)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetNumThreads()
+
+        Functional description:
+            Set the number of threads taking part in deblocking filtering of
+            each picture. By default one thread per online CPU is used, up to
+            the maximum supported by the decoder. Must not be called while
+            H264SwDecDecode is running.
+
+        Inputs:
+            decInst     decoder instance
+            numThreads  number of threads including the decoding thread,
+                        1 to filter in the decoding thread only, 0 for the
+                        default
+
+        Outputs:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetNumThreads(H264SwDecInst decInst, u32 numThreads)
+{
+
+    DEC_API_TRC("H264SwDecSetNumThreads#");
+
+    if (decInst == NULL)
+    {
+        DEC_API_TRC("H264SwDecSetNumThreads# ERROR: decInst == NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    h264bsdSetNumThreads(&(((decContainer_t *)decInst)->storage), numThreads);
+
+    DEC_API_TRC("H264SwDecSetNumThreads# OK");
+
+    return(H264SWDEC_OK);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: H264SwDecGetInfo()
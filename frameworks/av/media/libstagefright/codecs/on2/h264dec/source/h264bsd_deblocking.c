@@ -24,6 +24,11 @@
      4. Local function prototypes
      5. Functions
           h264bsdFilterPicture
+          h264bsdInitDeblocker
+          h264bsdShutdownDeblocker
+          FilterMacroblock
+          FilterRows
+          DeblockerThread
           FilterVerLumaEdge
           FilterHorLumaEdge
           FilterHorLuma
@@ -47,6 +52,8 @@
     1. Include headers
 ------------------------------------------------------------------------------*/
 
+#include <pthread.h>
+
 #include "basetype.h"
 #include "h264bsd_util.h"
 #include "h264bsd_macroblock_layer.h"
@@ -141,6 +148,33 @@ enum { TOP = 0, LEFT = 1, INNER = 2 };
 #define FILTER_TOP_EDGE     0x02
 #define FILTER_INNER_EDGE   0x01
 
+/* Deblocking worker threads. Filtering a macroblock modifies the three
+ * rightmost pixel columns of the macroblock on the left and the three bottom
+ * pixel rows of the macroblock above. The left edge of the macroblock above
+ * and to the right modifies the same corner of the macroblock above, so a
+ * macroblock can be filtered as soon as the row above has been filtered up to
+ * and including the next column. Rows are claimed in order and each row
+ * trails the row above by two macroblocks, which gives exactly the result of
+ * filtering in raster scan order. */
+struct deblocker
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    /* signalled on new picture, progress and exit */
+    pthread_t threads[MAX_DEBLOCKING_THREADS - 1];
+    u32 numThreads;         /* worker threads, the decoding thread is one more */
+    u32 numWaiting;         /* threads waiting for cond */
+    u32 exit;
+
+    /* picture being filtered */
+    u32 pictureId;
+    image_t *image;
+    mbStorage_t *mb;
+    u32 nextRow;            /* next macroblock row to be claimed */
+    u32 rowsDone;
+    u32 *rowProgress;       /* number of filtered macroblocks in each row */
+    u32 rowProgressSize;
+};
+
 
 /* clipping table defined in intra_prediction.c */
 extern const u8 h264bsdClip[];
@@ -149,6 +183,13 @@ extern const u8 h264bsdClip[];
     4. Local function prototypes
 ------------------------------------------------------------------------------*/
 
+static void FilterMacroblock(image_t *image, mbStorage_t *pMb, u32 mbRow,
+    u32 mbCol);
+
+static void FilterRows(deblocker_t *deblocker);
+
+static void *DeblockerThread(void *arg);
+
 static u32 InnerBoundaryStrength(mbStorage_t *mb1, u32 i1, u32 i2);
 
 #ifndef H264DEC_OMXDL
@@ -548,20 +589,21 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 #endif /* H264DEC_OMXDL */
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: FilterMacroblock
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for one macroblock, i.e. its left, top
+          and inner edges. Filtering is performed directly on the image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
 
         Inputs:
           image         pointer to image to be filtered
-          mb            pointer to macroblock data structure of the top-left
-                        macroblock of the picture
+          pMb           pointer to macroblock data structure of the filtered
+                        macroblock
+          mbRow         vertical position of the macroblock
+          mbCol         horizontal position of the macroblock
 
         Outputs:
           image         filtered image stored here
@@ -571,68 +613,50 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 
 ------------------------------------------------------------------------------*/
 #ifndef H264DEC_OMXDL
-void h264bsdFilterPicture(
+static void FilterMacroblock(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *pMb,
+  u32 mbRow,
+  u32 mbCol)
 {
 
 /* Variables */
 
     u32 flags;
-    u32 picSizeInMbs, mbRow, mbCol;
+    u32 picSizeInMbs;
     u32 picWidthInMbs;
     u8 *data;
-    mbStorage_t *pMb;
     bS_t bS[16];
     edgeThreshold_t thresholds[3];
 
 /* Code */
 
-    ASSERT(image);
-    ASSERT(mb);
-    ASSERT(image->data);
-    ASSERT(image->width);
-    ASSERT(image->height);
-
     picWidthInMbs = image->width;
-    data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    flags = GetMbFilteringFlags(pMb);
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    if (flags)
     {
-        flags = GetMbFilteringFlags(pMb);
-
-        if (flags)
+        /* GetBoundaryStrengths function returns non-zero value if any of
+         * the bS values for the macroblock being processed was non-zero */
+        if (GetBoundaryStrengths(pMb, bS, flags))
         {
-            /* GetBoundaryStrengths function returns non-zero value if any of
-             * the bS values for the macroblock being processed was non-zero */
-            if (GetBoundaryStrengths(pMb, bS, flags))
-            {
-                /* luma */
-                GetLumaEdgeThresholds(thresholds, pMb, flags);
-                data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
+            /* luma */
+            GetLumaEdgeThresholds(thresholds, pMb, flags);
+            data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
 
-                FilterLuma((u8*)data, bS, thresholds, picWidthInMbs*16);
+            FilterLuma((u8*)data, bS, thresholds, picWidthInMbs*16);
 
-                /* chroma */
-                GetChromaEdgeThresholds(thresholds, pMb, flags,
-                    pMb->chromaQpIndexOffset);
-                data = image->data + picSizeInMbs * 256 +
-                    mbRow * picWidthInMbs * 64 + mbCol * 8;
+            /* chroma */
+            GetChromaEdgeThresholds(thresholds, pMb, flags,
+                pMb->chromaQpIndexOffset);
+            data = image->data + picSizeInMbs * 256 +
+                mbRow * picWidthInMbs * 64 + mbCol * 8;
 
-                FilterChroma((u8*)data, data + 64*picSizeInMbs, bS,
-                        thresholds, picWidthInMbs*8);
+            FilterChroma((u8*)data, data + 64*picSizeInMbs, bS,
+                    thresholds, picWidthInMbs*8);
 
-            }
-        }
-
-        mbCol++;
-        if (mbCol == picWidthInMbs)
-        {
-            mbCol = 0;
-            mbRow++;
         }
     }
 
@@ -1739,20 +1763,21 @@ void FilterChroma(
 
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: FilterMacroblock
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for one macroblock, i.e. its left, top
+          and inner edges. Filtering is performed directly on the image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
 
         Inputs:
           image         pointer to image to be filtered
-          mb            pointer to macroblock data structure of the top-left
-                        macroblock of the picture
+          pMb           pointer to macroblock data structure of the filtered
+                        macroblock
+          mbRow         vertical position of the macroblock
+          mbCol         horizontal position of the macroblock
 
         Outputs:
           image         filtered image stored here
@@ -1761,20 +1786,20 @@ void FilterChroma(
           none
 
 ------------------------------------------------------------------------------*/
-
 /*lint --e{550} Symbol not accessed */
-void h264bsdFilterPicture(
+static void FilterMacroblock(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *pMb,
+  u32 mbRow,
+  u32 mbCol)
 {
 
 /* Variables */
 
     u32 flags;
-    u32 picSizeInMbs, mbRow, mbCol;
+    u32 picSizeInMbs;
     u32 picWidthInMbs;
     u8 *data;
-    mbStorage_t *pMb;
     u8 bS[2][16];
     u8 thresholdLuma[2][16];
     u8 thresholdChroma[2][8];
@@ -1784,86 +1809,67 @@ void h264bsdFilterPicture(
 
 /* Code */
 
-    ASSERT(image);
-    ASSERT(mb);
-    ASSERT(image->data);
-    ASSERT(image->width);
-    ASSERT(image->height);
-
     picWidthInMbs = image->width;
-    data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    flags = GetMbFilteringFlags(pMb);
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    if (flags)
     {
-        flags = GetMbFilteringFlags(pMb);
-
-        if (flags)
+        /* GetBoundaryStrengths function returns non-zero value if any of
+         * the bS values for the macroblock being processed was non-zero */
+        if (GetBoundaryStrengths(pMb, bS, flags))
         {
-            /* GetBoundaryStrengths function returns non-zero value if any of
-             * the bS values for the macroblock being processed was non-zero */
-            if (GetBoundaryStrengths(pMb, bS, flags))
-            {
 
-                /* Luma */
-                GetLumaEdgeThresholds(pMb,alpha,beta,thresholdLuma,bS,flags);
-                data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
-
-                res = omxVCM4P10_FilterDeblockingLuma_VerEdge_I( data,
-                                                (OMX_S32)(picWidthInMbs*16),
-                                                (const OMX_U8*)alpha,
-                                                (const OMX_U8*)beta,
-                                                (const OMX_U8*)thresholdLuma,
-                                                (const OMX_U8*)bS );
-
-                res = omxVCM4P10_FilterDeblockingLuma_HorEdge_I( data,
-                                                (OMX_S32)(picWidthInMbs*16),
-                                                (const OMX_U8*)alpha+2,
-                                                (const OMX_U8*)beta+2,
-                                                (const OMX_U8*)thresholdLuma+16,
-                                                (const OMX_U8*)bS+16 );
-                /* Cb */
-                GetChromaEdgeThresholds(pMb, alpha, beta, thresholdChroma,
-                                        bS, flags, pMb->chromaQpIndexOffset);
-                data = image->data + picSizeInMbs * 256 +
-                    mbRow * picWidthInMbs * 64 + mbCol * 8;
-
-                res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha,
-                                              (const OMX_U8*)beta,
-                                              (const OMX_U8*)thresholdChroma,
-                                              (const OMX_U8*)bS );
-                res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha+2,
-                                              (const OMX_U8*)beta+2,
-                                              (const OMX_U8*)thresholdChroma+8,
-                                              (const OMX_U8*)bS+16 );
-                /* Cr */
-                data += (picSizeInMbs * 64);
-                res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha,
-                                              (const OMX_U8*)beta,
-                                              (const OMX_U8*)thresholdChroma,
-                                              (const OMX_U8*)bS );
-                res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha+2,
-                                              (const OMX_U8*)beta+2,
-                                              (const OMX_U8*)thresholdChroma+8,
-                                              (const OMX_U8*)bS+16 );
-            }
-        }
-
-        mbCol++;
-        if (mbCol == picWidthInMbs)
-        {
-            mbCol = 0;
-            mbRow++;
+            /* Luma */
+            GetLumaEdgeThresholds(pMb,alpha,beta,thresholdLuma,bS,flags);
+            data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
+
+            res = omxVCM4P10_FilterDeblockingLuma_VerEdge_I( data,
+                                            (OMX_S32)(picWidthInMbs*16),
+                                            (const OMX_U8*)alpha,
+                                            (const OMX_U8*)beta,
+                                            (const OMX_U8*)thresholdLuma,
+                                            (const OMX_U8*)bS );
+
+            res = omxVCM4P10_FilterDeblockingLuma_HorEdge_I( data,
+                                            (OMX_S32)(picWidthInMbs*16),
+                                            (const OMX_U8*)alpha+2,
+                                            (const OMX_U8*)beta+2,
+                                            (const OMX_U8*)thresholdLuma+16,
+                                            (const OMX_U8*)bS+16 );
+            /* Cb */
+            GetChromaEdgeThresholds(pMb, alpha, beta, thresholdChroma,
+                                    bS, flags, pMb->chromaQpIndexOffset);
+            data = image->data + picSizeInMbs * 256 +
+                mbRow * picWidthInMbs * 64 + mbCol * 8;
+
+            res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha,
+                                          (const OMX_U8*)beta,
+                                          (const OMX_U8*)thresholdChroma,
+                                          (const OMX_U8*)bS );
+            res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha+2,
+                                          (const OMX_U8*)beta+2,
+                                          (const OMX_U8*)thresholdChroma+8,
+                                          (const OMX_U8*)bS+16 );
+            /* Cr */
+            data += (picSizeInMbs * 64);
+            res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha,
+                                          (const OMX_U8*)beta,
+                                          (const OMX_U8*)thresholdChroma,
+                                          (const OMX_U8*)bS );
+            res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha+2,
+                                          (const OMX_U8*)beta+2,
+                                          (const OMX_U8*)thresholdChroma+8,
+                                          (const OMX_U8*)bS+16 );
         }
     }
 
@@ -2413,5 +2419,308 @@ void GetChromaEdgeThresholds(
 
 #endif /* H264DEC_OMXDL */
 
-/*lint +e701 +e702 */
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterPicture
+
+        Functional description:
+          Perform deblocking filtering for a picture. Filter does not copy
+          the original picture anywhere but filtering is performed directly
+          on the original image. If worker threads are available, macroblock
+          rows are filtered in parallel, otherwise the picture is filtered
+          in raster scan order by the calling thread.
+
+        Inputs:
+          image         pointer to image to be filtered
+          mb            pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+          deblocker     worker threads, NULL to filter in the calling thread
+
+        Outputs:
+          image         filtered image stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+void h264bsdFilterPicture(
+  image_t *image,
+  mbStorage_t *mb,
+  deblocker_t *deblocker)
+{
+
+/* Variables */
+
+    u32 mbRow, mbCol;
+    mbStorage_t *pMb;
+
+/* Code */
+
+    ASSERT(image);
+    ASSERT(mb);
+    ASSERT(image->data);
+    ASSERT(image->width);
+    ASSERT(image->height);
+
+    if (deblocker && image->height > 1)
+    {
+        pthread_mutex_lock(&deblocker->lock);
+        if (deblocker->rowProgressSize < image->height)
+        {
+            FREE(deblocker->rowProgress);
+            ALLOCATE(deblocker->rowProgress, image->height, u32);
+            deblocker->rowProgressSize =
+                deblocker->rowProgress ? image->height : 0;
+        }
+        if (deblocker->rowProgress)
+        {
+            H264SwDecMemset(deblocker->rowProgress, 0,
+                image->height * sizeof(u32));
+            deblocker->image = image;
+            deblocker->mb = mb;
+            deblocker->nextRow = 0;
+            deblocker->rowsDone = 0;
+            deblocker->pictureId++;
+            pthread_cond_broadcast(&deblocker->cond);
+            pthread_mutex_unlock(&deblocker->lock);
+
+            FilterRows(deblocker);
+
+            pthread_mutex_lock(&deblocker->lock);
+            while (deblocker->rowsDone < image->height)
+            {
+                deblocker->numWaiting++;
+                pthread_cond_wait(&deblocker->cond, &deblocker->lock);
+                deblocker->numWaiting--;
+            }
+            pthread_mutex_unlock(&deblocker->lock);
+            return;
+        }
+        pthread_mutex_unlock(&deblocker->lock);
+    }
+
+    pMb = mb;
+
+    for (mbRow = 0; mbRow < image->height; mbRow++)
+    {
+        for (mbCol = 0; mbCol < image->width; mbCol++, pMb++)
+        {
+            FilterMacroblock(image, pMb, mbRow, mbCol);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterRows
+
+        Functional description:
+          Claim macroblock rows of the current picture and filter them until
+          all rows have been claimed. Each macroblock waits until the
+          macroblock above and to the right of it has been filtered.
+
+        Inputs:
+          deblocker     worker thread state
 
+        Outputs:
+          none
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+void FilterRows(deblocker_t *deblocker)
+{
+
+/* Variables */
+
+    u32 mbRow, mbCol;
+    u32 picWidthInMbs, picHeightInMbs;
+    u32 needed;
+    image_t *image;
+    mbStorage_t *pMb;
+
+/* Code */
+
+    pthread_mutex_lock(&deblocker->lock);
+
+    image = deblocker->image;
+    picWidthInMbs = image ? image->width : 0;
+    picHeightInMbs = image ? image->height : 0;
+
+    while (deblocker->nextRow < picHeightInMbs)
+    {
+        mbRow = deblocker->nextRow++;
+        pMb = deblocker->mb + mbRow * picWidthInMbs;
+
+        for (mbCol = 0; mbCol < picWidthInMbs; mbCol++, pMb++)
+        {
+            if (mbRow)
+            {
+                needed = MIN(mbCol + 2, picWidthInMbs);
+                while (deblocker->rowProgress[mbRow - 1] < needed)
+                {
+                    deblocker->numWaiting++;
+                    pthread_cond_wait(&deblocker->cond, &deblocker->lock);
+                    deblocker->numWaiting--;
+                }
+            }
+            pthread_mutex_unlock(&deblocker->lock);
+
+            FilterMacroblock(image, pMb, mbRow, mbCol);
+
+            pthread_mutex_lock(&deblocker->lock);
+            deblocker->rowProgress[mbRow] = mbCol + 1;
+            if (mbCol + 1 == picWidthInMbs)
+                deblocker->rowsDone++;
+            if (deblocker->numWaiting)
+                pthread_cond_broadcast(&deblocker->cond);
+        }
+    }
+
+    pthread_mutex_unlock(&deblocker->lock);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: DeblockerThread
+
+        Functional description:
+          Worker thread main loop, takes part in filtering of every picture
+          until h264bsdShutdownDeblocker is called.
+
+------------------------------------------------------------------------------*/
+void *DeblockerThread(void *arg)
+{
+
+/* Variables */
+
+    deblocker_t *deblocker = (deblocker_t *)arg;
+    u32 pictureId = 0;
+
+/* Code */
+
+    pthread_mutex_lock(&deblocker->lock);
+    for (;;)
+    {
+        while (!deblocker->exit && deblocker->pictureId == pictureId)
+        {
+            deblocker->numWaiting++;
+            pthread_cond_wait(&deblocker->cond, &deblocker->lock);
+            deblocker->numWaiting--;
+        }
+        if (deblocker->exit)
+            break;
+        pictureId = deblocker->pictureId;
+        pthread_mutex_unlock(&deblocker->lock);
+
+        FilterRows(deblocker);
+
+        pthread_mutex_lock(&deblocker->lock);
+    }
+    pthread_mutex_unlock(&deblocker->lock);
+
+    return NULL;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInitDeblocker
+
+        Functional description:
+          Start worker threads for deblocking filtering.
+
+        Inputs:
+          numThreads    total number of threads filtering a picture, including
+                        the decoding thread; limited to MAX_DEBLOCKING_THREADS
+
+        Returns:
+          pointer to worker thread state, NULL if numThreads is less than two
+          or no thread could be started
+
+------------------------------------------------------------------------------*/
+deblocker_t *h264bsdInitDeblocker(u32 numThreads)
+{
+
+/* Variables */
+
+    u32 i;
+    deblocker_t *deblocker;
+
+/* Code */
+
+    if (numThreads > MAX_DEBLOCKING_THREADS)
+        numThreads = MAX_DEBLOCKING_THREADS;
+    if (numThreads < 2)
+        return NULL;
+
+    ALLOCATE(deblocker, 1, deblocker_t);
+    if (deblocker == NULL)
+        return NULL;
+    H264SwDecMemset(deblocker, 0, sizeof(deblocker_t));
+
+    pthread_mutex_init(&deblocker->lock, NULL);
+    pthread_cond_init(&deblocker->cond, NULL);
+
+    for (i = 0; i < numThreads - 1; i++)
+    {
+        if (pthread_create(&deblocker->threads[i], NULL, DeblockerThread,
+                deblocker))
+            break;
+        deblocker->numThreads++;
+    }
+
+    if (deblocker->numThreads == 0)
+    {
+        h264bsdShutdownDeblocker(deblocker);
+        return NULL;
+    }
+
+    return deblocker;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdShutdownDeblocker
+
+        Functional description:
+          Stop the worker threads and free all resources. Must not be called
+          while a picture is being filtered.
+
+        Inputs:
+          deblocker     worker thread state, may be NULL
+
+------------------------------------------------------------------------------*/
+void h264bsdShutdownDeblocker(deblocker_t *deblocker)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    if (deblocker == NULL)
+        return;
+
+    pthread_mutex_lock(&deblocker->lock);
+    deblocker->exit = HANTRO_TRUE;
+    pthread_cond_broadcast(&deblocker->cond);
+    pthread_mutex_unlock(&deblocker->lock);
+
+    for (i = 0; i < deblocker->numThreads; i++)
+        pthread_join(deblocker->threads[i], NULL);
+
+    pthread_cond_destroy(&deblocker->cond);
+    pthread_mutex_destroy(&deblocker->lock);
+
+    FREE(deblocker->rowProgress);
+    FREE(deblocker);
+
+}
+
+/*lint +e701 +e702 */
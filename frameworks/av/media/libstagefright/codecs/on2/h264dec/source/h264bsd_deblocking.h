@@ -40,17 +40,29 @@
     2. Module defines
 ------------------------------------------------------------------------------*/
 
+/* maximum number of threads taking part in filtering of one picture,
+ * including the decoding thread */
+#define MAX_DEBLOCKING_THREADS 4
+
 /*------------------------------------------------------------------------------
     3. Data types
 ------------------------------------------------------------------------------*/
 
+/* deblocking worker threads, contents private to h264bsd_deblocking.c */
+typedef struct deblocker deblocker_t;
+
 /*------------------------------------------------------------------------------
     4. Function prototypes
 ------------------------------------------------------------------------------*/
 
 void h264bsdFilterPicture(
   image_t *image,
-  mbStorage_t *mb);
+  mbStorage_t *mb,
+  deblocker_t *deblocker);
+
+deblocker_t *h264bsdInitDeblocker(u32 numThreads);
+
+void h264bsdShutdownDeblocker(deblocker_t *deblocker);
 
 #endif /* #ifdef H264SWDEC_DEBLOCKING_H */
 
@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdInit
+          h264bsdSetNumThreads
           h264bsdDecode
           h264bsdShutdown
           h264bsdCurrentImage
@@ -42,6 +43,8 @@
     1. Include headers
 ------------------------------------------------------------------------------*/
 
+#include <unistd.h>
+
 #include "h264bsd_decoder.h"
 #include "h264bsd_nal_unit.h"
 #include "h264bsd_byte_stream.h"
@@ -108,9 +111,52 @@ u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering)
     if (noOutputReordering)
         pStorage->noReordering = HANTRO_TRUE;
 
+    h264bsdSetNumThreads(pStorage, 0);
+
     return HANTRO_OK;
 }
 
+/*------------------------------------------------------------------------------
+
+    Function name: h264bsdSetNumThreads
+
+        Functional description:
+            Set the number of threads used for deblocking filtering of a
+            picture. Filtering falls back to the decoding thread if worker
+            threads cannot be started.
+
+        Inputs:
+            numThreads          number of threads including the decoding
+                                thread, 0 for one per online CPU
+
+        Outputs:
+            pStorage            deblocker of the storage structure replaced
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdSetNumThreads(storage_t *pStorage, u32 numThreads)
+{
+
+/* Variables */
+    long numCpus;
+
+/* Code */
+
+    ASSERT(pStorage);
+
+    if (numThreads == 0)
+    {
+        numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = numCpus > 0 ? (u32)numCpus : 1;
+    }
+
+    h264bsdShutdownDeblocker(pStorage->deblocker);
+    pStorage->deblocker = h264bsdInitDeblocker(numThreads);
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdDecode
@@ -471,7 +517,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
 
     if (picReady)
     {
-        h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
+        h264bsdFilterPicture(pStorage->currImage, pStorage->mb,
+            pStorage->deblocker);
 
         h264bsdResetStorage(pStorage);
 
@@ -567,6 +614,9 @@ void h264bsdShutdown(storage_t *pStorage)
     FREE(pStorage->mb);
     FREE(pStorage->sliceGroupMap);
 
+    h264bsdShutdownDeblocker(pStorage->deblocker);
+    pStorage->deblocker = NULL;
+
     h264bsdFreeDpb(pStorage->dpb);
 
 }
@@ -58,6 +58,7 @@ enum {
 ------------------------------------------------------------------------------*/
 
 u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering);
+void h264bsdSetNumThreads(storage_t *pStorage, u32 numThreads);
 u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
     u32 *readBytes);
 void h264bsdShutdown(storage_t *pStorage);
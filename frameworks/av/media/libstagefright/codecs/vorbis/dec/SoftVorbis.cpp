@@ -311,93 +311,127 @@ void SoftVorbis::onQueueFilled(OMX_U32 portIndex) {
             return;
         }
 
-        int32_t numPageSamples;
-        CHECK_GE(inHeader->nFilledLen, sizeof(numPageSamples));
-        memcpy(&numPageSamples,
-               inHeader->pBuffer
-                + inHeader->nOffset + inHeader->nFilledLen - 4,
-               sizeof(numPageSamples));
-
-        if (numPageSamples >= 0) {
-            mNumFramesLeftOnPage = numPageSamples;
-        }
-
-        if (inHeader->nOffset == 0) {
-            mAnchorTimeUs = inHeader->nTimeStamp;
-            mNumFramesOutput = 0;
-        }
+        // Decode as many of the queued packets as fit into the output
+        // buffer, so that the client handles fewer and fuller buffers.
+        const int maxFrames = kMaxNumSamplesPerBuffer / mVi->channels;
+        const int maxFramesPerPacket =
+            ((codec_setup_info *)mVi->codec_setup)->blocksizes[1] / 2;
 
-        inHeader->nFilledLen -= sizeof(numPageSamples);;
-
-        ogg_buffer buf;
-        buf.data = inHeader->pBuffer + inHeader->nOffset;
-        buf.size = inHeader->nFilledLen;
-        buf.refcount = 1;
-        buf.ptr.owner = NULL;
+        int16_t *pcm = (int16_t *)outHeader->pBuffer;
+        int numFrames = 0;
 
-        ogg_reference ref;
-        ref.buffer = &buf;
-        ref.begin = 0;
-        ref.length = buf.size;
-        ref.next = NULL;
-
-        ogg_packet pack;
-        pack.packet = &ref;
-        pack.bytes = ref.length;
-        pack.b_o_s = 0;
-        pack.e_o_s = 0;
-        pack.granulepos = 0;
-        pack.packetno = 0;
+        for (;;) {
+            int64_t timeUs;
+            if (numFrames == 0) {
+                numFrames = decodePacket(inHeader, pcm, maxFrames, &timeUs);
+                outHeader->nTimeStamp = timeUs;
+            } else {
+                numFrames += decodePacket(
+                        inHeader, pcm + numFrames * mVi->channels,
+                        maxFrames - numFrames, &timeUs);
+            }
 
-        int numFrames = 0;
+            inInfo->mOwnedByUs = false;
+            inQueue.erase(inQueue.begin());
+            inInfo = NULL;
+            notifyEmptyBufferDone(inHeader);
+            inHeader = NULL;
 
-        int err = vorbis_dsp_synthesis(mState, &pack, 1);
-        if (err != 0) {
-            ALOGW("vorbis_dsp_synthesis returned %d", err);
-        } else {
-            numFrames = vorbis_dsp_pcmout(
-                    mState, (int16_t *)outHeader->pBuffer,
-                    kMaxNumSamplesPerBuffer);
+            ++mInputBufferCount;
 
-            if (numFrames < 0) {
-                ALOGE("vorbis_dsp_pcmout returned %d", numFrames);
-                numFrames = 0;
+            if (inQueue.empty() || maxFrames - numFrames < maxFramesPerPacket) {
+                break;
             }
-        }
 
-        if (mNumFramesLeftOnPage >= 0) {
-            if (numFrames > mNumFramesLeftOnPage) {
-                ALOGV("discarding %d frames at end of page",
-                     numFrames - mNumFramesLeftOnPage);
-                numFrames = mNumFramesLeftOnPage;
+            inInfo = *inQueue.begin();
+            inHeader = inInfo->mHeader;
+
+            if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+                break;
             }
-            mNumFramesLeftOnPage -= numFrames;
         }
 
         outHeader->nFilledLen = numFrames * sizeof(int16_t) * mVi->channels;
         outHeader->nOffset = 0;
         outHeader->nFlags = 0;
 
-        outHeader->nTimeStamp =
-            mAnchorTimeUs
-                + (mNumFramesOutput * 1000000ll) / mVi->rate;
-
-        mNumFramesOutput += numFrames;
-
-        inInfo->mOwnedByUs = false;
-        inQueue.erase(inQueue.begin());
-        inInfo = NULL;
-        notifyEmptyBufferDone(inHeader);
-        inHeader = NULL;
-
         outInfo->mOwnedByUs = false;
         outQueue.erase(outQueue.begin());
         outInfo = NULL;
         notifyFillBufferDone(outHeader);
         outHeader = NULL;
+    }
+}
 
-        ++mInputBufferCount;
+int SoftVorbis::decodePacket(
+        OMX_BUFFERHEADERTYPE *inHeader, int16_t *pcm, int maxFrames,
+        int64_t *timeUs) {
+    int32_t numPageSamples;
+    CHECK_GE(inHeader->nFilledLen, sizeof(numPageSamples));
+    memcpy(&numPageSamples,
+           inHeader->pBuffer
+            + inHeader->nOffset + inHeader->nFilledLen - 4,
+           sizeof(numPageSamples));
+
+    if (numPageSamples >= 0) {
+        mNumFramesLeftOnPage = numPageSamples;
     }
+
+    if (inHeader->nOffset == 0) {
+        mAnchorTimeUs = inHeader->nTimeStamp;
+        mNumFramesOutput = 0;
+    }
+
+    inHeader->nFilledLen -= sizeof(numPageSamples);;
+
+    ogg_buffer buf;
+    buf.data = inHeader->pBuffer + inHeader->nOffset;
+    buf.size = inHeader->nFilledLen;
+    buf.refcount = 1;
+    buf.ptr.owner = NULL;
+
+    ogg_reference ref;
+    ref.buffer = &buf;
+    ref.begin = 0;
+    ref.length = buf.size;
+    ref.next = NULL;
+
+    ogg_packet pack;
+    pack.packet = &ref;
+    pack.bytes = ref.length;
+    pack.b_o_s = 0;
+    pack.e_o_s = 0;
+    pack.granulepos = 0;
+    pack.packetno = 0;
+
+    int numFrames = 0;
+
+    int err = vorbis_dsp_synthesis(mState, &pack, 1);
+    if (err != 0) {
+        ALOGW("vorbis_dsp_synthesis returned %d", err);
+    } else {
+        numFrames = vorbis_dsp_pcmout(mState, pcm, maxFrames);
+
+        if (numFrames < 0) {
+            ALOGE("vorbis_dsp_pcmout returned %d", numFrames);
+            numFrames = 0;
+        }
+    }
+
+    if (mNumFramesLeftOnPage >= 0) {
+        if (numFrames > mNumFramesLeftOnPage) {
+            ALOGV("discarding %d frames at end of page",
+                 numFrames - mNumFramesLeftOnPage);
+            numFrames = mNumFramesLeftOnPage;
+        }
+        mNumFramesLeftOnPage -= numFrames;
+    }
+
+    *timeUs = mAnchorTimeUs + (mNumFramesOutput * 1000000ll) / mVi->rate;
+
+    mNumFramesOutput += numFrames;
+
+    return numFrames;
 }
 
 void SoftVorbis::onPortFlushCompleted(OMX_U32 portIndex) {
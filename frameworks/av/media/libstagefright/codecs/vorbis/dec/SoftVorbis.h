@@ -70,6 +70,12 @@ private:
     status_t initDecoder();
     bool isConfigured() const;
 
+    // Decodes the packet in the input buffer, returns the number of frames
+    // written to pcm and the time of the first one.
+    int decodePacket(
+            OMX_BUFFERHEADERTYPE *inHeader, int16_t *pcm, int maxFrames,
+            int64_t *timeUs);
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftVorbis);
 };
 
@@ -18,26 +18,190 @@
 #define LOG_TAG "ColorConverter"
 #include <utils/Log.h>
 
+#include "ColorConverterRow.h"
+
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/ColorConverter.h>
 #include <media/stagefright/MediaErrors.h>
 
+#include <pthread.h>
+#include <unistd.h>
+
 namespace android {
 
+// Frames smaller than this are converted on the calling thread only.
+static const size_t kMinPixelsPerThreadedFrame = 640 * 480;
+static const size_t kMaxNumThreads = 4;
+
+// Where to find the source rows of a frame and where to put the result.
+struct ColorConverter::Frame {
+    // Row 0 of the cropped source, chroma row i / 2^mCRowShift goes with
+    // luma row i.
+    YUVRow mRow;
+    size_t mYStride;
+    size_t mCStride;
+    size_t mCRowShift;
+
+    uint8_t *mDst;
+    size_t mDstStride;
+    RowOutput mOutput;
+
+    size_t mWidth;
+    size_t mHeight;
+
+    const uint8_t *mClip;
+    bool mUseNeon;
+};
+
+// Workers that convert bands of rows of a frame alongside the caller.
+struct ColorConverter::ThreadPool {
+    ThreadPool(size_t numThreads);
+    ~ThreadPool();
+
+    size_t numThreads() const;
+
+    // Converts "frame" in "numBands" bands of rows, returns once all of them
+    // are done.
+    void convert(const Frame &frame, size_t numBands);
+
+private:
+    pthread_mutex_t mLock;
+    pthread_cond_t mWorkCond;
+    pthread_cond_t mDoneCond;
+
+    pthread_t *mThreads;
+    size_t mNumThreads;
+    bool mExit;
+
+    const Frame *mFrame;
+    size_t mNumBands;
+    size_t mNextBand;
+    size_t mNumBandsPending;
+
+    static void *ThreadWrapper(void *me);
+    void threadEntry();
+
+    // Takes the next band, if any, converts it and returns true.
+    bool convertNextBand_l();
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+};
+
+static void ConvertRowC(
+        const YUVRow &row, size_t x, size_t width,
+        const uint8_t *kAdjustedClip, RowOutput output, uint8_t *dst) {
+    for (; x < width; x += 2) {
+        // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
+        // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
+        // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
+
+        // B = 298/256 * (Y - 16) + 517/256 * (U - 128)
+        // G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
+        // R = .................. + 409/256 * (V - 128)
+
+        // min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
+        // min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
+        // min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
+
+        // max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
+        // max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
+        // max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
+
+        // clip range -278 .. 535
+
+        signed y1 = (signed)row.mY[x * row.mYStep] - 16;
+        signed y2 = (signed)row.mY[(x + 1) * row.mYStep] - 16;
+
+        signed u = (signed)row.mU[x / 2 * row.mCStep] - 128;
+        signed v = (signed)row.mV[x / 2 * row.mCStep] - 128;
+
+        signed u_b = u * 517;
+        signed u_g = -u * 100;
+        signed v_g = -v * 208;
+        signed v_r = v * 409;
+
+        signed tmp1 = y1 * 298;
+        signed b1 = (tmp1 + u_b) / 256;
+        signed g1 = (tmp1 + v_g + u_g) / 256;
+        signed r1 = (tmp1 + v_r) / 256;
+
+        signed tmp2 = y2 * 298;
+        signed b2 = (tmp2 + u_b) / 256;
+        signed g2 = (tmp2 + v_g + u_g) / 256;
+        signed r2 = (tmp2 + v_r) / 256;
+
+        if (output == ROW_OUTPUT_BGR565 || output == ROW_OUTPUT_BGRA8888) {
+            signed tmp = r1;
+            r1 = b1;
+            b1 = tmp;
+
+            tmp = r2;
+            r2 = b2;
+            b2 = tmp;
+        }
+
+        bool haveSecond = (x + 1 < width);
+
+        if (output == ROW_OUTPUT_RGB565 || output == ROW_OUTPUT_BGR565) {
+            uint16_t *dst_ptr = (uint16_t *)dst;
+
+            uint32_t rgb1 =
+                ((kAdjustedClip[r1] >> 3) << 11)
+                | ((kAdjustedClip[g1] >> 2) << 5)
+                | (kAdjustedClip[b1] >> 3);
+
+            uint32_t rgb2 =
+                ((kAdjustedClip[r2] >> 3) << 11)
+                | ((kAdjustedClip[g2] >> 2) << 5)
+                | (kAdjustedClip[b2] >> 3);
+
+            if (haveSecond) {
+                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
+            } else {
+                dst_ptr[x] = rgb1;
+            }
+        } else {
+            uint8_t *dst_ptr = dst + x * 4;
+
+            dst_ptr[0] = kAdjustedClip[r1];
+            dst_ptr[1] = kAdjustedClip[g1];
+            dst_ptr[2] = kAdjustedClip[b1];
+            dst_ptr[3] = 0xff;
+
+            if (haveSecond) {
+                dst_ptr[4] = kAdjustedClip[r2];
+                dst_ptr[5] = kAdjustedClip[g2];
+                dst_ptr[6] = kAdjustedClip[b2];
+                dst_ptr[7] = 0xff;
+            }
+        }
+    }
+}
+
 ColorConverter::ColorConverter(
         OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to)
     : mSrcFormat(from),
       mDstFormat(to),
-      mClip(NULL) {
+      mClip(NULL),
+      mUseNeon(false),
+      mThreadPool(NULL) {
+#ifdef COLOR_CONVERTER_NEON
+    mUseNeon = ColorConverterCpuHasNeon();
+#endif
 }
 
 ColorConverter::~ColorConverter() {
+    delete mThreadPool;
+    mThreadPool = NULL;
+
     delete[] mClip;
     mClip = NULL;
 }
 
 bool ColorConverter::isValid() const {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+    if (mDstFormat != OMX_COLOR_Format16bitRGB565
+            && mDstFormat != OMX_COLOR_Format32BitRGBA8888) {
         return false;
     }
 
@@ -85,7 +249,7 @@ status_t ColorConverter::convert(
         size_t dstWidth, size_t dstHeight,
         size_t dstCropLeft, size_t dstCropTop,
         size_t dstCropRight, size_t dstCropBottom) {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+    if (!isValid()) {
         return ERROR_UNSUPPORTED;
     }
 
@@ -132,67 +296,106 @@ status_t ColorConverter::convert(
     return err;
 }
 
-status_t ColorConverter::convertCbYCrY(
-        const BitmapParams &src, const BitmapParams &dst) {
-    // XXX Untested
+size_t ColorConverter::bytesPerDstPixel() const {
+    return mDstFormat == OMX_COLOR_Format32BitRGBA8888 ? 4 : 2;
+}
 
-    uint8_t *kAdjustedClip = initClip();
+void ColorConverter::initFrame(
+        const BitmapParams &dst, bool swapRB, Frame *frame) {
+    size_t bpp = bytesPerDstPixel();
 
-    if (!((src.mCropLeft & 1) == 0
-        && src.cropWidth() == dst.cropWidth()
-        && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
+    frame->mDst = (uint8_t *)dst.mBits
+        + (dst.mCropTop * dst.mWidth + dst.mCropLeft) * bpp;
+    frame->mDstStride = dst.mWidth * bpp;
+
+    if (mDstFormat == OMX_COLOR_Format32BitRGBA8888) {
+        frame->mOutput = swapRB ? ROW_OUTPUT_BGRA8888 : ROW_OUTPUT_RGBA8888;
+    } else {
+        frame->mOutput = swapRB ? ROW_OUTPUT_BGR565 : ROW_OUTPUT_RGB565;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+    frame->mWidth = dst.cropWidth();
+    frame->mHeight = dst.cropHeight();
 
-    const uint8_t *src_ptr = (const uint8_t *)src.mBits
-        + (src.mCropTop * dst.mWidth + src.mCropLeft) * 2;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_ptr[2 * x + 1] - 16;
-            signed y2 = (signed)src_ptr[2 * x + 3] - 16;
-            signed u = (signed)src_ptr[2 * x] - 128;
-            signed v = (signed)src_ptr[2 * x + 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
+    frame->mClip = initClip();
+    frame->mUseNeon = mUseNeon;
+}
 
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
+// static
+void ColorConverter::ConvertRows(
+        const Frame &frame, size_t firstRow, size_t endRow) {
+    for (size_t y = firstRow; y < endRow; ++y) {
+        size_t cOffset = (y >> frame.mCRowShift) * frame.mCStride;
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
+        YUVRow row = frame.mRow;
+        row.mY += y * frame.mYStride;
+        row.mU += cOffset;
+        row.mV += cOffset;
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
+        uint8_t *dst = frame.mDst + y * frame.mDstStride;
+
+        size_t x = 0;
+#ifdef COLOR_CONVERTER_NEON
+        if (frame.mUseNeon) {
+            x = ConvertYUVRowNEON(row, dst, frame.mWidth, frame.mOutput);
+        }
+#endif
+
+        ConvertRowC(row, x, frame.mWidth, frame.mClip, frame.mOutput, dst);
+    }
+}
+
+void ColorConverter::convertFrame(const Frame &frame) {
+    if (frame.mWidth * frame.mHeight < kMinPixelsPerThreadedFrame) {
+        ConvertRows(frame, 0, frame.mHeight);
+        return;
+    }
+
+    if (mThreadPool == NULL) {
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        size_t numThreads = (numCpus > 1) ? (size_t)numCpus : 1;
+        if (numThreads > kMaxNumThreads) {
+            numThreads = kMaxNumThreads;
         }
 
-        src_ptr += src.mWidth * 2;
-        dst_ptr += dst.mWidth;
+        // The calling thread converts bands as well.
+        mThreadPool = new ThreadPool(numThreads - 1);
     }
 
+    if (mThreadPool->numThreads() == 0) {
+        ConvertRows(frame, 0, frame.mHeight);
+        return;
+    }
+
+    // A few more bands than threads evens out the load if one of them
+    // gets scheduled late.
+    mThreadPool->convert(frame, (mThreadPool->numThreads() + 1) * 2);
+}
+
+status_t ColorConverter::convertCbYCrY(
+        const BitmapParams &src, const BitmapParams &dst) {
+    if (!((src.mCropLeft & 1) == 0
+        && src.cropWidth() == dst.cropWidth()
+        && src.cropHeight() == dst.cropHeight())) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    const uint8_t *src_ptr = (const uint8_t *)src.mBits
+        + (src.mCropTop * src.mWidth + src.mCropLeft) * 2;
+
+    Frame frame;
+    frame.mRow.mY = src_ptr + 1;
+    frame.mRow.mYStep = 2;
+    frame.mRow.mU = src_ptr;
+    frame.mRow.mV = src_ptr + 2;
+    frame.mRow.mCStep = 4;
+    frame.mYStride = src.mWidth * 2;
+    frame.mCStride = src.mWidth * 2;
+    frame.mCRowShift = 0;
+
+    initFrame(dst, false /* swapRB */, &frame);
+    convertFrame(frame);
+
     return OK;
 }
 
@@ -204,11 +407,6 @@ status_t ColorConverter::convertYUV420Planar(
         return ERROR_UNSUPPORTED;
     }
 
-    uint8_t *kAdjustedClip = initClip();
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
     const uint8_t *src_y =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
@@ -219,90 +417,30 @@ status_t ColorConverter::convertYUV420Planar(
     const uint8_t *src_v =
         src_u + (src.mWidth / 2) * (src.mHeight / 2);
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
-            // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
-            // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
-
-            // B = 298/256 * (Y - 16) + 517/256 * (U - 128)
-            // G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
-            // R = .................. + 409/256 * (V - 128)
-
-            // min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
-            // min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
-            // min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
-
-            // max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
-            // max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
-            // max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
-
-            // clip range -278 .. 535
-
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x / 2] - 128;
-            signed v = (signed)src_v[x / 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
+    Frame frame;
+    frame.mRow.mY = src_y;
+    frame.mRow.mYStep = 1;
+    frame.mRow.mU = src_u;
+    frame.mRow.mV = src_v;
+    frame.mRow.mCStep = 1;
+    frame.mYStride = src.mWidth;
+    frame.mCStride = src.mWidth / 2;
+    frame.mCRowShift = 1;
 
-        if (y & 1) {
-            src_u += src.mWidth / 2;
-            src_v += src.mWidth / 2;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    initFrame(dst, false /* swapRB */, &frame);
+    convertFrame(frame);
 
     return OK;
 }
 
 status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
-
     if (!((src.mCropLeft & 1) == 0
             && src.cropWidth() == dst.cropWidth()
             && src.cropHeight() == dst.cropHeight())) {
         return ERROR_UNSUPPORTED;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
     const uint8_t *src_y =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
@@ -310,73 +448,31 @@ status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         (const uint8_t *)src_y + src.mWidth * src.mHeight
         + src.mCropTop * src.mWidth + src.mCropLeft;
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    Frame frame;
+    frame.mRow.mY = src_y;
+    frame.mRow.mYStep = 1;
+    frame.mRow.mU = src_u;
+    frame.mRow.mV = src_u + 1;
+    frame.mRow.mCStep = 2;
+    frame.mYStride = src.mWidth;
+    frame.mCStride = src.mWidth;
+    frame.mCRowShift = 1;
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    // This one has always been written with red and blue swapped.
+    initFrame(dst, true /* swapRB */, &frame);
+    convertFrame(frame);
 
     return OK;
 }
 
 status_t ColorConverter::convertYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    // XXX Untested
-
-    uint8_t *kAdjustedClip = initClip();
-
     if (!((src.mCropLeft & 1) == 0
             && src.cropWidth() == dst.cropWidth()
             && src.cropHeight() == dst.cropHeight())) {
         return ERROR_UNSUPPORTED;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
     const uint8_t *src_y =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
@@ -384,126 +480,181 @@ status_t ColorConverter::convertYUV420SemiPlanar(
         (const uint8_t *)src_y + src.mWidth * src.mHeight
         + src.mCropTop * src.mWidth + src.mCropLeft;
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+    // Chroma is stored as V, U pairs.
+    Frame frame;
+    frame.mRow.mY = src_y;
+    frame.mRow.mYStep = 1;
+    frame.mRow.mU = src_u + 1;
+    frame.mRow.mV = src_u;
+    frame.mRow.mCStep = 2;
+    frame.mYStride = src.mWidth;
+    frame.mCStride = src.mWidth;
+    frame.mCRowShift = 1;
 
-            signed v = (signed)src_u[x & ~1] - 128;
-            signed u = (signed)src_u[(x & ~1) + 1] - 128;
+    initFrame(dst, true /* swapRB */, &frame);
+    convertFrame(frame);
 
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    return OK;
+}
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
+status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
+        const BitmapParams &src, const BitmapParams &dst) {
+    if (!((src.mCropLeft & 1) == 0
+            && src.cropWidth() == dst.cropWidth()
+            && src.cropHeight() == dst.cropHeight())) {
+        return ERROR_UNSUPPORTED;
+    }
 
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
+    const uint8_t *src_y = (const uint8_t *)src.mBits;
 
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
+    const uint8_t *src_u =
+        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
+    Frame frame;
+    frame.mRow.mY = src_y;
+    frame.mRow.mYStep = 1;
+    frame.mRow.mU = src_u;
+    frame.mRow.mV = src_u + 1;
+    frame.mRow.mCStep = 2;
+    frame.mYStride = src.mWidth;
+    frame.mCStride = src.mWidth;
+    frame.mCRowShift = 1;
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
+    initFrame(dst, false /* swapRB */, &frame);
+    convertFrame(frame);
+
+    return OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ColorConverter::ThreadPool::ThreadPool(size_t numThreads)
+    : mThreads(NULL),
+      mNumThreads(0),
+      mExit(false),
+      mFrame(NULL),
+      mNumBands(0),
+      mNextBand(0),
+      mNumBandsPending(0) {
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mWorkCond, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+
+    if (numThreads == 0) {
+        return;
+    }
 
-        src_y += src.mWidth;
+    mThreads = new pthread_t[numThreads];
 
-        if (y & 1) {
-            src_u += src.mWidth;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    for (size_t i = 0; i < numThreads; ++i) {
+        if (pthread_create(&mThreads[mNumThreads], &attr, ThreadWrapper, this)) {
+            ALOGW("Unable to start color conversion thread, using %d",
+                  (int)mNumThreads);
+            break;
         }
+        ++mNumThreads;
+    }
 
-        dst_ptr += dst.mWidth;
+    pthread_attr_destroy(&attr);
+}
+
+ColorConverter::ThreadPool::~ThreadPool() {
+    pthread_mutex_lock(&mLock);
+    mExit = true;
+    pthread_cond_broadcast(&mWorkCond);
+    pthread_mutex_unlock(&mLock);
+
+    for (size_t i = 0; i < mNumThreads; ++i) {
+        pthread_join(mThreads[i], NULL);
     }
 
-    return OK;
+    delete[] mThreads;
+    mThreads = NULL;
+
+    pthread_cond_destroy(&mDoneCond);
+    pthread_cond_destroy(&mWorkCond);
+    pthread_mutex_destroy(&mLock);
 }
 
-status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
-        const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
+size_t ColorConverter::ThreadPool::numThreads() const {
+    return mNumThreads;
+}
 
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
+void ColorConverter::ThreadPool::convert(const Frame &frame, size_t numBands) {
+    pthread_mutex_lock(&mLock);
+
+    mFrame = &frame;
+    mNumBands = numBands;
+    mNextBand = 0;
+    mNumBandsPending = numBands;
+
+    pthread_cond_broadcast(&mWorkCond);
+
+    while (convertNextBand_l()) {
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+    while (mNumBandsPending > 0) {
+        pthread_cond_wait(&mDoneCond, &mLock);
+    }
 
-    const uint8_t *src_y = (const uint8_t *)src.mBits;
+    mFrame = NULL;
 
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
+    pthread_mutex_unlock(&mLock);
+}
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+bool ColorConverter::ThreadPool::convertNextBand_l() {
+    if (mFrame == NULL || mNextBand == mNumBands) {
+        return false;
+    }
 
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
+    const Frame *frame = mFrame;
+    size_t band = mNextBand++;
 
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    // Bands start on even rows so that no two of them share a chroma row
+    // of 4:2:0 input, which keeps the work per band even.
+    size_t rowsPerBand = ((frame->mHeight + mNumBands - 1) / mNumBands + 1) & ~1;
+    size_t firstRow = band * rowsPerBand;
+    size_t endRow = firstRow + rowsPerBand;
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
+    if (firstRow > frame->mHeight) {
+        firstRow = frame->mHeight;
+    }
+    if (endRow > frame->mHeight) {
+        endRow = frame->mHeight;
+    }
 
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
+    pthread_mutex_unlock(&mLock);
+    ConvertRows(*frame, firstRow, endRow);
+    pthread_mutex_lock(&mLock);
 
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
+    if (--mNumBandsPending == 0) {
+        pthread_cond_signal(&mDoneCond);
+    }
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
+    return true;
+}
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
+// static
+void *ColorConverter::ThreadPool::ThreadWrapper(void *me) {
+    static_cast<ThreadPool *>(me)->threadEntry();
+
+    return NULL;
+}
 
-        src_y += src.mWidth;
+void ColorConverter::ThreadPool::threadEntry() {
+    pthread_mutex_lock(&mLock);
 
-        if (y & 1) {
-            src_u += src.mWidth;
+    while (!mExit) {
+        if (!convertNextBand_l()) {
+            pthread_cond_wait(&mWorkCond, &mLock);
         }
-
-        dst_ptr += dst.mWidth;
     }
 
-    return OK;
+    pthread_mutex_unlock(&mLock);
 }
 
 uint8_t *ColorConverter::initClip() {
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ColorConverterRow.h"
+
+#include <arm_neon.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef AT_HWCAP
+#define AT_HWCAP    16
+#endif
+#ifndef HWCAP_NEON
+#define HWCAP_NEON  (1 << 12)
+#endif
+
+namespace android {
+
+// The chroma contributions for 8 pixel pairs, see ColorConverter.cpp for the
+// coefficients. Products are kept in 32 bits so that the results match the C
+// code exactly.
+struct ChromaTerms {
+    int32x4_t mB[2];
+    int32x4_t mG[2];
+    int32x4_t mR[2];
+};
+
+static inline void ComputeChromaTerms(
+        uint8x8_t u8, uint8x8_t v8, ChromaTerms *terms) {
+    int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(u8, vdup_n_u8(128)));
+    int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(v8, vdup_n_u8(128)));
+
+    int16x4_t uh[2] = { vget_low_s16(u), vget_high_s16(u) };
+    int16x4_t vh[2] = { vget_low_s16(v), vget_high_s16(v) };
+
+    for (int i = 0; i < 2; ++i) {
+        terms->mB[i] = vmull_n_s16(uh[i], 517);
+        terms->mG[i] = vmlal_n_s16(vmull_n_s16(uh[i], -100), vh[i], -208);
+        terms->mR[i] = vmull_n_s16(vh[i], 409);
+    }
+}
+
+// An arithmetic shift instead of the C code's division only differs for
+// negative values, which clip to 0 either way.
+static inline uint8x8_t Clip(int32x4_t lo, int32x4_t hi) {
+    return vqmovun_s16(vcombine_s16(vshrn_n_s32(lo, 8), vshrn_n_s32(hi, 8)));
+}
+
+static inline void ComputeRGB(
+        uint8x8_t y8, const ChromaTerms &terms,
+        uint8x8_t *r, uint8x8_t *g, uint8x8_t *b) {
+    int16x8_t y = vreinterpretq_s16_u16(vsubl_u8(y8, vdup_n_u8(16)));
+
+    int32x4_t t[2] = {
+        vmull_n_s16(vget_low_s16(y), 298),
+        vmull_n_s16(vget_high_s16(y), 298),
+    };
+
+    *b = Clip(vaddq_s32(t[0], terms.mB[0]), vaddq_s32(t[1], terms.mB[1]));
+    *g = Clip(vaddq_s32(t[0], terms.mG[0]), vaddq_s32(t[1], terms.mG[1]));
+    *r = Clip(vaddq_s32(t[0], terms.mR[0]), vaddq_s32(t[1], terms.mR[1]));
+}
+
+static inline uint16x8_t PackRGB565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t rgb = vshll_n_u8(r, 8);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(b, 8), 11);
+    return rgb;
+}
+
+size_t ConvertYUVRowNEON(
+        const YUVRow &row, uint8_t *dst, size_t width, RowOutput output) {
+    bool packed = (row.mYStep == 2);
+    bool swapRB =
+        (output == ROW_OUTPUT_BGR565 || output == ROW_OUTPUT_BGRA8888);
+
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x8_t yEven, yOdd, u, v;
+
+        if (packed) {
+            uint8x8x4_t uyvy = vld4_u8(row.mU + x * 2);
+            u = uyvy.val[0];
+            yEven = uyvy.val[1];
+            v = uyvy.val[2];
+            yOdd = uyvy.val[3];
+        } else {
+            uint8x8x2_t y = vld2_u8(row.mY + x);
+            yEven = y.val[0];
+            yOdd = y.val[1];
+
+            if (row.mCStep == 1) {
+                u = vld1_u8(row.mU + x / 2);
+                v = vld1_u8(row.mV + x / 2);
+            } else if (row.mU < row.mV) {
+                uint8x8x2_t uv = vld2_u8(row.mU + x);
+                u = uv.val[0];
+                v = uv.val[1];
+            } else {
+                uint8x8x2_t vu = vld2_u8(row.mV + x);
+                v = vu.val[0];
+                u = vu.val[1];
+            }
+        }
+
+        ChromaTerms terms;
+        ComputeChromaTerms(u, v, &terms);
+
+        uint8x8_t rEven, gEven, bEven, rOdd, gOdd, bOdd;
+        ComputeRGB(yEven, terms, &rEven, &gEven, &bEven);
+        ComputeRGB(yOdd, terms, &rOdd, &gOdd, &bOdd);
+
+        uint8x8x2_t r = vzip_u8(rEven, rOdd);
+        uint8x8x2_t g = vzip_u8(gEven, gOdd);
+        uint8x8x2_t b = vzip_u8(bEven, bOdd);
+
+        if (swapRB) {
+            uint8x8x2_t tmp = r;
+            r = b;
+            b = tmp;
+        }
+
+        if (output == ROW_OUTPUT_RGB565 || output == ROW_OUTPUT_BGR565) {
+            uint16_t *out = (uint16_t *)dst + x;
+            vst1q_u16(out, PackRGB565(r.val[0], g.val[0], b.val[0]));
+            vst1q_u16(out + 8, PackRGB565(r.val[1], g.val[1], b.val[1]));
+        } else {
+            uint8_t *out = dst + x * 4;
+            uint8x8_t alpha = vdup_n_u8(0xff);
+
+            for (int i = 0; i < 2; ++i) {
+                uint8x8x4_t rgba;
+                rgba.val[0] = r.val[i];
+                rgba.val[1] = g.val[i];
+                rgba.val[2] = b.val[i];
+                rgba.val[3] = alpha;
+                vst4_u8(out + i * 32, rgba);
+            }
+        }
+    }
+
+    return x;
+}
+
+// bionic has no getauxval(); read the aux vector directly
+bool ColorConverterCpuHasNeon() {
+    unsigned long entry[2];
+    bool neon = false;
+    int fd = open("/proc/self/auxv", O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    while (read(fd, entry, sizeof(entry)) == (ssize_t)sizeof(entry)) {
+        if (entry[0] == AT_HWCAP) {
+            neon = (entry[1] & HWCAP_NEON) != 0;
+            break;
+        }
+        if (entry[0] == 0) {
+            break;
+        }
+    }
+    close(fd);
+
+    return neon;
+}
+
+}  // namespace android
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COLOR_CONVERTER_ROW_H_
+
+#define COLOR_CONVERTER_ROW_H_
+
+#include <sys/types.h>
+
+#include <stdint.h>
+
+namespace android {
+
+// One row of YUV input with horizontally subsampled chroma, as seen by the
+// row kernels: luma sample x is at mY[x * mYStep], the chroma samples for
+// pixels x and x + 1 (x even) are at mU[x / 2 * mCStep] and
+// mV[x / 2 * mCStep].
+struct YUVRow {
+    const uint8_t *mY;
+    size_t mYStep;
+    const uint8_t *mU;
+    const uint8_t *mV;
+    size_t mCStep;
+};
+
+enum RowOutput {
+    ROW_OUTPUT_RGB565,
+    ROW_OUTPUT_BGR565,
+    ROW_OUTPUT_RGBA8888,
+    ROW_OUTPUT_BGRA8888,
+};
+
+#ifdef COLOR_CONVERTER_NEON
+bool ColorConverterCpuHasNeon();
+
+// Converts the pixels of "row" in blocks of 16 and returns how many were
+// done, the rest is left to the C code. Only luma steps of 1 (with chroma
+// steps of 1 or 2) and the packed CbYCrY layout (luma step 2, chroma step 4,
+// mY == mU + 1, mV == mU + 2) are handled.
+size_t ConvertYUVRowNEON(
+        const YUVRow &row, uint8_t *dst, size_t width, RowOutput output);
+#endif
+
+}  // namespace android
+
+#endif  // COLOR_CONVERTER_ROW_H_
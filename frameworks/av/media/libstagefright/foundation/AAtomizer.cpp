@@ -14,8 +14,11 @@
  * limitations under the License.
  */
 
+#include <string.h>
 #include <sys/types.h>
 
+#include <cutils/atomic-inline.h> // for android_memory_barrier()
+
 #include "AAtomizer.h"
 
 namespace android {
@@ -32,9 +35,32 @@ AAtomizer::AAtomizer() {
     for (size_t i = 0; i < 128; ++i) {
         mAtoms.push(List<AString>());
     }
+
+    for (size_t i = 0; i < kNumCacheEntries; ++i) {
+        mCache[i] = NULL;
+    }
 }
 
 const char *AAtomizer::atomize(const char *name) {
+    const size_t cacheIndex = CacheIndex(name);
+
+    // Atoms are never freed, and the load of their contents depends on the
+    // load of the pointer, so no barrier is needed on this side.
+    const char *atom = mCache[cacheIndex];
+    if (atom != NULL && (atom == name || !strcmp(atom, name))) {
+        return atom;
+    }
+
+    atom = atomizeLocked(name);
+
+    // Publish the contents of a new atom before its address.
+    android_memory_barrier();
+    mCache[cacheIndex] = atom;
+
+    return atom;
+}
+
+const char *AAtomizer::atomizeLocked(const char *name) {
     Mutex::Autolock autoLock(mLock);
 
     const size_t n = mAtoms.size();
@@ -53,6 +79,12 @@ const char *AAtomizer::atomize(const char *name) {
     return (*--entry.end()).c_str();
 }
 
+// static
+size_t AAtomizer::CacheIndex(const char *name) {
+    uintptr_t x = (uintptr_t)name;
+    return (x ^ (x >> 8) ^ (x >> 16)) % kNumCacheEntries;
+}
+
 // static
 uint32_t AAtomizer::Hash(const char *s) {
     uint32_t sum = 0;
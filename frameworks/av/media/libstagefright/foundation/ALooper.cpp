@@ -67,7 +67,8 @@ int64_t ALooper::GetNowUs() {
 }
 
 ALooper::ALooper()
-    : mRunningLocally(false) {
+    : mNextSeqNo(0),
+      mRunningLocally(false) {
 }
 
 ALooper::~ALooper() {
@@ -168,20 +169,72 @@ void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
         whenUs = GetNowUs();
     }
 
-    List<Event>::iterator it = mEventQueue.begin();
-    while (it != mEventQueue.end() && (*it).mWhenUs <= whenUs) {
-        ++it;
-    }
-
     Event event;
     event.mWhenUs = whenUs;
+    event.mSeqNo = mNextSeqNo++;
     event.mMessage = msg;
 
-    if (it == mEventQueue.begin()) {
+    if (mEventQueue.empty() || whenUs < mEventQueue[0].mWhenUs) {
         mQueueChangedCondition.signal();
     }
 
-    mEventQueue.insert(it, event);
+    pushEvent_l(event);
+}
+
+// static
+bool ALooper::EventBefore(const Event &a, const Event &b) {
+    if (a.mWhenUs != b.mWhenUs) {
+        return a.mWhenUs < b.mWhenUs;
+    }
+
+    // tolerates wrap around
+    return (int32_t)(a.mSeqNo - b.mSeqNo) < 0;
+}
+
+void ALooper::pushEvent_l(const Event &event) {
+    size_t i = mEventQueue.size();
+    mEventQueue.push(event);
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!EventBefore(event, mEventQueue[parent])) {
+            break;
+        }
+        mEventQueue.editItemAt(i) = mEventQueue[parent];
+        i = parent;
+    }
+
+    mEventQueue.editItemAt(i) = event;
+}
+
+void ALooper::popEvent_l(Event *event) {
+    *event = mEventQueue[0];
+
+    Event last = mEventQueue.top();
+    mEventQueue.pop();
+
+    size_t n = mEventQueue.size();
+    if (n == 0) {
+        return;
+    }
+
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && EventBefore(mEventQueue[child + 1], mEventQueue[child])) {
+            ++child;
+        }
+        if (!EventBefore(mEventQueue[child], last)) {
+            break;
+        }
+        mEventQueue.editItemAt(i) = mEventQueue[child];
+        i = child;
+    }
+
+    mEventQueue.editItemAt(i) = last;
 }
 
 bool ALooper::loop() {
@@ -196,7 +249,7 @@ bool ALooper::loop() {
             mQueueChangedCondition.wait(mLock);
             return true;
         }
-        int64_t whenUs = (*mEventQueue.begin()).mWhenUs;
+        int64_t whenUs = mEventQueue[0].mWhenUs;
         int64_t nowUs = GetNowUs();
 
         if (whenUs > nowUs) {
@@ -206,8 +259,7 @@ bool ALooper::loop() {
             return true;
         }
 
-        event = *mEventQueue.begin();
-        mEventQueue.erase(mEventQueue.begin());
+        popEvent_l(&event);
     }
 
     gLooperRoster.deliverMessage(event.mMessage);
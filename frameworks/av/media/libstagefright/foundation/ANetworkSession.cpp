@@ -27,8 +27,10 @@
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
@@ -52,14 +54,18 @@ static uint64_t U64_AT(const uint8_t *ptr) {
 static const size_t kMaxUDPSize = 1500;
 static const int32_t kMaxUDPRetries = 200;
 
+// Events handled per epoll_wait() and stream fragments per writev().
+static const size_t kMaxEpollEvents = 32;
+static const size_t kMaxWriteIOVecs = 16;
+
 struct ANetworkSession::NetworkThread : public Thread {
-    NetworkThread(ANetworkSession *session);
+    NetworkThread(Shard *shard);
 
 protected:
     virtual ~NetworkThread();
 
 private:
-    ANetworkSession *mSession;
+    Shard *mShard;
 
     virtual bool threadLoop();
 
@@ -102,10 +108,19 @@ struct ANetworkSession::Session : public RefBase {
     status_t sendRequest(
             const void *data, ssize_t size, bool timeValid, int64_t timeUs);
 
+    status_t sendDatagram(
+            const struct iovec *iov, size_t iovCount,
+            const sp<RefBase> &owner, bool timeValid, int64_t timeUs);
+
     void setMode(Mode mode);
 
     status_t switchToWebSocketMode();
 
+    // The events the socket is currently registered for with the
+    // shard's epoll set, 0 if it isn't.
+    uint32_t epollEvents() const;
+    void setEpollEvents(uint32_t events);
+
 protected:
     virtual ~Session();
 
@@ -117,6 +132,11 @@ private:
         uint32_t mFlags;
         int64_t mTimeUs;
         sp<ABuffer> mBuffer;
+
+        // Set instead of mBuffer for datagrams sent from the caller's
+        // memory, see sendDatagram().
+        Vector<struct iovec> mIOVecs;
+        sp<RefBase> mOwner;
     };
 
     int32_t mSessionID;
@@ -133,6 +153,8 @@ private:
 
     int64_t mLastStallReportUs;
 
+    uint32_t mEpollEvents;
+
     void notifyError(bool send, status_t err, const char *detail);
     void notify(NotificationReason reason);
 
@@ -140,17 +162,50 @@ private:
 
     DISALLOW_EVIL_CONSTRUCTORS(Session);
 };
+
+// One network thread together with the sessions it serves.
+struct ANetworkSession::Shard : public RefBase {
+    Shard(ANetworkSession *owner);
+
+    status_t start();
+    void stop();
+
+    // Must be called with mLock held.
+    void addSession_l(const sp<Session> &session);
+    void removeSession_l(const sp<Session> &session);
+    void updateEvents_l(const sp<Session> &session);
+
+    void threadLoop();
+
+    Mutex mLock;
+    KeyedVector<int32_t, sp<Session> > mSessions;
+
+protected:
+    virtual ~Shard();
+
+private:
+    ANetworkSession *mOwner;
+    sp<Thread> mThread;
+
+    int mEpollFd;
+    int mPipeFd[2];
+
+    void interrupt();
+
+    DISALLOW_EVIL_CONSTRUCTORS(Shard);
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
-ANetworkSession::NetworkThread::NetworkThread(ANetworkSession *session)
-    : mSession(session) {
+ANetworkSession::NetworkThread::NetworkThread(Shard *shard)
+    : mShard(shard) {
 }
 
 ANetworkSession::NetworkThread::~NetworkThread() {
 }
 
 bool ANetworkSession::NetworkThread::threadLoop() {
-    mSession->threadLoop();
+    mShard->threadLoop();
 
     return true;
 }
@@ -170,7 +225,8 @@ ANetworkSession::Session::Session(
       mSawReceiveFailure(false),
       mSawSendFailure(false),
       mUDPRetries(kMaxUDPRetries),
-      mLastStallReportUs(-1ll) {
+      mLastStallReportUs(-1ll),
+      mEpollEvents(0) {
     if (mState == CONNECTED) {
         struct sockaddr_in localAddr;
         socklen_t localAddrLen = sizeof(localAddr);
@@ -242,6 +298,14 @@ status_t ANetworkSession::Session::switchToWebSocketMode() {
     return OK;
 }
 
+uint32_t ANetworkSession::Session::epollEvents() const {
+    return mEpollEvents;
+}
+
+void ANetworkSession::Session::setEpollEvents(uint32_t events) {
+    mEpollEvents = events;
+}
+
 sp<AMessage> ANetworkSession::Session::getNotificationMessage() const {
     return mNotify;
 }
@@ -558,9 +622,20 @@ status_t ANetworkSession::Session::writeMore() {
             const sp<ABuffer> &datagram = frag.mBuffer;
 
             int n;
-            do {
-                n = send(mSocket, datagram->data(), datagram->size(), 0);
-            } while (n < 0 && errno == EINTR);
+            if (datagram == NULL) {
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = const_cast<struct iovec *>(frag.mIOVecs.array());
+                msg.msg_iovlen = frag.mIOVecs.size();
+
+                do {
+                    n = sendmsg(mSocket, &msg, 0);
+                } while (n < 0 && errno == EINTR);
+            } else {
+                do {
+                    n = send(mSocket, datagram->data(), datagram->size(), 0);
+                } while (n < 0 && errno == EINTR);
+            }
 
             err = OK;
 
@@ -625,34 +700,58 @@ status_t ANetworkSession::Session::writeMore() {
 
     ssize_t n;
     while (!mOutFragments.empty()) {
-        const Fragment &frag = *mOutFragments.begin();
+        // Hand as many queued fragments as possible to a single writev().
+        struct iovec iov[kMaxWriteIOVecs];
+        size_t iovCount = 0;
+        size_t totalSize = 0;
+
+        for (List<Fragment>::iterator it = mOutFragments.begin();
+                it != mOutFragments.end() && iovCount < kMaxWriteIOVecs;
+                ++it) {
+            iov[iovCount].iov_base = it->mBuffer->data();
+            iov[iovCount].iov_len = it->mBuffer->size();
+            totalSize += it->mBuffer->size();
+            ++iovCount;
+        }
 
         do {
-            n = send(mSocket, frag.mBuffer->data(), frag.mBuffer->size(), 0);
+            n = writev(mSocket, iov, iovCount);
         } while (n < 0 && errno == EINTR);
 
         if (n <= 0) {
             break;
         }
 
-        frag.mBuffer->setRange(
-                frag.mBuffer->offset() + n, frag.mBuffer->size() - n);
+        size_t numBytesLeft = n;
+        while (numBytesLeft > 0) {
+            const Fragment &frag = *mOutFragments.begin();
 
-        if (frag.mBuffer->size() > 0) {
-            break;
-        }
+            if (numBytesLeft < frag.mBuffer->size()) {
+                frag.mBuffer->setRange(
+                        frag.mBuffer->offset() + numBytesLeft,
+                        frag.mBuffer->size() - numBytesLeft);
+                break;
+            }
+
+            numBytesLeft -= frag.mBuffer->size();
 
-        if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
-            dumpFragmentStats(frag);
+            if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
+                dumpFragmentStats(frag);
+            }
+
+            mOutFragments.erase(mOutFragments.begin());
         }
 
-        mOutFragments.erase(mOutFragments.begin());
+        if ((size_t)n < totalSize) {
+            // The socket buffer is full.
+            break;
+        }
     }
 
     status_t err = OK;
 
     if (n < 0) {
-        err = -errno;
+        err = (errno == EAGAIN) ? OK : -errno;
     } else if (n == 0) {
         err = -ECONNRESET;
     }
@@ -777,6 +876,42 @@ status_t ANetworkSession::Session::sendRequest(
     return OK;
 }
 
+status_t ANetworkSession::Session::sendDatagram(
+        const struct iovec *iov, size_t iovCount,
+        const sp<RefBase> &owner, bool timeValid, int64_t timeUs) {
+    if (mState != DATAGRAM) {
+        // Needs framing, so it gets copied anyway.
+        size_t size = 0;
+        for (size_t i = 0; i < iovCount; ++i) {
+            size += iov[i].iov_len;
+        }
+
+        sp<ABuffer> buffer = new ABuffer(size);
+        size_t offset = 0;
+        for (size_t i = 0; i < iovCount; ++i) {
+            memcpy(buffer->data() + offset, iov[i].iov_base, iov[i].iov_len);
+            offset += iov[i].iov_len;
+        }
+
+        return sendRequest(buffer->data(), size, timeValid, timeUs);
+    }
+
+    Fragment frag;
+
+    frag.mFlags = 0;
+    if (timeValid) {
+        frag.mFlags = FRAGMENT_FLAG_TIME_VALID;
+        frag.mTimeUs = timeUs;
+    }
+
+    frag.mIOVecs.appendArray(iov, iovCount);
+    frag.mOwner = owner;
+
+    mOutFragments.push_back(frag);
+
+    return OK;
+}
+
 void ANetworkSession::Session::notifyError(
         bool send, status_t err, const char *detail) {
     sp<AMessage> msg = mNotify->dup();
@@ -797,61 +932,387 @@ void ANetworkSession::Session::notify(NotificationReason reason) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-ANetworkSession::ANetworkSession()
-    : mNextSessionID(1) {
+ANetworkSession::Shard::Shard(ANetworkSession *owner)
+    : mOwner(owner),
+      mEpollFd(-1) {
     mPipeFd[0] = mPipeFd[1] = -1;
 }
 
-ANetworkSession::~ANetworkSession() {
-    stop();
+ANetworkSession::Shard::~Shard() {
+    CHECK(mThread == NULL);
 }
 
-status_t ANetworkSession::start() {
-    if (mThread != NULL) {
-        return INVALID_OPERATION;
-    }
-
+status_t ANetworkSession::Shard::start() {
     int res = pipe(mPipeFd);
     if (res != 0) {
         mPipeFd[0] = mPipeFd[1] = -1;
         return -errno;
     }
 
-    mThread = new NetworkThread(this);
+    status_t err = OK;
+
+    mEpollFd = epoll_create(kMaxEpollEvents);
+    if (mEpollFd < 0) {
+        err = -errno;
+    } else {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = 0;  // Session ids start at 1.
+
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mPipeFd[0], &ev) < 0) {
+            err = -errno;
+        }
+    }
+
+    if (err == OK) {
+        Mutex::Autolock autoLock(mLock);
+
+        // Sessions created before the thread was started.
+        for (size_t i = 0; i < mSessions.size(); ++i) {
+            updateEvents_l(mSessions.valueAt(i));
+        }
+    }
+
+    if (err == OK) {
+        mThread = new NetworkThread(this);
 
-    status_t err = mThread->run("ANetworkSession", ANDROID_PRIORITY_AUDIO);
+        err = mThread->run("ANetworkSession", ANDROID_PRIORITY_AUDIO);
+
+        if (err != OK) {
+            mThread.clear();
+        }
+    }
 
     if (err != OK) {
+        stop();
+    }
+
+    return err;
+}
+
+void ANetworkSession::Shard::stop() {
+    if (mThread != NULL) {
+        mThread->requestExit();
+        interrupt();
+        mThread->requestExitAndWait();
+
         mThread.clear();
+    }
 
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        for (size_t i = 0; i < mSessions.size(); ++i) {
+            mSessions.valueAt(i)->setEpollEvents(0);
+        }
+    }
+
+    if (mEpollFd >= 0) {
+        close(mEpollFd);
+        mEpollFd = -1;
+    }
+
+    if (mPipeFd[0] >= 0) {
         close(mPipeFd[0]);
         close(mPipeFd[1]);
         mPipeFd[0] = mPipeFd[1] = -1;
+    }
+}
 
-        return err;
+void ANetworkSession::Shard::addSession_l(const sp<Session> &session) {
+    mSessions.add(session->sessionID(), session);
+    updateEvents_l(session);
+}
+
+void ANetworkSession::Shard::removeSession_l(const sp<Session> &session) {
+    if (session->epollEvents() != 0) {
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, session->socket(), NULL);
+        session->setEpollEvents(0);
+    }
+
+    mSessions.removeItem(session->sessionID());
+}
+
+void ANetworkSession::Shard::updateEvents_l(const sp<Session> &session) {
+    int s = session->socket();
+
+    if (mEpollFd < 0 || s < 0) {
+        return;
+    }
+
+    uint32_t events = 0;
+    if (session->wantsToRead()) {
+        events |= EPOLLIN;
+    }
+    if (session->wantsToWrite()) {
+        events |= EPOLLOUT;
+    }
+
+    uint32_t oldEvents = session->epollEvents();
+    if (events == oldEvents) {
+        return;
+    }
+
+    int res;
+    if (events == 0) {
+        // Errors and hangups are reported even without any events asked
+        // for, the socket has to go.
+        res = epoll_ctl(mEpollFd, EPOLL_CTL_DEL, s, NULL);
+    } else {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.u32 = session->sessionID();
+
+        res = epoll_ctl(
+                mEpollFd, oldEvents == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                s, &ev);
+    }
+
+    if (res < 0) {
+        ALOGE("epoll_ctl on socket %d failed w/ error %d (%s)",
+              s, errno, strerror(errno));
+        return;
+    }
+
+    session->setEpollEvents(events);
+}
+
+void ANetworkSession::Shard::interrupt() {
+    static const char dummy = 0;
+
+    ssize_t n;
+    do {
+        n = write(mPipeFd[1], &dummy, 1);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        ALOGW("Error writing to pipe (%s)", strerror(errno));
+    }
+}
+
+void ANetworkSession::Shard::threadLoop() {
+    struct epoll_event events[kMaxEpollEvents];
+
+    int res = epoll_wait(mEpollFd, events, kMaxEpollEvents, -1 /* timeout */);
+
+    if (res == 0) {
+        return;
+    }
+
+    if (res < 0) {
+        if (errno == EINTR) {
+            return;
+        }
+
+        ALOGE("epoll_wait failed w/ error %d (%s)", errno, strerror(errno));
+        return;
+    }
+
+    List<sp<Session> > sessionsToAdd;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        for (int i = 0; i < res; ++i) {
+            int32_t sessionID = events[i].data.u32;
+
+            if (sessionID == 0) {
+                char c;
+                ssize_t n;
+                do {
+                    n = read(mPipeFd[0], &c, 1);
+                } while (n < 0 && errno == EINTR);
+
+                if (n < 0) {
+                    ALOGW("Error reading from pipe (%s)", strerror(errno));
+                }
+                continue;
+            }
+
+            ssize_t index = mSessions.indexOfKey(sessionID);
+            if (index < 0) {
+                // Destroyed while we were waiting.
+                continue;
+            }
+
+            sp<Session> session = mSessions.valueAt(index);
+
+            int s = session->socket();
+
+            // Like select(), report errors to whichever side is interested.
+            uint32_t mask = events[i].events;
+            bool canRead =
+                (mask & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                    && session->wantsToRead();
+            bool canWrite =
+                (mask & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                    && session->wantsToWrite();
+
+            if (canRead) {
+                if (session->isRTSPServer() || session->isTCPDatagramServer()) {
+                    struct sockaddr_in remoteAddr;
+                    socklen_t remoteAddrLen = sizeof(remoteAddr);
+
+                    int clientSocket = accept(
+                            s, (struct sockaddr *)&remoteAddr, &remoteAddrLen);
+
+                    if (clientSocket >= 0) {
+                        status_t err = MakeSocketNonBlocking(clientSocket);
+
+                        if (err != OK) {
+                            ALOGE("Unable to make client socket non blocking, "
+                                  "failed w/ error %d (%s)",
+                                  err, strerror(-err));
+
+                            close(clientSocket);
+                            clientSocket = -1;
+                        } else {
+                            in_addr_t addr = ntohl(remoteAddr.sin_addr.s_addr);
+
+                            ALOGI("incoming connection from %d.%d.%d.%d:%d "
+                                  "(socket %d)",
+                                  (addr >> 24),
+                                  (addr >> 16) & 0xff,
+                                  (addr >> 8) & 0xff,
+                                  addr & 0xff,
+                                  ntohs(remoteAddr.sin_port),
+                                  clientSocket);
+
+                            sp<Session> clientSession =
+                                new Session(
+                                        mOwner->newSessionID(),
+                                        Session::CONNECTED,
+                                        clientSocket,
+                                        session->getNotificationMessage());
+
+                            clientSession->setMode(
+                                    session->isRTSPServer()
+                                        ? Session::MODE_RTSP
+                                        : Session::MODE_DATAGRAM);
+
+                            sessionsToAdd.push_back(clientSession);
+                        }
+                    } else {
+                        ALOGE("accept returned error %d (%s)",
+                              errno, strerror(errno));
+                    }
+                } else {
+                    status_t err = session->readMore();
+                    if (err != OK) {
+                        ALOGE("readMore on socket %d failed w/ error %d (%s)",
+                              s, err, strerror(-err));
+                    }
+                }
+            }
+
+            if (canWrite) {
+                status_t err = session->writeMore();
+                if (err != OK) {
+                    ALOGE("writeMore on socket %d failed w/ error %d (%s)",
+                          s, err, strerror(-err));
+                }
+            }
+
+            updateEvents_l(session);
+        }
+    }
+
+    // The new sessions may belong to another shard, add them without
+    // holding our own lock.
+    while (!sessionsToAdd.empty()) {
+        sp<Session> session = *sessionsToAdd.begin();
+        sessionsToAdd.erase(sessionsToAdd.begin());
+
+        mOwner->addSession(session);
+
+        ALOGI("added clientSession %d", session->sessionID());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ANetworkSession::ANetworkSession(size_t numThreads)
+    : mNextSessionID(1),
+      mStarted(false) {
+    CHECK_GT(numThreads, 0u);
+
+    for (size_t i = 0; i < numThreads; ++i) {
+        mShards.push(new Shard(this));
+    }
+}
+
+ANetworkSession::~ANetworkSession() {
+    stop();
+}
+
+status_t ANetworkSession::start() {
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        if (mStarted) {
+            return INVALID_OPERATION;
+        }
+
+        mStarted = true;
+    }
+
+    // Not holding mLock, the threads need it for new session ids.
+    for (size_t i = 0; i < mShards.size(); ++i) {
+        status_t err = mShards.itemAt(i)->start();
+
+        if (err != OK) {
+            while (i-- > 0) {
+                mShards.itemAt(i)->stop();
+            }
+
+            Mutex::Autolock autoLock(mLock);
+            mStarted = false;
+
+            return err;
+        }
     }
 
     return OK;
 }
 
 status_t ANetworkSession::stop() {
-    if (mThread == NULL) {
-        return INVALID_OPERATION;
-    }
+    {
+        Mutex::Autolock autoLock(mLock);
 
-    mThread->requestExit();
-    interrupt();
-    mThread->requestExitAndWait();
+        if (!mStarted) {
+            return INVALID_OPERATION;
+        }
 
-    mThread.clear();
+        mStarted = false;
+    }
 
-    close(mPipeFd[0]);
-    close(mPipeFd[1]);
-    mPipeFd[0] = mPipeFd[1] = -1;
+    for (size_t i = 0; i < mShards.size(); ++i) {
+        mShards.itemAt(i)->stop();
+    }
 
     return OK;
 }
 
+int32_t ANetworkSession::newSessionID() {
+    Mutex::Autolock autoLock(mLock);
+
+    return mNextSessionID++;
+}
+
+const sp<ANetworkSession::Shard> &ANetworkSession::shardFor(
+        int32_t sessionID) const {
+    return mShards.itemAt(sessionID % mShards.size());
+}
+
+void ANetworkSession::addSession(const sp<Session> &session) {
+    const sp<Shard> &shard = shardFor(session->sessionID());
+
+    Mutex::Autolock autoLock(shard->mLock);
+    shard->addSession_l(session);
+}
+
 status_t ANetworkSession::createRTSPClient(
         const char *host, unsigned port, const sp<AMessage> &notify,
         int32_t *sessionID) {
@@ -929,17 +1390,17 @@ status_t ANetworkSession::createTCPDatagramSession(
 }
 
 status_t ANetworkSession::destroySession(int32_t sessionID) {
-    Mutex::Autolock autoLock(mLock);
+    const sp<Shard> &shard = shardFor(sessionID);
 
-    ssize_t index = mSessions.indexOfKey(sessionID);
+    Mutex::Autolock autoLock(shard->mLock);
+
+    ssize_t index = shard->mSessions.indexOfKey(sessionID);
 
     if (index < 0) {
         return -ENOENT;
     }
 
-    mSessions.removeItemsAt(index);
-
-    interrupt();
+    shard->removeSession_l(shard->mSessions.valueAt(index));
 
     return OK;
 }
@@ -967,8 +1428,6 @@ status_t ANetworkSession::createClientOrServer(
         unsigned remotePort,
         const sp<AMessage> &notify,
         int32_t *sessionID) {
-    Mutex::Autolock autoLock(mLock);
-
     *sessionID = 0;
     status_t err = OK;
     int s, res;
@@ -1137,7 +1596,7 @@ status_t ANetworkSession::createClientOrServer(
     }
 
     session = new Session(
-            mNextSessionID++,
+            newSessionID(),
             state,
             s,
             notify);
@@ -1148,9 +1607,7 @@ status_t ANetworkSession::createClientOrServer(
         session->setMode(Session::MODE_RTSP);
     }
 
-    mSessions.add(session->sessionID(), session);
-
-    interrupt();
+    addSession(session);
 
     *sessionID = session->sessionID();
 
@@ -1166,15 +1623,17 @@ bail:
 
 status_t ANetworkSession::connectUDPSession(
         int32_t sessionID, const char *remoteHost, unsigned remotePort) {
-    Mutex::Autolock autoLock(mLock);
+    const sp<Shard> &shard = shardFor(sessionID);
+
+    Mutex::Autolock autoLock(shard->mLock);
 
-    ssize_t index = mSessions.indexOfKey(sessionID);
+    ssize_t index = shard->mSessions.indexOfKey(sessionID);
 
     if (index < 0) {
         return -ENOENT;
     }
 
-    const sp<Session> session = mSessions.valueAt(index);
+    const sp<Session> session = shard->mSessions.valueAt(index);
     int s = session->socket();
 
     struct sockaddr_in remoteAddr;
@@ -1205,207 +1664,62 @@ status_t ANetworkSession::connectUDPSession(
 status_t ANetworkSession::sendRequest(
         int32_t sessionID, const void *data, ssize_t size,
         bool timeValid, int64_t timeUs) {
-    Mutex::Autolock autoLock(mLock);
+    const sp<Shard> &shard = shardFor(sessionID);
 
-    ssize_t index = mSessions.indexOfKey(sessionID);
+    Mutex::Autolock autoLock(shard->mLock);
+
+    ssize_t index = shard->mSessions.indexOfKey(sessionID);
 
     if (index < 0) {
         return -ENOENT;
     }
 
-    const sp<Session> session = mSessions.valueAt(index);
+    const sp<Session> session = shard->mSessions.valueAt(index);
 
     status_t err = session->sendRequest(data, size, timeValid, timeUs);
 
-    interrupt();
+    // No need to wake up the network thread, epoll picks up the change.
+    shard->updateEvents_l(session);
 
     return err;
 }
 
-status_t ANetworkSession::switchToWebSocketMode(int32_t sessionID) {
-    Mutex::Autolock autoLock(mLock);
+status_t ANetworkSession::sendDatagram(
+        int32_t sessionID, const struct iovec *iov, size_t iovCount,
+        const sp<RefBase> &owner, bool timeValid, int64_t timeUs) {
+    const sp<Shard> &shard = shardFor(sessionID);
+
+    Mutex::Autolock autoLock(shard->mLock);
 
-    ssize_t index = mSessions.indexOfKey(sessionID);
+    ssize_t index = shard->mSessions.indexOfKey(sessionID);
 
     if (index < 0) {
         return -ENOENT;
     }
 
-    const sp<Session> session = mSessions.valueAt(index);
-    return session->switchToWebSocketMode();
-}
+    const sp<Session> session = shard->mSessions.valueAt(index);
 
-void ANetworkSession::interrupt() {
-    static const char dummy = 0;
+    status_t err = session->sendDatagram(
+            iov, iovCount, owner, timeValid, timeUs);
 
-    ssize_t n;
-    do {
-        n = write(mPipeFd[1], &dummy, 1);
-    } while (n < 0 && errno == EINTR);
+    shard->updateEvents_l(session);
 
-    if (n < 0) {
-        ALOGW("Error writing to pipe (%s)", strerror(errno));
-    }
+    return err;
 }
 
-void ANetworkSession::threadLoop() {
-    fd_set rs, ws;
-    FD_ZERO(&rs);
-    FD_ZERO(&ws);
-
-    FD_SET(mPipeFd[0], &rs);
-    int maxFd = mPipeFd[0];
-
-    {
-        Mutex::Autolock autoLock(mLock);
-
-        for (size_t i = 0; i < mSessions.size(); ++i) {
-            const sp<Session> &session = mSessions.valueAt(i);
-
-            int s = session->socket();
-
-            if (s < 0) {
-                continue;
-            }
-
-            if (session->wantsToRead()) {
-                FD_SET(s, &rs);
-                if (s > maxFd) {
-                    maxFd = s;
-                }
-            }
-
-            if (session->wantsToWrite()) {
-                FD_SET(s, &ws);
-                if (s > maxFd) {
-                    maxFd = s;
-                }
-            }
-        }
-    }
-
-    int res = select(maxFd + 1, &rs, &ws, NULL, NULL /* tv */);
-
-    if (res == 0) {
-        return;
-    }
-
-    if (res < 0) {
-        if (errno == EINTR) {
-            return;
-        }
-
-        ALOGE("select failed w/ error %d (%s)", errno, strerror(errno));
-        return;
-    }
+status_t ANetworkSession::switchToWebSocketMode(int32_t sessionID) {
+    const sp<Shard> &shard = shardFor(sessionID);
 
-    if (FD_ISSET(mPipeFd[0], &rs)) {
-        char c;
-        ssize_t n;
-        do {
-            n = read(mPipeFd[0], &c, 1);
-        } while (n < 0 && errno == EINTR);
+    Mutex::Autolock autoLock(shard->mLock);
 
-        if (n < 0) {
-            ALOGW("Error reading from pipe (%s)", strerror(errno));
-        }
+    ssize_t index = shard->mSessions.indexOfKey(sessionID);
 
-        --res;
+    if (index < 0) {
+        return -ENOENT;
     }
 
-    {
-        Mutex::Autolock autoLock(mLock);
-
-        List<sp<Session> > sessionsToAdd;
-
-        for (size_t i = mSessions.size(); res > 0 && i-- > 0;) {
-            const sp<Session> &session = mSessions.valueAt(i);
-
-            int s = session->socket();
-
-            if (s < 0) {
-                continue;
-            }
-
-            if (FD_ISSET(s, &rs) || FD_ISSET(s, &ws)) {
-                --res;
-            }
-
-            if (FD_ISSET(s, &rs)) {
-                if (session->isRTSPServer() || session->isTCPDatagramServer()) {
-                    struct sockaddr_in remoteAddr;
-                    socklen_t remoteAddrLen = sizeof(remoteAddr);
-
-                    int clientSocket = accept(
-                            s, (struct sockaddr *)&remoteAddr, &remoteAddrLen);
-
-                    if (clientSocket >= 0) {
-                        status_t err = MakeSocketNonBlocking(clientSocket);
-
-                        if (err != OK) {
-                            ALOGE("Unable to make client socket non blocking, "
-                                  "failed w/ error %d (%s)",
-                                  err, strerror(-err));
-
-                            close(clientSocket);
-                            clientSocket = -1;
-                        } else {
-                            in_addr_t addr = ntohl(remoteAddr.sin_addr.s_addr);
-
-                            ALOGI("incoming connection from %d.%d.%d.%d:%d "
-                                  "(socket %d)",
-                                  (addr >> 24),
-                                  (addr >> 16) & 0xff,
-                                  (addr >> 8) & 0xff,
-                                  addr & 0xff,
-                                  ntohs(remoteAddr.sin_port),
-                                  clientSocket);
-
-                            sp<Session> clientSession =
-                                new Session(
-                                        mNextSessionID++,
-                                        Session::CONNECTED,
-                                        clientSocket,
-                                        session->getNotificationMessage());
-
-                            clientSession->setMode(
-                                    session->isRTSPServer()
-                                        ? Session::MODE_RTSP
-                                        : Session::MODE_DATAGRAM);
-
-                            sessionsToAdd.push_back(clientSession);
-                        }
-                    } else {
-                        ALOGE("accept returned error %d (%s)",
-                              errno, strerror(errno));
-                    }
-                } else {
-                    status_t err = session->readMore();
-                    if (err != OK) {
-                        ALOGE("readMore on socket %d failed w/ error %d (%s)",
-                              s, err, strerror(-err));
-                    }
-                }
-            }
-
-            if (FD_ISSET(s, &ws)) {
-                status_t err = session->writeMore();
-                if (err != OK) {
-                    ALOGE("writeMore on socket %d failed w/ error %d (%s)",
-                          s, err, strerror(-err));
-                }
-            }
-        }
-
-        while (!sessionsToAdd.empty()) {
-            sp<Session> session = *sessionsToAdd.begin();
-            sessionsToAdd.erase(sessionsToAdd.begin());
-
-            mSessions.add(session->sessionID(), session);
-
-            ALOGI("added clientSession %d", session->sessionID());
-        }
-    }
+    const sp<Session> session = shard->mSessions.valueAt(index);
+    return session->switchToWebSocketMode();
 }
 
 }  // namespace android
@@ -68,7 +68,11 @@ LiveSession::LiveSession(
       mReconfigurationInProgress(false),
       mSwitchInProgress(false),
       mDisconnectReplyID(0),
-      mSeekReplyID(0) {
+      mSeekReplyID(0),
+      mLatencyUs(-1ll),
+      mThroughputBps(0ll),
+      mSegmentDurationUs(0ll),
+      mNumSegmentsMeasured(0) {
     if (mUIDValid) {
         mHTTPDataSource->setUID(mUID);
     }
@@ -657,12 +661,18 @@ ssize_t LiveSession::fetchFile(
                                     ? "" : StringPrintf("%lld",
                                             range_offset + range_length - 1).c_str()).c_str()));
             }
+            int64_t connectStartUs = ALooper::GetNowUs();
             status_t err = mHTTPDataSource->connect(url, &headers);
 
             if (err != OK) {
                 return err;
             }
 
+            // Every request pays this, be it for a playlist, a key or a segment.
+            int64_t latencyUs = ALooper::GetNowUs() - connectStartUs;
+            mLatencyUs = (mLatencyUs < 0)
+                    ? latencyUs : (mLatencyUs * 3 + latencyUs) / 4;
+
             *source = mHTTPDataSource;
         }
     }
@@ -792,6 +802,49 @@ sp<M3UParser> LiveSession::fetchPlaylist(
     return playlist;
 }
 
+void LiveSession::addSegmentMeasurement(
+        size_t bytes, int64_t fetchUs, int64_t segmentDurationUs) {
+    int64_t transferUs = fetchUs - (mLatencyUs > 0 ? mLatencyUs : 0);
+    if (bytes == 0 || transferUs <= 0 || segmentDurationUs <= 0) {
+        return;
+    }
+
+    int64_t throughputBps = bytes * 8000000ll / transferUs;
+
+    if (mNumSegmentsMeasured == 0) {
+        mThroughputBps = throughputBps;
+        mSegmentDurationUs = segmentDurationUs;
+    } else {
+        mThroughputBps = (mThroughputBps * 3 + throughputBps) / 4;
+        mSegmentDurationUs = (mSegmentDurationUs * 3 + segmentDurationUs) / 4;
+    }
+    ++mNumSegmentsMeasured;
+
+    ALOGV("segment of %d bytes in %lld us, throughput %lld bps, latency %lld us",
+          bytes, fetchUs, mThroughputBps, mLatencyUs);
+}
+
+bool LiveSession::estimateSegmentBandwidth(int32_t *bandwidthBps) const {
+    // A single segment says little, it may have been cached along the way.
+    static const size_t kMinSegmentsMeasured = 2;
+
+    if (mNumSegmentsMeasured < kMinSegmentsMeasured || mLatencyUs < 0) {
+        return false;
+    }
+
+    // L + B * D / R <= D, so B <= R * (D - L) / D.
+    int64_t slackUs = mSegmentDurationUs - mLatencyUs;
+    if (slackUs <= 0) {
+        *bandwidthBps = 0;
+        return true;
+    }
+
+    int64_t bps = mThroughputBps * slackUs / mSegmentDurationUs;
+    *bandwidthBps = (bps > 0x7fffffff) ? 0x7fffffff : (int32_t)bps;
+
+    return true;
+}
+
 static double uniformRand() {
     return (double)rand() / RAND_MAX;
 }
@@ -816,7 +869,9 @@ size_t LiveSession::getBandwidthIndex() {
 
     if (index < 0) {
         int32_t bandwidthBps;
-        if (mHTTPDataSource != NULL
+        if (estimateSegmentBandwidth(&bandwidthBps)) {
+            ALOGV("segment bandwidth estimated at %.2f kbps", bandwidthBps / 1024.0f);
+        } else if (mHTTPDataSource != NULL
                 && mHTTPDataSource->estimateBandwidth(&bandwidthBps)) {
             ALOGV("bandwidth estimated at %.2f kbps", bandwidthBps / 1024.0f);
         } else {
@@ -185,6 +185,14 @@ private:
     uint32_t mDisconnectReplyID;
     uint32_t mSeekReplyID;
 
+    // Download model used to pick the variant: fetching a segment of
+    // mSegmentDurationUs takes mLatencyUs plus its size at mThroughputBps.
+    // All three are smoothed over the recent fetches.
+    int64_t mLatencyUs;
+    int64_t mThroughputBps;
+    int64_t mSegmentDurationUs;
+    size_t mNumSegmentsMeasured;
+
     sp<PlaylistFetcher> addFetcher(const char *uri);
 
     void onConnect(const sp<AMessage> &msg);
@@ -215,6 +223,15 @@ private:
     sp<M3UParser> fetchPlaylist(
             const char *url, uint8_t *curPlaylistHash, bool *unchanged);
 
+    // Called by the fetchers once a segment is downloaded; fetchUs is the time
+    // spent in fetchFile, connection included.
+    void addSegmentMeasurement(
+            size_t bytes, int64_t fetchUs, int64_t segmentDurationUs);
+
+    // The highest rate a variant can have and still download its segments in
+    // real time, given the latency.
+    bool estimateSegmentBandwidth(int32_t *bandwidthBps) const;
+
     size_t getBandwidthIndex();
 
     static int SortByBandwidth(const BandwidthItem *, const BandwidthItem *);
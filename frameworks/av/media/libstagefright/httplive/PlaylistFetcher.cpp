@@ -846,9 +846,13 @@ void PlaylistFetcher::onDownloadNext() {
 
     // block-wise download
     ssize_t bytesRead;
+    size_t segmentBytes = 0;
+    int64_t fetchUs = 0ll;
     do {
+        int64_t fetchStartUs = ALooper::GetNowUs();
         bytesRead = mSession->fetchFile(
                 uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize, &source);
+        fetchUs += ALooper::GetNowUs() - fetchStartUs;
 
         if (bytesRead < 0) {
             status_t err = bytesRead;
@@ -859,6 +863,8 @@ void PlaylistFetcher::onDownloadNext() {
 
         CHECK(buffer != NULL);
 
+        segmentBytes += bytesRead;
+
         size_t size = buffer->size();
         // Set decryption range.
         buffer->setRange(size - bytesRead, bytesRead);
@@ -932,6 +938,11 @@ void PlaylistFetcher::onDownloadNext() {
         mStartup = false;
     } while (bytesRead != 0);
 
+    int64_t segmentDurationUs;
+    if (itemMeta->findInt64("durationUs", &segmentDurationUs)) {
+        mSession->addSegmentMeasurement(segmentBytes, fetchUs, segmentDurationUs);
+    }
+
     if (bufferStartsWithTsSyncByte(buffer)) {
         // If we still don't see a stream after fetching a full ts segment mark it as
         // nonexistent.
@@ -30,6 +30,12 @@ namespace android {
 
 static const size_t kMaxMetadataSize = 3 * 1024 * 1024;
 
+// Frames with larger payloads are not read until they are accessed
+static const size_t kMaxEagerFrameSize = 16 * 1024;
+
+// Size of the ID3v2 tag header preceding the frames
+static const size_t kTagHeaderSize = 10;
+
 struct MemorySource : public DataSource {
     MemorySource(const uint8_t *data, size_t size)
         : mData(data),
@@ -63,7 +69,7 @@ ID3::ID3(const sp<DataSource> &source, bool ignoreV1)
       mFirstFrameOffset(0),
       mVersion(ID3_UNKNOWN),
       mRawSize(0) {
-    mIsValid = parseV2(source);
+    mIsValid = parseV2(source, true /* deferLargeFrames */);
 
     if (!mIsValid && !ignoreV1) {
         mIsValid = parseV1(source);
@@ -79,7 +85,7 @@ ID3::ID3(const uint8_t *data, size_t size, bool ignoreV1)
       mRawSize(0) {
     sp<MemorySource> source = new MemorySource(data, size);
 
-    mIsValid = parseV2(source);
+    mIsValid = parseV2(source, false /* deferLargeFrames */);
 
     if (!mIsValid && !ignoreV1) {
         mIsValid = parseV1(source);
@@ -115,7 +121,7 @@ bool ID3::ParseSyncsafeInteger(const uint8_t encoded[4], size_t *x) {
     return true;
 }
 
-bool ID3::parseV2(const sp<DataSource> &source) {
+bool ID3::parseV2(const sp<DataSource> &source, bool deferLargeFrames) {
 struct id3_header {
     char id[3];
     uint8_t version_major;
@@ -185,14 +191,25 @@ struct id3_header {
     mSize = size;
     mRawSize = mSize + sizeof(header);
 
-    if (source->readAt(sizeof(header), mData, mSize) != (ssize_t)mSize) {
+    // Without unsynchronization or an extended header the frames can be
+    // read one by one, in place.
+    bool deferred = deferLargeFrames && !(header.flags & 0xc0)
+            && parseFrameHeaders(source, header.version_major);
+
+    if (deferred) {
+        if (!mDeferredFrames.isEmpty()) {
+            mSource = source;
+        }
+    } else if (source->readAt(sizeof(header), mData, mSize) != (ssize_t)mSize) {
         free(mData);
         mData = NULL;
 
         return false;
     }
 
-    if (header.version_major == 4) {
+    if (deferred) {
+        // parseFrameHeaders made sure there are no frame flags to undo
+    } else if (header.version_major == 4) {
         void *copy = malloc(size);
         memcpy(copy, mData, size);
 
@@ -307,6 +324,85 @@ struct id3_header {
     return true;
 }
 
+// Reads the frame headers and small frames into place in mData. The payloads
+// of large frames are left unread and recorded in mDeferredFrames. Returns
+// false if the tag needs to be read as a whole, because frames need
+// unsynchronization removed or do not add up.
+bool ID3::parseFrameHeaders(const sp<DataSource> &source, uint8_t versionMajor) {
+    mDeferredFrames.clear();
+
+    const size_t headerLength = (versionMajor == 2) ? 6 : 10;
+    size_t offset = 0;
+    while (offset + headerLength <= mSize) {
+        uint8_t *frame = &mData[offset];
+        if (source->readAt(kTagHeaderSize + offset, frame, headerLength)
+                != (ssize_t)headerLength) {
+            mDeferredFrames.clear();
+            return false;
+        }
+
+        if (!memcmp(frame, "\0\0\0\0", (versionMajor == 2) ? 3 : 4)) {
+            // padding
+            break;
+        }
+
+        size_t payloadSize;
+        if (versionMajor == 2) {
+            payloadSize = (frame[3] << 16) | (frame[4] << 8) | frame[5];
+        } else if (versionMajor == 4) {
+            if (!ParseSyncsafeInteger(&frame[4], &payloadSize)
+                    || (U16_AT(&frame[8]) & 3)) {
+                mDeferredFrames.clear();
+                return false;
+            }
+        } else {
+            payloadSize = U32_AT(&frame[4]);
+        }
+
+        offset += headerLength;
+        if (payloadSize > mSize - offset) {
+            mDeferredFrames.clear();
+            return false;
+        }
+
+        if (payloadSize > kMaxEagerFrameSize) {
+            DeferredFrame deferredFrame;
+            deferredFrame.mOffset = offset;
+            deferredFrame.mSize = payloadSize;
+            mDeferredFrames.push(deferredFrame);
+        } else if (source->readAt(kTagHeaderSize + offset, &mData[offset], payloadSize)
+                != (ssize_t)payloadSize) {
+            mDeferredFrames.clear();
+            return false;
+        }
+
+        offset += payloadSize;
+    }
+
+    return true;
+}
+
+bool ID3::loadFrame(const uint8_t *frameData) const {
+    const size_t offset = frameData - mData;
+    for (size_t i = 0; i < mDeferredFrames.size(); ++i) {
+        const DeferredFrame &deferredFrame = mDeferredFrames.itemAt(i);
+        if (deferredFrame.mOffset != offset) {
+            continue;
+        }
+
+        if (mSource->readAt(kTagHeaderSize + offset, &mData[offset], deferredFrame.mSize)
+                != (ssize_t)deferredFrame.mSize) {
+            ALOGW("failed to read ID3 frame at offset %d", offset);
+            return false;
+        }
+
+        mDeferredFrames.removeAt(i);
+        break;
+    }
+
+    return true;
+}
+
 void ID3::removeUnsynchronization() {
     for (size_t i = 0; i + 1 < mSize; ++i) {
         if (mData[i] == 0xff && mData[i + 1] == 0x00) {
@@ -633,6 +729,19 @@ size_t ID3::Iterator::getHeaderLength() const {
 }
 
 void ID3::Iterator::findFrame() {
+    for (;;) {
+        findNextFrame();
+
+        if (mFrameData == NULL || mParent.loadFrame(mFrameData)) {
+            return;
+        }
+
+        // The frame could not be read, skip it
+        mOffset += mFrameSize;
+    }
+}
+
+void ID3::Iterator::findNextFrame() {
     for (;;) {
         mFrameData = NULL;
         mFrameSize = 0;
@@ -19,6 +19,7 @@
 #define ID3_H_
 
 #include <utils/RefBase.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -64,6 +65,7 @@ struct ID3 {
         size_t mFrameSize;
 
         void findFrame();
+        void findNextFrame();
 
         size_t getHeaderLength() const;
         void getstring(String8 *s, bool secondhalf) const;
@@ -75,6 +77,12 @@ struct ID3 {
     size_t rawSize() const { return mRawSize; }
 
 private:
+    // Payload of a frame that has not been read from mSource yet
+    struct DeferredFrame {
+        size_t mOffset;
+        size_t mSize;
+    };
+
     bool mIsValid;
     uint8_t *mData;
     size_t mSize;
@@ -85,8 +93,14 @@ private:
     // only valid for IDV2+
     size_t mRawSize;
 
+    // Large frames, typically artwork, are only read once they are accessed
+    sp<DataSource> mSource;
+    mutable Vector<DeferredFrame> mDeferredFrames;
+
     bool parseV1(const sp<DataSource> &source);
-    bool parseV2(const sp<DataSource> &source);
+    bool parseV2(const sp<DataSource> &source, bool deferLargeFrames);
+    bool parseFrameHeaders(const sp<DataSource> &source, uint8_t versionMajor);
+    bool loadFrame(const uint8_t *frameData) const;
     void removeUnsynchronization();
     bool removeUnsynchronizationV2_4(bool iTunesHack);
 
@@ -38,6 +38,7 @@ public:
     virtual sp<MetaData> getTrackMetaData(size_t index, uint32_t flags);
 
     virtual sp<MetaData> getMetaData();
+    virtual sp<MetaData> getMetaDataWithFlags(uint32_t flags);
 
 private:
     status_t mInitCheck;
@@ -78,6 +78,11 @@ private:
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
+
+        // Ranges left behind by a seek are kept, up to this many bytes
+        // in total, so that seeking back to them does not refetch.
+        kMaxRetainedBytes               = 8 * 1024 * 1024,
+        kMaxNumRetainedRanges           = 4,
     };
 
     enum {
@@ -99,6 +104,16 @@ private:
 
     PageCache *mCache;
     off64_t mCacheOffset;
+
+    // Cached ranges other than the one being fetched, most recently used
+    // first. They do not overlap the fetched range when it is retained.
+    struct CachedRange {
+        PageCache *mCache;
+        off64_t mOffset;
+    };
+    Vector<CachedRange> mRetainedRanges;
+    size_t mRetainedBytes;
+
     status_t mFinalStatus;
     off64_t mLastAccessPos;
     sp<AMessage> mAsyncResult;
@@ -123,6 +138,10 @@ private:
     ssize_t readInternal(off64_t offset, void *data, size_t size);
     status_t seekInternal_l(off64_t offset);
 
+    ssize_t findRetainedRange_l(off64_t offset, size_t size) const;
+    void retainCurrentRange_l();
+    void trimRetainedRanges_l();
+
     size_t approxDataRemaining_l(status_t *finalStatus) const;
 
     void restartPrefetcherIfNecessary_l(
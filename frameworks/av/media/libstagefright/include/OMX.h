@@ -20,6 +20,8 @@
 #include <media/IOMX.h>
 #include <utils/threads.h>
 #include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -112,6 +114,9 @@ public:
             OMX_U32 range_offset, OMX_U32 range_length,
             OMX_U32 flags, OMX_TICKS timestamp);
 
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferRequest> &requests);
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -147,11 +152,27 @@ protected:
 private:
     struct CallbackDispatcherThread;
     struct CallbackDispatcher;
+    struct NodePoolTrimmerThread;
+
+    // A decoder whose client is done with it, kept in the Loaded state so
+    // that the next client asking for the same component gets it without
+    // paying for its creation.
+    struct PooledNode {
+        String8 mName;
+        OMXNodeInstance *mInstance;
+        int64_t mParkedAtUs;
+    };
 
     Mutex mLock;
     OMXMaster *mMaster;
     int32_t mNodeCounter;
 
+    size_t mMaxPooledNodes;
+    Vector<PooledNode> mNodePool;
+    bool mNodePoolDone;
+    Condition mNodePoolChanged;
+    sp<NodePoolTrimmerThread> mNodePoolTrimmer;
+
     KeyedVector<wp<IBinder>, OMXNodeInstance *> mLiveNodes;
     KeyedVector<node_id, OMXNodeInstance *> mNodeIDToInstance;
     KeyedVector<node_id, sp<CallbackDispatcher> > mDispatchers;
@@ -162,6 +183,13 @@ private:
 
     void invalidateNodeID_l(node_id node);
 
+    status_t tryAllocateNode(
+            const char *name, const sp<IOMXObserver> &observer, node_id *node);
+
+    void poolNode(OMXNodeInstance *instance);
+    size_t trimNodePool(int64_t maxAgeUs);
+    bool trimNodePoolLoop();
+
     OMX(const OMX &);
     OMX &operator=(const OMX &);
 };
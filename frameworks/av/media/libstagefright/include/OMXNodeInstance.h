@@ -39,8 +39,18 @@ struct OMXNodeInstance {
     sp<IOMXObserver> observer();
     OMX::node_id nodeID();
 
+    void setComponentName(const char *name);
+    const char *componentName() const;
+
     status_t freeNode(OMXMaster *master);
 
+    // Returns the component to the Loaded state with the port settings it
+    // had when it was created, so that it can be handed to another client
+    // with unpark().  Returns false if the component can't be reused, it
+    // must then be freed.
+    bool park();
+    void unpark(OMX::node_id node_id, const sp<IOMXObserver> &observer);
+
     status_t sendCommand(OMX_COMMANDTYPE cmd, OMX_S32 param);
     status_t getParameter(OMX_INDEXTYPE index, void *params, size_t size);
 
@@ -96,6 +106,8 @@ struct OMXNodeInstance {
             OMX_U32 rangeOffset, OMX_U32 rangeLength,
             OMX_U32 flags, OMX_TICKS timestamp);
 
+    status_t submitBuffers(const Vector<IOMX::BufferRequest> &requests);
+
     status_t emptyDirectBuffer(
             OMX_BUFFERHEADERTYPE *header,
             OMX_U32 rangeOffset, OMX_U32 rangeLength,
@@ -111,6 +123,7 @@ struct OMXNodeInstance {
             size_t size);
 
     void onMessage(const omx_message &msg);
+    void onMessages(const List<omx_message> &messages);
     void onObserverDied(OMXMaster *master);
     void onGetHandleFailed();
     void onEvent(OMX_EVENTTYPE event, OMX_U32 arg1, OMX_U32 arg2);
@@ -126,6 +139,18 @@ private:
     sp<IOMXObserver> mObserver;
     bool mDying;
 
+    String8 mComponentName;
+
+    // Cleared once the client does anything park() can't undo, such as
+    // creating an input surface.
+    bool mReusable;
+    Vector<OMX_PARAM_PORTDEFINITIONTYPE> mInitialPortDefs;
+
+    // Ports the Android extensions were turned on for, one bit per port.
+    OMX_U32 mGraphicBufferPorts;
+    OMX_U32 mMetaDataPorts;
+    OMX_U32 mAdaptivePlaybackPorts;
+
     // Lock only covers mGraphicBufferSource.  We can't always use mLock
     // because of rare instances where we'd end up locking it recursively.
     Mutex mGraphicBufferSourceLock;
@@ -144,6 +169,13 @@ private:
     void addActiveBuffer(OMX_U32 portIndex, OMX::buffer_id id);
     void removeActiveBuffer(OMX_U32 portIndex, OMX::buffer_id id);
     void freeActiveBuffers();
+    bool returnToLoaded();
+    status_t fillBuffer_l(OMX::buffer_id buffer);
+    status_t emptyBuffer_l(
+            OMX::buffer_id buffer,
+            OMX_U32 rangeOffset, OMX_U32 rangeLength,
+            OMX_U32 flags, OMX_TICKS timestamp);
+    bool handleMessage(omx_message &msg);
     status_t useGraphicBuffer2_l(
             OMX_U32 portIndex, const sp<GraphicBuffer> &graphicBuffer,
             OMX::buffer_id *buffer);
@@ -87,6 +87,7 @@ protected:
 
 private:
     struct CompositionDeltaLookup;
+    struct TableCache;
 
     static const uint32_t kChunkOffsetType32;
     static const uint32_t kChunkOffsetType64;
@@ -96,6 +97,10 @@ private:
     sp<DataSource> mDataSource;
     Mutex mLock;
 
+    // The stsz, stz2, stco, co64 and ctts tables are not loaded, their entries are read
+    // through this cache of a few pages of the file when needed.
+    TableCache *mTableCache;
+
     off64_t mChunkOffsetOffset;
     uint32_t mChunkOffsetType;
     uint32_t mNumChunkOffsets;
@@ -117,7 +122,7 @@ private:
     };
     SampleTimeEntry *mSampleTimeEntries;
 
-    uint32_t *mCompositionTimeDeltaEntries;
+    off64_t mCompositionTimeDeltaOffset;
     size_t mNumCompositionTimeDeltaEntries;
     CompositionDeltaLookup *mCompositionDeltaLookup;
 
@@ -137,6 +142,9 @@ private:
 
     friend struct SampleIterator;
 
+    // Read from the sample table boxes, through mTableCache.
+    ssize_t readTableAt(off64_t offset, void *data, size_t size);
+
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
     uint32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
@@ -144,6 +152,11 @@ private:
 
     void buildSampleEntriesTable();
 
+    // findSampleAtTime() for tracks without composition time offsets, where the samples are
+    // in presentation order and buildSampleEntriesTable() is not needed.
+    status_t findSampleAtTimeInOrder(
+            uint32_t req_time, uint32_t *sample_index, uint32_t flags);
+
     SampleTable(const SampleTable &);
     SampleTable &operator=(const SampleTable &);
 };
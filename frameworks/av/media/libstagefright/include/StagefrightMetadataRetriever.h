@@ -27,6 +27,8 @@ namespace android {
 
 struct DataSource;
 class MediaExtractor;
+class MediaSource;
+class MetaData;
 
 struct StagefrightMetadataRetriever : public MediaMetadataRetrieverInterface {
     StagefrightMetadataRetriever();
@@ -50,8 +52,17 @@ private:
     bool mParsedMetaData;
     KeyedVector<int, String8> mMetaData;
     MediaAlbumArt *mAlbumArt;
+    // Whether album art left out by parseMetaData() was asked for
+    bool mParsedAlbumArt;
+
+    // A started software decoder for the video track kept from the last
+    // getFrameAtTime() call, so that further frames of the same source only
+    // cost a seek.
+    sp<MediaSource> mVideoDecoder;
+    sp<MetaData> mVideoTrackMeta;
 
     void parseMetaData();
+    void clearVideoDecoder();
 
     StagefrightMetadataRetriever(const StagefrightMetadataRetriever &);
 
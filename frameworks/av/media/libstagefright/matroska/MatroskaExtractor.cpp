@@ -35,9 +35,22 @@
 
 namespace android {
 
+// Reads ahead in large chunks, covering the whole of the current cluster
+// where possible, so that parsing and frame reads do not each turn into a
+// small read of the data source.
 struct DataSourceReader : public mkvparser::IMkvReader {
     DataSourceReader(const sp<DataSource> &source)
-        : mSource(source) {
+        : mSource(source),
+          mCache(NULL),
+          mCacheOffset(0),
+          mCacheSize(0),
+          mHintStart(0),
+          mHintEnd(0) {
+    }
+
+    virtual ~DataSourceReader() {
+        free(mCache);
+        mCache = NULL;
     }
 
     virtual int Read(long long position, long length, unsigned char* buffer) {
@@ -48,6 +61,19 @@ struct DataSourceReader : public mkvparser::IMkvReader {
             return 0;
         }
 
+        Mutex::Autolock autoLock(mLock);
+
+        if (position >= mCacheOffset
+                && position + length <= mCacheOffset + mCacheSize) {
+            memcpy(buffer, mCache + (position - mCacheOffset), length);
+            return 0;
+        }
+
+        if (length < kMinReadAhead && fillCache_l(position) >= length) {
+            memcpy(buffer, mCache, length);
+            return 0;
+        }
+
         ssize_t n = mSource->readAt(position, buffer, length);
 
         if (n <= 0) {
@@ -77,9 +103,61 @@ struct DataSourceReader : public mkvparser::IMkvReader {
         return 0;
     }
 
+    // Lets reads inside the given cluster fill the cache up to its end.
+    void setClusterHint(const mkvparser::Cluster *cluster) {
+        if (cluster == NULL || cluster->EOS()) {
+            return;
+        }
+
+        const long long size = cluster->GetElementSize();
+        if (size <= 0) {
+            return;
+        }
+
+        Mutex::Autolock autoLock(mLock);
+        mHintStart = cluster->m_element_start;
+        mHintEnd = mHintStart + size;
+    }
+
 private:
+    enum {
+        kMinReadAhead = 64 * 1024,
+        kMaxReadAhead = 1024 * 1024,
+    };
+
     sp<DataSource> mSource;
 
+    Mutex mLock;
+    uint8_t *mCache;
+    long long mCacheOffset;
+    long mCacheSize;
+    long long mHintStart;
+    long long mHintEnd;
+
+    // Returns the number of bytes cached from the given position on.
+    long fillCache_l(long long position) {
+        if (mCache == NULL) {
+            mCache = (uint8_t *)malloc(kMaxReadAhead);
+            if (mCache == NULL) {
+                return 0;
+            }
+        }
+
+        long size = kMinReadAhead;
+        if (position >= mHintStart && position < mHintEnd
+                && mHintEnd - position > size) {
+            size = (mHintEnd - position > kMaxReadAhead)
+                    ? kMaxReadAhead : (long)(mHintEnd - position);
+        }
+
+        ssize_t n = mSource->readAt(position, mCache, size);
+
+        mCacheOffset = position;
+        mCacheSize = (n > 0) ? n : 0;
+
+        return mCacheSize;
+    }
+
     DataSourceReader(const DataSourceReader &);
     DataSourceReader &operator=(const DataSourceReader &);
 };
@@ -115,6 +193,86 @@ private:
     BlockIterator &operator=(const BlockIterator &);
 };
 
+// Recycles the MediaBuffers holding frames. Frames are read into buffers of
+// varying size, so buffers are allocated in multiples of a granule and handed
+// out for any frame that fits. The pool stays alive as long as one of its
+// buffers is in use.
+struct FramePool : public MediaBufferObserver, public RefBase {
+    FramePool() {}
+
+    MediaBuffer *acquire(size_t size);
+
+    virtual void signalBufferReturned(MediaBuffer *buffer);
+
+protected:
+    virtual ~FramePool();
+
+private:
+    enum {
+        kGranuleSize = 16 * 1024,
+        kMaxFreeBuffers = 8,
+    };
+
+    Mutex mLock;
+    List<MediaBuffer *> mFreeBuffers;
+
+    FramePool(const FramePool &);
+    FramePool &operator=(const FramePool &);
+};
+
+FramePool::~FramePool() {
+    while (!mFreeBuffers.empty()) {
+        MediaBuffer *buffer = *mFreeBuffers.begin();
+        mFreeBuffers.erase(mFreeBuffers.begin());
+
+        buffer->setObserver(NULL);
+        buffer->release();
+    }
+}
+
+MediaBuffer *FramePool::acquire(size_t size) {
+    MediaBuffer *buffer = NULL;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        for (List<MediaBuffer *>::iterator it = mFreeBuffers.begin();
+                it != mFreeBuffers.end(); ++it) {
+            if ((*it)->size() >= size) {
+                buffer = *it;
+                mFreeBuffers.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (buffer == NULL) {
+        buffer = new MediaBuffer((size + kGranuleSize - 1) & ~(kGranuleSize - 1));
+        buffer->setObserver(this);
+    } else {
+        buffer->reset();
+    }
+
+    buffer->set_range(0, size);
+    buffer->add_ref();
+    incStrong(buffer);
+
+    return buffer;
+}
+
+void FramePool::signalBufferReturned(MediaBuffer *buffer) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mFreeBuffers.size() < kMaxFreeBuffers) {
+            mFreeBuffers.push_back(buffer);
+        } else {
+            buffer->setObserver(NULL);
+            buffer->release();
+        }
+    }
+
+    decStrong(buffer);
+}
+
 struct MatroskaSource : public MediaSource {
     MatroskaSource(
             const sp<MatroskaExtractor> &extractor, size_t index);
@@ -144,6 +302,7 @@ private:
     BlockIterator mBlockIter;
     size_t mNALSizeLen;  // for type AVC
 
+    sp<FramePool> mFramePool;
     List<MediaBuffer *> mPendingFrames;
 
     status_t advance();
@@ -163,7 +322,8 @@ MatroskaSource::MatroskaSource(
       mIsAudio(false),
       mBlockIter(mExtractor.get(),
                  mExtractor->mTracks.itemAt(index).mTrackNum),
-      mNALSizeLen(0) {
+      mNALSizeLen(0),
+      mFramePool(new FramePool) {
     sp<MetaData> meta = mExtractor->mTracks.itemAt(index).mMeta;
 
     const char *mime;
@@ -275,6 +435,7 @@ void BlockIterator::advance_l() {
             CHECK(!nextCluster->EOS());
 
             mCluster = nextCluster;
+            mExtractor->mReader->setClusterHint(mCluster);
 
             res = mCluster->Parse(pos, len);
             ALOGV("Parse (2) returned %ld", res);
@@ -300,6 +461,7 @@ void BlockIterator::reset() {
     mCluster = mExtractor->mSegment->GetFirst();
     mBlockEntry = NULL;
     mBlockEntryIndex = 0;
+    mExtractor->mReader->setClusterHint(mCluster);
 
     do {
         advance_l();
@@ -323,6 +485,7 @@ void BlockIterator::seek(
         ALOGV("Seek to beginning: %lld", seekTimeUs);
         mCluster = pSegment->GetFirst();
         mBlockEntryIndex = 0;
+        mExtractor->mReader->setClusterHint(mCluster);
         do {
             advance_l();
         } while (!eos() && block()->GetTrackNumber() != mTrackNum);
@@ -350,26 +513,6 @@ void BlockIterator::seek(
                 break;
             }
         }
-
-        if (!pCues) {
-            ALOGE("No Cues in file");
-            return;
-        }
-    }
-    else if (!pSH) {
-        ALOGE("No SeekHead");
-        return;
-    }
-
-    const mkvparser::CuePoint* pCP;
-    while (!pCues->DoneParsing()) {
-        pCues->LoadCuePoint();
-        pCP = pCues->GetLast();
-
-        if (pCP->GetTime(pSegment) >= seekTimeNs) {
-            ALOGV("Parsed past relevant Cue");
-            break;
-        }
     }
 
     // The Cue index is built around video keyframes
@@ -383,23 +526,46 @@ void BlockIterator::seek(
         }
     }
 
-    // Always *search* based on the video track, but finalize based on mTrackNum
-    const mkvparser::CuePoint::TrackPosition* pTP;
-    if (pTrack && pTrack->GetType() == 1) {
+    if (pCues && pTrack && pTrack->GetType() == 1) {
+        const mkvparser::CuePoint* pCP;
+        while (!pCues->DoneParsing()) {
+            pCues->LoadCuePoint();
+            pCP = pCues->GetLast();
+
+            if (pCP->GetTime(pSegment) >= seekTimeNs) {
+                ALOGV("Parsed past relevant Cue");
+                break;
+            }
+        }
+
+        // Always *search* based on the video track, but finalize based on mTrackNum
+        const mkvparser::CuePoint::TrackPosition* pTP;
         pCues->Find(seekTimeNs, pTrack, pCP, pTP);
-    } else {
-        ALOGE("Did not locate the video track for seeking");
-        return;
-    }
 
-    mCluster = pSegment->FindOrPreloadCluster(pTP->m_pos);
+        mCluster = pSegment->FindOrPreloadCluster(pTP->m_pos);
 
-    CHECK(mCluster);
-    CHECK(!mCluster->EOS());
+        CHECK(mCluster);
+        CHECK(!mCluster->EOS());
 
-    // mBlockEntryIndex starts at 0 but m_block starts at 1
-    CHECK_GT(pTP->m_block, 0);
-    mBlockEntryIndex = pTP->m_block - 1;
+        // mBlockEntryIndex starts at 0 but m_block starts at 1
+        CHECK_GT(pTP->m_block, 0);
+        mBlockEntryIndex = pTP->m_block - 1;
+    } else {
+        // Without usable Cues, start at the last cluster beginning before
+        // the seek time. The clusters seen so far are indexed, so only the
+        // first seek past them walks the file.
+        ALOGV("No usable Cues, seeking by cluster time");
+
+        mCluster = mExtractor->findCluster_l(seekTimeNs);
+        if (mCluster == NULL) {
+            ALOGE("Failed to locate a cluster for seeking");
+            return;
+        }
+
+        mBlockEntryIndex = 0;
+    }
+
+    mExtractor->mReader->setClusterHint(mCluster);
 
     for (;;) {
         advance_l();
@@ -467,13 +633,14 @@ status_t MatroskaSource::readBlock() {
     for (int i = 0; i < block->GetFrameCount(); ++i) {
         const mkvparser::Block::Frame &frame = block->GetFrame(i);
 
-        MediaBuffer *mbuf = new MediaBuffer(frame.len);
+        MediaBuffer *mbuf = mFramePool->acquire(frame.len);
         mbuf->meta_data()->setInt64(kKeyTime, timeUs);
         mbuf->meta_data()->setInt32(kKeyIsSyncFrame, block->IsKey());
 
         long n = frame.Read(mExtractor->mReader, (unsigned char *)mbuf->data());
         if (n != 0) {
-            mPendingFrames.clear();
+            mbuf->release();
+            clearPendingFrames();
 
             mBlockIter.advance();
             return ERROR_IO;
@@ -594,7 +761,7 @@ status_t MatroskaSource::read(
         if (pass == 0) {
             dstSize = dstOffset;
 
-            buffer = new MediaBuffer(dstSize);
+            buffer = mFramePool->acquire(dstSize);
 
             int64_t timeUs;
             CHECK(frame->meta_data()->findInt64(kKeyTime, &timeUs));
@@ -628,7 +795,8 @@ MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
       mReader(new DataSourceReader(mDataSource)),
       mSegment(NULL),
       mExtractedThumbnails(false),
-      mIsWebm(false) {
+      mIsWebm(false),
+      mClusterIndexComplete(false) {
     off64_t size;
     mIsLiveStreaming =
         (mDataSource->flags()
@@ -716,6 +884,54 @@ bool MatroskaExtractor::isLiveStreaming() const {
     return mIsLiveStreaming;
 }
 
+const mkvparser::Cluster *MatroskaExtractor::findCluster_l(int64_t seekTimeNs) {
+    // Extend the index until it covers the seek time.
+    while (!mClusterIndexComplete
+            && (mClusterIndex.isEmpty()
+                || mClusterIndex.itemAt(mClusterIndex.size() - 1).mTimeNs < seekTimeNs)) {
+        const mkvparser::Cluster *cluster;
+        if (mClusterIndex.isEmpty()) {
+            cluster = mSegment->GetFirst();
+        } else {
+            long long pos;
+            long len;
+            const mkvparser::Cluster *last =
+                mClusterIndex.itemAt(mClusterIndex.size() - 1).mCluster;
+            if (mSegment->ParseNext(last, cluster, pos, len) != 0) {
+                cluster = NULL;
+            }
+        }
+
+        if (cluster == NULL || cluster->EOS()) {
+            mClusterIndexComplete = true;
+            break;
+        }
+
+        ClusterInfo info;
+        info.mTimeNs = cluster->GetTime();
+        info.mCluster = cluster;
+        mClusterIndex.push(info);
+    }
+
+    if (mClusterIndex.isEmpty()) {
+        return NULL;
+    }
+
+    // Find the last cluster starting at or before the seek time.
+    size_t lo = 0;
+    size_t hi = mClusterIndex.size();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mClusterIndex.itemAt(mid).mTimeNs <= seekTimeNs) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return mClusterIndex.itemAt(lo).mCluster;
+}
+
 static int bytesForSize(size_t size) {
     // use at most 28 bits (4 times 7)
     CHECK(size <= 0xfffffff);
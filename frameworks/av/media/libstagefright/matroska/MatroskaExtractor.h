@@ -24,6 +24,7 @@
 
 namespace mkvparser {
 struct Segment;
+class Cluster;
 };
 
 namespace android {
@@ -60,6 +61,11 @@ private:
         sp<MetaData> mMeta;
     };
 
+    struct ClusterInfo {
+        int64_t mTimeNs;
+        const mkvparser::Cluster *mCluster;
+    };
+
     Mutex mLock;
     Vector<TrackInfo> mTracks;
 
@@ -70,9 +76,15 @@ private:
     bool mIsLiveStreaming;
     bool mIsWebm;
 
+    // Start times of the clusters parsed so far, for seeking without Cues
+    Vector<ClusterInfo> mClusterIndex;
+    bool mClusterIndexComplete;
+
     void addTracks();
     void findThumbnails();
 
+    const mkvparser::Cluster *findCluster_l(int64_t seekTimeNs);
+
     bool isLiveStreaming() const;
 
     MatroskaExtractor(const MatroskaExtractor &);
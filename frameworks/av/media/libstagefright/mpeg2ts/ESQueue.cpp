@@ -44,6 +44,12 @@ sp<MetaData> ElementaryStreamQueue::getFormat() {
     return mFormat;
 }
 
+void ElementaryStreamQueue::consumeBuffer(size_t size) {
+    // Only the range moves; appendData() shifts the remaining data back to
+    // the start of the buffer once it runs out of room at the end.
+    mBuffer->setRange(mBuffer->offset() + size, mBuffer->size() - size);
+}
+
 void ElementaryStreamQueue::clear(bool clearFormat) {
     if (mBuffer != NULL) {
         mBuffer->setRange(0, 0);
@@ -263,6 +269,13 @@ status_t ElementaryStreamQueue::appendData(
     }
 
     size_t neededSize = (mBuffer == NULL ? 0 : mBuffer->size()) + size;
+    if (mBuffer != NULL && mBuffer->offset() + neededSize > mBuffer->capacity()
+            && neededSize <= mBuffer->capacity()) {
+        // Reclaim the space of the access units dequeued so far.
+        memmove(mBuffer->base(), mBuffer->data(), mBuffer->size());
+        mBuffer->setRange(0, mBuffer->size());
+    }
+
     if (mBuffer == NULL || neededSize > mBuffer->capacity()) {
         neededSize = (neededSize + 65535) & ~65535;
 
@@ -280,7 +293,7 @@ status_t ElementaryStreamQueue::appendData(
     }
 
     memcpy(mBuffer->data() + mBuffer->size(), data, size);
-    mBuffer->setRange(0, mBuffer->size() + size);
+    mBuffer->setRange(mBuffer->offset(), mBuffer->size() + size);
 
     RangeInfo info;
     info.mLength = size;
@@ -310,11 +323,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnit() {
         memcpy(accessUnit->data(), mBuffer->data(), info.mLength);
         accessUnit->meta()->setInt64("timeUs", info.mTimestampUs);
 
-        memmove(mBuffer->data(),
-                mBuffer->data() + info.mLength,
-                mBuffer->size() - info.mLength);
-
-        mBuffer->setRange(0, mBuffer->size() - info.mLength);
+        consumeBuffer(info.mLength);
 
         if (mFormat == NULL) {
             mFormat = MakeAVCCodecSpecificData(accessUnit);
@@ -384,12 +393,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitPCMAudio() {
         ptr[i] = ntohs(ptr[i]);
     }
 
-    memmove(
-            mBuffer->data(),
-            mBuffer->data() + 4 + payloadSize,
-            mBuffer->size() - 4 - payloadSize);
-
-    mBuffer->setRange(0, mBuffer->size() - 4 - payloadSize);
+    consumeBuffer(4 + payloadSize);
 
     return accessUnit;
 }
@@ -484,9 +488,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitAAC() {
     sp<ABuffer> accessUnit = new ABuffer(offset);
     memcpy(accessUnit->data(), mBuffer->data(), offset);
 
-    memmove(mBuffer->data(), mBuffer->data() + offset,
-            mBuffer->size() - offset);
-    mBuffer->setRange(0, mBuffer->size() - offset);
+    consumeBuffer(offset);
 
     accessUnit->meta()->setInt64("timeUs", timeUs);
 
@@ -609,11 +611,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
             const NALPosition &pos = nals.itemAt(nals.size() - 1);
             size_t nextScan = pos.nalOffset + pos.nalSize;
 
-            memmove(mBuffer->data(),
-                    mBuffer->data() + nextScan,
-                    mBuffer->size() - nextScan);
-
-            mBuffer->setRange(0, mBuffer->size() - nextScan);
+            consumeBuffer(nextScan);
 
             int64_t timeUs = fetchTimestamp(nextScan);
             CHECK_GE(timeUs, 0ll);
@@ -665,11 +663,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGAudio() {
     sp<ABuffer> accessUnit = new ABuffer(frameSize);
     memcpy(accessUnit->data(), data, frameSize);
 
-    memmove(mBuffer->data(),
-            mBuffer->data() + frameSize,
-            mBuffer->size() - frameSize);
-
-    mBuffer->setRange(0, mBuffer->size() - frameSize);
+    consumeBuffer(frameSize);
 
     int64_t timeUs = fetchTimestamp(frameSize);
     CHECK_GE(timeUs, 0ll);
@@ -764,11 +758,11 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
         currentStartCode = data[offset + 3];
 
         if (currentStartCode == 0xb3 && mFormat == NULL) {
-            memmove(mBuffer->data(), mBuffer->data() + offset, size - offset);
+            consumeBuffer(offset);
+            data = mBuffer->data();
             size -= offset;
             (void)fetchTimestamp(offset);
             offset = 0;
-            mBuffer->setRange(0, size);
         }
 
         if ((prevStartCode == 0xb3 && currentStartCode != 0xb5)
@@ -794,11 +788,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
                 sp<ABuffer> csd = new ABuffer(offset);
                 memcpy(csd->data(), data, offset);
 
-                memmove(mBuffer->data(),
-                        mBuffer->data() + offset,
-                        mBuffer->size() - offset);
-
-                mBuffer->setRange(0, mBuffer->size() - offset);
+                consumeBuffer(offset);
                 size -= offset;
                 (void)fetchTimestamp(offset);
                 offset = 0;
@@ -822,11 +812,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
                 sp<ABuffer> accessUnit = new ABuffer(offset);
                 memcpy(accessUnit->data(), data, offset);
 
-                memmove(mBuffer->data(),
-                        mBuffer->data() + offset,
-                        mBuffer->size() - offset);
-
-                mBuffer->setRange(0, mBuffer->size() - offset);
+                consumeBuffer(offset);
 
                 int64_t timeUs = fetchTimestamp(offset);
                 CHECK_GE(timeUs, 0ll);
@@ -983,9 +969,9 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEG4Video() {
                     sp<ABuffer> accessUnit = new ABuffer(offset);
                     memcpy(accessUnit->data(), data, offset);
 
-                    memmove(data, &data[offset], size - offset);
+                    consumeBuffer(offset);
+                    data = mBuffer->data();
                     size -= offset;
-                    mBuffer->setRange(0, size);
 
                     int64_t timeUs = fetchTimestamp(offset);
                     CHECK_GE(timeUs, 0ll);
@@ -1014,10 +1000,10 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEG4Video() {
 
         if (discard) {
             (void)fetchTimestamp(offset);
-            memmove(data, &data[offset], size - offset);
+            consumeBuffer(offset);
+            data = mBuffer->data();
             size -= offset;
             offset = 0;
-            mBuffer->setRange(0, size);
         } else {
             offset += chunkSize;
         }
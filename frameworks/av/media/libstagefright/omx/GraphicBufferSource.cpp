@@ -31,6 +31,49 @@ namespace android {
 
 static const bool EXTRA_CHECK = true;
 
+// Hashes the visible pixels of an RGB buffer, 32 bits at a time.  Returns
+// false if the buffer can't be read back or has a format we don't know the
+// layout of, in which case the frame has to be assumed to have changed.
+static bool HashGraphicBuffer(const sp<GraphicBuffer> &buffer, uint32_t *hash) {
+    size_t bpp;
+    switch (buffer->getPixelFormat()) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            bpp = 4;
+            break;
+        case HAL_PIXEL_FORMAT_RGB_565:
+            bpp = 2;
+            break;
+        default:
+            return false;
+    }
+
+    void *vaddr;
+    if (buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &vaddr) != OK) {
+        return false;
+    }
+
+    // Rows are hashed up to the last whole word, the few trailing bytes of
+    // an odd width RGB565 row are ignored.
+    size_t words = buffer->getWidth() * bpp / 4;
+    size_t strideBytes = buffer->getStride() * bpp;
+    uint32_t h = 2166136261u;
+    const uint8_t *row = (const uint8_t *)vaddr;
+    for (uint32_t y = 0; y < buffer->getHeight(); ++y) {
+        const uint32_t *p = (const uint32_t *)row;
+        for (size_t x = 0; x < words; ++x) {
+            h = (h ^ p[x]) * 16777619u;
+        }
+        row += strideBytes;
+    }
+
+    buffer->unlock();
+
+    *hash = h;
+    return true;
+}
+
 
 GraphicBufferSource::GraphicBufferSource(OMXNodeInstance* nodeInstance,
         uint32_t bufferWidth, uint32_t bufferHeight, uint32_t bufferCount) :
@@ -45,6 +88,13 @@ GraphicBufferSource::GraphicBufferSource(OMXNodeInstance* nodeInstance,
     mMaxTimestampGapUs(-1ll),
     mPrevOriginalTimeUs(-1ll),
     mPrevModifiedTimeUs(-1ll),
+    mMinFrameIntervalUs(-1ll),
+    mPrevKeptFrameTimeUs(-1ll),
+    mDropDuplicateFrames(false),
+    mPrevKeptFrameHashValid(false),
+    mPrevKeptFrameHash(0),
+    mMaxFrameLatencyUs(-1ll),
+    mNumFramesDropped(0),
     mRepeatLastFrameGeneration(0),
     mRepeatLastFrameTimestamp(-1ll),
     mLatestSubmittedBufferId(-1),
@@ -179,8 +229,9 @@ void GraphicBufferSource::omxLoaded(){
         mLooper.clear();
     }
 
-    ALOGV("--> loaded; avail=%d eos=%d eosSent=%d",
-            mNumFramesAvailable, mEndOfStream, mEndOfStreamSent);
+    ALOGV("--> loaded; avail=%d eos=%d eosSent=%d dropped=%u",
+            mNumFramesAvailable, mEndOfStream, mEndOfStreamSent,
+            mNumFramesDropped);
 
     // Codec is no longer executing.  Discard all codec-related state.
     mCodecBuffers.clear();
@@ -384,34 +435,56 @@ bool GraphicBufferSource::fillCodecBuffer_l() {
         return false;
     }
 
-    ALOGV("fillCodecBuffer_l: acquiring buffer, avail=%d",
-            mNumFramesAvailable);
     BufferQueue::BufferItem item;
-    status_t err = mBufferQueue->acquireBuffer(&item, 0);
-    if (err == BufferQueue::NO_BUFFER_AVAILABLE) {
-        // shouldn't happen
-        ALOGW("fillCodecBuffer_l: frame was not available");
-        return false;
-    } else if (err != OK) {
-        // now what? fake end-of-stream?
-        ALOGW("fillCodecBuffer_l: acquireBuffer returned err=%d", err);
-        return false;
-    }
+    status_t err;
+    for (;;) {
+        ALOGV("fillCodecBuffer_l: acquiring buffer, avail=%d",
+                mNumFramesAvailable);
+        err = mBufferQueue->acquireBuffer(&item, 0);
+        if (err == BufferQueue::NO_BUFFER_AVAILABLE) {
+            // shouldn't happen
+            ALOGW("fillCodecBuffer_l: frame was not available");
+            return false;
+        } else if (err != OK) {
+            // now what? fake end-of-stream?
+            ALOGW("fillCodecBuffer_l: acquireBuffer returned err=%d", err);
+            return false;
+        }
 
-    mNumFramesAvailable--;
+        mNumFramesAvailable--;
 
-    // Wait for it to become available.
-    err = item.mFence->waitForever("GraphicBufferSource::fillCodecBuffer_l");
-    if (err != OK) {
-        ALOGW("failed to wait for buffer fence: %d", err);
-        // keep going
-    }
+        // Wait for it to become available.
+        err = item.mFence->waitForever("GraphicBufferSource::fillCodecBuffer_l");
+        if (err != OK) {
+            ALOGW("failed to wait for buffer fence: %d", err);
+            // keep going
+        }
+
+        // If this is the first time we're seeing this buffer, add it to our
+        // slot table.
+        if (item.mGraphicBuffer != NULL) {
+            ALOGV("fillCodecBuffer_l: setting mBufferSlot %d", item.mBuf);
+            mBufferSlot[item.mBuf] = item.mGraphicBuffer;
+        }
+
+        if (!shouldDropFrame_l(item)) {
+            break;
+        }
 
-    // If this is the first time we're seeing this buffer, add it to our
-    // slot table.
-    if (item.mGraphicBuffer != NULL) {
-        ALOGV("fillCodecBuffer_l: setting mBufferSlot %d", item.mBuf);
-        mBufferSlot[item.mBuf] = item.mGraphicBuffer;
+        ++mNumFramesDropped;
+        mBufferQueue->releaseBuffer(item.mBuf, item.mFrameNumber,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE);
+
+        if (mNumFramesAvailable == 0) {
+            // The encoder keeps the frame it had, nothing else is coming
+            // until the next onFrameAvailable.
+            if (mEndOfStream) {
+                submitEndOfInputStream_l();
+            } else {
+                scheduleRepeatAfterDrop_l(item);
+            }
+            return false;
+        }
     }
 
     err = submitBuffer_l(item, cbi);
@@ -488,6 +561,66 @@ bool GraphicBufferSource::repeatLatestSubmittedBuffer_l() {
     return true;
 }
 
+bool GraphicBufferSource::shouldDropFrame_l(
+        const BufferQueue::BufferItem &item) {
+    int64_t timeUs = item.mTimestamp / 1000;
+
+    if (mMaxFrameLatencyUs > 0ll && mNumFramesAvailable > 0
+            && ALooper::GetNowUs() - timeUs > mMaxFrameLatencyUs) {
+        ALOGV("dropping stale frame %lld", timeUs);
+        return true;
+    }
+
+    if (mMinFrameIntervalUs > 0ll && mPrevKeptFrameTimeUs >= 0ll) {
+        // Allow for some jitter, or a source running at exactly the maximum
+        // rate would lose frames now and then.
+        int64_t minTimeUs = mPrevKeptFrameTimeUs + mMinFrameIntervalUs
+                - mMinFrameIntervalUs / 4;
+        if (timeUs < minTimeUs && timeUs >= mPrevKeptFrameTimeUs) {
+            ALOGV("dropping frame %lld above max fps", timeUs);
+            return true;
+        }
+    }
+
+    if (mDropDuplicateFrames) {
+        uint32_t hash;
+        if (mBufferSlot[item.mBuf] != NULL
+                && HashGraphicBuffer(mBufferSlot[item.mBuf], &hash)) {
+            if (mPrevKeptFrameHashValid && hash == mPrevKeptFrameHash) {
+                ALOGV("dropping duplicate frame %lld", timeUs);
+                return true;
+            }
+            mPrevKeptFrameHash = hash;
+            mPrevKeptFrameHashValid = true;
+        } else {
+            mPrevKeptFrameHashValid = false;
+        }
+    }
+
+    mPrevKeptFrameTimeUs = timeUs;
+    return false;
+}
+
+void GraphicBufferSource::scheduleRepeatAfterDrop_l(
+        const BufferQueue::BufferItem &item) {
+    // onFrameAvailable() cancelled the pending repeat, restart it as if the
+    // dropped frame had been a repeat of the latest submitted one.  This
+    // doesn't refill the repeat count, a static screen still only gets
+    // kRepeatLastFrameCount repeats.
+    if (mReflector == NULL || mLatestSubmittedBufferId < 0
+            || mRepeatLastFrameCount <= 0) {
+        return;
+    }
+
+    if (item.mTimestamp > mRepeatLastFrameTimestamp - mRepeatAfterUs * 1000) {
+        mRepeatLastFrameTimestamp = item.mTimestamp + mRepeatAfterUs * 1000;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatRepeatLastFrame, mReflector->id());
+    msg->setInt32("generation", ++mRepeatLastFrameGeneration);
+    msg->post(mRepeatAfterUs);
+}
+
 void GraphicBufferSource::setLatestSubmittedBuffer_l(
         const BufferQueue::BufferItem &item) {
     ALOGV("setLatestSubmittedBuffer_l");
@@ -762,6 +895,49 @@ status_t GraphicBufferSource::setMaxTimestampGapUs(int64_t maxGapUs) {
 
     return OK;
 }
+
+status_t GraphicBufferSource::setMaxFps(float maxFps) {
+    Mutex::Autolock autoLock(mMutex);
+
+    if (mExecuting || maxFps <= 0.0f) {
+        return INVALID_OPERATION;
+    }
+
+    mMinFrameIntervalUs = (int64_t)(1000000.0f / maxFps);
+
+    return OK;
+}
+
+status_t GraphicBufferSource::setDropDuplicateFrames(bool drop) {
+    Mutex::Autolock autoLock(mMutex);
+
+    if (mExecuting) {
+        return INVALID_OPERATION;
+    }
+
+    if (drop && !mDropDuplicateFrames) {
+        // The buffers have to be readable by the CPU for the comparison;
+        // this has to happen before the producer allocates them.
+        mBufferQueue->setConsumerUsageBits(GRALLOC_USAGE_HW_VIDEO_ENCODER |
+                GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_SW_READ_OFTEN);
+    }
+
+    mDropDuplicateFrames = drop;
+
+    return OK;
+}
+
+status_t GraphicBufferSource::setMaxFrameLatencyUs(int64_t maxLatencyUs) {
+    Mutex::Autolock autoLock(mMutex);
+
+    if (mExecuting || maxLatencyUs <= 0ll) {
+        return INVALID_OPERATION;
+    }
+
+    mMaxFrameLatencyUs = maxLatencyUs;
+
+    return OK;
+}
 void GraphicBufferSource::onMessageReceived(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatRepeatLastFrame:
@@ -118,6 +118,22 @@ public:
     // of suspension on input.
     status_t setMaxTimestampGapUs(int64_t maxGapUs);
 
+    // Frames that arrive less than 1/maxFps after the previous frame sent to
+    // the encoder are dropped.
+    status_t setMaxFps(float maxFps);
+
+    // When enabled, frames whose content is identical to the previous frame
+    // sent to the encoder are dropped; if a repeat delay is set, the
+    // previous frame is repeated instead as if no new frame had arrived.
+    // The comparison reads the frame back with the CPU, so this is meant
+    // for mostly static content such as screen recording or wifi display.
+    status_t setDropDuplicateFrames(bool drop);
+
+    // A frame that is older than maxLatencyUs by the time it's acquired is
+    // dropped if a newer frame is already waiting behind it, so that an
+    // encoder that fell behind catches up instead of adding latency.
+    status_t setMaxFrameLatencyUs(int64_t maxLatencyUs);
+
 protected:
     // BufferQueue::ConsumerListener interface, called when a new frame of
     // data is available.  If we're executing and a codec buffer is
@@ -178,6 +194,14 @@ private:
 
     void setLatestSubmittedBuffer_l(const BufferQueue::BufferItem &item);
     bool repeatLatestSubmittedBuffer_l();
+
+    // Applies the frame rate, duplicate and latency policies to a frame
+    // that was just acquired.  Returns true if it should not be encoded.
+    bool shouldDropFrame_l(const BufferQueue::BufferItem &item);
+
+    // Restarts the repeat timer for the latest submitted buffer after the
+    // frame that would have replaced it was dropped.
+    void scheduleRepeatAfterDrop_l(const BufferQueue::BufferItem &item);
     int64_t getTimestamp(const BufferQueue::BufferItem &item);
 
     // Lock, covers all member variables.
@@ -230,6 +254,16 @@ private:
     int64_t mPrevOriginalTimeUs;
     int64_t mPrevModifiedTimeUs;
 
+    // Frame dropping policies, see setMaxFps(), setDropDuplicateFrames() and
+    // setMaxFrameLatencyUs().
+    int64_t mMinFrameIntervalUs;
+    int64_t mPrevKeptFrameTimeUs;
+    bool mDropDuplicateFrames;
+    bool mPrevKeptFrameHashValid;
+    uint32_t mPrevKeptFrameHash;
+    int64_t mMaxFrameLatencyUs;
+    uint32_t mNumFramesDropped;
+
     sp<ALooper> mLooper;
     sp<AHandlerReflector<GraphicBufferSource> > mReflector;
 
@@ -25,7 +25,9 @@
 #include "../include/OMXNodeInstance.h"
 
 #include <binder/IMemory.h>
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <utils/threads.h>
 
 #include "OMXMaster.h"
@@ -75,7 +77,7 @@ private:
 
     sp<CallbackDispatcherThread> mThread;
 
-    void dispatch(const omx_message &msg);
+    void dispatch(const List<omx_message> &messages);
 
     CallbackDispatcher(const CallbackDispatcher &);
     CallbackDispatcher &operator=(const CallbackDispatcher &);
@@ -113,17 +115,17 @@ void OMX::CallbackDispatcher::post(const omx_message &msg) {
     mQueueChanged.signal();
 }
 
-void OMX::CallbackDispatcher::dispatch(const omx_message &msg) {
+void OMX::CallbackDispatcher::dispatch(const List<omx_message> &messages) {
     if (mOwner == NULL) {
         ALOGV("Would have dispatched a message to a node that's already gone.");
         return;
     }
-    mOwner->onMessage(msg);
+    mOwner->onMessages(messages);
 }
 
 bool OMX::CallbackDispatcher::loop() {
     for (;;) {
-        omx_message msg;
+        List<omx_message> messages;
 
         {
             Mutex::Autolock autoLock(mLock);
@@ -135,11 +137,15 @@ bool OMX::CallbackDispatcher::loop() {
                 break;
             }
 
-            msg = *mQueue.begin();
-            mQueue.erase(mQueue.begin());
+            // Take everything that has queued up, so that the buffers the
+            // component returned in a burst reach the observer together.
+            while (!mQueue.empty()) {
+                messages.push_back(*mQueue.begin());
+                mQueue.erase(mQueue.begin());
+            }
         }
 
-        dispatch(msg);
+        dispatch(messages);
     }
 
     return false;
@@ -153,12 +159,70 @@ bool OMX::CallbackDispatcherThread::threadLoop() {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Up to this many decoders that are no longer in use are kept around, for
+// at most this long, in case another client wants the same one.  The count
+// can be overridden with the media.omx.pool_size property, 0 disables it.
+static const size_t kDefaultMaxPooledNodes = 2;
+static const int64_t kMaxPooledNodeAgeUs = 30000000ll;
+
+static bool IsPoolableComponent(const char *name) {
+    // Only the software decoders are known to reset all of their state on
+    // the way back to Loaded, a vendor component may keep stream state or
+    // hardware resources around.  Encoders are set up once per recording
+    // and aren't worth keeping either.
+    return !strncmp(name, "OMX.google.", 11)
+        && strstr(name, ".decoder") != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Frees the pooled instances once they are too old, even if no other node
+// is ever allocated.
+
+struct OMX::NodePoolTrimmerThread : public Thread {
+    NodePoolTrimmerThread(OMX *owner)
+        : mOwner(owner) {
+    }
+
+private:
+    OMX *mOwner;
+
+    bool threadLoop();
+
+    NodePoolTrimmerThread(const NodePoolTrimmerThread &);
+    NodePoolTrimmerThread &operator=(const NodePoolTrimmerThread &);
+};
+
+bool OMX::NodePoolTrimmerThread::threadLoop() {
+    return mOwner->trimNodePoolLoop();
+}
+
 OMX::OMX()
     : mMaster(new OMXMaster),
-      mNodeCounter(0) {
+      mNodeCounter(0),
+      mMaxPooledNodes(kDefaultMaxPooledNodes),
+      mNodePoolDone(false) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.omx.pool_size", value, NULL)) {
+        mMaxPooledNodes = atoi(value);
+    }
 }
 
 OMX::~OMX() {
+    sp<NodePoolTrimmerThread> trimmer;
+    {
+        Mutex::Autolock autoLock(mLock);
+        mNodePoolDone = true;
+        mNodePoolChanged.signal();
+        trimmer = mNodePoolTrimmer;
+    }
+
+    if (trimmer != NULL) {
+        trimmer->join();
+    }
+
+    trimNodePool(0);
+
     delete mMaster;
     mMaster = NULL;
 }
@@ -219,10 +283,42 @@ status_t OMX::listNodes(List<ComponentInfo> *list) {
 
 status_t OMX::allocateNode(
         const char *name, const sp<IOMXObserver> &observer, node_id *node) {
+    status_t err = tryAllocateNode(name, observer, node);
+
+    if (err != OK && trimNodePool(0) > 0) {
+        // Hardware codecs only support so many instances, the pooled ones
+        // may be what's in the way.
+        err = tryAllocateNode(name, observer, node);
+    }
+
+    return err;
+}
+
+status_t OMX::tryAllocateNode(
+        const char *name, const sp<IOMXObserver> &observer, node_id *node) {
     Mutex::Autolock autoLock(mLock);
 
     *node = 0;
 
+    for (size_t i = 0; i < mNodePool.size(); ++i) {
+        if (mNodePool.itemAt(i).mName == name) {
+            OMXNodeInstance *instance = mNodePool.itemAt(i).mInstance;
+            mNodePool.removeAt(i);
+
+            ALOGV("reusing pooled omx component '%s'", name);
+
+            *node = makeNodeID(instance);
+            mDispatchers.add(*node, new CallbackDispatcher(instance));
+
+            instance->unpark(*node, observer);
+
+            mLiveNodes.add(observer->asBinder(), instance);
+            observer->asBinder()->linkToDeath(this);
+
+            return OK;
+        }
+    }
+
     OMXNodeInstance *instance = new OMXNodeInstance(this, observer);
 
     OMX_COMPONENTTYPE *handle;
@@ -242,6 +338,7 @@ status_t OMX::allocateNode(
     mDispatchers.add(*node, new CallbackDispatcher(instance));
 
     instance->setHandle(*node, handle);
+    instance->setComponentName(name);
 
     mLiveNodes.add(observer->asBinder(), instance);
     observer->asBinder()->linkToDeath(this);
@@ -265,18 +362,120 @@ status_t OMX::freeNode(node_id node) {
 
     instance->observer()->asBinder()->unlinkToDeath(this);
 
-    status_t err = instance->freeNode(mMaster);
+    bool pooled = mMaxPooledNodes > 0
+        && IsPoolableComponent(instance->componentName())
+        && instance->park();
+
+    status_t err = OK;
+    if (pooled) {
+        invalidateNodeID(node);
+    } else {
+        err = instance->freeNode(mMaster);
+    }
 
+    sp<CallbackDispatcher> dispatcher;
     {
         Mutex::Autolock autoLock(mLock);
         ssize_t index = mDispatchers.indexOfKey(node);
         CHECK(index >= 0);
+        dispatcher = mDispatchers.valueAt(index);
         mDispatchers.removeItemsAt(index);
     }
 
+    if (pooled) {
+        // Make sure the old client has seen the last of this instance
+        // before it can go to a new one.
+        dispatcher.clear();
+        poolNode(instance);
+    }
+
     return err;
 }
 
+// Takes ownership of a parked instance, making room for it if needed.
+void OMX::poolNode(OMXNodeInstance *instance) {
+    Vector<OMXNodeInstance *> evicted;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        PooledNode entry;
+        entry.mName = instance->componentName();
+        entry.mInstance = instance;
+        entry.mParkedAtUs = ALooper::GetNowUs();
+        mNodePool.push(entry);
+        mNodePoolChanged.signal();
+
+        if (mNodePoolTrimmer == NULL) {
+            mNodePoolTrimmer = new NodePoolTrimmerThread(this);
+            mNodePoolTrimmer->run("OMXNodePool", ANDROID_PRIORITY_BACKGROUND);
+        }
+
+        while (mNodePool.size() > mMaxPooledNodes) {
+            evicted.push(mNodePool.itemAt(0).mInstance);
+            mNodePool.removeAt(0);
+        }
+    }
+
+    for (size_t i = 0; i < evicted.size(); ++i) {
+        evicted.itemAt(i)->freeNode(mMaster);
+    }
+}
+
+// Frees the pooled instances parked for at least maxAgeUs, returns how many.
+size_t OMX::trimNodePool(int64_t maxAgeUs) {
+    Vector<OMXNodeInstance *> evicted;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        int64_t nowUs = ALooper::GetNowUs();
+
+        // Oldest entries come first.
+        while (!mNodePool.empty()
+                && nowUs - mNodePool.itemAt(0).mParkedAtUs >= maxAgeUs) {
+            evicted.push(mNodePool.itemAt(0).mInstance);
+            mNodePool.removeAt(0);
+        }
+    }
+
+    for (size_t i = 0; i < evicted.size(); ++i) {
+        evicted.itemAt(i)->freeNode(mMaster);
+    }
+
+    return evicted.size();
+}
+
+bool OMX::trimNodePoolLoop() {
+    for (;;) {
+        {
+            Mutex::Autolock autoLock(mLock);
+
+            for (;;) {
+                if (mNodePoolDone) {
+                    return false;
+                }
+
+                if (mNodePool.empty()) {
+                    mNodePoolChanged.wait(mLock);
+                    continue;
+                }
+
+                int64_t delayUs = mNodePool.itemAt(0).mParkedAtUs
+                    + kMaxPooledNodeAgeUs - ALooper::GetNowUs();
+
+                if (delayUs <= 0) {
+                    break;
+                }
+
+                mNodePoolChanged.waitRelative(mLock, delayUs * 1000ll);
+            }
+        }
+
+        trimNodePool(kMaxPooledNodeAgeUs);
+    }
+}
+
 status_t OMX::sendCommand(
         node_id node, OMX_COMMANDTYPE cmd, OMX_S32 param) {
     return findInstance(node)->sendCommand(cmd, param);
@@ -402,6 +601,11 @@ status_t OMX::emptyBuffer(
             buffer, range_offset, range_length, flags, timestamp);
 }
 
+status_t OMX::submitBuffers(
+        node_id node, const Vector<BufferRequest> &requests) {
+    return findInstance(node)->submitBuffers(requests);
+}
+
 status_t OMX::getExtensionIndex(
         node_id node,
         const char *parameter_name,
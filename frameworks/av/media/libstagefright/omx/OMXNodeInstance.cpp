@@ -34,6 +34,27 @@ static const OMX_U32 kPortIndexInput = 0;
 
 namespace android {
 
+template<class T>
+static void InitOMXParams(T *params) {
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+    params->nVersion.s.nVersionMinor = 0;
+    params->nVersion.s.nRevision = 0;
+    params->nVersion.s.nStep = 0;
+}
+
+static void UpdatePortMask(OMX_U32 *mask, OMX_U32 portIndex, OMX_BOOL enable) {
+    if (portIndex >= 32) {
+        return;
+    }
+
+    if (enable) {
+        *mask |= 1u << portIndex;
+    } else {
+        *mask &= ~(1u << portIndex);
+    }
+}
+
 struct BufferMeta {
     BufferMeta(const sp<IMemory> &mem, bool is_backup = false)
         : mMem(mem),
@@ -95,7 +116,11 @@ OMXNodeInstance::OMXNodeInstance(
       mNodeID(NULL),
       mHandle(NULL),
       mObserver(observer),
-      mDying(false) {
+      mDying(false),
+      mReusable(true),
+      mGraphicBufferPorts(0),
+      mMetaDataPorts(0),
+      mAdaptivePlaybackPorts(0) {
 }
 
 OMXNodeInstance::~OMXNodeInstance() {
@@ -106,6 +131,31 @@ void OMXNodeInstance::setHandle(OMX::node_id node_id, OMX_HANDLETYPE handle) {
     CHECK(mHandle == NULL);
     mNodeID = node_id;
     mHandle = handle;
+
+    // Remember the default settings of the input and output ports, park()
+    // restores them before the component is handed to another client.
+    for (OMX_U32 portIndex = 0; portIndex < 2; ++portIndex) {
+        OMX_PARAM_PORTDEFINITIONTYPE def;
+        InitOMXParams(&def);
+        def.nPortIndex = portIndex;
+
+        if (OMX_GetParameter(
+                    mHandle, OMX_IndexParamPortDefinition, &def)
+                != OMX_ErrorNone) {
+            mReusable = false;
+            break;
+        }
+
+        mInitialPortDefs.push(def);
+    }
+}
+
+void OMXNodeInstance::setComponentName(const char *name) {
+    mComponentName = name;
+}
+
+const char *OMXNodeInstance::componentName() const {
+    return mComponentName.string();
 }
 
 sp<GraphicBufferSource> OMXNodeInstance::getGraphicBufferSource() {
@@ -143,6 +193,89 @@ static status_t StatusFromOMXError(OMX_ERRORTYPE err) {
 }
 
 status_t OMXNodeInstance::freeNode(OMXMaster *master) {
+    returnToLoaded();
+
+    ALOGV("calling destroyComponentInstance");
+    OMX_ERRORTYPE err = master->destroyComponentInstance(
+            static_cast<OMX_COMPONENTTYPE *>(mHandle));
+    ALOGV("destroyComponentInstance returned err %d", err);
+
+    mHandle = NULL;
+
+    if (err != OMX_ErrorNone) {
+        ALOGE("FreeHandle FAILED with error 0x%08x.", err);
+    }
+
+    mOwner->invalidateNodeID(mNodeID);
+    mNodeID = NULL;
+
+    ALOGV("OMXNodeInstance going away.");
+    delete this;
+
+    return StatusFromOMXError(err);
+}
+
+bool OMXNodeInstance::park() {
+    if (!mReusable || !returnToLoaded()) {
+        return false;
+    }
+
+    // Undo the extensions the client turned on, the next one may not want
+    // them.
+    for (OMX_U32 portIndex = 0; portIndex < 32; ++portIndex) {
+        OMX_U32 bit = 1u << portIndex;
+
+        if (((mGraphicBufferPorts & bit)
+                    && enableGraphicBuffers(portIndex, OMX_FALSE) != OK)
+                || ((mMetaDataPorts & bit)
+                    && storeMetaDataInBuffers(portIndex, OMX_FALSE) != OK)
+                || ((mAdaptivePlaybackPorts & bit)
+                    && prepareForAdaptivePlayback(
+                        portIndex, OMX_FALSE, 0, 0) != OK)) {
+            return false;
+        }
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    if (!mActiveBuffers.empty()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < mInitialPortDefs.size(); ++i) {
+        OMX_PARAM_PORTDEFINITIONTYPE def = mInitialPortDefs.itemAt(i);
+
+        OMX_PARAM_PORTDEFINITIONTYPE current;
+        InitOMXParams(&current);
+        current.nPortIndex = def.nPortIndex;
+
+        // A port left disabled would need a command round trip to bring
+        // back, not worth it.
+        if (OMX_GetParameter(
+                    mHandle, OMX_IndexParamPortDefinition, &current)
+                    != OMX_ErrorNone
+                || current.bEnabled != def.bEnabled
+                || OMX_SetParameter(
+                    mHandle, OMX_IndexParamPortDefinition, &def)
+                    != OMX_ErrorNone) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void OMXNodeInstance::unpark(
+        OMX::node_id node_id, const sp<IOMXObserver> &observer) {
+    Mutex::Autolock autoLock(mLock);
+
+    mNodeID = node_id;
+    mObserver = observer;
+    mDying = false;
+}
+
+// Returns true if the component made it to the Loaded state.
+bool OMXNodeInstance::returnToLoaded() {
     static int32_t kMaxNumIterations = 10;
 
     // Transition the node from its current state all the way down
@@ -220,24 +353,7 @@ status_t OMXNodeInstance::freeNode(OMXMaster *master) {
             break;
     }
 
-    ALOGV("calling destroyComponentInstance");
-    OMX_ERRORTYPE err = master->destroyComponentInstance(
-            static_cast<OMX_COMPONENTTYPE *>(mHandle));
-    ALOGV("destroyComponentInstance returned err %d", err);
-
-    mHandle = NULL;
-
-    if (err != OMX_ErrorNone) {
-        ALOGE("FreeHandle FAILED with error 0x%08x.", err);
-    }
-
-    mOwner->invalidateNodeID(mNodeID);
-    mNodeID = NULL;
-
-    ALOGV("OMXNodeInstance going away.");
-    delete this;
-
-    return StatusFromOMXError(err);
+    return state == OMX_StateLoaded;
 }
 
 status_t OMXNodeInstance::sendCommand(
@@ -345,6 +461,8 @@ status_t OMXNodeInstance::enableGraphicBuffers(
         return UNKNOWN_ERROR;
     }
 
+    UpdatePortMask(&mGraphicBufferPorts, portIndex, enable);
+
     return OK;
 }
 
@@ -419,6 +537,7 @@ status_t OMXNodeInstance::storeMetaDataInBuffers_l(
         ALOGE("OMX_SetParameter() failed for StoreMetaDataInBuffers: 0x%08x", err);
         return UNKNOWN_ERROR;
     }
+    UpdatePortMask(&mMetaDataPorts, portIndex, enable);
     return err;
 }
 
@@ -453,6 +572,7 @@ status_t OMXNodeInstance::prepareForAdaptivePlayback(
               "with error %d (0x%08x)", err, err);
         return UNKNOWN_ERROR;
     }
+    UpdatePortMask(&mAdaptivePlaybackPorts, portIndex, enable);
     return err;
 }
 
@@ -669,6 +789,9 @@ status_t OMXNodeInstance::createInputSurface(
     }
     setGraphicBufferSource(bufferSource);
 
+    // The buffer source stays attached to this node for good.
+    mReusable = false;
+
     *bufferProducer = bufferSource->getIGraphicBufferProducer();
     return OK;
 }
@@ -780,6 +903,10 @@ status_t OMXNodeInstance::freeBuffer(
 status_t OMXNodeInstance::fillBuffer(OMX::buffer_id buffer) {
     Mutex::Autolock autoLock(mLock);
 
+    return fillBuffer_l(buffer);
+}
+
+status_t OMXNodeInstance::fillBuffer_l(OMX::buffer_id buffer) {
     OMX_BUFFERHEADERTYPE *header = (OMX_BUFFERHEADERTYPE *)buffer;
     header->nFilledLen = 0;
     header->nOffset = 0;
@@ -796,6 +923,13 @@ status_t OMXNodeInstance::emptyBuffer(
         OMX_U32 flags, OMX_TICKS timestamp) {
     Mutex::Autolock autoLock(mLock);
 
+    return emptyBuffer_l(buffer, rangeOffset, rangeLength, flags, timestamp);
+}
+
+status_t OMXNodeInstance::emptyBuffer_l(
+        OMX::buffer_id buffer,
+        OMX_U32 rangeOffset, OMX_U32 rangeLength,
+        OMX_U32 flags, OMX_TICKS timestamp) {
     OMX_BUFFERHEADERTYPE *header = (OMX_BUFFERHEADERTYPE *)buffer;
     header->nFilledLen = rangeLength;
     header->nOffset = rangeOffset;
@@ -811,6 +945,33 @@ status_t OMXNodeInstance::emptyBuffer(
     return StatusFromOMXError(err);
 }
 
+status_t OMXNodeInstance::submitBuffers(
+        const Vector<IOMX::BufferRequest> &requests) {
+    Mutex::Autolock autoLock(mLock);
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const IOMX::BufferRequest &request = requests[i];
+
+        status_t err;
+        if (request.mIsEmpty) {
+            err = emptyBuffer_l(
+                    request.mBuffer, request.mRangeOffset,
+                    request.mRangeLength, request.mFlags,
+                    request.mTimestamp);
+        } else {
+            err = fillBuffer_l(request.mBuffer);
+        }
+
+        if (err != OK) {
+            ALOGW("submitBuffers failed at request %d of %d, err=%d",
+                    i, requests.size(), err);
+            return err;
+        }
+    }
+
+    return OK;
+}
+
 // like emptyBuffer, but the data is already in header->pBuffer
 status_t OMXNodeInstance::emptyDirectBuffer(
         OMX_BUFFERHEADERTYPE *header,
@@ -850,6 +1011,9 @@ status_t OMXNodeInstance::setInternalOption(
         case IOMX::INTERNAL_OPTION_SUSPEND:
         case IOMX::INTERNAL_OPTION_REPEAT_PREVIOUS_FRAME_DELAY:
         case IOMX::INTERNAL_OPTION_MAX_TIMESTAMP_GAP:
+        case IOMX::INTERNAL_OPTION_MAX_FPS:
+        case IOMX::INTERNAL_OPTION_DROP_DUPLICATE_FRAMES:
+        case IOMX::INTERNAL_OPTION_MAX_FRAME_LATENCY:
         {
             const sp<GraphicBufferSource> &bufferSource =
                 getGraphicBufferSource();
@@ -874,6 +1038,30 @@ status_t OMXNodeInstance::setInternalOption(
                 int64_t delayUs = *(int64_t *)data;
 
                 return bufferSource->setRepeatPreviousFrameDelayUs(delayUs);
+            } else if (type == IOMX::INTERNAL_OPTION_MAX_FPS) {
+                if (size != sizeof(float)) {
+                    return INVALID_OPERATION;
+                }
+
+                float maxFps = *(float *)data;
+
+                return bufferSource->setMaxFps(maxFps);
+            } else if (type == IOMX::INTERNAL_OPTION_DROP_DUPLICATE_FRAMES) {
+                if (size != sizeof(bool)) {
+                    return INVALID_OPERATION;
+                }
+
+                bool drop = *(bool *)data;
+
+                return bufferSource->setDropDuplicateFrames(drop);
+            } else if (type == IOMX::INTERNAL_OPTION_MAX_FRAME_LATENCY) {
+                if (size != sizeof(int64_t)) {
+                    return INVALID_OPERATION;
+                }
+
+                int64_t maxLatencyUs = *(int64_t *)data;
+
+                return bufferSource->setMaxFrameLatencyUs(maxLatencyUs);
             } else {
                 if (size != sizeof(int64_t)) {
                     return INVALID_OPERATION;
@@ -893,6 +1081,32 @@ status_t OMXNodeInstance::setInternalOption(
 }
 
 void OMXNodeInstance::onMessage(const omx_message &msg) {
+    omx_message newMsg = msg;
+    if (handleMessage(newMsg)) {
+        mObserver->onMessage(newMsg);
+    }
+}
+
+void OMXNodeInstance::onMessages(const List<omx_message> &messages) {
+    List<omx_message> forward;
+    for (List<omx_message>::const_iterator it = messages.begin();
+            it != messages.end(); ++it) {
+        omx_message msg = *it;
+        if (handleMessage(msg)) {
+            forward.push_back(msg);
+        }
+    }
+
+    if (forward.size() == 1) {
+        mObserver->onMessage(*forward.begin());
+    } else if (!forward.empty()) {
+        mObserver->onMessages(forward);
+    }
+}
+
+// Does our own processing of a message from the component, possibly
+// updating it, and returns false if it must not reach the observer.
+bool OMXNodeInstance::handleMessage(omx_message &msg) {
     const sp<GraphicBufferSource>& bufferSource(getGraphicBufferSource());
 
     if (msg.type == omx_message::FILL_BUFFER_DONE) {
@@ -909,10 +1123,7 @@ void OMXNodeInstance::onMessage(const omx_message &msg) {
             // fix up the buffer info (especially timestamp) if needed
             bufferSource->codecBufferFilled(buffer);
 
-            omx_message newMsg = msg;
-            newMsg.u.extended_buffer_data.timestamp = buffer->nTimeStamp;
-            mObserver->onMessage(newMsg);
-            return;
+            msg.u.extended_buffer_data.timestamp = buffer->nTimeStamp;
         }
     } else if (msg.type == omx_message::EMPTY_BUFFER_DONE) {
         if (bufferSource != NULL) {
@@ -927,11 +1138,11 @@ void OMXNodeInstance::onMessage(const omx_message &msg) {
                         msg.u.buffer_data.buffer);
 
             bufferSource->codecBufferEmptied(buffer);
-            return;
+            return false;
         }
     }
 
-    mObserver->onMessage(msg);
+    return true;
 }
 
 void OMXNodeInstance::onObserverDied(OMXMaster *master) {
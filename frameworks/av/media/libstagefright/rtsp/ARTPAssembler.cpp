@@ -25,8 +25,22 @@
 
 namespace android {
 
+static const int64_t kMinLossTimeoutUs = 10000ll;
+static const int64_t kMaxLossTimeoutUs = 200000ll;
+
 ARTPAssembler::ARTPAssembler()
-    : mFirstFailureTimeUs(-1) {
+    : mFirstFailureTimeUs(-1),
+      mLossTimeoutUs(kMinLossTimeoutUs),
+      mMinLossTimeoutUs(kMinLossTimeoutUs) {
+}
+
+void ARTPAssembler::setMinLossTimeoutUs(int64_t timeoutUs) {
+    mMinLossTimeoutUs =
+        timeoutUs < kMaxLossTimeoutUs ? timeoutUs : kMaxLossTimeoutUs;
+
+    if (mLossTimeoutUs < mMinLossTimeoutUs) {
+        mLossTimeoutUs = mMinLossTimeoutUs;
+    }
 }
 
 void ARTPAssembler::onPacketReceived(const sp<ARTPSource> &source) {
@@ -36,9 +50,13 @@ void ARTPAssembler::onPacketReceived(const sp<ARTPSource> &source) {
 
         if (status == WRONG_SEQUENCE_NUMBER) {
             if (mFirstFailureTimeUs >= 0) {
-                if (ALooper::GetNowUs() - mFirstFailureTimeUs > 10000ll) {
+                if (ALooper::GetNowUs() - mFirstFailureTimeUs > mLossTimeoutUs) {
                     mFirstFailureTimeUs = -1;
 
+                    // The packet really is gone, be a little less patient
+                    // next time.
+                    mLossTimeoutUs -= (mLossTimeoutUs - mMinLossTimeoutUs) / 8;
+
                     // LOG(VERBOSE) << "waited too long for packet.";
                     packetLost();
                     continue;
@@ -48,6 +66,15 @@ void ARTPAssembler::onPacketReceived(const sp<ARTPSource> &source) {
             }
             break;
         } else {
+            if (mFirstFailureTimeUs >= 0) {
+                // A late packet closed the gap; leave twice that much
+                // room for the next one.
+                int64_t roomUs = 2 * (ALooper::GetNowUs() - mFirstFailureTimeUs);
+                if (roomUs > mLossTimeoutUs) {
+                    mLossTimeoutUs =
+                        roomUs < kMaxLossTimeoutUs ? roomUs : kMaxLossTimeoutUs;
+                }
+            }
             mFirstFailureTimeUs = -1;
 
             if (status == NOT_ENOUGH_DATA) {
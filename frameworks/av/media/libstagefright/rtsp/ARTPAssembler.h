@@ -40,6 +40,13 @@ struct ARTPAssembler : public RefBase {
     void onPacketReceived(const sp<ARTPSource> &source);
     virtual void onByeReceived() = 0;
 
+    // True while assembly is stalled on a missing packet.
+    bool isWaitingForPacket() const { return mFirstFailureTimeUs >= 0; }
+
+    // Never give up on a missing packet sooner than this, e.g. to leave
+    // time for a retransmission or FEC to fill the gap.
+    void setMinLossTimeoutUs(int64_t timeoutUs);
+
 protected:
     virtual AssemblyStatus assembleMore(const sp<ARTPSource> &source) = 0;
     virtual void packetLost() = 0;
@@ -58,6 +65,11 @@ protected:
 private:
     int64_t mFirstFailureTimeUs;
 
+    // How long to wait for a missing packet before declaring it lost,
+    // adapted to how late reordered packets have been showing up.
+    int64_t mLossTimeoutUs;
+    int64_t mMinLossTimeoutUs;
+
     DISALLOW_EVIL_CONSTRUCTORS(ARTPAssembler);
 };
 
@@ -37,6 +37,10 @@ namespace android {
 
 static const size_t kMaxUDPSize = 1500;
 
+// Upper bound on the datagrams read from one socket per poll, so that a
+// flooding stream cannot starve the others.
+static const size_t kMaxPacketsPerReceive = 32;
+
 static uint16_t u16at(const uint8_t *data) {
     return data[0] << 8 | data[1];
 }
@@ -64,13 +68,17 @@ struct ARTPConnection::StreamInfo {
     int64_t mNumRTPPacketsReceived;
     struct sockaddr_in mRemoteRTCPAddr;
 
+    // Payload type of the ULPFEC stream protecting this track, or -1.
+    int32_t mFECPayloadType;
+
     bool mIsInjected;
 };
 
 ARTPConnection::ARTPConnection(uint32_t flags)
     : mFlags(flags),
       mPollEventPending(false),
-      mLastReceiverReportTimeUs(-1) {
+      mLastReceiverReportTimeUs(-1),
+      mReceiveBuffer(new ABuffer(65536)) {
 }
 
 ARTPConnection::~ARTPConnection() {
@@ -205,6 +213,12 @@ void ARTPConnection::onAddStream(const sp<AMessage> &msg) {
     info->mNumRTPPacketsReceived = 0;
     memset(&info->mRemoteRTCPAddr, 0, sizeof(info->mRemoteRTCPAddr));
 
+    unsigned long fecPT;
+    info->mFECPayloadType = -1;
+    if (info->mSessionDesc->getFECPayloadType(info->mIndex, &fecPT)) {
+        info->mFECPayloadType = fecPT;
+    }
+
     if (!injected) {
         postPollEvent();
     }
@@ -305,6 +319,17 @@ void ARTPConnection::onPollStreams() {
         }
     }
 
+    // Give the assemblers a chance to declare missing packets lost even
+    // if the stream has stalled and nothing else arrives.
+    for (List<StreamInfo>::iterator it = mStreams.begin();
+         it != mStreams.end(); ++it) {
+        for (size_t i = 0; i < it->mSources.size(); ++i) {
+            it->mSources.valueAt(i)->checkForLostPackets();
+        }
+    }
+
+    sendNACKs();
+
     int64_t nowUs = ALooper::GetNowUs();
     if (mLastReceiverReportTimeUs <= 0
             || mLastReceiverReportTimeUs + 5000000ll <= nowUs) {
@@ -375,39 +400,91 @@ status_t ARTPConnection::receive(StreamInfo *s, bool receiveRTP) {
 
     CHECK(!s->mIsInjected);
 
-    sp<ABuffer> buffer = new ABuffer(65536);
-
-    socklen_t remoteAddrLen =
-        (!receiveRTP && s->mNumRTCPPacketsReceived == 0)
-            ? sizeof(s->mRemoteRTCPAddr) : 0;
-
-    ssize_t nbytes;
-    do {
-        nbytes = recvfrom(
-            receiveRTP ? s->mRTPSocket : s->mRTCPSocket,
-            buffer->data(),
-            buffer->capacity(),
-            0,
-            remoteAddrLen > 0 ? (struct sockaddr *)&s->mRemoteRTCPAddr : NULL,
-            remoteAddrLen > 0 ? &remoteAddrLen : NULL);
-    } while (nbytes < 0 && errno == EINTR);
-
-    if (nbytes <= 0) {
-        return -ECONNRESET;
-    }
+    // Drain whatever the socket has queued up, so a busy stream costs one
+    // poll per batch of datagrams instead of one per datagram. Each one is
+    // read into the shared scratch buffer and copied into a buffer of its
+    // own size, rather than parking a 64k allocation per packet in the
+    // jitter queue.
+    for (size_t i = 0; i < kMaxPacketsPerReceive; ++i) {
+        socklen_t remoteAddrLen =
+            (!receiveRTP && s->mNumRTCPPacketsReceived == 0)
+                ? sizeof(s->mRemoteRTCPAddr) : 0;
+
+        ssize_t nbytes;
+        do {
+            nbytes = recvfrom(
+                receiveRTP ? s->mRTPSocket : s->mRTCPSocket,
+                mReceiveBuffer->data(),
+                mReceiveBuffer->capacity(),
+                i > 0 ? MSG_DONTWAIT : 0,
+                remoteAddrLen > 0 ? (struct sockaddr *)&s->mRemoteRTCPAddr : NULL,
+                remoteAddrLen > 0 ? &remoteAddrLen : NULL);
+        } while (nbytes < 0 && errno == EINTR);
+
+        if (nbytes < 0 && i > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
 
-    buffer->setRange(0, nbytes);
+        if (nbytes <= 0) {
+            return -ECONNRESET;
+        }
 
-    // ALOGI("received %d bytes.", buffer->size());
+        sp<ABuffer> buffer = new ABuffer(nbytes);
+        memcpy(buffer->data(), mReceiveBuffer->data(), nbytes);
 
-    status_t err;
-    if (receiveRTP) {
-        err = parseRTP(s, buffer);
-    } else {
-        err = parseRTCP(s, buffer);
+        // ALOGI("received %d bytes.", buffer->size());
+
+        if (receiveRTP) {
+            parseRTP(s, buffer);
+        } else {
+            parseRTCP(s, buffer);
+        }
     }
 
-    return err;
+    return OK;
+}
+
+void ARTPConnection::sendNACKs() {
+    sp<ABuffer> buffer;
+
+    for (List<StreamInfo>::iterator it = mStreams.begin();
+         it != mStreams.end(); ++it) {
+        StreamInfo *s = &*it;
+
+        if (s->mIsInjected || s->mNumRTCPPacketsReceived == 0) {
+            continue;
+        }
+
+        if (buffer == NULL) {
+            buffer = new ABuffer(kMaxUDPSize);
+        }
+        buffer->setRange(0, 0);
+
+        for (size_t i = 0; i < s->mSources.size(); ++i) {
+            s->mSources.valueAt(i)->addNACK(buffer);
+        }
+
+        if (buffer->size() == 0) {
+            continue;
+        }
+
+        ALOGV("Sending NACK...");
+
+        ssize_t n;
+        do {
+            n = sendto(
+                s->mRTCPSocket, buffer->data(), buffer->size(), 0,
+                (const struct sockaddr *)&s->mRemoteRTCPAddr,
+                sizeof(s->mRemoteRTCPAddr));
+        } while (n < 0 && errno == EINTR);
+
+        if (n <= 0) {
+            // Any real trouble with the socket is dealt with when sending
+            // the next receiver report.
+            ALOGW("failed to send RTCP NACK (%s).",
+                 n == 0 ? "connection gone" : strerror(errno));
+        }
+    }
 }
 
 status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
@@ -478,6 +555,17 @@ status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
 
     uint32_t srcId = u32at(&data[8]);
 
+    if ((int32_t)(data[1] & 0x7f) == s->mFECPayloadType) {
+        // The FEC stream has an SSRC of its own, it protects the media
+        // source of this track.
+        buffer->setRange(payloadOffset, size - payloadOffset);
+
+        if (!s->mSources.isEmpty()) {
+            s->mSources.valueAt(0)->processFECPacket(buffer);
+        }
+        return OK;
+    }
+
     sp<ARTPSource> source = findSource(s, srcId);
 
     uint32_t rtpTime = u32at(&data[4]);
@@ -72,11 +72,15 @@ private:
     bool mPollEventPending;
     int64_t mLastReceiverReportTimeUs;
 
+    // scratch space for incoming datagrams
+    sp<ABuffer> mReceiveBuffer;
+
     void onAddStream(const sp<AMessage> &msg);
     void onRemoveStream(const sp<AMessage> &msg);
     void onPollStreams();
     void onInjectPacket(const sp<AMessage> &msg);
     void onSendReceiverReports();
+    void sendNACKs();
 
     status_t receive(StreamInfo *info, bool receiveRTP);
 
@@ -28,6 +28,7 @@
 #include "AMPEG4ElementaryAssembler.h"
 #include "ARawAudioAssembler.h"
 #include "ASessionDescription.h"
+#include "AULPFECDecoder.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
@@ -37,6 +38,19 @@ namespace android {
 
 static const uint32_t kSourceID = 0xdeadbeef;
 
+// Give a reordered packet this long before asking for it again.
+static const int64_t kNACKDelayUs = 10000ll;
+static const int64_t kNACKRetryIntervalUs = 100000ll;
+static const int32_t kMaxNACKsPerPacket = 3;
+static const int64_t kMaxNACKAgeUs = 500000ll;
+
+// Larger gaps are more likely a sender restart than packet loss.
+static const uint32_t kMaxNACKGap = 64;
+
+// How long the assembler waits for a missing packet when it may still be
+// retransmitted or recovered from FEC.
+static const int64_t kRepairLossTimeoutUs = 100000ll;
+
 ARTPSource::ARTPSource(
         uint32_t id,
         const sp<ASessionDescription> &sessionDesc, size_t index,
@@ -49,6 +63,7 @@ ARTPSource::ARTPSource(
       mIssueFIRRequests(false),
       mLastFIRRequestUs(-1),
       mNextFIRSeqNo((rand() * 256.0) / RAND_MAX),
+      mIssueNACKs(false),
       mNotify(notify) {
     unsigned long PT;
     AString desc;
@@ -79,6 +94,17 @@ ARTPSource::ARTPSource(
     } else {
         TRESPASS();
     }
+
+    unsigned long fecPT;
+    if (sessionDesc->getFECPayloadType(index, &fecPT)) {
+        mFECDecoder = new AULPFECDecoder;
+    }
+
+    mIssueNACKs = sessionDesc->hasRTCPFeedback(index, PT, "nack");
+
+    if (mFECDecoder != NULL || mIssueNACKs) {
+        mAssembler->setMinLossTimeoutUs(kRepairLossTimeoutUs);
+    }
 }
 
 static uint32_t AbsDiff(uint32_t seq1, uint32_t seq2) {
@@ -86,9 +112,44 @@ static uint32_t AbsDiff(uint32_t seq1, uint32_t seq2) {
 }
 
 void ARTPSource::processRTPPacket(const sp<ABuffer> &buffer) {
+    if (mFECDecoder != NULL) {
+        mFECDecoder->addMediaPacket(buffer);
+    }
+
     if (queuePacket(buffer) && mAssembler != NULL) {
         mAssembler->onPacketReceived(this);
     }
+
+    recoverPackets();
+}
+
+void ARTPSource::processFECPacket(const sp<ABuffer> &buffer) {
+    if (mFECDecoder == NULL) {
+        return;
+    }
+
+    mFECDecoder->addFECPacket(buffer);
+
+    recoverPackets();
+}
+
+void ARTPSource::recoverPackets() {
+    if (mFECDecoder == NULL) {
+        return;
+    }
+
+    sp<ABuffer> buffer;
+    while ((buffer = mFECDecoder->recoverPacket()) != NULL) {
+        if (queuePacket(buffer) && mAssembler != NULL) {
+            mAssembler->onPacketReceived(this);
+        }
+    }
+}
+
+void ARTPSource::checkForLostPackets() {
+    if (mAssembler != NULL && mAssembler->isWaitingForPacket()) {
+        mAssembler->onPacketReceived(this);
+    }
 }
 
 void ARTPSource::timeUpdate(uint32_t rtpTime, uint64_t ntpTime) {
@@ -138,15 +199,26 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
         seqNum = seq3;
     }
 
+    if (mIssueNACKs) {
+        updatePendingNACKs(seqNum);
+    }
+
     if (seqNum > mHighestSeqNumber) {
         mHighestSeqNumber = seqNum;
     }
 
     buffer->setInt32Data(seqNum);
 
-    List<sp<ABuffer> >::iterator it = mQueue.begin();
-    while (it != mQueue.end() && (uint32_t)(*it)->int32Data() < seqNum) {
-        ++it;
+    // Packets mostly arrive in order, so look for the insertion point
+    // starting from the newest one.
+    List<sp<ABuffer> >::iterator it = mQueue.end();
+    while (it != mQueue.begin()) {
+        List<sp<ABuffer> >::iterator prev = it;
+        --prev;
+        if ((uint32_t)(*prev)->int32Data() < seqNum) {
+            break;
+        }
+        it = prev;
     }
 
     if (it != mQueue.end() && (uint32_t)(*it)->int32Data() == seqNum) {
@@ -159,6 +231,35 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
     return true;
 }
 
+void ARTPSource::updatePendingNACKs(uint32_t seqNum) {
+    if (seqNum <= mHighestSeqNumber) {
+        // A late or retransmitted packet, no need to ask for it anymore.
+        for (List<PendingNACK>::iterator it = mPendingNACKs.begin();
+             it != mPendingNACKs.end(); ++it) {
+            if (it->mSeqNum == seqNum) {
+                mPendingNACKs.erase(it);
+                break;
+            }
+        }
+        return;
+    }
+
+    if (seqNum - mHighestSeqNumber - 1 > kMaxNACKGap) {
+        return;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    for (uint32_t missing = mHighestSeqNumber + 1;
+         missing < seqNum; ++missing) {
+        PendingNACK nack;
+        nack.mSeqNum = missing;
+        nack.mFirstMissingUs = nowUs;
+        nack.mNextNACKUs = nowUs + kNACKDelayUs;
+        nack.mNumNACKs = 0;
+        mPendingNACKs.push_back(nack);
+    }
+}
+
 void ARTPSource::byeReceived() {
     mAssembler->onByeReceived();
 }
@@ -213,6 +314,85 @@ void ARTPSource::addFIR(const sp<ABuffer> &buffer) {
     ALOGV("Added FIR request.");
 }
 
+void ARTPSource::addNACK(const sp<ABuffer> &buffer) {
+    if (mPendingNACKs.empty()) {
+        return;
+    }
+
+    // Generic NACK (RFC 4585), one PID/BLP pair covers up to 17 packets.
+    static const size_t kMaxFCIs = 16;
+
+    if (buffer->size() + 12 + 4 * kMaxFCIs > buffer->capacity()) {
+        ALOGW("RTCP buffer too small to accomodate NACK.");
+        return;
+    }
+
+    uint8_t *data = buffer->data() + buffer->size();
+    uint8_t *fci = NULL;
+    size_t numFCIs = 0;
+    uint32_t PID = 0;
+
+    int64_t nowUs = ALooper::GetNowUs();
+
+    List<PendingNACK>::iterator it = mPendingNACKs.begin();
+    while (it != mPendingNACKs.end()) {
+        if (it->mNumNACKs >= kMaxNACKsPerPacket
+                || it->mFirstMissingUs + kMaxNACKAgeUs <= nowUs) {
+            it = mPendingNACKs.erase(it);
+            continue;
+        }
+
+        if (it->mNextNACKUs > nowUs) {
+            ++it;
+            continue;
+        }
+
+        if (fci == NULL || it->mSeqNum - PID > 16) {
+            if (numFCIs == kMaxFCIs) {
+                break;
+            }
+
+            PID = it->mSeqNum;
+
+            fci = &data[12 + 4 * numFCIs++];
+            fci[0] = (PID >> 8) & 0xff;
+            fci[1] = PID & 0xff;
+            fci[2] = 0x00;  // BLP
+            fci[3] = 0x00;
+        } else {
+            unsigned bit = it->mSeqNum - PID - 1;
+            fci[3 - bit / 8] |= 1 << (bit % 8);
+        }
+
+        it->mNextNACKUs = nowUs + kNACKRetryIntervalUs;
+        ++it->mNumNACKs;
+
+        ++it;
+    }
+
+    if (numFCIs == 0) {
+        return;
+    }
+
+    data[0] = 0x80 | 1;
+    data[1] = 205;  // RTPFB
+    data[2] = 0;
+    data[3] = 2 + numFCIs;
+    data[4] = kSourceID >> 24;
+    data[5] = (kSourceID >> 16) & 0xff;
+    data[6] = (kSourceID >> 8) & 0xff;
+    data[7] = kSourceID & 0xff;
+
+    data[8] = mID >> 24;
+    data[9] = (mID >> 16) & 0xff;
+    data[10] = (mID >> 8) & 0xff;
+    data[11] = mID & 0xff;
+
+    buffer->setRange(buffer->offset(), buffer->size() + 12 + 4 * numFCIs);
+
+    ALOGV("Added NACK for %d packet ranges.", numFCIs);
+}
+
 void ARTPSource::addReceiverReport(const sp<ABuffer> &buffer) {
     if (buffer->size() + 32 > buffer->capacity()) {
         ALOGW("RTCP buffer too small to accomodate RR.");
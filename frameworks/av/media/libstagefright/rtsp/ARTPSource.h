@@ -30,6 +30,7 @@ struct ABuffer;
 struct AMessage;
 struct ARTPAssembler;
 struct ASessionDescription;
+struct AULPFECDecoder;
 
 struct ARTPSource : public RefBase {
     ARTPSource(
@@ -38,6 +39,8 @@ struct ARTPSource : public RefBase {
             const sp<AMessage> &notify);
 
     void processRTPPacket(const sp<ABuffer> &buffer);
+    void processFECPacket(const sp<ABuffer> &buffer);
+    void checkForLostPackets();
     void timeUpdate(uint32_t rtpTime, uint64_t ntpTime);
     void byeReceived();
 
@@ -45,6 +48,7 @@ struct ARTPSource : public RefBase {
 
     void addReceiverReport(const sp<ABuffer> &buffer);
     void addFIR(const sp<ABuffer> &buffer);
+    void addNACK(const sp<ABuffer> &buffer);
 
 private:
     uint32_t mID;
@@ -61,9 +65,23 @@ private:
     int64_t mLastFIRRequestUs;
     uint8_t mNextFIRSeqNo;
 
+    struct PendingNACK {
+        uint32_t mSeqNum;
+        int64_t mFirstMissingUs;
+        int64_t mNextNACKUs;
+        int32_t mNumNACKs;
+    };
+
+    bool mIssueNACKs;
+    List<PendingNACK> mPendingNACKs;  // sorted by sequence number
+
+    sp<AULPFECDecoder> mFECDecoder;
+
     sp<AMessage> mNotify;
 
     bool queuePacket(const sp<ABuffer> &buffer);
+    void updatePendingNACKs(uint32_t seqNum);
+    void recoverPackets();
 
     DISALLOW_EVIL_CONSTRUCTORS(ARTPSource);
 };
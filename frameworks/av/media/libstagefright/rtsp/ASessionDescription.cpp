@@ -115,6 +115,13 @@ bool ASessionDescription::parse(const void *data, size_t size) {
                     }
 
                     value.setTo(line, colonPos + 1, line.size() - colonPos - 1);
+
+                    if (key == "a=rtcp-fb") {
+                        // A track may list several of these, keep them
+                        // apart by using the whole line as the key.
+                        key = line;
+                        value.clear();
+                    }
                 }
 
                 key.trim();
@@ -195,19 +202,62 @@ bool ASessionDescription::findAttribute(
     return true;
 }
 
-void ASessionDescription::getFormatType(
-        size_t index, unsigned long *PT,
-        AString *desc, AString *params) const {
+void ASessionDescription::getPayloadTypes(
+        size_t index, Vector<unsigned long> *PTs) const {
+    PTs->clear();
+
     AString format;
     getFormat(index, &format);
 
-    const char *lastSpacePos = strrchr(format.c_str(), ' ');
-    CHECK(lastSpacePos != NULL);
+    // <media> <port> <proto> <fmt> ...
+    const char *s = format.c_str();
+    for (size_t field = 0; *s != '\0'; ++field) {
+        while (*s == ' ') {
+            ++s;
+        }
 
-    char *end;
-    unsigned long x = strtoul(lastSpacePos + 1, &end, 10);
-    CHECK_GT(end, lastSpacePos + 1);
-    CHECK_EQ(*end, '\0');
+        const char *end = s;
+        while (*end != '\0' && *end != ' ') {
+            ++end;
+        }
+
+        if (field >= 3 && end > s) {
+            char *numEnd;
+            unsigned long x = strtoul(s, &numEnd, 10);
+            if (numEnd == end) {
+                PTs->push(x);
+            }
+        }
+
+        s = end;
+    }
+}
+
+bool ASessionDescription::isFECPayloadType(
+        size_t index, unsigned long PT) const {
+    char key[20];
+    sprintf(key, "a=rtpmap:%lu", PT);
+
+    AString desc;
+    return findAttribute(index, key, &desc)
+        && !strncasecmp(desc.c_str(), "ulpfec/", 7);
+}
+
+void ASessionDescription::getFormatType(
+        size_t index, unsigned long *PT,
+        AString *desc, AString *params) const {
+    Vector<unsigned long> PTs;
+    getPayloadTypes(index, &PTs);
+    CHECK(!PTs.isEmpty());
+
+    // Use the last format listed, unless that is the FEC stream
+    // protecting the others.
+    size_t i = PTs.size() - 1;
+    while (i > 0 && isFECPayloadType(index, PTs[i])) {
+        --i;
+    }
+
+    unsigned long x = PTs[i];
 
     *PT = x;
 
@@ -222,6 +272,35 @@ void ASessionDescription::getFormatType(
     }
 }
 
+bool ASessionDescription::getFECPayloadType(
+        size_t index, unsigned long *PT) const {
+    Vector<unsigned long> PTs;
+    getPayloadTypes(index, &PTs);
+
+    for (size_t i = 0; i < PTs.size(); ++i) {
+        if (isFECPayloadType(index, PTs[i])) {
+            *PT = PTs[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ASessionDescription::hasRTCPFeedback(
+        size_t index, unsigned long PT, const char *type) const {
+    AString key = StringPrintf("a=rtcp-fb:%lu %s", PT, type);
+
+    AString value;
+    if (findAttribute(index, key.c_str(), &value)) {
+        return true;
+    }
+
+    key = StringPrintf("a=rtcp-fb:* %s", type);
+
+    return findAttribute(index, key.c_str(), &value);
+}
+
 bool ASessionDescription::getDimensions(
         size_t index, unsigned long PT,
         int32_t *width, int32_t *height) const {
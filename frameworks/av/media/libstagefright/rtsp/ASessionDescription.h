@@ -44,6 +44,15 @@ struct ASessionDescription : public RefBase {
             size_t index, unsigned long *PT,
             AString *desc, AString *params) const;
 
+    // Returns the payload type of the ULPFEC (RFC 5109) stream protecting
+    // this track, if there is one.
+    bool getFECPayloadType(size_t index, unsigned long *PT) const;
+
+    // True if the track advertises "a=rtcp-fb:<PT> <type>" (RFC 4585),
+    // or the same for all of its payload types.
+    bool hasRTCPFeedback(
+            size_t index, unsigned long PT, const char *type) const;
+
     bool getDimensions(
             size_t index, unsigned long PT,
             int32_t *width, int32_t *height) const;
@@ -75,6 +84,9 @@ private:
 
     bool parse(const void *data, size_t size);
 
+    void getPayloadTypes(size_t index, Vector<unsigned long> *PTs) const;
+    bool isFECPayloadType(size_t index, unsigned long PT) const;
+
     DISALLOW_EVIL_CONSTRUCTORS(ASessionDescription);
 };
 
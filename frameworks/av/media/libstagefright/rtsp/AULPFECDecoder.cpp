@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AULPFECDecoder"
+#include <utils/Log.h>
+
+#include "AULPFECDecoder.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+// Enough to cover the widest (48 packet) mask plus some reordering.
+static const size_t kMaxMediaPackets = 128;
+static const size_t kMaxFECPackets = 16;
+
+static const size_t kRTPHeaderSize = 12;
+static const size_t kFECHeaderSize = 10;
+
+static uint16_t u16at(const uint8_t *data) {
+    return data[0] << 8 | data[1];
+}
+
+static uint32_t u32at(const uint8_t *data) {
+    return u16at(data) << 16 | u16at(&data[2]);
+}
+
+AULPFECDecoder::AULPFECDecoder() {
+}
+
+AULPFECDecoder::~AULPFECDecoder() {
+}
+
+sp<ABuffer> AULPFECDecoder::findMediaPacket(uint16_t seqNum) const {
+    // The packets asked for are mostly recent ones.
+    List<sp<ABuffer> >::const_iterator it = mMediaPackets.end();
+    while (it != mMediaPackets.begin()) {
+        --it;
+        if ((uint16_t)(*it)->int32Data() == seqNum) {
+            return *it;
+        }
+    }
+
+    return NULL;
+}
+
+void AULPFECDecoder::storeMediaPacket(const sp<ABuffer> &packet) {
+    mMediaPackets.push_back(packet);
+
+    if (mMediaPackets.size() > kMaxMediaPackets) {
+        mMediaPackets.erase(mMediaPackets.begin());
+    }
+}
+
+void AULPFECDecoder::addMediaPacket(const sp<ABuffer> &buffer) {
+    if (buffer->capacity() < kRTPHeaderSize) {
+        return;
+    }
+
+    uint16_t seqNum = u16at(&buffer->base()[2]);
+    if (findMediaPacket(seqNum) != NULL) {
+        return;
+    }
+
+    // The assemblers are free to modify the packet, keep a copy.
+    sp<ABuffer> packet = new ABuffer(buffer->capacity());
+    memcpy(packet->data(), buffer->base(), buffer->capacity());
+    packet->setInt32Data(seqNum);
+
+    storeMediaPacket(packet);
+}
+
+void AULPFECDecoder::addFECPacket(const sp<ABuffer> &buffer) {
+    const uint8_t *data = buffer->data();
+    size_t size = buffer->size();
+
+    if (size < kFECHeaderSize + 4) {
+        return;
+    }
+
+    if (data[0] & 0x80) {
+        // E bit, reserved for a future extension of the header.
+        ALOGV("ignoring FEC packet with unknown header extension");
+        return;
+    }
+
+    bool longMask = (data[0] & 0x40) != 0;
+    size_t headerSize = kFECHeaderSize + (longMask ? 8 : 4);
+
+    if (size < headerSize) {
+        return;
+    }
+
+    FECPacket fec;
+    fec.mSeqNumBase = u16at(&data[2]);
+    fec.mProtectionLength = u16at(&data[kFECHeaderSize]);
+
+    fec.mMask = (uint64_t)u16at(&data[kFECHeaderSize + 2]) << 32;
+    fec.mNumMaskBits = 16;
+    if (longMask) {
+        fec.mMask |= u32at(&data[kFECHeaderSize + 4]);
+        fec.mNumMaskBits = 48;
+    }
+
+    if (headerSize + fec.mProtectionLength > size) {
+        return;
+    }
+
+    fec.mBuffer = buffer;
+
+    mFECPackets.push_back(fec);
+
+    if (mFECPackets.size() > kMaxFECPackets) {
+        mFECPackets.erase(mFECPackets.begin());
+    }
+}
+
+sp<ABuffer> AULPFECDecoder::recoverPacket() {
+    List<FECPacket>::iterator it = mFECPackets.begin();
+    while (it != mFECPackets.end()) {
+        size_t numMissing = 0;
+        uint16_t missingSeqNum = 0;
+
+        for (size_t i = 0; i < it->mNumMaskBits && numMissing < 2; ++i) {
+            if (!(it->mMask & (1ull << (47 - i)))) {
+                continue;
+            }
+
+            uint16_t seqNum = it->mSeqNumBase + i;
+            if (findMediaPacket(seqNum) == NULL) {
+                ++numMissing;
+                missingSeqNum = seqNum;
+            }
+        }
+
+        if (numMissing > 1) {
+            // Maybe later, once more of them have shown up.
+            ++it;
+            continue;
+        }
+
+        sp<ABuffer> packet;
+        if (numMissing == 1) {
+            packet = recover(*it, missingSeqNum);
+        }
+
+        it = mFECPackets.erase(it);
+
+        if (packet == NULL) {
+            continue;
+        }
+
+        sp<ABuffer> copy = new ABuffer(packet->size());
+        memcpy(copy->data(), packet->data(), packet->size());
+        copy->setInt32Data(missingSeqNum);
+        storeMediaPacket(copy);
+
+        if (!ParseRecoveredPacket(packet)) {
+            continue;
+        }
+
+        ALOGV("recovered packet %u", missingSeqNum);
+
+        return packet;
+    }
+
+    return NULL;
+}
+
+sp<ABuffer> AULPFECDecoder::recover(
+        const FECPacket &fec, uint16_t missingSeqNum) const {
+    if (mMediaPackets.empty()) {
+        return NULL;
+    }
+
+    // All media packets seen here come from the same source.
+    uint32_t SSRC = u32at(&(*--mMediaPackets.end())->data()[8]);
+
+    const uint8_t *fecData = fec.mBuffer->data();
+    size_t headerSize = kFECHeaderSize + (fec.mNumMaskBits > 16 ? 8 : 4);
+
+    uint8_t header[kFECHeaderSize];
+    memcpy(header, fecData, kFECHeaderSize);
+
+    sp<ABuffer> payload = new ABuffer(fec.mProtectionLength);
+    memcpy(payload->data(), &fecData[headerSize], fec.mProtectionLength);
+
+    uint8_t *out = payload->data();
+
+    for (size_t i = 0; i < fec.mNumMaskBits; ++i) {
+        if (!(fec.mMask & (1ull << (47 - i)))) {
+            continue;
+        }
+
+        uint16_t seqNum = fec.mSeqNumBase + i;
+        if (seqNum == missingSeqNum) {
+            continue;
+        }
+
+        sp<ABuffer> media = findMediaPacket(seqNum);
+        CHECK(media != NULL);
+
+        const uint8_t *data = media->data();
+        size_t length = media->size() - kRTPHeaderSize;
+
+        header[0] ^= data[0];
+        header[1] ^= data[1];
+        header[4] ^= data[4];
+        header[5] ^= data[5];
+        header[6] ^= data[6];
+        header[7] ^= data[7];
+        header[8] ^= length >> 8;
+        header[9] ^= length & 0xff;
+
+        if (length > fec.mProtectionLength) {
+            length = fec.mProtectionLength;
+        }
+        for (size_t j = 0; j < length; ++j) {
+            out[j] ^= data[kRTPHeaderSize + j];
+        }
+    }
+
+    size_t length = u16at(&header[8]);
+    if (length > fec.mProtectionLength) {
+        // The rest of the packet is only covered by higher protection
+        // levels, if at all.
+        ALOGV("cannot recover packet %u, %d bytes unprotected",
+              missingSeqNum, (int)(length - fec.mProtectionLength));
+        return NULL;
+    }
+
+    sp<ABuffer> packet = new ABuffer(kRTPHeaderSize + length);
+    uint8_t *data = packet->data();
+
+    data[0] = 0x80 | (header[0] & 0x3f);
+    data[1] = header[1];
+    data[2] = missingSeqNum >> 8;
+    data[3] = missingSeqNum & 0xff;
+    memcpy(&data[4], &header[4], 4);
+    data[8] = SSRC >> 24;
+    data[9] = (SSRC >> 16) & 0xff;
+    data[10] = (SSRC >> 8) & 0xff;
+    data[11] = SSRC & 0xff;
+    memcpy(&data[kRTPHeaderSize], out, length);
+
+    return packet;
+}
+
+// static
+bool AULPFECDecoder::ParseRecoveredPacket(const sp<ABuffer> &packet) {
+    // Same as ARTPConnection::parseRTP.
+
+    const uint8_t *data = packet->data();
+    size_t size = packet->size();
+
+    if (data[0] & 0x20) {
+        size_t paddingLength = data[size - 1];
+
+        if (paddingLength + kRTPHeaderSize > size) {
+            return false;
+        }
+
+        size -= paddingLength;
+    }
+
+    size_t payloadOffset = kRTPHeaderSize + 4 * (data[0] & 0x0f);
+
+    if (size < payloadOffset) {
+        return false;
+    }
+
+    if (data[0] & 0x10) {
+        if (size < payloadOffset + 4) {
+            return false;
+        }
+
+        const uint8_t *extensionData = &data[payloadOffset];
+
+        size_t extensionLength =
+            4 * (extensionData[2] << 8 | extensionData[3]);
+
+        if (size < payloadOffset + 4 + extensionLength) {
+            return false;
+        }
+
+        payloadOffset += 4 + extensionLength;
+    }
+
+    sp<AMessage> meta = packet->meta();
+    meta->setInt32("ssrc", u32at(&data[8]));
+    meta->setInt32("rtp-time", u32at(&data[4]));
+    meta->setInt32("PT", data[1] & 0x7f);
+    meta->setInt32("M", data[1] >> 7);
+
+    packet->setInt32Data(u16at(&data[2]));
+    packet->setRange(payloadOffset, size - payloadOffset);
+
+    return true;
+}
+
+}  // namespace android
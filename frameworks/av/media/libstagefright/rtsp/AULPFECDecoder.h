@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef A_ULPFEC_DECODER_H_
+
+#define A_ULPFEC_DECODER_H_
+
+#include <stdint.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/List.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct ABuffer;
+
+// Recovers lost RTP media packets from ULPFEC (RFC 5109) packets sent
+// as a separate stream alongside them. Only the level 0 protection is
+// used, which is enough to rebuild a packet no longer than the
+// protection length.
+struct AULPFECDecoder : public RefBase {
+    AULPFECDecoder();
+
+    // "buffer" is a media packet as parsed by ARTPConnection, i.e. its
+    // range covers the payload and the complete datagram is found in
+    // [base(), base() + capacity()).
+    void addMediaPacket(const sp<ABuffer> &buffer);
+
+    // "buffer" holds the payload of an RTP packet carrying ULPFEC data.
+    void addFECPacket(const sp<ABuffer> &buffer);
+
+    // Returns a media packet rebuilt from the FEC data received so far,
+    // in the same form ARTPConnection hands them out, or NULL if no
+    // (further) packet can be recovered.
+    sp<ABuffer> recoverPacket();
+
+protected:
+    virtual ~AULPFECDecoder();
+
+private:
+    struct FECPacket {
+        uint16_t mSeqNumBase;
+        uint64_t mMask;  // bit 47 protects mSeqNumBase
+        size_t mNumMaskBits;
+        size_t mProtectionLength;
+        sp<ABuffer> mBuffer;
+    };
+
+    // Copies of the most recent media datagrams, oldest first, with the
+    // 16-bit sequence number in int32Data().
+    List<sp<ABuffer> > mMediaPackets;
+    List<FECPacket> mFECPackets;
+
+    sp<ABuffer> findMediaPacket(uint16_t seqNum) const;
+    void storeMediaPacket(const sp<ABuffer> &packet);
+
+    sp<ABuffer> recover(const FECPacket &fec, uint16_t missingSeqNum) const;
+    static bool ParseRecoveredPacket(const sp<ABuffer> &packet);
+
+    DISALLOW_EVIL_CONSTRUCTORS(AULPFECDecoder);
+};
+
+}  // namespace android
+
+#endif  // A_ULPFEC_DECODER_H_
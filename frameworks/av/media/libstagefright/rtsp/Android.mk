@@ -17,6 +17,7 @@ LOCAL_SRC_FILES:=       \
         ARTPWriter.cpp              \
         ARTSPConnection.cpp         \
         ASessionDescription.cpp     \
+        AULPFECDecoder.cpp          \
         SDPLoader.cpp               \
 
 LOCAL_C_INCLUDES:= \
@@ -32,6 +32,8 @@
 
 namespace android {
 
+static const size_t kReadChunkSize = 16 * 1024;
+
 TimedTextSRTSource::TimedTextSRTSource(const sp<DataSource>& dataSource)
         : mSource(dataSource),
           mMetaData(new MetaData),
@@ -45,7 +47,10 @@ TimedTextSRTSource::~TimedTextSRTSource() {
 }
 
 status_t TimedTextSRTSource::start() {
-    status_t err = scanFile();
+    status_t err = loadFile();
+    if (err == OK) {
+        err = scanFile();
+    }
     if (err != OK) {
         reset();
     }
@@ -54,6 +59,7 @@ status_t TimedTextSRTSource::start() {
 
 void TimedTextSRTSource::reset() {
     mTextVector.clear();
+    mFileData.clear();
     mIndex = 0;
 }
 
@@ -82,6 +88,24 @@ sp<MetaData> TimedTextSRTSource::getFormat() {
     return mMetaData;
 }
 
+status_t TimedTextSRTSource::loadFile() {
+    mFileData.clear();
+
+    char buffer[kReadChunkSize];
+    off64_t offset = 0;
+    while (true) {
+        ssize_t n = mSource->readAt(offset, buffer, sizeof(buffer));
+        if (n < 0) {
+            return ERROR_IO;
+        } else if (n == 0) {
+            break;
+        }
+        mFileData.append(buffer, n);
+        offset += n;
+    }
+    return OK;
+}
+
 status_t TimedTextSRTSource::scanFile() {
     off64_t offset = 0;
     int64_t startTimeUs;
@@ -176,37 +200,27 @@ status_t TimedTextSRTSource::getNextSubtitleInfo(
 
 status_t TimedTextSRTSource::readNextLine(off64_t *offset, AString *data) {
     data->clear();
-    while (true) {
-        ssize_t readSize;
-        char character;
-        if ((readSize = mSource->readAt(*offset, &character, 1)) < 1) {
-            if (readSize == 0) {
-                return ERROR_END_OF_STREAM;
-            }
-            return ERROR_IO;
-        }
 
-        (*offset)++;
+    const char *file = mFileData.c_str();
+    const off64_t fileSize = mFileData.size();
+    if (*offset >= fileSize) {
+        return ERROR_END_OF_STREAM;
+    }
 
-        // a line could end with CR, LF or CR + LF
-        if (character == 10) {
-            break;
-        } else if (character == 13) {
-            if ((readSize = mSource->readAt(*offset, &character, 1)) < 1) {
-                if (readSize == 0) {  // end of the stream
-                    return OK;
-                }
-                return ERROR_IO;
-            }
+    // a line could end with CR, LF or CR + LF
+    off64_t end = *offset;
+    while (end < fileSize && file[end] != 10 && file[end] != 13) {
+        ++end;
+    }
+    data->setTo(file + *offset, end - *offset);
 
-            (*offset)++;
-            if (character != 10) {
-                (*offset)--;
-            }
-            break;
+    if (end < fileSize) {
+        if (file[end] == 13 && end + 1 < fileSize && file[end + 1] == 10) {
+            ++end;
         }
-        data->append(character);
+        ++end;
     }
+    *offset = end;
     return OK;
 }
 
@@ -256,13 +270,7 @@ status_t TimedTextSRTSource::getText(
     *endTimeUs = info.endTimeUs;
     mIndex++;
 
-    char *str = new char[info.textLen];
-    if (mSource->readAt(info.offset, str, info.textLen) < info.textLen) {
-        delete[] str;
-        return ERROR_IO;
-    }
-    text->append(str, info.textLen);
-    delete[] str;
+    text->append(mFileData, info.offset, info.textLen);
     return OK;
 }
 
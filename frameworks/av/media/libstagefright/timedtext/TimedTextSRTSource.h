@@ -21,11 +21,12 @@
 #include <media/stagefright/MediaSource.h>
 #include <utils/Compat.h>  // off64_t
 
+#include <media/stagefright/foundation/AString.h>
+
 #include "TimedTextSource.h"
 
 namespace android {
 
-class AString;
 class DataSource;
 class MediaBuffer;
 class Parcel;
@@ -59,7 +60,13 @@ private:
     size_t mIndex;
     KeyedVector<int64_t, TextInfo> mTextVector;
 
+    // The whole file, read once in start(). Subtitle files are small, and
+    // keeping them in memory spares a readAt() per character while scanning
+    // and any I/O in read().
+    AString mFileData;
+
     void reset();
+    status_t loadFile();
     status_t scanFile();
     status_t getNextSubtitleInfo(
             off64_t *offset, int64_t *startTimeUs, TextInfo *info);
@@ -55,7 +55,7 @@ static const char *kSRTString =
 class SRTDataSourceStub : public DataSource {
 public:
     SRTDataSourceStub(const char *data, size_t size) :
-        mData(data), mSize(size) {}
+        mData(data), mSize(size), mNumReads(0) {}
     virtual ~SRTDataSourceStub() {}
 
     virtual status_t initCheck() const {
@@ -63,6 +63,7 @@ public:
     }
 
     virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        mNumReads++;
         if (offset >= mSize) return 0;
 
         ssize_t avail = mSize - offset;
@@ -73,18 +74,23 @@ public:
         return avail;
     }
 
+    int numReads() const {
+        return mNumReads;
+    }
+
 private:
     const char *mData;
     size_t mSize;
+    int mNumReads;
 };
 
 class TimedTextSRTSourceTest : public testing::Test {
 protected:
     void SetUp() {
-        sp<DataSource> stub= new SRTDataSourceStub(
+        mStub = new SRTDataSourceStub(
                 kSRTString,
                 strlen(kSRTString));
-        mSource = new TimedTextSRTSource(stub);
+        mSource = new TimedTextSRTSource(mStub);
         mSource->start();
     }
 
@@ -107,6 +113,7 @@ protected:
         EXPECT_TRUE(strncmp(data, content, content_len) == 0);
     }
 
+    sp<SRTDataSourceStub> mStub;
     sp<TimedTextSource> mSource;
     int64_t startTimeUs;
     int64_t endTimeUs;
@@ -220,5 +227,24 @@ TEST_F(TimedTextSRTSourceTest, checkEdgeCase) {
     CheckDataEquals(parcel, subtitle.c_str());
 }
 
+TEST_F(TimedTextSRTSourceTest, readWithoutDataSourceAccess) {
+    // The file is read once in start(), subtitles come from memory.
+    int numReads = mStub->numReads();
+
+    MediaSource::ReadOptions options;
+    options.setSeekTo(4 * kSecToUsec, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
+    err = mSource->read(&startTimeUs, &endTimeUs, &parcel, &options);
+    EXPECT_EQ(OK, err);
+    subtitle = StringPrintf("4\n\n");
+    CheckDataEquals(parcel, subtitle.c_str());
+
+    err = mSource->read(&startTimeUs, &endTimeUs, &parcel);
+    EXPECT_EQ(OK, err);
+    subtitle = StringPrintf("5\n\n");
+    CheckDataEquals(parcel, subtitle.c_str());
+
+    EXPECT_EQ(numReads, mStub->numReads());
+}
+
 }  // namespace test
 }  // namespace android
@@ -74,6 +74,8 @@ ssize_t MediaSender::addTrack(const sp<AMessage> &format, uint32_t flags) {
     info.mFormat = format;
     info.mFlags = flags;
     info.mPacketizerTrackIndex = -1;
+    info.mSendLatencySumUs = 0ll;
+    info.mNumAccessUnitsSent = 0;
 
     AString mime;
     CHECK(format->findString("mime", &mime));
@@ -212,6 +214,8 @@ status_t MediaSender::queueAccessUnit(
     }
 
     if (mMode == MODE_TRANSPORT_STREAM) {
+        accessUnit->meta()->setInt64("queuedUs", ALooper::GetNowUs());
+
         TrackInfo *info = &mTrackInfos.editItemAt(trackIndex);
         info->mAccessUnits.push_back(accessUnit);
 
@@ -267,6 +271,14 @@ status_t MediaSender::queueAccessUnit(
                         RTPSender::PACKETIZATION_TRANSPORT_STREAM);
             }
 
+            if (err == OK) {
+                int64_t queuedUs;
+                CHECK(accessUnit->meta()->findInt64("queuedUs", &queuedUs));
+
+                info->mSendLatencySumUs += ALooper::GetNowUs() - queuedUs;
+                ++info->mNumAccessUnitsSent;
+            }
+
             if (err != OK) {
                 return err;
             }
@@ -282,6 +294,23 @@ status_t MediaSender::queueAccessUnit(
                 ? RTPSender::PACKETIZATION_AAC : RTPSender::PACKETIZATION_H264);
 }
 
+int64_t MediaSender::getAverageSendLatencyUs(size_t trackIndex) {
+    CHECK_LT(trackIndex, mTrackInfos.size());
+
+    TrackInfo *info = &mTrackInfos.editItemAt(trackIndex);
+
+    if (info->mNumAccessUnitsSent == 0) {
+        return -1ll;
+    }
+
+    int64_t avgUs = info->mSendLatencySumUs / info->mNumAccessUnitsSent;
+
+    info->mSendLatencySumUs = 0ll;
+    info->mNumAccessUnitsSent = 0;
+
+    return avgUs;
+}
+
 void MediaSender::onMessageReceived(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatSenderNotify:
@@ -397,8 +426,15 @@ status_t MediaSender::packetizeAccessUnit(
     uint64_t inputCTR;
     uint8_t HDCP_private_data[16];
 
+    // Later slices of a frame already sent in part.
+    int32_t continuesFrame;
+    if (!accessUnit->meta()->findInt32("continues-frame", &continuesFrame)) {
+        continuesFrame = false;
+    }
+
     bool manuallyPrependSPSPPS =
         !info.mIsAudio
+        && !continuesFrame
         && (info.mFlags & FLAG_MANUALLY_PREPEND_SPS_PPS)
         && IsIDR(accessUnit);
 
@@ -493,6 +529,15 @@ status_t MediaSender::packetizeAccessUnit(
         flags |= TSPacketizer::PREPEND_SPS_PPS_TO_IDR_FRAMES;
     }
 
+    if (continuesFrame) {
+        flags |= TSPacketizer::CONTINUES_ACCESS_UNIT;
+    }
+
+    if (mLogFile == NULL) {
+        // RTPSender gathers the payload straight from the access unit.
+        flags |= TSPacketizer::DEFER_PAYLOAD;
+    }
+
     int64_t timeUs = ALooper::GetNowUs();
     if (mPrevTimeUs < 0ll || mPrevTimeUs + 100000ll <= timeUs) {
         flags |= TSPacketizer::EMIT_PCR;
@@ -70,6 +70,11 @@ struct MediaSender : public AHandler {
     status_t queueAccessUnit(
             size_t trackIndex, const sp<ABuffer> &accessUnit);
 
+    // Average time the access units of a track spent in here, i.e.
+    // waiting for the other tracks and being packetized and handed to
+    // RTP, since the previous call. Returns -1 if none were sent.
+    int64_t getAverageSendLatencyUs(size_t trackIndex);
+
 protected:
     virtual void onMessageReceived(const sp<AMessage> &msg);
     virtual ~MediaSender();
@@ -92,6 +97,8 @@ private:
         List<sp<ABuffer> > mAccessUnits;
         ssize_t mPacketizerTrackIndex;
         bool mIsAudio;
+        int64_t mSendLatencySumUs;
+        int32_t mNumAccessUnitsSent;
     };
 
     sp<ANetworkSession> mNetSession;
@@ -30,8 +30,45 @@
 
 #include "include/avc_utils.h"
 
+#include <sys/uio.h>
+
 namespace android {
 
+struct RTPSender::TSPacketChain : public RefBase {
+    TSPacketChain()
+        : mNumIOVecs(0),
+          mSize(0) {
+    }
+
+    uint8_t mRTPHeader[12];
+
+    // Keep the memory "mIOVecs" points into alive.
+    sp<ABuffer> mTSHeaders;
+    sp<ABuffer> mPayload;
+
+    // The RTP header, then header and payload of each transport packet.
+    struct iovec mIOVecs[1 + 2 * kMaxNumTSPacketsPerRTPPacket];
+    size_t mNumIOVecs;
+    size_t mSize;
+
+    void append(const void *data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+
+        CHECK_LT(mNumIOVecs, sizeof(mIOVecs) / sizeof(mIOVecs[0]));
+
+        mIOVecs[mNumIOVecs].iov_base = const_cast<void *>(data);
+        mIOVecs[mNumIOVecs].iov_len = size;
+        ++mNumIOVecs;
+
+        mSize += size;
+    }
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(TSPacketChain);
+};
+
 RTPSender::RTPSender(
         const sp<ANetworkSession> &netSession,
         const sp<AMessage> &notify)
@@ -245,8 +282,35 @@ status_t RTPSender::queueRawPacket(
             ALooper::GetNowUs());
 }
 
+void RTPSender::writeTSRTPHeader(uint8_t *rtp, uint8_t packetType) {
+    rtp[0] = 0x80;
+    rtp[1] = packetType;
+
+    rtp[2] = (mRTPSeqNo >> 8) & 0xff;
+    rtp[3] = mRTPSeqNo & 0xff;
+    ++mRTPSeqNo;
+
+    int64_t nowUs = ALooper::GetNowUs();
+    uint32_t rtpTime = (nowUs * 9) / 100ll;
+
+    rtp[4] = rtpTime >> 24;
+    rtp[5] = (rtpTime >> 16) & 0xff;
+    rtp[6] = (rtpTime >> 8) & 0xff;
+    rtp[7] = rtpTime & 0xff;
+
+    rtp[8] = kSourceID >> 24;
+    rtp[9] = (kSourceID >> 16) & 0xff;
+    rtp[10] = (kSourceID >> 8) & 0xff;
+    rtp[11] = kSourceID & 0xff;
+}
+
 status_t RTPSender::queueTSPackets(
         const sp<ABuffer> &tsPackets, uint8_t packetType) {
+    sp<ABuffer> payload;
+    if (tsPackets->meta()->findBuffer("payload", &payload)) {
+        return queueTSPacketChain(tsPackets, packetType);
+    }
+
     CHECK_EQ(0, tsPackets->size() % 188);
 
     int64_t timeUs;
@@ -256,31 +320,17 @@ status_t RTPSender::queueTSPackets(
 
     size_t srcOffset = 0;
     while (srcOffset < tsPackets->size()) {
-        sp<ABuffer> udpPacket =
-            new ABuffer(12 + kMaxNumTSPacketsPerRTPPacket * 188);
+        sp<ABuffer> udpPacket = mSpareTSBuffer;
+        mSpareTSBuffer.clear();
+
+        if (udpPacket == NULL) {
+            udpPacket = new ABuffer(12 + kMaxNumTSPacketsPerRTPPacket * 188);
+        }
 
         udpPacket->setInt32Data(mRTPSeqNo);
 
         uint8_t *rtp = udpPacket->data();
-        rtp[0] = 0x80;
-        rtp[1] = packetType;
-
-        rtp[2] = (mRTPSeqNo >> 8) & 0xff;
-        rtp[3] = mRTPSeqNo & 0xff;
-        ++mRTPSeqNo;
-
-        int64_t nowUs = ALooper::GetNowUs();
-        uint32_t rtpTime = (nowUs * 9) / 100ll;
-
-        rtp[4] = rtpTime >> 24;
-        rtp[5] = (rtpTime >> 16) & 0xff;
-        rtp[6] = (rtpTime >> 8) & 0xff;
-        rtp[7] = rtpTime & 0xff;
-
-        rtp[8] = kSourceID >> 24;
-        rtp[9] = (kSourceID >> 16) & 0xff;
-        rtp[10] = (kSourceID >> 8) & 0xff;
-        rtp[11] = kSourceID & 0xff;
+        writeTSRTPHeader(rtp, packetType);
 
         size_t numTSPackets = (tsPackets->size() - srcOffset) / 188;
         if (numTSPackets > kMaxNumTSPacketsPerRTPPacket) {
@@ -308,6 +358,67 @@ status_t RTPSender::queueTSPackets(
     return OK;
 }
 
+status_t RTPSender::queueTSPacketChain(
+        const sp<ABuffer> &tsHeaders, uint8_t packetType) {
+    int64_t timeUs;
+    CHECK(tsHeaders->meta()->findInt64("timeUs", &timeUs));
+
+    sp<ABuffer> headerSizes, payload;
+    CHECK(tsHeaders->meta()->findBuffer("header-sizes", &headerSizes));
+    CHECK(tsHeaders->meta()->findBuffer("payload", &payload));
+
+    const size_t numTSPackets = headerSizes->size();
+
+    size_t headerOffset = 0;
+    size_t payloadOffset = 0;
+
+    size_t i = 0;
+    while (i < numTSPackets) {
+        sp<TSPacketChain> chain = new TSPacketChain;
+        chain->mTSHeaders = tsHeaders;
+        chain->mPayload = payload;
+
+        writeTSRTPHeader(chain->mRTPHeader, packetType);
+        chain->append(chain->mRTPHeader, sizeof(chain->mRTPHeader));
+
+        size_t n = numTSPackets - i;
+        if (n > kMaxNumTSPacketsPerRTPPacket) {
+            n = kMaxNumTSPacketsPerRTPPacket;
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+            size_t headerSize = headerSizes->data()[i + j];
+            size_t payloadSize = 188 - headerSize;
+
+            CHECK_LE(headerOffset + headerSize, tsHeaders->size());
+            CHECK_LE(payloadOffset + payloadSize, payload->size());
+
+            chain->append(tsHeaders->data() + headerOffset, headerSize);
+            chain->append(payload->data() + payloadOffset, payloadSize);
+
+            headerOffset += headerSize;
+            payloadOffset += payloadSize;
+        }
+
+        i += n;
+        bool isLastPacket = (i == numTSPackets);
+
+        status_t err = sendTSPacketChain(
+                chain,
+                true /* storeInHistory */,
+                isLastPacket /* timeValid */,
+                timeUs);
+
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    CHECK_EQ(payloadOffset, payload->size());
+
+    return OK;
+}
+
 status_t RTPSender::queueAVCBuffer(
         const sp<ABuffer> &accessUnit, uint8_t packetType) {
     int64_t timeUs;
@@ -471,22 +582,71 @@ status_t RTPSender::sendRTPPacket(
         return err;
     }
 
+    onRTPPacketSent(buffer->data(), buffer->size());
+
+    if (storeInHistory) {
+        HistoryEntry entry;
+        entry.mPacket = buffer;
+        addToHistory(entry);
+    }
+
+    return OK;
+}
+
+status_t RTPSender::sendTSPacketChain(
+        const sp<TSPacketChain> &chain, bool storeInHistory,
+        bool timeValid, int64_t timeUs) {
+    CHECK(mRTPConnected);
+
+    status_t err = mNetSession->sendDatagram(
+            mRTPSessionID, chain->mIOVecs, chain->mNumIOVecs, chain,
+            timeValid, timeUs);
+
+    if (err != OK) {
+        return err;
+    }
+
+    onRTPPacketSent(chain->mRTPHeader, chain->mSize);
+
+    if (storeInHistory) {
+        HistoryEntry entry;
+        entry.mChain = chain;
+        addToHistory(entry);
+    }
+
+    return OK;
+}
+
+void RTPSender::onRTPPacketSent(const uint8_t *rtp, size_t size) {
     mLastNTPTime = GetNowNTP();
-    mLastRTPTime = U32_AT(buffer->data() + 4);
+    mLastRTPTime = U32_AT(rtp + 4);
 
     ++mNumRTPSent;
-    mNumRTPOctetsSent += buffer->size() - 12;
+    mNumRTPOctetsSent += size - 12;
+}
 
-    if (storeInHistory) {
-        if (mHistorySize == kMaxHistorySize) {
-            mHistory.erase(mHistory.begin());
-        } else {
-            ++mHistorySize;
+void RTPSender::addToHistory(const HistoryEntry &entry) {
+    if (mHistorySize == kMaxHistorySize) {
+        const sp<ABuffer> &oldest = mHistory.begin()->mPacket;
+        if (oldest != NULL
+                && oldest->capacity() == 12 + kMaxNumTSPacketsPerRTPPacket * 188
+                && oldest->getStrongCount() == 1) {
+            mSpareTSBuffer = oldest;
         }
-        mHistory.push_back(buffer);
+        mHistory.erase(mHistory.begin());
+    } else {
+        ++mHistorySize;
     }
+    mHistory.push_back(entry);
+}
 
-    return OK;
+// static
+uint16_t RTPSender::SeqNoOf(const HistoryEntry &entry) {
+    if (entry.mChain != NULL) {
+        return U16_AT(&entry.mChain->mRTPHeader[2]);
+    }
+
+    return entry.mPacket->int32Data() & 0xffff;
 }
 
 // static
@@ -710,12 +870,12 @@ status_t RTPSender::parseTSFB(const uint8_t *data, size_t size) {
         uint16_t seqNo = U16_AT(&data[i]);
         uint16_t blp = U16_AT(&data[i + 2]);
 
-        List<sp<ABuffer> >::iterator it = mHistory.begin();
+        List<HistoryEntry>::iterator it = mHistory.begin();
         bool foundSeqNo = false;
         while (it != mHistory.end()) {
-            const sp<ABuffer> &buffer = *it;
+            const HistoryEntry &entry = *it;
 
-            uint16_t bufferSeqNo = buffer->int32Data() & 0xffff;
+            uint16_t bufferSeqNo = SeqNoOf(entry);
 
             bool retransmit = false;
             if (bufferSeqNo == seqNo) {
@@ -733,8 +893,15 @@ status_t RTPSender::parseTSFB(const uint8_t *data, size_t size) {
             if (retransmit) {
                 ALOGV("retransmitting seqNo %d", bufferSeqNo);
 
-                CHECK_EQ((status_t)OK,
-                         sendRTPPacket(buffer, false /* storeInHistory */));
+                if (entry.mChain != NULL) {
+                    CHECK_EQ((status_t)OK,
+                             sendTSPacketChain(
+                                 entry.mChain, false /* storeInHistory */));
+                } else {
+                    CHECK_EQ((status_t)OK,
+                             sendRTPPacket(
+                                 entry.mPacket, false /* storeInHistory */));
+                }
 
                 if (bufferSeqNo == seqNo) {
                     foundSeqNo = true;
@@ -754,8 +921,8 @@ status_t RTPSender::parseTSFB(const uint8_t *data, size_t size) {
                   seqNo, foundSeqNo, blp);
 
             if (!mHistory.empty()) {
-                int32_t earliest = (*mHistory.begin())->int32Data() & 0xffff;
-                int32_t latest = (*--mHistory.end())->int32Data() & 0xffff;
+                int32_t earliest = SeqNoOf(*mHistory.begin());
+                int32_t latest = SeqNoOf(*--mHistory.end());
 
                 ALOGI("have seq numbers from %d - %d", earliest, latest);
             }
@@ -89,19 +89,44 @@ private:
 
     uint32_t mRTPSeqNo;
 
-    List<sp<ABuffer> > mHistory;
+    // An RTP packet whose transport stream packets are gathered from
+    // the packetizer's headers and the access unit when sent.
+    struct TSPacketChain;
+
+    // Exactly one of the two is set.
+    struct HistoryEntry {
+        sp<ABuffer> mPacket;
+        sp<TSPacketChain> mChain;
+    };
+
+    List<HistoryEntry> mHistory;
     size_t mHistorySize;
 
+    // A transport stream packet buffer that fell out of the history,
+    // reused for the next one sent.
+    sp<ABuffer> mSpareTSBuffer;
+
     static uint64_t GetNowNTP();
 
     status_t queueRawPacket(const sp<ABuffer> &tsPackets, uint8_t packetType);
     status_t queueTSPackets(const sp<ABuffer> &tsPackets, uint8_t packetType);
+    status_t queueTSPacketChain(
+            const sp<ABuffer> &tsHeaders, uint8_t packetType);
     status_t queueAVCBuffer(const sp<ABuffer> &accessUnit, uint8_t packetType);
 
     status_t sendRTPPacket(
             const sp<ABuffer> &packet, bool storeInHistory,
             bool timeValid = false, int64_t timeUs = -1ll);
 
+    status_t sendTSPacketChain(
+            const sp<TSPacketChain> &chain, bool storeInHistory,
+            bool timeValid = false, int64_t timeUs = -1ll);
+
+    void writeTSRTPHeader(uint8_t *rtp, uint8_t packetType);
+    void onRTPPacketSent(const uint8_t *rtp, size_t size);
+    void addToHistory(const HistoryEntry &entry);
+    static uint16_t SeqNoOf(const HistoryEntry &entry);
+
     void onNetNotify(bool isRTP, const sp<AMessage> &msg);
 
     status_t onRTCPData(const sp<ABuffer> &data);
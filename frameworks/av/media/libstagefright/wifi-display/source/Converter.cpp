@@ -61,6 +61,8 @@ Converter::Converter(
       ,mPrevVideoBitrate(-1)
       ,mNumFramesToDrop(0)
       ,mEncodingSuspended(false)
+      ,mInPartialFrame(false)
+      ,mPartialFrameTimeUs(-1ll)
     {
     AString mime;
     CHECK(mOutputFormat->findString("mime", &mime));
@@ -109,6 +111,7 @@ void Converter::releaseEncoder() {
 
     mEncoderInputBuffers.clear();
     mEncoderOutputBuffers.clear();
+    mEncoderInputTimesUs.clear();
 }
 
 Converter::~Converter() {
@@ -213,6 +216,19 @@ status_t Converter::initEncoder() {
         // to recover from a lost/corrupted packet.
         mbs = (((width + 15) / 16) * ((height + 15) / 16) * 10) / 100;
         mOutputFormat->setInt32("intra-refresh-CIR-mbs", mbs);
+
+        if ((mFlags & FLAG_LOW_LATENCY) && mIsH264) {
+            // Slices of whole macroblock rows, so the first part of a
+            // frame can go out while the encoder works on the rest.
+            static const int kNumSlicesPerFrame = 4;
+
+            int mbRows = (height + 15) / 16;
+            int rowsPerSlice =
+                (mbRows + kNumSlicesPerFrame - 1) / kNumSlicesPerFrame;
+
+            mOutputFormat->setInt32(
+                    "mbs-per-slice", ((width + 15) / 16) * rowsPerSlice);
+        }
     }
 
     ALOGV("output format is '%s'", mOutputFormat->debugString(0).c_str());
@@ -666,6 +682,10 @@ status_t Converter::feedEncoderInputBuffers() {
         if (err != OK) {
             return err;
         }
+
+        if (mIsVideo && buffer != NULL) {
+            mEncoderInputTimesUs.add(timeUs, ALooper::GetNowUs());
+        }
     }
 
     return OK;
@@ -783,13 +803,45 @@ status_t Converter::doMoreWork() {
                     mOutputFormat->setBuffer("csd-0", buffer);
                 }
             } else {
-                if (mNeedToManuallyPrependSPSPPS
+                // Further slices of a frame share its timestamp.
+                bool continuesFrame =
+                    mInPartialFrame && timeUs == mPartialFrameTimeUs;
+
+                mInPartialFrame =
+                    (flags & MediaCodec::BUFFER_FLAG_PARTIAL_FRAME) != 0;
+                mPartialFrameTimeUs = timeUs;
+
+                if (!continuesFrame
+                        && mNeedToManuallyPrependSPSPPS
                         && mIsH264
                         && (mFlags & FLAG_PREPEND_CSD_IF_NECESSARY)
                         && IsIDR(buffer)) {
                     buffer = prependCSD(buffer);
                 }
 
+                if (continuesFrame) {
+                    buffer->meta()->setInt32("continues-frame", true);
+                }
+
+                if (mIsVideo) {
+                    // Frames the encoder dropped never show up here.
+                    while (!mEncoderInputTimesUs.isEmpty()
+                            && mEncoderInputTimesUs.keyAt(0) < timeUs) {
+                        mEncoderInputTimesUs.removeItemsAt(0);
+                    }
+
+                    ssize_t index = mEncoderInputTimesUs.indexOfKey(timeUs);
+                    if (index >= 0) {
+                        buffer->meta()->setInt64(
+                                "encoderInputUs",
+                                mEncoderInputTimesUs.valueAt(index));
+
+                        if (!mInPartialFrame) {
+                            mEncoderInputTimesUs.removeItemsAt(index);
+                        }
+                    }
+                }
+
                 sp<AMessage> notify = mNotify->dup();
                 notify->setInt32("what", kWhatAccessUnit);
                 notify->setBuffer("accessUnit", buffer);
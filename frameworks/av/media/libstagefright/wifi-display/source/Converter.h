@@ -19,6 +19,7 @@
 #define CONVERTER_H_
 
 #include <media/stagefright/foundation/AHandler.h>
+#include <utils/KeyedVector.h>
 
 namespace android {
 
@@ -42,6 +43,11 @@ struct Converter : public AHandler {
     enum FlagBits {
         FLAG_USE_SURFACE_INPUT          = 1,
         FLAG_PREPEND_CSD_IF_NECESSARY   = 2,
+
+        // Have the (H.264) encoder emit each frame as several slices and
+        // pass every one of them on as soon as it is available. All but
+        // the first slice of a frame carry "continues-frame" in their meta.
+        FLAG_LOW_LATENCY                = 4,
     };
     Converter(const sp<AMessage> &notify,
               const sp<ALooper> &codecLooper,
@@ -129,6 +135,12 @@ private:
     int32_t mNumFramesToDrop;
     bool mEncodingSuspended;
 
+    bool mInPartialFrame;
+    int64_t mPartialFrameTimeUs;
+
+    // When each pending video frame was handed to the encoder, by timestamp.
+    KeyedVector<int64_t, int64_t> mEncoderInputTimesUs;
+
     status_t initEncoder();
     void releaseEncoder();
 
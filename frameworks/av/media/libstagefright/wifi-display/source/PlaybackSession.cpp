@@ -359,6 +359,12 @@ WifiDisplaySource::PlaybackSession::PlaybackSession(
       mLastLifesignUs(),
       mVideoTrackIndex(-1),
       mPrevTimeUs(-1ll),
+      mLowLatency(
+              Converter::GetInt32Property("media.wfd.low-latency", 0) != 0),
+      mLastLatencyReportUs(-1ll),
+      mNumLatencyFrames(0),
+      mPullLatencySumUs(0ll),
+      mEncodeLatencySumUs(0ll),
       mPullExtractorPending(false),
       mPullExtractorGeneration(0),
       mFirstSampleTimeRealUs(-1ll),
@@ -502,6 +508,11 @@ void WifiDisplaySource::PlaybackSession::onMessageReceived(
 
                 if (err != OK) {
                     notifySessionDead();
+                    break;
+                }
+
+                if ((ssize_t)trackIndex == mVideoTrackIndex) {
+                    updateLatencyStats(accessUnit);
                 }
                 break;
             } else if (what == Converter::kWhatEOS) {
@@ -956,7 +967,13 @@ status_t WifiDisplaySource::PlaybackSession::addSource(
     notify = new AMessage(kWhatConverterNotify, id());
     notify->setSize("trackIndex", trackIndex);
 
-    sp<Converter> converter = new Converter(notify, codecLooper, format);
+    uint32_t converterFlags = 0;
+    if (isVideo && mLowLatency) {
+        converterFlags |= Converter::FLAG_LOW_LATENCY;
+    }
+
+    sp<Converter> converter =
+        new Converter(notify, codecLooper, format, converterFlags);
 
     looper()->registerHandler(converter);
 
@@ -1088,6 +1105,51 @@ void WifiDisplaySource::PlaybackSession::requestIDRFrame() {
     }
 }
 
+void WifiDisplaySource::PlaybackSession::updateLatencyStats(
+        const sp<ABuffer> &accessUnit) {
+    // The first slice of a frame is what the sink waits for.
+    int32_t continuesFrame;
+    if (accessUnit->meta()->findInt32("continues-frame", &continuesFrame)
+            && continuesFrame) {
+        return;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+
+    int64_t timeUs, encoderInputUs;
+    CHECK(accessUnit->meta()->findInt64("timeUs", &timeUs));
+    if (accessUnit->meta()->findInt64("encoderInputUs", &encoderInputUs)) {
+        mPullLatencySumUs += encoderInputUs - timeUs;
+        mEncodeLatencySumUs += nowUs - encoderInputUs;
+        ++mNumLatencyFrames;
+    }
+
+    if (mLastLatencyReportUs < 0ll) {
+        mLastLatencyReportUs = nowUs;
+        return;
+    }
+
+    if (nowUs < mLastLatencyReportUs + 5000000ll || mNumLatencyFrames == 0) {
+        return;
+    }
+
+    int64_t sendLatencyUs = mMediaSender->getAverageSendLatencyUs(
+            mTracks.valueFor(mVideoTrackIndex)->mediaSenderTrackIndex());
+
+    ALOGI("video latency: %lld ms to encoder, %lld ms encoding, "
+          "%lld ms muxing and sending (%d frames%s)",
+          mPullLatencySumUs / mNumLatencyFrames / 1000ll,
+          mEncodeLatencySumUs / mNumLatencyFrames / 1000ll,
+          sendLatencyUs / 1000ll,
+          mNumLatencyFrames,
+          mLowLatency ? ", sliced" : "");
+
+    mLastLatencyReportUs = nowUs;
+    mNumLatencyFrames = 0;
+    mPullLatencySumUs = 0ll;
+    mEncodeLatencySumUs = 0ll;
+}
+
 void WifiDisplaySource::PlaybackSession::notifySessionDead() {
     // Inform WifiDisplaySource of our premature death (wish).
     sp<AMessage> notify = mNotify->dup();
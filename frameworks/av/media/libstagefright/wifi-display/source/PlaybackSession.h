@@ -118,6 +118,17 @@ private:
 
     int64_t mPrevTimeUs;
 
+    // "media.wfd.low-latency": encode video in slices and send each one
+    // as soon as it is done.
+    bool mLowLatency;
+
+    // Per stage video latency since the last report, see
+    // updateLatencyStats().
+    int64_t mLastLatencyReportUs;
+    int32_t mNumLatencyFrames;
+    int64_t mPullLatencySumUs;
+    int64_t mEncodeLatencySumUs;
+
     sp<NuMediaExtractor> mExtractor;
     KeyedVector<size_t, size_t> mExtractorTrackToInternalTrack;
     bool mPullExtractorPending;
@@ -163,6 +174,8 @@ private:
 
     void onSinkFeedback(const sp<AMessage> &msg);
 
+    void updateLatencyStats(const sp<ABuffer> &accessUnit);
+
     DISALLOW_EVIL_CONSTRUCTORS(PlaybackSession);
 };
 
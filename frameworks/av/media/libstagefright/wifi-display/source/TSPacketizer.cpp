@@ -470,7 +470,11 @@ status_t TSPacketizer::packetize(
 
     const sp<Track> &track = mTracks.itemAt(trackIndex);
 
+    // Only the PES packet in which an access unit starts gets a PTS.
+    size_t PTS_size = (flags & CONTINUES_ACCESS_UNIT) ? 0 : 5;
+
     if (track->isH264() && (flags & PREPEND_SPS_PPS_TO_IDR_FRAMES)
+            && !(flags & CONTINUES_ACCESS_UNIT)
             && IsIDR(accessUnit)) {
         // prepend codec specific data, i.e. SPS and PPS.
         accessUnit = track->prependCSD(accessUnit);
@@ -524,7 +528,7 @@ status_t TSPacketizer::packetize(
 
        4 bytes of TS header
        ... padding
-       14 bytes of static PES header
+       14 bytes of static PES header (9 if there is no PTS)
        PES_private_data_len + 1 bytes (only if PES_private_data_len > 0)
        numStuffingBytes bytes
 
@@ -538,7 +542,8 @@ status_t TSPacketizer::packetize(
        followed by the payload
     */
 
-    size_t PES_packet_length = accessUnit->size() + 8 + numStuffingBytes;
+    size_t PES_packet_length =
+        accessUnit->size() + 3 + PTS_size + numStuffingBytes;
     if (PES_private_data_len > 0) {
         PES_packet_length += PES_private_data_len + 1;
     }
@@ -547,7 +552,7 @@ status_t TSPacketizer::packetize(
 
     {
         // Make sure the PES header fits into a single TS packet:
-        size_t PES_header_size = 14 + numStuffingBytes;
+        size_t PES_header_size = 9 + PTS_size + numStuffingBytes;
         if (PES_private_data_len > 0) {
             PES_header_size += PES_private_data_len + 1;
         }
@@ -639,7 +644,22 @@ status_t TSPacketizer::packetize(
         ++numTSPackets;
     }
 
-    sp<ABuffer> buffer = new ABuffer(numTSPackets * 188);
+    bool deferPayload = (flags & DEFER_PAYLOAD) != 0;
+
+    sp<ABuffer> buffer;
+    sp<ABuffer> headerSizes;
+    size_t numHeaders = 0;
+
+    if (deferPayload) {
+        // Only PAT, PMT, PCR and the first and last PES packet can have
+        // (close to) full size headers, the others carry at most an
+        // adaptation field for alignment.
+        buffer = new ABuffer(4 * 188 + numTSPackets * 21);
+        headerSizes = new ABuffer(numTSPackets);
+    } else {
+        buffer = new ABuffer(numTSPackets * 188);
+    }
+
     uint8_t *packetDataStart = buffer->data();
 
     if (flags & EMIT_PAT_AND_PMT) {
@@ -705,6 +725,9 @@ status_t TSPacketizer::packetize(
         memset(ptr, 0xff, sizeLeft);
 
         packetDataStart += 188;
+        if (deferPayload) {
+            headerSizes->data()[numHeaders++] = 188;
+        }
 
         // Program Map (PMT):
         // 0x47
@@ -820,6 +843,9 @@ status_t TSPacketizer::packetize(
         memset(ptr, 0xff, sizeLeft);
 
         packetDataStart += 188;
+        if (deferPayload) {
+            headerSizes->data()[numHeaders++] = 188;
+        }
     }
 
     if (flags & EMIT_PCR) {
@@ -868,6 +894,9 @@ status_t TSPacketizer::packetize(
         memset(ptr, 0xff, sizeLeft);
 
         packetDataStart += 188;
+        if (deferPayload) {
+            headerSizes->data()[numHeaders++] = 188;
+        }
     }
 
     uint64_t PTS = (timeUs * 9ll) / 100ll;
@@ -880,7 +909,8 @@ status_t TSPacketizer::packetize(
         PES_packet_length = 0;
     }
 
-    size_t sizeAvailableForPayload = 188 - 4 - 14 - numStuffingBytes;
+    size_t sizeAvailableForPayload =
+        188 - 4 - 9 - PTS_size - numStuffingBytes;
     if (PES_private_data_len > 0) {
         sizeAvailableForPayload -= PES_private_data_len + 1;
     }
@@ -921,20 +951,23 @@ status_t TSPacketizer::packetize(
     *ptr++ = PES_packet_length >> 8;
     *ptr++ = PES_packet_length & 0xff;
     *ptr++ = 0x84;
-    *ptr++ = (PES_private_data_len > 0) ? 0x81 : 0x80;
+    *ptr++ = (PTS_size > 0 ? 0x80 : 0x00)
+                | (PES_private_data_len > 0 ? 0x01 : 0x00);
 
-    size_t headerLength = 0x05 + numStuffingBytes;
+    size_t headerLength = PTS_size + numStuffingBytes;
     if (PES_private_data_len > 0) {
         headerLength += 1 + PES_private_data_len;
     }
 
     *ptr++ = headerLength;
 
-    *ptr++ = 0x20 | (((PTS >> 30) & 7) << 1) | 1;
-    *ptr++ = (PTS >> 22) & 0xff;
-    *ptr++ = (((PTS >> 15) & 0x7f) << 1) | 1;
-    *ptr++ = (PTS >> 7) & 0xff;
-    *ptr++ = ((PTS & 0x7f) << 1) | 1;
+    if (PTS_size > 0) {
+        *ptr++ = 0x20 | (((PTS >> 30) & 7) << 1) | 1;
+        *ptr++ = (PTS >> 22) & 0xff;
+        *ptr++ = (((PTS >> 15) & 0x7f) << 1) | 1;
+        *ptr++ = (PTS >> 7) & 0xff;
+        *ptr++ = ((PTS & 0x7f) << 1) | 1;
+    }
 
     if (PES_private_data_len > 0) {
         *ptr++ = 0x8e;  // PES_private_data_flag, reserved.
@@ -946,11 +979,17 @@ status_t TSPacketizer::packetize(
         *ptr++ = 0xff;
     }
 
-    memcpy(ptr, accessUnit->data(), copy);
-    ptr += copy;
+    if (deferPayload) {
+        CHECK_EQ(ptr + copy, packetDataStart + 188);
+        headerSizes->data()[numHeaders++] = ptr - packetDataStart;
+        packetDataStart = ptr;
+    } else {
+        memcpy(ptr, accessUnit->data(), copy);
+        ptr += copy;
 
-    CHECK_EQ(ptr, packetDataStart + 188);
-    packetDataStart += 188;
+        CHECK_EQ(ptr, packetDataStart + 188);
+        packetDataStart += 188;
+    }
 
     size_t offset = copy;
     while (offset < accessUnit->size()) {
@@ -996,15 +1035,30 @@ status_t TSPacketizer::packetize(
             }
         }
 
-        memcpy(ptr, accessUnit->data() + offset, copy);
-        ptr += copy;
-        CHECK_EQ(ptr, packetDataStart + 188);
+        if (deferPayload) {
+            CHECK_EQ(ptr + copy, packetDataStart + 188);
+            headerSizes->data()[numHeaders++] = ptr - packetDataStart;
+            packetDataStart = ptr;
+        } else {
+            memcpy(ptr, accessUnit->data() + offset, copy);
+            ptr += copy;
+            CHECK_EQ(ptr, packetDataStart + 188);
+            packetDataStart += 188;
+        }
 
         offset += copy;
-        packetDataStart += 188;
     }
 
-    CHECK(packetDataStart == buffer->data() + buffer->capacity());
+    if (deferPayload) {
+        CHECK_EQ(numHeaders, numTSPackets);
+        CHECK_LE(packetDataStart, buffer->data() + buffer->capacity());
+
+        buffer->setRange(0, packetDataStart - buffer->data());
+        buffer->meta()->setBuffer("header-sizes", headerSizes);
+        buffer->meta()->setBuffer("payload", accessUnit);
+    } else {
+        CHECK(packetDataStart == buffer->data() + buffer->capacity());
+    }
 
     *packets = buffer;
 
@@ -46,6 +46,15 @@ struct TSPacketizer : public RefBase {
         EMIT_PCR                        = 2,
         IS_ENCRYPTED                    = 4,
         PREPEND_SPS_PPS_TO_IDR_FRAMES   = 8,
+        // "accessUnit" holds further slices of the previous one, its PES
+        // packet carries no PTS.
+        CONTINUES_ACCESS_UNIT           = 16,
+        // Leave the PES payload where it is: "packets" then only holds
+        // the header part of each transport packet, back to back. Its
+        // meta carries a "header-sizes" buffer with one byte per
+        // transport packet and the "payload" buffer that the rest of
+        // each packet is to be taken from, in order.
+        DEFER_PAYLOAD                   = 32,
     };
     status_t packetize(
             size_t trackIndex, const sp<ABuffer> &accessUnit,
@@ -32,6 +32,12 @@ YUVCanvas::~YUVCanvas() {
 }
 
 void YUVCanvas::FillYUV(uint8_t yValue, uint8_t uValue, uint8_t vValue) {
+    if (mYUVImage.fastFillRectangle(
+                Rect(mYUVImage.width(), mYUVImage.height()),
+                yValue, uValue, vValue)) {
+        return;
+    }
+
     for (int32_t y = 0; y < mYUVImage.height(); ++y) {
         for (int32_t x = 0; x < mYUVImage.width(); ++x) {
             mYUVImage.setPixelValue(x, y, yValue, uValue, vValue);
@@ -41,6 +47,10 @@ void YUVCanvas::FillYUV(uint8_t yValue, uint8_t uValue, uint8_t vValue) {
 
 void YUVCanvas::FillYUVRectangle(const Rect& rect,
         uint8_t yValue, uint8_t uValue, uint8_t vValue) {
+    if (mYUVImage.fastFillRectangle(rect, yValue, uValue, vValue)) {
+        return;
+    }
+
     for (int32_t y = rect.top; y < rect.bottom; ++y) {
         for (int32_t x = rect.left; x < rect.right; ++x) {
             mYUVImage.setPixelValue(x, y, yValue, uValue, vValue);
@@ -91,6 +101,11 @@ void YUVCanvas::downsample(
     CHECK((srcOffsetX + (mYUVImage.width() - 1) * skipX) < srcImage.width());
     CHECK((srcOffsetY + (mYUVImage.height() - 1) * skipY) < srcImage.height());
 
+    if (YUVImage::fastDownsample(
+                srcOffsetX, srcOffsetY, skipX, skipY, srcImage, mYUVImage)) {
+        return;
+    }
+
     uint8_t yValue;
     uint8_t uValue;
     uint8_t vValue;
@@ -108,4 +123,49 @@ void YUVCanvas::downsample(
     }
 }
 
+void YUVCanvas::rotate(int32_t degrees, const YUVImage &srcImage) {
+    CHECK(degrees == 0 || degrees == 90 || degrees == 180 || degrees == 270);
+
+    bool swapSize = (degrees == 90 || degrees == 270);
+    int32_t srcWidth = srcImage.width();
+    int32_t srcHeight = srcImage.height();
+    CHECK_EQ(mYUVImage.width(), swapSize ? srcHeight : srcWidth);
+    CHECK_EQ(mYUVImage.height(), swapSize ? srcWidth : srcHeight);
+
+    if (YUVImage::fastRotate(degrees, srcImage, mYUVImage)) {
+        return;
+    }
+
+    uint8_t yValue;
+    uint8_t uValue;
+    uint8_t vValue;
+
+    for (int32_t y = 0; y < mYUVImage.height(); ++y) {
+        for (int32_t x = 0; x < mYUVImage.width(); ++x) {
+            int32_t srcX, srcY;
+            switch (degrees) {
+                case 90:
+                    srcX = y;
+                    srcY = srcHeight - 1 - x;
+                    break;
+                case 180:
+                    srcX = srcWidth - 1 - x;
+                    srcY = srcHeight - 1 - y;
+                    break;
+                case 270:
+                    srcX = srcWidth - 1 - y;
+                    srcY = x;
+                    break;
+                default:
+                    srcX = x;
+                    srcY = y;
+                    break;
+            }
+
+            srcImage.getPixelValue(srcX, srcY, &yValue, &uValue, &vValue);
+            mYUVImage.setPixelValue(x, y, yValue, uValue, vValue);
+        }
+    }
+}
+
 }  // namespace android
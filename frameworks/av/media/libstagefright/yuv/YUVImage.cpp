@@ -23,6 +23,103 @@
 
 namespace android {
 
+// Rotations and downsampling walk the destination in tiles of this many
+// pixels squared, so that the source rows being read stay in the cache.
+static const int32_t kTileSize = 32;
+
+// Copies a width x height block of values, each "step" bytes apart within a
+// row and "stride" bytes apart between rows.
+static void copyPlane(
+        const uint8_t *src, int32_t srcStep, int32_t srcStride,
+        uint8_t *dst, int32_t dstStep, int32_t dstStride,
+        int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; ++y) {
+        if (srcStep == 1 && dstStep == 1) {
+            memcpy(dst, src, width);
+        } else {
+            for (int32_t x = 0; x < width; ++x) {
+                dst[x * dstStep] = src[x * srcStep];
+            }
+        }
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+static void fillPlane(
+        uint8_t *dst, int32_t dstStep, int32_t dstStride,
+        int32_t width, int32_t height, uint8_t value) {
+    for (int32_t y = 0; y < height; ++y) {
+        if (dstStep == 1) {
+            memset(dst, value, width);
+        } else {
+            for (int32_t x = 0; x < width; ++x) {
+                dst[x * dstStep] = value;
+            }
+        }
+        dst += dstStride;
+    }
+}
+
+// Rotates a srcWidth x srcHeight plane clockwise by degrees. The value for
+// destination (x, y) is at src + x * colInc + y * rowInc once src has been
+// moved to the source value ending up at (0, 0).
+static void rotatePlane(
+        const uint8_t *src, int32_t srcStep, int32_t srcStride,
+        int32_t srcWidth, int32_t srcHeight,
+        uint8_t *dst, int32_t dstStep, int32_t dstStride,
+        int32_t degrees) {
+    int32_t colInc, rowInc;
+    int32_t dstWidth = srcWidth;
+    int32_t dstHeight = srcHeight;
+
+    switch (degrees) {
+        case 90:
+            src += (srcHeight - 1) * srcStride;
+            colInc = -srcStride;
+            rowInc = srcStep;
+            dstWidth = srcHeight;
+            dstHeight = srcWidth;
+            break;
+        case 180:
+            src += (srcHeight - 1) * srcStride + (srcWidth - 1) * srcStep;
+            colInc = -srcStep;
+            rowInc = -srcStride;
+            break;
+        case 270:
+            src += (srcWidth - 1) * srcStep;
+            colInc = srcStride;
+            rowInc = -srcStep;
+            dstWidth = srcHeight;
+            dstHeight = srcWidth;
+            break;
+        default:
+            copyPlane(src, srcStep, srcStride, dst, dstStep, dstStride,
+                    srcWidth, srcHeight);
+            return;
+    }
+
+    for (int32_t tileY = 0; tileY < dstHeight; tileY += kTileSize) {
+        int32_t endY = tileY + kTileSize;
+        if (endY > dstHeight) endY = dstHeight;
+
+        for (int32_t tileX = 0; tileX < dstWidth; tileX += kTileSize) {
+            int32_t endX = tileX + kTileSize;
+            if (endX > dstWidth) endX = dstWidth;
+
+            for (int32_t y = tileY; y < endY; ++y) {
+                const uint8_t *srcAddr = src + tileX * colInc + y * rowInc;
+                uint8_t *dstAddr = dst + y * dstStride + tileX * dstStep;
+                for (int32_t x = tileX; x < endX; ++x) {
+                    *dstAddr = *srcAddr;
+                    srcAddr += colInc;
+                    dstAddr += dstStep;
+                }
+            }
+        }
+    }
+}
+
 YUVImage::YUVImage(YUVFormat yuvFormat, int32_t width, int32_t height) {
     mYUVFormat = yuvFormat;
     mWidth = width;
@@ -129,6 +226,11 @@ bool YUVImage::getOffsetIncrementsPerDataRow(
     return true;
 }
 
+int32_t YUVImage::getUVStep() const {
+    // U and V are interleaved in the semi planar format.
+    return (mYUVFormat == YUV420SemiPlanar) ? 2 : 1;
+}
+
 uint8_t* YUVImage::getYAddress(int32_t offset) const {
     return mYdata + offset;
 }
@@ -361,7 +463,169 @@ bool YUVImage::fastCopyRectangle(
         }
         return true;
     }
-    return false;
+
+    // Different layouts can still be copied a data row at a time as long as
+    // every 2x2 block of pixels maps onto a single U/V pair, otherwise the
+    // caller's pixel by pixel copy decides which U/V values win.
+    if ((srcRect.left | srcRect.top | srcRect.right | srcRect.bottom
+            | destStartX | destStartY) & 1) {
+        return false;
+    }
+
+    uint8_t *ySrcAddr, *uSrcAddr, *vSrcAddr;
+    uint8_t *yDestAddr, *uDestAddr, *vDestAddr;
+    if (!srcImage.getYUVAddresses(srcRect.left, srcRect.top,
+                &ySrcAddr, &uSrcAddr, &vSrcAddr)
+            || !destImage.getYUVAddresses(destStartX, destStartY,
+                &yDestAddr, &uDestAddr, &vDestAddr)) {
+        return false;
+    }
+
+    int32_t ySrcInc, uSrcInc, vSrcInc;
+    int32_t yDestInc, uDestInc, vDestInc;
+    srcImage.getOffsetIncrementsPerDataRow(&ySrcInc, &uSrcInc, &vSrcInc);
+    destImage.getOffsetIncrementsPerDataRow(&yDestInc, &uDestInc, &vDestInc);
+
+    int32_t srcUVStep = srcImage.getUVStep();
+    int32_t destUVStep = destImage.getUVStep();
+    int32_t width = srcRect.width();
+    int32_t height = srcRect.height();
+
+    copyPlane(ySrcAddr, 1, ySrcInc, yDestAddr, 1, yDestInc, width, height);
+    copyPlane(uSrcAddr, srcUVStep, uSrcInc, uDestAddr, destUVStep, uDestInc,
+            width >> 1, height >> 1);
+    copyPlane(vSrcAddr, srcUVStep, vSrcInc, vDestAddr, destUVStep, vDestInc,
+            width >> 1, height >> 1);
+
+    return true;
+}
+
+bool YUVImage::fastFillRectangle(const Rect& rect,
+        uint8_t yValue, uint8_t uValue, uint8_t vValue) {
+    if (rect.isEmpty()) {
+        return true;
+    }
+
+    CHECK(validPixel(rect.left, rect.top));
+    CHECK(validPixel(rect.right - 1, rect.bottom - 1));
+
+    uint8_t *yAddr, *uAddr, *vAddr;
+    if (!getYUVAddresses(rect.left, rect.top, &yAddr, &uAddr, &vAddr)) {
+        return false;
+    }
+
+    int32_t yInc, uInc, vInc;
+    getOffsetIncrementsPerDataRow(&yInc, &uInc, &vInc);
+
+    fillPlane(yAddr, 1, yInc, rect.width(), rect.height(), yValue);
+
+    // Every U/V value shared with a pixel inside the rectangle is set,
+    // including those of the partly covered 2x2 blocks at the edges.
+    int32_t uvWidth = ((rect.right - 1) >> 1) - (rect.left >> 1) + 1;
+    int32_t uvHeight = ((rect.bottom - 1) >> 1) - (rect.top >> 1) + 1;
+    int32_t uvStep = getUVStep();
+
+    fillPlane(uAddr, uvStep, uInc, uvWidth, uvHeight, uValue);
+    fillPlane(vAddr, uvStep, vInc, uvWidth, uvHeight, vValue);
+
+    return true;
+}
+
+// static
+bool YUVImage::fastDownsample(
+        int32_t srcOffsetX, int32_t srcOffsetY,
+        int32_t skipX, int32_t skipY,
+        const YUVImage &srcImage, YUVImage &destImage) {
+    int32_t width = destImage.mWidth;
+    int32_t height = destImage.mHeight;
+
+    int32_t ySrcInc, uSrcInc, vSrcInc;
+    int32_t yDestInc, uDestInc, vDestInc;
+    if (!srcImage.getOffsetIncrementsPerDataRow(&ySrcInc, &uSrcInc, &vSrcInc)
+            || !destImage.getOffsetIncrementsPerDataRow(
+                &yDestInc, &uDestInc, &vDestInc)) {
+        return false;
+    }
+
+    // Y
+    for (int32_t y = 0; y < height; ++y) {
+        const uint8_t *srcAddr = srcImage.mYdata
+            + (srcOffsetY + y * skipY) * ySrcInc + srcOffsetX;
+        uint8_t *destAddr = destImage.mYdata + y * yDestInc;
+        for (int32_t x = 0; x < width; ++x) {
+            destAddr[x] = *srcAddr;
+            srcAddr += skipX;
+        }
+    }
+
+    // U and V. Setting the pixels one by one leaves each destination U/V
+    // pair with the values of the last (bottom right) pixel of its 2x2
+    // block, so sample the source at that pixel.
+    int32_t uvWidth = (width + 1) >> 1;
+    int32_t uvHeight = (height + 1) >> 1;
+    int32_t srcUVStep = srcImage.getUVStep();
+    int32_t destUVStep = destImage.getUVStep();
+
+    int32_t *srcUVOffsets = new int32_t[uvWidth];
+    for (int32_t x = 0; x < uvWidth; ++x) {
+        int32_t lastX = (2 * x + 1 < width) ? 2 * x + 1 : width - 1;
+        srcUVOffsets[x] = ((srcOffsetX + lastX * skipX) >> 1) * srcUVStep;
+    }
+
+    for (int32_t y = 0; y < uvHeight; ++y) {
+        int32_t lastY = (2 * y + 1 < height) ? 2 * y + 1 : height - 1;
+        int32_t srcRow = (srcOffsetY + lastY * skipY) >> 1;
+
+        const uint8_t *uSrcAddr = srcImage.mUdata + srcRow * uSrcInc;
+        const uint8_t *vSrcAddr = srcImage.mVdata + srcRow * vSrcInc;
+        uint8_t *uDestAddr = destImage.mUdata + y * uDestInc;
+        uint8_t *vDestAddr = destImage.mVdata + y * vDestInc;
+
+        for (int32_t x = 0; x < uvWidth; ++x) {
+            uDestAddr[x * destUVStep] = uSrcAddr[srcUVOffsets[x]];
+            vDestAddr[x * destUVStep] = vSrcAddr[srcUVOffsets[x]];
+        }
+    }
+
+    delete[] srcUVOffsets;
+    srcUVOffsets = NULL;
+
+    return true;
+}
+
+// static
+bool YUVImage::fastRotate(
+        int32_t degrees,
+        const YUVImage &srcImage, YUVImage &destImage) {
+    int32_t srcWidth = srcImage.mWidth;
+    int32_t srcHeight = srcImage.mHeight;
+
+    // With odd dimensions the 2x2 blocks do not line up after rotation.
+    if ((srcWidth | srcHeight) & 1) {
+        return false;
+    }
+
+    int32_t ySrcInc, uSrcInc, vSrcInc;
+    int32_t yDestInc, uDestInc, vDestInc;
+    if (!srcImage.getOffsetIncrementsPerDataRow(&ySrcInc, &uSrcInc, &vSrcInc)
+            || !destImage.getOffsetIncrementsPerDataRow(
+                &yDestInc, &uDestInc, &vDestInc)) {
+        return false;
+    }
+
+    int32_t srcUVStep = srcImage.getUVStep();
+    int32_t destUVStep = destImage.getUVStep();
+
+    rotatePlane(srcImage.mYdata, 1, ySrcInc, srcWidth, srcHeight,
+            destImage.mYdata, 1, yDestInc, degrees);
+    rotatePlane(srcImage.mUdata, srcUVStep, uSrcInc,
+            srcWidth >> 1, srcHeight >> 1,
+            destImage.mUdata, destUVStep, uDestInc, degrees);
+    rotatePlane(srcImage.mVdata, srcUVStep, vSrcInc,
+            srcWidth >> 1, srcHeight >> 1,
+            destImage.mVdata, destUVStep, vDestInc, degrees);
+
+    return true;
 }
 
 uint8_t clamp(uint8_t v, uint8_t minValue, uint8_t maxValue) {
@@ -42,6 +42,11 @@ int main(int argc, char** argv)
     signal(SIGPIPE, SIG_IGN);
     char value[PROPERTY_VALUE_MAX];
     bool doLog = (property_get("ro.test_harness", value, "0") > 0) && (atoi(value) == 1);
+    // media.log also collects the structured events of the services when asked for
+    if (!doLog) {
+        doLog = (property_get("persist.media.log.events", value, "0") > 0) &&
+                (atoi(value) == 1);
+    }
     pid_t childPid;
     // FIXME The advantage of making the process containing media.log service the parent process of
     // the process that contains all the other real services, is that it allows us to collect more
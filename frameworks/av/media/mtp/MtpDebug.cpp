@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "MtpDebug"
+
 #include "MtpDebug.h"
 
 namespace android {
@@ -399,4 +401,25 @@ const char* MtpDebug::getDevicePropCodeName(MtpPropertyCode code) {
     return getCodeName(code, sDevicePropCodes);
 }
 
+MtpTransferStats::MtpTransferStats(MtpOperationCode operation)
+    :   mOperation(operation),
+        mStartTime(systemTime(SYSTEM_TIME_MONOTONIC)),
+        mStartCpuTime(systemTime(SYSTEM_TIME_THREAD))
+{
+}
+
+void MtpTransferStats::done(uint64_t bytes, int ret) {
+    nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - mStartTime;
+    nsecs_t cpu = systemTime(SYSTEM_TIME_THREAD) - mStartCpuTime;
+    if (elapsed <= 0)
+        elapsed = 1;
+
+    ALOGD("%s: %llu bytes in %lld ms, %llu KB/s, cpu %lld ms (%d%%)%s",
+            MtpDebug::getOperationCodeName(mOperation),
+            (unsigned long long)bytes, (long long)ns2ms(elapsed),
+            (unsigned long long)(bytes / 1024 * 1000000000LL / elapsed),
+            (long long)ns2ms(cpu), (int)(cpu * 100 / elapsed),
+            (ret < 0 ? " failed" : ""));
+}
+
 }  // namespace android
@@ -19,6 +19,7 @@
 
 // #define LOG_NDEBUG 0
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include "MtpTypes.h"
 
@@ -32,6 +33,21 @@ public:
     static const char* getDevicePropCodeName(MtpPropertyCode code);
 };
 
+// Measures one object transfer and logs its throughput and the CPU time
+// spent by the calling thread, which includes the time the driver spends
+// copying the file inside the transfer ioctl.
+class MtpTransferStats {
+public:
+                        MtpTransferStats(MtpOperationCode operation);
+
+    void                done(uint64_t bytes, int ret);
+
+private:
+    MtpOperationCode    mOperation;
+    nsecs_t             mStartTime;
+    nsecs_t             mStartCpuTime;
+};
+
 }; // namespace android
 
 #endif // _MTP_DEBUG_H
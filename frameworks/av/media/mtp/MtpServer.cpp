@@ -88,6 +88,10 @@ static const MtpOperationCode kSupportedOperationCodes[] = {
     MTP_OPERATION_END_EDIT_OBJECT,
 };
 
+// above this many objects added at once, reloading the object lists
+// is cheaper than looking up every new object
+static const size_t kMaxIncrementalObjectAdds = 256;
+
 static const MtpEventCode kSupportedEventCodes[] = {
     MTP_EVENT_OBJECT_ADDED,
     MTP_EVENT_OBJECT_REMOVED,
@@ -107,7 +111,8 @@ MtpServer::MtpServer(int fd, MtpDatabase* database, bool ptp,
         mSessionOpen(false),
         mSendObjectHandle(kInvalidObjectHandle),
         mSendObjectFormat(0),
-        mSendObjectFileSize(0)
+        mSendObjectFileSize(0),
+        mObjectListsStale(false)
 {
 }
 
@@ -243,11 +248,24 @@ void MtpServer::run() {
 
 void MtpServer::sendObjectAdded(MtpObjectHandle handle) {
     ALOGV("sendObjectAdded %d\n", handle);
+    {
+        Mutex::Autolock autoLock(mObjectEventMutex);
+        if (mAddedObjects.size() < kMaxIncrementalObjectAdds)
+            mAddedObjects.push(handle);
+        else
+            mObjectListsStale = true;
+    }
     sendEvent(MTP_EVENT_OBJECT_ADDED, handle);
 }
 
 void MtpServer::sendObjectRemoved(MtpObjectHandle handle) {
     ALOGV("sendObjectRemoved %d\n", handle);
+    {
+        Mutex::Autolock autoLock(mObjectEventMutex);
+        // only the top of a removed directory tree is reported,
+        // so we cannot tell which other handles went away with it
+        mObjectListsStale = true;
+    }
     sendEvent(MTP_EVENT_OBJECT_REMOVED, handle);
 }
 
@@ -303,6 +321,44 @@ void MtpServer::commitEdit(ObjectEdit* edit) {
     mDatabase->endSendObject((const char *)edit->mPath, edit->mHandle, edit->mFormat, true);
 }
 
+// applies the object events from the media provider to the object list caches.
+// Must be called before using a cached list.
+void MtpServer::updateObjectListCaches() {
+    MtpObjectHandleList added;
+    bool stale;
+    {
+        Mutex::Autolock autoLock(mObjectEventMutex);
+        added = mAddedObjects;
+        mAddedObjects.clear();
+        stale = mObjectListsStale;
+        mObjectListsStale = false;
+    }
+
+    if (stale) {
+        clearObjectListCaches();
+        return;
+    }
+    for (size_t i = 0; i < added.size(); i++) {
+        MtpObjectInfo info(added[i]);
+        // the object may be gone again already
+        if (mDatabase->getObjectInfo(added[i], info) != MTP_RESPONSE_OK)
+            continue;
+        MtpStorage* storage = (info.mStorageID ? getStorage(info.mStorageID) : NULL);
+        if (storage)
+            storage->objectAdded(added[i], info.mFormat, info.mParent);
+    }
+}
+
+void MtpServer::removeFromObjectListCaches(MtpObjectHandle handle) {
+    for (size_t i = 0; i < mStorages.size(); i++)
+        mStorages[i]->objectRemoved(handle);
+}
+
+void MtpServer::clearObjectListCaches() {
+    for (size_t i = 0; i < mStorages.size(); i++)
+        mStorages[i]->clearObjectListCache();
+}
+
 
 bool MtpServer::handleRequest() {
     Mutex::Autolock autoLock(mMutex);
@@ -481,6 +537,7 @@ MtpResponseCode MtpServer::doOpenSession() {
     }
     mSessionID = mRequest.getParameter(1);
     mSessionOpen = true;
+    clearObjectListCaches();
 
     mDatabase->sessionStarted();
 
@@ -492,6 +549,7 @@ MtpResponseCode MtpServer::doCloseSession() {
         return MTP_RESPONSE_SESSION_NOT_OPEN;
     mSessionID = 0;
     mSessionOpen = false;
+    clearObjectListCaches();
     mDatabase->sessionEnded();
     return MTP_RESPONSE_OK;
 }
@@ -552,9 +610,25 @@ MtpResponseCode MtpServer::doGetObjectHandles() {
     if (!hasStorage(storageID))
         return MTP_RESPONSE_INVALID_STORAGE_ID;
 
+    // lists for a single storage are cached, so that browsing a large
+    // storage does not query the database for every folder visit
+    MtpStorage* storage = NULL;
+    if (storageID != 0 && storageID != 0xFFFFFFFF) {
+        storage = getStorage(storageID);
+        updateObjectListCaches();
+        const MtpObjectHandleList* cached = storage->getCachedObjectList(format, parent);
+        if (cached) {
+            mData.putAUInt32(cached);
+            return MTP_RESPONSE_OK;
+        }
+    }
+
     MtpObjectHandleList* handles = mDatabase->getObjectList(storageID, format, parent);
     mData.putAUInt32(handles);
-    delete handles;
+    if (storage && handles)
+        storage->cacheObjectList(format, parent, handles);
+    else
+        delete handles;
     return MTP_RESPONSE_OK;
 }
 
@@ -568,6 +642,16 @@ MtpResponseCode MtpServer::doGetNumObjects() {
     if (!hasStorage(storageID))
         return MTP_RESPONSE_INVALID_STORAGE_ID;
 
+    if (storageID != 0 && storageID != 0xFFFFFFFF) {
+        updateObjectListCaches();
+        const MtpObjectHandleList* cached =
+                getStorage(storageID)->getCachedObjectList(format, parent);
+        if (cached) {
+            mResponse.setParameter(1, cached->size());
+            return MTP_RESPONSE_OK;
+        }
+    }
+
     int count = mDatabase->getNumObjects(storageID, format, parent);
     if (count >= 0) {
         mResponse.setParameter(1, count);
@@ -735,9 +819,12 @@ MtpResponseCode MtpServer::doGetObject() {
     mfr.command = mRequest.getOperationCode();
     mfr.transaction_id = mRequest.getTransactionID();
 
-    // then transfer the file
+    // then transfer the file; the driver reads it straight into its
+    // USB request buffers, so the data never passes through this process
+    MtpTransferStats stats(mfr.command);
     int ret = ioctl(mFD, MTP_SEND_FILE_WITH_HEADER, (unsigned long)&mfr);
     ALOGV("MTP_SEND_FILE_WITH_HEADER returned %d\n", ret);
+    stats.done(mfr.length, ret);
     close(mfr.fd);
     if (ret < 0) {
         if (errno == ECANCELED)
@@ -802,8 +889,10 @@ MtpResponseCode MtpServer::doGetPartialObject(MtpOperationCode operation) {
     mResponse.setParameter(1, length);
 
     // transfer the file
+    MtpTransferStats stats(mfr.command);
     int ret = ioctl(mFD, MTP_SEND_FILE_WITH_HEADER, (unsigned long)&mfr);
     ALOGV("MTP_SEND_FILE_WITH_HEADER returned %d\n", ret);
+    stats.done(mfr.length, ret);
     close(mfr.fd);
     if (ret < 0) {
         if (errno == ECANCELED)
@@ -885,6 +974,7 @@ MtpResponseCode MtpServer::doSendObjectInfo() {
     if (handle == kInvalidObjectHandle) {
         return MTP_RESPONSE_GENERAL_ERROR;
     }
+    storage->objectAdded(handle, format, parent);
 
   if (format == MTP_FORMAT_ASSOCIATION) {
         mode_t mask = umask(0);
@@ -956,9 +1046,17 @@ MtpResponseCode MtpServer::doSendObject() {
         }
 
         ALOGV("receiving %s\n", (const char *)mSendObjectFilePath);
-        // transfer the file
+        // transfer the file; the driver writes the USB buffers to the file itself
+        MtpTransferStats stats(mRequest.getOperationCode());
         ret = ioctl(mFD, MTP_RECEIVE_FILE, (unsigned long)&mfr);
         ALOGV("MTP_RECEIVE_FILE returned %d\n", ret);
+        if (ret >= 0) {
+            struct stat sb;
+            if (fstat(mfr.fd, &sb) == 0)
+                stats.done(sb.st_size - initialData, ret);
+        } else {
+            stats.done(0, ret);
+        }
     }
     close(mfr.fd);
 
@@ -976,6 +1074,9 @@ done:
 
     mDatabase->endSendObject(mSendObjectFilePath, mSendObjectHandle, mSendObjectFormat,
             result == MTP_RESPONSE_OK);
+    // the database drops the object if the transfer failed
+    if (result != MTP_RESPONSE_OK)
+        removeFromObjectListCaches(mSendObjectHandle);
     mSendObjectHandle = kInvalidObjectHandle;
     mSendObjectFormat = 0;
     return result;
@@ -1058,6 +1159,11 @@ MtpResponseCode MtpServer::doDeleteObject() {
         // Don't delete the actual files unless the database deletion is allowed
         if (result == MTP_RESPONSE_OK) {
             deletePath((const char *)filePath);
+            // a directory takes all of its descendants with it
+            if (format == MTP_FORMAT_ASSOCIATION)
+                clearObjectListCaches();
+            else
+                removeFromObjectListCaches(handle);
         }
     }
 
@@ -68,6 +68,13 @@ private:
 
     Mutex               mMutex;
 
+    // objects added or removed by the media provider since the object list
+    // caches in MtpStorage were last brought up to date. mMutex is held for
+    // whole transfers, so these have their own lock.
+    Mutex               mObjectEventMutex;
+    MtpObjectHandleList mAddedObjects;
+    bool                mObjectListsStale;
+
     // represents an MTP object that is being edited using the android extensions
     // for direct editing (BeginEditObject, SendPartialObject, TruncateObject and EndEditObject)
     class ObjectEdit {
@@ -116,6 +123,10 @@ private:
     void                removeEditObject(MtpObjectHandle handle);
     void                commitEdit(ObjectEdit* edit);
 
+    void                updateObjectListCaches();
+    void                removeFromObjectListCaches(MtpObjectHandle handle);
+    void                clearObjectListCaches();
+
     bool                handleRequest();
 
     MtpResponseCode     doGetDeviceInfo();
@@ -47,6 +47,7 @@ MtpStorage::MtpStorage(MtpStorageID id, const char* filePath,
 }
 
 MtpStorage::~MtpStorage() {
+    clearObjectListCache();
 }
 
 int MtpStorage::getType() const {
@@ -83,4 +84,73 @@ const char* MtpStorage::getDescription() const {
     return (const char *)mDescription;
 }
 
+const MtpObjectHandleList* MtpStorage::getCachedObjectList(MtpObjectFormat format,
+        MtpObjectHandle parent) const {
+    ssize_t index = mObjectLists.indexOfKey(objectListKey(format, parent));
+    return (index >= 0 ? mObjectLists.valueAt(index) : NULL);
+}
+
+void MtpStorage::cacheObjectList(MtpObjectFormat format, MtpObjectHandle parent,
+        MtpObjectHandleList* list) {
+    uint64_t key = objectListKey(format, parent);
+    ssize_t index = mObjectLists.indexOfKey(key);
+    if (index >= 0) {
+        delete mObjectLists.valueAt(index);
+        mObjectLists.replaceValueAt(index, list);
+    } else {
+        mObjectLists.add(key, list);
+    }
+}
+
+void MtpStorage::objectAdded(MtpObjectHandle handle, MtpObjectFormat format,
+        MtpObjectHandle parent) {
+    for (size_t i = 0; i < mObjectLists.size(); i++) {
+        uint64_t key = mObjectLists.keyAt(i);
+        MtpObjectFormat listFormat = (MtpObjectFormat)(key >> 32);
+        MtpObjectHandle listParent = (MtpObjectHandle)key;
+
+        if (listFormat != 0 && listFormat != format)
+            continue;
+        // list parent 0 means all objects in the storage
+        if (listParent != 0 && listParent != (parent == 0 ? MTP_PARENT_ROOT : parent))
+            continue;
+
+        // the list may have been loaded after the object was created
+        MtpObjectHandleList* list = mObjectLists.editValueAt(i);
+        size_t count = list->size();
+        size_t j;
+        for (j = 0; j < count; j++) {
+            if ((*list)[j] == handle)
+                break;
+        }
+        if (j == count)
+            list->push(handle);
+    }
+}
+
+void MtpStorage::objectRemoved(MtpObjectHandle handle) {
+    for (size_t i = 0; i < mObjectLists.size(); ) {
+        if ((MtpObjectHandle)mObjectLists.keyAt(i) == handle) {
+            // the children of a removed association
+            delete mObjectLists.valueAt(i);
+            mObjectLists.removeItemsAt(i);
+            continue;
+        }
+        MtpObjectHandleList* list = mObjectLists.editValueAt(i);
+        for (size_t j = 0; j < list->size(); j++) {
+            if ((*list)[j] == handle) {
+                list->removeAt(j);
+                break;
+            }
+        }
+        i++;
+    }
+}
+
+void MtpStorage::clearObjectListCache() {
+    for (size_t i = 0; i < mObjectLists.size(); i++)
+        delete mObjectLists.valueAt(i);
+    mObjectLists.clear();
+}
+
 }  // namespace android
@@ -20,6 +20,8 @@
 #include "MtpTypes.h"
 #include "mtp.h"
 
+#include <utils/KeyedVector.h>
+
 namespace android {
 
 class MtpDatabase;
@@ -36,6 +38,13 @@ private:
     uint64_t                mReserveSpace;
     bool                    mRemovable;
 
+    // GetObjectHandles results for this storage, keyed by format and parent.
+    // Only touched from the server thread.
+    KeyedVector<uint64_t, MtpObjectHandleList*> mObjectLists;
+
+    static inline uint64_t  objectListKey(MtpObjectFormat format, MtpObjectHandle parent)
+                                { return ((uint64_t)format << 32) | parent; }
+
 public:
                             MtpStorage(MtpStorageID id, const char* filePath,
                                     const char* description, uint64_t reserveSpace,
@@ -52,6 +61,18 @@ public:
     inline const char*      getPath() const { return (const char *)mFilePath; }
     inline bool             isRemovable() const { return mRemovable; }
     inline uint64_t         getMaxFileSize() const { return mMaxFileSize; }
+
+    // returns the cached handle list or NULL; the storage keeps ownership
+    const MtpObjectHandleList* getCachedObjectList(MtpObjectFormat format,
+                                    MtpObjectHandle parent) const;
+    // takes ownership of list
+    void                    cacheObjectList(MtpObjectFormat format, MtpObjectHandle parent,
+                                    MtpObjectHandleList* list);
+    // parent is 0 for objects in the root of the storage
+    void                    objectAdded(MtpObjectHandle handle, MtpObjectFormat format,
+                                    MtpObjectHandle parent);
+    void                    objectRemoved(MtpObjectHandle handle);
+    void                    clearObjectListCache();
 };
 
 }; // namespace android
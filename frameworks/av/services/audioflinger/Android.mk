@@ -23,7 +23,8 @@ LOCAL_SRC_FILES:=               \
     AudioPolicyService.cpp      \
     ServiceUtilities.cpp        \
     AudioResamplerCubic.cpp.arm \
-    AudioResamplerSinc.cpp.arm
+    AudioResamplerSinc.cpp.arm  \
+    AudioResamplerPolyphase.cpp.arm
 
 LOCAL_SRC_FILES += StateQueue.cpp
 
@@ -66,6 +67,11 @@ endif
 
 LOCAL_CFLAGS += -fvisibility=hidden
 
+# SIMD mixer track hooks, see AudioMixerSimd.h
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -DARCH_ARM_HAVE_NEON
+endif
+
 include $(BUILD_SHARED_LIBRARY)
 
 #
@@ -77,7 +83,8 @@ LOCAL_SRC_FILES:=               \
 	test-resample.cpp 			\
     AudioResampler.cpp.arm      \
 	AudioResamplerCubic.cpp.arm \
-    AudioResamplerSinc.cpp.arm
+    AudioResamplerSinc.cpp.arm  \
+    AudioResamplerPolyphase.cpp.arm
 
 LOCAL_SHARED_LIBRARIES := \
     libdl \
@@ -146,7 +146,8 @@ AudioFlinger::AudioFlinger()
       mBtNrecIsOff(false),
       mIsLowRamDevice(true),
       mIsDeviceTypeKnown(false),
-      mGlobalEffectEnableTime(0)
+      mGlobalEffectEnableTime(0),
+      mBatchedMixing(false)
 {
     getpid_cached = getpid();
     char value[PROPERTY_VALUE_MAX];
@@ -154,6 +155,7 @@ AudioFlinger::AudioFlinger()
     if (doLog) {
         mLogMemoryDealer = new MemoryDealer(kLogMemorySize, "LogWriters");
     }
+    mBatchedMixing = (property_get("af.mixer.batched", value, "0") > 0) && (atoi(value) == 1);
 #ifdef TEE_SINK
     (void) property_get("ro.debuggable", value, "0");
     int debuggable = atoi(value);
@@ -1156,7 +1158,8 @@ AudioFlinger::Client::Client(const sp<AudioFlinger>& audioFlinger, pid_t pid)
     :   RefBase(),
         mAudioFlinger(audioFlinger),
         // FIXME should be a "k" constant not hard-coded, in .h or ro. property, see 4 lines below
-        mMemoryDealer(new MemoryDealer(1024*1024, "AudioFlinger::Client")),
+        mMemoryDealer(new MemoryDealer(1024*1024, "AudioFlinger::Client",
+                MemoryDealer::SLAB_ALLOCATIONS)),
         mPid(pid),
         mTimedTrackCount(0)
 {
@@ -1442,6 +1445,26 @@ status_t AudioFlinger::setLowRamDevice(bool isLowRamDevice)
 
 // ----------------------------------------------------------------------------
 
+status_t AudioFlinger::getFastMixerTimings(audio_io_handle_t output, uint32_t *cursor,
+        Vector<FastMixerCycleTiming> *timings)
+{
+    if (!dumpAllowed()) {
+        return PERMISSION_DENIED;
+    }
+    if (cursor == NULL || timings == NULL) {
+        return BAD_VALUE;
+    }
+    // the thread can't exit while we hold mLock, and the timing log itself is lock-free
+    Mutex::Autolock _l(mLock);
+    PlaybackThread *thread = checkPlaybackThread_l(output);
+    if (thread == NULL) {
+        return BAD_VALUE;
+    }
+    return thread->getFastMixerTimings(cursor, timings);
+}
+
+// ----------------------------------------------------------------------------
+
 audio_io_handle_t AudioFlinger::openOutput(audio_module_handle_t module,
                                            audio_devices_t *pDevices,
                                            uint32_t *pSamplingRate,
@@ -1521,6 +1544,16 @@ audio_io_handle_t AudioFlinger::openOutput(audio_module_handle_t module,
         }
         mPlaybackThreads.add(id, thread);
 
+        if (mBatchedMixing && thread->type() == ThreadBase::MIXER) {
+            PlaybackThread *primaryThread = primaryPlaybackThread_l();
+            if (primaryThread != NULL && primaryThread != thread &&
+                    primaryThread->type() == ThreadBase::MIXER) {
+                bool batched = ((MixerThread *)primaryThread)->addBatchFollower(
+                        (MixerThread *)thread);
+                ALOGV_IF(batched, "openOutput() output %d batched with primary output", id);
+            }
+        }
+
         if (pSamplingRate != NULL) {
             *pSamplingRate = config.sample_rate;
         }
@@ -1623,6 +1656,10 @@ status_t AudioFlinger::closeOutput_nonvirtual(audio_io_handle_t output)
         }
         audioConfigChanged_l(AudioSystem::OUTPUT_CLOSED, output, NULL);
     }
+    if (thread->type() == ThreadBase::MIXER) {
+        // without AudioFlinger::mLock, as a batch cycle in progress may call into audio policy
+        ((MixerThread *)thread.get())->detachBatch();
+    }
     thread->exit();
     // The thread entity (active unit of execution) is no longer running here,
     // but the ThreadBase container still exists.
@@ -1853,6 +1890,15 @@ status_t AudioFlinger::setStreamOutput(audio_stream_type_t stream, audio_io_hand
         thread->invalidateTracks(stream);
     }
 
+    // let clients drop the output they cached for the stream
+    PlaybackThread *thread = checkPlaybackThread_l(output);
+    if (thread == NULL && !mPlaybackThreads.isEmpty()) {
+        thread = mPlaybackThreads.valueAt(0).get();
+    }
+    if (thread != NULL) {
+        thread->audioConfigChanged_l(AudioSystem::STREAM_CONFIG_CHANGED, stream);
+    }
+
     return NO_ERROR;
 }
 
@@ -66,6 +66,7 @@ class AudioMixer;
 class AudioBuffer;
 class AudioResampler;
 class FastMixer;
+class MonoPipe;
 class ServerProxy;
 
 // ----------------------------------------------------------------------------
@@ -224,6 +225,9 @@ public:
 
     virtual status_t setLowRamDevice(bool isLowRamDevice);
 
+    virtual status_t getFastMixerTimings(audio_io_handle_t output, uint32_t *cursor,
+                                    Vector<FastMixerCycleTiming> *timings);
+
     virtual     status_t    onTransact(
                                 uint32_t code,
                                 const Parcel& data,
@@ -647,6 +651,10 @@ private:
     bool    mIsLowRamDevice;
     bool    mIsDeviceTypeKnown;
     nsecs_t mGlobalEffectEnableTime;  // when a global effect was last enabled
+
+    // af.mixer.batched: mix outputs with the primary output's period in the primary
+    // mixer thread's cycle, see MixerThread::addBatchFollower()
+    bool    mBatchedMixing;
 };
 
 #undef INCLUDING_FROM_AUDIOFLINGER_H
@@ -19,10 +19,13 @@
 //#define LOG_NDEBUG 0
 
 #include "Configuration.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <utils/Errors.h>
 #include <utils/Log.h>
@@ -40,6 +43,7 @@
 #include <media/EffectsFactoryApi.h>
 
 #include "AudioMixer.h"
+#include "AudioMixerSimd.h"
 
 namespace android {
 
@@ -201,6 +205,7 @@ int AudioMixer::getTrackName(audio_channel_mask_t channelMask, int sessionId)
         t->channelCount = 2;
         t->enabled = false;
         t->format = 16;
+        t->mainBufferFormat = MIX_FORMAT_INT16;
         t->channelMask = AUDIO_CHANNEL_OUT_STEREO;
         t->sessionId = sessionId;
         // setBufferProvider(name, AudioBufferProvider *) is required before enable(name)
@@ -458,6 +463,14 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
         case FORMAT:
             ALOG_ASSERT(valueInt == AUDIO_FORMAT_PCM_16_BIT);
             break;
+        case MAIN_BUFFER_FORMAT:
+            ALOG_ASSERT(valueInt == MIX_FORMAT_INT16 || valueInt == MIX_FORMAT_FLOAT);
+            if (track.mainBufferFormat != valueInt) {
+                track.mainBufferFormat = valueInt;
+                ALOGV("setParameter(TRACK, MAIN_BUFFER_FORMAT, %d)", valueInt);
+                invalidateState(1 << name);
+            }
+            break;
         // FIXME do we want to support setting the downmix type from AudioFlinger?
         //         for a specific track? or per mixer?
         /* case DOWNMIX_TYPE:
@@ -674,6 +687,11 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
             n |= NEEDS_AUX_ENABLED;
         }
 
+        // the 16-bit fast paths write the main buffer directly
+        if (t.mainBufferFormat != MIX_FORMAT_INT16) {
+            all16BitsStereoNoResample = false;
+        }
+
         if (t.volumeInc[0]|t.volumeInc[1]) {
             volumeRamp = true;
         } else if (!t.doesResample() && t.volumeRL == 0) {
@@ -690,16 +708,18 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
             if ((n & NEEDS_RESAMPLE__MASK) == NEEDS_RESAMPLE_ENABLED) {
                 all16BitsStereoNoResample = false;
                 resampling = true;
-                t.hook = track__genericResample;
+                t.hook = sUseSimd ? track__genericResampleSimd : track__genericResample;
                 ALOGV_IF((n & NEEDS_CHANNEL_COUNT__MASK) > NEEDS_CHANNEL_2,
                         "Track %d needs downmix + resample", i);
             } else {
+                // the SIMD hooks only cover the main buffer; aux sends stay on the scalar path
+                const bool simd = sUseSimd && (n & NEEDS_AUX__MASK) == NEEDS_AUX_DISABLED;
                 if ((n & NEEDS_CHANNEL_COUNT__MASK) == NEEDS_CHANNEL_1){
-                    t.hook = track__16BitsMono;
+                    t.hook = simd ? track__16BitsMonoSimd : track__16BitsMono;
                     all16BitsStereoNoResample = false;
                 }
                 if ((n & NEEDS_CHANNEL_COUNT__MASK) >= NEEDS_CHANNEL_2){
-                    t.hook = track__16BitsStereo;
+                    t.hook = simd ? track__16BitsStereoSimd : track__16BitsStereo;
                     ALOGV_IF((n & NEEDS_CHANNEL_COUNT__MASK) > NEEDS_CHANNEL_2,
                             "Track %d needs downmix", i);
                 }
@@ -1060,11 +1080,144 @@ void AudioMixer::track__16BitsMono(track_t* t, int32_t* out, size_t frameCount,
     t->in = in;
 }
 
+#if AUDIO_MIXER_SIMD
+
+void AudioMixer::track__genericResampleSimd(track_t* t, int32_t* out, size_t outFrameCount,
+        int32_t* temp, int32_t* aux)
+{
+    t->resampler->setSampleRate(t->sampleRate);
+
+    // same structure as track__genericResample(), only the gain stage differs
+    if (aux != NULL) {
+        t->resampler->setVolume(UNITY_GAIN, UNITY_GAIN);
+        memset(temp, 0, outFrameCount * MAX_NUM_CHANNELS * sizeof(int32_t));
+        t->resampler->resample(temp, outFrameCount, t->bufferProvider);
+        if (CC_UNLIKELY(t->volumeInc[0]|t->volumeInc[1]|t->auxInc)) {
+            volumeRampStereo(t, out, outFrameCount, temp, aux);
+        } else {
+            volumeStereoSimd(t, out, outFrameCount, temp, aux);
+        }
+    } else {
+        if (CC_UNLIKELY(t->volumeInc[0]|t->volumeInc[1])) {
+            t->resampler->setVolume(UNITY_GAIN, UNITY_GAIN);
+            memset(temp, 0, outFrameCount * MAX_NUM_CHANNELS * sizeof(int32_t));
+            t->resampler->resample(temp, outFrameCount, t->bufferProvider);
+            volumeRampStereoSimd(t, out, outFrameCount, temp, aux);
+        }
+
+        // constant gain
+        else {
+            t->resampler->setVolume(t->volume[0], t->volume[1]);
+            t->resampler->resample(out, outFrameCount, t->bufferProvider);
+        }
+    }
+}
+
+void AudioMixer::volumeRampStereoSimd(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
+        int32_t* aux)
+{
+    if (CC_UNLIKELY(aux != NULL)) {
+        volumeRampStereo(t, out, frameCount, temp, aux);
+        return;
+    }
+    AudioMixerKernels::mixStereo32RampSimd(out, temp, frameCount,
+            &t->prevVolume[0], &t->prevVolume[1], t->volumeInc[0], t->volumeInc[1]);
+    t->adjustVolumeRamp(false);
+}
+
+void AudioMixer::volumeStereoSimd(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
+        int32_t* aux)
+{
+    AudioMixerKernels::mixStereo32Simd(out, temp, frameCount, t->volume[0], t->volume[1]);
+    if (CC_UNLIKELY(aux != NULL)) {
+        // the aux send is independent of the main mix, so a second pass is still bit-exact
+        const int16_t va = t->auxLevel;
+        do {
+            int16_t l = (int16_t)(*temp++ >> 12);
+            int16_t r = (int16_t)(*temp++ >> 12);
+            int16_t a = (int16_t)(((int32_t)l + r) >> 1);
+            aux[0] = mulAdd(a, va, aux[0]);
+            aux++;
+        } while (--frameCount);
+    }
+}
+
+void AudioMixer::track__16BitsStereoSimd(track_t* t, int32_t* out, size_t frameCount,
+        int32_t* temp, int32_t* aux)
+{
+    if (CC_UNLIKELY(aux != NULL)) {
+        track__16BitsStereo(t, out, frameCount, temp, aux);
+        return;
+    }
+    const int16_t *in = static_cast<const int16_t *>(t->in);
+    if (CC_UNLIKELY(t->volumeInc[0]|t->volumeInc[1])) {
+        AudioMixerKernels::mixStereo16RampSimd(out, in, frameCount,
+                &t->prevVolume[0], &t->prevVolume[1], t->volumeInc[0], t->volumeInc[1]);
+        t->adjustVolumeRamp(false);
+    } else {
+        AudioMixerKernels::mixStereo16Simd(out, in, frameCount, t->volume[0], t->volume[1]);
+    }
+    t->in = in + frameCount * 2;
+}
+
+void AudioMixer::track__16BitsMonoSimd(track_t* t, int32_t* out, size_t frameCount,
+        int32_t* temp, int32_t* aux)
+{
+    if (CC_UNLIKELY(aux != NULL)) {
+        track__16BitsMono(t, out, frameCount, temp, aux);
+        return;
+    }
+    const int16_t *in = static_cast<const int16_t *>(t->in);
+    if (CC_UNLIKELY(t->volumeInc[0]|t->volumeInc[1])) {
+        AudioMixerKernels::mixMono16RampSimd(out, in, frameCount,
+                &t->prevVolume[0], &t->prevVolume[1], t->volumeInc[0], t->volumeInc[1]);
+        t->adjustVolumeRamp(false);
+    } else {
+        AudioMixerKernels::mixMono16Simd(out, in, frameCount, t->volume[0], t->volume[1]);
+    }
+    t->in = in + frameCount;
+}
+
+#else // AUDIO_MIXER_SIMD
+
+// sUseSimd is never true without SIMD support, these only satisfy the linker
+
+void AudioMixer::track__genericResampleSimd(track_t* t, int32_t* out, size_t outFrameCount,
+        int32_t* temp, int32_t* aux)
+{
+    track__genericResample(t, out, outFrameCount, temp, aux);
+}
+
+void AudioMixer::volumeRampStereoSimd(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
+        int32_t* aux)
+{
+    volumeRampStereo(t, out, frameCount, temp, aux);
+}
+
+void AudioMixer::volumeStereoSimd(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
+        int32_t* aux)
+{
+    volumeStereo(t, out, frameCount, temp, aux);
+}
+
+void AudioMixer::track__16BitsStereoSimd(track_t* t, int32_t* out, size_t frameCount,
+        int32_t* temp, int32_t* aux)
+{
+    track__16BitsStereo(t, out, frameCount, temp, aux);
+}
+
+void AudioMixer::track__16BitsMonoSimd(track_t* t, int32_t* out, size_t frameCount,
+        int32_t* temp, int32_t* aux)
+{
+    track__16BitsMono(t, out, frameCount, temp, aux);
+}
+
+#endif // AUDIO_MIXER_SIMD
+
 // no-op case
 void AudioMixer::process__nop(state_t* state, int64_t pts)
 {
     uint32_t e0 = state->enabledTracks;
-    size_t bufSize = state->frameCount * sizeof(int16_t) * MAX_NUM_CHANNELS;
     while (e0) {
         // process by group of tracks with same output buffer to
         // avoid multiple memset() on same buffer
@@ -1083,7 +1236,8 @@ void AudioMixer::process__nop(state_t* state, int64_t pts)
             }
             e0 &= ~(e1);
 
-            memset(t1.mainBuffer, 0, bufSize);
+            memset(t1.mainBuffer, 0, state->frameCount * MAX_NUM_CHANNELS *
+                    (t1.mainBufferFormat == MIX_FORMAT_FLOAT ? sizeof(float) : sizeof(int16_t)));
         }
 
         while (e1) {
@@ -1141,8 +1295,7 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
             }
         }
         e0 &= ~(e1);
-        // this assumes output 16 bits stereo, no resampling
-        int32_t *out = t1.mainBuffer;
+        // this assumes output stereo, no resampling
         size_t numFrames = 0;
         do {
             memset(outTemp, 0, sizeof(outTemp));
@@ -1191,8 +1344,7 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
                     }
                 }
             }
-            ditherAndClamp(out, outTemp, BLOCKSIZE);
-            out += BLOCKSIZE;
+            writeMainBuffer(t1, numFrames, outTemp, BLOCKSIZE);
             numFrames += BLOCKSIZE;
         } while (numFrames < state->frameCount);
     }
@@ -1234,7 +1386,6 @@ void AudioMixer::process__genericResampling(state_t* state, int64_t pts)
             }
         }
         e0 &= ~(e1);
-        int32_t *out = t1.mainBuffer;
         memset(outTemp, 0, size);
         while (e1) {
             const int i = 31 - __builtin_clz(e1);
@@ -1274,7 +1425,40 @@ void AudioMixer::process__genericResampling(state_t* state, int64_t pts)
                 }
             }
         }
-        ditherAndClamp(out, outTemp, numFrames);
+        writeMainBuffer(t1, 0, outTemp, numFrames);
+    }
+}
+
+/*static*/ void AudioMixer::writeMainBuffer(const track_t& t, size_t offset, const int32_t* sums,
+        size_t frameCount)
+{
+    if (CC_LIKELY(t.mainBufferFormat == MIX_FORMAT_INT16)) {
+        // one packed stereo frame per int32_t
+        ditherAndClamp(t.mainBuffer + offset, sums, frameCount);
+        return;
+    }
+    // the sums are Q4.27, where unity gain applied to a full scale 16-bit sample is 1 << 27
+    static const float kScale = 1.0f / (1 << 27);
+    float *out = reinterpret_cast<float *>(t.mainBuffer) + offset * MAX_NUM_CHANNELS;
+    for (size_t i = 0; i < frameCount * MAX_NUM_CHANNELS; i++) {
+        out[i] = sums[i] * kScale;
+    }
+}
+
+/*static*/ void AudioMixer::convertFloatToInt16(int16_t* out, const float* in, size_t count)
+{
+    while (count--) {
+        float f = *in++ * 32768.0f;
+        int32_t s;
+        if (CC_UNLIKELY(f >= 32767.0f)) {
+            s = 32767;
+        } else if (CC_UNLIKELY(f <= -32768.0f)) {
+            s = -32768;
+        } else {
+            // round to nearest
+            s = (int32_t) (f + (f >= 0.0f ? 0.5f : -0.5f));
+        }
+        *out++ = s;
     }
 }
 
@@ -1457,10 +1641,41 @@ int64_t AudioMixer::calculateOutputPTS(const track_t& t, int64_t basePTS,
 /*static*/ uint64_t AudioMixer::sLocalTimeFreq;
 /*static*/ pthread_once_t AudioMixer::sOnceControl = PTHREAD_ONCE_INIT;
 
+/*static*/ bool AudioMixer::sUseSimd = false;
+
+#if defined(ARCH_ARM_HAVE_NEON)
+// NEON is optional on ARMv7, so the build flag alone is not enough
+static bool cpuHasNeon()
+{
+    char cpuinfo[4096];
+    int fd = open("/proc/cpuinfo", O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t len;
+    do {
+        len = read(fd, cpuinfo, sizeof(cpuinfo) - 1);
+    } while (len < 0 && errno == EINTR);
+    close(fd);
+    if (len <= 0) {
+        return false;
+    }
+    cpuinfo[len] = '\0';
+    return strstr(cpuinfo, " neon") != NULL;
+}
+#endif
+
 /*static*/ void AudioMixer::sInitRoutine()
 {
     LocalClock lc;
     sLocalTimeFreq = lc.getLocalFreq();
+
+#if defined(ARCH_ARM_HAVE_NEON)
+    sUseSimd = cpuHasNeon();
+#elif AUDIO_MIXER_SIMD
+    sUseSimd = true;
+#endif
+    ALOGV("AudioMixer %s SIMD track hooks", sUseSimd ? "using" : "not using");
 }
 
 // ----------------------------------------------------------------------------
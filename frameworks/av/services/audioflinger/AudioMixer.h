@@ -77,6 +77,7 @@ public:
         MAIN_BUFFER     = 0x4002,
         AUX_BUFFER      = 0x4003,
         DOWNMIX_TYPE    = 0X4004,
+        MAIN_BUFFER_FORMAT = 0x4005, // format of MAIN_BUFFER, one of mix_format_t
         // for target RESAMPLE
         SAMPLE_RATE     = 0x4100, // Configure sample rate conversion on this track name;
                                   // parameter 'value' is the new sample rate in Hz.
@@ -95,6 +96,19 @@ public:
         AUXLEVEL        = 0x4210,
     };
 
+    // Formats of a track main buffer.  In MIX_FORMAT_FLOAT the sum of the tracks is written
+    // as interleaved stereo float with full scale at +/-1.0 and without any clamping, so that
+    // the headroom of the accumulator is kept until the buffer is converted for the sink
+    // with convertFloatToInt16().
+    enum mix_format_t {
+        MIX_FORMAT_INT16    = 0,    // default, packed 16-bit stereo
+        MIX_FORMAT_FLOAT    = 1,
+    };
+
+    // Convert count samples of a MIX_FORMAT_FLOAT buffer to 16-bit PCM, clamping to full scale.
+    // out and in may not overlap.
+    static void convertFloatToInt16(int16_t* out, const float* in, size_t count);
+
 
     // For all APIs with "name": TRACK0 <= name < TRACK0 + MAX_NUM_TRACKS
 
@@ -201,7 +215,9 @@ private:
 
         int32_t     sessionId;
 
-        int32_t     padding[2];
+        uint8_t     mainBufferFormat;   // mix_format_t
+        uint8_t     padding8[3];
+        int32_t     padding[1];
 
         // 16-byte boundary
 
@@ -280,6 +296,19 @@ private:
     static void volumeStereo(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
             int32_t* aux);
 
+    // SIMD variants of the hooks above, selected by process__validate() when sUseSimd is true.
+    // They produce bit-exact results with the scalar hooks; see AudioMixerSimd.h.
+    static void track__genericResampleSimd(track_t* t, int32_t* out, size_t numFrames,
+            int32_t* temp, int32_t* aux);
+    static void track__16BitsStereoSimd(track_t* t, int32_t* out, size_t numFrames,
+            int32_t* temp, int32_t* aux);
+    static void track__16BitsMonoSimd(track_t* t, int32_t* out, size_t numFrames, int32_t* temp,
+            int32_t* aux);
+    static void volumeRampStereoSimd(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
+            int32_t* aux);
+    static void volumeStereoSimd(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
+            int32_t* aux);
+
     static void process__validate(state_t* state, int64_t pts);
     static void process__nop(state_t* state, int64_t pts);
     static void process__genericNoResampling(state_t* state, int64_t pts);
@@ -291,10 +320,16 @@ private:
                                                            int64_t pts);
 #endif
 
+    // Write frameCount frames of accumulator sums to a main buffer at frame offset, in the
+    // main buffer format of track t.
+    static void writeMainBuffer(const track_t& t, size_t offset, const int32_t* sums,
+                                size_t frameCount);
+
     static int64_t calculateOutputPTS(const track_t& t, int64_t basePTS,
                                       int outputFrameIndex);
 
     static uint64_t         sLocalTimeFreq;
+    static bool             sUseSimd;   // SIMD hooks are available on this CPU
     static pthread_once_t   sOnceControl;
     static void             sInitRoutine();
 };
@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_SIMD_H
+#define ANDROID_AUDIO_MIXER_SIMD_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#if defined(ARCH_ARM_HAVE_NEON)
+#include <arm_neon.h>
+#define AUDIO_MIXER_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SIMD 1
+#else
+#define AUDIO_MIXER_SIMD 0
+#endif
+
+namespace android {
+
+// ----------------------------------------------------------------------------
+
+// Inner loops of the AudioMixer track hooks for the case where no auxiliary send is active.
+//
+// Each kernel exists in two flavors: a portable "C" version, which is the reference
+// and is bit-exact with the historic scalar loops of AudioMixer.cpp, and a "Simd" version
+// which produces exactly the same output but processes several frames per iteration.
+// The SIMD versions fall back to the scalar loop for the trailing frames, so any
+// frame count (including 0) is accepted.
+//
+// All ramps use the 16.16 fixed point volume representation of track_t::prevVolume;
+// constant volumes use the 4.12 representation of track_t::volume.
+
+struct AudioMixerKernels {
+
+    // out[2*i+c] += in[2*i+c] * vol[c], for 16-bit interleaved stereo input
+    static inline void mixStereo16C(int32_t* out, const int16_t* in, size_t frameCount,
+            int16_t vl, int16_t vr) {
+        for (size_t i = 0; i < frameCount; i++) {
+            out[0] += (int32_t)in[0] * vl;
+            out[1] += (int32_t)in[1] * vr;
+            in += 2;
+            out += 2;
+        }
+    }
+
+    // out[2*i+c] += in[i] * vol[c], for 16-bit mono input
+    static inline void mixMono16C(int32_t* out, const int16_t* in, size_t frameCount,
+            int16_t vl, int16_t vr) {
+        for (size_t i = 0; i < frameCount; i++) {
+            const int32_t l = *in++;
+            out[0] += l * vl;
+            out[1] += l * vr;
+            out += 2;
+        }
+    }
+
+    // ramped volume variant of mixStereo16C(); updates *pvl and *pvr
+    static inline void mixStereo16RampC(int32_t* out, const int16_t* in, size_t frameCount,
+            int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc) {
+        int32_t vl = *pvl;
+        int32_t vr = *pvr;
+        for (size_t i = 0; i < frameCount; i++) {
+            *out++ += (vl >> 16) * (int32_t) *in++;
+            *out++ += (vr >> 16) * (int32_t) *in++;
+            vl += vlInc;
+            vr += vrInc;
+        }
+        *pvl = vl;
+        *pvr = vr;
+    }
+
+    // ramped volume variant of mixMono16C(); updates *pvl and *pvr
+    static inline void mixMono16RampC(int32_t* out, const int16_t* in, size_t frameCount,
+            int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc) {
+        int32_t vl = *pvl;
+        int32_t vr = *pvr;
+        for (size_t i = 0; i < frameCount; i++) {
+            const int32_t l = *in++;
+            *out++ += (vl >> 16) * l;
+            *out++ += (vr >> 16) * l;
+            vl += vlInc;
+            vr += vrInc;
+        }
+        *pvl = vl;
+        *pvr = vr;
+    }
+
+    // out[2*i+c] += (int16_t)(temp[2*i+c] >> 12) * vol[c], for resampler output at unity gain
+    static inline void mixStereo32C(int32_t* out, const int32_t* temp, size_t frameCount,
+            int16_t vl, int16_t vr) {
+        for (size_t i = 0; i < frameCount; i++) {
+            const int16_t l = (int16_t)(*temp++ >> 12);
+            const int16_t r = (int16_t)(*temp++ >> 12);
+            out[0] += (int32_t)l * vl;
+            out[1] += (int32_t)r * vr;
+            out += 2;
+        }
+    }
+
+    // ramped volume variant of mixStereo32C(); note the input is not truncated to 16 bits
+    static inline void mixStereo32RampC(int32_t* out, const int32_t* temp, size_t frameCount,
+            int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc) {
+        int32_t vl = *pvl;
+        int32_t vr = *pvr;
+        for (size_t i = 0; i < frameCount; i++) {
+            *out++ += (vl >> 16) * (*temp++ >> 12);
+            *out++ += (vr >> 16) * (*temp++ >> 12);
+            vl += vlInc;
+            vr += vrInc;
+        }
+        *pvl = vl;
+        *pvr = vr;
+    }
+
+#if AUDIO_MIXER_SIMD
+
+    static inline void mixStereo16Simd(int32_t* out, const int16_t* in, size_t frameCount,
+            int16_t vl, int16_t vr) {
+        size_t blocks = frameCount >> 2;
+#if defined(ARCH_ARM_HAVE_NEON)
+        const int16_t v[4] = { vl, vr, vl, vr };
+        const int16x4_t vol = vld1_s16(v);
+        while (blocks--) {
+            const int16x8_t s = vld1q_s16(in);
+            vst1q_s32(out, vmlal_s16(vld1q_s32(out), vget_low_s16(s), vol));
+            vst1q_s32(out + 4, vmlal_s16(vld1q_s32(out + 4), vget_high_s16(s), vol));
+            in += 8;
+            out += 8;
+        }
+#else
+        const __m128i vol = _mm_set_epi16(vr, vl, vr, vl, vr, vl, vr, vl);
+        while (blocks--) {
+            const __m128i s = _mm_loadu_si128((const __m128i*)in);
+            mulAcc16x8(out, s, vol);
+            in += 8;
+            out += 8;
+        }
+#endif
+        mixStereo16C(out, in, frameCount & 3, vl, vr);
+    }
+
+    static inline void mixMono16Simd(int32_t* out, const int16_t* in, size_t frameCount,
+            int16_t vl, int16_t vr) {
+        size_t blocks = frameCount >> 2;
+#if defined(ARCH_ARM_HAVE_NEON)
+        const int16_t v[4] = { vl, vr, vl, vr };
+        const int16x4_t vol = vld1_s16(v);
+        while (blocks--) {
+            const int16x4_t m = vld1_s16(in);
+            const int16x4x2_t s = vzip_s16(m, m);
+            vst1q_s32(out, vmlal_s16(vld1q_s32(out), s.val[0], vol));
+            vst1q_s32(out + 4, vmlal_s16(vld1q_s32(out + 4), s.val[1], vol));
+            in += 4;
+            out += 8;
+        }
+#else
+        const __m128i vol = _mm_set_epi16(vr, vl, vr, vl, vr, vl, vr, vl);
+        while (blocks--) {
+            const __m128i m = _mm_loadl_epi64((const __m128i*)in);
+            mulAcc16x8(out, _mm_unpacklo_epi16(m, m), vol);
+            in += 4;
+            out += 8;
+        }
+#endif
+        mixMono16C(out, in, frameCount & 3, vl, vr);
+    }
+
+    static inline void mixStereo16RampSimd(int32_t* out, const int16_t* in, size_t frameCount,
+            int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc) {
+        size_t blocks = frameCount >> 2;
+        if (blocks) {
+            // lanes hold the volumes of two consecutive frames: vl(n), vr(n), vl(n+1), vr(n+1)
+#if defined(ARCH_ARM_HAVE_NEON)
+            int32x4_t v0, v1, step;
+            initRamp(&v0, &v1, &step, *pvl, *pvr, vlInc, vrInc);
+            for (size_t b = blocks; b; b--) {
+                const int16x8_t s = vld1q_s16(in);
+                vst1q_s32(out, vmlaq_s32(vld1q_s32(out),
+                        vshrq_n_s32(v0, 16), vmovl_s16(vget_low_s16(s))));
+                vst1q_s32(out + 4, vmlaq_s32(vld1q_s32(out + 4),
+                        vshrq_n_s32(v1, 16), vmovl_s16(vget_high_s16(s))));
+                v0 = vaddq_s32(v0, step);
+                v1 = vaddq_s32(v1, step);
+                in += 8;
+                out += 8;
+            }
+#else
+            __m128i v0, v1, step;
+            initRamp(&v0, &v1, &step, *pvl, *pvr, vlInc, vrInc);
+            for (size_t b = blocks; b; b--) {
+                const __m128i s = _mm_loadu_si128((const __m128i*)in);
+                mulAccRamp(out, _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16), v0);
+                mulAccRamp(out + 4, _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16), v1);
+                v0 = _mm_add_epi32(v0, step);
+                v1 = _mm_add_epi32(v1, step);
+                in += 8;
+                out += 8;
+            }
+#endif
+            advanceRamp(pvl, pvr, vlInc, vrInc, blocks << 2);
+        }
+        mixStereo16RampC(out, in, frameCount & 3, pvl, pvr, vlInc, vrInc);
+    }
+
+    static inline void mixMono16RampSimd(int32_t* out, const int16_t* in, size_t frameCount,
+            int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc) {
+        size_t blocks = frameCount >> 2;
+        if (blocks) {
+#if defined(ARCH_ARM_HAVE_NEON)
+            int32x4_t v0, v1, step;
+            initRamp(&v0, &v1, &step, *pvl, *pvr, vlInc, vrInc);
+            for (size_t b = blocks; b; b--) {
+                const int16x4_t m = vld1_s16(in);
+                const int16x4x2_t s = vzip_s16(m, m);
+                vst1q_s32(out, vmlaq_s32(vld1q_s32(out),
+                        vshrq_n_s32(v0, 16), vmovl_s16(s.val[0])));
+                vst1q_s32(out + 4, vmlaq_s32(vld1q_s32(out + 4),
+                        vshrq_n_s32(v1, 16), vmovl_s16(s.val[1])));
+                v0 = vaddq_s32(v0, step);
+                v1 = vaddq_s32(v1, step);
+                in += 4;
+                out += 8;
+            }
+#else
+            __m128i v0, v1, step;
+            initRamp(&v0, &v1, &step, *pvl, *pvr, vlInc, vrInc);
+            for (size_t b = blocks; b; b--) {
+                const __m128i m = _mm_loadl_epi64((const __m128i*)in);
+                const __m128i s = _mm_unpacklo_epi16(m, m);
+                mulAccRamp(out, _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16), v0);
+                mulAccRamp(out + 4, _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16), v1);
+                v0 = _mm_add_epi32(v0, step);
+                v1 = _mm_add_epi32(v1, step);
+                in += 4;
+                out += 8;
+            }
+#endif
+            advanceRamp(pvl, pvr, vlInc, vrInc, blocks << 2);
+        }
+        mixMono16RampC(out, in, frameCount & 3, pvl, pvr, vlInc, vrInc);
+    }
+
+    static inline void mixStereo32Simd(int32_t* out, const int32_t* temp, size_t frameCount,
+            int16_t vl, int16_t vr) {
+        size_t blocks = frameCount >> 1;
+#if defined(ARCH_ARM_HAVE_NEON)
+        const int16_t v[4] = { vl, vr, vl, vr };
+        const int16x4_t vol = vld1_s16(v);
+        while (blocks--) {
+            // vmovn truncates, which matches the (int16_t) cast of the scalar loop
+            const int16x4_t s = vmovn_s32(vshrq_n_s32(vld1q_s32(temp), 12));
+            vst1q_s32(out, vmlal_s16(vld1q_s32(out), s, vol));
+            temp += 4;
+            out += 4;
+        }
+#else
+        // volume in the low half of each 32-bit lane, so that madd computes s * v exactly
+        const __m128i vol = _mm_set_epi32((uint16_t)vr, (uint16_t)vl, (uint16_t)vr, (uint16_t)vl);
+        while (blocks--) {
+            __m128i s = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)temp), 12);
+            s = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+            const __m128i o = _mm_loadu_si128((const __m128i*)out);
+            _mm_storeu_si128((__m128i*)out, _mm_add_epi32(o, _mm_madd_epi16(s, vol)));
+            temp += 4;
+            out += 4;
+        }
+#endif
+        mixStereo32C(out, temp, frameCount & 1, vl, vr);
+    }
+
+    static inline void mixStereo32RampSimd(int32_t* out, const int32_t* temp, size_t frameCount,
+            int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc) {
+        size_t blocks = frameCount >> 2;
+        if (blocks) {
+#if defined(ARCH_ARM_HAVE_NEON)
+            int32x4_t v0, v1, step;
+            initRamp(&v0, &v1, &step, *pvl, *pvr, vlInc, vrInc);
+            for (size_t b = blocks; b; b--) {
+                vst1q_s32(out, vmlaq_s32(vld1q_s32(out),
+                        vshrq_n_s32(v0, 16), vshrq_n_s32(vld1q_s32(temp), 12)));
+                vst1q_s32(out + 4, vmlaq_s32(vld1q_s32(out + 4),
+                        vshrq_n_s32(v1, 16), vshrq_n_s32(vld1q_s32(temp + 4), 12)));
+                v0 = vaddq_s32(v0, step);
+                v1 = vaddq_s32(v1, step);
+                temp += 8;
+                out += 8;
+            }
+#else
+            __m128i v0, v1, step;
+            initRamp(&v0, &v1, &step, *pvl, *pvr, vlInc, vrInc);
+            for (size_t b = blocks; b; b--) {
+                mulLoAcc32(out, _mm_srai_epi32(_mm_loadu_si128((const __m128i*)temp), 12),
+                        _mm_srai_epi32(v0, 16));
+                mulLoAcc32(out + 4, _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(temp + 4)), 12),
+                        _mm_srai_epi32(v1, 16));
+                v0 = _mm_add_epi32(v0, step);
+                v1 = _mm_add_epi32(v1, step);
+                temp += 8;
+                out += 8;
+            }
+#endif
+            advanceRamp(pvl, pvr, vlInc, vrInc, blocks << 2);
+        }
+        mixStereo32RampC(out, temp, frameCount & 3, pvl, pvr, vlInc, vrInc);
+    }
+
+private:
+
+    // The ramp arithmetic is done in unsigned to get the same modulo 2^32 behavior
+    // as the vector lanes.
+    static inline void advanceRamp(int32_t* pvl, int32_t* pvr, int32_t vlInc, int32_t vrInc,
+            size_t frames) {
+        *pvl = (int32_t)((uint32_t)*pvl + (uint32_t)vlInc * (uint32_t)frames);
+        *pvr = (int32_t)((uint32_t)*pvr + (uint32_t)vrInc * (uint32_t)frames);
+    }
+
+#if defined(ARCH_ARM_HAVE_NEON)
+    static inline void initRamp(int32x4_t* v0, int32x4_t* v1, int32x4_t* step,
+            int32_t vl, int32_t vr, int32_t vlInc, int32_t vrInc) {
+        const int32_t v[4] = { vl, vr, (int32_t)((uint32_t)vl + vlInc),
+                (int32_t)((uint32_t)vr + vrInc) };
+        const int32_t s[4] = { (int32_t)((uint32_t)vlInc << 1), (int32_t)((uint32_t)vrInc << 1),
+                (int32_t)((uint32_t)vlInc << 1), (int32_t)((uint32_t)vrInc << 1) };
+        *step = vld1q_s32(s);
+        *v0 = vld1q_s32(v);
+        *v1 = vaddq_s32(*v0, *step);
+        *step = vaddq_s32(*step, *step);
+    }
+#else
+    static inline void initRamp(__m128i* v0, __m128i* v1, __m128i* step,
+            int32_t vl, int32_t vr, int32_t vlInc, int32_t vrInc) {
+        const int32_t vlIncx2 = (int32_t)((uint32_t)vlInc << 1);
+        const int32_t vrIncx2 = (int32_t)((uint32_t)vrInc << 1);
+        *step = _mm_set_epi32(vrIncx2, vlIncx2, vrIncx2, vlIncx2);
+        *v0 = _mm_set_epi32((int32_t)((uint32_t)vr + vrInc), (int32_t)((uint32_t)vl + vlInc),
+                vr, vl);
+        *v1 = _mm_add_epi32(*v0, *step);
+        *step = _mm_add_epi32(*step, *step);
+    }
+
+    // out[0..7] += s[0..7] * vol[0..7], with exact 32-bit products of 16-bit operands
+    static inline void mulAcc16x8(int32_t* out, __m128i s, __m128i vol) {
+        const __m128i lo = _mm_mullo_epi16(s, vol);
+        const __m128i hi = _mm_mulhi_epi16(s, vol);
+        const __m128i o0 = _mm_loadu_si128((const __m128i*)out);
+        const __m128i o1 = _mm_loadu_si128((const __m128i*)(out + 4));
+        _mm_storeu_si128((__m128i*)out, _mm_add_epi32(o0, _mm_unpacklo_epi16(lo, hi)));
+        _mm_storeu_si128((__m128i*)(out + 4), _mm_add_epi32(o1, _mm_unpackhi_epi16(lo, hi)));
+    }
+
+    // out[0..3] += s[0..3] * (v[0..3] >> 16), where s is a sign-extended 16-bit value;
+    // v >> 16 always fits in 16 bits, so madd on the low halves is exact.
+    static inline void mulAccRamp(int32_t* out, __m128i s, __m128i v) {
+        const __m128i vol = _mm_and_si128(_mm_srai_epi32(v, 16), _mm_set1_epi32(0xFFFF));
+        const __m128i o = _mm_loadu_si128((const __m128i*)out);
+        _mm_storeu_si128((__m128i*)out, _mm_add_epi32(o, _mm_madd_epi16(s, vol)));
+    }
+
+    // out[0..3] += low 32 bits of a[0..3] * b[0..3]; SSE2 has no _mm_mullo_epi32
+    static inline void mulLoAcc32(int32_t* out, __m128i a, __m128i b) {
+        const __m128i even = _mm_mul_epu32(a, b);
+        const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+        const __m128i p = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        const __m128i o = _mm_loadu_si128((const __m128i*)out);
+        _mm_storeu_si128((__m128i*)out, _mm_add_epi32(o, p));
+    }
+#endif
+
+#endif // AUDIO_MIXER_SIMD
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
+
+#endif // ANDROID_AUDIO_MIXER_SIMD_H
@@ -60,7 +60,8 @@ namespace {
 // ----------------------------------------------------------------------------
 
 AudioPolicyService::AudioPolicyService()
-    : BnAudioPolicyService() , mpAudioPolicyDev(NULL) , mpAudioPolicy(NULL)
+    : BnAudioPolicyService() , mpAudioPolicyDev(NULL) , mpAudioPolicy(NULL),
+      mRecordFanOut(false)
 {
     char value[PROPERTY_VALUE_MAX];
     const struct hw_module_t *module;
@@ -69,6 +70,9 @@ AudioPolicyService::AudioPolicyService()
 
     Mutex::Autolock _l(mLock);
 
+    property_get("af.record.fanout", value, "0");
+    mRecordFanOut = atoi(value) != 0;
+
     // start tone playback thread
     mTonePlaybackThread = new AudioCommandThread(String8("ApmTone"), this);
     // start audio commands thread
@@ -126,6 +130,11 @@ AudioPolicyService::~AudioPolicyService()
     }
     mInputs.clear();
 
+    for (size_t i = 0; i < mSharedInputs.size(); i++) {
+        delete mSharedInputs.valueAt(i);
+    }
+    mSharedInputs.clear();
+
     if (mpAudioPolicy != NULL && mpAudioPolicyDev != NULL)
         mpAudioPolicyDev->destroy_audio_policy(mpAudioPolicyDev, mpAudioPolicy);
     if (mpAudioPolicyDev != NULL)
@@ -305,6 +314,20 @@ audio_io_handle_t AudioPolicyService::getInput(audio_source_t inputSource,
     }
 
     Mutex::Autolock _l(mLock);
+    // Hotword capture is never shared, as it may have a different priority than other sources.
+    // An input shared with an earlier client keeps the pre processors of that client's session.
+    bool shareable = mRecordFanOut && inputSource != AUDIO_SOURCE_HOTWORD;
+    if (shareable) {
+        for (size_t i = 0; i < mSharedInputs.size(); i++) {
+            SharedInputDesc *desc = mSharedInputs.valueAt(i);
+            if (desc->mSource == inputSource && desc->mSamplingRate == samplingRate &&
+                    desc->mFormat == format && desc->mChannelMask == channelMask) {
+                desc->mRefCount++;
+                return mSharedInputs.keyAt(i);
+            }
+        }
+    }
+
     // the audio_in_acoustics_t parameter is ignored by get_input()
     audio_io_handle_t input = mpAudioPolicy->get_input(mpAudioPolicy, inputSource, samplingRate,
                                                    format, channelMask, (audio_in_acoustics_t) 0);
@@ -312,6 +335,10 @@ audio_io_handle_t AudioPolicyService::getInput(audio_source_t inputSource,
     if (input == 0) {
         return input;
     }
+    if (shareable) {
+        mSharedInputs.add(input, new SharedInputDesc(inputSource, samplingRate, format,
+                                                     channelMask));
+    }
     // create audio pre processors according to input source
     audio_source_t aliasSource = (inputSource == AUDIO_SOURCE_HOTWORD) ?
                                     AUDIO_SOURCE_VOICE_RECOGNITION : inputSource;
@@ -374,6 +401,15 @@ void AudioPolicyService::releaseInput(audio_io_handle_t input)
         return;
     }
     Mutex::Autolock _l(mLock);
+    ssize_t shared = mSharedInputs.indexOfKey(input);
+    if (shared >= 0) {
+        SharedInputDesc *desc = mSharedInputs.valueAt(shared);
+        if (--desc->mRefCount > 0) {
+            return;
+        }
+        delete desc;
+        mSharedInputs.removeItemsAt(shared);
+    }
     mpAudioPolicy->release_input(mpAudioPolicy, input);
 
     ssize_t index = mInputs.indexOfKey(input);
@@ -670,6 +706,7 @@ AudioPolicyService::AudioCommandThread::AudioCommandThread(String8 name,
     : Thread(false), mName(name), mService(service)
 {
     mpToneGenerator = NULL;
+    memset(mStats, 0, sizeof(mStats));
 }
 
 
@@ -788,6 +825,7 @@ bool AudioPolicyService::AudioCommandThread::threadLoop()
                 default:
                     ALOGW("AudioCommandThread() unknown command %d", command->mCommand);
                 }
+                updateStats_l(command, systemTime());
                 delete command;
                 waitTime = INT64_MAX;
             } else {
@@ -834,6 +872,20 @@ status_t AudioPolicyService::AudioCommandThread::dump(int fd)
     mLastCommand.dump(buffer, SIZE);
     result.append(buffer);
 
+    result.append("- Command stats:\n");
+    result.append("   Command Count      Merged     Avg(ms)  Max(ms)\n");
+    for (size_t i = 0; i < NUM_COMMANDS; i++) {
+        const CommandStats &stats = mStats[i];
+        if (stats.mCount == 0 && stats.mMerged == 0) {
+            continue;
+        }
+        snprintf(buffer, SIZE, "   %02d      %-10u %-10u %-8.2f %.2f\n",
+                (int)i, stats.mCount, stats.mMerged,
+                stats.mCount ? (double)stats.mTotalLatency / stats.mCount / 1000000.0 : 0.0,
+                (double)stats.mMaxLatency / 1000000.0);
+        result.append(buffer);
+    }
+
     write(fd, result.string(), result.size());
 
     if (locked) mLock.unlock();
@@ -882,15 +934,10 @@ status_t AudioPolicyService::AudioCommandThread::volumeCommand(audio_stream_type
     data->mIO = output;
     command->mParam = data;
     Mutex::Autolock _l(mLock);
-    insertCommand_l(command, delayMs);
     ALOGV("AudioCommandThread() adding set volume stream %d, volume %f, output %d",
             stream, volume, output);
+    insertCommand_l(command, delayMs);
     mWaitWorkCV.signal();
-    if (command->mWaitStatus) {
-        command->mCond.wait(mLock);
-        status =  command->mStatus;
-        command->mCond.signal();
-    }
     return status;
 }
 
@@ -929,14 +976,9 @@ status_t AudioPolicyService::AudioCommandThread::voiceVolumeCommand(float volume
     data->mVolume = volume;
     command->mParam = data;
     Mutex::Autolock _l(mLock);
-    insertCommand_l(command, delayMs);
     ALOGV("AudioCommandThread() adding set voice volume volume %f", volume);
+    insertCommand_l(command, delayMs);
     mWaitWorkCV.signal();
-    if (command->mWaitStatus) {
-        command->mCond.wait(mLock);
-        status =  command->mStatus;
-        command->mCond.signal();
-    }
     return status;
 }
 
@@ -977,6 +1019,10 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(AudioCommand *comma
     Vector <AudioCommand *> removedCommands;
     command->mTime = systemTime() + milliseconds(delayMs);
 
+    if (mergeCommand_l(command)) {
+        return;
+    }
+
     // acquire wake lock to make sure delayed commands are processed
     if (mAudioCommands.isEmpty()) {
         acquire_wake_lock(PARTIAL_WAKE_LOCK, mName.string());
@@ -1060,7 +1106,7 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(AudioCommand *comma
     removedCommands.clear();
 
     // wait for status only if delay is 0
-    if (delayMs == 0) {
+    if (delayMs == 0 && !isAsyncCommand(command->mCommand)) {
         command->mWaitStatus = true;
     } else {
         command->mWaitStatus = false;
@@ -1072,6 +1118,78 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(AudioCommand *comma
     mAudioCommands.insertAt(command, i + 1);
 }
 
+bool AudioPolicyService::AudioCommandThread::isAsyncCommand(int command)
+{
+    return command == SET_VOLUME || command == SET_VOICE_VOLUME;
+}
+
+// mergeCommand_l() must be called with mLock held
+// Applies a volume command to a pending command for the same stream and output instead of
+// queuing it, so that a burst of volume changes is applied once. Returns true if the command
+// was merged, in which case it has been deleted.
+bool AudioPolicyService::AudioCommandThread::mergeCommand_l(AudioCommand *command)
+{
+    if (!isAsyncCommand(command->mCommand)) {
+        return false;
+    }
+
+    for (ssize_t i = mAudioCommands.size() - 1; i >= 0; i--) {
+        AudioCommand *command2 = mAudioCommands[i];
+        if (command2->mCommand != command->mCommand) {
+            // volume changes can be reordered with each other, but not with other commands
+            if (isAsyncCommand(command2->mCommand)) continue;
+            return false;
+        }
+
+        bool sameTarget = true;
+        if (command->mCommand == SET_VOLUME) {
+            VolumeData *data = (VolumeData *)command->mParam;
+            VolumeData *data2 = (VolumeData *)command2->mParam;
+            sameTarget = data->mIO == data2->mIO && data->mStream == data2->mStream;
+        }
+        if (!sameTarget) continue;
+
+        // a command for the same target due later is filtered out by insertCommand_l()
+        if (command2->mTime > command->mTime) {
+            return false;
+        }
+
+        if (command->mCommand == SET_VOLUME) {
+            VolumeData *data = (VolumeData *)command->mParam;
+            ((VolumeData *)command2->mParam)->mVolume = data->mVolume;
+            delete data;
+        } else {
+            VoiceVolumeData *data = (VoiceVolumeData *)command->mParam;
+            ((VoiceVolumeData *)command2->mParam)->mVolume = data->mVolume;
+            delete data;
+        }
+        ALOGV("merging command %d into pending command", command->mCommand);
+        mStats[command->mCommand].mMerged++;
+        delete command;
+        return true;
+    }
+    return false;
+}
+
+// updateStats_l() must be called with mLock held
+void AudioPolicyService::AudioCommandThread::updateStats_l(const AudioCommand *command,
+                                                           nsecs_t doneTime)
+{
+    if (command->mCommand < 0 || command->mCommand >= NUM_COMMANDS) {
+        return;
+    }
+    CommandStats &stats = mStats[command->mCommand];
+    nsecs_t latency = doneTime - command->mTime;
+    if (latency < 0) {
+        latency = 0;
+    }
+    stats.mCount++;
+    stats.mTotalLatency += latency;
+    if (latency > stats.mMaxLatency) {
+        stats.mMaxLatency = latency;
+    }
+}
+
 void AudioPolicyService::AudioCommandThread::exit()
 {
     ALOGV("AudioCommandThread::exit");
@@ -194,15 +194,28 @@ private:
                                                   int session);
                     void        releaseOutputCommand(audio_io_handle_t output);
 
+                    // The command may be merged into a pending one and deleted, so
+                    // callers must not access it afterwards unless they wait for
+                    // its status.
                     void        insertCommand_l(AudioCommand *command, int delayMs = 0);
 
     private:
+        enum {
+            NUM_COMMANDS = RELEASE_OUTPUT + 1
+        };
+
+        // Volume commands do not report their status to the audio policy, so
+        // callers do not wait for them.
+        static      bool        isAsyncCommand(int command);
+                    bool        mergeCommand_l(AudioCommand *command);
+                    void        updateStats_l(const AudioCommand *command, nsecs_t doneTime);
+
         // descriptor for requested tone playback event
         class AudioCommand {
 
         public:
             AudioCommand()
-            : mCommand(-1) {}
+            : mCommand(-1), mTime(0), mStatus(NO_ERROR), mWaitStatus(false), mParam(NULL) {}
 
             void dump(char* buffer, size_t size);
 
@@ -250,6 +263,15 @@ private:
             audio_io_handle_t mIO;
         };
 
+        // Latency from the time a command is due to its completion, per
+        // command type
+        struct CommandStats {
+            uint32_t mCount;
+            uint32_t mMerged;   // commands merged into a pending one
+            nsecs_t mTotalLatency;
+            nsecs_t mMaxLatency;
+        };
+
         Mutex   mLock;
         Condition mWaitWorkCV;
         Vector <AudioCommand *> mAudioCommands; // list of pending commands
@@ -257,6 +279,7 @@ private:
         AudioCommand mLastCommand;          // last processed command (used by dump)
         String8 mName;                      // string used by wake lock fo delayed commands
         wp<AudioPolicyService> mService;
+        CommandStats mStats[NUM_COMMANDS];
     };
 
     class EffectDesc {
@@ -313,6 +336,21 @@ private:
         Vector< sp<AudioEffect> >mEffects;
     };
 
+    // An input handed out to several clients, whose capture is fanned out by the RecordThread
+    class SharedInputDesc {
+    public:
+        SharedInputDesc(audio_source_t source, uint32_t samplingRate, audio_format_t format,
+                        audio_channel_mask_t channelMask) :
+            mSource(source), mSamplingRate(samplingRate), mFormat(format),
+            mChannelMask(channelMask), mRefCount(1) {}
+        /*virtual*/ ~SharedInputDesc() {}
+        const audio_source_t        mSource;
+        const uint32_t              mSamplingRate;
+        const audio_format_t        mFormat;
+        const audio_channel_mask_t  mChannelMask;
+        int                         mRefCount;  // number of getInput() not yet released
+    };
+
     static const char * const kInputSourceNames[AUDIO_SOURCE_CNT -1];
 
     void setPreProcessorEnabled(const InputDesc *inputDesc, bool enabled);
@@ -346,6 +384,9 @@ private:
     struct audio_policy *mpAudioPolicy;
     KeyedVector< audio_source_t, InputSourceDesc* > mInputSources;
     KeyedVector< audio_io_handle_t, InputDesc* > mInputs;
+    // only used if mRecordFanOut is true
+    KeyedVector< audio_io_handle_t, SharedInputDesc* > mSharedInputs;
+    bool mRecordFanOut;     // share inputs between clients requesting the same configuration
 };
 
 }; // namespace android
@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioResamplerPolyphase"
+//#define LOG_NDEBUG 0
+
+#include <malloc.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <cutils/compiler.h>
+
+#include <utils/Log.h>
+
+#include "AudioResamplerPolyphase.h"
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+// Kaiser window parameter, ~80 dB stop band attenuation
+static const double kKaiserBeta = 7.5;
+
+// fraction of the lower Nyquist frequency kept in the pass band
+static const double kPassBand = 0.91;
+
+// Banks are shared between all the mixer threads.  The list is only walked and modified
+// under sBankLock, which is never held while a bank is computed: new banks are queued on the
+// list as not ready and computed by sBankThread.
+static pthread_mutex_t sBankLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sBankCond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t sBankThreadOnce = PTHREAD_ONCE_INIT;
+static pthread_t sBankThread;
+static AudioResamplerPolyphase::Bank* sBanks = NULL;
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// zeroth order modified Bessel function of the first kind
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double y = x * x / 4.0;
+    for (int k = 1; k < 32; k++) {
+        term *= y / ((double)k * k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/*static*/ void* AudioResamplerPolyphase::bankThreadLoop(void* /*arg*/)
+{
+    pthread_mutex_lock(&sBankLock);
+    for (;;) {
+        Bank* bank;
+        for (bank = sBanks; bank != NULL; bank = bank->next) {
+            if (!bank->ready) {
+                break;
+            }
+        }
+        if (bank == NULL) {
+            pthread_cond_wait(&sBankCond, &sBankLock);
+            continue;
+        }
+        // keep the bank alive while it is computed outside of the lock
+        bank->refCount++;
+        pthread_mutex_unlock(&sBankLock);
+        computeBank(bank);
+        ALOGV("created polyphase bank %d -> %d Hz, %u phases",
+                bank->inRate, bank->outRate, bank->numPhases);
+        android_atomic_release_store(1, &bank->ready);
+        releaseBank(bank);
+        pthread_mutex_lock(&sBankLock);
+    }
+    return NULL;
+}
+
+/*static*/ void AudioResamplerPolyphase::startBankThread()
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int ret = pthread_create(&sBankThread, &attr, bankThreadLoop, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        // the resamplers stay on their fallback
+        ALOGE("cannot create the polyphase bank thread: %d", ret);
+    }
+}
+
+/*static*/ AudioResamplerPolyphase::Bank* AudioResamplerPolyphase::acquireBank(
+        int32_t inRate, int32_t outRate)
+{
+    // called from the mixer thread: never wait for the bank thread
+    if (pthread_mutex_trylock(&sBankLock) != 0) {
+        return NULL;
+    }
+    Bank* bank;
+    for (bank = sBanks; bank != NULL; bank = bank->next) {
+        if (bank->inRate == inRate && bank->outRate == outRate) {
+            break;
+        }
+    }
+    if (bank == NULL) {
+        bank = new Bank;
+        bank->inRate = inRate;
+        bank->outRate = outRate;
+        bank->numPhases = 0;
+        bank->phaseStep = 0;
+        bank->phaseStepRem = 0;
+        bank->coefs = NULL;
+        bank->ready = 0;
+        bank->refCount = 0;
+        bank->next = sBanks;
+        sBanks = bank;
+        pthread_cond_signal(&sBankCond);
+    }
+    bank->refCount++;
+    pthread_mutex_unlock(&sBankLock);
+    return bank;
+}
+
+/*static*/ void AudioResamplerPolyphase::releaseBank(Bank* bank)
+{
+    if (bank == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sBankLock);
+    if (--bank->refCount != 0) {
+        bank = NULL;
+    } else {
+        Bank** pp = &sBanks;
+        while (*pp != bank) {
+            pp = &(*pp)->next;
+        }
+        *pp = bank->next;
+    }
+    pthread_mutex_unlock(&sBankLock);
+    if (bank != NULL) {
+        ALOGV("deleting polyphase bank %d -> %d Hz", bank->inRate, bank->outRate);
+        free(bank->coefs);
+        delete bank;
+    }
+}
+
+/*static*/ void AudioResamplerPolyphase::computeBank(Bank* bank)
+{
+    const uint32_t inRate = bank->inRate;
+    const uint32_t outRate = bank->outRate;
+    uint32_t phases = outRate / gcd(inRate, outRate);
+    if (phases > kMaxPhases) {
+        phases = kMaxPhases;
+    }
+    bank->numPhases = phases;
+    bank->phaseStep = (uint32_t)(((uint64_t)inRate * phases) / outRate);
+    bank->phaseStepRem = (uint32_t)(((uint64_t)inRate * phases) % outRate);
+
+    // cut-off relative to the input sample rate, lowered when down-sampling
+    double fc = 0.5 * kPassBand;
+    if (outRate < inRate) {
+        fc *= (double)outRate / inRate;
+    }
+
+    // Prototype filter sampled at phases * inRate.  Coefficient j of phase p applies to
+    // input frame n - j, and is stored at index kNumTaps - 1 - j so that the inner product
+    // runs forward over the history, which is kept oldest first.
+    const uint32_t length = phases * kNumTaps;
+    const double center = (length - 1) / 2.0;
+    const double i0Beta = besselI0(kKaiserBeta);
+    bank->coefs = (int16_t*)memalign(32, length * sizeof(int16_t));
+    double* h = new double[kNumTaps];
+    for (uint32_t p = 0; p < phases; p++) {
+        double sum = 0;
+        for (uint32_t j = 0; j < kNumTaps; j++) {
+            const double t = (double)j * phases + p;
+            const double x = (t - center) / phases;     // in input frames
+            const double r = (t - center) / (center + 1);
+            const double w = besselI0(kKaiserBeta * sqrt(fmax(0.0, 1.0 - r * r))) / i0Beta;
+            const double arg = M_PI * 2.0 * fc * x;
+            const double s = (fabs(arg) < 1e-9) ? 1.0 : sin(arg) / arg;
+            h[j] = 2.0 * fc * s * w;
+            sum += h[j];
+        }
+        // normalize every phase to unity DC gain, so that there is no phase dependent ripple
+        int16_t* c = bank->coefs + p * kNumTaps;
+        for (uint32_t j = 0; j < kNumTaps; j++) {
+            const long v = lrint(h[j] / sum * 32768.0);
+            c[kNumTaps - 1 - j] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+        }
+    }
+    delete[] h;
+}
+
+// ----------------------------------------------------------------------------
+
+// Inner product of kNumTaps Q.15 coefficients with kNumTaps samples.
+// The sum of the absolute values of a phase is well below 2.0, so 32 bits cannot overflow.
+static inline int32_t dotProduct(const int16_t* samples, const int16_t* coefs)
+{
+#if defined(__ARM_NEON__)
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    for (uint32_t i = 0; i < AudioResamplerPolyphase::kNumTaps; i += 8) {
+        const int16x8_t s = vld1q_s16(samples + i);
+        const int16x8_t c = vld1q_s16(coefs + i);
+        acc0 = vmlal_s16(acc0, vget_low_s16(s), vget_low_s16(c));
+        acc1 = vmlal_s16(acc1, vget_high_s16(s), vget_high_s16(c));
+    }
+    const int32x4_t acc = vaddq_s32(acc0, acc1);
+    const int32x2_t sum = vpadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (uint32_t i = 0; i < AudioResamplerPolyphase::kNumTaps; i += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(samples + i));
+        const __m128i c = _mm_load_si128((const __m128i*)(coefs + i));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(s, c));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+#else
+    int32_t acc = 0;
+    for (uint32_t i = 0; i < AudioResamplerPolyphase::kNumTaps; i++) {
+        acc += (int32_t)samples[i] * coefs[i];
+    }
+    return acc;
+#endif
+}
+
+// apply a 4.12 volume to a Q.15 inner product, giving the Q19.12 output of resample()
+static inline int32_t applyVolume(int32_t acc, int16_t v)
+{
+    return (int32_t)(((int64_t)acc * v) >> 15);
+}
+
+// ----------------------------------------------------------------------------
+
+status_t AudioResamplerPolyphase::FallbackProvider::getNextBuffer(Buffer* buffer, int64_t pts)
+{
+    status_t status = mProvider->getNextBuffer(buffer, pts);
+    mHeld = *buffer;
+    return status;
+}
+
+void AudioResamplerPolyphase::FallbackProvider::releaseBuffer(Buffer* buffer)
+{
+    mProvider->releaseBuffer(buffer);
+    mHeld.raw = NULL;
+    mHeld.frameCount = 0;
+}
+
+AudioResamplerPolyphase::AudioResamplerPolyphase(int bitDepth, int inChannelCount,
+        int32_t sampleRate)
+    : AudioResampler(bitDepth, inChannelCount, sampleRate, POLYPHASE_QUALITY),
+    mBank(NULL), mFallback(NULL), mFallbackActive(true),
+    mHistory(NULL), mHistoryPos(0), mPhase(0), mPhaseRem(0), mFramesNeeded(1)
+{
+}
+
+AudioResamplerPolyphase::~AudioResamplerPolyphase()
+{
+    releaseBank(mBank);
+    delete mFallback;
+    free(mHistory);
+}
+
+void AudioResamplerPolyphase::init()
+{
+    const size_t historySize = 2 * kNumTaps * mChannelCount;
+    mHistory = (int16_t*)memalign(32, historySize * sizeof(int16_t));
+    memset(mHistory, 0, historySize * sizeof(int16_t));
+    mFallback = AudioResampler::create(mBitDepth, mChannelCount, mSampleRate, MED_QUALITY);
+    pthread_once(&sBankThreadOnce, startBankThread);
+    // the bank is acquired by the first setSampleRate() or resample(), as the input
+    // sample rate is usually not known yet
+}
+
+void AudioResamplerPolyphase::setSampleRate(int32_t inSampleRate)
+{
+    AudioResampler::setSampleRate(inSampleRate);
+    mFallback->setSampleRate(inSampleRate);
+    if (mBank != NULL && mBank->inRate == inSampleRate) {
+        return;
+    }
+    // acquire before releasing, so a bank shared with a track at the new rate is not rebuilt
+    Bank* bank = acquireBank(inSampleRate, mSampleRate);
+    if (bank == NULL) {
+        // the bank list is busy, retried by the next resample()
+        return;
+    }
+    releaseBank(mBank);
+    mBank = bank;
+    mPhase = 0;
+    mPhaseRem = 0;
+}
+
+void AudioResamplerPolyphase::setVolume(int16_t left, int16_t right)
+{
+    AudioResampler::setVolume(left, right);
+    mFallback->setVolume(left, right);
+}
+
+void AudioResamplerPolyphase::setLocalTimeFreq(uint64_t freq)
+{
+    AudioResampler::setLocalTimeFreq(freq);
+    mFallback->setLocalTimeFreq(freq);
+}
+
+void AudioResamplerPolyphase::setPTS(int64_t pts)
+{
+    AudioResampler::setPTS(pts);
+    mFallback->setPTS(pts);
+}
+
+void AudioResamplerPolyphase::reset()
+{
+    AudioResampler::reset();
+    mFallback->reset();
+    mFallbackProvider.mHeld.raw = NULL;
+    mFallbackProvider.mHeld.frameCount = 0;
+    if (mHistory != NULL) {
+        memset(mHistory, 0, 2 * kNumTaps * mChannelCount * sizeof(int16_t));
+    }
+    mHistoryPos = 0;
+    mPhase = 0;
+    mPhaseRem = 0;
+    mFramesNeeded = 1;
+}
+
+void AudioResamplerPolyphase::resample(int32_t* out, size_t outFrameCount,
+        AudioBufferProvider* provider)
+{
+    if (CC_UNLIKELY(!bankReady())) {
+        if (mBank == NULL || mBank->inRate != mInSampleRate) {
+            setSampleRate(mInSampleRate);
+        }
+        if (!bankReady()) {
+            if (!mFallbackActive) {
+                switchToFallback(provider);
+            }
+            mFallbackProvider.mProvider = provider;
+            mFallback->resample(out, outFrameCount, &mFallbackProvider);
+            return;
+        }
+    }
+    if (CC_UNLIKELY(mFallbackActive)) {
+        switchFromFallback(provider);
+    }
+
+    switch (mChannelCount) {
+    case 1:
+        resample<1>(out, outFrameCount, provider);
+        break;
+    case 2:
+        resample<2>(out, outFrameCount, provider);
+        break;
+    }
+}
+
+size_t AudioResamplerPolyphase::getUnreleasedFrames() const
+{
+    return mFallbackActive ? mFallback->getUnreleasedFrames() : mInputIndex;
+}
+
+// The resampler giving up the input releases the frames it consumed from its current buffer,
+// so that the other one continues with a fresh getNextBuffer() at the same input position.
+void AudioResamplerPolyphase::switchToFallback(AudioBufferProvider* provider)
+{
+    if (mBuffer.frameCount != 0) {
+        mBuffer.frameCount = mInputIndex;
+        provider->releaseBuffer(&mBuffer);
+    }
+    AudioResampler::reset();
+    mFallback->reset();
+    mFallbackActive = true;
+}
+
+void AudioResamplerPolyphase::switchFromFallback(AudioBufferProvider* provider)
+{
+    AudioBufferProvider::Buffer& held(mFallbackProvider.mHeld);
+    if (held.frameCount != 0) {
+        held.frameCount = mFallback->getUnreleasedFrames();
+        provider->releaseBuffer(&held);
+        held.raw = NULL;
+        held.frameCount = 0;
+    }
+    mFallback->reset();
+    AudioResampler::reset();
+    mFallbackActive = false;
+}
+
+// The history of each channel is stored twice, at position pos and pos + kNumTaps, so that
+// the last kNumTaps frames are always contiguous at [pos, pos + kNumTaps) after the write.
+template<int CHANNELS>
+void AudioResamplerPolyphase::push(const int16_t* frame)
+{
+    const uint32_t pos = mHistoryPos;
+    for (int i = 0; i < CHANNELS; i++) {
+        int16_t* h = mHistory + i * 2 * kNumTaps;
+        h[pos] = h[pos + kNumTaps] = frame[i];
+    }
+    mHistoryPos = (pos + 1 == kNumTaps) ? 0 : pos + 1;
+}
+
+template<int CHANNELS>
+void AudioResamplerPolyphase::resample(int32_t* out, size_t outFrameCount,
+        AudioBufferProvider* provider)
+{
+    const Bank& bank(*mBank);
+    const int16_t vl = mVolume[0];
+    const int16_t vr = mVolume[1];
+    size_t inputIndex = mInputIndex;
+    size_t outputIndex = 0;
+    size_t inFrameCount = (outFrameCount * mInSampleRate) / mSampleRate;
+    if (inFrameCount == 0) {
+        inFrameCount = 1;
+    }
+
+    while (outputIndex < outFrameCount) {
+        // consume the input frames needed to produce the next output frame
+        while (mFramesNeeded) {
+            if (mBuffer.frameCount == 0) {
+                mBuffer.frameCount = inFrameCount;
+                provider->getNextBuffer(&mBuffer, calculateOutputPTS(outputIndex));
+                if (mBuffer.raw == NULL) {
+                    goto resample_exit;
+                }
+            }
+            push<CHANNELS>(mBuffer.i16 + inputIndex * CHANNELS);
+            mFramesNeeded--;
+            if (++inputIndex >= mBuffer.frameCount) {
+                inputIndex -= mBuffer.frameCount;
+                provider->releaseBuffer(&mBuffer);
+                // mBuffer.frameCount == 0 now so we reload a new buffer
+            }
+        }
+
+        const int16_t* coefs = bank.coefs + mPhase * kNumTaps;
+        const int16_t* h = mHistory + mHistoryPos;
+        const int32_t l = dotProduct(h, coefs);
+        if (CHANNELS == 1) {
+            out[outputIndex * 2] += applyVolume(l, vl);
+            out[outputIndex * 2 + 1] += applyVolume(l, vr);
+        } else {
+            const int32_t r = dotProduct(h + 2 * kNumTaps, coefs);
+            out[outputIndex * 2] += applyVolume(l, vl);
+            out[outputIndex * 2 + 1] += applyVolume(r, vr);
+        }
+        outputIndex++;
+
+        // advance the phase by inRate / outRate input frames
+        uint32_t phase = mPhase + bank.phaseStep;
+        mPhaseRem += bank.phaseStepRem;
+        if (mPhaseRem >= (uint32_t)bank.outRate) {
+            mPhaseRem -= bank.outRate;
+            phase++;
+        }
+        mFramesNeeded += phase / bank.numPhases;
+        mPhase = phase % bank.numPhases;
+    }
+
+resample_exit:
+    mInputIndex = inputIndex;
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
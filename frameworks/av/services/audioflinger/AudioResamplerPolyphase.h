@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_RESAMPLER_POLYPHASE_H
+#define ANDROID_AUDIO_RESAMPLER_POLYPHASE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <cutils/atomic.h>
+#include <cutils/log.h>
+
+#include "AudioResampler.h"
+
+namespace android {
+
+// ----------------------------------------------------------------------------
+
+// Polyphase FIR resampler.
+//
+// For a conversion inRate -> outRate = M/L (reduced), the prototype low-pass filter is split
+// into L phases of kNumTaps coefficients each, and every output frame is a single inner
+// product of kNumTaps input frames with one phase.  The coefficient banks only depend on
+// (inRate, outRate, quality), so they are computed once and shared by all the resamplers
+// doing the same conversion; the per-instance state is just the input history.
+//
+// When L would exceed kMaxPhases, the bank is built with kMaxPhases phases and the nearest
+// lower phase is used; the phase accumulator itself stays exact so there is no drift.
+//
+// The banks are computed on a background thread, never on the mixer thread.  Until the bank
+// for the current conversion is ready, the frames go through a cubic resampler.
+
+class AudioResamplerPolyphase : public AudioResampler {
+public:
+    AudioResamplerPolyphase(int bitDepth, int inChannelCount, int32_t sampleRate);
+    virtual ~AudioResamplerPolyphase();
+
+    virtual void init();
+    virtual void setSampleRate(int32_t inSampleRate);
+    virtual void setVolume(int16_t left, int16_t right);
+    virtual void setLocalTimeFreq(uint64_t freq);
+    virtual void setPTS(int64_t pts);
+    virtual void reset();
+    virtual void resample(int32_t* out, size_t outFrameCount,
+            AudioBufferProvider* provider);
+    virtual size_t getUnreleasedFrames() const;
+
+    // number of taps of each phase, a multiple of 8 for the SIMD inner products
+    static const uint32_t kNumTaps = 32;
+    // upper bound on the number of phases of a coefficient bank
+    static const uint32_t kMaxPhases = 1024;
+
+    // Reference counted coefficient bank, shared across instances.
+    struct Bank {
+        int32_t     inRate;
+        int32_t     outRate;
+        uint32_t    numPhases;
+        uint32_t    phaseStep;      // integer part of the phase advance per output frame
+        uint32_t    phaseStepRem;   // fractional part, in units of 1 / outRate
+        int16_t*    coefs;          // numPhases * kNumTaps, Q15, time-reversed per phase
+        volatile int32_t ready;     // non-zero once the fields above are computed
+        int32_t     refCount;
+        Bank*       next;
+    };
+
+    // Return a bank for this conversion, queueing its computation if it does not exist yet;
+    // the bank may not be ready.  Does not block: returns NULL if the bank list is busy.
+    static Bank* acquireBank(int32_t inRate, int32_t outRate);
+    static void releaseBank(Bank* bank);
+
+private:
+    // Forwards to the mixer's provider, remembering the buffer held by the fallback resampler
+    // so that its unconsumed frames can be handed back when the polyphase resampler takes over.
+    class FallbackProvider : public AudioBufferProvider {
+    public:
+        FallbackProvider() : mProvider(NULL) { }
+        virtual status_t getNextBuffer(Buffer* buffer, int64_t pts = kInvalidPTS);
+        virtual void releaseBuffer(Buffer* buffer);
+
+        AudioBufferProvider* mProvider;
+        Buffer mHeld;               // frameCount == 0 when no buffer is held
+    };
+
+    inline bool bankReady() const {
+        return mBank != NULL && android_atomic_acquire_load(&mBank->ready);
+    }
+
+    // move the input position between the polyphase and the fallback resampler
+    void switchToFallback(AudioBufferProvider* provider);
+    void switchFromFallback(AudioBufferProvider* provider);
+
+    template<int CHANNELS>
+    void resample(int32_t* out, size_t outFrameCount, AudioBufferProvider* provider);
+
+    // append one input frame to the history
+    template<int CHANNELS>
+    inline void push(const int16_t* frame);
+
+    static void computeBank(Bank* bank);
+    static void* bankThreadLoop(void* arg);
+    static void startBankThread();
+
+    Bank*       mBank;
+    AudioResampler* mFallback;      // used until mBank is ready
+    bool        mFallbackActive;
+    FallbackProvider mFallbackProvider;
+    int16_t*    mHistory;           // per channel: 2 * kNumTaps samples, see push()
+    uint32_t    mHistoryPos;        // 0 <= mHistoryPos < kNumTaps
+    uint32_t    mPhase;             // current phase, 0 <= mPhase < mBank->numPhases
+    uint32_t    mPhaseRem;          // 0 <= mPhaseRem < mBank->outRate
+    uint32_t    mFramesNeeded;      // input frames to consume before the next output frame
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
+
+#endif /*ANDROID_AUDIO_RESAMPLER_POLYPHASE_H*/
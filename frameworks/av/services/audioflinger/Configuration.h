@@ -32,6 +32,9 @@
 // uncomment to enable fast mixer to take performance samples for later statistical analysis
 #define FAST_MIXER_STATISTICS
 
+// uncomment to enable fast mixer to log a timing breakdown of each cycle, for binder clients
+#define FAST_MIXER_CYCLE_TIMING
+
 // uncomment to allow fast tracks at non-native sample rate
 //#define FAST_TRACKS_AT_NON_NATIVE_SAMPLE_RATE
 
@@ -25,6 +25,9 @@
 #include <audio_utils/primitives.h>
 #include <private/media/AudioEffectShared.h>
 #include <media/EffectsFactoryApi.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #include "AudioFlinger.h"
 #include "ServiceUtilities.h"
@@ -286,7 +289,14 @@ void AudioFlinger::EffectModule::process()
             size_t frameCnt = mConfig.inputCfg.buffer.frameCount * 2;  //always stereo here
             int16_t *in = mConfig.inputCfg.buffer.s16;
             int16_t *out = mConfig.outputCfg.buffer.s16;
-            for (size_t i = 0; i < frameCnt; i++) {
+            size_t i = 0;
+#ifdef __ARM_NEON__
+            // saturating add is bit exact with clamp16() of the sum
+            for (; i + 8 <= frameCnt; i += 8) {
+                vst1q_s16(out + i, vqaddq_s16(vld1q_s16(out + i), vld1q_s16(in + i)));
+            }
+#endif
+            for (; i < frameCnt; i++) {
                 out[i] = clamp16((int32_t)out[i] + (int32_t)in[i]);
             }
         }
@@ -1314,6 +1324,10 @@ void AudioFlinger::EffectChain::process_l()
         }
     }
 
+    // Each effect processes the whole mix buffer of the thread in one call, in the 16 bit
+    // format of the effect HAL. Gathering several cycles into a larger batch would delay the
+    // output of the thread by as many cycles; threads that can afford that latency, such as
+    // deep buffer ones, already run with a larger frame count.
     size_t size = mEffects.size();
     if (doProcess) {
         for (size_t i = 0; i < size; i++) {
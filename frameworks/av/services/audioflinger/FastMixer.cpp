@@ -27,6 +27,7 @@
 
 #include "Configuration.h"
 #include <sys/atomics.h>
+#include <cutils/atomic-inline.h> // for android_memory_barrier()
 #include <time.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
@@ -49,6 +50,28 @@
 
 namespace android {
 
+#ifdef FAST_MIXER_CYCLE_TIMING
+// Return the current CLOCK_MONOTONIC time in nanoseconds, or 0 if the clock is broken
+static inline int64_t monotonicNs()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0;
+    }
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Return the time between two monotonicNs() values, saturated to 32 bits
+static inline uint32_t elapsedNs(int64_t from, int64_t to)
+{
+    int64_t delta = to - from;
+    if (delta <= 0 || from == 0) {
+        return 0;
+    }
+    return delta < 0xFFFFFFFFLL ? (uint32_t) delta : 0xFFFFFFFF;
+}
+#endif
+
 // Fast mixer thread
 bool FastMixer::threadLoop()
 {
@@ -73,7 +96,9 @@ bool FastMixer::threadLoop()
     enum {UNDEFINED, MIXED, ZEROED} mixBufferState = UNDEFINED;
     NBAIO_Format format = Format_Invalid;
     unsigned sampleRate = 0;
-    int fastTracksGen = 0;
+    const FastTrackTable *fastTrackTable = NULL;
+    unsigned trackMask = 0; // last observed fastTrackTable->mTrackMask
+    int32_t fastTracksGen = 0; // last observed fastTrackTable->mGen
     long periodNs = 0;      // expected period; the time required to render one mix buffer
     long underrunNs = 0;    // underrun likely when write cycle is greater than this value
     long overrunNs = 0;     // overrun likely when write cycle is less than this value
@@ -103,6 +128,11 @@ bool FastMixer::threadLoop()
     uint32_t nativeFramesWrittenButNotPresented = 0;    // the = 0 is to silence the compiler
     status_t timestampStatus = INVALID_OPERATION;
 
+#ifdef FAST_MIXER_CYCLE_TIMING
+    FastMixerCycleTiming timing; // timing breakdown of the current cycle
+    int64_t stageNs;            // start time of the current stage
+#endif
+
     for (;;) {
 
         // either nanosleep, sched_yield, or busy wait
@@ -221,7 +251,13 @@ bool FastMixer::threadLoop()
 
             // handle state change here, but since we want to diff the state,
             // we're prepared for previous == &initial the first time through
-            unsigned previousTrackMask;
+
+            // the fast track table is a one-time configuration
+            if (current->mFastTrackTable != fastTrackTable) {
+                ALOG_ASSERT(fastTrackTable == NULL && trackMask == 0);
+                fastTrackTable = current->mFastTrackTable;
+                fastTracksGen = fastTrackTable != NULL ? fastTrackTable->mGen - 1 : 0;
+            }
 
             // check for change in output HAL configuration
             NBAIO_Format previousFormat = format;
@@ -270,125 +306,134 @@ bool FastMixer::threadLoop()
                 }
 #endif
                 // we need to reconfigure all active tracks
-                previousTrackMask = 0;
-                fastTracksGen = current->mFastTracksGen - 1;
+                trackMask = 0;
+                --fastTracksGen;
                 dumpState->mFrameCount = frameCount;
-            } else {
-                previousTrackMask = previous->mTrackMask;
             }
 
-            // check for change in active track set
-            unsigned currentTrackMask = current->mTrackMask;
+#if 1   // FIXME shouldn't need this
+            // only process state change once
+            previous = current;
+#endif
+        }
+
+        // check for change in active track set; when the table is unchanged this costs a
+        // single load per cycle, regardless of the number of fast tracks
+        int32_t tableGen;
+        if (fastTrackTable != NULL &&
+                (tableGen = android_atomic_acquire_load(&fastTrackTable->mGen)) != fastTracksGen) {
+            unsigned previousTrackMask = trackMask;
+            unsigned currentTrackMask =
+                    (unsigned) android_atomic_acquire_load(&fastTrackTable->mTrackMask);
             dumpState->mTrackMask = currentTrackMask;
-            if (current->mFastTracksGen != fastTracksGen) {
-                ALOG_ASSERT(mixBuffer != NULL);
-                int name;
-
-                // process removed tracks first to avoid running out of track names
-                unsigned removedTracks = previousTrackMask & ~currentTrackMask;
-                while (removedTracks != 0) {
-                    i = __builtin_ctz(removedTracks);
-                    removedTracks &= ~(1 << i);
-                    const FastTrack* fastTrack = &current->mFastTracks[i];
-                    ALOG_ASSERT(fastTrack->mBufferProvider == NULL);
-                    if (mixer != NULL) {
-                        name = fastTrackNames[i];
-                        ALOG_ASSERT(name >= 0);
-                        mixer->deleteTrackName(name);
-                    }
+            ALOG_ASSERT(mixBuffer != NULL);
+            int name;
+
+            // process removed tracks first to avoid running out of track names
+            unsigned removedTracks = previousTrackMask & ~currentTrackMask;
+            while (removedTracks != 0) {
+                i = __builtin_ctz(removedTracks);
+                removedTracks &= ~(1 << i);
+                const FastTrack* fastTrack = &fastTrackTable->mFastTracks[i];
+                if (mixer != NULL) {
+                    name = fastTrackNames[i];
+                    ALOG_ASSERT(name >= 0);
+                    mixer->deleteTrackName(name);
+                }
 #if !LOG_NDEBUG
-                    fastTrackNames[i] = -1;
+                fastTrackNames[i] = -1;
 #endif
-                    // don't reset track dump state, since other side is ignoring it
-                    generations[i] = fastTrack->mGeneration;
+                // don't reset track dump state, since other side is ignoring it
+                generations[i] = fastTrack->mGeneration;
+            }
+
+            // now process added tracks
+            unsigned addedTracks = currentTrackMask & ~previousTrackMask;
+            while (addedTracks != 0) {
+                i = __builtin_ctz(addedTracks);
+                addedTracks &= ~(1 << i);
+                const FastTrack* fastTrack = &fastTrackTable->mFastTracks[i];
+                AudioBufferProvider *bufferProvider = fastTrack->mBufferProvider;
+                ALOG_ASSERT(bufferProvider != NULL && fastTrackNames[i] == -1);
+                if (mixer != NULL) {
+                    // calling getTrackName with default channel mask and a random invalid
+                    //   sessionId (no effects here)
+                    name = mixer->getTrackName(AUDIO_CHANNEL_OUT_STEREO, -555);
+                    ALOG_ASSERT(name >= 0);
+                    fastTrackNames[i] = name;
+                    mixer->setBufferProvider(name, bufferProvider);
+                    mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                            (void *) mixBuffer);
+                    // newly allocated track names default to full scale volume
+                    if (fastTrack->mSampleRate != 0 && fastTrack->mSampleRate != sampleRate) {
+                        mixer->setParameter(name, AudioMixer::RESAMPLE,
+                                AudioMixer::SAMPLE_RATE, (void*) fastTrack->mSampleRate);
+                    }
+                    mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
+                            (void *) fastTrack->mChannelMask);
+                    mixer->enable(name);
                 }
+                generations[i] = fastTrack->mGeneration;
+            }
 
-                // now process added tracks
-                unsigned addedTracks = currentTrackMask & ~previousTrackMask;
-                while (addedTracks != 0) {
-                    i = __builtin_ctz(addedTracks);
-                    addedTracks &= ~(1 << i);
-                    const FastTrack* fastTrack = &current->mFastTracks[i];
+            // finally process (potentially) modified tracks; these use the same slot
+            // but may have a different buffer provider or volume provider
+            unsigned modifiedTracks = currentTrackMask & previousTrackMask;
+            while (modifiedTracks != 0) {
+                i = __builtin_ctz(modifiedTracks);
+                modifiedTracks &= ~(1 << i);
+                const FastTrack* fastTrack = &fastTrackTable->mFastTracks[i];
+                if (fastTrack->mGeneration != generations[i]) {
+                    // this track was actually modified
                     AudioBufferProvider *bufferProvider = fastTrack->mBufferProvider;
-                    ALOG_ASSERT(bufferProvider != NULL && fastTrackNames[i] == -1);
+                    ALOG_ASSERT(bufferProvider != NULL);
                     if (mixer != NULL) {
-                        // calling getTrackName with default channel mask and a random invalid
-                        //   sessionId (no effects here)
-                        name = mixer->getTrackName(AUDIO_CHANNEL_OUT_STEREO, -555);
+                        name = fastTrackNames[i];
                         ALOG_ASSERT(name >= 0);
-                        fastTrackNames[i] = name;
                         mixer->setBufferProvider(name, bufferProvider);
-                        mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
-                                (void *) mixBuffer);
-                        // newly allocated track names default to full scale volume
-                        if (fastTrack->mSampleRate != 0 && fastTrack->mSampleRate != sampleRate) {
+                        if (fastTrack->mVolumeProvider == NULL) {
+                            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0,
+                                    (void *)0x1000);
+                            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1,
+                                    (void *)0x1000);
+                        }
+                        if (fastTrack->mSampleRate != 0 &&
+                                fastTrack->mSampleRate != sampleRate) {
                             mixer->setParameter(name, AudioMixer::RESAMPLE,
                                     AudioMixer::SAMPLE_RATE, (void*) fastTrack->mSampleRate);
+                        } else {
+                            mixer->setParameter(name, AudioMixer::RESAMPLE,
+                                    AudioMixer::REMOVE, NULL);
                         }
                         mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
                                 (void *) fastTrack->mChannelMask);
-                        mixer->enable(name);
+                        // already enabled
                     }
                     generations[i] = fastTrack->mGeneration;
                 }
+            }
 
-                // finally process (potentially) modified tracks; these use the same slot
-                // but may have a different buffer provider or volume provider
-                unsigned modifiedTracks = currentTrackMask & previousTrackMask;
-                while (modifiedTracks != 0) {
-                    i = __builtin_ctz(modifiedTracks);
-                    modifiedTracks &= ~(1 << i);
-                    const FastTrack* fastTrack = &current->mFastTracks[i];
-                    if (fastTrack->mGeneration != generations[i]) {
-                        // this track was actually modified
-                        AudioBufferProvider *bufferProvider = fastTrack->mBufferProvider;
-                        ALOG_ASSERT(bufferProvider != NULL);
-                        if (mixer != NULL) {
-                            name = fastTrackNames[i];
-                            ALOG_ASSERT(name >= 0);
-                            mixer->setBufferProvider(name, bufferProvider);
-                            if (fastTrack->mVolumeProvider == NULL) {
-                                mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0,
-                                        (void *)0x1000);
-                                mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1,
-                                        (void *)0x1000);
-                            }
-                            if (fastTrack->mSampleRate != 0 &&
-                                    fastTrack->mSampleRate != sampleRate) {
-                                mixer->setParameter(name, AudioMixer::RESAMPLE,
-                                        AudioMixer::SAMPLE_RATE, (void*) fastTrack->mSampleRate);
-                            } else {
-                                mixer->setParameter(name, AudioMixer::RESAMPLE,
-                                        AudioMixer::REMOVE, NULL);
-                            }
-                            mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
-                                    (void *) fastTrack->mChannelMask);
-                            // already enabled
-                        }
-                        generations[i] = fastTrack->mGeneration;
-                    }
-                }
-
-                fastTracksGen = current->mFastTracksGen;
+            trackMask = currentTrackMask;
+            fastTracksGen = tableGen;
 
-                dumpState->mNumTracks = popcount(currentTrackMask);
-            }
+            dumpState->mNumTracks = popcount(currentTrackMask);
+        }
 
-#if 1   // FIXME shouldn't need this
-            // only process state change once
-            previous = current;
+#ifdef FAST_MIXER_CYCLE_TIMING
+        memset(&timing, 0, sizeof(timing));
+        timing.mSlowestTrack = -1;
+        stageNs = monotonicNs();
 #endif
-        }
 
         // do work using current state here
         if ((command & FastMixerState::MIX) && (mixer != NULL) && isWarm) {
             ALOG_ASSERT(mixBuffer != NULL);
             // for each track, update volume and check for underrun
-            unsigned currentTrackMask = current->mTrackMask;
+            unsigned currentTrackMask = trackMask;
             while (currentTrackMask != 0) {
                 i = __builtin_ctz(currentTrackMask);
                 currentTrackMask &= ~(1 << i);
-                const FastTrack* fastTrack = &current->mFastTracks[i];
+                const FastTrack* fastTrack = &fastTrackTable->mFastTracks[i];
 
                 // Refresh the per-track timestamp
                 if (timestampStatus == NO_ERROR) {
@@ -456,6 +501,17 @@ bool FastMixer::threadLoop()
                 }
                 ftDump->mUnderruns = underruns;
                 ftDump->mFramesReady = framesReady;
+#ifdef FAST_MIXER_CYCLE_TIMING
+                // attribute the time since the previous track to this one
+                int64_t trackNs = monotonicNs();
+                uint32_t thisTrackNs = elapsedNs(stageNs, trackNs);
+                if (timing.mSlowestTrack < 0 || thisTrackNs > timing.mSlowestTrackNs) {
+                    timing.mSlowestTrack = i;
+                    timing.mSlowestTrackNs = thisTrackNs;
+                }
+                timing.mTracksNs += thisTrackNs;
+                stageNs = trackNs;
+#endif
             }
 
             int64_t pts;
@@ -465,6 +521,9 @@ bool FastMixer::threadLoop()
             // process() is CPU-bound
             mixer->process(pts);
             mixBufferState = MIXED;
+#ifdef FAST_MIXER_CYCLE_TIMING
+            timing.mMixNs = elapsedNs(stageNs, monotonicNs());
+#endif
         } else if (mixBufferState == MIXED) {
             mixBufferState = UNDEFINED;
         }
@@ -481,9 +540,15 @@ bool FastMixer::threadLoop()
             // FIXME write() is non-blocking and lock-free for a properly implemented NBAIO sink,
             //       but this code should be modified to handle both non-blocking and blocking sinks
             dumpState->mWriteSequence++;
+#ifdef FAST_MIXER_CYCLE_TIMING
+            stageNs = monotonicNs();
+#endif
             ATRACE_BEGIN("write");
             ssize_t framesWritten = outputSink->write(mixBuffer, frameCount);
             ATRACE_END();
+#ifdef FAST_MIXER_CYCLE_TIMING
+            timing.mWriteNs = elapsedNs(stageNs, monotonicNs());
+#endif
             dumpState->mWriteSequence++;
             if (framesWritten >= 0) {
                 ALOG_ASSERT((size_t) framesWritten <= frameCount);
@@ -578,6 +643,17 @@ bool FastMixer::threadLoop()
                         ignoreNextOverrun = false;
                     }
                 }
+#ifdef FAST_MIXER_CYCLE_TIMING
+                if (isWarm) {
+                    timing.mCycleNs = sec >= 4 ? 0xFFFFFFFF : (uint32_t) sec * 1000000000U + nsec;
+                    if (sec > 0 || nsec > underrunNs) {
+                        timing.mFlags |= FastMixerCycleTiming::FLAG_UNDERRUN;
+                    } else if (nsec < overrunNs) {
+                        timing.mFlags |= FastMixerCycleTiming::FLAG_OVERRUN;
+                    }
+                    dumpState->mTimingLog.log(timing);
+                }
+#endif
 #ifdef FAST_MIXER_STATISTICS
                 if (isWarm) {
                     // advance the FIFO queue bounds
@@ -697,6 +773,42 @@ FastMixerDumpState::~FastMixerDumpState()
 {
 }
 
+#ifdef FAST_MIXER_CYCLE_TIMING
+void FastMixerTimingLog::log(FastMixerCycleTiming& timing)
+{
+    uint32_t rear = mRear;
+    timing.mSequence = rear;
+    mEntries[rear & (kN - 1)] = timing;
+    android_atomic_release_store((int32_t) (rear + 1), &mRear);
+}
+
+void FastMixerTimingLog::read(uint32_t *cursor, Vector<FastMixerCycleTiming> *timings) const
+{
+    uint32_t rear = (uint32_t) android_atomic_acquire_load(&mRear);
+    uint32_t front = *cursor;
+    if (rear - front > kN) {
+        // the reader is too far behind, or the cursor is bogus
+        front = rear - kN;
+    }
+    size_t base = timings->size();
+    for (uint32_t i = front; i != rear; ++i) {
+        timings->add(mEntries[i & (kN - 1)]);
+    }
+    // Discard the entries that the writer may have overwritten while we were copying them,
+    // including the one it may be writing right now at index newRear.
+    android_memory_barrier();
+    uint32_t newRear = (uint32_t) android_atomic_acquire_load(&mRear);
+    if (newRear - front >= kN) {
+        size_t overwritten = newRear - front - kN + 1;
+        if (overwritten > rear - front) {
+            overwritten = rear - front;
+        }
+        timings->removeItemsAt(base, overwritten);
+    }
+    *cursor = rear;
+}
+#endif
+
 // helper function called by qsort()
 static int compare_uint32_t(const void *pa, const void *pb)
 {
@@ -19,6 +19,8 @@
 
 #include <utils/Debug.h>
 #include <utils/Thread.h>
+#include <utils/Vector.h>
+#include <media/IAudioFlinger.h>
 extern "C" {
 #include "../private/bionic_futex.h"
 }
@@ -78,6 +80,28 @@ struct FastTrackDump {
     size_t mFramesReady;        // most recent value only; no long-term statistics kept
 };
 
+#ifdef FAST_MIXER_CYCLE_TIMING
+// Ring of the most recent cycle timings.  Like NBLog, it has a single writer (the fast mixer)
+// which never blocks and never waits for readers, and any number of readers which each keep
+// their own cursor.  A reader which falls more than kN entries behind loses the oldest ones.
+struct FastMixerTimingLog {
+    FastMixerTimingLog() : mRear(0) { }
+    /*virtual*/ ~FastMixerTimingLog() { }
+
+    static const uint32_t kN = 512;     // must be a power of 2
+
+    // Called by the fast mixer only; assigns timing.mSequence
+    void    log(FastMixerCycleTiming& timing);
+
+    // Append to timings the entries from *cursor up to the newest one, and update *cursor.
+    void    read(uint32_t *cursor, Vector<FastMixerCycleTiming> *timings) const;
+
+private:
+    FastMixerCycleTiming mEntries[kN];
+    volatile int32_t     mRear;         // total number of entries logged, modulo 2^32
+};
+#endif
+
 // The FastMixerDumpState keeps a cache of FastMixer statistics that can be logged by dumpsys.
 // Each individual native word-sized field is accessed atomically.  But the
 // overall structure is non-atomic, that is there may be an inconsistency between fields.
@@ -107,6 +131,9 @@ struct FastMixerDumpState {
     uint32_t mWarmupCycles;     // number of loop cycles required to warmup
     uint32_t mTrackMask;        // mask of active tracks
     FastTrackDump   mTracks[FastMixerState::kMaxFastTracks];
+#ifdef FAST_MIXER_CYCLE_TIMING
+    FastMixerTimingLog mTimingLog; // accessed atomically, so it may be read from the original
+#endif
 
 #ifdef FAST_MIXER_STATISTICS
     // Recently collected samples of per-cycle monotonic time, thread CPU time, and CPU frequency.
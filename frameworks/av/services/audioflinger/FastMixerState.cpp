@@ -15,6 +15,7 @@
  */
 
 #include "Configuration.h"
+#include <cutils/atomic.h>
 #include "FastMixerState.h"
 
 namespace android {
@@ -30,7 +31,7 @@ FastTrack::~FastTrack()
 }
 
 FastMixerState::FastMixerState() :
-    mFastTracksGen(0), mTrackMask(0), mOutputSink(NULL), mOutputSinkGen(0),
+    mFastTrackTable(NULL), mOutputSink(NULL), mOutputSinkGen(0),
     mFrameCount(0), mCommand(INITIAL), mColdFutexAddr(NULL), mColdGen(0),
     mDumpState(NULL), mTeeSink(NULL), mNBLogWriter(NULL)
 {
@@ -40,4 +41,19 @@ FastMixerState::~FastMixerState()
 {
 }
 
+FastTrackTable::FastTrackTable() :
+    mTrackMask(0), mGen(0)
+{
+}
+
+FastTrackTable::~FastTrackTable()
+{
+}
+
+void FastTrackTable::publish(unsigned trackMask)
+{
+    android_atomic_release_store((int32_t) trackMask, &mTrackMask);
+    android_atomic_release_store(mGen + 1, &mGen);
+}
+
 }   // namespace android
@@ -41,24 +41,25 @@ struct FastTrack {
     FastTrack();
     /*virtual*/ ~FastTrack();
 
-    ExtendedAudioBufferProvider* mBufferProvider; // must be NULL if inactive, or non-NULL if active
+    ExtendedAudioBufferProvider* mBufferProvider; // must be non-NULL if active
     VolumeProvider*         mVolumeProvider; // optional; if NULL then full-scale
     unsigned                mSampleRate;     // optional; if zero then use mixer sample rate
     audio_channel_mask_t    mChannelMask;    // AUDIO_CHANNEL_OUT_MONO or AUDIO_CHANNEL_OUT_STEREO
     int                     mGeneration;     // increment when any field is assigned
 };
 
+struct FastTrackTable;
+
 // Represents a single state of the fast mixer
 struct FastMixerState {
                 FastMixerState();
     /*virtual*/ ~FastMixerState();
 
-    static const unsigned kMaxFastTracks = 8;   // must be between 2 and 32 inclusive
+    static const unsigned kMaxFastTracks = 32;  // must be between 2 and 32 inclusive
 
     // all pointer fields use raw pointers; objects are owned and ref-counted by the normal mixer
-    FastTrack   mFastTracks[kMaxFastTracks];
-    int         mFastTracksGen; // increment when any mFastTracks[i].mGeneration is incremented
-    unsigned    mTrackMask;     // bit i is set if and only if mFastTracks[i] is active
+    FastTrackTable* mFastTrackTable; // one-time configuration; the fast tracks are not part of
+                                // the state, so that changing them does not require a push
     NBAIO_Sink* mOutputSink;    // HAL output device, must already be negotiated
     int         mOutputSinkGen; // increment when mOutputSink is assigned
     size_t      mFrameCount;    // number of frames per fast mix buffer
@@ -81,6 +82,32 @@ struct FastMixerState {
     NBLog::Writer* mNBLogWriter; // non-blocking logger
 };  // struct FastMixerState
 
+// The set of fast tracks, shared by the normal mixer (the only writer) and the fast mixer.
+// It lives outside of the state queue so that a track can be added or modified by updating
+// just its own slot, and the fast mixer only pays for a single load per cycle to detect that
+// nothing changed.  The protocol is:
+//  - the normal mixer assigns the fields of a slot only while its bit is clear in mTrackMask,
+//    or while the fast mixer has not yet been told about the slot, then increments mGeneration;
+//  - then it publishes the new mTrackMask and increments mGen, both with release semantics;
+//  - the fast mixer reads mGen with acquire semantics, and only if it changed reads mTrackMask
+//    and the mGeneration of each active slot.
+// Removing a track clears its bit, but the slot (and the provider it points to) must remain
+// valid until the fast mixer has acknowledged a subsequent state queue push, because the
+// fast mixer only observes mGen once per cycle, right after polling the state queue.
+struct FastTrackTable {
+                FastTrackTable();
+    /*virtual*/ ~FastTrackTable();
+
+    // Called by the normal mixer only
+    unsigned    trackMask() const { return (unsigned) mTrackMask; }
+    void        publish(unsigned trackMask);    // set mTrackMask and increment mGen
+
+    // all pointer fields use raw pointers; objects are owned and ref-counted by the normal mixer
+    FastTrack   mFastTracks[FastMixerState::kMaxFastTracks];
+    volatile int32_t mTrackMask; // bit i is set if and only if mFastTracks[i] is active
+    volatile int32_t mGen;       // increment when mTrackMask or any mGeneration is changed
+};  // struct FastTrackTable
+
 }   // namespace android
 
 #endif  // ANDROID_AUDIO_FAST_MIXER_STATE_H
@@ -140,7 +140,7 @@ private:
     IAudioFlinger::track_flags_t mFlags;
 
     // The following fields are only for fast tracks, and should be in a subclass
-    int                 mFastIndex; // index within FastMixerState::mFastTracks[];
+    int                 mFastIndex; // index within FastTrackTable::mFastTracks[];
                                     // either mFastIndex == -1 if not isFastTrack()
                                     // or 0 < mFastIndex < FastMixerState::kMaxFast because
                                     // index 0 is reserved for normal mixer's submix;
@@ -112,6 +112,10 @@ static const uint32_t kMaxNormalMixBufferSizeMs = 24;
 // Offloaded output thread standby delay: allows track transition without going to standby
 static const nsecs_t kOffloadStandbyDelayNs = seconds(1);
 
+// Maximum idle wait of a batch leader: followers wake it up without holding its lock,
+// so a wakeup can be missed, see MixerThread::wakeBatchLeader()
+static const nsecs_t kBatchLeaderIdleWaitNs = milliseconds(50);
+
 // Whether to use fast mixer
 static const enum {
     FastMixer_Never,    // never initialize or use: for debugging only
@@ -1017,13 +1021,16 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
         mDrainSequence(0),
         mSignalPending(false),
         mScreenState(AudioFlinger::mScreenState),
+        mAdaptivePipe(false),
         // index 0 is reserved for normal mixer's submix
-        mFastTrackAvailMask(((1 << FastMixerState::kMaxFastTracks) - 1) & ~1),
+        mFastTrackAvailMask((~0U >> (32 - FastMixerState::kMaxFastTracks)) & ~1),
         // mLatchD, mLatchQ,
         mLatchDValid(false), mLatchQValid(false)
 {
     snprintf(mName, kNameLength, "AudioOut_%X", id);
     mNBLogWriter = audioFlinger->newWriter_l(kLogSize, mName);
+    char value[PROPERTY_VALUE_MAX];
+    mAdaptivePipe = (property_get("af.pipe.adaptive", value, "0") > 0) && (atoi(value) == 1);
 
     // Assumes constructor is called by AudioFlinger with it's mLock held, but
     // it would be safer to explicitly pass initial masterVolume/masterMute as
@@ -1149,6 +1156,17 @@ void AudioFlinger::PlaybackThread::dumpInternals(int fd, const Vector<String16>&
     dumpBase(fd, args);
 }
 
+void AudioFlinger::PlaybackThread::setPipeSetpoint(MonoPipe *pipe)
+{
+    size_t setpoint = (mScreenState & 1) ? (pipe->maxFrames() * 7) / 8 : mNormalFrameCount * 2;
+    if (mAdaptivePipe) {
+        // the usual setpoint is the ceiling, and the pipe may go down to one normal mix buffer
+        pipe->setAdaptiveSetpoint(mNormalFrameCount, setpoint);
+    } else {
+        pipe->setAvgFrames(setpoint);
+    }
+}
+
 // Thread virtuals
 status_t AudioFlinger::PlaybackThread::readyToRun()
 {
@@ -1893,8 +1911,7 @@ ssize_t AudioFlinger::PlaybackThread::threadLoop_write()
             mScreenState = screenState;
             MonoPipe *pipe = (MonoPipe *)mPipeSink.get();
             if (pipe != NULL) {
-                pipe->setAvgFrames((mScreenState & 1) ?
-                        (pipe->maxFrames() * 7) / 8 : mNormalFrameCount * 2);
+                setPipeSetpoint(pipe);
             }
         }
         ssize_t framesWritten = mNormalSink->write(mMixBuffer + offset, count);
@@ -2205,6 +2222,20 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                 mLatchQValid = true;
             }
 
+            if (isBatchFollower_l()) {
+                // The batch leader mixes and writes for this thread, including parameter
+                // changes, see MixerThread::batchCycle(); just relay the wakeups to it.
+                if (exitPending()) {
+                    break;
+                }
+                mSignalPending = false;
+                wakeBatchLeader();
+                releaseWakeLock_l();
+                mWaitWorkCV.wait(mLock);
+                acquireWakeLock_l();
+                continue;
+            }
+
             if (checkForNewParameters_l()) {
                 cacheParameters_l();
             }
@@ -2229,7 +2260,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
                 continue;
             }
-            if ((!mActiveTracks.size() && systemTime() > standbyTime) ||
+            if ((!mActiveTracks.size() && !batchPending_l() && systemTime() > standbyTime) ||
                                    isSuspended()) {
                 // put audio hardware into standby after short delay
                 if (shouldStandby_l()) {
@@ -2239,7 +2270,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                     mStandby = true;
                 }
 
-                if (!mActiveTracks.size() && mConfigEvents.isEmpty()) {
+                if (!mActiveTracks.size() && !batchPending_l() && mConfigEvents.isEmpty()) {
                     // we're about to wait, flush the binder command buffer
                     IPCThreadState::self()->flushCommands();
 
@@ -2254,7 +2285,11 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                     mActiveTracksGeneration++;
                     // wait until we have something to do...
                     ALOGV("%s going to sleep", myName.string());
-                    mWaitWorkCV.wait(mLock);
+                    if (hasBatchFollowers()) {
+                        mWaitWorkCV.waitRelative(mLock, kBatchLeaderIdleWaitNs);
+                    } else {
+                        mWaitWorkCV.wait(mLock);
+                    }
                     ALOGV("%s waking up", myName.string());
                     acquireWakeLock_l();
 
@@ -2366,6 +2401,10 @@ if (mType == MIXER) {
             }
         }
 
+        // mix and write the outputs batched with this one, after our own write so that
+        // all the sinks are fed within the same wakeup
+        threadLoop_batch();
+
         // Finally let go of removed track(s), without the lock held
         // since we can't guarantee the destructors won't acquire that
         // same lock.  This will also mutate and push a new fast mixer state.
@@ -2451,7 +2490,9 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
     :   PlaybackThread(audioFlinger, output, id, device, type),
         // mAudioMixer below
         // mFastMixer below
-        mFastMixerFutex(0)
+        mMixBufferFloat(NULL), mFloatMixActive(false),
+        mFastMixerFutex(0),
+        mBatchWakeups(0), mBatchWakeupsSeen(0), mBatchFollowersActive(false)
         // mOutputSink below
         // mPipeSink below
         // mNormalSink below
@@ -2462,6 +2503,7 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
             mSampleRate, mChannelMask, mChannelCount, mFormat, mFrameSize, mFrameCount,
             mNormalFrameCount);
     mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
+    allocMixBufferFloat();
 
     // FIXME - Current mixer implementation only supports stereo output
     if (mChannelCount != FCC_2) {
@@ -2501,8 +2543,7 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
         size_t numCounterOffers = 0;
         ssize_t index = monoPipe->negotiate(offers, 1, NULL, numCounterOffers);
         ALOG_ASSERT(index == 0);
-        monoPipe->setAvgFrames((mScreenState & 1) ?
-                (monoPipe->maxFrames() * 7) / 8 : mNormalFrameCount * 2);
+        setPipeSetpoint(monoPipe);
         mPipeSink = monoPipe;
 
 #ifdef TEE_SINK
@@ -2529,13 +2570,13 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
         sq->setMutatorDump(&mStateQueueMutatorDump);
 #endif
         FastMixerState *state = sq->begin();
-        FastTrack *fastTrack = &state->mFastTracks[0];
+        FastTrack *fastTrack = &mFastTrackTable.mFastTracks[0];
         // wrap the source side of the MonoPipe to make it an AudioBufferProvider
         fastTrack->mBufferProvider = new SourceAudioBufferProvider(new MonoPipeReader(monoPipe));
         fastTrack->mVolumeProvider = NULL;
         fastTrack->mGeneration++;
-        state->mFastTracksGen++;
-        state->mTrackMask = 1;
+        mFastTrackTable.publish(1);
+        state->mFastTrackTable = &mFastTrackTable;
         // fast mixer will use the HAL output sink
         state->mOutputSink = mOutputSink.get();
         state->mOutputSinkGen++;
@@ -2609,15 +2650,12 @@ AudioFlinger::MixerThread::~MixerThread()
         sq->end();
         sq->push(FastMixerStateQueue::BLOCK_UNTIL_PUSHED);
         mFastMixer->join();
-        // Though the fast mixer thread has exited, it's state queue is still valid.
-        // We'll use that extract the final state which contains one remaining fast track
-        // corresponding to our sub-mix.
-        state = sq->begin();
-        ALOG_ASSERT(state->mTrackMask == 1);
-        FastTrack *fastTrack = &state->mFastTracks[0];
+        // The fast mixer thread has exited, so it no longer references the fast track table.
+        // The fast track table contains one remaining fast track corresponding to our sub-mix.
+        ALOG_ASSERT(mFastTrackTable.trackMask() == 1);
+        FastTrack *fastTrack = &mFastTrackTable.mFastTracks[0];
         ALOG_ASSERT(fastTrack->mBufferProvider != NULL);
         delete fastTrack->mBufferProvider;
-        sq->end(false /*didModify*/);
         delete mFastMixer;
 #ifdef AUDIO_WATCHDOG
         if (mAudioWatchdog != 0) {
@@ -2629,8 +2667,33 @@ AudioFlinger::MixerThread::~MixerThread()
     }
     mAudioFlinger->unregisterWriter(mFastMixerNBLogWriter);
     delete mAudioMixer;
+    delete[] mMixBufferFloat;
 }
 
+void AudioFlinger::MixerThread::allocMixBufferFloat()
+{
+    delete[] mMixBufferFloat;
+    mMixBufferFloat = NULL;
+    mFloatMixActive = false;
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("af.mixer.float", value, "0") > 0 && atoi(value) == 1) {
+        mMixBufferFloat = new float[mNormalFrameCount * FCC_2];
+        memset(mMixBufferFloat, 0, mNormalFrameCount * FCC_2 * sizeof(float));
+    }
+}
+
+
+status_t AudioFlinger::MixerThread::getFastMixerTimings(uint32_t *cursor,
+        Vector<FastMixerCycleTiming> *timings) const
+{
+#ifdef FAST_MIXER_CYCLE_TIMING
+    if (mFastMixer != NULL) {
+        mFastMixerDumpState.mTimingLog.read(cursor, timings);
+        return NO_ERROR;
+    }
+#endif
+    return INVALID_OPERATION;
+}
 
 uint32_t AudioFlinger::MixerThread::correctLatency_l(uint32_t latency) const
 {
@@ -2655,7 +2718,7 @@ ssize_t AudioFlinger::MixerThread::threadLoop_write()
         FastMixerStateQueue *sq = mFastMixer->sq();
         FastMixerState *state = sq->begin();
         if (state->mCommand != FastMixerState::MIX_WRITE &&
-                (kUseFastMixer != FastMixer_Dynamic || state->mTrackMask > 1)) {
+                (kUseFastMixer != FastMixer_Dynamic || mFastTrackTable.trackMask() > 1)) {
             if (state->mCommand == FastMixerState::COLD_IDLE) {
                 int32_t old = android_atomic_inc(&mFastMixerFutex);
                 if (old == -1) {
@@ -2766,6 +2829,10 @@ void AudioFlinger::MixerThread::threadLoop_mix()
 
     // mix buffers...
     mAudioMixer->process(pts);
+    if (mFloatMixActive) {
+        // the one conversion to 16-bit, effect chains then accumulate into mMixBuffer
+        AudioMixer::convertFloatToInt16(mMixBuffer, mMixBufferFloat, mNormalFrameCount * FCC_2);
+    }
     mCurrentWriteLength = mixBufferSize;
     // increase sleep time progressively when application underrun condition clears.
     // Only increase sleep time if the mixer is ready for two consecutive times to avoid
@@ -2818,6 +2885,7 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
     size_t count = mActiveTracks.size();
     size_t mixedTracks = 0;
     size_t tracksWithEffect = 0;
+    size_t floatTracks = 0;
     // counts only _active_ fast tracks
     size_t fastTracks = 0;
     uint32_t resetMask = 0; // bit mask of fast tracks that need to be reset
@@ -2846,6 +2914,8 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         sq = mFastMixer->sq();
         state = sq->begin();
     }
+    // the fast track set is published separately from the state, see FastTrackTable
+    unsigned fastTrackMask = mFastTrackTable.trackMask();
 
     for (size_t i=0 ; i<count ; i++) {
         const sp<Track> t = mActiveTracks[i].promote();
@@ -2868,7 +2938,7 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
             int j = track->mFastIndex;
             ALOG_ASSERT(0 < j && j < (int)FastMixerState::kMaxFastTracks);
             ALOG_ASSERT(!(mFastTrackAvailMask & (1 << j)));
-            FastTrack *fastTrack = &state->mFastTracks[j];
+            FastTrack *fastTrack = &mFastTrackTable.mFastTracks[j];
 
             // Determine whether the track is currently in underrun condition,
             // and whether it had a recent underrun.
@@ -2970,7 +3040,7 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
 
             if (isActive) {
                 // was it previously inactive?
-                if (!(state->mTrackMask & (1 << j))) {
+                if (!(fastTrackMask & (1 << j))) {
                     ExtendedAudioBufferProvider *eabp = track;
                     VolumeProvider *vp = track;
                     fastTrack->mBufferProvider = eabp;
@@ -2978,9 +3048,8 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
                     fastTrack->mSampleRate = track->mSampleRate;
                     fastTrack->mChannelMask = track->mChannelMask;
                     fastTrack->mGeneration++;
-                    state->mTrackMask |= 1 << j;
-                    didModify = true;
-                    // no acknowledgement required for newly active tracks
+                    fastTrackMask |= 1 << j;
+                    // no push and no acknowledgement required for newly active tracks
                 }
                 // cache the combined master volume and stream type volume for fast mixer; this
                 // lacks any synchronization or barrier so VolumeProvider may read a stale value
@@ -2988,13 +3057,14 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
                 ++fastTracks;
             } else {
                 // was it previously active?
-                if (state->mTrackMask & (1 << j)) {
-                    fastTrack->mBufferProvider = NULL;
-                    fastTrack->mGeneration++;
-                    state->mTrackMask &= ~(1 << j);
-                    didModify = true;
+                if (fastTrackMask & (1 << j)) {
+                    // The slot is left as is, as the fast mixer may still be using it.
+                    fastTrackMask &= ~(1 << j);
                     // If any fast tracks were removed, we must wait for acknowledgement
                     // because we're about to decrement the last sp<> on those tracks.
+                    // The fast mixer checks the fast track table right after each poll of
+                    // the state queue, so a push is needed even if the state is unchanged.
+                    didModify = true;
                     block = FastMixerStateQueue::BLOCK_UNTIL_ACKED;
                 } else {
                     LOG_FATAL("fast track %d should have been active", j);
@@ -3176,10 +3246,26 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
                 AudioMixer::RESAMPLE,
                 AudioMixer::SAMPLE_RATE,
                 (void *)reqSampleRate);
-            mAudioMixer->setParameter(
-                name,
-                AudioMixer::TRACK,
-                AudioMixer::MAIN_BUFFER, (void *)track->mainBuffer());
+            if (mMixBufferFloat != NULL && track->mainBuffer() == mMixBuffer) {
+                mAudioMixer->setParameter(
+                    name,
+                    AudioMixer::TRACK,
+                    AudioMixer::MAIN_BUFFER, (void *)mMixBufferFloat);
+                mAudioMixer->setParameter(
+                    name,
+                    AudioMixer::TRACK,
+                    AudioMixer::MAIN_BUFFER_FORMAT, (void *)AudioMixer::MIX_FORMAT_FLOAT);
+                floatTracks++;
+            } else {
+                mAudioMixer->setParameter(
+                    name,
+                    AudioMixer::TRACK,
+                    AudioMixer::MAIN_BUFFER, (void *)track->mainBuffer());
+                mAudioMixer->setParameter(
+                    name,
+                    AudioMixer::TRACK,
+                    AudioMixer::MAIN_BUFFER_FORMAT, (void *)AudioMixer::MIX_FORMAT_INT16);
+            }
             mAudioMixer->setParameter(
                 name,
                 AudioMixer::TRACK,
@@ -3246,13 +3332,13 @@ track_is_ready: ;
 
     }
 
-    // Push the new FastMixer state if necessary
+    // Publish the new fast track set, and push the new FastMixer state if necessary
     bool pauseAudioWatchdog = false;
-    if (didModify) {
-        state->mFastTracksGen++;
+    if (fastTrackMask != mFastTrackTable.trackMask()) {
+        mFastTrackTable.publish(fastTrackMask);
         // if the fast mixer was active, but now there are no fast tracks, then put it in cold idle
         if (kUseFastMixer == FastMixer_Dynamic &&
-                state->mCommand == FastMixerState::MIX_WRITE && state->mTrackMask <= 1) {
+                state->mCommand == FastMixerState::MIX_WRITE && fastTrackMask <= 1) {
             state->mCommand = FastMixerState::COLD_IDLE;
             state->mColdFutexAddr = &mFastMixerFutex;
             state->mColdGen++;
@@ -3263,6 +3349,7 @@ track_is_ready: ;
             // If we go into cold idle, need to wait for acknowledgement
             // so that fast mixer stops doing I/O.
             block = FastMixerStateQueue::BLOCK_UNTIL_ACKED;
+            didModify = true;
             pauseAudioWatchdog = true;
         }
     }
@@ -3293,6 +3380,8 @@ track_is_ready: ;
     // remove all the tracks that need to be...
     removeTracks_l(*tracksToRemove);
 
+    mFloatMixActive = floatTracks > 0;
+
     // mix buffer must be cleared if all tracks are connected to an
     // effect chain as in this case the mixer will not write to
     // mix buffer and track effects will accumulate into it
@@ -3425,6 +3514,7 @@ bool AudioFlinger::MixerThread::checkForNewParameters_l()
                 readOutputParameters();
                 delete mAudioMixer;
                 mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
+                allocMixBufferFloat();
                 for (size_t i = 0; i < mTracks.size() ; i++) {
                     int name = getTrackName_l(mTracks[i]->mChannelMask, mTracks[i]->mSessionId);
                     if (name < 0) {
@@ -3469,6 +3559,18 @@ void AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>& ar
 
     snprintf(buffer, SIZE, "AudioMixer tracks: %08x\n", mAudioMixer->trackNames());
     result.append(buffer);
+    snprintf(buffer, SIZE, "Float mix buffer: %p\n", mMixBufferFloat);
+    result.append(buffer);
+    MonoPipe *pipe = (MonoPipe *)mPipeSink.get();
+    if (pipe != NULL && pipe->isAdaptive()) {
+        // not guaranteed to be consistent, the normal mixer updates these without lock
+        const MonoPipe::AdaptiveStats stats = pipe->adaptiveStats();
+        snprintf(buffer, SIZE, "Adaptive pipe: setpoint=%u (%u ms) minFill=%u maxJitter=%u us "
+                "underruns=%u raises=%u lowers=%u\n",
+                stats.mSetpoint, (stats.mSetpoint * 1000) / mSampleRate, stats.mMinFill,
+                stats.mMaxJitterUs, stats.mUnderruns, stats.mRaises, stats.mLowers);
+        result.append(buffer);
+    }
     write(fd, result.string(), result.size());
 
     // Make a non-atomic copy of fast mixer dump state so it won't change underneath us
@@ -3518,6 +3620,176 @@ void AudioFlinger::MixerThread::cacheParameters_l()
     maxPeriod = seconds(mNormalFrameCount) / mSampleRate * 15;
 }
 
+// Batched mixing.
+//
+// Lock order: follower mBatchCycleLock, then follower mLock, then leader mLock, then
+// leader mBatchLock. The leader never holds its own mLock while calling into a follower.
+
+bool AudioFlinger::MixerThread::addBatchFollower(const sp<MixerThread>& follower)
+{
+    if (follower == this || mType != MIXER || follower->mType != MIXER ||
+            follower->hasFastMixer() || follower->mSampleRate != mSampleRate ||
+            follower->mNormalFrameCount != mNormalFrameCount) {
+        return false;
+    }
+    {
+        Mutex::Autolock _l(follower->mLock);
+        follower->mBatchLeader = this;
+        // the follower's own threadLoop() relays its wakeups from now on
+        follower->broadcast_l();
+    }
+    Mutex::Autolock _b(mBatchLock);
+    mBatchFollowers.add(follower);
+    ALOGV("output thread %p now mixed with batch leader %p", follower.get(), this);
+    return true;
+}
+
+void AudioFlinger::MixerThread::detachBatch()
+{
+    Vector< sp<MixerThread> > followers;
+    sp<MixerThread> leader;
+    {
+        Mutex::Autolock _l(mLock);
+        leader = mBatchLeader.promote();
+    }
+    if (leader != 0) {
+        Mutex::Autolock _b(leader->mBatchLock);
+        for (size_t i = 0; i < leader->mBatchFollowers.size(); i++) {
+            if (leader->mBatchFollowers[i] == this) {
+                leader->mBatchFollowers.removeAt(i);
+                break;
+            }
+        }
+        followers.add(this);
+    } else {
+        Mutex::Autolock _b(mBatchLock);
+        followers = mBatchFollowers;
+        mBatchFollowers.clear();
+    }
+    for (size_t i = 0; i < followers.size(); i++) {
+        const sp<MixerThread>& follower = followers[i];
+        // wait for a batchCycle() in progress on the leader's thread
+        Mutex::Autolock _c(follower->mBatchCycleLock);
+        Mutex::Autolock _l(follower->mLock);
+        follower->mBatchLeader.clear();
+        follower->broadcast_l();
+    }
+}
+
+bool AudioFlinger::MixerThread::hasBatchFollowers() const
+{
+    Mutex::Autolock _b(mBatchLock);
+    return !mBatchFollowers.isEmpty();
+}
+
+bool AudioFlinger::MixerThread::batchPending_l() const
+{
+    return mBatchFollowersActive ||
+            android_atomic_acquire_load(&mBatchWakeups) != mBatchWakeupsSeen;
+}
+
+void AudioFlinger::MixerThread::wakeBatchLeader()
+{
+    sp<MixerThread> leader = mBatchLeader.promote();
+    if (leader != 0) {
+        // Must not take the leader's mLock here, as our own mLock may be held.
+        // The leader rechecks mBatchWakeups at least every kBatchLeaderIdleWaitNs.
+        android_atomic_inc(&leader->mBatchWakeups);
+        leader->mWaitWorkCV.broadcast();
+    }
+}
+
+void AudioFlinger::MixerThread::broadcast_l()
+{
+    PlaybackThread::broadcast_l();
+    if (isBatchFollower_l()) {
+        wakeBatchLeader();
+    }
+}
+
+void AudioFlinger::MixerThread::threadLoop_batch()
+{
+    Vector< sp<MixerThread> > followers;
+    {
+        Mutex::Autolock _b(mBatchLock);
+        if (mBatchFollowers.isEmpty()) {
+            mBatchFollowersActive = false;
+            return;
+        }
+        followers = mBatchFollowers;
+    }
+    // read before the cycles: a wakeup racing with a follower going idle stays pending
+    const int32_t wakeups = android_atomic_acquire_load(&mBatchWakeups);
+    bool active = false;
+    for (size_t i = 0; i < followers.size(); i++) {
+        if (followers[i]->batchCycle()) {
+            active = true;
+        }
+    }
+    mBatchFollowersActive = active;
+    mBatchWakeupsSeen = wakeups;
+}
+
+bool AudioFlinger::MixerThread::batchCycle()
+{
+    Mutex::Autolock _c(mBatchCycleLock);
+    Vector< sp<Track> > tracksToRemove;
+    Vector< sp<EffectChain> > effectChains;
+
+    { // scope for mLock
+        Mutex::Autolock _l(mLock);
+        if (!isBatchFollower_l()) {
+            return false;
+        }
+        if (checkForNewParameters_l()) {
+            cacheParameters_l();
+        }
+        if (!mActiveTracks.size()) {
+            if (!mStandby && systemTime() > standbyTime && shouldStandby_l()) {
+                threadLoop_standby();
+                mStandby = true;
+            }
+            return !mStandby;
+        }
+        mMixerStatus = prepareTracks_l(&tracksToRemove);
+        lockEffectChains_l(effectChains);
+    }
+
+    mCurrentWriteLength = 0;
+    if (mMixerStatus == MIXER_TRACKS_READY) {
+        // threadLoop_mix() sets mCurrentWriteLength and standbyTime
+        threadLoop_mix();
+    } else {
+        // Unlike threadLoop_sleepTime(), always write silence: the write is what paces
+        // the leader when it is idle itself.
+        memset(mMixBuffer, 0, mixBufferSize);
+        mCurrentWriteLength = mixBufferSize;
+    }
+    for (size_t i = 0; i < effectChains.size(); i ++) {
+        effectChains[i]->process_l();
+    }
+    unlockEffectChains(effectChains);
+
+    if (isSuspended()) {
+        // simulate write to HAL when suspended
+        mBytesWritten += mixBufferSize;
+    } else {
+        mBytesRemaining = mCurrentWriteLength;
+        while (mBytesRemaining) {
+            ssize_t ret = threadLoop_write();
+            if (ret <= 0) {
+                break;
+            }
+            mBytesWritten += ret;
+            mBytesRemaining -= ret;
+        }
+    }
+    mBytesRemaining = 0;
+
+    threadLoop_removeTracks(tracksToRemove);
+    return true;
+}
+
 // ----------------------------------------------------------------------------
 
 AudioFlinger::DirectOutputThread::DirectOutputThread(const sp<AudioFlinger>& audioFlinger,
@@ -4389,6 +4661,9 @@ AudioFlinger::RecordThread::RecordThread(const sp<AudioFlinger>& audioFlinger,
 #endif
 {
     snprintf(mName, kNameLength, "AudioIn_%X", id);
+    // Structured events go to the writer shared by all threads of the service, which
+    // unlike the per thread text logs is not limited to test harness builds
+    mNBLogWriter = NBLog::getServiceWriter("AudioFlinger");
 
     readInputParameters();
 }
@@ -4417,6 +4692,7 @@ bool AudioFlinger::RecordThread::threadLoop()
 {
     AudioBufferProvider::Buffer buffer;
     sp<RecordTrack> activeTrack;
+    Vector< sp<RecordTrack> > fanOutTracks;
     Vector< sp<EffectChain> > effectChains;
 
     nsecs_t lastWarning = 0;
@@ -4460,13 +4736,30 @@ bool AudioFlinger::RecordThread::threadLoop()
                 acquireWakeLock_l(mActiveTrack != 0 ? mActiveTrack->uid() : -1);
                 continue;
             }
+            // fan-out tracks only need to be acknowledged when stopping
+            for (size_t i = 0; i < mFanOutTracks.size(); ) {
+                if (mFanOutTracks[i]->mState == TrackBase::PAUSING) {
+                    mFanOutTracks[i]->mState = TrackBase::PAUSED;
+                    mFanOutTracks.removeAt(i);
+                    mStartStopCond.broadcast();
+                } else {
+                    i++;
+                }
+            }
             if (mActiveTrack != 0) {
                 if (mActiveTrack->isTerminated()) {
                     removeTrack_l(mActiveTrack);
                     mActiveTrack.clear();
+                    promoteFanOutTrack_l();
                 } else if (mActiveTrack->mState == TrackBase::PAUSING) {
-                    standby();
-                    mActiveTrack.clear();
+                    sp<RecordTrack> stoppingTrack = mActiveTrack;
+                    if (promoteFanOutTrack_l()) {
+                        // the capture goes on for the fan-out track, see stop()
+                        stoppingTrack->mState = TrackBase::PAUSED;
+                    } else {
+                        standby();
+                        mActiveTrack.clear();
+                    }
                     mStartStopCond.broadcast();
                 } else if (mActiveTrack->mState == TrackBase::RESUMING) {
                     if (mReqChannelCount != mActiveTrack->channelCount()) {
@@ -4486,6 +4779,7 @@ bool AudioFlinger::RecordThread::threadLoop()
                 }
             }
 
+            fanOutTracks = mFanOutTracks;
             lockEffectChains_l(effectChains);
         }
 
@@ -4538,8 +4832,10 @@ bool AudioFlinger::RecordThread::threadLoop()
                                 readInto = mRsmpInBuffer;
                                 mRsmpInIndex = 0;
                             }
+                            mNBLogWriter->logBegin(NBLog::EVENT_ID_RECORD_READ);
                             mBytesRead = mInput->stream->read(mInput->stream, readInto,
                                     mBufferSize);
+                            mNBLogWriter->logEnd(NBLog::EVENT_ID_RECORD_READ, mBytesRead);
                             if (mBytesRead <= 0) {
                                 if ((mBytesRead < 0) && (mActiveTrack->mState == TrackBase::ACTIVE))
                                 {
@@ -4587,6 +4883,9 @@ bool AudioFlinger::RecordThread::threadLoop()
                     // now done with mRsmpOutBuffer
 
                 }
+                if (!fanOutTracks.isEmpty() && buffer.frameCount > 0) {
+                    fanOut(fanOutTracks, buffer);
+                }
                 if (mFramestoDrop == 0) {
                     mActiveTrack->releaseBuffer(&buffer);
                 } else {
@@ -4627,6 +4926,7 @@ bool AudioFlinger::RecordThread::threadLoop()
         // enable changes in effect chain
         unlockEffectChains(effectChains);
         effectChains.clear();
+        fanOutTracks.clear();
     }
 
     standby();
@@ -4638,6 +4938,7 @@ bool AudioFlinger::RecordThread::threadLoop()
             track->invalidate();
         }
         mActiveTrack.clear();
+        mFanOutTracks.clear();
         mStartStopCond.broadcast();
     }
 
@@ -4777,6 +5078,15 @@ status_t AudioFlinger::RecordThread::start(RecordThread::RecordTrack* recordTrac
     sp<ThreadBase> strongMe = this;
     status_t status = NO_ERROR;
 
+    {
+        AutoMutex lock(mLock);
+        if (mActiveTrack != 0 && recordTrack != mActiveTrack.get()) {
+            // The input is already running for another track, so share its capture if
+            // possible.  Sync events only apply to the start of the input itself.
+            return startFanOut_l(recordTrack);
+        }
+    }
+
     if (event == AudioSystem::SYNC_EVENT_NONE) {
         clearSyncStartEvent();
     } else if (event != AudioSystem::SYNC_EVENT_SAME) {
@@ -4875,9 +5185,91 @@ void AudioFlinger::RecordThread::handleSyncStartEvent(const sp<SyncEvent>& event
     }
 }
 
+status_t AudioFlinger::RecordThread::startFanOut_l(RecordThread::RecordTrack* recordTrack)
+{
+    // only share a capture which is known to work
+    if (mActiveTrack->mState != TrackBase::ACTIVE ||
+            recordTrack->sampleRate() != mReqSampleRate ||
+            recordTrack->channelCount() != mReqChannelCount ||
+            recordTrack->mFrameSize != mActiveTrack->mFrameSize) {
+        return -EBUSY;
+    }
+    if (fanOutIndex_l(recordTrack) >= 0) {
+        if (recordTrack->mState == TrackBase::PAUSING) {
+            recordTrack->mState = TrackBase::ACTIVE;
+        }
+        return NO_ERROR;
+    }
+    ALOGV("RecordThread::startFanOut_l %p shares capture of %p", recordTrack, mActiveTrack.get());
+    // the input is already started, so there is no need to wait for a first read
+    recordTrack->mState = TrackBase::ACTIVE;
+    mFanOutTracks.add(recordTrack);
+    return NO_ERROR;
+}
+
+ssize_t AudioFlinger::RecordThread::fanOutIndex_l(RecordThread::RecordTrack* recordTrack) const
+{
+    for (size_t i = 0; i < mFanOutTracks.size(); i++) {
+        if (mFanOutTracks[i].get() == recordTrack) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool AudioFlinger::RecordThread::promoteFanOutTrack_l()
+{
+    if (mFanOutTracks.isEmpty()) {
+        return false;
+    }
+    mActiveTrack = mFanOutTracks[0];
+    mFanOutTracks.removeAt(0);
+    ALOGV("RecordThread: fan-out track %p is now the active track", mActiveTrack.get());
+    return true;
+}
+
+void AudioFlinger::RecordThread::fanOut(const Vector< sp<RecordTrack> >& tracks,
+        const AudioBufferProvider::Buffer& captured)
+{
+    for (size_t i = 0; i < tracks.size(); i++) {
+        RecordTrack* track = tracks[i].get();
+        if (track->mState != TrackBase::ACTIVE) {
+            continue;
+        }
+        size_t framesDone = 0;
+        while (framesDone < captured.frameCount) {
+            AudioBufferProvider::Buffer buffer;
+            buffer.frameCount = captured.frameCount - framesDone;
+            if (track->getNextBuffer(&buffer) != NO_ERROR || buffer.frameCount == 0) {
+                break;
+            }
+            memcpy(buffer.raw, captured.i8 + framesDone * track->mFrameSize,
+                    buffer.frameCount * track->mFrameSize);
+            framesDone += buffer.frameCount;
+            track->releaseBuffer(&buffer);
+        }
+        // a fan-out track which isn't read fast enough loses frames, but doesn't slow down others
+        if (framesDone < captured.frameCount) {
+            track->setOverflow();
+        } else {
+            track->clearOverflow();
+        }
+    }
+}
+
 bool AudioFlinger::RecordThread::stop(RecordThread::RecordTrack* recordTrack) {
     ALOGV("RecordThread::stop");
     AutoMutex _l(mLock);
+    if (fanOutIndex_l(recordTrack) >= 0) {
+        // the capture itself goes on for the other tracks
+        if (recordTrack->mState != TrackBase::PAUSING) {
+            recordTrack->mState = TrackBase::PAUSING;
+            if (!exitPending()) {
+                mStartStopCond.wait(mLock);
+            }
+        }
+        return false;
+    }
     if (recordTrack != mActiveTrack.get() || recordTrack->mState == TrackBase::PAUSING) {
         return false;
     }
@@ -4890,11 +5282,21 @@ bool AudioFlinger::RecordThread::stop(RecordThread::RecordTrack* recordTrack) {
     // if we have been restarted, recordTrack == mActiveTrack.get() here
     if (exitPending() || recordTrack != mActiveTrack.get()) {
         ALOGV("Record stopped OK");
-        return true;
+        // PAUSED means that a fan-out track took over the capture, which must keep running
+        return recordTrack->mState != TrackBase::PAUSED;
     }
     return false;
 }
 
+bool AudioFlinger::RecordThread::isInputShared(RecordThread::RecordTrack* recordTrack)
+{
+    Mutex::Autolock _l(mLock);
+    if (mFanOutTracks.isEmpty()) {
+        return false;
+    }
+    return recordTrack == mActiveTrack.get() || fanOutIndex_l(recordTrack) >= 0;
+}
+
 bool AudioFlinger::RecordThread::isValidSyncEvent(const sp<SyncEvent>& event) const
 {
     return false;
@@ -4930,7 +5332,11 @@ void AudioFlinger::RecordThread::destroyTrack_l(const sp<RecordTrack>& track)
 {
     track->terminate();
     track->mState = TrackBase::STOPPED;
-    // active tracks are removed by threadLoop()
+    // active tracks are removed by threadLoop(), but fan-out tracks can be removed right away
+    ssize_t index = fanOutIndex_l(track.get());
+    if (index >= 0) {
+        mFanOutTracks.removeAt(index);
+    }
     if (mActiveTrack != track) {
         removeTrack_l(track);
     }
@@ -4969,6 +5375,8 @@ void AudioFlinger::RecordThread::dumpInternals(int fd, const Vector<String16>& a
         result.append(buffer);
         snprintf(buffer, SIZE, "Out sample rate: %u\n", mReqSampleRate);
         result.append(buffer);
+        snprintf(buffer, SIZE, "Fan-out tracks: %u\n", mFanOutTracks.size());
+        result.append(buffer);
     } else {
         result.append("No active record client\n");
     }
@@ -5014,7 +5422,9 @@ status_t AudioFlinger::RecordThread::getNextBuffer(AudioBufferProvider::Buffer*
     int channelCount;
 
     if (framesReady == 0) {
+        mNBLogWriter->logBegin(NBLog::EVENT_ID_RECORD_READ);
         mBytesRead = mInput->stream->read(mInput->stream, mRsmpInBuffer, mBufferSize);
+        mNBLogWriter->logEnd(NBLog::EVENT_ID_RECORD_READ, mBytesRead);
         if (mBytesRead <= 0) {
             if ((mBytesRead < 0) && (mActiveTrack->mState == TrackBase::ACTIVE)) {
                 ALOGE("RecordThread::getNextBuffer() Error reading audio input");
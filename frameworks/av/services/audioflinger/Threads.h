@@ -527,6 +527,16 @@ protected:
 
     virtual     uint32_t    correctLatency_l(uint32_t latency) const;
 
+    // Batched mixing of several outputs in one scheduled pass; only MixerThread
+    // implements it, see MixerThread::batchCycle().
+    virtual     bool        isBatchFollower_l() const { return false; }
+    virtual     bool        hasBatchFollowers() const { return false; }
+    virtual     bool        batchPending_l() const { return false; }
+    virtual     void        threadLoop_batch() { }
+    virtual     void        wakeBatchLeader() { }
+
+    virtual     void        broadcast_l();
+
 private:
 
     friend class AudioFlinger;      // for numerous
@@ -537,7 +547,6 @@ private:
     status_t    addTrack_l(const sp<Track>& track);
     bool        destroyTrack_l(const sp<Track>& track);
     void        removeTrack_l(const sp<Track>& track);
-    void        broadcast_l();
 
     void        readOutputParameters();
 
@@ -619,12 +628,20 @@ private:
     sp<NBAIO_Source>        mTeeSource;
 #endif
     uint32_t                mScreenState;   // cached copy of gScreenState
+    // whether the pipe to the fast mixer adapts its depth, from property "af.pipe.adaptive"
+    bool                    mAdaptivePipe;
+    // set the fill setpoint of the pipe to the fast mixer for the current screen state
+    void                    setPipeSetpoint(MonoPipe *pipe);
     static const size_t     kFastMixerLogSize = 4 * 1024;
     sp<NBLog::Writer>       mFastMixerNBLogWriter;
 public:
     virtual     bool        hasFastMixer() const = 0;
     virtual     FastTrackUnderruns getFastTrackUnderruns(size_t fastIndex) const
                                 { FastTrackUnderruns dummy; return dummy; }
+    // no lock required, see IAudioFlinger::getFastMixerTimings()
+    virtual     status_t    getFastMixerTimings(uint32_t *cursor,
+                                    Vector<FastMixerCycleTiming> *timings) const
+                                { return INVALID_OPERATION; }
 
 protected:
                 // accessed by both binder threads and within threadLoop(), lock on mutex needed
@@ -673,10 +690,30 @@ protected:
     virtual     void        threadLoop_removeTracks(const Vector< sp<Track> >& tracksToRemove);
     virtual     uint32_t    correctLatency_l(uint32_t latency) const;
 
+    virtual     bool        isBatchFollower_l() const { return mBatchLeader.unsafe_get() != NULL; }
+    virtual     bool        hasBatchFollowers() const;
+    virtual     bool        batchPending_l() const;
+    virtual     void        threadLoop_batch();
+    virtual     void        wakeBatchLeader();
+    virtual     void        broadcast_l();
+
+                // One mix and write cycle of a follower, executed on the leader's thread.
+                // Returns false once the follower is idle and in standby.
+                bool        batchCycle();
+
                 AudioMixer* mAudioMixer;    // normal mixer
 private:
+                // Optional float mix buffer, enabled by property "af.mixer.float": tracks
+                // without an effect chain are mixed into it rather than into mMixBuffer, and it
+                // is converted into mMixBuffer once per cycle before the effect chains run.
+                // NULL if disabled.  Accessible only within the threadLoop().
+                void        allocMixBufferFloat();
+                float*      mMixBufferFloat;    // mNormalFrameCount * FCC_2 samples
+                bool        mFloatMixActive;    // at least one track is mixed into it this cycle
                 // one-time initialization, no locks required
                 FastMixer*  mFastMixer;         // non-NULL if there is also a fast mixer
+                // written only by the normal mixer, see FastTrackTable for the protocol
+                FastTrackTable mFastTrackTable;
                 sp<AudioWatchdog> mAudioWatchdog; // non-0 if there is an audio watchdog thread
 
                 // contents are not guaranteed to be consistent, no locks required
@@ -691,12 +728,33 @@ private:
                 //          mFastMixer->sq()    // for mutating and pushing state
                 int32_t     mFastMixerFutex;    // for cold idle
 
+                // Batched mixing, follower side
+                wp<MixerThread>     mBatchLeader;       // protected by mLock
+                Mutex               mBatchCycleLock;    // held during batchCycle(), before mLock
+
+                // Batched mixing, leader side
+                mutable Mutex       mBatchLock;         // leaf lock, protects mBatchFollowers
+                Vector< sp<MixerThread> > mBatchFollowers;
+                volatile int32_t    mBatchWakeups;      // incremented by followers without lock
+                int32_t             mBatchWakeupsSeen;  // accessible only within threadLoop()
+                bool                mBatchFollowersActive; // accessible only within threadLoop()
+
+public:
+    // Batched mixing: a follower output with the same period as this thread is mixed and
+    // written by this thread's threadLoop(), saving one wakeup per output and mix cycle.
+    // Returns false if the follower is not compatible.
+                bool        addBatchFollower(const sp<MixerThread>& follower);
+    // Stop batching, as leader or as follower; must be called before exit().
+                void        detachBatch();
+
 public:
     virtual     bool        hasFastMixer() const { return mFastMixer != NULL; }
     virtual     FastTrackUnderruns getFastTrackUnderruns(size_t fastIndex) const {
                               ALOG_ASSERT(fastIndex < FastMixerState::kMaxFastTracks);
                               return mFastMixerDumpState.mTracks[fastIndex].mUnderruns;
                             }
+    virtual     status_t    getFastMixerTimings(uint32_t *cursor,
+                                    Vector<FastMixerCycleTiming> *timings) const;
 };
 
 class DirectOutputThread : public PlaybackThread {
@@ -893,6 +951,10 @@ public:
             // return true if the caller should then do it's part of the stopping process
             bool        stop(RecordTrack* recordTrack);
 
+            // return true if the capture used by the specified active track is shared with
+            // other active tracks, so that it must keep running when that track goes away
+            bool        isInputShared(RecordTrack* recordTrack);
+
             void        dump(int fd, const Vector<String16>& args);
             AudioStreamIn* clearInput();
             virtual audio_stream_t* stream() const;
@@ -928,6 +990,15 @@ public:
 private:
             void clearSyncStartEvent();
 
+            // fan-out of the capture of mActiveTrack to other compatible tracks
+            status_t    startFanOut_l(RecordTrack* recordTrack);
+            ssize_t     fanOutIndex_l(RecordTrack* recordTrack) const;
+            // replace mActiveTrack by the oldest fan-out track, and return false if there is none
+            bool        promoteFanOutTrack_l();
+            // copy the frames just captured for mActiveTrack to the fan-out tracks
+            void        fanOut(const Vector< sp<RecordTrack> >& tracks,
+                               const AudioBufferProvider::Buffer& captured);
+
             // Enter standby if not already in standby, and set mStandby flag
             void standby();
 
@@ -940,6 +1011,12 @@ private:
             // is used together with mStartStopCond to indicate start()/stop() progress
             sp<RecordTrack>                     mActiveTrack;
             Condition                           mStartStopCond;
+            // Additional active tracks with the same format as mActiveTrack, in start order.
+            // The input is read, and resampled if needed, once for mActiveTrack, and the result
+            // is then copied to each of them.  When mActiveTrack stops, the oldest one replaces
+            // it without interrupting the capture.  They are also used together with
+            // mStartStopCond to indicate stop() progress.
+            Vector< sp<RecordTrack> >           mFanOutTracks;
 
             // updated by RecordThread::readInputParameters()
             AudioResampler                      *mResampler;
@@ -1821,12 +1821,13 @@ void AudioFlinger::RecordThread::RecordTrack::destroy()
     {
         sp<ThreadBase> thread = mThread.promote();
         if (thread != 0) {
-            if (mState == ACTIVE || mState == RESUMING) {
+            RecordThread *recordThread = (RecordThread *) thread.get();
+            // an input shared by fan-out tracks is stopped by the last of them
+            if ((mState == ACTIVE || mState == RESUMING) && !recordThread->isInputShared(this)) {
                 AudioSystem::stopInput(thread->id());
             }
             AudioSystem::releaseInput(thread->id());
             Mutex::Autolock _l(thread->mLock);
-            RecordThread *recordThread = (RecordThread *) thread.get();
             recordThread->destroyTrack_l(this);
         }
     }
@@ -0,0 +1,66 @@
+# Build the unit tests.
+LOCAL_PATH := $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AudioMixerSimd_test.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    liblog
+
+LOCAL_STATIC_LIBRARIES := \
+    libgtest \
+    libgtest_main
+
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -DARCH_ARM_HAVE_NEON
+endif
+
+LOCAL_MODULE := AudioMixerSimd_test
+
+include $(BUILD_NATIVE_TEST)
+
+# Build the benchmarks, see frameworks/base/tests/benchmarks.
+# libaudioflinger doesn't export the mixer, so it is built in.
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AudioMixer_benchmark.cpp \
+    ../AudioMixer.cpp.arm \
+    ../AudioResampler.cpp.arm \
+    ../AudioResamplerCubic.cpp.arm \
+    ../AudioResamplerSinc.cpp.arm \
+    ../AudioResamplerPolyphase.cpp.arm
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/.. \
+    $(call include-path-for, audio-effects) \
+    $(call include-path-for, audio-utils) \
+    frameworks/base/tests/benchmarks
+
+LOCAL_SHARED_LIBRARIES := \
+    libaudioutils \
+    libcommon_time_client \
+    libcutils \
+    libeffects \
+    libnbaio \
+    libutils \
+    liblog \
+    libdl
+
+LOCAL_STATIC_LIBRARIES := \
+    libframework_benchmark
+
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -DARCH_ARM_HAVE_NEON
+endif
+
+LOCAL_MODULE := AudioMixer_benchmark
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_PATH := $(TARGET_OUT_DATA_NATIVE_TESTS)/AudioMixer_benchmark
+
+include $(BUILD_EXECUTABLE)
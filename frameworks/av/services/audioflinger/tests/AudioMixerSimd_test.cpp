@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioMixerSimdTest"
+
+#include <stdlib.h>
+#include <string.h>
+#include <gtest/gtest.h>
+
+#include "AudioMixerSimd.h"
+
+namespace android {
+
+#if AUDIO_MIXER_SIMD
+
+// Frame counts chosen to exercise empty input, pure tails and multi-block runs.
+static const size_t kFrameCounts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 256, 1023 };
+static const size_t kMaxFrames = 1024;
+
+class AudioMixerSimdTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        srand(0x5eed);
+        for (size_t i = 0; i < kMaxFrames * 2; i++) {
+            mIn16[i] = (int16_t)rand();
+            // resampler output at unity gain also carries bits above Q.12 after filtering
+            mIn32[i] = (int32_t)((rand() << 1) ^ rand());
+            mOutRef[i] = mOutSimd[i] = (int32_t)rand() - (RAND_MAX / 2);
+        }
+    }
+
+    void expectSameOutput(size_t frameCount) {
+        ASSERT_EQ(0, memcmp(mOutRef, mOutSimd, sizeof(mOutRef)))
+                << "mismatch with frameCount " << frameCount;
+    }
+
+    // Volume ramps spanning the full 16.16 range, including negative steps and wraparound.
+    static void pickRamp(size_t n, int32_t* vl, int32_t* vr, int32_t* vlInc, int32_t* vrInc) {
+        *vl = (int32_t)(n * 0x01234567);
+        *vr = 0x10000000 - (int32_t)(n * 0x00abcdef);
+        *vlInc = (n & 1) ? 0x00010000 : -0x00007fff;
+        *vrInc = (int32_t)(n * 0x00001111) - 0x00100000;
+    }
+
+    int16_t mIn16[kMaxFrames * 2];
+    int32_t mIn32[kMaxFrames * 2];
+    int32_t mOutRef[kMaxFrames * 2];
+    int32_t mOutSimd[kMaxFrames * 2];
+};
+
+TEST_F(AudioMixerSimdTest, Stereo16) {
+    for (size_t n = 0; n < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); n++) {
+        const size_t frames = kFrameCounts[n];
+        const int16_t vl = (int16_t)(0x1000 - n * 0x155);
+        const int16_t vr = (int16_t)(n * 0x1234);
+        AudioMixerKernels::mixStereo16C(mOutRef, mIn16, frames, vl, vr);
+        AudioMixerKernels::mixStereo16Simd(mOutSimd, mIn16, frames, vl, vr);
+        expectSameOutput(frames);
+    }
+}
+
+TEST_F(AudioMixerSimdTest, Mono16) {
+    for (size_t n = 0; n < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); n++) {
+        const size_t frames = kFrameCounts[n];
+        const int16_t vl = (int16_t)(n * 0x0321);
+        const int16_t vr = (int16_t)(-0x7fff + n * 0x1000);
+        AudioMixerKernels::mixMono16C(mOutRef, mIn16, frames, vl, vr);
+        AudioMixerKernels::mixMono16Simd(mOutSimd, mIn16, frames, vl, vr);
+        expectSameOutput(frames);
+    }
+}
+
+TEST_F(AudioMixerSimdTest, Stereo32) {
+    for (size_t n = 0; n < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); n++) {
+        const size_t frames = kFrameCounts[n];
+        const int16_t vl = (int16_t)(0x1000 + n * 0x0777);
+        const int16_t vr = (int16_t)(0x0800 - n * 0x0123);
+        AudioMixerKernels::mixStereo32C(mOutRef, mIn32, frames, vl, vr);
+        AudioMixerKernels::mixStereo32Simd(mOutSimd, mIn32, frames, vl, vr);
+        expectSameOutput(frames);
+    }
+}
+
+TEST_F(AudioMixerSimdTest, Stereo16Ramp) {
+    for (size_t n = 0; n < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); n++) {
+        const size_t frames = kFrameCounts[n];
+        int32_t vl, vr, vlInc, vrInc;
+        pickRamp(n, &vl, &vr, &vlInc, &vrInc);
+        int32_t vlRef = vl, vrRef = vr;
+        AudioMixerKernels::mixStereo16RampC(mOutRef, mIn16, frames, &vlRef, &vrRef, vlInc, vrInc);
+        AudioMixerKernels::mixStereo16RampSimd(mOutSimd, mIn16, frames, &vl, &vr, vlInc, vrInc);
+        expectSameOutput(frames);
+        EXPECT_EQ(vlRef, vl);
+        EXPECT_EQ(vrRef, vr);
+    }
+}
+
+TEST_F(AudioMixerSimdTest, Mono16Ramp) {
+    for (size_t n = 0; n < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); n++) {
+        const size_t frames = kFrameCounts[n];
+        int32_t vl, vr, vlInc, vrInc;
+        pickRamp(n, &vl, &vr, &vlInc, &vrInc);
+        int32_t vlRef = vl, vrRef = vr;
+        AudioMixerKernels::mixMono16RampC(mOutRef, mIn16, frames, &vlRef, &vrRef, vlInc, vrInc);
+        AudioMixerKernels::mixMono16RampSimd(mOutSimd, mIn16, frames, &vl, &vr, vlInc, vrInc);
+        expectSameOutput(frames);
+        EXPECT_EQ(vlRef, vl);
+        EXPECT_EQ(vrRef, vr);
+    }
+}
+
+TEST_F(AudioMixerSimdTest, Stereo32Ramp) {
+    for (size_t n = 0; n < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); n++) {
+        const size_t frames = kFrameCounts[n];
+        int32_t vl, vr, vlInc, vrInc;
+        pickRamp(n, &vl, &vr, &vlInc, &vrInc);
+        int32_t vlRef = vl, vrRef = vr;
+        AudioMixerKernels::mixStereo32RampC(mOutRef, mIn32, frames, &vlRef, &vrRef, vlInc, vrInc);
+        AudioMixerKernels::mixStereo32RampSimd(mOutSimd, mIn32, frames, &vl, &vr, vlInc, vrInc);
+        expectSameOutput(frames);
+        EXPECT_EQ(vlRef, vl);
+        EXPECT_EQ(vrRef, vr);
+    }
+}
+
+#endif // AUDIO_MIXER_SIMD
+
+}; // namespace android
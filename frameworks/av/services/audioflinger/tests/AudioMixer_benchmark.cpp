@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "AudioMixerBenchmark"
+
+#include <math.h>
+#include <stdint.h>
+
+#include <system/audio.h>
+
+#include "AudioMixer.h"
+#include "Benchmark.h"
+
+using namespace android;
+
+// One AudioMixer::process() call is the mixing work of one normal mixer
+// cycle, for 1024 frames at 48 kHz.
+
+static const size_t FRAME_COUNT = 1024;
+static const uint32_t SAMPLE_RATE = 48000;
+static const int MAX_TRACKS = 8;
+
+// Always returns the same stereo sine wave.
+class SineProvider : public AudioBufferProvider {
+public:
+    enum { CAPACITY = FRAME_COUNT * 2 };
+
+    SineProvider() {
+        for (size_t i = 0; i < CAPACITY; i++) {
+            const int16_t s = (int16_t)(sin(i * 2 * M_PI * 440 / SAMPLE_RATE) * 16384);
+            mData[i * 2] = s;
+            mData[i * 2 + 1] = s;
+        }
+    }
+
+    virtual status_t getNextBuffer(Buffer* buffer, int64_t pts) {
+        if (buffer->frameCount > CAPACITY) {
+            buffer->frameCount = CAPACITY;
+        }
+        buffer->i16 = mData;
+        return NO_ERROR;
+    }
+
+    virtual void releaseBuffer(Buffer* buffer) {
+        buffer->raw = NULL;
+        buffer->frameCount = 0;
+    }
+
+private:
+    int16_t mData[CAPACITY * 2];
+};
+
+static void mix(benchmark::State& state, int tracks, uint32_t trackRate,
+        AudioMixer::mix_format_t format) {
+    AudioMixer mixer(FRAME_COUNT, SAMPLE_RATE);
+    SineProvider providers[MAX_TRACKS];
+    // large enough for the float format
+    int32_t out[FRAME_COUNT * 2];
+
+    for (int t = 0; t < tracks; t++) {
+        const int name = mixer.getTrackName(AUDIO_CHANNEL_OUT_STEREO, AUDIO_SESSION_OUTPUT_MIX);
+        if (name < 0) {
+            state.skip("can't allocate a track");
+            return;
+        }
+        mixer.setBufferProvider(name, &providers[t]);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER, out);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER_FORMAT,
+                (void *)format);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
+                (void *)AUDIO_CHANNEL_OUT_STEREO);
+        if (trackRate != SAMPLE_RATE) {
+            mixer.setParameter(name, AudioMixer::RESAMPLE, AudioMixer::SAMPLE_RATE,
+                    (void *)trackRate);
+        }
+        // below unity gain, so that the volume is applied
+        mixer.setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, (void *)0x0800);
+        mixer.setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, (void *)0x0800);
+        mixer.enable(name);
+    }
+
+    while (state.keepRunning()) {
+        mixer.process(AudioBufferProvider::kInvalidPTS);
+    }
+    state.setBytesPerIteration(FRAME_COUNT * 2 * sizeof(int16_t) * tracks);
+}
+
+BENCHMARK(AudioMixer_process_1track) {
+    mix(state, 1, SAMPLE_RATE, AudioMixer::MIX_FORMAT_INT16);
+}
+
+BENCHMARK(AudioMixer_process_4tracks) {
+    mix(state, 4, SAMPLE_RATE, AudioMixer::MIX_FORMAT_INT16);
+}
+
+BENCHMARK(AudioMixer_process_4tracks_float) {
+    mix(state, 4, SAMPLE_RATE, AudioMixer::MIX_FORMAT_FLOAT);
+}
+
+BENCHMARK(AudioMixer_process_1track_resample44100) {
+    mix(state, 1, 44100, AudioMixer::MIX_FORMAT_INT16);
+}
+
+BENCHMARK(AudioMixer_process_4tracks_resample44100) {
+    mix(state, 4, 44100, AudioMixer::MIX_FORMAT_INT16);
+}
@@ -44,6 +44,7 @@ LOCAL_SHARED_LIBRARIES:= \
     libbinder \
     libcutils \
     libmedia \
+    libnbaio \
     libcamera_client \
     libgui \
     libhardware \
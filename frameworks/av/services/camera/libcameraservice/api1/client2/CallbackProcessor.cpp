@@ -22,6 +22,10 @@
 #include <utils/Trace.h>
 #include <gui/Surface.h>
 
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #include "common/CameraDeviceBase.h"
 #include "api1/Camera2Client.h"
 #include "api1/client2/CallbackProcessor.h"
@@ -31,6 +35,60 @@
 namespace android {
 namespace camera2 {
 
+/**
+ * Chroma row helpers for convertFromFlexibleYuv, vectorized where NEON is
+ * available.
+ */
+
+// Interleave two planar chroma rows into a semiplanar row: a0 b0 a1 b1 ...
+static void interleaveChromaRow(uint8_t *dst, const uint8_t *a,
+        const uint8_t *b, size_t count) {
+    size_t i = 0;
+#if defined(__ARM_NEON__)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t pairs;
+        pairs.val[0] = vld1q_u8(a + i);
+        pairs.val[1] = vld1q_u8(b + i);
+        vst2q_u8(dst + 2 * i, pairs);
+    }
+#endif
+    for (; i < count; i++) {
+        dst[2 * i] = a[i];
+        dst[2 * i + 1] = b[i];
+    }
+}
+
+// Split a semiplanar chroma row into two planar rows
+static void deinterleaveChromaRow(uint8_t *a, uint8_t *b,
+        const uint8_t *src, size_t count) {
+    size_t i = 0;
+#if defined(__ARM_NEON__)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t pairs = vld2q_u8(src + 2 * i);
+        vst1q_u8(a + i, pairs.val[0]);
+        vst1q_u8(b + i, pairs.val[1]);
+    }
+#endif
+    for (; i < count; i++) {
+        a[i] = src[2 * i];
+        b[i] = src[2 * i + 1];
+    }
+}
+
+// Swap the two samples of each pair of a semiplanar chroma row
+static void swapChromaRow(uint8_t *dst, const uint8_t *src, size_t count) {
+    size_t i = 0;
+#if defined(__ARM_NEON__)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u8(dst + 2 * i, vrev16q_u8(vld1q_u8(src + 2 * i)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[2 * i] = src[2 * i + 1];
+        dst[2 * i + 1] = src[2 * i];
+    }
+}
+
 CallbackProcessor::CallbackProcessor(sp<Camera2Client> client):
         Thread(false),
         mClient(client),
@@ -393,7 +451,7 @@ status_t CallbackProcessor::processNewCallback(sp<Camera2Client> &client) {
 
         heapIdx = mCallbackHeapHead;
 
-        mCallbackHeapHead = (mCallbackHeapHead + 1) & kCallbackHeapCount;
+        mCallbackHeapHead = (mCallbackHeapHead + 1) % kCallbackHeapCount;
         mCallbackHeapFree--;
 
         // TODO: Get rid of this copy by passing the gralloc queue all the way
@@ -490,6 +548,23 @@ status_t CallbackProcessor::convertFromFlexibleYuv(int32_t previewFormat,
                 crcbDst += src.width;
                 crSrc += src.chromaStride;
             }
+        } else if (crSrc == cbSrc + 1 && src.chromaStep == 2) {
+            ALOGV("%s: Fast NV12->NV21", __FUNCTION__);
+            // Source has semiplanar CbCr chroma layout, swap each pair
+            for (size_t row = 0; row < chromaHeight; row++) {
+                swapChromaRow(crcbDst, cbSrc, chromaWidth);
+                crcbDst += src.width;
+                cbSrc += src.chromaStride;
+            }
+        } else if (src.chromaStep == 1) {
+            ALOGV("%s: Fast YUV420P->NV21", __FUNCTION__);
+            // Source has planar chroma layout, interleave by rows
+            for (size_t row = 0; row < chromaHeight; row++) {
+                interleaveChromaRow(crcbDst, crSrc, cbSrc, chromaWidth);
+                crcbDst += src.width;
+                crSrc += src.chromaStride;
+                cbSrc += src.chromaStride;
+            }
         } else {
             ALOGV("%s: Generic->NV21", __FUNCTION__);
             // Generic copy, always works but not very efficient
@@ -523,6 +598,22 @@ status_t CallbackProcessor::convertFromFlexibleYuv(int32_t previewFormat,
                 cbDst += dstCStride;
                 cbSrc += src.chromaStride;
             }
+        } else if (src.chromaStep == 2 &&
+                (cbSrc == crSrc + 1 || crSrc == cbSrc + 1)) {
+            ALOGV("%s: Fast YUV420SP->YV12", __FUNCTION__);
+            // Source has semiplanar chroma layout, split by rows
+            bool crFirst = cbSrc == crSrc + 1;
+            const uint8_t *pairSrc = crFirst ? crSrc : cbSrc;
+            for (size_t row = 0; row < chromaHeight; row++) {
+                if (crFirst) {
+                    deinterleaveChromaRow(crDst, cbDst, pairSrc, chromaWidth);
+                } else {
+                    deinterleaveChromaRow(cbDst, crDst, pairSrc, chromaWidth);
+                }
+                crDst += dstCStride;
+                cbDst += dstCStride;
+                pairSrc += src.chromaStride;
+            }
         } else {
             ALOGV("%s: Generic->YV12", __FUNCTION__);
             // Generic copy, always works but not very efficient
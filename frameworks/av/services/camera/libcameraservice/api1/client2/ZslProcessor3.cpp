@@ -27,6 +27,7 @@
 
 #include <utils/Log.h>
 #include <utils/Trace.h>
+#include <cutils/properties.h>
 #include <gui/Surface.h>
 
 #include "common/CameraDeviceBase.h"
@@ -50,6 +51,10 @@ ZslProcessor3::ZslProcessor3(
         mFrameListHead(0),
         mZslQueueHead(0),
         mZslQueueTail(0) {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.config.low_ram", value, "false");
+    mZslBufferDepth = strcmp(value, "true") ? kZslBufferDepth : kLowRamZslBufferDepth;
+
     mZslQueue.insertAt(0, kZslBufferDepth);
     mFrameList.insertAt(0, kFrameListDepth);
     sp<CaptureSequencer> captureSequencer = mSequencer.promote();
@@ -133,7 +138,7 @@ status_t ZslProcessor3::updateStream(const Parameters &params) {
         // Note that format specified internally in Camera3ZslStream
         res = device->createZslStream(
                 params.fastInfo.arrayWidth, params.fastInfo.arrayHeight,
-                kZslBufferDepth,
+                mZslBufferDepth,
                 &mZslStreamId,
                 &mZslStream);
         if (res != OK) {
@@ -370,14 +375,19 @@ nsecs_t ZslProcessor3::getCandidateTimestampLocked(size_t* metadataIdx) const {
     /**
      * Find the smallest timestamp we know about so far
      * - ensure that aeState is either converged or locked
+     * - only look at the newest frames, whose buffers are still in the ZSL
+     *   ring, so that the buffer and the metadata match
      */
 
     size_t idx = 0;
     nsecs_t minTimestamp = -1;
 
-    size_t emptyCount = mFrameList.size();
+    size_t frameCount = mZslBufferDepth < mFrameList.size() ?
+            mZslBufferDepth : mFrameList.size();
+    size_t emptyCount = frameCount;
 
-    for (size_t j = 0; j < mFrameList.size(); j++) {
+    for (size_t i = 0; i < frameCount; i++) {
+        size_t j = (mFrameListHead + mFrameList.size() - 1 - i) % mFrameList.size();
         const CameraMetadata &frame = mFrameList[j];
         if (!frame.isEmpty()) {
 
@@ -419,7 +429,7 @@ nsecs_t ZslProcessor3::getCandidateTimestampLocked(size_t* metadataIdx) const {
         }
     }
 
-    if (emptyCount == mFrameList.size()) {
+    if (emptyCount == frameCount) {
         /**
          * This could be mildly bad and means our ZSL was triggered before
          * there were any frames yet received by the camera framework.
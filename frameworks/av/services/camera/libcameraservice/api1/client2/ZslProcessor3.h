@@ -108,7 +108,13 @@ class ZslProcessor3 :
     };
 
     static const size_t kZslBufferDepth = 4;
+    // Depth of the ZSL ring on low-RAM devices, where full-resolution
+    // buffers are too costly to keep many of
+    static const size_t kLowRamZslBufferDepth = 2;
     static const size_t kFrameListDepth = kZslBufferDepth * 2;
+
+    // Number of buffers kept in the ZSL ring
+    size_t mZslBufferDepth;
     Vector<CameraMetadata> mFrameList;
     size_t mFrameListHead;
 
@@ -58,7 +58,8 @@ Camera3Device::Camera3Device(int id):
         mUsePartialResultQuirk(false),
         mNextResultFrameNumber(0),
         mNextShutterFrameNumber(0),
-        mListener(NULL)
+        mListener(NULL),
+        mNBLogWriter(NBLog::getServiceWriter("CameraService"))
 {
     ATRACE_CALL();
     camera3_callback_ops::notify = &sNotify;
@@ -1579,6 +1580,8 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
     status_t res;
 
     uint32_t frameNumber = result->frame_number;
+    mNBLogWriter->logEvent(NBLog::EVENT_ID_CAMERA_CAPTURE_RESULT, frameNumber,
+            result->num_output_buffers);
     if (result->result == NULL && result->num_output_buffers == 0) {
         SET_ERR("No result data provided by HAL for frame %d",
                 frameNumber);
@@ -1861,6 +1864,72 @@ CameraMetadata Camera3Device::getLatestRequestLocked() {
     return retVal;
 }
 
+/**
+ * OutputBufferThread inner class methods
+ */
+
+Camera3Device::OutputBufferThread::OutputBufferThread() :
+        Thread(false),
+        mPendingCount(0),
+        mResult(OK) {
+}
+
+void Camera3Device::OutputBufferThread::queueGetBuffer(
+        const sp<camera3::Camera3OutputStreamInterface> &stream,
+        camera3_stream_buffer_t *buffer) {
+    Mutex::Autolock l(mLock);
+    BufferRequest bufferRequest;
+    bufferRequest.stream = stream;
+    bufferRequest.buffer = buffer;
+    mQueue.push_back(bufferRequest);
+    mPendingCount++;
+    mQueueSignal.signal();
+}
+
+status_t Camera3Device::OutputBufferThread::waitForBuffers() {
+    Mutex::Autolock l(mLock);
+    while (mPendingCount > 0) {
+        mDoneSignal.wait(mLock);
+    }
+    status_t res = mResult;
+    mResult = OK;
+    return res;
+}
+
+void Camera3Device::OutputBufferThread::requestExit() {
+    Mutex::Autolock l(mLock);
+    Thread::requestExit();
+    mQueueSignal.signal();
+}
+
+bool Camera3Device::OutputBufferThread::threadLoop() {
+    BufferRequest bufferRequest;
+    {
+        Mutex::Autolock l(mLock);
+        while (mQueue.empty()) {
+            if (exitPending()) {
+                return false;
+            }
+            mQueueSignal.wait(mLock);
+        }
+        bufferRequest = mQueue[0];
+        mQueue.removeAt(0);
+    }
+
+    status_t res = bufferRequest.stream->getBuffer(bufferRequest.buffer);
+    if (res != OK) {
+        bufferRequest.buffer->buffer = NULL;
+    }
+
+    Mutex::Autolock l(mLock);
+    if (res != OK && mResult == OK) {
+        mResult = res;
+    }
+    mPendingCount--;
+    mDoneSignal.signal();
+    return true;
+}
+
 /**
  * RequestThread inner class methods
  */
@@ -1879,6 +1948,8 @@ Camera3Device::RequestThread::RequestThread(wp<Camera3Device> parent,
         mFrameNumber(0),
         mLatestRequestId(NAME_NOT_FOUND) {
     mStatusId = statusTracker->addComponent();
+    mOutputBufferThread = new OutputBufferThread();
+    mOutputBufferThread->run(String8::format("C3Dev-%d-BufQueue", mId).string());
 }
 
 void Camera3Device::RequestThread::configurationComplete() {
@@ -2006,6 +2077,7 @@ void Camera3Device::RequestThread::requestExit() {
     // The exit from any possible waits
     mDoPauseSignal.signal();
     mRequestSignal.signal();
+    mOutputBufferThread->requestExit();
 }
 
 bool Camera3Device::RequestThread::threadLoop() {
@@ -2115,19 +2187,12 @@ bool Camera3Device::RequestThread::threadLoop() {
         request.input_buffer = NULL;
     }
 
-    outputBuffers.insertAt(camera3_stream_buffer_t(), 0,
-            nextRequest->mOutputStreams.size());
-    request.output_buffers = outputBuffers.array();
-    for (size_t i = 0; i < nextRequest->mOutputStreams.size(); i++) {
-        res = nextRequest->mOutputStreams.editItemAt(i)->
-                getBuffer(&outputBuffers.editItemAt(i));
-        if (res != OK) {
-            ALOGE("RequestThread: Can't get output buffer, skipping request:"
-                    " %s (%d)", strerror(-res), res);
-            cleanUpFailedRequest(request, nextRequest, outputBuffers);
-            return true;
-        }
-        request.num_output_buffers++;
+    res = getOutputBuffers(request, nextRequest, outputBuffers);
+    if (res != OK) {
+        ALOGE("RequestThread: Can't get output buffer, skipping request:"
+                " %s (%d)", strerror(-res), res);
+        cleanUpFailedRequest(request, nextRequest, outputBuffers);
+        return true;
     }
 
     request.frame_number = mFrameNumber++;
@@ -2174,8 +2239,14 @@ bool Camera3Device::RequestThread::threadLoop() {
     if (request.settings != NULL) { // Don't update them if they were unchanged
         Mutex::Autolock al(mLatestRequestMutex);
 
-        camera_metadata_t* cloned = clone_camera_metadata(request.settings);
-        mLatestRequest.acquire(cloned);
+        if (triggerCount > 0) {
+            // The triggers are removed from the request right below
+            camera_metadata_t* cloned = clone_camera_metadata(request.settings);
+            mLatestRequest.acquire(cloned);
+            mLatestRequestSource.clear();
+        } else {
+            mLatestRequestSource = nextRequest;
+        }
     }
 
     if (request.settings != NULL) {
@@ -2211,10 +2282,15 @@ bool Camera3Device::RequestThread::threadLoop() {
 }
 
 CameraMetadata Camera3Device::RequestThread::getLatestRequest() const {
+    // Triggers are only mixed into requests with mTriggerMutex held
+    Mutex::Autolock tl(mTriggerMutex);
     Mutex::Autolock al(mLatestRequestMutex);
 
     ALOGV("RequestThread::%s", __FUNCTION__);
 
+    if (mLatestRequestSource != NULL) {
+        return mLatestRequestSource->mSettings;
+    }
     return mLatestRequest;
 }
 
@@ -2237,6 +2313,51 @@ void Camera3Device::RequestThread::cleanUpFailedRequest(
     }
 }
 
+status_t Camera3Device::RequestThread::getOutputBuffers(
+        camera3_capture_request_t &request,
+        sp<CaptureRequest> &nextRequest,
+        Vector<camera3_stream_buffer_t> &outputBuffers) {
+    size_t count = nextRequest->mOutputStreams.size();
+    outputBuffers.insertAt(camera3_stream_buffer_t(), 0, count);
+    request.output_buffers = outputBuffers.array();
+
+    // Every other stream is handed to the buffer thread, so that waiting on
+    // the consumers of several streams overlaps
+    for (size_t i = 1; i < count; i += 2) {
+        mOutputBufferThread->queueGetBuffer(nextRequest->mOutputStreams[i],
+                &outputBuffers.editItemAt(i));
+    }
+    status_t res = OK;
+    for (size_t i = 0; i < count; i += 2) {
+        status_t streamRes = nextRequest->mOutputStreams.editItemAt(i)->
+                getBuffer(&outputBuffers.editItemAt(i));
+        if (streamRes != OK) {
+            outputBuffers.editItemAt(i).buffer = NULL;
+            if (res == OK) res = streamRes;
+        }
+    }
+    if (count > 1) {
+        status_t threadRes = mOutputBufferThread->waitForBuffers();
+        if (res == OK) res = threadRes;
+    }
+
+    if (res != OK) {
+        // Return the buffers that were gotten, as cleanUpFailedRequest only
+        // returns a leading run of them
+        for (size_t i = 0; i < count; i++) {
+            if (outputBuffers[i].buffer != NULL) {
+                outputBuffers.editItemAt(i).status = CAMERA3_BUFFER_STATUS_ERROR;
+                nextRequest->mOutputStreams.editItemAt(i)->returnBuffer(
+                        outputBuffers[i], 0);
+            }
+        }
+        return res;
+    }
+
+    request.num_output_buffers = count;
+    return OK;
+}
+
 sp<Camera3Device::CaptureRequest>
         Camera3Device::RequestThread::waitForNextRequest() {
     status_t res;
@@ -2375,6 +2496,15 @@ status_t Camera3Device::RequestThread::insertTriggers(
     CameraMetadata &metadata = request->mSettings;
     size_t count = mTriggerMap.size();
 
+    if (count > 0) {
+        // Stop sharing the settings as the latest request before changing them
+        Mutex::Autolock al(mLatestRequestMutex);
+        if (mLatestRequestSource == request) {
+            mLatestRequest = request->mSettings;
+            mLatestRequestSource.clear();
+        }
+    }
+
     for (size_t i = 0; i < count; ++i) {
         RequestTrigger trigger = mTriggerMap.valueAt(i);
 
@@ -24,6 +24,7 @@
 #include <utils/Thread.h>
 #include <utils/KeyedVector.h>
 #include <hardware/camera3.h>
+#include <media/nbaio/NBLog.h>
 
 #include "common/CameraDeviceBase.h"
 #include "device3/StatusTracker.h"
@@ -287,6 +288,51 @@ class Camera3Device :
         }
     };
 
+    /**
+     * Thread for getting output buffers of a request in parallel with the
+     * request thread, so that the time spent waiting on each stream's
+     * consumer overlaps.
+     */
+    class OutputBufferThread : public Thread {
+
+      public:
+
+        OutputBufferThread();
+
+        /**
+         * Start getting a buffer from the stream. The buffer must stay valid
+         * until waitForBuffers returns.
+         */
+        void     queueGetBuffer(const sp<camera3::Camera3OutputStreamInterface> &stream,
+                camera3_stream_buffer_t *buffer);
+
+        /**
+         * Wait until all queued buffers have been gotten. Returns the first
+         * error, with the buffers that failed left with a NULL buffer handle.
+         */
+        status_t waitForBuffers();
+
+        virtual void requestExit();
+
+      protected:
+
+        virtual bool threadLoop();
+
+      private:
+
+        struct BufferRequest {
+            sp<camera3::Camera3OutputStreamInterface> stream;
+            camera3_stream_buffer_t *buffer;
+        };
+
+        Mutex              mLock;
+        Condition          mQueueSignal;
+        Condition          mDoneSignal;
+        Vector<BufferRequest> mQueue;
+        size_t             mPendingCount;
+        status_t           mResult;
+    };
+
     /**
      * Thread for managing capture request submission to HAL device.
      */
@@ -384,6 +430,12 @@ class Camera3Device :
                 sp<CaptureRequest> &nextRequest,
                 Vector<camera3_stream_buffer_t> &outputBuffers);
 
+        // Get a buffer from each output stream of the request, sharing the
+        // streams with mOutputBufferThread when there are several.
+        status_t getOutputBuffers(camera3_capture_request_t &request,
+                sp<CaptureRequest> &nextRequest,
+                Vector<camera3_stream_buffer_t> &outputBuffers);
+
         // Pause handling
         bool               waitIfPaused();
         void               unpauseForNewRequests();
@@ -422,10 +474,16 @@ class Camera3Device :
         Condition          mLatestRequestSignal;
         // android.request.id for latest process_capture_request
         int32_t            mLatestRequestId;
+        // Settings of the latest process_capture_request. They're shared with
+        // mLatestRequestSource, which the HAL was given as is, and only copied
+        // once triggers are about to be mixed into it.
         CameraMetadata     mLatestRequest;
+        sp<CaptureRequest> mLatestRequestSource;
+
+        sp<OutputBufferThread> mOutputBufferThread;
 
         typedef KeyedVector<uint32_t/*tag*/, RequestTrigger> TriggerMap;
-        Mutex              mTriggerMutex;
+        mutable Mutex      mTriggerMutex;
         TriggerMap         mTriggerMap;
         TriggerMap         mTriggerRemovedMap;
         TriggerMap         mTriggerReplacedMap;
@@ -524,6 +582,9 @@ class Camera3Device :
 
     /**** End scope for mOutputLock ****/
 
+    // Capture result events, shared with the other devices of the camera service
+    sp<NBLog::Writer>      mNBLogWriter;
+
     /**
      * Callback functions from HAL device
      */
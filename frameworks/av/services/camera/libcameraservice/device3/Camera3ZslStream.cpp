@@ -282,11 +282,17 @@ status_t Camera3ZslStream::enqueueInputBufferByTimestamp(
 
     Mutex::Autolock l(mLock);
 
-    TimestampFinder timestampFinder = TimestampFinder(timestamp);
-
+    // The candidate timestamp normally comes from the metadata of a frame
+    // still in the ring buffer, so look it up directly first
     sp<RingBufferConsumer::PinnedBufferItem> pinnedBuffer =
-            mProducer->pinSelectedBuffer(timestampFinder,
-                                        /*waitForFence*/false);
+            mProducer->pinBufferWithTimestamp(timestamp,
+                                              /*waitForFence*/false);
+
+    if (pinnedBuffer == 0) {
+        TimestampFinder timestampFinder = TimestampFinder(timestamp);
+        pinnedBuffer = mProducer->pinSelectedBuffer(timestampFinder,
+                                                    /*waitForFence*/false);
+    }
 
     if (pinnedBuffer == 0) {
         ALOGE("%s: No ZSL buffers were available yet", __FUNCTION__);
@@ -113,6 +113,40 @@ sp<PinnedBufferItem> RingBufferConsumer::pinSelectedBuffer(
     return pinnedBuffer;
 }
 
+sp<PinnedBufferItem> RingBufferConsumer::pinBufferWithTimestamp(
+        int64_t timestamp,
+        bool waitForFence) {
+
+    sp<PinnedBufferItem> pinnedBuffer;
+
+    {
+        Mutex::Autolock _l(mMutex);
+
+        ssize_t index = mTimestampIndex.indexOfKey(timestamp);
+        if (index < 0) {
+            return NULL;
+        }
+
+        pinnedBuffer = new PinnedBufferItem(this, *mTimestampIndex.valueAt(index));
+        mTimestampIndex.editValueAt(index)->mPinCount++;
+
+        BI_LOGV("Pinned buffer (frame %lld, timestamp %lld)",
+                pinnedBuffer->getBufferItem().mFrameNumber, timestamp);
+
+    } // end scope of mMutex autolock
+
+    if (waitForFence) {
+        status_t err = pinnedBuffer->getBufferItem().mFence->waitForever(
+                "RingBufferConsumer::pinBufferWithTimestamp");
+        if (err != OK) {
+            BI_LOGE("Failed to wait for fence of acquired buffer: %s (%d)",
+                    strerror(-err), err);
+        }
+    }
+
+    return pinnedBuffer;
+}
+
 status_t RingBufferConsumer::clear() {
 
     status_t err;
@@ -245,7 +279,7 @@ status_t RingBufferConsumer::releaseOldestBufferLocked(size_t* pinnedFrames) {
                 item.mTimestamp, item.mFrameNumber);
 
         size_t currentSize = mBufferItemList.size();
-        mBufferItemList.erase(accIt);
+        eraseBufferItemLocked(accIt);
         assert(mBufferItemList.size() == currentSize - 1);
     } else {
         BI_LOGW("All buffers pinned, could not find any to release");
@@ -300,11 +334,23 @@ void RingBufferConsumer::onFrameAvailable() {
                 mBufferItemList.size(), mBufferCount);
 
         item.mGraphicBuffer = mSlots[item.mBuf].mGraphicBuffer;
+
+        // Two frames with the same timestamp can only be told apart by a
+        // scan, so the index keeps the newest one
+        mTimestampIndex.add(item.mTimestamp, --mBufferItemList.end());
     } // end of mMutex lock
 
     ConsumerBase::onFrameAvailable();
 }
 
+void RingBufferConsumer::eraseBufferItemLocked(List<RingBufferItem>::iterator it) {
+    ssize_t index = mTimestampIndex.indexOfKey(it->mTimestamp);
+    if (index >= 0 && mTimestampIndex.valueAt(index) == it) {
+        mTimestampIndex.removeItemsAt(index);
+    }
+    mBufferItemList.erase(it);
+}
+
 void RingBufferConsumer::unpinBuffer(const BufferItem& item) {
     Mutex::Autolock _l(mMutex);
 
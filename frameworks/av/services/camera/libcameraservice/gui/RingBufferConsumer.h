@@ -25,6 +25,7 @@
 #include <utils/Vector.h>
 #include <utils/threads.h>
 #include <utils/List.h>
+#include <utils/KeyedVector.h>
 
 #define ANDROID_GRAPHICS_RINGBUFFERCONSUMER_JNI_ID "mRingBufferConsumer"
 
@@ -156,6 +157,14 @@ class RingBufferConsumer : public ConsumerBase,
     sp<PinnedBufferItem> pinSelectedBuffer(const RingBufferComparator& filter,
                                            bool waitForFence = true);
 
+    // Find the buffer with exactly this timestamp, then pin it before returning
+    // it. Returns NULL if no buffer in the ring buffer has this timestamp.
+    //
+    // Unlike pinSelectedBuffer, this doesn't scan the ring buffer, as the
+    // buffers are indexed by timestamp.
+    sp<PinnedBufferItem> pinBufferWithTimestamp(int64_t timestamp,
+                                                bool waitForFence = true);
+
     // Release all the non-pinned buffers in the ring buffer
     status_t clear();
 
@@ -177,8 +186,13 @@ class RingBufferConsumer : public ConsumerBase,
         int mPinCount;
     };
 
+    // Removes the item from the ring buffer and from the timestamp index
+    void eraseBufferItemLocked(List<RingBufferItem>::iterator it);
+
     // List of acquired buffers in our ring buffer
     List<RingBufferItem>       mBufferItemList;
+    // Acquired buffers by timestamp
+    KeyedVector<int64_t, List<RingBufferItem>::iterator> mTimestampIndex;
     const int                  mBufferCount;
 };
 
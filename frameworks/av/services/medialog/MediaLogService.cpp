@@ -34,7 +34,7 @@ void MediaLogService::registerWriter(const sp<IMemory>& shared, size_t size, con
         return;
     }
     sp<NBLog::Reader> reader(new NBLog::Reader(size, shared));
-    NamedReader namedReader(reader, name);
+    NamedReader namedReader(reader, name, IPCThreadState::self()->getCallingPid());
     Mutex::Autolock _l(mLock);
     mNamedReaders.add(namedReader);
 }
@@ -71,6 +71,23 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args)
         Mutex::Autolock _l(mLock);
         namedReaders = mNamedReaders;
     }
+
+    // "--merged" dumps the structured events of all writers in time order, and
+    // "--systrace" does the same in a format that systrace can load
+    bool merged = false;
+    bool systrace = false;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == String16("--merged")) {
+            merged = true;
+        } else if (args[i] == String16("--systrace")) {
+            systrace = true;
+        }
+    }
+    if (merged || systrace) {
+        dumpMerged(fd, namedReaders, systrace);
+        return NO_ERROR;
+    }
+
     for (size_t i = 0; i < namedReaders.size(); i++) {
         const NamedReader& namedReader = namedReaders[i];
         if (fd >= 0) {
@@ -83,6 +100,74 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args)
     return NO_ERROR;
 }
 
+struct MergedEvent {
+    NBLog::IdEvent  mEvent;
+    size_t          mReader;    // index in the named readers
+    size_t          mSeq;       // order within the reader, for events with the same time
+};
+
+static int compareMergedEvents(const MergedEvent* lhs, const MergedEvent* rhs)
+{
+    if (lhs->mEvent.mTimeNs != rhs->mEvent.mTimeNs) {
+        return lhs->mEvent.mTimeNs < rhs->mEvent.mTimeNs ? -1 : 1;
+    }
+    if (lhs->mReader != rhs->mReader) {
+        return lhs->mReader < rhs->mReader ? -1 : 1;
+    }
+    return lhs->mSeq < rhs->mSeq ? -1 : (lhs->mSeq > rhs->mSeq ? 1 : 0);
+}
+
+void MediaLogService::dumpMerged(int fd, const Vector<NamedReader>& namedReaders, bool systrace)
+{
+    Vector<MergedEvent> merged;
+    for (size_t i = 0; i < namedReaders.size(); i++) {
+        Vector<NBLog::IdEvent> events;
+        namedReaders[i].reader()->readEvents(events);
+        for (size_t j = 0; j < events.size(); j++) {
+            MergedEvent event;
+            event.mEvent = events[j];
+            event.mReader = i;
+            event.mSeq = j;
+            merged.add(event);
+        }
+    }
+    merged.sort(compareMergedEvents);
+
+    if (systrace) {
+        fdprintf(fd, "# tracer: nop\n#\n");
+        fdprintf(fd, "#           TASK-PID    CPU#    TIMESTAMP  FUNCTION\n");
+        fdprintf(fd, "#              | |       |          |         |\n");
+    }
+    for (size_t i = 0; i < merged.size(); i++) {
+        const NBLog::IdEvent& event = merged[i].mEvent;
+        const NamedReader& namedReader = namedReaders[merged[i].mReader];
+        const int sec = (int) (event.mTimeNs / 1000000000LL);
+        const int usec = (int) (event.mTimeNs / 1000LL % 1000000);
+        if (!systrace) {
+            char description[96];
+            NBLog::formatEvent(description, sizeof(description), event);
+            fdprintf(fd, "[%d.%06d] %s: %s\n", sec, usec, namedReader.name(), description);
+            continue;
+        }
+        // systrace pairs the begin and end marks of each thread, and shows the
+        // instant events as counters of the process
+        fdprintf(fd, "%16.16s-%-5d [000] ...1 %5d.%06d: tracing_mark_write: ",
+                namedReader.name(), event.mTid, sec, usec);
+        switch (event.mPhase) {
+        case NBLog::PHASE_BEGIN:
+            fdprintf(fd, "B|%d|%s\n", namedReader.pid(), NBLog::eventName(event.mId));
+            break;
+        case NBLog::PHASE_END:
+            fdprintf(fd, "E\n");
+            break;
+        default:
+            fdprintf(fd, "C|%d|%s|%d\n", namedReader.pid(), NBLog::eventName(event.mId),
+                    event.mNumArgs > 0 ? event.mArgs[0] : 0);
+            break;
+        }
+    }
+}
+
 status_t MediaLogService::onTransact(uint32_t code, const Parcel& data, Parcel* reply,
         uint32_t flags)
 {
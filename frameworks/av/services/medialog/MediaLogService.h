@@ -46,18 +46,26 @@ private:
     Mutex               mLock;
     class NamedReader {
     public:
-        NamedReader() : mReader(0) { mName[0] = '\0'; } // for Vector
-        NamedReader(const sp<NBLog::Reader>& reader, const char *name) : mReader(reader)
+        NamedReader() : mReader(0), mPid(0) { mName[0] = '\0'; } // for Vector
+        NamedReader(const sp<NBLog::Reader>& reader, const char *name, pid_t pid)
+            : mReader(reader), mPid(pid)
             { strlcpy(mName, name, sizeof(mName)); }
         ~NamedReader() { }
         const sp<NBLog::Reader>&  reader() const { return mReader; }
         const char*               name() const { return mName; }
+        pid_t                     pid() const { return mPid; }
     private:
         sp<NBLog::Reader>   mReader;
         static const size_t kMaxName = 32;
         char                mName[kMaxName];
+        pid_t               mPid;       // process of the writer
     };
     Vector<NamedReader> mNamedReaders;
+
+    // Dumps the structured events of all writers as a single time-ordered stream,
+    // either as text or in the systrace (ftrace text) format
+    static void         dumpMerged(int fd, const Vector<NamedReader>& namedReaders,
+                                bool systrace);
 };
 
 }   // namespace android
@@ -26,6 +26,7 @@
 #include <cutils/properties.h>
 
 #include <androidfw/AssetManager.h>
+#include <androidfw/ZipFileRO.h>
 #include <binder/IPCThreadState.h>
 #include <utils/Atomic.h>
 #include <utils/Errors.h>
@@ -152,25 +153,43 @@ status_t BootAnimation::initTexture(Texture* texture, AssetManager& assets,
     return NO_ERROR;
 }
 
-status_t BootAnimation::initTexture(void* buffer, size_t len)
+bool BootAnimation::decodeFrame(const Animation::Frame& frame, SkBitmap* bitmap)
 {
-    //StopWatch watch("blah");
+    const void* data = frame.map->getDataPtr();
+    size_t len = frame.map->getDataLength();
+    void* inflated = NULL;
+    if (frame.method == ZipFileRO::kCompressDeflated) {
+        inflated = malloc(frame.uncompLen);
+        if (!inflated || !ZipFileRO::inflateBuffer(inflated, data, frame.uncompLen, len)) {
+            ALOGE("Failed to inflate frame %s", frame.name.string());
+            free(inflated);
+            return false;
+        }
+        data = inflated;
+        len = frame.uncompLen;
+    }
 
-    SkBitmap bitmap;
-    SkMemoryStream  stream(buffer, len);
+    bool result = false;
+    SkMemoryStream stream(data, len);
     SkImageDecoder* codec = SkImageDecoder::Factory(&stream);
-    codec->setDitherImage(false);
     if (codec) {
-        codec->decode(&stream, &bitmap,
+        codec->setDitherImage(false);
+        result = codec->decode(&stream, bitmap,
                 SkBitmap::kARGB_8888_Config,
                 SkImageDecoder::kDecodePixels_Mode);
         delete codec;
     }
+    free(inflated);
 
-    // ensure we can call getPixels(). No need to call unlock, since the
-    // bitmap will go out of scope when we return from this method.
-    bitmap.lockPixels();
+    // ensure we can call getPixels() from the render thread
+    if (result) {
+        bitmap->lockPixels();
+    }
+    return result;
+}
 
+status_t BootAnimation::initTexture(const SkBitmap& bitmap)
+{
     const int w = bitmap.width();
     const int h = bitmap.height();
     const void* p = bitmap.getPixels();
@@ -214,6 +233,31 @@ status_t BootAnimation::initTexture(void* buffer, size_t len)
     return NO_ERROR;
 }
 
+status_t BootAnimation::initCompressedTexture(const void* buffer, size_t len)
+{
+    // PKM header, as written by etc1tool: magic, version, format, then the
+    // padded and the original dimensions, big-endian
+    static const size_t PKM_HEADER_SIZE = 16;
+    const uint8_t* p = static_cast<const uint8_t*>(buffer);
+    if (len < PKM_HEADER_SIZE || memcmp(p, "PKM 10", 6)) {
+        return BAD_VALUE;
+    }
+    const int tw = (p[8] << 8) | p[9];
+    const int th = (p[10] << 8) | p[11];
+    const int w = (p[12] << 8) | p[13];
+    const int h = (p[14] << 8) | p[15];
+    const size_t size = ((tw + 3) / 4) * ((th + 3) / 4) * 8;
+    if (len < PKM_HEADER_SIZE + size) {
+        return BAD_VALUE;
+    }
+
+    GLint crop[4] = { 0, h, w, -h };
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_ETC1_RGB8_OES, tw, th, 0,
+            size, p + PKM_HEADER_SIZE);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_CROP_RECT_OES, crop);
+    return NO_ERROR;
+}
+
 status_t BootAnimation::readyToRun() {
     mAssets.addDefaultAssets();
 
@@ -390,6 +434,106 @@ void BootAnimation::checkExit() {
     }
 }
 
+BootAnimation::FrameLoader::FrameLoader(const Animation& animation)
+    : Thread(false), mAnimation(animation), mPart(0), mFrame(0), mDone(false)
+{
+}
+
+BootAnimation::FrameLoader::~FrameLoader()
+{
+    for (size_t i=0 ; i<mFrames.size() ; i++) {
+        delete mFrames[i].bitmap;
+    }
+}
+
+void BootAnimation::FrameLoader::stop()
+{
+    {
+        Mutex::Autolock _l(mLock);
+        requestExit();
+        mCondition.broadcast();
+    }
+    requestExitAndWait();
+}
+
+// Advances to the next frame to decode. Returns false past the last one.
+bool BootAnimation::FrameLoader::nextFrame()
+{
+    const size_t pcount = mAnimation.parts.size();
+    while (mPart < pcount) {
+        const Animation::Part& part(mAnimation.parts[mPart]);
+        if (mFrame < part.frames.size() && !part.frames[mFrame].etc1) {
+            return true;
+        }
+        if (mFrame < part.frames.size()) {
+            mFrame++;
+        } else {
+            mPart++;
+            mFrame = 0;
+        }
+    }
+    return false;
+}
+
+bool BootAnimation::FrameLoader::threadLoop()
+{
+    size_t part, frame;
+    {
+        Mutex::Autolock _l(mLock);
+        while (!exitPending() && mFrames.size() >= MAX_PREFETCH_FRAMES) {
+            mCondition.wait(mLock);
+        }
+        if (exitPending() || !nextFrame()) {
+            mDone = true;
+            mCondition.broadcast();
+            return false;
+        }
+        part = mPart;
+        frame = mFrame++;
+    }
+
+    // decode without the lock, so that the render thread can take the
+    // frames already decoded
+    SkBitmap* bitmap = new SkBitmap();
+    if (!decodeFrame(mAnimation.parts[part].frames[frame], bitmap)) {
+        delete bitmap;
+        bitmap = NULL;
+    }
+
+    Mutex::Autolock _l(mLock);
+    DecodedFrame decoded;
+    decoded.part = part;
+    decoded.frame = frame;
+    decoded.bitmap = bitmap;
+    mFrames.add(decoded);
+    mCondition.broadcast();
+    return true;
+}
+
+SkBitmap* BootAnimation::FrameLoader::getFrame(size_t part, size_t frame)
+{
+    Mutex::Autolock _l(mLock);
+    for (;;) {
+        while (!mFrames.isEmpty()) {
+            DecodedFrame decoded(mFrames[0]);
+            mFrames.removeAt(0);
+            mCondition.broadcast();
+            if (decoded.part == part && decoded.frame == frame) {
+                return decoded.bitmap;
+            }
+            // this frame was skipped by the render thread
+            delete decoded.bitmap;
+            if (decoded.part > part || (decoded.part == part && decoded.frame > frame)) {
+                return NULL;
+            }
+        }
+        if (mDone) {
+            return NULL;
+        }
+        mCondition.wait(mLock);
+    }
+}
+
 bool BootAnimation::movie()
 {
     ZipFileRO& zip(mZip);
@@ -449,14 +593,22 @@ bool BootAnimation::movie()
                 for (int j=0 ; j<pcount ; j++) {
                     if (path == animation.parts[j].path) {
                         int method;
-                        // supports only stored png files
-                        if (zip.getEntryInfo(entry, &method, 0, 0, 0, 0, 0)) {
-                            if (method == ZipFileRO::kCompressStored) {
+                        size_t uncompLen;
+                        // png files are decoded straight from the zip mapping,
+                        // etc1 ones must be stored to be uploaded from it
+                        if (zip.getEntryInfo(entry, &method, &uncompLen, 0, 0, 0, 0)) {
+                            const bool etc1 = (leaf.getPathExtension() == ".pkm");
+                            if (method == ZipFileRO::kCompressStored ||
+                                    (method == ZipFileRO::kCompressDeflated && !etc1)) {
                                 FileMap* map = zip.createEntryFileMap(entry);
                                 if (map) {
                                     Animation::Frame frame;
                                     frame.name = leaf;
                                     frame.map = map;
+                                    frame.method = method;
+                                    frame.uncompLen = uncompLen;
+                                    frame.etc1 = etc1;
+                                    frame.tid = 0;
                                     Animation::Part& part(animation.parts.editItemAt(j));
                                     part.frames.add(frame);
                                 }
@@ -494,6 +646,9 @@ bool BootAnimation::movie()
     Region clearReg(Rect(mWidth, mHeight));
     clearReg.subtractSelf(Rect(xc, yc, xc+animation.width, yc+animation.height));
 
+    sp<FrameLoader> loader = new FrameLoader(animation);
+    loader->run("BootAnimationLoader", PRIORITY_DISPLAY);
+
     for (int i=0 ; i<pcount ; i++) {
         const Animation::Part& part(animation.parts[i]);
         const size_t fcount = part.frames.size();
@@ -517,9 +672,17 @@ bool BootAnimation::movie()
                         glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
                         glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
                     }
-                    initTexture(
-                            frame.map->getDataPtr(),
-                            frame.map->getDataLength());
+                    if (frame.etc1) {
+                        initCompressedTexture(
+                                frame.map->getDataPtr(),
+                                frame.map->getDataLength());
+                    } else {
+                        SkBitmap* bitmap = loader->getFrame(i, j);
+                        if (bitmap) {
+                            initTexture(*bitmap);
+                            delete bitmap;
+                        }
+                    }
                 }
 
                 if (!clearReg.isEmpty()) {
@@ -571,6 +734,8 @@ bool BootAnimation::movie()
         }
     }
 
+    loader->stop();
+
     return false;
 }
 
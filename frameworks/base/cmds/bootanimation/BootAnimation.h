@@ -60,6 +60,11 @@ private:
         struct Frame {
             String8 name;
             FileMap* map;
+            // compression method of the zip entry, and its uncompressed size
+            int method;
+            size_t uncompLen;
+            // ETC1 frames (.pkm) are uploaded straight from the mapping
+            bool etc1;
             mutable GLuint tid;
             bool operator < (const Frame& rhs) const {
                 return name < rhs.name;
@@ -78,8 +83,51 @@ private:
         Vector<Part> parts;
     };
 
+    /*
+     * Decodes the PNG frames of an animation on its own thread, in playback
+     * order, keeping at most MAX_PREFETCH_FRAMES of them decoded ahead.
+     */
+    class FrameLoader : public Thread {
+    public:
+        FrameLoader(const Animation& animation);
+        virtual ~FrameLoader();
+
+        // Returns the given frame, which the caller then owns, and drops the
+        // frames decoded before it. Blocks until the frame is decoded, and
+        // returns NULL if it couldn't be. Frames must be asked for in
+        // playback order.
+        SkBitmap* getFrame(size_t part, size_t frame);
+
+        // Stops decoding and waits for the thread to exit
+        void stop();
+
+    private:
+        enum { MAX_PREFETCH_FRAMES = 3 };
+
+        struct DecodedFrame {
+            size_t part;
+            size_t frame;
+            SkBitmap* bitmap;
+        };
+
+        virtual bool threadLoop();
+        bool nextFrame();
+
+        const Animation& mAnimation;
+        Mutex mLock;
+        Condition mCondition;
+        Vector<DecodedFrame> mFrames;
+        // next frame to decode
+        size_t mPart;
+        size_t mFrame;
+        bool mDone;
+    };
+
+    static bool decodeFrame(const Animation::Frame& frame, SkBitmap* bitmap);
+
     status_t initTexture(Texture* texture, AssetManager& asset, const char* name);
-    status_t initTexture(void* buffer, size_t len);
+    status_t initTexture(const SkBitmap& bitmap);
+    status_t initCompressedTexture(const void* buffer, size_t len);
     bool android();
     bool movie();
 
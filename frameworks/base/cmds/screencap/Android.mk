@@ -10,7 +10,8 @@ LOCAL_SHARED_LIBRARIES := \
 	libbinder \
 	libskia \
     libui \
-    libgui
+    libgui \
+    libz
 
 LOCAL_MODULE:= screencap
 
@@ -21,6 +22,7 @@ LOCAL_C_INCLUDES += \
 	external/skia/include/effects \
 	external/skia/include/images \
 	external/skia/src/ports \
-	external/skia/include/utils
+	external/skia/include/utils \
+	external/zlib
 
 include $(BUILD_EXECUTABLE)
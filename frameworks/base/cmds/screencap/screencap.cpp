@@ -17,7 +17,10 @@
 #include <errno.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <zlib.h>
 
 #include <linux/fb.h>
 #include <sys/ioctl.h>
@@ -29,6 +32,7 @@
 #include <gui/ISurfaceComposer.h>
 
 #include <ui/PixelFormat.h>
+#include <ui/Rect.h>
 
 #include <SkImageEncoder.h>
 #include <SkBitmap.h>
@@ -39,13 +43,17 @@ using namespace android;
 
 static uint32_t DEFAULT_DISPLAY_ID = ISurfaceComposer::eDisplayIdMain;
 
+// More threads than this don't speed up the compression of a screen
+static const int MAX_PNG_THREADS = 4;
+
 static void usage(const char* pname)
 {
     fprintf(stderr,
-            "usage: %s [-hp] [-d display-id] [FILENAME]\n"
+            "usage: %s [-hp] [-d display-id] [-r x,y,w,h] [FILENAME]\n"
             "   -h: this message\n"
             "   -p: save the file as a png.\n"
             "   -d: specify the display id to capture, default %d.\n"
+            "   -r: only capture the given region of the display.\n"
             "If FILENAME ends with .png it will be saved as a png.\n"
             "If FILENAME is not given, the results will be printed to stdout.\n",
             pname, DEFAULT_DISPLAY_ID
@@ -62,6 +70,254 @@ static SkBitmap::Config flinger2skia(PixelFormat f)
     }
 }
 
+// ----------------------------------------------------------------------------
+// PNG encoding
+//
+// 32-bit images are written with zlib directly, so that they can be compressed
+// by several threads: each thread deflates a band of rows into a raw deflate
+// stream ending with a sync flush, and the streams are concatenated into the
+// zlib stream of a single IDAT chunk. Other formats go through Skia.
+// ----------------------------------------------------------------------------
+
+struct PngBand {
+    // input
+    const uint8_t* pixels;
+    uint32_t width;
+    uint32_t rows;
+    size_t stride;          // in bytes
+    bool hasAlpha;          // RGBA, or RGBX written as RGB
+    bool last;
+    // output
+    uint8_t* data;
+    size_t size;
+    uLong adler;
+    size_t rawSize;         // size of the filtered rows
+    int err;
+};
+
+static void* deflatePngBand(void* arg)
+{
+    PngBand* band = static_cast<PngBand*>(arg);
+    const size_t bpp = band->hasAlpha ? 4 : 3;
+    const size_t rowSize = 1 + band->width * bpp;
+
+    band->data = NULL;
+    band->size = 0;
+    band->adler = adler32(0L, Z_NULL, 0);
+    band->rawSize = rowSize * band->rows;
+    band->err = Z_OK;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    band->err = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+            -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (band->err != Z_OK) {
+        return NULL;
+    }
+
+    // room for the whole band, plus the sync flush marker
+    size_t capacity = deflateBound(&zs, band->rawSize) + 64;
+    band->data = static_cast<uint8_t*>(malloc(capacity));
+    uint8_t* row = static_cast<uint8_t*>(malloc(rowSize));
+    uint8_t* prev = static_cast<uint8_t*>(malloc(bpp));
+    if (band->data == NULL || row == NULL || prev == NULL) {
+        band->err = Z_MEM_ERROR;
+    }
+
+    zs.next_out = band->data;
+    zs.avail_out = capacity;
+    for (uint32_t y = 0; y < band->rows && band->err == Z_OK; y++) {
+        const uint8_t* src = band->pixels + y * band->stride;
+        // "Sub" filter: each byte is stored as the difference with the same
+        // byte of the pixel on its left
+        row[0] = 1;
+        memset(prev, 0, bpp);
+        uint8_t* dst = row + 1;
+        for (uint32_t x = 0; x < band->width; x++, src += 4, dst += bpp) {
+            uint8_t r = src[0], g = src[1], b = src[2], a = src[3];
+            if (band->hasAlpha && a != 0xFF && a != 0) {
+                // PNG colors aren't premultiplied
+                r = (r * 0xFF + a / 2) / a;
+                g = (g * 0xFF + a / 2) / a;
+                b = (b * 0xFF + a / 2) / a;
+            }
+            dst[0] = r - prev[0];
+            dst[1] = g - prev[1];
+            dst[2] = b - prev[2];
+            prev[0] = r;
+            prev[1] = g;
+            prev[2] = b;
+            if (band->hasAlpha) {
+                dst[3] = a - prev[3];
+                prev[3] = a;
+            }
+        }
+        band->adler = adler32(band->adler, row, rowSize);
+
+        zs.next_in = row;
+        zs.avail_in = rowSize;
+        const bool lastRow = (y + 1 == band->rows);
+        const int flush = !lastRow ? Z_NO_FLUSH : (band->last ? Z_FINISH : Z_SYNC_FLUSH);
+        do {
+            if (zs.avail_out == 0) {
+                // deflateBound() should make this unnecessary
+                uint8_t* data = static_cast<uint8_t*>(realloc(band->data, capacity * 2));
+                if (data == NULL) {
+                    band->err = Z_MEM_ERROR;
+                    break;
+                }
+                band->data = data;
+                zs.next_out = band->data + capacity;
+                zs.avail_out = capacity;
+                capacity *= 2;
+            }
+            int err = deflate(&zs, flush);
+            if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+                band->err = err;
+            }
+        } while (band->err == Z_OK && (zs.avail_in != 0 || zs.avail_out == 0));
+    }
+
+    band->size = capacity - zs.avail_out;
+    deflateEnd(&zs);
+    free(prev);
+    free(row);
+    return NULL;
+}
+
+static void writeBigEndian(uint8_t* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static bool writeFully(int fd, const void* data, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool writePngChunk(int fd, const char* type, const uint8_t* data, size_t size)
+{
+    uint8_t header[8];
+    writeBigEndian(header, size);
+    memcpy(header + 4, type, 4);
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), header + 4, 4);
+    if (size > 0) {
+        // crc32() resets the checksum when passed a NULL buffer
+        crc = crc32(crc, data, size);
+    }
+    uint8_t trailer[4];
+    writeBigEndian(trailer, crc);
+    return writeFully(fd, header, sizeof(header))
+            && writeFully(fd, data, size)
+            && writeFully(fd, trailer, sizeof(trailer));
+}
+
+static status_t writePng(int fd, const void* base, uint32_t w, uint32_t h,
+        size_t strideBytes, bool hasAlpha)
+{
+    int numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numThreads > MAX_PNG_THREADS) numThreads = MAX_PNG_THREADS;
+    if (numThreads > int(h)) numThreads = h;
+    if (numThreads < 1) numThreads = 1;
+
+    PngBand bands[MAX_PNG_THREADS];
+    pthread_t threads[MAX_PNG_THREADS];
+    const uint32_t rowsPerBand = (h + numThreads - 1) / numThreads;
+    for (int i = 0; i < numThreads; i++) {
+        const uint32_t firstRow = i * rowsPerBand;
+        PngBand& band(bands[i]);
+        band.pixels = static_cast<const uint8_t*>(base) + firstRow * strideBytes;
+        band.width = w;
+        band.rows = (i == numThreads - 1) ? h - firstRow : rowsPerBand;
+        band.stride = strideBytes;
+        band.hasAlpha = hasAlpha;
+        band.last = (i == numThreads - 1);
+    }
+    // the calling thread takes the first band
+    int numStarted = 1;
+    for (; numStarted < numThreads; numStarted++) {
+        if (pthread_create(&threads[numStarted], NULL, deflatePngBand,
+                &bands[numStarted]) != 0) {
+            break;
+        }
+    }
+    deflatePngBand(&bands[0]);
+    for (int i = 1; i < numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for (int i = numStarted; i < numThreads; i++) {
+        deflatePngBand(&bands[i]);
+    }
+
+    status_t result = NO_ERROR;
+    size_t idatSize = 2 + 4;    // zlib header and adler32 checksum
+    uLong adler = bands[0].adler;
+    for (int i = 0; i < numThreads; i++) {
+        if (bands[i].err != Z_OK) {
+            result = NO_MEMORY;
+        }
+        idatSize += bands[i].size;
+        if (i > 0) {
+            adler = adler32_combine(adler, bands[i].adler, bands[i].rawSize);
+        }
+    }
+
+    if (result == NO_ERROR) {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        uint8_t ihdr[13];
+        writeBigEndian(ihdr, w);
+        writeBigEndian(ihdr + 4, h);
+        ihdr[8] = 8;                    // bit depth
+        ihdr[9] = hasAlpha ? 6 : 2;     // RGBA or RGB
+        ihdr[10] = 0;                   // deflate
+        ihdr[11] = 0;                   // adaptive filtering
+        ihdr[12] = 0;                   // no interlace
+
+        // The IDAT chunk is written piecewise, to avoid gathering the bands
+        uint8_t idatHeader[8 + 2];
+        writeBigEndian(idatHeader, idatSize);
+        memcpy(idatHeader + 4, "IDAT", 4);
+        idatHeader[8] = 0x78;           // deflate, 32K window
+        idatHeader[9] = 0x9C;           // default compression, FCHECK
+        uLong crc = crc32(crc32(0L, Z_NULL, 0), idatHeader + 4, 6);
+        uint8_t idatTrailer[4 + 4];
+        writeBigEndian(idatTrailer, adler);
+
+        bool ok = writeFully(fd, signature, sizeof(signature))
+                && writePngChunk(fd, "IHDR", ihdr, sizeof(ihdr))
+                && writeFully(fd, idatHeader, sizeof(idatHeader));
+        for (int i = 0; ok && i < numThreads; i++) {
+            crc = crc32(crc, bands[i].data, bands[i].size);
+            ok = writeFully(fd, bands[i].data, bands[i].size);
+        }
+        crc = crc32(crc, idatTrailer, 4);
+        writeBigEndian(idatTrailer + 4, crc);
+        ok = ok && writeFully(fd, idatTrailer, sizeof(idatTrailer))
+                && writePngChunk(fd, "IEND", NULL, 0);
+        if (!ok) {
+            result = -errno;
+        }
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        free(bands[i].data);
+    }
+    return result;
+}
+
 static status_t vinfoToPixelFormat(const fb_var_screeninfo& vinfo,
         uint32_t* bytespp, uint32_t* f)
 {
@@ -93,8 +349,9 @@ int main(int argc, char** argv)
     const char* pname = argv[0];
     bool png = false;
     int32_t displayId = DEFAULT_DISPLAY_ID;
+    Rect region;
     int c;
-    while ((c = getopt(argc, argv, "phd:")) != -1) {
+    while ((c = getopt(argc, argv, "phd:r:")) != -1) {
         switch (c) {
             case 'p':
                 png = true;
@@ -102,6 +359,16 @@ int main(int argc, char** argv)
             case 'd':
                 displayId = atoi(optarg);
                 break;
+            case 'r': {
+                int x, y, rw, rh;
+                if (sscanf(optarg, "%d,%d,%d,%d", &x, &y, &rw, &rh) != 4
+                        || x < 0 || y < 0 || rw <= 0 || rh <= 0) {
+                    usage(pname);
+                    return 1;
+                }
+                region = Rect(x, y, x + rw, y + rh);
+                break;
+            }
             case '?':
             case 'h':
                 usage(pname);
@@ -141,7 +408,7 @@ int main(int argc, char** argv)
 
     ScreenshotClient screenshot;
     sp<IBinder> display = SurfaceComposerClient::getBuiltInDisplay(displayId);
-    if (display != NULL && screenshot.update(display) == NO_ERROR) {
+    if (display != NULL && screenshot.update(display, region, 0, 0, 0, -1UL) == NO_ERROR) {
         base = screenshot.getPixels();
         w = screenshot.getWidth();
         h = screenshot.getHeight();
@@ -166,6 +433,20 @@ int main(int argc, char** argv)
                     if (mapbase != MAP_FAILED) {
                         base = (void const *)((char const *)mapbase + offset);
                     }
+                    if (base && !region.isEmpty()) {
+                        // the framebuffer is cropped here, the stride is unchanged
+                        Rect crop;
+                        if (!region.intersect(Rect(w, h), &crop)) {
+                            fprintf(stderr, "Region is outside of the screen\n");
+                            base = 0;
+                        } else {
+                            base = (void const *)((char const *)base
+                                    + (crop.top * s + crop.left) * bytespp);
+                            w = crop.width();
+                            h = crop.height();
+                            size = w*h*bytespp;
+                        }
+                    }
                 }
             }
             close(fb);
@@ -173,7 +454,12 @@ int main(int argc, char** argv)
     }
 
     if (base) {
-        if (png) {
+        if (png && (f == PIXEL_FORMAT_RGBA_8888 || f == PIXEL_FORMAT_RGBX_8888)) {
+            status_t err = writePng(fd, base, w, h, s*4, f == PIXEL_FORMAT_RGBA_8888);
+            if (err != NO_ERROR) {
+                fprintf(stderr, "Error writing png (%s)\n", strerror(-err));
+            }
+        } else if (png) {
             SkBitmap b;
             b.setConfig(flinger2skia(f), w, h, s*bytesPerPixel(f));
             b.setPixels((void*)base);
@@ -188,9 +474,13 @@ int main(int argc, char** argv)
             write(fd, &h, 4);
             write(fd, &f, 4);
             size_t Bpp = bytesPerPixel(f);
-            for (size_t y=0 ; y<h ; y++) {
-                write(fd, base, w*Bpp);
-                base = (void *)((char *)base + s*Bpp);
+            if (s == w) {
+                writeFully(fd, base, size_t(w)*h*Bpp);
+            } else {
+                for (size_t y=0 ; y<h ; y++) {
+                    writeFully(fd, base, w*Bpp);
+                    base = (void *)((char *)base + s*Bpp);
+                }
             }
         }
     }
@@ -85,6 +85,7 @@ LOCAL_SRC_FILES:= \
 	android/graphics/AutoDecodeCancel.cpp \
 	android/graphics/Bitmap.cpp \
 	android/graphics/BitmapFactory.cpp \
+	android/graphics/BitmapPool.cpp \
 	android/graphics/Camera.cpp \
 	android/graphics/Canvas.cpp \
 	android/graphics/ColorFilter.cpp \
@@ -109,6 +110,7 @@ LOCAL_SRC_FILES:= \
 	android/graphics/BitmapRegionDecoder.cpp \
 	android/graphics/Rasterizer.cpp \
 	android/graphics/Region.cpp \
+	android/graphics/RegionTileCache.cpp \
 	android/graphics/Shader.cpp \
 	android/graphics/SurfaceTexture.cpp \
 	android/graphics/TextLayout.cpp \
@@ -25,6 +25,7 @@
 #include <utils/misc.h>
 #include <binder/Parcel.h>
 #include <utils/threads.h>
+#include <cutils/atomic.h>
 #include <cutils/properties.h>
 
 #include <SkGraphics.h>
@@ -43,6 +44,7 @@
 #include <signal.h>
 #include <dirent.h>
 #include <assert.h>
+#include <pthread.h>
 
 
 using namespace android;
@@ -1056,34 +1058,113 @@ static void quickTest(void* arg)
 }
 #endif
 
-#ifdef NDEBUG
-    #define REG_JNI(name)      { name }
-    struct RegJNIRec {
-        int (*mProc)(JNIEnv*);
-    };
-#else
-    #define REG_JNI(name)      { name, #name }
-    struct RegJNIRec {
-        int (*mProc)(JNIEnv*);
-        const char* mName;
-    };
-#endif
+// The names are kept in release builds too, for the registration timings
+#define REG_JNI(name)      { name, #name }
+struct RegJNIRec {
+    int (*mProc)(JNIEnv*);
+    const char* mName;
+};
 
 typedef void (*RegJAMProc)();
 
-static int register_jni_procs(const RegJNIRec array[], size_t count, JNIEnv* env)
+// Most threads used to register the natives of gParallelRegJNI
+static const int kMaxRegJNIThreads = 4;
+
+static int register_jni_proc(const RegJNIRec& rec, JNIEnv* env, bool timing)
+{
+    nsecs_t start = timing ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+    if (rec.mProc(env) < 0) {
+        ALOGD("----------!!! %s failed to load\n", rec.mName);
+        return -1;
+    }
+    if (timing) {
+        ALOGI("%s took %lld us", rec.mName,
+                ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - start));
+    }
+    return 0;
+}
+
+static int register_jni_procs(const RegJNIRec array[], size_t count, JNIEnv* env,
+        bool timing = false)
 {
     for (size_t i = 0; i < count; i++) {
-        if (array[i].mProc(env) < 0) {
-#ifndef NDEBUG
-            ALOGD("----------!!! %s failed to load\n", array[i].mName);
-#endif
+        if (register_jni_proc(array[i], env, timing) < 0) {
             return -1;
         }
     }
     return 0;
 }
 
+/*
+ * Registration state shared by the threads of register_jni_procs_parallel().
+ * Each thread takes the next entry of the table until there are none left.
+ */
+struct RegJNIWork {
+    const RegJNIRec* mArray;
+    int32_t mCount;
+    bool mTiming;
+    volatile int32_t mNext;
+    volatile int32_t mFailed;
+};
+
+static void register_jni_work(RegJNIWork* work, JNIEnv* env)
+{
+    env->PushLocalFrame(200);
+    while (!work->mFailed) {
+        int32_t i = android_atomic_inc(&work->mNext);
+        if (i >= work->mCount) {
+            break;
+        }
+        if (register_jni_proc(work->mArray[i], env, work->mTiming) < 0) {
+            android_atomic_release_store(1, &work->mFailed);
+        }
+    }
+    env->PopLocalFrame(NULL);
+}
+
+static void* register_jni_thread(void* arg)
+{
+    RegJNIWork* work = static_cast<RegJNIWork*>(arg);
+    JNIEnv* env;
+    if (javaAttachThread("JNIRegistration", &env) != JNI_OK) {
+        // the other threads take over this one's share
+        return NULL;
+    }
+    register_jni_work(work, env);
+    javaDetachThread();
+    return NULL;
+}
+
+/*
+ * Registers the entries of the table from the calling thread and up to
+ * numThreads - 1 threads attached to the VM, in no particular order. All of
+ * them are done when this returns.
+ */
+static int register_jni_procs_parallel(const RegJNIRec array[], size_t count,
+        JNIEnv* env, int numThreads, bool timing)
+{
+    RegJNIWork work;
+    work.mArray = array;
+    work.mCount = count;
+    work.mTiming = timing;
+    work.mNext = 0;
+    work.mFailed = 0;
+
+    pthread_t threads[kMaxRegJNIThreads];
+    int numStarted = 0;
+    for (int i = 1; i < numThreads && i < kMaxRegJNIThreads; i++) {
+        if (pthread_create(&threads[numStarted], NULL, register_jni_thread, &work) != 0) {
+            break;
+        }
+        numStarted++;
+    }
+    register_jni_work(&work, env);
+    for (int i = 0; i < numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return work.mFailed ? -1 : 0;
+}
+
 static void register_jam_procs(const RegJAMProc array[], size_t count)
 {
     for (size_t i = 0; i < count; i++) {
@@ -1114,6 +1195,13 @@ static const RegJNIRec gRegJNI[] = {
     REG_JNI(register_android_view_DisplayEventReceiver),
     REG_JNI(register_android_nio_utils),
     REG_JNI(register_android_graphics_Graphics),
+};
+
+/*
+ * These don't depend on each other when registering, so they may be registered
+ * concurrently, after gRegJNI.
+ */
+static const RegJNIRec gParallelRegJNI[] = {
     REG_JNI(register_android_view_GraphicBuffer),
     REG_JNI(register_android_view_GLES20DisplayList),
     REG_JNI(register_android_view_GLES20Canvas),
@@ -1240,14 +1328,45 @@ static const RegJNIRec gRegJNI[] = {
      * started the VM yet, they're all getting stored in the base frame
      * and never released.  Use Push/Pop to manage the storage.
      */
+    char propBuf[PROPERTY_VALUE_MAX];
+    property_get("debug.zygote.jni_reg_timing", propBuf, "");
+    const bool timing = (strcmp(propBuf, "true") == 0);
+    property_get("ro.zygote.jni_reg_threads", propBuf, "1");
+    int numThreads = atoi(propBuf);
+    if (numThreads < 1) {
+        numThreads = 1;
+    } else if (numThreads > kMaxRegJNIThreads) {
+        numThreads = kMaxRegJNIThreads;
+    }
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+
     env->PushLocalFrame(200);
 
-    if (register_jni_procs(gRegJNI, NELEM(gRegJNI), env) < 0) {
+    if (register_jni_procs(gRegJNI, NELEM(gRegJNI), env, timing) < 0) {
         env->PopLocalFrame(NULL);
         return -1;
     }
     env->PopLocalFrame(NULL);
 
+    if (numThreads > 1) {
+        if (register_jni_procs_parallel(gParallelRegJNI, NELEM(gParallelRegJNI), env,
+                numThreads, timing) < 0) {
+            return -1;
+        }
+    } else {
+        env->PushLocalFrame(200);
+        if (register_jni_procs(gParallelRegJNI, NELEM(gParallelRegJNI), env, timing) < 0) {
+            env->PopLocalFrame(NULL);
+            return -1;
+        }
+        env->PopLocalFrame(NULL);
+    }
+
+    if (timing) {
+        ALOGI("Registered natives in %lld ms on %d threads",
+                ns2ms(systemTime(SYSTEM_TIME_MONOTONIC) - start), numThreads);
+    }
+
     //createJavaThread("fubar", quickTest, (void*) "hello");
 
     return 0;
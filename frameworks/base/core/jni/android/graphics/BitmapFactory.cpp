@@ -1,6 +1,7 @@
 #define LOG_TAG "BitmapFactory"
 
 #include "BitmapFactory.h"
+#include "BitmapPool.h"
 #include "NinePatchPeeker.h"
 #include "SkData.h"
 #include "SkFrontBufferedStream.h"
@@ -304,7 +305,8 @@ static jobject doDecode(JNIEnv* env, SkStreamRewindable* stream, jobject padding
 
     SkImageDecoder::Mode decodeMode = isPurgeable ? SkImageDecoder::kDecodeBounds_Mode : mode;
 
-    JavaPixelAllocator javaAllocator(env);
+    // The pixels of a new bitmap may reuse the array of a freed one
+    JavaPixelAllocator javaAllocator(env, true /*pooled*/);
     RecyclingPixelAllocator recyclingAllocator(outputBitmap->pixelRef(), existingBufferSize);
     ScaleCheckingAllocator scaleCheckingAllocator(scale, existingBufferSize);
     SkBitmap::Allocator* outputAllocator = (javaBitmap != NULL) ?
@@ -614,6 +616,23 @@ static jboolean nativeIsSeekable(JNIEnv* env, jobject, jobject fileDescriptor) {
     return ::lseek64(descriptor, 0, SEEK_CUR) != -1 ? JNI_TRUE : JNI_FALSE;
 }
 
+static void nativeSetBitmapPoolSize(JNIEnv* env, jobject, jint maxBytes) {
+    BitmapPool::getInstance().setMaxBytes(env, maxBytes > 0 ? maxBytes : 0);
+}
+
+// Writes the hits, misses, releases, drops, count and bytes of the pool.
+static void nativeGetBitmapPoolStats(JNIEnv* env, jobject, jintArray outStats) {
+    if (env->GetArrayLength(outStats) < 6) {
+        doThrowAIOOBE(env);
+        return;
+    }
+    BitmapPool::Stats stats;
+    BitmapPool::getInstance().getStats(&stats);
+    jint values[6] = { jint(stats.hits), jint(stats.misses), jint(stats.releases),
+            jint(stats.drops), jint(stats.count), jint(stats.bytes) };
+    env->SetIntArrayRegion(outStats, 0, 6, values);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 static JNINativeMethod gMethods[] = {
@@ -641,6 +660,16 @@ static JNINativeMethod gMethods[] = {
         "(Ljava/io/FileDescriptor;)Z",
         (void*)nativeIsSeekable
     },
+
+    {   "nativeSetBitmapPoolSize",
+        "(I)V",
+        (void*)nativeSetBitmapPoolSize
+    },
+
+    {   "nativeGetBitmapPoolStats",
+        "([I)V",
+        (void*)nativeGetBitmapPoolStats
+    },
 };
 
 static JNINativeMethod gOptionsMethods[] = {
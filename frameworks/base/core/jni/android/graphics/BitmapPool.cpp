@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BitmapPool"
+
+#include "BitmapPool.h"
+
+#include <utils/Log.h>
+
+namespace android {
+
+ANDROID_SINGLETON_STATIC_INSTANCE(BitmapPool);
+
+BitmapPool::BitmapPool() : mMaxBytes(0), mBytes(0),
+        mHits(0), mMisses(0), mReleases(0), mDrops(0) {
+}
+
+BitmapPool::~BitmapPool() {
+    // The arrays are only dropped with the VM
+}
+
+size_t BitmapPool::getPooledSize(size_t size) {
+    AutoMutex _l(mLock);
+    if (size < MIN_POOLED_SIZE || size > mMaxBytes) {
+        return 0;
+    }
+    // Round up to a quarter of the power of two below the size, so that
+    // no more than a fifth of the array is unused.
+    size_t top = size - 1;
+    int shift = 0;
+    while (top >> (shift + 1)) {
+        shift++;
+    }
+    const size_t step = size_t(1) << (shift - 2);
+    return (size + step - 1) & ~(step - 1);
+}
+
+jbyteArray BitmapPool::acquire(JNIEnv* env, size_t pooledSize) {
+    AutoMutex _l(mLock);
+    // the most recently released arrays are the most likely to be resident
+    for (size_t i = mEntries.size(); i > 0; i--) {
+        const Entry& entry = mEntries[i - 1];
+        if (entry.size == pooledSize) {
+            jbyteArray array = (jbyteArray) env->NewLocalRef(entry.array);
+            env->DeleteGlobalRef(entry.array);
+            mEntries.removeAt(i - 1);
+            mBytes -= pooledSize;
+            mHits++;
+            return array;
+        }
+    }
+    mMisses++;
+    return NULL;
+}
+
+void BitmapPool::release(JNIEnv* env, jbyteArray globalRef) {
+    const size_t size = env->GetArrayLength(globalRef);
+
+    AutoMutex _l(mLock);
+    mReleases++;
+    if (size > mMaxBytes) {
+        mDrops++;
+        env->DeleteGlobalRef(globalRef);
+        return;
+    }
+    trimLocked(env, mMaxBytes - size);
+
+    Entry entry;
+    entry.size = size;
+    entry.array = globalRef;
+    mEntries.add(entry);
+    mBytes += size;
+}
+
+void BitmapPool::setMaxBytes(JNIEnv* env, size_t maxBytes) {
+    AutoMutex _l(mLock);
+    mMaxBytes = maxBytes;
+    trimLocked(env, maxBytes);
+}
+
+void BitmapPool::trimLocked(JNIEnv* env, size_t maxBytes) {
+    while (mBytes > maxBytes && !mEntries.isEmpty()) {
+        const Entry& entry = mEntries[0];
+        mBytes -= entry.size;
+        env->DeleteGlobalRef(entry.array);
+        mEntries.removeAt(0);
+        mDrops++;
+    }
+}
+
+void BitmapPool::getStats(Stats* outStats) {
+    AutoMutex _l(mLock);
+    outStats->hits = mHits;
+    outStats->misses = mMisses;
+    outStats->releases = mReleases;
+    outStats->drops = mDrops;
+    outStats->count = mEntries.size();
+    outStats->bytes = mBytes;
+}
+
+}; // namespace android
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BITMAP_POOL_H
+#define ANDROID_BITMAP_POOL_H
+
+#include "jni.h"
+
+#include <utils/Singleton.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+/**
+ * Keeps the byte arrays of the freed decoded bitmaps, so that the next
+ * decodes reuse them instead of allocating on the Java heap.  The arrays are
+ * rounded up to size classes, four per power of two, so that bitmaps of any
+ * config and of close dimensions share them.
+ *
+ * The pool is disabled until it is given a size.  The arrays it keeps are
+ * still on the Java heap, the pool only holds JNI global refs to them.
+ */
+class BitmapPool : public Singleton<BitmapPool> {
+public:
+    struct Stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t releases;
+        uint32_t drops;
+        uint32_t count;
+        uint32_t bytes;
+    };
+
+    BitmapPool();
+    ~BitmapPool();
+
+    /**
+     * Returns the size of the array to allocate for the pixels of a bitmap of
+     * the given size, or 0 if they should not come from the pool.
+     */
+    size_t getPooledSize(size_t size);
+
+    /**
+     * Returns a local ref to an array exactly pooledSize long taken from the
+     * pool, or NULL if there is none.  The array is not cleared.
+     */
+    jbyteArray acquire(JNIEnv* env, size_t pooledSize);
+
+    /**
+     * Gives an array back to the pool, which takes over the global ref.
+     */
+    void release(JNIEnv* env, jbyteArray globalRef);
+
+    /**
+     * Sets the total size of the arrays kept, and drops the arrays over it.
+     * 0 disables the pool.
+     */
+    void setMaxBytes(JNIEnv* env, size_t maxBytes);
+
+    void getStats(Stats* outStats);
+
+private:
+    // Smaller bitmaps are cheap enough to allocate.
+    static const size_t MIN_POOLED_SIZE = 64 * 1024;
+
+    struct Entry {
+        size_t size;
+        jbyteArray array;
+    };
+
+    // Must be called with mLock held.
+    void trimLocked(JNIEnv* env, size_t maxBytes);
+
+    Mutex mLock;
+    size_t mMaxBytes;
+    size_t mBytes;
+
+    // The oldest arrays first, they are the first dropped.
+    Vector<Entry> mEntries;
+
+    uint32_t mHits;
+    uint32_t mMisses;
+    uint32_t mReleases;
+    uint32_t mDrops;
+};
+
+}; // namespace android
+
+#endif // ANDROID_BITMAP_POOL_H
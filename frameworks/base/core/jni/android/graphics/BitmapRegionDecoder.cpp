@@ -27,6 +27,7 @@
 #include "BitmapFactory.h"
 #include "AutoDecodeCancel.h"
 #include "CreateJavaOutputStreamAdaptor.h"
+#include "RegionTileCache.h"
 #include "Utils.h"
 #include "JNIHelp.h"
 
@@ -50,13 +51,19 @@ using namespace android;
 
 class SkBitmapRegionDecoder {
 public:
-    SkBitmapRegionDecoder(SkImageDecoder* decoder, int width, int height) {
+    SkBitmapRegionDecoder(SkImageDecoder* decoder, SkStreamRewindable* stream,
+                          int width, int height) {
         fDecoder = decoder;
+        fStream = stream;
+        fStream->ref();
+        fTileCache = NULL;
         fWidth = width;
         fHeight = height;
     }
     ~SkBitmapRegionDecoder() {
+        delete fTileCache;
         SkDELETE(fDecoder);
+        fStream->unref();
     }
 
     bool decodeRegion(SkBitmap* bitmap, const SkIRect& rect,
@@ -65,12 +72,35 @@ public:
         return fDecoder->decodeRegion(bitmap, rect, pref);
     }
 
+    /**
+     * Decodes the regions as tiles of tileSize pixels on up to maxThreads
+     * threads, keeping up to maxBytes of tiles.  A tileSize of 0 decodes
+     * the regions directly again.  Returns false if the tiles can't be
+     * decoded in parallel.
+     */
+    bool setTileCache(int tileSize, size_t maxBytes, int maxThreads) {
+        delete fTileCache;
+        fTileCache = NULL;
+        if (tileSize <= 0) {
+            return true;
+        }
+        if (maxThreads < 1 || !RegionTileCache::canDecode(fStream)) {
+            return false;
+        }
+        fTileCache = new RegionTileCache(fStream, fWidth, fHeight,
+                tileSize, maxBytes, maxThreads);
+        return true;
+    }
+
+    RegionTileCache* getTileCache() const { return fTileCache; }
     SkImageDecoder* getDecoder() const { return fDecoder; }
     int getWidth() const { return fWidth; }
     int getHeight() const { return fHeight; }
 
 private:
     SkImageDecoder* fDecoder;
+    SkStreamRewindable* fStream;
+    RegionTileCache* fTileCache;
     int fWidth;
     int fHeight;
 };
@@ -96,7 +126,7 @@ static jobject createBitmapRegionDecoder(JNIEnv* env, SkStreamRewindable* stream
         return nullObjectReturn("decoder->buildTileIndex returned false");
     }
 
-    SkBitmapRegionDecoder *bm = new SkBitmapRegionDecoder(decoder, width, height);
+    SkBitmapRegionDecoder *bm = new SkBitmapRegionDecoder(decoder, stream, width, height);
     return GraphicsJNI::createBitmapRegionDecoder(env, bm);
 }
 
@@ -225,7 +255,14 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, SkBitmapRegionDecoder *b
         adb.reset(bitmap);
     }
 
-    if (!brd->decodeRegion(bitmap, region, prefConfig, sampleSize)) {
+    // The tiles are only drawn into new premultiplied bitmaps
+    RegionTileCache* tileCache = brd->getTileCache();
+    if (tileCache != NULL && tileBitmap == NULL && !requireUnpremultiplied) {
+        if (!tileCache->decodeRegion(bitmap, region, prefConfig, sampleSize,
+                decoder->getAllocator())) {
+            return nullObjectReturn("tileCache->decodeRegion returned false");
+        }
+    } else if (!brd->decodeRegion(bitmap, region, prefConfig, sampleSize)) {
         return nullObjectReturn("decoder->decodeRegion returned false");
     }
 
@@ -255,6 +292,32 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, SkBitmapRegionDecoder *b
     return GraphicsJNI::createBitmap(env, bitmap, buff, bitmapCreateFlags, NULL, NULL, -1);
 }
 
+static jboolean nativeSetTileCache(JNIEnv* env, jobject, SkBitmapRegionDecoder *brd,
+                                   int tileSize, int maxBytes, int maxThreads) {
+    return brd->setTileCache(tileSize, maxBytes, maxThreads);
+}
+
+static void nativePrefetchRegion(JNIEnv* env, jobject, SkBitmapRegionDecoder *brd,
+                                 int start_x, int start_y, int width, int height,
+                                 jobject options) {
+    RegionTileCache* tileCache = brd->getTileCache();
+    if (tileCache == NULL) {
+        return;
+    }
+
+    int sampleSize = 1;
+    SkBitmap::Config prefConfig = SkBitmap::kNo_Config;
+    if (NULL != options) {
+        sampleSize = env->GetIntField(options, gOptions_sampleSizeFieldID);
+        jobject jconfig = env->GetObjectField(options, gOptions_configFieldID);
+        prefConfig = GraphicsJNI::getNativeBitmapConfig(env, jconfig);
+    }
+
+    SkIRect region;
+    region.set(start_x, start_y, start_x + width, start_y + height);
+    tileCache->prefetchRegion(region, prefConfig, sampleSize);
+}
+
 static int nativeGetHeight(JNIEnv* env, jobject, SkBitmapRegionDecoder *brd) {
     return brd->getHeight();
 }
@@ -276,6 +339,12 @@ static JNINativeMethod gBitmapRegionDecoderMethods[] = {
         "(IIIIILandroid/graphics/BitmapFactory$Options;)Landroid/graphics/Bitmap;",
         (void*)nativeDecodeRegion},
 
+    {   "nativeSetTileCache", "(IIII)Z", (void*)nativeSetTileCache},
+
+    {   "nativePrefetchRegion",
+        "(IIIIILandroid/graphics/BitmapFactory$Options;)V",
+        (void*)nativePrefetchRegion},
+
     {   "nativeGetHeight", "(I)I", (void*)nativeGetHeight},
 
     {   "nativeGetWidth", "(I)I", (void*)nativeGetWidth},
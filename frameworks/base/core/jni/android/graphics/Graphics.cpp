@@ -3,6 +3,7 @@
 #include "jni.h"
 #include "JNIHelp.h"
 #include "GraphicsJNI.h"
+#include "BitmapPool.h"
 
 #include "SkCanvas.h"
 #include "SkDevice.h"
@@ -446,6 +447,7 @@ AndroidPixelRef::AndroidPixelRef(JNIEnv* env, const SkImageInfo& info, void* sto
     }
     fStorageObj = storageObj;
     fHasGlobalRef = false;
+    fPoolObj = NULL;
     fGlobalRefCnt = 0;
 
     // If storageObj is NULL, the memory was NOT allocated on the Java heap
@@ -464,6 +466,7 @@ AndroidPixelRef::AndroidPixelRef(AndroidPixelRef& wrappedPixelRef, const SkImage
     // don't need to initialize these, as all the relevant logic delegates to the wrapped ref
     fStorageObj = NULL;
     fHasGlobalRef = false;
+    fPoolObj = NULL;
     fGlobalRefCnt = 0;
     fOnJavaHeap = false;
 }
@@ -478,6 +481,11 @@ AndroidPixelRef::~AndroidPixelRef() {
             env->DeleteGlobalRef(fStorageObj);
         }
         fStorageObj = NULL;
+
+        if (fPoolObj) {
+            BitmapPool::getInstance().release(env, fPoolObj);
+            fPoolObj = NULL;
+        }
     }
 }
 jbyteArray AndroidPixelRef::getStorageObj() {
@@ -548,12 +556,19 @@ void AndroidPixelRef::globalUnref() {
     unref();
 }
 
+void AndroidPixelRef::returnToBitmapPool(JNIEnv* env) {
+    SkASSERT(!fWrappedPixelRef && fOnJavaHeap && !fPoolObj);
+    // The Java bitmap drops its buffer when it is recycled or collected,
+    // which is also when its pixel ref is freed.
+    fPoolObj = (jbyteArray) env->NewGlobalRef(fStorageObj);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 extern "C" jbyte* jniGetNonMovableArrayElements(C_JNIEnv* env, jarray arrayObj);
 
 jbyteArray GraphicsJNI::allocateJavaPixelRef(JNIEnv* env, SkBitmap* bitmap,
-                                             SkColorTable* ctable) {
+                                             SkColorTable* ctable, bool pooled) {
     Sk64 size64 = bitmap->getSize64();
     if (size64.isNeg() || !size64.is32()) {
         jniThrowException(env, "java/lang/IllegalArgumentException",
@@ -569,13 +584,29 @@ jbyteArray GraphicsJNI::allocateJavaPixelRef(JNIEnv* env, SkBitmap* bitmap,
     }
 
     size_t size = size64.get32();
-    jbyteArray arrayObj = env->NewByteArray(size);
+    size_t pooledSize = pooled ? BitmapPool::getInstance().getPooledSize(size) : 0;
+    jbyteArray arrayObj = NULL;
+    bool reused = false;
+    if (pooledSize) {
+        arrayObj = BitmapPool::getInstance().acquire(env, pooledSize);
+        reused = arrayObj != NULL;
+    }
+    if (!arrayObj) {
+        arrayObj = env->NewByteArray(pooledSize ? pooledSize : size);
+    }
     if (arrayObj) {
         // TODO: make this work without jniGetNonMovableArrayElements
         jbyte* addr = jniGetNonMovableArrayElements(&env->functions, arrayObj);
         if (addr) {
-            SkPixelRef* pr = new AndroidPixelRef(env, bitmapInfo, (void*) addr,
+            // the decoders skip the zeroes, as new arrays are cleared
+            if (reused) {
+                memset(addr, 0, size);
+            }
+            AndroidPixelRef* pr = new AndroidPixelRef(env, bitmapInfo, (void*) addr,
                     bitmap->rowBytes(), arrayObj, ctable);
+            if (pooledSize) {
+                pr->returnToBitmapPool(env);
+            }
             bitmap->setPixelRef(pr)->unref();
             // since we're already allocated, we lockPixels right away
             // HeapAllocator behaves this way too
@@ -588,8 +619,9 @@ jbyteArray GraphicsJNI::allocateJavaPixelRef(JNIEnv* env, SkBitmap* bitmap,
 
 ///////////////////////////////////////////////////////////////////////////////
 
-JavaPixelAllocator::JavaPixelAllocator(JNIEnv* env)
-    : fStorageObj(NULL),
+JavaPixelAllocator::JavaPixelAllocator(JNIEnv* env, bool pooled)
+    : fPooled(pooled),
+      fStorageObj(NULL),
       fAllocCount(0) {
     if (env->GetJavaVM(&fVM) != JNI_OK) {
         SkDebugf("------ [%p] env->GetJavaVM failed\n", env);
@@ -600,7 +632,7 @@ JavaPixelAllocator::JavaPixelAllocator(JNIEnv* env)
 bool JavaPixelAllocator::allocPixelRef(SkBitmap* bitmap, SkColorTable* ctable) {
     JNIEnv* env = vm2env(fVM);
 
-    fStorageObj = GraphicsJNI::allocateJavaPixelRef(env, bitmap, ctable);
+    fStorageObj = GraphicsJNI::allocateJavaPixelRef(env, bitmap, ctable, fPooled);
     fAllocCount += 1;
     return fStorageObj != NULL;
 }
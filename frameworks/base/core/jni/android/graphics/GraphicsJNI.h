@@ -48,6 +48,13 @@ public:
     static SkPaint*  getNativePaint(JNIEnv*, jobject paint);
     static SkBitmap* getNativeBitmap(JNIEnv*, jobject bitmap);
     static SkPicture* getNativePicture(JNIEnv*, jobject picture);
+
+    /** Return a bitmap with the picture drawn into it, for canvases that can't
+        play pictures back. The bitmap is owned by the picture: it is reused
+        until the picture is recorded again or destroyed. Returns NULL if the
+        picture is empty, or larger than maxSize in either dimension.
+    */
+    static SkBitmap* getPictureBitmap(SkPicture* picture, int maxSize);
     static SkRegion* getNativeRegion(JNIEnv*, jobject region);
 
     /** Return the corresponding native config from the java Config enum,
@@ -77,8 +84,12 @@ public:
 
     static jobject createBitmapRegionDecoder(JNIEnv* env, SkBitmapRegionDecoder* bitmap);
 
+    /** Allocates the pixels of bitmap in a new Java byte array.  If pooled is
+        true, the array may come from BitmapPool, and it goes back to the pool
+        when the pixel ref is freed.
+    */
     static jbyteArray allocateJavaPixelRef(JNIEnv* env, SkBitmap* bitmap,
-            SkColorTable* ctable);
+            SkColorTable* ctable, bool pooled = false);
 
     /** Copy the colors in colors[] to the bitmap, convert to the correct
         format along the way.
@@ -121,6 +132,9 @@ public:
     /** Release a ref that was acquired using globalRef(). */
     virtual void globalUnref();
 
+    /** Gives the byte array to BitmapPool when this pixel ref is freed. */
+    void returnToBitmapPool(JNIEnv* env);
+
 private:
     AndroidPixelRef* const fWrappedPixelRef; // if set, delegate memory management calls to this
 
@@ -130,6 +144,8 @@ private:
     jbyteArray fStorageObj; // The Java byte[] object used as the bitmap backing store
     bool fHasGlobalRef; // If true, fStorageObj holds a JNI global ref
 
+    jbyteArray fPoolObj; // If set, a JNI global ref released to BitmapPool
+
     mutable int32_t fGlobalRefCnt;
 };
 
@@ -160,7 +176,8 @@ private:
  */
 class JavaPixelAllocator : public SkBitmap::Allocator {
 public:
-    JavaPixelAllocator(JNIEnv* env);
+    /** If pooled is true, the pixels may be taken from BitmapPool. */
+    JavaPixelAllocator(JNIEnv* env, bool pooled = false);
     // overrides
     virtual bool allocPixelRef(SkBitmap* bitmap, SkColorTable* ctable);
 
@@ -184,6 +201,7 @@ public:
 private:
     JavaVM* fVM;
     bool fAllocateInJavaHeap;
+    bool fPooled;
     jbyteArray fStorageObj;
     int fAllocCount;
 };
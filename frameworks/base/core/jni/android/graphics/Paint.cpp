@@ -600,6 +600,23 @@ public:
         return result;
     }
 
+    static void precacheTextRun___C(JNIEnv* env, jobject clazz, SkPaint* paint,
+            jcharArray text, jint index, jint count, jint contextIndex, jint contextCount,
+            jint flags) {
+        jchar* textArray = env->GetCharArrayElements(text, NULL);
+        TextLayoutEngine::getInstance().precacheValue(paint, textArray + contextIndex,
+                index - contextIndex, count, contextCount, flags);
+        env->ReleaseCharArrayElements(text, textArray, JNI_ABORT);
+    }
+
+    static void precacheTextRun__String(JNIEnv* env, jobject clazz, SkPaint* paint,
+            jstring text, jint start, jint end, jint contextStart, jint contextEnd, jint flags) {
+        const jchar* textArray = env->GetStringChars(text, NULL);
+        TextLayoutEngine::getInstance().precacheValue(paint, textArray + contextStart,
+                start - contextStart, end - start, contextEnd - contextStart, flags);
+        env->ReleaseStringChars(text, textArray);
+    }
+
     static jint doTextRunCursor(JNIEnv *env, SkPaint* paint, const jchar *text, jint start,
             jint count, jint flags, jint offset, jint opt) {
         jfloat scalarArray[count];
@@ -859,6 +876,9 @@ static JNINativeMethod methods[] = {
         (void*) SkPaintGlue::getTextRunAdvances___CIIIII_FI},
     {"native_getTextRunAdvances","(ILjava/lang/String;IIIII[FI)F",
         (void*) SkPaintGlue::getTextRunAdvances__StringIIIII_FI},
+    {"native_precacheTextRun","(I[CIIIII)V", (void*) SkPaintGlue::precacheTextRun___C},
+    {"native_precacheTextRun","(ILjava/lang/String;IIIII)V",
+        (void*) SkPaintGlue::precacheTextRun__String},
 
 
     {"native_getTextGlyphs","(ILjava/lang/String;IIIII[C)I",
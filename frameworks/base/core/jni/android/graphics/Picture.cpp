@@ -24,8 +24,38 @@
 #include "SkTemplates.h"
 #include "CreateJavaOutputStreamAdaptor.h"
 
+#include <utils/KeyedVector.h>
+#include <utils/threads.h>
+
+#include <Caches.h>
+
 namespace android {
 
+// Bitmaps of the pictures drawn with GraphicsJNI::getPictureBitmap()
+static Mutex gPictureBitmapsLock;
+static DefaultKeyedVector<SkPicture*, SkBitmap*> gPictureBitmaps(NULL);
+
+static void releasePictureBitmap(SkPicture* picture) {
+    SkBitmap* bitmap;
+    {
+        Mutex::Autolock _l(gPictureBitmapsLock);
+        ssize_t index = gPictureBitmaps.indexOfKey(picture);
+        if (index < 0) {
+            return;
+        }
+        bitmap = gPictureBitmaps.valueAt(index);
+        gPictureBitmaps.removeItemsAt(index);
+    }
+#ifdef USE_OPENGL_RENDERER
+    // display lists may still draw the bitmap
+    if (android::uirenderer::Caches::hasInstance()) {
+        android::uirenderer::Caches::getInstance().resourceCache.destructor(bitmap);
+        return;
+    }
+#endif // USE_OPENGL_RENDERER
+    delete bitmap;
+}
+
 class SkPictureGlue {
 public:
     static SkPicture* newPicture(JNIEnv* env, jobject, const SkPicture* src) {
@@ -49,6 +79,7 @@ public:
     
     static void killPicture(JNIEnv* env, jobject, SkPicture* picture) {
         SkASSERT(picture);
+        releasePictureBitmap(picture);
         picture->unref();
     }
     
@@ -83,6 +114,7 @@ public:
     
     static SkCanvas* beginRecording(JNIEnv* env, jobject, SkPicture* pict,
                                     int w, int h) {
+        releasePictureBitmap(pict);
         // beginRecording does not ref its return value, it just returns it.
         SkCanvas* canvas = pict->beginRecording(w, h);
         // the java side will wrap this guy in a Canvas.java, which will call
@@ -94,6 +126,8 @@ public:
     
     static void endRecording(JNIEnv* env, jobject, SkPicture* pict) {
         pict->endRecording();
+        // the picture may have been drawn while being recorded
+        releasePictureBitmap(pict);
     }
 };
 
@@ -126,4 +160,31 @@ int register_android_graphics_Picture(JNIEnv* env) {
     
 }
 
+using namespace android;
 
+SkBitmap* GraphicsJNI::getPictureBitmap(SkPicture* picture, int maxSize) {
+    Mutex::Autolock _l(gPictureBitmapsLock);
+    SkBitmap* bitmap = gPictureBitmaps.valueFor(picture);
+    if (bitmap) {
+        return bitmap;
+    }
+
+    const int width = picture->width();
+    const int height = picture->height();
+    if (width <= 0 || height <= 0 || width > maxSize || height > maxSize) {
+        return NULL;
+    }
+
+    bitmap = new SkBitmap;
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, width, height);
+    if (!bitmap->allocPixels()) {
+        delete bitmap;
+        return NULL;
+    }
+    bitmap->eraseColor(0);
+    SkCanvas canvas(*bitmap);
+    picture->draw(&canvas);
+
+    gPictureBitmaps.add(picture, bitmap);
+    return bitmap;
+}
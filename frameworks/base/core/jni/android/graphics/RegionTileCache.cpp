@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RegionTileCache"
+
+#include "RegionTileCache.h"
+
+#include "SkCanvas.h"
+#include "SkImageDecoder.h"
+#include "SkStream.h"
+
+#include <utils/Log.h>
+
+namespace android {
+
+RegionTileCache::RegionTileCache(SkStreamRewindable* stream, int width, int height,
+        int tileSize, size_t maxBytes, int maxThreads) :
+        mStream(stream), mWidth(width), mHeight(height), mTileSize(tileSize),
+        mMaxBytes(maxBytes), mMaxThreads(maxThreads), mExiting(false),
+        mCache(LruCache<RegionTileKey, sp<RegionTile> >::kUnlimitedCapacity),
+        mBytes(0) {
+    mStream->ref();
+    mCache.setOnEntryRemovedListener(this);
+}
+
+RegionTileCache::~RegionTileCache() {
+    {
+        AutoMutex _l(mLock);
+        mExiting = true;
+        mPending.clear();
+        mWorkCondition.broadcast();
+    }
+    for (size_t i = 0; i < mThreads.size(); i++) {
+        mThreads[i]->requestExitAndWait();
+    }
+    mThreads.clear();
+    mCache.clear();
+    mStream->unref();
+}
+
+bool RegionTileCache::canDecode(SkStreamRewindable* stream) {
+    return stream->getMemoryBase() != NULL;
+}
+
+void RegionTileCache::operator()(RegionTileKey& key, sp<RegionTile>& tile) {
+    mBytes -= tile->getSize();
+}
+
+SkIRect RegionTileCache::getTileRect(const RegionTileKey& key) const {
+    const int span = mTileSize * key.sampleSize;
+    SkIRect rect;
+    rect.set(key.x * span, key.y * span,
+            SkMin32((key.x + 1) * span, mWidth), SkMin32((key.y + 1) * span, mHeight));
+    return rect;
+}
+
+// The columns and rows of the tiles covering a region of the image, as a
+// rectangle whose right and bottom are excluded.
+void RegionTileCache::getTileRange(const SkIRect& region, int sampleSize,
+        SkIRect* outRange) const {
+    const int span = mTileSize * sampleSize;
+    outRange->set(region.fLeft / span, region.fTop / span,
+            (region.fRight - 1) / span + 1, (region.fBottom - 1) / span + 1);
+}
+
+void RegionTileCache::scheduleLocked(const RegionTileKey& key, bool urgent) {
+    if (mScheduled.indexOf(key) >= 0) {
+        if (urgent) {
+            // move a prefetched tile ahead of the others
+            for (size_t i = 0; i < mPending.size(); i++) {
+                if (mPending[i] == key) {
+                    mPending.removeAt(i);
+                    mPending.insertAt(key, 0);
+                    break;
+                }
+            }
+        }
+        return;
+    }
+
+    mScheduled.add(key);
+    if (urgent) {
+        mPending.insertAt(key, 0);
+    } else {
+        mPending.add(key);
+    }
+    mWorkCondition.signal();
+
+    if (mThreads.size() < size_t(mMaxThreads) && mThreads.size() < mScheduled.size()) {
+        sp<DecodeThread> thread = new DecodeThread(this);
+        if (thread->run("RegionTileDecoder", PRIORITY_DEFAULT) == NO_ERROR) {
+            mThreads.add(thread);
+        } else {
+            ALOGW("Failed to start a tile decoding thread");
+        }
+    }
+}
+
+bool RegionTileCache::waitForKey(RegionTileKey* outKey) {
+    AutoMutex _l(mLock);
+    while (!mExiting && mPending.isEmpty()) {
+        mWorkCondition.wait(mLock);
+    }
+    if (mExiting) {
+        return false;
+    }
+    *outKey = mPending[0];
+    mPending.removeAt(0);
+    return true;
+}
+
+void RegionTileCache::finishTile(const RegionTileKey& key, const sp<RegionTile>& tile) {
+    AutoMutex _l(mLock);
+    mScheduled.remove(key);
+
+    for (size_t i = 0; i < mRequests.size(); i++) {
+        TileRequest* request = mRequests[i];
+        for (size_t j = 0; j < request->keys.size(); j++) {
+            if (request->keys[j] == key && request->tiles[j] == NULL) {
+                request->tiles.editItemAt(j) = tile;
+                request->remaining--;
+            }
+        }
+    }
+
+    // Don't bother to add the tile if it is too big
+    const size_t size = tile->getSize();
+    if (size <= mMaxBytes) {
+        while (mBytes + size > mMaxBytes && mCache.removeOldest()) {
+            // This calls operator()
+        }
+        mBytes += size;
+        mCache.put(key, tile);
+    }
+    mDoneCondition.broadcast();
+}
+
+bool RegionTileCache::decodeRegion(SkBitmap* bitmap, const SkIRect& region,
+        SkBitmap::Config pref, int sampleSize, SkBitmap::Allocator* allocator) {
+    // like the decoders, take sample sizes below 1 as 1
+    sampleSize = SkMax32(sampleSize, 1);
+    SkIRect clipped = region;
+    if (!clipped.intersect(0, 0, mWidth, mHeight)) {
+        return false;
+    }
+    SkIRect range;
+    getTileRange(clipped, sampleSize, &range);
+
+    TileRequest request;
+    request.remaining = 0;
+    {
+        AutoMutex _l(mLock);
+        for (int y = range.fTop; y < range.fBottom; y++) {
+            for (int x = range.fLeft; x < range.fRight; x++) {
+                RegionTileKey key;
+                key.sampleSize = sampleSize;
+                key.config = pref;
+                key.x = x;
+                key.y = y;
+                sp<RegionTile> tile = mCache.get(key);
+                if (tile == NULL) {
+                    scheduleLocked(key, true /*urgent*/);
+                    request.remaining++;
+                }
+                request.keys.add(key);
+                request.tiles.add(tile);
+            }
+        }
+
+        if (request.remaining > 0 && mThreads.isEmpty()) {
+            return false;
+        }
+        if (request.remaining > 0) {
+            mRequests.add(&request);
+            while (request.remaining > 0) {
+                mDoneCondition.wait(mLock);
+            }
+            for (size_t i = 0; i < mRequests.size(); i++) {
+                if (mRequests[i] == &request) {
+                    mRequests.removeAt(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < request.tiles.size(); i++) {
+        if (!request.tiles[i]->decoded) {
+            return false;
+        }
+    }
+
+    // Palettes can't be drawn into, so these tiles are drawn in 8888
+    SkBitmap::Config config = request.tiles[0]->bitmap.config();
+    if (config == SkBitmap::kIndex8_Config) {
+        config = SkBitmap::kARGB_8888_Config;
+    }
+    bitmap->setConfig(config, SkMax32(1, clipped.width() / sampleSize),
+            SkMax32(1, clipped.height() / sampleSize));
+    if (!bitmap->allocPixels(allocator, NULL)) {
+        return false;
+    }
+    bitmap->eraseColor(0);
+
+    SkCanvas canvas(*bitmap);
+    for (size_t i = 0; i < request.tiles.size(); i++) {
+        SkIRect rect = getTileRect(request.keys[i]);
+        canvas.drawBitmap(request.tiles[i]->bitmap,
+                SkIntToScalar(rect.fLeft - clipped.fLeft) / sampleSize,
+                SkIntToScalar(rect.fTop - clipped.fTop) / sampleSize);
+    }
+    return true;
+}
+
+void RegionTileCache::prefetchRegion(const SkIRect& region, SkBitmap::Config pref,
+        int sampleSize) {
+    // like the decoders, take sample sizes below 1 as 1
+    sampleSize = SkMax32(sampleSize, 1);
+    SkIRect clipped = region;
+    if (!clipped.intersect(0, 0, mWidth, mHeight)) {
+        return;
+    }
+    SkIRect range;
+    getTileRange(clipped, sampleSize, &range);
+
+    // the tiles around the region are next when panning
+    const int span = mTileSize * sampleSize;
+    range.fLeft = SkMax32(range.fLeft - 1, 0);
+    range.fTop = SkMax32(range.fTop - 1, 0);
+    range.fRight = SkMin32(range.fRight + 1, (mWidth + span - 1) / span);
+    range.fBottom = SkMin32(range.fBottom + 1, (mHeight + span - 1) / span);
+
+    AutoMutex _l(mLock);
+    for (int y = range.fTop; y < range.fBottom; y++) {
+        for (int x = range.fLeft; x < range.fRight; x++) {
+            if (mPending.size() >= MAX_PENDING_PREFETCHES) {
+                return;
+            }
+            RegionTileKey key;
+            key.sampleSize = sampleSize;
+            key.config = pref;
+            key.x = x;
+            key.y = y;
+            if (mCache.get(key) == NULL) {
+                scheduleLocked(key, false /*urgent*/);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RegionTileCache::DecodeThread::DecodeThread(RegionTileCache* cache) :
+        Thread(false /*canCallJava*/), mCache(cache), mDecoder(NULL), mDecoderFailed(false) {
+}
+
+RegionTileCache::DecodeThread::~DecodeThread() {
+    SkDELETE(mDecoder);
+}
+
+bool RegionTileCache::DecodeThread::threadLoop() {
+    RegionTileKey key;
+    if (!mCache->waitForKey(&key)) {
+        return false;
+    }
+    sp<RegionTile> tile = decodeTile(key);
+    mCache->finishTile(key, tile);
+    return true;
+}
+
+sp<RegionTile> RegionTileCache::DecodeThread::decodeTile(const RegionTileKey& key) {
+    if (mDecoder == NULL && !mDecoderFailed) {
+        // The data stays owned by the stream of the cache
+        SkStreamRewindable* stream = new SkMemoryStream(mCache->mStream->getMemoryBase(),
+                mCache->mStream->getLength(), false /*copyData*/);
+        mDecoder = SkImageDecoder::Factory(stream);
+        int width, height;
+        if (mDecoder == NULL || !mDecoder->buildTileIndex(stream, &width, &height)) {
+            ALOGW("Failed to build the tile index of a decoding thread");
+            SkDELETE(mDecoder);
+            mDecoder = NULL;
+            mDecoderFailed = true;
+        }
+        stream->unref(); // the decoder now holds a reference
+    }
+
+    sp<RegionTile> tile = new RegionTile();
+    if (mDecoder != NULL) {
+        mDecoder->setSampleSize(key.sampleSize);
+        tile->decoded = mDecoder->decodeRegion(&tile->bitmap, mCache->getTileRect(key),
+                SkBitmap::Config(key.config));
+    }
+    return tile;
+}
+
+}; // namespace android
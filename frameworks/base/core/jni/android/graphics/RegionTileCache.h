@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_REGION_TILE_CACHE_H
+#define ANDROID_REGION_TILE_CACHE_H
+
+#include <utils/JenkinsHash.h>
+#include <utils/LruCache.h>
+#include <utils/RefBase.h>
+#include <utils/SortedVector.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "SkBitmap.h"
+#include "SkRect.h"
+
+class SkImageDecoder;
+class SkStreamRewindable;
+
+namespace android {
+
+/**
+ * Identifies a tile: its column and row in the grid of a sample size, and the
+ * preferred config it was decoded with.
+ */
+struct RegionTileKey {
+    int32_t sampleSize;
+    int32_t config;
+    int32_t x;
+    int32_t y;
+
+    hash_t hash() const {
+        uint32_t hash = JenkinsHashMix(0, sampleSize);
+        hash = JenkinsHashMix(hash, config);
+        hash = JenkinsHashMix(hash, x);
+        hash = JenkinsHashMix(hash, y);
+        return JenkinsHashWhiten(hash);
+    }
+
+    static int compare(const RegionTileKey& lhs, const RegionTileKey& rhs) {
+        int deltaInt = lhs.sampleSize - rhs.sampleSize;
+        if (deltaInt != 0) return deltaInt;
+        deltaInt = lhs.config - rhs.config;
+        if (deltaInt != 0) return deltaInt;
+        deltaInt = lhs.y - rhs.y;
+        if (deltaInt != 0) return deltaInt;
+        return lhs.x - rhs.x;
+    }
+
+    bool operator==(const RegionTileKey& other) const { return compare(*this, other) == 0; }
+    bool operator!=(const RegionTileKey& other) const { return compare(*this, other) != 0; }
+    bool operator<(const RegionTileKey& other) const { return compare(*this, other) < 0; }
+};
+
+inline int strictly_order_type(const RegionTileKey& lhs, const RegionTileKey& rhs) {
+    return RegionTileKey::compare(lhs, rhs) < 0;
+}
+
+inline int compare_type(const RegionTileKey& lhs, const RegionTileKey& rhs) {
+    return RegionTileKey::compare(lhs, rhs);
+}
+
+inline hash_t hash_type(const RegionTileKey& key) {
+    return key.hash();
+}
+
+/**
+ * A decoded tile.  A tile that failed to decode is cached too, so that it
+ * is not decoded again for every region.
+ */
+class RegionTile : public LightRefBase<RegionTile> {
+public:
+    RegionTile() : decoded(false) { }
+
+    SkBitmap bitmap;
+    bool decoded;
+
+    size_t getSize() const { return sizeof(RegionTile) + bitmap.getSize(); }
+};
+
+/**
+ * Decodes the regions of a large image as square tiles, on a pool of threads,
+ * and keeps the recently used tiles in a cache bounded in bytes.  The tiles of
+ * each sample size are aligned on their own grid, so that panning at a zoom
+ * level reuses them.
+ *
+ * A tile index can only be used by one thread at a time, so each thread
+ * builds its own decoder over the encoded data, which must be in memory.
+ */
+class RegionTileCache : private OnEntryRemoved<RegionTileKey, sp<RegionTile> > {
+public:
+    /**
+     * Tiles are tileSize pixels wide once sampled.  The stream is kept
+     * referenced while the cache exists.
+     */
+    RegionTileCache(SkStreamRewindable* stream, int width, int height,
+            int tileSize, size_t maxBytes, int maxThreads);
+    ~RegionTileCache();
+
+    /**
+     * Returns true if the tiles of the image in the stream can be decoded
+     * by several threads.
+     */
+    static bool canDecode(SkStreamRewindable* stream);
+
+    /**
+     * Decodes a region from its tiles into bitmap, whose pixels are allocated
+     * with allocator.  The missing tiles are decoded in parallel, the call
+     * returns once they are all there.
+     */
+    bool decodeRegion(SkBitmap* bitmap, const SkIRect& region, SkBitmap::Config pref,
+            int sampleSize, SkBitmap::Allocator* allocator);
+
+    /**
+     * Schedules the tiles of a region and the tiles around it which are not
+     * cached yet, and returns without waiting for them.
+     */
+    void prefetchRegion(const SkIRect& region, SkBitmap::Config pref, int sampleSize);
+
+    /**
+     * Used as a callback when an entry is removed from the cache
+     * Do not invoke directly
+     */
+    void operator()(RegionTileKey& key, sp<RegionTile>& tile);
+
+private:
+    // Prefetches don't make the queue longer than this.
+    static const size_t MAX_PENDING_PREFETCHES = 32;
+
+    class DecodeThread : public Thread {
+    public:
+        DecodeThread(RegionTileCache* cache);
+        virtual ~DecodeThread();
+
+    private:
+        virtual bool threadLoop();
+
+        sp<RegionTile> decodeTile(const RegionTileKey& key);
+
+        RegionTileCache* mCache;
+        SkImageDecoder* mDecoder;
+        bool mDecoderFailed;
+    };
+
+    // The tiles a decodeRegion() call waits for.
+    struct TileRequest {
+        Vector<RegionTileKey> keys;
+        Vector<sp<RegionTile> > tiles;
+        size_t remaining;
+    };
+
+    SkIRect getTileRect(const RegionTileKey& key) const;
+    void getTileRange(const SkIRect& region, int sampleSize, SkIRect* outRange) const;
+
+    // Must be called with mLock held.
+    void scheduleLocked(const RegionTileKey& key, bool urgent);
+    bool waitForKey(RegionTileKey* outKey);
+    void finishTile(const RegionTileKey& key, const sp<RegionTile>& tile);
+
+    SkStreamRewindable* mStream;
+    const int mWidth;
+    const int mHeight;
+    const int mTileSize;
+    const size_t mMaxBytes;
+    const int mMaxThreads;
+
+    Mutex mLock;
+    Condition mWorkCondition;
+    Condition mDoneCondition;
+    bool mExiting;
+
+    // Decoded tiles, and the total size of their pixels.
+    LruCache<RegionTileKey, sp<RegionTile> > mCache;
+    size_t mBytes;
+
+    // Tiles waiting for a thread, the urgent ones first, and the tiles
+    // being decoded or waiting.
+    Vector<RegionTileKey> mPending;
+    SortedVector<RegionTileKey> mScheduled;
+
+    // The decodeRegion() calls waiting for tiles.  Finished tiles are given
+    // to them directly, as the cache may not keep them.
+    Vector<TileRequest*> mRequests;
+
+    Vector<sp<DecodeThread> > mThreads;
+};
+
+}; // namespace android
+
+#endif // ANDROID_REGION_TILE_CACHE_H
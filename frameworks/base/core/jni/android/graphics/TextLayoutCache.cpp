@@ -35,25 +35,37 @@ ANDROID_SINGLETON_STATIC_INSTANCE(TextLayoutEngine);
 
 //--------------------------------------------------------------------------------------------------
 
-TextLayoutCache::TextLayoutCache(TextLayoutShaper* shaper) :
-        mShaper(shaper),
-        mCache(LruCache<TextLayoutCacheKey, sp<TextLayoutValue> >::kUnlimitedCapacity),
-        mSize(0), mMaxSize(MB(DEFAULT_TEXT_LAYOUT_CACHE_SIZE_IN_MB)),
-        mCacheHitCount(0), mNanosecondsSaved(0) {
+TextLayoutCache::TextLayoutCache(TextLayoutShaperPool* shaperPool) :
+        mShaperPool(shaperPool),
+        mMaxSize(MB(DEFAULT_TEXT_LAYOUT_CACHE_SIZE_IN_MB)),
+        mCacheHitCount(0), mNanosecondsSaved(0), mExiting(false) {
     init();
 }
 
 TextLayoutCache::~TextLayoutCache() {
-    mCache.clear();
+    {
+        AutoMutex _l(mPrecacheLock);
+        mExiting = true;
+        mPrecacheRequests.clear();
+        mPrecacheCondition.signal();
+    }
+    if (mPrecacheThread != NULL) {
+        mPrecacheThread->requestExitAndWait();
+    }
+    for (size_t i = 0; i < TEXT_LAYOUT_CACHE_SHARD_COUNT; i++) {
+        mShards[i].mCache.clear();
+    }
 }
 
 void TextLayoutCache::init() {
-    mCache.setOnEntryRemovedListener(this);
-
     mDebugLevel = readRtlDebugLevel();
     mDebugEnabled = mDebugLevel & kRtlDebugCaches;
     ALOGD("Using debug level = %d - Debug Enabled = %d", mDebugLevel, mDebugEnabled);
 
+    for (size_t i = 0; i < TEXT_LAYOUT_CACHE_SHARD_COUNT; i++) {
+        mShards[i].mDebugEnabled = mDebugEnabled;
+    }
+
     mCacheStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
     if (mDebugEnabled) {
@@ -63,10 +75,16 @@ void TextLayoutCache::init() {
     mInitialized = true;
 }
 
+TextLayoutCache::Shard::Shard() :
+        mCache(LruCache<TextLayoutCacheKey, sp<TextLayoutValue> >::kUnlimitedCapacity),
+        mSize(0), mDebugEnabled(false) {
+    mCache.setOnEntryRemovedListener(this);
+}
+
 /**
  *  Callbacks
  */
-void TextLayoutCache::operator()(TextLayoutCacheKey& text, sp<TextLayoutValue>& desc) {
+void TextLayoutCache::Shard::operator()(TextLayoutCacheKey& text, sp<TextLayoutValue>& desc) {
     size_t totalSizeToDelete = text.getSize() + desc->getSize();
     mSize -= totalSizeToDelete;
     if (mDebugEnabled) {
@@ -74,13 +92,19 @@ void TextLayoutCache::operator()(TextLayoutCacheKey& text, sp<TextLayoutValue>&
     }
 }
 
+TextLayoutCache::Shard& TextLayoutCache::getShard(const TextLayoutCacheKey& key) {
+    return mShards[key.hash() % TEXT_LAYOUT_CACHE_SHARD_COUNT];
+}
+
 /*
  * Cache clearing
  */
 void TextLayoutCache::purgeCaches() {
-    AutoMutex _l(mLock);
-    mCache.clear();
-    mShaper->purgeCaches();
+    for (size_t i = 0; i < TEXT_LAYOUT_CACHE_SHARD_COUNT; i++) {
+        AutoMutex _l(mShards[i].mLock);
+        mShards[i].mCache.clear();
+    }
+    mShaperPool->purgeCaches();
 }
 
 /*
@@ -88,7 +112,6 @@ void TextLayoutCache::purgeCaches() {
  */
 sp<TextLayoutValue> TextLayoutCache::getValue(const SkPaint* paint,
             const jchar* text, jint start, jint count, jint contextCount, jint dirFlags) {
-    AutoMutex _l(mLock);
     nsecs_t startTime = 0;
     if (mDebugEnabled) {
         startTime = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -96,109 +119,225 @@ sp<TextLayoutValue> TextLayoutCache::getValue(const SkPaint* paint,
 
     // Create the key
     TextLayoutCacheKey key(paint, text, start, count, contextCount, dirFlags);
+    Shard& shard = getShard(key);
 
-    // Get value from cache if possible
-    sp<TextLayoutValue> value = mCache.get(key);
-
-    // Value not found for the key, we need to add a new value in the cache
-    if (value == NULL) {
-        if (mDebugEnabled) {
-            startTime = systemTime(SYSTEM_TIME_MONOTONIC);
-        }
-
-        value = new TextLayoutValue(contextCount);
-
-        // Compute advances and store them
-        mShaper->computeValues(value.get(), paint,
-                reinterpret_cast<const UChar*>(key.getText()), start, count,
-                size_t(contextCount), int(dirFlags));
-
-        if (mDebugEnabled) {
-            value->setElapsedTime(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
-        }
-
-        // Don't bother to add in the cache if the entry is too big
-        size_t size = key.getSize() + value->getSize();
-        if (size <= mMaxSize) {
-            // Cleanup to make some room if needed
-            if (mSize + size > mMaxSize) {
-                if (mDebugEnabled) {
-                    ALOGD("Need to clean some entries for making some room for a new entry");
-                }
-                while (mSize + size > mMaxSize) {
-                    // This will call the callback
-                    bool removedOne = mCache.removeOldest();
-                    LOG_ALWAYS_FATAL_IF(!removedOne, "The cache is non-empty but we "
-                            "failed to remove the oldest entry.  "
-                            "mSize = %u, size = %u, mMaxSize = %u, mCache.size() = %u",
-                            mSize, size, mMaxSize, mCache.size());
+    sp<TextLayoutValue> value;
+    bool needShaping = false;
+    {
+        AutoMutex _l(shard.mLock);
+
+        // Get value from cache if possible
+        value = shard.mCache.get(key);
+
+        if (value == NULL) {
+            ssize_t index = shard.mInFlight.indexOfKey(key);
+            if (index >= 0) {
+                // Another thread is shaping the same text, wait for its value
+                value = shard.mInFlight.valueAt(index);
+                while ((index = shard.mInFlight.indexOfKey(key)) >= 0 &&
+                        shard.mInFlight.valueAt(index) == value) {
+                    shard.mShapedCondition.wait(shard.mLock);
                 }
+                return value;
             }
 
-            // Update current cache size
-            mSize += size;
-
-            bool putOne = mCache.put(key, value);
-            LOG_ALWAYS_FATAL_IF(!putOne, "Failed to put an entry into the cache.  "
-                    "This indicates that the cache already has an entry with the "
-                    "same key but it should not since we checked earlier!"
-                    " - start = %d, count = %d, contextCount = %d - Text = '%s'",
-                    start, count, contextCount, String8(key.getText() + start, count).string());
-
-            if (mDebugEnabled) {
-                nsecs_t totalTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
-                ALOGD("CACHE MISS: Added entry %p "
-                        "with start = %d, count = %d, contextCount = %d, "
-                        "entry size %d bytes, remaining space %d bytes"
-                        " - Compute time %0.6f ms - Put time %0.6f ms - Text = '%s'",
-                        value.get(), start, count, contextCount, size, mMaxSize - mSize,
-                        value->getElapsedTime() * 0.000001f,
-                        (totalTime - value->getElapsedTime()) * 0.000001f,
-                        String8(key.getText() + start, count).string());
-            }
-        } else {
-            if (mDebugEnabled) {
-                ALOGD("CACHE MISS: Calculated but not storing entry because it is too big "
-                        "with start = %d, count = %d, contextCount = %d, "
-                        "entry size %d bytes, remaining space %d bytes"
-                        " - Compute time %0.6f ms - Text = '%s'",
-                        start, count, contextCount, size, mMaxSize - mSize,
-                        value->getElapsedTime() * 0.000001f,
-                        String8(key.getText() + start, count).string());
-            }
+            // Value not found for the key, we need to add a new value in the cache.
+            // Until then, other threads asking for it wait for this one
+            value = new TextLayoutValue(contextCount);
+            shard.mInFlight.add(key, value);
+            needShaping = true;
         }
-    } else {
+    }
+
+    if (!needShaping) {
         // This is a cache hit, just log timestamp and user infos
         if (mDebugEnabled) {
             nsecs_t elapsedTimeThruCacheGet = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
-            mNanosecondsSaved += (value->getElapsedTime() - elapsedTimeThruCacheGet);
-            ++mCacheHitCount;
+            bool dumpStats;
+            {
+                AutoMutex _l(mStatsLock);
+                mNanosecondsSaved += (value->getElapsedTime() - elapsedTimeThruCacheGet);
+                ++mCacheHitCount;
+                dumpStats = mCacheHitCount % DEFAULT_DUMP_STATS_CACHE_HIT_INTERVAL == 0;
+            }
 
             if (value->getElapsedTime() > 0) {
                 float deltaPercent = 100 * ((value->getElapsedTime() - elapsedTimeThruCacheGet)
                         / ((float)value->getElapsedTime()));
-                ALOGD("CACHE HIT #%d with start = %d, count = %d, contextCount = %d"
+                ALOGD("CACHE HIT with start = %d, count = %d, contextCount = %d"
                         "- Compute time %0.6f ms - "
                         "Cache get time %0.6f ms - Gain in percent: %2.2f - Text = '%s'",
-                        mCacheHitCount, start, count, contextCount,
+                        start, count, contextCount,
                         value->getElapsedTime() * 0.000001f,
                         elapsedTimeThruCacheGet * 0.000001f,
                         deltaPercent,
                         String8(key.getText() + start, count).string());
             }
-            if (mCacheHitCount % DEFAULT_DUMP_STATS_CACHE_HIT_INTERVAL == 0) {
+            if (dumpStats) {
                 dumpCacheStats();
             }
         }
+        return value;
+    }
+
+    if (mDebugEnabled) {
+        startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+
+    // Compute advances and store them
+    TextLayoutShaper* shaper = mShaperPool->acquire();
+    shaper->computeValues(value.get(), paint,
+            reinterpret_cast<const UChar*>(key.getText()), start, count,
+            size_t(contextCount), int(dirFlags));
+    mShaperPool->release(shaper);
+
+    if (mDebugEnabled) {
+        value->setElapsedTime(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
+    }
+
+    AutoMutex _l(shard.mLock);
+    shard.mInFlight.removeItem(key);
+    shard.mShapedCondition.broadcast();
+
+    // Don't bother to add in the cache if the entry is too big
+    const uint32_t maxSize = mMaxSize / TEXT_LAYOUT_CACHE_SHARD_COUNT;
+    size_t size = key.getSize() + value->getSize();
+    if (size <= maxSize) {
+        // Cleanup to make some room if needed
+        if (shard.mSize + size > maxSize) {
+            if (mDebugEnabled) {
+                ALOGD("Need to clean some entries for making some room for a new entry");
+            }
+            while (shard.mSize + size > maxSize) {
+                // This will call the callback
+                bool removedOne = shard.mCache.removeOldest();
+                LOG_ALWAYS_FATAL_IF(!removedOne, "The cache is non-empty but we "
+                        "failed to remove the oldest entry.  "
+                        "mSize = %u, size = %u, maxSize = %u, mCache.size() = %u",
+                        shard.mSize, size, maxSize, shard.mCache.size());
+            }
+        }
+
+        // Update current cache size
+        shard.mSize += size;
+
+        bool putOne = shard.mCache.put(key, value);
+        LOG_ALWAYS_FATAL_IF(!putOne, "Failed to put an entry into the cache.  "
+                "This indicates that the cache already has an entry with the "
+                "same key but it should not since we checked earlier!"
+                " - start = %d, count = %d, contextCount = %d - Text = '%s'",
+                start, count, contextCount, String8(key.getText() + start, count).string());
+
+        if (mDebugEnabled) {
+            nsecs_t totalTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+            ALOGD("CACHE MISS: Added entry %p "
+                    "with start = %d, count = %d, contextCount = %d, "
+                    "entry size %d bytes, remaining space %d bytes"
+                    " - Compute time %0.6f ms - Put time %0.6f ms - Text = '%s'",
+                    value.get(), start, count, contextCount, size, maxSize - shard.mSize,
+                    value->getElapsedTime() * 0.000001f,
+                    (totalTime - value->getElapsedTime()) * 0.000001f,
+                    String8(key.getText() + start, count).string());
+        }
+    } else {
+        if (mDebugEnabled) {
+            ALOGD("CACHE MISS: Calculated but not storing entry because it is too big "
+                    "with start = %d, count = %d, contextCount = %d, "
+                    "entry size %d bytes, remaining space %d bytes"
+                    " - Compute time %0.6f ms - Text = '%s'",
+                    start, count, contextCount, size, maxSize - shard.mSize,
+                    value->getElapsedTime() * 0.000001f,
+                    String8(key.getText() + start, count).string());
+        }
     }
     return value;
 }
 
+bool TextLayoutCache::isCachedOrInFlight(const TextLayoutCacheKey& key) {
+    Shard& shard = getShard(key);
+    AutoMutex _l(shard.mLock);
+    return shard.mCache.get(key) != NULL || shard.mInFlight.indexOfKey(key) >= 0;
+}
+
+/*
+ * Precaching
+ */
+void TextLayoutCache::precacheValue(const SkPaint* paint, const jchar* text, jint start,
+        jint count, jint contextCount, jint dirFlags) {
+    TextLayoutCacheKey key(paint, text, start, count, contextCount, dirFlags);
+    if (isCachedOrInFlight(key)) {
+        return;
+    }
+
+    AutoMutex _l(mPrecacheLock);
+    if (mExiting || mPrecacheRequests.size() >= MAX_PENDING_PRECACHE_COUNT) {
+        return;
+    }
+    PrecacheRequest request;
+    request.paint = *paint;
+    request.text.setTo(reinterpret_cast<const char16_t*>(text), contextCount);
+    request.start = start;
+    request.count = count;
+    request.dirFlags = dirFlags;
+    mPrecacheRequests.add(request);
+    mPrecacheCondition.signal();
+
+    if (mPrecacheThread == NULL) {
+        sp<PrecacheThread> thread = new PrecacheThread(this);
+        if (thread->run("TextLayoutPrecache", PRIORITY_BACKGROUND) == NO_ERROR) {
+            mPrecacheThread = thread;
+        } else {
+            ALOGW("Failed to start the text layout precache thread");
+            mPrecacheRequests.clear();
+        }
+    }
+}
+
+bool TextLayoutCache::waitForPrecacheRequest(PrecacheRequest* outRequest) {
+    AutoMutex _l(mPrecacheLock);
+    while (!mExiting && mPrecacheRequests.isEmpty()) {
+        mPrecacheCondition.wait(mPrecacheLock);
+    }
+    if (mExiting) {
+        return false;
+    }
+    *outRequest = mPrecacheRequests[0];
+    mPrecacheRequests.removeAt(0);
+    return true;
+}
+
+TextLayoutCache::PrecacheThread::PrecacheThread(TextLayoutCache* cache) :
+        Thread(false /*canCallJava*/), mCache(cache) {
+}
+
+bool TextLayoutCache::PrecacheThread::threadLoop() {
+    PrecacheRequest request;
+    if (!mCache->waitForPrecacheRequest(&request)) {
+        return false;
+    }
+    mCache->getValue(&request.paint, reinterpret_cast<const jchar*>(request.text.string()),
+            request.start, request.count, request.text.size(), request.dirFlags);
+    return true;
+}
+
 void TextLayoutCache::dumpCacheStats() {
-    float remainingPercent = 100 * ((mMaxSize - mSize) / ((float)mMaxSize));
-    float timeRunningInSec = (systemTime(SYSTEM_TIME_MONOTONIC) - mCacheStartTime) / 1000000000;
+    size_t cacheSize = 0;
+    uint32_t size = 0;
+    for (size_t i = 0; i < TEXT_LAYOUT_CACHE_SHARD_COUNT; i++) {
+        AutoMutex _l(mShards[i].mLock);
+        cacheSize += mShards[i].mCache.size();
+        size += mShards[i].mSize;
+    }
+    uint32_t cacheHitCount;
+    uint64_t nanosecondsSaved;
+    {
+        AutoMutex _l(mStatsLock);
+        cacheHitCount = mCacheHitCount;
+        nanosecondsSaved = mNanosecondsSaved;
+    }
 
-    size_t cacheSize = mCache.size();
+    float remainingPercent = 100 * ((mMaxSize - size) / ((float)mMaxSize));
+    float timeRunningInSec = (systemTime(SYSTEM_TIME_MONOTONIC) - mCacheStartTime) / 1000000000;
 
     ALOGD("------------------------------------------------");
     ALOGD("Cache stats");
@@ -206,11 +345,12 @@ void TextLayoutCache::dumpCacheStats() {
     ALOGD("pid       : %d", getpid());
     ALOGD("running   : %.0f seconds", timeRunningInSec);
     ALOGD("entries   : %d", cacheSize);
+    ALOGD("shards    : %d", TEXT_LAYOUT_CACHE_SHARD_COUNT);
     ALOGD("max size  : %d bytes", mMaxSize);
-    ALOGD("used      : %d bytes according to mSize", mSize);
-    ALOGD("remaining : %d bytes or %2.2f percent", mMaxSize - mSize, remainingPercent);
-    ALOGD("hits      : %d", mCacheHitCount);
-    ALOGD("saved     : %0.6f ms", mNanosecondsSaved * 0.000001f);
+    ALOGD("used      : %d bytes according to mSize", size);
+    ALOGD("remaining : %d bytes or %2.2f percent", mMaxSize - size, remainingPercent);
+    ALOGD("hits      : %d", cacheHitCount);
+    ALOGD("saved     : %0.6f ms", nanosecondsSaved * 0.000001f);
     ALOGD("------------------------------------------------");
 }
 
@@ -335,7 +475,80 @@ uint32_t TextLayoutValue::getElapsedTime() {
     return mElapsedTime;
 }
 
-TextLayoutShaper::TextLayoutShaper() {
+/**
+ * ShapedSegmentKey
+ */
+ShapedSegmentKey::ShapedSegmentKey(): typefaceId(0), textSize(0), textSkewX(0), textScaleX(0),
+        flags(0), hinting(SkPaint::kNo_Hinting), script(HB_SCRIPT_INVALID) {
+    paintOpts.setUseFontFallbacks(true);
+}
+
+ShapedSegmentKey::ShapedSegmentKey(const SkPaint* paint, const UChar* text, size_t count,
+        hb_script_t script) : script(script) {
+    textCopy.setTo(text, count);
+    typefaceId = SkTypeface::UniqueID(paint->getTypeface());
+    textSize = paint->getTextSize();
+    textSkewX = paint->getTextSkewX();
+    textScaleX = paint->getTextScaleX();
+    flags = paint->getFlags();
+    hinting = paint->getHinting();
+    paintOpts = paint->getPaintOptionsAndroid();
+}
+
+int ShapedSegmentKey::compare(const ShapedSegmentKey& lhs, const ShapedSegmentKey& rhs) {
+    int deltaInt = lhs.textCopy.size() - rhs.textCopy.size();
+    if (deltaInt != 0) return (deltaInt);
+
+    if (lhs.typefaceId < rhs.typefaceId) return -1;
+    if (lhs.typefaceId > rhs.typefaceId) return +1;
+
+    if (lhs.textSize < rhs.textSize) return -1;
+    if (lhs.textSize > rhs.textSize) return +1;
+
+    if (lhs.textSkewX < rhs.textSkewX) return -1;
+    if (lhs.textSkewX > rhs.textSkewX) return +1;
+
+    if (lhs.textScaleX < rhs.textScaleX) return -1;
+    if (lhs.textScaleX > rhs.textScaleX) return +1;
+
+    deltaInt = lhs.flags - rhs.flags;
+    if (deltaInt != 0) return (deltaInt);
+
+    deltaInt = lhs.hinting - rhs.hinting;
+    if (deltaInt != 0) return (deltaInt);
+
+    deltaInt = lhs.script - rhs.script;
+    if (deltaInt != 0) return (deltaInt);
+
+    if (lhs.paintOpts != rhs.paintOpts)
+        return memcmp(&lhs.paintOpts, &rhs.paintOpts, sizeof(SkPaintOptionsAndroid));
+
+    return memcmp(lhs.textCopy.string(), rhs.textCopy.string(),
+            lhs.textCopy.size() * sizeof(UChar));
+}
+
+hash_t ShapedSegmentKey::hash() const {
+    uint32_t hash = JenkinsHashMix(0, typefaceId);
+    hash = JenkinsHashMix(hash, hash_type(textSize));
+    hash = JenkinsHashMix(hash, hash_type(textSkewX));
+    hash = JenkinsHashMix(hash, hash_type(textScaleX));
+    hash = JenkinsHashMix(hash, flags);
+    hash = JenkinsHashMix(hash, hinting);
+    hash = JenkinsHashMix(hash, script);
+    hash = JenkinsHashMix(hash, paintOpts.getFontVariant());
+    hash = JenkinsHashMixShorts(hash, textCopy.string(), textCopy.size());
+    return JenkinsHashWhiten(hash);
+}
+
+/**
+ * ShapedSegment
+ */
+ShapedSegment::ShapedSegment() : mTotalAdvance(0) {
+    mBounds.setEmpty();
+}
+
+TextLayoutShaper::TextLayoutShaper() : mPurgeGeneration(0),
+        mSegmentCache(SHAPED_SEGMENT_CACHE_CAPACITY) {
     mBuffer = hb_buffer_create();
 }
 
@@ -717,6 +930,26 @@ void TextLayoutShaper::computeRunValues(const SkPaint* paint, const UChar* conte
         ALOGD("         -- string = '%s'", String8(chars, count).string());
 #endif
 
+        if (!isRTL && !isComplexScript(run.script)) {
+            // Simple scripts are shaped word by word, so that the words left untouched
+            // by an edit come out of the segment cache instead of going through Harfbuzz
+            size_t runEnd = run.pos + run.length;
+            size_t segmentStart = run.pos;
+            while (segmentStart < runEnd) {
+                size_t segmentEnd = segmentStart;
+                while (segmentEnd < runEnd && chars[segmentEnd] != ' ') {
+                    segmentEnd++;
+                }
+                while (segmentEnd < runEnd && chars[segmentEnd] == ' ') {
+                    segmentEnd++;
+                }
+                computeSegmentValues(paint, chars, segmentStart, segmentEnd - segmentStart,
+                        run.script, outAdvances, &totalAdvance, outBounds, outGlyphs, outPos);
+                segmentStart = segmentEnd;
+            }
+            continue;
+        }
+
         hb_buffer_reset(mBuffer);
         // Note: if we want to set unicode functions, etc., this is the place.
         
@@ -774,6 +1007,99 @@ void TextLayoutShaper::computeRunValues(const SkPaint* paint, const UChar* conte
 #endif
 }
 
+/**
+ * Append the glyphs of a segment of a simple script run, starting at outTotalAdvance.
+ * start is relative to chars, as are the indices of outAdvances.
+ */
+void TextLayoutShaper::computeSegmentValues(const SkPaint* paint, const UChar* chars,
+        size_t start, size_t count, hb_script_t script,
+        Vector<jfloat>* const outAdvances, jfloat* outTotalAdvance, SkRect* outBounds,
+        Vector<jchar>* const outGlyphs, Vector<jfloat>* const outPos) {
+    sp<ShapedSegment> segment = getShapedSegment(paint, chars + start, count, script);
+    jfloat totalAdvance = *outTotalAdvance;
+
+    size_t numGlyphs = segment->mGlyphs.size();
+    for (size_t i = 0; i < numGlyphs; i++) {
+        size_t cluster = start + segment->mClusters.itemAt(i);
+        outAdvances->replaceAt(outAdvances->itemAt(cluster) + segment->mAdvances.itemAt(i),
+                cluster);
+        outGlyphs->add(segment->mGlyphs.itemAt(i));
+        outPos->add(totalAdvance + segment->mPos.itemAt(2 * i));
+        outPos->add(segment->mPos.itemAt(2 * i + 1));
+    }
+
+    SkRect bounds = segment->mBounds;
+    bounds.offset(totalAdvance, 0);
+    outBounds->join(bounds);
+
+    *outTotalAdvance = totalAdvance + segment->mTotalAdvance;
+}
+
+/**
+ * Return the glyphs of a segment shaped on its own, from the segment cache when possible.
+ * Expects mShapingPaint to be set up for paint.
+ */
+sp<ShapedSegment> TextLayoutShaper::getShapedSegment(const SkPaint* paint, const UChar* chars,
+        size_t count, hb_script_t script) {
+    bool cacheable = count <= MAX_CACHED_SEGMENT_LENGTH;
+    ShapedSegmentKey key;
+    if (cacheable) {
+        key = ShapedSegmentKey(paint, chars, count, script);
+        sp<ShapedSegment> cached = mSegmentCache.get(key);
+        if (cached != NULL) {
+            return cached;
+        }
+    }
+
+    sp<ShapedSegment> segment = new ShapedSegment();
+
+    hb_buffer_reset(mBuffer);
+    hb_buffer_set_direction(mBuffer, HB_DIRECTION_LTR);
+    hb_buffer_set_script(mBuffer, script);
+    SkString langString = paint->getPaintOptionsAndroid().getLanguage().getTag();
+    hb_buffer_set_language(mBuffer, hb_language_from_string(langString.c_str(), -1));
+    hb_buffer_add_utf16(mBuffer, chars, count, 0, count);
+
+    size_t glyphBaseCount = shapeFontRun(paint);
+    unsigned int numGlyphs;
+    hb_glyph_info_t* info = hb_buffer_get_glyph_infos(mBuffer, &numGlyphs);
+    hb_glyph_position_t* positions = hb_buffer_get_glyph_positions(mBuffer, NULL);
+
+#if DEBUG_GLYPHS
+    ALOGD("Shaped segment '%s'", String8(chars, count).string());
+    logGlyphs(mBuffer);
+#endif
+
+    float skewX = paint->getTextSkewX();
+    jfloat totalAdvance = 0;
+    SkAutoGlyphCache autoCache(mShapingPaint, NULL, NULL);
+    for (size_t i = 0; i < numGlyphs; i++) {
+        float xAdvance = HBFixedToFloat(positions[i].x_advance);
+        jchar glyphId = info[i].codepoint + glyphBaseCount;
+        float xo = HBFixedToFloat(positions[i].x_offset);
+        float yo = -HBFixedToFloat(positions[i].y_offset);
+
+        float xpos = totalAdvance + xo + yo * skewX;
+        float ypos = yo;
+        segment->mGlyphs.add(glyphId);
+        segment->mClusters.add(info[i].cluster);
+        segment->mAdvances.add(xAdvance);
+        segment->mPos.add(xpos);
+        segment->mPos.add(ypos);
+        totalAdvance += xAdvance;
+
+        const SkGlyph& metrics = autoCache.getCache()->getGlyphIDMetrics(glyphId);
+        segment->mBounds.join(xpos + metrics.fLeft, ypos + metrics.fTop,
+                xpos + metrics.fLeft + metrics.fWidth, ypos + metrics.fTop + metrics.fHeight);
+    }
+    segment->mTotalAdvance = totalAdvance;
+
+    if (cacheable) {
+        mSegmentCache.put(key, segment);
+    }
+    return segment;
+}
+
 /**
  * Return the first typeface in the logical change, starting with this typeface,
  * that contains the specified unichar, or NULL if none is found.
@@ -895,12 +1221,54 @@ void TextLayoutShaper::purgeCaches() {
         hb_face_destroy(mCachedHBFaces.valueAt(i));
     }
     mCachedHBFaces.clear();
+    mSegmentCache.clear();
+}
+
+TextLayoutShaperPool::TextLayoutShaperPool() : mPurgeGeneration(0) {
+}
+
+TextLayoutShaperPool::~TextLayoutShaperPool() {
+    for (size_t i = 0; i < mShapers.size(); i++) {
+        delete mShapers[i];
+    }
+}
+
+TextLayoutShaper* TextLayoutShaperPool::acquire() {
+    AutoMutex _l(mLock);
+    if (!mIdleShapers.isEmpty()) {
+        TextLayoutShaper* shaper = mIdleShapers.top();
+        mIdleShapers.pop();
+        return shaper;
+    }
+    // There are as many shapers as threads shaping at the same time
+    TextLayoutShaper* shaper = new TextLayoutShaper();
+    shaper->mPurgeGeneration = mPurgeGeneration;
+    mShapers.add(shaper);
+    return shaper;
+}
+
+void TextLayoutShaperPool::release(TextLayoutShaper* shaper) {
+    AutoMutex _l(mLock);
+    if (shaper->mPurgeGeneration != mPurgeGeneration) {
+        shaper->purgeCaches();
+        shaper->mPurgeGeneration = mPurgeGeneration;
+    }
+    mIdleShapers.push(shaper);
+}
+
+void TextLayoutShaperPool::purgeCaches() {
+    AutoMutex _l(mLock);
+    mPurgeGeneration++;
+    for (size_t i = 0; i < mIdleShapers.size(); i++) {
+        mIdleShapers[i]->purgeCaches();
+        mIdleShapers[i]->mPurgeGeneration = mPurgeGeneration;
+    }
 }
 
 TextLayoutEngine::TextLayoutEngine() {
-    mShaper = new TextLayoutShaper();
+    mShaperPool = new TextLayoutShaperPool();
 #if USE_TEXT_LAYOUT_CACHE
-    mTextLayoutCache = new TextLayoutCache(mShaper);
+    mTextLayoutCache = new TextLayoutCache(mShaperPool);
 #else
     mTextLayoutCache = NULL;
 #endif
@@ -908,7 +1276,7 @@ TextLayoutEngine::TextLayoutEngine() {
 
 TextLayoutEngine::~TextLayoutEngine() {
     delete mTextLayoutCache;
-    delete mShaper;
+    delete mShaperPool;
 }
 
 sp<TextLayoutValue> TextLayoutEngine::getValue(const SkPaint* paint, const jchar* text,
@@ -923,18 +1291,29 @@ sp<TextLayoutValue> TextLayoutEngine::getValue(const SkPaint* paint, const jchar
     }
 #else
     value = new TextLayoutValue(count);
-    mShaper->computeValues(value.get(), paint,
+    TextLayoutShaper* shaper = mShaperPool->acquire();
+    shaper->computeValues(value.get(), paint,
             reinterpret_cast<const UChar*>(text), start, count, contextCount, dirFlags);
+    mShaperPool->release(shaper);
 #endif
     return value;
 }
 
+void TextLayoutEngine::precacheValue(const SkPaint* paint, const jchar* text,
+        jint start, jint count, jint contextCount, jint dirFlags) {
+#if USE_TEXT_LAYOUT_CACHE
+    mTextLayoutCache->precacheValue(paint, text, start, count, contextCount, dirFlags);
+#endif
+}
+
 void TextLayoutEngine::purgeCaches() {
 #if USE_TEXT_LAYOUT_CACHE
     mTextLayoutCache->purgeCaches();
 #if DEBUG_GLYPHS
     ALOGD("Purged TextLayoutEngine caches");
 #endif
+#else
+    mShaperPool->purgeCaches();
 #endif
 }
 
@@ -59,6 +59,18 @@
 // Define the interval in number of cache hits between two statistics dump
 #define DEFAULT_DUMP_STATS_CACHE_HIT_INTERVAL 100
 
+// Define the number of independently locked parts of the cache
+#define TEXT_LAYOUT_CACHE_SHARD_COUNT 4
+
+// Define the maximum number of strings waiting to be precached
+#define MAX_PENDING_PRECACHE_COUNT 64
+
+// Define the number of shaped segments kept by each shaper
+#define SHAPED_SEGMENT_CACHE_CAPACITY 1000
+
+// Define the length over which a shaped segment is not kept
+#define MAX_CACHED_SEGMENT_LENGTH 64
+
 namespace android {
 
 /**
@@ -176,6 +188,78 @@ private:
 
 }; // TextLayoutCacheValue
 
+/**
+ * ShapedSegmentKey is the key of a shaped segment: a word and its trailing
+ * space, in a simple script, with the paint properties used to shape it
+ */
+class ShapedSegmentKey {
+public:
+    ShapedSegmentKey();
+
+    ShapedSegmentKey(const SkPaint* paint, const UChar* text, size_t count, hb_script_t script);
+
+    static int compare(const ShapedSegmentKey& lhs, const ShapedSegmentKey& rhs);
+
+    bool operator==(const ShapedSegmentKey& other) const {
+        return compare(*this, other) == 0;
+    }
+
+    bool operator!=(const ShapedSegmentKey& other) const {
+        return compare(*this, other) != 0;
+    }
+
+    hash_t hash() const;
+private:
+    String16 textCopy;
+    SkFontID typefaceId;
+    SkScalar textSize;
+    SkScalar textSkewX;
+    SkScalar textScaleX;
+    uint32_t flags;
+    SkPaint::Hinting hinting;
+    SkPaintOptionsAndroid paintOpts;
+    hb_script_t script;
+}; // ShapedSegmentKey
+
+inline int strictly_order_type(const ShapedSegmentKey& lhs, const ShapedSegmentKey& rhs) {
+    return ShapedSegmentKey::compare(lhs, rhs) < 0;
+}
+
+inline int compare_type(const ShapedSegmentKey& lhs, const ShapedSegmentKey& rhs) {
+    return ShapedSegmentKey::compare(lhs, rhs);
+}
+
+inline hash_t hash_type(const ShapedSegmentKey& key) {
+    return key.hash();
+}
+
+/*
+ * ShapedSegment holds the glyphs of a segment, positioned from its origin
+ */
+class ShapedSegment : public LightRefBase<ShapedSegment> {
+public:
+    ShapedSegment();
+
+    /**
+     * Glyphs, and the index of the first character of the cluster of each
+     */
+    Vector<jchar> mGlyphs;
+    Vector<size_t> mClusters;
+
+    /**
+     * Advance of each glyph
+     */
+    Vector<jfloat> mAdvances;
+
+    /**
+     * Pos vector (2 * i is x pos, 2 * i + 1 is y pos, same as drawPosText)
+     */
+    Vector<jfloat> mPos;
+
+    jfloat mTotalAdvance;
+    SkRect mBounds;
+}; // ShapedSegment
+
 /**
  * The TextLayoutShaper is responsible for shaping (with the Harfbuzz library)
  */
@@ -205,6 +289,12 @@ private:
      */
     KeyedVector<SkFontID, hb_face_t*> mCachedHBFaces;
 
+    /**
+     * Cache of the shaped words of simple scripts, so that the text around an
+     * edit is not reshaped
+     */
+    LruCache<ShapedSegmentKey, sp<ShapedSegment> > mSegmentCache;
+
     SkTypeface* typefaceForScript(const SkPaint* paint, SkTypeface* typeface,
         hb_script_t script);
 
@@ -220,19 +310,62 @@ private:
             Vector<jfloat>* const outAdvances, jfloat* outTotalAdvance, SkRect* outBounds,
             Vector<jchar>* const outGlyphs, Vector<jfloat>* const outPos);
 
+    void computeSegmentValues(const SkPaint* paint, const UChar* chars,
+            size_t start, size_t count, hb_script_t script,
+            Vector<jfloat>* const outAdvances, jfloat* outTotalAdvance, SkRect* outBounds,
+            Vector<jchar>* const outGlyphs, Vector<jfloat>* const outPos);
+
+    sp<ShapedSegment> getShapedSegment(const SkPaint* paint, const UChar* chars, size_t count,
+            hb_script_t script);
+
     SkTypeface* setCachedTypeface(SkTypeface** typeface, hb_script_t script, SkTypeface::Style style);
     hb_face_t* referenceCachedHBFace(SkTypeface* typeface);
 
     bool isComplexScript(hb_script_t script);
+
+    /**
+     * Value of the pool purge count when the caches were last purged
+     */
+    uint32_t mPurgeGeneration;
+
+    friend class TextLayoutShaperPool;
 }; // TextLayoutShaper
 
+/**
+ * The TextLayoutShaperPool hands out shapers, so that several threads can shape
+ * at the same time. A shaper is only used by one thread at a time.
+ */
+class TextLayoutShaperPool {
+public:
+    TextLayoutShaperPool();
+    ~TextLayoutShaperPool();
+
+    TextLayoutShaper* acquire();
+    void release(TextLayoutShaper* shaper);
+
+    /**
+     * Purge the caches of the idle shapers now, and of the others when released
+     */
+    void purgeCaches();
+
+private:
+    Mutex mLock;
+    Vector<TextLayoutShaper*> mShapers;
+    Vector<TextLayoutShaper*> mIdleShapers;
+    uint32_t mPurgeGeneration;
+}; // TextLayoutShaperPool
+
 /**
  * Cache of text layout information.
+ *
+ * The cache is split in shards by key hash, each with its own lock, and the
+ * text is shaped outside of the locks. A thread looking up a key which is
+ * being shaped by another thread waits for its value instead of shaping it too.
  */
-class TextLayoutCache : private OnEntryRemoved<TextLayoutCacheKey, sp<TextLayoutValue> >
+class TextLayoutCache
 {
 public:
-    TextLayoutCache(TextLayoutShaper* shaper);
+    TextLayoutCache(TextLayoutShaperPool* shaperPool);
 
     ~TextLayoutCache();
 
@@ -240,13 +373,14 @@ public:
         return mInitialized;
     }
 
+    sp<TextLayoutValue> getValue(const SkPaint* paint, const jchar* text, jint start,
+            jint count, jint contextCount, jint dirFlags);
+
     /**
-     * Used as a callback when an entry is removed from the cache
-     * Do not invoke directly
+     * Shape the text on a background thread if it is not cached yet, and return
+     * without waiting
      */
-    void operator()(TextLayoutCacheKey& text, sp<TextLayoutValue>& desc);
-
-    sp<TextLayoutValue> getValue(const SkPaint* paint, const jchar* text, jint start,
+    void precacheValue(const SkPaint* paint, const jchar* text, jint start,
             jint count, jint contextCount, jint dirFlags);
 
     /**
@@ -255,18 +389,65 @@ public:
     void purgeCaches();
 
 private:
-    TextLayoutShaper* mShaper;
-    Mutex mLock;
+    /**
+     * Part of the cache with its own lock, and the keys being shaped
+     */
+    class Shard : public OnEntryRemoved<TextLayoutCacheKey, sp<TextLayoutValue> > {
+    public:
+        Shard();
+
+        /**
+         * Used as a callback when an entry is removed from the cache
+         * Do not invoke directly
+         */
+        void operator()(TextLayoutCacheKey& text, sp<TextLayoutValue>& desc);
+
+        Mutex mLock;
+        Condition mShapedCondition;
+        LruCache<TextLayoutCacheKey, sp<TextLayoutValue> > mCache;
+        KeyedVector<TextLayoutCacheKey, sp<TextLayoutValue> > mInFlight;
+        uint32_t mSize;
+        bool mDebugEnabled;
+    };
+
+    /**
+     * Text waiting to be precached
+     */
+    struct PrecacheRequest {
+        SkPaint paint;
+        String16 text;
+        jint start;
+        jint count;
+        jint dirFlags;
+    };
+
+    class PrecacheThread : public Thread {
+    public:
+        PrecacheThread(TextLayoutCache* cache);
+
+    private:
+        virtual bool threadLoop();
+
+        TextLayoutCache* mCache;
+    };
+
+    TextLayoutShaperPool* mShaperPool;
     bool mInitialized;
 
-    LruCache<TextLayoutCacheKey, sp<TextLayoutValue> > mCache;
+    Shard mShards[TEXT_LAYOUT_CACHE_SHARD_COUNT];
 
-    uint32_t mSize;
     uint32_t mMaxSize;
 
+    Mutex mStatsLock;
     uint32_t mCacheHitCount;
     uint64_t mNanosecondsSaved;
 
+    Mutex mPrecacheLock;
+    Condition mPrecacheCondition;
+    Vector<PrecacheRequest> mPrecacheRequests;
+    sp<PrecacheThread> mPrecacheThread;
+    bool mExiting;
+
     uint64_t mCacheStartTime;
 
     RtlDebugLevel mDebugLevel;
@@ -282,6 +463,10 @@ private:
      */
     void dumpCacheStats();
 
+    Shard& getShard(const TextLayoutCacheKey& key);
+    bool isCachedOrInFlight(const TextLayoutCacheKey& key);
+    bool waitForPrecacheRequest(PrecacheRequest* outRequest);
+
 }; // TextLayoutCache
 
 /**
@@ -301,11 +486,18 @@ public:
     sp<TextLayoutValue> getValue(const SkPaint* paint, const jchar* text, jint start,
             jint count, jint contextCount, jint dirFlags);
 
+    /**
+     * Shape ahead of time the text which is about to be laid out, such as the
+     * items of a list about to scroll in
+     */
+    void precacheValue(const SkPaint* paint, const jchar* text, jint start,
+            jint count, jint contextCount, jint dirFlags);
+
     void purgeCaches();
 
 private:
     TextLayoutCache* mTextLayoutCache;
-    TextLayoutShaper* mShaper;
+    TextLayoutShaperPool* mShaperPool;
 }; // TextLayoutEngine
 
 } // namespace android
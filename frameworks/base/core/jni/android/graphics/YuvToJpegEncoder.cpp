@@ -1,11 +1,25 @@
 #include "CreateJavaOutputStreamAdaptor.h"
+#include "SkData.h"
 #include "SkJpegUtility.h"
 #include "YuvToJpegEncoder.h"
 #include <ui/PixelFormat.h>
 #include <hardware/hardware.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+#include <unistd.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 #include <jni.h>
 
+// Both formats are encoded in MCUs of 16 rows
+static const int kMcuRows = 16;
+// Frames are split in stripes of at least this many MCU rows
+static const int kMinStripeMcuRows = 8;
+static const int kMaxStripes = 4;
+
 YuvToJpegEncoder* YuvToJpegEncoder::create(int format, int* strides) {
     // Only ImageFormat.NV21 and ImageFormat.YUY2 are supported
     // for now.
@@ -23,6 +37,20 @@ YuvToJpegEncoder::YuvToJpegEncoder(int* strides) : fStrides(strides) {
 
 bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
         int height, int* offsets, int jpegQuality) {
+    int mcuRows = (height + kMcuRows - 1) / kMcuRows;
+    int numStripes = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numStripes > kMaxStripes) numStripes = kMaxStripes;
+    if (numStripes > mcuRows / kMinStripeMcuRows) numStripes = mcuRows / kMinStripeMcuRows;
+    if (numStripes > 1 && encodeStripes(stream, (uint8_t*) inYuv, width, height,
+            offsets, jpegQuality, numStripes)) {
+        return true;
+    }
+    return encodeRows(stream, inYuv, width, height, offsets, jpegQuality, 0, 0);
+}
+
+bool YuvToJpegEncoder::encodeRows(SkWStream* stream, void* inYuv, int width,
+        int height, int* offsets, int jpegQuality, int firstRow,
+        unsigned int restartInterval) {
     jpeg_compress_struct    cinfo;
     skjpeg_error_mgr        sk_err;
     skjpeg_destination_mgr  sk_wstream(stream);
@@ -30,6 +58,7 @@ bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
     cinfo.err = jpeg_std_error(&sk_err);
     sk_err.error_exit = skjpeg_error_exit;
     if (setjmp(sk_err.fJmpBuf)) {
+        jpeg_destroy_compress(&cinfo);
         return false;
     }
     jpeg_create_compress(&cinfo);
@@ -37,16 +66,161 @@ bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
     cinfo.dest = &sk_wstream;
 
     setJpegCompressStruct(&cinfo, width, height, jpegQuality);
+    cinfo.restart_interval = restartInterval;
 
     jpeg_start_compress(&cinfo, TRUE);
 
-    compress(&cinfo, (uint8_t*) inYuv, offsets);
+    int rowOffsets[2];
+    offsetRows(offsets, firstRow, rowOffsets);
+    compress(&cinfo, (uint8_t*) inYuv, rowOffsets);
 
     jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
 
     return true;
 }
 
+/**
+ * Encodes one stripe of a frame into memory, on its own thread.
+ */
+class YuvToJpegStripeThread : public android::Thread {
+public:
+    YuvToJpegStripeThread(YuvToJpegEncoder* encoder, uint8_t* yuv, int width, int height,
+            int* offsets, int jpegQuality, int firstRow, unsigned int restartInterval) :
+            android::Thread(false), fEncoder(encoder), fYuv(yuv), fWidth(width),
+            fHeight(height), fOffsets(offsets), fJpegQuality(jpegQuality),
+            fFirstRow(firstRow), fRestartInterval(restartInterval), fResult(false) {
+    }
+
+    SkDynamicMemoryWStream* getStream() { return &fStream; }
+    bool getResult() const { return fResult; }
+
+    bool encode() {
+        fResult = fEncoder->encodeRows(&fStream, fYuv, fWidth, fHeight, fOffsets,
+                fJpegQuality, fFirstRow, fRestartInterval);
+        return fResult;
+    }
+
+private:
+    virtual bool threadLoop() {
+        encode();
+        return false;
+    }
+
+    YuvToJpegEncoder* fEncoder;
+    uint8_t* fYuv;
+    int fWidth;
+    int fHeight;
+    int* fOffsets;
+    int fJpegQuality;
+    int fFirstRow;
+    unsigned int fRestartInterval;
+    bool fResult;
+    SkDynamicMemoryWStream fStream;
+};
+
+/**
+ * Finds the entropy coded data of a baseline jpeg: returns the offset of the
+ * first byte after the SOS segment, and the offset of the height in the SOF
+ * segment when sofOffset is not NULL. Returns 0 if the jpeg can't be parsed.
+ */
+static size_t findScanData(const uint8_t* jpeg, size_t size, size_t* sofOffset) {
+    size_t offset = 2;
+    while (offset + 4 <= size && jpeg[offset] == 0xFF) {
+        uint8_t marker = jpeg[offset + 1];
+        size_t length = (jpeg[offset + 2] << 8) | jpeg[offset + 3];
+        if ((marker == 0xC0 || marker == 0xC1) && sofOffset != NULL) {
+            // FF Cx, length, precision, then height
+            *sofOffset = offset + 5;
+        }
+        offset += 2 + length;
+        if (marker == 0xDA) {
+            return offset <= size ? offset : 0;
+        }
+    }
+    return 0;
+}
+
+bool YuvToJpegEncoder::encodeStripes(SkWStream* stream, uint8_t* yuv, int width,
+        int height, int* offsets, int jpegQuality, int numStripes) {
+    // Each stripe is encoded as a jpeg of its own, whose single restart interval
+    // covers it entirely. As restarts reset the DC predictors and byte-align the
+    // entropy coded data, the scans of the stripes joined with RSTn markers make
+    // up the scan of the whole frame.
+    int mcuRows = (height + kMcuRows - 1) / kMcuRows;
+    int stripeMcuRows = (mcuRows + numStripes - 1) / numStripes;
+    numStripes = (mcuRows + stripeMcuRows - 1) / stripeMcuRows;
+    unsigned int restartInterval = ((width + kMcuRows - 1) / kMcuRows) * stripeMcuRows;
+    if (restartInterval > 0xFFFF) {
+        return false;
+    }
+
+    int stripeHeight = stripeMcuRows * kMcuRows;
+    android::Vector<android::sp<YuvToJpegStripeThread> > stripes;
+    for (int i = 0; i < numStripes; i++) {
+        int firstRow = i * stripeHeight;
+        int rows = height - firstRow < stripeHeight ? height - firstRow : stripeHeight;
+        stripes.add(new YuvToJpegStripeThread(this, yuv, width, rows, offsets,
+                jpegQuality, firstRow, restartInterval));
+    }
+
+    // The last stripe is encoded on the calling thread
+    bool success = true;
+    for (int i = 0; i < numStripes - 1; i++) {
+        if (stripes[i]->run("YuvToJpegStripe") != android::NO_ERROR) {
+            stripes[i]->encode();
+        }
+    }
+    stripes[numStripes - 1]->encode();
+    for (int i = 0; i < numStripes; i++) {
+        stripes[i]->join();
+        success &= stripes[i]->getResult();
+    }
+    if (!success) {
+        return false;
+    }
+
+    android::Vector<SkData*> data;
+    android::Vector<size_t> scanOffsets;
+    size_t sofOffset = 0;
+    for (int i = 0; i < numStripes; i++) {
+        SkData* stripeData = stripes[i]->getStream()->copyToData();
+        size_t scanOffset = findScanData(stripeData->bytes(), stripeData->size(),
+                i == 0 ? &sofOffset : NULL);
+        data.add(stripeData);
+        scanOffsets.add(scanOffset);
+        if (scanOffset == 0 || stripeData->size() < scanOffset + 2) {
+            success = false;
+        }
+    }
+    success &= sofOffset != 0;
+
+    for (int i = 0; success && i < numStripes; i++) {
+        uint8_t* bytes = (uint8_t*) data[i]->data();
+        size_t size = data[i]->size();
+        size_t scanOffset = scanOffsets[i];
+        if (i == 0) {
+            bytes[sofOffset] = height >> 8;
+            bytes[sofOffset + 1] = height & 0xFF;
+            success = stream->write(bytes, scanOffset);
+        } else {
+            uint8_t restart[2] = { 0xFF, (uint8_t) (0xD0 + ((i - 1) & 7)) };
+            success = stream->write(restart, sizeof(restart));
+        }
+        // Leave out the EOI marker of each stripe
+        success = success && stream->write(bytes + scanOffset, size - scanOffset - 2);
+    }
+    if (success) {
+        const uint8_t eoi[2] = { 0xFF, 0xD9 };
+        success = stream->write(eoi, sizeof(eoi));
+    }
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i]->unref();
+    }
+    return success;
+}
+
 void YuvToJpegEncoder::setJpegCompressStruct(jpeg_compress_struct* cinfo,
         int width, int height, int quality) {
     cinfo->image_width = width;
@@ -119,7 +293,17 @@ void Yuv420SpToJpegEncoder::deinterleave(uint8_t* vuPlanar, uint8_t* uRows,
     for (int row = 0; row < numRows; ++row) {
         int offset = ((rowIndex >> 1) + row) * fStrides[1];
         uint8_t* vu = vuPlanar + offset;
-        for (int i = 0; i < (width >> 1); ++i) {
+        int i = 0;
+#if defined(__ARM_NEON__)
+        for (; i + 16 <= (width >> 1); i += 16) {
+            int index = row * (width >> 1) + i;
+            uint8x16x2_t vuPairs = vld2q_u8(vu);
+            vst1q_u8(uRows + index, vuPairs.val[1]);
+            vst1q_u8(vRows + index, vuPairs.val[0]);
+            vu += 32;
+        }
+#endif
+        for (; i < (width >> 1); ++i) {
             int index = row * (width >> 1) + i;
             uRows[index] = vu[1];
             vRows[index] = vu[0];
@@ -128,6 +312,12 @@ void Yuv420SpToJpegEncoder::deinterleave(uint8_t* vuPlanar, uint8_t* uRows,
     }
 }
 
+void Yuv420SpToJpegEncoder::offsetRows(int* offsets, int firstRow, int* outOffsets) {
+    // The vu plane is vertically downsampled
+    outOffsets[0] = offsets[0] + firstRow * fStrides[0];
+    outOffsets[1] = offsets[1] + (firstRow >> 1) * fStrides[1];
+}
+
 void Yuv420SpToJpegEncoder::configSamplingFactors(jpeg_compress_struct* cinfo) {
     // cb and cr are horizontally downsampled and vertically downsampled as well.
     cinfo->comp_info[0].h_samp_factor = 2;
@@ -193,7 +383,20 @@ void Yuv422IToJpegEncoder::deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* u
     if (numRows > 16) numRows = 16;
     for (int row = 0; row < numRows; ++row) {
         uint8_t* yuvSeg = yuv + (rowIndex + row) * fStrides[0];
-        for (int i = 0; i < (width >> 1); ++i) {
+        int i = 0;
+#if defined(__ARM_NEON__)
+        for (; i + 8 <= (width >> 1); i += 8) {
+            int indexY = row * width + (i << 1);
+            int indexU = row * (width >> 1) + i;
+            uint8x8x4_t yuyv = vld4_u8(yuvSeg);
+            uint8x8x2_t yPairs = { { yuyv.val[0], yuyv.val[2] } };
+            vst2_u8(yRows + indexY, yPairs);
+            vst1_u8(uRows + indexU, yuyv.val[1]);
+            vst1_u8(vRows + indexU, yuyv.val[3]);
+            yuvSeg += 32;
+        }
+#endif
+        for (; i < (width >> 1); ++i) {
             int indexY = row * width + (i << 1);
             int indexU = row * (width >> 1) + i;
             yRows[indexY] = yuvSeg[0];
@@ -205,6 +408,10 @@ void Yuv422IToJpegEncoder::deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* u
     }
 }
 
+void Yuv422IToJpegEncoder::offsetRows(int* offsets, int firstRow, int* outOffsets) {
+    outOffsets[0] = offsets[0] + firstRow * fStrides[0];
+}
+
 void Yuv422IToJpegEncoder::configSamplingFactors(jpeg_compress_struct* cinfo) {
     // cb and cr are horizontally downsampled and vertically downsampled as well.
     cinfo->comp_info[0].h_samp_factor = 2;
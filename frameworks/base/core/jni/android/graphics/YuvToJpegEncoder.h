@@ -35,14 +35,27 @@ public:
 
     virtual ~YuvToJpegEncoder() {}
 
+    /** Encode a horizontal stripe of the YUV data to a standalone jpeg,
+     *  with a restart interval covering the whole stripe.
+     *
+     *  @param firstRow The first row of the stripe, a multiple of 16.
+     *  @param restartInterval The restart interval in MCUs, or 0 for none.
+     *  @return true if successfully compressed the stream.
+     */
+    bool encodeRows(SkWStream* stream, void* inYuv, int width, int height,
+            int* offsets, int jpegQuality, int firstRow, unsigned int restartInterval);
+
 protected:
     int fNumPlanes;
     int* fStrides;
     void setJpegCompressStruct(jpeg_compress_struct* cinfo, int width,
             int height, int quality);
+    bool encodeStripes(SkWStream* stream, uint8_t* yuv, int width,
+            int height, int* offsets, int jpegQuality, int numStripes);
     virtual void configSamplingFactors(jpeg_compress_struct* cinfo) = 0;
     virtual void compress(jpeg_compress_struct* cinfo,
             uint8_t* yuv, int* offsets) = 0;
+    virtual void offsetRows(int* offsets, int firstRow, int* outOffsets) = 0;
 };
 
 class Yuv420SpToJpegEncoder : public YuvToJpegEncoder {
@@ -57,6 +70,7 @@ private:
      void deinterleave(uint8_t* vuPlanar, uint8_t* uRows, uint8_t* vRows,
              int rowIndex, int width, int height);
      void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets);
+     void offsetRows(int* offsets, int firstRow, int* outOffsets);
 };
 
 class Yuv422IToJpegEncoder : public YuvToJpegEncoder {
@@ -69,6 +83,7 @@ private:
     void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets);
     void deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* uRows,
             uint8_t* vRows, int rowIndex, int width, int height);
+    void offsetRows(int* offsets, int firstRow, int* outOffsets);
 };
 
 #endif
@@ -17,7 +17,9 @@
 #include "jni.h"
 #include "GraphicsJNI.h"
 #include <android_runtime/AndroidRuntime.h>
-#include <vector>
+#include <deque>
+
+#include <utils/threads.h>
 
 #include "CreateJavaOutputStreamAdaptor.h"
 
@@ -46,20 +48,146 @@ struct PageRecord {
     SkRect mContentRect;
 };
 
+/*
+ * Adds the finished pages to the PDF document on its own thread, in order,
+ * while the next pages are recorded. The recording of a page is freed as soon
+ * as the page is added, so only a few recordings are alive at any time.
+ */
+class PageWriter : public Thread {
+public:
+    PageWriter(SkDocument* document)
+            : Thread(false), mDocument(document), mBusy(false) {
+    }
+
+    virtual ~PageWriter() {
+        for (unsigned i = 0; i < mPages.size(); i++) {
+            delete mPages[i];
+        }
+    }
+
+    // Queues a finished page, waiting while too many pages are queued.
+    void queuePage(PageRecord* page) {
+        Mutex::Autolock _l(mLock);
+        while (mPages.size() >= MAX_QUEUED_PAGES) {
+            mCondition.wait(mLock);
+        }
+        mPages.push_back(page);
+        mCondition.broadcast();
+    }
+
+    // Waits until all the queued pages have been added to the document.
+    void flush() {
+        Mutex::Autolock _l(mLock);
+        while (!mPages.empty() || mBusy) {
+            mCondition.wait(mLock);
+        }
+    }
+
+    void stop() {
+        {
+            Mutex::Autolock _l(mLock);
+            requestExit();
+            mCondition.broadcast();
+        }
+        requestExitAndWait();
+    }
+
+private:
+    enum { MAX_QUEUED_PAGES = 2 };
+
+    virtual bool threadLoop() {
+        PageRecord* page;
+        {
+            Mutex::Autolock _l(mLock);
+            while (mPages.empty() && !exitPending()) {
+                mCondition.wait(mLock);
+            }
+            if (exitPending()) {
+                return false;
+            }
+            page = mPages.front();
+            mPages.pop_front();
+            mBusy = true;
+            mCondition.broadcast();
+        }
+
+        SkCanvas* canvas = mDocument->beginPage(page->mWidth, page->mHeight,
+                &(page->mContentRect));
+
+        canvas->clipRect(page->mContentRect);
+        canvas->translate(page->mContentRect.left(), page->mContentRect.top());
+        canvas->drawPicture(*page->mPicture);
+
+        mDocument->endPage();
+        delete page;
+
+        Mutex::Autolock _l(mLock);
+        mBusy = false;
+        mCondition.broadcast();
+        return true;
+    }
+
+    SkDocument* const mDocument;
+    Mutex mLock;
+    Condition mCondition;
+    std::deque<PageRecord*> mPages;
+    // whether a page is being added
+    bool mBusy;
+};
+
+/*
+ * The stream the document is created with. Skia's PDF backend only emits the
+ * PDF when the document is closed, which happens in write(), so the output
+ * goes straight to the stream passed to write() instead of to memory.
+ */
+class DeferredWStream : public SkWStream {
+public:
+    DeferredWStream() : mTarget(NULL) {
+    }
+
+    void setTarget(SkWStream* target) {
+        mTarget = target;
+    }
+
+    virtual bool write(const void* buffer, size_t size) {
+        return mTarget != NULL && mTarget->write(buffer, size);
+    }
+
+    virtual void flush() {
+        if (mTarget != NULL) {
+            mTarget->flush();
+        }
+    }
+
+private:
+    SkWStream* mTarget;
+};
+
 class PdfDocument {
 public:
     PdfDocument() {
         mCurrentPage = NULL;
+        mOutput = new DeferredWStream();
+        mDocument = SkDocument::CreatePDF(mOutput);
+        mDocumentClosed = false;
+        mWriter = new PageWriter(mDocument);
+        mWriter->run("PdfPageWriter");
+    }
+
+    // Once the document is written the pages it was converted from are gone,
+    // so no page can be added and it can't be written again.
+    bool isWritten() const {
+        return mDocumentClosed;
     }
 
     SkCanvas* startPage(int width, int height,
             int contentLeft, int contentTop, int contentRight, int contentBottom) {
         assert(mCurrentPage == NULL);
+        assert(!mDocumentClosed);
 
         SkRect contentRect = SkRect::MakeLTRB(
                 contentLeft, contentTop, contentRight, contentBottom);
         PageRecord* page = new PageRecord(width, height, contentRect);
-        mPages.push_back(page);
         mCurrentPage = page;
 
         SkCanvas* canvas = page->mPicture->beginRecording(
@@ -76,30 +204,32 @@ public:
     void finishPage() {
         assert(mCurrentPage != NULL);
         mCurrentPage->mPicture->endRecording();
+        mWriter->queuePage(mCurrentPage);
         mCurrentPage = NULL;
     }
 
     void write(SkWStream* stream) {
-        SkDocument* document = SkDocument::CreatePDF(stream);
-        for (unsigned i = 0; i < mPages.size(); i++) {
-            PageRecord* page =  mPages[i];
-
-            SkCanvas* canvas = document->beginPage(page->mWidth, page->mHeight,
-                    &(page->mContentRect));
-
-            canvas->clipRect(page->mContentRect);
-            canvas->translate(page->mContentRect.left(), page->mContentRect.top());
-            canvas->drawPicture(*page->mPicture);
-
-            document->endPage();
-        }
-        document->close();
+        assert(!mDocumentClosed);
+        mWriter->flush();
+        mWriter->stop();
+        mWriter.clear();
+        mOutput->setTarget(stream);
+        mDocument->close();
+        mOutput->setTarget(NULL);
+        mDocumentClosed = true;
     }
 
     void close() {
-        for (unsigned i = 0; i < mPages.size(); i++) {
-            delete mPages[i];
+        if (mWriter != NULL) {
+            mWriter->stop();
+            mWriter.clear();
         }
+        if (mDocument != NULL) {
+            mDocument->unref();
+            mDocument = NULL;
+        }
+        delete mOutput;
+        mOutput = NULL;
         delete mCurrentPage;
         mCurrentPage = NULL;
     }
@@ -109,8 +239,11 @@ private:
         close();
     }
 
-    std::vector<PageRecord*> mPages;
     PageRecord* mCurrentPage;
+    DeferredWStream* mOutput;
+    SkDocument* mDocument;
+    bool mDocumentClosed;
+    sp<PageWriter> mWriter;
 };
 
 static jint nativeCreateDocument(JNIEnv* env, jobject thiz) {
@@ -121,6 +254,10 @@ static jint nativeStartPage(JNIEnv* env, jobject thiz, jint documentPtr,
         jint pageWidth, jint pageHeight,
         jint contentLeft, jint contentTop, jint contentRight, jint contentBottom) {
     PdfDocument* document = reinterpret_cast<PdfDocument*>(documentPtr);
+    if (document->isWritten()) {
+        doThrowISE(env, "Cannot add a page to a document that was already written");
+        return 0;
+    }
     return reinterpret_cast<jint>(document->startPage(pageWidth, pageHeight,
             contentLeft, contentTop, contentRight, contentBottom));
 }
@@ -133,6 +270,10 @@ static void nativeFinishPage(JNIEnv* env, jobject thiz, jint documentPtr) {
 static void nativeWriteTo(JNIEnv* env, jobject thiz, jint documentPtr, jobject out,
         jbyteArray chunk) {
     PdfDocument* document = reinterpret_cast<PdfDocument*>(documentPtr);
+    if (document->isWritten()) {
+        doThrowISE(env, "The document can only be written once");
+        return;
+    }
     SkWStream* skWStream = CreateJavaOutputStreamAdaptor(env, out, chunk);
     document->write(skWStream);
     delete skWStream;
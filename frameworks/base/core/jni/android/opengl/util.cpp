@@ -770,10 +770,10 @@ getPointer(JNIEnv *_env, jobject buffer, jint *remaining)
     limit = _env->GetIntField(buffer, limitID);
     elementSizeShift = _env->GetIntField(buffer, elementSizeShiftID);
     *remaining = (limit - position) << elementSizeShift;
-    pointer = _env->CallStaticLongMethod(nioAccessClass,
-            getBasePointerID, buffer);
+    // Direct buffers don't need the upcall to NIOAccess.getBasePointer()
+    pointer = (jint) _env->GetDirectBufferAddress(buffer);
     if (pointer != 0L) {
-        return (void *) (jint) pointer;
+        return (void *) (jint) (pointer + (position << elementSizeShift));
     }
     return NULL;
 }
@@ -330,17 +330,8 @@ static void nativeCopyStringToBuffer(JNIEnv* env, jclass clazz, jint windowPtr,
     }
 }
 
-static jlong nativeGetLong(JNIEnv* env, jclass clazz, jint windowPtr,
-        jint row, jint column) {
-    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
-    LOG_WINDOW("Getting long for %d,%d from %p", row, column, window);
-
-    CursorWindow::FieldSlot* fieldSlot = window->getFieldSlot(row, column);
-    if (!fieldSlot) {
-        throwExceptionWithRowCol(env, row, column);
-        return 0;
-    }
-
+static jlong getFieldSlotLong(JNIEnv* env, CursorWindow* window,
+        CursorWindow::FieldSlot* fieldSlot) {
     int32_t type = window->getFieldSlotType(fieldSlot);
     if (type == CursorWindow::FIELD_TYPE_INTEGER) {
         return window->getFieldSlotValueLong(fieldSlot);
@@ -361,17 +352,8 @@ static jlong nativeGetLong(JNIEnv* env, jclass clazz, jint windowPtr,
     }
 }
 
-static jdouble nativeGetDouble(JNIEnv* env, jclass clazz, jint windowPtr,
-        jint row, jint column) {
-    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
-    LOG_WINDOW("Getting double for %d,%d from %p", row, column, window);
-
-    CursorWindow::FieldSlot* fieldSlot = window->getFieldSlot(row, column);
-    if (!fieldSlot) {
-        throwExceptionWithRowCol(env, row, column);
-        return 0.0;
-    }
-
+static jdouble getFieldSlotDouble(JNIEnv* env, CursorWindow* window,
+        CursorWindow::FieldSlot* fieldSlot) {
     int32_t type = window->getFieldSlotType(fieldSlot);
     if (type == CursorWindow::FIELD_TYPE_FLOAT) {
         return window->getFieldSlotValueDouble(fieldSlot);
@@ -392,6 +374,104 @@ static jdouble nativeGetDouble(JNIEnv* env, jclass clazz, jint windowPtr,
     }
 }
 
+static jint getFieldSlotType(JNIEnv* env, CursorWindow* window,
+        CursorWindow::FieldSlot* fieldSlot) {
+    return window->getFieldSlotType(fieldSlot);
+}
+
+static jlong nativeGetLong(JNIEnv* env, jclass clazz, jint windowPtr,
+        jint row, jint column) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting long for %d,%d from %p", row, column, window);
+
+    CursorWindow::FieldSlot* fieldSlot = window->getFieldSlot(row, column);
+    if (!fieldSlot) {
+        throwExceptionWithRowCol(env, row, column);
+        return 0;
+    }
+    return getFieldSlotLong(env, window, fieldSlot);
+}
+
+static jdouble nativeGetDouble(JNIEnv* env, jclass clazz, jint windowPtr,
+        jint row, jint column) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting double for %d,%d from %p", row, column, window);
+
+    CursorWindow::FieldSlot* fieldSlot = window->getFieldSlot(row, column);
+    if (!fieldSlot) {
+        throwExceptionWithRowCol(env, row, column);
+        return 0.0;
+    }
+    return getFieldSlotDouble(env, window, fieldSlot);
+}
+
+// Number of values converted on the stack before they are copied to the array.
+static const uint32_t COLUMN_BATCH_ROWS = 128;
+
+// Reads a column of the rows from startRow on into valuesObj, until the array
+// or the window is full, and returns the number of rows read.  The values are
+// converted like those of the single value accessors.
+template <typename T, typename ArrayT>
+static jint getColumnValues(JNIEnv* env, CursorWindow* window, jint startRow, jint column,
+        ArrayT valuesObj,
+        T (*getValue)(JNIEnv*, CursorWindow*, CursorWindow::FieldSlot*),
+        void (JNIEnv::*setArrayRegion)(ArrayT, jsize, jsize, const T*)) {
+    if (startRow < 0 || column < 0 || uint32_t(column) >= window->getNumColumns()) {
+        throwExceptionWithRowCol(env, startRow, column);
+        return 0;
+    }
+
+    const uint32_t numRows = window->getNumRows();
+    const uint32_t length = env->GetArrayLength(valuesObj);
+    CursorWindow::FieldSlot* fieldSlots[COLUMN_BATCH_ROWS];
+    T values[COLUMN_BATCH_ROWS];
+    uint32_t numRead = 0;
+    while (numRead < length && startRow + numRead < numRows) {
+        uint32_t maxRows = length - numRead;
+        if (maxRows > COLUMN_BATCH_ROWS) {
+            maxRows = COLUMN_BATCH_ROWS;
+        }
+        uint32_t count = window->getColumnFieldSlots(startRow + numRead, column,
+                maxRows, fieldSlots);
+        for (uint32_t i = 0; i < count; i++) {
+            values[i] = getValue(env, window, fieldSlots[i]);
+            if (env->ExceptionCheck()) {
+                return numRead;
+            }
+        }
+        (env->*setArrayRegion)(valuesObj, numRead, count, values);
+        numRead += count;
+    }
+    return numRead;
+}
+
+static jint nativeGetLongs(JNIEnv* env, jclass clazz, jint windowPtr,
+        jint startRow, jint column, jlongArray valuesObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting longs for column %d from row %d from %p", column, startRow, window);
+
+    return getColumnValues(env, window, startRow, column, valuesObj,
+            getFieldSlotLong, &JNIEnv::SetLongArrayRegion);
+}
+
+static jint nativeGetDoubles(JNIEnv* env, jclass clazz, jint windowPtr,
+        jint startRow, jint column, jdoubleArray valuesObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting doubles for column %d from row %d from %p", column, startRow, window);
+
+    return getColumnValues(env, window, startRow, column, valuesObj,
+            getFieldSlotDouble, &JNIEnv::SetDoubleArrayRegion);
+}
+
+static jint nativeGetTypes(JNIEnv* env, jclass clazz, jint windowPtr,
+        jint startRow, jint column, jintArray typesObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting types for column %d from row %d from %p", column, startRow, window);
+
+    return getColumnValues(env, window, startRow, column, typesObj,
+            getFieldSlotType, &JNIEnv::SetIntArrayRegion);
+}
+
 static jboolean nativePutBlob(JNIEnv* env, jclass clazz, jint windowPtr,
         jbyteArray valueObj, jint row, jint column) {
     CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
@@ -509,6 +589,12 @@ static JNINativeMethod sMethods[] =
             (void*)nativeGetDouble },
     { "nativeCopyStringToBuffer", "(IIILandroid/database/CharArrayBuffer;)V",
             (void*)nativeCopyStringToBuffer },
+    { "nativeGetLongs", "(III[J)I",
+            (void*)nativeGetLongs },
+    { "nativeGetDoubles", "(III[D)I",
+            (void*)nativeGetDoubles },
+    { "nativeGetTypes", "(III[I)I",
+            (void*)nativeGetTypes },
     { "nativePutBlob", "(I[BII)Z",
             (void*)nativePutBlob },
     { "nativePutString", "(ILjava/lang/String;II)Z",
@@ -66,6 +66,14 @@ static struct {
     jclass clazz;
 } gStringClassInfo;
 
+// Classes of the column arrays accepted by nativeExecuteBatch.
+static struct {
+    jclass longArray;
+    jclass doubleArray;
+    jclass stringArray;
+    jclass byteArrayArray;
+} gBatchColumnClassInfo;
+
 struct SQLiteConnection {
     // Open flags.
     // Must be kept in sync with the constants defined in SQLiteDatabase.java.
@@ -477,6 +485,153 @@ static jlong nativeExecuteForLastInsertedRowId(JNIEnv* env, jclass clazz,
             ? sqlite3_last_insert_rowid(connection->db) : -1;
 }
 
+// A column of values bound to one parameter for each row of a batch.
+struct BatchColumn {
+    enum {
+        TYPE_NULL,
+        TYPE_LONG,
+        TYPE_DOUBLE,
+        TYPE_STRING,
+        TYPE_BLOB,
+    };
+
+    int type;
+    jarray array;
+    jlong* longs;
+    jdouble* doubles;
+};
+
+static int bindBatchValue(JNIEnv* env, sqlite3_stmt* statement, int index,
+        const BatchColumn& column, jint row) {
+    switch (column.type) {
+    case BatchColumn::TYPE_LONG:
+        return sqlite3_bind_int64(statement, index, column.longs[row]);
+    case BatchColumn::TYPE_DOUBLE:
+        return sqlite3_bind_double(statement, index, column.doubles[row]);
+    case BatchColumn::TYPE_STRING: {
+        jstring valueString = jstring(env->GetObjectArrayElement(
+                jobjectArray(column.array), row));
+        if (!valueString) {
+            return sqlite3_bind_null(statement, index);
+        }
+        jsize valueLength = env->GetStringLength(valueString);
+        const jchar* value = env->GetStringCritical(valueString, NULL);
+        int err = sqlite3_bind_text16(statement, index, value, valueLength * sizeof(jchar),
+                SQLITE_TRANSIENT);
+        env->ReleaseStringCritical(valueString, value);
+        env->DeleteLocalRef(valueString);
+        return err;
+    }
+    case BatchColumn::TYPE_BLOB: {
+        jbyteArray valueArray = jbyteArray(env->GetObjectArrayElement(
+                jobjectArray(column.array), row));
+        if (!valueArray) {
+            return sqlite3_bind_null(statement, index);
+        }
+        jsize valueLength = env->GetArrayLength(valueArray);
+        jbyte* value = static_cast<jbyte*>(env->GetPrimitiveArrayCritical(valueArray, NULL));
+        int err = sqlite3_bind_blob(statement, index, value, valueLength, SQLITE_TRANSIENT);
+        env->ReleasePrimitiveArrayCritical(valueArray, value, JNI_ABORT);
+        env->DeleteLocalRef(valueArray);
+        return err;
+    }
+    default:
+        return sqlite3_bind_null(statement, index);
+    }
+}
+
+// Executes a statement once for each of rowCount rows.  Parameter i of the
+// statement is bound to row r of columns[i - 1], which is a long[], a double[],
+// a String[] or a byte[][] (null elements are bound to NULL), or null to bind
+// NULL in every row.  This saves the bind and execute calls of each row.
+// Returns the number of rows executed, or throws at the row that failed.
+static jint nativeExecuteBatch(JNIEnv* env, jclass clazz, jint connectionPtr,
+        jint statementPtr, jobjectArray columnsArray, jint rowCount) {
+    SQLiteConnection* connection = reinterpret_cast<SQLiteConnection*>(connectionPtr);
+    sqlite3_stmt* statement = reinterpret_cast<sqlite3_stmt*>(statementPtr);
+
+    jsize numColumns = env->GetArrayLength(columnsArray);
+    if (numColumns != sqlite3_bind_parameter_count(statement)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "The number of columns does not match the number of parameters.");
+        return 0;
+    }
+
+    BatchColumn* columns = new BatchColumn[numColumns];
+    jsize numAcquired = 0;
+    bool valid = true;
+    for (; numAcquired < numColumns && valid; numAcquired++) {
+        BatchColumn& column = columns[numAcquired];
+        column.array = jarray(env->GetObjectArrayElement(columnsArray, numAcquired));
+        column.longs = NULL;
+        column.doubles = NULL;
+        if (!column.array) {
+            column.type = BatchColumn::TYPE_NULL;
+            continue;
+        }
+        if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.longArray)) {
+            column.type = BatchColumn::TYPE_LONG;
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.doubleArray)) {
+            column.type = BatchColumn::TYPE_DOUBLE;
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.stringArray)) {
+            column.type = BatchColumn::TYPE_STRING;
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.byteArrayArray)) {
+            column.type = BatchColumn::TYPE_BLOB;
+        } else {
+            jniThrowException(env, "java/lang/IllegalArgumentException",
+                    "Unsupported column array type.");
+            valid = false;
+            continue;
+        }
+        if (env->GetArrayLength(column.array) < rowCount) {
+            jniThrowException(env, "java/lang/IllegalArgumentException",
+                    "A column has fewer values than the number of rows.");
+            valid = false;
+            continue;
+        }
+        // The values are only read, so copies of the arrays are as good.
+        if (column.type == BatchColumn::TYPE_LONG) {
+            column.longs = env->GetLongArrayElements(jlongArray(column.array), NULL);
+        } else if (column.type == BatchColumn::TYPE_DOUBLE) {
+            column.doubles = env->GetDoubleArrayElements(jdoubleArray(column.array), NULL);
+        }
+    }
+
+    jint row = 0;
+    if (valid) {
+        for (; row < rowCount; row++) {
+            int err = SQLITE_OK;
+            for (jsize i = 0; i < numColumns && err == SQLITE_OK; i++) {
+                err = bindBatchValue(env, statement, i + 1, columns[i], row);
+            }
+            if (err != SQLITE_OK) {
+                throw_sqlite3_exception(env, connection->db, NULL);
+                break;
+            }
+            err = executeNonQuery(env, connection, statement);
+            sqlite3_reset(statement);
+            if (err != SQLITE_DONE) {
+                break;
+            }
+        }
+    }
+
+    for (jsize i = 0; i < numAcquired; i++) {
+        BatchColumn& column = columns[i];
+        if (column.longs) {
+            env->ReleaseLongArrayElements(jlongArray(column.array), column.longs, JNI_ABORT);
+        } else if (column.doubles) {
+            env->ReleaseDoubleArrayElements(jdoubleArray(column.array), column.doubles,
+                    JNI_ABORT);
+        }
+        if (column.array) {
+            env->DeleteLocalRef(column.array);
+        }
+    }
+    delete[] columns;
+    return row;
+}
+
 static int executeOneRowQuery(JNIEnv* env, SQLiteConnection* connection, sqlite3_stmt* statement) {
     int err = sqlite3_step(statement);
     if (err != SQLITE_ROW) {
@@ -835,6 +990,8 @@ static JNINativeMethod sMethods[] =
             (void*)nativeExecuteForChangedRowCount },
     { "nativeExecuteForLastInsertedRowId", "(II)J",
             (void*)nativeExecuteForLastInsertedRowId },
+    { "nativeExecuteBatch", "(II[Ljava/lang/Object;I)I",
+            (void*)nativeExecuteBatch },
     { "nativeExecuteForCursorWindow", "(IIIIIZ)J",
             (void*)nativeExecuteForCursorWindow },
     { "nativeGetDbLookaside", "(I)I",
@@ -872,6 +1029,15 @@ int register_android_database_SQLiteConnection(JNIEnv *env)
     FIND_CLASS(clazz, "java/lang/String");
     gStringClassInfo.clazz = jclass(env->NewGlobalRef(clazz));
 
+    FIND_CLASS(clazz, "[J");
+    gBatchColumnClassInfo.longArray = jclass(env->NewGlobalRef(clazz));
+    FIND_CLASS(clazz, "[D");
+    gBatchColumnClassInfo.doubleArray = jclass(env->NewGlobalRef(clazz));
+    FIND_CLASS(clazz, "[Ljava/lang/String;");
+    gBatchColumnClassInfo.stringArray = jclass(env->NewGlobalRef(clazz));
+    FIND_CLASS(clazz, "[[B");
+    gBatchColumnClassInfo.byteArrayArray = jclass(env->NewGlobalRef(clazz));
+
     return AndroidRuntime::registerNativeMethods(env, "android/database/sqlite/SQLiteConnection",
             sMethods, NELEM(sMethods));
 }
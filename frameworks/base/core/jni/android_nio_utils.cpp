@@ -22,6 +22,9 @@ struct NioJNIData {
     jmethodID getBasePointerID;
     jmethodID getBaseArrayID;
     jmethodID getBaseArrayOffsetID;
+
+    jfieldID positionID;
+    jfieldID elementSizeShiftID;
 };
 
 static NioJNIData gNioJNI;
@@ -33,11 +36,13 @@ void* android::nio_getPointer(JNIEnv *_env, jobject buffer, jarray *array) {
     jint offset;
     void *data;
 
-    pointer = _env->CallStaticLongMethod(gNioJNI.nioAccessClass,
-                                         gNioJNI.getBasePointerID, buffer);
+    // Direct buffers don't need the upcall to NIOAccess.getBasePointer()
+    pointer = (jint) _env->GetDirectBufferAddress(buffer);
     if (pointer != 0L) {
+        jint position = _env->GetIntField(buffer, gNioJNI.positionID);
+        jint elementSizeShift = _env->GetIntField(buffer, gNioJNI.elementSizeShiftID);
         *array = NULL;
-        return (void *) (jint) pointer;
+        return (void *) (jint) (pointer + (position << elementSizeShift));
     }
 
     *array = (jarray) _env->CallStaticObjectMethod(gNioJNI.nioAccessClass,
@@ -107,6 +112,10 @@ int register_android_nio_utils(JNIEnv* env) {
     // now record a permanent version of the class ID
     gNioJNI.nioAccessClass = (jclass) env->NewGlobalRef(localClass);
 
+    jclass bufferClass = findClass(env, "java/nio/Buffer");
+    gNioJNI.positionID = getFieldID(env, bufferClass, "position", "I");
+    gNioJNI.elementSizeShiftID = getFieldID(env, bufferClass, "_elementSizeShift", "I");
+
     return 0;
 }
 
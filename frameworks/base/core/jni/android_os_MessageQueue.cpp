@@ -19,8 +19,11 @@
 #include "JNIHelp.h"
 #include <android_runtime/AndroidRuntime.h>
 
+#include <utils/KeyedVector.h>
 #include <utils/Looper.h>
 #include <utils/Log.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
 #include "android_os_MessageQueue.h"
 
 namespace android {
@@ -41,9 +44,62 @@ public:
 
     void wake();
 
+    virtual int addFd(int fd, int events, const sp<LooperCallback>& callback, int priority);
+    virtual int removeFd(int fd);
+
+    // Called by the looper for the file descriptors added with addFd()
+    int handleFdEvent(int fd, int events);
+
 private:
+    struct FdRegistration {
+        sp<LooperCallback> callback;
+        int priority;
+        // tells a registration apart from a later one of the same fd
+        uint32_t seq;
+    };
+
+    struct PendingFdEvent {
+        int fd;
+        int events;
+        int priority;
+        uint32_t seq;
+        sp<LooperCallback> callback;
+    };
+
+    void dispatchPendingFdEvents();
+    void unregisterFd(int fd, uint32_t seq);
+
     bool mInCallback;
     jthrowable mExceptionObj;
+
+    sp<LooperCallback> mFdCallback;
+    Mutex mFdLock;
+    KeyedVector<int, FdRegistration> mFds;
+    // sorted by priority
+    Vector<PendingFdEvent> mPendingFdEvents;
+    uint32_t mNextFdSeq;
+    bool mBatchingFdEvents;
+};
+
+/*
+ * The looper callback of the file descriptors added to a NativeMessageQueue. The
+ * looper may outlive the queue, so the queue detaches itself when destroyed.
+ */
+class MessageQueueFdCallback : public LooperCallback {
+public:
+    MessageQueueFdCallback(NativeMessageQueue* messageQueue) : mMessageQueue(messageQueue) {
+    }
+
+    virtual int handleEvent(int fd, int events, void* data) {
+        return mMessageQueue ? mMessageQueue->handleFdEvent(fd, events) : 0;
+    }
+
+    void detach() {
+        mMessageQueue = NULL;
+    }
+
+private:
+    NativeMessageQueue* mMessageQueue;
 };
 
 
@@ -64,15 +120,22 @@ bool MessageQueue::raiseAndClearException(JNIEnv* env, const char* msg) {
     return false;
 }
 
-NativeMessageQueue::NativeMessageQueue() : mInCallback(false), mExceptionObj(NULL) {
+NativeMessageQueue::NativeMessageQueue() : mInCallback(false), mExceptionObj(NULL),
+        mNextFdSeq(0), mBatchingFdEvents(false) {
     mLooper = Looper::getForThread();
     if (mLooper == NULL) {
         mLooper = new Looper(false);
         Looper::setForThread(mLooper);
     }
+    mFdCallback = new MessageQueueFdCallback(this);
 }
 
 NativeMessageQueue::~NativeMessageQueue() {
+    Mutex::Autolock _l(mFdLock);
+    for (size_t i = 0; i < mFds.size(); i++) {
+        mLooper->removeFd(mFds.keyAt(i));
+    }
+    static_cast<MessageQueueFdCallback*>(mFdCallback.get())->detach();
 }
 
 void NativeMessageQueue::raiseException(JNIEnv* env, const char* msg, jthrowable exceptionObj) {
@@ -94,7 +157,10 @@ void NativeMessageQueue::raiseException(JNIEnv* env, const char* msg, jthrowable
 
 void NativeMessageQueue::pollOnce(JNIEnv* env, int timeoutMillis) {
     mInCallback = true;
+    mBatchingFdEvents = true;
     mLooper->pollOnce(timeoutMillis);
+    mBatchingFdEvents = false;
+    dispatchPendingFdEvents();
     mInCallback = false;
     if (mExceptionObj) {
         env->Throw(mExceptionObj);
@@ -107,6 +173,107 @@ void NativeMessageQueue::wake() {
     mLooper->wake();
 }
 
+int NativeMessageQueue::addFd(int fd, int events, const sp<LooperCallback>& callback,
+        int priority) {
+    Mutex::Autolock _l(mFdLock);
+    ssize_t index = mFds.indexOfKey(fd);
+    if (index >= 0 && mFds.valueAt(index).callback == callback) {
+        // only the events change, keep any pending callback
+        mFds.editValueAt(index).priority = priority;
+    } else {
+        FdRegistration registration;
+        registration.callback = callback;
+        registration.priority = priority;
+        registration.seq = mNextFdSeq++;
+        mFds.replaceValueFor(fd, registration);
+    }
+
+    int result = mLooper->addFd(fd, 0, events, mFdCallback, NULL);
+    if (result < 0) {
+        mFds.removeItem(fd);
+    }
+    return result;
+}
+
+int NativeMessageQueue::removeFd(int fd) {
+    Mutex::Autolock _l(mFdLock);
+    if (mFds.removeItem(fd) < 0) {
+        return 0;
+    }
+    mLooper->removeFd(fd);
+    return 1;
+}
+
+void NativeMessageQueue::unregisterFd(int fd, uint32_t seq) {
+    Mutex::Autolock _l(mFdLock);
+    ssize_t index = mFds.indexOfKey(fd);
+    if (index >= 0 && mFds.valueAt(index).seq == seq) {
+        mFds.removeItemsAt(index);
+        mLooper->removeFd(fd);
+    }
+}
+
+int NativeMessageQueue::handleFdEvent(int fd, int events) {
+    PendingFdEvent event;
+    {
+        Mutex::Autolock _l(mFdLock);
+        ssize_t index = mFds.indexOfKey(fd);
+        if (index < 0) {
+            return 0;
+        }
+        const FdRegistration& registration = mFds.valueAt(index);
+        event.fd = fd;
+        event.events = events;
+        event.priority = registration.priority;
+        event.seq = registration.seq;
+        event.callback = registration.callback;
+
+        if (mBatchingFdEvents) {
+            // keep the events of the same priority in the order the looper reported them
+            size_t i = 0;
+            while (i < mPendingFdEvents.size()
+                    && mPendingFdEvents[i].priority <= event.priority) {
+                i++;
+            }
+            mPendingFdEvents.insertAt(event, i);
+            return 1;
+        }
+    }
+
+    // the looper isn't polled by the message queue, so there is nothing to batch with
+    if (!event.callback->handleEvent(fd, events, NULL)) {
+        unregisterFd(fd, event.seq);
+    }
+    return 1;
+}
+
+void NativeMessageQueue::dispatchPendingFdEvents() {
+    Vector<PendingFdEvent> events;
+    {
+        Mutex::Autolock _l(mFdLock);
+        if (mPendingFdEvents.isEmpty()) {
+            return;
+        }
+        events = mPendingFdEvents;
+        mPendingFdEvents.clear();
+    }
+
+    for (size_t i = 0; i < events.size(); i++) {
+        const PendingFdEvent& event = events[i];
+        {
+            // an earlier callback may have removed or replaced this one
+            Mutex::Autolock _l(mFdLock);
+            ssize_t index = mFds.indexOfKey(event.fd);
+            if (index < 0 || mFds.valueAt(index).seq != event.seq) {
+                continue;
+            }
+        }
+        if (!event.callback->handleEvent(event.fd, event.events, NULL)) {
+            unregisterFd(event.fd, event.seq);
+        }
+    }
+}
+
 // ----------------------------------------------------------------------------
 
 sp<MessageQueue> android_os_MessageQueue_getMessageQueue(JNIEnv* env, jobject messageQueueObj) {
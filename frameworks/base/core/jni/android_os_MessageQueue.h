@@ -54,6 +54,33 @@ public:
      */
     virtual void raiseException(JNIEnv* env, const char* msg, jthrowable exceptionObj) = 0;
 
+    /* Dispatch priorities of the file descriptor callbacks, the lowest first. */
+    enum {
+        FD_PRIORITY_INPUT = 0,
+        FD_PRIORITY_DISPLAY_EVENT = 1,
+        FD_PRIORITY_DEFAULT = 2,
+    };
+
+    /* Adds a file descriptor to the looper, or replaces its callback, like Looper::addFd().
+     *
+     * When the message queue polls the looper, the callbacks of all the file descriptors
+     * that became ready are run together once the looper returns, in order of priority,
+     * so that input is handled before display events that arrived in the same poll.
+     * Other pollers of the looper get the callbacks immediately.
+     *
+     * A callback that returns 0 removes its file descriptor.
+     *
+     * Returns 1 if the file descriptor was added, -1 if an error occurred.
+     */
+    virtual int addFd(int fd, int events, const sp<LooperCallback>& callback, int priority) = 0;
+
+    /* Removes a file descriptor added with addFd(). Its pending callback, if any, is
+     * not run.
+     *
+     * Returns 1 if the file descriptor was removed, 0 if none was previously registered.
+     */
+    virtual int removeFd(int fd) = 0;
+
 protected:
     MessageQueue();
     virtual ~MessageQueue();
@@ -87,8 +87,8 @@ status_t NativeDisplayEventReceiver::initialize() {
         return result;
     }
 
-    int rc = mMessageQueue->getLooper()->addFd(mReceiver.getFd(), 0, ALOOPER_EVENT_INPUT,
-            this, NULL);
+    int rc = mMessageQueue->addFd(mReceiver.getFd(), ALOOPER_EVENT_INPUT,
+            this, MessageQueue::FD_PRIORITY_DISPLAY_EVENT);
     if (rc < 0) {
         return UNKNOWN_ERROR;
     }
@@ -99,7 +99,7 @@ void NativeDisplayEventReceiver::dispose() {
     ALOGV("receiver %p ~ Disposing display event receiver.", this);
 
     if (!mReceiver.initCheck()) {
-        mMessageQueue->getLooper()->removeFd(mReceiver.getFd());
+        mMessageQueue->removeFd(mReceiver.getFd());
     }
 }
 
@@ -405,6 +405,17 @@ static void android_view_GLES20Canvas_drawBitmapMatrix(JNIEnv* env, jobject claz
     renderer->drawBitmap(bitmap, matrix, paint);
 }
 
+static void android_view_GLES20Canvas_drawPicture(JNIEnv* env, jobject clazz,
+        OpenGLRenderer* renderer, SkPicture* picture) {
+    // Pictures are drawn through a bitmap, rasterized once and kept with the
+    // picture, so that display lists and the texture cache can reuse it
+    SkBitmap* bitmap = GraphicsJNI::getPictureBitmap(picture,
+            Caches::getInstance().maxTextureSize);
+    if (bitmap) {
+        renderer->drawBitmap(bitmap, 0.0f, 0.0f, NULL);
+    }
+}
+
 static void android_view_GLES20Canvas_drawBitmapData(JNIEnv* env, jobject clazz,
         OpenGLRenderer* renderer, jintArray colors, jint offset, jint stride,
         jfloat left, jfloat top, jint width, jint height, jboolean hasAlpha, SkPaint* paint) {
@@ -1058,6 +1069,7 @@ static JNINativeMethod gMethods[] = {
     { "nDrawBitmap",        "(II[BII)V",       (void*) android_view_GLES20Canvas_drawBitmapMatrix },
     { "nDrawBitmap",        "(I[IIIFFIIZI)V",  (void*) android_view_GLES20Canvas_drawBitmapData },
 
+    { "nDrawPicture",       "(II)V",           (void*) android_view_GLES20Canvas_drawPicture },
     { "nDrawBitmapMesh",    "(II[BII[FI[III)V",(void*) android_view_GLES20Canvas_drawBitmapMesh },
 
     { "nDrawPatch",         "(II[BIFFFFI)V",   (void*) android_view_GLES20Canvas_drawPatch },
@@ -142,6 +142,12 @@ static void android_view_HardwareRenderer_setupShadersDiskCache(JNIEnv* env, job
 
     const char* cacheArray = env->GetStringUTFChars(diskCachePath, NULL);
     egl_cache_t::get()->setCacheFilename(cacheArray);
+#ifdef USE_OPENGL_RENDERER
+    // hwui saves the programs it uses next to the EGL shaders cache
+    String8 programsCache(String8(cacheArray).getPathDir());
+    programsCache.appendPath("com.android.hwui.programs_cache");
+    uirenderer::ProgramCache::setPersistentCacheFile(programsCache.string());
+#endif
     env->ReleaseStringUTFChars(diskCachePath, cacheArray);
 }
 
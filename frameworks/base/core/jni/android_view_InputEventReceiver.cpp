@@ -147,9 +147,9 @@ void NativeInputEventReceiver::setFdEvents(int events) {
         mFdEvents = events;
         int fd = mInputConsumer.getChannel()->getFd();
         if (events) {
-            mMessageQueue->getLooper()->addFd(fd, 0, events, this, NULL);
+            mMessageQueue->addFd(fd, events, this, MessageQueue::FD_PRIORITY_INPUT);
         } else {
-            mMessageQueue->getLooper()->removeFd(fd);
+            mMessageQueue->removeFd(fd);
         }
     }
 }
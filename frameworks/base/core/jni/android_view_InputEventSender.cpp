@@ -94,7 +94,7 @@ NativeInputEventSender::~NativeInputEventSender() {
 
 status_t NativeInputEventSender::initialize() {
     int receiveFd = mInputPublisher.getChannel()->getFd();
-    mMessageQueue->getLooper()->addFd(receiveFd, 0, ALOOPER_EVENT_INPUT, this, NULL);
+    mMessageQueue->addFd(receiveFd, ALOOPER_EVENT_INPUT, this, MessageQueue::FD_PRIORITY_INPUT);
     return OK;
 }
 
@@ -103,7 +103,7 @@ void NativeInputEventSender::dispose() {
     ALOGD("channel '%s' ~ Disposing input event sender.", getInputChannelName());
 #endif
 
-    mMessageQueue->getLooper()->removeFd(mInputPublisher.getChannel()->getFd());
+    mMessageQueue->removeFd(mInputPublisher.getChannel()->getFd());
 }
 
 status_t NativeInputEventSender::sendKeyEvent(uint32_t seq, const KeyEvent* event) {
@@ -125,11 +125,11 @@ getPointer(JNIEnv *_env, jobject buffer, jarray *array, jint *remaining, jint *o
     limit = _env->GetIntField(buffer, limitID);
     elementSizeShift = _env->GetIntField(buffer, elementSizeShiftID);
     *remaining = (limit - position) << elementSizeShift;
-    pointer = _env->CallStaticLongMethod(nioAccessClass,
-            getBasePointerID, buffer);
+    // Direct buffers don't need the upcall to NIOAccess.getBasePointer()
+    pointer = (jint) _env->GetDirectBufferAddress(buffer);
     if (pointer != 0L) {
         *array = NULL;
-        return (void *) (jint) pointer;
+        return (void *) (jint) (pointer + (position << elementSizeShift));
     }
 
     *array = (jarray) _env->CallStaticObjectMethod(nioAccessClass,
@@ -113,6 +113,15 @@ public:
      */
     FieldSlot* getFieldSlot(uint32_t row, uint32_t column);
 
+    /**
+     * Gets the field slots of a column in up to maxRows rows, starting at startRow.
+     * The row slot chunks are walked once, rather than once per row as with getFieldSlot.
+     * Returns the number of slots stored in outFieldSlots, which is less than maxRows
+     * when the window ends before, or 0 if the row or column is not in the window.
+     */
+    uint32_t getColumnFieldSlots(uint32_t startRow, uint32_t column, uint32_t maxRows,
+            FieldSlot** outFieldSlots);
+
     inline int32_t getFieldSlotType(FieldSlot* fieldSlot) {
         return fieldSlot->type;
     }
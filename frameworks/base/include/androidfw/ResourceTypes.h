@@ -1287,6 +1287,8 @@ public:
                  bool copyData=false, const void* idmap = NULL);
     status_t add(Asset* asset, void* cookie,
                  bool copyData=false, const void* idmap = NULL);
+    // Adds the packages of src without parsing them again.  They are
+    // shared with src, which must outlive this table.
     status_t add(ResTable* src);
 
     status_t getError() const;
@@ -1568,6 +1570,7 @@ private:
     struct Package;
     struct PackageGroup;
     struct bag_set;
+    struct ResolvedEntry;
 
     status_t add(const void* data, size_t size, void* cookie,
                  Asset* asset, bool copyData, const Asset* idmap);
@@ -1589,6 +1592,10 @@ private:
 
     ResTable_config             mParams;
 
+    // Incremented whenever a lookup may give a different result, which
+    // invalidates the entries cached by getResource().
+    volatile int32_t            mGeneration;
+
     // Array of all resource tables.
     Vector<Header*>             mHeaders;
 
@@ -22,6 +22,7 @@
 #include <zlib.h>
 
 #include <utils/Compat.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -30,6 +31,11 @@ public:
     static const size_t INPUT_CHUNK_SIZE = 64 * 1024;
     static const size_t OUTPUT_CHUNK_SIZE = 64 * 1024;
 
+    // The inflater state is saved every CHECKPOINT_INTERVAL bytes of output
+    // or more, so that at most MAX_CHECKPOINTS are kept.
+    static const size_t CHECKPOINT_INTERVAL = 1024 * 1024;
+    static const size_t MAX_CHECKPOINTS = 16;
+
     // Flavor that pages in the compressed data from a fd
     StreamingZipInflater(int fd, off64_t compDataStart, size_t uncompSize, size_t compSize);
 
@@ -42,14 +48,23 @@ public:
     // be NULL, in which case the data is consumed and discarded.
     ssize_t read(void* outBuf, size_t count);
 
-    // seeking backwards requires uncompressing fom the beginning, so is very
-    // expensive.  seeking forwards only requires uncompressing from the current
-    // position to the destination.
+    // seeking backwards within the last decoded chunk is free, otherwise it
+    // requires uncompressing from the last checkpoint before the destination.
+    // seeking forwards only requires uncompressing from the current position
+    // to the destination.
     off64_t seekAbsolute(off64_t absoluteInputPosition);
 
 private:
+    struct Checkpoint {
+        off64_t outPosition;    // uncompressed offset of the saved state
+        size_t inOffset;        // offset from start of blob of the next input byte
+        z_stream* state;
+    };
+
     void initInflateState();
     int readNextChunk();
+    void addCheckpoint();
+    bool restoreCheckpoint(off64_t position);
 
     // where to find the uncompressed data
     int mFd;
@@ -77,6 +92,11 @@ private:
     // input state bookkeeping
     size_t mInNextChunkOffset;  // offset from start of blob at which the next input chunk lies
     // the z_stream contains state about input block consumption
+
+    // seek bookkeeping
+    Vector<Checkpoint> mCheckpoints;    // in increasing outPosition order
+    size_t mCheckpointInterval;
+    bool mSequential;           // no backwards seek happened yet
 };
 
 }
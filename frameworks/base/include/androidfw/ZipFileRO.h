@@ -58,6 +58,11 @@ typedef void* ZipEntryRO;
  * filename, so we don't need to extract those (but we do need to byte-read
  * and endian-swap them every time we want them).
  *
+ * The hash table is only built by the first lookup, so that opening an
+ * archive doesn't touch every page of its Central Directory.  Opening only
+ * checks the End of Central Directory record; a Central Directory found bad
+ * by the first lookup makes every lookup fail.
+ *
  * To speed comparisons when doing a lookup by name, we could make the mapping
  * "private" (copy-on-write) and null-terminate the filenames after verifying
  * the record structure.  However, this requires a private mapping of
@@ -74,7 +79,8 @@ public:
         : mFd(-1), mFileName(NULL), mFileLength(-1),
           mDirectoryMap(NULL),
           mNumEntries(-1), mDirectoryOffset(-1),
-          mHashTableSize(-1), mHashTable(NULL)
+          mHashTableSize(-1), mHashTable(NULL), mEntryIndex(NULL),
+          mIndexState(kIndexNone)
         {}
 
     ~ZipFileRO();
@@ -107,9 +113,6 @@ public:
      * rather than the Nth entry in the archive.
      *
      * Valid values are [0..numEntries).
-     *
-     * [This is currently O(n).  If it needs to be fast we can allocate an
-     * additional data structure or provide an iterator interface.]
      */
     ZipEntryRO findEntryByIndex(int idx) const;
 
@@ -210,8 +213,11 @@ private:
     /* parse the archive, prepping internal structures */
     bool parseZipArchive(void);
 
-    /* add a new entry to the hash table */
-    void addToHash(const char* str, int strLen, unsigned int hash);
+    /* parse the archive if it isn't yet, returns false if it is bad */
+    bool ensureIndex(void) const;
+
+    /* add a new entry to the hash table, returns its index */
+    int addToHash(const char* str, int strLen, unsigned int hash);
 
     /* compute string hash code */
     static unsigned int computeHash(const char* str, int len);
@@ -255,6 +261,14 @@ private:
      */
     int         mHashTableSize;
     HashEntry*  mHashTable;
+
+    /* hash table index of each entry, in Central Directory order */
+    int*        mEntryIndex;
+
+    /* state of the hash table, built by ensureIndex() */
+    enum { kIndexNone, kIndexReady, kIndexBad };
+    mutable Mutex mIndexLock;
+    mutable volatile int32_t mIndexState;
 };
 
 }; // namespace android
@@ -17,6 +17,8 @@
 #ifndef ANDROID_HWUI_DRAW_GL_INFO_H
 #define ANDROID_HWUI_DRAW_GL_INFO_H
 
+#include <stdint.h>
+
 namespace android {
 namespace uirenderer {
 
@@ -47,6 +49,12 @@ struct DrawGlInfo {
     float dirtyRight;
     float dirtyBottom;
 
+    // Output: GL state modified by the functor, a combination of the
+    // State flags. Set to kStateAll before the call; a functor that
+    // leaves some of the state untouched, or restores it itself, can
+    // clear the matching flags so the renderer does not restore it.
+    uint32_t modifiedState;
+
     /**
      * Values used as the "what" parameter of the functor.
      */
@@ -81,6 +89,22 @@ struct DrawGlInfo {
         // commands are issued.
         kStatusDrew = 0x4
     };
+
+    /**
+     * GL state the renderer restores after a functor, used
+     * in modifiedState.
+     */
+    enum State {
+        kStateViewport = 0x1,
+        kStateFramebuffer = 0x2,
+        // Scissor test, scissor box and stencil
+        kStateClip = 0x4,
+        kStateBlend = 0x8,
+        // Active texture unit and texture bindings
+        kStateTexture = 0x10,
+        kStateClearColor = 0x20,
+        kStateAll = 0xffffffff
+    };
 }; // struct DrawGlInfo
 
 }; // namespace uirenderer
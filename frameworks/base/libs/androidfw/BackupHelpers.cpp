@@ -21,8 +21,11 @@
 #include <utils/KeyedVector.h>
 #include <utils/ByteOrder.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <sys/stat.h>
@@ -30,10 +33,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
 #include <utime.h>
 #include <fcntl.h>
 #include <zlib.h>
 
+#include <cutils/atomic.h>
 #include <cutils/log.h>
 
 namespace android {
@@ -68,6 +73,21 @@ struct file_metadata_v1 {
 
 const static int CURRENT_METADATA_VERSION = 1;
 
+// Threads reading and checksumming files during back_up_files()
+const static int MAX_CRC_THREADS = 4;
+
+// Age in seconds a modification time needs before it can be trusted to
+// change along with the content of the file
+const static int MIN_TRUSTED_MTIME_AGE = 2;
+
+struct BackupStats {
+    int unchanged;
+    int hashed;
+    int written;
+    int64_t bytesHashed;
+    int64_t bytesWritten;
+};
+
 #if 1
 #define LOGP(f, x...)
 #else
@@ -213,11 +233,11 @@ write_delete_file(BackupDataWriter* dataStream, const String8& key)
 
 static int
 write_update_file(BackupDataWriter* dataStream, int fd, int mode, const String8& key,
-        char const* realFilename)
+        char const* realFilename, int* outCrc, BackupStats* stats)
 {
     LOGP("write_update_file %s (%s) : mode 0%o\n", realFilename, key.string(), mode);
 
-    const int bufsize = 4*1024;
+    const int bufsize = 64*1024;
     int err;
     int amt;
     int fileSize;
@@ -230,6 +250,7 @@ write_update_file(BackupDataWriter* dataStream, int fd, int mode, const String8&
 
     fileSize = lseek(fd, 0, SEEK_END);
     lseek(fd, 0, SEEK_SET);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
 
     if (sizeof(metadata) != 16) {
         ALOGE("ERROR: metadata block is the wrong size!");
@@ -253,12 +274,14 @@ write_update_file(BackupDataWriter* dataStream, int fd, int mode, const String8&
     }
     bytesLeft -= sizeof(metadata); // bytesLeft should == fileSize now
 
-    // now store the file content
-    while ((amt = read(fd, buf, bufsize)) != 0 && bytesLeft > 0) {
+    // now store the file content, the checksum for the new snapshot is computed
+    // on the way so the file is only read once
+    while ((amt = read(fd, buf, bufsize)) > 0 && bytesLeft > 0) {
         bytesLeft -= amt;
         if (bytesLeft < 0) {
             amt += bytesLeft; // Plus a negative is minus.  Don't write more than we promised.
         }
+        crc = crc32(crc, (Bytef*)buf, amt);
         err = dataStream->WriteEntityData(buf, amt);
         if (err != 0) {
             free(buf);
@@ -284,12 +307,22 @@ write_update_file(BackupDataWriter* dataStream, int fd, int mode, const String8&
                 " You aren't doing proper locking!", realFilename, fileSize, fileSize-bytesLeft);
     }
 
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
     free(buf);
+
+    if (outCrc != NULL) {
+        *outCrc = crc;
+    }
+    if (stats != NULL) {
+        stats->written++;
+        stats->bytesWritten += fileSize;
+    }
     return NO_ERROR;
 }
 
 static int
-write_update_file(BackupDataWriter* dataStream, const String8& key, char const* realFilename)
+write_update_file(BackupDataWriter* dataStream, const String8& key, char const* realFilename,
+        int* outCrc, BackupStats* stats)
 {
     int err;
     struct stat st;
@@ -304,7 +337,7 @@ write_update_file(BackupDataWriter* dataStream, const String8& key, char const*
         return errno;
     }
 
-    err = write_update_file(dataStream, fd, st.st_mode, key, realFilename);
+    err = write_update_file(dataStream, fd, st.st_mode, key, realFilename, outCrc, stats);
     close(fd);
     return err;
 }
@@ -312,15 +345,16 @@ write_update_file(BackupDataWriter* dataStream, const String8& key, char const*
 static int
 compute_crc32(int fd)
 {
-    const int bufsize = 4*1024;
+    const int bufsize = 64*1024;
     int amt;
 
     char* buf = (char*)malloc(bufsize);
     int crc = crc32(0L, Z_NULL, 0);
 
     lseek(fd, 0, SEEK_SET);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
 
-    while ((amt = read(fd, buf, bufsize)) != 0) {
+    while ((amt = read(fd, buf, bufsize)) > 0) {
         crc = crc32(crc, (Bytef*)buf, amt);
     }
 
@@ -328,6 +362,89 @@ compute_crc32(int fd)
     return crc;
 }
 
+static long
+get_mtime_nsec(const struct stat& st)
+{
+#ifdef __USE_MISC
+    return st.st_mtim.tv_nsec;
+#else
+    return st.st_mtime_nsec;
+#endif
+}
+
+static inline bool
+same_metadata(const FileState& f, const FileState& g)
+{
+    return f.modTime_sec == g.modTime_sec && f.mode == g.mode && f.size == g.size;
+}
+
+// A modification time of 0 ns means the time could not be trusted when the
+// snapshot was written
+static inline bool
+unchanged_by_metadata(const FileState& f, const FileState& g)
+{
+    return same_metadata(f, g) && f.modTime_nsec != 0 && f.modTime_nsec == g.modTime_nsec;
+}
+
+/*
+ * Checksums of the files whose metadata alone doesn't tell whether they
+ * changed. The files are read by a few threads at once, which keeps the
+ * storage busy and spreads the crc32 work over the cores.
+ */
+struct CrcJob {
+    const char* file;
+    int crc32;
+    bool opened;
+};
+
+struct CrcJobQueue {
+    CrcJob* jobs;
+    int32_t count;
+    volatile int32_t next;
+};
+
+static void*
+crc_worker(void* arg)
+{
+    CrcJobQueue* queue = (CrcJobQueue*)arg;
+    int32_t i;
+    while ((i = android_atomic_inc(&queue->next)) < queue->count) {
+        CrcJob& job = queue->jobs[i];
+        int fd = open(job.file, O_RDONLY);
+        job.opened = fd >= 0;
+        if (job.opened) {
+            job.crc32 = compute_crc32(fd);
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+static void
+compute_crc32_parallel(CrcJob* jobs, int count)
+{
+    CrcJobQueue queue = { jobs, count, 0 };
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCount = count < MAX_CRC_THREADS ? count : MAX_CRC_THREADS;
+    if (cpus > 0 && threadCount > cpus) {
+        threadCount = cpus;
+    }
+
+    // the calling thread is one of the workers
+    pthread_t threads[MAX_CRC_THREADS];
+    int started = 0;
+    for (int i=1; i<threadCount; i++) {
+        if (pthread_create(&threads[started], NULL, crc_worker, &queue) == 0) {
+            started++;
+        }
+    }
+    crc_worker(&queue);
+    for (int i=0; i<started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
 int
 back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD,
         char const* const* files, char const* const* keys, int fileCount)
@@ -335,6 +452,9 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
     int err;
     KeyedVector<String8,FileState> oldSnapshot;
     KeyedVector<String8,FileRec> newSnapshot;
+    BackupStats stats;
+    memset(&stats, 0, sizeof(stats));
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
     if (oldSnapshotFD != -1) {
         err = read_snapshot_file(oldSnapshotFD, &oldSnapshot);
@@ -344,6 +464,10 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
         }
     }
 
+    // A file written in the same second as it is backed up can be written
+    // again without its modification time changing, don't trust it later
+    const time_t now = time(NULL);
+
     for (int i=0; i<fileCount; i++) {
         String8 key(keys[i]);
         FileRec r;
@@ -357,11 +481,14 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
         } else {
             r.deleted = false;
             r.s.modTime_sec = st.st_mtime;
-            r.s.modTime_nsec = 0; // workaround sim breakage
-            //r.s.modTime_nsec = st.st_mtime_nsec;
+            r.s.modTime_nsec = 0;
+            if (now - st.st_mtime >= MIN_TRUSTED_MTIME_AGE) {
+                r.s.modTime_nsec = get_mtime_nsec(st);
+            }
             r.s.mode = st.st_mode;
             r.s.size = st.st_size;
-            // we compute the crc32 later down below, when we already have the file open.
+            // the crc32 is carried over, computed below or computed while writing the file
+            r.s.crc32 = 0;
 
             if (newSnapshot.indexOfKey(key) >= 0) {
                 LOGP("back_up_files key already in use '%s'", key.string());
@@ -371,9 +498,42 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
         newSnapshot.add(key, r);
     }
 
+    // Sort out the files present in both snapshots. A file with a different
+    // size, mode or modification time is backed up again, one whose precise
+    // modification time is also unchanged is not even read. Only the others
+    // need their content checked.
+    Vector<int> crcIndices;
+    Vector<CrcJob> crcJobs;
+    for (int m=0; m<fileCount; m++) {
+        FileRec& g = newSnapshot.editValueAt(m);
+        ssize_t n = g.deleted ? -1 : oldSnapshot.indexOfKey(newSnapshot.keyAt(m));
+        if (n < 0) {
+            continue;
+        }
+        const FileState& f = oldSnapshot.valueAt(n);
+        if (!same_metadata(f, g.s)) {
+            continue;
+        }
+        if (unchanged_by_metadata(f, g.s)) {
+            stats.unchanged++;
+        } else {
+            CrcJob job = { g.file.string(), 0, false };
+            crcIndices.add(m);
+            crcJobs.add(job);
+        }
+    }
+    if (crcJobs.size() > 0) {
+        compute_crc32_parallel(crcJobs.editArray(), crcJobs.size());
+        for (size_t i=0; i<crcJobs.size(); i++) {
+            stats.hashed++;
+            stats.bytesHashed += newSnapshot.valueAt(crcIndices[i]).s.size;
+        }
+    }
+
     int n = 0;
     int N = oldSnapshot.size();
     int m = 0;
+    size_t nextCrc = 0;
 
     while (n<N && m<fileCount) {
         const String8& p = oldSnapshot.keyAt(n);
@@ -390,33 +550,45 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
         else if (cmp > 0) {
             // file added
             LOGP("file added: %s", g.file.string());
-            write_update_file(dataStream, q, g.file.string());
+            write_update_file(dataStream, q, g.file.string(), &g.s.crc32, &stats);
             m++;
         }
         else {
             // both files exist, check them
             const FileState& f = oldSnapshot.valueAt(n);
+            const CrcJob* job = NULL;
+            while (nextCrc < crcIndices.size() && crcIndices[nextCrc] < m) {
+                nextCrc++;
+            }
+            if (nextCrc < crcIndices.size() && crcIndices[nextCrc] == m) {
+                job = &crcJobs[nextCrc++];
+            }
 
-            int fd = open(g.file.string(), O_RDONLY);
-            if (fd < 0) {
+            LOGP("%s", q.string());
+            LOGP("  new: modTime=%d,%d mode=%04o size=%-3d crc32=0x%08x",
+                    f.modTime_sec, f.modTime_nsec, f.mode, f.size, f.crc32);
+            LOGP("  old: modTime=%d,%d mode=%04o size=%-3d crc32=0x%08x",
+                    g.s.modTime_sec, g.s.modTime_nsec, g.s.mode, g.s.size,
+                    job != NULL ? job->crc32 : g.s.crc32);
+
+            if (job != NULL && !job->opened) {
                 // We can't open the file.  Don't report it as a delete either.  Let the
                 // server keep the old version.  Maybe they'll be able to deal with it
-                // on restore.
+                // on restore.  Keep the old state so that it is checked again next time.
                 LOGP("Unable to open file %s - skipping", g.file.string());
+                g.s = f;
+            } else if (job != NULL ? job->crc32 == f.crc32 : unchanged_by_metadata(f, g.s)) {
+                g.s.crc32 = f.crc32;
             } else {
-                g.s.crc32 = compute_crc32(fd);
-
-                LOGP("%s", q.string());
-                LOGP("  new: modTime=%d,%d mode=%04o size=%-3d crc32=0x%08x",
-                        f.modTime_sec, f.modTime_nsec, f.mode, f.size, f.crc32);
-                LOGP("  old: modTime=%d,%d mode=%04o size=%-3d crc32=0x%08x",
-                        g.s.modTime_sec, g.s.modTime_nsec, g.s.mode, g.s.size, g.s.crc32);
-                if (f.modTime_sec != g.s.modTime_sec || f.modTime_nsec != g.s.modTime_nsec
-                        || f.mode != g.s.mode || f.size != g.s.size || f.crc32 != g.s.crc32) {
-                    write_update_file(dataStream, fd, g.s.mode, p, g.file.string());
+                int fd = open(g.file.string(), O_RDONLY);
+                if (fd < 0) {
+                    LOGP("Unable to open file %s - skipping", g.file.string());
+                    g.s = f;
+                } else {
+                    write_update_file(dataStream, fd, g.s.mode, p, g.file.string(),
+                            &g.s.crc32, &stats);
+                    close(fd);
                 }
-
-                close(fd);
             }
             n++;
             m++;
@@ -433,12 +605,20 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
     while (m<fileCount) {
         const String8& q = newSnapshot.keyAt(m);
         FileRec& g = newSnapshot.editValueAt(m);
-        write_update_file(dataStream, q, g.file.string());
+        write_update_file(dataStream, q, g.file.string(), &g.s.crc32, &stats);
         m++;
     }
 
     err = write_snapshot_file(newSnapshotFD, newSnapshot);
 
+    const nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    const int64_t bytesRead = stats.bytesHashed + stats.bytesWritten;
+    ALOGI("back_up_files: %d files, %d unchanged, %d checksummed (%lld bytes),"
+            " %d written (%lld bytes) in %lld ms, %.1f MB/s",
+            fileCount, stats.unchanged, stats.hashed, (long long) stats.bytesHashed,
+            stats.written, (long long) stats.bytesWritten, (long long) ns2ms(elapsed),
+            elapsed > 0 ? bytesRead * 1000.0 / elapsed : 0.0);
+
     return 0;
 }
 
@@ -535,7 +715,6 @@ int write_tarfile(const String8& packageName, const String8& domain,
     const int isdir = S_ISDIR(s.st_mode);
     if (isdir) s.st_size = 0;   // directories get no actual data in the tar stream
 
-    // !!! TODO: use mmap when possible to avoid churning the buffer cache
     // !!! TODO: this will break with symlinks; need to use readlink(2)
     int fd = open(filepath.string(), O_RDONLY);
     if (fd < 0) {
@@ -544,6 +723,11 @@ int write_tarfile(const String8& packageName, const String8& domain,
         return err;
     }
 
+    // The file is read once from start to end: let the kernel read ahead,
+    // and drop the pages afterwards so the backup doesn't churn the buffer cache
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
     // read/write up to this much at a time.
     const size_t BUFSIZE = 32 * 1024;
     char* buf = (char *)calloc(1,BUFSIZE);
@@ -707,11 +891,17 @@ int write_tarfile(const String8& packageName, const String8& domain,
             send_tarfile_chunk(writer, buf, nRead);
             toWrite -= nRead;
         }
+
+        const nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+        ALOGV("   %lld bytes in %lld ms, %.1f MB/s", (long long) s.st_size,
+                (long long) ns2ms(elapsed),
+                elapsed > 0 ? s.st_size * 1000.0 / elapsed : 0.0);
     }
 
 cleanup:
     free(buf);
 done:
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
     close(fd);
     return err;
 }
@@ -1586,6 +1776,132 @@ backup_helper_test_missing_file()
 }
 
 
+static int
+back_up_scratch_files(int oldSnapshotFD, const char* dataName, const char* snapName,
+        char const* const* files, char const* const* keys, int fileCount)
+{
+    int err;
+    int dataStreamFD;
+    int newSnapshotFD;
+
+    dataStreamFD = creat(dataName, 0666);
+    if (dataStreamFD == -1) {
+        fprintf(stderr, "error creating: %s\n", strerror(errno));
+        return errno;
+    }
+
+    newSnapshotFD = creat(snapName, 0666);
+    if (newSnapshotFD == -1) {
+        fprintf(stderr, "error creating: %s\n", strerror(errno));
+        return errno;
+    }
+
+    {
+        BackupDataWriter dataStream(dataStreamFD);
+
+        err = back_up_files(oldSnapshotFD, &dataStream, newSnapshotFD, files, keys, fileCount);
+    }
+
+    close(dataStreamFD);
+    close(newSnapshotFD);
+
+    return err;
+}
+
+int
+backup_helper_test_unchanged_files()
+{
+    int err;
+    int oldSnapshotFD;
+    int dataStreamFD;
+
+    system("rm -r " SCRATCH_DIR);
+    mkdir(SCRATCH_DIR, 0777);
+    mkdir(SCRATCH_DIR "data", 0777);
+
+    write_text_file(SCRATCH_DIR "data/a", "a\naa\n");
+    write_text_file(SCRATCH_DIR "data/b", "b\nbb\n");
+
+    // old enough for the modification times to be trusted
+    struct timeval times[2];
+    times[0].tv_sec = times[1].tv_sec = time(NULL) - 60;
+    times[0].tv_usec = times[1].tv_usec = 500000;
+    utimes(SCRATCH_DIR "data/a", times);
+    utimes(SCRATCH_DIR "data/b", times);
+
+    char const* files[] = {
+        SCRATCH_DIR "data/a", // same
+        SCRATCH_DIR "data/b"  // different contents (same size, same mod time in seconds)
+    };
+
+    char const* keys[] = {
+        "data/a",
+        "data/b"
+    };
+
+    err = back_up_scratch_files(-1, SCRATCH_DIR "unchanged_1.data",
+            SCRATCH_DIR "unchanged_1.snap", files, keys, 2);
+    if (err != 0) {
+        return err;
+    }
+
+    write_text_file(SCRATCH_DIR "data/b", "b\nbc\n");
+    times[1].tv_usec = 250000;
+    utimes(SCRATCH_DIR "data/b", times);
+
+    oldSnapshotFD = open(SCRATCH_DIR "unchanged_1.snap", O_RDONLY);
+    if (oldSnapshotFD == -1) {
+        fprintf(stderr, "error opening: %s\n", strerror(errno));
+        return errno;
+    }
+
+    err = back_up_scratch_files(oldSnapshotFD, SCRATCH_DIR "unchanged_2.data",
+            SCRATCH_DIR "unchanged_2.snap", files, keys, 2);
+    close(oldSnapshotFD);
+    if (err != 0) {
+        return err;
+    }
+
+    // only data/b is in the second backup
+    dataStreamFD = open(SCRATCH_DIR "unchanged_2.data", O_RDONLY);
+    if (dataStreamFD == -1) {
+        fprintf(stderr, "error opening: %s\n", strerror(errno));
+        return errno;
+    }
+
+    {
+        BackupDataReader reader(dataStreamFD);
+        bool done;
+        int type;
+        int count = 0;
+        String8 key;
+        size_t dataSize;
+
+        while ((err = reader.ReadNextHeader(&done, &type)) == NO_ERROR && !done) {
+            err = reader.ReadEntityHeader(&key, &dataSize);
+            if (err != NO_ERROR) {
+                break;
+            }
+            if (key != "data/b") {
+                fprintf(stderr, "unexpected entity '%s'\n", key.string());
+                err = EINVAL;
+                break;
+            }
+            reader.SkipEntityData();
+            count++;
+        }
+        if (err == NO_ERROR && count != 1) {
+            fprintf(stderr, "expected 1 entity, got %d\n", count);
+            err = EINVAL;
+        }
+    }
+
+    close(dataStreamFD);
+
+    return err;
+}
+
+
 #endif // TEST_BACKUP_HELPERS
 
 }
@@ -270,6 +270,38 @@ CursorWindow::FieldSlot* CursorWindow::getFieldSlot(uint32_t row, uint32_t colum
     return &fieldDir[column];
 }
 
+uint32_t CursorWindow::getColumnFieldSlots(uint32_t startRow, uint32_t column,
+        uint32_t maxRows, FieldSlot** outFieldSlots) {
+    if (startRow >= mHeader->numRows || column >= mHeader->numColumns) {
+        ALOGE("Failed to read row %d, column %d from a CursorWindow which "
+                "has %d rows, %d columns.",
+                startRow, column, mHeader->numRows, mHeader->numColumns);
+        return 0;
+    }
+    uint32_t numRows = mHeader->numRows - startRow;
+    if (numRows > maxRows) {
+        numRows = maxRows;
+    }
+
+    uint32_t chunkPos = startRow;
+    RowSlotChunk* chunk = static_cast<RowSlotChunk*>(
+            offsetToPtr(mHeader->firstChunkOffset));
+    while (chunkPos >= ROW_SLOT_CHUNK_NUM_ROWS) {
+        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
+        chunkPos -= ROW_SLOT_CHUNK_NUM_ROWS;
+    }
+    for (uint32_t i = 0; i < numRows; i++) {
+        if (chunkPos == ROW_SLOT_CHUNK_NUM_ROWS) {
+            chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
+            chunkPos = 0;
+        }
+        FieldSlot* fieldDir = static_cast<FieldSlot*>(
+                offsetToPtr(chunk->slots[chunkPos++].offset));
+        outFieldSlots[i] = &fieldDir[column];
+    }
+    return numRows;
+}
+
 status_t CursorWindow::putBlob(uint32_t row, uint32_t column, const void* value, size_t size) {
     return putBlobOrString(row, column, value, size, FIELD_TYPE_BLOB);
 }
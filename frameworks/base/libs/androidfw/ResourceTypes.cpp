@@ -2507,15 +2507,61 @@ struct ResTable::Package
     }
 };
 
+// The value found by getResource() for an entry with the default density.
+// It is valid while seq is the tag of the table generation, and read and
+// written without the table lock: seq is odd while a thread writes the
+// entry, and a reader that sees seq change while copying it discards it.
+struct ResTable::ResolvedEntry
+{
+    volatile int32_t seq;
+    uint32_t specFlags;
+    const ResTable_type* type;
+    uint32_t offset;
+    ssize_t packageIndex;
+
+    static int32_t tagOf(int32_t generation) {
+        // never 0, the seq of the entries never written
+        return (int32_t)(((uint32_t)generation << 1) + 2);
+    }
+
+    bool read(int32_t tag, ResolvedEntry* outEntry) const {
+        const int32_t s = android_atomic_acquire_load(&seq);
+        if (s != tag) {
+            return false;
+        }
+        outEntry->specFlags = specFlags;
+        outEntry->type = type;
+        outEntry->offset = offset;
+        outEntry->packageIndex = packageIndex;
+        android_memory_barrier();
+        return seq == s && outEntry->type != NULL;
+    }
+
+    void write(int32_t tag, uint32_t _specFlags, const ResTable_type* _type,
+            uint32_t _offset, ssize_t _packageIndex) {
+        const int32_t s = seq;
+        if ((s & 1) != 0 || android_atomic_acquire_cas(s, s | 1, &seq) != 0) {
+            // another thread is writing it
+            return;
+        }
+        specFlags = _specFlags;
+        type = _type;
+        offset = _offset;
+        packageIndex = _packageIndex;
+        android_atomic_release_store(tag, &seq);
+    }
+};
+
 // A group of objects describing a particular resource package.
 // The first in 'package' is always the root object (from the resource
 // table that defined the package); the ones after are skins on top of it.
 struct ResTable::PackageGroup
 {
     PackageGroup(ResTable* _owner, const String16& _name, uint32_t _id)
-        : owner(_owner), name(_name), id(_id), typeCount(0), bags(NULL) { }
+        : owner(_owner), name(_name), id(_id), typeCount(0), bags(NULL), resolved(NULL) { }
     ~PackageGroup() {
         clearBagCache();
+        clearResolvedCache();
         const size_t N = packages.size();
         for (size_t i=0; i<N; i++) {
             Package* pkg = packages[i];
@@ -2551,7 +2597,55 @@ struct ResTable::PackageGroup
             bags = NULL;
         }
     }
-    
+
+    void clearResolvedCache() {
+        if (resolved) {
+            for (size_t i=0; i<typeCount; i++) {
+                free(resolved[i]);
+            }
+            free((void*)resolved);
+            resolved = NULL;
+        }
+    }
+
+    // Returns the cache slot of an entry, allocating the cache of its type
+    // if needed.  This is called without the table lock, threads allocating
+    // the same array at the same time keep the first one published.
+    ResolvedEntry* getResolvedEntry(int t, int e) {
+        if (packages.size() == 0 || (size_t)t >= typeCount) {
+            return NULL;
+        }
+        const Type* type = packages[0]->getType(t);
+        if (type == NULL || (size_t)e >= type->entryCount) {
+            return NULL;
+        }
+
+        ResolvedEntry* volatile* types = resolved;
+        if (types == NULL) {
+            types = (ResolvedEntry* volatile*)calloc(typeCount, sizeof(ResolvedEntry*));
+            if (types == NULL) {
+                return NULL;
+            }
+            if (!__sync_bool_compare_and_swap(&resolved, NULL, types)) {
+                free((void*)types);
+                types = resolved;
+            }
+        }
+
+        ResolvedEntry* entries = types[t];
+        if (entries == NULL) {
+            entries = (ResolvedEntry*)calloc(type->entryCount, sizeof(ResolvedEntry));
+            if (entries == NULL) {
+                return NULL;
+            }
+            if (!__sync_bool_compare_and_swap(&types[t], NULL, entries)) {
+                free(entries);
+                entries = types[t];
+            }
+        }
+        return &entries[e];
+    }
+
     ResTable* const                 owner;
     String16 const                  name;
     uint32_t const                  id;
@@ -2566,6 +2660,9 @@ struct ResTable::PackageGroup
     // Computed attribute bags, first indexed by the type and second
     // by the entry in that type.
     bag_set***                      bags;
+
+    // Values resolved by getResource(), indexed like the bags.
+    ResolvedEntry* volatile*        resolved;
 };
 
 struct ResTable::bag_set
@@ -2853,7 +2950,7 @@ void ResTable::Theme::dumpToLog() const
 }
 
 ResTable::ResTable()
-    : mError(NO_INIT)
+    : mError(NO_INIT), mGeneration(0)
 {
     memset(&mParams, 0, sizeof(mParams));
     memset(mPackageMap, 0, sizeof(mPackageMap));
@@ -2861,7 +2958,7 @@ ResTable::ResTable()
 }
 
 ResTable::ResTable(const void* data, size_t size, void* cookie, bool copyData)
-    : mError(NO_INIT)
+    : mError(NO_INIT), mGeneration(0)
 {
     memset(&mParams, 0, sizeof(mParams));
     memset(mPackageMap, 0, sizeof(mPackageMap));
@@ -2901,24 +2998,38 @@ status_t ResTable::add(Asset* asset, void* cookie, bool copyData, const void* id
 status_t ResTable::add(ResTable* src)
 {
     mError = src->mError;
-    
+    android_atomic_inc(&mGeneration);
+
+    // The headers and packages stay owned by src: they are only read, so
+    // the processes forked from the one that parsed src share them.
     for (size_t i=0; i<src->mHeaders.size(); i++) {
         mHeaders.add(src->mHeaders[i]);
     }
-    
-    for (size_t i=0; i<src->mPackageGroups.size(); i++) {
-        PackageGroup* srcPg = src->mPackageGroups[i];
-        PackageGroup* pg = new PackageGroup(this, srcPg->name, srcPg->id);
+
+    for (size_t id=0; id<sizeof(mPackageMap); id++) {
+        const size_t srcIdx = src->mPackageMap[id];
+        if (srcIdx == 0) {
+            continue;
+        }
+        const PackageGroup* srcPg = src->mPackageGroups[srcIdx-1];
+        size_t idx = mPackageMap[id];
+        PackageGroup* pg;
+        if (idx == 0) {
+            pg = new PackageGroup(this, srcPg->name, srcPg->id);
+            pg->basePackage = srcPg->basePackage;
+            pg->typeCount = srcPg->typeCount;
+            mPackageGroups.add(pg);
+            mPackageMap[id] = (uint8_t)mPackageGroups.size();
+        } else {
+            // src overlays a package this table already has
+            pg = mPackageGroups[idx-1];
+            pg->clearBagCache();
+        }
         for (size_t j=0; j<srcPg->packages.size(); j++) {
             pg->packages.add(srcPg->packages[j]);
         }
-        pg->basePackage = srcPg->basePackage;
-        pg->typeCount = srcPg->typeCount;
-        mPackageGroups.add(pg);
     }
-    
-    memcpy(mPackageMap, src->mPackageMap, sizeof(mPackageMap));
-    
+
     return mError;
 }
 
@@ -2926,6 +3037,8 @@ status_t ResTable::add(const void* data, size_t size, void* cookie,
                        Asset* asset, bool copyData, const Asset* idmap)
 {
     if (!data) return NO_ERROR;
+    // an overlay package added to an existing group changes its values
+    android_atomic_inc(&mGeneration);
     Header* header = new Header(this);
     header->index = mHeaders.size();
     header->cookie = cookie;
@@ -3173,19 +3286,46 @@ ssize_t ResTable::getResource(uint32_t resID, Res_value* outValue, bool mayBeBag
 
     const Res_value* bestValue = NULL;
     const Package* bestPackage = NULL;
+    const ResTable_type* bestType = NULL;
     ResTable_config bestItem;
     memset(&bestItem, 0, sizeof(bestItem)); // make the compiler shut up
 
+    uint32_t specFlags = 0;
     if (outSpecFlags != NULL) *outSpecFlags = 0;
 
     // Look through all resource packages, starting with the most
     // recently added.
-    const PackageGroup* const grp = mPackageGroups[p];
+    PackageGroup* const grp = mPackageGroups[p];
     if (grp == NULL) {
         ALOGW("Bad identifier when getting value for resource number 0x%08x", resID);
         return BAD_INDEX;
     }
 
+    // The lookups with the configuration of the table are resolved once per
+    // generation.  The generation is read before mParams, see setParameters().
+    ResolvedEntry* resolved = NULL;
+    int32_t resolvedTag = 0;
+    if (density == 0) {
+        resolvedTag = ResolvedEntry::tagOf(android_atomic_acquire_load(&mGeneration));
+        resolved = grp->getResolvedEntry(t, e);
+        ResolvedEntry hit;
+        if (resolved != NULL && resolved->read(resolvedTag, &hit)) {
+            const Res_value* value =
+                (const Res_value*)(((const uint8_t*)hit.type) + hit.offset);
+            outValue->size = dtohs(value->size);
+            outValue->res0 = value->res0;
+            outValue->dataType = value->dataType;
+            outValue->data = dtohl(value->data);
+            if (outConfig != NULL) {
+                outConfig->copyFromDtoH(hit.type->config);
+            }
+            if (outSpecFlags != NULL) {
+                *outSpecFlags = hit.specFlags;
+            }
+            return hit.packageIndex;
+        }
+    }
+
     // Allow overriding density
     const ResTable_config* desiredConfig = &mParams;
     ResTable_config* overrideConfig = NULL;
@@ -3265,12 +3405,13 @@ ssize_t ResTable::getResource(uint32_t resID, Res_value* outValue, bool mayBeBag
         ResTable_config thisConfig;
         thisConfig.copyFromDtoH(type->config);
 
+        if (typeClass->typeSpecFlags != NULL) {
+            specFlags |= dtohl(typeClass->typeSpecFlags[E]);
+        } else {
+            specFlags = -1;
+        }
         if (outSpecFlags != NULL) {
-            if (typeClass->typeSpecFlags != NULL) {
-                *outSpecFlags |= dtohl(typeClass->typeSpecFlags[E]);
-            } else {
-                *outSpecFlags = -1;
-            }
+            *outSpecFlags = specFlags;
         }
 
         if (bestPackage != NULL &&
@@ -3283,6 +3424,7 @@ ssize_t ResTable::getResource(uint32_t resID, Res_value* outValue, bool mayBeBag
         bestItem = thisConfig;
         bestValue = item;
         bestPackage = package;
+        bestType = type;
     }
 
     TABLE_NOISY(printf("Found result: package %p\n", bestPackage));
@@ -3305,6 +3447,10 @@ ssize_t ResTable::getResource(uint32_t resID, Res_value* outValue, bool mayBeBag
                      : "",
                      outValue->data));
         rc = bestPackage->header->index;
+        if (resolved != NULL) {
+            resolved->write(resolvedTag, specFlags, bestType,
+                    ((const uint8_t*)bestValue) - ((const uint8_t*)bestType), rc);
+        }
         goto out;
     }
 
@@ -3684,6 +3830,8 @@ void ResTable::setParameters(const ResTable_config* params)
         TABLE_NOISY(ALOGI("CLEARING BAGS FOR GROUP %d!", i));
         mPackageGroups[i]->clearBagCache();
     }
+    // after mParams, so that a lookup seeing the new generation uses them
+    android_atomic_inc(&mGeneration);
     mLock.unlock();
 }
 
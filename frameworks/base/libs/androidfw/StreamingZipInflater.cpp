@@ -42,6 +42,7 @@
 #endif
 
 static inline size_t min_of(size_t a, size_t b) { return (a < b) ? a : b; }
+static inline size_t max_of(size_t a, size_t b) { return (a > b) ? a : b; }
 
 using namespace android;
 
@@ -62,6 +63,8 @@ StreamingZipInflater::StreamingZipInflater(int fd, off64_t compDataStart,
     mOutBufSize = StreamingZipInflater::OUTPUT_CHUNK_SIZE;
     mOutBuf = new uint8_t[mOutBufSize];
 
+    mCheckpointInterval = max_of(CHECKPOINT_INTERVAL, mOutTotalSize / MAX_CHECKPOINTS);
+    mSequential = true;
     initInflateState();
 }
 
@@ -80,6 +83,11 @@ StreamingZipInflater::StreamingZipInflater(FileMap* dataMap, size_t uncompSize)
     mOutBufSize = StreamingZipInflater::OUTPUT_CHUNK_SIZE;
     mOutBuf = new uint8_t[mOutBufSize];
 
+    // the data is paged in as it is inflated, read it ahead until the
+    // first backwards seek
+    mDataMap->advise(FileMap::SEQUENTIAL);
+    mCheckpointInterval = max_of(CHECKPOINT_INTERVAL, mOutTotalSize / MAX_CHECKPOINTS);
+    mSequential = true;
     initInflateState();
 }
 
@@ -87,6 +95,11 @@ StreamingZipInflater::~StreamingZipInflater() {
     // tear down the in-flight zip state just in case
     ::inflateEnd(&mInflateState);
 
+    for (size_t i = 0; i < mCheckpoints.size(); i++) {
+        ::inflateEnd(mCheckpoints[i].state);
+        delete mCheckpoints[i].state;
+    }
+
     if (mDataMap == NULL) {
         delete [] mInBuf;
     }
@@ -149,6 +162,13 @@ ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
 
         // need more data?  time to decode some.
         if (toRead > 0) {
+            // mOutBuf is drained, so the stream is exactly at mOutCurPosition
+            if (!mStreamNeedsInit && mCheckpoints.size() < MAX_CHECKPOINTS &&
+                    mOutCurPosition >= (mCheckpoints.isEmpty() ? 0
+                            : mCheckpoints.top().outPosition) + (off64_t) mCheckpointInterval) {
+                addCheckpoint();
+            }
+
             // if we don't have any data to decode, read some in.  If we're working
             // from mmapped data this won't happen, because the clipping to total size
             // will prevent reading off the end of the mapped input chunk.
@@ -223,17 +243,98 @@ int StreamingZipInflater::readNextChunk() {
     return 0;
 }
 
-// seeking backwards requires uncompressing fom the beginning, so is very
-// expensive.  seeking forwards only requires uncompressing from the current
-// position to the destination.
+/*
+ * Saves the state of the stream at mOutCurPosition, which must be the start
+ * of the next chunk to decode.
+ */
+void StreamingZipInflater::addCheckpoint() {
+    Checkpoint cp;
+    cp.outPosition = mOutCurPosition;
+    if (mDataMap == NULL) {
+        cp.inOffset = mInNextChunkOffset - mInflateState.avail_in;
+    } else {
+        cp.inOffset = mInflateState.next_in - mInBuf;
+    }
+    cp.state = new z_stream;
+    if (::inflateCopy(cp.state, &mInflateState) != Z_OK) {
+        // not fatal, the seeks just go back further
+        ALOGW("Unable to save inflater state at %lld", (long long) mOutCurPosition);
+        delete cp.state;
+        return;
+    }
+    ALOGV("Checkpoint at %lld, input offset %zu", (long long) cp.outPosition, cp.inOffset);
+    mCheckpoints.push(cp);
+}
+
+/*
+ * Restarts the stream from the last checkpoint at or before position.
+ * Returns false if there is none, which leaves the stream unchanged.
+ */
+bool StreamingZipInflater::restoreCheckpoint(off64_t position) {
+    ssize_t i = mCheckpoints.size() - 1;
+    while (i >= 0 && mCheckpoints[i].outPosition > position) {
+        i--;
+    }
+    if (i < 0) {
+        return false;
+    }
+
+    const Checkpoint& cp(mCheckpoints[i]);
+    if (!mStreamNeedsInit) {
+        ::inflateEnd(&mInflateState);
+    }
+    initInflateState();
+    if (::inflateCopy(&mInflateState, cp.state) != Z_OK) {
+        ALOGW("Unable to restore inflater state at %lld", (long long) cp.outPosition);
+        initInflateState();
+        return false;
+    }
+    mStreamNeedsInit = false;
+
+    mInflateState.next_out = (Bytef*) mOutBuf;
+    mInflateState.avail_out = mOutBufSize;
+    if (mDataMap == NULL) {
+        ::lseek(mFd, mInFileStart + cp.inOffset, SEEK_SET);
+        mInNextChunkOffset = cp.inOffset;
+        mInflateState.next_in = (Bytef*) mInBuf;
+        mInflateState.avail_in = 0;
+    } else {
+        mInflateState.next_in = (Bytef*) mInBuf + cp.inOffset;
+        mInflateState.avail_in = mInBufSize - cp.inOffset;
+    }
+    mOutCurPosition = cp.outPosition;
+    return true;
+}
+
+// seeking backwards within the decoded chunk only moves the delivery pointer,
+// further back it restarts from the closest checkpoint, or from the beginning.
+// seeking forwards only requires uncompressing from the current position to
+// the destination.
 off64_t StreamingZipInflater::seekAbsolute(off64_t absoluteInputPosition) {
     if (absoluteInputPosition < mOutCurPosition) {
-        // rewind and reprocess the data from the beginning
-        if (!mStreamNeedsInit) {
-            ::inflateEnd(&mInflateState);
+        const off64_t chunkStart = mOutCurPosition - mOutDeliverable;
+        if (absoluteInputPosition >= chunkStart) {
+            mOutDeliverable = absoluteInputPosition - chunkStart;
+            mOutCurPosition = absoluteInputPosition;
+            return absoluteInputPosition;
         }
-        initInflateState();
-        read(NULL, absoluteInputPosition);
+
+        if (mSequential) {
+            // the reads jump around, stop reading ahead
+            mSequential = false;
+            if (mDataMap != NULL) {
+                mDataMap->advise(FileMap::NORMAL);
+            }
+        }
+
+        if (!restoreCheckpoint(absoluteInputPosition)) {
+            // rewind and reprocess the data from the beginning
+            if (!mStreamNeedsInit) {
+                ::inflateEnd(&mInflateState);
+            }
+            initInflateState();
+        }
+        read(NULL, absoluteInputPosition - mOutCurPosition);
     } else if (absoluteInputPosition > mOutCurPosition) {
         read(NULL, absoluteInputPosition - mOutCurPosition);
     }
@@ -20,6 +20,7 @@
 #define LOG_TAG "zipro"
 //#define LOG_NDEBUG 0
 #include <androidfw/ZipFileRO.h>
+#include <utils/Atomic.h>
 #include <utils/Log.h>
 #include <utils/Compat.h>
 #include <utils/misc.h>
@@ -92,6 +93,7 @@ using namespace android;
 
 ZipFileRO::~ZipFileRO() {
     free(mHashTable);
+    free(mEntryIndex);
     if (mDirectoryMap)
         mDirectoryMap->release();
     if (mFd >= 0)
@@ -155,12 +157,9 @@ status_t ZipFileRO::open(const char* zipFileName)
     }
 
     /*
-     * Verify Central Directory and create data structures for fast access.
+     * The Central Directory is verified, and the data structures for fast
+     * access are created, by the first lookup.
      */
-    if (!parseZipArchive()) {
-        goto bail;
-    }
-
     return OK;
 
 bail:
@@ -353,6 +352,11 @@ bool ZipFileRO::parseZipArchive(void)
      */
     mHashTableSize = roundUpPower2(1 + (numEntries * 4) / 3);
     mHashTable = (HashEntry*) calloc(mHashTableSize, sizeof(HashEntry));
+    mEntryIndex = (int*) malloc(numEntries * sizeof(int));
+    if (mHashTable == NULL || mEntryIndex == NULL) {
+        ALOGW("couldn't allocate the index of %d entries", numEntries);
+        goto bail;
+    }
 
     /*
      * Walk through the central directory, adding entries to the hash
@@ -395,7 +399,7 @@ bool ZipFileRO::parseZipArchive(void)
 
         /* add the CDE filename to the hash table */
         unsigned int hash = computeHash(name, nameLen);
-        addToHash(name, nameLen, hash);
+        mEntryIndex[i] = addToHash(name, nameLen, hash);
 
         /* We don't care about the comment or extra data. */
         ptr += kCDELen + nameLen + extraLen + commentLen;
@@ -412,6 +416,28 @@ bail:
     return result;
 }
 
+bool ZipFileRO::ensureIndex(void) const
+{
+    int32_t state = android_atomic_acquire_load(&mIndexState);
+    if (state == kIndexNone) {
+        AutoMutex _l(mIndexLock);
+        state = mIndexState;
+        if (state == kIndexNone) {
+            // the archive looks the same from the outside whether it is
+            // indexed or not
+            ZipFileRO* self = const_cast<ZipFileRO*>(this);
+            state = self->parseZipArchive() ? kIndexReady : kIndexBad;
+            if (state == kIndexBad) {
+                ALOGW("Bad central directory in zip '%s'\n", mFileName);
+                // lookups see an empty table
+                self->mHashTableSize = -1;
+            }
+            android_atomic_release_store(state, &mIndexState);
+        }
+    }
+    return state == kIndexReady;
+}
+
 /*
  * Simple string hash function for non-null-terminated strings.
  */
@@ -428,7 +454,7 @@ bail:
 /*
  * Add a new entry to the hash table.
  */
-void ZipFileRO::addToHash(const char* str, int strLen, unsigned int hash)
+int ZipFileRO::addToHash(const char* str, int strLen, unsigned int hash)
 {
     int ent = hash & (mHashTableSize-1);
 
@@ -440,6 +466,7 @@ void ZipFileRO::addToHash(const char* str, int strLen, unsigned int hash)
 
     mHashTable[ent].name = str;
     mHashTable[ent].nameLen = strLen;
+    return ent;
 }
 
 /*
@@ -453,7 +480,7 @@ ZipEntryRO ZipFileRO::findEntryByName(const char* fileName) const
      * If the ZipFileRO instance is not initialized, the entry number will
      * end up being garbage since mHashTableSize is -1.
      */
-    if (mHashTableSize <= 0) {
+    if (mDirectoryMap == NULL || !ensureIndex() || mHashTableSize <= 0) {
         return NULL;
     }
 
@@ -476,11 +503,7 @@ ZipEntryRO ZipFileRO::findEntryByName(const char* fileName) const
 }
 
 /*
- * Find the Nth entry.
- *
- * This currently involves walking through the sparse hash table, counting
- * non-empty entries.  If we need to speed this up we can either allocate
- * a parallel lookup table or (perhaps better) provide an iterator interface.
+ * Find the Nth entry, in Central Directory order.
  */
 ZipEntryRO ZipFileRO::findEntryByIndex(int idx) const
 {
@@ -488,15 +511,11 @@ ZipEntryRO ZipFileRO::findEntryByIndex(int idx) const
         ALOGW("Invalid index %d\n", idx);
         return NULL;
     }
-
-    for (int ent = 0; ent < mHashTableSize; ent++) {
-        if (mHashTable[ent].name != NULL) {
-            if (idx-- == 0)
-                return (ZipEntryRO) (intptr_t)(ent + kZipEntryAdj);
-        }
+    if (mDirectoryMap == NULL || !ensureIndex()) {
+        return NULL;
     }
 
-    return NULL;
+    return (ZipEntryRO) (intptr_t)(mEntryIndex[idx] + kZipEntryAdj);
 }
 
 /*
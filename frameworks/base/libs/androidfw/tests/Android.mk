@@ -4,6 +4,7 @@ include $(CLEAR_VARS)
 
 # Build the unit tests.
 test_src_files := \
+    CursorWindow_test.cpp \
     ObbFile_test.cpp \
     ZipFileRO_test.cpp
 
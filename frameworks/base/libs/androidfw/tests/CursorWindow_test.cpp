@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CursorWindow_test"
+#include <androidfw/CursorWindow.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+class CursorWindowTest : public testing::Test {
+protected:
+    enum { NUM_ROWS = 1234, NUM_COLUMNS = 3 };
+
+    CursorWindow* mWindow;
+
+    virtual void SetUp() {
+        ASSERT_EQ(OK, CursorWindow::create(String8("test"), 2 * 1024 * 1024, &mWindow));
+        ASSERT_EQ(OK, mWindow->setNumColumns(NUM_COLUMNS));
+        for (uint32_t row = 0; row < NUM_ROWS; row++) {
+            ASSERT_EQ(OK, mWindow->allocRow());
+            ASSERT_EQ(OK, mWindow->putLong(row, 1, row * 7));
+        }
+    }
+
+    virtual void TearDown() {
+        delete mWindow;
+    }
+};
+
+TEST_F(CursorWindowTest, GetColumnFieldSlots) {
+    CursorWindow::FieldSlot* slots[300];
+    for (uint32_t start = 0; start < NUM_ROWS; start += 97) {
+        uint32_t count = mWindow->getColumnFieldSlots(start, 1, 300, slots);
+        EXPECT_EQ(NUM_ROWS - start < 300 ? NUM_ROWS - start : 300, count)
+                << "Wrong number of slots from row " << start;
+        for (uint32_t i = 0; i < count; i++) {
+            EXPECT_EQ(mWindow->getFieldSlot(start + i, 1), slots[i]);
+            EXPECT_EQ(int64_t((start + i) * 7), mWindow->getFieldSlotValueLong(slots[i]));
+        }
+    }
+}
+
+TEST_F(CursorWindowTest, GetColumnFieldSlotsOutOfWindow) {
+    CursorWindow::FieldSlot* slots[10];
+    EXPECT_EQ(0U, mWindow->getColumnFieldSlots(NUM_ROWS, 1, 10, slots));
+    EXPECT_EQ(0U, mWindow->getColumnFieldSlots(0, NUM_COLUMNS, 10, slots));
+}
+
+}
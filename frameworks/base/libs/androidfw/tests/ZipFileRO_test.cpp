@@ -21,19 +21,130 @@
 #include <gtest/gtest.h>
 
 #include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 namespace android {
 
 class ZipFileROTest : public testing::Test {
 protected:
     virtual void SetUp() {
+        mPath[0] = '\0';
     }
 
     virtual void TearDown() {
+        if (mPath[0] != '\0') {
+            unlink(mPath);
+        }
     }
+
+    static void put2LE(unsigned char* buf, unsigned int val) {
+        buf[0] = val & 0xff;
+        buf[1] = (val >> 8) & 0xff;
+    }
+
+    static void put4LE(unsigned char* buf, unsigned int val) {
+        put2LE(buf, val & 0xffff);
+        put2LE(buf + 2, val >> 16);
+    }
+
+    // Writes a zip archive of "count" stored entries named "entry<N>", each
+    // holding its own name.  If badEntry is in range, the Central Directory
+    // signature of that entry is broken.
+    void writeArchive(int count, int badEntry = -1) {
+        strcpy(mPath, "/data/local/tmp/ZipFileRO_test_XXXXXX");
+        int fd = mkstemp(mPath);
+        ASSERT_GE(fd, 0);
+
+        unsigned char* data = (unsigned char*) calloc(count, 128);
+        unsigned char* cd = (unsigned char*) calloc(count, 128);
+        size_t dataLen = 0;
+        size_t cdLen = 0;
+        for (int i = 0; i < count; i++) {
+            char name[32];
+            int nameLen = snprintf(name, sizeof(name), "entry%d", i);
+
+            unsigned char* lfh = data + dataLen;
+            put4LE(lfh, 0x04034b50);
+            put4LE(lfh + 18, nameLen);      // compressed length
+            put4LE(lfh + 22, nameLen);      // uncompressed length
+            put2LE(lfh + 26, nameLen);
+            memcpy(lfh + 30, name, nameLen);
+            memcpy(lfh + 30 + nameLen, name, nameLen);
+
+            unsigned char* cde = cd + cdLen;
+            put4LE(cde, i == badEntry ? 0 : 0x02014b50);
+            put4LE(cde + 20, nameLen);
+            put4LE(cde + 24, nameLen);
+            put2LE(cde + 28, nameLen);
+            put4LE(cde + 42, dataLen);
+            memcpy(cde + 46, name, nameLen);
+
+            dataLen += 30 + 2 * nameLen;
+            cdLen += 46 + nameLen;
+        }
+
+        unsigned char eocd[22];
+        memset(eocd, 0, sizeof(eocd));
+        put4LE(eocd, 0x06054b50);
+        put2LE(eocd + 8, count);
+        put2LE(eocd + 10, count);
+        put4LE(eocd + 12, cdLen);
+        put4LE(eocd + 16, dataLen);
+
+        EXPECT_EQ((ssize_t) dataLen, write(fd, data, dataLen));
+        EXPECT_EQ((ssize_t) cdLen, write(fd, cd, cdLen));
+        EXPECT_EQ((ssize_t) sizeof(eocd), write(fd, eocd, sizeof(eocd)));
+        close(fd);
+        free(data);
+        free(cd);
+    }
+
+    char mPath[64];
 };
 
+TEST_F(ZipFileROTest, FindEntries) {
+    const int count = 1000;
+    writeArchive(count);
+
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mPath));
+    ASSERT_EQ(count, zip.getNumEntries());
+
+    char name[32];
+    char found[32];
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "entry%d", i);
+        ZipEntryRO entry = zip.findEntryByName(name);
+        ASSERT_TRUE(entry != NULL) << name;
+        EXPECT_EQ(entry, zip.findEntryByIndex(i))
+                << "Entries are indexed in Central Directory order.";
+        ASSERT_EQ(0, zip.getEntryFileName(entry, found, sizeof(found)));
+        EXPECT_STREQ(name, found);
+
+        size_t uncompLen = 0;
+        off64_t offset = 0;
+        EXPECT_TRUE(zip.getEntryInfo(entry, NULL, &uncompLen, NULL, &offset, NULL, NULL));
+        EXPECT_EQ(strlen(name), uncompLen);
+    }
+
+    EXPECT_TRUE(zip.findEntryByName("entry") == NULL);
+    EXPECT_TRUE(zip.findEntryByName("entry1000") == NULL);
+    EXPECT_TRUE(zip.findEntryByIndex(count) == NULL);
+}
+
+TEST_F(ZipFileROTest, BadCentralDirectory) {
+    writeArchive(10, 5);
+
+    // the Central Directory is only parsed by the first lookup
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mPath));
+
+    EXPECT_TRUE(zip.findEntryByName("entry0") == NULL);
+    EXPECT_TRUE(zip.findEntryByIndex(0) == NULL);
+}
+
 TEST_F(ZipFileROTest, ZipTimeConvertSuccess) {
     struct tm t;
 
@@ -11,6 +11,7 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		font/CacheTexture.cpp \
 		font/Font.cpp \
 		AssetAtlas.cpp \
+		CacheBudget.cpp \
 		FontRenderer.cpp \
 		GammaFontRenderer.cpp \
 		Caches.cpp \
@@ -19,8 +20,10 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		DisplayListLogBuffer.cpp \
 		DisplayListRenderer.cpp \
 		Dither.cpp \
+		DynamicAtlas.cpp \
 		Extensions.cpp \
 		FboCache.cpp \
+		FrameProfiler.cpp \
 		GradientCache.cpp \
 		Image.cpp \
 		Layer.cpp \
@@ -41,6 +44,7 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		SkiaShader.cpp \
 		Snapshot.cpp \
 		Stencil.cpp \
+		TessellationCache.cpp \
 		Texture.cpp \
 		TextureCache.cpp \
 		TextDropShadowCache.cpp
@@ -84,27 +84,6 @@ Texture* AssetAtlas::getEntryTexture(SkBitmap* const bitmap) const {
     return index >= 0 ? mEntries.valueAt(index)->texture : NULL;
 }
 
-/**
- * Delegates changes to wrapping and filtering to the base atlas texture
- * instead of applying the changes to the virtual textures.
- */
-struct DelegateTexture: public Texture {
-    DelegateTexture(Caches& caches, Texture* delegate): Texture(caches), mDelegate(delegate) { }
-
-    virtual void setWrapST(GLenum wrapS, GLenum wrapT, bool bindTexture = false,
-            bool force = false, GLenum renderTarget = GL_TEXTURE_2D) {
-        mDelegate->setWrapST(wrapS, wrapT, bindTexture, force, renderTarget);
-    }
-
-    virtual void setFilterMinMag(GLenum min, GLenum mag, bool bindTexture = false,
-            bool force = false, GLenum renderTarget = GL_TEXTURE_2D) {
-        mDelegate->setFilterMinMag(min, mag, bindTexture, force, renderTarget);
-    }
-
-private:
-    Texture* const mDelegate;
-}; // struct DelegateTexture
-
 /**
  * TODO: This method does not take the rotation flag into account
  */
@@ -131,7 +110,8 @@ void AssetAtlas::createEntries(Caches& caches, int* map, int count) {
         texture->width = bitmap->width();
         texture->height = bitmap->height();
 
-        Entry* entry = new Entry(bitmap, x, y, rotated, texture, mapper, *this);
+        Entry* entry = new Entry(bitmap, x, y, rotated, texture, mapper,
+                &mBlendKey, &mOpaqueKey);
         texture->uvMapper = &entry->uvMapper;
 
         mEntries.add(entry->bitmap, entry);
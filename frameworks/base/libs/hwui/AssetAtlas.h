@@ -36,6 +36,27 @@ namespace uirenderer {
 
 class Caches;
 
+/**
+ * Delegates changes to wrapping and filtering to the base atlas texture
+ * instead of applying the changes to the virtual textures.
+ */
+struct DelegateTexture: public Texture {
+    DelegateTexture(Caches& caches, Texture* delegate): Texture(caches), mDelegate(delegate) { }
+
+    virtual void setWrapST(GLenum wrapS, GLenum wrapT, bool bindTexture = false,
+            bool force = false, GLenum renderTarget = GL_TEXTURE_2D) {
+        mDelegate->setWrapST(wrapS, wrapT, bindTexture, force, renderTarget);
+    }
+
+    virtual void setFilterMinMag(GLenum min, GLenum mag, bool bindTexture = false,
+            bool force = false, GLenum renderTarget = GL_TEXTURE_2D) {
+        mDelegate->setFilterMinMag(min, mag, bindTexture, force, renderTarget);
+    }
+
+private:
+    Texture* const mDelegate;
+}; // struct DelegateTexture
+
 /**
  * An asset atlas holds a collection of framework bitmaps in a single OpenGL
  * texture. Each bitmap is associated with a location, defined in pixels,
@@ -79,31 +100,33 @@ public:
          */
         const UvMapper uvMapper;
 
-        /**
-         * Atlas this entry belongs to.
-         */
-        const AssetAtlas& atlas;
-
         /**
          * Unique identifier used to merge bitmaps and 9-patches stored
-         * in the atlas.
+         * in the same atlas texture.
          */
         const void* getMergeId() const {
-            return texture->blend ? &atlas.mBlendKey : &atlas.mOpaqueKey;
+            return texture->blend ? mBlendKey : mOpaqueKey;
         }
 
     private:
         Entry(SkBitmap* bitmap, int x, int y, bool rotated,
-                Texture* texture, const UvMapper& mapper, const AssetAtlas& atlas):
+                Texture* texture, const UvMapper& mapper,
+                const void* blendKey, const void* opaqueKey):
                 bitmap(bitmap), x(x), y(y), rotated(rotated),
-                texture(texture), uvMapper(mapper), atlas(atlas) {
+                texture(texture), uvMapper(mapper),
+                mBlendKey(blendKey), mOpaqueKey(opaqueKey) {
         }
 
         ~Entry() {
             delete texture;
         }
 
+        // Keys of the atlas texture this entry belongs to
+        const void* const mBlendKey;
+        const void* const mOpaqueKey;
+
         friend class AssetAtlas;
+        friend class DynamicAtlas;
     };
 
     AssetAtlas(): mTexture(NULL), mImage(NULL), mGenerationId(0),
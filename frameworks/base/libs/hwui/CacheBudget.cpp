@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <stdlib.h>
+
+#include <cutils/properties.h>
+#include <utils/Log.h>
+
+#include "CacheBudget.h"
+#include "Properties.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Number of frames without growth after which a cache is considered idle
+#define IDLE_FRAME_COUNT 60
+
+// Fraction of the budget kept free to let caches grow between two updates
+#define RESERVE_RATIO 16
+
+// Debug
+#if DEBUG_CACHE_BUDGET
+    #define BUDGET_LOGD(...) ALOGD(__VA_ARGS__)
+#else
+    #define BUDGET_LOGD(...)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+CacheBudget::CacheBudget(): mBudget(0) {
+}
+
+CacheBudget::~CacheBudget() {
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        delete mCaches[i];
+    }
+}
+
+void CacheBudget::init() {
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_CACHE_BUDGET, property, NULL) > 0) {
+        INIT_LOGD("  Setting caches budget to %sMB", property);
+        mBudget = MB(atof(property));
+    } else {
+        INIT_LOGD("  Caches budget disabled");
+    }
+}
+
+void CacheBudget::addCache(BudgetedCache* cache) {
+    cache->lastSize = cache->getSize();
+    mCaches.add(cache);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Budget
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t CacheBudget::getTotalSize() {
+    uint32_t total = 0;
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        total += mCaches[i]->getSize();
+    }
+    return total;
+}
+
+void CacheBudget::update() {
+    if (!isEnabled()) return;
+
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        BudgetedCache* cache = mCaches[i];
+        const uint32_t size = cache->getSize();
+        if (size > cache->lastSize) {
+            cache->idleFrames = 0;
+        } else if (cache->idleFrames < IDLE_FRAME_COUNT) {
+            cache->idleFrames++;
+        }
+        cache->lastSize = size;
+    }
+
+    uint32_t total = getTotalSize();
+    const uint32_t reserve = mBudget / RESERVE_RATIO;
+
+    if (total + reserve > mBudget) {
+        // Reclaim from the idle cache holding the most memory per unit of
+        // regeneration cost. Caches evict from their least recently used end
+        BudgetedCache* victim = NULL;
+        uint32_t victimScore = 0;
+        for (size_t i = 0; i < mCaches.size(); i++) {
+            BudgetedCache* cache = mCaches[i];
+            if (cache->idleFrames < IDLE_FRAME_COUNT) continue;
+
+            const uint32_t score = cache->lastSize / cache->weight;
+            if (score > victimScore) {
+                victim = cache;
+                victimScore = score;
+            }
+        }
+
+        if (victim) {
+            const uint32_t needed = total + reserve - mBudget;
+            const uint32_t size = victim->lastSize;
+            const uint32_t target = size > needed ? size - needed : 0;
+
+            BUDGET_LOGD("Reclaiming %d bytes from idle %s", size - target, victim->name);
+
+            victim->setMaxSize(target);
+            victim->lastSize = victim->getSize();
+            total = getTotalSize();
+        }
+    }
+
+    distribute(total);
+}
+
+void CacheBudget::distribute(uint32_t totalSize) {
+    // Growing caches get twice their regular share of the free memory
+    uint32_t totalWeight = 0;
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        BudgetedCache* cache = mCaches[i];
+        totalWeight += cache->idleFrames == 0 ? cache->weight * 2 : cache->weight;
+    }
+    if (totalWeight == 0) return;
+
+    const uint32_t available = mBudget > totalSize ? mBudget - totalSize : 0;
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        BudgetedCache* cache = mCaches[i];
+        const uint32_t weight = cache->idleFrames == 0 ? cache->weight * 2 : cache->weight;
+        const uint32_t share = uint32_t(uint64_t(available) * weight / totalWeight);
+        cache->setMaxSize(cache->getSize() + share);
+    }
+}
+
+void CacheBudget::trim(float ratio) {
+    if (!isEnabled()) return;
+
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        BudgetedCache* cache = mCaches[i];
+        cache->setMaxSize(uint32_t(cache->getSize() * ratio));
+        cache->lastSize = cache->getSize();
+    }
+
+    distribute(getTotalSize());
+}
+
+void CacheBudget::dump(String8& log) {
+    if (!isEnabled()) return;
+
+    log.appendFormat("Caches budget: %d / %d bytes\n", getTotalSize(), mBudget);
+    for (size_t i = 0; i < mCaches.size(); i++) {
+        BudgetedCache* cache = mCaches[i];
+        log.appendFormat("  %-20s %8d / %8d, weight %d, %s\n", cache->name,
+                cache->getSize(), cache->getMaxSize(), cache->weight,
+                cache->idleFrames >= IDLE_FRAME_COUNT ? "idle" : "active");
+    }
+}
+
+}; // namespace uirenderer
+}; // namespace android
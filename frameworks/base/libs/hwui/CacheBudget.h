@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_CACHE_BUDGET_H
+#define ANDROID_HWUI_CACHE_BUDGET_H
+
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include "Debug.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A cache whose memory is managed by a CacheBudget.
+ */
+class BudgetedCache {
+public:
+    BudgetedCache(const char* name, uint32_t weight): name(name), weight(weight),
+            lastSize(0), idleFrames(0) {
+    }
+
+    virtual ~BudgetedCache() { }
+
+    virtual uint32_t getSize() = 0;
+    virtual uint32_t getMaxSize() = 0;
+    virtual void setMaxSize(uint32_t maxSize) = 0;
+
+    const char* name;
+    // Relative cost of regenerating a byte of the cache's content
+    uint32_t weight;
+
+    uint32_t lastSize;
+    // Number of frames since the cache last grew
+    uint32_t idleFrames;
+}; // class BudgetedCache
+
+template<typename T>
+class BudgetedCacheImpl: public BudgetedCache {
+public:
+    BudgetedCacheImpl(const char* name, uint32_t weight, T& cache):
+            BudgetedCache(name, weight), mCache(cache) {
+    }
+
+    uint32_t getSize() {
+        return mCache.getSize();
+    }
+
+    uint32_t getMaxSize() {
+        return mCache.getMaxSize();
+    }
+
+    void setMaxSize(uint32_t maxSize) {
+        mCache.setMaxSize(maxSize);
+    }
+
+private:
+    T& mCache;
+}; // class BudgetedCacheImpl
+
+/**
+ * Shares a single memory budget between several caches. The fixed limit
+ * of each cache is replaced by a limit recomputed at the end of every
+ * frame: the memory not used by any cache is handed out to all of them,
+ * with a larger share going to the caches that are growing and to the
+ * ones whose content is expensive to regenerate.
+ *
+ * When the budget is almost exhausted, memory is reclaimed from the
+ * least recently used end of the caches that stopped growing, idle and
+ * cheap caches first.
+ */
+class CacheBudget {
+public:
+    CacheBudget();
+    ~CacheBudget();
+
+    /**
+     * Reads the budget from the system properties. The budget is disabled,
+     * and every cache keeps its own limit, if the budget is not set.
+     */
+    void init();
+
+    /**
+     * Adds a cache to the budget. The budget takes ownership of the cache.
+     */
+    void addCache(BudgetedCache* cache);
+
+    inline bool isEnabled() const {
+        return mBudget > 0;
+    }
+
+    inline uint32_t getBudget() const {
+        return mBudget;
+    }
+
+    /**
+     * Recomputes the limits of the caches. Invoked at the end of every frame.
+     */
+    void update();
+
+    /**
+     * Shrinks every cache to the specified fraction of its current size, used
+     * to respond to memory pressure.
+     */
+    void trim(float ratio);
+
+    void dump(String8& log);
+
+private:
+    uint32_t getTotalSize();
+    void distribute(uint32_t totalSize);
+
+    Vector<BudgetedCache*> mCaches;
+    uint32_t mBudget;
+}; // class CacheBudget
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_CACHE_BUDGET_H
@@ -55,6 +55,7 @@ Caches::Caches(): Singleton<Caches>(),
     initProperties();
     initStaticProperties();
     initExtensions();
+    initBudget();
 
     mDebugLevel = readDebugLevel();
     ALOGD("Enabling debug mode %d", mDebugLevel);
@@ -98,6 +99,7 @@ bool Caches::init() {
     debugStencilClip = kStencilHide;
 
     patchCache.init(*this);
+    programCache.init();
 
     mInitialized = true;
 
@@ -153,6 +155,22 @@ void Caches::initStaticProperties() {
     }
 }
 
+void Caches::initBudget() {
+    budget.init();
+    if (!budget.isEnabled()) return;
+
+    // Weights reflect how expensive a byte of each cache is to regenerate
+    budget.addCache(new BudgetedCacheImpl<TextureCache>("TextureCache", 1, textureCache));
+    budget.addCache(new BudgetedCacheImpl<LayerCache>("LayerCache", 1, layerCache));
+    budget.addCache(new BudgetedCacheImpl<GradientCache>("GradientCache", 1, gradientCache));
+    budget.addCache(new BudgetedCacheImpl<PathCache>("PathCache", 4, pathCache));
+    budget.addCache(new BudgetedCacheImpl<TessellationCache>("TessellationCache", 2,
+            tessellationCache));
+    budget.addCache(new BudgetedCacheImpl<TextDropShadowCache>("TextDropShadowCache", 4,
+            dropShadowCache));
+    budget.update();
+}
+
 bool Caches::initProperties() {
     bool prevDebugLayersUpdates = debugLayersUpdates;
     bool prevDebugOverdraw = debugOverdraw;
@@ -206,6 +224,11 @@ bool Caches::initProperties() {
         INIT_LOGD("  Draw reorder enabled");
     }
 
+    if (property_get(PROPERTY_PROFILE_FRAMES, property, "false")) {
+        frameProfiler.setEnabled(!strcasecmp(property, "true"));
+        INIT_LOGD("  Frame profiler %s", frameProfiler.isEnabled() ? "enabled" : "disabled");
+    }
+
     return (prevDebugLayersUpdates != debugLayersUpdates) ||
             (prevDebugOverdraw != debugOverdraw) ||
             (prevDebugStencilClip != debugStencilClip);
@@ -228,8 +251,12 @@ void Caches::terminate() {
     currentProgram = NULL;
 
     assetAtlas.terminate();
+    dynamicAtlas.clear();
 
     patchCache.clear();
+    tessellationCache.clear();
+
+    frameProfiler.terminate();
 
     clearGarbage();
 
@@ -272,6 +299,10 @@ void Caches::dumpMemoryUsage(String8 &log) {
             dropShadowCache.getMaxSize());
     log.appendFormat("  PatchCache           %8d / %8d\n",
             patchCache.getSize(), patchCache.getMaxSize());
+    log.appendFormat("  TessellationCache    %8d / %8d\n",
+            tessellationCache.getSize(), tessellationCache.getMaxSize());
+    log.appendFormat("  DynamicAtlas         %8d / %8d\n",
+            dynamicAtlas.getSize(), dynamicAtlas.getMaxSize());
     for (uint32_t i = 0; i < fontRenderer->getFontRendererCount(); i++) {
         const uint32_t sizeA8 = fontRenderer->getFontRendererSize(i, GL_ALPHA);
         const uint32_t sizeRGBA = fontRenderer->getFontRendererSize(i, GL_RGBA);
@@ -280,6 +311,7 @@ void Caches::dumpMemoryUsage(String8 &log) {
         log.appendFormat("  FontRenderer %d total %8d / %8d\n", i, sizeA8 + sizeRGBA,
                 sizeA8 + sizeRGBA);
     }
+    budget.dump(log);
     log.appendFormat("Other:\n");
     log.appendFormat("  FboCache             %8d / %8d\n",
             fboCache.getSize(), fboCache.getMaxSize());
@@ -292,6 +324,8 @@ void Caches::dumpMemoryUsage(String8 &log) {
     total += pathCache.getSize();
     total += dropShadowCache.getSize();
     total += patchCache.getSize();
+    total += tessellationCache.getSize();
+    total += dynamicAtlas.getSize();
     for (uint32_t i = 0; i < fontRenderer->getFontRendererCount(); i++) {
         total += fontRenderer->getFontRendererSize(i, GL_ALPHA);
         total += fontRenderer->getFontRendererSize(i, GL_RGBA);
@@ -307,6 +341,7 @@ void Caches::dumpMemoryUsage(String8 &log) {
 
 void Caches::clearGarbage() {
     textureCache.clearGarbage();
+    dynamicAtlas.clearGarbage();
     pathCache.clearGarbage();
     patchCache.clearGarbage();
 
@@ -367,6 +402,8 @@ void Caches::flush(FlushMode mode) {
             fontRenderer->flush();
             textureCache.flush();
             pathCache.clear();
+            tessellationCache.clear();
+            dynamicAtlas.clear();
             // fall through
         case kFlushMode_Layers:
             layerCache.clear();
@@ -374,6 +411,10 @@ void Caches::flush(FlushMode mode) {
             break;
     }
 
+    // Shrink the caches the flush left alone and hand the memory
+    // released by the flush back to all of them
+    budget.trim(mode == kFlushMode_Layers ? 1.0f : 0.5f);
+
     clearGarbage();
 }
 
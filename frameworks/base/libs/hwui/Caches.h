@@ -33,6 +33,7 @@
 #include "thread/TaskManager.h"
 
 #include "AssetAtlas.h"
+#include "CacheBudget.h"
 #include "FontRenderer.h"
 #include "GammaFontRenderer.h"
 #include "TextureCache.h"
@@ -42,11 +43,14 @@
 #include "PatchCache.h"
 #include "ProgramCache.h"
 #include "PathCache.h"
+#include "TessellationCache.h"
 #include "TextDropShadowCache.h"
 #include "FboCache.h"
 #include "ResourceCache.h"
 #include "Stencil.h"
 #include "Dither.h"
+#include "DynamicAtlas.h"
+#include "FrameProfiler.h"
 
 namespace android {
 namespace uirenderer {
@@ -329,19 +333,27 @@ public:
     GradientCache gradientCache;
     ProgramCache programCache;
     PathCache pathCache;
+    TessellationCache tessellationCache;
     PatchCache patchCache;
     TextDropShadowCache dropShadowCache;
     FboCache fboCache;
     ResourceCache resourceCache;
 
+    // Shared by the caches above when ro.hwui.cache_budget is set
+    CacheBudget budget;
+
     GammaFontRenderer* fontRenderer;
 
     TaskManager tasks;
 
+    FrameProfiler frameProfiler;
+
     Dither dither;
     Stencil stencil;
 
     AssetAtlas assetAtlas;
+    // Application bitmaps drawn in many consecutive frames
+    DynamicAtlas dynamicAtlas;
 
     bool gpuPixelBuffersEnabled;
 
@@ -363,6 +375,7 @@ private:
     void initExtensions();
     void initConstraints();
     void initStaticProperties();
+    void initBudget();
 
     static void eventMarkNull(GLsizei length, const GLchar* marker) { }
     static void startMarkNull(GLsizei length, const GLchar* marker) { }
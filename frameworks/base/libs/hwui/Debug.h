@@ -32,6 +32,12 @@
 // Turn on to enable debugging of cache flushes
 #define DEBUG_CACHE_FLUSH 0
 
+// Turn on to enable debugging of the caches memory budget
+#define DEBUG_CACHE_BUDGET 0
+
+// Turn on to display debug info about the dynamic atlas
+#define DEBUG_DYNAMIC_ATLAS 0
+
 // Turn on to enable layers debugging when rendered as regions
 #define DEBUG_LAYERS_AS_REGIONS 0
 
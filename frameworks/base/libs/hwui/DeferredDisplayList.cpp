@@ -41,6 +41,9 @@ namespace uirenderer {
 // Depth of the save stack at the beginning of batch playback at flush time
 #define FLUSH_SAVE_STACK_DEPTH 2
 
+// Maximum number of opaque rects tracked at once by the occlusion pass
+#define MAX_OCCLUDERS 4
+
 #define DEBUG_COLOR_BARRIER          0x1f000000
 #define DEBUG_COLOR_MERGEDBATCH      0x5f7f7fff
 #define DEBUG_COLOR_MERGEDBATCH_SOLO 0x5f7fff7f
@@ -70,7 +73,33 @@ public:
         // NOTE: ignore empty bounds special case, since we don't merge across those ops
         mBounds.unionWith(state->mBounds);
         mAllOpsOpaque &= opaqueOverBounds;
-        mOps.add(OpStatePair(op, state));
+        mOps.add(OpStatePair(op, state, opaqueOverBounds));
+    }
+
+    /**
+     * Removes, from last to first, the ops covered by one of the occluders, and adds the
+     * bounds of the remaining opaque ops to the occluders. Returns the number of removed ops
+     * and accumulates the area they would have covered into culledArea.
+     */
+    int cullOccludedOps(Vector<Rect>& occluders, float& culledArea) {
+        int culled = 0;
+        for (int i = mOps.size() - 1; i >= 0; i--) {
+            const DeferredDisplayState* state = mOps[i].state;
+
+            // ops of unknown bounds (e.g. functors) are always drawn
+            if (state->mClipSideFlags != kClipSide_ConservativeFull &&
+                    isOccluded(occluders, state->mBounds)) {
+                culledArea += state->mBounds.getWidth() * state->mBounds.getHeight();
+                mOps.removeAt(i);
+                culled++;
+                continue;
+            }
+
+            if (mOps[i].opaque && state->mClipSideFlags != kClipSide_ConservativeFull) {
+                addOccluder(occluders, state->mBounds);
+            }
+        }
+        return culled;
     }
 
     bool intersects(const Rect& rect) {
@@ -96,6 +125,7 @@ public:
 
         status_t status = DrawGlInfo::kStatusDone;
         DisplayListLogBuffer& logBuffer = DisplayListLogBuffer::getInstance();
+        FrameProfiler& profiler = renderer.getCaches().frameProfiler;
         for (unsigned int i = 0; i < mOps.size(); i++) {
             DrawOp* op = mOps[i].op;
             const DeferredDisplayState* state = mOps[i].state;
@@ -105,7 +135,13 @@ public:
             renderer.eventMark(op->name());
 #endif
             logBuffer.writeCommand(0, op->name());
-            status |= op->applyDraw(renderer, dirty);
+            if (CC_UNLIKELY(profiler.isEnabled())) {
+                nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+                status |= op->applyDraw(renderer, dirty);
+                profiler.addOpTime(op->name(), systemTime(SYSTEM_TIME_MONOTONIC) - start);
+            } else {
+                status |= op->applyDraw(renderer, dirty);
+            }
 
 #if DEBUG_MERGE_BEHAVIOR
             const Rect& bounds = state->mBounds;
@@ -138,6 +174,40 @@ public:
     inline int count() const { return mOps.size(); }
 
 protected:
+    static bool isOccluded(const Vector<Rect>& occluders, const Rect& bounds) {
+        // account for the antialiasing fringe drawn outside of the bounds
+        Rect drawn(bounds);
+        drawn.outset(1.0f);
+        for (unsigned int i = 0; i < occluders.size(); i++) {
+            if (occluders[i].contains(drawn)) return true;
+        }
+        return false;
+    }
+
+    static void addOccluder(Vector<Rect>& occluders, const Rect& bounds) {
+        // antialiased edges are not opaque, only keep the pixels fully covered by the op
+        Rect opaque(bounds.left + 1.0f, bounds.top + 1.0f,
+                bounds.right - 1.0f, bounds.bottom - 1.0f);
+        if (opaque.isEmpty()) return;
+
+        const float area = opaque.getWidth() * opaque.getHeight();
+        int smallest = -1;
+        for (unsigned int i = 0; i < occluders.size(); i++) {
+            const Rect& occluder = occluders[i];
+            if (occluder.contains(opaque)) return;
+            if (smallest < 0 || occluder.getWidth() * occluder.getHeight() <
+                    occluders[smallest].getWidth() * occluders[smallest].getHeight()) {
+                smallest = i;
+            }
+        }
+
+        if (occluders.size() < MAX_OCCLUDERS) {
+            occluders.add(opaque);
+        } else if (area > occluders[smallest].getWidth() * occluders[smallest].getHeight()) {
+            occluders.replaceAt(opaque, smallest);
+        }
+    }
+
     Vector<OpStatePair> mOps;
     Rect mBounds; // union of bounds of contained ops
 private:
@@ -280,7 +350,16 @@ public:
         renderer.eventMark("multiDraw");
         renderer.eventMark(op->name());
 #endif
-        status_t status = op->multiDraw(renderer, dirty, mOps, mBounds);
+        status_t status;
+        FrameProfiler& profiler = renderer.getCaches().frameProfiler;
+        if (CC_UNLIKELY(profiler.isEnabled())) {
+            // the merged draw is attributed to the type of its ops
+            nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            status = op->multiDraw(renderer, dirty, mOps, mBounds);
+            profiler.addOpTime(op->name(), systemTime(SYSTEM_TIME_MONOTONIC) - start, mOps.size());
+        } else {
+            status = op->multiDraw(renderer, dirty, mOps, mBounds);
+        }
 
 #if DEBUG_MERGE_BEHAVIOR
         renderer.drawScreenSpaceColorRect(mBounds.left, mBounds.top, mBounds.right, mBounds.bottom,
@@ -674,6 +753,7 @@ status_t DeferredDisplayList::flush(OpenGLRenderer& renderer, Rect& dirty) {
                 discardDrawingBatches(i - 1);
             }
         }
+        cullOccludedOps();
     }
     // NOTE: depth of the save stack at this point, before playback, should be reflected in
     // FLUSH_SAVE_STACK_DEPTH, so that save/restores match up correctly
@@ -687,6 +767,33 @@ status_t DeferredDisplayList::flush(OpenGLRenderer& renderer, Rect& dirty) {
     return status;
 }
 
+void DeferredDisplayList::cullOccludedOps() {
+    Vector<Rect> occluders;
+    int culledOps = 0;
+    float culledArea = 0.0f;
+
+    for (int i = mBatches.size() - 1; i >= 0; i--) {
+        if (!mBatches[i]) continue;
+
+        if (!mBatches[i]->purelyDrawBatch()) {
+            occluders.clear();
+            continue;
+        }
+
+        DrawBatch* b = (DrawBatch*) mBatches[i];
+        culledOps += b->cullOccludedOps(occluders, culledArea);
+        if (b->count() == 0) {
+            delete b;
+            mBatches.replaceAt(NULL, i);
+        }
+    }
+
+    DEFER_LOGD("%p culled %d occluded ops, saving %.0f pixels of overdraw",
+            this, culledOps, culledArea);
+    ATRACE_INT("Culled ops", culledOps);
+    ATRACE_INT("Culled pixels", (int) culledArea);
+}
+
 void DeferredDisplayList::discardDrawingBatches(const unsigned int maxIndex) {
     for (unsigned int i = mEarliestUnclearedIndex; i <= maxIndex; i++) {
         // leave deferred state ops alone for simplicity (empty save restore pairs may now exist)
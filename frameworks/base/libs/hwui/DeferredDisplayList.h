@@ -69,13 +69,14 @@ public:
 class OpStatePair {
 public:
     OpStatePair()
-            : op(NULL), state(NULL) {}
-    OpStatePair(DrawOp* newOp, const DeferredDisplayState* newState)
-            : op(newOp), state(newState) {}
+            : op(NULL), state(NULL), opaque(false) {}
+    OpStatePair(DrawOp* newOp, const DeferredDisplayState* newState, bool newOpaque = false)
+            : op(newOp), state(newState), opaque(newOpaque) {}
     OpStatePair(const OpStatePair& other)
-            : op(other.op), state(other.state) {}
+            : op(other.op), state(other.state), opaque(other.opaque) {}
     DrawOp* op;
     const DeferredDisplayState* state;
+    bool opaque; // op is opaque over state->mBounds, and can occlude ops drawn before it
 };
 
 class DeferredDisplayList {
@@ -146,6 +147,13 @@ private:
 
     void discardDrawingBatches(const unsigned int maxIndex);
 
+    /**
+     * Walks the batches back to front, removing the draw ops entirely covered by opaque ops
+     * played back after them. Occluders are reset at every state barrier, since the ops
+     * before a barrier may target a different layer or clip.
+     */
+    void cullOccludedOps();
+
     // layer space bounds of rendering
     Rect mBounds;
     const bool mAvoidOverdraw;
@@ -38,6 +38,8 @@ void DisplayList::outputLogBuffer(int fd) {
     String8 cachesLog;
     Caches::getInstance().dumpMemoryUsage(cachesLog);
     fprintf(file, "\nCaches:\n%s", cachesLog.string());
+
+    Caches::getInstance().frameProfiler.dump(file);
     fprintf(file, "\n");
 
     fflush(file);
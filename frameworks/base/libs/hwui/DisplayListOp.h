@@ -737,6 +737,7 @@ public:
             mEntryGenerationId = mAtlas.getGenerationId();
             mUvMapper = mEntry->uvMapper;
         }
+        mDrawEntry = mEntry;
     }
 
     virtual status_t applyDraw(OpenGLRenderer& renderer, Rect& dirty) {
@@ -800,7 +801,7 @@ public:
             }
         }
 
-        return renderer.drawBitmaps(mBitmap, mEntry, ops.size(), &vertices[0],
+        return renderer.drawBitmaps(mBitmap, mDrawEntry, ops.size(), &vertices[0],
                 pureTranslate, bounds, mPaint);
     }
 
@@ -813,8 +814,16 @@ public:
     virtual void onDefer(OpenGLRenderer& renderer, DeferInfo& deferInfo,
             const DeferredDisplayState& state) {
         deferInfo.batchId = DeferredDisplayList::kOpBatch_Bitmap;
-        deferInfo.mergeId = getAtlasEntry() ?
-                (mergeid_t) mEntry->getMergeId() : (mergeid_t) mBitmap;
+
+        // Bitmaps that are not part of the framework atlas can be packed in the
+        // dynamic atlas, to be merged with the other bitmaps of the same page
+        mDrawEntry = getAtlasEntry();
+        if (!mDrawEntry) {
+            mDrawEntry = renderer.getCaches().dynamicAtlas.get(mBitmap);
+        }
+        mUvMapper = mDrawEntry ? mDrawEntry->uvMapper : UvMapper();
+        deferInfo.mergeId = mDrawEntry ?
+                (mergeid_t) mDrawEntry->getMergeId() : (mergeid_t) mBitmap;
 
         // Don't merge non-simply transformed or neg scale ops, SET_TEXTURE doesn't handle rotation
         // Don't merge A8 bitmaps - the paint's color isn't compared by mergeId, or in
@@ -832,6 +841,9 @@ protected:
     const AssetAtlas& mAtlas;
     uint32_t mEntryGenerationId;
     AssetAtlas::Entry* mEntry;
+    // Entry of the framework or dynamic atlas the op was deferred with,
+    // only valid until the end of the frame
+    AssetAtlas::Entry* mDrawEntry;
     UvMapper mUvMapper;
 };
 
@@ -1204,6 +1216,20 @@ public:
         OP_LOG("Draw RoundRect "RECT_STRING", rx %f, ry %f", RECT_ARGS(mLocalBounds), mRx, mRy);
     }
 
+    virtual void onDefer(OpenGLRenderer& renderer, DeferInfo& deferInfo,
+            const DeferredDisplayState& state) {
+        DrawStrokableOp::onDefer(renderer, deferInfo, state);
+        SkPaint* paint = getPaint(renderer);
+        if (paint->getPathEffect()) {
+            renderer.getCaches().pathCache.precacheRoundRect(mLocalBounds.getWidth(),
+                    mLocalBounds.getHeight(), mRx, mRy, paint);
+        } else {
+            renderer.getCaches().tessellationCache.precacheRoundRect(state.mMatrix,
+                    mLocalBounds.left, mLocalBounds.top, mLocalBounds.right,
+                    mLocalBounds.bottom, mRx, mRy, paint);
+        }
+    }
+
     virtual const char* name() { return "DrawRoundRect"; }
 
 private:
@@ -1225,6 +1251,18 @@ public:
         OP_LOG("Draw Circle x %f, y %f, r %f", mX, mY, mRadius);
     }
 
+    virtual void onDefer(OpenGLRenderer& renderer, DeferInfo& deferInfo,
+            const DeferredDisplayState& state) {
+        DrawStrokableOp::onDefer(renderer, deferInfo, state);
+        SkPaint* paint = getPaint(renderer);
+        if (paint->getPathEffect()) {
+            renderer.getCaches().pathCache.precacheCircle(mRadius, paint);
+        } else {
+            renderer.getCaches().tessellationCache.precacheCircle(state.mMatrix,
+                    mX, mY, mRadius, paint);
+        }
+    }
+
     virtual const char* name() { return "DrawCircle"; }
 
 private:
@@ -1247,6 +1285,20 @@ public:
         OP_LOG("Draw Oval "RECT_STRING, RECT_ARGS(mLocalBounds));
     }
 
+    virtual void onDefer(OpenGLRenderer& renderer, DeferInfo& deferInfo,
+            const DeferredDisplayState& state) {
+        DrawStrokableOp::onDefer(renderer, deferInfo, state);
+        SkPaint* paint = getPaint(renderer);
+        if (paint->getPathEffect()) {
+            renderer.getCaches().pathCache.precacheOval(mLocalBounds.getWidth(),
+                    mLocalBounds.getHeight(), paint);
+        } else {
+            renderer.getCaches().tessellationCache.precacheOval(state.mMatrix,
+                    mLocalBounds.left, mLocalBounds.top, mLocalBounds.right,
+                    mLocalBounds.bottom, paint);
+        }
+    }
+
     virtual const char* name() { return "DrawOval"; }
 };
 
@@ -1268,6 +1320,34 @@ public:
                 RECT_ARGS(mLocalBounds), mStartAngle, mSweepAngle, mUseCenter);
     }
 
+    virtual void onDefer(OpenGLRenderer& renderer, DeferInfo& deferInfo,
+            const DeferredDisplayState& state) {
+        DrawStrokableOp::onDefer(renderer, deferInfo, state);
+        SkPaint* paint = getPaint(renderer);
+        PathCache& pathCache = renderer.getCaches().pathCache;
+
+        TessellationCache& tessellationCache = renderer.getCaches().tessellationCache;
+
+        // Mirrors the choice made by OpenGLRenderer::drawArc()
+        if (fabs(mSweepAngle) >= 360.0f) {
+            if (paint->getPathEffect()) {
+                pathCache.precacheOval(mLocalBounds.getWidth(), mLocalBounds.getHeight(), paint);
+            } else {
+                tessellationCache.precacheOval(state.mMatrix, mLocalBounds.left,
+                        mLocalBounds.top, mLocalBounds.right, mLocalBounds.bottom, paint);
+            }
+        } else if (paint->getStyle() != SkPaint::kStroke_Style || paint->getPathEffect() ||
+                mUseCenter) {
+            deferInfo.batchId = DeferredDisplayList::kOpBatch_AlphaMaskTexture;
+            pathCache.precacheArc(mLocalBounds.getWidth(), mLocalBounds.getHeight(),
+                    mStartAngle, mSweepAngle, mUseCenter, paint);
+        } else {
+            tessellationCache.precacheArc(state.mMatrix, mLocalBounds.left, mLocalBounds.top,
+                    mLocalBounds.right, mLocalBounds.bottom, mStartAngle, mSweepAngle,
+                    mUseCenter, paint);
+        }
+    }
+
     virtual const char* name() { return "DrawArc"; }
 
 private:
@@ -1572,6 +1652,30 @@ public:
         OP_LOG("Draw Layer %p at %f %f", mLayer, mX, mY);
     }
 
+    virtual bool getLocalBounds(const DrawModifiers& drawModifiers, Rect& localBounds) {
+        // texture layers carry their own transform, let them be conservatively clipped
+        if (!mLayer || mLayer->isTextureLayer()) return false;
+        localBounds.set(mX, mY, mX + mLayer->layer.getWidth(), mY + mLayer->layer.getHeight());
+        return true;
+    }
+
+    virtual void onDefer(OpenGLRenderer& renderer, DeferInfo& deferInfo,
+            const DeferredDisplayState& state) {
+        if (!mLayer || mLayer->isTextureLayer()) return;
+
+        // the layer only hides what is below it if its whole area is drawn without blending
+        const android::Rect& region = mLayer->region.getBounds();
+        deferInfo.opaqueOverBounds = isOpaqueOverBounds(state) &&
+                !mLayer->isBlend() && mLayer->getAlpha() == 255 &&
+                state.mDrawModifiers.mOverrideLayerAlpha >= 1.0f &&
+                !mLayer->getColorFilter() &&
+                (mLayer->getMode() == SkXfermode::kSrcOver_Mode ||
+                        mLayer->getMode() == SkXfermode::kSrc_Mode) &&
+                mLayer->region.isRect() && region.left <= 0 && region.top <= 0 &&
+                region.right >= (int) mLayer->layer.getWidth() &&
+                region.bottom >= (int) mLayer->layer.getHeight();
+    }
+
     virtual const char* name() { return "DrawLayer"; }
 
 private:
@@ -34,10 +34,13 @@ namespace uirenderer {
 DisplayListRenderer::DisplayListRenderer():
         mCaches(Caches::getInstance()), mDisplayListData(new DisplayListData),
         mTranslateX(0.0f), mTranslateY(0.0f), mHasTranslate(false),
-        mHasDrawOps(false), mFunctorCount(0) {
+        mHasDrawOps(false), mFunctorCount(0), mProfiling(false) {
 }
 
 DisplayListRenderer::~DisplayListRenderer() {
+    if (mProfiling) {
+        mCaches.frameProfiler.endRecord();
+    }
     reset();
 }
 
@@ -137,12 +140,22 @@ status_t DisplayListRenderer::prepareDirty(float left, float top,
 
     mRestoreSaveCount = -1;
 
+    if (CC_UNLIKELY(mCaches.frameProfiler.isEnabled() && !mProfiling)) {
+        mCaches.frameProfiler.beginRecord();
+        mProfiling = true;
+    }
+
     return DrawGlInfo::kStatusDone; // No invalidate needed at record-time
 }
 
 void DisplayListRenderer::finish() {
     insertRestoreToCount();
     insertTranslate();
+
+    if (CC_UNLIKELY(mProfiling)) {
+        mCaches.frameProfiler.endRecord();
+        mProfiling = false;
+    }
 }
 
 void DisplayListRenderer::interrupt() {
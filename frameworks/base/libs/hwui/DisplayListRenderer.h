@@ -363,6 +363,9 @@ private:
 
     uint32_t mFunctorCount;
 
+    // True if the frame profiler is timing this recording
+    bool mProfiling;
+
     friend class DisplayList;
 
 }; // class DisplayListRenderer
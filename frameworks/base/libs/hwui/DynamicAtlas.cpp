@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <stdlib.h>
+
+#include <cutils/properties.h>
+#include <utils/Log.h>
+
+#include "Caches.h"
+#include "DynamicAtlas.h"
+#include "Properties.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Shelves heights are rounded up to limit the number of distinct shelves
+#define SHELF_ROUNDING_SIZE 8
+
+// Maximum number of entries evicted to make room for a new bitmap
+#define MAX_EVICTIONS 8
+
+// Debug
+#if DEBUG_DYNAMIC_ATLAS
+    #define ATLAS_LOGD(...) ALOGD(__VA_ARGS__)
+#else
+    #define ATLAS_LOGD(...)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+DynamicAtlas::DynamicAtlas(): mMaxPageCount(0), mPageSize(DYNAMIC_ATLAS_PAGE_SIZE),
+        mFrameCount(0) {
+    float size = DEFAULT_DYNAMIC_ATLAS_SIZE;
+
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_DYNAMIC_ATLAS_SIZE, property, NULL) > 0) {
+        INIT_LOGD("  Setting dynamic atlas size to %sMB", property);
+        size = atof(property);
+    } else {
+        INIT_LOGD("  Using default dynamic atlas size of %.2fMB", DEFAULT_DYNAMIC_ATLAS_SIZE);
+    }
+
+    mMaxPageCount = uint32_t(MB(size)) / (mPageSize * mPageSize * 4);
+}
+
+DynamicAtlas::~DynamicAtlas() {
+    clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Size management
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t DynamicAtlas::getSize() const {
+    return mPages.size() * mPageSize * mPageSize * 4;
+}
+
+uint32_t DynamicAtlas::getMaxSize() const {
+    return mMaxPageCount * mPageSize * mPageSize * 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Entries
+///////////////////////////////////////////////////////////////////////////////
+
+AssetAtlas::Entry* DynamicAtlas::get(SkBitmap* bitmap) {
+    if (!isEnabled()) return NULL;
+
+    Slot* slot = getSlot(bitmap);
+    if (slot) return slot->entry;
+
+    if (!isPackable(bitmap)) return NULL;
+
+    ssize_t index = mCandidates.indexOfKey(bitmap);
+    if (index < 0) {
+        Candidate candidate;
+        candidate.lastFrame = mFrameCount;
+        candidate.frameCount = 1;
+        mCandidates.add(bitmap, candidate);
+        return NULL;
+    }
+
+    Candidate& candidate = mCandidates.editValueAt(index);
+    if (candidate.lastFrame == mFrameCount) return NULL;
+
+    candidate.lastFrame = mFrameCount;
+    if (++candidate.frameCount < DYNAMIC_ATLAS_MIN_FRAMES) return NULL;
+
+    mCandidates.removeItemsAt(index);
+
+    slot = pack(bitmap);
+    return slot ? slot->entry : NULL;
+}
+
+Texture* DynamicAtlas::getEntryTexture(SkBitmap* bitmap) {
+    if (mSlots.isEmpty()) return NULL;
+
+    Slot* slot = getSlot(bitmap);
+    return slot ? slot->entry->texture : NULL;
+}
+
+DynamicAtlas::Slot* DynamicAtlas::getSlot(SkBitmap* bitmap) {
+    ssize_t index = mSlots.indexOfKey(bitmap);
+    if (index < 0) return NULL;
+
+    Slot* slot = mSlots.valueAt(index);
+    if (bitmap->getGenerationID() != slot->generation) {
+        // Only the area of the page occupied by the bitmap is uploaded again
+        const bool resized = uint32_t(bitmap->width() + 2) != slot->width ||
+                uint32_t(bitmap->height() + 2) != slot->height;
+        if (resized || !isPackable(bitmap) || !upload(slot, bitmap)) {
+            ATLAS_LOGD("Removing bitmap %p from the dynamic atlas", bitmap);
+            removeSlot(index);
+            return NULL;
+        }
+    }
+
+    slot->lastUsed = mFrameCount;
+    return slot;
+}
+
+bool DynamicAtlas::isPackable(SkBitmap* bitmap) const {
+    // Mipmapped bitmaps and A8 bitmaps, which are tinted by the paint,
+    // cannot be drawn from the atlas
+    return bitmap->getConfig() == SkBitmap::kARGB_8888_Config &&
+            bitmap->width() > 0 && bitmap->width() <= DYNAMIC_ATLAS_MAX_ENTRY_SIZE &&
+            bitmap->height() > 0 && bitmap->height() <= DYNAMIC_ATLAS_MAX_ENTRY_SIZE &&
+            !bitmap->hasHardwareMipMap() &&
+            (bitmap->rowBytesAsPixels() == bitmap->width() ||
+                    Extensions::getInstance().hasUnpackRowLength());
+}
+
+void DynamicAtlas::remove(SkBitmap* bitmap) {
+    ssize_t index = mSlots.indexOfKey(bitmap);
+    if (index >= 0) {
+        removeSlot(index);
+    }
+    mCandidates.removeItem(bitmap);
+}
+
+void DynamicAtlas::removeDeferred(SkBitmap* bitmap) {
+    Mutex::Autolock _l(mLock);
+    mGarbage.push(bitmap);
+}
+
+void DynamicAtlas::clearGarbage() {
+    Mutex::Autolock _l(mLock);
+    size_t count = mGarbage.size();
+    for (size_t i = 0; i < count; i++) {
+        remove(mGarbage.itemAt(i));
+    }
+    mGarbage.clear();
+}
+
+void DynamicAtlas::clear() {
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        Slot* slot = mSlots.valueAt(i);
+        delete slot->entry;
+        delete slot;
+    }
+    mSlots.clear();
+    mCandidates.clear();
+
+    for (size_t i = 0; i < mPages.size(); i++) {
+        Page* page = mPages.itemAt(i);
+        page->texture->deleteTexture();
+        delete page->texture;
+        delete page;
+    }
+    mPages.clear();
+}
+
+void DynamicAtlas::endFrame() {
+    mFrameCount++;
+
+    // Bitmaps must be drawn in consecutive frames to become eligible
+    for (ssize_t i = mCandidates.size() - 1; i >= 0; i--) {
+        if (mCandidates.valueAt(i).lastFrame + 1 < mFrameCount) {
+            mCandidates.removeItemsAt(i);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Packing
+///////////////////////////////////////////////////////////////////////////////
+
+DynamicAtlas::Slot* DynamicAtlas::pack(SkBitmap* bitmap) {
+    // Each bitmap is surrounded by a 1 pixel transparent border to prevent
+    // its neighbours from bleeding into it when filtering
+    const uint32_t width = bitmap->width() + 2;
+    const uint32_t height = bitmap->height() + 2;
+
+    Slot* slot = new Slot();
+
+    bool allocated = false;
+    for (size_t i = 0; i < mPages.size() && !allocated; i++) {
+        allocated = allocate(mPages.itemAt(i), width, height, slot);
+    }
+
+    if (!allocated && mPages.size() < mMaxPageCount) {
+        allocated = allocate(createPage(), width, height, slot);
+    }
+
+    // Make room by evicting the entries that were not used recently
+    for (int evictions = 0; !allocated && evictions < MAX_EVICTIONS && evict(); evictions++) {
+        for (size_t i = 0; i < mPages.size() && !allocated; i++) {
+            allocated = allocate(mPages.itemAt(i), width, height, slot);
+        }
+    }
+
+    if (!allocated) {
+        ATLAS_LOGD("Could not pack bitmap %p (%dx%d) in the dynamic atlas",
+                bitmap, bitmap->width(), bitmap->height());
+        delete slot;
+        return NULL;
+    }
+
+    Caches& caches = Caches::getInstance();
+    Page* page = slot->page;
+
+    const uint32_t x = slot->x + 1;
+    const uint32_t y = slot->y + 1;
+    const float size = float(mPageSize);
+    const UvMapper mapper(
+            x / size, (x + bitmap->width()) / size,
+            y / size, (y + bitmap->height()) / size);
+
+    Texture* texture = new DelegateTexture(caches, page->texture);
+    texture->id = page->texture->id;
+    texture->width = bitmap->width();
+    texture->height = bitmap->height();
+
+    slot->entry = new AssetAtlas::Entry(bitmap, x, y, false, texture, mapper,
+            &page->blendKey, &page->opaqueKey);
+    texture->uvMapper = &slot->entry->uvMapper;
+
+    clearBorder(slot);
+    if (!upload(slot, bitmap)) {
+        release(slot);
+        delete slot->entry;
+        delete slot;
+        return NULL;
+    }
+
+    ATLAS_LOGD("Packed bitmap %p (%dx%d) in the dynamic atlas at %d, %d",
+            bitmap, bitmap->width(), bitmap->height(), x, y);
+
+    mSlots.add(bitmap, slot);
+
+    // The copy held by the texture cache is not needed anymore
+    caches.textureCache.remove(bitmap);
+
+    return slot;
+}
+
+ssize_t DynamicAtlas::findSpan(const Shelf& shelf, uint32_t width) {
+    ssize_t best = -1;
+    for (size_t i = 0; i < shelf.freeSpans.size(); i++) {
+        const Span& span = shelf.freeSpans.itemAt(i);
+        if (span.width >= width &&
+                (best < 0 || span.width < shelf.freeSpans.itemAt(best).width)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+bool DynamicAtlas::allocate(Page* page, uint32_t width, uint32_t height, Slot* slot) {
+    if (!page || width > mPageSize || height > mPageSize) return false;
+
+    // Pick the shelf that wastes the least height
+    ssize_t best = -1;
+    uint32_t bestWaste = 0;
+    for (size_t i = 0; i < page->shelves.size(); i++) {
+        const Shelf& shelf = page->shelves.itemAt(i);
+        if (shelf.height < height) continue;
+        if (shelf.cursor + width > mPageSize && findSpan(shelf, width) < 0) continue;
+
+        const uint32_t waste = shelf.height - height;
+        if (best < 0 || waste < bestWaste) {
+            best = i;
+            bestWaste = waste;
+        }
+    }
+
+    // Open a new shelf rather than wasting more than half of an existing one
+    if ((best < 0 || bestWaste > page->shelves.itemAt(best).height / 2) &&
+            page->nextShelf + height <= mPageSize) {
+        Shelf shelf;
+        shelf.y = page->nextShelf;
+        shelf.height = (height + SHELF_ROUNDING_SIZE - 1) & -SHELF_ROUNDING_SIZE;
+        if (page->nextShelf + shelf.height > mPageSize) {
+            shelf.height = mPageSize - page->nextShelf;
+        }
+        shelf.cursor = 0;
+
+        best = page->shelves.add(shelf);
+        page->nextShelf += shelf.height;
+    }
+
+    if (best < 0) return false;
+
+    Shelf& shelf = page->shelves.editItemAt(best);
+
+    // Reuse the space freed by previous entries first
+    ssize_t index = findSpan(shelf, width);
+    if (index >= 0) {
+        Span& span = shelf.freeSpans.editItemAt(index);
+        slot->x = span.x;
+        span.x += width;
+        span.width -= width;
+        if (span.width == 0) {
+            shelf.freeSpans.removeAt(index);
+        }
+    } else {
+        slot->x = shelf.cursor;
+        shelf.cursor += width;
+    }
+
+    slot->page = page;
+    slot->shelf = best;
+    slot->y = shelf.y;
+    slot->width = width;
+    slot->height = height;
+
+    page->entryCount++;
+
+    return true;
+}
+
+void DynamicAtlas::release(Slot* slot) {
+    Page* page = slot->page;
+
+    if (--page->entryCount == 0) {
+        page->shelves.clear();
+        page->nextShelf = 0;
+        return;
+    }
+
+    Shelf& shelf = page->shelves.editItemAt(slot->shelf);
+    Vector<Span>& spans = shelf.freeSpans;
+
+    Span span;
+    span.x = slot->x;
+    span.width = slot->width;
+
+    // Keep the spans sorted and merge the adjacent ones
+    size_t i = 0;
+    while (i < spans.size() && spans.itemAt(i).x < span.x) i++;
+
+    if (i < spans.size() && span.x + span.width == spans.itemAt(i).x) {
+        span.width += spans.itemAt(i).width;
+        spans.removeAt(i);
+    }
+
+    if (i > 0 && spans.itemAt(i - 1).x + spans.itemAt(i - 1).width == span.x) {
+        spans.editItemAt(i - 1).width += span.width;
+    } else {
+        spans.insertAt(span, i);
+    }
+
+    // Give the space freed at the end of the shelf back to the cursor
+    if (!spans.isEmpty() && spans.top().x + spans.top().width == shelf.cursor) {
+        shelf.cursor = spans.top().x;
+        spans.pop();
+    }
+
+    // Give the space of the empty shelves at the bottom of the page back
+    while (!page->shelves.isEmpty() && page->shelves.top().cursor == 0) {
+        page->nextShelf = page->shelves.top().y;
+        page->shelves.pop();
+    }
+}
+
+bool DynamicAtlas::evict() {
+    // Entries used during the current frame may be referenced by deferred
+    // operations and must not be evicted
+    ssize_t victim = -1;
+    uint32_t oldest = mFrameCount;
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        const Slot* slot = mSlots.valueAt(i);
+        if (slot->lastUsed < oldest) {
+            victim = i;
+            oldest = slot->lastUsed;
+        }
+    }
+
+    if (victim < 0) return false;
+
+    ATLAS_LOGD("Evicting bitmap %p from the dynamic atlas", mSlots.keyAt(victim));
+    removeSlot(victim);
+
+    return true;
+}
+
+void DynamicAtlas::removeSlot(ssize_t index) {
+    Slot* slot = mSlots.valueAt(index);
+    release(slot);
+    delete slot->entry;
+    delete slot;
+    mSlots.removeItemsAt(index);
+}
+
+DynamicAtlas::Page* DynamicAtlas::createPage() {
+    Caches& caches = Caches::getInstance();
+    if (mPages.isEmpty()) {
+        mPageSize = caches.maxTextureSize < DYNAMIC_ATLAS_PAGE_SIZE ?
+                caches.maxTextureSize : DYNAMIC_ATLAS_PAGE_SIZE;
+    }
+
+    Page* page = new Page();
+    page->texture = new Texture(caches);
+
+    Texture* texture = page->texture;
+    texture->width = mPageSize;
+    texture->height = mPageSize;
+    texture->blend = true;
+
+    glGenTextures(1, &texture->id);
+    caches.bindTexture(texture->id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mPageSize, mPageSize, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    texture->setFilter(GL_NEAREST);
+    texture->setWrap(GL_CLAMP_TO_EDGE);
+
+    ATLAS_LOGD("Created dynamic atlas page %d (%dx%d)", mPages.size(), mPageSize, mPageSize);
+
+    mPages.add(page);
+    return page;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Upload
+///////////////////////////////////////////////////////////////////////////////
+
+bool DynamicAtlas::upload(Slot* slot, SkBitmap* bitmap) {
+    SkAutoLockPixels alp(*bitmap);
+
+    if (!bitmap->readyToDraw()) {
+        ALOGE("Cannot upload bitmap to the dynamic atlas");
+        return false;
+    }
+
+    Caches::getInstance().bindTexture(slot->page->texture->id);
+
+    const GLsizei stride = bitmap->rowBytesAsPixels();
+    const bool useStride = stride != bitmap->width();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, bitmap->bytesPerPixel());
+    if (useStride) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot->entry->x, slot->entry->y,
+            bitmap->width(), bitmap->height(), GL_RGBA, GL_UNSIGNED_BYTE, bitmap->getPixels());
+
+    if (useStride) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    slot->generation = bitmap->getGenerationID();
+    // Do this after calling getPixels() to make sure Skia's deferred
+    // decoding happened
+    slot->entry->texture->blend = !bitmap->isOpaque();
+
+    return true;
+}
+
+void DynamicAtlas::clearBorder(Slot* slot) {
+    // The slot may contain the pixels of an evicted entry
+    static const uint32_t sTransparent[DYNAMIC_ATLAS_MAX_ENTRY_SIZE + 2] = { 0 };
+
+    Caches::getInstance().bindTexture(slot->page->texture->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    const uint32_t right = slot->x + slot->width - 1;
+    const uint32_t bottom = slot->y + slot->height - 1;
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot->x, slot->y, slot->width, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, sTransparent);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot->x, bottom, slot->width, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, sTransparent);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot->x, slot->y, 1, slot->height,
+            GL_RGBA, GL_UNSIGNED_BYTE, sTransparent);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, right, slot->y, 1, slot->height,
+            GL_RGBA, GL_UNSIGNED_BYTE, sTransparent);
+}
+
+}; // namespace uirenderer
+}; // namespace android
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_DYNAMIC_ATLAS_H
+#define ANDROID_HWUI_DYNAMIC_ATLAS_H
+
+#include <GLES2/gl2.h>
+
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include <SkBitmap.h>
+
+#include "AssetAtlas.h"
+#include "Debug.h"
+#include "Texture.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Width and height of a page of the atlas, in pixels
+#define DYNAMIC_ATLAS_PAGE_SIZE 1024
+// Bitmaps larger than this in either dimension are never packed
+#define DYNAMIC_ATLAS_MAX_ENTRY_SIZE 256
+// Number of consecutive frames a bitmap must be drawn in before being packed
+#define DYNAMIC_ATLAS_MIN_FRAMES 3
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A dynamic atlas packs the application bitmaps drawn in many consecutive
+ * frames into a few shared textures, called pages, so that they can be
+ * merged into a single draw call like the bitmaps of the framework atlas.
+ *
+ * Each page is packed in shelves. Adding, removing or updating a bitmap
+ * only uploads the area of the page it occupies: a bitmap whose content
+ * changes is uploaded again at the same location and the space of evicted
+ * bitmaps is reused by the next bitmaps that fit in it.
+ *
+ * Entries are only evicted to make room for a bitmap when they were not
+ * used during the current frame. The entries returned by get() are thus
+ * valid until the end of the frame.
+ */
+class DynamicAtlas {
+public:
+    DynamicAtlas();
+    ~DynamicAtlas();
+
+    inline bool isEnabled() const {
+        return mMaxPageCount > 0;
+    }
+
+    /**
+     * Returns the entry associated with the specified bitmap. Bitmaps drawn
+     * often enough are packed in the atlas the first time this method is
+     * invoked in the frame that makes them eligible. Returns NULL if
+     * the bitmap is not in the atlas.
+     */
+    AssetAtlas::Entry* get(SkBitmap* bitmap);
+
+    /**
+     * Returns the texture for the atlas entry associated with the specified
+     * bitmap, without packing it. Returns NULL if the bitmap is not in the atlas.
+     */
+    Texture* getEntryTexture(SkBitmap* bitmap);
+
+    /**
+     * Removes the specified bitmap from the atlas. This method must be
+     * invoked from the rendering thread.
+     */
+    void remove(SkBitmap* bitmap);
+
+    /**
+     * Removes the specified bitmap from the atlas at the next call to
+     * clearGarbage(). This method can be invoked from any thread.
+     */
+    void removeDeferred(SkBitmap* bitmap);
+
+    /**
+     * Processes deferred removals.
+     */
+    void clearGarbage();
+
+    /**
+     * Destroys all the pages of the atlas.
+     */
+    void clear();
+
+    /**
+     * Marks the end of a frame rendered into the framebuffer.
+     */
+    void endFrame();
+
+    /**
+     * Returns the memory used by the pages of the atlas, in bytes.
+     */
+    uint32_t getSize() const;
+
+    /**
+     * Returns the maximum memory the pages of the atlas can use, in bytes.
+     */
+    uint32_t getMaxSize() const;
+
+private:
+    struct Span {
+        uint32_t x;
+        uint32_t width;
+    };
+
+    struct Shelf {
+        uint32_t y;
+        uint32_t height;
+        // Left edge of the space never allocated in this shelf
+        uint32_t cursor;
+        // Space freed by evicted entries, sorted by x
+        Vector<Span> freeSpans;
+    };
+
+    struct Page {
+        Page(): texture(NULL), entryCount(0), nextShelf(0),
+                blendKey(true), opaqueKey(false) {
+        }
+
+        Texture* texture;
+        uint32_t entryCount;
+        Vector<Shelf> shelves;
+        // Top edge of the space not used by any shelf
+        uint32_t nextShelf;
+
+        // Merge keys shared by the entries of this page
+        const bool blendKey;
+        const bool opaqueKey;
+    };
+
+    struct Slot {
+        AssetAtlas::Entry* entry;
+        Page* page;
+        size_t shelf;
+        // Location of the slot in the page, including the border
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+        uint32_t generation;
+        uint32_t lastUsed;
+    };
+
+    struct Candidate {
+        // Last frame the bitmap was drawn in
+        uint32_t lastFrame;
+        // Number of consecutive frames the bitmap was drawn in
+        uint32_t frameCount;
+    };
+
+    Slot* getSlot(SkBitmap* bitmap);
+    bool isPackable(SkBitmap* bitmap) const;
+
+    Slot* pack(SkBitmap* bitmap);
+    bool allocate(Page* page, uint32_t width, uint32_t height, Slot* slot);
+    static ssize_t findSpan(const Shelf& shelf, uint32_t width);
+    void release(Slot* slot);
+    bool evict();
+    Page* createPage();
+
+    bool upload(Slot* slot, SkBitmap* bitmap);
+    void clearBorder(Slot* slot);
+
+    void removeSlot(ssize_t index);
+
+    uint32_t mMaxPageCount;
+    uint32_t mPageSize;
+    uint32_t mFrameCount;
+
+    Vector<Page*> mPages;
+    KeyedVector<SkBitmap*, Slot*> mSlots;
+    KeyedVector<SkBitmap*, Candidate> mCandidates;
+
+    Vector<SkBitmap*> mGarbage;
+    mutable Mutex mLock;
+}; // class DynamicAtlas
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_DYNAMIC_ATLAS_H
@@ -91,6 +91,9 @@ Extensions::Extensions(): Singleton<Extensions>() {
         mVersionMajor = 2;
         mVersionMinor = 0;
     }
+
+    // The timer queries extension reuses the OpenGL ES 3.0 query entry points
+    mHasTimerQueries = mVersionMajor >= 3 && hasGlExtension("GL_EXT_disjoint_timer_query");
 }
 
 Extensions::~Extensions() {
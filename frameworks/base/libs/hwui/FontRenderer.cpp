@@ -107,6 +107,7 @@ FontRenderer::FontRenderer() :
     mInitialized = false;
 
     mCurrentCacheTexture = NULL;
+    mTextureUsage = 0;
 
     mLinearFiltering = false;
 
@@ -215,6 +216,47 @@ CacheTexture* FontRenderer::cacheBitmapInTexture(Vector<CacheTexture*>& cacheTex
     return NULL;
 }
 
+CacheTexture* FontRenderer::evictCacheTexture(Vector<CacheTexture*>& cacheTextures,
+        const SkGlyph& glyph, uint32_t* startX, uint32_t* startY) {
+    // Pick the least recently used texture that could hold the glyph once emptied.
+    // Textures without memory are already empty, they cannot hold it
+    CacheTexture* victim = NULL;
+    for (uint32_t i = 0; i < cacheTextures.size(); i++) {
+        CacheTexture* cacheTexture = cacheTextures[i];
+        if (!cacheTexture->getPixelBuffer() ||
+                glyph.fWidth + TEXTURE_BORDER_SIZE * 2 > cacheTexture->getWidth() ||
+                glyph.fHeight + TEXTURE_BORDER_SIZE * 2 > cacheTexture->getHeight()) {
+            continue;
+        }
+        if (!victim || cacheTexture->getLastUsed() < victim->getLastUsed()) {
+            victim = cacheTexture;
+        }
+    }
+
+    if (!victim) {
+        return NULL;
+    }
+
+#if DEBUG_FONT_RENDERER
+    ALOGD("Evicting %dx%d cache texture holding %d glyphs",
+            victim->getWidth(), victim->getHeight(), victim->getGlyphCount());
+#endif
+
+    // Pending quads may still sample the texture
+    issueDrawCommand();
+
+    victim->init();
+    LruCache<Font::FontDescription, Font*>::Iterator it(mActiveFonts);
+    while (it.next()) {
+        it.value()->invalidateTextureCache(victim);
+    }
+
+    if (victim->fitBitmap(glyph, startX, startY)) {
+        return victim;
+    }
+    return NULL;
+}
+
 void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyph,
         uint32_t* retOriginX, uint32_t* retOriginY, bool precaching) {
     checkInit();
@@ -264,9 +306,13 @@ void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyp
     if (!cacheTexture) {
         if (!precaching) {
             // If the new glyph didn't fit and we are not just trying to precache it,
-            // clear out the cache and try again
-            flushAllAndInvalidate();
-            cacheTexture = cacheBitmapInTexture(*cacheTextures, glyph, &startX, &startY);
+            // make room in the least recently used texture, or as a last resort
+            // clear out the cache, and try again
+            cacheTexture = evictCacheTexture(*cacheTextures, glyph, &startX, &startY);
+            if (!cacheTexture) {
+                flushAllAndInvalidate();
+                cacheTexture = cacheBitmapInTexture(*cacheTextures, glyph, &startX, &startY);
+            }
         }
 
         if (!cacheTexture) {
@@ -276,6 +322,7 @@ void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyp
     }
 
     cachedGlyph->mCacheTexture = cacheTexture;
+    cacheTexture->setLastUsed(mTextureUsage);
 
     *retOriginX = startX;
     *retOriginY = startY;
@@ -540,6 +587,7 @@ void FontRenderer::appendMeshQuadNoClip(float x1, float y1, float u1, float v1,
         // Now use the new texture id
         mCurrentCacheTexture = texture;
     }
+    texture->setLastUsed(mTextureUsage);
 
     mCurrentCacheTexture->addQuad(x1, y1, u1, v1, x2, y2, u2, v2,
             x3, y3, u3, v3, x4, y4, u4, v4);
@@ -591,7 +639,8 @@ void FontRenderer::setFont(SkPaint* paint, const mat4& matrix) {
 }
 
 FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const char *text,
-        uint32_t startIndex, uint32_t len, int numGlyphs, uint32_t radius, const float* positions) {
+        uint32_t startIndex, uint32_t len, int numGlyphs, uint32_t radius, const float* positions,
+        bool blur) {
     checkInit();
 
     DropShadow image;
@@ -647,7 +696,9 @@ FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const ch
         // Unbind any PBO we might have used
         Caches::getInstance().unbindPixelBuffer();
 
-        blurImage(&dataBuffer, paddedWidth, paddedHeight, radius);
+        if (blur) {
+            blurImage(&dataBuffer, paddedWidth, paddedHeight, radius);
+        }
     }
 
     image.width = paddedWidth;
@@ -662,6 +713,7 @@ FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const ch
 void FontRenderer::initRender(const Rect* clip, Rect* bounds, Functor* functor) {
     checkInit();
 
+    mTextureUsage++;
     mDrawn = false;
     mBounds = bounds;
     mFunctor = functor;
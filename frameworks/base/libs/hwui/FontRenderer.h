@@ -129,9 +129,11 @@ public:
     };
 
     // After renderDropShadow returns, the called owns the memory in DropShadow.image
-    // and is responsible for releasing it when it's done with it
+    // and is responsible for releasing it when it's done with it. When blur is false
+    // the image is padded by radius but left unblurred, for the caller to blur it
     DropShadow renderDropShadow(SkPaint* paint, const char *text, uint32_t startIndex,
-            uint32_t len, int numGlyphs, uint32_t radius, const float* positions);
+            uint32_t len, int numGlyphs, uint32_t radius, const float* positions,
+            bool blur = true);
 
     void setTextureFiltering(bool linearFiltering) {
         mLinearFiltering = linearFiltering;
@@ -152,6 +154,8 @@ private:
             uint32_t *retOriginX, uint32_t *retOriginY, bool precaching);
     CacheTexture* cacheBitmapInTexture(Vector<CacheTexture*>& cacheTextures, const SkGlyph& glyph,
             uint32_t* startX, uint32_t* startY);
+    CacheTexture* evictCacheTexture(Vector<CacheTexture*>& cacheTextures, const SkGlyph& glyph,
+            uint32_t* startX, uint32_t* startY);
 
     void flushAllAndInvalidate();
 
@@ -195,6 +199,9 @@ private:
 
     CacheTexture* mCurrentCacheTexture;
 
+    // Bumped for every text draw, stamps the cache textures when used
+    uint32_t mTextureUsage;
+
     bool mUploadTexture;
 
     Functor* mFunctor;
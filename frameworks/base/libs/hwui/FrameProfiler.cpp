@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <string.h>
+
+#include <cutils/atomic.h>
+
+#include "FrameProfiler.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Upper bounds, in milliseconds, of the histogram buckets. The last bucket
+// holds the frames taking longer than the last bound
+static const uint32_t gBucketBoundsMs[] = { 1, 2, 4, 8, 16, 32 };
+#define BUCKET_COUNT (sizeof(gBucketBoundsMs) / sizeof(uint32_t) + 1)
+
+static const char* gPhaseNames[] = { "Record", "Defer", "Issue", "GPU" };
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+FrameProfiler::FrameProfiler(): mEnabled(false), mInFrame(false),
+        mRecordDepth(0), mRecordStart(0), mPendingStart(0), mPendingCount(0), mActiveQuery(-1), mFrameCount(0) {
+    memset(mFrames, 0, sizeof(mFrames));
+    memset(mOps, 0, sizeof(mOps));
+    memset(mOpDurations, 0, sizeof(mOpDurations));
+    memset(mOpCounts, 0, sizeof(mOpCounts));
+    for (uint32_t i = 0; i < FRAME_PROFILER_PENDING_FRAMES; i++) {
+        mPendingFrames[i].query = NULL;
+    }
+    resetFrame();
+    mDurations[kPhaseRecord] = 0;
+}
+
+FrameProfiler::~FrameProfiler() {
+    terminate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Setup
+///////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::setEnabled(bool enabled) {
+    if (enabled == mEnabled) return;
+
+    mEnabled = enabled;
+    mInFrame = false;
+
+    if (mActiveQuery >= 0) {
+        mPendingFrames[mActiveQuery].query->end();
+    }
+
+    // Queries pending from a previous session would be attributed to the wrong frames
+    mPendingStart = 0;
+    mPendingCount = 0;
+    mActiveQuery = -1;
+
+    resetFrame();
+    mRecordDepth = 0;
+    mDurations[kPhaseRecord] = 0;
+}
+
+void FrameProfiler::terminate() {
+    for (uint32_t i = 0; i < FRAME_PROFILER_PENDING_FRAMES; i++) {
+        delete mPendingFrames[i].query;
+        mPendingFrames[i].query = NULL;
+    }
+    mPendingStart = 0;
+    mPendingCount = 0;
+    mActiveQuery = -1;
+    mInFrame = false;
+}
+
+void FrameProfiler::resetFrame() {
+    for (int i = kPhaseDefer; i < kPhase_Count; i++) {
+        mDurations[i] = 0;
+    }
+    mOpCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Frames
+///////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::beginFrame() {
+    if (!mEnabled || mInFrame) return;
+
+    mInFrame = true;
+    resetFrame();
+
+    if (Extensions::getInstance().hasTimerQueries()) {
+        if (mPendingCount == FRAME_PROFILER_PENDING_FRAMES) {
+            collectPendingFrames(true);
+        }
+
+        mActiveQuery = (mPendingStart + mPendingCount) % FRAME_PROFILER_PENDING_FRAMES;
+        PendingFrame& pending = mPendingFrames[mActiveQuery];
+        if (!pending.query) {
+            pending.query = new Query(Query::kTargetTimeElapsed);
+        }
+        pending.query->begin();
+    }
+}
+
+void FrameProfiler::endFrame() {
+    if (!mInFrame) return;
+    mInFrame = false;
+
+    Frame frame;
+    for (int i = 0; i < kPhase_Count; i++) {
+        frame.durations[i] = toUs(mDurations[i]);
+    }
+    frame.durations[kPhaseGpu] = kUnknownDuration;
+    frame.opCount = mOpCount;
+    mDurations[kPhaseRecord] = 0;
+
+    // Flush the per operation costs, keeping the sub-microsecond remainders
+    for (uint32_t i = 0; i < FRAME_PROFILER_MAX_OPS; i++) {
+        if (!mOpCounts[i] && mOpDurations[i] < 1000) continue;
+
+        OpSlot& slot = mOps[i];
+        const uint32_t durationUs = toUs(mOpDurations[i]);
+        slot.count += mOpCounts[i];
+        slot.durationUs += durationUs;
+        mOpDurations[i] -= us2ns(durationUs);
+        mOpCounts[i] = 0;
+    }
+
+    if (mActiveQuery >= 0) {
+        PendingFrame& pending = mPendingFrames[mActiveQuery];
+        pending.query->end();
+        pending.frame = frame;
+        mPendingCount++;
+        mActiveQuery = -1;
+        collectPendingFrames(false);
+    } else {
+        publish(frame);
+    }
+}
+
+void FrameProfiler::collectPendingFrames(bool dropOldest) {
+    if (!mPendingCount) return;
+
+    // Reading the disjoint state resets it, the results of all the queries
+    // in flight are meaningless if it was set
+    const bool disjoint = Query::isTimerDisjoint();
+
+    while (mPendingCount > 0) {
+        PendingFrame& pending = mPendingFrames[mPendingStart];
+        if (dropOldest || disjoint) {
+            pending.frame.durations[kPhaseGpu] = kUnknownDuration;
+        } else if (pending.query->isResultAvailable()) {
+            pending.frame.durations[kPhaseGpu] = toUs(pending.query->getResult());
+        } else {
+            break;
+        }
+
+        publish(pending.frame);
+        mPendingStart = (mPendingStart + 1) % FRAME_PROFILER_PENDING_FRAMES;
+        mPendingCount--;
+        dropOldest = false;
+    }
+}
+
+void FrameProfiler::publish(const Frame& frame) {
+    FrameSlot& slot = mFrames[mFrameCount % FRAME_PROFILER_FRAME_COUNT];
+
+    // The increments act as barriers, readers discard the slot if its
+    // sequence is odd or changes while they copy it
+    android_atomic_inc(&slot.sequence);
+    slot.frame = frame;
+    android_atomic_inc(&slot.sequence);
+
+    android_atomic_inc(&mFrameCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Recording
+///////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::beginRecord() {
+    if (mRecordDepth++ == 0) {
+        mRecordStart = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+}
+
+void FrameProfiler::endRecord() {
+    if (mRecordDepth > 0 && --mRecordDepth == 0) {
+        mDurations[kPhaseRecord] += systemTime(SYSTEM_TIME_MONOTONIC) - mRecordStart;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Operations
+///////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::addOpTime(const char* name, nsecs_t duration, uint32_t count) {
+    if (!mInFrame) return;
+
+    mOpCount += count;
+
+    // Names are static strings, hash their address and probe linearly
+    uint32_t index = (uint32_t(uintptr_t(name)) >> 2) % FRAME_PROFILER_MAX_OPS;
+    for (uint32_t i = 0; i < FRAME_PROFILER_MAX_OPS; i++) {
+        OpSlot& slot = mOps[index];
+        if (slot.name == name) break;
+        if (!slot.name) {
+            // Readers skip the slot until the name is set
+            slot.name = name;
+            android_memory_barrier();
+            break;
+        }
+        index = (index + 1) % FRAME_PROFILER_MAX_OPS;
+    }
+
+    if (mOps[index].name != name) {
+        // The table is full, the cost is still part of the frame
+        return;
+    }
+
+    mOpDurations[index] += duration;
+    mOpCounts[index] += count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Output
+///////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::dump(FILE* file) {
+    const int32_t frameCount = android_atomic_acquire_load(&mFrameCount);
+    if (!mEnabled && frameCount == 0) return;
+
+    uint32_t histograms[kPhase_Count][BUCKET_COUNT];
+    uint64_t totals[kPhase_Count];
+    uint32_t counts[kPhase_Count];
+    memset(histograms, 0, sizeof(histograms));
+    memset(totals, 0, sizeof(totals));
+    memset(counts, 0, sizeof(counts));
+
+    uint32_t frames = 0;
+    uint64_t totalOps = 0;
+    const int32_t slots = frameCount < FRAME_PROFILER_FRAME_COUNT ?
+            frameCount : FRAME_PROFILER_FRAME_COUNT;
+    for (int32_t i = 0; i < slots; i++) {
+        FrameSlot& slot = mFrames[i];
+
+        const int32_t sequence = android_atomic_acquire_load(&slot.sequence);
+        if (sequence & 1) continue;
+        Frame frame = slot.frame;
+        android_memory_barrier();
+        if (slot.sequence != sequence) continue;
+
+        for (int phase = 0; phase < kPhase_Count; phase++) {
+            const uint32_t duration = frame.durations[phase];
+            if (duration == kUnknownDuration) continue;
+
+            uint32_t bucket = 0;
+            while (bucket < BUCKET_COUNT - 1 && duration >= gBucketBoundsMs[bucket] * 1000) {
+                bucket++;
+            }
+            histograms[phase][bucket]++;
+            totals[phase] += duration;
+            counts[phase]++;
+        }
+        totalOps += frame.opCount;
+        frames++;
+    }
+
+    fprintf(file, "\nFrame profile (%d frames, %.1f ops per frame):\n",
+            frames, frames ? totalOps / float(frames) : 0.0f);
+    fprintf(file, "  %-8s %8s", "Phase", "Avg ms");
+    for (uint32_t i = 0; i < BUCKET_COUNT - 1; i++) {
+        fprintf(file, "   <%-3d", gBucketBoundsMs[i]);
+    }
+    fprintf(file, "  >=%-3d\n", gBucketBoundsMs[BUCKET_COUNT - 2]);
+
+    for (int phase = 0; phase < kPhase_Count; phase++) {
+        if (!counts[phase]) {
+            fprintf(file, "  %-8s      n/a\n", gPhaseNames[phase]);
+            continue;
+        }
+        fprintf(file, "  %-8s %8.2f", gPhaseNames[phase],
+                totals[phase] / (counts[phase] * 1000.0f));
+        for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+            fprintf(file, " %6d", histograms[phase][i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    // Ops are sorted by total cost, names may appear in several slots
+    // if the same string is stored at different addresses
+    const char* names[FRAME_PROFILER_MAX_OPS];
+    uint32_t opCounts[FRAME_PROFILER_MAX_OPS];
+    uint32_t opDurations[FRAME_PROFILER_MAX_OPS];
+    uint32_t opTotal = 0;
+    for (uint32_t i = 0; i < FRAME_PROFILER_MAX_OPS; i++) {
+        const char* name = mOps[i].name;
+        if (!name) continue;
+        android_memory_barrier();
+
+        uint32_t j = 0;
+        while (j < opTotal && strcmp(names[j], name)) j++;
+        if (j == opTotal) {
+            names[j] = name;
+            opCounts[j] = 0;
+            opDurations[j] = 0;
+            opTotal++;
+        }
+        opCounts[j] += mOps[i].count;
+        opDurations[j] += mOps[i].durationUs;
+    }
+
+    for (uint32_t i = 1; i < opTotal; i++) {
+        for (uint32_t j = i; j > 0 && opDurations[j] > opDurations[j - 1]; j--) {
+            const char* name = names[j];
+            names[j] = names[j - 1];
+            names[j - 1] = name;
+            uint32_t count = opCounts[j];
+            opCounts[j] = opCounts[j - 1];
+            opCounts[j - 1] = count;
+            uint32_t duration = opDurations[j];
+            opDurations[j] = opDurations[j - 1];
+            opDurations[j - 1] = duration;
+        }
+    }
+
+    fprintf(file, "\nIssue time by operation:\n");
+    for (uint32_t i = 0; i < opTotal; i++) {
+        fprintf(file, "  %-24s %10d calls %10.2f ms %8.2f us/call\n", names[i],
+                opCounts[i], opDurations[i] / 1000.0f,
+                opCounts[i] ? opDurations[i] / float(opCounts[i]) : 0.0f);
+    }
+}
+
+}; // namespace uirenderer
+}; // namespace android
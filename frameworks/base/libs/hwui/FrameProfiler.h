@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_FRAME_PROFILER_H
+#define ANDROID_HWUI_FRAME_PROFILER_H
+
+#include <stdio.h>
+
+#include <utils/Timers.h>
+
+#include "Debug.h"
+#include "Query.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Number of frames kept in the ring buffer
+#define FRAME_PROFILER_FRAME_COUNT 128
+// Number of distinct operations that can be attributed a cost
+#define FRAME_PROFILER_MAX_OPS 64
+// Number of frames whose GPU timer queries can be in flight at once
+#define FRAME_PROFILER_PENDING_FRAMES 3
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Gathers the CPU time spent recording, deferring and issuing each frame,
+ * the GPU time spent executing it when timer queries are supported, and
+ * the CPU time spent issuing each kind of operation.
+ *
+ * All the methods but dump() must be invoked from the rendering thread.
+ * Completed frames are published into a lock-free ring buffer that dump()
+ * can read from any thread, without blocking the renderer.
+ */
+class FrameProfiler {
+public:
+    enum Phase {
+        kPhaseRecord = 0,
+        kPhaseDefer,
+        kPhaseIssue,
+        kPhaseGpu,
+
+        kPhase_Count // Add other phases before this
+    };
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    inline bool isEnabled() const {
+        return mEnabled;
+    }
+
+    void setEnabled(bool enabled);
+
+    /**
+     * Destroys the GPU queries. Must be invoked with the GL context current.
+     */
+    void terminate();
+
+    /**
+     * Marks the beginning and the end of a frame rendered into the framebuffer.
+     * Time spent recording display lists is attributed to the next frame to end.
+     */
+    void beginFrame();
+    void endFrame();
+
+    inline void addTime(Phase phase, nsecs_t duration) {
+        mDurations[phase] += duration;
+    }
+
+    /**
+     * Marks the beginning and the end of a display list recording. Child
+     * display lists are recorded while their parent is, only the outermost
+     * recording is timed.
+     */
+    void beginRecord();
+    void endRecord();
+
+    /**
+     * Attributes the specified CPU time to an operation. The name must be
+     * a static string, such as the one returned by DisplayListOp::name().
+     * The count indicates how many operations were issued at once.
+     */
+    void addOpTime(const char* name, nsecs_t duration, uint32_t count = 1);
+
+    /**
+     * Outputs per phase histograms of the frames in the ring buffer,
+     * followed by the operations sorted by cost. Can be invoked from
+     * any thread.
+     */
+    void dump(FILE* file);
+
+private:
+    struct Frame {
+        // Durations in microseconds, kUnknownDuration if not measured
+        uint32_t durations[kPhase_Count];
+        // Operations and layers passed to addOpTime()
+        uint32_t opCount;
+    };
+
+    struct FrameSlot {
+        // Odd while the frame is being written
+        volatile int32_t sequence;
+        Frame frame;
+    };
+
+    struct OpSlot {
+        const char* volatile name;
+        // Both counters are cumulative since the profiler was created
+        volatile uint32_t count;
+        volatile uint32_t durationUs;
+    };
+
+    struct PendingFrame {
+        Frame frame;
+        Query* query;
+    };
+
+    static const uint32_t kUnknownDuration = 0xffffffff;
+
+    static inline uint32_t toUs(nsecs_t duration) {
+        return uint32_t(ns2us(duration));
+    }
+
+    /**
+     * Publishes frames whose GPU time is known. If dropOldest is true, the
+     * oldest pending frame is published without waiting for its GPU time.
+     */
+    void collectPendingFrames(bool dropOldest);
+    void publish(const Frame& frame);
+
+    void resetFrame();
+
+    bool mEnabled;
+    bool mInFrame;
+
+    uint32_t mRecordDepth;
+    nsecs_t mRecordStart;
+
+    // Accessed by the rendering thread only
+    nsecs_t mDurations[kPhase_Count];
+    uint32_t mOpCount;
+    // Pending per operation costs, flushed into mOps once per frame
+    nsecs_t mOpDurations[FRAME_PROFILER_MAX_OPS];
+    uint32_t mOpCounts[FRAME_PROFILER_MAX_OPS];
+
+    PendingFrame mPendingFrames[FRAME_PROFILER_PENDING_FRAMES];
+    uint32_t mPendingStart;
+    uint32_t mPendingCount;
+    int32_t mActiveQuery;
+
+    // Shared with the thread invoking dump()
+    FrameSlot mFrames[FRAME_PROFILER_FRAME_COUNT];
+    volatile int32_t mFrameCount;
+    OpSlot mOps[FRAME_PROFILER_MAX_OPS];
+}; // class FrameProfiler
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_FRAME_PROFILER_H
@@ -46,7 +46,6 @@ Layer::Layer(const uint32_t layerWidth, const uint32_t layerHeight):
     stencil = NULL;
     debugDrawUpdate = false;
     hasDrawnSinceUpdate = false;
-    deferredList = NULL;
     caches.resourceCache.incrementRefcount(this);
 }
 
@@ -56,7 +55,9 @@ Layer::~Layer() {
     deleteTexture();
 
     delete[] mesh;
-    delete deferredList;
+    for (size_t i = 0; i < deferredLists.size(); i++) {
+        delete deferredLists[i];
+    }
 }
 
 uint32_t Layer::computeIdealWidth(uint32_t layerWidth) {
@@ -69,7 +70,7 @@ uint32_t Layer::computeIdealHeight(uint32_t layerHeight) {
 
 bool Layer::resize(const uint32_t width, const uint32_t height) {
     uint32_t desiredWidth = computeIdealWidth(width);
-    uint32_t desiredHeight = computeIdealWidth(height);
+    uint32_t desiredHeight = computeIdealHeight(height);
 
     if (desiredWidth <= getWidth() && desiredHeight <= getHeight()) {
         return true;
@@ -185,6 +186,46 @@ void Layer::allocateTexture() {
     }
 }
 
+void Layer::addDirtyTiles(const Rect& r) {
+    if (r.isEmpty()) return;
+
+    // Updates falling in the same tiles are redrawn together
+    const android::Rect tiles(
+            int(floorf(r.left / LAYER_SIZE)) * LAYER_SIZE,
+            int(floorf(r.top / LAYER_SIZE)) * LAYER_SIZE,
+            int(ceilf(r.right / LAYER_SIZE)) * LAYER_SIZE,
+            int(ceilf(r.bottom / LAYER_SIZE)) * LAYER_SIZE);
+    dirtyTiles.orSelf(tiles);
+}
+
+void Layer::computeUpdateRects() {
+    updateRects.clear();
+
+    // Redrawing an area replays the whole display list, only split the
+    // update when the dirty tiles leave most of the dirty rect untouched
+    size_t count;
+    const android::Rect* tiles = dirtyTiles.getArray(&count);
+    if (count > 1 && count <= LAYER_MAX_DIRTY_TILES) {
+        float area = 0.0f;
+        for (size_t i = 0; i < count; i++) {
+            area += tiles[i].width() * tiles[i].height();
+        }
+        if (area * 2.0f <= dirtyRect.getWidth() * dirtyRect.getHeight()) {
+            for (size_t i = 0; i < count; i++) {
+                Rect bounds(tiles[i].left, tiles[i].top, tiles[i].right, tiles[i].bottom);
+                if (bounds.intersect(dirtyRect)) {
+                    updateRects.add(bounds);
+                }
+            }
+        }
+    }
+
+    if (updateRects.isEmpty()) {
+        updateRects.add(dirtyRect);
+    }
+    dirtyTiles.clear();
+}
+
 void Layer::defer() {
     const float width = layer.getWidth();
     const float height = layer.getHeight();
@@ -192,21 +233,31 @@ void Layer::defer() {
     if (dirtyRect.isEmpty() || (dirtyRect.left <= 0 && dirtyRect.top <= 0 &&
             dirtyRect.right >= width && dirtyRect.bottom >= height)) {
         dirtyRect.set(0, 0, width, height);
+        dirtyTiles.clear();
     }
+    computeUpdateRects();
 
-    if (deferredList) {
-        deferredList->reset(dirtyRect);
-    } else {
-        deferredList = new DeferredDisplayList(dirtyRect);
+    while (deferredLists.size() > updateRects.size()) {
+        delete deferredLists.top();
+        deferredLists.pop();
     }
-    DeferStateStruct deferredState(*deferredList, *renderer,
-            DisplayList::kReplayFlag_ClipChildren);
 
-    renderer->initViewport(width, height);
-    renderer->setupFrameState(dirtyRect.left, dirtyRect.top,
-            dirtyRect.right, dirtyRect.bottom, !isBlend());
+    for (size_t i = 0; i < updateRects.size(); i++) {
+        const Rect& bounds = updateRects[i];
+        if (i < deferredLists.size()) {
+            deferredLists[i]->reset(bounds);
+        } else {
+            deferredLists.add(new DeferredDisplayList(bounds));
+        }
+        DeferStateStruct deferredState(*deferredLists[i], *renderer,
+                DisplayList::kReplayFlag_ClipChildren);
 
-    displayList->defer(deferredState, 0);
+        renderer->initViewport(width, height);
+        renderer->setupFrameState(bounds.left, bounds.top,
+                bounds.right, bounds.bottom, !isBlend());
+
+        displayList->defer(deferredState, 0);
+    }
 
     deferredUpdateScheduled = false;
 }
@@ -215,22 +266,26 @@ void Layer::cancelDefer() {
     renderer = NULL;
     displayList = NULL;
     deferredUpdateScheduled = false;
-    if (deferredList) {
-        delete deferredList;
-        deferredList = NULL;
+    dirtyTiles.clear();
+    for (size_t i = 0; i < deferredLists.size(); i++) {
+        delete deferredLists[i];
     }
+    deferredLists.clear();
 }
 
 void Layer::flush() {
     // renderer is checked as layer may be destroyed/put in layer cache with flush scheduled
-    if (deferredList && renderer) {
-        renderer->setViewport(layer.getWidth(), layer.getHeight());
-        renderer->prepareDirty(dirtyRect.left, dirtyRect.top, dirtyRect.right, dirtyRect.bottom,
-                !isBlend());
+    if (!deferredLists.isEmpty() && renderer) {
+        for (size_t i = 0; i < deferredLists.size() && i < updateRects.size(); i++) {
+            Rect& bounds = updateRects.editItemAt(i);
+            renderer->setViewport(layer.getWidth(), layer.getHeight());
+            renderer->prepareDirty(bounds.left, bounds.top, bounds.right, bounds.bottom,
+                    !isBlend());
 
-        deferredList->flush(*renderer, dirtyRect);
+            deferredLists[i]->flush(*renderer, bounds);
 
-        renderer->finish();
+            renderer->finish();
+        }
         renderer = NULL;
 
         dirtyRect.setEmpty();
@@ -239,13 +294,18 @@ void Layer::flush() {
 }
 
 void Layer::render() {
-    renderer->setViewport(layer.getWidth(), layer.getHeight());
-    renderer->prepareDirty(dirtyRect.left, dirtyRect.top, dirtyRect.right, dirtyRect.bottom,
-            !isBlend());
+    computeUpdateRects();
 
-    renderer->drawDisplayList(displayList, dirtyRect, DisplayList::kReplayFlag_ClipChildren);
+    for (size_t i = 0; i < updateRects.size(); i++) {
+        Rect& bounds = updateRects.editItemAt(i);
+        renderer->setViewport(layer.getWidth(), layer.getHeight());
+        renderer->prepareDirty(bounds.left, bounds.top, bounds.right, bounds.bottom,
+                !isBlend());
+
+        renderer->drawDisplayList(displayList, bounds, DisplayList::kReplayFlag_ClipChildren);
 
-    renderer->finish();
+        renderer->finish();
+    }
     renderer = NULL;
 
     dirtyRect.setEmpty();
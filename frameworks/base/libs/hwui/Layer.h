@@ -23,6 +23,8 @@
 
 #include <ui/Region.h>
 
+#include <utils/Vector.h>
+
 #include <SkPaint.h>
 #include <SkXfermode.h>
 
@@ -88,6 +90,7 @@ struct Layer {
         this->displayList = displayList;
         const Rect r(left, top, right, bottom);
         dirtyRect.unionWith(r);
+        addDirtyTiles(r);
         deferredUpdateScheduled = true;
     }
 
@@ -290,6 +293,9 @@ struct Layer {
     bool hasDrawnSinceUpdate;
 
 private:
+    void addDirtyTiles(const Rect& r);
+    void computeUpdateRects();
+
     Caches& caches;
 
     /**
@@ -359,11 +365,22 @@ private:
      */
     mat4 transform;
 
+    /**
+     * Tiles of LAYER_SIZE touched by the updates since the last render.
+     */
+    Region dirtyTiles;
+
+    /**
+     * Areas redrawn by the current update: the dirty rect, or the groups
+     * of dirty tiles when they only cover a small part of it.
+     */
+    Vector<Rect> updateRects;
+
     /**
      * Used to defer display lists when the layer is updated with a
-     * display list.
+     * display list, one per update rect.
      */
-    DeferredDisplayList* deferredList;
+    Vector<DeferredDisplayList*> deferredLists;
 
 }; // struct Layer
 
@@ -31,7 +31,7 @@ namespace uirenderer {
 // Constructors/destructor
 ///////////////////////////////////////////////////////////////////////////////
 
-LayerCache::LayerCache(): mSize(0), mMaxSize(MB(DEFAULT_LAYER_CACHE_SIZE)) {
+LayerCache::LayerCache(): mSize(0), mMaxSize(MB(DEFAULT_LAYER_CACHE_SIZE)), mGeneration(0) {
     char property[PROPERTY_VALUE_MAX];
     if (property_get(PROPERTY_LAYER_CACHE_SIZE, property, NULL) > 0) {
         INIT_LOGD("  Setting layer cache size to %sMB", property);
@@ -58,7 +58,11 @@ uint32_t LayerCache::getMaxSize() {
 }
 
 void LayerCache::setMaxSize(uint32_t maxSize) {
-    clear();
+    // Keep the most recently released layers, the next animation is
+    // likely to ask for the same sizes again
+    while (mSize > maxSize && mCache.size() > 0) {
+        removeOldest();
+    }
     mMaxSize = maxSize;
 }
 
@@ -74,6 +78,65 @@ int LayerCache::LayerEntry::compare(const LayerCache::LayerEntry& lhs,
     return int(lhs.mHeight) - int(rhs.mHeight);
 }
 
+uint32_t LayerCache::computeSizeStep(uint32_t size) {
+    uint32_t bucket = LAYER_SIZE;
+    while (bucket < size) {
+        bucket <<= 1;
+    }
+    return bucket / 8 > LAYER_SIZE ? bucket / 8 : LAYER_SIZE;
+}
+
+ssize_t LayerCache::findBestFit(const uint32_t width, const uint32_t height) const {
+    const uint32_t idealWidth = Layer::computeIdealWidth(width);
+    const uint32_t idealHeight = Layer::computeIdealHeight(height);
+    const uint32_t maxWidth = idealWidth + computeSizeStep(idealWidth);
+    const uint32_t maxHeight = idealHeight + computeSizeStep(idealHeight);
+    const uint32_t maxTextureSize = Caches::getInstance().maxTextureSize;
+
+    ssize_t bestIndex = -1;
+    uint32_t bestArea = 0;
+
+    // The entries are sorted by width first, stop at the first one too wide
+    size_t count = mCache.size();
+    for (size_t i = 0; i < count; i++) {
+        const LayerEntry& entry = mCache.itemAt(i);
+        if (entry.mWidth >= maxWidth || entry.mWidth > maxTextureSize) break;
+        if (entry.mWidth < idealWidth || entry.mHeight < idealHeight ||
+                entry.mHeight >= maxHeight || entry.mHeight > maxTextureSize) {
+            continue;
+        }
+
+        const uint32_t area = entry.mWidth * entry.mHeight;
+        if (bestIndex < 0 || area < bestArea) {
+            bestIndex = i;
+            bestArea = area;
+        }
+    }
+
+    return bestIndex;
+}
+
+void LayerCache::removeOldest() {
+    size_t position = 0;
+#if LAYER_REMOVE_BIGGEST_FIRST
+    position = mCache.size() - 1;
+#else
+    size_t count = mCache.size();
+    for (size_t i = 1; i < count; i++) {
+        // Generations wrap around, compare their distance to the current one
+        if (mGeneration - mCache.itemAt(i).mGeneration >
+                mGeneration - mCache.itemAt(position).mGeneration) {
+            position = i;
+        }
+    }
+#endif
+    Layer* victim = mCache.itemAt(position).mLayer;
+    LAYER_LOGD("  Deleting layer %dx%d", victim->getWidth(), victim->getHeight());
+
+    deleteLayer(victim);
+    mCache.removeAt(position);
+}
+
 void LayerCache::deleteLayer(Layer* layer) {
     if (layer) {
         LAYER_LOGD("Destroying layer %dx%d, fbo %d", layer->getWidth(), layer->getHeight(),
@@ -95,7 +158,7 @@ Layer* LayerCache::get(const uint32_t width, const uint32_t height) {
     Layer* layer = NULL;
 
     LayerEntry entry(width, height);
-    ssize_t index = mCache.indexOf(entry);
+    ssize_t index = findBestFit(width, height);
 
     if (index >= 0) {
         entry = mCache.itemAt(index);
@@ -141,23 +204,13 @@ bool LayerCache::put(Layer* layer) {
     const uint32_t size = layer->getWidth() * layer->getHeight() * 4;
     // Don't even try to cache a layer that's bigger than the cache
     if (size < mMaxSize) {
-        // TODO: Use an LRU
         while (mSize + size > mMaxSize) {
-            size_t position = 0;
-#if LAYER_REMOVE_BIGGEST_FIRST
-            position = mCache.size() - 1;
-#endif
-            Layer* victim = mCache.itemAt(position).mLayer;
-            deleteLayer(victim);
-            mCache.removeAt(position);
-
-            LAYER_LOGD("  Deleting layer %.2fx%.2f", victim->layer.getWidth(),
-                    victim->layer.getHeight());
+            removeOldest();
         }
 
         layer->cancelDefer();
 
-        LayerEntry entry(layer);
+        LayerEntry entry(layer, ++mGeneration);
 
         mCache.add(entry);
         mSize += size;
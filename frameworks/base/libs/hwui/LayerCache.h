@@ -49,6 +49,10 @@ public:
      * layer can be found, a new one is created and returned. If creating a new
      * layer fails, NULL is returned.
      *
+     * A cached layer is suitable when it is less than one size step larger in
+     * each dimension, where the step is an eighth of the power of two above
+     * the dimension (and at least LAYER_SIZE). The smallest one is returned.
+     *
      * When a layer is obtained from the cache, it is removed and the total
      * size of the cache goes down.
      *
@@ -93,16 +97,18 @@ public:
 private:
     struct LayerEntry {
         LayerEntry():
-            mLayer(NULL), mWidth(0), mHeight(0) {
+            mLayer(NULL), mWidth(0), mHeight(0), mGeneration(0) {
         }
 
-        LayerEntry(const uint32_t layerWidth, const uint32_t layerHeight): mLayer(NULL) {
+        LayerEntry(const uint32_t layerWidth, const uint32_t layerHeight):
+                mLayer(NULL), mGeneration(0) {
             mWidth = Layer::computeIdealWidth(layerWidth);
             mHeight = Layer::computeIdealHeight(layerHeight);
         }
 
-        LayerEntry(Layer* layer):
-            mLayer(layer), mWidth(layer->getWidth()), mHeight(layer->getHeight()) {
+        LayerEntry(Layer* layer, uint32_t generation):
+            mLayer(layer), mWidth(layer->getWidth()), mHeight(layer->getHeight()),
+            mGeneration(generation) {
         }
 
         static int compare(const LayerEntry& lhs, const LayerEntry& rhs);
@@ -126,14 +132,21 @@ private:
         Layer* mLayer;
         uint32_t mWidth;
         uint32_t mHeight;
+        // Value of mGeneration when the layer was put in the cache
+        uint32_t mGeneration;
     }; // struct LayerEntry
 
+    static uint32_t computeSizeStep(uint32_t size);
+
+    ssize_t findBestFit(const uint32_t width, const uint32_t height) const;
+    void removeOldest();
     void deleteLayer(Layer* layer);
 
     SortedList<LayerEntry> mCache;
 
     uint32_t mSize;
     uint32_t mMaxSize;
+    uint32_t mGeneration;
 }; // class LayerCache
 
 }; // namespace uirenderer
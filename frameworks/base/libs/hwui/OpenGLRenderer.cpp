@@ -240,8 +240,20 @@ status_t OpenGLRenderer::prepareDirty(float left, float top,
     // for each layer and wait until the first drawing command
     // to start the frame
     if (mSnapshot->fbo == 0) {
+        mCaches.frameProfiler.beginFrame();
+
         syncState();
-        updateLayers();
+
+        if (CC_UNLIKELY(mCaches.frameProfiler.isEnabled() && !mLayerUpdates.isEmpty())) {
+            const uint32_t count = mLayerUpdates.size();
+            nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            updateLayers();
+            nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+            mCaches.frameProfiler.addTime(FrameProfiler::kPhaseDefer, duration);
+            mCaches.frameProfiler.addOpTime("DeferLayers", duration, count);
+        } else {
+            updateLayers();
+        }
     } else {
         return startFrame();
     }
@@ -313,6 +325,11 @@ void OpenGLRenderer::finish() {
     // of the current frame
     if (getTargetFbo() == 0) {
         mCaches.pathCache.trim();
+        mCaches.tessellationCache.trim();
+        mCaches.budget.update();
+        mCaches.programCache.endFrame();
+        mCaches.dynamicAtlas.endFrame();
+        mCaches.frameProfiler.endFrame();
     }
 
     if (!suppressErrorChecks()) {
@@ -369,25 +386,41 @@ void OpenGLRenderer::interrupt() {
 }
 
 void OpenGLRenderer::resume() {
+    resumeState(DrawGlInfo::kStateAll);
+}
+
+void OpenGLRenderer::resumeState(uint32_t modifiedState) {
     sp<Snapshot> snapshot = (mSnapshot != NULL) ? mSnapshot : mFirstSnapshot;
-    glViewport(0, 0, snapshot->viewport.getWidth(), snapshot->viewport.getHeight());
-    glBindFramebuffer(GL_FRAMEBUFFER, snapshot->fbo);
+    if (modifiedState & DrawGlInfo::kStateViewport) {
+        glViewport(0, 0, snapshot->viewport.getWidth(), snapshot->viewport.getHeight());
+    }
+    if (modifiedState & DrawGlInfo::kStateFramebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, snapshot->fbo);
+    }
     debugOverdraw(true, false);
 
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    if (modifiedState & DrawGlInfo::kStateClearColor) {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    }
 
-    mCaches.scissorEnabled = glIsEnabled(GL_SCISSOR_TEST);
-    mCaches.enableScissor();
-    mCaches.resetScissor();
-    dirtyClip();
+    if (modifiedState & DrawGlInfo::kStateClip) {
+        mCaches.scissorEnabled = glIsEnabled(GL_SCISSOR_TEST);
+        mCaches.enableScissor();
+        mCaches.resetScissor();
+        dirtyClip();
+    }
 
-    mCaches.activeTexture(0);
-    mCaches.resetBoundTextures();
+    if (modifiedState & DrawGlInfo::kStateTexture) {
+        mCaches.activeTexture(0);
+        mCaches.resetBoundTextures();
+    }
 
-    mCaches.blend = true;
-    glEnable(GL_BLEND);
-    glBlendFunc(mCaches.lastSrcMode, mCaches.lastDstMode);
-    glBlendEquation(GL_FUNC_ADD);
+    if (modifiedState & DrawGlInfo::kStateBlend) {
+        mCaches.blend = true;
+        glEnable(GL_BLEND);
+        glBlendFunc(mCaches.lastSrcMode, mCaches.lastDstMode);
+        glBlendEquation(GL_FUNC_ADD);
+    }
 }
 
 void OpenGLRenderer::resumeAfterLayer() {
@@ -427,9 +460,12 @@ status_t OpenGLRenderer::invokeFunctors(Rect& dirty) {
         info.height = 0;
         memset(info.transform, 0, sizeof(float) * 16);
 
+        uint32_t modifiedState = 0;
         for (size_t i = 0; i < count; i++) {
             Functor* f = functors.itemAt(i);
+            info.modifiedState = DrawGlInfo::kStateAll;
             result |= (*f)(DrawGlInfo::kModeProcess, &info);
+            modifiedState |= info.modifiedState;
 
             if (result & DrawGlInfo::kStatusDraw) {
                 Rect localDirty(info.dirtyLeft, info.dirtyTop, info.dirtyRight, info.dirtyBottom);
@@ -440,7 +476,7 @@ status_t OpenGLRenderer::invokeFunctors(Rect& dirty) {
                 mFunctors.add(f);
             }
         }
-        resume();
+        resumeState(modifiedState);
     }
 
     return result;
@@ -470,6 +506,7 @@ status_t OpenGLRenderer::callDrawGLFunction(Functor* functor, Rect& dirty) {
     info.width = getSnapshot()->viewport.getWidth();
     info.height = getSnapshot()->height;
     getSnapshot()->transform->copyTo(&info.transform[0]);
+    info.modifiedState = DrawGlInfo::kStateAll;
 
     bool dirtyClip = mDirtyClip;
     // setup GL state for functor
@@ -493,7 +530,7 @@ status_t OpenGLRenderer::callDrawGLFunction(Functor* functor, Rect& dirty) {
         }
     }
 
-    resume();
+    resumeState(info.modifiedState);
     return result | DrawGlInfo::kStatusDrew;
 }
 
@@ -641,14 +678,21 @@ void OpenGLRenderer::flushLayers() {
         startMark("Apply Layer Updates");
         char layerName[12];
 
+        const bool profile = mCaches.frameProfiler.isEnabled();
+
         // Note: it is very important to update the layers in order
         for (int i = 0; i < count; i++) {
             sprintf(layerName, "Layer #%d", i);
             startMark(layerName);
 
             ATRACE_BEGIN("flushLayer");
+            nsecs_t start = profile ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
             Layer* layer = mLayerUpdates.itemAt(i);
             layer->flush();
+            if (CC_UNLIKELY(profile)) {
+                mCaches.frameProfiler.addOpTime("FlushLayer",
+                        systemTime(SYSTEM_TIME_MONOTONIC) - start);
+            }
             ATRACE_END();
 
             mCaches.resourceCache.decrementRefcount(layer);
@@ -2033,10 +2077,18 @@ status_t OpenGLRenderer::drawDisplayList(DisplayList* displayList, Rect& dirty,
     // All the usual checks and setup operations (quickReject, setupDraw, etc.)
     // will be performed by the display list itself
     if (displayList && displayList->isRenderable()) {
+        // Layers are accounted for as a whole by the frame profiler
+        const bool profile = mCaches.frameProfiler.isEnabled() && getTargetFbo() == 0;
+        nsecs_t start = profile ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
         if (CC_UNLIKELY(mCaches.drawDeferDisabled)) {
             status = startFrame();
             ReplayStateStruct replayStruct(*this, dirty, replayFlags);
             displayList->replay(replayStruct, 0);
+            if (CC_UNLIKELY(profile)) {
+                mCaches.frameProfiler.addTime(FrameProfiler::kPhaseIssue,
+                        systemTime(SYSTEM_TIME_MONOTONIC) - start);
+            }
             return status | replayStruct.mDrawGlStatus;
         }
 
@@ -2045,10 +2097,21 @@ status_t OpenGLRenderer::drawDisplayList(DisplayList* displayList, Rect& dirty,
         DeferStateStruct deferStruct(deferredList, *this, replayFlags);
         displayList->defer(deferStruct, 0);
 
+        if (CC_UNLIKELY(profile)) {
+            nsecs_t end = systemTime(SYSTEM_TIME_MONOTONIC);
+            mCaches.frameProfiler.addTime(FrameProfiler::kPhaseDefer, end - start);
+            start = end;
+        }
+
         flushLayers();
         status = startFrame();
+        status |= deferredList.flush(*this, dirty);
 
-        return status | deferredList.flush(*this, dirty);
+        if (CC_UNLIKELY(profile)) {
+            mCaches.frameProfiler.addTime(FrameProfiler::kPhaseIssue,
+                    systemTime(SYSTEM_TIME_MONOTONIC) - start);
+        }
+        return status;
     }
 
     return DrawGlInfo::kStatusDone;
@@ -2509,7 +2572,13 @@ status_t OpenGLRenderer::drawPatches(SkBitmap* bitmap, AssetAtlas::Entry* entry,
 
 status_t OpenGLRenderer::drawVertexBuffer(const VertexBuffer& vertexBuffer, SkPaint* paint,
         bool useOffset) {
-    if (!vertexBuffer.getVertexCount()) {
+    return drawVertices(0, vertexBuffer.getBuffer(), vertexBuffer.getVertexCount(),
+            paint, useOffset);
+}
+
+status_t OpenGLRenderer::drawVertices(GLuint vbo, void* vertices, uint32_t vertexCount,
+        SkPaint* paint, bool useOffset) {
+    if (!vertexCount) {
         // no vertices to draw
         return DrawGlInfo::kStatusDone;
     }
@@ -2531,8 +2600,8 @@ status_t OpenGLRenderer::drawVertexBuffer(const VertexBuffer& vertexBuffer, SkPa
     setupDrawColorFilterUniforms();
     setupDrawShaderIdentityUniforms();
 
-    void* vertices = vertexBuffer.getBuffer();
-    bool force = mCaches.unbindMeshBuffer();
+    // With a VBO bound, vertices is an offset into it
+    bool force = vbo ? mCaches.bindMeshBuffer(vbo) : mCaches.unbindMeshBuffer();
     mCaches.bindPositionVertexPointer(true, vertices, isAA ? gAlphaVertexStride : gVertexStride);
     mCaches.resetTexCoordsVertexPointer();
     mCaches.unbindIndicesBuffer();
@@ -2547,7 +2616,7 @@ status_t OpenGLRenderer::drawVertexBuffer(const VertexBuffer& vertexBuffer, SkPa
         glVertexAttribPointer(alphaSlot, 1, GL_FLOAT, GL_FALSE, gAlphaVertexStride, alphaCoords);
     }
 
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, vertexBuffer.getVertexCount());
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, vertexCount);
 
     if (isAA) {
         glDisableVertexAttribArray(alphaSlot);
@@ -2579,6 +2648,15 @@ status_t OpenGLRenderer::drawConvexPath(const SkPath& path, SkPaint* paint) {
     return drawVertexBuffer(vertexBuffer, paint);
 }
 
+status_t OpenGLRenderer::drawTessellation(const TessellationBuffer* buffer, SkPaint* paint) {
+    if (hasLayer()) {
+        const SkRect& bounds = buffer->getBounds();
+        dirtyLayer(bounds.fLeft, bounds.fTop, bounds.fRight, bounds.fBottom, currentTransform());
+    }
+
+    return drawVertices(buffer->getVbo(), NULL, buffer->getVertexCount(), paint, false);
+}
+
 /**
  * We create tristrips for the lines much like shape stroke tessellation, using a per-vertex alpha
  * and additional geometry for defining an alpha slope perimeter.
@@ -2667,16 +2745,8 @@ status_t OpenGLRenderer::drawRoundRect(float left, float top, float right, float
         return drawShape(left, top, texture, p);
     }
 
-    SkPath path;
-    SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        float outset = p->getStrokeWidth() / 2;
-        rect.outset(outset, outset);
-        rx += outset;
-        ry += outset;
-    }
-    path.addRoundRect(rect, rx, ry);
-    return drawConvexPath(path, p);
+    return drawTessellation(mCaches.tessellationCache.getRoundRect(currentTransform(),
+            left, top, right, bottom, rx, ry, p), p);
 }
 
 status_t OpenGLRenderer::drawCircle(float x, float y, float radius, SkPaint* p) {
@@ -2691,13 +2761,8 @@ status_t OpenGLRenderer::drawCircle(float x, float y, float radius, SkPaint* p)
         return drawShape(x - radius, y - radius, texture, p);
     }
 
-    SkPath path;
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        path.addCircle(x, y, radius + p->getStrokeWidth() / 2);
-    } else {
-        path.addCircle(x, y, radius);
-    }
-    return drawConvexPath(path, p);
+    return drawTessellation(mCaches.tessellationCache.getCircle(currentTransform(),
+            x, y, radius, p), p);
 }
 
 status_t OpenGLRenderer::drawOval(float left, float top, float right, float bottom,
@@ -2713,13 +2778,8 @@ status_t OpenGLRenderer::drawOval(float left, float top, float right, float bott
         return drawShape(left, top, texture, p);
     }
 
-    SkPath path;
-    SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        rect.outset(p->getStrokeWidth() / 2, p->getStrokeWidth() / 2);
-    }
-    path.addOval(rect);
-    return drawConvexPath(path, p);
+    return drawTessellation(mCaches.tessellationCache.getOval(currentTransform(),
+            left, top, right, bottom, p), p);
 }
 
 status_t OpenGLRenderer::drawArc(float left, float top, float right, float bottom,
@@ -2741,20 +2801,8 @@ status_t OpenGLRenderer::drawArc(float left, float top, float right, float botto
         return drawShape(left, top, texture, p);
     }
 
-    SkRect rect = SkRect::MakeLTRB(left, top, right, bottom);
-    if (p->getStyle() == SkPaint::kStrokeAndFill_Style) {
-        rect.outset(p->getStrokeWidth() / 2, p->getStrokeWidth() / 2);
-    }
-
-    SkPath path;
-    if (useCenter) {
-        path.moveTo(rect.centerX(), rect.centerY());
-    }
-    path.arcTo(rect, startAngle, sweepAngle, !useCenter);
-    if (useCenter) {
-        path.close();
-    }
-    return drawConvexPath(path, p);
+    return drawTessellation(mCaches.tessellationCache.getArc(currentTransform(),
+            left, top, right, bottom, startAngle, sweepAngle, useCenter, p), p);
 }
 
 // See SkPaintDefaults.h
@@ -3235,7 +3283,10 @@ SkPaint* OpenGLRenderer::filterPaint(SkPaint* paint) {
 Texture* OpenGLRenderer::getTexture(SkBitmap* bitmap) {
     Texture* texture = mCaches.assetAtlas.getEntryTexture(bitmap);
     if (!texture) {
-        return mCaches.textureCache.get(bitmap);
+        texture = mCaches.dynamicAtlas.getEntryTexture(bitmap);
+        if (!texture) {
+            return mCaches.textureCache.get(bitmap);
+        }
     }
     return texture;
 }
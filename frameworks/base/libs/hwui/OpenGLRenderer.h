@@ -464,6 +464,12 @@ protected:
      */
     void resumeAfterLayer();
 
+    /**
+     * Restores the given DrawGlInfo::State after a functor, the
+     * rest of the GL state is assumed to be unchanged.
+     */
+    void resumeState(uint32_t modifiedState);
+
     /**
      * This method is called whenever a stencil buffer is required. Subclasses
      * should override this method and call attachStencilBufferToLayer() on the
@@ -774,6 +780,26 @@ private:
     status_t drawVertexBuffer(const VertexBuffer& vertexBuffer, SkPaint* paint,
             bool useOffset = false);
 
+    /**
+     * Renders a strip of polygons with the specified paint.
+     *
+     * @param vbo The buffer object holding the vertices, or 0 to draw from client memory
+     * @param vertices The vertices, or their offset into vbo
+     * @param vertexCount The number of vertices to draw
+     * @param paint The paint to render with
+     * @param useOffset Offset the vertices (used in drawing non-AA lines)
+     */
+    status_t drawVertices(GLuint vbo, void* vertices, uint32_t vertexCount, SkPaint* paint,
+            bool useOffset);
+
+    /**
+     * Renders a convex shape tessellated by the tessellation cache.
+     *
+     * @param buffer The tessellated shape
+     * @param paint The paint to render with
+     */
+    status_t drawTessellation(const TessellationBuffer* buffer, SkPaint* paint);
+
     /**
      * Renders the convex hull defined by the specified path as a strip of polygons.
      *
@@ -421,39 +421,44 @@ static SkPath* getSourcePath(SkPath* path) {
     return path;
 }
 
+PathTexture* PathCache::get(const PathDescription& entry) {
+    PathTexture* texture = mCache.get(entry);
+
+    // A bitmap is attached to the texture, this means we need to
+    // upload it as a GL texture
+    if (texture && texture->task() != NULL) {
+        // But we must first wait for the worker thread to be done
+        // producing the bitmap, so let's wait
+        SkBitmap* bitmap = texture->task()->getResult();
+        if (bitmap) {
+            generateTexture(entry, bitmap, texture, false);
+            texture->clearTask();
+        } else {
+            ALOGW("Shape too large to be rendered into a texture");
+            texture->clearTask();
+            texture = NULL;
+            mCache.remove(entry);
+        }
+    }
+
+    return texture;
+}
+
 PathTexture* PathCache::get(SkPath* path, SkPaint* paint) {
     path = getSourcePath(path);
 
     PathDescription entry(kShapePath, paint);
     entry.shape.path.mPath = path;
 
-    PathTexture* texture = mCache.get(entry);
+    PathTexture* texture = get(entry);
 
     if (!texture) {
         texture = addTexture(entry, path, paint);
-    } else {
-        // A bitmap is attached to the texture, this means we need to
-        // upload it as a GL texture
-        const sp<Task<SkBitmap*> >& task = texture->task();
-        if (task != NULL) {
-            // But we must first wait for the worker thread to be done
-            // producing the bitmap, so let's wait
-            SkBitmap* bitmap = task->getResult();
-            if (bitmap) {
-                generateTexture(entry, bitmap, texture, false);
-                texture->clearTask();
-            } else {
-                ALOGW("Path too large to be rendered into a texture");
-                texture->clearTask();
-                texture = NULL;
-                mCache.remove(entry);
-            }
-        } else if (path->getGenerationID() != texture->generation) {
-            // The size of the path might have changed so we first
-            // remove the entry from the cache
-            mCache.remove(entry);
-            texture = addTexture(entry, path, paint);
-        }
+    } else if (path->getGenerationID() != texture->generation) {
+        // The size of the path might have changed so we first
+        // remove the entry from the cache
+        mCache.remove(entry);
+        texture = addTexture(entry, path, paint);
     }
 
     return texture;
@@ -482,45 +487,59 @@ void PathCache::precache(SkPath* path, SkPaint* paint) {
     if (generate) {
         // It is important to specify the generation ID so we do not
         // attempt to precache the same path several times
-        texture = createTexture(0.0f, 0.0f, 0.0f, 0, 0, path->getGenerationID());
-        sp<PathTask> task = new PathTask(path, paint, texture);
-        texture->setTask(task);
-
-        // During the precaching phase we insert path texture objects into
-        // the cache that do not point to any GL texture. They are instead
-        // treated as a task for the precaching worker thread. This is why
-        // we do not check the cache limit when inserting these objects.
-        // The conversion into GL texture will happen in get(), when a client
-        // asks for a path texture. This is also when the cache limit will
-        // be enforced.
-        mCache.put(entry, texture);
-
-        if (mProcessor == NULL) {
-            mProcessor = new PathProcessor(Caches::getInstance());
-        }
-        mProcessor->add(task);
+        precache(entry, path, paint, path->getGenerationID(), false);
+    }
+}
+
+void PathCache::precache(const PathDescription& entry, SkPath* path, SkPaint* paint,
+        uint32_t generation, bool ownsPath) {
+    PathTexture* texture = createTexture(0.0f, 0.0f, 0.0f, 0, 0, generation);
+    sp<PathTask> task = new PathTask(path, paint, texture, ownsPath);
+    texture->setTask(task);
+
+    // During the precaching phase we insert path texture objects into
+    // the cache that do not point to any GL texture. They are instead
+    // treated as a task for the precaching worker thread. This is why
+    // we do not check the cache limit when inserting these objects.
+    // The conversion into GL texture will happen in get(), when a client
+    // asks for a path texture. This is also when the cache limit will
+    // be enforced.
+    mCache.put(entry, texture);
+
+    if (mProcessor == NULL) {
+        mProcessor = new PathProcessor(Caches::getInstance());
     }
+    mProcessor->add(task);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Rounded rects
 ///////////////////////////////////////////////////////////////////////////////
 
-PathTexture* PathCache::getRoundRect(float width, float height,
-        float rx, float ry, SkPaint* paint) {
-    PathDescription entry(kShapeRoundRect, paint);
+static void initRoundRect(PathDescription& entry, float width, float height,
+        float rx, float ry) {
     entry.shape.roundRect.mWidth = width;
     entry.shape.roundRect.mHeight = height;
     entry.shape.roundRect.mRx = rx;
     entry.shape.roundRect.mRy = ry;
+}
+
+static void addRoundRect(SkPath& path, float width, float height, float rx, float ry) {
+    SkRect r;
+    r.set(0.0f, 0.0f, width, height);
+    path.addRoundRect(r, rx, ry, SkPath::kCW_Direction);
+}
+
+PathTexture* PathCache::getRoundRect(float width, float height,
+        float rx, float ry, SkPaint* paint) {
+    PathDescription entry(kShapeRoundRect, paint);
+    initRoundRect(entry, width, height, rx, ry);
 
     PathTexture* texture = get(entry);
 
     if (!texture) {
         SkPath path;
-        SkRect r;
-        r.set(0.0f, 0.0f, width, height);
-        path.addRoundRect(r, rx, ry, SkPath::kCW_Direction);
+        addRoundRect(path, width, height, rx, ry);
 
         texture = addTexture(entry, &path, paint);
     }
@@ -528,6 +547,23 @@ PathTexture* PathCache::getRoundRect(float width, float height,
     return texture;
 }
 
+void PathCache::precacheRoundRect(float width, float height,
+        float rx, float ry, SkPaint* paint) {
+    if (!Caches::getInstance().tasks.canRunTasks()) {
+        return;
+    }
+
+    PathDescription entry(kShapeRoundRect, paint);
+    initRoundRect(entry, width, height, rx, ry);
+
+    if (!mCache.get(entry)) {
+        SkPath* path = new SkPath();
+        addRoundRect(*path, width, height, rx, ry);
+
+        precache(entry, path, paint, 0, true);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Circles
 ///////////////////////////////////////////////////////////////////////////////
@@ -548,10 +584,32 @@ PathTexture* PathCache::getCircle(float radius, SkPaint* paint) {
     return texture;
 }
 
+void PathCache::precacheCircle(float radius, SkPaint* paint) {
+    if (!Caches::getInstance().tasks.canRunTasks()) {
+        return;
+    }
+
+    PathDescription entry(kShapeCircle, paint);
+    entry.shape.circle.mRadius = radius;
+
+    if (!mCache.get(entry)) {
+        SkPath* path = new SkPath();
+        path->addCircle(radius, radius, radius, SkPath::kCW_Direction);
+
+        precache(entry, path, paint, 0, true);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Ovals
 ///////////////////////////////////////////////////////////////////////////////
 
+static void addOval(SkPath& path, float width, float height) {
+    SkRect r;
+    r.set(0.0f, 0.0f, width, height);
+    path.addOval(r, SkPath::kCW_Direction);
+}
+
 PathTexture* PathCache::getOval(float width, float height, SkPaint* paint) {
     PathDescription entry(kShapeOval, paint);
     entry.shape.oval.mWidth = width;
@@ -561,9 +619,7 @@ PathTexture* PathCache::getOval(float width, float height, SkPaint* paint) {
 
     if (!texture) {
         SkPath path;
-        SkRect r;
-        r.set(0.0f, 0.0f, width, height);
-        path.addOval(r, SkPath::kCW_Direction);
+        addOval(path, width, height);
 
         texture = addTexture(entry, &path, paint);
     }
@@ -571,6 +627,23 @@ PathTexture* PathCache::getOval(float width, float height, SkPaint* paint) {
     return texture;
 }
 
+void PathCache::precacheOval(float width, float height, SkPaint* paint) {
+    if (!Caches::getInstance().tasks.canRunTasks()) {
+        return;
+    }
+
+    PathDescription entry(kShapeOval, paint);
+    entry.shape.oval.mWidth = width;
+    entry.shape.oval.mHeight = height;
+
+    if (!mCache.get(entry)) {
+        SkPath* path = new SkPath();
+        addOval(*path, width, height);
+
+        precache(entry, path, paint, 0, true);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Rects
 ///////////////////////////////////////////////////////////////////////////////
@@ -598,28 +671,38 @@ PathTexture* PathCache::getRect(float width, float height, SkPaint* paint) {
 // Arcs
 ///////////////////////////////////////////////////////////////////////////////
 
-PathTexture* PathCache::getArc(float width, float height,
-        float startAngle, float sweepAngle, bool useCenter, SkPaint* paint) {
-    PathDescription entry(kShapeArc, paint);
+static void initArc(PathDescription& entry, float width, float height,
+        float startAngle, float sweepAngle, bool useCenter) {
     entry.shape.arc.mWidth = width;
     entry.shape.arc.mHeight = height;
     entry.shape.arc.mStartAngle = startAngle;
     entry.shape.arc.mSweepAngle = sweepAngle;
     entry.shape.arc.mUseCenter = useCenter;
+}
+
+static void addArc(SkPath& path, float width, float height,
+        float startAngle, float sweepAngle, bool useCenter) {
+    SkRect r;
+    r.set(0.0f, 0.0f, width, height);
+    if (useCenter) {
+        path.moveTo(r.centerX(), r.centerY());
+    }
+    path.arcTo(r, startAngle, sweepAngle, !useCenter);
+    if (useCenter) {
+        path.close();
+    }
+}
+
+PathTexture* PathCache::getArc(float width, float height,
+        float startAngle, float sweepAngle, bool useCenter, SkPaint* paint) {
+    PathDescription entry(kShapeArc, paint);
+    initArc(entry, width, height, startAngle, sweepAngle, useCenter);
 
     PathTexture* texture = get(entry);
 
     if (!texture) {
         SkPath path;
-        SkRect r;
-        r.set(0.0f, 0.0f, width, height);
-        if (useCenter) {
-            path.moveTo(r.centerX(), r.centerY());
-        }
-        path.arcTo(r, startAngle, sweepAngle, !useCenter);
-        if (useCenter) {
-            path.close();
-        }
+        addArc(path, width, height, startAngle, sweepAngle, useCenter);
 
         texture = addTexture(entry, &path, paint);
     }
@@ -627,5 +710,22 @@ PathTexture* PathCache::getArc(float width, float height,
     return texture;
 }
 
+void PathCache::precacheArc(float width, float height,
+        float startAngle, float sweepAngle, bool useCenter, SkPaint* paint) {
+    if (!Caches::getInstance().tasks.canRunTasks()) {
+        return;
+    }
+
+    PathDescription entry(kShapeArc, paint);
+    initArc(entry, width, height, startAngle, sweepAngle, useCenter);
+
+    if (!mCache.get(entry)) {
+        SkPath* path = new SkPath();
+        addArc(*path, width, height, startAngle, sweepAngle, useCenter);
+
+        precache(entry, path, paint, 0, true);
+    }
+}
+
 }; // namespace uirenderer
 }; // namespace android
@@ -241,6 +241,16 @@ public:
      */
     void precache(SkPath* path, SkPaint* paint);
 
+    /**
+     * Precache the specified shapes using background threads. The
+     * texture is picked up by the matching get method.
+     */
+    void precacheRoundRect(float width, float height, float rx, float ry, SkPaint* paint);
+    void precacheCircle(float radius, SkPaint* paint);
+    void precacheOval(float width, float height, SkPaint* paint);
+    void precacheArc(float width, float height, float startAngle, float sweepAngle,
+            bool useCenter, SkPaint* paint);
+
     static bool canDrawAsConvexPath(SkPath* path, SkPaint* paint);
     static void computePathBounds(const SkPath* path, const SkPaint* paint,
             float& left, float& top, float& offset, uint32_t& width, uint32_t& height);
@@ -261,9 +271,19 @@ private:
     void generateTexture(const PathDescription& entry, SkBitmap* bitmap, PathTexture* texture,
             bool addToCache = true);
 
-    PathTexture* get(const PathDescription& entry) {
-        return mCache.get(entry);
-    }
+    /**
+     * Returns the texture for the specified entry, waiting for and
+     * uploading the result of its precaching task if there is one.
+     */
+    PathTexture* get(const PathDescription& entry);
+
+    /**
+     * Inserts a placeholder texture for the specified entry and hands the
+     * path over to a worker thread. If ownsPath is true, the path is
+     * deleted by the task once done.
+     */
+    void precache(const PathDescription& entry, SkPath* path, SkPaint* paint,
+            uint32_t generation, bool ownsPath);
 
     /**
      * Removes an entry.
@@ -292,17 +312,22 @@ private:
 
     class PathTask: public Task<SkBitmap*> {
     public:
-        PathTask(SkPath* path, SkPaint* paint, PathTexture* texture):
-            path(path), paint(paint), texture(texture) {
+        PathTask(SkPath* path, SkPaint* paint, PathTexture* texture, bool ownsPath):
+            path(path), paint(paint), texture(texture), ownsPath(ownsPath) {
         }
 
         ~PathTask() {
             delete future()->get();
+            if (ownsPath) {
+                delete path;
+            }
         }
 
         SkPath* path;
         SkPaint* paint;
         PathTexture* texture;
+        // Shapes are turned into paths that only live as long as the task
+        bool ownsPath;
     };
 
     class PathProcessor: public TaskProcessor<SkBitmap*> {
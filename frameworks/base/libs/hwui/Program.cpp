@@ -19,6 +19,9 @@
 
 #include <utils/Trace.h>
 
+#include <GLES3/gl3.h>
+
+#include "Extensions.h"
 #include "Program.h"
 #include "Vertex.h"
 
@@ -53,6 +56,11 @@ Program::Program(const ProgramDescription& description, const char* vertex, cons
                 texCoords = -1;
             }
 
+            if (Extensions::getInstance().getMajorGlVersion() >= 3) {
+                // Lets the ProgramCache save the binary of this program
+                glProgramParameteri(mProgramId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+
             ATRACE_BEGIN("linkProgram");
             glLinkProgram(mProgramId);
             ATRACE_END();
@@ -90,21 +98,97 @@ Program::Program(const ProgramDescription& description, const char* vertex, cons
     }
 }
 
+Program::Program(const ProgramDescription& description, GLenum binaryFormat,
+        const void* binary, GLsizei length) {
+    mInitialized = false;
+    mHasColorUniform = false;
+    mHasSampler = false;
+    mUse = false;
+
+    // Programs loaded from a binary have no shader objects
+    mVertexShader = 0;
+    mFragmentShader = 0;
+
+    mProgramId = glCreateProgram();
+
+    ATRACE_BEGIN("loadProgramBinary");
+    if (Extensions::getInstance().getMajorGlVersion() >= 3) {
+        glProgramBinary(mProgramId, binaryFormat, binary, length);
+    } else {
+        glProgramBinaryOES(mProgramId, binaryFormat, binary, length);
+    }
+    ATRACE_END();
+
+    // A binary can be rejected at any time, after a driver update for instance
+    GLint status;
+    glGetProgramiv(mProgramId, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteProgram(mProgramId);
+        return;
+    }
+
+    // Attribute bindings are part of the binary
+    position = kBindingPosition;
+    mAttributes.add("position", kBindingPosition);
+    if (description.hasTexture || description.hasExternalTexture) {
+        texCoords = kBindingTexCoords;
+        mAttributes.add("texCoords", kBindingTexCoords);
+    } else {
+        texCoords = -1;
+    }
+
+    mInitialized = true;
+
+    transform = addUniform("transform");
+    projection = addUniform("projection");
+}
+
 Program::~Program() {
     if (mInitialized) {
         // This would ideally happen after linking the program
         // but Tegra drivers, especially when perfhud is enabled,
         // sometimes crash if we do so
-        glDetachShader(mProgramId, mVertexShader);
-        glDetachShader(mProgramId, mFragmentShader);
+        if (mVertexShader) {
+            glDetachShader(mProgramId, mVertexShader);
+            glDetachShader(mProgramId, mFragmentShader);
 
-        glDeleteShader(mVertexShader);
-        glDeleteShader(mFragmentShader);
+            glDeleteShader(mVertexShader);
+            glDeleteShader(mFragmentShader);
+        }
 
         glDeleteProgram(mProgramId);
     }
 }
 
+bool Program::getBinary(GLenum* binaryFormat, Vector<uint8_t>& binary) const {
+    if (!mInitialized) return false;
+
+    GLint length = 0;
+    glGetProgramiv(mProgramId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+
+    const size_t offset = binary.size();
+    binary.insertAt(offset, length);
+
+    GLsizei written = 0;
+    if (Extensions::getInstance().getMajorGlVersion() >= 3) {
+        glGetProgramBinary(mProgramId, length, &written, binaryFormat,
+                binary.editArray() + offset);
+    } else {
+        glGetProgramBinaryOES(mProgramId, length, &written, binaryFormat,
+                binary.editArray() + offset);
+    }
+
+    if (written <= 0) {
+        binary.removeItemsAt(offset, length);
+        return false;
+    }
+    if (written < length) {
+        binary.removeItemsAt(offset + written, length - written);
+    }
+    return true;
+}
+
 int Program::addAttrib(const char* name) {
     int slot = glGetAttribLocation(mProgramId, name);
     mAttributes.add(name, slot);
@@ -18,6 +18,7 @@
 #define ANDROID_HWUI_PROGRAM_H
 
 #include <utils/KeyedVector.h>
+#include <utils/Vector.h>
 
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
@@ -85,6 +86,11 @@ namespace uirenderer {
 #define PROGRAM_HAS_DEBUG_HIGHLIGHT 42
 #define PROGRAM_EMULATE_STENCIL 43
 
+#define PROGRAM_IS_BLUR 44
+
+// Largest radius supported by the blur program
+#define PROGRAM_BLUR_MAX_RADIUS 25
+
 ///////////////////////////////////////////////////////////////////////////////
 // Types
 ///////////////////////////////////////////////////////////////////////////////
@@ -161,6 +167,10 @@ struct ProgramDescription {
     bool hasDebugHighlight;
     bool emulateStencil;
 
+    // One pass of a separable gaussian blur of the red channel of
+    // the texture, requires OpenGL ES 3.0
+    bool isBlur;
+
     /**
      * Resets this description. All fields are reset back to the default
      * values they hold after building a new instance.
@@ -200,6 +210,8 @@ struct ProgramDescription {
         gamma = 2.2f;
 
         hasDebugHighlight = false;
+
+        isBlur = false;
     }
 
     /**
@@ -269,9 +281,61 @@ struct ProgramDescription {
         if (hasColors) key |= programid(0x1) << PROGRAM_HAS_COLORS;
         if (hasDebugHighlight) key |= programid(0x1) << PROGRAM_HAS_DEBUG_HIGHLIGHT;
         if (emulateStencil) key |= programid(0x1) << PROGRAM_EMULATE_STENCIL;
+        if (isBlur) key |= programid(0x1) << PROGRAM_IS_BLUR;
         return key;
     }
 
+    /**
+     * Sets the features of this description from a key computed by key().
+     * Fields that do not change the generated shaders, such as gamma, keep
+     * their default values.
+     */
+    void setKey(programid key) {
+        reset();
+
+        hasTexture = key & PROGRAM_KEY_TEXTURE;
+        hasAlpha8Texture = key & PROGRAM_KEY_A8_TEXTURE;
+        hasBitmap = key & PROGRAM_KEY_BITMAP;
+        if (hasBitmap) {
+            isBitmapNpot = key & PROGRAM_KEY_BITMAP_NPOT;
+            if (isBitmapNpot) {
+                bitmapWrapS = getWrapForEnum((key & PROGRAM_KEY_BITMAP_WRAPS_MASK) >>
+                        PROGRAM_BITMAP_WRAPS_SHIFT);
+                bitmapWrapT = getWrapForEnum((key & PROGRAM_KEY_BITMAP_WRAPT_MASK) >>
+                        PROGRAM_BITMAP_WRAPT_SHIFT);
+            }
+        }
+        hasGradient = key & PROGRAM_KEY_GRADIENT;
+        gradientType = Gradient((key >> PROGRAM_GRADIENT_TYPE_SHIFT) & 0x3);
+        isBitmapFirst = key & PROGRAM_KEY_BITMAP_FIRST;
+        if (hasBitmap && hasGradient) {
+            shadersMode = SkXfermode::Mode(
+                    (key >> PROGRAM_XFERMODE_SHADER_SHIFT) & PROGRAM_MAX_XFERMODE);
+        }
+        if (key & PROGRAM_KEY_COLOR_MATRIX) {
+            colorOp = kColorMatrix;
+        } else if (key & PROGRAM_KEY_COLOR_LIGHTING) {
+            colorOp = kColorLighting;
+        } else if (key & PROGRAM_KEY_COLOR_BLEND) {
+            colorOp = kColorBlend;
+            colorMode = SkXfermode::Mode(
+                    (key >> PROGRAM_XFERMODE_COLOR_OP_SHIFT) & PROGRAM_MAX_XFERMODE);
+        }
+        framebufferMode = SkXfermode::Mode(
+                (key >> PROGRAM_XFERMODE_FRAMEBUFFER_SHIFT) & PROGRAM_MAX_XFERMODE);
+        swapSrcDst = key & PROGRAM_KEY_SWAP_SRC_DST;
+        modulate = (key >> PROGRAM_MODULATE_SHIFT) & 0x1;
+        isAA = (key >> PROGRAM_HAS_AA_SHIFT) & 0x1;
+        hasExternalTexture = (key >> PROGRAM_HAS_EXTERNAL_TEXTURE_SHIFT) & 0x1;
+        hasTextureTransform = (key >> PROGRAM_HAS_TEXTURE_TRANSFORM_SHIFT) & 0x1;
+        hasGammaCorrection = (key >> PROGRAM_HAS_GAMMA_CORRECTION) & 0x1;
+        isSimpleGradient = (key >> PROGRAM_IS_SIMPLE_GRADIENT) & 0x1;
+        hasColors = (key >> PROGRAM_HAS_COLORS) & 0x1;
+        hasDebugHighlight = (key >> PROGRAM_HAS_DEBUG_HIGHLIGHT) & 0x1;
+        emulateStencil = (key >> PROGRAM_EMULATE_STENCIL) & 0x1;
+        isBlur = (key >> PROGRAM_IS_BLUR) & 0x1;
+    }
+
     /**
      * Logs the specified message followed by the key identifying this program.
      */
@@ -296,6 +360,16 @@ private:
         return 0;
     }
 
+    static inline GLenum getWrapForEnum(uint32_t wrap) {
+        switch (wrap) {
+            case 1:
+                return GL_REPEAT;
+            case 2:
+                return GL_MIRRORED_REPEAT;
+        }
+        return GL_CLAMP_TO_EDGE;
+    }
+
 }; // struct ProgramDescription
 
 /**
@@ -314,8 +388,20 @@ public:
      * shaders sources.
      */
     Program(const ProgramDescription& description, const char* vertex, const char* fragment);
+    /**
+     * Creates a new program from a binary previously returned by getBinary().
+     * The program is not initialized if the binary is rejected by the driver.
+     */
+    Program(const ProgramDescription& description, GLenum binaryFormat,
+            const void* binary, GLsizei length);
     virtual ~Program();
 
+    /**
+     * Appends the binary of this program to the specified buffer. Returns
+     * false if the binary cannot be retrieved.
+     */
+    bool getBinary(GLenum* binaryFormat, Vector<uint8_t>& binary) const;
+
     /**
      * Binds this program to the GL context.
      */
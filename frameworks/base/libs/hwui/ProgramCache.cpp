@@ -15,8 +15,16 @@
  */
 
 #define LOG_TAG "OpenGLRenderer"
+#define ATRACE_TAG ATRACE_TAG_VIEW
 
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <utils/JenkinsHash.h>
 #include <utils/String8.h>
+#include <utils/Trace.h>
 
 #include "Caches.h"
 #include "Dither.h"
@@ -29,6 +37,15 @@ namespace uirenderer {
 // Defines
 ///////////////////////////////////////////////////////////////////////////////
 
+// Persistent cache file
+#define PROGRAM_CACHE_MAGIC 0x43505748 // HWPC
+#define PROGRAM_CACHE_VERSION 1
+// Number of frames without a new program after which the cache file is saved
+#define PROGRAM_CACHE_SAVE_DELAY 120
+// Upper bounds used to reject corrupted cache files
+#define PROGRAM_CACHE_MAX_PROGRAMS 512
+#define PROGRAM_CACHE_MAX_BINARY_SIZE (1024 * 1024)
+
 #define MODULATE_OP_NO_MODULATE 0
 #define MODULATE_OP_MODULATE 1
 #define MODULATE_OP_MODULATE_A8 2
@@ -336,6 +353,23 @@ const char* gFS_Footer_EmulateStencil =
 const char* gFS_Footer =
         "}\n\n";
 
+// Blur, samples 2 * blurRadius + 1 texels along blurStep
+const char* gFS_Uniforms_Blur =
+        "uniform vec2 blurStep;\n"
+        "uniform int blurRadius;\n"
+        "uniform float blurWeights[" STR(PROGRAM_BLUR_MAX_RADIUS) " * 2 + 1];\n";
+const char* gFS_Main_Blur =
+        "\nvoid main(void) {\n"
+        "    float blurred = 0.0;\n"
+        "    highp vec2 texCoords = outTexCoords - blurStep * float(blurRadius);\n"
+        "    for (int i = 0; i <= " STR(PROGRAM_BLUR_MAX_RADIUS) " * 2; i++) {\n"
+        "        if (i > blurRadius * 2) break;\n"
+        "        blurred += texture2D(baseSampler, texCoords).r * blurWeights[i];\n"
+        "        texCoords += blurStep;\n"
+        "    }\n"
+        "    gl_FragColor = vec4(blurred);\n"
+        "}\n\n";
+
 ///////////////////////////////////////////////////////////////////////////////
 // PorterDuff snippets
 ///////////////////////////////////////////////////////////////////////////////
@@ -390,13 +424,242 @@ const char* gBlendOps[18] = {
 // Constructors/destructors
 ///////////////////////////////////////////////////////////////////////////////
 
-ProgramCache::ProgramCache(): mHasES3(Extensions::getInstance().getMajorGlVersion() >= 3) {
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    // Identifies the build of the system and of the driver the file was saved with
+    uint32_t buildId;
+    uint32_t count;
+};
+
+struct ProgramCacheEntry {
+    programid key;
+    uint32_t binaryFormat;
+    // 0 when the file only records the key of the program
+    uint32_t binaryLength;
+};
+
+static String8 sPersistentCacheFile;
+
+ProgramCache::ProgramCache(): mHasES3(Extensions::getInstance().getMajorGlVersion() >= 3),
+        mDirty(false), mIdleFrames(0) {
+    mHasProgramBinaries = false;
+    if (mHasES3 || Extensions::getInstance().hasGlExtension("GL_OES_get_program_binary")) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+        mHasProgramBinaries = formats > 0;
+    }
 }
 
 ProgramCache::~ProgramCache() {
     clear();
 }
 
+void ProgramCache::setPersistentCacheFile(const char* filename) {
+    sPersistentCacheFile.setTo(filename);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Persistence
+///////////////////////////////////////////////////////////////////////////////
+
+void ProgramCache::init() {
+    mFilename.clear();
+    mDirty = false;
+    mIdleFrames = 0;
+
+    if (sPersistentCacheFile.isEmpty()) return;
+
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_PERSISTENT_PROGRAMS, property, "true") > 0 &&
+            strcmp(property, "true")) {
+        INIT_LOGD("  Persistent programs disabled");
+        return;
+    }
+
+    mFilename = sPersistentCacheFile;
+    if (!load()) {
+        // Replace a stale or corrupted file as soon as possible
+        mDirty = true;
+    }
+
+    INIT_LOGD("  Loaded %d programs from %s", mCache.size(), mFilename.string());
+}
+
+void ProgramCache::endFrame() {
+    if (!mDirty || mFilename.isEmpty()) return;
+
+    if (++mIdleFrames >= PROGRAM_CACHE_SAVE_DELAY) {
+        save();
+        mDirty = false;
+        mIdleFrames = 0;
+    }
+}
+
+uint32_t ProgramCache::getBuildId() const {
+    // Programs must be compiled again when hwui or the driver change
+    char fingerprint[PROPERTY_VALUE_MAX];
+    int length = property_get("ro.build.fingerprint", fingerprint, "");
+
+    uint32_t hash = JenkinsHashMixBytes(0, (const uint8_t*) fingerprint, length);
+
+    const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_EXTENSIONS };
+    for (size_t i = 0; i < sizeof(strings) / sizeof(GLenum); i++) {
+        const char* s = (const char*) glGetString(strings[i]);
+        if (s) {
+            hash = JenkinsHashMixBytes(hash, (const uint8_t*) s, strlen(s));
+        }
+    }
+
+    return JenkinsHashWhiten(hash);
+}
+
+bool ProgramCache::load() {
+    ATRACE_NAME("loadPrograms");
+
+    FILE* file = fopen(mFilename.string(), "rb");
+    if (!file) return errno == ENOENT;
+
+    ProgramCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+            header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION &&
+            header.buildId == getBuildId() && header.count <= PROGRAM_CACHE_MAX_PROGRAMS;
+
+    Vector<uint8_t> binary;
+    for (uint32_t i = 0; valid && i < header.count; i++) {
+        ProgramCacheEntry entry;
+        if (fread(&entry, sizeof(entry), 1, file) != 1 ||
+                entry.binaryLength > PROGRAM_CACHE_MAX_BINARY_SIZE) {
+            valid = false;
+            break;
+        }
+
+        if (entry.binaryLength > 0) {
+            binary.resize(entry.binaryLength);
+            if (fread(binary.editArray(), 1, entry.binaryLength, file) != entry.binaryLength) {
+                valid = false;
+                break;
+            }
+        }
+
+        if (mCache.indexOfKey(entry.key) >= 0) continue;
+
+        ProgramDescription description;
+        description.setKey(entry.key);
+
+        Program* program = NULL;
+        if (entry.binaryLength > 0 && mHasProgramBinaries) {
+            program = new Program(description, entry.binaryFormat,
+                    binary.array(), entry.binaryLength);
+            if (!program->isInitialized()) {
+                delete program;
+                program = NULL;
+            }
+        }
+
+        if (!program) {
+            // Keys saved without a binary, and rejected binaries, are compiled
+            // now rather than during the first frames
+            description.log("Precompiling program");
+            program = generateProgram(description, entry.key);
+            if (mHasProgramBinaries) mDirty = true;
+        }
+
+        mCache.add(entry.key, program);
+    }
+
+    fclose(file);
+
+    if (!valid) {
+        ALOGW("Discarding invalid program cache file %s", mFilename.string());
+    }
+    return valid;
+}
+
+void ProgramCache::save() {
+    ATRACE_NAME("savePrograms");
+
+    sp<SaveTask> task = new SaveTask(mFilename);
+    Vector<uint8_t>& data = task->data;
+
+    ProgramCacheHeader header;
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.buildId = getBuildId();
+    header.count = 0;
+    data.appendArray((const uint8_t*) &header, sizeof(header));
+
+    for (size_t i = 0; i < mCache.size() && header.count < PROGRAM_CACHE_MAX_PROGRAMS; i++) {
+        Program* program = mCache.valueAt(i);
+        if (!program->isInitialized()) continue;
+
+        ProgramCacheEntry entry;
+        entry.key = mCache.keyAt(i);
+        entry.binaryFormat = 0;
+        entry.binaryLength = 0;
+
+        const size_t offset = data.size();
+        data.appendArray((const uint8_t*) &entry, sizeof(entry));
+
+        GLenum binaryFormat;
+        if (mHasProgramBinaries && program->getBinary(&binaryFormat, data)) {
+            entry.binaryFormat = binaryFormat;
+            entry.binaryLength = data.size() - offset - sizeof(entry);
+            if (entry.binaryLength > PROGRAM_CACHE_MAX_BINARY_SIZE) {
+                data.removeItemsAt(offset + sizeof(entry), entry.binaryLength);
+                entry.binaryFormat = 0;
+                entry.binaryLength = 0;
+            }
+            memcpy(data.editArray() + offset, &entry, sizeof(entry));
+        }
+
+        header.count++;
+    }
+
+    memcpy(data.editArray(), &header, sizeof(header));
+
+    // Writing the file can take a while, do it off the render thread if possible
+    Caches& caches = Caches::getInstance();
+    if (caches.tasks.canRunTasks()) {
+        if (mProcessor == NULL) {
+            mProcessor = new SaveProcessor(&caches.tasks);
+        }
+        if (mProcessor->add(task)) return;
+    }
+
+    write(mFilename, data);
+}
+
+bool ProgramCache::write(const String8& filename, const Vector<uint8_t>& data) {
+    // Write a temporary file first to never leave a truncated cache file behind
+    String8 temporary(filename);
+    temporary.append(".tmp");
+
+    FILE* file = fopen(temporary.string(), "wb");
+    if (!file) {
+        ALOGW("Could not open program cache file %s", temporary.string());
+        return false;
+    }
+
+    bool success = fwrite(data.array(), 1, data.size(), file) == data.size();
+    success = fclose(file) == 0 && success;
+    if (success) {
+        success = rename(temporary.string(), filename.string()) == 0;
+    }
+
+    if (!success) {
+        ALOGW("Could not write program cache file %s", filename.string());
+        unlink(temporary.string());
+    }
+    return success;
+}
+
+void ProgramCache::SaveProcessor::onProcess(const sp<Task<bool> >& task) {
+    sp<SaveTask> t = static_cast<SaveTask*>(task.get());
+    ATRACE_NAME("writeProgramCache");
+    t->setResult(write(t->filename, t->data));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Cache management
 ///////////////////////////////////////////////////////////////////////////////
@@ -425,6 +688,9 @@ Program* ProgramCache::get(const ProgramDescription& description) {
         description.log("Could not find program");
         program = generateProgram(description, key);
         mCache.add(key, program);
+
+        mDirty = true;
+        mIdleFrames = 0;
     } else {
         program = mCache.valueAt(index);
     }
@@ -541,6 +807,22 @@ String8 ProgramCache::generateFragmentShader(const ProgramDescription& descripti
     if (description.hasTexture || description.hasExternalTexture) {
         shader.append(gVS_Header_Varyings_HasTexture);
     }
+
+    // The blur program does not support any other feature
+    if (description.isBlur) {
+        shader.append(gFS_Uniforms_TextureSampler);
+        shader.append(gFS_Uniforms_Blur);
+        shader.append(gFS_Main_Blur);
+
+#if DEBUG_PROGRAMS
+        PROGRAM_LOGD("*** Blur case:\n");
+        PROGRAM_LOGD("*** Generated fragment shader:\n\n");
+        printLongString(shader);
+#endif
+
+        return shader;
+    }
+
     if (description.isAA) {
         shader.append(gVS_Header_Varyings_IsAAVertexShape);
     }
@@ -17,15 +17,20 @@
 #ifndef ANDROID_HWUI_PROGRAM_CACHE_H
 #define ANDROID_HWUI_PROGRAM_CACHE_H
 
+#include <cutils/compiler.h>
+
 #include <utils/KeyedVector.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 #include <GLES2/gl2.h>
 
 #include "Debug.h"
 #include "Program.h"
 #include "Properties.h"
+#include "thread/Task.h"
+#include "thread/TaskProcessor.h"
 
 namespace android {
 namespace uirenderer {
@@ -37,17 +42,62 @@ namespace uirenderer {
 /**
  * Generates and caches program. Programs are generated based on
  * ProgramDescriptions.
+ *
+ * When a persistent cache file is set, the keys of the programs used by
+ * the application are saved to that file, along with the program binaries
+ * when the driver supports them. The programs are then created from the
+ * file when the cache is initialized, instead of being compiled the first
+ * time they are needed during a frame.
  */
 class ProgramCache {
 public:
     ProgramCache();
     ~ProgramCache();
 
+    /**
+     * Sets the file used to persist the programs across launches. This
+     * method can be invoked before any GL context is created.
+     */
+    ANDROID_API static void setPersistentCacheFile(const char* filename);
+
+    /**
+     * Creates the programs saved in the persistent cache file, if any.
+     * Must be invoked with a current GL context.
+     */
+    void init();
+
+    /**
+     * Marks the end of a frame. Saves the persistent cache file once no
+     * new program was generated for a while.
+     */
+    void endFrame();
+
     Program* get(const ProgramDescription& description);
 
     void clear();
 
 private:
+    class SaveTask: public Task<bool> {
+    public:
+        SaveTask(const String8& filename): filename(filename) { }
+
+        String8 filename;
+        Vector<uint8_t> data;
+    };
+
+    class SaveProcessor: public TaskProcessor<bool> {
+    public:
+        SaveProcessor(TaskManager* manager): TaskProcessor<bool>(manager) { }
+        ~SaveProcessor() { }
+
+        virtual void onProcess(const sp<Task<bool> >& task);
+    };
+
+    bool load();
+    void save();
+    static bool write(const String8& filename, const Vector<uint8_t>& data);
+    uint32_t getBuildId() const;
+
     Program* generateProgram(const ProgramDescription& description, programid key);
     String8 generateVertexShader(const ProgramDescription& description);
     String8 generateFragmentShader(const ProgramDescription& description);
@@ -59,6 +109,14 @@ private:
     KeyedVector<programid, Program*> mCache;
 
     const bool mHasES3;
+
+    bool mHasProgramBinaries;
+    // Empty when the programs are not persisted
+    String8 mFilename;
+    // True when programs were generated since the cache file was saved
+    bool mDirty;
+    uint32_t mIdleFrames;
+    sp<SaveProcessor> mProcessor;
 }; // class ProgramCache
 
 }; // namespace uirenderer
@@ -38,6 +38,9 @@
 // Textures used by layers must have dimensions multiples of this number
 #define LAYER_SIZE 64
 
+// Maximum number of separate areas redrawn when a hardware layer is updated
+#define LAYER_MAX_DIRTY_TILES 4
+
 // Defines the size in bits of the stencil buffer for the framebuffer
 // Note: Only 1 bit is required for clipping but more bits are required
 // to properly implement overdraw debugging
@@ -115,6 +118,14 @@ enum DebugLevel {
  */
 #define PROPERTY_DISABLE_DRAW_REORDER "debug.hwui.disable_draw_reorder"
 
+/**
+ * Used to enable/disable the frame profiler. When enabled, the time spent
+ * recording, deferring, issuing and executing each frame, as well as the
+ * time spent issuing each kind of operation, is output by gfxinfo.
+ * The accepted values are "true" and "false". The default value is "false".
+ */
+#define PROPERTY_PROFILE_FRAMES "debug.hwui.profile_frames"
+
 ///////////////////////////////////////////////////////////////////////////////
 // Runtime configuration properties
 ///////////////////////////////////////////////////////////////////////////////
@@ -140,6 +151,13 @@ enum DebugLevel {
  */
 #define PROPERTY_ENABLE_GPU_PIXEL_BUFFERS "ro.hwui.use_gpu_pixel_buffers"
 
+/**
+ * Indicates whether the programs used by an application are saved to disk
+ * and compiled, or loaded from their binary, when the application starts.
+ * Accepted values are "true" and "false". Default is true.
+ */
+#define PROPERTY_PERSISTENT_PROGRAMS "ro.hwui.persistent_programs"
+
 // These properties are defined in mega-bytes
 #define PROPERTY_TEXTURE_CACHE_SIZE "ro.hwui.texture_cache_size"
 #define PROPERTY_LAYER_CACHE_SIZE "ro.hwui.layer_cache_size"
@@ -147,8 +165,14 @@ enum DebugLevel {
 #define PROPERTY_GRADIENT_CACHE_SIZE "ro.hwui.gradient_cache_size"
 #define PROPERTY_PATH_CACHE_SIZE "ro.hwui.path_cache_size"
 #define PROPERTY_PATCH_CACHE_SIZE "ro.hwui.patch_cache_size"
+#define PROPERTY_TESSELLATION_CACHE_SIZE "ro.hwui.tessellation_cache_size"
 #define PROPERTY_DROP_SHADOW_CACHE_SIZE "ro.hwui.drop_shadow_cache_size"
 #define PROPERTY_FBO_CACHE_SIZE "ro.hwui.fbo_cache_size"
+// When set, the texture, layer, gradient, path, tessellation and drop shadow
+// caches share this budget instead of being bound by their own size
+#define PROPERTY_CACHE_BUDGET "ro.hwui.cache_budget"
+// Memory used by the pages of the dynamic atlas, 0 disables the atlas
+#define PROPERTY_DYNAMIC_ATLAS_SIZE "ro.hwui.dynamic_atlas_size"
 
 // These properties are defined in percentage (range 0..1)
 #define PROPERTY_TEXTURE_CACHE_FLUSH_RATE "ro.hwui.texture_cache_flushrate"
@@ -193,9 +217,11 @@ enum DebugLevel {
 #define DEFAULT_RENDER_BUFFER_CACHE_SIZE 2.0f
 #define DEFAULT_PATH_CACHE_SIZE 10.0f
 #define DEFAULT_PATCH_CACHE_SIZE 128 // in kB
+#define DEFAULT_TESSELLATION_CACHE_SIZE 1.0f
 #define DEFAULT_GRADIENT_CACHE_SIZE 0.5f
 #define DEFAULT_DROP_SHADOW_CACHE_SIZE 2.0f
 #define DEFAULT_FBO_CACHE_SIZE 16
+#define DEFAULT_DYNAMIC_ATLAS_SIZE 4.0f
 
 #define DEFAULT_TEXTURE_CACHE_FLUSH_RATE 0.6f
 
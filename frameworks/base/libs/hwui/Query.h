@@ -21,13 +21,22 @@
 
 #include "Extensions.h"
 
+// Defined by GL_EXT_disjoint_timer_query
+#ifndef GL_TIME_ELAPSED_EXT
+    #define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+    #define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
 namespace android {
 namespace uirenderer {
 
 /**
- * A Query instance can be used to perform occlusion queries. If the device
- * does not support occlusion queries, the result of a query will always be
- * 0 and the result will always be marked available.
+ * A Query instance can be used to perform occlusion or timer queries. If
+ * the device does not support the requested kind of queries, the result
+ * of a query will always be 0 and the result will always be marked
+ * available.
  *
  * To run an occlusion query successfully, you must start end end the query:
  *
@@ -53,6 +62,12 @@ public:
          * of the test, potentially resulting in false positives.
          */
         kTargetConservativeSamples = GL_ANY_SAMPLES_PASSED_CONSERVATIVE,
+        /**
+         * Measures the time, in nanoseconds, taken by the GPU to execute
+         * the commands issued during the query. Only one such query can
+         * be active at a time.
+         */
+        kTargetTimeElapsed = GL_TIME_ELAPSED_EXT,
     };
 
     /**
@@ -60,7 +75,9 @@ public:
      * target is kTargetSamples (of GL_ANY_SAMPLES_PASSED in OpenGL.)
      */
     Query(Target target = kTargetSamples): mActive(false), mTarget(target),
-            mCanQuery(Extensions::getInstance().hasOcclusionQueries()),
+            mCanQuery(target == kTargetTimeElapsed ?
+                    Extensions::getInstance().hasTimerQueries() :
+                    Extensions::getInstance().hasOcclusionQueries()),
             mQuery(0) {
     }
 
@@ -137,6 +154,18 @@ public:
         return result;
     }
 
+    /**
+     * Returns true if the GPU timer was disrupted since the last call,
+     * making the results of pending timer queries meaningless. Always
+     * returns false if the device does not support timer queries.
+     */
+    static bool isTimerDisjoint() {
+        if (!Extensions::getInstance().hasTimerQueries()) return false;
+
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        return disjoint != 0;
+    }
 
 private:
     bool mActive;
@@ -235,6 +235,7 @@ void ResourceCache::destructorLocked(SkBitmap* resource) {
         // If we're not tracking this resource, just delete it
         if (Caches::hasInstance()) {
             Caches::getInstance().textureCache.removeDeferred(resource);
+            Caches::getInstance().dynamicAtlas.removeDeferred(resource);
         }
         delete resource;
         return;
@@ -355,6 +356,7 @@ void ResourceCache::deleteResourceReferenceLocked(void* resource, ResourceRefere
                 SkBitmap* bitmap = (SkBitmap*) resource;
                 if (Caches::hasInstance()) {
                     Caches::getInstance().textureCache.removeDeferred(bitmap);
+                    Caches::getInstance().dynamicAtlas.removeDeferred(bitmap);
                 }
                 delete bitmap;
             }
@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+#define ATRACE_TAG ATRACE_TAG_VIEW
+
+#include <SkPaint.h>
+#include <SkPath.h>
+#include <SkRect.h>
+
+#include <utils/JenkinsHash.h>
+#include <utils/Trace.h>
+
+#include "Caches.h"
+#include "PathTessellator.h"
+#include "TessellationCache.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Cache entries
+///////////////////////////////////////////////////////////////////////////////
+
+TessellationDescription::TessellationDescription() {
+    // The whole structure, padding included, takes part in compare()
+    memset(this, 0, sizeof(TessellationDescription));
+    type = kShapeNone;
+    cap = SkPaint::kDefault_Cap;
+    style = SkPaint::kFill_Style;
+    strokeWidth = 1.0f;
+    scaleX = 1.0f;
+    scaleY = 1.0f;
+}
+
+TessellationDescription::TessellationDescription(ShapeType shapeType,
+        const mat4& transform, const SkPaint* paint) {
+    memset(this, 0, sizeof(TessellationDescription));
+    type = shapeType;
+    cap = paint->getStrokeCap();
+    style = paint->getStyle();
+    strokeWidth = paint->getStrokeWidth();
+    antiAlias = paint->isAntiAlias();
+
+    // Same as the scale computed by PathTessellator, see PaintInfo
+    scaleX = 1.0f;
+    scaleY = 1.0f;
+    if (!transform.isPureTranslate()) {
+        float m00 = transform.data[Matrix4::kScaleX];
+        float m01 = transform.data[Matrix4::kSkewY];
+        float m10 = transform.data[Matrix4::kSkewX];
+        float m11 = transform.data[Matrix4::kScaleY];
+        scaleX = sqrtf(m00 * m00 + m01 * m01);
+        scaleY = sqrtf(m10 * m10 + m11 * m11);
+    }
+}
+
+hash_t TessellationDescription::hash() const {
+    uint32_t hash = JenkinsHashMix(0, type);
+    hash = JenkinsHashMix(hash, cap);
+    hash = JenkinsHashMix(hash, style);
+    hash = JenkinsHashMix(hash, android::hash_type(strokeWidth));
+    hash = JenkinsHashMix(hash, antiAlias);
+    hash = JenkinsHashMix(hash, android::hash_type(scaleX));
+    hash = JenkinsHashMix(hash, android::hash_type(scaleY));
+    hash = JenkinsHashMixBytes(hash, (uint8_t*) &shape, sizeof(Shape));
+    return JenkinsHashWhiten(hash);
+}
+
+int TessellationDescription::compare(const TessellationDescription& rhs) const {
+    return memcmp(this, &rhs, sizeof(TessellationDescription));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Utilities
+///////////////////////////////////////////////////////////////////////////////
+
+static void initPaint(const TessellationDescription& description, SkPaint& paint) {
+    paint.setStyle(description.style);
+    paint.setStrokeCap(description.cap);
+    paint.setStrokeWidth(description.strokeWidth);
+    paint.setAntiAlias(description.antiAlias);
+}
+
+/**
+ * Builds the hull tessellated for the specified entry. This must match the
+ * paths OpenGLRenderer used to hand over to drawConvexPath().
+ */
+static void initPath(const TessellationDescription& description, SkPath& path) {
+    const TessellationDescription::Shape& shape = description.shape;
+    const bool outset = description.style == SkPaint::kStrokeAndFill_Style;
+    const float halfStrokeWidth = description.strokeWidth / 2;
+
+    switch (description.type) {
+        case kShapeRoundRect: {
+            SkRect rect = SkRect::MakeLTRB(shape.roundRect.mLeft, shape.roundRect.mTop,
+                    shape.roundRect.mRight, shape.roundRect.mBottom);
+            float rx = shape.roundRect.mRx;
+            float ry = shape.roundRect.mRy;
+            if (outset) {
+                rect.outset(halfStrokeWidth, halfStrokeWidth);
+                rx += halfStrokeWidth;
+                ry += halfStrokeWidth;
+            }
+            path.addRoundRect(rect, rx, ry);
+            break;
+        }
+        case kShapeCircle: {
+            float radius = shape.circle.mRadius;
+            if (outset) {
+                radius += halfStrokeWidth;
+            }
+            path.addCircle(shape.circle.mX, shape.circle.mY, radius);
+            break;
+        }
+        case kShapeOval: {
+            SkRect rect = SkRect::MakeLTRB(shape.oval.mLeft, shape.oval.mTop,
+                    shape.oval.mRight, shape.oval.mBottom);
+            if (outset) {
+                rect.outset(halfStrokeWidth, halfStrokeWidth);
+            }
+            path.addOval(rect);
+            break;
+        }
+        case kShapeArc: {
+            SkRect rect = SkRect::MakeLTRB(shape.arc.mLeft, shape.arc.mTop,
+                    shape.arc.mRight, shape.arc.mBottom);
+            if (outset) {
+                rect.outset(halfStrokeWidth, halfStrokeWidth);
+            }
+            if (shape.arc.mUseCenter) {
+                path.moveTo(rect.centerX(), rect.centerY());
+            }
+            path.arcTo(rect, shape.arc.mStartAngle, shape.arc.mSweepAngle,
+                    !shape.arc.mUseCenter);
+            if (shape.arc.mUseCenter) {
+                path.close();
+            }
+            break;
+        }
+        default:
+            LOG_ALWAYS_FATAL("Cannot tessellate shape type %d", description.type);
+    }
+}
+
+static inline GLsizei getVertexStride(const TessellationDescription& description) {
+    return description.antiAlias ? gAlphaVertexStride : gVertexStride;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+TessellationCache::TessellationCache():
+        mCache(LruCache<TessellationDescription, TessellationBuffer*>::kUnlimitedCapacity),
+        mSize(0), mMaxSize(MB(DEFAULT_TESSELLATION_CACHE_SIZE)) {
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_TESSELLATION_CACHE_SIZE, property, NULL) > 0) {
+        INIT_LOGD("  Setting tessellation cache size to %sMB", property);
+        mMaxSize = MB(atof(property));
+    } else {
+        INIT_LOGD("  Using default tessellation cache size of %.2fMB",
+                DEFAULT_TESSELLATION_CACHE_SIZE);
+    }
+
+    mCache.setOnEntryRemovedListener(this);
+    mDebugEnabled = readDebugLevel() & kDebugCaches;
+}
+
+TessellationCache::~TessellationCache() {
+    mCache.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Size management
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t TessellationCache::getSize() {
+    return mSize;
+}
+
+uint32_t TessellationCache::getMaxSize() {
+    return mMaxSize;
+}
+
+void TessellationCache::setMaxSize(uint32_t maxSize) {
+    mMaxSize = maxSize;
+    while (mSize > mMaxSize) {
+        mCache.removeOldest();
+    }
+}
+
+void TessellationCache::trim() {
+    while (mSize > mMaxSize) {
+        mCache.removeOldest();
+    }
+}
+
+void TessellationCache::clear() {
+    mCache.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Callbacks
+///////////////////////////////////////////////////////////////////////////////
+
+void TessellationCache::operator()(TessellationDescription& description,
+        TessellationBuffer*& buffer) {
+    removeBuffer(buffer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Caching
+///////////////////////////////////////////////////////////////////////////////
+
+void TessellationCache::removeBuffer(TessellationBuffer* buffer) {
+    if (buffer) {
+        if (buffer->task != NULL) {
+            // The worker thread might still be using the entry, and the
+            // vertices were never accounted for
+            buffer->task->getResult();
+            buffer->task.clear();
+        } else {
+            mSize -= buffer->size;
+        }
+
+        if (mDebugEnabled) {
+            ALOGD("Tessellation deleted, size = %d", buffer->size);
+        }
+
+        if (buffer->vbo) {
+            Caches::getInstance().unbindMeshBuffer();
+            glDeleteBuffers(1, &buffer->vbo);
+        }
+        delete buffer;
+    }
+}
+
+void TessellationCache::tessellate(const TessellationDescription& description,
+        VertexBuffer& vertexBuffer, SkRect& bounds) {
+    SkPaint paint;
+    initPaint(description, paint);
+
+    SkPath path;
+    initPath(description, path);
+
+    // The tessellation only depends on the scale of the transform
+    mat4 transform;
+    transform.loadScale(description.scaleX, description.scaleY, 1.0f);
+
+    PathTessellator::tessellatePath(path, &paint, &transform, vertexBuffer);
+
+    bounds = path.getBounds();
+    PathTessellator::expandBoundsForStroke(bounds, &paint, false);
+}
+
+void TessellationCache::upload(const TessellationDescription& entry, TessellationBuffer* buffer,
+        const VertexBuffer& vertexBuffer, bool addToCache) {
+    buffer->vertexCount = vertexBuffer.getVertexCount();
+    buffer->size = buffer->vertexCount * getVertexStride(entry);
+
+    if (addToCache) {
+        // Make room before the new entry goes in, it must not evict itself
+        while (mSize + buffer->size > mMaxSize && mCache.size() > 0) {
+            mCache.removeOldest();
+        }
+    }
+
+    if (buffer->vertexCount) {
+        glGenBuffers(1, &buffer->vbo);
+        Caches::getInstance().bindMeshBuffer(buffer->vbo);
+        glBufferData(GL_ARRAY_BUFFER, buffer->size, vertexBuffer.getBuffer(), GL_STATIC_DRAW);
+    }
+
+    mSize += buffer->size;
+    if (mDebugEnabled) {
+        ALOGD("Tessellation created, size = %d", buffer->size);
+    }
+
+    if (addToCache) {
+        mCache.put(entry, buffer);
+    }
+}
+
+const TessellationBuffer* TessellationCache::get(const TessellationDescription& entry) {
+    TessellationBuffer* buffer = mCache.get(entry);
+
+    if (!buffer) {
+        ATRACE_NAME("tessellateShape");
+        buffer = new TessellationBuffer();
+
+        VertexBuffer vertexBuffer;
+        tessellate(entry, vertexBuffer, buffer->bounds);
+        upload(entry, buffer, vertexBuffer, true);
+    } else if (buffer->task != NULL) {
+        // The shape was precached, wait for the worker thread if needed
+        // and move the vertices into a VBO
+        sp<TessellationTask> task = static_cast<TessellationTask*>(buffer->task.get());
+        VertexBuffer* vertexBuffer = task->getResult();
+        buffer->bounds = task->bounds;
+        buffer->task.clear();
+
+        upload(entry, buffer, *vertexBuffer, false);
+    }
+
+    return buffer;
+}
+
+void TessellationCache::precache(const TessellationDescription& entry) {
+    if (!Caches::getInstance().tasks.canRunTasks() || mCache.get(entry)) {
+        return;
+    }
+
+    TessellationBuffer* buffer = new TessellationBuffer();
+    sp<TessellationTask> task = new TessellationTask(entry);
+    buffer->task = task;
+
+    // Like PathCache::precache(), the cache limit is only enforced once
+    // the vertices are uploaded and at the end of the frame
+    mCache.put(entry, buffer);
+
+    if (mProcessor == NULL) {
+        mProcessor = new TessellationProcessor(Caches::getInstance());
+    }
+    mProcessor->add(task);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Shape precaching
+///////////////////////////////////////////////////////////////////////////////
+
+TessellationCache::TessellationTask::~TessellationTask() {
+    delete future()->get();
+}
+
+TessellationCache::TessellationProcessor::TessellationProcessor(Caches& caches):
+        TaskProcessor<VertexBuffer*>(&caches.tasks) {
+}
+
+void TessellationCache::TessellationProcessor::onProcess(
+        const sp<Task<VertexBuffer*> >& task) {
+    sp<TessellationTask> t = static_cast<TessellationTask*>(task.get());
+    ATRACE_NAME("shapePrecache");
+
+    VertexBuffer* vertexBuffer = new VertexBuffer();
+    tessellate(t->description, *vertexBuffer, t->bounds);
+    t->setResult(vertexBuffer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Shapes
+///////////////////////////////////////////////////////////////////////////////
+
+static TessellationDescription roundRectDescription(const mat4& transform,
+        float left, float top, float right, float bottom, float rx, float ry,
+        const SkPaint* paint) {
+    TessellationDescription entry(kShapeRoundRect, transform, paint);
+    entry.shape.roundRect.mLeft = left;
+    entry.shape.roundRect.mTop = top;
+    entry.shape.roundRect.mRight = right;
+    entry.shape.roundRect.mBottom = bottom;
+    entry.shape.roundRect.mRx = rx;
+    entry.shape.roundRect.mRy = ry;
+    return entry;
+}
+
+static TessellationDescription circleDescription(const mat4& transform,
+        float x, float y, float radius, const SkPaint* paint) {
+    TessellationDescription entry(kShapeCircle, transform, paint);
+    entry.shape.circle.mX = x;
+    entry.shape.circle.mY = y;
+    entry.shape.circle.mRadius = radius;
+    return entry;
+}
+
+static TessellationDescription ovalDescription(const mat4& transform,
+        float left, float top, float right, float bottom, const SkPaint* paint) {
+    TessellationDescription entry(kShapeOval, transform, paint);
+    entry.shape.oval.mLeft = left;
+    entry.shape.oval.mTop = top;
+    entry.shape.oval.mRight = right;
+    entry.shape.oval.mBottom = bottom;
+    return entry;
+}
+
+static TessellationDescription arcDescription(const mat4& transform,
+        float left, float top, float right, float bottom,
+        float startAngle, float sweepAngle, bool useCenter, const SkPaint* paint) {
+    TessellationDescription entry(kShapeArc, transform, paint);
+    entry.shape.arc.mLeft = left;
+    entry.shape.arc.mTop = top;
+    entry.shape.arc.mRight = right;
+    entry.shape.arc.mBottom = bottom;
+    entry.shape.arc.mStartAngle = startAngle;
+    entry.shape.arc.mSweepAngle = sweepAngle;
+    entry.shape.arc.mUseCenter = useCenter;
+    return entry;
+}
+
+const TessellationBuffer* TessellationCache::getRoundRect(const mat4& transform,
+        float left, float top, float right, float bottom, float rx, float ry,
+        const SkPaint* paint) {
+    return get(roundRectDescription(transform, left, top, right, bottom, rx, ry, paint));
+}
+
+const TessellationBuffer* TessellationCache::getCircle(const mat4& transform,
+        float x, float y, float radius, const SkPaint* paint) {
+    return get(circleDescription(transform, x, y, radius, paint));
+}
+
+const TessellationBuffer* TessellationCache::getOval(const mat4& transform,
+        float left, float top, float right, float bottom, const SkPaint* paint) {
+    return get(ovalDescription(transform, left, top, right, bottom, paint));
+}
+
+const TessellationBuffer* TessellationCache::getArc(const mat4& transform,
+        float left, float top, float right, float bottom,
+        float startAngle, float sweepAngle, bool useCenter, const SkPaint* paint) {
+    return get(arcDescription(transform, left, top, right, bottom,
+            startAngle, sweepAngle, useCenter, paint));
+}
+
+void TessellationCache::precacheRoundRect(const mat4& transform,
+        float left, float top, float right, float bottom, float rx, float ry,
+        const SkPaint* paint) {
+    precache(roundRectDescription(transform, left, top, right, bottom, rx, ry, paint));
+}
+
+void TessellationCache::precacheCircle(const mat4& transform,
+        float x, float y, float radius, const SkPaint* paint) {
+    precache(circleDescription(transform, x, y, radius, paint));
+}
+
+void TessellationCache::precacheOval(const mat4& transform,
+        float left, float top, float right, float bottom, const SkPaint* paint) {
+    precache(ovalDescription(transform, left, top, right, bottom, paint));
+}
+
+void TessellationCache::precacheArc(const mat4& transform,
+        float left, float top, float right, float bottom,
+        float startAngle, float sweepAngle, bool useCenter, const SkPaint* paint) {
+    precache(arcDescription(transform, left, top, right, bottom,
+            startAngle, sweepAngle, useCenter, paint));
+}
+
+}; // namespace uirenderer
+}; // namespace android
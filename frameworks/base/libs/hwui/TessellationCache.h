@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_TESSELLATION_CACHE_H
+#define ANDROID_HWUI_TESSELLATION_CACHE_H
+
+#include <GLES2/gl2.h>
+
+#include <SkPaint.h>
+#include <SkRect.h>
+
+#include <utils/LruCache.h>
+
+#include "Debug.h"
+#include "Matrix.h"
+#include "PathCache.h"
+#include "Properties.h"
+#include "thread/Task.h"
+#include "thread/TaskProcessor.h"
+
+class SkPath;
+
+namespace android {
+namespace uirenderer {
+
+class Caches;
+class VertexBuffer;
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Describes a convex shape as tessellated by PathTessellator::tessellatePath().
+ * Shapes are described in local coordinates. The transform only contributes
+ * its scale since that is all the tessellation depends on.
+ */
+struct TessellationDescription {
+    ShapeType type;
+    SkPaint::Cap cap;
+    SkPaint::Style style;
+    float strokeWidth;
+    bool antiAlias;
+    float scaleX;
+    float scaleY;
+    union Shape {
+        struct RoundRect {
+            float mLeft;
+            float mTop;
+            float mRight;
+            float mBottom;
+            float mRx;
+            float mRy;
+        } roundRect;
+        struct Circle {
+            float mX;
+            float mY;
+            float mRadius;
+        } circle;
+        struct Oval {
+            float mLeft;
+            float mTop;
+            float mRight;
+            float mBottom;
+        } oval;
+        struct Arc {
+            float mLeft;
+            float mTop;
+            float mRight;
+            float mBottom;
+            float mStartAngle;
+            float mSweepAngle;
+            bool mUseCenter;
+        } arc;
+    } shape;
+
+    TessellationDescription();
+    TessellationDescription(ShapeType shapeType, const mat4& transform, const SkPaint* paint);
+
+    hash_t hash() const;
+
+    int compare(const TessellationDescription& rhs) const;
+
+    bool operator==(const TessellationDescription& other) const {
+        return compare(other) == 0;
+    }
+
+    bool operator!=(const TessellationDescription& other) const {
+        return compare(other) != 0;
+    }
+
+    friend inline int strictly_order_type(
+            const TessellationDescription& lhs, const TessellationDescription& rhs) {
+        return lhs.compare(rhs) < 0;
+    }
+
+    friend inline int compare_type(const TessellationDescription& lhs,
+            const TessellationDescription& rhs) {
+        return lhs.compare(rhs);
+    }
+
+    friend inline hash_t hash_type(const TessellationDescription& entry) {
+        return entry.hash();
+    }
+};
+
+/**
+ * Tessellated vertices of a shape, stored in a vertex buffer object.
+ */
+class TessellationBuffer {
+public:
+    TessellationBuffer(): vbo(0), vertexCount(0), size(0) {
+        bounds.setEmpty();
+    }
+
+    GLuint getVbo() const {
+        return vbo;
+    }
+
+    uint32_t getVertexCount() const {
+        return vertexCount;
+    }
+
+    /**
+     * Bounds of the shape in local coordinates, accounting for the stroke.
+     */
+    const SkRect& getBounds() const {
+        return bounds;
+    }
+
+private:
+    friend class TessellationCache;
+
+    GLuint vbo;
+    uint32_t vertexCount;
+    uint32_t size;
+    SkRect bounds;
+    sp<Task<VertexBuffer*> > task;
+}; // class TessellationBuffer
+
+/**
+ * A LRU cache of tessellated convex shapes, stored in vertex buffer objects.
+ * The cache has a maximum size expressed in bytes.
+ *
+ * Shapes can be tessellated ahead of time by worker threads while the
+ * frame is being deferred, in which case the upload to the VBO happens
+ * when the shape is first drawn.
+ */
+class TessellationCache: public OnEntryRemoved<TessellationDescription, TessellationBuffer*> {
+public:
+    TessellationCache();
+    ~TessellationCache();
+
+    /**
+     * Used as a callback when an entry is removed from the cache.
+     * Do not invoke directly.
+     */
+    void operator()(TessellationDescription& description, TessellationBuffer*& buffer);
+
+    /**
+     * Clears the cache. This causes all vertex buffer objects to be deleted.
+     */
+    void clear();
+
+    /**
+     * Sets the maximum size of the cache in bytes.
+     */
+    void setMaxSize(uint32_t maxSize);
+    /**
+     * Returns the maximum size of the cache in bytes.
+     */
+    uint32_t getMaxSize();
+    /**
+     * Returns the current size of the cache in bytes.
+     */
+    uint32_t getSize();
+
+    /**
+     * Trims the contents of the cache, removing items until it's under its
+     * specified limit. Precaching can take the cache over its limit for the
+     * duration of a frame, see PathCache::trim().
+     */
+    void trim();
+
+    /**
+     * The get methods never return NULL. The returned buffer is only valid
+     * until the next call into the cache.
+     */
+    const TessellationBuffer* getRoundRect(const mat4& transform, float left, float top,
+            float right, float bottom, float rx, float ry, const SkPaint* paint);
+    const TessellationBuffer* getCircle(const mat4& transform, float x, float y, float radius,
+            const SkPaint* paint);
+    const TessellationBuffer* getOval(const mat4& transform, float left, float top,
+            float right, float bottom, const SkPaint* paint);
+    const TessellationBuffer* getArc(const mat4& transform, float left, float top,
+            float right, float bottom, float startAngle, float sweepAngle, bool useCenter,
+            const SkPaint* paint);
+
+    /**
+     * Tessellate the specified shapes using background threads.
+     */
+    void precacheRoundRect(const mat4& transform, float left, float top,
+            float right, float bottom, float rx, float ry, const SkPaint* paint);
+    void precacheCircle(const mat4& transform, float x, float y, float radius,
+            const SkPaint* paint);
+    void precacheOval(const mat4& transform, float left, float top,
+            float right, float bottom, const SkPaint* paint);
+    void precacheArc(const mat4& transform, float left, float top,
+            float right, float bottom, float startAngle, float sweepAngle, bool useCenter,
+            const SkPaint* paint);
+
+private:
+    class TessellationTask: public Task<VertexBuffer*> {
+    public:
+        TessellationTask(const TessellationDescription& description):
+                description(description) {
+        }
+
+        ~TessellationTask();
+
+        TessellationDescription description;
+        // Written by the worker before the result is produced
+        SkRect bounds;
+    };
+
+    class TessellationProcessor: public TaskProcessor<VertexBuffer*> {
+    public:
+        TessellationProcessor(Caches& caches);
+        ~TessellationProcessor() { }
+
+        virtual void onProcess(const sp<Task<VertexBuffer*> >& task);
+    };
+
+    /**
+     * Tessellates the shape described by the specified entry in local
+     * coordinates, and computes the bounds covered by the vertices.
+     */
+    static void tessellate(const TessellationDescription& description,
+            VertexBuffer& vertexBuffer, SkRect& bounds);
+
+    const TessellationBuffer* get(const TessellationDescription& entry);
+    void precache(const TessellationDescription& entry);
+
+    /**
+     * Moves the vertices into a new VBO owned by the specified buffer.
+     */
+    void upload(const TessellationDescription& entry, TessellationBuffer* buffer,
+            const VertexBuffer& vertexBuffer, bool addToCache);
+
+    void removeBuffer(TessellationBuffer* buffer);
+
+    LruCache<TessellationDescription, TessellationBuffer*> mCache;
+    uint32_t mSize;
+    uint32_t mMaxSize;
+
+    bool mDebugEnabled;
+
+    sp<TessellationProcessor> mProcessor;
+}; // class TessellationCache
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_TESSELLATION_CACHE_H
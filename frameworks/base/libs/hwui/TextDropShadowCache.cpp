@@ -20,8 +20,11 @@
 
 #include "Caches.h"
 #include "Debug.h"
+#include "Extensions.h"
+#include "Program.h"
 #include "TextDropShadowCache.h"
 #include "Properties.h"
+#include "utils/Blur.h"
 
 namespace android {
 namespace uirenderer {
@@ -122,6 +125,11 @@ TextDropShadowCache::~TextDropShadowCache() {
 void TextDropShadowCache::init() {
     mCache.setOnEntryRemovedListener(this);
     mDebugEnabled = readDebugLevel() & kDebugMoreCaches;
+
+    mHasGpuBlur = Extensions::getInstance().getMajorGlVersion() >= 3;
+    mScratchTexture = 0;
+    mScratchWidth = 0;
+    mScratchHeight = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -166,6 +174,13 @@ void TextDropShadowCache::operator()(ShadowText& text, ShadowTexture*& texture)
 
 void TextDropShadowCache::clear() {
     mCache.clear();
+
+    if (mScratchTexture) {
+        Caches::getInstance().deleteTexture(mScratchTexture);
+        mScratchTexture = 0;
+        mScratchWidth = 0;
+        mScratchHeight = 0;
+    }
 }
 
 ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32_t len,
@@ -174,10 +189,15 @@ ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32
     ShadowTexture* texture = mCache.get(entry);
 
     if (!texture) {
+        // The GPU blur needs an 8 bit renderable format for the shadow texture
+        const uint32_t intRadius = uint32_t(radius);
+        const bool gpuBlur = mHasGpuBlur &&
+                intRadius > 0 && intRadius <= PROGRAM_BLUR_MAX_RADIUS;
+
         SkPaint paintCopy(*paint);
         paintCopy.setTextAlign(SkPaint::kLeft_Align);
         FontRenderer::DropShadow shadow = mRenderer->renderDropShadow(&paintCopy, text, 0,
-                len, numGlyphs, radius, positions);
+                len, numGlyphs, radius, positions, !gpuBlur);
 
         if (!shadow.image) {
             return NULL;
@@ -209,12 +229,40 @@ ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32
         // Textures are Alpha8
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texture->width, texture->height, 0,
-                GL_ALPHA, GL_UNSIGNED_BYTE, shadow.image);
+        if (gpuBlur) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, texture->width, texture->height, 0,
+                    GL_RED, GL_UNSIGNED_BYTE, shadow.image);
+            // Sample the red channel as alpha, like an Alpha8 texture
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texture->width, texture->height, 0,
+                    GL_ALPHA, GL_UNSIGNED_BYTE, shadow.image);
+        }
 
         texture->setFilter(GL_LINEAR);
         texture->setWrap(GL_CLAMP_TO_EDGE);
 
+        if (gpuBlur && !blurShadow(caches, texture, intRadius)) {
+            ALOGW("Could not blur shadow on the GPU, falling back to the CPU");
+            mHasGpuBlur = false;
+
+            float* gaussian = new float[2 * intRadius + 1];
+            Blur::generateGaussianWeights(gaussian, intRadius);
+
+            uint8_t* scratch = new uint8_t[size];
+            Blur::horizontal(gaussian, intRadius, shadow.image, scratch,
+                    texture->width, texture->height);
+            Blur::vertical(gaussian, intRadius, scratch, shadow.image,
+                    texture->width, texture->height);
+
+            delete[] gaussian;
+            delete[] scratch;
+
+            caches.bindTexture(texture->id);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->width, texture->height,
+                    GL_RED, GL_UNSIGNED_BYTE, shadow.image);
+        }
+
         if (size < mMaxSize) {
             if (mDebugEnabled) {
                 ALOGD("Shadow texture created, size = %d", texture->bitmapSize);
@@ -235,5 +283,122 @@ ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32
     return texture;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// GPU blur
+///////////////////////////////////////////////////////////////////////////////
+
+bool TextDropShadowCache::resizeScratchTexture(Caches& caches, uint32_t width, uint32_t height) {
+    if (!mScratchTexture) {
+        glGenTextures(1, &mScratchTexture);
+        if (!mScratchTexture) return false;
+
+        caches.bindTexture(mScratchTexture);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        caches.bindTexture(mScratchTexture);
+    }
+
+    if (width != mScratchWidth || height != mScratchHeight) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0,
+                GL_RED, GL_UNSIGNED_BYTE, NULL);
+        mScratchWidth = width;
+        mScratchHeight = height;
+    }
+
+    return true;
+}
+
+bool TextDropShadowCache::blurShadow(Caches& caches, ShadowTexture* texture, uint32_t radius) {
+    GLuint fbo = caches.fboCache.get();
+    if (!fbo) return false;
+
+    const uint32_t width = texture->width;
+    const uint32_t height = texture->height;
+
+    caches.activeTexture(0);
+    if (!resizeScratchTexture(caches, width, height)) {
+        caches.fboCache.put(fbo);
+        return false;
+    }
+
+    ProgramDescription description;
+    description.hasTexture = true;
+    description.isBlur = true;
+    Program* program = caches.programCache.get(description);
+
+    GLuint previousFbo;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, (GLint*) &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, mScratchTexture, 0);
+
+    bool status = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (status) {
+        glViewport(0, 0, width, height);
+
+        const bool scissorEnabled = caches.disableScissor();
+        if (caches.blend) {
+            glDisable(GL_BLEND);
+            caches.blend = false;
+        }
+
+        if (!program->isInUse()) {
+            if (caches.currentProgram) caches.currentProgram->remove();
+            program->use();
+            caches.currentProgram = program;
+        }
+
+        // Map the unit quad onto the whole target, one fragment per texel
+        mat4 ortho;
+        ortho.loadOrtho(0.0f, width, 0.0f, height, -1.0f, 1.0f);
+        mat4 modelView;
+        modelView.loadScale(width, height, 1.0f);
+        program->set(ortho, modelView, mat4::identity());
+
+        float weights[2 * PROGRAM_BLUR_MAX_RADIUS + 1];
+        Blur::generateGaussianWeights(weights, radius);
+
+        glUniform1i(program->getUniform("baseSampler"), 0);
+        glUniform1i(program->getUniform("blurRadius"), radius);
+        glUniform1fv(program->getUniform("blurWeights"), 2 * radius + 1, weights);
+
+        bool force = caches.bindMeshBuffer();
+        caches.bindPositionVertexPointer(force, 0);
+        caches.bindTexCoordsVertexPointer(force, (GLvoid*) gMeshTextureOffset);
+        caches.unbindIndicesBuffer();
+        caches.enableTexCoordsVertexArray();
+
+        // Horizontal pass, from the shadow into the scratch texture
+        caches.bindTexture(texture->id);
+        glUniform2f(program->getUniform("blurStep"), 1.0f / width, 0.0f);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, gMeshCount);
+
+        // Vertical pass, from the scratch texture back into the shadow
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                GL_TEXTURE_2D, texture->id, 0);
+        caches.bindTexture(mScratchTexture);
+        glUniform2f(program->getUniform("blurStep"), 0.0f, 1.0f / height);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, gMeshCount);
+
+        if (scissorEnabled) caches.enableScissor();
+        glViewport(previousViewport[0], previousViewport[1],
+                previousViewport[2], previousViewport[3]);
+    }
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    caches.fboCache.put(fbo);
+
+    return status;
+}
+
 }; // namespace uirenderer
 }; // namespace android
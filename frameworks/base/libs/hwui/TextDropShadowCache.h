@@ -163,12 +163,27 @@ public:
 private:
     void init();
 
+    /**
+     * Blurs the specified shadow texture in place, in two passes rendered
+     * into an FBO. The texture must be a GL_R8 texture. Returns false if
+     * the blur could not be applied.
+     */
+    bool blurShadow(Caches& caches, ShadowTexture* texture, uint32_t radius);
+    bool resizeScratchTexture(Caches& caches, uint32_t width, uint32_t height);
+
     LruCache<ShadowText, ShadowTexture*> mCache;
 
     uint32_t mSize;
     uint32_t mMaxSize;
     FontRenderer* mRenderer;
     bool mDebugEnabled;
+
+    // Shadows are blurred on the GPU when OpenGL ES 3.0 is available
+    bool mHasGpuBlur;
+    // Holds the result of the horizontal blur pass
+    GLuint mScratchTexture;
+    uint32_t mScratchWidth;
+    uint32_t mScratchHeight;
 }; // class TextDropShadowCache
 
 }; // namespace uirenderer
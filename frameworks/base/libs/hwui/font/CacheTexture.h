@@ -174,6 +174,18 @@ public:
         return mCurrentQuad == mMaxQuadCount;
     }
 
+    /**
+     * Used by the FontRenderer to pick the texture to evict when a
+     * glyph does not fit in any of the cache textures.
+     */
+    inline uint32_t getLastUsed() const {
+        return mLastUsed;
+    }
+
+    inline void setLastUsed(uint32_t lastUsed) {
+        mLastUsed = lastUsed;
+    }
+
 private:
     void setDirty(bool dirty);
 
@@ -192,6 +204,7 @@ private:
     CacheBlock* mCacheBlocks;
     bool mHasUnpackRowLength;
     Rect mDirtyRect;
+    uint32_t mLastUsed;
 };
 
 }; // namespace uirenderer
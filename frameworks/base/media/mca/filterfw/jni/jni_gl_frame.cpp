@@ -105,6 +105,22 @@ jboolean Java_android_filterfw_core_GLFrame_nativeAllocateExternal(JNIEnv* env,
   }
 }
 
+jboolean Java_android_filterfw_core_GLFrame_nativeAllocateShared(JNIEnv* env,
+                                                                 jobject thiz,
+                                                                 jobject gl_env,
+                                                                 jint width,
+                                                                 jint height) {
+  GLEnv* gl_env_ptr = ConvertFromJava<GLEnv>(env, gl_env);
+  if (!gl_env_ptr) return JNI_FALSE;
+  GLFrame* frame = new GLFrame(gl_env_ptr);
+  if (frame->InitWithSharedBuffer(width, height)) {
+    return ToJBool(WrapObjectInJava(frame, env, thiz, true));
+  } else {
+    delete frame;
+    return JNI_FALSE;
+  }
+}
+
 jboolean Java_android_filterfw_core_GLFrame_nativeDeallocate(JNIEnv* env, jobject thiz) {
   return ToJBool(DeleteNativeObject<GLFrame>(env, thiz));
 }
@@ -138,6 +154,11 @@ jbyteArray Java_android_filterfw_core_GLFrame_getNativeData(JNIEnv* env, jobject
   return NULL;
 }
 
+jboolean Java_android_filterfw_core_GLFrame_nativeReadDataAsync(JNIEnv* env, jobject thiz) {
+  GLFrame* frame = ConvertFromJava<GLFrame>(env, thiz);
+  return ToJBool(frame && frame->ReadDataAsync());
+}
+
 jboolean Java_android_filterfw_core_GLFrame_setNativeInts(JNIEnv* env,
                                                           jobject thiz,
                                                           jintArray ints) {
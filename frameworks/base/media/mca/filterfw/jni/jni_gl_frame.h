@@ -51,6 +51,13 @@ Java_android_filterfw_core_GLFrame_nativeAllocateExternal(JNIEnv* env,
                                                           jobject thiz,
                                                           jobject gl_env);
 
+JNIEXPORT jboolean JNICALL
+Java_android_filterfw_core_GLFrame_nativeAllocateShared(JNIEnv* env,
+                                                        jobject thiz,
+                                                        jobject gl_env,
+                                                        jint width,
+                                                        jint height);
+
 JNIEXPORT jboolean JNICALL
 Java_android_filterfw_core_GLFrame_nativeDeallocate(JNIEnv* env, jobject thiz);
 
@@ -76,6 +83,9 @@ Java_android_filterfw_core_GLFrame_setNativeData(JNIEnv* env,
 JNIEXPORT jbyteArray JNICALL
 Java_android_filterfw_core_GLFrame_getNativeData(JNIEnv* env, jobject thiz);
 
+JNIEXPORT jboolean JNICALL
+Java_android_filterfw_core_GLFrame_nativeReadDataAsync(JNIEnv* env, jobject thiz);
+
 JNIEXPORT jboolean JNICALL
 Java_android_filterfw_core_GLFrame_setNativeBitmap(JNIEnv* env,
                                                    jobject thiz,
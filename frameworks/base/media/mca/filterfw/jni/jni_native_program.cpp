@@ -27,6 +27,50 @@
 using android::filterfw::NativeFrame;
 using android::filterfw::NativeProgram;
 
+// Collects the data pointers and sizes of the given NativeFrame inputs and output.
+static bool GetProcessBuffers(JNIEnv* env,
+                              jobjectArray inputs,
+                              jobject output,
+                              std::vector<const char*>* input_buffers,
+                              std::vector<int>* input_sizes,
+                              char** output_data,
+                              int* output_size) {
+  // Get the input buffers
+  const int input_count = env->GetArrayLength(inputs);
+  input_buffers->assign(input_count, NULL);
+  input_sizes->assign(input_count, 0);
+  for (int i = 0 ; i < input_count; ++i) {
+    const char* input_data = NULL;
+    int input_size = 0;
+    jobject input = env->GetObjectArrayElement(inputs, i);
+    if (input) {
+        NativeFrame* native_frame = ConvertFromJava<NativeFrame>(env, input);
+        if (!native_frame) {
+          ALOGE("NativeProgram: Could not grab NativeFrame input %d!", i);
+          return false;
+        }
+        input_data = reinterpret_cast<const char*>(native_frame->Data());
+        input_size = native_frame->Size();
+    }
+    (*input_buffers)[i] = input_data;
+    (*input_sizes)[i] = input_size;
+  }
+
+  // Get the output buffer
+  *output_data = NULL;
+  *output_size = 0;
+  if (output) {
+    NativeFrame* output_frame = ConvertFromJava<NativeFrame>(env, output);
+    if (!output_frame) {
+      ALOGE("NativeProgram: Could not grab NativeFrame output!");
+      return false;
+    }
+    *output_data = reinterpret_cast<char*>(output_frame->MutableData());
+    *output_size = output_frame->Size();
+  }
+  return true;
+}
+
 jboolean Java_android_filterfw_core_NativeProgram_allocate(JNIEnv* env, jobject thiz) {
   return ToJBool(WrapObjectInJava(new NativeProgram(), env, thiz, true));
 }
@@ -138,44 +182,38 @@ jboolean Java_android_filterfw_core_NativeProgram_callNativeProcess(JNIEnv* env,
     return JNI_FALSE;
   }
 
-  // Get the input buffers
-  const int input_count = env->GetArrayLength(inputs);
-  std::vector<const char*> input_buffers(input_count, NULL);
-  std::vector<int> input_sizes(input_count, 0);
-  for (int i = 0 ; i < input_count; ++i) {
-    const char* input_data = NULL;
-    int input_size = 0;
-    jobject input = env->GetObjectArrayElement(inputs, i);
-    if (input) {
-        NativeFrame* native_frame = ConvertFromJava<NativeFrame>(env, input);
-        if (!native_frame) {
-          ALOGE("NativeProgram: Could not grab NativeFrame input %d!", i);
-          return JNI_FALSE;
-        }
-        input_data = reinterpret_cast<const char*>(native_frame->Data());
-        input_size = native_frame->Size();
-    }
-    input_buffers[i] = input_data;
-    input_sizes[i] = input_size;
-  }
-
-  // Get the output buffer
-  char* output_data = NULL;
-  int output_size = 0;
-  if (output) {
-    NativeFrame* output_frame = ConvertFromJava<NativeFrame>(env, output);
-    if (!output_frame) {
-      ALOGE("NativeProgram: Could not grab NativeFrame output!");
-      return JNI_FALSE;
-    }
-    output_data = reinterpret_cast<char*>(output_frame->MutableData());
-    output_size = output_frame->Size();
+  std::vector<const char*> input_buffers;
+  std::vector<int> input_sizes;
+  char* output_data;
+  int output_size;
+  if (!GetProcessBuffers(env, inputs, output,
+                         &input_buffers, &input_sizes, &output_data, &output_size)) {
+    return JNI_FALSE;
   }
 
   // Process the frames!
   return ToJBool(program->CallProcess(input_buffers, input_sizes, output_data, output_size));
 }
 
+jfloatArray Java_android_filterfw_core_NativeProgram_getNativeProcessTimes(JNIEnv* env,
+                                                                          jobject thiz) {
+  NativeProgram* program = ConvertFromJava<NativeProgram>(env, thiz);
+  if (!program) {
+    return NULL;
+  }
+
+  // Returned as { number of calls, mean ms, standard deviation ms, recent mean ms }
+  int num_calls;
+  float times[4];
+  program->GetProcessTimes(&num_calls, &times[1], &times[2], &times[3]);
+  times[0] = num_calls;
+  jfloatArray result = env->NewFloatArray(4);
+  if (result) {
+    env->SetFloatArrayRegion(result, 0, 4, times);
+  }
+  return result;
+}
+
 jboolean Java_android_filterfw_core_NativeProgram_callNativeReset(JNIEnv* env, jobject thiz) {
   NativeProgram* program = ConvertFromJava<NativeProgram>(env, thiz);
   return ToJBool(program && program->CallReset());
@@ -87,6 +87,9 @@ Java_android_filterfw_core_NativeProgram_callNativeProcess(JNIEnv* env,
                                                            jobjectArray inputs,
                                                            jobject output);
 
+JNIEXPORT jfloatArray JNICALL
+Java_android_filterfw_core_NativeProgram_getNativeProcessTimes(JNIEnv* env, jobject thiz);
+
 JNIEXPORT jboolean JNICALL
 Java_android_filterfw_core_NativeProgram_callNativeReset(JNIEnv* env, jobject thiz);
 
@@ -14,12 +14,19 @@
  * limitations under the License.
  */
 
+#define EGL_EGLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+
 #include "base/logging.h"
 
 #include "core/gl_env.h"
 #include "core/gl_frame.h"
 #include "core/shader_program.h"
 
+#include <GLES3/gl3.h>
+
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 
 namespace android {
@@ -34,6 +41,13 @@ static const int kIdentityShaderKey = 1;
 // and when pixel data is uploaded to a GLFrame. The FBO is used as a rendering
 // target for shaders.
 //
+// Frames initialized with InitWithSharedBuffer() back their texture with a
+// gralloc buffer through an EGL image instead, so that pixel data can be
+// exchanged with the CPU by locking the buffer, without glTexImage2D() or
+// glReadPixels(). On GLES 3.0 contexts, ReadDataAsync() reads the FBO into a
+// pixel buffer object, so that the GPU is not stalled until the data is
+// actually needed.
+//
 
 GLFrame::GLFrame(GLEnv* gl_env)
   : gl_env_(gl_env),
@@ -49,7 +63,11 @@ GLFrame::GLFrame(GLEnv* gl_env)
     texture_state_(kStateUninitialized),
     fbo_state_(kStateUninitialized),
     owns_texture_(false),
-    owns_fbo_(false) {
+    owns_fbo_(false),
+    egl_image_(EGL_NO_IMAGE_KHR),
+    pbo_id_(0),
+    readback_valid_(false),
+    pbo_support_(-1) {
   SetDefaultTexParameters();
 }
 
@@ -77,6 +95,39 @@ bool GLFrame::InitWithFbo(GLint fbo_id, int width, int height) {
   return true;
 }
 
+bool GLFrame::InitWithSharedBuffer(int width, int height) {
+  // Make sure we haven't been initialized already
+  if (width_ != 0 || height_ != 0) {
+    return false;
+  }
+
+  graphic_buffer_ = new GraphicBuffer(width, height, PIXEL_FORMAT_RGBA_8888,
+                                      GraphicBuffer::USAGE_SW_READ_OFTEN |
+                                      GraphicBuffer::USAGE_SW_WRITE_OFTEN |
+                                      GraphicBuffer::USAGE_HW_TEXTURE |
+                                      GraphicBuffer::USAGE_HW_RENDER);
+  if (graphic_buffer_->initCheck() != NO_ERROR) {
+    ALOGE("GLFrame: Could not allocate %dx%d gralloc buffer!", width, height);
+    graphic_buffer_.clear();
+    return false;
+  }
+
+  const EGLint attribs[] = { EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE };
+  egl_image_ = eglCreateImageKHR(gl_env_->display(),
+                                 EGL_NO_CONTEXT,
+                                 EGL_NATIVE_BUFFER_ANDROID,
+                                 static_cast<EGLClientBuffer>(graphic_buffer_->getNativeBuffer()),
+                                 attribs);
+  if (egl_image_ == EGL_NO_IMAGE_KHR) {
+    GLEnv::CheckEGLError("EGL Image Creation");
+    graphic_buffer_.clear();
+    return false;
+  }
+
+  InitDimensions(width, height);
+  return GenerateTextureName() && AllocateTexture();
+}
+
 bool GLFrame::InitWithExternalTexture() {
   texture_target_ = GL_TEXTURE_EXTERNAL_OES;
   width_ = 0;
@@ -105,6 +156,16 @@ GLFrame::~GLFrame() {
   if (owns_fbo_) {
     glDeleteFramebuffers(1, &fbo_id_);
   }
+
+  // Delete readback PBO
+  if (pbo_id_) {
+    glDeleteBuffers(1, &pbo_id_);
+  }
+
+  // Release the gralloc buffer (the texture no longer references it)
+  if (egl_image_ != EGL_NO_IMAGE_KHR) {
+    eglDestroyImageKHR(gl_env_->display(), egl_image_);
+  }
 }
 
 bool GLFrame::GenerateMipMap() {
@@ -172,7 +233,11 @@ bool GLFrame::CopyDataTo(uint8_t* buffer, int size) {
 bool GLFrame::CopyPixelsTo(uint8_t* buffer) {
   // Use one of the pixel reading methods below, ordered from most
   // efficient to least efficient.
-  if (fbo_state_ == kStateComplete)
+  if (readback_valid_ && ReadPixelBufferObject(buffer))
+    return true;
+  else if (HoldsSharedBuffer())
+    return ReadSharedBufferPixels(buffer);
+  else if (fbo_state_ == kStateComplete)
     return ReadFboPixels(buffer);
   else if (texture_state_ == kStateComplete)
     return ReadTexturePixels(buffer);
@@ -184,6 +249,82 @@ bool GLFrame::WriteData(const uint8_t* data, int data_size) {
   return (data_size == Size()) ? UploadTexturePixels(data) : false;
 }
 
+bool GLFrame::ReadDataAsync() {
+  if (readback_valid_) {
+    return true;
+  } else if (fbo_state_ != kStateComplete || !SupportsPixelBufferObjects()) {
+    return false;
+  }
+
+  // Create the PBO. Its size is fixed, as the frame dimensions are.
+  if (!pbo_id_) {
+    glGenBuffers(1, &pbo_id_);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_id_);
+    glBufferData(GL_PIXEL_PACK_BUFFER, Size(), NULL, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (GLEnv::CheckGLError("PBO Allocation")) {
+      glDeleteBuffers(1, &pbo_id_);
+      pbo_id_ = 0;
+      return false;
+    }
+  }
+
+  // With a pack buffer bound, glReadPixels() only queues the transfer.
+  if (!BindFrameBuffer())
+    return false;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_id_);
+  glReadPixels(0,
+               0,
+               width_,
+               height_,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback_valid_ = !GLEnv::CheckGLError("PBO Pixel Readout");
+  return readback_valid_;
+}
+
+bool GLFrame::SupportsPixelBufferObjects() {
+  if (pbo_support_ < 0) {
+    // GL_VERSION is of the form "OpenGL ES N.M <vendor specific>".
+    static const char kPrefix[] = "OpenGL ES ";
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    pbo_support_ = (version &&
+                    strncmp(version, kPrefix, sizeof(kPrefix) - 1) == 0 &&
+                    atoi(version + sizeof(kPrefix) - 1) >= 3) ? 1 : 0;
+  }
+  return pbo_support_ == 1;
+}
+
+uint8_t* GLFrame::LockData(int* stride) {
+  if (!HoldsSharedBuffer()) {
+    ALOGE("GLFrame: Cannot lock the data of a frame without shared buffer!");
+    return NULL;
+  }
+
+  // Make sure the GPU is done rendering to the buffer.
+  glFinish();
+
+  void* data = NULL;
+  const status_t result = graphic_buffer_->lock(GraphicBuffer::USAGE_SW_READ_OFTEN |
+                                                GraphicBuffer::USAGE_SW_WRITE_OFTEN,
+                                                &data);
+  if (result != NO_ERROR) {
+    ALOGE("GLFrame: Could not lock gralloc buffer (error %d)!", result);
+    return NULL;
+  }
+
+  // The caller may modify the data, so any readback is outdated.
+  readback_valid_ = false;
+  *stride = graphic_buffer_->getStride() * 4;
+  return reinterpret_cast<uint8_t*>(data);
+}
+
+bool GLFrame::UnlockData() {
+  return HoldsSharedBuffer() && graphic_buffer_->unlock() == NO_ERROR;
+}
+
 bool GLFrame::SetViewport(int x, int y, int width, int height) {
   vp_x_ = x;
   vp_y_ = y;
@@ -237,6 +378,9 @@ bool GLFrame::BindFrameBuffer() const {
 }
 
 bool GLFrame::FocusFrameBuffer() {
+  // We are about to be rendered to
+  readback_valid_ = false;
+
   // Create texture backing if necessary
   if (texture_state_ == kStateUninitialized) {
     if (!GenerateTextureName())
@@ -304,15 +448,19 @@ bool GLFrame::AllocateTexture() {
   if (texture_state_ == kStateGenerated || TextureWasDeleted()) {
     LOG_FRAME("GLFrame: Allocating texture: %d", texture_id_);
     glBindTexture(GL_TEXTURE_2D, texture_id_);
-    glTexImage2D(GL_TEXTURE_2D,
-               0,
-               GL_RGBA,
-               width_,
-               height_,
-               0,
-               GL_RGBA,
-               GL_UNSIGNED_BYTE,
-               NULL);
+    if (HoldsSharedBuffer()) {
+      glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, egl_image_);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA,
+                 width_,
+                 height_,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 NULL);
+    }
     if (!GLEnv::CheckGLError("Texture Allocation")) {
       UpdateTexParameters();
       texture_state_ = kStateComplete;
@@ -359,6 +507,56 @@ bool GLFrame::ReadFboPixels(uint8_t* pixels) const {
   return false;
 }
 
+bool GLFrame::ReadPixelBufferObject(uint8_t* pixels) {
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_id_);
+  // Mapping waits for the transfer to complete, if it has not yet.
+  const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, Size(), GL_MAP_READ_BIT);
+  if (data) {
+    memcpy(pixels, data, Size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (GLEnv::CheckGLError("PBO Mapping") || !data) {
+    readback_valid_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool GLFrame::ReadSharedBufferPixels(uint8_t* pixels) {
+  int stride;
+  const uint8_t* data = LockData(&stride);
+  if (!data)
+    return false;
+
+  const int row_size = width_ * 4;
+  if (stride == row_size) {
+    memcpy(pixels, data, Size());
+  } else {
+    for (int y = 0; y < height_; ++y) {
+      memcpy(pixels + y * row_size, data + y * stride, row_size);
+    }
+  }
+  return UnlockData();
+}
+
+bool GLFrame::WriteSharedBufferPixels(const uint8_t* pixels) {
+  int stride;
+  uint8_t* data = LockData(&stride);
+  if (!data)
+    return false;
+
+  const int row_size = width_ * 4;
+  if (stride == row_size) {
+    memcpy(data, pixels, Size());
+  } else {
+    for (int y = 0; y < height_; ++y) {
+      memcpy(data + y * stride, pixels + y * row_size, row_size);
+    }
+  }
+  return UnlockData();
+}
+
 bool GLFrame::ReadTexturePixels(uint8_t* pixels) const {
   // Read pixels from texture if we do not have an FBO
   // NOTE: OpenGL ES does NOT support glGetTexImage() for reading out texture
@@ -446,6 +644,12 @@ bool GLFrame::DetachTextureFromFbo() {
 }
 
 bool GLFrame::UploadTexturePixels(const uint8_t* pixels) {
+  readback_valid_ = false;
+
+  // Shared buffers are written in place
+  if (HoldsSharedBuffer())
+    return WriteSharedBufferPixels(pixels);
+
   // Bind the texture object
   FocusTexture();
 
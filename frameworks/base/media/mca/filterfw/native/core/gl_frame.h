@@ -19,8 +19,12 @@
 
 #include <map>
 
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 
+#include <ui/GraphicBuffer.h>
+
 #include "core/gl_buffer_interface.h"
 
 namespace android {
@@ -56,13 +60,41 @@ class GLFrame : public GLBufferHandle {
     // Initialize using an existing FBO.
     bool InitWithFbo(GLint fbo_id, int width, int height);
 
+    // Initialize a frame whose texture is backed by a gralloc buffer, which
+    // the CPU can access in place through LockData() and UnlockData(). Data
+    // written to or read from such a frame does not go through glTexImage2D()
+    // or glReadPixels().
+    bool InitWithSharedBuffer(int width, int height);
+
     // Write the data with the given size in bytes to the frame. The frame size must match the
     // size of the data.
     bool WriteData(const uint8_t* data, int size);
 
-    // Copies the frame data to the given buffer.
+    // Copies the frame data to the given buffer. If a readback was started
+    // with ReadDataAsync(), and the frame has not been modified since, its
+    // result is used.
     bool CopyDataTo(uint8_t* buffer, int size);
 
+    // Starts reading the frame data into a pixel buffer object, without
+    // waiting for the GPU. Call CopyDataTo() once other work has been issued
+    // to collect the data. Returns false if the context does not support
+    // pixel buffer objects (GLES 3.0), in which case CopyDataTo() reads the
+    // data synchronously.
+    bool ReadDataAsync();
+
+    // Returns true if the frame is backed by a gralloc buffer.
+    bool HoldsSharedBuffer() const {
+      return graphic_buffer_ != NULL;
+    }
+
+    // Locks the gralloc buffer of a frame initialized with
+    // InitWithSharedBuffer() for CPU access, after the GPU has finished
+    // rendering to it. Rows are stride bytes apart. Returns NULL on failure.
+    uint8_t* LockData(int* stride);
+
+    // Unlocks the buffer locked by LockData().
+    bool UnlockData();
+
     // Copies the pixels from another GL frame to this frame.
     bool CopyPixelsFrom(const GLFrame* frame);
 
@@ -147,6 +179,18 @@ class GLFrame : public GLBufferHandle {
     // Reads the pixels from the internal FBO to the given buffer.
     bool ReadFboPixels(uint8_t* pixels) const;
 
+    // Copies the pixels of the pending readback to the given buffer.
+    bool ReadPixelBufferObject(uint8_t* pixels);
+
+    // Copies the pixels of the gralloc buffer to the given buffer.
+    bool ReadSharedBufferPixels(uint8_t* pixels);
+
+    // Writes the specified pixels to the gralloc buffer.
+    bool WriteSharedBufferPixels(const uint8_t* pixels);
+
+    // Returns true if the current context supports pixel buffer objects.
+    bool SupportsPixelBufferObjects();
+
     // Writes the specified pixels to the internal texture.
     bool UploadTexturePixels(const uint8_t* pixels);
 
@@ -209,6 +253,20 @@ class GLFrame : public GLBufferHandle {
     // Flag whether frame owns the texture and FBO
     bool owns_texture_;
     bool owns_fbo_;
+
+    // The gralloc buffer and its EGL image, for frames initialized with
+    // InitWithSharedBuffer().
+    sp<GraphicBuffer> graphic_buffer_;
+    EGLImageKHR egl_image_;
+
+    // The pixel buffer object used for asynchronous readback, and whether it
+    // holds a readback of the current frame data.
+    GLuint pbo_id_;
+    bool readback_valid_;
+
+    // Whether the context supports pixel buffer objects: -1 if not yet
+    // checked, otherwise 0 or 1.
+    int pbo_support_;
 };
 
 } // namespace filterfw
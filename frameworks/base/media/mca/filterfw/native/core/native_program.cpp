@@ -19,6 +19,7 @@
 #include "base/logging.h"
 #include "core/native_frame.h"
 #include "core/native_program.h"
+#include "core/time_util.h"
 
 #include <string>
 #include <vector>
@@ -26,6 +27,9 @@
 namespace android {
 namespace filterfw {
 
+// Weight of the latest call in the recent process time average.
+static const float kRecentProcessTimeGain = 0.1f;
+
 NativeProgram::NativeProgram()
     : lib_handle_(NULL),
       init_function_(NULL),
@@ -34,12 +38,15 @@ NativeProgram::NativeProgram()
       process_function_(NULL),
       reset_function_(NULL),
       teardown_function_(NULL),
-      user_data_(NULL) {
+      user_data_(NULL),
+      recent_process_time_ms_(kRecentProcessTimeGain) {
+  pthread_mutex_init(&stats_lock_, NULL);
 }
 
 NativeProgram::~NativeProgram() {
   if (lib_handle_)
     dlclose(lib_handle_);
+  pthread_mutex_destroy(&stats_lock_);
 }
 
 bool NativeProgram::OpenLibrary(const std::string& lib_name) {
@@ -105,16 +112,36 @@ bool NativeProgram::CallProcess(const std::vector<const char*>& inputs,
                                 char* output,
                                 int output_size) {
   if (process_function_) {
-    return process_function_(const_cast<const char**>(&inputs[0]),
-                             &input_sizes[0],
-                             inputs.size(),
-                             output,
-                             output_size,
-                             user_data_) == 1;
+    const uint64_t start_us = getTimeUs();
+    const bool success = process_function_(const_cast<const char**>(&inputs[0]),
+                                           &input_sizes[0],
+                                           inputs.size(),
+                                           output,
+                                           output_size,
+                                           user_data_) == 1;
+    const float duration_ms = (getTimeUs() - start_us) * 1.0E-3f;
+
+    pthread_mutex_lock(&stats_lock_);
+    process_time_ms_.Add(duration_ms);
+    recent_process_time_ms_.Add(duration_ms);
+    pthread_mutex_unlock(&stats_lock_);
+    return success;
   }
   return false;
 }
 
+void NativeProgram::GetProcessTimes(int* num_calls,
+                                    float* mean_ms,
+                                    float* std_ms,
+                                    float* recent_ms) {
+  pthread_mutex_lock(&stats_lock_);
+  *num_calls = recent_process_time_ms_.NumMeasurements();
+  *mean_ms = process_time_ms_.Mean();
+  *std_ms = process_time_ms_.Std();
+  *recent_ms = recent_process_time_ms_.Output();
+  pthread_mutex_unlock(&stats_lock_);
+}
+
 bool NativeProgram::CallInit() {
   if (init_function_) {
     init_function_(&user_data_);
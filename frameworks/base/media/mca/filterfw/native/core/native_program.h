@@ -17,10 +17,13 @@
 #ifndef ANDROID_FILTERFW_CORE_NATIVE_PROGRAM_H
 #define ANDROID_FILTERFW_CORE_NATIVE_PROGRAM_H
 
+#include <pthread.h>
+
 #include <vector>
 #include <string>
 
 #include "base/utilities.h"
+#include "core/statistics.h"
 
 namespace android {
 namespace filterfw {
@@ -60,6 +63,11 @@ class NativeProgram {
     bool CallReset();
     bool CallTeardown();
 
+    // Returns the timing of the process function calls so far: their number,
+    // the mean and standard deviation of their duration in milliseconds, and
+    // a moving average of the duration of recent calls.
+    void GetProcessTimes(int* num_calls, float* mean_ms, float* std_ms, float* recent_ms);
+
   private:
     // Pointer to the data. Owned by the frame.
     void* lib_handle_;
@@ -75,6 +83,12 @@ class NativeProgram {
     // Pointer to user data
     void* user_data_;
 
+    // Process function timing. Guarded by the stats lock, as programs may be
+    // run on a ProgramScheduler worker.
+    pthread_mutex_t stats_lock_;
+    IncrementalGaussian process_time_ms_;
+    RCFilter recent_process_time_ms_;
+
     DISALLOW_COPY_AND_ASSIGN(NativeProgram);
 };
 
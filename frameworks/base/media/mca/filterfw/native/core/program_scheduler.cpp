@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include "base/logging.h"
+#include "core/native_program.h"
+#include "core/program_scheduler.h"
+
+namespace android {
+namespace filterfw {
+
+// More workers than this do not pay off for camera-rate filter graphs.
+static const int kMaxThreads = 4;
+
+ProgramScheduler::ProgramScheduler(int num_threads)
+    : next_job_id_(0),
+      stopping_(false) {
+  if (num_threads <= 0) {
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (num_threads < 1) {
+    num_threads = 1;
+  } else if (num_threads > kMaxThreads) {
+    num_threads = kMaxThreads;
+  }
+
+  pthread_mutex_init(&lock_, NULL);
+  pthread_cond_init(&job_ready_, NULL);
+  pthread_cond_init(&job_done_, NULL);
+
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &ProgramScheduler::WorkerMain, this) != 0) {
+      ALOGE("ProgramScheduler: Could not create worker thread %d!", i);
+      break;
+    }
+    threads_.push_back(thread);
+  }
+}
+
+ProgramScheduler::~ProgramScheduler() {
+  WaitAll();
+
+  pthread_mutex_lock(&lock_);
+  stopping_ = true;
+  pthread_cond_broadcast(&job_ready_);
+  pthread_mutex_unlock(&lock_);
+
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    pthread_join(threads_[i], NULL);
+  }
+
+  pthread_cond_destroy(&job_done_);
+  pthread_cond_destroy(&job_ready_);
+  pthread_mutex_destroy(&lock_);
+}
+
+int ProgramScheduler::Submit(NativeProgram* program,
+                             const std::vector<const char*>& inputs,
+                             const std::vector<int>& input_sizes,
+                             char* output,
+                             int output_size,
+                             const std::vector<int>& dependencies) {
+  if (!program || inputs.size() != input_sizes.size() || threads_.empty()) {
+    return -1;
+  }
+
+  Job* job = new Job();
+  job->program = program;
+  job->inputs = inputs;
+  job->input_sizes = input_sizes;
+  job->output = output;
+  job->output_size = output_size;
+  job->state = kJobWaiting;
+  job->pending_dependencies = 0;
+  job->dependency_failed = false;
+  job->success = false;
+
+  pthread_mutex_lock(&lock_);
+  const int job_id = next_job_id_++;
+  for (size_t i = 0; i < dependencies.size(); ++i) {
+    AddDependency(job, job_id, dependencies[i]);
+  }
+
+  // Serialize the jobs of each program
+  std::map<NativeProgram*, int>::const_iterator last = last_job_of_program_.find(program);
+  if (last != last_job_of_program_.end()) {
+    AddDependency(job, job_id, last->second);
+  }
+  last_job_of_program_[program] = job_id;
+
+  jobs_[job_id] = job;
+  if (job->pending_dependencies == 0) {
+    job->state = kJobReady;
+    ready_jobs_.push_back(job_id);
+    pthread_cond_signal(&job_ready_);
+  }
+  pthread_mutex_unlock(&lock_);
+
+  return job_id;
+}
+
+void ProgramScheduler::AddDependency(Job* job, int job_id, int dependency_id) {
+  std::map<int, Job*>::iterator iter = jobs_.find(dependency_id);
+  if (iter == jobs_.end()) {
+    return;
+  }
+  Job* dependency = iter->second;
+  if (dependency->state == kJobDone) {
+    job->dependency_failed |= !dependency->success;
+  } else {
+    ++job->pending_dependencies;
+    dependency->dependents.push_back(job_id);
+  }
+}
+
+bool ProgramScheduler::Wait(int job_id) {
+  pthread_mutex_lock(&lock_);
+  std::map<int, Job*>::iterator iter = jobs_.find(job_id);
+  if (iter == jobs_.end()) {
+    pthread_mutex_unlock(&lock_);
+    ALOGE("ProgramScheduler: Waiting for unknown job %d!", job_id);
+    return false;
+  }
+  Job* job = iter->second;
+  while (job->state != kJobDone) {
+    pthread_cond_wait(&job_done_, &lock_);
+  }
+  const bool success = job->success;
+  ReapJob(job_id);
+  pthread_mutex_unlock(&lock_);
+  return success;
+}
+
+bool ProgramScheduler::WaitAll() {
+  bool success = true;
+  pthread_mutex_lock(&lock_);
+  while (!jobs_.empty()) {
+    const int job_id = jobs_.begin()->first;
+    Job* job = jobs_.begin()->second;
+    while (job->state != kJobDone) {
+      pthread_cond_wait(&job_done_, &lock_);
+    }
+    success &= job->success;
+    ReapJob(job_id);
+  }
+  pthread_mutex_unlock(&lock_);
+  return success;
+}
+
+void ProgramScheduler::ReapJob(int job_id) {
+  std::map<int, Job*>::iterator iter = jobs_.find(job_id);
+  std::map<NativeProgram*, int>::iterator last =
+      last_job_of_program_.find(iter->second->program);
+  if (last != last_job_of_program_.end() && last->second == job_id) {
+    last_job_of_program_.erase(last);
+  }
+  delete iter->second;
+  jobs_.erase(iter);
+}
+
+void* ProgramScheduler::WorkerMain(void* scheduler) {
+  static_cast<ProgramScheduler*>(scheduler)->RunJobs();
+  return NULL;
+}
+
+void ProgramScheduler::RunJobs() {
+  pthread_mutex_lock(&lock_);
+  while (true) {
+    while (ready_jobs_.empty() && !stopping_) {
+      pthread_cond_wait(&job_ready_, &lock_);
+    }
+    if (stopping_) {
+      break;
+    }
+
+    const int job_id = ready_jobs_.front();
+    ready_jobs_.pop_front();
+    Job* job = jobs_[job_id];
+
+    // Jobs fed by a failed job are not run
+    bool success = false;
+    if (!job->dependency_failed) {
+      job->state = kJobRunning;
+      pthread_mutex_unlock(&lock_);
+      success = job->program->CallProcess(job->inputs,
+                                          job->input_sizes,
+                                          job->output,
+                                          job->output_size);
+      pthread_mutex_lock(&lock_);
+    }
+    CompleteJob(job_id, success);
+  }
+  pthread_mutex_unlock(&lock_);
+}
+
+void ProgramScheduler::CompleteJob(int job_id, bool success) {
+  Job* job = jobs_[job_id];
+  job->state = kJobDone;
+  job->success = success;
+
+  for (size_t i = 0; i < job->dependents.size(); ++i) {
+    std::map<int, Job*>::iterator iter = jobs_.find(job->dependents[i]);
+    if (iter == jobs_.end()) {
+      continue;
+    }
+    Job* dependent = iter->second;
+    dependent->dependency_failed |= !success;
+    if (--dependent->pending_dependencies == 0) {
+      dependent->state = kJobReady;
+      ready_jobs_.push_back(iter->first);
+      pthread_cond_signal(&job_ready_);
+    }
+  }
+  job->dependents.clear();
+
+  pthread_cond_broadcast(&job_done_);
+}
+
+} // namespace filterfw
+} // namespace android
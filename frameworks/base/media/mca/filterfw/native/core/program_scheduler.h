@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FILTERFW_CORE_PROGRAM_SCHEDULER_H
+#define ANDROID_FILTERFW_CORE_PROGRAM_SCHEDULER_H
+
+#include <pthread.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "base/utilities.h"
+
+namespace android {
+namespace filterfw {
+
+class NativeProgram;
+
+// A ProgramScheduler runs the process functions of NativePrograms on a pool of
+// worker threads, so that independent branches of a filter graph can overlap.
+// Each submitted job may depend on earlier jobs, and is only run once these
+// have completed. Jobs of the same program are always run in submission
+// order, one at a time, so that programs need not be thread-safe.
+//
+// The input and output buffers of a job must stay valid until the job has
+// been waited for.
+//
+// The scheduler is not built into libfilterfw nor exposed through JNI yet:
+// that needs program_scheduler.cpp in native/libfilterfw.mk and a Java
+// android.filterfw.core peer to drive it from the graph runner.
+class ProgramScheduler {
+  public:
+    // Create a scheduler with the given number of worker threads. Pass 0 to
+    // use one thread per online CPU.
+    explicit ProgramScheduler(int num_threads);
+
+    // Waits for all pending jobs, and stops the worker threads.
+    ~ProgramScheduler();
+
+    // Submits a call to the program's process function. Returns the id of the
+    // job, or -1 if it could not be submitted. Dependencies on jobs that have
+    // been waited for already are considered satisfied. If a dependency
+    // fails, the job fails without being run.
+    int Submit(NativeProgram* program,
+               const std::vector<const char*>& inputs,
+               const std::vector<int>& input_sizes,
+               char* output,
+               int output_size,
+               const std::vector<int>& dependencies);
+
+    // Waits for the job with the given id. Returns true if the process
+    // function succeeded.
+    bool Wait(int job_id);
+
+    // Waits for all submitted jobs. Returns true if all of them succeeded.
+    bool WaitAll();
+
+    // Returns the number of worker threads.
+    int NumThreads() const {
+      return threads_.size();
+    }
+
+  private:
+    enum JobState {
+      kJobWaiting,  // Waiting for its dependencies
+      kJobReady,    // Queued for a worker
+      kJobRunning,  // Being processed by a worker
+      kJobDone      // Completed, possibly unsuccessfully
+    };
+
+    struct Job {
+      NativeProgram* program;
+      std::vector<const char*> inputs;
+      std::vector<int> input_sizes;
+      char* output;
+      int output_size;
+      JobState state;
+      int pending_dependencies;
+      bool dependency_failed;
+      bool success;
+      std::vector<int> dependents;
+    };
+
+    // Worker thread entry point.
+    static void* WorkerMain(void* scheduler);
+
+    // Runs ready jobs until the scheduler is stopped.
+    void RunJobs();
+
+    // Marks the job as completed and queues dependents that became ready.
+    // Must be called with the lock held.
+    void CompleteJob(int job_id, bool success);
+
+    // Adds a dependency of the job on the given job, unless it has completed
+    // already. Must be called with the lock held.
+    void AddDependency(Job* job, int job_id, int dependency_id);
+
+    // Removes the job from the scheduler. Must be called with the lock held.
+    void ReapJob(int job_id);
+
+    std::vector<pthread_t> threads_;
+    pthread_mutex_t lock_;
+    pthread_cond_t job_ready_;
+    pthread_cond_t job_done_;
+
+    // Jobs that have not been waited for, by id.
+    std::map<int, Job*> jobs_;
+
+    // Ids of the jobs that can run.
+    std::deque<int> ready_jobs_;
+
+    // The most recent job submitted for each program.
+    std::map<NativeProgram*, int> last_job_of_program_;
+
+    int next_job_id_;
+    bool stopping_;
+
+    DISALLOW_COPY_AND_ASSIGN(ProgramScheduler);
+};
+
+} // namespace filterfw
+} // namespace android
+
+#endif  // ANDROID_FILTERFW_CORE_PROGRAM_SCHEDULER_H
@@ -89,15 +89,15 @@ ClockRecoveryLoop::~ClockRecoveryLoop() {
 }
 
 // Constants.
-const float ClockRecoveryLoop::dT = 1.0;
-const float ClockRecoveryLoop::Kc = 1.0f;
-const float ClockRecoveryLoop::Ti = 15.0f;
-const float ClockRecoveryLoop::Tf = 0.05;
-const float ClockRecoveryLoop::bias_Fc = 0.01;
-const float ClockRecoveryLoop::bias_RC = (dT / (2 * 3.14159f * bias_Fc));
-const float ClockRecoveryLoop::bias_Alpha = (dT / (bias_RC + dT));
+const float ClockRecoveryLoop::kOffsetProcessNoise = 1.0f;
+const float ClockRecoveryLoop::kFreqProcessNoise = 0.001f;
+const float ClockRecoveryLoop::kInitialFreqVariance = 10000.0f;
+const float ClockRecoveryLoop::kMeasurementNoiseFloor = 20.0f;
+const float ClockRecoveryLoop::kOutlierSigmas = 4.0f;
+const uint32_t ClockRecoveryLoop::kMaxConsecutiveOutliers = 4;
+const float ClockRecoveryLoop::kOffsetTimeConstant = 10.0f;
+const float ClockRecoveryLoop::kMaxPredictionInterval = 60.0f;
 const int64_t ClockRecoveryLoop::panic_thresh_ = 50000;
-const int64_t ClockRecoveryLoop::control_thresh_ = 10000;
 const float ClockRecoveryLoop::COmin = -100.0f;
 const float ClockRecoveryLoop::COmax = 100.0f;
 const uint32_t ClockRecoveryLoop::kMinFullRangeSlewChange_mSec = 300;
@@ -161,7 +161,6 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
 
     int64_t observed_common;
     int64_t delta;
-    float delta_f, dCO;
     int32_t tgt_correction;
 
     if (OK != common_clock_->localToCommon(local_time, &observed_common)) {
@@ -173,60 +172,43 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
         return false;
     }
 
-    // Implement a filter which should match NTP filtering behavior when a
-    // client is associated with only one peer of lower stratum.  Basically,
-    // always use the best of the N last data points, where best is defined as
-    // lowest round trip time.  NTP uses an N of 8; we use a value of 6.
-    //
-    // TODO(johngro) : experiment with other filter strategies.  The goal here
-    // is to mitigate the effects of high RTT data points which typically have
-    // large asymmetries in the TX/RX legs.  Downside of the existing NTP
-    // approach (particularly because of the PID controller we are using to
-    // produce the control signal from the filtered data) are that the rate at
-    // which discipline events are actually acted upon becomes irregular and can
-    // become drawn out (the time between actionable event can go way up).  If
-    // the system receives a strong high quality data point, the proportional
-    // component of the controller can produce a strong correction which is left
-    // in place for too long causing overshoot.  In addition, the integral
-    // component of the system currently is an approximation based on the
-    // assumption of a more or less homogeneous sampling of the error.  Its
-    // unclear what the effect of undermining this assumption would be right
-    // now.
-
-    // Two ideas which come to mind immediately would be to...
-    // 1) Keep a history of more data points (32 or so) and ignore data points
-    //    whose RTT is more than a certain number of standard deviations outside
-    //    of the norm.
-    // 2) Eliminate the PID controller portion of this system entirely.
-    //    Instead, move to a system which uses a very wide filter (128 data
-    //    points or more) with a sum-of-least-squares line fitting approach to
-    //    tracking the long term drift.  This would take the place of the I
-    //    component in the current PID controller.  Also use a much more narrow
-    //    outlier-rejector filter (as described in #1) to drive a short term
-    //    correction factor similar to the P component of the PID controller.
-    assert(filter_wr_ < kFilterSize);
-    filter_data_[filter_wr_].local_time           = local_time;
-    filter_data_[filter_wr_].observed_common_time = observed_common;
-    filter_data_[filter_wr_].nominal_common_time  = nominal_common_time;
-    filter_data_[filter_wr_].rtt                  = rtt;
-    filter_data_[filter_wr_].point_used           = false;
-    uint32_t current_point = filter_wr_;
-    filter_wr_ = (filter_wr_ + 1) % kFilterSize;
-    if (!filter_wr_)
-        filter_full_ = true;
-
-    uint32_t scan_end = filter_full_ ? kFilterSize : filter_wr_;
-    uint32_t min_rtt = findMinRTTNdx(filter_data_, scan_end);
-    // We only use packets with low RTTs for control. If the packet RTT
-    // is less than the panic threshold, we can probably eat the jitter with the
-    // control loop. Otherwise, take the packet only if it better than all
-    // of the packets we have in the history. That way we try to track
-    // something, even if it is noisy.
-    if (current_point == min_rtt || rtt < control_thresh_) {
-        delta_f = delta = nominal_common_time - observed_common;
+    // Rather than only acting on the best of the last N data points, weigh
+    // every data point by its RTT through the measurement noise of a Kalman
+    // filter.  The server already only hands us the lowest RTT exchange of
+    // each burst of sync requests.  The filter predicts the offset across the
+    // time since the last event using its frequency estimate and the
+    // correction we applied, which keeps the control signal sensible while
+    // data points are being rejected.
+    delta = nominal_common_time - observed_common;
+
+    if (!filter_valid_) {
+        float sigma = kMeasurementNoiseFloor + 0.5f * rtt;
+        offset_est_ = delta;
+        freq_est_ = CO;
+        P_[0][0] = sigma * sigma;
+        P_[0][1] = P_[1][0] = 0.0f;
+        P_[1][1] = kInitialFreqVariance;
+        consecutive_outliers_ = 0;
+        filter_valid_ = true;
+    } else {
+        float dt = static_cast<float>(local_time - last_event_local_time_) /
+                   local_clock_->getLocalFreq();
+        if (dt < 0.0f)
+            dt = 0.0f;
+        else if (dt > kMaxPredictionInterval)
+            dt = kMaxPredictionInterval;
+
+        predict_l(dt);
+        if (!update_l(delta, rtt)) {
+            LOG_TS("clock_loop rejected outlier %lld (predicted %f, rtt %lld)\n",
+                   delta, offset_est_, rtt);
+        }
+    }
+    last_event_local_time_ = local_time;
 
+    if (!consecutive_outliers_) {
         last_error_est_valid_ = true;
-        last_error_est_usec_ = delta;
+        last_error_est_usec_ = offset_est_;
 
         // Compute the error then clamp to the panic threshold.  If we ever
         // exceed this amt of error, its time to panic and reset the system.
@@ -235,7 +217,8 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
         // the implied error (delta) is greater than the absolute panic
         // threashold plus the RTT.  IOW - we don't panic until we are
         // absoluely sure that our best case sync is worse than the absolute
-        // panic threshold.
+        // panic threshold.  Outliers never get here, so a single bad data
+        // point can not cause a panic.
         int64_t effective_panic_thresh = panic_thresh_ + rtt;
         if ((delta > effective_panic_thresh) ||
             (delta < -effective_panic_thresh)) {
@@ -243,24 +226,11 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
             reset_l(false, true);
             return false;
         }
-
-    } else {
-        // We do not have a good packet to look at, but we also do not want to
-        // free-run the clock at some crazy slew rate. So we guess the
-        // trajectory of the clock based on the last controller output and the
-        // estimated bias of our clock against the master.
-        // The net effect of this is that CO == CObias after some extended
-        // period of no feedback.
-        delta_f = last_delta_f_ - dT*(CO - CObias);
-        delta = delta_f;
     }
 
-    // Velocity form PI control equation.
-    dCO = Kc * (1.0f + dT/Ti) * delta_f - Kc * last_delta_f_;
-    CO += dCO * Tf; // Filter CO by applying gain <1 here.
-
-    // Save error terms for later.
-    last_delta_f_ = delta_f;
+    // Cancel the estimated frequency error, and steer out the estimated
+    // offset over kOffsetTimeConstant seconds.
+    CO = freq_est_ + offset_est_ / kOffsetTimeConstant;
 
     // Clamp CO to +/- 100ppm.
     if (CO < COmin)
@@ -268,10 +238,6 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
     else if (CO > COmax)
         CO = COmax;
 
-    // Update the controller bias.
-    CObias = bias_Alpha * CO + (1.0f - bias_Alpha) * lastCObias;
-    lastCObias = CObias;
-
     // Convert PPM to 16-bit int range. Add some guard band (-0.01) so we
     // don't get fp weirdness.
     tgt_correction = CO * 327.66;
@@ -280,7 +246,7 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
     // system.
     setTargetCorrection_l(tgt_correction);
 
-    LOG_TS("clock_loop %lld %f %f %f %d\n", raw_delta, delta_f, CO, CObias, tgt_correction);
+    LOG_TS("clock_loop %lld %f %f %f %d\n", raw_delta, offset_est_, freq_est_, CO, tgt_correction);
 
 #ifdef TIME_SERVICE_DEBUG
     diag_thread_->pushDisciplineEvent(
@@ -294,6 +260,48 @@ bool ClockRecoveryLoop::pushDisciplineEvent(int64_t local_time,
     return true;
 }
 
+void ClockRecoveryLoop::predict_l(float dt) {
+    // The offset drifts by the difference between the frequency error and
+    // the correction we applied; the frequency error is a random walk.
+    offset_est_ += (freq_est_ - CO) * dt;
+
+    float p00 = P_[0][0] + dt * (P_[0][1] + P_[1][0]) + dt * dt * P_[1][1];
+    float p01 = P_[0][1] + dt * P_[1][1];
+    float p10 = P_[1][0] + dt * P_[1][1];
+    P_[0][0] = p00 + kOffsetProcessNoise * dt;
+    P_[0][1] = p01;
+    P_[1][0] = p10;
+    P_[1][1] += kFreqProcessNoise * dt;
+}
+
+bool ClockRecoveryLoop::update_l(float measured_offset, int64_t rtt) {
+    float sigma = kMeasurementNoiseFloor + 0.5f * rtt;
+    float innovation = measured_offset - offset_est_;
+    float S = P_[0][0] + sigma * sigma;
+
+    // Reject outliers, unless they keep coming; then the model is wrong
+    // (say, the master stepped) and we should follow the measurements.
+    if ((innovation * innovation > kOutlierSigmas * kOutlierSigmas * S) &&
+        (++consecutive_outliers_ <= kMaxConsecutiveOutliers))
+        return false;
+    consecutive_outliers_ = 0;
+
+    float K0 = P_[0][0] / S;
+    float K1 = P_[1][0] / S;
+    offset_est_ += K0 * innovation;
+    freq_est_ += K1 * innovation;
+
+    float p00 = (1.0f - K0) * P_[0][0];
+    float p01 = (1.0f - K0) * P_[0][1];
+    float p10 = P_[1][0] - K1 * P_[0][0];
+    float p11 = P_[1][1] - K1 * P_[0][1];
+    P_[0][0] = p00;
+    P_[0][1] = p01;
+    P_[1][0] = p10;
+    P_[1][1] = p11;
+    return true;
+}
+
 int32_t ClockRecoveryLoop::getLastErrorEstimate() {
     Mutex::Autolock lock(&lock_);
 
@@ -314,15 +322,15 @@ void ClockRecoveryLoop::reset_l(bool position, bool frequency) {
     if (frequency) {
         last_error_est_valid_ = false;
         last_error_est_usec_ = 0;
-        last_delta_f_ = 0.0;
         CO = 0.0f;
-        lastCObias = CObias = 0.0f;
         setTargetCorrection_l(0);
         applySlew_l();
     }
 
-    filter_wr_   = 0;
-    filter_full_ = false;
+    // Restart the filter from the next data point.  Unless the frequency is
+    // being reset, it starts out from the current correction.
+    filter_valid_ = false;
+    consecutive_outliers_ = 0;
 }
 
 void ClockRecoveryLoop::setTargetCorrection_l(int32_t tgt) {
@@ -51,49 +51,54 @@ class ClockRecoveryLoop {
 
   private:
 
-    // Tuned using the "Good Gain" method.
-    // See:
-    // http://techteach.no/publications/books/dynamics_and_control/tuning_pid_controller.pdf
-
-    // Controller period (1Hz for now).
-    static const float dT;
-
-    // Controller gain, positive and unitless. Larger values converge faster,
-    // but can cause instability.
-    static const float Kc;
-
-    // Integral reset time. Smaller values cause loop to track faster, but can
-    // also cause instability.
-    static const float Ti;
-
-    // Controller output filter time constant. Range (0-1). Smaller values make
-    // output smoother, but slow convergence.
-    static const float Tf;
-
-    // Low-pass filter for bias tracker.
-    static const float bias_Fc; // HZ
-    static const float bias_RC; // Computed in constructor.
-    static const float bias_Alpha; // Computed inconstructor.
+    // The discipline events drive a two state Kalman filter, tracking the
+    // offset (in uSec) and the frequency error (in ppm) of the common clock
+    // relative to the master.  The controller output then corrects for the
+    // estimated frequency error, and steers the estimated offset out over a
+    // fixed time constant.
+
+    // Process noise of the offset (uSec^2 per second) and frequency
+    // (ppm^2 per second) states.  Larger values track faster, but pass more
+    // measurement noise through to the clock.
+    static const float kOffsetProcessNoise;
+    static const float kFreqProcessNoise;
+
+    // Initial variance of the frequency estimate (ppm^2).
+    static const float kInitialFreqVariance;
+
+    // Standard deviation of a zero RTT measurement (uSec).  The standard
+    // deviation of a measurement is this plus half of its RTT, as the path
+    // asymmetry can be anywhere in [-RTT/2, RTT/2].
+    static const float kMeasurementNoiseFloor;
+
+    // Measurements further than this many standard deviations from the
+    // predicted offset are rejected as outliers, unless this happened for
+    // more than kMaxConsecutiveOutliers measurements in a row.
+    static const float kOutlierSigmas;
+    static const uint32_t kMaxConsecutiveOutliers;
+
+    // Time constant (seconds) over which an offset estimate is steered out.
+    static const float kOffsetTimeConstant;
+
+    // The maximum time (seconds) the filter predicts across.  Longer gaps in
+    // the discipline events are clamped to this.
+    static const float kMaxPredictionInterval;
 
     // The maximum allowed error (as indicated by a  pushDisciplineEvent) before
     // we panic.
     static const int64_t panic_thresh_;
 
-    // The maximum allowed error rtt time for packets to be used for control
-    // feedback, unless the packet is the best in recent memory.
-    static const int64_t control_thresh_;
-
     typedef struct {
         int64_t local_time;
-        int64_t observed_common_time;
         int64_t nominal_common_time;
         int64_t rtt;
-        bool point_used;
     } DisciplineDataPoint;
 
     static uint32_t findMinRTTNdx(DisciplineDataPoint* data, uint32_t count);
 
     void reset_l(bool position, bool frequency);
+    void predict_l(float dt);
+    bool update_l(float measured_offset, int64_t rtt);
     void setTargetCorrection_l(int32_t tgt);
     bool applySlew_l();
 
@@ -110,32 +115,29 @@ class ClockRecoveryLoop {
     // of the frequency correction.
     bool    last_error_est_valid_;
     int32_t last_error_est_usec_;
-    float last_delta_f_;
-    int32_t integrated_error_;
     int32_t tgt_correction_;
     int32_t cur_correction_;
     LinearTransform time_to_cur_slew_;
     int64_t slew_change_end_time_;
     Timeout next_slew_change_timeout_;
 
-    // Contoller Output.
+    // Contoller Output (ppm).
     float CO;
 
-    // Bias tracking for trajectory estimation.
-    float CObias;
-    float lastCObias;
+    // Kalman filter state: the offset and frequency estimates, their
+    // covariance, and the local time of the last discipline event.
+    bool    filter_valid_;
+    float   offset_est_;
+    float   freq_est_;
+    float   P_[2][2];
+    int64_t last_event_local_time_;
+    uint32_t consecutive_outliers_;
 
     // Controller output bounds. The controller will not try to
     // slew faster that +/-100ppm offset from center per interation.
     static const float COmin;
     static const float COmax;
 
-    // State kept for filtering the discipline data.
-    static const uint32_t kFilterSize = 16;
-    DisciplineDataPoint filter_data_[kFilterSize];
-    uint32_t filter_wr_;
-    bool filter_full_;
-
     static const uint32_t kStartupFilterSize = 4;
     DisciplineDataPoint startup_filter_data_[kStartupFilterSize];
     uint32_t startup_filter_wr_;
@@ -36,6 +36,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #include <common_time/local_clock.h>
 #include <binder/IPCThreadState.h>
@@ -82,6 +83,13 @@ const int CommonTimeServer::kInitial_WhoIsMasterTimeoutMs = 500;
 // is dead
 const int CommonTimeServer::kClient_NumSyncRequestRetries = 10;
 
+// number of sync request/response exchanges in a burst.  The exchange with the
+// lowest RTT of each burst is the one least disturbed by queuing delays.
+const uint32_t CommonTimeServer::kClient_SyncBurstSize = 4;
+
+// receive timestamps older than this are considered bogus
+static const int64_t kMaxRxTimestampAgeNsec = 1000000000ll;
+
 /*** Master state constants ***/
 
 /*** Ronin state constants ***/
@@ -104,6 +112,7 @@ CommonTimeServer::CommonTimeServer()
     , mClockRecovery(&mLocalClock, &mCommonClock)
     , mSocket(-1)
     , mLastPacketRxLocalTime(0)
+    , mSocketHasRxTimestamps(false)
     , mTimelineID(ICommonClock::kInvalidTimelineID)
     , mClockSynced(false)
     , mCommonClockHasClients(false)
@@ -524,6 +533,17 @@ bool CommonTimeServer::setupSocket_l() {
         goto bailout;
     }
 
+    // Ask the kernel to timestamp received packets, so that the time we
+    // spend waking up does not count as network delay.  This is optional;
+    // without it we use the time at which poll returned.
+    rc = setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+    mSocketHasRxTimestamps = (rc == 0);
+    if (!mSocketHasRxTimestamps) {
+        mStateChangeLog.log(ANDROID_LOG_WARN, LOG_TAG,
+                            "Failed to enable RX timestamps (errno = %d)",
+                            errno);
+    }
+
     // get the device's unique ID
     if (!assignDeviceID())
         goto bailout;
@@ -607,22 +627,69 @@ static void hexDumpToString(const uint8_t* src, size_t src_len,
     dst[dst_len - 1] = 0;
 }
 
+// Converts a kernel receive timestamp (CLOCK_REALTIME) to local time by
+// measuring how long ago it was taken.  The local clock need not be based on
+// the same oscillator; the age of a packet is short enough for the rate
+// difference to not matter.
+int64_t CommonTimeServer::kernelRxTimeToLocalTime(
+        const struct timespec& rxTime) {
+    struct timespec now;
+    int64_t localNow = mLocalClock.getLocalTime();
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    int64_t ageNsec = (static_cast<int64_t>(now.tv_sec) - rxTime.tv_sec)
+                    * 1000000000ll + (now.tv_nsec - rxTime.tv_nsec);
+    if ((ageNsec < 0) || (ageNsec > kMaxRxTimestampAgeNsec))
+        return mLastPacketRxLocalTime;
+
+    int64_t ageLocal = ageNsec * static_cast<int64_t>(mLocalClock.getLocalFreq())
+                     / 1000000000ll;
+    return localNow - ageLocal;
+}
+
 bool CommonTimeServer::handlePacket() {
     uint8_t buf[256];
+    uint8_t ctrl[CMSG_SPACE(sizeof(struct timespec))];
     struct sockaddr_storage srcAddr;
-    socklen_t srcAddrLen = sizeof(srcAddr);
 
-    ssize_t recvBytes = recvfrom(
-            mSocket, buf, sizeof(buf), 0,
-            reinterpret_cast<const sockaddr *>(&srcAddr), &srcAddrLen);
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len  = sizeof(buf);
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name       = &srcAddr;
+    msg.msg_namelen    = sizeof(srcAddr);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    ssize_t recvBytes = recvmsg(mSocket, &msg, 0);
 
     if (recvBytes < 0) {
         mBadPktLog.log(ANDROID_LOG_ERROR, LOG_TAG,
-                       "recvfrom failed (res %d, errno %d)",
+                       "recvmsg failed (res %d, errno %d)",
                        recvBytes, errno);
         return false;
     }
 
+    // Use the kernel's RX timestamp if we have one.  The local time of our
+    // wakeup (set by the caller) remains the fallback.
+    if (mSocketHasRxTimestamps) {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+             cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if ((cmsg->cmsg_level == SOL_SOCKET) &&
+                (cmsg->cmsg_type == SCM_TIMESTAMPNS)) {
+                struct timespec rxTime;
+                memcpy(&rxTime, CMSG_DATA(cmsg), sizeof(rxTime));
+                mLastPacketRxLocalTime = kernelRxTimeToLocalTime(rxTime);
+                break;
+            }
+        }
+    }
+
     UniversalTimeServicePacket pkt;
     if (pkt.deserializePacket(buf, recvBytes, mSyncGroupID) < 0) {
         char hex[256];
@@ -951,7 +1018,7 @@ bool CommonTimeServer::handleSyncResponse(
     mClient_PacketRTTLog.logRX(response->clientTxLocalTime,
                                mLastPacketRxLocalTime);
 
-    bool result;
+    bool result = true;
     if (!(mClient_SyncRespsRXedFromCurMaster++)) {
         // the first request/response exchange between a client and a master
         // may take unusually long due to ARP, so discard it.
@@ -976,19 +1043,38 @@ bool CommonTimeServer::handleSyncResponse(
             mClient_ExpiredSyncRespsRXedFromCurMaster++;
             if (shouldPanicNotGettingGoodData())
                 return becomeInitial("RX panic, no good data");
-        } else {
-            result = mClockRecovery.pushDisciplineEvent(avgLocal, avgCommon, rttCommon);
-            mClient_LastGoodSyncRX = clientRxLocalTime;
+        } else if (!mClient_SyncBurstBestValid ||
+                   (rttCommon < mClient_SyncBurstBestRTT)) {
+            // Remember the best exchange of the current burst.
+            mClient_SyncBurstBestValid  = true;
+            mClient_SyncBurstBestLocal  = avgLocal;
+            mClient_SyncBurstBestCommon = avgCommon;
+            mClient_SyncBurstBestRTT    = rttCommon;
+            mClient_SyncBurstBestRX     = clientRxLocalTime;
+        }
+    }
 
-            if (result) {
-                // indicate to listeners that we've synced to the common timeline
-                notifyClockSync();
-            } else {
-                ALOGE("Panic!  Observed clock sync error is too high to tolerate,"
-                        " resetting state machine and starting over.");
-                notifyClockSyncLoss();
-                return becomeInitial("panic");
-            }
+    // If the burst is not complete yet, follow up with its next request right
+    // away.
+    if (++mClient_SyncBurstRespsRXed < kClient_SyncBurstSize)
+        return sendSyncRequest();
+    mClient_SyncBurstRespsRXed = 0;
+
+    if (mClient_SyncBurstBestValid) {
+        mClient_SyncBurstBestValid = false;
+        result = mClockRecovery.pushDisciplineEvent(mClient_SyncBurstBestLocal,
+                                                    mClient_SyncBurstBestCommon,
+                                                    mClient_SyncBurstBestRTT);
+        mClient_LastGoodSyncRX = mClient_SyncBurstBestRX;
+
+        if (result) {
+            // indicate to listeners that we've synced to the common timeline
+            notifyClockSync();
+        } else {
+            ALOGE("Panic!  Observed clock sync error is too high to tolerate,"
+                    " resetting state machine and starting over.");
+            notifyClockSyncLoss();
+            return becomeInitial("panic");
         }
     }
 
@@ -117,6 +117,7 @@ class CommonTimeServer : public Thread {
                                 uint64_t deviceID2, uint8_t devicePrio2);
 
     bool handlePacket();
+    int64_t kernelRxTimeToLocalTime(const struct timespec& rxTime);
     bool handleWhoIsMasterRequest (const WhoIsMasterRequestPacket* request,
                                    const sockaddr_storage& srcAddr);
     bool handleWhoIsMasterResponse(const WhoIsMasterResponsePacket* response,
@@ -177,6 +178,8 @@ class CommonTimeServer : public Thread {
         mClient_ExpiredSyncRespsRXedFromCurMaster = 0;
         mClient_FirstSyncTX = 0;
         mClient_LastGoodSyncRX = 0;
+        mClient_SyncBurstRespsRXed = 0;
+        mClient_SyncBurstBestValid = false;
         mClient_PacketRTTLog.resetLog();
     }
 
@@ -203,8 +206,11 @@ class CommonTimeServer : public Thread {
     // changes.
     int mWakeupThreadFD;
 
-    // timestamp captured when a packet is received
+    // timestamp captured when a packet is received.  When the socket
+    // supports it, this is derived from the kernel's receive timestamp, so it
+    // does not include our wakeup latency.
     int64_t mLastPacketRxLocalTime;
+    bool mSocketHasRxTimestamps;
 
     // ID of the timeline that this device is following
     uint64_t mTimelineID;
@@ -297,6 +303,16 @@ class CommonTimeServer : public Thread {
     PacketRTTLog mClient_PacketRTTLog;
     static const int kClient_NumSyncRequestRetries;
 
+    // Sync requests are sent in bursts, and only the exchange with the lowest
+    // RTT of each burst is passed on to the clock recovery loop.
+    uint32_t mClient_SyncBurstRespsRXed;
+    bool mClient_SyncBurstBestValid;
+    int64_t mClient_SyncBurstBestLocal;
+    int64_t mClient_SyncBurstBestCommon;
+    int64_t mClient_SyncBurstBestRTT;
+    int64_t mClient_SyncBurstBestRX;
+    static const uint32_t kClient_SyncBurstSize;
+
 
     /*** status while in the Master state ***/
     static const uint32_t kDefaultMaster_AnnouncementIntervalMs;
@@ -17,6 +17,8 @@
 #define LOG_TAG "common_time"
 #include <utils/Log.h>
 
+#include <algorithm>
+
 #include <fcntl.h>
 #include <linux/in.h>
 #include <linux/tcp.h>
@@ -66,6 +68,8 @@ DiagThread::DiagThread(CommonClock* common_clock, LocalClock* local_clock) {
     data_fd_ = -1;
     kernel_logID_basis_known_ = false;
     discipline_log_ID_ = 0;
+    sync_error_wr_ = 0;
+    sync_error_count_ = 0;
 }
 
 DiagThread::~DiagThread() {
@@ -167,6 +171,8 @@ void DiagThread::resetLogIDs() {
         Mutex::Autolock lock(&discipline_log_lock_);
         discipline_log_.clear();
         discipline_log_ID_ = 0;
+        sync_error_wr_ = 0;
+        sync_error_count_ = 0;
     }
 
     kernel_logID_basis_known_ = false;
@@ -196,6 +202,43 @@ void DiagThread::pushDisciplineEvent(int64_t observed_local_time,
     discipline_log_.push_back(evt);
     while (discipline_log_.size() > kMaxDisciplineLogSize)
         discipline_log_.erase(discipline_log_.begin());
+
+    int64_t sync_error = nominal_common_time - observed_common_time;
+    sync_error_history_[sync_error_wr_] = (sync_error < 0) ? -sync_error
+                                                           : sync_error;
+    sync_error_wr_ = (sync_error_wr_ + 1) % kSyncErrorHistorySize;
+    if (sync_error_count_ < kSyncErrorHistorySize)
+        sync_error_count_++;
+}
+
+// Writes "P,<count>,<p50>,<p90>,<p99>,<max>" with the percentiles of the
+// magnitude of the recent sync errors, in uSec.
+void DiagThread::writeSyncErrorPercentiles() {
+    int64_t sorted[kSyncErrorHistorySize];
+    size_t count;
+
+    {
+        Mutex::Autolock lock(&discipline_log_lock_);
+        count = sync_error_count_;
+        memcpy(sorted, sync_error_history_, count * sizeof(sorted[0]));
+    }
+
+    char buf[256];
+    if (count) {
+        std::sort(sorted, sorted + count);
+        snprintf(buf, sizeof(buf), "P,%u,%lld,%lld,%lld,%lld\n",
+                 static_cast<uint32_t>(count),
+                 sorted[(count - 1) * 50 / 100],
+                 sorted[(count - 1) * 90 / 100],
+                 sorted[(count - 1) * 99 / 100],
+                 sorted[count - 1]);
+    } else {
+        snprintf(buf, sizeof(buf), "P,0,0,0,0,0\n");
+    }
+    buf[sizeof(buf) - 1] = 0;
+
+    if (data_fd_ >= 0)
+        write(data_fd_, buf, strlen(buf));
 }
 
 bool DiagThread::threadLoop() {
@@ -254,6 +297,10 @@ bool DiagThread::threadLoop() {
                                     case 'R':
                                         resetLogIDs();
                                         break;
+                                    case 'p':
+                                    case 'P':
+                                        writeSyncErrorPercentiles();
+                                        break;
                                 }
                             }
                         }
@@ -56,6 +56,7 @@ class DiagThread : public Thread {
     void            cleanupListenSocket();
     void            cleanupDataSocket();
     void            resetLogIDs();
+    void            writeSyncErrorPercentiles();
 
     CommonClock*    common_clock_;
     LocalClock*     local_clock_;
@@ -69,6 +70,13 @@ class DiagThread : public Thread {
     Mutex                       discipline_log_lock_;
     List<DisciplineEventRecord> discipline_log_;
     int64_t                     discipline_log_ID_;
+
+    // Magnitude of the sync error (nominal - observed common time, in uSec)
+    // of the most recent discipline events, for percentile reporting.
+    static const size_t         kSyncErrorHistorySize = 512;
+    int64_t                     sync_error_history_[kSyncErrorHistorySize];
+    size_t                      sync_error_wr_;
+    size_t                      sync_error_count_;
 };
 
 }  // namespace android
@@ -163,7 +163,8 @@ EventHub::Device::Device(int fd, int32_t id, const String8& path,
         fd(fd), id(id), path(path), identifier(identifier),
         classes(0), configuration(NULL), virtualKeyMap(NULL),
         ffEffectPlaying(false), ffEffectId(-1), controllerNumber(0),
-        timestampOverrideSec(0), timestampOverrideUsec(0) {
+        timestampOverrideSec(0), timestampOverrideUsec(0),
+        coalesceWindow(0), lastEventTime(0) {
     memset(keyBitmask, 0, sizeof(keyBitmask));
     memset(absBitmask, 0, sizeof(absBitmask));
     memset(relBitmask, 0, sizeof(relBitmask));
@@ -202,6 +203,10 @@ EventHub::EventHub(void) :
         mPendingEventCount(0), mPendingEventIndex(0), mPendingINotify(false) {
     acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_ID);
 
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.input.coalesce_window_ms", value, "0");
+    mDefaultCoalesceWindow = milliseconds_to_nanoseconds(max(atoi(value), 0));
+
     mEpollFd = epoll_create(EPOLL_SIZE_HINT);
     LOG_ALWAYS_FATAL_IF(mEpollFd < 0, "Could not create epoll instance.  errno=%d", errno);
 
@@ -654,8 +659,16 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
     RawEvent* event = buffer;
     size_t capacity = bufferSize;
     bool awoken = false;
+
+    // The time until which the events collected so far may be held back to be
+    // returned together with the events of other devices.  It is the earliest
+    // event time plus coalescing window of the devices read.
+    nsecs_t batchDeadline = LONG_LONG_MAX;
+    nsecs_t timeoutTime = timeoutMillis < 0 ? LONG_LONG_MAX
+            : systemTime(SYSTEM_TIME_MONOTONIC) + milliseconds_to_nanoseconds(timeoutMillis);
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        RawEvent* const reportedEvents = event;
 
         // Reopen input devices if needed.
         if (mNeedToReopenDevices) {
@@ -716,6 +729,11 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             }
         }
 
+        // Device changes are never held back.
+        if (event != reportedEvents) {
+            batchDeadline = now;
+        }
+
         // Grab the next input event.
         bool deviceChanged = false;
         while (mPendingEventIndex < mPendingEventCount) {
@@ -771,6 +789,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                     ALOGE("could not get event (wrong size: %d)", readSize);
                 } else {
                     int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
+                    RawEvent* const deviceEvents = event;
 
                     size_t count = size_t(readSize) / sizeof(struct input_event);
                     for (size_t i = 0; i < count; i++) {
@@ -794,7 +813,9 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                                 continue;
                             }
                         }
+                        bool overridden = false;
                         if (device->timestampOverrideSec || device->timestampOverrideUsec) {
+                            overridden = true;
                             iev.time.tv_sec = device->timestampOverrideSec;
                             iev.time.tv_usec = device->timestampOverrideUsec;
                             if (iev.type == EV_SYN && iev.code == SYN_REPORT) {
@@ -854,6 +875,8 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                                         event->when, time, now);
                             }
                         }
+                        event->when = correctEventTimeLocked(device, event->when,
+                                overridden, now);
 #else
                         event->when = now;
 #endif
@@ -864,6 +887,13 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                         event += 1;
                         capacity -= 1;
                     }
+                    if (event != deviceEvents) {
+                        nsecs_t deadline = device->coalesceWindow
+                                ? deviceEvents->when + device->coalesceWindow : now;
+                        if (deadline < batchDeadline) {
+                            batchDeadline = deadline;
+                        }
+                    }
                     if (capacity == 0) {
                         // The result buffer is full.  Reset the pending event index
                         // so we will try to read the device again on the next iteration.
@@ -897,7 +927,17 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         }
 
         // Return now if we have collected any events or if we were explicitly awoken.
-        if (event != buffer || awoken) {
+        // The events of devices with a coalescing window are held back until the
+        // window of the earliest one has elapsed, so that the reader processes the
+        // events of the devices reporting meanwhile in the same round.
+        int pollTimeoutMillis = timeoutMillis;
+        if (event != buffer) {
+            if (awoken || capacity == 0 || batchDeadline <= now || timeoutTime <= now) {
+                break;
+            }
+            nsecs_t deadline = batchDeadline < timeoutTime ? batchDeadline : timeoutTime;
+            pollTimeoutMillis = toMillisecondTimeoutDelay(now, deadline);
+        } else if (awoken) {
             break;
         }
 
@@ -912,14 +952,23 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         //
         // The timeout is advisory only.  If the device is asleep, it will not wake just to
         // service the timeout.
+        //
+        // The events held back for coalescing have already been read, so the wake lock
+        // is kept while waiting for more.
         mPendingEventIndex = 0;
 
+        bool coalescing = event != buffer;
         mLock.unlock(); // release lock before poll, must be before release_wake_lock
-        release_wake_lock(WAKE_LOCK_ID);
+        if (!coalescing) {
+            release_wake_lock(WAKE_LOCK_ID);
+        }
 
-        int pollResult = epoll_wait(mEpollFd, mPendingEventItems, EPOLL_MAX_EVENTS, timeoutMillis);
+        int pollResult = epoll_wait(mEpollFd, mPendingEventItems, EPOLL_MAX_EVENTS,
+                pollTimeoutMillis);
 
-        acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_ID);
+        if (!coalescing) {
+            acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_ID);
+        }
         mLock.lock(); // reacquire lock after poll, must be after acquire_wake_lock
 
         if (pollResult == 0) {
@@ -1241,6 +1290,8 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
         device->controllerNumber = getNextControllerNumberLocked(device);
     }
 
+    device->coalesceWindow = getCoalesceWindowLocked(device);
+
     // Register with epoll.
     struct epoll_event eventItem;
     memset(&eventItem, 0, sizeof(eventItem));
@@ -1284,6 +1335,8 @@ status_t EventHub::openDeviceLocked(const char *devicePath) {
          device->keyMap.keyCharacterMapFile.string(),
          toString(mBuiltInKeyboardId == deviceId),
          toString(usingSuspendBlockIoctl), toString(usingClockIoctl));
+    ALOGI_IF(device->coalesceWindow, "Coalescing the events of device id=%d for up to %lldus",
+            deviceId, device->coalesceWindow / 1000);
 
     addDeviceLocked(device);
     return 0;
@@ -1352,6 +1405,44 @@ bool EventHub::isExternalDeviceLocked(Device* device) {
     return device->identifier.bus == BUS_USB || device->identifier.bus == BUS_BLUETOOTH;
 }
 
+nsecs_t EventHub::getCoalesceWindowLocked(Device* device) {
+    // Touches are never held back, coalescing them would add to the latency
+    // the user notices the most.
+    if (device->classes & INPUT_DEVICE_CLASS_TOUCH) {
+        return 0;
+    }
+    if (device->configuration) {
+        int32_t value;
+        if (device->configuration->tryGetProperty(String8("device.coalesceWindowMs"), value)) {
+            return milliseconds_to_nanoseconds(max(value, 0));
+        }
+    }
+    return mDefaultCoalesceWindow;
+}
+
+nsecs_t EventHub::correctEventTimeLocked(Device* device, nsecs_t when, bool overridden,
+        nsecs_t now) {
+    // The time a driver supplies with MSC_ANDROID_TIME_SEC/USEC comes from its own
+    // reading of the clock, which may be slightly ahead of ours or go backwards
+    // between reports.  The kernel timestamps are taken from our clock on entry
+    // to evdev and are only ever corrected by the guard in getEvents().
+    if (overridden && when > now) {
+        nsecs_t time = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (when > time) {
+            ALOGV("Clamping override time %lld of %s to the current time %lld.",
+                    when, device->path.string(), time);
+            when = time;
+        }
+    }
+    if (when < device->lastEventTime) {
+        ALOGV("Clamping time %lld of %s to the time of its last event %lld.",
+                when, device->path.string(), device->lastEventTime);
+        when = device->lastEventTime;
+    }
+    device->lastEventTime = when;
+    return when;
+}
+
 int32_t EventHub::getNextControllerNumberLocked(Device* device) {
     if (mControllerNumbers.isFull()) {
         ALOGI("Maximum number of controllers reached, assigning controller number 0 to device %s",
@@ -1556,6 +1647,8 @@ void EventHub::dump(String8& dump) {
             dump.appendFormat(INDENT3 "Descriptor: %s\n", device->identifier.descriptor.string());
             dump.appendFormat(INDENT3 "Location: %s\n", device->identifier.location.string());
             dump.appendFormat(INDENT3 "ControllerNumber: %d\n", device->controllerNumber);
+            dump.appendFormat(INDENT3 "CoalesceWindow: %0.3fms\n",
+                    device->coalesceWindow * 0.000001f);
             dump.appendFormat(INDENT3 "UniqueId: %s\n", device->identifier.uniqueId.string());
             dump.appendFormat(INDENT3 "Identifier: bus=0x%04x, vendor=0x%04x, "
                     "product=0x%04x, version=0x%04x\n",
@@ -353,6 +353,14 @@ private:
         int32_t timestampOverrideSec;
         int32_t timestampOverrideUsec;
 
+        // How long the events of the device may be held back to be returned together
+        // with the events of other devices, 0 if they must be returned right away.
+        nsecs_t coalesceWindow;
+
+        // The time of the last event returned for the device, used to keep the event
+        // times of the device monotonic.
+        nsecs_t lastEventTime;
+
         Device(int fd, int32_t id, const String8& path, const InputDeviceIdentifier& identifier);
         ~Device();
 
@@ -390,6 +398,8 @@ private:
     status_t loadKeyMapLocked(Device* device);
 
     bool isExternalDeviceLocked(Device* device);
+    nsecs_t getCoalesceWindowLocked(Device* device);
+    nsecs_t correctEventTimeLocked(Device* device, nsecs_t when, bool overridden, nsecs_t now);
 
     int32_t getNextControllerNumberLocked(Device* device);
     void releaseControllerNumberLocked(Device* device);
@@ -420,6 +430,10 @@ private:
     bool mNeedToScanDevices;
     Vector<String8> mExcludedDevices;
 
+    // The coalescing window of the devices that don't specify one in their
+    // configuration file, from the ro.input.coalesce_window_ms property.
+    nsecs_t mDefaultCoalesceWindow;
+
     int mEpollFd;
     int mINotifyFd;
     int mWakeReadPipeFd;
@@ -95,6 +95,11 @@ static inline const char* toString(bool value) {
     return value ? "true" : "false";
 }
 
+template<typename T>
+inline static T min(const T& a, const T& b) {
+    return a < b ? a : b;
+}
+
 static inline int32_t getMotionEventActionPointerIndex(int32_t action) {
     return (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK)
             >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
@@ -204,6 +209,16 @@ InputDispatcher::InputDispatcher(const sp<InputDispatcherPolicyInterface>& polic
     mKeyRepeatState.lastKeyEntry = NULL;
 
     policy->getDispatcherConfiguration(&mConfig);
+
+    for (uint32_t i = 0; i < mConfig.publisherThreadCount; i++) {
+        sp<PublisherThread> thread = new PublisherThread(this);
+        status_t result = thread->run("InputPublisher", PRIORITY_URGENT_DISPLAY);
+        if (result) {
+            ALOGE("Could not start InputPublisher thread due to error %d.", result);
+            break;
+        }
+        mPublisherThreads.add(thread);
+    }
 }
 
 InputDispatcher::~InputDispatcher() {
@@ -218,6 +233,10 @@ InputDispatcher::~InputDispatcher() {
     while (mConnectionsByFd.size() != 0) {
         unregisterInputChannel(mConnectionsByFd.valueAt(0)->inputChannel);
     }
+
+    for (size_t i = 0; i < mPublisherThreads.size(); i++) {
+        mPublisherThreads[i]->quit();
+    }
 }
 
 void InputDispatcher::dispatchOnce() {
@@ -468,9 +487,11 @@ void InputDispatcher::addRecentEventLocked(EventEntry* entry) {
 sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayId,
         int32_t x, int32_t y) {
     // Traverse windows from front to back to find touched window.
-    size_t numWindows = mWindowHandles.size();
+    const uint16_t* windowIndices;
+    size_t numWindows;
+    mWindowHitIndex.getCandidates(displayId, x, y, &windowIndices, &numWindows);
     for (size_t i = 0; i < numWindows; i++) {
-        sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(i);
+        sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(windowIndices[i]);
         const InputWindowInfo* windowInfo = windowHandle->getInfo();
         if (windowInfo->displayId == displayId) {
             int32_t flags = windowInfo->layoutParamsFlags;
@@ -1208,9 +1229,11 @@ int32_t InputDispatcher::findTouchedWindowTargetsLocked(nsecs_t currentTime,
         bool isTouchModal = false;
 
         // Traverse windows from front to back to find touched window and outside targets.
-        size_t numWindows = mWindowHandles.size();
+        const uint16_t* windowIndices;
+        size_t numWindows;
+        mWindowHitIndex.getCandidates(displayId, x, y, &windowIndices, &numWindows);
         for (size_t i = 0; i < numWindows; i++) {
-            sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(i);
+            sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(windowIndices[i]);
             const InputWindowInfo* windowInfo = windowHandle->getInfo();
             if (windowInfo->displayId != displayId) {
                 continue; // wrong display
@@ -1932,79 +1955,44 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
             connection->getInputChannelName());
 #endif
 
+    if (!mPublisherThreads.isEmpty()) {
+        // Hand the events to the publisher thread of the connection.  They are moved
+        // to the wait queue right away, the thread writes them in the same order.
+        Vector<PublishRequest*> requests;
+        while (connection->status == Connection::STATUS_NORMAL
+                && !connection->outboundQueue.isEmpty()) {
+            DispatchEntry* dispatchEntry = connection->outboundQueue.head;
+            dispatchEntry->deliveryTime = currentTime;
+
+            PublishRequest* request = new PublishRequest();
+            if (!initializePublishRequest(dispatchEntry, request)) {
+                delete request;
+                break;
+            }
+            requests.add(request);
+
+            connection->outboundQueue.dequeue(dispatchEntry);
+            traceOutboundQueueLengthLocked(connection);
+            connection->waitQueue.enqueueAtTail(dispatchEntry);
+            traceWaitQueueLengthLocked(connection);
+        }
+        if (!requests.isEmpty()) {
+            getPublisherThreadLocked(connection)->enqueue(connection, requests);
+        }
+        return;
+    }
+
     while (connection->status == Connection::STATUS_NORMAL
             && !connection->outboundQueue.isEmpty()) {
         DispatchEntry* dispatchEntry = connection->outboundQueue.head;
         dispatchEntry->deliveryTime = currentTime;
 
         // Publish the event.
-        status_t status;
-        EventEntry* eventEntry = dispatchEntry->eventEntry;
-        switch (eventEntry->type) {
-        case EventEntry::TYPE_KEY: {
-            KeyEntry* keyEntry = static_cast<KeyEntry*>(eventEntry);
-
-            // Publish the key event.
-            status = connection->inputPublisher.publishKeyEvent(dispatchEntry->seq,
-                    keyEntry->deviceId, keyEntry->source,
-                    dispatchEntry->resolvedAction, dispatchEntry->resolvedFlags,
-                    keyEntry->keyCode, keyEntry->scanCode,
-                    keyEntry->metaState, keyEntry->repeatCount, keyEntry->downTime,
-                    keyEntry->eventTime);
-            break;
-        }
-
-        case EventEntry::TYPE_MOTION: {
-            MotionEntry* motionEntry = static_cast<MotionEntry*>(eventEntry);
-
-            PointerCoords scaledCoords[MAX_POINTERS];
-            const PointerCoords* usingCoords = motionEntry->pointerCoords;
-
-            // Set the X and Y offset depending on the input source.
-            float xOffset, yOffset, scaleFactor;
-            if ((motionEntry->source & AINPUT_SOURCE_CLASS_POINTER)
-                    && !(dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS)) {
-                scaleFactor = dispatchEntry->scaleFactor;
-                xOffset = dispatchEntry->xOffset * scaleFactor;
-                yOffset = dispatchEntry->yOffset * scaleFactor;
-                if (scaleFactor != 1.0f) {
-                    for (size_t i = 0; i < motionEntry->pointerCount; i++) {
-                        scaledCoords[i] = motionEntry->pointerCoords[i];
-                        scaledCoords[i].scale(scaleFactor);
-                    }
-                    usingCoords = scaledCoords;
-                }
-            } else {
-                xOffset = 0.0f;
-                yOffset = 0.0f;
-                scaleFactor = 1.0f;
-
-                // We don't want the dispatch target to know.
-                if (dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS) {
-                    for (size_t i = 0; i < motionEntry->pointerCount; i++) {
-                        scaledCoords[i].clear();
-                    }
-                    usingCoords = scaledCoords;
-                }
-            }
-
-            // Publish the motion event.
-            status = connection->inputPublisher.publishMotionEvent(dispatchEntry->seq,
-                    motionEntry->deviceId, motionEntry->source,
-                    dispatchEntry->resolvedAction, dispatchEntry->resolvedFlags,
-                    motionEntry->edgeFlags, motionEntry->metaState, motionEntry->buttonState,
-                    xOffset, yOffset,
-                    motionEntry->xPrecision, motionEntry->yPrecision,
-                    motionEntry->downTime, motionEntry->eventTime,
-                    motionEntry->pointerCount, motionEntry->pointerProperties,
-                    usingCoords);
-            break;
-        }
-
-        default:
-            ALOG_ASSERT(false);
+        PublishRequest request;
+        if (!initializePublishRequest(dispatchEntry, &request)) {
             return;
         }
+        status_t status = publish(connection->inputPublisher, request);
 
         // Check the result.
         if (status) {
@@ -2041,6 +2029,115 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
     }
 }
 
+bool InputDispatcher::initializePublishRequest(const DispatchEntry* dispatchEntry,
+        PublishRequest* outRequest) {
+    EventEntry* eventEntry = dispatchEntry->eventEntry;
+    outRequest->seq = dispatchEntry->seq;
+    outRequest->type = eventEntry->type;
+    outRequest->action = dispatchEntry->resolvedAction;
+    outRequest->flags = dispatchEntry->resolvedFlags;
+    outRequest->eventTime = eventEntry->eventTime;
+
+    switch (eventEntry->type) {
+    case EventEntry::TYPE_KEY: {
+        const KeyEntry* keyEntry = static_cast<const KeyEntry*>(eventEntry);
+        outRequest->deviceId = keyEntry->deviceId;
+        outRequest->source = keyEntry->source;
+        outRequest->metaState = keyEntry->metaState;
+        outRequest->downTime = keyEntry->downTime;
+        outRequest->keyCode = keyEntry->keyCode;
+        outRequest->scanCode = keyEntry->scanCode;
+        outRequest->repeatCount = keyEntry->repeatCount;
+        return true;
+    }
+
+    case EventEntry::TYPE_MOTION: {
+        const MotionEntry* motionEntry = static_cast<const MotionEntry*>(eventEntry);
+        outRequest->deviceId = motionEntry->deviceId;
+        outRequest->source = motionEntry->source;
+        outRequest->metaState = motionEntry->metaState;
+        outRequest->downTime = motionEntry->downTime;
+        outRequest->edgeFlags = motionEntry->edgeFlags;
+        outRequest->buttonState = motionEntry->buttonState;
+        outRequest->xPrecision = motionEntry->xPrecision;
+        outRequest->yPrecision = motionEntry->yPrecision;
+        outRequest->pointerCount = motionEntry->pointerCount;
+        for (uint32_t i = 0; i < motionEntry->pointerCount; i++) {
+            outRequest->pointerProperties[i].copyFrom(motionEntry->pointerProperties[i]);
+            outRequest->pointerCoords[i].copyFrom(motionEntry->pointerCoords[i]);
+        }
+
+        // Set the X and Y offset depending on the input source.
+        if ((motionEntry->source & AINPUT_SOURCE_CLASS_POINTER)
+                && !(dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS)) {
+            float scaleFactor = dispatchEntry->scaleFactor;
+            outRequest->xOffset = dispatchEntry->xOffset * scaleFactor;
+            outRequest->yOffset = dispatchEntry->yOffset * scaleFactor;
+            if (scaleFactor != 1.0f) {
+                for (uint32_t i = 0; i < motionEntry->pointerCount; i++) {
+                    outRequest->pointerCoords[i].scale(scaleFactor);
+                }
+            }
+        } else {
+            outRequest->xOffset = 0.0f;
+            outRequest->yOffset = 0.0f;
+
+            // We don't want the dispatch target to know.
+            if (dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS) {
+                for (uint32_t i = 0; i < motionEntry->pointerCount; i++) {
+                    outRequest->pointerCoords[i].clear();
+                }
+            }
+        }
+        return true;
+    }
+
+    default:
+        ALOG_ASSERT(false);
+        return false;
+    }
+}
+
+status_t InputDispatcher::publish(InputPublisher& publisher, const PublishRequest& request) {
+    if (request.type == EventEntry::TYPE_KEY) {
+        return publisher.publishKeyEvent(request.seq,
+                request.deviceId, request.source,
+                request.action, request.flags,
+                request.keyCode, request.scanCode,
+                request.metaState, request.repeatCount, request.downTime,
+                request.eventTime);
+    }
+    return publisher.publishMotionEvent(request.seq,
+            request.deviceId, request.source,
+            request.action, request.flags,
+            request.edgeFlags, request.metaState, request.buttonState,
+            request.xOffset, request.yOffset,
+            request.xPrecision, request.yPrecision,
+            request.downTime, request.eventTime,
+            request.pointerCount, request.pointerProperties,
+            request.pointerCoords);
+}
+
+sp<InputDispatcher::PublisherThread> InputDispatcher::getPublisherThreadLocked(
+        const sp<Connection>& connection) {
+    return mPublisherThreads[connection->inputChannel->getFd() % mPublisherThreads.size()];
+}
+
+void InputDispatcher::onPublishFailed(const sp<Connection>& connection, status_t status) {
+    { // acquire lock
+        AutoMutex _l(mLock);
+
+        if (connection->status == Connection::STATUS_NORMAL) {
+            ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
+                    "status=%d", connection->getInputChannelName(), status);
+            abortBrokenDispatchCycleLocked(now(), connection, true /*notify*/);
+        }
+    } // release lock
+
+    // Wake the dispatcher so that it runs the command that reports the broken channel.
+    mLooper->wake();
+}
+
 void InputDispatcher::finishDispatchCycleLocked(nsecs_t currentTime,
         const sp<Connection>& connection, uint32_t seq, bool handled) {
 #if DEBUG_DISPATCH_CYCLE
@@ -2049,6 +2146,9 @@ void InputDispatcher::finishDispatchCycleLocked(nsecs_t currentTime,
 #endif
 
     connection->inputPublisherBlocked = false;
+    if (!mPublisherThreads.isEmpty()) {
+        getPublisherThreadLocked(connection)->unblock(connection);
+    }
 
     if (connection->status == Connection::STATUS_BROKEN
             || connection->status == Connection::STATUS_ZOMBIE) {
@@ -2067,6 +2167,9 @@ void InputDispatcher::abortBrokenDispatchCycleLocked(nsecs_t currentTime,
 #endif
 
     // Clear the dispatch queues.
+    if (!mPublisherThreads.isEmpty()) {
+        getPublisherThreadLocked(connection)->removeConnection(connection);
+    }
     drainDispatchQueueLocked(&connection->outboundQueue);
     traceOutboundQueueLengthLocked(connection);
     drainDispatchQueueLocked(&connection->waitQueue);
@@ -2824,6 +2927,8 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
             mLastHoverWindowHandle = NULL;
         }
 
+        mWindowHitIndex.rebuild(mWindowHandles);
+
         if (mFocusedWindowHandle != newFocusedWindowHandle) {
             if (mFocusedWindowHandle != NULL) {
 #if DEBUG_FOCUS
@@ -3243,6 +3348,13 @@ void InputDispatcher::dumpDispatchStateLocked(String8& dump) {
         dump.append(INDENT "Connections: <none>\n");
     }
 
+    if (!mPublisherThreads.isEmpty()) {
+        dump.appendFormat(INDENT "PublisherThreads: %u\n", mPublisherThreads.size());
+        for (size_t i = 0; i < mPublisherThreads.size(); i++) {
+            mPublisherThreads[i]->dump(dump);
+        }
+    }
+
     if (isAppSwitchPendingLocked()) {
         dump.appendFormat(INDENT "AppSwitch: pending, due in %0.1fms\n",
                 (mAppSwitchDueTime - now()) / 1000000.0);
@@ -3273,6 +3385,15 @@ status_t InputDispatcher::registerInputChannel(const sp<InputChannel>& inputChan
             return BAD_VALUE;
         }
 
+        if (mConfig.inputChannelRingCapacity) {
+            status_t result = inputChannel->openSharedRing(mConfig.inputChannelRingCapacity);
+            if (result && result != INVALID_OPERATION) {
+                ALOGW("channel '%s' ~ Could not open a shared ring, events will be sent "
+                        "through the socket, status=%d", inputChannel->getName().string(),
+                        result);
+            }
+        }
+
         sp<Connection> connection = new Connection(inputChannel, inputWindowHandle, monitor);
 
         int fd = inputChannel->getFd();
@@ -4453,6 +4574,381 @@ bool InputDispatcher::TouchState::isSlippery() const {
 }
 
 
+// --- InputDispatcher::WindowHitIndex ---
+
+enum WindowHitArea {
+    // No touch affects the window.
+    WINDOW_HIT_NONE,
+    // Only the touches in the touchable region of the window affect it.
+    WINDOW_HIT_TOUCHABLE_REGION,
+    // Any touch on the display affects the window.
+    WINDOW_HIT_ANYWHERE,
+};
+
+// Mirrors the checks made by findTouchedWindowAtLocked and findTouchedWindowTargetsLocked.
+static WindowHitArea getWindowHitArea(const InputWindowInfo* windowInfo) {
+    if (windowInfo->layoutParamsPrivateFlags & InputWindowInfo::PRIVATE_FLAG_SYSTEM_ERROR) {
+        return WINDOW_HIT_ANYWHERE;
+    }
+    if (!windowInfo->visible) {
+        return WINDOW_HIT_NONE;
+    }
+
+    int32_t flags = windowInfo->layoutParamsFlags;
+    if (flags & InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH) {
+        return WINDOW_HIT_ANYWHERE;
+    }
+    if (flags & InputWindowInfo::FLAG_NOT_TOUCHABLE) {
+        return WINDOW_HIT_NONE;
+    }
+    bool isTouchModal = (flags & (InputWindowInfo::FLAG_NOT_FOCUSABLE
+            | InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
+    if (isTouchModal) {
+        return WINDOW_HIT_ANYWHERE;
+    }
+    return windowInfo->touchableRegion.isEmpty()
+            ? WINDOW_HIT_NONE : WINDOW_HIT_TOUCHABLE_REGION;
+}
+
+InputDispatcher::WindowHitIndex::WindowHitIndex() {
+}
+
+void InputDispatcher::WindowHitIndex::rebuild(
+        const Vector<sp<InputWindowHandle> >& windowHandles) {
+    mGrids.clear();
+
+    size_t numWindows = windowHandles.size();
+    if (numWindows > 0xffff) {
+        ALOGW("Too many windows, only the first %d are touchable.", 0xffff);
+        numWindows = 0xffff;
+    }
+
+    for (size_t i = 0; i < numWindows; i++) {
+        int32_t displayId = windowHandles.itemAt(i)->getInfo()->displayId;
+        bool found = false;
+        for (size_t j = 0; j < mGrids.size(); j++) {
+            if (mGrids[j].displayId == displayId) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            Grid grid;
+            grid.displayId = displayId;
+            mGrids.add(grid);
+        }
+    }
+
+    for (size_t g = 0; g < mGrids.size(); g++) {
+        Grid& grid = mGrids.editItemAt(g);
+
+        // Cover the touchable regions of the display with the grid.
+        SkIRect bounds;
+        bounds.setEmpty();
+        for (size_t i = 0; i < numWindows; i++) {
+            const InputWindowInfo* windowInfo = windowHandles.itemAt(i)->getInfo();
+            if (windowInfo->displayId == grid.displayId
+                    && getWindowHitArea(windowInfo) == WINDOW_HIT_TOUCHABLE_REGION) {
+                bounds.join(windowInfo->touchableRegion.getBounds());
+            }
+        }
+
+        grid.left = bounds.fLeft;
+        grid.top = bounds.fTop;
+        if (bounds.isEmpty()) {
+            grid.columns = 0;
+            grid.rows = 0;
+            grid.cellWidth = MIN_CELL_SIZE;
+            grid.cellHeight = MIN_CELL_SIZE;
+        } else {
+            int32_t width = bounds.width();
+            int32_t height = bounds.height();
+            grid.columns = min(int32_t(MAX_CELLS_PER_SIDE),
+                    (width + MIN_CELL_SIZE - 1) / MIN_CELL_SIZE);
+            grid.rows = min(int32_t(MAX_CELLS_PER_SIDE),
+                    (height + MIN_CELL_SIZE - 1) / MIN_CELL_SIZE);
+            grid.cellWidth = (width + grid.columns - 1) / grid.columns;
+            grid.cellHeight = (height + grid.rows - 1) / grid.rows;
+        }
+
+        // Count the windows of each cell, then fill in the cells in window order.
+        size_t numCells = grid.columns * grid.rows;
+        grid.cellStarts.insertAt(size_t(0), 0, numCells + 1);
+        for (int pass = 0; pass < 2; pass++) {
+            Vector<size_t> cellEnds;
+            if (pass) {
+                for (size_t c = 0; c < numCells; c++) {
+                    grid.cellStarts.editItemAt(c + 1) += grid.cellStarts[c];
+                }
+                grid.cellIndices.insertAt(0, 0, grid.cellStarts[numCells]);
+                cellEnds = grid.cellStarts;
+            }
+
+            for (size_t i = 0; i < numWindows; i++) {
+                const InputWindowInfo* windowInfo = windowHandles.itemAt(i)->getInfo();
+                if (windowInfo->displayId != grid.displayId) {
+                    continue;
+                }
+
+                int32_t left, top, right, bottom;
+                switch (getWindowHitArea(windowInfo)) {
+                case WINDOW_HIT_ANYWHERE:
+                    if (pass) {
+                        grid.anywhereIndices.add(uint16_t(i));
+                    }
+                    left = 0;
+                    top = 0;
+                    right = grid.columns - 1;
+                    bottom = grid.rows - 1;
+                    break;
+                case WINDOW_HIT_TOUCHABLE_REGION: {
+                    const SkIRect& windowBounds = windowInfo->touchableRegion.getBounds();
+                    left = (windowBounds.fLeft - grid.left) / grid.cellWidth;
+                    top = (windowBounds.fTop - grid.top) / grid.cellHeight;
+                    right = min(grid.columns - 1,
+                            (windowBounds.fRight - 1 - grid.left) / grid.cellWidth);
+                    bottom = min(grid.rows - 1,
+                            (windowBounds.fBottom - 1 - grid.top) / grid.cellHeight);
+                    break;
+                }
+                default:
+                    continue;
+                }
+
+                for (int32_t row = top; row <= bottom; row++) {
+                    for (int32_t column = left; column <= right; column++) {
+                        size_t c = row * grid.columns + column;
+                        if (pass) {
+                            grid.cellIndices.editItemAt(cellEnds[c]) = uint16_t(i);
+                            cellEnds.editItemAt(c) += 1;
+                        } else {
+                            grid.cellStarts.editItemAt(c + 1) += 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void InputDispatcher::WindowHitIndex::getCandidates(int32_t displayId, int32_t x, int32_t y,
+        const uint16_t** outIndices, size_t* outCount) const {
+    for (size_t g = 0; g < mGrids.size(); g++) {
+        const Grid& grid = mGrids[g];
+        if (grid.displayId != displayId) {
+            continue;
+        }
+
+        if (x >= grid.left && y >= grid.top) {
+            int32_t column = (x - grid.left) / grid.cellWidth;
+            int32_t row = (y - grid.top) / grid.cellHeight;
+            if (column < grid.columns && row < grid.rows) {
+                size_t c = row * grid.columns + column;
+                *outIndices = grid.cellIndices.array() + grid.cellStarts[c];
+                *outCount = grid.cellStarts[c + 1] - grid.cellStarts[c];
+                return;
+            }
+        }
+        *outIndices = grid.anywhereIndices.array();
+        *outCount = grid.anywhereIndices.size();
+        return;
+    }
+    *outIndices = NULL;
+    *outCount = 0;
+}
+
+
+// --- InputDispatcher::PublisherThread ---
+
+InputDispatcher::PublisherThread::PublisherThread(InputDispatcher* dispatcher) :
+        Thread(/*canCallJava*/ false), mDispatcher(dispatcher), mNextPending(0) {
+}
+
+InputDispatcher::PublisherThread::~PublisherThread() {
+    for (size_t i = 0; i < mPending.size(); i++) {
+        const Vector<PublishRequest*>& requests = mPending[i].requests;
+        for (size_t j = 0; j < requests.size(); j++) {
+            delete requests[j];
+        }
+    }
+}
+
+void InputDispatcher::PublisherThread::enqueue(const sp<Connection>& connection,
+        const Vector<PublishRequest*>& requests) {
+    AutoMutex _l(mLock);
+
+    ssize_t index = getPendingIndexLocked(connection);
+    if (index < 0) {
+        Pending pending;
+        pending.connection = connection;
+        pending.blocked = false;
+        pending.publishing = false;
+        pending.unblockCount = 0;
+        index = mPending.add(pending);
+    }
+    mPending.editItemAt(index).requests.appendVector(requests);
+    mCondition.signal();
+}
+
+void InputDispatcher::PublisherThread::unblock(const sp<Connection>& connection) {
+    AutoMutex _l(mLock);
+
+    ssize_t index = getPendingIndexLocked(connection);
+    if (index >= 0) {
+        Pending& pending = mPending.editItemAt(index);
+        pending.blocked = false;
+        pending.unblockCount += 1;
+        mCondition.signal();
+    }
+}
+
+void InputDispatcher::PublisherThread::removeConnection(const sp<Connection>& connection) {
+    AutoMutex _l(mLock);
+
+    // If the requests are being written, the thread drops what is left of them
+    // once it finds the connection gone.
+    ssize_t index = getPendingIndexLocked(connection);
+    if (index >= 0) {
+        const Vector<PublishRequest*>& requests = mPending[index].requests;
+        for (size_t i = 0; i < requests.size(); i++) {
+            delete requests[i];
+        }
+        mPending.removeAt(index);
+    }
+}
+
+void InputDispatcher::PublisherThread::quit() {
+    requestExit();
+    { // acquire lock
+        AutoMutex _l(mLock);
+        mCondition.signal();
+    } // release lock
+    join();
+}
+
+void InputDispatcher::PublisherThread::dump(String8& dump) {
+    AutoMutex _l(mLock);
+
+    dump.appendFormat(INDENT2 "PublisherThread: pendingConnections=%u\n", mPending.size());
+    for (size_t i = 0; i < mPending.size(); i++) {
+        const Pending& pending = mPending[i];
+        dump.appendFormat(INDENT3 "channelName='%s', pendingRequests=%u, blocked=%s\n",
+                pending.connection->getInputChannelName(), pending.requests.size(),
+                toString(pending.blocked));
+    }
+}
+
+ssize_t InputDispatcher::PublisherThread::getPendingIndexLocked(
+        const sp<Connection>& connection) const {
+    for (size_t i = 0; i < mPending.size(); i++) {
+        if (mPending[i].connection == connection) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ssize_t InputDispatcher::PublisherThread::getReadyIndexLocked() const {
+    // Take turns so that a connection that keeps receiving events does not hold
+    // back the others.
+    size_t count = mPending.size();
+    for (size_t i = 0; i < count; i++) {
+        size_t index = (mNextPending + i) % count;
+        const Pending& pending = mPending[index];
+        if (!pending.blocked && !pending.publishing && !pending.requests.isEmpty()) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+bool InputDispatcher::PublisherThread::threadLoop() {
+    sp<Connection> connection;
+    Vector<PublishRequest*> requests;
+    uint32_t unblockCount;
+    { // acquire lock
+        AutoMutex _l(mLock);
+
+        ssize_t index = getReadyIndexLocked();
+        while (index < 0) {
+            if (exitPending()) {
+                return false;
+            }
+            mCondition.wait(mLock);
+            index = getReadyIndexLocked();
+        }
+
+        Pending& pending = mPending.editItemAt(index);
+        connection = pending.connection;
+        requests = pending.requests;
+        pending.requests.clear();
+        pending.publishing = true;
+        unblockCount = pending.unblockCount;
+        mNextPending = index + 1;
+    } // release lock
+
+    // Write the events without holding any lock.  The finished signals are read
+    // by the dispatcher thread, the socket can be used from both threads at once.
+    status_t status = OK;
+    size_t published = 0;
+    while (published < requests.size()) {
+        status = publish(connection->inputPublisher, *requests[published]);
+        if (status) {
+            break;
+        }
+        delete requests[published];
+        published += 1;
+    }
+
+    bool failed = false;
+    { // acquire lock
+        AutoMutex _l(mLock);
+
+        ssize_t index = getPendingIndexLocked(connection);
+        if (index < 0) {
+            // The connection was removed while its events were being written.
+            for (size_t i = published; i < requests.size(); i++) {
+                delete requests[i];
+            }
+        } else if (status && status != WOULD_BLOCK) {
+            for (size_t i = published; i < requests.size(); i++) {
+                delete requests[i];
+            }
+            const Vector<PublishRequest*>& queued = mPending[index].requests;
+            for (size_t i = 0; i < queued.size(); i++) {
+                delete queued[i];
+            }
+            mPending.removeAt(index);
+            failed = true;
+        } else {
+            // Put back the events that did not fit in the socket ahead of those
+            // enqueued in the meantime.
+            Pending& pending = mPending.editItemAt(index);
+            pending.publishing = false;
+            if (published < requests.size()) {
+                requests.removeItemsAt(0, published);
+                pending.requests.insertVectorAt(requests, 0);
+                // Unless the application finished some events while they were written,
+                // wait for it to catch up before trying again.
+                pending.blocked = pending.unblockCount == unblockCount;
+#if DEBUG_DISPATCH_CYCLE
+                ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
+                        "waiting for the application to catch up",
+                        connection->getInputChannelName());
+#endif
+            } else if (pending.requests.isEmpty()) {
+                mPending.removeAt(index);
+            }
+        }
+    } // release lock
+
+    if (failed) {
+        mDispatcher->onPublishFailed(connection, status);
+    }
+    return true;
+}
+
+
 // --- InputDispatcherThread ---
 
 InputDispatcherThread::InputDispatcherThread(const sp<InputDispatcherInterface>& dispatcher) :
@@ -175,9 +175,19 @@ struct InputDispatcherConfiguration {
     // The key repeat inter-key delay.
     nsecs_t keyRepeatDelay;
 
+    // The number of threads that write the events to the input channels.
+    // If 0, the events are written by the dispatcher thread.
+    uint32_t publisherThreadCount;
+
+    // The number of events the shared ring of an input channel has room for.
+    // If 0, the events are sent through the socket of the channel.
+    uint32_t inputChannelRingCapacity;
+
     InputDispatcherConfiguration() :
             keyRepeatTimeout(500 * 1000000LL),
-            keyRepeatDelay(50 * 1000000LL) { }
+            keyRepeatDelay(50 * 1000000LL),
+            publisherThreadCount(0),
+            inputChannelRingCapacity(0) { }
 };
 
 
@@ -828,6 +838,81 @@ private:
         DispatchEntry* findWaitQueueEntry(uint32_t seq);
     };
 
+    // The arguments of one InputPublisher call, copied out of a dispatch entry so
+    // that the event can be published without holding the dispatcher lock.
+    struct PublishRequest {
+        uint32_t seq;
+        int32_t type; // EventEntry::TYPE_KEY or EventEntry::TYPE_MOTION
+        int32_t deviceId;
+        int32_t source;
+        int32_t action;
+        int32_t flags;
+        int32_t metaState;
+        nsecs_t downTime;
+        nsecs_t eventTime;
+
+        // key events
+        int32_t keyCode;
+        int32_t scanCode;
+        int32_t repeatCount;
+
+        // motion events
+        int32_t edgeFlags;
+        int32_t buttonState;
+        float xOffset;
+        float yOffset;
+        float xPrecision;
+        float yPrecision;
+        uint32_t pointerCount;
+        PointerProperties pointerProperties[MAX_POINTERS];
+        PointerCoords pointerCoords[MAX_POINTERS];
+    };
+
+    /* Publishes the events of the connections assigned to it.
+     *
+     * A connection is always assigned to the same thread, so its events are written
+     * in the order they were dispatched.  When the socket of a connection is full,
+     * only the events of that connection wait for the application to catch up. */
+    class PublisherThread : public Thread {
+    public:
+        explicit PublisherThread(InputDispatcher* dispatcher);
+        virtual ~PublisherThread();
+
+        // Takes ownership of the requests.
+        void enqueue(const sp<Connection>& connection,
+                const Vector<PublishRequest*>& requests);
+
+        // Retries the requests of a connection whose socket was full.
+        void unblock(const sp<Connection>& connection);
+
+        // Drops the requests of a connection that is broken or unregistered.
+        void removeConnection(const sp<Connection>& connection);
+
+        void quit();
+        void dump(String8& dump);
+
+    private:
+        struct Pending {
+            sp<Connection> connection;
+            Vector<PublishRequest*> requests;
+            bool blocked; // the socket was full when the requests were last written
+            bool publishing; // the requests are being written by the thread
+            uint32_t unblockCount;
+        };
+
+        virtual bool threadLoop();
+
+        ssize_t getPendingIndexLocked(const sp<Connection>& connection) const;
+        ssize_t getReadyIndexLocked() const;
+
+        InputDispatcher* mDispatcher;
+
+        Mutex mLock;
+        Condition mCondition;
+        Vector<Pending> mPending;
+        size_t mNextPending;
+    };
+
     enum DropReason {
         DROP_REASON_NOT_DROPPED = 0,
         DROP_REASON_POLICY = 1,
@@ -846,6 +931,9 @@ private:
 
     sp<Looper> mLooper;
 
+    // Empty if the events are published by the dispatcher thread.
+    Vector<sp<PublisherThread> > mPublisherThreads;
+
     EventEntry* mPendingEvent;
     Queue<EventEntry> mInboundQueue;
     Queue<EventEntry> mRecentQueue;
@@ -927,6 +1015,57 @@ private:
 
     Vector<sp<InputWindowHandle> > mWindowHandles;
 
+    /* Spatial index of the windows used to find the window touched at a point.
+     *
+     * Each display is split in a grid of cells.  A cell lists, front to back, the
+     * windows that can be affected by a touch in the cell: those whose touchable
+     * region overlaps the cell, and those that are affected by any touch on the
+     * display (touch modal windows, windows watching outside touches and system error
+     * windows).  Scanning the windows of a cell gives the same result as scanning
+     * all of the windows. */
+    class WindowHitIndex {
+    public:
+        WindowHitIndex();
+
+        // Rebuilds the index, must be called whenever the windows change.
+        void rebuild(const Vector<sp<InputWindowHandle> >& windowHandles);
+
+        // Returns the indices of the windows that can be affected by a touch at
+        // (x, y) on the display, in their order in the windows the index was built from.
+        void getCandidates(int32_t displayId, int32_t x, int32_t y,
+                const uint16_t** outIndices, size_t* outCount) const;
+
+    private:
+        // The cells are at least MIN_CELL_SIZE pixels wide and high, and a display
+        // has at most MAX_CELLS_PER_SIDE x MAX_CELLS_PER_SIDE cells.
+        enum {
+            MIN_CELL_SIZE = 32,
+            MAX_CELLS_PER_SIDE = 16,
+        };
+
+        struct Grid {
+            int32_t displayId;
+            int32_t left;
+            int32_t top;
+            int32_t cellWidth;
+            int32_t cellHeight;
+            int32_t columns;
+            int32_t rows;
+
+            // The windows affected by touches outside of the grid.
+            Vector<uint16_t> anywhereIndices;
+
+            // The windows of cell c are cellIndices[cellStarts[c]] up to
+            // cellIndices[cellStarts[c + 1]] excluded.
+            Vector<size_t> cellStarts;
+            Vector<uint16_t> cellIndices;
+        };
+
+        Vector<Grid> mGrids;
+    };
+
+    WindowHitIndex mWindowHitIndex;
+
     sp<InputWindowHandle> getWindowHandleLocked(const sp<InputChannel>& inputChannel) const;
     bool hasWindowHandleLocked(const sp<InputWindowHandle>& windowHandle) const;
 
@@ -1047,6 +1186,11 @@ private:
     void abortBrokenDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection,
             bool notify);
     void drainDispatchQueueLocked(Queue<DispatchEntry>* queue);
+    static bool initializePublishRequest(const DispatchEntry* dispatchEntry,
+            PublishRequest* outRequest);
+    static status_t publish(InputPublisher& publisher, const PublishRequest& request);
+    sp<PublisherThread> getPublisherThreadLocked(const sp<Connection>& connection);
+    void onPublishFailed(const sp<Connection>& connection, status_t status);
     void releaseDispatchEntryLocked(DispatchEntry* dispatchEntry);
     static int handleReceiveCallback(int fd, int events, void* data);
 
@@ -73,7 +73,7 @@ PointerController::PointerController(const sp<PointerControllerPolicyInterface>&
     mLocked.pointerX = 0;
     mLocked.pointerY = 0;
     mLocked.pointerAlpha = 0.0f; // pointer is initially faded
-    mLocked.pointerSprite = mSpriteController->createSprite();
+    mLocked.pointerSprite = mSpriteController->createCursorSprite();
     mLocked.pointerIconChanged = false;
 
     mLocked.buttonState = 0;
@@ -53,7 +53,11 @@ SpriteController::~SpriteController() {
 }
 
 sp<Sprite> SpriteController::createSprite() {
-    return new SpriteImpl(this);
+    return new SpriteImpl(this, false);
+}
+
+sp<Sprite> SpriteController::createCursorSprite() {
+    return new SpriteImpl(this, true);
 }
 
 void SpriteController::openTransaction() {
@@ -137,8 +141,10 @@ void SpriteController::doUpdateSprites() {
             update.state.surfaceHeight = update.state.icon.bitmap.height();
             update.state.surfaceDrawn = false;
             update.state.surfaceVisible = false;
+            update.state.surfaceGenerationId = 0;
             update.state.surfaceControl = obtainSurface(
-                    update.state.surfaceWidth, update.state.surfaceHeight);
+                    update.state.surfaceWidth, update.state.surfaceHeight,
+                    update.state.cursor);
             if (update.state.surfaceControl != NULL) {
                 update.surfaceChanged = surfaceChanged = true;
             }
@@ -187,11 +193,13 @@ void SpriteController::doUpdateSprites() {
         SurfaceComposerClient::closeGlobalTransaction();
     }
 
-    // Redraw sprites if needed.
+    // Redraw sprites if needed.  A surface that still holds the pixels of the new icon,
+    // such as a recycled spot sprite that is given the same icon again, is not redrawn.
     for (size_t i = 0; i < numSprites; i++) {
         SpriteUpdate& update = updates.editItemAt(i);
 
-        if ((update.state.dirty & DIRTY_BITMAP) && update.state.surfaceDrawn) {
+        if ((update.state.dirty & DIRTY_BITMAP) && update.state.surfaceDrawn
+                && update.state.surfaceGenerationId != update.state.iconGenerationId) {
             update.state.surfaceDrawn = false;
             update.surfaceChanged = surfaceChanged = true;
         }
@@ -232,6 +240,7 @@ void SpriteController::doUpdateSprites() {
                     ALOGE("Error %d unlocking and posting sprite surface after drawing.", status);
                 } else {
                     update.state.surfaceDrawn = true;
+                    update.state.surfaceGenerationId = update.state.iconGenerationId;
                     update.surfaceChanged = surfaceChanged = true;
                 }
             }
@@ -247,6 +256,24 @@ void SpriteController::doUpdateSprites() {
                 && update.state.surfaceDrawn;
         bool becomingVisible = wantSurfaceVisibleAndDrawn && !update.state.surfaceVisible;
         bool becomingHidden = !wantSurfaceVisibleAndDrawn && update.state.surfaceVisible;
+
+        // Move visible cursor surfaces right away rather than in the global transaction.
+        // Position changes that come with other changes, such as a new hotspot, still
+        // go through the transaction so that they are applied together.
+        if (update.state.cursor && update.state.surfaceControl != NULL
+                && wantSurfaceVisibleAndDrawn && !becomingVisible
+                && (update.state.dirty & DIRTY_POSITION)
+                && !(update.state.dirty & (DIRTY_HOTSPOT | DIRTY_TRANSFORMATION_MATRIX))) {
+            status_t status = update.state.surfaceControl->setCursorPosition(
+                    update.state.positionX - update.state.icon.hotSpotX,
+                    update.state.positionY - update.state.icon.hotSpotY);
+            if (status) {
+                ALOGE("Error %d setting cursor surface position.", status);
+            } else {
+                update.state.dirty &= ~DIRTY_POSITION;
+            }
+        }
+
         if (update.state.surfaceControl != NULL && (becomingVisible || becomingHidden
                 || (wantSurfaceVisibleAndDrawn && (update.state.dirty & (DIRTY_ALPHA
                         | DIRTY_POSITION | DIRTY_TRANSFORMATION_MATRIX | DIRTY_LAYER
@@ -332,7 +359,8 @@ void SpriteController::doUpdateSprites() {
             if (update.surfaceChanged) {
                 update.sprite->setSurfaceLocked(update.state.surfaceControl,
                         update.state.surfaceWidth, update.state.surfaceHeight,
-                        update.state.surfaceDrawn, update.state.surfaceVisible);
+                        update.state.surfaceDrawn, update.state.surfaceVisible,
+                        update.state.surfaceGenerationId);
             }
         }
     } // release lock
@@ -366,12 +394,17 @@ void SpriteController::ensureSurfaceComposerClient() {
     }
 }
 
-sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height) {
+sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height,
+        bool cursor) {
     ensureSurfaceComposerClient();
 
+    uint32_t flags = ISurfaceComposerClient::eHidden;
+    if (cursor) {
+        flags |= ISurfaceComposerClient::eCursorWindow;
+    }
     sp<SurfaceControl> surfaceControl = mSurfaceComposerClient->createSurface(
-            String8("Sprite"), width, height, PIXEL_FORMAT_RGBA_8888,
-            ISurfaceComposerClient::eHidden);
+            String8(cursor ? "Cursor" : "Sprite"), width, height, PIXEL_FORMAT_RGBA_8888,
+            flags);
     if (surfaceControl == NULL || !surfaceControl->isValid()) {
         ALOGE("Error creating sprite surface.");
         return NULL;
@@ -382,8 +415,10 @@ sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height
 
 // --- SpriteController::SpriteImpl ---
 
-SpriteController::SpriteImpl::SpriteImpl(const sp<SpriteController> controller) :
+SpriteController::SpriteImpl::SpriteImpl(const sp<SpriteController> controller,
+        bool cursor) :
         mController(controller) {
+    mLocked.state.cursor = cursor;
 }
 
 SpriteController::SpriteImpl::~SpriteImpl() {
@@ -402,7 +437,15 @@ void SpriteController::SpriteImpl::setIcon(const SpriteIcon& icon) {
 
     uint32_t dirty;
     if (icon.isValid()) {
+        if (mLocked.state.icon.isValid()
+                && mLocked.state.iconGenerationId == icon.bitmap.getGenerationID()
+                && mLocked.state.icon.hotSpotX == icon.hotSpotX
+                && mLocked.state.icon.hotSpotY == icon.hotSpotY) {
+            return; // same icon as before so nothing to do
+        }
+
         icon.bitmap.copyTo(&mLocked.state.icon.bitmap, SkBitmap::kARGB_8888_Config);
+        mLocked.state.iconGenerationId = icon.bitmap.getGenerationID();
 
         if (!mLocked.state.icon.isValid()
                 || mLocked.state.icon.hotSpotX != icon.hotSpotX
@@ -145,6 +145,11 @@ public:
     /* Creates a new sprite, initially invisible. */
     sp<Sprite> createSprite();
 
+    /* Creates a new sprite for the mouse pointer, initially invisible.
+     * Its surface is a cursor surface, which is moved without a SurfaceFlinger
+     * transaction so that pointer motion does not cost a transaction per event. */
+    sp<Sprite> createCursorSprite();
+
     /* Opens or closes a transaction to perform a batch of sprite updates as part of
      * a single operation such as setPosition and setAlpha.  It is not necessary to
      * open a transaction when updating a single property.
@@ -176,14 +181,18 @@ private:
      * Note that the SkBitmap holds a reference to a shared (and immutable) pixel ref. */
     struct SpriteState {
         inline SpriteState() :
-                dirty(0), visible(false),
+                dirty(0), cursor(false), iconGenerationId(0), visible(false),
                 positionX(0), positionY(0), layer(0), alpha(1.0f),
-                surfaceWidth(0), surfaceHeight(0), surfaceDrawn(false), surfaceVisible(false) {
+                surfaceWidth(0), surfaceHeight(0), surfaceDrawn(false), surfaceVisible(false),
+                surfaceGenerationId(0) {
         }
 
         uint32_t dirty;
+        bool cursor;
 
         SpriteIcon icon;
+        // generation id of the bitmap the icon was copied from
+        uint32_t iconGenerationId;
         bool visible;
         float positionX;
         float positionY;
@@ -196,6 +205,8 @@ private:
         int32_t surfaceHeight;
         bool surfaceDrawn;
         bool surfaceVisible;
+        // generation id of the icon bitmap last drawn into the surface
+        uint32_t surfaceGenerationId;
 
         inline bool wantSurfaceVisible() const {
             return visible && alpha > 0.0f && icon.isValid();
@@ -214,7 +225,7 @@ private:
         virtual ~SpriteImpl();
 
     public:
-        SpriteImpl(const sp<SpriteController> controller);
+        SpriteImpl(const sp<SpriteController> controller, bool cursor);
 
         virtual void setIcon(const SpriteIcon& icon);
         virtual void setVisible(bool visible);
@@ -232,12 +243,14 @@ private:
         }
 
         inline void setSurfaceLocked(const sp<SurfaceControl>& surfaceControl,
-                int32_t width, int32_t height, bool drawn, bool visible) {
+                int32_t width, int32_t height, bool drawn, bool visible,
+                uint32_t generationId) {
             mLocked.state.surfaceControl = surfaceControl;
             mLocked.state.surfaceWidth = width;
             mLocked.state.surfaceHeight = height;
             mLocked.state.surfaceDrawn = drawn;
             mLocked.state.surfaceVisible = visible;
+            mLocked.state.surfaceGenerationId = generationId;
         }
 
     private:
@@ -285,7 +298,7 @@ private:
     void doDisposeSurfaces();
 
     void ensureSurfaceComposerClient();
-    sp<SurfaceControl> obtainSurface(int32_t width, int32_t height);
+    sp<SurfaceControl> obtainSurface(int32_t width, int32_t height, bool cursor);
 };
 
 } // namespace android
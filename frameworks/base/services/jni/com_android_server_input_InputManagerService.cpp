@@ -31,6 +31,8 @@
 #include <android_runtime/AndroidRuntime.h>
 #include <android_runtime/Log.h>
 
+#include <cutils/properties.h>
+
 #include <utils/Log.h>
 #include <utils/Looper.h>
 #include <utils/threads.h>
@@ -615,6 +617,14 @@ void NativeInputManager::getDispatcherConfiguration(InputDispatcherConfiguration
     if (!checkAndClearExceptionFromCallback(env, "getKeyRepeatDelay")) {
         outConfig->keyRepeatDelay = milliseconds_to_nanoseconds(keyRepeatDelay);
     }
+
+    char publisherThreads[PROPERTY_VALUE_MAX];
+    property_get("ro.input.publisher_threads", publisherThreads, "0");
+    outConfig->publisherThreadCount = atoi(publisherThreads);
+
+    char ringCapacity[PROPERTY_VALUE_MAX];
+    property_get("ro.input.channel_ring_capacity", ringCapacity, "0");
+    outConfig->inputChannelRingCapacity = atoi(ringCapacity);
 }
 
 bool NativeInputManager::isKeyRepeatEnabled() {
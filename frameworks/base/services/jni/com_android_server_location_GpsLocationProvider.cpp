@@ -25,6 +25,7 @@
 #include "hardware_legacy/power.h"
 #include "utils/Log.h"
 #include "utils/misc.h"
+#include "utils/Timers.h"
 #include "android_runtime/AndroidRuntime.h"
 #include "android_runtime/Log.h"
 
@@ -64,6 +65,18 @@ static GpsSvStatus  sGpsSvStatus;
 static const char* sNmeaString;
 static int sNmeaStringLength;
 
+// While the engine is producing fixes, satellite status is held here and
+// delivered together with the next fix, so Java sees one status per fix no
+// matter how often the HAL reports it.
+static GpsSvStatus sPendingSvStatus;
+static bool sSvStatusPending = false;
+// time of the last fix, 0 when there is no fix
+static nsecs_t sLastFixTime = 0;
+
+// Satellite status is delivered right away if there was no fix in this long,
+// so it keeps updating while the engine is searching.
+#define SV_STATUS_HOLD_TIME ms2ns(2000)
+
 #define WAKE_LOCK_NAME  "GPS"
 
 namespace android {
@@ -76,30 +89,74 @@ static void checkAndClearExceptionFromCallback(JNIEnv* env, const char* methodNa
     }
 }
 
+static bool sv_status_equals(const GpsSvStatus& a, const GpsSvStatus& b)
+{
+    if (a.num_svs != b.num_svs || a.ephemeris_mask != b.ephemeris_mask
+            || a.almanac_mask != b.almanac_mask || a.used_in_fix_mask != b.used_in_fix_mask)
+        return false;
+    for (int i = 0; i < a.num_svs; i++) {
+        const GpsSvInfo& sa = a.sv_list[i];
+        const GpsSvInfo& sb = b.sv_list[i];
+        if (sa.prn != sb.prn || sa.snr != sb.snr || sa.elevation != sb.elevation
+                || sa.azimuth != sb.azimuth)
+            return false;
+    }
+    return true;
+}
+
+static void deliver_sv_status(JNIEnv* env, const GpsSvStatus& sv_status)
+{
+    sSvStatusPending = false;
+    // Java only repaints the satellite view, skip statuses that didn't change
+    if (sv_status_equals(sv_status, sGpsSvStatus))
+        return;
+    memcpy(&sGpsSvStatus, &sv_status, sizeof(sGpsSvStatus));
+    env->CallVoidMethod(mCallbacksObj, method_reportSvStatus);
+    checkAndClearExceptionFromCallback(env, "sv_status_callback");
+}
+
+static void flush_sv_status(JNIEnv* env)
+{
+    if (sSvStatusPending)
+        deliver_sv_status(env, sPendingSvStatus);
+}
+
 static void location_callback(GpsLocation* location)
 {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
+    sLastFixTime = systemTime(SYSTEM_TIME_MONOTONIC);
     env->CallVoidMethod(mCallbacksObj, method_reportLocation, location->flags,
             (jdouble)location->latitude, (jdouble)location->longitude,
             (jdouble)location->altitude,
             (jfloat)location->speed, (jfloat)location->bearing,
             (jfloat)location->accuracy, (jlong)location->timestamp);
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    flush_sv_status(env);
 }
 
 static void status_callback(GpsStatus* status)
 {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
+    if (status->status == GPS_STATUS_SESSION_END || status->status == GPS_STATUS_ENGINE_OFF) {
+        // no more fixes to deliver the held status with
+        flush_sv_status(env);
+        sLastFixTime = 0;
+    }
     env->CallVoidMethod(mCallbacksObj, method_reportStatus, status->status);
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
 
 static void sv_status_callback(GpsSvStatus* sv_status)
 {
+    if (sLastFixTime != 0
+            && systemTime(SYSTEM_TIME_MONOTONIC) - sLastFixTime < SV_STATUS_HOLD_TIME) {
+        // a fix is expected soon, only the latest status is delivered with it
+        memcpy(&sPendingSvStatus, sv_status, sizeof(sPendingSvStatus));
+        sSvStatusPending = true;
+        return;
+    }
     JNIEnv* env = AndroidRuntime::getJNIEnv();
-    memcpy(&sGpsSvStatus, sv_status, sizeof(sGpsSvStatus));
-    env->CallVoidMethod(mCallbacksObj, method_reportSvStatus);
-    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    deliver_sv_status(env, *sv_status);
 }
 
 static void nmea_callback(GpsUtcTime timestamp, const char* nmea, int length)
@@ -420,6 +477,8 @@ static void android_location_GpsLocationProvider_cleanup(JNIEnv* env, jobject ob
 {
     if (sGpsInterface)
         sGpsInterface->cleanup();
+    sSvStatusPending = false;
+    sLastFixTime = 0;
 }
 
 static jboolean android_location_GpsLocationProvider_set_position_mode(JNIEnv* env, jobject obj,
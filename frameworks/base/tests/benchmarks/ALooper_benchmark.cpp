@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "ALooperBenchmark"
+
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/threads.h>
+
+#include "Benchmark.h"
+
+using namespace android;
+
+// Stagefright components talk to each other through messages posted to
+// their loopers, several times per buffer of every stream.
+
+static const int BATCH_SIZE = 64;
+
+struct CountingHandler : public AHandler {
+    CountingHandler() : mCount(0) {}
+
+    void waitFor(int64_t count) {
+        Mutex::Autolock _l(mLock);
+        while (mCount < count) {
+            mCondition.wait(mLock);
+        }
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage>& msg) {
+        Mutex::Autolock _l(mLock);
+        mCount++;
+        mCondition.signal();
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    int64_t mCount;
+};
+
+// One message at a time, which includes waking up the looper thread.
+BENCHMARK(ALooper_postAndDispatch) {
+    sp<ALooper> looper = new ALooper;
+    sp<CountingHandler> handler = new CountingHandler;
+    looper->registerHandler(handler);
+    looper->start();
+
+    int64_t posted = 0;
+    while (state.keepRunning()) {
+        (new AMessage('ping', handler->id()))->post();
+        handler->waitFor(++posted);
+    }
+
+    looper->stop();
+    looper->unregisterHandler(handler->id());
+}
+
+// Messages queued faster than they are handled.
+BENCHMARK(ALooper_post64AndDispatch) {
+    sp<ALooper> looper = new ALooper;
+    sp<CountingHandler> handler = new CountingHandler;
+    looper->registerHandler(handler);
+    looper->start();
+
+    int64_t posted = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            (new AMessage('ping', handler->id()))->post();
+        }
+        posted += BATCH_SIZE;
+        handler->waitFor(posted);
+    }
+
+    looper->stop();
+    looper->unregisterHandler(handler->id());
+}
+
+// Building and reading a typical buffer notification.
+BENCHMARK(AMessage_setAndFind) {
+    int32_t sum = 0;
+    while (state.keepRunning()) {
+        sp<AMessage> msg = new AMessage('buff');
+        msg->setInt32("what", 1);
+        msg->setInt32("bufferID", 2);
+        msg->setInt64("timeUs", 3);
+        msg->setString("mime", "video/avc");
+
+        int32_t what, bufferID;
+        int64_t timeUs;
+        AString mime;
+        if (msg->findInt32("what", &what) && msg->findInt32("bufferID", &bufferID)
+                && msg->findInt64("timeUs", &timeUs) && msg->findString("mime", &mime)) {
+            sum += what + bufferID + (int32_t)timeUs + mime.size();
+        }
+    }
+    benchmark::doNotOptimize(sum);
+}
@@ -0,0 +1,59 @@
+# Copyright (C) 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+# benchmark harness, also used by the benchmarks of the other projects
+# ========================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    Benchmark.cpp \
+    BenchmarkMain.cpp
+
+LOCAL_MODULE := libframework_benchmark
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_STATIC_LIBRARY)
+
+# framework benchmarks
+# ========================================
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALooper_benchmark.cpp \
+    BufferQueue_benchmark.cpp \
+    Parcel_benchmark.cpp \
+    Region_benchmark.cpp \
+    ResTable_benchmark.cpp \
+    ZipFileRO_benchmark.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+    libandroidfw \
+    libbinder \
+    libcutils \
+    libgui \
+    liblog \
+    libstagefright_foundation \
+    libui \
+    libutils
+
+LOCAL_STATIC_LIBRARIES := \
+    libframework_benchmark
+
+LOCAL_MODULE := framework_benchmarks
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_PATH := $(TARGET_OUT_DATA_NATIVE_TESTS)/framework_benchmarks
+
+include $(BUILD_EXECUTABLE)
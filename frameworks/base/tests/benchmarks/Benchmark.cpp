@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Output formats
+ *
+ * The csv and json formats are meant to be parsed by scripts, so they only
+ * change in backward compatible ways: new columns and fields are added at
+ * the end, and FORMAT_VERSION is bumped when a field changes meaning.
+ * All times are nanoseconds per iteration.
+ *
+ * csv: a header line, then one line per benchmark that ran:
+ *
+ *     name,iterations,repetitions,median_ns,min_ns,max_ns,bytes_per_second
+ *
+ *     bytes_per_second is 0 for benchmarks that don't report a throughput.
+ *     Skipped benchmarks are only reported on stderr.
+ *
+ * json: a single object:
+ *
+ *     {
+ *       "format_version": 1,
+ *       "context": { "fingerprint": "...", "cpus": 4 },
+ *       "benchmarks": [
+ *         { "name": "...", "iterations": 1000, "repetitions": 5,
+ *           "median_ns": 12.5, "min_ns": 12.1, "max_ns": 13.0,
+ *           "bytes_per_second": 0 },
+ *         { "name": "...", "skipped": "reason" }
+ *       ]
+ *     }
+ *
+ * text: for people, no stability guarantees.
+ */
+
+#define LOG_TAG "Benchmark"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <utils/Vector.h>
+
+#include "Benchmark.h"
+
+namespace android {
+namespace benchmark {
+
+static const int FORMAT_VERSION = 1;
+
+static const int64_t MAX_ITERATIONS = 1000000000LL;
+
+static const Benchmark* sFirst = NULL;
+
+enum Format {
+    FORMAT_TEXT,
+    FORMAT_CSV,
+    FORMAT_JSON,
+};
+
+struct Options {
+    Options() : format(FORMAT_TEXT), filter(NULL), minTime(ms2ns(200)),
+            repetitions(5), list(false) { }
+
+    Format format;
+    const char* filter;
+    nsecs_t minTime;
+    int repetitions;
+    bool list;
+};
+
+struct Result {
+    Result() : benchmark(NULL), iterations(0), medianNs(0), minNs(0), maxNs(0),
+            bytesPerSecond(0), skipped(false) { }
+
+    const Benchmark* benchmark;
+    int64_t iterations;
+    double medianNs;
+    double minNs;
+    double maxNs;
+    double bytesPerSecond;
+    bool skipped;
+    String8 skipReason;
+};
+
+// ---------------------------------------------------------------------------
+
+State::State(int64_t iterations)
+    : mIterations(iterations), mIteration(0), mTiming(false), mStart(0), mElapsed(0),
+      mBytesPerIteration(0), mSkipped(false) {
+}
+
+void State::pauseTiming() {
+    mElapsed += systemTime(SYSTEM_TIME_MONOTONIC) - mStart;
+    mTiming = false;
+}
+
+void State::resumeTiming() {
+    mTiming = true;
+    mStart = systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+void State::skip(const char* reason) {
+    mSkipped = true;
+    mSkipReason = reason;
+}
+
+Benchmark::Benchmark(const char* name, BenchmarkFunction function)
+    : mName(name), mFunction(function), mNext(sFirst) {
+    sFirst = this;
+}
+
+const Benchmark* Benchmark::first() {
+    return sFirst;
+}
+
+// ---------------------------------------------------------------------------
+
+static int compareBenchmarks(const Benchmark* const* lhs, const Benchmark* const* rhs) {
+    return strcmp((*lhs)->name(), (*rhs)->name());
+}
+
+static int compareDoubles(const double* lhs, const double* rhs) {
+    return *lhs < *rhs ? -1 : (*lhs > *rhs ? 1 : 0);
+}
+
+// Finds the number of iterations that makes a run last at least the minimum
+// time. Returns false if the benchmark skipped itself.
+static bool calibrate(const Benchmark* b, const Options& options, Result* result) {
+    int64_t iterations = 1;
+    for (;;) {
+        State state(iterations);
+        b->function()(state);
+        if (state.skipped()) {
+            result->skipped = true;
+            result->skipReason = state.skipReason();
+            return false;
+        }
+        const nsecs_t elapsed = state.elapsed();
+        if (elapsed >= options.minTime || iterations >= MAX_ITERATIONS) {
+            break;
+        }
+        // aim a bit past the minimum time, but don't trust a single short
+        // run for more than a 10x increase
+        int64_t next = iterations * 10;
+        if (elapsed > 0) {
+            next = iterations * options.minTime / elapsed;
+            next += next / 5;
+        }
+        if (next <= iterations) {
+            next = iterations + 1;
+        } else if (next > iterations * 10) {
+            next = iterations * 10;
+        }
+        iterations = next < MAX_ITERATIONS ? next : MAX_ITERATIONS;
+    }
+    result->iterations = iterations;
+    return true;
+}
+
+static void run(const Benchmark* b, const Options& options, Result* result) {
+    result->benchmark = b;
+    if (!calibrate(b, options, result)) {
+        return;
+    }
+
+    Vector<double> times;
+    int64_t bytesPerIteration = 0;
+    for (int i = 0; i < options.repetitions; i++) {
+        State state(result->iterations);
+        b->function()(state);
+        if (state.skipped()) {
+            result->skipped = true;
+            result->skipReason = state.skipReason();
+            return;
+        }
+        times.add(double(state.elapsed()) / result->iterations);
+        bytesPerIteration = state.bytesPerIteration();
+    }
+    times.sort(compareDoubles);
+
+    const size_t count = times.size();
+    result->minNs = times[0];
+    result->maxNs = times[count - 1];
+    result->medianNs = (count & 1) ? times[count / 2]
+            : (times[count / 2 - 1] + times[count / 2]) / 2;
+    if (bytesPerIteration > 0 && result->medianNs > 0) {
+        result->bytesPerSecond = bytesPerIteration * 1e9 / result->medianNs;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+static String8 jsonString(const char* s) {
+    String8 out("\"");
+    for (; *s; s++) {
+        const unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            out.appendFormat("\\%c", c);
+        } else if (c < 0x20) {
+            out.appendFormat("\\u%04x", c);
+        } else {
+            out.append(s, 1);
+        }
+    }
+    out.append("\"");
+    return out;
+}
+
+static void printHeader(const Options& options) {
+    char fingerprint[PROPERTY_VALUE_MAX];
+    property_get("ro.build.fingerprint", fingerprint, "unknown");
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    switch (options.format) {
+    case FORMAT_TEXT:
+        printf("# %s, %ld cpus, %d repetitions of at least %lld ms\n", fingerprint, cpus,
+                options.repetitions, (long long)ns2ms(options.minTime));
+        printf("%-48s %12s %12s %12s %12s\n", "benchmark", "iterations", "median ns",
+                "min ns", "max ns");
+        break;
+    case FORMAT_CSV:
+        printf("name,iterations,repetitions,median_ns,min_ns,max_ns,bytes_per_second\n");
+        break;
+    case FORMAT_JSON:
+        printf("{\n  \"format_version\": %d,\n", FORMAT_VERSION);
+        printf("  \"context\": { \"fingerprint\": %s, \"cpus\": %ld },\n",
+                jsonString(fingerprint).string(), cpus);
+        printf("  \"benchmarks\": [");
+        break;
+    }
+}
+
+static void printResult(const Options& options, const Result& result, bool first) {
+    const char* name = result.benchmark->name();
+
+    switch (options.format) {
+    case FORMAT_TEXT:
+        if (result.skipped) {
+            printf("%-48s skipped: %s\n", name, result.skipReason.string());
+            break;
+        }
+        printf("%-48s %12lld %12.1f %12.1f %12.1f", name, (long long)result.iterations,
+                result.medianNs, result.minNs, result.maxNs);
+        if (result.bytesPerSecond > 0) {
+            printf(" %10.1f MB/s", result.bytesPerSecond / (1024 * 1024));
+        }
+        printf("\n");
+        break;
+    case FORMAT_CSV:
+        if (result.skipped) {
+            fprintf(stderr, "%s skipped: %s\n", name, result.skipReason.string());
+            break;
+        }
+        printf("%s,%lld,%d,%.3f,%.3f,%.3f,%.0f\n", name, (long long)result.iterations,
+                options.repetitions, result.medianNs, result.minNs, result.maxNs,
+                result.bytesPerSecond);
+        break;
+    case FORMAT_JSON:
+        printf("%s\n    { \"name\": %s, ", first ? "" : ",", jsonString(name).string());
+        if (result.skipped) {
+            printf("\"skipped\": %s }", jsonString(result.skipReason.string()).string());
+            break;
+        }
+        printf("\"iterations\": %lld, \"repetitions\": %d, "
+                "\"median_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, "
+                "\"bytes_per_second\": %.0f }",
+                (long long)result.iterations, options.repetitions,
+                result.medianNs, result.minNs, result.maxNs, result.bytesPerSecond);
+        break;
+    }
+    fflush(stdout);
+}
+
+static void printFooter(const Options& options) {
+    if (options.format == FORMAT_JSON) {
+        printf("\n  ]\n}\n");
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --format=text|csv|json  output format, default text\n"
+            "  --filter=<substring>    only run the benchmarks whose name contains it\n"
+            "  --min_time_ms=<ms>      minimum duration of each repetition, default 200\n"
+            "  --repetitions=<n>       number of timed repetitions, default 5\n"
+            "  --list                  list the benchmarks and exit\n",
+            program);
+}
+
+static bool parseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strcmp(arg, "--format=text")) {
+            options->format = FORMAT_TEXT;
+        } else if (!strcmp(arg, "--format=csv")) {
+            options->format = FORMAT_CSV;
+        } else if (!strcmp(arg, "--format=json")) {
+            options->format = FORMAT_JSON;
+        } else if (!strncmp(arg, "--filter=", 9)) {
+            options->filter = arg + 9;
+        } else if (!strncmp(arg, "--min_time_ms=", 14) && atoi(arg + 14) > 0) {
+            options->minTime = ms2ns(atoi(arg + 14));
+        } else if (!strncmp(arg, "--repetitions=", 14) && atoi(arg + 14) > 0) {
+            options->repetitions = atoi(arg + 14);
+        } else if (!strcmp(arg, "--list")) {
+            options->list = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int Benchmark::runAll(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Vector<const Benchmark*> benchmarks;
+    for (const Benchmark* b = first(); b != NULL; b = b->next()) {
+        if (options.filter == NULL || strstr(b->name(), options.filter) != NULL) {
+            benchmarks.add(b);
+        }
+    }
+    if (benchmarks.isEmpty()) {
+        fprintf(stderr, "no benchmark matches\n");
+        return 1;
+    }
+    benchmarks.sort(compareBenchmarks);
+
+    if (options.list) {
+        for (size_t i = 0; i < benchmarks.size(); i++) {
+            printf("%s\n", benchmarks[i]->name());
+        }
+        return 0;
+    }
+
+    printHeader(options);
+    for (size_t i = 0; i < benchmarks.size(); i++) {
+        Result result;
+        run(benchmarks[i], options, &result);
+        printResult(options, result, i == 0);
+    }
+    printFooter(options);
+    return 0;
+}
+
+}; // namespace benchmark
+}; // namespace android
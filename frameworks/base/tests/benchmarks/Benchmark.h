@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORK_BENCHMARK_H
+#define ANDROID_FRAMEWORK_BENCHMARK_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+namespace android {
+namespace benchmark {
+
+/*
+ * Microbenchmark harness for the native framework hot paths.
+ *
+ * A benchmark is a function registered with BENCHMARK(name). The function
+ * does its setup, then loops on State::keepRunning() around the operation
+ * being measured. Only the time spent inside that loop is counted:
+ *
+ *     BENCHMARK(Parcel_writeInt32) {
+ *         Parcel p;
+ *         while (state.keepRunning()) {
+ *             p.setDataPosition(0);
+ *             p.writeInt32(42);
+ *         }
+ *     }
+ *
+ * The runner calls each function several times. The first runs calibrate
+ * the number of iterations so that a run lasts at least the minimum time,
+ * then each repetition reports the time per iteration. The results are the
+ * median, minimum and maximum of the repetitions.
+ *
+ * The output formats are stable so that results can be compared across
+ * builds, see the top of Benchmark.cpp.
+ */
+class State {
+public:
+    State(int64_t iterations);
+
+    // Returns true until the requested number of iterations has run.
+    // The first call starts the timer and the last one stops it.
+    inline bool keepRunning() {
+        if (mIteration < mIterations) {
+            if (mIteration++ == 0) {
+                resumeTiming();
+            }
+            return true;
+        }
+        if (mTiming) {
+            pauseTiming();
+        }
+        return false;
+    }
+
+    // Excludes the code between the two calls from the measurement.
+    void pauseTiming();
+    void resumeTiming();
+
+    // Number of bytes each iteration processes, reported as a throughput.
+    void setBytesPerIteration(int64_t bytes) { mBytesPerIteration = bytes; }
+
+    // Marks the benchmark as not runnable on this device, e.g. because a
+    // file it needs is missing. It must return without calling keepRunning().
+    void skip(const char* reason);
+
+    int64_t iterations() const { return mIterations; }
+    nsecs_t elapsed() const { return mElapsed; }
+    int64_t bytesPerIteration() const { return mBytesPerIteration; }
+    bool skipped() const { return mSkipped; }
+    const String8& skipReason() const { return mSkipReason; }
+
+private:
+    const int64_t mIterations;
+    int64_t mIteration;
+    bool mTiming;
+    nsecs_t mStart;
+    nsecs_t mElapsed;
+    int64_t mBytesPerIteration;
+    bool mSkipped;
+    String8 mSkipReason;
+};
+
+typedef void (*BenchmarkFunction)(State& state);
+
+class Benchmark {
+public:
+    // Registers the benchmark, instances are expected to be static.
+    Benchmark(const char* name, BenchmarkFunction function);
+
+    const char* name() const { return mName; }
+    BenchmarkFunction function() const { return mFunction; }
+    const Benchmark* next() const { return mNext; }
+
+    // Returns the first registered benchmark, in no particular order.
+    static const Benchmark* first();
+
+    // Parses the command line and runs the matching benchmarks.
+    // Returns the exit status of the program.
+    static int runAll(int argc, char** argv);
+
+private:
+    const char* const mName;
+    const BenchmarkFunction mFunction;
+    const Benchmark* mNext;
+};
+
+// Keeps the compiler from optimizing away the computation of a value.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+}; // namespace benchmark
+}; // namespace android
+
+#define BENCHMARK(name) \
+    static void benchmark_##name(::android::benchmark::State& state); \
+    static ::android::benchmark::Benchmark sBenchmark_##name(#name, benchmark_##name); \
+    static void benchmark_##name(::android::benchmark::State& state)
+
+#endif // ANDROID_FRAMEWORK_BENCHMARK_H
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "BufferQueueBenchmark"
+
+#include <gui/BufferQueue.h>
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
+
+#include "Benchmark.h"
+
+using namespace android;
+
+// The producer and consumer side of every frame of every surface. The
+// buffers are allocated by SurfaceFlinger before the measurement starts, so
+// this only measures the bookkeeping of the queue.
+
+static const int WARMUP_CYCLES = 4;
+
+struct DummyConsumer : public BnConsumerListener {
+    virtual void onFrameAvailable() {}
+    virtual void onBuffersReleased() {}
+};
+
+static status_t cycle(const sp<BufferQueue>& bq) {
+    int slot;
+    sp<Fence> fence;
+    status_t err = bq->dequeueBuffer(&slot, &fence, false, 1, 1, 0,
+            GRALLOC_USAGE_SW_READ_OFTEN);
+    if (err < 0) {
+        return err;
+    }
+    if (err & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+        sp<GraphicBuffer> buffer;
+        err = bq->requestBuffer(slot, &buffer);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+
+    IGraphicBufferProducer::QueueBufferInput input(0, false, Rect(0, 0, 1, 1),
+            NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, false, Fence::NO_FENCE);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    err = bq->queueBuffer(slot, input, &output);
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    BufferQueue::BufferItem item;
+    err = bq->acquireBuffer(&item, 0);
+    if (err != NO_ERROR) {
+        return err;
+    }
+    return bq->releaseBuffer(item.mBuf, item.mFrameNumber,
+            EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE);
+}
+
+BENCHMARK(BufferQueue_dequeueQueueAcquireRelease) {
+    sp<BufferQueue> bq(new BufferQueue());
+    bq->consumerConnect(new DummyConsumer, false);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    if (bq->connect(NULL, NATIVE_WINDOW_API_CPU, false, &output) != NO_ERROR) {
+        state.skip("can't connect to the BufferQueue");
+        return;
+    }
+
+    // The first cycles allocate the buffers the queue rotates through.
+    for (int i = 0; i < WARMUP_CYCLES; i++) {
+        if (cycle(bq) != NO_ERROR) {
+            state.skip("can't allocate buffers");
+            return;
+        }
+    }
+
+    int failures = 0;
+    while (state.keepRunning()) {
+        if (cycle(bq) != NO_ERROR) {
+            failures++;
+        }
+    }
+    ALOGE_IF(failures, "%d BufferQueue cycles failed", failures);
+
+    bq->disconnect(NATIVE_WINDOW_API_CPU);
+    bq->consumerDisconnect();
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "ParcelBenchmark"
+
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+#include <utils/String16.h>
+
+#include "Benchmark.h"
+
+using namespace android;
+
+// Every binder transaction flattens its arguments into a Parcel and the
+// receiving side reads them back, so these run for every IPC.
+
+static const int INT32_COUNT = 16;
+
+BENCHMARK(Parcel_writeInt32x16) {
+    Parcel p;
+    while (state.keepRunning()) {
+        p.setDataPosition(0);
+        for (int i = 0; i < INT32_COUNT; i++) {
+            p.writeInt32(i);
+        }
+    }
+    state.setBytesPerIteration(INT32_COUNT * sizeof(int32_t));
+}
+
+BENCHMARK(Parcel_readInt32x16) {
+    Parcel p;
+    for (int i = 0; i < INT32_COUNT; i++) {
+        p.writeInt32(i);
+    }
+    int32_t sum = 0;
+    while (state.keepRunning()) {
+        p.setDataPosition(0);
+        for (int i = 0; i < INT32_COUNT; i++) {
+            sum += p.readInt32();
+        }
+    }
+    benchmark::doNotOptimize(sum);
+    state.setBytesPerIteration(INT32_COUNT * sizeof(int32_t));
+}
+
+BENCHMARK(Parcel_writeString16) {
+    const String16 s("android.view.IWindowSession");
+    Parcel p;
+    while (state.keepRunning()) {
+        p.setDataPosition(0);
+        p.writeString16(s);
+    }
+}
+
+BENCHMARK(Parcel_readString16) {
+    Parcel p;
+    p.writeString16(String16("android.view.IWindowSession"));
+    while (state.keepRunning()) {
+        p.setDataPosition(0);
+        String16 s(p.readString16());
+        benchmark::doNotOptimize(s);
+    }
+}
+
+BENCHMARK(Parcel_writeInterfaceToken) {
+    const String16 descriptor("android.view.IWindowSession");
+    Parcel p;
+    while (state.keepRunning()) {
+        p.setDataPosition(0);
+        p.writeInterfaceToken(descriptor);
+    }
+}
+
+// Objects can't be overwritten in place, so each iteration uses a new Parcel.
+BENCHMARK(Parcel_writeReadStrongBinder) {
+    sp<IBinder> binder = new BBinder();
+    while (state.keepRunning()) {
+        Parcel p;
+        p.writeStrongBinder(binder);
+        p.setDataPosition(0);
+        sp<IBinder> b = p.readStrongBinder();
+        benchmark::doNotOptimize(b);
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "RegionBenchmark"
+
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+#include "Benchmark.h"
+
+using namespace android;
+
+// SurfaceFlinger runs these for every layer of every frame while computing
+// the visible and dirty regions.
+
+// returns a region made of a grid of count x count squares
+static Region grid(int count, int size) {
+    Region r;
+    for (int y = 0; y < count; y++) {
+        for (int x = 0; x < count; x++) {
+            r.orSelf(Rect(x * size * 2, y * size * 2,
+                    x * size * 2 + size, y * size * 2 + size));
+        }
+    }
+    return r;
+}
+
+BENCHMARK(Region_rectSubtractRect) {
+    const Region screen(Rect(0, 0, 1080, 1920));
+    const Rect dialog(100, 500, 980, 1400);
+    Region r;
+    while (state.keepRunning()) {
+        r = screen;
+        r.subtractSelf(dialog);
+    }
+}
+
+BENCHMARK(Region_rectOrRect) {
+    const Region top(Rect(0, 0, 1080, 960));
+    const Rect corner(900, 1700, 1080, 1920);
+    Region r;
+    while (state.keepRunning()) {
+        r = top;
+        r.orSelf(corner);
+    }
+}
+
+BENCHMARK(Region_gridOrGrid) {
+    const Region lhs(grid(4, 50));
+    const Region rhs(grid(4, 60));
+    Region r;
+    while (state.keepRunning()) {
+        r = lhs;
+        r.orSelf(rhs);
+    }
+}
+
+BENCHMARK(Region_gridAndGrid) {
+    const Region lhs(grid(4, 50));
+    const Region rhs(grid(4, 60));
+    Region r;
+    while (state.keepRunning()) {
+        r = lhs.intersect(rhs);
+    }
+    benchmark::doNotOptimize(r);
+}
+
+BENCHMARK(Region_gridSubtractGrid) {
+    const Region lhs(grid(4, 50));
+    const Region rhs(grid(4, 60));
+    Region r;
+    while (state.keepRunning()) {
+        r = lhs;
+        r.subtractSelf(rhs);
+    }
+}
+
+BENCHMARK(Region_largeGridOrLargeGrid) {
+    const Region lhs(grid(16, 10));
+    const Region rhs(grid(16, 12));
+    Region r;
+    while (state.keepRunning()) {
+        r = lhs.merge(rhs);
+    }
+    benchmark::doNotOptimize(r);
+}
+
+// The per layer steps of SurfaceFlinger::computeVisibleRegions() for a stack
+// of a wallpaper, an application window, the status bar and a dialog.
+BENCHMARK(Region_computeVisibleRegions) {
+    const Rect layers[] = {
+        Rect(900, 1700, 1080, 1920),    // dialog, on top
+        Rect(0, 0, 1080, 75),           // status bar
+        Rect(0, 75, 1080, 1920),        // application
+        Rect(0, 0, 1080, 1920),         // wallpaper
+    };
+    const size_t count = sizeof(layers) / sizeof(layers[0]);
+    const Region screen(Rect(0, 0, 1080, 1920));
+    Region visible[count];
+    while (state.keepRunning()) {
+        Region aboveOpaqueLayers;
+        for (size_t i = 0; i < count; i++) {
+            visible[i] = screen.intersect(layers[i]);
+            visible[i].subtractSelf(aboveOpaqueLayers);
+            aboveOpaqueLayers.orSelf(layers[i]);
+        }
+    }
+}
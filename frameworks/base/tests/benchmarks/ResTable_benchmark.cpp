@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "ResTableBenchmark"
+
+#include <androidfw/AssetManager.h>
+#include <androidfw/ResourceTypes.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
+
+#include "Benchmark.h"
+
+using namespace android;
+
+// Every resource an application loads goes through getResource(), most of
+// them from the framework package.
+
+static const char* const RESOURCE_NAMES[] = {
+    "android:string/ok",
+    "android:string/cancel",
+    "android:color/white",
+    "android:dimen/status_bar_height",
+    "android:integer/config_shortAnimTime",
+    "android:drawable/btn_default",
+    "android:layout/simple_list_item_1",
+};
+
+// Loading the framework resources takes a while, so it is only done once.
+static AssetManager* getAssets() {
+    static AssetManager* sAssets = NULL;
+    if (sAssets == NULL) {
+        AssetManager* assets = new AssetManager();
+        if (!assets->addDefaultAssets() || assets->getResources().getError() != NO_ERROR) {
+            delete assets;
+            return NULL;
+        }
+        sAssets = assets;
+    }
+    return sAssets;
+}
+
+BENCHMARK(ResTable_getResource) {
+    AssetManager* assets = getAssets();
+    if (assets == NULL) {
+        state.skip("no framework resources");
+        return;
+    }
+    const ResTable& res = assets->getResources();
+
+    Vector<uint32_t> ids;
+    for (size_t i = 0; i < sizeof(RESOURCE_NAMES) / sizeof(RESOURCE_NAMES[0]); i++) {
+        const String16 name(RESOURCE_NAMES[i]);
+        const uint32_t id = res.identifierForName(name.string(), name.size());
+        if (id != 0) {
+            ids.add(id);
+        }
+    }
+    if (ids.isEmpty()) {
+        state.skip("no known framework resources");
+        return;
+    }
+
+    size_t next = 0;
+    Res_value value;
+    uint32_t specFlags;
+    while (state.keepRunning()) {
+        ssize_t block = res.getResource(ids[next], &value, false, 0, &specFlags);
+        benchmark::doNotOptimize(block);
+        if (++next == ids.size()) {
+            next = 0;
+        }
+    }
+}
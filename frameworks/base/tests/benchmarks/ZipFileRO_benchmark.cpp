@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "ZipFileROBenchmark"
+
+#include <limits.h>
+
+#include <androidfw/ZipFileRO.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include "Benchmark.h"
+
+using namespace android;
+
+// The asset manager finds every asset and resource file of a package by
+// name in its zip archive.
+
+static const char* FRAMEWORK_RES = "/system/framework/framework-res.apk";
+
+static const int MAX_NAMES = 256;
+
+BENCHMARK(ZipFileRO_findEntryByName) {
+    ZipFileRO zip;
+    if (zip.open(FRAMEWORK_RES) != NO_ERROR) {
+        state.skip("can't open framework-res.apk");
+        return;
+    }
+
+    // Spread the lookups over the archive, in the order of the hash table.
+    Vector<String8> names;
+    const int count = zip.getNumEntries();
+    const int step = count > MAX_NAMES ? count / MAX_NAMES : 1;
+    for (int i = 0; i < count; i += step) {
+        char name[PATH_MAX];
+        if (zip.getEntryFileName(zip.findEntryByIndex(i), name, sizeof(name)) == 0) {
+            names.add(String8(name));
+        }
+    }
+    if (names.isEmpty()) {
+        state.skip("framework-res.apk is empty");
+        return;
+    }
+
+    size_t next = 0;
+    while (state.keepRunning()) {
+        ZipEntryRO entry = zip.findEntryByName(names[next].string());
+        benchmark::doNotOptimize(entry);
+        if (++next == names.size()) {
+            next = 0;
+        }
+    }
+}
+
+BENCHMARK(ZipFileRO_findEntryByName_missing) {
+    ZipFileRO zip;
+    if (zip.open(FRAMEWORK_RES) != NO_ERROR) {
+        state.skip("can't open framework-res.apk");
+        return;
+    }
+    // The hash table is built by the first lookup.
+    zip.findEntryByName("AndroidManifest.xml");
+
+    while (state.keepRunning()) {
+        ZipEntryRO entry = zip.findEntryByName("res/drawable-xxhdpi/missing.png");
+        benchmark::doNotOptimize(entry);
+    }
+}
@@ -51,7 +51,7 @@ public:
           mForce(false), mGrayscaleTolerance(0), mMakePackageDirs(false),
           mUpdate(false), mExtending(false),
           mRequireLocalization(false), mPseudolocalize(false),
-          mWantUTF16(false), mValues(false),
+          mWantUTF16(false), mCompactStyles(false), mValues(false),
           mCompressionMethod(0), mJunkPath(false), mOutputAPKFile(NULL),
           mManifestPackageNameOverride(NULL), mInstrumentationPackageNameOverride(NULL),
           mAutoAddOverlay(false), mGenDependencies(false),
@@ -62,7 +62,7 @@ public:
           mMinSdkVersion(NULL), mTargetSdkVersion(NULL), mMaxSdkVersion(NULL),
           mVersionCode(NULL), mVersionName(NULL), mCustomPackage(NULL), mExtraPackages(NULL),
           mMaxResVersion(NULL), mDebugMode(false), mNonConstantId(false), mProduct(NULL),
-          mUseCrunchCache(false), mErrorOnFailedInsert(false), mOutputTextSymbols(NULL),
+          mUseCrunchCache(false), mQuantizePng(false), mErrorOnFailedInsert(false), mOutputTextSymbols(NULL),
           mSingleCrunchInputFile(NULL), mSingleCrunchOutputFile(NULL),
           mArgc(0), mArgv(NULL)
         {}
@@ -97,6 +97,8 @@ public:
     bool getPseudolocalize(void) const { return mPseudolocalize; }
     void setPseudolocalize(bool val) { mPseudolocalize = val; }
     void setWantUTF16(bool val) { mWantUTF16 = val; }
+    bool getCompactStyles(void) const { return mCompactStyles; }
+    void setCompactStyles(bool val) { mCompactStyles = val; }
     bool getValues(void) const { return mValues; }
     void setValues(bool val) { mValues = val; }
     int getCompressionMethod(void) const { return mCompressionMethod; }
@@ -176,6 +178,8 @@ public:
     void setProduct(const char * val) { mProduct = val; }
     void setUseCrunchCache(bool val) { mUseCrunchCache = val; }
     bool getUseCrunchCache() const { return mUseCrunchCache; }
+    void setQuantizePng(bool val) { mQuantizePng = val; }
+    bool getQuantizePng() const { return mQuantizePng; }
     const char* getOutputTextSymbols() const { return mOutputTextSymbols; }
     void setOutputTextSymbols(const char* val) { mOutputTextSymbols = val; }
     const char* getSingleCrunchInputFile() const { return mSingleCrunchInputFile; }
@@ -252,6 +256,7 @@ private:
     bool        mRequireLocalization;
     bool        mPseudolocalize;
     bool        mWantUTF16;
+    bool        mCompactStyles;
     bool        mValues;
     int         mCompressionMethod;
     bool        mJunkPath;
@@ -287,6 +292,7 @@ private:
     bool        mNonConstantId;
     const char* mProduct;
     bool        mUseCrunchCache;
+    bool        mQuantizePng;
     bool        mErrorOnFailedInsert;
     const char* mOutputTextSymbols;
     const char* mSingleCrunchInputFile;
@@ -1790,10 +1790,12 @@ int doAdd(Bundle* bundle)
                 String8 storageName = String8(fileName).getPathLeaf();
                 printf(" '%s' as '%s'...\n", fileName, storageName.string());
                 result = zip->add(fileName, storageName.string(),
-                                  bundle->getCompressionMethod(), NULL);
+                                  bundle->getCompressionMethod(), NULL,
+                                  getStorageAlignment(storageName));
             } else {
                 printf(" '%s'...\n", fileName);
-                result = zip->add(fileName, bundle->getCompressionMethod(), NULL);
+                result = zip->add(fileName, bundle->getCompressionMethod(), NULL,
+                                  getStorageAlignment(String8(fileName)));
             }
         }
         if (result != NO_ERROR) {
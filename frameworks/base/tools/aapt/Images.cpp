@@ -13,6 +13,9 @@
 
 #include <png.h>
 
+#include <algorithm>
+#include <vector>
+
 #define NOISY(x) //x
 
 static void
@@ -800,8 +803,164 @@ static void dump_image(int w, int h, png_bytepp rows, int color_type)
 #define MAX(a,b) ((a)>(b)?(a):(b))
 #define ABS(a)   ((a)<0?-(a):(a))
 
+struct color_count {
+    uint32_t color;     // RGBA, R in the high byte
+    uint32_t count;
+};
+
+struct color_less {
+    bool operator()(const color_count& lhs, const color_count& rhs) const {
+        return lhs.color < rhs.color;
+    }
+};
+
+// Orders the colors by one of their channels, given by its shift in the RGBA word.
+struct channel_less {
+    int shift;
+    bool operator()(const color_count& lhs, const color_count& rhs) const {
+        return ((lhs.color >> shift) & 0xff) < ((rhs.color >> shift) & 0xff);
+    }
+};
+
+struct color_box {
+    size_t start;       // range of the box in the color array
+    size_t end;
+    int shift;          // channel with the widest range
+    int range;          // width of that range
+};
+
+static void measure_box(const std::vector<color_count>& colors, color_box* box)
+{
+    int lo[4] = { 255, 255, 255, 255 };
+    int hi[4] = { 0, 0, 0, 0 };
+    for (size_t i = box->start; i < box->end; i++) {
+        for (int c = 0; c < 4; c++) {
+            int v = (colors[i].color >> (c * 8)) & 0xff;
+            lo[c] = std::min(lo[c], v);
+            hi[c] = std::max(hi[c], v);
+        }
+    }
+    box->range = -1;
+    for (int c = 0; c < 4; c++) {
+        if (hi[c] - lo[c] > box->range) {
+            box->range = hi[c] - lo[c];
+            box->shift = c * 8;
+        }
+    }
+}
+
+/*
+ * Reduces the image to at most 256 colors with the median cut algorithm:
+ * the box of colors with the widest channel is split at the pixel median
+ * of that channel until there are 256 boxes, and each box is replaced by
+ * the average of its pixels.  The palette is returned in "colors", and the
+ * index of each pixel is written to outRows.
+ */
+static int quantize_image(image_info &imageInfo, uint32_t* colors, png_bytepp outRows)
+{
+    const int w = imageInfo.width;
+    const int h = imageInfo.height;
+
+    std::vector<color_count> hist;
+    hist.reserve(w * h);
+    for (int j = 0; j < h; j++) {
+        const png_bytep row = imageInfo.rows[j];
+        for (int i = 0; i < w; i++) {
+            const png_bytep p = row + i * 4;
+            color_count cc;
+            cc.color = (uint32_t) ((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+            cc.count = 1;
+            hist.push_back(cc);
+        }
+    }
+    std::sort(hist.begin(), hist.end(), color_less());
+    size_t unique = 0;
+    for (size_t i = 0; i < hist.size(); i++) {
+        if (unique > 0 && hist[unique - 1].color == hist[i].color) {
+            hist[unique - 1].count++;
+        } else {
+            hist[unique++] = hist[i];
+        }
+    }
+    hist.resize(unique);
+
+    std::vector<color_box> boxes;
+    color_box first;
+    first.start = 0;
+    first.end = hist.size();
+    measure_box(hist, &first);
+    boxes.push_back(first);
+    while (boxes.size() < 256) {
+        size_t widest = 0;
+        for (size_t b = 1; b < boxes.size(); b++) {
+            if (boxes[b].range > boxes[widest].range) {
+                widest = b;
+            }
+        }
+        color_box& box = boxes[widest];
+        if (box.range <= 0) {
+            break;  // every box holds a single color
+        }
+
+        channel_less less;
+        less.shift = box.shift;
+        std::sort(hist.begin() + box.start, hist.begin() + box.end, less);
+
+        uint32_t total = 0;
+        for (size_t i = box.start; i < box.end; i++) {
+            total += hist[i].count;
+        }
+        // both halves get at least one color
+        size_t split = box.start + 1;
+        uint32_t below = hist[box.start].count;
+        while (split < box.end - 1 && below < total / 2) {
+            below += hist[split++].count;
+        }
+
+        color_box upper;
+        upper.start = split;
+        upper.end = box.end;
+        box.end = split;
+        measure_box(hist, &box);
+        measure_box(hist, &upper);
+        boxes.push_back(upper);
+    }
+
+    // the index of each color, found by its position in the sorted colors
+    for (size_t b = 0; b < boxes.size(); b++) {
+        uint64_t sum[4] = { 0, 0, 0, 0 };
+        uint64_t total = 0;
+        for (size_t i = boxes[b].start; i < boxes[b].end; i++) {
+            for (int c = 0; c < 4; c++) {
+                sum[c] += (uint64_t) ((hist[i].color >> (c * 8)) & 0xff) * hist[i].count;
+            }
+            total += hist[i].count;
+            hist[i].count = b;
+        }
+        uint32_t col = 0;
+        for (int c = 0; c < 4; c++) {
+            col |= (uint32_t) ((sum[c] + total / 2) / total) << (c * 8);
+        }
+        colors[b] = col;
+    }
+    std::sort(hist.begin(), hist.end(), color_less());
+
+    for (int j = 0; j < h; j++) {
+        const png_bytep row = imageInfo.rows[j];
+        png_bytep out = outRows[j];
+        for (int i = 0; i < w; i++) {
+            const png_bytep p = row + i * 4;
+            color_count key;
+            key.color = (uint32_t) ((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+            *out++ = (png_byte) std::lower_bound(hist.begin(), hist.end(), key,
+                    color_less())->count;
+        }
+    }
+    return boxes.size();
+}
+
 static void analyze_image(const char *imageName, image_info &imageInfo, int grayscaleTolerance,
-                          png_colorp rgbPalette, png_bytep alphaPalette,
+                          bool quantize, png_colorp rgbPalette, png_bytep alphaPalette,
                           int *paletteEntries, bool *hasTransparency, int *colorType,
                           png_bytepp outRows)
 {
@@ -812,6 +971,13 @@ static void analyze_image(const char *imageName, image_info &imageInfo, int gray
     int num_colors = 0;
     int maxGrayDeviation = 0;
 
+    // Open addressing table of the indices in colors, -1 in empty slots.  It is
+    // never more than half full.
+    int colorSlots[512];
+    memset(colorSlots, -1, sizeof(colorSlots));
+    uint32_t lastColor = 0;
+    int lastIndex = -1;
+
     bool isOpaque = true;
     bool isPalette = true;
     bool isGrayscale = true;
@@ -863,26 +1029,31 @@ static void analyze_image(const char *imageName, image_info &imageInfo, int gray
             // Check if image is really <= 256 colors
             if (isPalette) {
                 col = (uint32_t) ((rr << 24) | (gg << 16) | (bb << 8) | aa);
-                bool match = false;
-                for (idx = 0; idx < num_colors; idx++) {
-                    if (colors[idx] == col) {
-                        match = true;
-                        break;
+                // runs of the same color are common, skip the lookup for them
+                if (col != lastColor || lastIndex < 0) {
+                    uint32_t slot = (col * 2654435761u) >> 23;
+                    while (colorSlots[slot] >= 0 && colors[colorSlots[slot]] != col) {
+                        slot = (slot + 1) & 511;
+                    }
+                    idx = colorSlots[slot];
+                    if (idx < 0) {
+                        idx = num_colors;
+                        if (num_colors == 256) {
+                            NOISY(printf("Found 257th color at %d, %d\n", i, j));
+                            isPalette = false;
+                        } else {
+                            colors[num_colors++] = col;
+                            colorSlots[slot] = idx;
+                        }
                     }
+                    lastColor = col;
+                    lastIndex = idx;
                 }
 
                 // Write the palette index for the pixel to outRows optimistically
                 // We might overwrite it later if we decide to encode as gray or
                 // gray + alpha
-                *out++ = idx;
-                if (!match) {
-                    if (num_colors == 256) {
-                        NOISY(printf("Found 257th color at %d, %d\n", i, j));
-                        isPalette = false;
-                    } else {
-                        colors[num_colors++] = col;
-                    }
-                }
+                *out++ = lastIndex;
             }
         }
     }
@@ -925,6 +1096,10 @@ static void analyze_image(const char *imageName, image_info &imageInfo, int gray
         if (maxGrayDeviation <= grayscaleTolerance) {
             printf("%s: forcing image to gray (max deviation = %d)\n", imageName, maxGrayDeviation);
             *colorType = isOpaque ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_GRAY_ALPHA;
+        } else if (quantize) {
+            num_colors = quantize_image(imageInfo, colors, outRows);
+            printf("%s: quantized image to %d colors\n", imageName, num_colors);
+            *colorType = PNG_COLOR_TYPE_PALETTE;
         } else {
             *colorType = isOpaque ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
         }
@@ -972,7 +1147,7 @@ static void analyze_image(const char *imageName, image_info &imageInfo, int gray
 
 static void write_png(const char* imageName,
                       png_structp write_ptr, png_infop write_info,
-                      image_info& imageInfo, int grayscaleTolerance)
+                      image_info& imageInfo, int grayscaleTolerance, bool quantize)
 {
     bool optimize = true;
     png_uint_32 width, height;
@@ -1007,8 +1182,10 @@ static void write_png(const char* imageName,
     bool hasTransparency;
     int paletteEntries;
 
-    analyze_image(imageName, imageInfo, grayscaleTolerance, rgbPalette, alphaPalette,
-                  &paletteEntries, &hasTransparency, &color_type, outRows);
+    // 9-patches are written as RGBA, see below
+    analyze_image(imageName, imageInfo, grayscaleTolerance, quantize && !imageInfo.is9Patch,
+                  rgbPalette, alphaPalette, &paletteEntries, &hasTransparency, &color_type,
+                  outRows);
 
     // If the image is a 9-patch, we need to preserve it as a ARGB file to make
     // sure the pixels will not be pre-dithered/clamped until we decide they are
@@ -1209,7 +1386,7 @@ status_t preProcessImage(const Bundle* bundle, const sp<AaptAssets>& assets,
     }
 
     write_png(printableName.string(), write_ptr, write_info, imageInfo,
-              bundle->getGrayscaleTolerance());
+              bundle->getGrayscaleTolerance(), bundle->getQuantizePng());
 
     error = NO_ERROR;
 
@@ -1345,7 +1522,7 @@ status_t preProcessImageToCache(const Bundle* bundle, const String8& source, con
 
     // Actually write out to the new png
     write_png(dest.string(), write_ptr, write_info, imageInfo,
-              bundle->getGrayscaleTolerance());
+              bundle->getGrayscaleTolerance(), bundle->getQuantizePng());
 
     if (bundle->getVerbose()) {
         // Find the size of our new file
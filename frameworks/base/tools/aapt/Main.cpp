@@ -62,7 +62,7 @@ void usage(void)
         "        [--app-version VAL] [--app-version-name TEXT] [--custom-package VAL] \\\n"
         "        [--rename-manifest-package PACKAGE] \\\n"
         "        [--rename-instrumentation-target-package PACKAGE] \\\n"
-        "        [--utf16] [--auto-add-overlay] \\\n"
+        "        [--utf16] [--compact-styles] [--quantize-png] [--auto-add-overlay] \\\n"
         "        [--max-res-version VAL] \\\n"
         "        [-I base-package [-I base-package ...]] \\\n"
         "        [-A asset-source-dir]  [-G class-list-file] [-P public-definitions-file] \\\n"
@@ -179,6 +179,12 @@ void usage(void)
         "   --utf16\n"
         "       changes default encoding for resources to UTF-16.  Only useful when API\n"
         "       level is set to 7 or higher where the default encoding is UTF-8.\n"
+        "   --compact-styles\n"
+        "       Store the style spans of the strings that have the same spans, or none,\n"
+        "       only once in the resource table.\n"
+        "   --quantize-png\n"
+        "       Reduce the PNG files that have more than 256 colors to a palette of 256\n"
+        "       colors.  This is lossy, 9-patches are left as they are.\n"
         "   --non-constant-id\n"
         "       Make the resources ID non constant. This is required to make an R java class\n"
         "       that does not contain the final value but is used to make reusable compiled\n"
@@ -552,6 +558,8 @@ int main(int argc, char* const argv[])
                     bundle.setGenDependencies(true);
                 } else if (strcmp(cp, "-utf16") == 0) {
                     bundle.setWantUTF16(true);
+                } else if (strcmp(cp, "-compact-styles") == 0) {
+                    bundle.setCompactStyles(true);
                 } else if (strcmp(cp, "-preferred-configurations") == 0) {
                     argc--;
                     argv++;
@@ -605,6 +613,8 @@ int main(int argc, char* const argv[])
                     bundle.setNonConstantId(true);
                 } else if (strcmp(cp, "-no-crunch") == 0) {
                     bundle.setUseCrunchCache(true);
+                } else if (strcmp(cp, "-quantize-png") == 0) {
+                    bundle.setQuantizePng(true);
                 } else if (strcmp(cp, "-ignore-assets") == 0) {
                     argc--;
                     argv++;
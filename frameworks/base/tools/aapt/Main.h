@@ -51,6 +51,8 @@ extern bool isValidResourceType(const String8& type);
 
 ssize_t processAssets(Bundle* bundle, ZipFile* zip, const sp<AaptAssets>& assets);
 
+int getStorageAlignment(const String8& storageName);
+
 extern status_t filterResources(Bundle* bundle, const sp<AaptAssets>& assets);
 
 int dumpResources(Bundle* bundle);
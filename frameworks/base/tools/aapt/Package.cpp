@@ -20,6 +20,7 @@
 #include <dirent.h>
 #include <ctype.h>
 #include <errno.h>
+#include <zlib.h>
 
 using namespace android;
 
@@ -43,6 +44,8 @@ bool processFile(Bundle* bundle, ZipFile* zip,
                         const sp<AaptGroup>& group, const sp<AaptFile>& file);
 bool okayToCompress(Bundle* bundle, const String8& pathName);
 ssize_t processJarFiles(Bundle* bundle, ZipFile* zip);
+static bool sameEntryData(ZipFile* zip, const ZipEntry* entry, const sp<AaptFile>& file);
+static bool isAligned(const ZipEntry* entry, int alignment);
 
 /*
  * The directory hierarchy looks like this:
@@ -364,8 +367,16 @@ bool processFile(Bundle* bundle, ZipFile* zip,
                     entry->setMarked(true);
                     return true;
                 }
+            } else if (isAligned(entry, getStorageAlignment(storageName))
+                    && sameEntryData(zip, entry, file)) {
+                // Generated files that didn't change are kept, so that the
+                // entries after them don't have to be moved.
+                if (bundle->getVerbose()) {
+                    printf("      (not updating unchanged '%s')\n", storageName.string());
+                }
+                entry->setMarked(true);
+                return true;
             } else {
-                // Generated files are always replaced.
                 zip->remove(entry);
             }
         }
@@ -373,6 +384,7 @@ bool processFile(Bundle* bundle, ZipFile* zip,
 
     //android_setMinPriority(NULL, ANDROID_LOG_VERBOSE);
 
+    const int alignment = getStorageAlignment(storageName);
     if (fromGzip) {
         result = zip->addGzip(file->getSourceFile().string(), storageName.string(), &entry);
     } else if (!hasData) {
@@ -382,10 +394,10 @@ bool processFile(Bundle* bundle, ZipFile* zip,
             compressionMethod = ZipEntry::kCompressStored;
         }
         result = zip->add(file->getSourceFile().string(), storageName.string(), compressionMethod,
-                            &entry);
+                            &entry, alignment);
     } else {
         result = zip->add(file->getData(), file->getSize(), storageName.string(),
-                           file->getCompressionMethod(), &entry);
+                           file->getCompressionMethod(), &entry, alignment);
     }
     if (result == NO_ERROR) {
         if (bundle->getVerbose()) {
@@ -412,6 +424,48 @@ bool processFile(Bundle* bundle, ZipFile* zip,
     return true;
 }
 
+/*
+ * Returns true if the data of the archive entry is where it would be put
+ * when added again.  Only stored entries are aligned.
+ */
+static bool isAligned(const ZipEntry* entry, int alignment)
+{
+    return entry->getCompressionMethod() != ZipEntry::kCompressStored
+            || entry->getFileOffset() % alignment == 0;
+}
+
+/*
+ * Returns true if the archive entry holds exactly the generated data of
+ * "file", stored the way it would be added again.
+ */
+static bool sameEntryData(ZipFile* zip, const ZipEntry* entry, const sp<AaptFile>& file)
+{
+    if ((size_t) entry->getUncompressedLen() != file->getSize()) {
+        return false;
+    }
+    // deflated data that doesn't shrink is stored instead
+    if (entry->getCompressionMethod() != file->getCompressionMethod()
+            && entry->getCompressionMethod() != ZipEntry::kCompressStored) {
+        return false;
+    }
+
+    const Bytef* data = (const Bytef*) file->getData();
+    unsigned long crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, data, file->getSize());
+    if (crc != entry->getCRC32()) {
+        return false;
+    }
+
+    // the CRC doesn't prove it, compare the bytes
+    void* old = zip->uncompress(entry);
+    if (old == NULL) {
+        return false;
+    }
+    bool same = memcmp(old, data, file->getSize()) == 0;
+    free(old);
+    return same;
+}
+
 /*
  * Determine whether or not we want to try to compress this file based
  * on the file extension.
@@ -453,6 +507,19 @@ bool endsWith(const char* haystack, const char* needle)
     return strcasecmp(haystack+(a-b), needle) == 0;
 }
 
+/*
+ * Determine the alignment of the data of a stored file.  Native libraries
+ * and the resource table are mapped by whole pages, the other files are
+ * aligned for reading them in place.
+ */
+int getStorageAlignment(const String8& storageName)
+{
+    if (storageName == "resources.arsc" || endsWith(storageName.string(), ".so")) {
+        return ZipFile::kPageAlignment;
+    }
+    return 4;
+}
+
 ssize_t processJarFile(ZipFile* jar, ZipFile* out)
 {
     status_t err;
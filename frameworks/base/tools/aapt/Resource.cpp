@@ -16,6 +16,8 @@
 
 #include "WorkQueue.h"
 
+#include <utils/Timers.h>
+
 #if HAVE_PRINTF_ZD
 #  define ZD "%zd"
 #  define ZD_TYPE ssize_t
@@ -26,7 +28,7 @@
 
 #define NOISY(x) // x
 
-// Number of threads to use for preprocessing images.
+// Number of threads to use for preprocessing images and compiling XML files.
 static const size_t MAX_THREADS = 4;
 
 // ==========================================================================
@@ -375,6 +377,88 @@ status_t postProcessImages(const sp<AaptAssets>& assets,
     return (hasErrors || (res < NO_ERROR)) ? UNKNOWN_ERROR : NO_ERROR;
 }
 
+class CompileXmlWorkUnit : public WorkQueue::WorkUnit {
+public:
+    CompileXmlWorkUnit(const sp<AaptAssets>& assets, const sp<AaptFile>& file,
+            ResourceTable* table, Mutex* tableLock, int xmlFlags, volatile bool* hasErrors) :
+            mAssets(assets), mFile(file), mTable(table), mTableLock(tableLock),
+            mXmlFlags(xmlFlags), mHasErrors(hasErrors) {
+    }
+
+    virtual bool run() {
+        status_t status = compileXmlFile(mAssets, mFile, mTable, mXmlFlags, mTableLock);
+        if (status) {
+            *mHasErrors = true;
+        }
+        return true; // continue even if there are errors
+    }
+
+private:
+    sp<AaptAssets> mAssets;
+    sp<AaptFile> mFile;
+    ResourceTable* mTable;
+    Mutex* mTableLock;
+    int mXmlFlags;
+    volatile bool* mHasErrors;
+};
+
+static void checkForIds(const String8& path, ResXMLParser& parser);
+
+/*
+ * Compiles the XML files of a resource type in parallel.  Each file is
+ * compiled into its own AaptFile, so the output doesn't depend on the order
+ * the files are done in.  If checkIds is set, the compiled files are checked
+ * for missing ids afterwards, in order.
+ */
+static status_t compileXmlFiles(const sp<AaptAssets>& assets, const sp<ResourceTypeSet>& set,
+        const char* type, ResourceTable* table, int xmlFlags, bool checkIds)
+{
+    volatile bool hasErrors = false;
+    ssize_t res = NO_ERROR;
+    Mutex tableLock;
+    {
+        WorkQueue wq(MAX_THREADS, false);
+        ResourceDirIterator it(set, String8(type));
+        while ((res=it.next()) == NO_ERROR) {
+            CompileXmlWorkUnit* w = new CompileXmlWorkUnit(
+                    assets, it.getFile(), table, &tableLock, xmlFlags, &hasErrors);
+            status_t status = wq.schedule(w);
+            if (status) {
+                fprintf(stderr, "compileXmlFiles failed: schedule() returned %d\n", status);
+                hasErrors = true;
+                delete w;
+                break;
+            }
+        }
+        status_t status = wq.finish();
+        if (status) {
+            fprintf(stderr, "compileXmlFiles failed: finish() returned %d\n", status);
+            hasErrors = true;
+        }
+    }
+
+    if (checkIds && !hasErrors) {
+        ResourceDirIterator it(set, String8(type));
+        while (it.next() == NO_ERROR) {
+            ResXMLTree block;
+            block.setTo(it.getFile()->getData(), it.getFile()->getSize(), true);
+            checkForIds(it.getFile()->getPrintableSource(), block);
+        }
+    }
+    return (hasErrors || (res < NO_ERROR)) ? UNKNOWN_ERROR : NO_ERROR;
+}
+
+// Prints how long a phase of buildResources() took, in verbose mode, and
+// starts the next one.
+static void reportPhase(const Bundle* bundle, const char* phase, nsecs_t* start)
+{
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (bundle->getVerbose()) {
+        printf("  %s in %lld ms\n", phase, (long long) ns2ms(now - *start));
+    }
+    *start = now;
+}
+
 static void collect_files(const sp<AaptDir>& dir,
         KeyedVector<String8, sp<ResourceTypeSet> >* resources)
 {
@@ -908,6 +992,8 @@ status_t buildResources(Bundle* bundle, const sp<AaptAssets>& assets)
 
     NOISY(printf("Found %d included resource packages\n", (int)table.size()));
 
+    nsecs_t phaseStart = systemTime(SYSTEM_TIME_MONOTONIC);
+
     // Standard flags for compiled XML and optional UTF-8 encoding
     int xmlFlags = XML_COMPILE_STANDARD_RESOURCE;
 
@@ -1056,6 +1142,8 @@ status_t buildResources(Bundle* bundle, const sp<AaptAssets>& assets)
         }
     }
 
+    reportPhase(bundle, "Collected resource files", &phaseStart);
+
     // compile resources
     current = assets;
     while(current.get()) {
@@ -1078,6 +1166,8 @@ status_t buildResources(Bundle* bundle, const sp<AaptAssets>& assets)
         current = current->getOverlay();
     }
 
+    reportPhase(bundle, "Compiled values", &phaseStart);
+
     if (colors != NULL) {
         err = makeFileResources(bundle, assets, &table, colors, "color");
         if (err != NO_ERROR) {
@@ -1109,104 +1199,53 @@ status_t buildResources(Bundle* bundle, const sp<AaptAssets>& assets)
         }
     }
 
+    reportPhase(bundle, "Assigned resource ids", &phaseStart);
+
     // --------------------------------------------------------------
     // Finally, we can now we can compile XML files, which may reference
     // resources.
     // --------------------------------------------------------------
 
     if (layouts != NULL) {
-        ResourceDirIterator it(layouts, String8("layout"));
-        while ((err=it.next()) == NO_ERROR) {
-            String8 src = it.getFile()->getPrintableSource();
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err == NO_ERROR) {
-                ResXMLTree block;
-                block.setTo(it.getFile()->getData(), it.getFile()->getSize(), true);
-                checkForIds(src, block);
-            } else {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, layouts, "layout", &table, xmlFlags, true);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (anims != NULL) {
-        ResourceDirIterator it(anims, String8("anim"));
-        while ((err=it.next()) == NO_ERROR) {
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, anims, "anim", &table, xmlFlags, false);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (animators != NULL) {
-        ResourceDirIterator it(animators, String8("animator"));
-        while ((err=it.next()) == NO_ERROR) {
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, animators, "animator", &table, xmlFlags, false);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (interpolators != NULL) {
-        ResourceDirIterator it(interpolators, String8("interpolator"));
-        while ((err=it.next()) == NO_ERROR) {
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, interpolators, "interpolator", &table, xmlFlags, false);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (transitions != NULL) {
-        ResourceDirIterator it(transitions, String8("transition"));
-        while ((err=it.next()) == NO_ERROR) {
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, transitions, "transition", &table, xmlFlags, false);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (xmls != NULL) {
-        ResourceDirIterator it(xmls, String8("xml"));
-        while ((err=it.next()) == NO_ERROR) {
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, xmls, "xml", &table, xmlFlags, false);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (drawables != NULL) {
@@ -1217,39 +1256,21 @@ status_t buildResources(Bundle* bundle, const sp<AaptAssets>& assets)
     }
 
     if (colors != NULL) {
-        ResourceDirIterator it(colors, String8("color"));
-        while ((err=it.next()) == NO_ERROR) {
-          err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, colors, "color", &table, xmlFlags, false);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
     if (menus != NULL) {
-        ResourceDirIterator it(menus, String8("menu"));
-        while ((err=it.next()) == NO_ERROR) {
-            String8 src = it.getFile()->getPrintableSource();
-            err = compileXmlFile(assets, it.getFile(), &table, xmlFlags);
-            if (err != NO_ERROR) {
-                hasErrors = true;
-            }
-            ResXMLTree block;
-            block.setTo(it.getFile()->getData(), it.getFile()->getSize(), true);
-            checkForIds(src, block);
-        }
-
-        if (err < NO_ERROR) {
+        err = compileXmlFiles(assets, menus, "menu", &table, xmlFlags, true);
+        if (err != NO_ERROR) {
             hasErrors = true;
         }
-        err = NO_ERROR;
     }
 
+    reportPhase(bundle, "Compiled XML files", &phaseStart);
+
     if (table.validateLocalizations()) {
         hasErrors = true;
     }
@@ -1304,6 +1325,7 @@ status_t buildResources(Bundle* bundle, const sp<AaptAssets>& assets)
         if (err < NO_ERROR) {
             return err;
         }
+        reportPhase(bundle, "Flattened resource table", &phaseStart);
 
         if (bundle->getPublicOutputFile()) {
             FILE* fp = fopen(bundle->getPublicOutputFile(), "w+");
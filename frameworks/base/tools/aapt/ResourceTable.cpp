@@ -19,14 +19,15 @@
 status_t compileXmlFile(const sp<AaptAssets>& assets,
                         const sp<AaptFile>& target,
                         ResourceTable* table,
-                        int options)
+                        int options,
+                        Mutex* tableLock)
 {
     sp<XMLNode> root = XMLNode::parse(target);
     if (root == NULL) {
         return UNKNOWN_ERROR;
     }
     
-    return compileXmlFile(assets, root, target, table, options);
+    return compileXmlFile(assets, root, target, table, options, tableLock);
 }
 
 status_t compileXmlFile(const sp<AaptAssets>& assets,
@@ -47,7 +48,8 @@ status_t compileXmlFile(const sp<AaptAssets>& assets,
                         const sp<XMLNode>& root,
                         const sp<AaptFile>& target,
                         ResourceTable* table,
-                        int options)
+                        int options,
+                        Mutex* tableLock)
 {
     if ((options&XML_COMPILE_STRIP_WHITESPACE) != 0) {
         root->removeWhitespace(true, NULL);
@@ -61,6 +63,12 @@ status_t compileXmlFile(const sp<AaptAssets>& assets,
 
     bool hasErrors = false;
     
+    // The table and the included resources aren't thread safe, only the
+    // parsing and the flattening run in parallel.
+    if (tableLock != NULL) {
+        tableLock->lock();
+    }
+
     if ((options&XML_COMPILE_ASSIGN_ATTRIBUTE_IDS) != 0) {
         status_t err = root->assignResourceIds(assets, table);
         if (err != NO_ERROR) {
@@ -73,6 +81,10 @@ status_t compileXmlFile(const sp<AaptAssets>& assets,
         hasErrors = true;
     }
 
+    if (tableLock != NULL) {
+        tableLock->unlock();
+    }
+
     if (hasErrors) {
         return UNKNOWN_ERROR;
     }
@@ -2664,7 +2676,7 @@ status_t ResourceTable::flatten(Bundle* bundle, const sp<AaptFile>& dest)
 
     // Iterate through all data, collecting all values (strings,
     // references, etc).
-    StringPool valueStrings(useUTF8);
+    StringPool valueStrings(useUTF8, bundle->getCompactStyles());
     Vector<sp<Entry> > allEntries;
     for (pi=0; pi<N; pi++) {
         sp<Package> p = mOrderedPackages.itemAt(pi);
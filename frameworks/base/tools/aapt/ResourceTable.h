@@ -31,10 +31,13 @@ enum {
             | XML_COMPILE_STRIP_WHITESPACE | XML_COMPILE_STRIP_RAW_VALUES
 };
 
+// If tableLock is not NULL, it is held while the attributes are resolved
+// against the table, so that files can be compiled by several threads.
 status_t compileXmlFile(const sp<AaptAssets>& assets,
                         const sp<AaptFile>& target,
                         ResourceTable* table,
-                        int options = XML_COMPILE_STANDARD_RESOURCE);
+                        int options = XML_COMPILE_STANDARD_RESOURCE,
+                        Mutex* tableLock = NULL);
 
 status_t compileXmlFile(const sp<AaptAssets>& assets,
                         const sp<AaptFile>& target,
@@ -46,7 +49,8 @@ status_t compileXmlFile(const sp<AaptAssets>& assets,
                         const sp<XMLNode>& xmlTree,
                         const sp<AaptFile>& target,
                         ResourceTable* table,
-                        int options = XML_COMPILE_STANDARD_RESOURCE);
+                        int options = XML_COMPILE_STANDARD_RESOURCE,
+                        Mutex* tableLock = NULL);
 
 status_t compileResourceFile(Bundle* bundle,
                              const sp<AaptAssets>& assets,
@@ -1,6 +1,9 @@
 #include "SourcePos.h"
 
+#include <utils/threads.h>
+
 #include <stdarg.h>
+#include <algorithm>
 #include <vector>
 
 using namespace std;
@@ -26,6 +29,9 @@ struct ErrorPos
     void print(FILE* to) const;
 };
 
+// The errors are collected by the threads compiling XML files, and printed
+// sorted so that the report doesn't depend on the order they ran.
+static Mutex g_errorsLock;
 static vector<ErrorPos> g_errors;
 
 ErrorPos::ErrorPos()
@@ -80,6 +86,7 @@ ErrorPos::operator=(const ErrorPos& rhs)
     this->file = rhs.file;
     this->line = rhs.line;
     this->error = rhs.error;
+    this->fatal = rhs.fatal;
     return *this;
 }
 
@@ -130,6 +137,7 @@ SourcePos::error(const char* fmt, ...) const
         *p = '\0';
         p--;
     }
+    AutoMutex _l(g_errorsLock);
     g_errors.push_back(ErrorPos(this->file, this->line, String8(buf), true));
     return retval;
 }
@@ -155,12 +163,15 @@ SourcePos::warning(const char* fmt, ...) const
 bool
 SourcePos::hasErrors()
 {
+    AutoMutex _l(g_errorsLock);
     return g_errors.size() > 0;
 }
 
 void
 SourcePos::printErrors(FILE* to)
 {
+    AutoMutex _l(g_errorsLock);
+    stable_sort(g_errors.begin(), g_errors.end());
     vector<ErrorPos>::const_iterator it;
     for (it=g_errors.begin(); it!=g_errors.end(); it++) {
         it->print(to);
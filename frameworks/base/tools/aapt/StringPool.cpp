@@ -6,11 +6,15 @@
 
 #include "StringPool.h"
 #include "ResourceTable.h"
+#include "WorkQueue.h"
 
 #include <utils/ByteOrder.h>
 #include <utils/SortedVector.h>
 #include "qsort_r_compat.h"
 
+#include <map>
+#include <vector>
+
 #if HAVE_PRINTF_ZD
 #  define ZD "%zd"
 #  define ZD_TYPE ssize_t
@@ -21,6 +25,10 @@
 
 #define NOISY(x) //x
 
+// Pools with more strings than this are encoded to UTF-8 by several threads.
+static const size_t PARALLEL_ENCODE_MIN_STRINGS = 4096;
+static const size_t ENCODE_THREADS = 4;
+
 void strcpy16_htod(uint16_t* dst, const uint16_t* src)
 {
     while (*src) {
@@ -101,9 +109,69 @@ int StringPool::entry::compare(const entry& o) const {
     return 0;
 }
 
-StringPool::StringPool(bool utf8) :
-        mUTF8(utf8), mValues(-1)
+StringPool::StringPool(bool utf8, bool compactStyles) :
+        mUTF8(utf8), mCompactStyles(compactStyles), mValueCount(0)
+{
+}
+
+uint32_t StringPool::hashValue(const String16& value)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    const char16_t* str = value.string();
+    for (size_t i = 0; i < value.size(); i++) {
+        hash = (hash ^ str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+ssize_t StringPool::findValue(const String16& value, uint32_t hash) const
+{
+    const size_t N = mValues.size();
+    if (N == 0) {
+        return -1;
+    }
+    for (size_t i = hash & (N-1); ; i = (i+1) & (N-1)) {
+        const value_slot& slot = mValues[i];
+        if (slot.pos < 0) {
+            return -1;
+        }
+        if (slot.hash == hash && mEntries[mEntryArray[slot.pos]].value == value) {
+            return slot.pos;
+        }
+    }
+}
+
+void StringPool::addValue(uint32_t hash, ssize_t pos)
 {
+    if ((mValueCount+1)*2 > mValues.size()) {
+        growValues();
+    }
+    const size_t N = mValues.size();
+    size_t i = hash & (N-1);
+    while (mValues[i].pos >= 0) {
+        i = (i+1) & (N-1);
+    }
+    value_slot& slot = mValues.editItemAt(i);
+    slot.hash = hash;
+    slot.pos = pos;
+    mValueCount++;
+}
+
+void StringPool::growValues()
+{
+    Vector<value_slot> old(mValues);
+    value_slot empty;
+    empty.hash = 0;
+    empty.pos = -1;
+    mValues.clear();
+    mValues.insertAt(empty, 0, old.size() > 0 ? old.size()*2 : 64);
+    mValueCount = 0;
+    for (size_t i = 0; i < old.size(); i++) {
+        if (old[i].pos >= 0) {
+            addValue(old[i].hash, old[i].pos);
+        }
+    }
 }
 
 ssize_t StringPool::add(const String16& value, const Vector<entry_style_span>& spans,
@@ -119,8 +187,8 @@ ssize_t StringPool::add(const String16& value, const Vector<entry_style_span>& s
 ssize_t StringPool::add(const String16& value,
         bool mergeDuplicates, const String8* configTypeName, const ResTable_config* config)
 {
-    ssize_t vidx = mValues.indexOfKey(value);
-    ssize_t pos = vidx >= 0 ? mValues.valueAt(vidx) : -1;
+    const uint32_t hash = hashValue(value);
+    ssize_t pos = findValue(value, hash);
     ssize_t eidx = pos >= 0 ? mEntryArray.itemAt(pos) : -1;
     if (eidx < 0) {
         eidx = mEntries.add(entry(value));
@@ -161,20 +229,20 @@ ssize_t StringPool::add(const String16& value,
         }
     }
 
-    const bool first = vidx < 0;
+    const bool first = pos < 0;
     const bool styled = (pos >= 0 && (size_t)pos < mEntryStyleArray.size()) ?
         mEntryStyleArray[pos].spans.size() : 0;
     if (first || styled || !mergeDuplicates) {
         pos = mEntryArray.add(eidx);
         if (first) {
-            vidx = mValues.add(value, pos);
+            addValue(hash, pos);
         }
         entry& ent = mEntries.editItemAt(eidx);
         ent.indices.add(pos);
     }
 
-    NOISY(printf("Adding string %s to pool: pos=%d eidx=%d vidx=%d\n",
-            String8(value).string(), pos, eidx, vidx));
+    NOISY(printf("Adding string %s to pool: pos=%d eidx=%d\n",
+            String8(value).string(), pos, eidx));
     
     return pos;
 }
@@ -327,9 +395,10 @@ void StringPool::sortByConfig()
     mEntryArray = newEntryArray;
     mEntryStyleArray = newEntryStyleArray;
     mValues.clear();
+    mValueCount = 0;
     for (size_t i=0; i<mEntries.size(); i++) {
         const entry& ent = mEntries[i];
-        mValues.add(ent.value, ent.indices[0]);
+        addValue(hashValue(ent.value), ent.indices[0]);
     }
 
 #if 0
@@ -342,6 +411,64 @@ void StringPool::sortByConfig()
 #endif
 }
 
+class EncodeStringsWorkUnit : public WorkQueue::WorkUnit {
+public:
+    EncodeStringsWorkUnit(const Vector<StringPool::entry>& entries, String8* outEncoded,
+            size_t start, size_t end) :
+            mEntries(entries), mEncoded(outEncoded), mStart(start), mEnd(end) {
+    }
+
+    virtual bool run() {
+        for (size_t i = mStart; i < mEnd; i++) {
+            mEncoded[i] = String8(mEntries[i].value);
+        }
+        return true;
+    }
+
+private:
+    const Vector<StringPool::entry>& mEntries;
+    String8* mEncoded;
+    const size_t mStart;
+    const size_t mEnd;
+};
+
+/*
+ * Converts the unique strings to UTF-8, in the order of mEntries.  Each work
+ * unit fills its own range of the output, so the result doesn't depend on
+ * the order they run in.
+ */
+status_t StringPool::encodeStrings(Vector<String8>* outEncoded) const
+{
+    const size_t N = mEntries.size();
+    outEncoded->clear();
+    outEncoded->insertAt(String8(), 0, N);
+    String8* encoded = outEncoded->editArray();
+
+    if (N < PARALLEL_ENCODE_MIN_STRINGS) {
+        for (size_t i = 0; i < N; i++) {
+            encoded[i] = String8(mEntries[i].value);
+        }
+        return NO_ERROR;
+    }
+
+    // a few units per thread, so that an unlucky range doesn't hold up the others
+    const size_t chunk = (N + ENCODE_THREADS*4 - 1) / (ENCODE_THREADS*4);
+    WorkQueue wq(ENCODE_THREADS, false);
+    for (size_t start = 0; start < N; start += chunk) {
+        EncodeStringsWorkUnit* w = new EncodeStringsWorkUnit(mEntries, encoded,
+                start, start + chunk < N ? start + chunk : N);
+        status_t err = wq.schedule(w, 0);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "ERROR: encoding string pool failed: schedule() returned %d\n", err);
+            delete w;
+            wq.cancel();
+            wq.finish();
+            return err;
+        }
+    }
+    return wq.finish();
+}
+
 sp<AaptFile> StringPool::createStringBlock()
 {
     sp<AaptFile> pool = new AaptFile(String8(), AaptGroupEntry(),
@@ -400,6 +527,13 @@ status_t StringPool::writeStringBlock(const sp<AaptFile>& pool)
     // Now build the pool of unique strings.
 
     const size_t STRINGS = mEntries.size();
+    Vector<String8> encoded;
+    if (mUTF8) {
+        status_t err = encodeStrings(&encoded);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
     const size_t preSize = sizeof(ResStringPool_header)
                          + (sizeof(uint32_t)*ENTRIES)
                          + (sizeof(uint32_t)*STYLES);
@@ -419,7 +553,7 @@ status_t StringPool::writeStringBlock(const sp<AaptFile>& pool)
 
         String8 encStr;
         if (mUTF8) {
-            encStr = String8(ent.value);
+            encStr = encoded[i];
         }
 
         const size_t encSize = mUTF8 ? encStr.size() : 0;
@@ -473,12 +607,29 @@ status_t StringPool::writeStringBlock(const sp<AaptFile>& pool)
     // Build the pool of style spans.
 
     size_t styPos = strPos;
+    map<vector<uint32_t>, size_t> styleOffsets;
     for (i=0; i<STYLES; i++) {
         entry_style& ent = mEntryStyleArray.editItemAt(i);
         const size_t N = ent.spans.size();
         const size_t totalSize = (N*sizeof(ResStringPool_span))
                                + sizeof(ResStringPool_ref);
 
+        if (mCompactStyles) {
+            // the strings with the same spans point to the same copy of them
+            vector<uint32_t> key;
+            for (size_t i=0; i<N; i++) {
+                key.push_back(ent.spans[i].span.name.index);
+                key.push_back(ent.spans[i].span.firstChar);
+                key.push_back(ent.spans[i].span.lastChar);
+            }
+            map<vector<uint32_t>, size_t>::const_iterator it = styleOffsets.find(key);
+            if (it != styleOffsets.end()) {
+                ent.offset = it->second;
+                continue;
+            }
+            styleOffsets[key] = styPos-strPos;
+        }
+
         ent.offset = styPos-strPos;
         uint8_t* dat = (uint8_t*)pool->editData(preSize + styPos + totalSize);
         if (dat == NULL) {
@@ -566,7 +717,7 @@ ssize_t StringPool::offsetForString(const String16& val) const
 
 const Vector<size_t>* StringPool::offsetsForString(const String16& val) const
 {
-    ssize_t pos = mValues.valueFor(val);
+    ssize_t pos = findValue(val, hashValue(val));
     if (pos < 0) {
         return NULL;
     }
@@ -80,9 +80,11 @@ public:
 
     /**
      * If 'utf8' is true, strings will be encoded with UTF-8 instead of
-     * left in Java's native UTF-16.
+     * left in Java's native UTF-16.  If 'compactStyles' is true, the
+     * strings with the same style spans, or with none, share a single copy
+     * of them in the pool.
      */
-    explicit StringPool(bool utf8 = false);
+    explicit StringPool(bool utf8 = false, bool compactStyles = false);
 
     /**
      * Add a new string to the pool.  If mergeDuplicates is true, thenif
@@ -138,9 +140,22 @@ public:
     const Vector<size_t>* offsetsForString(const String16& val) const;
 
 private:
+    struct value_slot {
+        uint32_t hash;
+        ssize_t pos;            // -1 if the slot is empty
+    };
+
     static int config_sort(void* state, const void* lhs, const void* rhs);
 
+    static uint32_t hashValue(const String16& value);
+    ssize_t findValue(const String16& value, uint32_t hash) const;
+    void addValue(uint32_t hash, ssize_t pos);
+    void growValues();
+
+    status_t encodeStrings(Vector<String8>* outEncoded) const;
+
     const bool                              mUTF8;
+    const bool                              mCompactStyles;
 
     // The following data structures represent the actual structures
     // that will be generated for the final string pool.
@@ -164,8 +179,11 @@ private:
     // string pool is constructed.
 
     // Unique set of all the strings added to the pool, mapped to
-    // the first index of mEntryArray where the value was added.
-    DefaultKeyedVector<String16, ssize_t>   mValues;
+    // the first index of mEntryArray where the value was added.  This is
+    // an open addressing hash table, its size is a power of 2 and it is
+    // never more than half full.
+    Vector<value_slot>                      mValues;
+    size_t                                  mValueCount;
     // This array maps from the original position a string was placed at
     // in mEntryArray to its new position after being sorted with sortByConfig().
     Vector<size_t>                          mOriginalPosToNewPos;
@@ -357,7 +357,7 @@ bail:
  */
 status_t ZipFile::addCommon(const char* fileName, const void* data, size_t size,
     const char* storageName, int sourceType, int compressionMethod,
-    ZipEntry** ppEntry)
+    ZipEntry** ppEntry, int alignment)
 {
     ZipEntry* pEntry = NULL;
     status_t result = NO_ERROR;
@@ -371,6 +371,7 @@ status_t ZipFile::addCommon(const char* fileName, const void* data, size_t size,
 
     assert(compressionMethod == ZipEntry::kCompressDeflated ||
            compressionMethod == ZipEntry::kCompressStored);
+    assert(alignment >= 0 && kPageAlignment % (alignment > 0 ? alignment : 1) == 0);
 
     /* make sure we're in a reasonable state */
     assert(mZipFp != NULL);
@@ -442,6 +443,15 @@ status_t ZipFile::addCommon(const char* fileName, const void* data, size_t size,
         }
         /* handle "no compression" request, or failed compression from above */
         if (compressionMethod == ZipEntry::kCompressStored) {
+            int padding = alignment > 0 ?
+                    (alignment - startPosn % alignment) % alignment : 0;
+            if (padding > 0) {
+                /* pad the LFH "extra" field so the data starts aligned */
+                pEntry->addPadding(padding);
+                fseek(mZipFp, lfhPosn, SEEK_SET);
+                pEntry->mLFH.write(mZipFp);
+                startPosn = ftell(mZipFp);
+            }
             if (inputFp) {
                 result = copyFpToFp(mZipFp, inputFp, &crc);
             } else {
@@ -504,6 +514,8 @@ status_t ZipFile::addCommon(const char* fileName, const void* data, size_t size,
     mEOCD.mTotalNumEntries++;
     mEOCD.mCentralDirSize = 0;      // mark invalid; set by flush()
     mEOCD.mCentralDirOffset = endPosn;
+    if (alignment > 0)
+        mKeepAlignment = true;
 
     /*
      * Go back and write the LFH.
@@ -1012,11 +1024,40 @@ status_t ZipFile::crunchArchive(void)
             count--;
             i--;
         } else if (span != 0 && adjust > 0) {
+            /*
+             * Stored entries of an aligned archive are moved by whole
+             * pages, and the rest of the shift goes into the padding of
+             * their header, so that their data stays aligned.
+             */
+            long padding = 0;
+            if (mKeepAlignment &&
+                pEntry->getCompressionMethod() == ZipEntry::kCompressStored)
+            {
+                padding = adjust % kPageAlignment;
+                if (pEntry->mLFH.mExtraFieldLength + padding > 0xffff)
+                    padding = 0;
+            }
+
             /* shuffle this entry back */
             //printf("+++ Shuffling '%s' back %ld\n",
             //    pEntry->getFileName(), adjust);
-            result = filemove(mZipFp, pEntry->getLFHOffset() - adjust,
-                        pEntry->getLFHOffset(), span);
+            if (padding == 0) {
+                result = filemove(mZipFp, pEntry->getLFHOffset() - adjust,
+                            pEntry->getLFHOffset(), span);
+            } else {
+                long lfhPosn = pEntry->getLFHOffset() - adjust;
+                long hdrLen = pEntry->getFileOffset() - pEntry->getLFHOffset();
+                result = filemove(mZipFp, lfhPosn + hdrLen + padding,
+                            pEntry->getFileOffset(), span - hdrLen);
+                if (result == NO_ERROR) {
+                    pEntry->addPadding(padding);
+                    if (fseek(mZipFp, lfhPosn, SEEK_SET) != 0 ||
+                        pEntry->mLFH.write(mZipFp) != NO_ERROR)
+                    {
+                        result = UNKNOWN_ERROR;
+                    }
+                }
+            }
             if (result != NO_ERROR) {
                 /* this is why you use a temp file */
                 ALOGE("error during crunch - archive is toast\n");
@@ -1024,6 +1065,7 @@ status_t ZipFile::crunchArchive(void)
             }
 
             pEntry->setLFHOffset(pEntry->getLFHOffset() - adjust);
+            adjust -= padding;
         }
     }
 
@@ -44,7 +44,8 @@ namespace android {
 class ZipFile {
 public:
     ZipFile(void)
-      : mZipFp(NULL), mReadOnly(false), mNeedCDRewrite(false)
+      : mZipFp(NULL), mReadOnly(false), mNeedCDRewrite(false),
+        mKeepAlignment(false)
       {}
     ~ZipFile(void) {
         if (!mReadOnly)
@@ -65,6 +66,15 @@ public:
     };
     status_t open(const char* zipFileName, int flags);
 
+    /*
+     * The data of the uncompressed entries can be aligned, so that it can
+     * be mapped straight from the archive.  Every alignment must divide
+     * kPageAlignment.
+     */
+    enum {
+        kPageAlignment  = 4096,
+    };
+
     /*
      * Add a file to the end of the archive.  Specify whether you want the
      * library to try to store it compressed.
@@ -75,19 +85,24 @@ public:
      * If there is already an entry with the same name, the call fails.
      * Existing entries with the same name must be removed first.
      *
+     * If "alignment" is nonzero and the file ends up stored, the "extra"
+     * field of the header is padded so that the data starts at a multiple
+     * of "alignment".  Once an aligned entry has been added, flush() keeps
+     * the stored entries aligned when it moves them.
+     *
      * If "ppEntry" is non-NULL, a pointer to the new entry will be returned.
      */
     status_t add(const char* fileName, int compressionMethod,
-        ZipEntry** ppEntry)
+        ZipEntry** ppEntry, int alignment = 0)
     {
-        return add(fileName, fileName, compressionMethod, ppEntry);
+        return add(fileName, fileName, compressionMethod, ppEntry, alignment);
     }
     status_t add(const char* fileName, const char* storageName,
-        int compressionMethod, ZipEntry** ppEntry)
+        int compressionMethod, ZipEntry** ppEntry, int alignment = 0)
     {
         return addCommon(fileName, NULL, 0, storageName,
                          ZipEntry::kCompressStored,
-                         compressionMethod, ppEntry);
+                         compressionMethod, ppEntry, alignment);
     }
 
     /*
@@ -100,7 +115,7 @@ public:
     {
         return addCommon(fileName, NULL, 0, storageName,
                          ZipEntry::kCompressDeflated,
-                         ZipEntry::kCompressDeflated, ppEntry);
+                         ZipEntry::kCompressDeflated, ppEntry, 0);
     }
 
     /*
@@ -109,11 +124,11 @@ public:
      * If "ppEntry" is non-NULL, a pointer to the new entry will be returned.
      */
     status_t add(const void* data, size_t size, const char* storageName,
-        int compressionMethod, ZipEntry** ppEntry)
+        int compressionMethod, ZipEntry** ppEntry, int alignment = 0)
     {
         return addCommon(NULL, data, size, storageName,
                          ZipEntry::kCompressStored,
-                         compressionMethod, ppEntry);
+                         compressionMethod, ppEntry, alignment);
     }
 
     /*
@@ -223,7 +238,7 @@ private:
     /* common handler for all "add" functions */
     status_t addCommon(const char* fileName, const void* data, size_t size,
         const char* storageName, int sourceType, int compressionMethod,
-        ZipEntry** ppEntry);
+        ZipEntry** ppEntry, int alignment);
 
     /* copy all of "srcFp" into "dstFp" */
     status_t copyFpToFp(FILE* dstFp, FILE* srcFp, unsigned long* pCRC32);
@@ -257,6 +272,9 @@ private:
     /* set this when we trash the central dir */
     bool            mNeedCDRewrite;
 
+    /* set when an aligned entry was added; see crunchArchive() */
+    bool            mKeepAlignment;
+
     /*
      * One ZipEntry per entry in the zip file.  I'm using pointers instead
      * of objects because it's easier than making operator= work for the
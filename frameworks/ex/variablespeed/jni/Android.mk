@@ -34,6 +34,11 @@ LOCAL_SRC_FILES := \
     jni_entry.cc \
     decode_buffer.cc \
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+LOCAL_SRC_FILES += sola_kernels_neon.cc.neon
+LOCAL_CFLAGS += -DSOLA_NEON
+endif
+
 LOCAL_C_INCLUDES := \
     $(call include-path-for, wilhelm) \
     external/stlport/stlport \
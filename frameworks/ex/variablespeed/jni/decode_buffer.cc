@@ -80,6 +80,17 @@ void DecodeBuffer::PushValue(int16 value) {
   ++end_;
 }
 
+size_t DecodeBuffer::GetContiguousHead(const int16** data) const {
+  if (end_ == start_) {
+    *data = NULL;
+    return 0;
+  }
+  size_t offset = start_ % sizeOfOneBuffer_;
+  *data = data_.at(start_ / sizeOfOneBuffer_) + offset;
+  size_t count = sizeOfOneBuffer_ - offset;
+  return (count < end_ - start_) ? count : end_ - start_;
+}
+
 int16 DecodeBuffer::GetAtIndex(size_t index) {
   return data_.at((start_ + index) / sizeOfOneBuffer_)
       [(start_ + index) % sizeOfOneBuffer_];
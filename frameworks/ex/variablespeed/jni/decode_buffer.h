@@ -35,6 +35,9 @@ class DecodeBuffer {
   void Clear();
   void AdvanceHeadPointerShorts(size_t numberOfShorts);
   int16 GetAtIndex(size_t index);
+  // Returns the number of values stored contiguously from the head, and a
+  // pointer to the first of them in *data (NULL if the buffer is empty).
+  size_t GetContiguousHead(const int16** data) const;
   bool IsTooLarge() const;
   size_t GetTotalAdvancedCount() const;
 
@@ -98,6 +98,32 @@ void RingBuffer::Write(const float* samples, int num_frames) {
   head_logical_ += num_frames;
 }
 
+static void ConvertSamples(float* destination, const int16* source,
+                           int num_samples) {
+  for (int i = 0; i < num_samples; ++i) {
+    destination[i] = source[i];
+  }
+}
+
+void RingBuffer::Write(const int16* samples, int num_frames) {
+  if (!num_frames) {
+    return;
+  }
+  if (head_ + num_frames <= size_) {
+    ConvertSamples(samples_ + head_ * num_channels_, samples,
+                   num_frames * num_channels_);
+    head_ += num_frames;
+  } else {
+    int overhead = size_ - head_;
+    ConvertSamples(samples_ + head_ * num_channels_, samples,
+                   num_channels_ * overhead);
+    head_ = num_frames - overhead;
+    ConvertSamples(samples_, samples + overhead * num_channels_,
+                   num_channels_ * head_);
+  }
+  head_logical_ += num_frames;
+}
+
 void RingBuffer::Copy(int reader, float* destination, int num_frames) const {
   int pos = Tell(reader) % size_;
   if (pos + num_frames <= size_) {
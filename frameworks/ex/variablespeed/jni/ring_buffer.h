@@ -64,6 +64,11 @@ class RingBuffer {
   // @param num_frames number of frames to write.
   void Write(const float* samples, int num_frames);
 
+  // Writes 16-bit samples, converting them to float.
+  // @param samples int16 buffer containing the samples.
+  // @param num_frames number of frames to write.
+  void Write(const int16* samples, int num_frames);
+
   // Flushes the content of the buffer and reset the position of the heads.
   void Reset();
 
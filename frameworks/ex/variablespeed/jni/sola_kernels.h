@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORKS_EX_VARIABLESPEED_JNI_SOLA_KERNELS_H_
+#define FRAMEWORKS_EX_VARIABLESPEED_JNI_SOLA_KERNELS_H_
+
+// Inner loops of the SOLA time scaler, with a scalar implementation and,
+// when built with SOLA_NEON, a NEON one that handles the bulk of the data.
+
+namespace video_editing {
+
+// Returns the number of samples among the first num_samples of buffer1 and
+// buffer2 whose sign bits match.
+int CountMatchingSigns(const float* buffer1, const float* buffer2,
+                       int num_samples);
+
+// Linear cross-fade of num_frames interleaved frames of input into output,
+// in place: frame i is weighted i / fade_length for the input and
+// 1 - i / fade_length for the output.
+void CrossFade(float* output, const float* input, int num_frames,
+               int num_channels, int fade_length);
+
+#ifdef SOLA_NEON
+// NEON versions of the above. They process a prefix of the data and return
+// how much they did (in samples, respectively frames); the caller finishes
+// the rest. CrossFadeNEON only handles mono and stereo, and returns 0 for
+// other channel counts.
+int CountMatchingSignsNEON(const float* buffer1, const float* buffer2,
+                           int num_samples, int* num_done);
+int CrossFadeNEON(float* output, const float* input, int num_frames,
+                  int num_channels, int fade_length);
+#endif
+
+}  // namespace video_editing
+
+#endif  // FRAMEWORKS_EX_VARIABLESPEED_JNI_SOLA_KERNELS_H_
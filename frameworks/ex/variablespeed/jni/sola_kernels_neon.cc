@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sola_kernels.h"
+
+#include <arm_neon.h>
+
+namespace video_editing {
+
+int CountMatchingSignsNEON(const float* buffer1, const float* buffer2,
+                           int num_samples, int* num_done) {
+  const uint32_t* in1 = reinterpret_cast<const uint32_t*>(buffer1);
+  const uint32_t* in2 = reinterpret_cast<const uint32_t*>(buffer2);
+
+  // Each lane counts the mismatching sign bits of its samples. A lane can't
+  // overflow, the overlap is at most a few thousand samples.
+  uint32x4_t mismatches = vdupq_n_u32(0);
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    uint32x4_t x0 = veorq_u32(vld1q_u32(in1 + i), vld1q_u32(in2 + i));
+    uint32x4_t x1 = veorq_u32(vld1q_u32(in1 + i + 4), vld1q_u32(in2 + i + 4));
+    mismatches = vsraq_n_u32(mismatches, x0, 31);
+    mismatches = vsraq_n_u32(mismatches, x1, 31);
+  }
+
+  uint32x2_t sum = vadd_u32(vget_low_u32(mismatches),
+                            vget_high_u32(mismatches));
+  sum = vpadd_u32(sum, sum);
+
+  *num_done = i;
+  return i - static_cast<int>(vget_lane_u32(sum, 0));
+}
+
+int CrossFadeNEON(float* output, const float* input, int num_frames,
+                  int num_channels, int fade_length) {
+  // Frame index of each lane, and how much it moves per vector of 4 samples.
+  float32x4_t index;
+  float step;
+  if (num_channels == 1) {
+    static const float kMono[4] = { 0.f, 1.f, 2.f, 3.f };
+    index = vld1q_f32(kMono);
+    step = 4.f;
+  } else if (num_channels == 2) {
+    static const float kStereo[4] = { 0.f, 0.f, 1.f, 1.f };
+    index = vld1q_f32(kStereo);
+    step = 2.f;
+  } else {
+    return 0;
+  }
+
+  const float32x4_t inverse_length =
+      vdupq_n_f32(1.f / static_cast<float>(fade_length));
+  const float32x4_t index_step = vdupq_n_f32(step);
+  const int frames_per_vector = 4 / num_channels;
+
+  int frame = 0;
+  for (; frame + frames_per_vector <= num_frames;
+       frame += frames_per_vector) {
+    float32x4_t input_scale = vmulq_f32(index, inverse_length);
+    float32x4_t out = vld1q_f32(output);
+    float32x4_t in = vld1q_f32(input);
+    // out * (1 - scale) + in * scale
+    out = vmlaq_f32(out, vsubq_f32(in, out), input_scale);
+    vst1q_f32(output, out);
+    output += 4;
+    input += 4;
+    index = vaddq_f32(index, index_step);
+  }
+  return frame;
+}
+
+}  // namespace video_editing
@@ -17,25 +17,33 @@
 #include "sola_time_scaler.h"
 
 #include <math.h>
+#include <stdlib.h>
 #include <hlogging.h>
 #include <algorithm>
 
 #include "ring_buffer.h"
+#include "sola_kernels.h"
 
 #define FLAGS_sola_ring_buffer 2.0
 #define FLAGS_sola_enable_correlation true
+// Offsets tried by the first pass of the correlation search are this many
+// frames apart; the second pass tries every offset around the best of those.
+#define FLAGS_sola_coarse_search_step 4
 
 
 namespace video_editing {
 
-// Returns a cross-correlation score for the specified buffers.
-int SolaAnalyzer::Correlate(const float* buffer1, const float* buffer2,
-                            int num_frames) {
-  CHECK(initialized_);
-
+int CountMatchingSigns(const float* buffer1, const float* buffer2,
+                       int num_samples) {
   int score = 0;
-  num_frames *= num_channels_;
-  while (num_frames-- > 0) {
+#ifdef SOLA_NEON
+  int num_done;
+  score = CountMatchingSignsNEON(buffer1, buffer2, num_samples, &num_done);
+  buffer1 += num_done;
+  buffer2 += num_done;
+  num_samples -= num_done;
+#endif
+  while (num_samples-- > 0) {
     // Increment the score if the sign bits match.
     score += ((bit_cast<int32>(*buffer1++) ^ bit_cast<int32>(*buffer2++)) >= 0)
               ? 1 : 0;
@@ -43,6 +51,34 @@ int SolaAnalyzer::Correlate(const float* buffer1, const float* buffer2,
   return score;
 }
 
+void CrossFade(float* output, const float* input, int num_frames,
+               int num_channels, int fade_length) {
+  int i = 0;
+#ifdef SOLA_NEON
+  i = CrossFadeNEON(output, input, num_frames, num_channels, fade_length);
+  output += i * num_channels;
+  input += i * num_channels;
+#endif
+  float flt_count = static_cast<float>(fade_length);
+  for (; i < num_frames; ++i) {
+    // Linear cross-fade, for now.
+    float input_scale = static_cast<float>(i) / flt_count;
+    float output_scale = 1. - input_scale;
+    for (int j = 0; j < num_channels; ++j) {
+      *output = (*output * output_scale) + (*input++ * input_scale);
+      ++output;
+    }
+  }
+}
+
+// Returns a cross-correlation score for the specified buffers.
+int SolaAnalyzer::Correlate(const float* buffer1, const float* buffer2,
+                            int num_frames) {
+  CHECK(initialized_);
+
+  return CountMatchingSigns(buffer1, buffer2, num_frames * num_channels_);
+}
+
 // Trivial SolaAnalyzer class to bypass correlation.
 class SolaBypassAnalyzer : public SolaAnalyzer {
  public:
@@ -224,6 +260,22 @@ int SolaTimeScaler::InjectSamples(float* buffer, int num_frames) {
   return num_frames;
 }
 
+// Feeds 16-bit audio to the timescaler, and processes as much data as possible.
+int SolaTimeScaler::InjectSamples(const int16* buffer, int num_frames) {
+  CHECK(initialized_);
+
+  // Do not write more frames than the buffer can accept.
+  num_frames = min(input_limit(), num_frames);
+  if (!num_frames) {
+    return 0;
+  }
+
+  // Convert samples straight into the input buffer and then process.
+  input_buffer_->Write(buffer, num_frames);
+  Process();
+  return num_frames;
+}
+
 // Retrieves audio data from the timescaler.
 int SolaTimeScaler::RetrieveSamples(float* buffer, int num_frames) {
   CHECK(initialized_);
@@ -241,6 +293,40 @@ int SolaTimeScaler::RetrieveSamples(float* buffer, int num_frames) {
   return num_frames;
 }
 
+// Correlates the input with the output at offsets center - radius to
+// center + radius, step frames apart, working from the center out.
+// Updates the best offset and score if a better score is found.
+void SolaTimeScaler::SearchCorrelation(const float* input_pointer,
+                                       const float* output_pointer,
+                                       int center, int radius, int step,
+                                       int* best_offset, int* best_score) {
+  const int perfect_score = num_overlap_frames_ * num_channels_;
+  for (int i = 0; i <= radius; i += step) {
+    int score = analyzer_->Correlate(input_pointer,
+        output_pointer + ((center + i) * num_channels_),
+        num_overlap_frames_);
+    if (score > *best_score) {
+      *best_score = score;
+      *best_offset = center + i;
+      if (score == perfect_score) {
+        return;  // It doesn't get better than perfect.
+      }
+    }
+    if (i > 0) {
+      score = analyzer_->Correlate(input_pointer,
+          output_pointer + ((center - i) * num_channels_),
+          num_overlap_frames_);
+      if (score > *best_score) {
+        *best_score = score;
+        *best_offset = center - i;
+        if (score == perfect_score) {
+          return;  // It doesn't get better than perfect.
+        }
+      }
+    }
+  }
+}
+
 // Munges input samples to produce output.
 bool SolaTimeScaler::Process() {
   CHECK(initialized_);
@@ -277,32 +363,24 @@ bool SolaTimeScaler::Process() {
 
     if ((output_merge_cnt >= (2 * num_overlap_frames_)) &&
         (input_count >= num_overlap_frames_)) {
+      // Coarse pass over the whole search range, then a fine pass around
+      // the best coarse offset.
       int best_offset = merge_offset;
       int best_score = 0;
-      int score;
-      for (int i = 0; i <= half_overlap_frames_; ++i) {
-        score = analyzer_->Correlate(input_pointer,
-            output_pointer + ((merge_offset + i) * num_channels_),
-            num_overlap_frames_);
-        if (score > best_score) {
-          best_score = score;
-          best_offset = merge_offset + i;
-          if (score == (num_overlap_frames_ * num_channels_)) {
-            break;  // It doesn't get better than perfect.
-          }
-        }
-        if (i > 0) {
-          score = analyzer_->Correlate(input_pointer,
-              output_pointer + ((merge_offset - i) * num_channels_),
-              num_overlap_frames_);
-          if (score > best_score) {
-            best_score = score;
-            best_offset = merge_offset - i;
-            if (score == (num_overlap_frames_ * num_channels_)) {
-              break;  // It doesn't get better than perfect.
-            }
-          }
-        }
+      int step = min(FLAGS_sola_coarse_search_step, half_overlap_frames_);
+      if (step > 1) {
+        SearchCorrelation(input_pointer, output_pointer, merge_offset,
+                          half_overlap_frames_, step,
+                          &best_offset, &best_score);
+      } else {
+        step = half_overlap_frames_ + 1;
+      }
+      if (best_score < num_overlap_frames_ * num_channels_) {
+        int center = best_offset;
+        int radius = min(step - 1,
+            half_overlap_frames_ - abs(center - merge_offset));
+        SearchCorrelation(input_pointer, output_pointer, center, radius, 1,
+                          &best_offset, &best_score);
       }
       merge_offset = best_offset;
     } else if ((output_merge_cnt > 0) && !draining_) {
@@ -316,17 +394,9 @@ bool SolaTimeScaler::Process() {
     int remaining_count = input_count - crossfade_count;
 
     float* merge_pointer = output_pointer + (merge_offset * num_channels_);
-    float flt_count = static_cast<float>(crossfade_count);
-    for (int i = 0; i < crossfade_count; ++i) {
-      // Linear cross-fade, for now.
-      float input_scale = static_cast<float>(i) / flt_count;
-      float output_scale = 1. - input_scale;
-      for (int j = 0; j < num_channels_; ++j) {
-        *merge_pointer = (*merge_pointer * output_scale) +
-                         (*input_pointer++ * input_scale);
-        ++merge_pointer;
-      }
-    }
+    CrossFade(merge_pointer, input_pointer, crossfade_count, num_channels_,
+              crossfade_count);
+    input_pointer += crossfade_count * num_channels_;
     // Copy the merged buffer back into the output, if necessary, and
     // append the rest of the window.
     output_buffer_->MergeBack(kOutputAnalysis,
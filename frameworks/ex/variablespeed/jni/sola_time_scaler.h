@@ -24,6 +24,7 @@
 #include <list>
 #include <vector>
 
+#include "integral_types.h"
 #include "macros.h"
 
 // Time-domain audio playback rate scaler using phase-aligned Synchronized
@@ -108,6 +109,13 @@ class SolaTimeScaler {
   // @returns number of frames actually accepted
   int InjectSamples(float* buffer, int num_frames);
 
+  // Same as above, for 16-bit input samples. The samples are converted as
+  // they are written to the input buffer, without an intermediate copy.
+  // @param buffer pointer to interleaved 16-bit input samples
+  // @param num_frames number of frames (num_samples / num_channels)
+  // @returns number of frames actually accepted
+  int InjectSamples(const int16* buffer, int num_frames);
+
   // Retrieves audio data from the timescaler.
   // @param buffer pointer to buffer to receive interleaved float output
   // @param num_frames maximum desired number of frames
@@ -153,6 +161,13 @@ class SolaTimeScaler {
   // Generates processing parameters from the current settings.
   void GenerateParameters();
 
+  // Correlates the input with the output at offsets within radius frames of
+  // center, step frames apart, and updates the best offset and score.
+  void SearchCorrelation(const float* input_pointer,
+                         const float* output_pointer,
+                         int center, int radius, int step,
+                         int* best_offset, int* best_score);
+
   // Munges input samples to produce output.
   // @returns true if any output samples were generated
   bool Process();
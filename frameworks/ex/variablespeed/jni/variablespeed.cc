@@ -424,10 +424,22 @@ bool AudioEngine::EnqueueNextBufferOfAudio(
       // No more frames left to inject.
       break;
     }
-    for (size_t i = 0; i < framesToInject * channels; ++i) {
-      injectBuffer_[i] = decodeBuffer_.GetAtIndex(i);
+    // Hand the scaler the decoded samples in place, as long as whole frames
+    // are contiguous; a frame split across two decode buffer chunks goes
+    // through injectBuffer_.
+    const int16* contiguous;
+    size_t contiguousFrames =
+        decodeBuffer_.GetContiguousHead(&contiguous) / channels;
+    int count;
+    if (contiguousFrames > 0) {
+      count = GetTimeScaler()->InjectSamples(contiguous,
+          min(framesToInject, contiguousFrames));
+    } else {
+      for (size_t i = 0; i < channels; ++i) {
+        injectBuffer_[i] = decodeBuffer_.GetAtIndex(i);
+      }
+      count = GetTimeScaler()->InjectSamples(injectBuffer_, 1);
     }
-    int count = GetTimeScaler()->InjectSamples(injectBuffer_, framesToInject);
     if (count <= 0) {
       LOGD("error: count was %d", count);
       break;
@@ -16,6 +16,8 @@
 
 #include "jni/jni_stochastic_linear_ranker.h"
 #include "native/common_defs.h"
+#include "native/dense_weight_vector.h"
+#include "native/hashed_linear_ranker.h"
 #include "native/sparse_weight_vector.h"
 #include "native/stochastic_linear_ranker.h"
 
@@ -26,6 +28,9 @@ using std::vector;
 using std::hash_map;
 using learning_stochastic_linear::StochasticLinearRanker;
 using learning_stochastic_linear::SparseWeightVector;
+using learning_stochastic_linear::HashedLinearRanker;
+using learning_stochastic_linear::HashedFeatureVector;
+using learning_stochastic_linear::DenseWeightVector;
 
 void CreateSparseWeightVector(JNIEnv* env, const jobjectArray keys, const float* values,
     const int length, SparseWeightVector<string> * sample) {
@@ -460,3 +465,208 @@ jfloat Java_android_bordeaux_learning_StochasticLinearRanker_nativeScoreSample(
   }
   return -1;
 }
+
+// Hashed ranker
+
+bool CreateHashedFeatureVector(JNIEnv* env, const jintArray ids, const jfloatArray values,
+    HashedFeatureVector* sample) {
+
+  const int length = env->GetArrayLength(ids);
+  if (length != env->GetArrayLength(values)) {
+    return false;
+  }
+  sample->indices.resize(length);
+  sample->values.resize(length);
+  if (length > 0) {
+    env->GetIntArrayRegion(ids, 0, length, reinterpret_cast<jint*>(&sample->indices[0]));
+    env->GetFloatArrayRegion(values, 0, length, &sample->values[0]);
+  }
+  return true;
+}
+
+jint Java_android_bordeaux_learning_StochasticLinearRanker_initNativeHashedClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jint numBits) {
+  HashedLinearRanker* classifier = new HashedLinearRanker(numBits);
+  return ((jint) classifier);
+}
+
+jboolean Java_android_bordeaux_learning_StochasticLinearRanker_deleteNativeHashedClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jint paPtr) {
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+  delete classifier;
+  return JNI_TRUE;
+}
+
+jboolean Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedUpdateClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jintArray id_array_positive,
+    jfloatArray value_array_positive,
+    jintArray id_array_negative,
+    jfloatArray value_array_negative,
+    jint paPtr) {
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+
+  if (classifier && id_array_positive && value_array_positive &&
+      id_array_negative && value_array_negative) {
+    HashedFeatureVector sample_pos;
+    HashedFeatureVector sample_neg;
+    if (CreateHashedFeatureVector(env, id_array_positive, value_array_positive, &sample_pos) &&
+        CreateHashedFeatureVector(env, id_array_negative, value_array_negative, &sample_neg)) {
+      return classifier->UpdateClassifier(sample_pos, sample_neg) >= 0 ? JNI_TRUE : JNI_FALSE;
+    }
+  }
+  return JNI_FALSE;
+}
+
+jboolean Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedScoreSamples(
+    JNIEnv* env,
+    jobject thiz,
+    jintArray id_array,
+    jfloatArray value_array,
+    jintArray offset_array,
+    jfloatArray score_array,
+    jint paPtr) {
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+
+  if (!classifier || !id_array || !value_array || !offset_array || !score_array) {
+    return JNI_FALSE;
+  }
+  const int ids_len = env->GetArrayLength(id_array);
+  const int count = env->GetArrayLength(score_array);
+  if (env->GetArrayLength(value_array) != ids_len ||
+      env->GetArrayLength(offset_array) != count + 1) {
+    return JNI_FALSE;
+  }
+
+  // Candidates are scored straight out of the Java arrays, without copies.
+  jint* offsets = (jint*) env->GetPrimitiveArrayCritical(offset_array, NULL);
+  jint* ids = (jint*) env->GetPrimitiveArrayCritical(id_array, NULL);
+  jfloat* values = (jfloat*) env->GetPrimitiveArrayCritical(value_array, NULL);
+  jfloat* scores = (jfloat*) env->GetPrimitiveArrayCritical(score_array, NULL);
+
+  jboolean ok = offsets && ids && values && scores;
+  for (int i = 0; ok && i < count; ++i) {
+    ok = offsets[i] >= 0 && offsets[i] <= offsets[i + 1] && offsets[i + 1] <= ids_len;
+  }
+  if (ok) {
+    classifier->ScoreSamples(reinterpret_cast<const uint32*>(ids), values, offsets, count,
+        scores);
+  }
+
+  if (scores) env->ReleasePrimitiveArrayCritical(score_array, scores, ok ? 0 : JNI_ABORT);
+  if (values) env->ReleasePrimitiveArrayCritical(value_array, values, JNI_ABORT);
+  if (ids) env->ReleasePrimitiveArrayCritical(id_array, ids, JNI_ABORT);
+  if (offsets) env->ReleasePrimitiveArrayCritical(offset_array, offsets, JNI_ABORT);
+  return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+jint Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedGetLengthClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jint paPtr) {
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+  return classifier->GetWeights().Size();
+}
+
+jfloat Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedGetWeightClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jfloatArray weight_array,
+    jint paPtr) {
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+  const DenseWeightVector& weights = classifier->GetWeights();
+  if (weight_array && env->GetArrayLength(weight_array) == (int) weights.Size()) {
+    env->SetFloatArrayRegion(weight_array, 0, weights.Size(), weights.GetData());
+  }
+  return weights.GetNormalizer();
+}
+
+jboolean Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedSetWeightClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jfloatArray weight_array,
+    jfloat normalizer,
+    jint paPtr) {
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+  if (classifier && weight_array && normalizer) {
+    const int length = env->GetArrayLength(weight_array);
+    jfloat* weights = env->GetFloatArrayElements(weight_array, NULL);
+    if (weights) {
+      bool ok = classifier->LoadWeights(weights, length, normalizer);
+      env->ReleaseFloatArrayElements(weight_array, weights, JNI_ABORT);
+      return ok ? JNI_TRUE : JNI_FALSE;
+    }
+  }
+  return JNI_FALSE;
+}
+
+jboolean Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedSetParameterClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jstring key,
+    jstring value,
+    jint paPtr) {
+
+  HashedLinearRanker* classifier = (HashedLinearRanker*) paPtr;
+  const char *cKey = env->GetStringUTFChars(key, NULL);
+  const char *cValue = env->GetStringUTFChars(value, NULL);
+  float v;
+  jboolean result = JNI_TRUE;
+  if (strcmp(cKey, ITR_NUM) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetIterationNumber((uint64) v);
+  } else if (strcmp(cKey, NORM_CONSTRAINT) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetNormConstraint((double) v);
+  } else if (strcmp(cKey, LAMBDA) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetLambda((double) v);
+  } else if (strcmp(cKey, ADAPT_MODE) == 0) {
+    if (strcmp(cValue, ADAPT_MODE_CONST) == 0)
+      classifier->SetAdaptationMode(learning_stochastic_linear::CONST);
+    else if (strcmp(cValue, ADAPT_MODE_INV_LINEAR) == 0)
+      classifier->SetAdaptationMode(learning_stochastic_linear::INV_LINEAR);
+    else if (strcmp(cValue, ADAPT_MODE_INV_QUADRATIC) == 0)
+      classifier->SetAdaptationMode(learning_stochastic_linear::INV_QUADRATIC);
+    else if (strcmp(cValue, ADAPT_MODE_INV_SQRT) == 0)
+      classifier->SetAdaptationMode(learning_stochastic_linear::INV_SQRT);
+    else {
+      ALOGE("Error: %s is not an Adaptation Mode", cValue);
+      result = JNI_FALSE;
+    }
+  } else if (strcmp(cKey, KERNEL_TYPE) == 0) {
+    if (strcmp(cValue, KERNEL_TYPE_LINEAR) == 0)
+      classifier->SetKernelType(learning_stochastic_linear::LINEAR);
+    else if (strcmp(cValue, KERNEL_TYPE_POLY) == 0)
+      classifier->SetKernelType(learning_stochastic_linear::POLY);
+    else if (strcmp(cValue, KERNEL_TYPE_RBF) == 0)
+      classifier->SetKernelType(learning_stochastic_linear::RBF);
+    else {
+      ALOGE("Error: %s is not a Kernel Type", cValue);
+      result = JNI_FALSE;
+    }
+  } else if (strcmp(cKey, KERNEL_PARAM) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetKernelParam((double) v);
+  } else if (strcmp(cKey, KERNEL_GAIN) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetKernelGain((double) v);
+  } else if (strcmp(cKey, KERNEL_BIAS) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetKernelBias((double) v);
+  } else if (strcmp(cKey, MIN_BATCH_SIZE) == 0) {
+    sscanf(cValue, "%f", &v);
+    classifier->SetMiniBatchSize((uint64) v);
+  } else {
+    ALOGE("Error: %s is not a hashed ranker parameter", cKey);
+    result = JNI_FALSE;
+  }
+  env->ReleaseStringUTFChars(value, cValue);
+  env->ReleaseStringUTFChars(key, cKey);
+  return result;
+}
@@ -175,6 +175,78 @@ Java_android_bordeaux_learning_StochasticLinearRanker_nativeSetParameterClassifi
     jstring value,
     jint paPtr);
 
+/*  Hashed ranker: features are interned integer ids (for instance String.hashCode(), which
+    Java caches), masked to 2^numBits slots of a dense weight vector. Only the SL update
+    with the PAIRWISE loss and L2 regularization is supported. Parameters use the keys
+    above, except RegularizationType, UpdateType, LossType, AcceptaceProbability and
+    GradientL0Nrom. */
+
+JNIEXPORT jint JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_initNativeHashedClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jint numBits);
+
+JNIEXPORT jboolean JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_deleteNativeHashedClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jint paPtr);
+
+JNIEXPORT jboolean JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedUpdateClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jintArray id_array_positive,
+    jfloatArray value_array_positive,
+    jintArray id_array_negative,
+    jfloatArray value_array_negative,
+    jint paPtr);
+
+/*  Scores a batch of candidates. The features of candidate i are ids[offsets[i]] to
+    ids[offsets[i + 1] - 1] with the matching values; offsets has one more entry than
+    scores. */
+JNIEXPORT jboolean JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedScoreSamples(
+    JNIEnv* env,
+    jobject thiz,
+    jintArray id_array,
+    jfloatArray value_array,
+    jintArray offset_array,
+    jfloatArray score_array,
+    jint paPtr);
+
+/*  Returns the number of weights, 2^numBits. */
+JNIEXPORT jint JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedGetLengthClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jint paPtr);
+
+/*  Copies the weights to weight_array and returns the normalizer. */
+JNIEXPORT jfloat JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedGetWeightClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jfloatArray weight_array,
+    jint paPtr);
+
+JNIEXPORT jboolean JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedSetWeightClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jfloatArray weight_array,
+    jfloat normalizer,
+    jint paPtr);
+
+JNIEXPORT jboolean JNICALL
+Java_android_bordeaux_learning_StochasticLinearRanker_nativeHashedSetParameterClassifier(
+    JNIEnv* env,
+    jobject thiz,
+    jstring key,
+    jstring value,
+    jint paPtr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dense_weight_vector.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace learning_stochastic_linear {
+
+// Max/Min permitted values of normalizer_ for preventing under/overflows.
+static double kNormalizerMin = 1e-20;
+static double kNormalizerMax = 1e20;
+
+uint32 HashFeatureName(const char *name, int num_bits) {
+  // 32 bit FNV-1a
+  uint32 hash = 2166136261u;
+  for (const unsigned char *p = reinterpret_cast<const unsigned char *>(name);
+       *p != '\0'; ++p) {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash & ((1u << num_bits) - 1);
+}
+
+DenseWeightVector::DenseWeightVector(int num_bits)
+    : num_bits_(num_bits),
+      mask_((1u << num_bits) - 1),
+      w_(static_cast<size_t>(1) << num_bits, 0.0f),
+      normalizer_(1.0) {
+}
+
+bool DenseWeightVector::Load(const float *weights, size_t size,
+                             double normalizer) {
+  if (size != w_.size()) {
+    ALOGE("Expected %zu weights, got %zu", w_.size(), size);
+    return false;
+  }
+  memcpy(&w_[0], weights, size * sizeof(float));
+  normalizer_ = normalizer;
+  return true;
+}
+
+void DenseWeightVector::Clear() {
+  memset(&w_[0], 0, w_.size() * sizeof(float));
+  normalizer_ = 1.0;
+}
+
+void DenseWeightVector::CopyFrom(const DenseWeightVector &other) {
+  num_bits_ = other.num_bits_;
+  mask_ = other.mask_;
+  w_ = other.w_;
+  normalizer_ = other.normalizer_;
+}
+
+bool DenseWeightVector::IsValid() const {
+  if (isnan(normalizer_) || isinf(normalizer_))
+    return false;
+  for (size_t i = 0; i < w_.size(); ++i) {
+    if (isnan(w_[i]) || isinf(w_[i]))
+      return false;
+  }
+  return true;
+}
+
+void DenseWeightVector::ResetNormalizer() {
+  const float inv = static_cast<float>(1.0 / normalizer_);
+  for (size_t i = 0; i < w_.size(); ++i) {
+    w_[i] *= inv;
+  }
+  normalizer_ = 1.0;
+}
+
+double DenseWeightVector::DotProduct(const uint32 *index, const float *value,
+                                     size_t n) const {
+  const float *w = &w_[0];
+  // Four independent accumulators so the gathers and multiply-adds of
+  // consecutive features can overlap.
+  float acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc0 += w[index[i] & mask_] * value[i];
+    acc1 += w[index[i + 1] & mask_] * value[i + 1];
+    acc2 += w[index[i + 2] & mask_] * value[i + 2];
+    acc3 += w[index[i + 3] & mask_] * value[i + 3];
+  }
+  for (; i < n; ++i) {
+    acc0 += w[index[i] & mask_] * value[i];
+  }
+  return ((acc0 + acc1) + (acc2 + acc3)) / normalizer_;
+}
+
+void DenseWeightVector::AdditiveWeightUpdate(
+    const double multiplier,
+    const HashedFeatureVector &sample) {
+  const float scale = static_cast<float>(multiplier * normalizer_);
+  for (size_t i = 0; i < sample.Size(); ++i) {
+    w_[sample.indices[i] & mask_] += scale * sample.values[i];
+  }
+}
+
+double DenseWeightVector::L2Norm() const {
+  const float *w = &w_[0];
+  const size_t n = w_.size();
+  double acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc0 += w[i] * w[i];
+    acc1 += w[i + 1] * w[i + 1];
+    acc2 += w[i + 2] * w[i + 2];
+    acc3 += w[i + 3] * w[i + 3];
+  }
+  for (; i < n; ++i) {
+    acc0 += w[i] * w[i];
+  }
+  return sqrt((acc0 + acc1) + (acc2 + acc3)) / normalizer_;
+}
+
+void DenseWeightVector::ReprojectL2(const double l2_norm) {
+  CHECK_GT(l2_norm, 0);
+  double curr_l2_norm = L2Norm();
+  // Check if a projection is necessary.
+  if (curr_l2_norm > l2_norm) {
+    normalizer_ *= curr_l2_norm / l2_norm;
+  }
+  // See SparseWeightVector::Reproject().
+  if (normalizer_ < kNormalizerMin || normalizer_ > kNormalizerMax) {
+    ALOGE("Resetting normalizer to 1.0 to prevent under/overflow. "
+          "Is lambda too large or too small?");
+    ResetNormalizer();
+  }
+}
+
+}  // namespace learning_stochastic_linear
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Purpose: A dense weight vector indexed by hashed feature ids.
+// Features are mapped to a slot of a float array of size 2^num_bits, either
+// by hashing their name or by masking an interned integer id, so scoring and
+// updates never hash strings or chase hash map nodes. As in
+// SparseWeightVector, all operations assume that value/normalizer_ is the
+// true value in question.
+
+#ifndef LEARNING_STOCHASTIC_LINEAR_DENSE_WEIGHT_VECTOR_H_
+#define LEARNING_STOCHASTIC_LINEAR_DENSE_WEIGHT_VECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "common_defs.h"
+
+namespace learning_stochastic_linear {
+
+// Returns the slot of a named feature in a vector of 2^num_bits weights.
+uint32 HashFeatureName(const char *name, int num_bits);
+
+// A sample with features already mapped to slots. Slots may repeat, their
+// values then add up.
+struct HashedFeatureVector {
+  std::vector<uint32> indices;
+  std::vector<float> values;
+
+  void Clear() {
+    indices.clear();
+    values.clear();
+  }
+  void Add(uint32 index, float value) {
+    indices.push_back(index);
+    values.push_back(value);
+  }
+  size_t Size() const {
+    return indices.size();
+  }
+};
+
+class DenseWeightVector {
+ public:
+  explicit DenseWeightVector(int num_bits);
+  ~DenseWeightVector() {}
+
+  int GetNumBits() const {
+    return num_bits_;
+  }
+  uint32 GetMask() const {
+    return mask_;
+  }
+  size_t Size() const {
+    return w_.size();
+  }
+  double GetNormalizer() const {
+    return normalizer_;
+  }
+  void SetNormalizer(const double norm) {
+    normalizer_ = norm;
+  }
+  void NormalizerMultUpdate(const double mul) {
+    normalizer_ = normalizer_ * mul;
+  }
+  const float *GetData() const {
+    return &w_[0];
+  }
+  // Replaces all the weights; size must be Size().
+  bool Load(const float *weights, size_t size, double normalizer);
+  void Clear();
+  void CopyFrom(const DenseWeightVector &other);
+
+  // Same as SparseWeightVector::IsValid().
+  bool IsValid() const;
+  // Divides all the values by the normalizer, then it resets it to 1.0
+  void ResetNormalizer();
+
+  // Dot product with a sample of n features, given as slots and values.
+  double DotProduct(const uint32 *indices, const float *values,
+                    size_t n) const;
+  double DotProduct(const HashedFeatureVector &sample) const {
+    return sample.Size() == 0 ? 0 :
+        DotProduct(&sample.indices[0], &sample.values[0], sample.Size());
+  }
+  // Adds multiplier * sample.
+  void AdditiveWeightUpdate(const double multiplier,
+                            const HashedFeatureVector &sample);
+  double L2Norm() const;
+  void ReprojectL2(const double l2_norm);
+
+ private:
+  int num_bits_;
+  uint32 mask_;
+  std::vector<float> w_;
+  double normalizer_;
+
+  DenseWeightVector(const DenseWeightVector &);
+  void operator=(const DenseWeightVector &);
+};
+
+}  // namespace learning_stochastic_linear
+#endif  // LEARNING_STOCHASTIC_LINEAR_DENSE_WEIGHT_VECTOR_H_
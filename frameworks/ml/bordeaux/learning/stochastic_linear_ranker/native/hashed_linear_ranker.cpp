@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include "hashed_linear_ranker.h"
+
+namespace learning_stochastic_linear {
+
+static int ClampNumBits(int num_bits) {
+  if (num_bits <= 0 || num_bits > HashedLinearRanker::kMaxNumBits) {
+    ALOGE("Unsupported number of hash bits %d, using %d", num_bits,
+          HashedLinearRanker::kDefaultNumBits);
+    return HashedLinearRanker::kDefaultNumBits;
+  }
+  return num_bits;
+}
+
+// Same defaults as StochasticLinearRanker.
+HashedLinearRanker::HashedLinearRanker(int num_bits)
+    : weight_(ClampNumBits(num_bits)) {
+  iteration_num_ = 0;
+  lambda_ = 1.0;
+  learning_rate_controller_.SetLambda(lambda_);
+  mini_batch_size_ = 1;
+  learning_rate_controller_.SetMiniBatchSize(mini_batch_size_);
+  adaptation_mode_ = INV_LINEAR;
+  learning_rate_controller_.SetAdaptationMode(adaptation_mode_);
+  kernel_type_ = LINEAR;
+  kernel_param_ = 1.0;
+  kernel_gain_ = 1.0;
+  kernel_bias_ = 0.0;
+  norm_constraint_ = 1.0;
+  pending_count_ = 0;
+  pending_decay_ = 1.0;
+}
+
+void HashedLinearRanker::SetMiniBatchSize(const uint64 msize) {
+  FlushMiniBatch();
+  mini_batch_size_ = msize > 0 ? msize : 1;
+  learning_rate_controller_.SetMiniBatchSize(mini_batch_size_);
+}
+
+const DenseWeightVector &HashedLinearRanker::GetWeights() {
+  FlushMiniBatch();
+  return weight_;
+}
+
+bool HashedLinearRanker::LoadWeights(const float *weights, size_t size,
+                                     double normalizer) {
+  pending_gradient_.Clear();
+  pending_count_ = 0;
+  pending_decay_ = 1.0;
+  return weight_.Load(weights, size, normalizer);
+}
+
+double HashedLinearRanker::Score(const uint32 *slots, const float *values,
+                                 size_t n, double weight_norm) const {
+  const double dot = weight_.DotProduct(slots, values, n);
+  double s_square;
+  switch (kernel_type_) {
+    case LINEAR:
+      return dot;
+    case POLY:
+      return pow(kernel_gain_ * dot + kernel_bias_, kernel_param_);
+    case RBF:
+      // Same as StochasticLinearRanker::ScoreSample, which uses L2 norms.
+      s_square = 0;
+      for (size_t i = 0; i < n; ++i) {
+        s_square += values[i] * values[i];
+      }
+      s_square = sqrt(s_square);
+      return exp(-1 * kernel_param_ * (weight_norm + s_square - 2 * dot));
+    default:
+      ALOGE("unsupported kernel: %d", kernel_type_);
+  }
+  return -1;
+}
+
+void HashedLinearRanker::ScoreSamples(const uint32 *slots,
+                                      const float *values,
+                                      const int32 *offsets, size_t count,
+                                      float *scores) const {
+  // The weight norm is the same for every candidate, compute it once.
+  const double weight_norm = kernel_type_ == RBF ? weight_.L2Norm() : 0;
+  for (size_t i = 0; i < count; ++i) {
+    const int32 begin = offsets[i];
+    scores[i] = static_cast<float>(Score(slots + begin, values + begin,
+                                         offsets[i + 1] - begin, weight_norm));
+  }
+}
+
+int HashedLinearRanker::UpdateClassifier(
+    const HashedFeatureVector &positive,
+    const HashedFeatureVector &negative) {
+  // Scores are relative to the weights as of the last mini batch.
+  const double positive_score = ScoreSample(positive);
+  const double negative_score = ScoreSample(negative);
+  if ((positive_score - negative_score) >= 1) {
+    return 0;
+  }
+
+  if ((pending_count_ + 1 >= mini_batch_size_) || (iteration_num_ == 0)) {
+    ++iteration_num_;
+  }
+  learning_rate_controller_.IncrementSample();
+  const double learning_rate = learning_rate_controller_.GetLearningRate();
+  if (isnan(learning_rate) || isinf(learning_rate)) {
+    return -1;
+  }
+
+  // Queue learning_rate * (positive - negative); the -lambda * weight part
+  // of the sub-gradient is a scaling of the whole vector, folded into
+  // pending_decay_ and applied through the normalizer.
+  const float rate = static_cast<float>(learning_rate);
+  for (size_t i = 0; i < positive.Size(); ++i) {
+    pending_gradient_.Add(positive.indices[i], rate * positive.values[i]);
+  }
+  for (size_t i = 0; i < negative.Size(); ++i) {
+    pending_gradient_.Add(negative.indices[i], -rate * negative.values[i]);
+  }
+  pending_decay_ *= 1.0 - learning_rate * lambda_;
+  ++pending_count_;
+
+  if (pending_count_ < mini_batch_size_) {
+    return 2;
+  }
+  FlushMiniBatch();
+  return 1;
+}
+
+void HashedLinearRanker::FlushMiniBatch() {
+  if (pending_count_ == 0) {
+    return;
+  }
+
+  // Drop the batch rather than let it make the weights unbounded.
+  bool valid = !isnan(pending_decay_) && !isinf(pending_decay_);
+  for (size_t i = 0; valid && i < pending_gradient_.Size(); ++i) {
+    const float v = pending_gradient_.values[i];
+    valid = !isnan(v) && !isinf(v);
+  }
+
+  if (valid) {
+    if (pending_decay_ > 0) {
+      weight_.NormalizerMultUpdate(1.0 / pending_decay_);
+    } else {
+      // The regularization cancels the previous weights entirely.
+      weight_.Clear();
+    }
+    weight_.AdditiveWeightUpdate(1.0, pending_gradient_);
+    weight_.ReprojectL2(norm_constraint_);
+  } else {
+    ALOGE("Dropping a mini batch with unbounded updates");
+  }
+
+  pending_gradient_.Clear();
+  pending_count_ = 0;
+  pending_decay_ = 1.0;
+}
+
+}  // namespace learning_stochastic_linear
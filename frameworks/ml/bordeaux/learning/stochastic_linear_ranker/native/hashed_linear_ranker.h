@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stochastic Linear Ranking over hashed features.
+// A variant of StochasticLinearRanker that keeps its weights in a
+// DenseWeightVector, for models that score many candidates per query. It
+// implements the SL update type with the PAIRWISE loss and L2 regularization,
+// and applies updates once per mini batch.
+
+#ifndef LEARNING_STOCHASTIC_LINEAR_HASHED_LINEAR_RANKER_H_
+#define LEARNING_STOCHASTIC_LINEAR_HASHED_LINEAR_RANKER_H_
+
+#include <vector>
+
+#include "cutils/log.h"
+#include "common_defs.h"
+#include "dense_weight_vector.h"
+#include "learning_rate_controller-inl.h"
+
+namespace learning_stochastic_linear {
+
+class HashedLinearRanker {
+ public:
+  // Default number of hash bits, 2^18 weights use 1MB.
+  static const int kDefaultNumBits = 18;
+  static const int kMaxNumBits = 24;
+
+  explicit HashedLinearRanker(int num_bits);
+  ~HashedLinearRanker() {}
+
+  // Getters and setters, see StochasticLinearRanker.
+  uint64 GetIterationNumber() const {
+    return iteration_num_;
+  }
+  double GetNormContraint() const {
+    return norm_constraint_;
+  }
+  double GetLambda() const {
+    return lambda_;
+  }
+  uint64 GetMiniBatchSize() const {
+    return mini_batch_size_;
+  }
+  AdaptationMode GetAdaptationMode() const {
+    return adaptation_mode_;
+  }
+  KernelType GetKernelType() const {
+    return kernel_type_;
+  }
+  double GetKernelParam() const {
+    return kernel_param_;
+  }
+  double GetKernelGain() const {
+    return kernel_gain_;
+  }
+  double GetKernelBias() const {
+    return kernel_bias_;
+  }
+  void SetIterationNumber(uint64 num) {
+    iteration_num_ = num;
+  }
+  void SetNormConstraint(const double norm) {
+    norm_constraint_ = norm;
+  }
+  void SetLambda(double l) {
+    lambda_ = l;
+    learning_rate_controller_.SetLambda(l);
+  }
+  // Flushes the pending mini batch before changing its size.
+  void SetMiniBatchSize(const uint64 msize);
+  void SetAdaptationMode(AdaptationMode m) {
+    adaptation_mode_ = m;
+    learning_rate_controller_.SetAdaptationMode(m);
+  }
+  void SetKernelType(KernelType k) {
+    kernel_type_ = k;
+  }
+  void SetKernelParam(double param) {
+    kernel_param_ = param;
+  }
+  void SetKernelGain(double gain) {
+    kernel_gain_ = gain;
+  }
+  void SetKernelBias(double bias) {
+    kernel_bias_ = bias;
+  }
+
+  // Model access, for persistence. The pending mini batch is applied first.
+  const DenseWeightVector &GetWeights();
+  bool LoadWeights(const float *weights, size_t size, double normalizer);
+
+  // Maps features to slots of this model's weight vector.
+  uint32 SlotForName(const char *name) const {
+    return HashFeatureName(name, weight_.GetNumBits());
+  }
+  uint32 SlotForId(uint32 id) const {
+    return id & weight_.GetMask();
+  }
+
+  // Scoring
+  double ScoreSample(const HashedFeatureVector &sample) const {
+    if (sample.Size() == 0) {
+      return Score(NULL, NULL, 0, kernel_type_ == RBF ? weight_.L2Norm() : 0);
+    }
+    return Score(&sample.indices[0], &sample.values[0], sample.Size(),
+                 kernel_type_ == RBF ? weight_.L2Norm() : 0);
+  }
+  // Scores count candidates for ranking. The features of candidate i are
+  // slots[offsets[i]] to slots[offsets[i + 1] - 1] and the matching values,
+  // offsets has count + 1 entries. Ids may be passed as slots, they are
+  // masked like SlotForId() does.
+  void ScoreSamples(const uint32 *slots, const float *values,
+                    const int32 *offsets, size_t count, float *scores) const;
+
+  // Learning Functions
+  // Return values, as in StochasticLinearRanker:
+  // 1 :full update went through (end of a mini batch)
+  // 2 :partial update went through (gradient queued in the mini batch)
+  // 0 :no update necessary.
+  // -1:error.
+  int UpdateClassifier(const HashedFeatureVector &positive,
+                       const HashedFeatureVector &negative);
+
+  // Applies the gradients queued in the current mini batch, if any.
+  void FlushMiniBatch();
+
+ private:
+  DenseWeightVector weight_;
+  double norm_constraint_;
+  double lambda_;
+  AdaptationMode adaptation_mode_;
+  KernelType kernel_type_;
+  double kernel_param_;
+  double kernel_gain_;
+  double kernel_bias_;
+  LearningRateController learning_rate_controller_;
+  uint64 iteration_num_;
+  uint64 mini_batch_size_;
+  // Sum of learning_rate * (positive - negative) over the pairs of the
+  // current mini batch, their count, and the product of the regularization
+  // decays (1 - learning_rate * lambda) they would have applied.
+  HashedFeatureVector pending_gradient_;
+  uint64 pending_count_;
+  double pending_decay_;
+
+  // Kernel score of a sample; weight_norm is only used by the RBF kernel.
+  double Score(const uint32 *slots, const float *values, size_t n,
+               double weight_norm) const;
+
+  HashedLinearRanker(const HashedLinearRanker &);
+  void operator=(const HashedLinearRanker &);
+};
+
+}  // namespace learning_stochastic_linear
+#endif  // LEARNING_STOCHASTIC_LINEAR_HASHED_LINEAR_RANKER_H_
@@ -14,16 +14,20 @@
  * limitations under the License.
  */
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 #include <zlib.h>
 
 #include <binder/IBinder.h>
@@ -32,7 +36,9 @@
 
 #include <cutils/properties.h>
 
+#include <utils/KeyedVector.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 
 using namespace android;
@@ -43,6 +49,7 @@ enum { MAX_SYS_FILES = 8 };
 
 const char* k_traceTagsProperty = "debug.atrace.tags.enableflags";
 const char* k_traceAppCmdlineProperty = "debug.atrace.app_cmdlines";
+const char* k_traceSnapshotProperty = "debug.atrace.snapshot";
 
 typedef enum { OPT, REQ } requiredness  ;
 
@@ -126,9 +133,17 @@ static bool g_nohup = false;
 static int g_initialSleepSecs = 0;
 static const char* g_kernelTraceFuncs = NULL;
 static const char* g_debugAppCmdLine = "";
+static const char* g_ringDir = NULL;
+static int g_ringSegments = 8;
+static int g_ringSegmentKB = 1024;
+static int g_ringSnapshots = 4;
+static int g_snapshotPostSecs = 2;
+static int g_sampleIntervalMs = 0;
 
 /* Global state */
 static bool g_traceAborted = false;
+static bool g_snapshotRequested = false;
+static int g_traceMarkerFD = -1;
 static bool g_categoryEnables[NELEM(k_categories)] = {};
 
 /* Sys file paths */
@@ -171,6 +186,12 @@ static const char* k_tracingOnPath =
 static const char* k_tracePath =
     "/sys/kernel/debug/tracing/trace";
 
+static const char* k_tracePipePath =
+    "/sys/kernel/debug/tracing/trace_pipe";
+
+static const char* k_traceMarkerPath =
+    "/sys/kernel/debug/tracing/trace_marker";
+
 // Check whether a file exists.
 static bool fileExists(const char* filename) {
     return access(filename, F_OK) != -1;
@@ -665,8 +686,507 @@ static void dumpTrace()
     close(traceFD);
 }
 
+// Write all of buf to fd, returning true if the write was successful.
+static bool writeFully(int fd, const void* buf, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Read the scheduler state and the cumulative CPU time, in clock ticks, of a
+// thread.
+static bool readThreadStat(pid_t pid, pid_t tid, char* comm, size_t commSize,
+        char* state, unsigned long* ticks)
+{
+    char path[64];
+    char buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", pid, tid);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+
+    // The command name is in parentheses and may itself contain spaces or
+    // parentheses, so look for the last closing one.
+    char* start = strchr(buf, '(');
+    char* end = strrchr(buf, ')');
+    if (start == NULL || end == NULL || end < start) {
+        return false;
+    }
+    size_t len = end - start - 1;
+    if (len >= commSize) {
+        len = commSize - 1;
+    }
+    memcpy(comm, start + 1, len);
+    comm[len] = '\0';
+
+    unsigned long utime, stime;
+    if (sscanf(end + 1, " %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+            state, &utime, &stime) != 3) {
+        return false;
+    }
+    *ticks = utime + stime;
+    return true;
+}
+
+// Format the kernel stack of a thread as "func;func;..." innermost frame
+// first, falling back to its wait channel when the stack isn't readable.
+static void readThreadStack(pid_t pid, pid_t tid, char* out, size_t size)
+{
+    char path[64];
+    char buf[2048];
+    size_t len = 0;
+
+    out[0] = '\0';
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/stack", pid, tid);
+    int fd = open(path, O_RDONLY);
+    if (fd != -1) {
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n > 0) {
+            buf[n] = '\0';
+            // Each line looks like "[<c00a1b2c>] func+0x1c/0x40".
+            char* line = strtok(buf, "\n");
+            while (line != NULL) {
+                char* func = strstr(line, "] ");
+                if (func != NULL) {
+                    func += 2;
+                    size_t flen = strcspn(func, "+ ");
+                    if (flen > 0 && len + flen + 2 < size) {
+                        if (len > 0) {
+                            out[len++] = ';';
+                        }
+                        memcpy(out + len, func, flen);
+                        len += flen;
+                        out[len] = '\0';
+                    }
+                }
+                line = strtok(NULL, "\n");
+            }
+        }
+    }
+
+    if (len == 0) {
+        snprintf(path, sizeof(path), "/proc/%d/task/%d/wchan", pid, tid);
+        fd = open(path, O_RDONLY);
+        if (fd != -1) {
+            ssize_t n = read(fd, out, size - 1);
+            close(fd);
+            out[n > 0 ? n : 0] = '\0';
+        }
+    }
+}
+
+// Sample every thread in the system and write one "atrace_sample:" line to
+// the trace for each thread that used the CPU since the previous sample or
+// that is blocked in uninterruptible sleep.  The kernel stack (or the wait
+// channel) is the closest thing to a call stack that can be had for other
+// processes without ptrace.  Writing the samples through the trace marker
+// keeps them on the same clock as the rest of the trace.
+static void sampleThreads()
+{
+    static KeyedVector<pid_t, unsigned long> lastTicks;
+    KeyedVector<pid_t, unsigned long> ticks;
+
+    if (g_traceMarkerFD == -1) {
+        g_traceMarkerFD = open(k_traceMarkerPath, O_WRONLY);
+        if (g_traceMarkerFD == -1) {
+            fprintf(stderr, "error opening %s: %s (%d)\n", k_traceMarkerPath,
+                    strerror(errno), errno);
+            g_sampleIntervalMs = 0;
+            return;
+        }
+    }
+
+    DIR* proc = opendir("/proc");
+    if (proc == NULL) {
+        return;
+    }
+
+    pid_t self = getpid();
+    struct dirent* pe;
+    while ((pe = readdir(proc)) != NULL) {
+        pid_t pid = atoi(pe->d_name);
+        if (pid <= 0 || pid == self) {
+            continue;
+        }
+
+        char taskPath[64];
+        snprintf(taskPath, sizeof(taskPath), "/proc/%d/task", pid);
+        DIR* tasks = opendir(taskPath);
+        if (tasks == NULL) {
+            continue;
+        }
+
+        struct dirent* te;
+        while ((te = readdir(tasks)) != NULL) {
+            pid_t tid = atoi(te->d_name);
+            if (tid <= 0) {
+                continue;
+            }
+
+            char comm[64];
+            char state;
+            unsigned long t;
+            if (!readThreadStat(pid, tid, comm, sizeof(comm), &state, &t)) {
+                continue;
+            }
+            ticks.add(tid, t);
+
+            // Threads seen for the first time only establish a baseline.
+            ssize_t idx = lastTicks.indexOfKey(tid);
+            if (idx < 0) {
+                continue;
+            }
+            unsigned long delta = t - lastTicks.valueAt(idx);
+            if (delta == 0 && state != 'D') {
+                continue;
+            }
+
+            char stack[768];
+            char line[1024];
+            readThreadStack(pid, tid, stack, sizeof(stack));
+            int len = snprintf(line, sizeof(line),
+                    "atrace_sample: pid=%d tid=%d comm=%s state=%c "
+                    "cpu_ticks=%lu stack=%s\n",
+                    pid, tid, comm, state, delta, stack);
+            if (len >= (int)sizeof(line)) {
+                len = sizeof(line) - 1;
+            }
+            write(g_traceMarkerFD, line, len);
+        }
+        closedir(tasks);
+    }
+    closedir(proc);
+
+    lastTicks = ticks;
+}
+
+// Sleep for the given number of seconds, or until the trace is aborted,
+// sampling the threads periodically if requested.
+static void sleepAndSample(int secs)
+{
+    if (g_sampleIntervalMs <= 0) {
+        struct timespec timeLeft;
+        timeLeft.tv_sec = secs;
+        timeLeft.tv_nsec = 0;
+        do {
+            if (g_traceAborted) {
+                break;
+            }
+        } while (nanosleep(&timeLeft, &timeLeft) == -1 && errno == EINTR);
+        return;
+    }
+
+    nsecs_t end = systemTime() + seconds(secs);
+    while (!g_traceAborted) {
+        sampleThreads();
+        nsecs_t now = systemTime();
+        if (now >= end) {
+            break;
+        }
+        nsecs_t wait = milliseconds(g_sampleIntervalMs);
+        if (wait > end - now) {
+            wait = end - now;
+        }
+        struct timespec ts;
+        ts.tv_sec = wait / 1000000000;
+        ts.tv_nsec = wait % 1000000000;
+        nanosleep(&ts, NULL);
+    }
+}
+
+// The state of a ring capture.  The trace is read from trace_pipe and written
+// to a sequence of zlib compressed segment files in g_ringDir, each of which
+// is closed once it reaches g_ringSegmentKB of compressed data.  Only the
+// most recent g_ringSegments segments are kept, which bounds the disk usage
+// regardless of how long the capture runs.
+struct RingCapture {
+    int fd;
+    z_stream zs;
+    uint8_t* out;
+    size_t segmentBytes;    // compressed bytes written to the open segment
+    unsigned seq;           // sequence number of the open segment
+    unsigned firstSeq;      // oldest segment still on disk
+    unsigned snapshotSeq;   // sequence number of the next snapshot
+};
+
+static const size_t k_ringBufSize = 64*1024;
+
+static String8 ringSegmentPath(const char* dir, unsigned seq)
+{
+    return String8::format("%s/trace-%06u.z", dir, seq);
+}
+
+static String8 ringSnapshotPath(unsigned seq)
+{
+    return String8::format("%s/snapshot-%06u", g_ringDir, seq);
+}
+
+// Remove a directory along with the files in it.
+static void removeDir(const char* path)
+{
+    DIR* d = opendir(path);
+    if (d == NULL) {
+        return;
+    }
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] != '.') {
+            unlink(String8::format("%s/%s", path, e->d_name).string());
+        }
+    }
+    closedir(d);
+    rmdir(path);
+}
+
+// Remove the segments and snapshots left behind by a previous capture.
+static void ringRemoveStale()
+{
+    DIR* d = opendir(g_ringDir);
+    if (d == NULL) {
+        return;
+    }
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        String8 path = String8::format("%s/%s", g_ringDir, e->d_name);
+        if (!strncmp(e->d_name, "trace-", 6)) {
+            unlink(path.string());
+        } else if (!strncmp(e->d_name, "snapshot-", 9)) {
+            removeDir(path.string());
+        }
+    }
+    closedir(d);
+}
+
+// Run the compressor over the pending input.  Full output buffers are
+// written to the open segment, and everything is written out when the
+// stream is finished.
+static bool ringDeflate(RingCapture* r, int flush)
+{
+    for (;;) {
+        int result = deflate(&r->zs, flush);
+        if (result == Z_STREAM_ERROR) {
+            fprintf(stderr, "error deflating trace: %s\n", r->zs.msg);
+            return false;
+        }
+
+        bool done = (flush == Z_FINISH) ? result == Z_STREAM_END :
+                r->zs.avail_in == 0;
+        size_t bytes = k_ringBufSize - r->zs.avail_out;
+        if (bytes > 0 && (r->zs.avail_out == 0 || (done && flush == Z_FINISH))) {
+            if (!writeFully(r->fd, r->out, bytes)) {
+                fprintf(stderr, "error writing trace segment: %s (%d)\n",
+                        strerror(errno), errno);
+                return false;
+            }
+            r->segmentBytes += bytes;
+            r->zs.next_out = r->out;
+            r->zs.avail_out = k_ringBufSize;
+        }
+
+        if (done) {
+            return true;
+        }
+    }
+}
+
+static bool ringOpenSegment(RingCapture* r)
+{
+    String8 path = ringSegmentPath(g_ringDir, r->seq);
+    r->fd = open(path.string(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (r->fd == -1) {
+        fprintf(stderr, "error opening %s: %s (%d)\n", path.string(),
+                strerror(errno), errno);
+        return false;
+    }
+
+    bzero(&r->zs, sizeof(r->zs));
+    int result = deflateInit(&r->zs, Z_DEFAULT_COMPRESSION);
+    if (result != Z_OK) {
+        fprintf(stderr, "error initializing zlib: %d\n", result);
+        close(r->fd);
+        r->fd = -1;
+        return false;
+    }
+    r->zs.next_out = r->out;
+    r->zs.avail_out = k_ringBufSize;
+    r->segmentBytes = 0;
+    return true;
+}
+
+static bool ringCloseSegment(RingCapture* r)
+{
+    bool ok = ringDeflate(r, Z_FINISH);
+    deflateEnd(&r->zs);
+    close(r->fd);
+    r->fd = -1;
+    return ok;
+}
+
+// Close the open segment, drop the segments that fall out of the ring and
+// start a new one.  When snapshot is true, the closed segments are also
+// hard linked into a new snapshot directory before any of them are dropped,
+// so that they survive the ring moving on.
+static bool ringRotate(RingCapture* r, bool snapshot)
+{
+    bool ok = ringCloseSegment(r);
+
+    if (snapshot) {
+        String8 dir = ringSnapshotPath(r->snapshotSeq);
+        if (mkdir(dir.string(), 0755) == -1) {
+            fprintf(stderr, "error creating %s: %s (%d)\n", dir.string(),
+                    strerror(errno), errno);
+        } else {
+            for (unsigned seq = r->firstSeq; seq <= r->seq; seq++) {
+                link(ringSegmentPath(g_ringDir, seq).string(),
+                        ringSegmentPath(dir.string(), seq).string());
+            }
+            fprintf(stderr, "trace snapshot saved to %s\n", dir.string());
+            if (r->snapshotSeq >= (unsigned)g_ringSnapshots) {
+                removeDir(ringSnapshotPath(
+                        r->snapshotSeq - g_ringSnapshots).string());
+            }
+            r->snapshotSeq++;
+        }
+    }
+
+    r->seq++;
+    while (r->seq - r->firstSeq >= (unsigned)g_ringSegments) {
+        unlink(ringSegmentPath(g_ringDir, r->firstSeq).string());
+        r->firstSeq++;
+    }
+
+    return ok && ringOpenSegment(r);
+}
+
+// Return true if the snapshot property was set to a new value since the
+// last call.
+static bool snapshotPropertyChanged(char* lastValue)
+{
+    char value[PROPERTY_VALUE_MAX];
+    property_get(k_traceSnapshotProperty, value, "");
+    if (value[0] != '\0' && strcmp(value, lastValue) != 0) {
+        strcpy(lastValue, value);
+        return true;
+    }
+    return false;
+}
+
+// Continuously drain the kernel trace into the compressed ring until the
+// trace is aborted.  A snapshot is requested with SIGUSR1 or by setting the
+// debug.atrace.snapshot property to a new value, typically by whatever
+// detected the jank; it is taken g_snapshotPostSecs later so that it covers
+// what happened both before and after the event.
+static bool runRingCapture()
+{
+    int traceFD = open(k_tracePipePath, O_RDONLY | O_NONBLOCK);
+    if (traceFD == -1) {
+        fprintf(stderr, "error opening %s: %s (%d)\n", k_tracePipePath,
+                strerror(errno), errno);
+        return false;
+    }
+
+    if (mkdir(g_ringDir, 0755) == -1 && errno != EEXIST) {
+        fprintf(stderr, "error creating %s: %s (%d)\n", g_ringDir,
+                strerror(errno), errno);
+        close(traceFD);
+        return false;
+    }
+    ringRemoveStale();
+
+    RingCapture r;
+    bzero(&r, sizeof(r));
+    r.fd = -1;
+    r.out = (uint8_t*)malloc(k_ringBufSize);
+    uint8_t* in = (uint8_t*)malloc(k_ringBufSize);
+
+    char lastTrigger[PROPERTY_VALUE_MAX];
+    property_get(k_traceSnapshotProperty, lastTrigger, "");
+
+    nsecs_t snapshotTime = 0;
+    nsecs_t nextSample = 0;
+    bool ok = ringOpenSegment(&r);
+
+    while (ok && !g_traceAborted) {
+        struct pollfd pfd;
+        pfd.fd = traceFD;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        poll(&pfd, 1, 100);
+
+        for (;;) {
+            ssize_t n = read(traceFD, in, k_ringBufSize);
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                fprintf(stderr, "error reading trace: %s (%d)\n",
+                        strerror(errno), errno);
+                ok = false;
+            }
+            if (n <= 0) {
+                break;
+            }
+            r.zs.next_in = in;
+            r.zs.avail_in = n;
+            ok = ringDeflate(&r, Z_NO_FLUSH);
+            if (ok && r.segmentBytes >= (size_t)g_ringSegmentKB * 1024) {
+                ok = ringRotate(&r, false);
+            }
+            if (!ok) {
+                break;
+            }
+        }
+
+        nsecs_t now = systemTime();
+        if (g_snapshotRequested || snapshotPropertyChanged(lastTrigger)) {
+            g_snapshotRequested = false;
+            if (snapshotTime == 0) {
+                snapshotTime = now + seconds(g_snapshotPostSecs);
+            }
+        }
+        if (ok && snapshotTime != 0 && now >= snapshotTime) {
+            ok = ringRotate(&r, true);
+            snapshotTime = 0;
+        }
+        if (g_sampleIntervalMs > 0 && now >= nextSample) {
+            sampleThreads();
+            nextSample = now + milliseconds(g_sampleIntervalMs);
+        }
+    }
+
+    if (r.fd != -1) {
+        ok &= ringCloseSegment(&r);
+    }
+
+    free(in);
+    free(r.out);
+    close(traceFD);
+
+    return ok;
+}
+
 static void handleSignal(int signo)
 {
+    if (signo == SIGUSR1) {
+        g_snapshotRequested = true;
+        return;
+    }
     if (!g_nohup) {
         g_traceAborted = true;
     }
@@ -682,6 +1202,7 @@ static void registerSigHandler()
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGQUIT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
 }
 
 static bool setCategoryEnable(const char* name, bool enable)
@@ -738,6 +1259,20 @@ static void showHelp(const char *cmd)
                     "                    trace buffer\n"
                     "  --list_categories\n"
                     "                  list the available tracing categories\n"
+                    "  --ring dir      trace continuously into a ring of compressed segments\n"
+                    "                    in dir until interrupted; SIGUSR1 or setting\n"
+                    "                    debug.atrace.snapshot saves a snapshot of the ring\n"
+                    "  --ring_segments N\n"
+                    "                  keep the N most recent segments [default 8]\n"
+                    "  --ring_segment_kb N\n"
+                    "                  close segments at N KB of compressed data [default 1024]\n"
+                    "  --ring_snapshots N\n"
+                    "                  keep the N most recent snapshots [default 4]\n"
+                    "  --snapshot_post N\n"
+                    "                  keep tracing for N seconds after a snapshot is\n"
+                    "                    requested before taking it [default 2]\n"
+                    "  --sample_ms N   sample the kernel stacks of the threads using the CPU\n"
+                    "                    every N ms into the trace\n"
             );
 }
 
@@ -761,6 +1296,12 @@ int main(int argc, char **argv)
             {"async_stop",      no_argument, 0,  0 },
             {"async_dump",      no_argument, 0,  0 },
             {"list_categories", no_argument, 0,  0 },
+            {"ring",            required_argument, 0,  0 },
+            {"ring_segments",   required_argument, 0,  0 },
+            {"ring_segment_kb", required_argument, 0,  0 },
+            {"ring_snapshots",  required_argument, 0,  0 },
+            {"snapshot_post",   required_argument, 0,  0 },
+            {"sample_ms",       required_argument, 0,  0 },
             {           0,                0, 0,  0 }
         };
 
@@ -826,6 +1367,19 @@ int main(int argc, char **argv)
                 } else if (!strcmp(long_options[option_index].name, "list_categories")) {
                     listSupportedCategories();
                     exit(0);
+                } else if (!strcmp(long_options[option_index].name, "ring")) {
+                    g_ringDir = optarg;
+                    traceDump = false;
+                } else if (!strcmp(long_options[option_index].name, "ring_segments")) {
+                    g_ringSegments = atoi(optarg) > 1 ? atoi(optarg) : 2;
+                } else if (!strcmp(long_options[option_index].name, "ring_segment_kb")) {
+                    g_ringSegmentKB = atoi(optarg) > 1 ? atoi(optarg) : 1;
+                } else if (!strcmp(long_options[option_index].name, "ring_snapshots")) {
+                    g_ringSnapshots = atoi(optarg) > 1 ? atoi(optarg) : 1;
+                } else if (!strcmp(long_options[option_index].name, "snapshot_post")) {
+                    g_snapshotPostSecs = atoi(optarg);
+                } else if (!strcmp(long_options[option_index].name, "sample_ms")) {
+                    g_sampleIntervalMs = atoi(optarg);
                 }
             break;
 
@@ -858,16 +1412,12 @@ int main(int argc, char **argv)
         // another.
         ok = clearTrace();
 
-        if (ok && !async) {
+        if (ok && g_ringDir != NULL) {
+            // Trace until interrupted, draining the kernel buffer as we go.
+            ok = runRingCapture();
+        } else if (ok && !async) {
             // Sleep to allow the trace to be captured.
-            struct timespec timeLeft;
-            timeLeft.tv_sec = g_traceDurationSeconds;
-            timeLeft.tv_nsec = 0;
-            do {
-                if (g_traceAborted) {
-                    break;
-                }
-            } while (nanosleep(&timeLeft, &timeLeft) == -1 && errno == EINTR);
+            sleepAndSample(g_traceDurationSeconds);
         }
     }
 
@@ -889,9 +1439,17 @@ int main(int argc, char **argv)
         fprintf(stderr, "unable to start tracing\n");
     }
 
+    if (g_traceMarkerFD != -1) {
+        close(g_traceMarkerFD);
+    }
+
     // Reset the trace buffer size to 1.
     if (traceStop)
         cleanUpTrace();
 
+    if (g_ringDir != NULL) {
+        return ok ? 0 : 1;
+    }
+
     return g_traceAborted ? 1 : 0;
 }
@@ -282,4 +282,85 @@ Composer* blendShrink() {
     return new BlendShrinkComp();
 }
 
+// The number of frames in one cycle of the animated composers.
+enum { ANIMATION_FRAMES = 32 };
+
+// Goes from 0 to 1 and back over ANIMATION_FRAMES frames.
+static float animationPhase(uint32_t frame) {
+    uint32_t f = frame % ANIMATION_FRAMES;
+    if (f > ANIMATION_FRAMES / 2) {
+        f = ANIMATION_FRAMES - f;
+    }
+    return float(f) / float(ANIMATION_FRAMES / 2);
+}
+
+Composer* slide() {
+    class SlideComp : public ComposerBase {
+        virtual bool setUp(GLHelper* helper) {
+            mFrame = 0;
+            return mBlitter.setUp(helper);
+        }
+
+        virtual bool compose(GLuint texName, const sp<GLConsumer>& glc) {
+            float texMatrix[16];
+            glc->getTransformMatrix(texMatrix);
+
+            int32_t x = mLayerDesc.x;
+            int32_t y = mLayerDesc.y;
+            int32_t w = mLayerDesc.width;
+            int32_t h = mLayerDesc.height;
+
+            // Scroll back and forth by a quarter of the layer width.
+            x -= int32_t(animationPhase(mFrame++) * float(w / 4));
+
+            return mBlitter.blit(texName, texMatrix, x, y, w, h);
+        }
+
+        Blitter mBlitter;
+        uint32_t mFrame;
+    };
+    return new SlideComp();
+}
+
+Composer* fade() {
+    class FadeComp : public ComposerBase {
+        virtual bool setUp(GLHelper* helper) {
+            mFrame = 0;
+            return mBlitter.setUp(helper);
+        }
+
+        virtual bool compose(GLuint texName, const sp<GLConsumer>& glc) {
+            bool result;
+
+            float texMatrix[16];
+            glc->getTransformMatrix(texMatrix);
+
+            float a = animationPhase(mFrame++);
+            float modColor[4] = { a, a, a, a };
+
+            int32_t x = mLayerDesc.x;
+            int32_t y = mLayerDesc.y;
+            int32_t w = mLayerDesc.width;
+            int32_t h = mLayerDesc.height;
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+            result = mBlitter.modBlit(texName, texMatrix, modColor,
+                    x, y, w, h);
+            if (!result) {
+                return false;
+            }
+
+            glDisable(GL_BLEND);
+
+            return true;
+        }
+
+        Blitter mBlitter;
+        uint32_t mFrame;
+    };
+    return new FadeComp();
+}
+
 } // namespace android
@@ -57,6 +57,8 @@ Composer* opaque();
 Composer* opaqueShrink();
 Composer* blend();
 Composer* blendShrink();
+Composer* slide();
+Composer* fade();
 
 class Renderer {
 public:
@@ -67,5 +69,6 @@ public:
 };
 
 Renderer* staticGradient();
+Renderer* animatedGradient();
 
 } // namespace android
@@ -37,8 +37,12 @@ using namespace ::android;
 
 static uint32_t g_SleepBetweenSamplesMs = 0;
 static bool     g_PresentToWindow       = false;
+static bool     g_MachineReadable       = false;
 static size_t   g_BenchmarkNameLen      = 0;
 
+// The number of timed frames for which per-frame latencies are collected.
+static const uint32_t g_LatencyFrames   = 64;
+
 struct BenchmarkDesc {
     // The name of the test.
     const char* name;
@@ -202,8 +206,55 @@ static const BenchmarkDesc benchmarks[] = {
             },
         },
     },
+
+    { "16:10 Animated Home Scroll",
+        2560, 1600, { 800, 1200, 1600, 2400 },
+        {
+            {   // Wallpaper, wider than the screen for the parallax scroll
+                0, staticGradient, slide,
+                0,    50,     3414,   1454,
+            },
+            {   // Launcher, redrawn every frame
+                0, animatedGradient, blend,
+                0,    50,     2560,   1454,
+            },
+            {   // Status bar
+                0, staticGradient, opaque,
+                0,    0,      2560,   50,
+            },
+            {   // Navigation bar
+                0, staticGradient, opaque,
+                0,    1504,   2560,   96,
+            },
+        },
+    },
+
+    { "16:10 Animated Dialog Fade",
+        2560, 1600, { 800, 1200, 1600, 2400 },
+        {
+            {   // Window
+                0, staticGradient, opaque,
+                0,    50,     2560,   1454,
+            },
+            {   // Dialog, redrawn every frame
+                0, animatedGradient, fade,
+                320,  400,    1920,   800,
+            },
+            {   // Status bar
+                0, staticGradient, opaque,
+                0,    0,      2560,   50,
+            },
+            {   // Navigation bar
+                0, staticGradient, opaque,
+                0,    1504,   2560,   96,
+            },
+        },
+    },
 };
 
+// Resolutions at which the BufferQueue round trip is measured.
+static const uint32_t bufferQueueRunHeights[] = { 800, 1600 };
+
 static const ShaderDesc shaders[] = {
     {
         name: "Blit",
@@ -462,11 +513,16 @@ public:
         }
     }
 
-    nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames) {
+    // If frameLatencies is not NULL, the time from the start of each timed
+    // frame until its composition finished on the GPU is added to it.
+    nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames,
+            Vector<nsecs_t>* frameLatencies = NULL) {
         ATRACE_CALL();
 
         bool result;
         status_t err;
+        Vector<nsecs_t> frameStarts;
+        Vector<sp<Fence> > frameFences;
 
         resetColorGenerator();
 
@@ -483,10 +539,15 @@ public:
 
         //  the timed frames.
         for (uint32_t i = warmUpFrames; i < totalFrames; i++) {
+            nsecs_t frameStart = systemTime();
             result = doFrame(mSurface);
             if (!result) {
                 return -1;
             }
+            if (frameLatencies != NULL) {
+                frameStarts.add(frameStart);
+                frameFences.add(mGLConsumer->getCurrentFence());
+            }
         }
 
         // Grab the fence for the end timestamp.
@@ -504,6 +565,17 @@ public:
         nsecs_t startTime = startFence->getSignalTime();
         nsecs_t endTime = endFence->getSignalTime();
 
+        if (frameLatencies != NULL) {
+            for (size_t i = 0; i < frameFences.size(); i++) {
+                err = frameFences[i]->waitForever("flatland");
+                if (err != NO_ERROR) {
+                    return -1;
+                }
+                frameLatencies->add(
+                        frameFences[i]->getSignalTime() - frameStarts[i]);
+            }
+        }
+
         return endTime - startTime;
     }
 
@@ -583,6 +655,113 @@ private:
     Layer mLayers[MAX_NUM_LAYERS];
 };
 
+// Measures the round trip of a buffer through a BufferQueue: the producer
+// dequeues a buffer, renders into it and queues it, and the consumer
+// acquires it and latches it into a texture.
+class BufferQueueRunner {
+
+public:
+
+    BufferQueueRunner() :
+        mGLHelper(NULL),
+        mSurface(EGL_NO_SURFACE),
+        mRenderer(NULL) {
+    }
+
+    bool setUp(uint32_t w, uint32_t h) {
+        ATRACE_CALL();
+
+        bool result;
+
+        mGLHelper = new GLHelper();
+        result = mGLHelper->setUp(shaders, NELEMS(shaders));
+        if (!result) {
+            return false;
+        }
+
+        GLuint texName;
+        result = mGLHelper->createSurfaceTexture(w, h, &mGLConsumer, &mSurface,
+                &texName);
+        if (!result) {
+            return false;
+        }
+
+        mRenderer = animatedGradient();
+        return mRenderer->setUp(mGLHelper);
+    }
+
+    void tearDown() {
+        ATRACE_CALL();
+
+        if (mRenderer != NULL) {
+            mRenderer->tearDown();
+            delete mRenderer;
+            mRenderer = NULL;
+        }
+
+        if (mGLHelper != NULL) {
+            mGLHelper->destroySurface(&mSurface);
+            mGLConsumer->abandon();
+            mGLConsumer.clear();
+            mGLHelper->tearDown();
+            delete mGLHelper;
+            mGLHelper = NULL;
+        }
+    }
+
+    // Adds the per-frame times from the start of the frame until it was
+    // queued, from queueing until the consumer latched it, and from the
+    // start of the frame until its content was ready on the GPU.
+    bool run(uint32_t numFrames, Vector<nsecs_t>* queueTimes,
+            Vector<nsecs_t>* acquireTimes, Vector<nsecs_t>* totalTimes) {
+        ATRACE_CALL();
+
+        Vector<nsecs_t> frameStarts;
+        Vector<sp<Fence> > frameFences;
+        status_t err;
+
+        resetColorGenerator();
+
+        for (uint32_t i = 0; i < numFrames; i++) {
+            nsecs_t t0 = systemTime();
+            if (!mRenderer->render(mSurface)) {
+                return false;
+            }
+            nsecs_t t1 = systemTime();
+            err = mGLConsumer->updateTexImage();
+            if (err < 0) {
+                fprintf(stderr, "GLConsumer::updateTexImage error: %d\n", err);
+                return false;
+            }
+            nsecs_t t2 = systemTime();
+
+            queueTimes->add(t1 - t0);
+            acquireTimes->add(t2 - t1);
+            frameStarts.add(t0);
+            frameFences.add(mGLConsumer->getCurrentFence());
+        }
+
+        for (size_t i = 0; i < frameFences.size(); i++) {
+            err = frameFences[i]->waitForever("flatland");
+            if (err != NO_ERROR) {
+                return false;
+            }
+            totalTimes->add(frameFences[i]->getSignalTime() - frameStarts[i]);
+        }
+
+        return true;
+    }
+
+private:
+
+    GLHelper* mGLHelper;
+
+    sp<GLConsumer> mGLConsumer;
+    EGLSurface mSurface;
+
+    Renderer* mRenderer;
+};
+
 static int cmpDouble(const double* lhs, const double* rhs) {
     if (*lhs < *rhs) {
         return -1;
@@ -592,17 +771,74 @@ static int cmpDouble(const double* lhs, const double* rhs) {
     return 0;
 }
 
+static int cmpNsecs(const nsecs_t* lhs, const nsecs_t* rhs) {
+    if (*lhs < *rhs) {
+        return -1;
+    } else if (*rhs < *lhs) {
+        return 1;
+    }
+    return 0;
+}
+
+struct TestResult {
+    // "ok", or why there is no result: "fast", "slow" or "varies".
+    const char* status;
+
+    // The mean frame time, and the frame latency percentiles, in ms.
+    double frameTime;
+    double p50;
+    double p90;
+    double p99;
+};
+
+// Sorts the samples and stores their percentiles in the result.
+static void computePercentiles(Vector<nsecs_t>& samples, TestResult* r) {
+    r->p50 = r->p90 = r->p99 = 0.0;
+    if (samples.isEmpty()) {
+        return;
+    }
+
+    samples.sort(cmpNsecs);
+
+    // nearest rank
+    size_t n = samples.size();
+    r->p50 = samples[(n - 1) * 50 / 100] / 1e6;
+    r->p90 = samples[(n - 1) * 90 / 100] / 1e6;
+    r->p99 = samples[(n - 1) * 99 / 100] / 1e6;
+}
+
+static void printResult(const char* kind, const char* name, uint32_t w,
+        uint32_t h, const TestResult& r) {
+    if (g_MachineReadable) {
+        printf("%s,%s,%d,%d,%s,%.3f,%.3f,%.3f,%.3f\n", kind, name, w, h,
+                r.status, r.frameTime, r.p50, r.p90, r.p99);
+    } else if (strcmp(r.status, "ok")) {
+        printf("%9s |         |         |\n", r.status);
+    } else {
+        printf("%9.3f | %7.3f | %7.3f | %7.3f\n", r.frameTime, r.p50, r.p90,
+                r.p99);
+    }
+    fflush(stdout);
+}
+
+static void printTestName(const char* name, uint32_t w, uint32_t h) {
+    if (!g_MachineReadable) {
+        printf(" %-*s | %4d x %4d | ", g_BenchmarkNameLen, name, w, h);
+        fflush(stdout);
+    }
+}
+
 // Run a single benchmark and print the result.
 static bool runTest(const BenchmarkDesc b, size_t run) {
     bool success = true;
     double prevResult = 0.0, result = 0.0;
     Vector<double> samples;
+    Vector<nsecs_t> latencies;
+    TestResult testResult = { "ok", 0.0, 0.0, 0.0, 0.0 };
 
     uint32_t runHeight = b.runHeights[run];
     uint32_t runWidth = b.width * runHeight / b.height;
-    printf(" %-*s | %4d x %4d | ", g_BenchmarkNameLen, b.name,
-            runWidth, runHeight);
-    fflush(stdout);
+    printTestName(b.name, runWidth, runHeight);
 
     BenchmarkRunner r(b, run);
     if (!r.setUp()) {
@@ -633,11 +869,11 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
 
     if (totalFrames - warmUpFrames > 16) {
         // The test runs too fast to get a stable result.  Skip it.
-        printf("  fast");
+        testResult.status = "fast";
         goto done;
     } else if (totalFrames == 5 && runTime > 200e6) {
         // The test runs too slow to be very useful.  Skip it.
-        printf("  slow");
+        testResult.status = "slow";
         goto done;
     }
 
@@ -648,7 +884,7 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         }
 
         if (newSamples > 512) {
-            printf("varies");
+            testResult.status = "varies";
             goto done;
         }
 
@@ -674,24 +910,86 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         result = (samples[elem-1] + samples[elem]) * 0.5;
     } while (fabs(result - prevResult) > threshold * result);
 
-    printf("%6.3f", result / double(totalFrames - warmUpFrames) / 1e6);
+    testResult.frameTime = result / double(totalFrames - warmUpFrames) / 1e6;
+
+    // One more pass, long enough for meaningful latency percentiles.
+    if (r.run(warmUpFrames, warmUpFrames + g_LatencyFrames, &latencies) < 0) {
+        success = false;
+        goto done;
+    }
+    computePercentiles(latencies, &testResult);
 
 done:
 
-    printf("\n");
-    fflush(stdout);
+    if (success) {
+        printResult("composition", b.name, runWidth, runHeight, testResult);
+    } else if (!g_MachineReadable) {
+        printf("\n");
+    }
     r.tearDown();
 
     return success;
 }
 
+// Run the BufferQueue round trip test at one resolution and print the
+// per-frame latencies of each stage.
+static bool runBufferQueueTest(uint32_t w, uint32_t h) {
+    static const char* const names[] = {
+        "BufferQueue dequeue+queue",
+        "BufferQueue acquire",
+        "BufferQueue end-to-end",
+    };
+    Vector<nsecs_t> times[NELEMS(names)];
+
+    BufferQueueRunner r;
+    if (!r.setUp(w, h)) {
+        fprintf(stderr, "error initializing runner.\n");
+        r.tearDown();
+        return false;
+    }
+
+    // Warm up, then measure.
+    bool success = r.run(4, &times[0], &times[1], &times[2]);
+    for (int i = 0; i < NELEMS(names); i++) {
+        times[i].clear();
+    }
+    success = success &&
+            r.run(g_LatencyFrames, &times[0], &times[1], &times[2]);
+    r.tearDown();
+
+    if (!success) {
+        return false;
+    }
+
+    for (int i = 0; i < NELEMS(names); i++) {
+        TestResult testResult = { "ok", 0.0, 0.0, 0.0, 0.0 };
+        nsecs_t sum = 0;
+        for (size_t j = 0; j < times[i].size(); j++) {
+            sum += times[i][j];
+        }
+        testResult.frameTime = double(sum) / double(times[i].size()) / 1e6;
+        computePercentiles(times[i], &testResult);
+
+        printTestName(names[i], w, h);
+        printResult("bufferqueue", names[i], w, h, testResult);
+    }
+
+    return true;
+}
+
 static void printResultsTableHeader() {
+    if (g_MachineReadable) {
+        printf("kind,scenario,width,height,status,"
+                "time_ms,p50_ms,p90_ms,p99_ms\n");
+        return;
+    }
+
     const char* scenario = "Scenario";
     size_t len = strlen(scenario);
     size_t leftPad = (g_BenchmarkNameLen - len) / 2;
     size_t rightPad = g_BenchmarkNameLen - len - leftPad;
-    printf(" %*s%s%*s | Resolution  | Time (ms)\n", leftPad, "",
-            "Scenario", rightPad, "");
+    printf(" %*s%s%*s | Resolution  | Time (ms) |  p50 ms |  p90 ms |  p99 ms\n",
+            leftPad, "", "Scenario", rightPad, "");
 }
 
 // Run ALL the benchmarks!
@@ -706,12 +1004,21 @@ static bool runTests() {
             }
         }
     }
+
+    // The BufferQueue tests use the aspect ratio of the first benchmark.
+    const BenchmarkDesc& b = benchmarks[0];
+    for (int i = 0; i < NELEMS(bufferQueueRunHeights); i++) {
+        uint32_t h = bufferQueueRunHeights[i];
+        if (!runBufferQueueTest(b.width * h / b.height, h)) {
+            return false;
+        }
+    }
     return true;
 }
 
 // Return the length longest benchmark name.
 static size_t maxBenchmarkNameLen() {
-    size_t maxLen = 0;
+    size_t maxLen = strlen("BufferQueue dequeue+queue");
     for (size_t i = 0; i < NELEMS(benchmarks); i++) {
         const BenchmarkDesc& b = benchmarks[i];
         size_t len = strlen(b.name);
@@ -728,6 +1035,7 @@ static void showHelp(const char *cmd) {
     fprintf(stderr, "options include:\n"
                     "  -s N            sleep for N ms between samples\n"
                     "  -d              display the test frame to a window\n"
+                    "  -m              machine-readable (CSV) output\n"
                     "  --help          print this helpful message and exit\n"
             );
 }
@@ -746,7 +1054,7 @@ int main(int argc, char** argv) {
             {     0,               0, 0,  0 }
         };
 
-        ret = getopt_long(argc, argv, "ds:",
+        ret = getopt_long(argc, argv, "dms:",
                           long_options, &option_index);
 
         if (ret < 0) {
@@ -758,6 +1066,10 @@ int main(int argc, char** argv) {
                 g_PresentToWindow = true;
             break;
 
+            case 'm':
+                g_MachineReadable = true;
+            break;
+
             case 's':
                 g_SleepBetweenSamplesMs = atoi(optarg);
             break;
@@ -777,11 +1089,13 @@ int main(int argc, char** argv) {
 
     g_BenchmarkNameLen = maxBenchmarkNameLen();
 
-    printf(" cmdline:");
-    for (int i = 0; i < argc; i++) {
-        printf(" %s", argv[i]);
+    if (!g_MachineReadable) {
+        printf(" cmdline:");
+        for (int i = 0; i < argc; i++) {
+            printf(" %s", argv[i]);
+        }
+        printf("\n");
     }
-    printf("\n");
 
     if (!runTests()) {
         fprintf(stderr, "exiting due to error.\n");
@@ -193,5 +193,39 @@ Renderer* staticGradient() {
     return new NoRenderer;
 }
 
+// Renders new content into the layer every frame, like an animating app.
+Renderer* animatedGradient() {
+    class AnimatedRenderer : public Renderer {
+        virtual bool setUp(GLHelper* helper) {
+            mGLHelper = helper;
+            return mGradientRenderer.setUp(helper);
+        }
+
+        virtual void tearDown() {
+            mGradientRenderer.tearDown();
+        }
+
+        virtual bool render(EGLSurface surface) {
+            bool result;
+
+            result = mGLHelper->makeCurrent(surface);
+            if (!result) {
+                return false;
+            }
+
+            result = mGradientRenderer.drawGradient();
+            if (!result) {
+                return false;
+            }
+
+            return mGLHelper->swapBuffers(surface);
+        }
+
+        GLHelper* mGLHelper;
+        GradientRenderer mGradientRenderer;
+    };
+    return new AnimatedRenderer;
+}
+
 
 } // namespace android
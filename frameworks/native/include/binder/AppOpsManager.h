@@ -67,7 +67,10 @@ public:
     };
 
     AppOpsManager();
+    ~AppOpsManager();
 
+    // checkOp answers from a local cache of the modes it already got from
+    // the service, the cache watches the service for mode changes.
     int32_t checkOp(int32_t op, int32_t uid, const String16& callingPackage);
     int32_t noteOp(int32_t op, int32_t uid, const String16& callingPackage);
     int32_t startOp(int32_t op, int32_t uid, const String16& callingPackage);
@@ -77,10 +80,18 @@ public:
     void stopWatchingMode(const sp<IAppOpsCallback>& callback);
 
 private:
+    class ModeCache;
+
     Mutex mLock;
     sp<IAppOpsService> mService;
 
+    // mCacheLock protects mModeCache, which is replaced when the service
+    // changes.
+    Mutex mCacheLock;
+    sp<ModeCache> mModeCache;
+
     sp<IAppOpsService> getService();
+    sp<ModeCache> getModeCache(const sp<IAppOpsService>& service);
 };
 
 
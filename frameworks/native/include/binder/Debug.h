@@ -39,6 +39,10 @@ void printHexData(int32_t indent, const void *buf, size_t length,
     size_t alignment=0, bool cArrayStyle=false,
     debugPrintFunc func = 0, void* cookie = 0);
 
+// Prints the binder transaction statistics of this process, see
+// IPCThreadState::enableTransactionStats().
+void printTransactionStats(debugPrintFunc func = 0, void* cookie = 0);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,7 @@
 #include <utils/Errors.h>
 #include <binder/Parcel.h>
 #include <binder/ProcessState.h>
+#include <utils/Timers.h>
 #include <utils/Vector.h>
 
 #ifdef HAVE_WIN32_PROC
@@ -29,6 +30,9 @@ typedef  int  uid_t;
 // ---------------------------------------------------------------------------
 namespace android {
 
+class String8;
+class TransactionStats;
+
 class IPCThreadState
 {
 public:
@@ -64,6 +68,19 @@ public:
                                          uint32_t code, const Parcel& data,
                                          Parcel* reply, uint32_t flags);
 
+            struct OnewayTransaction {
+                int32_t         handle;
+                uint32_t        code;
+                const Parcel*   data;
+            };
+
+            // Sends count oneway transactions, in order, with a single write
+            // to the driver instead of one round trip each.  Returns the
+            // first error, the transactions that follow a failed one are
+            // still sent.
+            status_t            transactOneway(const OnewayTransaction* transactions,
+                                               size_t count);
+
             void                incStrongHandle(int32_t handle);
             void                decStrongHandle(int32_t handle);
             void                incWeakHandle(int32_t handle);
@@ -83,8 +100,21 @@ public:
     // in to it but doesn't want to acquire locks in its services while in
     // the background.
     static  void                disableBackgroundScheduling(bool disable);
+
+    // Call this to record the latency and the parcel sizes of every
+    // transaction sent and received by this process, for each interface
+    // and transaction code.  It is also enabled by the debug.binder.stats
+    // system property.  Recording is cheap but not free, it is off by
+    // default.
+    static  void                enableTransactionStats(bool enable);
+
+    // Appends the transaction statistics of all the threads of this
+    // process to result.
+    static  void                dumpTransactionStats(String8& result);
     
 private:
+    friend class PoolThread;
+
                                 IPCThreadState();
                                 ~IPCThreadState();
 
@@ -122,6 +152,22 @@ private:
             uid_t               mCallingUid;
             int32_t             mStrictModePolicy;
             int32_t             mLastTransactionBinderFlags;
+
+            // mStats is allocated the first time this thread records a
+            // transaction.  mWaitTime accumulates the time spent blocked in
+            // the driver by the outgoing transaction in progress, when
+            // mTimingWait is set.
+            TransactionStats*   mStats;
+            bool                mTimingWait;
+            nsecs_t             mWaitTime;
+
+            // mInThreadPool is set while this thread runs joinThreadPool,
+            // mReservedThread if it was spawned as a reserved thread of the
+            // pool.  mIdleTime is how long the last read from the driver
+            // waited for a command.
+            bool                mInThreadPool;
+            bool                mReservedThread;
+            nsecs_t             mIdleTime;
 };
 
 }; // namespace android
@@ -28,13 +28,21 @@ namespace android {
 // ----------------------------------------------------------------------------
 
 class SimpleBestFitAllocator;
+class SlabAllocator;
 
 // ----------------------------------------------------------------------------
 
 class MemoryDealer : public RefBase
 {
 public:
-    MemoryDealer(size_t size, const char* name = 0);
+    enum {
+        // allocations of up to 4 KB are carved out of slabs of objects of
+        // the same size class, which keeps the heap from fragmenting when
+        // many small blocks are allocated and freed.
+        SLAB_ALLOCATIONS = 0x00000001
+    };
+
+    MemoryDealer(size_t size, const char* name = 0, uint32_t flags = 0);
 
     virtual sp<IMemory> allocate(size_t size);
     virtual void        deallocate(size_t offset);
@@ -51,6 +59,7 @@ private:
 
     sp<IMemoryHeap>             mHeap;
     SimpleBestFitAllocator*     mAllocator;
+    SlabAllocator*              mSlabAllocator;
 };
 
 
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_ONEWAY_BATCHER_H
+#define ANDROID_ONEWAY_BATCHER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <binder/IBinder.h>
+#include <utils/Looper.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+class Parcel;
+
+// OnewayBatcher queues oneway calls and sends all the calls queued during one
+// hop of a Looper with a single write to the binder driver, rather than with
+// a round trip each.  It is meant for high-rate callbacks such as listeners
+// notified of every frame or sensor event.
+//
+// A call can be queued with a merge key, in which case it replaces the call
+// of the same target, code and key still in the queue: only the last value
+// is delivered.  The receiving side sees ordinary oneway transactions, in the
+// order they were queued.
+class OnewayBatcher : public MessageHandler
+{
+public:
+    enum { NO_MERGE = -1 };
+
+    // The queued calls are sent the next time looper processes its
+    // messages.  If looper is NULL, they are only sent by flush().
+    OnewayBatcher(const sp<Looper>& looper);
+
+    // Queues a oneway call of code on target with a copy of data.  Calls to
+    // local binders are queued too, and are made from flush().
+    status_t            queue(const sp<IBinder>& target, uint32_t code,
+                              const Parcel& data, int32_t mergeKey = NO_MERGE);
+
+    // Sends the queued calls now.  Returns the first error.
+    status_t            flush();
+
+protected:
+    virtual ~OnewayBatcher();
+
+    virtual void        handleMessage(const Message& message);
+
+private:
+    struct Call {
+        sp<IBinder>     target;
+        uint32_t        code;
+        int32_t         mergeKey;
+        Parcel*         data;
+    };
+
+    const sp<Looper>    mLooper;
+
+    // mFlushLock serializes the flushes so that the calls are sent in the
+    // order they were queued.  It is always taken before mLock.
+    Mutex               mFlushLock;
+
+    // mLock protects mCalls and mFlushScheduled.
+    Mutex               mLock;
+    Vector<Call>        mCalls;
+    bool                mFlushScheduled;
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
+
+#endif // ANDROID_ONEWAY_BATCHER_H
@@ -22,7 +22,7 @@
 
 #include <utils/String16.h>
 #include <utils/Singleton.h>
-#include <utils/SortedVector.h>
+#include <utils/threads.h>
 
 namespace android {
 // ---------------------------------------------------------------------------
@@ -30,32 +30,54 @@ namespace android {
 /*
  * PermissionCache caches permission checks for a given uid.
  *
- * Currently the cache is not updated when there is a permission change,
- * for instance when an application is uninstalled.
+ * The cache is not updated by itself when there is a permission change,
+ * for instance when an application is uninstalled.  Services that learn
+ * about such changes can call invalidate().
  *
  * IMPORTANT: for the reason stated above, only system permissions are safe
  * to cache. This restriction may be lifted at a later time.
  *
+ * Lookups don't take any lock.  The cache is split in shards, each shard
+ * is protected by a sequence number that writers make odd while they update
+ * it; readers retry when the number changed under them.
+ *
  */
 
 class PermissionCache : Singleton<PermissionCache> {
-    struct Entry {
-        String16    name;
-        uid_t       uid;
-        bool        granted;
-        inline bool operator < (const Entry& e) const {
-            return (uid == e.uid) ? (name < e.name) : (uid < e.uid);
-        }
+    // MAX_NAMES is the number of different permissions cached, the checks of
+    // the other permissions always go to the permission controller.
+    enum { MAX_NAMES = 64 };
+    enum { NUM_SHARDS = 16 };
+    enum { SHARD_SIZE = 16 };
+
+    struct Shard {
+        // lock serializes the writers of the shard
+        Mutex               lock;
+        volatile int32_t    seq;
+        volatile int32_t    uids[SHARD_SIZE];
+        // 0 for an empty slot, else (name index + 1) << 1 | granted
+        volatile int32_t    values[SHARD_SIZE];
+        // next is the slot replaced when the shard is full
+        uint32_t            next;
     };
-    mutable Mutex mLock;
+
     // we pool all the permission names we see, as many permissions checks
-    // will have identical names
-    SortedVector< String16 > mPermissionNamesPool;
-    // this is our cache per say. it stores pooled names.
-    SortedVector< Entry > mCache;
+    // will have identical names.  Names are only ever added, under mLock,
+    // readers only look at the first mNameCount ones.
+    mutable Mutex mLock;
+    String16 mNames[MAX_NAMES];
+    volatile int32_t mNameCount;
+
+    // this is our cache per say. it stores indices of pooled names.
+    Shard mShards[NUM_SHARDS];
 
-    // free the whole cache, but keep the permission name pool
-    void purge();
+    ssize_t findName(const String16& permission) const;
+    ssize_t addName(const String16& permission);
+    static size_t shardIndex(uid_t uid, ssize_t name);
+
+    // free the cache entries of uid, or of all the uids if uid is -1,
+    // but keep the permission name pool
+    void purge(uid_t uid);
 
     status_t check(bool* granted,
             const String16& permission, uid_t uid) const;
@@ -72,6 +94,11 @@ public:
 
     static bool checkPermission(const String16& permission,
             pid_t pid, uid_t uid);
+
+    // forget the cached checks of all the uids, or of the given uid, for
+    // instance when the package of uid changed.
+    static void invalidate();
+    static void invalidate(uid_t uid);
 };
 
 // ---------------------------------------------------------------------------
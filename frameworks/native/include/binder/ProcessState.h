@@ -21,6 +21,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/String8.h>
 #include <utils/String16.h>
+#include <utils/Timers.h>
 
 #include <utils/threads.h>
 
@@ -73,6 +74,25 @@ public:
             status_t            setThreadPoolMaxThreadCount(size_t maxThreads);
             void                giveThreadPoolName();
 
+            // Pooled threads that waited longer than timeout for their last
+            // command exit once they're done with it, as long as another
+            // thread is left waiting.  The driver spawns new threads again
+            // when the pool runs out of waiting threads.  0, the default
+            // unless ro.binder.idle_timeout_ms is set, keeps them forever.
+            void                setThreadPoolIdleTimeout(nsecs_t timeout);
+
+            // When a caller of higher than normal priority gets the last
+            // waiting thread of the pool, up to count reserved threads are
+            // spawned, beyond the maximum given to the driver, so that the
+            // next such callers don't have to wait for a thread.  0, the
+            // default unless ro.binder.reserved_threads is set, disables
+            // them.
+            void                setThreadPoolReservedThreadCount(size_t count);
+
+            // Appends the thread pool state and saturation counters to
+            // result.
+            void                dumpThreadPool(String8& result) const;
+
 private:
     friend class IPCThreadState;
     
@@ -82,6 +102,17 @@ private:
                                 ProcessState(const ProcessState& o);
             ProcessState&       operator=(const ProcessState& o);
             String8             makeBinderThreadName();
+
+            // Called by IPCThreadState as threads join and leave the pool,
+            // and around each transaction they execute.
+            void                threadPoolThreadJoined();
+            void                threadPoolThreadExited(bool isMain,
+                                                       bool isReserved,
+                                                       bool retired);
+            bool                shouldRetireThread(nsecs_t idleTime) const;
+            void                beginPooledTransaction(pid_t tid);
+            void                endPooledTransaction();
+            void                spawnReservedThread();
             
             struct handle_entry {
                 IBinder* binder;
@@ -108,6 +139,23 @@ private:
             String8             mRootDir;
             bool                mThreadPoolStarted;
     volatile int32_t            mThreadPoolSeq;
+
+            // mMaxThreads is the maximum number of threads the driver may
+            // spawn.  The driver doesn't forget the threads that exited, so
+            // the maximum it is given is raised by mRetiredThreads.
+            size_t              mMaxThreads;
+            nsecs_t             mIdleTimeout;
+            size_t              mMaxReservedThreads;
+            size_t              mReservedThreads;
+
+            // these are updated without holding mLock
+    volatile int32_t            mThreadPoolThreads;
+    volatile int32_t            mExecutingThreads;
+            int32_t             mMaxExecutingThreads;
+    volatile int32_t            mSaturatedCount;
+    volatile int32_t            mSpawnedThreads;
+            uint32_t            mRetiredThreads;
+            uint32_t            mSpawnedReservedThreads;
 };
     
 }; // namespace android
@@ -47,6 +47,10 @@ public:
     enum { INVALID_BUFFER_SLOT = -1 };
     enum { STALE_BUFFER_SLOT = 1, NO_BUFFER_AVAILABLE, PRESENT_LATER };
 
+    // MAX_FREE_BUFFERS is the number of buffers kept for reuse after a
+    // geometry change or by allocateBuffers.
+    enum { MAX_FREE_BUFFERS = 4 };
+
     // When in async mode we reserve two slots in order to guarantee that the
     // producer and consumer can run asynchronously.
     enum { MAX_MAX_ACQUIRED_BUFFERS = NUM_BUFFER_SLOTS - 2 };
@@ -207,6 +211,12 @@ public:
     // connected to the specified producer API.
     virtual status_t disconnect(int api);
 
+    // allocateBuffers allocates buffers of the given geometry outside of the
+    // lock and keeps them in the free buffer pool, where dequeueBuffer looks
+    // for them before allocating new buffers.  See IGraphicBufferProducer.
+    virtual void allocateBuffers(bool async, uint32_t w, uint32_t h,
+            uint32_t format, uint32_t usage, int count);
+
     /*
      * IGraphicBufferConsumer interface
      */
@@ -356,6 +366,63 @@ private:
     // in one of the slots.
     bool stillTracking(const BufferItem *item) const;
 
+    // LockStats counts how often one side of the BufferQueue, the producer
+    // or the consumer, had to wait for mMutex and for how long.  It is
+    // reported by dump.
+    struct LockStats {
+        LockStats() : count(0), contended(0), waitTime(0), maxWaitTime(0) { }
+        uint32_t count;
+        uint32_t contended;
+        nsecs_t waitTime;
+        nsecs_t maxWaitTime;
+    };
+
+    // StatsAutolock locks mMutex for the lifetime of the object, like
+    // Mutex::Autolock, and records in the given LockStats whether it had to
+    // wait for it.
+    class StatsAutolock {
+    public:
+        StatsAutolock(Mutex& mutex, LockStats& stats);
+        ~StatsAutolock() { mMutex.unlock(); }
+    private:
+        Mutex& mMutex;
+    };
+
+    // A FreeBuffer is a buffer that was allocated for a geometry the
+    // producer doesn't use anymore, or ahead of time by allocateBuffers.
+    // It's handed out again by dequeueBuffer if the producer asks for that
+    // geometry before it expires.  mFence is the release fence of the
+    // buffer's last use and mTime the time it entered the pool.
+    struct FreeBuffer {
+        sp<GraphicBuffer> mGraphicBuffer;
+        sp<Fence> mFence;
+        nsecs_t mTime;
+    };
+
+    // addFreeBufferLocked adds a buffer to the free buffer pool.  If the pool
+    // is full, the oldest buffer is evicted and returned, so that the caller
+    // can drop it after releasing the lock.
+    sp<GraphicBuffer> addFreeBufferLocked(const sp<GraphicBuffer>& buffer,
+            const sp<Fence>& fence);
+
+    // takeFreeBufferLocked removes from the pool and returns a buffer that
+    // matches the given geometry, along with its fence, or NULL.
+    sp<GraphicBuffer> takeFreeBufferLocked(uint32_t w, uint32_t h,
+            uint32_t format, uint32_t usage, sp<Fence>* outFence);
+
+    // expireFreeBuffersLocked removes the buffers that were in the pool for
+    // too long and appends them to expired, to be dropped without the lock.
+    void expireFreeBuffersLocked(Vector<sp<GraphicBuffer> >* expired);
+
+    // waitForDequeueConditionLocked waits on mDequeueCondition.  It must be
+    // used instead of waiting on mDequeueCondition directly, so that
+    // broadcastDequeueConditionLocked knows whether there is anyone to wake.
+    void waitForDequeueConditionLocked();
+
+    // broadcastDequeueConditionLocked broadcasts mDequeueCondition if a
+    // thread is waiting on it.
+    void broadcastDequeueConditionLocked();
+
     struct BufferSlot {
 
         BufferSlot()
@@ -545,6 +612,22 @@ private:
     // member variables are accessed.
     mutable Mutex mMutex;
 
+    // mProducerLockStats and mConsumerLockStats count the contention on
+    // mMutex in the producer and consumer buffer paths.
+    LockStats mProducerLockStats;
+    LockStats mConsumerLockStats;
+
+    // mDequeueWaiters is the number of threads waiting on mDequeueCondition.
+    // mDequeueWaitCount and mDequeueWaitTime count how often and how long
+    // they waited.
+    int mDequeueWaiters;
+    uint32_t mDequeueWaitCount;
+    nsecs_t mDequeueWaitTime;
+
+    // mFreeBuffers is the pool of buffers kept for reuse by dequeueBuffer,
+    // oldest first.
+    Vector<FreeBuffer> mFreeBuffers;
+
     // mFrameCounter is the free running counter, incremented on every
     // successful queueBuffer call, and buffer allocation.
     uint64_t mFrameCounter;
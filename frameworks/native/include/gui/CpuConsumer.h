@@ -98,18 +98,40 @@ class CpuConsumer : public ConsumerBase
     // by calling unlockBuffer before more buffers can be acquired.
     status_t lockNextBuffer(LockedBuffer *nativeBuffer);
 
+    // Locks up to maxBuffers of the next graphics buffers at once, filling
+    // out nativeBuffers in queue order. Returns the number of buffers locked,
+    // which is 0 if no new buffer is available, or a negative error if the
+    // first buffer couldn't be locked. Fewer buffers are locked if the
+    // maximum number of locked buffers is reached. Each of them is returned
+    // with unlockBuffer.
+    ssize_t lockNextBuffers(LockedBuffer *nativeBuffers, size_t maxBuffers);
+
     // Returns a locked buffer to the queue, allowing it to be reused. Since
     // only a fixed number of buffers may be locked at a time, old buffers must
     // be released by calling unlockBuffer to ensure new buffers can be acquired by
     // lockNextBuffer.
     status_t unlockBuffer(const LockedBuffer &nativeBuffer);
 
+    // Keeps each buffer mapped for CPU access after it's unlocked, so that
+    // the next time it comes through the queue lockNextBuffer doesn't have to
+    // map it again. The mappings are dropped when the buffers are freed, for
+    // instance when the producer reallocates them. Only use this for buffers
+    // whose CPU mappings stay coherent with what the producer writes, since
+    // gralloc does no cache maintenance for buffers that aren't unlocked.
+    // Disabled by default.
+    void setPersistentMapping(bool enabled);
+
   private:
     // Maximum number of buffers that can be locked at a time
     uint32_t mMaxLockedBuffers;
 
+    status_t lockNextBufferLocked(LockedBuffer *nativeBuffer);
+
     status_t releaseAcquiredBufferLocked(int lockedIdx);
 
+    // Drops the persistent CPU mapping of a slot, if any
+    void unmapSlotLocked(int slotIndex);
+
     virtual void freeBufferLocked(int slotIndex);
 
     // Tracking for buffers acquired by the user
@@ -120,14 +142,33 @@ class CpuConsumer : public ConsumerBase
         int mSlot;
         sp<GraphicBuffer> mGraphicBuffer;
         void *mBufferPointer;
+        // Whether the buffer has to be unlocked when it's released, rather
+        // than staying mapped in mSlotMappings
+        bool mUnlockOnRelease;
 
         AcquiredBuffer() :
                 mSlot(BufferQueue::INVALID_BUFFER_SLOT),
-                mBufferPointer(NULL) {
+                mBufferPointer(NULL),
+                mUnlockOnRelease(false) {
         }
     };
     Vector<AcquiredBuffer> mAcquiredBuffers;
 
+    // Persistent CPU mappings of the slot buffers, indexed by slot
+    struct SlotMapping {
+        // The mapped buffer, NULL if the slot isn't mapped
+        sp<GraphicBuffer> mGraphicBuffer;
+        void *mBufferPointer;
+        android_ycbcr mYCbCr;
+
+        SlotMapping() :
+                mBufferPointer(NULL),
+                mYCbCr() {
+        }
+    };
+    SlotMapping mSlotMappings[BufferQueue::NUM_BUFFER_SLOTS];
+    bool mPersistentMapping;
+
     // Count of currently locked buffers
     uint32_t mCurrentLockedBuffers;
 
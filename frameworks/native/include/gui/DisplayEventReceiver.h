@@ -54,6 +54,11 @@ public:
 
         struct VSync {
             uint32_t count;
+            // When a frame started on this event is expected to be
+            // presented, and the time by which it must be queued to be
+            // composed for that. Both are 0 if they are not known.
+            nsecs_t expectedPresentTime;
+            nsecs_t deadline;
         };
 
         struct Hotplug {
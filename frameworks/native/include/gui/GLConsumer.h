@@ -162,6 +162,22 @@ public:
     // for use with bilinear filtering.
     void setFilteringEnabled(bool enabled);
 
+    // setUseSlotTextures makes updateTexImage bind each buffer slot to a
+    // texture of its own, created in the current context, instead of the
+    // texture passed at construction.  A slot's EGLImage is then attached to
+    // its texture only once rather than on every frame, and the caller must
+    // bind getCurrentTextureName() after updateTexImage.  It must be called
+    // before the first updateTexImage.
+    void setUseSlotTextures(bool enabled);
+
+    // getCurrentTextureName returns the name of the texture the current
+    // image is bound to.
+    uint32_t getCurrentTextureName() const;
+
+    // takeSlotTextureNames gives up the textures created for the buffer
+    // slots; the caller must delete them in the consumer's context.
+    void takeSlotTextureNames(Vector<uint32_t>* names);
+
     // getCurrentBuffer returns the buffer associated with the current image.
     sp<GraphicBuffer> getCurrentBuffer() const;
 
@@ -178,6 +194,11 @@ public:
     // getCurrentScalingMode returns the scaling mode of the current buffer.
     uint32_t getCurrentScalingMode() const;
 
+    // getCurrentSurfaceDamage returns the region of the current buffer that
+    // changed since the previous buffer, in buffer coordinates. An empty
+    // region means the whole buffer may have changed.
+    Region getCurrentSurfaceDamage() const;
+
     // getCurrentFence returns the fence indicating when the current buffer is
     // ready to be read from.
     sp<Fence> getCurrentFence() const;
@@ -306,6 +327,10 @@ private:
     // binding the buffer without touching the EglSlots.
     status_t bindUnslottedBufferLocked(EGLDisplay dpy);
 
+    // destroyEglImageLocked destroys the EGLImage of the given slot, and
+    // forgets that it was attached to any texture.
+    void destroyEglImageLocked(int slot);
+
     // returns a graphic buffer used when the texture image has been released
     static sp<GraphicBuffer> getDebugTexImageBuffer();
 
@@ -332,6 +357,10 @@ private:
     // set each time updateTexImage is called.
     uint32_t mCurrentScalingMode;
 
+    // mCurrentSurfaceDamage is the damage of the current texture. It gets
+    // set each time updateTexImage is called.
+    Region mCurrentSurfaceDamage;
+
     // mCurrentFence is the fence received from BufferQueue in updateTexImage.
     sp<Fence> mCurrentFence;
 
@@ -360,6 +389,19 @@ private:
     // and can be changed with a call to attachToContext.
     uint32_t mTexName;
 
+    // mBoundImage is the EGLImage last attached to mTexName, so that binding
+    // the same image again can skip glEGLImageTargetTexture2DOES.
+    EGLImageKHR mBoundImage;
+
+    // mUseSlotTextures indicates whether each buffer slot has a texture of
+    // its own.  It is set by setUseSlotTextures().
+    bool mUseSlotTextures;
+
+    // mCurrentFenceWaited indicates whether the GL command stream already
+    // waits for mCurrentFence, so binding the texture again does not need
+    // to wait for it another time.
+    bool mCurrentFenceWaited;
+
     // mUseFenceSync indicates whether creation of the EGL_KHR_fence_sync
     // extension should be used to prevent buffers from being dequeued before
     // it's safe for them to be written. It gets set at construction time and
@@ -380,7 +422,9 @@ private:
     struct EglSlot {
         EglSlot()
         : mEglImage(EGL_NO_IMAGE_KHR),
-          mEglFence(EGL_NO_SYNC_KHR) {
+          mEglFence(EGL_NO_SYNC_KHR),
+          mTexName(0),
+          mBoundImage(EGL_NO_IMAGE_KHR) {
         }
 
         // mEglImage is the EGLImage created from mGraphicBuffer.
@@ -395,6 +439,14 @@ private:
         // to EGL_NO_SYNC_KHR when the buffer is created and (optionally, based
         // on a compile-time option) set to a new sync object in updateTexImage.
         EGLSyncKHR mEglFence;
+
+        // mTexName is the texture of the slot when mUseSlotTextures is set,
+        // or 0 if it has not been created yet.  It lives as long as the
+        // GLConsumer stays attached to its context.
+        uint32_t mTexName;
+
+        // mBoundImage is the EGLImage last attached to mTexName.
+        EGLImageKHR mBoundImage;
     };
 
     // mEglDisplay is the EGLDisplay with which this GLConsumer is currently
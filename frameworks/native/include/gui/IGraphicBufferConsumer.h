@@ -26,6 +26,7 @@
 
 #include <binder/IInterface.h>
 #include <ui/Rect.h>
+#include <ui/Region.h>
 
 namespace android {
 // ----------------------------------------------------------------------------
@@ -95,6 +96,11 @@ public:
         // Indicates this buffer must be transformed by the inverse transform of the screen
         // it is displayed onto. This is applied after mTransform.
         bool mTransformToDisplayInverse;
+
+        // mSurfaceDamage is the region of the buffer whose content changed
+        // since the previous frame, in buffer coordinates. It is empty when
+        // the whole buffer may have changed.
+        Region mSurfaceDamage;
     };
 
 
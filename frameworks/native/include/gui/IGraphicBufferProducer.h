@@ -28,6 +28,7 @@
 #include <ui/Fence.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/Rect.h>
+#include <ui/Region.h>
 
 namespace android {
 // ----------------------------------------------------------------------------
@@ -101,6 +102,10 @@ public:
     //
     // The async parameter sets whether we're queuing a buffer in asynchronous mode.
     //
+    // The surfaceDamage parameter is the region of the buffer, in buffer
+    // coordinates, whose content changed since the previous queued buffer.
+    // An empty region means the whole buffer may have changed.
+    //
     // outWidth, outHeight and outTransform are filled with the default width
     // and height of the window and current transform applied to buffers,
     // respectively.
@@ -110,13 +115,14 @@ public:
         inline QueueBufferInput(const Parcel& parcel);
         inline QueueBufferInput(int64_t timestamp, bool isAutoTimestamp,
                 const Rect& crop, int scalingMode, uint32_t transform, bool async,
-                const sp<Fence>& fence)
+                const sp<Fence>& fence, const Region& surfaceDamage = Region())
         : timestamp(timestamp), isAutoTimestamp(isAutoTimestamp), crop(crop),
           scalingMode(scalingMode), transform(transform), async(async),
-          fence(fence) { }
+          fence(fence), surfaceDamage(surfaceDamage) { }
         inline void deflate(int64_t* outTimestamp, bool* outIsAutoTimestamp,
                 Rect* outCrop, int* outScalingMode, uint32_t* outTransform,
-                bool* outAsync, sp<Fence>* outFence) const {
+                bool* outAsync, sp<Fence>* outFence,
+                Region* outSurfaceDamage = NULL) const {
             *outTimestamp = timestamp;
             *outIsAutoTimestamp = bool(isAutoTimestamp);
             *outCrop = crop;
@@ -124,6 +130,9 @@ public:
             *outTransform = transform;
             *outAsync = bool(async);
             *outFence = fence;
+            if (outSurfaceDamage) {
+                *outSurfaceDamage = surfaceDamage;
+            }
         }
 
         // Flattenable protocol
@@ -140,6 +149,7 @@ public:
         uint32_t transform;
         int async;
         sp<Fence> fence;
+        Region surfaceDamage;
     };
 
     // QueueBufferOutput must be a POD structure
@@ -204,6 +214,18 @@ public:
     // This method will fail if the the IGraphicBufferProducer is not currently
     // connected to the specified client API.
     virtual status_t disconnect(int api) = 0;
+
+    // allocateBuffers allocates up to count buffers of the given size,
+    // format and usage ahead of time, for instance right before a known
+    // geometry change.  The buffers are kept until a dequeueBuffer call asks
+    // for that geometry, which then doesn't have to wait for gralloc.  A
+    // width and height of 0 and a format of 0 select the defaults, like in
+    // dequeueBuffer.
+    //
+    // This call is asynchronous: it may return before the buffers are
+    // allocated, and buffers that aren't used shortly are freed again.
+    virtual void allocateBuffers(bool async, uint32_t w, uint32_t h,
+            uint32_t format, uint32_t usage, int count) = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -26,6 +26,7 @@
 #include <binder/IInterface.h>
 
 #include <ui/PixelFormat.h>
+#include <ui/Rect.h>
 
 #include <gui/IGraphicBufferAlloc.h>
 #include <gui/ISurfaceComposerClient.h>
@@ -116,10 +117,13 @@ public:
 
     /* Capture the specified screen. requires READ_FRAME_BUFFER permission
      * This function will fail if there is a secure window on screen.
+     * Only the sourceCrop region of the display is captured, or all of it if
+     * sourceCrop is empty. The buffer is queued to the producer with a fence
+     * that signals once rendering is complete.
      */
     virtual status_t captureScreen(const sp<IBinder>& display,
             const sp<IGraphicBufferProducer>& producer,
-            uint32_t reqWidth, uint32_t reqHeight,
+            Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
             uint32_t minLayerZ, uint32_t maxLayerZ) = 0;
 };
 
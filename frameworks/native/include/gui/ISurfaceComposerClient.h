@@ -46,6 +46,7 @@ public:
         eOpaque             = 0x00000400,
         eProtectedByApp     = 0x00000800,
         eProtectedByDRM     = 0x00001000,
+        eCursorWindow       = 0x00002000,
 
         eFXSurfaceNormal    = 0x00000000,
         eFXSurfaceDim       = 0x00020000,
@@ -65,6 +66,14 @@ public:
      * Requires ACCESS_SURFACE_FLINGER permission
      */
     virtual status_t destroySurface(const sp<IBinder>& handle) = 0;
+
+    /*
+     * Moves a surface created with eCursorWindow without going through a
+     * transaction. The call is one-way, so it never blocks the caller.
+     * Requires ACCESS_SURFACE_FLINGER permission
+     */
+    virtual status_t setCursorPosition(const sp<IBinder>& handle,
+            float x, float y) = 0;
 };
 
 // ----------------------------------------------------------------------------
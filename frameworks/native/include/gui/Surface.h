@@ -78,6 +78,13 @@ public:
         return surface != NULL && surface->getIGraphicBufferProducer() != NULL;
     }
 
+    /* allocateBuffers asks the IGraphicBufferProducer to allocate count
+     * buffers of the given size, with the current format and usage, ahead
+     * of a known resize so that the first frames at the new size don't wait
+     * for the allocations. It doesn't block.
+     */
+    void allocateBuffers(uint32_t w, uint32_t h, int count);
+
 protected:
     virtual ~Surface();
 
@@ -148,6 +155,11 @@ public:
     virtual int lock(ANativeWindow_Buffer* outBuffer, ARect* inOutDirtyBounds);
     virtual int unlockAndPost();
 
+    // sets the region of the next queued buffer whose content changed since
+    // the previously queued buffer, in buffer coordinates. An empty region,
+    // the default, means the whole buffer may have changed.
+    virtual int setSurfaceDamage(const Region& damage);
+
 protected:
     enum { NUM_BUFFER_SLOTS = BufferQueue::NUM_BUFFER_SLOTS };
     enum { DEFAULT_FORMAT = PIXEL_FORMAT_RGBA_8888 };
@@ -208,6 +220,11 @@ private:
     // buffer that gets queued. It is set by calling setTransform.
     uint32_t mTransform;
 
+    // mSurfaceDamage is the damage that will be used for the next buffer
+    // that gets queued. It is set by calling setSurfaceDamage and reset
+    // once the buffer is queued.
+    Region mSurfaceDamage;
+
      // mDefaultWidth is default width of the buffers, regardless of the
      // native_window_set_buffers_dimensions call.
      uint32_t mDefaultWidth;
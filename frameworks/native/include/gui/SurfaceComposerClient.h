@@ -125,6 +125,9 @@ public:
     status_t    setLayerStack(const sp<IBinder>& id, uint32_t layerStack);
     status_t    destroySurface(const sp<IBinder>& id);
 
+    //! Moves a cursor surface right away, outside of any transaction
+    status_t    setCursorPosition(const sp<IBinder>& id, float x, float y);
+
     static void setDisplaySurface(const sp<IBinder>& token,
             const sp<IGraphicBufferProducer>& bufferProducer);
     static void setDisplayLayerStack(const sp<IBinder>& token,
@@ -165,6 +168,11 @@ public:
             const sp<IGraphicBufferProducer>& producer,
             uint32_t reqWidth, uint32_t reqHeight,
             uint32_t minLayerZ, uint32_t maxLayerZ);
+    static status_t capture(
+            const sp<IBinder>& display,
+            const sp<IGraphicBufferProducer>& producer,
+            Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
+            uint32_t minLayerZ, uint32_t maxLayerZ);
 
 private:
     mutable sp<CpuConsumer> mCpuConsumer;
@@ -183,6 +191,10 @@ public:
     status_t update(const sp<IBinder>& display,
             uint32_t reqWidth, uint32_t reqHeight,
             uint32_t minLayerZ, uint32_t maxLayerZ);
+    // captures only the sourceCrop region of the display
+    status_t update(const sp<IBinder>& display, Rect sourceCrop,
+            uint32_t reqWidth, uint32_t reqHeight,
+            uint32_t minLayerZ, uint32_t maxLayerZ);
 
     sp<CpuConsumer> getCpuConsumer() const;
 
@@ -68,6 +68,10 @@ public:
     status_t    setMatrix(float dsdx, float dtdx, float dsdy, float dtdy);
     status_t    setCrop(const Rect& crop);
 
+    // only for surfaces created with ISurfaceComposerClient::eCursorWindow,
+    // takes effect without a transaction
+    status_t    setCursorPosition(float x, float y);
+
     static status_t writeSurfaceToParcel(
             const sp<SurfaceControl>& control, Parcel* parcel);
 
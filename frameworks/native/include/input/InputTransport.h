@@ -37,6 +37,8 @@
 
 namespace android {
 
+class VelocityTracker;
+
 /*
  * Intermediate representation used to send input events and related signals.
  */
@@ -45,6 +47,8 @@ struct InputMessage {
         TYPE_KEY = 1,
         TYPE_MOTION = 2,
         TYPE_FINISHED = 3,
+        TYPE_RING = 4,     // carries the fd of a shared ring, see InputChannel::openSharedRing
+        TYPE_DOORBELL = 5, // wakes up the endpoint reading from a shared ring
     };
 
     struct Header {
@@ -112,6 +116,14 @@ struct InputMessage {
                 return sizeof(Finished);
             }
         } finished;
+
+        struct Ring {
+            uint32_t capacity;
+
+            inline size_t size() const {
+                return sizeof(Ring);
+            }
+        } ring;
     } body;
 
     bool isValid(size_t actualSize) const;
@@ -168,12 +180,45 @@ public:
      */
     status_t receiveMessage(InputMessage* msg);
 
-    /* Returns a new object that has a duplicate of this channel's fd. */
+    /* Returns a new object that has a duplicate of this channel's fd.
+     * The shared ring of the channel, if any, is not duplicated. */
     sp<InputChannel> dup() const;
 
+    /* Sends the following messages of this endpoint through a ring in shared memory
+     * with room for capacity messages, instead of through the socket.
+     *
+     * Messages are then written to the ring without a system call.  The socket only
+     * carries a doorbell message when the other endpoint has found the ring empty and
+     * waits for the fd to become readable.  The ring itself is handed to the other
+     * endpoint through the socket, after the messages already sent.
+     *
+     * The ring carries messages one way only, it is meant for the server endpoint.
+     *
+     * Returns OK on success.
+     * Returns INVALID_OPERATION if the channel already has a ring.
+     */
+    status_t openSharedRing(size_t capacity);
+
 private:
+    struct SharedRing;
+
+    status_t sendSocketMessage(const InputMessage* msg, int fd);
+    status_t receiveSocketMessage(InputMessage* msg, int* outFd);
+    status_t writeToRing(const InputMessage* msg);
+    status_t readFromRing(InputMessage* msg);
+    status_t mapSharedRing(int fd, uint32_t capacity);
+
     String8 mName;
     int mFd;
+
+    // The ring that carries the messages, either those sent by this endpoint or
+    // those received by it.  NULL if the messages go through the socket.
+    SharedRing* mRing;
+    size_t mRingSize;
+    // The number of slots of the ring.  Never read back from the shared memory,
+    // which the other endpoint can write to.
+    uint32_t mRingCapacity;
+    bool mRingWriter;
 };
 
 /*
@@ -330,10 +375,29 @@ public:
      */
     bool hasPendingBatch() const;
 
+    /* Sets the time between the frame time passed to consume() and the time the
+     * frame is expected to be presented, typically taken from the display's vsync
+     * period.  When touch prediction is enabled, the last resampled touch of a batch
+     * predicts where the pointers will be at that time.
+     */
+    void setPresentTimeOffset(nsecs_t offset);
+
 private:
     // True if touch resampling is enabled.
     const bool mResampleTouch;
 
+    // Touch prediction settings, read from system properties.  Prediction is enabled
+    // if a velocity tracker strategy is set.
+    struct TouchPrediction {
+        String8 strategy;
+        nsecs_t presentTimeOffset;
+        // How far past the last touch sample to predict, per tool type.  Tools with
+        // a maximum of 0 are not predicted.
+        nsecs_t maxFingerPrediction;
+        nsecs_t maxStylusPrediction;
+    };
+    TouchPrediction mTouchPrediction;
+
     // The input channel.
     sp<InputChannel> mChannel;
 
@@ -380,6 +444,10 @@ private:
         History history[2];
         History lastResample;
 
+        // Fits the recent touch samples when touch prediction is enabled, owned by the
+        // consumer, which deletes it along with the touch state.
+        VelocityTracker* predictor;
+
         void initialize(int32_t deviceId, int32_t source) {
             this->deviceId = deviceId;
             this->source = source;
@@ -422,6 +490,8 @@ private:
     void rewriteMessage(const TouchState& state, InputMessage* msg);
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event,
             const InputMessage *next);
+    bool predictTouchState(TouchState& touchState, nsecs_t sampleTime, MotionEvent* event);
+    void removeTouchState(size_t index);
 
     ssize_t findBatch(int32_t deviceId, int32_t source) const;
     ssize_t findTouchState(int32_t deviceId, int32_t source) const;
@@ -434,8 +504,10 @@ private:
     static bool canAddSample(const Batch& batch, const InputMessage* msg);
     static ssize_t findSampleNoLaterThan(const Batch& batch, nsecs_t time);
     static bool shouldResampleTool(int32_t toolType);
+    static void addPredictorMovement(VelocityTracker* predictor, const InputMessage* msg);
 
     static bool isTouchResamplingEnabled();
+    static void getTouchPrediction(TouchPrediction* outPrediction);
 };
 
 } // namespace android
@@ -231,6 +231,9 @@ private:
 
     static status_t load(Tokenizer* tokenizer, Format format, sp<KeyCharacterMap>* outMap);
 
+    bool loadCompiled(const int32_t* words, size_t numWords);
+    void compile(Vector<int32_t>* outWords) const;
+
     static void addKey(Vector<KeyEvent>& outEvents,
             int32_t deviceId, int32_t keyCode, int32_t metaState, bool down, nsecs_t time);
     static void addMetaKeys(Vector<KeyEvent>& outEvents,
@@ -25,6 +25,8 @@
 
 namespace android {
 
+class FileMap;
+
 struct AxisInfo {
     enum Mode {
         // Axis value is reported directly.
@@ -59,6 +61,9 @@ struct AxisInfo {
  * Describes a mapping from keyboard scan codes and joystick axes to Android key codes and axes.
  *
  * This object is immutable after it has been loaded.
+ *
+ * The map is compiled into a binary form the first time a file is parsed. When the compiled
+ * form is up to date, it is memory-mapped and used directly instead of parsing the file.
  */
 class KeyLayoutMap : public RefBase {
 public:
@@ -79,14 +84,42 @@ private:
         uint32_t flags;
     };
 
+    // Layout of the entries of a compiled map, which are sorted by code.
+    struct CompiledKey {
+        int32_t code;
+        Key key;
+    };
+
+    struct CompiledAxis {
+        int32_t code;
+        int32_t mode;
+        int32_t axis;
+        int32_t highAxis;
+        int32_t splitValue;
+        int32_t flatOverride;
+    };
+
     KeyedVector<int32_t, Key> mKeysByScanCode;
     KeyedVector<int32_t, Key> mKeysByUsageCode;
     KeyedVector<int32_t, AxisInfo> mAxes;
 
+    // The compiled map the entries are looked up in instead of the vectors above,
+    // or NULL if the map was parsed.
+    FileMap* mCompiledMap;
+    const CompiledKey* mCompiledKeysByScanCode;
+    size_t mNumCompiledKeysByScanCode;
+    const CompiledKey* mCompiledKeysByUsageCode;
+    size_t mNumCompiledKeysByUsageCode;
+    const CompiledAxis* mCompiledAxes;
+    size_t mNumCompiledAxes;
+
     KeyLayoutMap();
 
     const Key* getKey(int32_t scanCode, int32_t usageCode) const;
 
+    bool setCompiledMap(FileMap* compiledMap, const int32_t* words, size_t numWords);
+    void compile(Vector<int32_t>* outWords) const;
+
     class Parser {
         KeyLayoutMap* mMap;
         Tokenizer* mTokenizer;
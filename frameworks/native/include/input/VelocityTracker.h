@@ -93,6 +93,7 @@ public:
     // Gets an estimator for the recent movements of the specified pointer id.
     // Returns false and clears the estimator if there is no information available
     // about the pointer.
+    // The estimator is only computed once until the next movement is added.
     bool getEstimator(uint32_t id, Estimator* outEstimator) const;
 
     // Gets the active pointer id, or -1 if none.
@@ -109,6 +110,10 @@ private:
     int32_t mActivePointerId;
     VelocityTrackerStrategy* mStrategy;
 
+    // The estimators computed since the last change of the movements, by pointer id.
+    mutable BitSet32 mEstimatorIdBits;
+    mutable Estimator mEstimators[MAX_POINTER_ID + 1];
+
     bool configureStrategy(const char* strategy);
 
     static VelocityTrackerStrategy* createStrategy(const char* strategy);
@@ -183,11 +188,22 @@ private:
     };
 
     float chooseWeight(uint32_t index) const;
+    bool factor(const float* time, const float* w, uint32_t m, uint32_t n) const;
 
     const uint32_t mDegree;
     const Weighting mWeighting;
     uint32_t mIndex;
     Movement mMovements[HISTORY_SIZE];
+
+    // The QR decomposition of the sample times of the last m movements.  It only
+    // depends on the times and weights of the movements, so the pointers that
+    // were down for the same movements share it, and it is reused until the next
+    // movement is added.  mFactorSamples is 0 if there is none.
+    mutable uint32_t mFactorSamples;
+    mutable bool mFactorSolvable;
+    mutable float mFactorQ[(VelocityTracker::Estimator::MAX_DEGREE + 1) * HISTORY_SIZE];
+    mutable float mFactorR[(VelocityTracker::Estimator::MAX_DEGREE + 1)
+            * (VelocityTracker::Estimator::MAX_DEGREE + 1)];
 };
 
 
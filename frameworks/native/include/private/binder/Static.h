@@ -25,6 +25,8 @@
 #include <binder/IPermissionController.h>
 #include <binder/IServiceManager.h>
 
+#include <private/binder/TransactionStats.h>
+
 namespace android {
 
 // For TextStream.cpp
@@ -34,6 +36,10 @@ extern Vector<int32_t> gTextBuffers;
 extern Mutex gProcessMutex;
 extern sp<ProcessState> gProcess;
 
+// For TransactionStats.cpp
+extern Mutex gTransactionStatsLock;
+extern TransactionStats* gTransactionStats;
+
 // For ServiceManager.cpp
 extern Mutex gDefaultServiceManagerLock;
 extern sp<IServiceManager> gDefaultServiceManager;
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BINDER_TRANSACTION_STATS_H
+#define ANDROID_BINDER_TRANSACTION_STATS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/String16.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class String8;
+
+// ---------------------------------------------------------------------------
+
+// TransactionStats holds the latency and size histograms of the binder
+// transactions sent and received by one thread.  Only the thread owning a
+// TransactionStats records into it, so recording takes no lock.  dump() reads
+// the counters of all the threads while they are being updated, so the
+// numbers it prints may be off by the transactions in flight.
+//
+// The TransactionStats of a thread that exits are kept, and reused by the
+// next thread that needs one, so that the statistics cover the whole life of
+// the process.
+class TransactionStats
+{
+public:
+    // NUM_TIME_BUCKETS is the number of buckets of the latency histograms,
+    // bucket i counts the transactions shorter than 16us << i.  The last
+    // bucket counts all the longer ones.
+    enum { NUM_TIME_BUCKETS = 16 };
+
+    // NUM_SIZE_BUCKETS is the number of buckets of the size histograms,
+    // bucket i counts the parcels smaller than 64 bytes << i.
+    enum { NUM_SIZE_BUCKETS = 12 };
+
+    // NUM_ENTRIES is the number of different (target, code) pairs a thread
+    // keeps statistics for.  The transactions that don't fit are only
+    // counted as dropped.
+    enum { NUM_ENTRIES = 64 };
+
+    // get returns the TransactionStats of a new thread.
+    static  TransactionStats*   get();
+
+    // put hands back the TransactionStats of an exiting thread.
+    static  void                put(TransactionStats* stats);
+
+    // dump appends the statistics of all the threads to result.
+    static  void                dump(String8& result);
+
+    // recordOutgoing records a transaction sent to the remote binder handle.
+    // duration is the whole time spent in IPCThreadState::transact, of which
+    // waitTime was spent blocked in the driver.
+            void                recordOutgoing(int32_t handle, uint32_t code,
+                                        uint32_t flags, nsecs_t duration,
+                                        nsecs_t waitTime, size_t dataSize,
+                                        size_t replySize);
+
+    // recordIncoming records a transaction executed by the local binder.
+    // descriptor is only used the first time binder and code are seen.
+            void                recordIncoming(const void* binder,
+                                        const String16& descriptor,
+                                        uint32_t code, uint32_t flags,
+                                        nsecs_t duration, size_t dataSize,
+                                        size_t replySize);
+
+private:
+                                TransactionStats();
+
+    struct Entry {
+        // used is set once the key of the entry is written, other threads
+        // must not read the entry before they see it set.
+        volatile int32_t    used;
+        bool                incoming;
+        uintptr_t           target;
+        uint32_t            code;
+        String16            descriptor;
+        uint32_t            count;
+        uint32_t            oneway;
+        nsecs_t             totalTime;
+        nsecs_t             maxTime;
+        nsecs_t             waitTime;
+        uint64_t            dataBytes;
+        uint64_t            replyBytes;
+        uint32_t            timeHistogram[NUM_TIME_BUCKETS];
+        uint32_t            sizeHistogram[NUM_SIZE_BUCKETS];
+    };
+
+            Entry*              findEntry(bool incoming, uintptr_t target,
+                                        uint32_t code, const String16* descriptor);
+            void                record(Entry* e, uint32_t flags,
+                                        nsecs_t duration, nsecs_t waitTime,
+                                        size_t dataSize, size_t replySize);
+
+    Entry               mEntries[NUM_ENTRIES];
+    uint32_t            mDropped;
+    TransactionStats*   mNext;
+    bool                mInUse;
+};
+
+// ---------------------------------------------------------------------------
+
+}; // namespace android
+
+#endif // ANDROID_BINDER_TRANSACTION_STATS_H
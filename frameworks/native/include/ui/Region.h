@@ -164,6 +164,12 @@ private:
     static void boolean_operation(int op, Region& dst,
             const Region& lhs, const Rect& rhs);
 
+    // handles the operations that don't need to be rasterized, rhs is the
+    // (translated) bounds of the right operand. returns false if the
+    // operation must go through the rasterizer.
+    static bool quick_boolean_operation(int op, Region& dst,
+            const Region& lhs, const Rect& rhs, bool rhsIsRect);
+
     static void translate(Region& reg, int dx, int dy);
     static void translate(Region& dst, const Region& reg, int dx, int dy);
 
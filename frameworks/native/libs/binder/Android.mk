@@ -29,11 +29,13 @@ sources := \
     MemoryDealer.cpp \
     MemoryBase.cpp \
     MemoryHeapBase.cpp \
+    OnewayBatcher.cpp \
     Parcel.cpp \
     PermissionCache.cpp \
     ProcessState.cpp \
     Static.cpp \
     TextOutput.cpp \
+    TransactionStats.cpp \
 
 LOCAL_PATH:= $(call my-dir)
 
@@ -16,9 +16,11 @@
 
 #include <binder/AppOpsManager.h>
 #include <binder/Binder.h>
+#include <binder/IAppOpsCallback.h>
 #include <binder/IServiceManager.h>
 
 #include <utils/SystemClock.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -35,10 +37,143 @@ static const sp<IBinder>& getToken(const sp<IAppOpsService>& service) {
     return gToken;
 }
 
+// ModeCache caches the modes returned by checkOperation.  It watches the
+// mode changes of every (op, package) it caches, and drops the modes that
+// changed when it's notified.
+class AppOpsManager::ModeCache : public BnAppOpsCallback
+{
+public:
+    enum { MAX_ENTRIES = 32 };
+    enum { MAX_WATCHED = 32 };
+
+    ModeCache(const sp<IAppOpsService>& service)
+        : mService(service), mNext(0), mGeneration(0) {
+    }
+
+    const sp<IAppOpsService>& service() const {
+        return mService;
+    }
+
+    bool lookup(int32_t op, int32_t uid, const String16& packageName,
+            int32_t* mode) const {
+        Mutex::Autolock _l(mLock);
+        for (size_t i = 0; i < mEntries.size(); i++) {
+            const Entry& e(mEntries[i]);
+            if (e.op == op && e.uid == uid && e.packageName == packageName) {
+                *mode = e.mode;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // makes sure the changes of op and packageName are watched before
+    // their mode is cached.  Returns false if too many are watched already,
+    // in which case the mode must not be cached.  *generation is set to the
+    // generation to pass to add().
+    bool watch(int32_t op, const String16& packageName, uint32_t* generation) {
+        // a pair is only reported as watched once the service knows
+        Mutex::Autolock _wl(mWatchLock);
+        {
+            Mutex::Autolock _l(mLock);
+            *generation = mGeneration;
+            for (size_t i = 0; i < mWatched.size(); i++) {
+                const Watched& w(mWatched[i]);
+                if (w.op == op && w.packageName == packageName) {
+                    return true;
+                }
+            }
+            if (mWatched.size() >= MAX_WATCHED) {
+                return false;
+            }
+            Watched w;
+            w.op = op;
+            w.packageName = packageName;
+            mWatched.add(w);
+        }
+        mService->startWatchingMode(op, packageName, this);
+        return true;
+    }
+
+    // caches mode unless a mode changed since generation was returned by
+    // watch().
+    void add(int32_t op, int32_t uid, const String16& packageName,
+            int32_t mode, uint32_t generation) {
+        Mutex::Autolock _l(mLock);
+        if (generation != mGeneration) {
+            return;
+        }
+        Entry e;
+        e.op = op;
+        e.uid = uid;
+        e.packageName = packageName;
+        e.mode = mode;
+        if (mEntries.size() < MAX_ENTRIES) {
+            mEntries.add(e);
+        } else {
+            mEntries.editItemAt(mNext) = e;
+            mNext = (mNext + 1) % MAX_ENTRIES;
+        }
+    }
+
+    virtual void opChanged(int32_t op, const String16& packageName) {
+        Mutex::Autolock _l(mLock);
+        mGeneration++;
+        for (size_t i = 0; i < mEntries.size(); ) {
+            const Entry& e(mEntries[i]);
+            if (e.op == op && e.packageName == packageName) {
+                mEntries.removeAt(i);
+            } else {
+                i++;
+            }
+        }
+        mNext = 0;
+    }
+
+private:
+    struct Entry {
+        int32_t op;
+        int32_t uid;
+        String16 packageName;
+        int32_t mode;
+    };
+
+    struct Watched {
+        int32_t op;
+        String16 packageName;
+    };
+
+    const sp<IAppOpsService> mService;
+    Mutex mWatchLock;
+    mutable Mutex mLock;
+    Vector<Entry> mEntries;
+    size_t mNext;
+    Vector<Watched> mWatched;
+    uint32_t mGeneration;
+};
+
 AppOpsManager::AppOpsManager()
 {
 }
 
+AppOpsManager::~AppOpsManager()
+{
+    if (mModeCache != NULL) {
+        mModeCache->service()->stopWatchingMode(mModeCache);
+    }
+}
+
+sp<AppOpsManager::ModeCache> AppOpsManager::getModeCache(
+        const sp<IAppOpsService>& service)
+{
+    Mutex::Autolock _l(mCacheLock);
+    if (mModeCache == NULL || mModeCache->service() != service) {
+        // the modes of a dead service may have changed since
+        mModeCache = new ModeCache(service);
+    }
+    return mModeCache;
+}
+
 sp<IAppOpsService> AppOpsManager::getService()
 {
     int64_t startTime = 0;
@@ -68,7 +203,22 @@ sp<IAppOpsService> AppOpsManager::getService()
 int32_t AppOpsManager::checkOp(int32_t op, int32_t uid, const String16& callingPackage)
 {
     sp<IAppOpsService> service = getService();
-    return service != NULL ? service->checkOperation(op, uid, callingPackage) : MODE_IGNORED;
+    if (service == NULL) {
+        return MODE_IGNORED;
+    }
+
+    sp<ModeCache> cache = getModeCache(service);
+    int32_t mode;
+    if (cache->lookup(op, uid, callingPackage, &mode)) {
+        return mode;
+    }
+    uint32_t generation;
+    const bool cacheable = cache->watch(op, callingPackage, &generation);
+    mode = service->checkOperation(op, uid, callingPackage);
+    if (cacheable) {
+        cache->add(op, uid, callingPackage, mode, generation);
+    }
+    return mode;
 }
 
 int32_t AppOpsManager::noteOp(int32_t op, int32_t uid, const String16& callingPackage) {
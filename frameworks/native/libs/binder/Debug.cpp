@@ -15,8 +15,10 @@
  */
 
 #include <binder/Debug.h>
+#include <binder/IPCThreadState.h>
 
 #include <utils/misc.h>
+#include <utils/String8.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -300,5 +302,12 @@ void printHexData(int32_t indent, const void *buf, size_t length,
     }
 }
 
+void printTransactionStats(debugPrintFunc func, void* cookie)
+{
+    String8 result;
+    IPCThreadState::dumpTransactionStats(result);
+    func ? (*func)(cookie, result.string()) : defaultPrintFunc(cookie, result.string());
+}
+
 }; // namespace android
 
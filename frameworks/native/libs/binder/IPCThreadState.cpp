@@ -22,6 +22,7 @@
 #include <binder/BpBinder.h>
 #include <binder/TextOutput.h>
 
+#include <cutils/properties.h>
 #include <cutils/sched_policy.h>
 #include <utils/Debug.h>
 #include <utils/Log.h>
@@ -29,11 +30,13 @@
 
 #include <private/binder/binder_module.h>
 #include <private/binder/Static.h>
+#include <private/binder/TransactionStats.h>
 
 #include <sys/ioctl.h>
 #include <signal.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #ifdef HAVE_PTHREADS
@@ -295,6 +298,7 @@ static bool gHaveTLS = false;
 static pthread_key_t gTLS = 0;
 static bool gShutdown = false;
 static bool gDisableBackgroundScheduling = false;
+static bool gEnableTransactionStats = false;
 
 IPCThreadState* IPCThreadState::self()
 {
@@ -314,6 +318,11 @@ restart:
             pthread_mutex_unlock(&gTLSMutex);
             return NULL;
         }
+        char value[PROPERTY_VALUE_MAX];
+        property_get("debug.binder.stats", value, "0");
+        if (atoi(value)) {
+            gEnableTransactionStats = true;
+        }
         gHaveTLS = true;
     }
     pthread_mutex_unlock(&gTLSMutex);
@@ -350,6 +359,16 @@ void IPCThreadState::disableBackgroundScheduling(bool disable)
     gDisableBackgroundScheduling = disable;
 }
 
+void IPCThreadState::enableTransactionStats(bool enable)
+{
+    gEnableTransactionStats = enable;
+}
+
+void IPCThreadState::dumpTransactionStats(String8& result)
+{
+    TransactionStats::dump(result);
+}
+
 sp<ProcessState> IPCThreadState::process()
 {
     return mProcess;
@@ -423,7 +442,13 @@ status_t IPCThreadState::getAndExecuteCommand()
     status_t result;
     int32_t cmd;
 
+    // talkWithDriver only waits for commands once mIn is consumed
+    const bool waiting = mIn.dataPosition() >= mIn.dataSize();
+    const nsecs_t waitStart = waiting ? systemTime() : 0;
     result = talkWithDriver();
+    if (waiting) {
+        mIdleTime = systemTime() - waitStart;
+    }
     if (result >= NO_ERROR) {
         size_t IN = mIn.dataAvail();
         if (IN < sizeof(int32_t)) return result;
@@ -433,7 +458,14 @@ status_t IPCThreadState::getAndExecuteCommand()
                  << getReturnString(cmd) << endl;
         }
 
+        const bool pooledTransaction = mInThreadPool && cmd == BR_TRANSACTION;
+        if (pooledTransaction) {
+            mProcess->beginPooledTransaction(mMyThreadId);
+        }
         result = executeCommand(cmd);
+        if (pooledTransaction) {
+            mProcess->endPooledTransaction();
+        }
 
         // After executing the command, ensure that the thread is returned to the
         // foreground cgroup before rejoining the pool.  The driver takes care of
@@ -476,7 +508,11 @@ void IPCThreadState::joinThreadPool(bool isMain)
 {
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS JOINING THE THREAD POOL\n", (void*)pthread_self(), getpid());
 
-    mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
+    // reserved threads aren't requested by the driver, they enter the
+    // looper like the main thread does
+    mOut.writeInt32((isMain || mReservedThread) ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
+    mInThreadPool = true;
+    mProcess->threadPoolThreadJoined();
     
     // This thread may have been spawned by a thread that was in the background
     // scheduling group, so first we will make sure it is in the foreground
@@ -484,6 +520,7 @@ void IPCThreadState::joinThreadPool(bool isMain)
     set_sched_policy(mMyThreadId, SP_FOREGROUND);
         
     status_t result;
+    bool retired = false;
     do {
         processPendingDerefs();
         // now get the next command to be processed, waiting if necessary
@@ -500,6 +537,15 @@ void IPCThreadState::joinThreadPool(bool isMain)
         if(result == TIMED_OUT && !isMain) {
             break;
         }
+
+        // Let this thread exit if it waited too long for this command,
+        // the pool has more threads than the process needs.
+        if (!isMain && mIn.dataPosition() >= mIn.dataSize() &&
+                mProcess->shouldRetireThread(mIdleTime)) {
+            processPendingDerefs();
+            retired = true;
+            break;
+        }
     } while (result != -ECONNREFUSED && result != -EBADF);
 
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%p\n",
@@ -507,6 +553,9 @@ void IPCThreadState::joinThreadPool(bool isMain)
     
     mOut.writeInt32(BC_EXIT_LOOPER);
     talkWithDriver(false);
+
+    mInThreadPool = false;
+    mProcess->threadPoolThreadExited(isMain, mReservedThread, retired);
 }
 
 int IPCThreadState::setupPolling(int* fd)
@@ -568,6 +617,18 @@ status_t IPCThreadState::transact(int32_t handle,
         if (reply) reply->setError(err);
         return (mLastError = err);
     }
+
+    // this transaction may be sent while waiting for the reply of another
+    // one, whose wait time must not include the time spent here
+    const bool recordStats = gEnableTransactionStats;
+    const bool prevTimingWait = mTimingWait;
+    const nsecs_t prevWaitTime = mWaitTime;
+    nsecs_t startTime = 0;
+    if (recordStats) {
+        startTime = systemTime();
+        mTimingWait = true;
+        mWaitTime = 0;
+    }
     
     if ((flags & TF_ONE_WAY) == 0) {
         #if 0
@@ -601,10 +662,70 @@ status_t IPCThreadState::transact(int32_t handle,
     } else {
         err = waitForResponse(NULL, NULL);
     }
+
+    if (recordStats) {
+        if (mStats == NULL) mStats = TransactionStats::get();
+        mStats->recordOutgoing(handle, code, flags, systemTime() - startTime,
+                mWaitTime, data.dataSize(), reply ? reply->dataSize() : 0);
+        mTimingWait = prevTimingWait;
+        mWaitTime = prevWaitTime;
+    }
     
     return err;
 }
 
+status_t IPCThreadState::transactOneway(const OnewayTransaction* transactions,
+                                        size_t count)
+{
+    const uint32_t flags = TF_ONE_WAY | TF_ACCEPT_FDS;
+    const bool recordStats = gEnableTransactionStats;
+    const nsecs_t startTime = recordStats ? systemTime() : 0;
+    status_t result = NO_ERROR;
+
+    // the transactions are only written to mOut here, they all go to the
+    // driver with the first talkWithDriver below
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        const OnewayTransaction& t(transactions[i]);
+        status_t err = t.data->errorCheck();
+        if (err == NO_ERROR) {
+            LOG_ONEWAY(">>>> SEND BATCHED from pid %d uid %d ONE WAY",
+                getpid(), getuid());
+            err = writeTransactionData(BC_TRANSACTION, flags, t.handle,
+                    t.code, *t.data, NULL);
+        }
+        if (err == NO_ERROR) {
+            written++;
+        } else if (result == NO_ERROR) {
+            result = err;
+        }
+    }
+
+    // the driver stops at the first transaction it fails, the following
+    // ones stay in mOut and are written by the next wait
+    for (size_t i = 0; i < written; i++) {
+        status_t err = waitForResponse(NULL, NULL);
+        if (err != NO_ERROR && result == NO_ERROR) {
+            result = err;
+        }
+    }
+
+    if (recordStats && written > 0) {
+        if (mStats == NULL) mStats = TransactionStats::get();
+        const nsecs_t duration = (systemTime() - startTime) / written;
+        for (size_t i = 0; i < count; i++) {
+            const OnewayTransaction& t(transactions[i]);
+            mStats->recordOutgoing(t.handle, t.code, flags, duration, 0,
+                    t.data->dataSize(), 0);
+        }
+    }
+
+    if (result != NO_ERROR) {
+        mLastError = result;
+    }
+    return result;
+}
+
 void IPCThreadState::incStrongHandle(int32_t handle)
 {
     LOG_REMOTEREFS("IPCThreadState::incStrongHandle(%d)\n", handle);
@@ -679,7 +800,13 @@ IPCThreadState::IPCThreadState()
     : mProcess(ProcessState::self()),
       mMyThreadId(androidGetTid()),
       mStrictModePolicy(0),
-      mLastTransactionBinderFlags(0)
+      mLastTransactionBinderFlags(0),
+      mStats(NULL),
+      mTimingWait(false),
+      mWaitTime(0),
+      mInThreadPool(false),
+      mReservedThread(false),
+      mIdleTime(0)
 {
     pthread_setspecific(gTLS, this);
     clearCaller();
@@ -689,6 +816,9 @@ IPCThreadState::IPCThreadState()
 
 IPCThreadState::~IPCThreadState()
 {
+    if (mStats != NULL) {
+        TransactionStats::put(mStats);
+    }
 }
 
 status_t IPCThreadState::sendReply(const Parcel& reply, uint32_t flags)
@@ -707,7 +837,14 @@ status_t IPCThreadState::waitForResponse(Parcel *reply, status_t *acquireResult)
     int32_t err;
 
     while (1) {
-        if ((err=talkWithDriver()) < NO_ERROR) break;
+        if (mTimingWait) {
+            const nsecs_t waitStart = systemTime();
+            err = talkWithDriver();
+            mWaitTime += systemTime() - waitStart;
+        } else {
+            err = talkWithDriver();
+        }
+        if (err < NO_ERROR) break;
         err = mIn.errorCheck();
         if (err < NO_ERROR) break;
         if (mIn.dataAvail() == 0) continue;
@@ -1056,6 +1193,13 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             }
 
             //ALOGI(">>>> TRANSACT from pid %d uid %d\n", mCallingPid, mCallingUid);
+
+            // the time spent executing and replying to this transaction
+            // isn't time the enclosing outgoing transaction, if any, waited
+            const bool prevTimingWait = mTimingWait;
+            mTimingWait = false;
+            const bool recordStats = gEnableTransactionStats;
+            const nsecs_t startTime = recordStats ? systemTime() : 0;
             
             Parcel reply;
             IF_LOG_TRANSACTIONS() {
@@ -1073,10 +1217,23 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
                 sp<BBinder> b((BBinder*)tr.cookie);
                 const status_t error = b->transact(tr.code, buffer, &reply, tr.flags);
                 if (error < NO_ERROR) reply.setError(error);
+                if (recordStats) {
+                    if (mStats == NULL) mStats = TransactionStats::get();
+                    mStats->recordIncoming(b.get(), b->getInterfaceDescriptor(),
+                            tr.code, tr.flags, systemTime() - startTime,
+                            tr.data_size, reply.dataSize());
+                }
 
             } else {
                 const status_t error = the_context_object->transact(tr.code, buffer, &reply, tr.flags);
                 if (error < NO_ERROR) reply.setError(error);
+                if (recordStats) {
+                    if (mStats == NULL) mStats = TransactionStats::get();
+                    mStats->recordIncoming(the_context_object.get(),
+                            the_context_object->getInterfaceDescriptor(),
+                            tr.code, tr.flags, systemTime() - startTime,
+                            tr.data_size, reply.dataSize());
+                }
             }
             
             //ALOGI("<<<< TRANSACT from pid %d restore pid %d uid %d\n",
@@ -1088,6 +1245,7 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             } else {
                 LOG_ONEWAY("NOT sending reply to %d!", mCallingPid);
             }
+            mTimingWait = prevTimingWait;
             
             mCallingPid = origPid;
             mCallingUid = origUid;
@@ -20,6 +20,7 @@
 #include <binder/IPCThreadState.h>
 #include <binder/MemoryBase.h>
 
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
 #include <utils/SortedVector.h>
 #include <utils/String8.h>
@@ -122,10 +123,11 @@ private:
 
 class SimpleBestFitAllocator
 {
+public:
     enum {
         PAGE_ALIGNED = 0x00000001
     };
-public:
+
     SimpleBestFitAllocator(size_t size);
     ~SimpleBestFitAllocator();
 
@@ -157,6 +159,62 @@ private:
     mutable Mutex       mLock;
     LinkedList<chunk_t> mList;
     size_t              mHeapSize;
+    size_t              mAllocated;
+    size_t              mHighWatermark;
+};
+
+// ----------------------------------------------------------------------------
+
+/*
+ * SlabAllocator serves the small allocations from slabs, page aligned blocks
+ * of the SimpleBestFitAllocator split in objects of a single size class.
+ * Blocks of the same class are interchangeable, so freeing them never
+ * leaves holes that only smaller allocations could use.
+ */
+
+class SlabAllocator
+{
+public:
+    SlabAllocator(SimpleBestFitAllocator* allocator);
+    ~SlabAllocator();
+
+    // returns NO_MEMORY if size isn't served by slabs or there is no room
+    // for a new slab
+    ssize_t     allocate(size_t size);
+    // returns NAME_NOT_FOUND if offset isn't in a slab
+    status_t    deallocate(size_t offset);
+    void        dump(String8& res) const;
+
+private:
+    struct slab_t {
+        size_t      start;
+        size_t      size;
+        size_t      objectSize;
+        uint32_t    count;
+        uint32_t    used;
+        // bit i is set if object i is free
+        uint64_t    freeMask;
+    };
+
+    struct size_class_t {
+        Vector<slab_t*> slabs;
+        size_t          used;
+        size_t          highWatermark;
+    };
+
+    static ssize_t  sizeClassFor(size_t size);
+    void            freeSlab_l(size_t sizeClass, size_t index);
+
+    static const size_t kSizeClasses[];
+    static const size_t kNumSizeClasses;
+
+    mutable Mutex           mLock;
+    SimpleBestFitAllocator* mAllocator;
+    size_t                  mPageSize;
+    size_class_t*           mClasses;
+    // maps the index of every page of the heap that belongs to a slab to
+    // the slab
+    KeyedVector<size_t, slab_t*> mPages;
 };
 
 // ----------------------------------------------------------------------------
@@ -225,21 +283,32 @@ Allocation::~Allocation()
 
 // ----------------------------------------------------------------------------
 
-MemoryDealer::MemoryDealer(size_t size, const char* name)
+MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags)
     : mHeap(new MemoryHeapBase(size, 0, name)),
-    mAllocator(new SimpleBestFitAllocator(size))
+    mAllocator(new SimpleBestFitAllocator(size)),
+    mSlabAllocator(NULL)
 {    
+    if (flags & SLAB_ALLOCATIONS) {
+        mSlabAllocator = new SlabAllocator(mAllocator);
+    }
 }
 
 MemoryDealer::~MemoryDealer()
 {
+    delete mSlabAllocator;
     delete mAllocator;
 }
 
 sp<IMemory> MemoryDealer::allocate(size_t size)
 {
     sp<IMemory> memory;
-    const ssize_t offset = allocator()->allocate(size);
+    ssize_t offset = NO_MEMORY;
+    if (mSlabAllocator) {
+        offset = mSlabAllocator->allocate(size);
+    }
+    if (offset < 0) {
+        offset = allocator()->allocate(size);
+    }
     if (offset >= 0) {
         memory = new Allocation(this, heap(), offset, size);
     }
@@ -248,12 +317,20 @@ sp<IMemory> MemoryDealer::allocate(size_t size)
 
 void MemoryDealer::deallocate(size_t offset)
 {
+    if (mSlabAllocator && mSlabAllocator->deallocate(offset) == NO_ERROR) {
+        return;
+    }
     allocator()->deallocate(offset);
 }
 
 void MemoryDealer::dump(const char* what) const
 {
-    allocator()->dump(what);
+    String8 result;
+    allocator()->dump(result, what);
+    if (mSlabAllocator) {
+        mSlabAllocator->dump(result);
+    }
+    ALOGD("%s", result.string());
 }
 
 const sp<IMemoryHeap>& MemoryDealer::heap() const {
@@ -276,6 +353,8 @@ SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size)
 
     chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
     mList.insertHead(node);
+    mAllocated = 0;
+    mHighWatermark = 0;
 }
 
 SimpleBestFitAllocator::~SimpleBestFitAllocator()
@@ -359,6 +438,10 @@ ssize_t SimpleBestFitAllocator::alloc(size_t size, uint32_t flags)
                 mList.insertAfter(free_chunk, split);
             }
         }
+        mAllocated += size*kMemoryAlign;
+        if (mAllocated > mHighWatermark) {
+            mHighWatermark = mAllocated;
+        }
         return (free_chunk->start)*kMemoryAlign;
     }
     return NO_MEMORY;
@@ -377,6 +460,7 @@ SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc(size_t start)
             // merge freed blocks together
             chunk_t* freed = cur;
             cur->free = 1;
+            mAllocated -= cur->size*kMemoryAlign;
             do {
                 chunk_t* const p = cur->prev;
                 chunk_t* const n = cur->next;
@@ -429,6 +513,8 @@ void SimpleBestFitAllocator::dump_l(String8& result,
         const char* what) const
 {
     size_t size = 0;
+    size_t freeSize = 0;
+    size_t largestFree = 0;
     int32_t i = 0;
     chunk_t const* cur = mList.head();
     
@@ -453,8 +539,13 @@ void SimpleBestFitAllocator::dump_l(String8& result,
         
         result.append(buffer);
 
-        if (!cur->free)
+        if (!cur->free) {
             size += cur->size*kMemoryAlign;
+        } else {
+            freeSize += cur->size*kMemoryAlign;
+            if (cur->size*kMemoryAlign > largestFree)
+                largestFree = cur->size*kMemoryAlign;
+        }
 
         i++;
         cur = cur->next;
@@ -462,6 +553,192 @@ void SimpleBestFitAllocator::dump_l(String8& result,
     snprintf(buffer, SIZE,
             "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
     result.append(buffer);
+
+    // fragmentation is the part of the free space that can't be allocated
+    // in one block
+    snprintf(buffer, SIZE,
+            "  high watermark: %u (%u KB), largest free block: %u KB, "
+            "fragmentation: %u%%\n",
+            int(mHighWatermark), int(mHighWatermark/1024), int(largestFree/1024),
+            freeSize ? int(100 - (largestFree*100)/freeSize) : 0);
+    result.append(buffer);
+}
+
+// ----------------------------------------------------------------------------
+
+// multiples of kMemoryAlign, growing by half of the previous power of 2 so
+// that at most a third of an object is wasted
+const size_t SlabAllocator::kSizeClasses[] = {
+    32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+const size_t SlabAllocator::kNumSizeClasses =
+        sizeof(kSizeClasses) / sizeof(kSizeClasses[0]);
+
+// slabs are at most this big, unless a single page is, and hold at most 64
+// objects
+static const size_t kMaxSlabSize = 16384;
+static const size_t kMaxSlabObjects = 64;
+
+SlabAllocator::SlabAllocator(SimpleBestFitAllocator* allocator)
+    : mAllocator(allocator),
+      mPageSize(getpagesize()),
+      mClasses(new size_class_t[kNumSizeClasses])
+{
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+        mClasses[i].used = 0;
+        mClasses[i].highWatermark = 0;
+    }
+}
+
+SlabAllocator::~SlabAllocator()
+{
+    // the memory of the slabs goes away with the heap
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+        const Vector<slab_t*>& slabs(mClasses[i].slabs);
+        for (size_t j = 0; j < slabs.size(); j++) {
+            delete slabs[j];
+        }
+    }
+    delete [] mClasses;
+}
+
+ssize_t SlabAllocator::sizeClassFor(size_t size)
+{
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+        if (size <= kSizeClasses[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ssize_t SlabAllocator::allocate(size_t size)
+{
+    const ssize_t sizeClass = size ? sizeClassFor(size) : -1;
+    if (sizeClass < 0) {
+        return NO_MEMORY;
+    }
+
+    Mutex::Autolock _l(mLock);
+    size_class_t& c(mClasses[sizeClass]);
+    slab_t* slab = NULL;
+    for (size_t i = 0; i < c.slabs.size(); i++) {
+        if (c.slabs[i]->freeMask) {
+            slab = c.slabs[i];
+            break;
+        }
+    }
+
+    if (slab == NULL) {
+        const size_t objectSize = kSizeClasses[sizeClass];
+        size_t slabSize = objectSize * kMaxSlabObjects;
+        if (slabSize > kMaxSlabSize) {
+            slabSize = kMaxSlabSize;
+        }
+        slabSize = (slabSize + mPageSize-1) & ~(mPageSize-1);
+        size_t count = slabSize / objectSize;
+        if (count > kMaxSlabObjects) {
+            count = kMaxSlabObjects;
+        }
+
+        const ssize_t start = mAllocator->allocate(slabSize,
+                SimpleBestFitAllocator::PAGE_ALIGNED);
+        if (start < 0) {
+            return NO_MEMORY;
+        }
+        slab = new slab_t;
+        slab->start = start;
+        slab->size = slabSize;
+        slab->objectSize = objectSize;
+        slab->count = count;
+        slab->used = 0;
+        slab->freeMask = (count == 64) ? ~0ULL : ((1ULL << count) - 1);
+        c.slabs.add(slab);
+        for (size_t page = start / mPageSize;
+                page < (start + slabSize) / mPageSize; page++) {
+            mPages.add(page, slab);
+        }
+    }
+
+    const uint32_t index = __builtin_ctzll(slab->freeMask);
+    slab->freeMask &= ~(1ULL << index);
+    slab->used++;
+    c.used++;
+    if (c.used > c.highWatermark) {
+        c.highWatermark = c.used;
+    }
+    return slab->start + index * slab->objectSize;
+}
+
+status_t SlabAllocator::deallocate(size_t offset)
+{
+    Mutex::Autolock _l(mLock);
+    const ssize_t pageIndex = mPages.indexOfKey(offset / mPageSize);
+    if (pageIndex < 0) {
+        return NAME_NOT_FOUND;
+    }
+    slab_t* slab = mPages.valueAt(pageIndex);
+    const size_t index = (offset - slab->start) / slab->objectSize;
+    LOG_FATAL_IF(index >= slab->count ||
+            (offset - slab->start) % slab->objectSize ||
+            (slab->freeMask & (1ULL << index)),
+            "bad slab block at offset 0x%08X", int(offset));
+    slab->freeMask |= 1ULL << index;
+    slab->used--;
+
+    const ssize_t sizeClass = sizeClassFor(slab->objectSize);
+    size_class_t& c(mClasses[sizeClass]);
+    c.used--;
+    if (slab->used == 0) {
+        // keep one slab per class around, allocations often come back
+        for (size_t i = 0; i < c.slabs.size(); i++) {
+            if (c.slabs[i] != slab && c.slabs[i]->freeMask) {
+                for (size_t j = 0; j < c.slabs.size(); j++) {
+                    if (c.slabs[j] == slab) {
+                        freeSlab_l(sizeClass, j);
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+    }
+    return NO_ERROR;
+}
+
+void SlabAllocator::freeSlab_l(size_t sizeClass, size_t index)
+{
+    Vector<slab_t*>& slabs(mClasses[sizeClass].slabs);
+    slab_t* slab = slabs[index];
+    for (size_t page = slab->start / mPageSize;
+            page < (slab->start + slab->size) / mPageSize; page++) {
+        mPages.removeItem(page);
+    }
+    slabs.removeAt(index);
+    mAllocator->deallocate(slab->start);
+    delete slab;
+}
+
+void SlabAllocator::dump(String8& result) const
+{
+    Mutex::Autolock _l(mLock);
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    result.append("  slabs: class | slabs | used | capacity | high watermark\n");
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+        const size_class_t& c(mClasses[i]);
+        if (c.slabs.isEmpty() && !c.highWatermark) {
+            continue;
+        }
+        size_t capacity = 0;
+        for (size_t j = 0; j < c.slabs.size(); j++) {
+            capacity += c.slabs[j]->count;
+        }
+        snprintf(buffer, SIZE, "  %12u | %5u | %4u | %8u | %u\n",
+                int(kSizeClasses[i]), int(c.slabs.size()), int(c.used),
+                int(capacity), int(c.highWatermark));
+        result.append(buffer);
+    }
 }
 
 
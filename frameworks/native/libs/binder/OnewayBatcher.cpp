@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OnewayBatcher"
+
+#include <binder/OnewayBatcher.h>
+
+#include <binder/BpBinder.h>
+#include <binder/IPCThreadState.h>
+#include <binder/Parcel.h>
+
+#include <utils/Log.h>
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+OnewayBatcher::OnewayBatcher(const sp<Looper>& looper)
+    : mLooper(looper)
+    , mFlushScheduled(false)
+{
+}
+
+OnewayBatcher::~OnewayBatcher()
+{
+    // the calls still queued can't be sent anymore
+    for (size_t i = 0; i < mCalls.size(); i++) {
+        delete mCalls[i].data;
+    }
+}
+
+status_t OnewayBatcher::queue(const sp<IBinder>& target, uint32_t code,
+        const Parcel& data, int32_t mergeKey)
+{
+    if (target == NULL) {
+        return BAD_VALUE;
+    }
+    status_t err = data.errorCheck();
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    Parcel* copy = new Parcel();
+    err = copy->appendFrom(&data, 0, data.dataSize());
+    if (err != NO_ERROR) {
+        delete copy;
+        return err;
+    }
+
+    Parcel* replaced = NULL;
+    bool scheduleFlush = false;
+    {
+        Mutex::Autolock _l(mLock);
+        if (mergeKey != NO_MERGE) {
+            // the merged call goes to the end of the queue, so that it isn't
+            // delivered before the calls queued ahead of its last value
+            for (size_t i = 0; i < mCalls.size(); i++) {
+                const Call& c(mCalls[i]);
+                if (c.target == target && c.code == code &&
+                        c.mergeKey == mergeKey) {
+                    replaced = c.data;
+                    mCalls.removeAt(i);
+                    break;
+                }
+            }
+        }
+
+        Call call;
+        call.target = target;
+        call.code = code;
+        call.mergeKey = mergeKey;
+        call.data = copy;
+        mCalls.add(call);
+
+        if (mLooper != NULL && !mFlushScheduled) {
+            mFlushScheduled = true;
+            scheduleFlush = true;
+        }
+    }
+
+    // the replaced parcel may hold the last reference to binders, release
+    // them without holding the lock
+    delete replaced;
+
+    if (scheduleFlush) {
+        mLooper->sendMessage(this, Message());
+    }
+    return NO_ERROR;
+}
+
+status_t OnewayBatcher::flush()
+{
+    Mutex::Autolock _fl(mFlushLock);
+
+    Vector<Call> calls;
+    {
+        Mutex::Autolock _l(mLock);
+        calls = mCalls;
+        mCalls.clear();
+        mFlushScheduled = false;
+    }
+
+    // consecutive calls to remote binders are sent together, calls to local
+    // binders are made in between so that the order is kept
+    IPCThreadState* ipc = IPCThreadState::self();
+    Vector<IPCThreadState::OnewayTransaction> transactions;
+    status_t result = NO_ERROR;
+    const size_t count = calls.size();
+    for (size_t i = 0; i <= count; i++) {
+        BpBinder* proxy = i < count ? calls[i].target->remoteBinder() : NULL;
+        if (proxy != NULL) {
+            IPCThreadState::OnewayTransaction t;
+            t.handle = proxy->handle();
+            t.code = calls[i].code;
+            t.data = calls[i].data;
+            transactions.add(t);
+            continue;
+        }
+
+        if (!transactions.isEmpty()) {
+            status_t err = ipc->transactOneway(transactions.array(),
+                    transactions.size());
+            if (err != NO_ERROR && result == NO_ERROR) {
+                result = err;
+            }
+            transactions.clear();
+        }
+
+        if (i < count) {
+            const Call& c(calls[i]);
+            status_t err = c.target->transact(c.code, *c.data, NULL,
+                    IBinder::FLAG_ONEWAY);
+            if (err != NO_ERROR && result == NO_ERROR) {
+                result = err;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        delete calls[i].data;
+    }
+
+    ALOGW_IF(result != NO_ERROR, "flush: sending %zu calls failed (%d)",
+            count, result);
+    return result;
+}
+
+void OnewayBatcher::handleMessage(const Message& message)
+{
+    flush();
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
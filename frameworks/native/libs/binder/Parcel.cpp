@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <pthread.h>
 #include <sys/mman.h>
 
 #ifndef INT32_MAX
@@ -61,6 +62,15 @@
 // Maximum size of a blob to transfer in-place.
 static const size_t IN_PLACE_BLOB_LIMIT = 40 * 1024;
 
+// Most transactions are a few hundred bytes at most.  The data buffer of a
+// Parcel starts at PARCEL_MIN_CAPACITY bytes so that they don't grow it
+// through a series of realloc(), and the buffers of up to
+// PARCEL_CACHE_MAX_CAPACITY bytes are recycled through a small cache when
+// the Parcel goes away.
+static const size_t PARCEL_MIN_CAPACITY = 256;
+static const size_t PARCEL_CACHE_MAX_CAPACITY = 2048;
+static const size_t PARCEL_CACHE_SIZE = 8;
+
 // XXX This can be made public if we want to provide
 // support for typed data.
 struct small_flat_data
@@ -71,6 +81,56 @@ struct small_flat_data
 
 namespace android {
 
+struct ParcelCacheEntry {
+    uint8_t* data;
+    size_t capacity;
+};
+
+static pthread_mutex_t gParcelCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static ParcelCacheEntry gParcelCache[PARCEL_CACHE_SIZE];
+static size_t gParcelCacheCount = 0;
+
+static uint8_t* allocParcelData(size_t desired, size_t* outCapacity)
+{
+    if (desired <= PARCEL_CACHE_MAX_CAPACITY) {
+        pthread_mutex_lock(&gParcelCacheMutex);
+        for (size_t i = gParcelCacheCount; i > 0; i--) {
+            const ParcelCacheEntry entry(gParcelCache[i-1]);
+            if (entry.capacity >= desired) {
+                gParcelCache[i-1] = gParcelCache[--gParcelCacheCount];
+                pthread_mutex_unlock(&gParcelCacheMutex);
+                *outCapacity = entry.capacity;
+                return entry.data;
+            }
+        }
+        pthread_mutex_unlock(&gParcelCacheMutex);
+    }
+
+    const size_t capacity = desired < PARCEL_MIN_CAPACITY ? PARCEL_MIN_CAPACITY : desired;
+    uint8_t* data = (uint8_t*)malloc(capacity);
+    if (data) {
+        *outCapacity = capacity;
+    }
+    return data;
+}
+
+static void freeParcelData(uint8_t* data, size_t capacity)
+{
+    if (!data) return;
+    if (capacity >= PARCEL_MIN_CAPACITY && capacity <= PARCEL_CACHE_MAX_CAPACITY) {
+        pthread_mutex_lock(&gParcelCacheMutex);
+        if (gParcelCacheCount < PARCEL_CACHE_SIZE) {
+            gParcelCache[gParcelCacheCount].data = data;
+            gParcelCache[gParcelCacheCount].capacity = capacity;
+            gParcelCacheCount++;
+            pthread_mutex_unlock(&gParcelCacheMutex);
+            return;
+        }
+        pthread_mutex_unlock(&gParcelCacheMutex);
+    }
+    free(data);
+}
+
 void acquire_object(const sp<ProcessState>& proc,
     const flat_binder_object& obj, const void* who)
 {
@@ -1423,7 +1483,7 @@ void Parcel::freeDataNoInit()
         mOwner(this, mData, mDataSize, mObjects, mObjectsSize, mOwnerCookie);
     } else {
         releaseObjects();
-        if (mData) free(mData);
+        freeParcelData(mData, mDataCapacity);
         if (mObjects) free(mObjects);
     }
 }
@@ -1443,19 +1503,19 @@ status_t Parcel::restartWrite(size_t desired)
         return continueWrite(desired);
     }
     
-    uint8_t* data = (uint8_t*)realloc(mData, desired);
-    if (!data && desired > mDataCapacity) {
-        mError = NO_MEMORY;
-        return NO_MEMORY;
-    }
-    
-    releaseObjects();
-    
-    if (data) {
+    // keep the current buffer if it's large enough
+    if (desired > mDataCapacity) {
+        uint8_t* data = (uint8_t*)realloc(mData, desired);
+        if (!data) {
+            mError = NO_MEMORY;
+            return NO_MEMORY;
+        }
         mData = data;
         mDataCapacity = desired;
     }
     
+    releaseObjects();
+    
     mDataSize = mDataPos = 0;
     ALOGV("restartWrite Setting data size of %p to %d\n", this, mDataSize);
     ALOGV("restartWrite Setting data pos of %p to %d\n", this, mDataPos);
@@ -1497,7 +1557,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        size_t capacity;
+        uint8_t* data = allocParcelData(desired, &capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -1507,7 +1568,7 @@ status_t Parcel::continueWrite(size_t desired)
         if (objectsSize) {
             objects = (size_t*)malloc(objectsSize*sizeof(size_t));
             if (!objects) {
-                free(data);
+                freeParcelData(data, capacity);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -1535,7 +1596,7 @@ status_t Parcel::continueWrite(size_t desired)
         mObjects = objects;
         mDataSize = (mDataSize < desired) ? mDataSize : desired;
         ALOGV("continueWrite Setting data size of %p to %d\n", this, mDataSize);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
         mObjectsSize = mObjectsCapacity = objectsSize;
         mNextObjectHint = 0;
 
@@ -1584,7 +1645,8 @@ status_t Parcel::continueWrite(size_t desired)
         
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        size_t capacity;
+        uint8_t* data = allocParcelData(desired, &capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -1599,7 +1661,7 @@ status_t Parcel::continueWrite(size_t desired)
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %d\n", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %d\n", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
@@ -21,6 +21,7 @@
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
 #include <binder/PermissionCache.h>
+#include <utils/Atomic.h>
 #include <utils/String8.h>
 
 namespace android {
@@ -31,47 +32,136 @@ ANDROID_SINGLETON_STATIC_INSTANCE(PermissionCache) ;
 
 // ----------------------------------------------------------------------------
 
-PermissionCache::PermissionCache() {
+PermissionCache::PermissionCache()
+    : mNameCount(0) {
+    for (size_t i = 0; i < NUM_SHARDS; i++) {
+        Shard& shard(mShards[i]);
+        shard.seq = 0;
+        for (size_t j = 0; j < SHARD_SIZE; j++) {
+            shard.uids[j] = 0;
+            shard.values[j] = 0;
+        }
+        shard.next = 0;
+    }
+}
+
+ssize_t PermissionCache::findName(const String16& permission) const {
+    const int32_t count = android_atomic_acquire_load(&mNameCount);
+    for (int32_t i = 0; i < count; i++) {
+        // most callers check the same static String16 every time
+        const String16& name(mNames[i]);
+        if (name.string() == permission.string() || name == permission) {
+            return i;
+        }
+    }
+    return NAME_NOT_FOUND;
+}
+
+ssize_t PermissionCache::addName(const String16& permission) {
+    Mutex::Autolock _l(mLock);
+    ssize_t index = findName(permission);
+    if (index < 0 && mNameCount < MAX_NAMES) {
+        index = mNameCount;
+        mNames[index] = permission;
+        android_atomic_release_store(index + 1, &mNameCount);
+    }
+    return index;
+}
+
+size_t PermissionCache::shardIndex(uid_t uid, ssize_t name) {
+    return (uint32_t(uid) * 31 + uint32_t(name)) % NUM_SHARDS;
 }
 
 status_t PermissionCache::check(bool* granted,
         const String16& permission, uid_t uid) const {
-    Mutex::Autolock _l(mLock);
-    Entry e;
-    e.name = permission;
-    e.uid  = uid;
-    ssize_t index = mCache.indexOf(e);
-    if (index >= 0) {
-        *granted = mCache.itemAt(index).granted;
-        return NO_ERROR;
+    const ssize_t name = findName(permission);
+    if (name < 0) {
+        return NAME_NOT_FOUND;
+    }
+
+    const Shard& shard(mShards[shardIndex(uid, name)]);
+    const int32_t key = int32_t(name + 1) << 1;
+    while (true) {
+        const int32_t seq = android_atomic_acquire_load(&shard.seq);
+        if (seq & 1) {
+            // a writer is updating the shard, it won't be long
+            continue;
+        }
+        status_t result = NAME_NOT_FOUND;
+        bool value = false;
+        for (size_t i = 0; i < SHARD_SIZE; i++) {
+            const int32_t v = android_atomic_acquire_load(&shard.values[i]);
+            if ((v & ~1) == key &&
+                    android_atomic_acquire_load(&shard.uids[i]) == int32_t(uid)) {
+                value = v & 1;
+                result = NO_ERROR;
+                break;
+            }
+        }
+        if (android_atomic_acquire_load(&shard.seq) == seq) {
+            if (result == NO_ERROR) {
+                *granted = value;
+            }
+            return result;
+        }
     }
-    return NAME_NOT_FOUND;
 }
 
 void PermissionCache::cache(const String16& permission,
         uid_t uid, bool granted) {
-    Mutex::Autolock _l(mLock);
-    Entry e;
-    ssize_t index = mPermissionNamesPool.indexOf(permission);
-    if (index > 0) {
-        e.name = mPermissionNamesPool.itemAt(index);
-    } else {
-        mPermissionNamesPool.add(permission);
-        e.name = permission;
+    const ssize_t name = addName(permission);
+    if (name < 0) {
+        // too many permissions, this one isn't cached
+        return;
     }
+
     // note, we don't need to store the pid, which is not actually used in
     // permission checks
-    e.uid  = uid;
-    e.granted = granted;
-    index = mCache.indexOf(e);
-    if (index < 0) {
-        mCache.add(e);
+    Shard& shard(mShards[shardIndex(uid, name)]);
+    const int32_t key = int32_t(name + 1) << 1;
+    Mutex::Autolock _l(shard.lock);
+    ssize_t slot = -1;
+    for (size_t i = 0; i < SHARD_SIZE; i++) {
+        const int32_t v = shard.values[i];
+        if ((v & ~1) == key && shard.uids[i] == int32_t(uid)) {
+            // another thread cached it in the meantime
+            return;
+        }
+        if (v == 0 && slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        slot = shard.next;
+        shard.next = (shard.next + 1) % SHARD_SIZE;
+    }
+
+    android_atomic_release_store(shard.seq + 1, &shard.seq);
+    android_atomic_release_store(int32_t(uid), &shard.uids[slot]);
+    android_atomic_release_store(key | (granted ? 1 : 0), &shard.values[slot]);
+    android_atomic_release_store(shard.seq + 1, &shard.seq);
+}
+
+void PermissionCache::purge(uid_t uid) {
+    for (size_t i = 0; i < NUM_SHARDS; i++) {
+        Shard& shard(mShards[i]);
+        Mutex::Autolock _l(shard.lock);
+        android_atomic_release_store(shard.seq + 1, &shard.seq);
+        for (size_t j = 0; j < SHARD_SIZE; j++) {
+            if (uid == uid_t(-1) || shard.uids[j] == int32_t(uid)) {
+                android_atomic_release_store(0, &shard.values[j]);
+            }
+        }
+        android_atomic_release_store(shard.seq + 1, &shard.seq);
     }
 }
 
-void PermissionCache::purge() {
-    Mutex::Autolock _l(mLock);
-    mCache.clear();
+void PermissionCache::invalidate() {
+    PermissionCache::getInstance().purge(uid_t(-1));
+}
+
+void PermissionCache::invalidate(uid_t uid) {
+    PermissionCache::getInstance().purge(uid);
 }
 
 bool PermissionCache::checkCallingPermission(const String16& permission) {
@@ -17,6 +17,7 @@
 #define LOG_TAG "ProcessState"
 
 #include <cutils/process_name.h>
+#include <cutils/properties.h>
 
 #include <binder/ProcessState.h>
 
@@ -39,9 +40,11 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 
 #define BINDER_VM_SIZE ((1*1024*1024) - (4096 *2))
+#define DEFAULT_MAX_BINDER_THREADS 15
 
 
 // ---------------------------------------------------------------------------
@@ -56,19 +59,23 @@ int                 mArgLen;
 class PoolThread : public Thread
 {
 public:
-    PoolThread(bool isMain)
+    PoolThread(bool isMain, bool isReserved = false)
         : mIsMain(isMain)
+        , mIsReserved(isReserved)
     {
     }
     
 protected:
     virtual bool threadLoop()
     {
-        IPCThreadState::self()->joinThreadPool(mIsMain);
+        IPCThreadState* ipc = IPCThreadState::self();
+        ipc->mReservedThread = mIsReserved;
+        ipc->joinThreadPool(mIsMain);
         return false;
     }
     
     const bool mIsMain;
+    const bool mIsReserved;
 };
 
 sp<ProcessState> ProcessState::self()
@@ -324,18 +331,117 @@ void ProcessState::spawnPooledThread(bool isMain)
         ALOGV("Spawning new pooled thread, name=%s\n", name.string());
         sp<Thread> t = new PoolThread(isMain);
         t->run(name.string());
+        android_atomic_inc(&mSpawnedThreads);
     }
 }
 
 status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
+    AutoMutex _l(mLock);
     status_t result = NO_ERROR;
-    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &maxThreads) == -1) {
+    size_t driverMaxThreads = maxThreads + mRetiredThreads;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) == -1) {
         result = -errno;
         ALOGE("Binder ioctl to set max threads failed: %s", strerror(-result));
+    } else {
+        mMaxThreads = maxThreads;
     }
     return result;
 }
 
+void ProcessState::setThreadPoolIdleTimeout(nsecs_t timeout) {
+    AutoMutex _l(mLock);
+    mIdleTimeout = timeout;
+}
+
+void ProcessState::setThreadPoolReservedThreadCount(size_t count) {
+    AutoMutex _l(mLock);
+    mMaxReservedThreads = count;
+}
+
+void ProcessState::threadPoolThreadJoined() {
+    android_atomic_inc(&mThreadPoolThreads);
+}
+
+void ProcessState::threadPoolThreadExited(bool isMain, bool isReserved,
+        bool retired) {
+    android_atomic_dec(&mThreadPoolThreads);
+    if (!isMain && (isReserved || retired)) {
+        AutoMutex _l(mLock);
+        if (isReserved) {
+            mReservedThreads--;
+        } else {
+            // the driver still counts this thread against the maximum, let
+            // it spawn a new one in its place
+            mRetiredThreads++;
+            size_t driverMaxThreads = mMaxThreads + mRetiredThreads;
+            if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) == -1) {
+                ALOGE("Binder ioctl to set max threads failed: %s", strerror(errno));
+            }
+        }
+    }
+}
+
+bool ProcessState::shouldRetireThread(nsecs_t idleTime) const {
+    // mIdleTimeout is only ever set once in practice, reading it without
+    // the lock is fine
+    if (mIdleTimeout <= 0 || idleTime < mIdleTimeout) {
+        return false;
+    }
+    // the calling thread is waiting too, keep at least one other thread
+    const int32_t waiting = android_atomic_acquire_load(&mThreadPoolThreads) -
+            android_atomic_acquire_load(&mExecutingThreads);
+    return waiting > 1;
+}
+
+void ProcessState::beginPooledTransaction(pid_t tid) {
+    const int32_t executing = android_atomic_inc(&mExecutingThreads) + 1;
+    if (executing > mMaxExecutingThreads) {
+        mMaxExecutingThreads = executing;
+    }
+    if (executing < android_atomic_acquire_load(&mThreadPoolThreads)) {
+        return;
+    }
+
+    // no thread of the pool is left waiting for the next transaction
+    android_atomic_inc(&mSaturatedCount);
+    if (mMaxReservedThreads > 0 &&
+            getpriority(PRIO_PROCESS, tid) < ANDROID_PRIORITY_NORMAL) {
+        spawnReservedThread();
+    }
+}
+
+void ProcessState::endPooledTransaction() {
+    android_atomic_dec(&mExecutingThreads);
+}
+
+void ProcessState::spawnReservedThread() {
+    AutoMutex _l(mLock);
+    if (mThreadPoolStarted && mReservedThreads < mMaxReservedThreads) {
+        mReservedThreads++;
+        mSpawnedReservedThreads++;
+        String8 name = makeBinderThreadName();
+        ALOGV("Spawning new reserved pooled thread, name=%s\n", name.string());
+        sp<Thread> t = new PoolThread(false, true);
+        t->run(name.string());
+    }
+}
+
+void ProcessState::dumpThreadPool(String8& result) const {
+    AutoMutex _l(mLock);
+    result.appendFormat("Binder thread pool (pid %d): threads=%d, executing=%d "
+            "(max %d), saturated=%d\n", getpid(),
+            android_atomic_acquire_load(&mThreadPoolThreads),
+            android_atomic_acquire_load(&mExecutingThreads),
+            mMaxExecutingThreads,
+            android_atomic_acquire_load(&mSaturatedCount));
+    result.appendFormat("  max threads=%zu, spawned=%d, retired=%u, "
+            "idle timeout=%lldms\n", mMaxThreads,
+            android_atomic_acquire_load(&mSpawnedThreads),
+            mRetiredThreads, mIdleTimeout / 1000000);
+    result.appendFormat("  reserved threads=%zu (max %zu), spawned=%u\n",
+            mReservedThreads, mMaxReservedThreads, mSpawnedReservedThreads);
+}
+
 void ProcessState::giveThreadPoolName() {
     androidSetThreadName( makeBinderThreadName().string() );
 }
@@ -357,7 +463,7 @@ static int open_driver()
             close(fd);
             fd = -1;
         }
-        size_t maxThreads = 15;
+        size_t maxThreads = DEFAULT_MAX_BINDER_THREADS;
         result = ioctl(fd, BINDER_SET_MAX_THREADS, &maxThreads);
         if (result == -1) {
             ALOGE("Binder ioctl to set max threads failed: %s", strerror(errno));
@@ -376,7 +482,24 @@ ProcessState::ProcessState()
     , mBinderContextUserData(NULL)
     , mThreadPoolStarted(false)
     , mThreadPoolSeq(1)
+    , mMaxThreads(DEFAULT_MAX_BINDER_THREADS)
+    , mIdleTimeout(0)
+    , mMaxReservedThreads(0)
+    , mReservedThreads(0)
+    , mThreadPoolThreads(0)
+    , mExecutingThreads(0)
+    , mMaxExecutingThreads(0)
+    , mSaturatedCount(0)
+    , mSpawnedThreads(0)
+    , mRetiredThreads(0)
+    , mSpawnedReservedThreads(0)
 {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.binder.idle_timeout_ms", value, "0");
+    mIdleTimeout = ms2ns(atoi(value));
+    property_get("ro.binder.reserved_threads", value, "0");
+    mMaxReservedThreads = atoi(value);
+
     if (mDriverFD >= 0) {
         // XXX Ideally, there should be a specific define for whether we
         // have mmap (or whether we could possibly have the kernel module
@@ -90,6 +90,11 @@ public:
 
 static LibBinderIPCtStatics gIPCStatics;
 
+// ------------ TransactionStats.cpp
+
+Mutex gTransactionStatsLock;
+TransactionStats* gTransactionStats = NULL;
+
 // ------------ ServiceManager.cpp
 
 Mutex gDefaultServiceManagerLock;
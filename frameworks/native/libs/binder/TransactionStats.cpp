@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TransactionStats"
+
+#include <private/binder/TransactionStats.h>
+#include <private/binder/binder_module.h>
+#include <private/binder/Static.h>
+
+#include <binder/IBinder.h>
+#include <binder/ProcessState.h>
+
+#include <utils/Atomic.h>
+#include <utils/KeyedVector.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include <string.h>
+#include <unistd.h>
+
+namespace android {
+
+// ---------------------------------------------------------------------------
+
+static size_t timeBucket(nsecs_t duration)
+{
+    size_t bucket = 0;
+    nsecs_t n = duration / 16000;
+    while (n > 0 && bucket < TransactionStats::NUM_TIME_BUCKETS - 1) {
+        n >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static size_t sizeBucket(size_t size)
+{
+    size_t bucket = 0;
+    size_t n = size / 64;
+    while (n > 0 && bucket < TransactionStats::NUM_SIZE_BUCKETS - 1) {
+        n >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+TransactionStats::TransactionStats()
+    : mDropped(0)
+    , mNext(NULL)
+    , mInUse(false)
+{
+    for (size_t i = 0; i < NUM_ENTRIES; i++) {
+        Entry& e(mEntries[i]);
+        e.used = 0;
+        e.incoming = false;
+        e.target = 0;
+        e.code = 0;
+        e.count = 0;
+        e.oneway = 0;
+        e.totalTime = 0;
+        e.maxTime = 0;
+        e.waitTime = 0;
+        e.dataBytes = 0;
+        e.replyBytes = 0;
+        memset(e.timeHistogram, 0, sizeof(e.timeHistogram));
+        memset(e.sizeHistogram, 0, sizeof(e.sizeHistogram));
+    }
+}
+
+TransactionStats* TransactionStats::get()
+{
+    AutoMutex _l(gTransactionStatsLock);
+    TransactionStats* stats = gTransactionStats;
+    while (stats != NULL && stats->mInUse) {
+        stats = stats->mNext;
+    }
+    if (stats == NULL) {
+        // these are never freed, see put()
+        stats = new TransactionStats();
+        stats->mNext = gTransactionStats;
+        gTransactionStats = stats;
+    }
+    stats->mInUse = true;
+    return stats;
+}
+
+void TransactionStats::put(TransactionStats* stats)
+{
+    AutoMutex _l(gTransactionStatsLock);
+    stats->mInUse = false;
+}
+
+TransactionStats::Entry* TransactionStats::findEntry(bool incoming,
+        uintptr_t target, uint32_t code, const String16* descriptor)
+{
+    size_t index = ((target >> 2) * 31 + code * 7 + incoming) % NUM_ENTRIES;
+    for (size_t i = 0; i < NUM_ENTRIES; i++) {
+        Entry* e = &mEntries[index];
+        if (!e->used) {
+            e->incoming = incoming;
+            e->target = target;
+            e->code = code;
+            if (descriptor != NULL) {
+                e->descriptor = *descriptor;
+            }
+            android_atomic_release_store(1, &e->used);
+            return e;
+        }
+        if (e->incoming == incoming && e->target == target && e->code == code) {
+            return e;
+        }
+        index = (index + 1) % NUM_ENTRIES;
+    }
+    mDropped++;
+    return NULL;
+}
+
+void TransactionStats::record(Entry* e, uint32_t flags, nsecs_t duration,
+        nsecs_t waitTime, size_t dataSize, size_t replySize)
+{
+    e->count++;
+    if (flags & TF_ONE_WAY) {
+        e->oneway++;
+    }
+    e->totalTime += duration;
+    if (duration > e->maxTime) {
+        e->maxTime = duration;
+    }
+    e->waitTime += waitTime;
+    e->dataBytes += dataSize;
+    e->replyBytes += replySize;
+    e->timeHistogram[timeBucket(duration)]++;
+    e->sizeHistogram[sizeBucket(dataSize)]++;
+}
+
+void TransactionStats::recordOutgoing(int32_t handle, uint32_t code,
+        uint32_t flags, nsecs_t duration, nsecs_t waitTime, size_t dataSize,
+        size_t replySize)
+{
+    // the interface descriptor of the handle is looked up by dump(), asking
+    // for it here would mean another transaction
+    Entry* e = findEntry(false, uintptr_t(handle), code, NULL);
+    if (e != NULL) {
+        record(e, flags, duration, waitTime, dataSize, replySize);
+    }
+}
+
+void TransactionStats::recordIncoming(const void* binder,
+        const String16& descriptor, uint32_t code, uint32_t flags,
+        nsecs_t duration, size_t dataSize, size_t replySize)
+{
+    Entry* e = findEntry(true, uintptr_t(binder), code, &descriptor);
+    if (e != NULL) {
+        record(e, flags, duration, 0, dataSize, replySize);
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct Summary {
+    bool incoming;
+    uintptr_t target;
+    uint32_t code;
+    String16 descriptor;
+    uint32_t count;
+    uint32_t oneway;
+    nsecs_t totalTime;
+    nsecs_t maxTime;
+    nsecs_t waitTime;
+    uint64_t dataBytes;
+    uint64_t replyBytes;
+    uint32_t timeHistogram[TransactionStats::NUM_TIME_BUCKETS];
+    uint32_t sizeHistogram[TransactionStats::NUM_SIZE_BUCKETS];
+
+    template <typename T>
+    void init(const T& rhs) {
+        incoming = rhs.incoming;
+        target = rhs.target;
+        code = rhs.code;
+        descriptor = rhs.descriptor;
+        count = 0;
+        oneway = 0;
+        totalTime = 0;
+        maxTime = 0;
+        waitTime = 0;
+        dataBytes = 0;
+        replyBytes = 0;
+        memset(timeHistogram, 0, sizeof(timeHistogram));
+        memset(sizeHistogram, 0, sizeof(sizeHistogram));
+    }
+
+    template <typename T>
+    void merge(const T& rhs) {
+        count += rhs.count;
+        oneway += rhs.oneway;
+        totalTime += rhs.totalTime;
+        if (rhs.maxTime > maxTime) {
+            maxTime = rhs.maxTime;
+        }
+        waitTime += rhs.waitTime;
+        dataBytes += rhs.dataBytes;
+        replyBytes += rhs.replyBytes;
+        for (size_t i = 0; i < TransactionStats::NUM_TIME_BUCKETS; i++) {
+            timeHistogram[i] += rhs.timeHistogram[i];
+        }
+        for (size_t i = 0; i < TransactionStats::NUM_SIZE_BUCKETS; i++) {
+            sizeHistogram[i] += rhs.sizeHistogram[i];
+        }
+    }
+};
+
+// adds rhs to the summary of the same transaction, matching incoming
+// transactions and the already resolved outgoing ones by descriptor, and
+// the other outgoing ones by handle.
+template <typename T>
+static void addToSummaries(Vector<Summary>& summaries, const T& rhs,
+        bool byDescriptor)
+{
+    for (size_t i = 0; i < summaries.size(); i++) {
+        Summary& s(summaries.editItemAt(i));
+        if (s.incoming == rhs.incoming && s.code == rhs.code &&
+                (byDescriptor ? s.descriptor == rhs.descriptor :
+                        s.target == rhs.target)) {
+            s.merge(rhs);
+            return;
+        }
+    }
+    Summary s;
+    s.init(rhs);
+    s.merge(rhs);
+    summaries.add(s);
+}
+
+static void dumpSummaries(String8& result, const Vector<Summary>& summaries,
+        bool incoming)
+{
+    // the most expensive transactions first
+    Vector<const Summary*> sorted;
+    for (size_t i = 0; i < summaries.size(); i++) {
+        if (summaries[i].incoming == incoming) {
+            size_t pos = 0;
+            while (pos < sorted.size() &&
+                    sorted[pos]->totalTime >= summaries[i].totalTime) {
+                pos++;
+            }
+            sorted.insertAt(&summaries[i], pos);
+        }
+    }
+
+    result.appendFormat("  %s transactions: %zu\n",
+            incoming ? "incoming" : "outgoing", sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const Summary& s(*sorted[i]);
+        result.appendFormat("    %s code=%u: count=%u, oneway=%u, "
+                "avg=%lldus, max=%lldus",
+                String8(s.descriptor).string(), s.code, s.count, s.oneway,
+                s.totalTime / s.count / 1000, s.maxTime / 1000);
+        if (!incoming) {
+            result.appendFormat(", avg wait=%lldus", s.waitTime / s.count / 1000);
+        }
+        result.appendFormat(", avg data=%lluB, avg reply=%lluB\n",
+                s.dataBytes / s.count, s.replyBytes / s.count);
+
+        result.append("      time:");
+        for (size_t b = 0; b < TransactionStats::NUM_TIME_BUCKETS; b++) {
+            if (s.timeHistogram[b] == 0) continue;
+            if (b < TransactionStats::NUM_TIME_BUCKETS - 1) {
+                result.appendFormat(" <%uus:%u", 16u << b, s.timeHistogram[b]);
+            } else {
+                result.appendFormat(" >=%uus:%u", 16u << (b - 1), s.timeHistogram[b]);
+            }
+        }
+        result.append("\n      data:");
+        for (size_t b = 0; b < TransactionStats::NUM_SIZE_BUCKETS; b++) {
+            if (s.sizeHistogram[b] == 0) continue;
+            if (b < TransactionStats::NUM_SIZE_BUCKETS - 1) {
+                result.appendFormat(" <%uB:%u", 64u << b, s.sizeHistogram[b]);
+            } else {
+                result.appendFormat(" >=%uB:%u", 64u << (b - 1), s.sizeHistogram[b]);
+            }
+        }
+        result.append("\n");
+    }
+}
+
+}; // anonymous namespace
+
+void TransactionStats::dump(String8& result)
+{
+    Vector<Summary> byTarget;
+    uint32_t dropped = 0;
+    uint32_t numThreads = 0;
+    {
+        AutoMutex _l(gTransactionStatsLock);
+        for (TransactionStats* stats = gTransactionStats; stats != NULL;
+                stats = stats->mNext) {
+            for (size_t i = 0; i < NUM_ENTRIES; i++) {
+                const Entry& e(stats->mEntries[i]);
+                if (android_atomic_acquire_load(&e.used) && e.count > 0) {
+                    addToSummaries(byTarget, e, e.incoming);
+                }
+            }
+            dropped += stats->mDropped;
+            numThreads++;
+        }
+    }
+
+    // resolve the descriptors of the outgoing transactions without holding
+    // the lock, this may need a transaction per handle
+    sp<ProcessState> proc(ProcessState::self());
+    KeyedVector<uintptr_t, String16> descriptors;
+    Vector<Summary> summaries;
+    for (size_t i = 0; i < byTarget.size(); i++) {
+        Summary& s(byTarget.editItemAt(i));
+        if (!s.incoming) {
+            ssize_t index = descriptors.indexOfKey(s.target);
+            if (index < 0) {
+                String16 descriptor;
+                sp<IBinder> binder(proc->getStrongProxyForHandle(int32_t(s.target)));
+                if (binder != NULL) {
+                    descriptor = binder->getInterfaceDescriptor();
+                }
+                if (descriptor.size() == 0) {
+                    String8 name;
+                    name.appendFormat("handle %d", int32_t(s.target));
+                    descriptor = String16(name);
+                }
+                index = descriptors.add(s.target, descriptor);
+            }
+            s.descriptor = descriptors.valueAt(index);
+        } else if (s.descriptor.size() == 0) {
+            s.descriptor = String16("<unknown>");
+        }
+        addToSummaries(summaries, s, true);
+    }
+
+    result.appendFormat("Binder transaction stats (pid %d, %u threads, "
+            "%u dropped):\n", getpid(), numThreads, dropped);
+    dumpSummaries(result, summaries, false);
+    dumpSummaries(result, summaries, true);
+}
+
+// ---------------------------------------------------------------------------
+
+}; // namespace android
@@ -65,6 +65,16 @@ static const char* scalingModeName(int scalingMode) {
     }
 }
 
+// The frame that replaces a dropped frame must also carry its damage, an
+// empty damage covering the whole buffer.
+static void mergeSurfaceDamage(Region& damage, const Region& droppedDamage) {
+    if (droppedDamage.isEmpty()) {
+        damage.clear();
+    } else if (!damage.isEmpty()) {
+        damage.orSelf(droppedDamage);
+    }
+}
+
 BufferQueue::BufferQueue(const sp<IGraphicBufferAlloc>& allocator) :
     mDefaultWidth(1),
     mDefaultHeight(1),
@@ -76,6 +86,9 @@ BufferQueue::BufferQueue(const sp<IGraphicBufferAlloc>& allocator) :
     mUseAsyncBuffer(true),
     mConnectedApi(NO_CONNECTED_API),
     mAbandoned(false),
+    mDequeueWaiters(0),
+    mDequeueWaitCount(0),
+    mDequeueWaitTime(0),
     mFrameCounter(0),
     mBufferHasBeenQueued(false),
     mDefaultBufferFormat(PIXEL_FORMAT_RGBA_8888),
@@ -263,9 +276,14 @@ status_t BufferQueue::dequeueBuffer(int *outBuf, sp<Fence>* outFence, bool async
     status_t returnFlags(OK);
     EGLDisplay dpy = EGL_NO_DISPLAY;
     EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
+    // the buffers being dropped are only released once the lock is
+    // dropped, so that unmapping them doesn't stall the consumer
+    sp<GraphicBuffer> oldBuffer;
+    Vector<sp<GraphicBuffer> > expiredBuffers;
+    bool needsAllocation = false;
 
     { // Scope for the lock
-        Mutex::Autolock lock(mMutex);
+        StatsAutolock lock(mMutex, mProducerLockStats);
 
         if (format == 0) {
             format = mDefaultBufferFormat;
@@ -368,7 +386,7 @@ status_t BufferQueue::dequeueBuffer(int *outBuf, sp<Fence>* outFence, bool async
                     ST_LOGE("dequeueBuffer: would block! returning an error instead.");
                     return WOULD_BLOCK;
                 }
-                mDequeueCondition.wait(mMutex);
+                waitForDequeueConditionLocked();
             }
         }
 
@@ -393,6 +411,8 @@ status_t BufferQueue::dequeueBuffer(int *outBuf, sp<Fence>* outFence, bool async
 
         mSlots[buf].mBufferState = BufferSlot::DEQUEUED;
 
+        expireFreeBuffersLocked(&expiredBuffers);
+
         const sp<GraphicBuffer>& buffer(mSlots[buf].mGraphicBuffer);
         if ((buffer == NULL) ||
             (uint32_t(buffer->width)  != w) ||
@@ -400,13 +420,34 @@ status_t BufferQueue::dequeueBuffer(int *outBuf, sp<Fence>* outFence, bool async
             (uint32_t(buffer->format) != format) ||
             ((uint32_t(buffer->usage) & usage) != usage))
         {
+            // take the replacement from the pool before adding the old
+            // buffer to it, so that it can't get evicted
+            sp<Fence> fence;
+            sp<GraphicBuffer> freeBuffer(
+                    takeFreeBufferLocked(w, h, format, usage, &fence));
+
             mSlots[buf].mAcquireCalled = false;
+            if (buffer != NULL && mSlots[buf].mEglFence == EGL_NO_SYNC_KHR) {
+                // keep the buffer in case the producer goes back to its
+                // geometry, e.g. when the display rotates back
+                oldBuffer = addFreeBufferLocked(buffer, mSlots[buf].mFence);
+            } else {
+                oldBuffer = buffer;
+            }
             mSlots[buf].mGraphicBuffer = NULL;
             mSlots[buf].mRequestBufferCalled = false;
             mSlots[buf].mEglFence = EGL_NO_SYNC_KHR;
             mSlots[buf].mFence = Fence::NO_FENCE;
             mSlots[buf].mEglDisplay = EGL_NO_DISPLAY;
 
+            if (freeBuffer != NULL) {
+                mSlots[buf].mFrameNumber = ~0;
+                mSlots[buf].mGraphicBuffer = freeBuffer;
+                mSlots[buf].mFence = fence;
+            } else {
+                needsAllocation = true;
+            }
+
             returnFlags |= IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION;
         }
 
@@ -424,7 +465,7 @@ status_t BufferQueue::dequeueBuffer(int *outBuf, sp<Fence>* outFence, bool async
         mSlots[buf].mFence = Fence::NO_FENCE;
     }  // end lock scope
 
-    if (returnFlags & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+    if (needsAllocation) {
         status_t error;
         sp<GraphicBuffer> graphicBuffer(
                 mGraphicBufferAlloc->createGraphicBuffer(w, h, format, usage, &error));
@@ -434,7 +475,7 @@ status_t BufferQueue::dequeueBuffer(int *outBuf, sp<Fence>* outFence, bool async
         }
 
         { // Scope for the lock
-            Mutex::Autolock lock(mMutex);
+            StatsAutolock lock(mMutex, mProducerLockStats);
 
             if (mAbandoned) {
                 ST_LOGE("dequeueBuffer: BufferQueue has been abandoned!");
@@ -478,9 +519,10 @@ status_t BufferQueue::queueBuffer(int buf,
     bool isAutoTimestamp;
     bool async;
     sp<Fence> fence;
+    Region surfaceDamage;
 
     input.deflate(&timestamp, &isAutoTimestamp, &crop, &scalingMode, &transform,
-            &async, &fence);
+            &async, &fence, &surfaceDamage);
 
     if (fence == NULL) {
         ST_LOGE("queueBuffer: fence is NULL");
@@ -501,7 +543,7 @@ status_t BufferQueue::queueBuffer(int buf,
     sp<IConsumerListener> listener;
 
     { // scope for the lock
-        Mutex::Autolock lock(mMutex);
+        StatsAutolock lock(mMutex, mProducerLockStats);
 
         if (mAbandoned) {
             ST_LOGE("queueBuffer: BufferQueue has been abandoned!");
@@ -566,6 +608,7 @@ status_t BufferQueue::queueBuffer(int buf,
         item.mBuf = buf;
         item.mFence = fence;
         item.mIsDroppable = mDequeueBufferCannotBlock || async;
+        item.mSurfaceDamage = surfaceDamage;
 
         if (mQueue.empty()) {
             // when the queue is empty, we can ignore "mDequeueBufferCannotBlock", and
@@ -585,6 +628,7 @@ status_t BufferQueue::queueBuffer(int buf,
                     mSlots[front->mBuf].mFrameNumber = 0;
                 }
                 // and we record the new buffer in the queued list
+                mergeSurfaceDamage(item.mSurfaceDamage, front->mSurfaceDamage);
                 *front = item;
             } else {
                 mQueue.push_back(item);
@@ -593,7 +637,7 @@ status_t BufferQueue::queueBuffer(int buf,
         }
 
         mBufferHasBeenQueued = true;
-        mDequeueCondition.broadcast();
+        broadcastDequeueConditionLocked();
 
         output->inflate(mDefaultWidth, mDefaultHeight, mTransformHint,
                 mQueue.size());
@@ -611,7 +655,7 @@ status_t BufferQueue::queueBuffer(int buf,
 void BufferQueue::cancelBuffer(int buf, const sp<Fence>& fence) {
     ATRACE_CALL();
     ST_LOGV("cancelBuffer: slot=%d", buf);
-    Mutex::Autolock lock(mMutex);
+    StatsAutolock lock(mMutex, mProducerLockStats);
 
     if (mAbandoned) {
         ST_LOGW("cancelBuffer: BufferQueue has been abandoned!");
@@ -633,7 +677,7 @@ void BufferQueue::cancelBuffer(int buf, const sp<Fence>& fence) {
     mSlots[buf].mBufferState = BufferSlot::FREE;
     mSlots[buf].mFrameNumber = 0;
     mSlots[buf].mFence = fence;
-    mDequeueCondition.broadcast();
+    broadcastDequeueConditionLocked();
 }
 
 
@@ -669,7 +713,7 @@ retry:
     if (mQueue.size() > (size_t) maxBufferCount) {
         // TODO: make this bound tighter?
         ST_LOGV("queue size is %d, waiting", mQueue.size());
-        mDequeueCondition.wait(mMutex);
+        waitForDequeueConditionLocked();
         goto retry;
     }
 
@@ -768,6 +812,96 @@ status_t BufferQueue::disconnect(int api) {
     return err;
 }
 
+void BufferQueue::allocateBuffers(bool async, uint32_t w, uint32_t h,
+        uint32_t format, uint32_t usage, int count) {
+    ATRACE_CALL();
+    ST_LOGV("allocateBuffers: w=%d h=%d fmt=%#x usage=%#x count=%d",
+            w, h, format, usage, count);
+
+    if ((w && !h) || (!w && h)) {
+        ST_LOGE("allocateBuffers: invalid size: w=%u, h=%u", w, h);
+        return;
+    }
+
+    { // Scope for the lock
+        Mutex::Autolock lock(mMutex);
+
+        if (mAbandoned) {
+            ST_LOGE("allocateBuffers: BufferQueue has been abandoned!");
+            return;
+        }
+
+        if (format == 0) {
+            format = mDefaultBufferFormat;
+        }
+        usage |= mConsumerUsageBits;
+        if (!w && !h) {
+            w = mDefaultWidth;
+            h = mDefaultHeight;
+        }
+
+        const int maxBufferCount = getMaxBufferCountLocked(async);
+        if (count > maxBufferCount) {
+            count = maxBufferCount;
+        }
+        if (count > MAX_FREE_BUFFERS) {
+            count = MAX_FREE_BUFFERS;
+        }
+
+        // don't allocate the buffers that already exist
+        for (size_t i = 0; i < mFreeBuffers.size(); i++) {
+            const sp<GraphicBuffer>& buffer(mFreeBuffers[i].mGraphicBuffer);
+            if (uint32_t(buffer->width) == w &&
+                    uint32_t(buffer->height) == h &&
+                    uint32_t(buffer->format) == format &&
+                    (uint32_t(buffer->usage) & usage) == usage) {
+                count--;
+            }
+        }
+        for (int i = 0; i < maxBufferCount; i++) {
+            const sp<GraphicBuffer>& buffer(mSlots[i].mGraphicBuffer);
+            if (buffer != NULL &&
+                    uint32_t(buffer->width) == w &&
+                    uint32_t(buffer->height) == h &&
+                    uint32_t(buffer->format) == format &&
+                    (uint32_t(buffer->usage) & usage) == usage) {
+                count--;
+            }
+        }
+    }
+
+    // allocate without holding the lock, the producer and the consumer
+    // keep running in the meantime
+    Vector<sp<GraphicBuffer> > buffers;
+    for (int i = 0; i < count; i++) {
+        status_t error;
+        sp<GraphicBuffer> graphicBuffer(
+                mGraphicBufferAlloc->createGraphicBuffer(w, h, format, usage, &error));
+        if (graphicBuffer == 0) {
+            ST_LOGE("allocateBuffers: SurfaceComposer::createGraphicBuffer failed");
+            break;
+        }
+        buffers.add(graphicBuffer);
+    }
+
+    Vector<sp<GraphicBuffer> > evictedBuffers;
+    { // Scope for the lock
+        Mutex::Autolock lock(mMutex);
+
+        if (mAbandoned) {
+            ST_LOGE("allocateBuffers: BufferQueue has been abandoned!");
+            return;
+        }
+
+        for (size_t i = 0; i < buffers.size(); i++) {
+            sp<GraphicBuffer> evicted(addFreeBufferLocked(buffers[i], Fence::NO_FENCE));
+            if (evicted != NULL) {
+                evictedBuffers.add(evicted);
+            }
+        }
+    }
+}
+
 void BufferQueue::dump(String8& result, const char* prefix) const {
     Mutex::Autolock _l(mMutex);
 
@@ -794,6 +928,27 @@ void BufferQueue::dump(String8& result, const char* prefix) const {
             mDefaultHeight, mDefaultBufferFormat, mTransformHint,
             fifoSize, fifo.string());
 
+    if (!mFreeBuffers.isEmpty()) {
+        result.appendFormat("%s free buffers:", prefix);
+        for (size_t i = 0; i < mFreeBuffers.size(); i++) {
+            const sp<GraphicBuffer>& buf(mFreeBuffers[i].mGraphicBuffer);
+            result.appendFormat(" [%4ux%4u:%4u,%3X]",
+                    buf->width, buf->height, buf->stride, buf->format);
+        }
+        result.append("\n");
+    }
+
+    result.appendFormat(
+            "%s lock: producer=%u (contended=%u, wait=%lldus, max=%lldus), "
+            "consumer=%u (contended=%u, wait=%lldus, max=%lldus), "
+            "dequeue-waits=%u (%lldus)\n",
+            prefix,
+            mProducerLockStats.count, mProducerLockStats.contended,
+            ns2us(mProducerLockStats.waitTime), ns2us(mProducerLockStats.maxWaitTime),
+            mConsumerLockStats.count, mConsumerLockStats.contended,
+            ns2us(mConsumerLockStats.waitTime), ns2us(mConsumerLockStats.maxWaitTime),
+            mDequeueWaitCount, ns2us(mDequeueWaitTime));
+
     struct {
         const char * operator()(int state) const {
             switch (state) {
@@ -835,6 +990,83 @@ void BufferQueue::dump(String8& result, const char* prefix) const {
     }
 }
 
+BufferQueue::StatsAutolock::StatsAutolock(Mutex& mutex, LockStats& stats) :
+    mMutex(mutex)
+{
+    if (mMutex.tryLock() != NO_ERROR) {
+        const nsecs_t start = systemTime();
+        mMutex.lock();
+        const nsecs_t waitTime = systemTime() - start;
+        stats.contended++;
+        stats.waitTime += waitTime;
+        if (waitTime > stats.maxWaitTime) {
+            stats.maxWaitTime = waitTime;
+        }
+    }
+    stats.count++;
+}
+
+void BufferQueue::waitForDequeueConditionLocked() {
+    const nsecs_t start = systemTime();
+    mDequeueWaiters++;
+    mDequeueCondition.wait(mMutex);
+    mDequeueWaiters--;
+    mDequeueWaitCount++;
+    mDequeueWaitTime += systemTime() - start;
+}
+
+void BufferQueue::broadcastDequeueConditionLocked() {
+    // waking up the condition is a system call, don't make it while
+    // holding the lock if nobody is waiting
+    if (mDequeueWaiters > 0) {
+        mDequeueCondition.broadcast();
+    }
+}
+
+sp<GraphicBuffer> BufferQueue::addFreeBufferLocked(
+        const sp<GraphicBuffer>& buffer, const sp<Fence>& fence) {
+    sp<GraphicBuffer> evicted;
+    if (mFreeBuffers.size() >= MAX_FREE_BUFFERS) {
+        evicted = mFreeBuffers[0].mGraphicBuffer;
+        mFreeBuffers.removeAt(0);
+    }
+    FreeBuffer freeBuffer;
+    freeBuffer.mGraphicBuffer = buffer;
+    freeBuffer.mFence = fence;
+    freeBuffer.mTime = systemTime();
+    mFreeBuffers.add(freeBuffer);
+    return evicted;
+}
+
+sp<GraphicBuffer> BufferQueue::takeFreeBufferLocked(uint32_t w, uint32_t h,
+        uint32_t format, uint32_t usage, sp<Fence>* outFence) {
+    // look for the most recent match, the oldest ones expire first
+    for (size_t i = mFreeBuffers.size(); i > 0; i--) {
+        const FreeBuffer& freeBuffer(mFreeBuffers[i - 1]);
+        const sp<GraphicBuffer>& buffer(freeBuffer.mGraphicBuffer);
+        if (uint32_t(buffer->width) == w &&
+                uint32_t(buffer->height) == h &&
+                uint32_t(buffer->format) == format &&
+                (uint32_t(buffer->usage) & usage) == usage) {
+            sp<GraphicBuffer> result(buffer);
+            *outFence = freeBuffer.mFence;
+            mFreeBuffers.removeAt(i - 1);
+            return result;
+        }
+    }
+    return NULL;
+}
+
+void BufferQueue::expireFreeBuffersLocked(Vector<sp<GraphicBuffer> >* expired) {
+    // a geometry change, such as a rotation, completes well within this
+    const nsecs_t maxAge = ms2ns(1000);
+    const nsecs_t now = systemTime();
+    while (!mFreeBuffers.isEmpty() && now - mFreeBuffers[0].mTime > maxAge) {
+        expired->add(mFreeBuffers[0].mGraphicBuffer);
+        mFreeBuffers.removeAt(0);
+    }
+}
+
 void BufferQueue::freeBufferLocked(int slot) {
     ST_LOGV("freeBufferLocked: slot=%d", slot);
     mSlots[slot].mGraphicBuffer = 0;
@@ -855,6 +1087,7 @@ void BufferQueue::freeBufferLocked(int slot) {
 
 void BufferQueue::freeAllBuffersLocked() {
     mBufferHasBeenQueued = false;
+    mFreeBuffers.clear();
     for (int i = 0; i < NUM_BUFFER_SLOTS; i++) {
         freeBufferLocked(i);
     }
@@ -862,7 +1095,7 @@ void BufferQueue::freeAllBuffersLocked() {
 
 status_t BufferQueue::acquireBuffer(BufferItem *buffer, nsecs_t expectedPresent) {
     ATRACE_CALL();
-    Mutex::Autolock _l(mMutex);
+    StatsAutolock _l(mMutex, mConsumerLockStats);
 
     // Check that the consumer doesn't currently have the maximum number of
     // buffers acquired.  We allow the max buffer count to be exceeded by one
@@ -944,6 +1177,8 @@ status_t BufferQueue::acquireBuffer(BufferItem *buffer, nsecs_t expectedPresent)
                 // front buffer is still in mSlots, so mark the slot as free
                 mSlots[front->mBuf].mBufferState = BufferSlot::FREE;
             }
+            mergeSurfaceDamage(mQueue.editItemAt(1).mSurfaceDamage,
+                    front->mSurfaceDamage);
             mQueue.erase(front);
             front = mQueue.begin();
         }
@@ -986,7 +1221,7 @@ status_t BufferQueue::acquireBuffer(BufferItem *buffer, nsecs_t expectedPresent)
     }
 
     mQueue.erase(front);
-    mDequeueCondition.broadcast();
+    broadcastDequeueConditionLocked();
 
     ATRACE_INT(mConsumerName.string(), mQueue.size());
 
@@ -1003,7 +1238,7 @@ status_t BufferQueue::releaseBuffer(
         return BAD_VALUE;
     }
 
-    Mutex::Autolock _l(mMutex);
+    StatsAutolock _l(mMutex, mConsumerLockStats);
 
     // If the frame number has changed because buffer has been reallocated,
     // we can ignore this releaseBuffer for the old buffer.
@@ -1040,7 +1275,7 @@ status_t BufferQueue::releaseBuffer(
         return -EINVAL;
     }
 
-    mDequeueCondition.broadcast();
+    broadcastDequeueConditionLocked();
     return NO_ERROR;
 }
 
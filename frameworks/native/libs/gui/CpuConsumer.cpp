@@ -34,7 +34,8 @@ CpuConsumer::CpuConsumer(const sp<IGraphicBufferConsumer>& bq,
         uint32_t maxLockedBuffers, bool controlledByApp) :
     ConsumerBase(bq, controlledByApp),
     mMaxLockedBuffers(maxLockedBuffers),
-    mCurrentLockedBuffers(0)
+    mCurrentLockedBuffers(0),
+    mPersistentMapping(false)
 {
     // Create tracking entries for locked buffers
     mAcquiredBuffers.insertAt(0, maxLockedBuffers);
@@ -68,9 +69,47 @@ status_t CpuConsumer::setDefaultBufferFormat(uint32_t defaultFormat)
 }
 
 status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
+    if (!nativeBuffer) return BAD_VALUE;
+
+    Mutex::Autolock _l(mMutex);
+    return lockNextBufferLocked(nativeBuffer);
+}
+
+ssize_t CpuConsumer::lockNextBuffers(LockedBuffer *nativeBuffers,
+        size_t maxBuffers) {
+    if (!nativeBuffers) return BAD_VALUE;
+
+    Mutex::Autolock _l(mMutex);
+    size_t numLocked = 0;
+    while (numLocked < maxBuffers &&
+            mCurrentLockedBuffers < mMaxLockedBuffers) {
+        status_t err = lockNextBufferLocked(&nativeBuffers[numLocked]);
+        if (err == BAD_VALUE) {
+            // no more buffers in the queue
+            break;
+        } else if (err != OK) {
+            // the buffers locked so far are still valid, the error is
+            // reported again by the next call
+            return numLocked > 0 ? ssize_t(numLocked) : ssize_t(err);
+        }
+        numLocked++;
+    }
+    return numLocked;
+}
+
+void CpuConsumer::setPersistentMapping(bool enabled) {
+    Mutex::Autolock _l(mMutex);
+    mPersistentMapping = enabled;
+    if (!enabled) {
+        for (int i = 0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
+            unmapSlotLocked(i);
+        }
+    }
+}
+
+status_t CpuConsumer::lockNextBufferLocked(LockedBuffer *nativeBuffer) {
     status_t err;
 
-    if (!nativeBuffer) return BAD_VALUE;
     if (mCurrentLockedBuffers == mMaxLockedBuffers) {
         CC_LOGW("Max buffers have been locked (%d), cannot lock anymore.",
                 mMaxLockedBuffers);
@@ -79,8 +118,6 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
 
     BufferQueue::BufferItem b;
 
-    Mutex::Autolock _l(mMutex);
-
     err = acquireBufferLocked(&b, 0);
     if (err != OK) {
         if (err == BufferQueue::NO_BUFFER_AVAILABLE) {
@@ -102,32 +139,51 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
         }
     }
 
+    const sp<GraphicBuffer>& graphicBuffer(mSlots[buf].mGraphicBuffer);
+    SlotMapping &mapping = mSlotMappings[buf];
     void *bufferPointer = NULL;
     android_ycbcr ycbcr = android_ycbcr();
 
-    if (mSlots[buf].mGraphicBuffer->getPixelFormat() ==
-            HAL_PIXEL_FORMAT_YCbCr_420_888) {
-        err = mSlots[buf].mGraphicBuffer->lockYCbCr(
-            GraphicBuffer::USAGE_SW_READ_OFTEN,
-            b.mCrop,
-            &ycbcr);
-
-        if (err != OK) {
-            CC_LOGE("Unable to lock YCbCr buffer for CPU reading: %s (%d)",
-                    strerror(-err), err);
-            return err;
-        }
-        bufferPointer = ycbcr.y;
+    if (mPersistentMapping && mapping.mGraphicBuffer == graphicBuffer) {
+        bufferPointer = mapping.mBufferPointer;
+        ycbcr = mapping.mYCbCr;
     } else {
-        err = mSlots[buf].mGraphicBuffer->lock(
-            GraphicBuffer::USAGE_SW_READ_OFTEN,
-            b.mCrop,
-            &bufferPointer);
+        // A persistent mapping covers the whole buffer, since the crop may
+        // change from frame to frame.
+        const Rect rect = mPersistentMapping ?
+                graphicBuffer->getBounds() : b.mCrop;
+
+        if (graphicBuffer->getPixelFormat() ==
+                HAL_PIXEL_FORMAT_YCbCr_420_888) {
+            err = graphicBuffer->lockYCbCr(
+                GraphicBuffer::USAGE_SW_READ_OFTEN,
+                rect,
+                &ycbcr);
+
+            if (err != OK) {
+                CC_LOGE("Unable to lock YCbCr buffer for CPU reading: %s (%d)",
+                        strerror(-err), err);
+                return err;
+            }
+            bufferPointer = ycbcr.y;
+        } else {
+            err = graphicBuffer->lock(
+                GraphicBuffer::USAGE_SW_READ_OFTEN,
+                rect,
+                &bufferPointer);
+
+            if (err != OK) {
+                CC_LOGE("Unable to lock buffer for CPU reading: %s (%d)",
+                        strerror(-err), err);
+                return err;
+            }
+        }
 
-        if (err != OK) {
-            CC_LOGE("Unable to lock buffer for CPU reading: %s (%d)",
-                    strerror(-err), err);
-            return err;
+        if (mPersistentMapping) {
+            unmapSlotLocked(buf);
+            mapping.mGraphicBuffer = graphicBuffer;
+            mapping.mBufferPointer = bufferPointer;
+            mapping.mYCbCr = ycbcr;
         }
     }
 
@@ -143,16 +199,17 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
     AcquiredBuffer &ab = mAcquiredBuffers.editItemAt(lockedIdx);
     ab.mSlot = buf;
     ab.mBufferPointer = bufferPointer;
-    ab.mGraphicBuffer = mSlots[buf].mGraphicBuffer;
+    ab.mGraphicBuffer = graphicBuffer;
+    ab.mUnlockOnRelease = !mPersistentMapping;
 
     nativeBuffer->data   =
             reinterpret_cast<uint8_t*>(bufferPointer);
-    nativeBuffer->width  = mSlots[buf].mGraphicBuffer->getWidth();
-    nativeBuffer->height = mSlots[buf].mGraphicBuffer->getHeight();
-    nativeBuffer->format = mSlots[buf].mGraphicBuffer->getPixelFormat();
+    nativeBuffer->width  = graphicBuffer->getWidth();
+    nativeBuffer->height = graphicBuffer->getHeight();
+    nativeBuffer->format = graphicBuffer->getPixelFormat();
     nativeBuffer->stride = (ycbcr.y != NULL) ?
             ycbcr.ystride :
-            mSlots[buf].mGraphicBuffer->getStride();
+            graphicBuffer->getStride();
 
     nativeBuffer->crop        = b.mCrop;
     nativeBuffer->transform   = b.mTransform;
@@ -190,11 +247,13 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
 status_t CpuConsumer::releaseAcquiredBufferLocked(int lockedIdx) {
     status_t err;
 
-    err = mAcquiredBuffers[lockedIdx].mGraphicBuffer->unlock();
-    if (err != OK) {
-        CC_LOGE("%s: Unable to unlock graphic buffer %d", __FUNCTION__,
-                lockedIdx);
-        return err;
+    if (mAcquiredBuffers[lockedIdx].mUnlockOnRelease) {
+        err = mAcquiredBuffers[lockedIdx].mGraphicBuffer->unlock();
+        if (err != OK) {
+            CC_LOGE("%s: Unable to unlock graphic buffer %d", __FUNCTION__,
+                    lockedIdx);
+            return err;
+        }
     }
     int buf = mAcquiredBuffers[lockedIdx].mSlot;
 
@@ -212,12 +271,42 @@ status_t CpuConsumer::releaseAcquiredBufferLocked(int lockedIdx) {
     ab.mSlot = BufferQueue::INVALID_BUFFER_SLOT;
     ab.mBufferPointer = NULL;
     ab.mGraphicBuffer.clear();
+    ab.mUnlockOnRelease = false;
 
     mCurrentLockedBuffers--;
     return OK;
 }
 
+void CpuConsumer::unmapSlotLocked(int slotIndex) {
+    SlotMapping &mapping = mSlotMappings[slotIndex];
+    if (mapping.mGraphicBuffer == NULL) {
+        return;
+    }
+
+    // A buffer still held by the user stays mapped until it's released
+    bool acquired = false;
+    for (size_t i = 0; i < mMaxLockedBuffers; i++) {
+        AcquiredBuffer &ab = mAcquiredBuffers.editItemAt(i);
+        if (ab.mGraphicBuffer == mapping.mGraphicBuffer) {
+            ab.mUnlockOnRelease = true;
+            acquired = true;
+        }
+    }
+    if (!acquired) {
+        status_t err = mapping.mGraphicBuffer->unlock();
+        if (err != OK) {
+            CC_LOGE("%s: Unable to unlock graphic buffer of slot %d",
+                    __FUNCTION__, slotIndex);
+        }
+    }
+
+    mapping.mGraphicBuffer.clear();
+    mapping.mBufferPointer = NULL;
+    mapping.mYCbCr = android_ycbcr();
+}
+
 void CpuConsumer::freeBufferLocked(int slotIndex) {
+    unmapSlotLocked(slotIndex);
     ConsumerBase::freeBufferLocked(slotIndex);
 }
 
@@ -128,6 +128,9 @@ GLConsumer::GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t tex,
     mDefaultHeight(1),
     mFilteringEnabled(true),
     mTexName(tex),
+    mBoundImage(EGL_NO_IMAGE_KHR),
+    mUseSlotTextures(false),
+    mCurrentFenceWaited(false),
     mUseFenceSync(useFenceSync),
     mTexTarget(texTarget),
     mEglDisplay(EGL_NO_DISPLAY),
@@ -257,6 +260,7 @@ status_t GLConsumer::releaseTexImage() {
         mCurrentCrop.makeInvalid();
         mCurrentTransform = 0;
         mCurrentScalingMode = NATIVE_WINDOW_SCALING_MODE_FREEZE;
+        mCurrentSurfaceDamage.clear();
         mCurrentTimestamp = 0;
         mCurrentFence = Fence::NO_FENCE;
 
@@ -322,12 +326,7 @@ status_t GLConsumer::acquireBufferLocked(BufferQueue::BufferItem *item,
     }
 
     if (destroyEglImage) {
-        if (!eglDestroyImageKHR(mEglDisplay, mEglSlots[slot].mEglImage)) {
-            ST_LOGW("acquireBufferLocked: eglDestroyImageKHR failed for slot=%d",
-                  slot);
-            // keep going
-        }
-        mEglSlots[slot].mEglImage = EGL_NO_IMAGE_KHR;
+        destroyEglImageLocked(slot);
     }
 
     return NO_ERROR;
@@ -419,8 +418,10 @@ status_t GLConsumer::updateAndReleaseLocked(const BufferQueue::BufferItem& item)
     mCurrentCrop = item.mCrop;
     mCurrentTransform = item.mTransform;
     mCurrentScalingMode = item.mScalingMode;
+    mCurrentSurfaceDamage = item.mSurfaceDamage;
     mCurrentTimestamp = item.mTimestamp;
     mCurrentFence = item.mFence;
+    mCurrentFenceWaited = false;
     mCurrentFrameNumber = item.mFrameNumber;
 
     computeCurrentTransformMatrixLocked();
@@ -439,8 +440,8 @@ status_t GLConsumer::bindTextureImageLocked() {
         ST_LOGW("bindTextureImage: clearing GL error: %#04x", error);
     }
 
-    glBindTexture(mTexTarget, mTexName);
     if (mCurrentTexture == BufferQueue::INVALID_BUFFER_SLOT) {
+        glBindTexture(mTexTarget, mTexName);
         if (mCurrentTextureBuf == NULL) {
             ST_LOGE("bindTextureImage: no currently-bound texture");
             return NO_INIT;
@@ -450,19 +451,45 @@ status_t GLConsumer::bindTextureImageLocked() {
             return err;
         }
     } else {
-        EGLImageKHR image = mEglSlots[mCurrentTexture].mEglImage;
-
-        glEGLImageTargetTexture2DOES(mTexTarget, (GLeglImageOES)image);
+        EglSlot& slot(mEglSlots[mCurrentTexture]);
+        EGLImageKHR image = slot.mEglImage;
+
+        uint32_t texName = mTexName;
+        EGLImageKHR* boundImage = &mBoundImage;
+        if (mUseSlotTextures) {
+            if (slot.mTexName == 0) {
+                glGenTextures(1, &slot.mTexName);
+                slot.mBoundImage = EGL_NO_IMAGE_KHR;
+            }
+            texName = slot.mTexName;
+            boundImage = &slot.mBoundImage;
+        }
 
-        while ((error = glGetError()) != GL_NO_ERROR) {
-            ST_LOGE("bindTextureImage: error binding external texture image %p"
-                    ": %#04x", image, error);
-            return UNKNOWN_ERROR;
+        // Without native fences, attaching the image is what synchronizes
+        // with the producer, so it cannot be skipped.
+        glBindTexture(mTexTarget, texName);
+        if (*boundImage != image ||
+                !SyncFeatures::getInstance().useNativeFenceSync()) {
+            glEGLImageTargetTexture2DOES(mTexTarget, (GLeglImageOES)image);
+
+            while ((error = glGetError()) != GL_NO_ERROR) {
+                ST_LOGE("bindTextureImage: error binding external texture image %p"
+                        ": %#04x", image, error);
+                *boundImage = EGL_NO_IMAGE_KHR;
+                return UNKNOWN_ERROR;
+            }
+            *boundImage = image;
         }
     }
 
-    // Wait for the new buffer to be ready.
-    return doGLFenceWaitLocked();
+    // Wait for the new buffer to be ready.  The wait only needs to be in
+    // the command stream once per buffer.
+    if (mCurrentFenceWaited) {
+        return NO_ERROR;
+    }
+    status_t err = doGLFenceWaitLocked();
+    mCurrentFenceWaited = (err == NO_ERROR);
+    return err;
 
 }
 
@@ -544,6 +571,14 @@ status_t GLConsumer::detachFromContext() {
         }
 
         glDeleteTextures(1, &mTexName);
+        for (int i = 0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
+            if (mEglSlots[i].mTexName != 0) {
+                glDeleteTextures(1, &mEglSlots[i].mTexName);
+            }
+        }
+    }
+    for (int i = 0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
+        mEglSlots[i].mTexName = 0;
     }
 
     // Because we're giving up the EGLDisplay we need to free all the EGLImages
@@ -551,12 +586,10 @@ status_t GLConsumer::detachFromContext() {
     // GLConsumer gets attached to a new OpenGL ES context (and thus gets a
     // new EGLDisplay).
     for (int i =0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
-        EGLImageKHR img = mEglSlots[i].mEglImage;
-        if (img != EGL_NO_IMAGE_KHR) {
-            eglDestroyImageKHR(mEglDisplay, img);
-            mEglSlots[i].mEglImage = EGL_NO_IMAGE_KHR;
-        }
+        destroyEglImageLocked(i);
     }
+    mBoundImage = EGL_NO_IMAGE_KHR;
+    mCurrentFenceWaited = false;
 
     mEglDisplay = EGL_NO_DISPLAY;
     mEglContext = EGL_NO_CONTEXT;
@@ -611,6 +644,8 @@ status_t GLConsumer::attachToContext(uint32_t tex) {
     mEglDisplay = dpy;
     mEglContext = ctx;
     mTexName = tex;
+    mBoundImage = EGL_NO_IMAGE_KHR;
+    mCurrentFenceWaited = false;
     mAttached = true;
 
     return OK;
@@ -629,6 +664,7 @@ status_t GLConsumer::bindUnslottedBufferLocked(EGLDisplay dpy) {
 
     // Attach the current buffer to the GL texture.
     glEGLImageTargetTexture2DOES(mTexTarget, (GLeglImageOES)image);
+    mBoundImage = EGL_NO_IMAGE_KHR;
 
     GLint error;
     status_t err = OK;
@@ -904,6 +940,31 @@ EGLImageKHR GLConsumer::createImage(EGLDisplay dpy,
     return image;
 }
 
+void GLConsumer::setUseSlotTextures(bool enabled) {
+    Mutex::Autolock lock(mMutex);
+    mUseSlotTextures = enabled;
+}
+
+uint32_t GLConsumer::getCurrentTextureName() const {
+    Mutex::Autolock lock(mMutex);
+    if (mUseSlotTextures && mCurrentTexture != BufferQueue::INVALID_BUFFER_SLOT &&
+            mEglSlots[mCurrentTexture].mTexName != 0) {
+        return mEglSlots[mCurrentTexture].mTexName;
+    }
+    return mTexName;
+}
+
+void GLConsumer::takeSlotTextureNames(Vector<uint32_t>* names) {
+    Mutex::Autolock lock(mMutex);
+    for (int i = 0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
+        if (mEglSlots[i].mTexName != 0) {
+            names->add(mEglSlots[i].mTexName);
+            mEglSlots[i].mTexName = 0;
+            mEglSlots[i].mBoundImage = EGL_NO_IMAGE_KHR;
+        }
+    }
+}
+
 sp<GraphicBuffer> GLConsumer::getCurrentBuffer() const {
     Mutex::Autolock lock(mMutex);
     return mCurrentTextureBuf;
@@ -955,6 +1016,11 @@ uint32_t GLConsumer::getCurrentScalingMode() const {
     return mCurrentScalingMode;
 }
 
+Region GLConsumer::getCurrentSurfaceDamage() const {
+    Mutex::Autolock lock(mMutex);
+    return mCurrentSurfaceDamage;
+}
+
 sp<Fence> GLConsumer::getCurrentFence() const {
     Mutex::Autolock lock(mMutex);
     return mCurrentFence;
@@ -1030,15 +1096,29 @@ void GLConsumer::freeBufferLocked(int slotIndex) {
     if (slotIndex == mCurrentTexture) {
         mCurrentTexture = BufferQueue::INVALID_BUFFER_SLOT;
     }
-    EGLImageKHR img = mEglSlots[slotIndex].mEglImage;
-    if (img != EGL_NO_IMAGE_KHR) {
-        ST_LOGV("destroying EGLImage dpy=%p img=%p", mEglDisplay, img);
-        eglDestroyImageKHR(mEglDisplay, img);
-    }
-    mEglSlots[slotIndex].mEglImage = EGL_NO_IMAGE_KHR;
+    destroyEglImageLocked(slotIndex);
     ConsumerBase::freeBufferLocked(slotIndex);
 }
 
+void GLConsumer::destroyEglImageLocked(int slot) {
+    EGLImageKHR img = mEglSlots[slot].mEglImage;
+    if (img == EGL_NO_IMAGE_KHR) {
+        return;
+    }
+    ST_LOGV("destroying EGLImage dpy=%p img=%p", mEglDisplay, img);
+    if (!eglDestroyImageKHR(mEglDisplay, img)) {
+        ST_LOGW("destroyEglImageLocked: eglDestroyImageKHR failed for slot=%d",
+              slot);
+    }
+    mEglSlots[slot].mEglImage = EGL_NO_IMAGE_KHR;
+
+    // A new EGLImage may get the same handle, it must be attached again.
+    if (mBoundImage == img) {
+        mBoundImage = EGL_NO_IMAGE_KHR;
+    }
+    mEglSlots[slot].mBoundImage = EGL_NO_IMAGE_KHR;
+}
+
 void GLConsumer::abandonLocked() {
     ST_LOGV("abandonLocked");
     mCurrentTextureBuf.clear();
@@ -76,6 +76,7 @@ size_t IGraphicBufferConsumer::BufferItem::getFlattenedSize() const {
         c += mFence->getFlattenedSize();
         FlattenableUtils::align<4>(c);
     }
+    c += sizeof(uint32_t) + mSurfaceDamage.getFlattenedSize();
     return sizeof(int32_t) + c + getPodSize();
 }
 
@@ -134,6 +135,15 @@ status_t IGraphicBufferConsumer::BufferItem::flatten(
     FlattenableUtils::write(buffer, size, mAcquireCalled);
     FlattenableUtils::write(buffer, size, mTransformToDisplayInverse);
 
+    const uint32_t damageSize = mSurfaceDamage.getFlattenedSize();
+    if (size < sizeof(damageSize) + damageSize) {
+        return NO_MEMORY;
+    }
+    FlattenableUtils::write(buffer, size, damageSize);
+    status_t err = mSurfaceDamage.flatten(buffer, size);
+    if (err) return err;
+    FlattenableUtils::advance(buffer, size, damageSize);
+
     return NO_ERROR;
 }
 
@@ -176,6 +186,18 @@ status_t IGraphicBufferConsumer::BufferItem::unflatten(
     FlattenableUtils::read(buffer, size, mAcquireCalled);
     FlattenableUtils::read(buffer, size, mTransformToDisplayInverse);
 
+    uint32_t damageSize = 0;
+    if (size < sizeof(damageSize)) {
+        return NO_MEMORY;
+    }
+    FlattenableUtils::read(buffer, size, damageSize);
+    if (size < damageSize) {
+        return NO_MEMORY;
+    }
+    status_t err = mSurfaceDamage.unflatten(buffer, damageSize);
+    if (err) return err;
+    FlattenableUtils::advance(buffer, size, damageSize);
+
     return NO_ERROR;
 }
 
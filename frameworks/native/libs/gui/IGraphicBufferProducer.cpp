@@ -39,6 +39,7 @@ enum {
     QUERY,
     CONNECT,
     DISCONNECT,
+    ALLOCATE_BUFFERS,
 };
 
 class BpGraphicBufferProducer : public BpInterface<IGraphicBufferProducer>
@@ -165,6 +166,20 @@ public:
         result = reply.readInt32();
         return result;
     }
+
+    virtual void allocateBuffers(bool async, uint32_t w, uint32_t h,
+            uint32_t format, uint32_t usage, int count) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeInt32((int32_t)async);
+        data.writeInt32(w);
+        data.writeInt32(h);
+        data.writeInt32(format);
+        data.writeInt32(usage);
+        data.writeInt32(count);
+        remote()->transact(ALLOCATE_BUFFERS, data, &reply,
+                IBinder::FLAG_ONEWAY);
+    }
 };
 
 IMPLEMENT_META_INTERFACE(GraphicBufferProducer, "android.gui.IGraphicBufferProducer");
@@ -259,6 +274,17 @@ status_t BnGraphicBufferProducer::onTransact(
             reply->writeInt32(res);
             return NO_ERROR;
         } break;
+        case ALLOCATE_BUFFERS: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            bool async      = data.readInt32();
+            uint32_t w      = data.readInt32();
+            uint32_t h      = data.readInt32();
+            uint32_t format = data.readInt32();
+            uint32_t usage  = data.readInt32();
+            int count       = data.readInt32();
+            allocateBuffers(async, w, h, format, usage, count);
+            return NO_ERROR;
+        } break;
     }
     return BBinder::onTransact(code, data, reply, flags);
 }
@@ -276,6 +302,8 @@ size_t IGraphicBufferProducer::QueueBufferInput::getFlattenedSize() const {
          + sizeof(scalingMode)
          + sizeof(transform)
          + sizeof(async)
+         + sizeof(uint32_t)
+         + surfaceDamage.getFlattenedSize()
          + fence->getFlattenedSize();
 }
 
@@ -295,6 +323,14 @@ status_t IGraphicBufferProducer::QueueBufferInput::flatten(
     FlattenableUtils::write(buffer, size, scalingMode);
     FlattenableUtils::write(buffer, size, transform);
     FlattenableUtils::write(buffer, size, async);
+
+    // the flattened region doesn't record its own size
+    const uint32_t damageSize = surfaceDamage.getFlattenedSize();
+    FlattenableUtils::write(buffer, size, damageSize);
+    status_t err = surfaceDamage.flatten(buffer, size);
+    if (err) return err;
+    FlattenableUtils::advance(buffer, size, damageSize);
+
     return fence->flatten(buffer, size, fds, count);
 }
 
@@ -307,7 +343,8 @@ status_t IGraphicBufferProducer::QueueBufferInput::unflatten(
             + sizeof(crop)
             + sizeof(scalingMode)
             + sizeof(transform)
-            + sizeof(async);
+            + sizeof(async)
+            + sizeof(uint32_t);
 
     if (size < minNeeded) {
         return NO_MEMORY;
@@ -320,6 +357,15 @@ status_t IGraphicBufferProducer::QueueBufferInput::unflatten(
     FlattenableUtils::read(buffer, size, transform);
     FlattenableUtils::read(buffer, size, async);
 
+    uint32_t damageSize = 0;
+    FlattenableUtils::read(buffer, size, damageSize);
+    if (size < damageSize) {
+        return NO_MEMORY;
+    }
+    status_t err = surfaceDamage.unflatten(buffer, damageSize);
+    if (err) return err;
+    FlattenableUtils::advance(buffer, size, damageSize);
+
     fence = new Fence();
     return fence->unflatten(buffer, size, fds, count);
 }
@@ -86,6 +86,21 @@ sp<IGraphicBufferProducer> Surface::getIGraphicBufferProducer() const {
     return mGraphicBufferProducer;
 }
 
+void Surface::allocateBuffers(uint32_t w, uint32_t h, int count) {
+    ATRACE_CALL();
+    ALOGV("Surface::allocateBuffers");
+    bool async;
+    uint32_t format;
+    uint32_t usage;
+    {
+        Mutex::Autolock lock(mMutex);
+        async = mSwapIntervalZero;
+        format = mReqFormat;
+        usage = mReqUsage;
+    }
+    mGraphicBufferProducer->allocateBuffers(async, w, h, format, usage, count);
+}
+
 int Surface::hook_setSwapInterval(ANativeWindow* window, int interval) {
     Surface* c = getSelf(window);
     return c->setSwapInterval(interval);
@@ -284,7 +299,9 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
     sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
     IGraphicBufferProducer::QueueBufferOutput output;
     IGraphicBufferProducer::QueueBufferInput input(timestamp, isAutoTimestamp,
-            crop, mScalingMode, mTransform, mSwapIntervalZero, fence);
+            crop, mScalingMode, mTransform, mSwapIntervalZero, fence,
+            mSurfaceDamage);
+    mSurfaceDamage.clear();
     status_t err = mGraphicBufferProducer->queueBuffer(i, input, &output);
     if (err != OK)  {
         ALOGE("queueBuffer: error queuing buffer to SurfaceTexture, %d", err);
@@ -555,6 +572,16 @@ int Surface::setCrop(Rect const* rect)
     return NO_ERROR;
 }
 
+int Surface::setSurfaceDamage(const Region& damage)
+{
+    ATRACE_CALL();
+    ALOGV("Surface::setSurfaceDamage");
+
+    Mutex::Autolock lock(mMutex);
+    mSurfaceDamage = damage;
+    return NO_ERROR;
+}
+
 int Surface::setBufferCount(int bufferCount)
 {
     ATRACE_CALL();
@@ -794,6 +821,8 @@ status_t Surface::lock(
         }
 
         mDirtyRegion.orSelf(newDirtyRegion);
+        // the rest of the buffer holds the content of the previous frame
+        setSurfaceDamage(newDirtyRegion);
         if (inOutDirtyBounds) {
             *inOutDirtyBounds = newDirtyRegion.getBounds();
         }
@@ -510,6 +510,13 @@ status_t SurfaceComposerClient::destroySurface(const sp<IBinder>& sid) {
     return err;
 }
 
+status_t SurfaceComposerClient::setCursorPosition(const sp<IBinder>& id,
+        float x, float y) {
+    if (mStatus != NO_ERROR)
+        return mStatus;
+    return mClient->setCursorPosition(id, x, y);
+}
+
 inline Composer& SurfaceComposerClient::getComposer() {
     return mComposer;
 }
@@ -624,9 +631,18 @@ status_t ScreenshotClient::capture(
         const sp<IGraphicBufferProducer>& producer,
         uint32_t reqWidth, uint32_t reqHeight,
         uint32_t minLayerZ, uint32_t maxLayerZ) {
+    return ScreenshotClient::capture(display, producer, Rect(),
+            reqWidth, reqHeight, minLayerZ, maxLayerZ);
+}
+
+status_t ScreenshotClient::capture(
+        const sp<IBinder>& display,
+        const sp<IGraphicBufferProducer>& producer,
+        Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
+        uint32_t minLayerZ, uint32_t maxLayerZ) {
     sp<ISurfaceComposer> s(ComposerService::getComposerService());
     if (s == NULL) return NO_INIT;
-    return s->captureScreen(display, producer,
+    return s->captureScreen(display, producer, sourceCrop,
             reqWidth, reqHeight, minLayerZ, maxLayerZ);
 }
 
@@ -651,6 +667,13 @@ sp<CpuConsumer> ScreenshotClient::getCpuConsumer() const {
 status_t ScreenshotClient::update(const sp<IBinder>& display,
         uint32_t reqWidth, uint32_t reqHeight,
         uint32_t minLayerZ, uint32_t maxLayerZ) {
+    return ScreenshotClient::update(display, Rect(),
+            reqWidth, reqHeight, minLayerZ, maxLayerZ);
+}
+
+status_t ScreenshotClient::update(const sp<IBinder>& display, Rect sourceCrop,
+        uint32_t reqWidth, uint32_t reqHeight,
+        uint32_t minLayerZ, uint32_t maxLayerZ) {
     sp<ISurfaceComposer> s(ComposerService::getComposerService());
     if (s == NULL) return NO_INIT;
     sp<CpuConsumer> cpuConsumer = getCpuConsumer();
@@ -661,7 +684,7 @@ status_t ScreenshotClient::update(const sp<IBinder>& display,
         mHaveBuffer = false;
     }
 
-    status_t err = s->captureScreen(display, mBufferQueue,
+    status_t err = s->captureScreen(display, mBufferQueue, sourceCrop,
             reqWidth, reqHeight, minLayerZ, maxLayerZ);
 
     if (err == NO_ERROR) {
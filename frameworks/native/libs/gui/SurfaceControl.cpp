@@ -156,6 +156,12 @@ status_t SurfaceControl::setCrop(const Rect& crop) {
     const sp<SurfaceComposerClient>& client(mClient);
     return client->setCrop(mHandle, crop);
 }
+status_t SurfaceControl::setCursorPosition(float x, float y) {
+    status_t err = validate();
+    if (err < 0) return err;
+    const sp<SurfaceComposerClient>& client(mClient);
+    return client->setCursorPosition(mHandle, x, y);
+}
 
 status_t SurfaceControl::validate() const
 {
@@ -114,4 +114,102 @@ TEST_F(BufferQueueTest, SetMaxAcquiredBufferCountWithLegalValues_Succeeds) {
             BufferQueue::MAX_MAX_ACQUIRED_BUFFERS));
 }
 
+TEST_F(BufferQueueTest, QueueBuffer_ReplacingDroppableBuffer_MergesDamage) {
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mBQ->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mBQ->connect(NULL, NATIVE_WINDOW_API_CPU, false, &qbo);
+    mBQ->setBufferCount(4);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    const Rect damages[] = { Rect(0, 0, 1, 1), Rect(2, 2, 4, 4), Rect() };
+    BufferQueue::BufferItem item;
+
+    for (int i = 0; i < 3; i++) {
+        IGraphicBufferProducer::QueueBufferInput qbi(0, false, Rect(0, 0, 4, 4),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, true, Fence::NO_FENCE,
+                Region(damages[i]));
+        status_t result = mBQ->dequeueBuffer(&slot, &fence, true, 4, 4, 0,
+                GRALLOC_USAGE_SW_READ_OFTEN);
+        ASSERT_TRUE(result == OK ||
+                result == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION);
+        ASSERT_EQ(OK, mBQ->requestBuffer(slot, &buf));
+        ASSERT_EQ(OK, mBQ->queueBuffer(slot, qbi, &qbo));
+
+        if (i == 1) {
+            // The second buffer replaced the first one, it carries both damages
+            ASSERT_EQ(OK, mBQ->acquireBuffer(&item, 0));
+            Region expected(damages[0]);
+            expected.orSelf(damages[1]);
+            ASSERT_TRUE(item.mSurfaceDamage.subtract(expected).isEmpty());
+            ASSERT_TRUE(expected.subtract(item.mSurfaceDamage).isEmpty());
+            ASSERT_EQ(OK, mBQ->releaseBuffer(item.mBuf, item.mFrameNumber,
+                    EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+        }
+    }
+
+    // The third buffer is damaged entirely
+    ASSERT_EQ(OK, mBQ->acquireBuffer(&item, 0));
+    ASSERT_TRUE(item.mSurfaceDamage.isEmpty());
+}
+
+TEST_F(BufferQueueTest, DequeueBuffer_BackToPreviousGeometry_ReusesBuffer) {
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mBQ->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mBQ->connect(NULL, NATIVE_WINDOW_API_CPU, false, &qbo);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> first;
+    sp<GraphicBuffer> buf;
+
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+            mBQ->dequeueBuffer(&slot, &fence, false, 1, 1, 0,
+                GRALLOC_USAGE_SW_READ_OFTEN));
+    ASSERT_EQ(OK, mBQ->requestBuffer(slot, &first));
+    mBQ->cancelBuffer(slot, Fence::NO_FENCE);
+
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+            mBQ->dequeueBuffer(&slot, &fence, false, 2, 2, 0,
+                GRALLOC_USAGE_SW_READ_OFTEN));
+    ASSERT_EQ(OK, mBQ->requestBuffer(slot, &buf));
+    ASSERT_NE(first.get(), buf.get());
+    mBQ->cancelBuffer(slot, Fence::NO_FENCE);
+
+    // Going back to 1x1 hands out the first buffer again
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+            mBQ->dequeueBuffer(&slot, &fence, false, 1, 1, 0,
+                GRALLOC_USAGE_SW_READ_OFTEN));
+    ASSERT_EQ(OK, mBQ->requestBuffer(slot, &buf));
+    ASSERT_EQ(first.get(), buf.get());
+}
+
+TEST_F(BufferQueueTest, AllocateBuffers_DequeueUsesAllocatedBuffer) {
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mBQ->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mBQ->connect(NULL, NATIVE_WINDOW_API_CPU, false, &qbo);
+
+    mBQ->allocateBuffers(false, 3, 3, 0, GRALLOC_USAGE_SW_READ_OFTEN, 1);
+    String8 dump;
+    mBQ->dump(dump, "");
+    ASSERT_TRUE(strstr(dump.string(), "free buffers") != NULL);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+            mBQ->dequeueBuffer(&slot, &fence, false, 3, 3, 0,
+                GRALLOC_USAGE_SW_READ_OFTEN));
+    ASSERT_EQ(OK, mBQ->requestBuffer(slot, &buf));
+    ASSERT_EQ(3U, buf->getWidth());
+
+    dump.clear();
+    mBQ->dump(dump, "");
+    ASSERT_TRUE(strstr(dump.string(), "free buffers") == NULL);
+}
+
 } // namespace android
@@ -691,6 +691,99 @@ TEST_P(CpuConsumerTest, FromCpuLockMax) {
 
 }
 
+TEST_P(CpuConsumerTest, FromCpuLockNextBuffers) {
+    CpuConsumerTestParams params = GetParam();
+
+    // Set up
+
+    ASSERT_NO_FATAL_FAILURE(configureANW(mANW, params, params.maxLockedBuffers + 1));
+
+    // Produce
+
+    uint32_t stride;
+    for (int i = 0; i < params.maxLockedBuffers + 1; i++) {
+        ALOGV("Producing frame %d", i);
+        ASSERT_NO_FATAL_FAILURE(produceOneFrame(mANW, params, i + 1,
+                        &stride));
+    }
+
+    // Consume
+
+    const int numBuffers = params.maxLockedBuffers + 1;
+    CpuConsumer::LockedBuffer *b = new CpuConsumer::LockedBuffer[numBuffers];
+    ssize_t numLocked = mCC->lockNextBuffers(b, numBuffers);
+    ASSERT_EQ(params.maxLockedBuffers, numLocked) << "Not limited to max locks";
+
+    for (int i = 0; i < numLocked; i++) {
+        ASSERT_TRUE(b[i].data != NULL);
+        EXPECT_EQ(params.width,  b[i].width);
+        EXPECT_EQ(params.height, b[i].height);
+        EXPECT_EQ(params.format, b[i].format);
+        EXPECT_EQ(stride, b[i].stride);
+        EXPECT_EQ(i + 1, b[i].timestamp);
+
+        checkAnyBuffer(b[i], GetParam().format);
+    }
+
+    for (int i = 0; i < numLocked; i++) {
+        status_t err = mCC->unlockBuffer(b[i]);
+        ASSERT_NO_ERROR(err, "Could not unlock buffer: ");
+    }
+
+    ALOGV("Locking the remaining frame");
+    numLocked = mCC->lockNextBuffers(b, numBuffers);
+    ASSERT_EQ(1, numLocked);
+    EXPECT_EQ(numBuffers, b[0].timestamp);
+    checkAnyBuffer(b[0], GetParam().format);
+    mCC->unlockBuffer(b[0]);
+
+    ALOGV("Locking with an empty queue");
+    numLocked = mCC->lockNextBuffers(b, numBuffers);
+    ASSERT_EQ(0, numLocked) << "Not out of buffers somehow";
+
+    delete[] b;
+}
+
+TEST_P(CpuConsumerTest, FromCpuPersistentMapping) {
+    status_t err;
+    CpuConsumerTestParams params = GetParam();
+
+    // Set up
+
+    mCC->setPersistentMapping(true);
+    ASSERT_NO_FATAL_FAILURE(configureANW(mANW, params, 1));
+
+    // Produce and consume more frames than there are buffers, so that each
+    // buffer is locked from its cached mapping at least once
+
+    const int numFrames = 8;
+    for (int i = 0; i < numFrames; i++) {
+        ALOGV("Producing frame %d", i);
+        uint32_t stride;
+        ASSERT_NO_FATAL_FAILURE(produceOneFrame(mANW, params, i + 1,
+                        &stride));
+
+        ALOGV("Consuming frame %d", i);
+        CpuConsumer::LockedBuffer b;
+        err = mCC->lockNextBuffer(&b);
+        ASSERT_NO_ERROR(err, "getNextBuffer error: ");
+
+        ASSERT_TRUE(b.data != NULL);
+        EXPECT_EQ(params.width,  b.width);
+        EXPECT_EQ(params.height, b.height);
+        EXPECT_EQ(params.format, b.format);
+        EXPECT_EQ(stride, b.stride);
+        EXPECT_EQ(i + 1, b.timestamp);
+
+        checkAnyBuffer(b, GetParam().format);
+
+        err = mCC->unlockBuffer(b);
+        ASSERT_NO_ERROR(err, "Could not unlock buffer: ");
+    }
+
+    mCC->setPersistentMapping(false);
+}
+
 CpuConsumerTestParams y8TestSets[] = {
     { 512,   512, 1, HAL_PIXEL_FORMAT_Y8},
     { 512,   512, 3, HAL_PIXEL_FORMAT_Y8},
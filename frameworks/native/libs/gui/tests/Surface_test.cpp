@@ -92,7 +92,7 @@ TEST_F(SurfaceTest, ScreenshotsOfProtectedBuffersSucceed) {
     sp<CpuConsumer> consumer = new CpuConsumer(bq, 1);
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
     sp<IBinder> display(sf->getBuiltInDisplay(ISurfaceComposer::eDisplayIdMain));
-    ASSERT_EQ(NO_ERROR, sf->captureScreen(display, bq,
+    ASSERT_EQ(NO_ERROR, sf->captureScreen(display, bq, Rect(),
             64, 64, 0, 0x7fffffff));
 
     // Set the PROTECTED usage bit and verify that the screenshot fails.  Note
@@ -121,10 +121,25 @@ TEST_F(SurfaceTest, ScreenshotsOfProtectedBuffersSucceed) {
                 &buf));
         ASSERT_EQ(NO_ERROR, anw->queueBuffer(anw.get(), buf, -1));
     }
-    ASSERT_EQ(NO_ERROR, sf->captureScreen(display, bq,
+    ASSERT_EQ(NO_ERROR, sf->captureScreen(display, bq, Rect(),
             64, 64, 0, 0x7fffffff));
 }
 
+TEST_F(SurfaceTest, ScreenshotOfRegionHasCropSize) {
+    sp<BufferQueue> bq = new BufferQueue();
+    sp<CpuConsumer> consumer = new CpuConsumer(bq, 1);
+    sp<ISurfaceComposer> sf(ComposerService::getComposerService());
+    sp<IBinder> display(sf->getBuiltInDisplay(ISurfaceComposer::eDisplayIdMain));
+    ASSERT_EQ(NO_ERROR, sf->captureScreen(display, bq, Rect(16, 16, 80, 48),
+            0, 0, 0, 0x7fffffff));
+
+    CpuConsumer::LockedBuffer b;
+    ASSERT_EQ(NO_ERROR, consumer->lockNextBuffer(&b));
+    EXPECT_EQ(64U, b.width);
+    EXPECT_EQ(32U, b.height);
+    ASSERT_EQ(NO_ERROR, consumer->unlockBuffer(b));
+}
+
 TEST_F(SurfaceTest, ConcreteTypeIsSurface) {
     sp<ANativeWindow> anw(mSurface);
     int result = -123;
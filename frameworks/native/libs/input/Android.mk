@@ -23,6 +23,7 @@ commonSources := \
     Keyboard.cpp \
     KeyCharacterMap.cpp \
     KeyLayoutMap.cpp \
+    KeyMapCache.cpp \
     VirtualKeyMap.cpp
 
 deviceSources := \
@@ -23,13 +23,20 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <cutils/ashmem.h>
+#include <cutils/atomic.h>
+#include <cutils/atomic-inline.h>
 #include <cutils/log.h>
 #include <cutils/properties.h>
 #include <input/InputTransport.h>
+#include <input/VelocityTracker.h>
 
 
 namespace android {
@@ -54,6 +61,17 @@ static const nsecs_t RESAMPLE_MIN_DELTA = 2 * NANOS_PER_MS;
 // far into the future.  This time is further bounded by 50% of the last time delta.
 static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
 
+// Default time between the frame time and the time the frame is presented, used by
+// touch prediction until the consumer is told the actual offset.
+static const nsecs_t PREDICTION_DEFAULT_PRESENT_OFFSET = 16 * NANOS_PER_MS;
+
+// Default maximum time to predict forward from the last touch sample.
+static const nsecs_t PREDICTION_DEFAULT_MAX_PREDICTION = 16 * NANOS_PER_MS;
+
+// Minimum confidence of the fit of the recent touch samples to predict a pointer.
+// A pointer fitted with less confidence is resampled linearly instead.
+static const float PREDICTION_MIN_CONFIDENCE = 0.5f;
+
 template<typename T>
 inline static T min(const T& a, const T& b) {
     return a < b ? a : b;
@@ -74,6 +92,8 @@ bool InputMessage::isValid(size_t actualSize) const {
             return body.motion.pointerCount > 0
                     && body.motion.pointerCount <= MAX_POINTERS;
         case TYPE_FINISHED:
+        case TYPE_RING:
+        case TYPE_DOORBELL:
             return true;
         }
     }
@@ -88,15 +108,43 @@ size_t InputMessage::size() const {
         return sizeof(Header) + body.motion.size();
     case TYPE_FINISHED:
         return sizeof(Header) + body.finished.size();
+    case TYPE_RING:
+        return sizeof(Header) + body.ring.size();
     }
     return sizeof(Header);
 }
 
 
+// --- InputChannel::SharedRing ---
+
+// A single writer, single reader ring of messages in shared memory.  The slots
+// follow the header.  The indices only grow, the slot of index i is i % capacity.
+// Both endpoints can write to the memory, so the capacity is not stored in it:
+// each endpoint keeps its own copy, see InputChannel::mRingCapacity.
+struct InputChannel::SharedRing {
+    // The index of the next slot the writer fills in, only written by the writer.
+    volatile int32_t head;
+    // The index of the next slot the reader reads, only written by the reader.
+    volatile int32_t tail;
+    // Set by the reader when it finds the ring empty, cleared by the writer when it
+    // rings the doorbell.
+    volatile int32_t readerIdle;
+
+    inline InputMessage* slot(uint32_t index, uint32_t capacity) {
+        return reinterpret_cast<InputMessage*>(this + 1) + index % capacity;
+    }
+
+    static inline size_t sizeFor(uint32_t capacity) {
+        return sizeof(SharedRing) + capacity * sizeof(InputMessage);
+    }
+};
+
+
 // --- InputChannel ---
 
 InputChannel::InputChannel(const String8& name, int fd) :
-        mName(name), mFd(fd) {
+        mName(name), mFd(fd), mRing(NULL), mRingSize(0), mRingCapacity(0),
+        mRingWriter(false) {
 #if DEBUG_CHANNEL_LIFECYCLE
     ALOGD("Input channel constructed: name='%s', fd=%d",
             mName.string(), fd);
@@ -113,6 +161,9 @@ InputChannel::~InputChannel() {
             mName.string(), mFd);
 #endif
 
+    if (mRing) {
+        munmap(mRing, mRingSize);
+    }
     ::close(mFd);
 }
 
@@ -145,11 +196,42 @@ status_t InputChannel::openInputChannelPair(const String8& name,
 }
 
 status_t InputChannel::sendMessage(const InputMessage* msg) {
+    if (mRing && mRingWriter) {
+        return writeToRing(msg);
+    }
+    return sendSocketMessage(msg, -1);
+}
+
+status_t InputChannel::sendSocketMessage(const InputMessage* msg, int fd) {
     size_t msgLength = msg->size();
     ssize_t nWrite;
-    do {
-        nWrite = ::send(mFd, msg, msgLength, MSG_DONTWAIT | MSG_NOSIGNAL);
-    } while (nWrite == -1 && errno == EINTR);
+    if (fd < 0) {
+        do {
+            nWrite = ::send(mFd, msg, msgLength, MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nWrite == -1 && errno == EINTR);
+    } else {
+        struct iovec iov;
+        iov.iov_base = const_cast<InputMessage*>(msg);
+        iov.iov_len = msgLength;
+
+        char control[CMSG_SPACE(sizeof(int))];
+        struct msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1;
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+        do {
+            nWrite = ::sendmsg(mFd, &header, MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nWrite == -1 && errno == EINTR);
+    }
 
     if (nWrite < 0) {
         int error = errno;
@@ -181,11 +263,81 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
 }
 
 status_t InputChannel::receiveMessage(InputMessage* msg) {
+    for (;;) {
+        bool ringReader = mRing && !mRingWriter;
+        if (ringReader) {
+            status_t result = readFromRing(msg);
+            if (result != WOULD_BLOCK) {
+                return result;
+            }
+        }
+
+        int fd = -1;
+        status_t result = receiveSocketMessage(msg, &fd);
+        if (result == WOULD_BLOCK && ringReader) {
+            // Ask for a doorbell, then check again for a message written before the
+            // writer could see the request.
+            android_atomic_release_store(1, &mRing->readerIdle);
+            ANDROID_MEMBAR_FULL();
+            return readFromRing(msg);
+        }
+        if (result) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return result;
+        }
+
+        switch (msg->header.type) {
+        case InputMessage::TYPE_DOORBELL:
+            continue;
+
+        case InputMessage::TYPE_RING:
+            result = mapSharedRing(fd, msg->body.ring.capacity);
+            ::close(fd);
+            if (result) {
+                ALOGE("channel '%s' ~ Could not map the shared ring, status=%d",
+                        mName.string(), result);
+                return result;
+            }
+            continue;
+        }
+
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return OK;
+    }
+}
+
+status_t InputChannel::receiveSocketMessage(InputMessage* msg, int* outFd) {
+    struct iovec iov;
+    iov.iov_base = msg;
+    iov.iov_len = sizeof(InputMessage);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
     ssize_t nRead;
     do {
-        nRead = ::recv(mFd, msg, sizeof(InputMessage), MSG_DONTWAIT);
+        nRead = ::recvmsg(mFd, &header, MSG_DONTWAIT);
     } while (nRead == -1 && errno == EINTR);
 
+    if (nRead >= 0) {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg;
+                cmsg = CMSG_NXTHDR(&header, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+                    && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+                memcpy(outFd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+    }
+
     if (nRead < 0) {
         int error = errno;
 #if DEBUG_CHANNEL_MESSAGES
@@ -220,6 +372,149 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::openSharedRing(size_t capacity) {
+    if (mRing) {
+        return INVALID_OPERATION;
+    }
+    if (capacity == 0 || capacity > 0xffff) {
+        return BAD_VALUE;
+    }
+
+    size_t size = SharedRing::sizeFor(capacity);
+    int fd = ashmem_create_region(mName.string(), size);
+    if (fd < 0) {
+        ALOGE("channel '%s' ~ Could not create the shared ring, errno=%d",
+                mName.string(), errno);
+        return -errno;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        status_t result = -errno;
+        ALOGE("channel '%s' ~ Could not map the shared ring, errno=%d",
+                mName.string(), errno);
+        ::close(fd);
+        return result;
+    }
+
+    SharedRing* ring = static_cast<SharedRing*>(data);
+    ring->head = 0;
+    ring->tail = 0;
+    ring->readerIdle = 1;
+
+    InputMessage msg;
+    msg.header.type = InputMessage::TYPE_RING;
+    msg.header.padding = 0;
+    msg.body.ring.capacity = capacity;
+    status_t result = sendSocketMessage(&msg, fd);
+    ::close(fd);
+    if (result) {
+        munmap(data, size);
+        return result;
+    }
+
+    mRing = ring;
+    mRingSize = size;
+    mRingCapacity = capacity;
+    mRingWriter = true;
+    return OK;
+}
+
+status_t InputChannel::mapSharedRing(int fd, uint32_t capacity) {
+    if (fd < 0 || capacity == 0 || capacity > 0xffff) {
+        return BAD_VALUE;
+    }
+    if (mRing) {
+        return INVALID_OPERATION;
+    }
+
+    size_t size = SharedRing::sizeFor(capacity);
+    int regionSize = ashmem_get_size_region(fd);
+    if (regionSize < 0 || size_t(regionSize) < size) {
+        return BAD_VALUE;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        return -errno;
+    }
+
+    mRing = static_cast<SharedRing*>(data);
+    mRingSize = size;
+    mRingCapacity = capacity;
+    mRingWriter = false;
+    return OK;
+}
+
+status_t InputChannel::writeToRing(const InputMessage* msg) {
+    SharedRing* ring = mRing;
+    uint32_t head = uint32_t(ring->head);
+    uint32_t tail = uint32_t(android_atomic_acquire_load(&ring->tail));
+    if (head - tail >= mRingCapacity) {
+#if DEBUG_CHANNEL_MESSAGES
+        ALOGD("channel '%s' ~ shared ring is full", mName.string());
+#endif
+        return WOULD_BLOCK;
+    }
+
+    memcpy(ring->slot(head, mRingCapacity), msg, msg->size());
+    android_atomic_release_store(int32_t(head + 1), &ring->head);
+
+    // Ring the doorbell if the reader found the ring empty.  The barrier orders the
+    // write of the head before the read of the flag, the reader does the opposite.
+    ANDROID_MEMBAR_FULL();
+    if (ring->readerIdle && android_atomic_cmpxchg(1, 0, &ring->readerIdle) == 0) {
+        InputMessage doorbell;
+        doorbell.header.type = InputMessage::TYPE_DOORBELL;
+        doorbell.header.padding = 0;
+        status_t result = sendSocketMessage(&doorbell, -1);
+        // A full socket already has a message that wakes the reader up.
+        if (result && result != WOULD_BLOCK) {
+            return result;
+        }
+    }
+
+#if DEBUG_CHANNEL_MESSAGES
+    ALOGD("channel '%s' ~ wrote message of type %d to the shared ring", mName.string(),
+            msg->header.type);
+#endif
+    return OK;
+}
+
+status_t InputChannel::readFromRing(InputMessage* msg) {
+    SharedRing* ring = mRing;
+    uint32_t tail = uint32_t(ring->tail);
+    uint32_t head = uint32_t(android_atomic_acquire_load(&ring->head));
+    if (head == tail) {
+        return WOULD_BLOCK;
+    }
+
+    // The size of a motion message depends on its pointer count, which must be
+    // checked before the pointers are copied.
+    const InputMessage* slot = ring->slot(tail, mRingCapacity);
+    msg->header = slot->header;
+    if (msg->header.type == InputMessage::TYPE_MOTION) {
+        size_t pointerCount = slot->body.motion.pointerCount;
+        msg->body.motion.pointerCount = pointerCount <= MAX_POINTERS ? pointerCount : 0;
+    }
+    size_t size = msg->size();
+    memcpy(msg, slot, size);
+    android_atomic_release_store(int32_t(tail + 1), &ring->tail);
+
+    if (!msg->isValid(size)) {
+#if DEBUG_CHANNEL_MESSAGES
+        ALOGD("channel '%s' ~ read invalid message from the shared ring", mName.string());
+#endif
+        return BAD_VALUE;
+    }
+
+#if DEBUG_CHANNEL_MESSAGES
+    ALOGD("channel '%s' ~ read message of type %d from the shared ring", mName.string(),
+            msg->header.type);
+#endif
+    return OK;
+}
+
 sp<InputChannel> InputChannel::dup() const {
     int fd = ::dup(getFd());
     return fd >= 0 ? new InputChannel(getName(), fd) : NULL;
@@ -369,9 +664,17 @@ status_t InputPublisher::receiveFinishedSignal(uint32_t* outSeq, bool* outHandle
 InputConsumer::InputConsumer(const sp<InputChannel>& channel) :
         mResampleTouch(isTouchResamplingEnabled()),
         mChannel(channel), mMsgDeferred(false) {
+    getTouchPrediction(&mTouchPrediction);
 }
 
 InputConsumer::~InputConsumer() {
+    for (size_t i = 0; i < mTouchStates.size(); i++) {
+        delete mTouchStates[i].predictor;
+    }
+}
+
+void InputConsumer::setPresentTimeOffset(nsecs_t offset) {
+    mTouchPrediction.presentTimeOffset = offset;
 }
 
 bool InputConsumer::isTouchResamplingEnabled() {
@@ -389,6 +692,26 @@ bool InputConsumer::isTouchResamplingEnabled() {
     return true;
 }
 
+static nsecs_t getMillisecondsProperty(const char* key, nsecs_t defaultValue) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get(key, value, NULL) > 0) {
+        return atoi(value) * NANOS_PER_MS;
+    }
+    return defaultValue;
+}
+
+void InputConsumer::getTouchPrediction(TouchPrediction* outPrediction) {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.input.predictor", value, "");
+    outPrediction->strategy.setTo(value);
+    outPrediction->presentTimeOffset = getMillisecondsProperty(
+            "ro.input.predict_present_offset_ms", PREDICTION_DEFAULT_PRESENT_OFFSET);
+    outPrediction->maxFingerPrediction = getMillisecondsProperty(
+            "ro.input.predict_finger_max_ms", PREDICTION_DEFAULT_MAX_PREDICTION);
+    outPrediction->maxStylusPrediction = getMillisecondsProperty(
+            "ro.input.predict_stylus_max_ms", 0);
+}
+
 status_t InputConsumer::consume(InputEventFactoryInterface* factory,
         bool consumeBatches, nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent) {
 #if DEBUG_TRANSPORT_ACTIONS
@@ -590,10 +913,19 @@ void InputConsumer::updateTouchState(InputMessage* msg) {
         if (index < 0) {
             mTouchStates.push();
             index = mTouchStates.size() - 1;
+            mTouchStates.editItemAt(index).predictor = NULL;
         }
         TouchState& touchState = mTouchStates.editItemAt(index);
         touchState.initialize(deviceId, source);
         touchState.addHistory(msg);
+        if (!mTouchPrediction.strategy.isEmpty()) {
+            if (touchState.predictor) {
+                touchState.predictor->clear();
+            } else {
+                touchState.predictor = new VelocityTracker(mTouchPrediction.strategy.string());
+            }
+            addPredictorMovement(touchState.predictor, msg);
+        }
         break;
     }
 
@@ -602,6 +934,9 @@ void InputConsumer::updateTouchState(InputMessage* msg) {
         if (index >= 0) {
             TouchState& touchState = mTouchStates.editItemAt(index);
             touchState.addHistory(msg);
+            if (touchState.predictor) {
+                addPredictorMovement(touchState.predictor, msg);
+            }
             if (eventTime < touchState.lastResample.eventTime) {
                 rewriteMessage(touchState, msg);
             } else {
@@ -617,6 +952,11 @@ void InputConsumer::updateTouchState(InputMessage* msg) {
             TouchState& touchState = mTouchStates.editItemAt(index);
             touchState.lastResample.idBits.clearBit(msg->body.motion.getActionId());
             rewriteMessage(touchState, msg);
+            if (touchState.predictor) {
+                // The id may have been used by another pointer before.
+                touchState.predictor->clearPointers(
+                        BitSet32(BitSet32::valueForBit(msg->body.motion.getActionId())));
+            }
         }
         break;
     }
@@ -646,13 +986,36 @@ void InputConsumer::updateTouchState(InputMessage* msg) {
         if (index >= 0) {
             const TouchState& touchState = mTouchStates.itemAt(index);
             rewriteMessage(touchState, msg);
-            mTouchStates.removeAt(index);
+            removeTouchState(index);
         }
         break;
     }
     }
 }
 
+void InputConsumer::removeTouchState(size_t index) {
+    delete mTouchStates[index].predictor;
+    mTouchStates.removeAt(index);
+}
+
+void InputConsumer::addPredictorMovement(VelocityTracker* predictor, const InputMessage* msg) {
+    // The positions go in order by increasing id.
+    size_t pointerCount = msg->body.motion.pointerCount;
+    BitSet32 idBits;
+    for (size_t i = 0; i < pointerCount; i++) {
+        idBits.markBit(msg->body.motion.pointers[i].properties.id);
+    }
+    VelocityTracker::Position positions[MAX_POINTERS];
+    for (size_t i = 0; i < pointerCount; i++) {
+        const InputMessage::Body::Motion::Pointer& pointer = msg->body.motion.pointers[i];
+        VelocityTracker::Position& position =
+                positions[idBits.getIndexOfBit(pointer.properties.id)];
+        position.x = pointer.coords.getX();
+        position.y = pointer.coords.getY();
+    }
+    predictor->addMovement(msg->body.motion.eventTime, idBits, positions);
+}
+
 void InputConsumer::rewriteMessage(const TouchState& state, InputMessage* msg) {
     for (size_t i = 0; i < msg->body.motion.pointerCount; i++) {
         uint32_t id = msg->body.motion.pointers[i].properties.id;
@@ -726,6 +1089,8 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
             return;
         }
         alpha = float(sampleTime - current->eventTime) / delta;
+    } else if (touchState.predictor && predictTouchState(touchState, sampleTime, event)) {
+        return;
     } else if (touchState.historySize >= 2) {
         // Extrapolate future sample using current sample and past sample.
         // So other->eventTime <= current->eventTime <= sampleTime.
@@ -792,6 +1157,74 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
     event->addSample(sampleTime, touchState.lastResample.pointers);
 }
 
+bool InputConsumer::predictTouchState(TouchState& touchState, nsecs_t sampleTime,
+        MotionEvent* event) {
+    // Predict where the pointers will be when the frame is presented, rather than
+    // where they were RESAMPLE_LATENCY before the frame started.
+    const History* current = touchState.getHistory(0);
+    nsecs_t predictTime = sampleTime + RESAMPLE_LATENCY + mTouchPrediction.presentTimeOffset;
+    if (predictTime <= current->eventTime) {
+        return false;
+    }
+
+    size_t pointerCount = event->getPointerCount();
+    PointerCoords predictedCoords[MAX_POINTERS];
+    nsecs_t maxPrediction = 0;
+    bool predicted = false;
+    for (size_t i = 0; i < pointerCount; i++) {
+        uint32_t id = event->getPointerId(i);
+        const PointerCoords& currentCoords = current->getPointerById(id);
+        predictedCoords[i].copyFrom(currentCoords);
+
+        int32_t toolType = event->getToolType(i);
+        nsecs_t toolMaxPrediction = toolType == AMOTION_EVENT_TOOL_TYPE_STYLUS
+                ? mTouchPrediction.maxStylusPrediction
+                : shouldResampleTool(toolType) ? mTouchPrediction.maxFingerPrediction : 0;
+        VelocityTracker::Estimator estimator;
+        if (toolMaxPrediction <= 0
+                || !touchState.predictor->getEstimator(id, &estimator)
+                || estimator.degree < 1
+                || estimator.confidence < PREDICTION_MIN_CONFIDENCE) {
+            continue;
+        }
+
+        // The estimator is a polynomial of the time in seconds since its time base.
+        nsecs_t time = min(predictTime, current->eventTime + toolMaxPrediction);
+        float t = (time - estimator.time) * 0.000000001f;
+        float x = 0, y = 0, tn = 1;
+        for (size_t n = 0; n <= estimator.degree; n++) {
+            x += estimator.xCoeff[n] * tn;
+            y += estimator.yCoeff[n] * tn;
+            tn *= t;
+        }
+        predictedCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, x);
+        predictedCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+        if (toolMaxPrediction > maxPrediction) {
+            maxPrediction = toolMaxPrediction;
+        }
+        predicted = true;
+    }
+    if (!predicted) {
+        return false;
+    }
+
+    predictTime = min(predictTime, current->eventTime + maxPrediction);
+#if DEBUG_RESAMPLING
+    ALOGD("Predicted touch %lld ns past the last sample.", predictTime - current->eventTime);
+#endif
+
+    touchState.lastResample.eventTime = predictTime;
+    touchState.lastResample.idBits.clear();
+    for (size_t i = 0; i < pointerCount; i++) {
+        uint32_t id = event->getPointerId(i);
+        touchState.lastResample.idToIndex[id] = i;
+        touchState.lastResample.idBits.markBit(id);
+        touchState.lastResample.pointers[i].copyFrom(predictedCoords[i]);
+    }
+    event->addSample(predictTime, touchState.lastResample.pointers);
+    return true;
+}
+
 bool InputConsumer::shouldResampleTool(int32_t toolType) {
     return toolType == AMOTION_EVENT_TOOL_TYPE_FINGER
             || toolType == AMOTION_EVENT_TOOL_TYPE_UNKNOWN;
@@ -32,6 +32,8 @@
 #include <utils/Tokenizer.h>
 #include <utils/Timers.h>
 
+#include "KeyMapCache.h"
+
 // Enables debug output for the parser.
 #define DEBUG_PARSER 0
 
@@ -109,6 +111,22 @@ status_t KeyCharacterMap::load(const String8& filename,
         Format format, sp<KeyCharacterMap>* outMap) {
     outMap->clear();
 
+    // The format restricts what the parser accepts, so it is part of the compiled form.
+    const int32_t* words;
+    size_t numWords;
+    FileMap* compiledMap = KeyMapCache::open(filename, KeyMapCache::MAGIC_KEY_CHARACTER_MAP,
+            format, &words, &numWords);
+    if (compiledMap) {
+        sp<KeyCharacterMap> map = new KeyCharacterMap();
+        bool loaded = map->loadCompiled(words, numWords);
+        compiledMap->release();
+        if (loaded) {
+            *outMap = map;
+            return NO_ERROR;
+        }
+        ALOGW("Ignoring malformed compiled key character map for %s.", filename.string());
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(filename, &tokenizer);
     if (status) {
@@ -116,6 +134,13 @@ status_t KeyCharacterMap::load(const String8& filename,
     } else {
         status = load(tokenizer, format, outMap);
         delete tokenizer;
+
+        if (!status) {
+            Vector<int32_t> compiledWords;
+            (*outMap)->compile(&compiledWords);
+            KeyMapCache::save(filename, KeyMapCache::MAGIC_KEY_CHARACTER_MAP, format,
+                    compiledWords);
+        }
     }
     return status;
 }
@@ -161,6 +186,91 @@ status_t KeyCharacterMap::load(Tokenizer* tokenizer,
     return status;
 }
 
+bool KeyCharacterMap::loadCompiled(const int32_t* words, size_t numWords) {
+    const int32_t* end = words + numWords;
+    if (end - words < 4) {
+        return false;
+    }
+    mType = *words++;
+    size_t numKeys = *words++;
+    size_t numScanCodes = *words++;
+    size_t numUsageCodes = *words++;
+
+    for (size_t i = 0; i < numKeys; i++) {
+        if (end - words < 4) {
+            return false;
+        }
+        int32_t keyCode = *words++;
+        Key* key = new Key();
+        key->label = *words++;
+        key->number = *words++;
+        size_t numBehaviors = *words++;
+        mKeys.add(keyCode, key);
+
+        Behavior* lastBehavior = NULL;
+        for (size_t j = 0; j < numBehaviors; j++) {
+            if (end - words < 3) {
+                return false;
+            }
+            Behavior* behavior = new Behavior();
+            behavior->metaState = *words++;
+            behavior->character = *words++;
+            behavior->fallbackKeyCode = *words++;
+            if (lastBehavior) {
+                lastBehavior->next = behavior;
+            } else {
+                key->firstBehavior = behavior;
+            }
+            lastBehavior = behavior;
+        }
+    }
+
+    if (size_t(end - words) != (numScanCodes + numUsageCodes) * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < numScanCodes; i++, words += 2) {
+        mKeysByScanCode.add(words[0], words[1]);
+    }
+    for (size_t i = 0; i < numUsageCodes; i++, words += 2) {
+        mKeysByUsageCode.add(words[0], words[1]);
+    }
+    return true;
+}
+
+void KeyCharacterMap::compile(Vector<int32_t>* outWords) const {
+    outWords->add(mType);
+    outWords->add(mKeys.size());
+    outWords->add(mKeysByScanCode.size());
+    outWords->add(mKeysByUsageCode.size());
+
+    for (size_t i = 0; i < mKeys.size(); i++) {
+        const Key* key = mKeys.valueAt(i);
+        outWords->add(mKeys.keyAt(i));
+        outWords->add(key->label);
+        outWords->add(key->number);
+
+        size_t countIndex = outWords->add(0);
+        size_t numBehaviors = 0;
+        for (const Behavior* behavior = key->firstBehavior; behavior != NULL;
+                behavior = behavior->next) {
+            outWords->add(behavior->metaState);
+            outWords->add(behavior->character);
+            outWords->add(behavior->fallbackKeyCode);
+            numBehaviors += 1;
+        }
+        outWords->editItemAt(countIndex) = numBehaviors;
+    }
+
+    for (size_t i = 0; i < mKeysByScanCode.size(); i++) {
+        outWords->add(mKeysByScanCode.keyAt(i));
+        outWords->add(mKeysByScanCode.valueAt(i));
+    }
+    for (size_t i = 0; i < mKeysByUsageCode.size(); i++) {
+        outWords->add(mKeysByUsageCode.keyAt(i));
+        outWords->add(mKeysByUsageCode.valueAt(i));
+    }
+}
+
 sp<KeyCharacterMap> KeyCharacterMap::combine(const sp<KeyCharacterMap>& base,
         const sp<KeyCharacterMap>& overlay) {
     if (overlay == NULL) {
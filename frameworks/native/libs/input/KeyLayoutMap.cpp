@@ -26,6 +26,8 @@
 #include <utils/Tokenizer.h>
 #include <utils/Timers.h>
 
+#include "KeyMapCache.h"
+
 // Enables debug output for the parser.
 #define DEBUG_PARSER 0
 
@@ -42,15 +44,35 @@ static const char* WHITESPACE = " \t\r";
 
 // --- KeyLayoutMap ---
 
-KeyLayoutMap::KeyLayoutMap() {
+KeyLayoutMap::KeyLayoutMap() :
+        mCompiledMap(NULL),
+        mCompiledKeysByScanCode(NULL), mNumCompiledKeysByScanCode(0),
+        mCompiledKeysByUsageCode(NULL), mNumCompiledKeysByUsageCode(0),
+        mCompiledAxes(NULL), mNumCompiledAxes(0) {
 }
 
 KeyLayoutMap::~KeyLayoutMap() {
+    if (mCompiledMap) {
+        mCompiledMap->release();
+    }
 }
 
 status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
     outMap->clear();
 
+    const int32_t* words;
+    size_t numWords;
+    FileMap* compiledMap = KeyMapCache::open(filename, KeyMapCache::MAGIC_KEY_LAYOUT, 0,
+            &words, &numWords);
+    if (compiledMap) {
+        sp<KeyLayoutMap> map = new KeyLayoutMap();
+        if (map->setCompiledMap(compiledMap, words, numWords)) {
+            *outMap = map;
+            return NO_ERROR;
+        }
+        ALOGW("Ignoring malformed compiled key layout map for %s.", filename.string());
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(filename, &tokenizer);
     if (status) {
@@ -74,6 +96,10 @@ status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
 #endif
             if (!status) {
                 *outMap = map;
+
+                Vector<int32_t> compiledWords;
+                map->compile(&compiledWords);
+                KeyMapCache::save(filename, KeyMapCache::MAGIC_KEY_LAYOUT, 0, compiledWords);
             }
         }
         delete tokenizer;
@@ -81,6 +107,64 @@ status_t KeyLayoutMap::load(const String8& filename, sp<KeyLayoutMap>* outMap) {
     return status;
 }
 
+bool KeyLayoutMap::setCompiledMap(FileMap* compiledMap, const int32_t* words, size_t numWords) {
+    // The map owns the compiled data from now on, even if it turns out to be malformed.
+    mCompiledMap = compiledMap;
+
+    const size_t keyWords = sizeof(CompiledKey) / sizeof(int32_t);
+    const size_t axisWords = sizeof(CompiledAxis) / sizeof(int32_t);
+    if (numWords < 3) {
+        return false;
+    }
+    size_t numScanKeys = words[0];
+    size_t numUsageKeys = words[1];
+    size_t numAxes = words[2];
+    if (numScanKeys > numWords || numUsageKeys > numWords || numAxes > numWords
+            || 3 + (numScanKeys + numUsageKeys) * keyWords + numAxes * axisWords != numWords) {
+        return false;
+    }
+
+    const int32_t* entries = words + 3;
+    mCompiledKeysByScanCode = reinterpret_cast<const CompiledKey*>(entries);
+    mNumCompiledKeysByScanCode = numScanKeys;
+    entries += numScanKeys * keyWords;
+    mCompiledKeysByUsageCode = reinterpret_cast<const CompiledKey*>(entries);
+    mNumCompiledKeysByUsageCode = numUsageKeys;
+    entries += numUsageKeys * keyWords;
+    mCompiledAxes = reinterpret_cast<const CompiledAxis*>(entries);
+    mNumCompiledAxes = numAxes;
+    return true;
+}
+
+void KeyLayoutMap::compile(Vector<int32_t>* outWords) const {
+    outWords->add(mKeysByScanCode.size());
+    outWords->add(mKeysByUsageCode.size());
+    outWords->add(mAxes.size());
+
+    // Keyed vectors are sorted by key, which is the order the compiled map is searched in.
+    for (size_t i = 0; i < mKeysByScanCode.size(); i++) {
+        const Key& key = mKeysByScanCode.valueAt(i);
+        outWords->add(mKeysByScanCode.keyAt(i));
+        outWords->add(key.keyCode);
+        outWords->add(key.flags);
+    }
+    for (size_t i = 0; i < mKeysByUsageCode.size(); i++) {
+        const Key& key = mKeysByUsageCode.valueAt(i);
+        outWords->add(mKeysByUsageCode.keyAt(i));
+        outWords->add(key.keyCode);
+        outWords->add(key.flags);
+    }
+    for (size_t i = 0; i < mAxes.size(); i++) {
+        const AxisInfo& axis = mAxes.valueAt(i);
+        outWords->add(mAxes.keyAt(i));
+        outWords->add(axis.mode);
+        outWords->add(axis.axis);
+        outWords->add(axis.highAxis);
+        outWords->add(axis.splitValue);
+        outWords->add(axis.flatOverride);
+    }
+}
+
 status_t KeyLayoutMap::mapKey(int32_t scanCode, int32_t usageCode,
         int32_t* outKeyCode, uint32_t* outFlags) const {
     const Key* key = getKey(scanCode, usageCode);
@@ -104,6 +188,19 @@ status_t KeyLayoutMap::mapKey(int32_t scanCode, int32_t usageCode,
 }
 
 const KeyLayoutMap::Key* KeyLayoutMap::getKey(int32_t scanCode, int32_t usageCode) const {
+    if (mCompiledMap) {
+        const CompiledKey* entry = NULL;
+        if (usageCode) {
+            entry = KeyMapCache::find(mCompiledKeysByUsageCode, mNumCompiledKeysByUsageCode,
+                    usageCode);
+        }
+        if (!entry && scanCode) {
+            entry = KeyMapCache::find(mCompiledKeysByScanCode, mNumCompiledKeysByScanCode,
+                    scanCode);
+        }
+        return entry ? &entry->key : NULL;
+    }
+
     if (usageCode) {
         ssize_t index = mKeysByUsageCode.indexOfKey(usageCode);
         if (index >= 0) {
@@ -120,6 +217,12 @@ const KeyLayoutMap::Key* KeyLayoutMap::getKey(int32_t scanCode, int32_t usageCod
 }
 
 status_t KeyLayoutMap::findScanCodesForKey(int32_t keyCode, Vector<int32_t>* outScanCodes) const {
+    for (size_t i = 0; i < mNumCompiledKeysByScanCode; i++) {
+        if (mCompiledKeysByScanCode[i].key.keyCode == keyCode) {
+            outScanCodes->add(mCompiledKeysByScanCode[i].code);
+        }
+    }
+
     const size_t N = mKeysByScanCode.size();
     for (size_t i=0; i<N; i++) {
         if (mKeysByScanCode.valueAt(i).keyCode == keyCode) {
@@ -130,15 +233,30 @@ status_t KeyLayoutMap::findScanCodesForKey(int32_t keyCode, Vector<int32_t>* out
 }
 
 status_t KeyLayoutMap::mapAxis(int32_t scanCode, AxisInfo* outAxisInfo) const {
-    ssize_t index = mAxes.indexOfKey(scanCode);
-    if (index < 0) {
+    if (mCompiledMap) {
+        const CompiledAxis* entry = KeyMapCache::find(mCompiledAxes, mNumCompiledAxes, scanCode);
+        if (!entry) {
 #if DEBUG_MAPPING
-        ALOGD("mapAxis: scanCode=%d ~ Failed.", scanCode);
+            ALOGD("mapAxis: scanCode=%d ~ Failed.", scanCode);
 #endif
-        return NAME_NOT_FOUND;
-    }
+            return NAME_NOT_FOUND;
+        }
+        outAxisInfo->mode = AxisInfo::Mode(entry->mode);
+        outAxisInfo->axis = entry->axis;
+        outAxisInfo->highAxis = entry->highAxis;
+        outAxisInfo->splitValue = entry->splitValue;
+        outAxisInfo->flatOverride = entry->flatOverride;
+    } else {
+        ssize_t index = mAxes.indexOfKey(scanCode);
+        if (index < 0) {
+#if DEBUG_MAPPING
+            ALOGD("mapAxis: scanCode=%d ~ Failed.", scanCode);
+#endif
+            return NAME_NOT_FOUND;
+        }
 
-    *outAxisInfo = mAxes.valueAt(index);
+        *outAxisInfo = mAxes.valueAt(index);
+    }
 
 #if DEBUG_MAPPING
     ALOGD("mapAxis: scanCode=%d ~ Result mode=%d, axis=%d, highAxis=%d, "
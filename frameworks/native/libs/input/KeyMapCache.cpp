@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "KeyMapCache"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <utils/Log.h>
+
+#include "KeyMapCache.h"
+
+// Enables debug output for the cache.
+#define DEBUG_CACHE 0
+
+namespace android {
+
+#if HAVE_ANDROID_OS
+static const char* CACHE_DIR = "/data/system/inputmap-cache";
+#endif
+
+struct CompiledHeader {
+    uint32_t magic;
+    uint32_t variant;
+    int64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceIno;
+    uint32_t numWords;
+    uint32_t reserved;
+};
+
+static void initHeader(CompiledHeader* header, uint32_t magic, uint32_t variant,
+        const struct stat& sourceStat) {
+    memset(header, 0, sizeof(*header));
+    header->magic = magic;
+    header->variant = variant;
+    header->sourceSize = sourceStat.st_size;
+    header->sourceMtime = sourceStat.st_mtime;
+    header->sourceIno = sourceStat.st_ino;
+}
+
+String8 KeyMapCache::getCachePath(const String8& filename) {
+    String8 path;
+#if HAVE_ANDROID_OS
+    const char* name = filename.string();
+    while (*name == '/') {
+        name++;
+    }
+    path.appendFormat("%s/%s", CACHE_DIR, name);
+
+    // Flatten the source path into a single file name.
+    char* buf = path.lockBuffer(path.size());
+    for (char* c = buf + strlen(CACHE_DIR) + 1; *c; c++) {
+        if (*c == '/') {
+            *c = '@';
+        }
+    }
+    path.unlockBuffer();
+#endif
+    return path;
+}
+
+FileMap* KeyMapCache::open(const String8& filename, uint32_t magic, uint32_t variant,
+        const int32_t** outWords, size_t* outNumWords) {
+#if HAVE_ANDROID_OS
+    struct stat sourceStat;
+    if (stat(filename.string(), &sourceStat)) {
+        return NULL;
+    }
+
+    String8 path(getCachePath(filename));
+    int fd = ::open(path.string(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    FileMap* fileMap = NULL;
+    struct stat cacheStat;
+    if (!fstat(fd, &cacheStat) && size_t(cacheStat.st_size) >= sizeof(CompiledHeader)) {
+        fileMap = new FileMap();
+        if (!fileMap->create(NULL, fd, 0, cacheStat.st_size, true)) {
+            fileMap->release();
+            fileMap = NULL;
+        }
+    }
+    close(fd);
+    if (!fileMap) {
+        return NULL;
+    }
+
+    CompiledHeader expected;
+    initHeader(&expected, magic, variant, sourceStat);
+    const CompiledHeader* header = static_cast<const CompiledHeader*>(fileMap->getDataPtr());
+    if (header->magic != expected.magic
+            || header->variant != expected.variant
+            || header->sourceSize != expected.sourceSize
+            || header->sourceMtime != expected.sourceMtime
+            || header->sourceIno != expected.sourceIno
+            || sizeof(CompiledHeader) + header->numWords * sizeof(int32_t)
+                    != fileMap->getDataLength()) {
+#if DEBUG_CACHE
+        ALOGD("Compiled form of '%s' is out of date.", filename.string());
+#endif
+        fileMap->release();
+        return NULL;
+    }
+
+    *outWords = reinterpret_cast<const int32_t*>(header + 1);
+    *outNumWords = header->numWords;
+    return fileMap;
+#else
+    return NULL;
+#endif
+}
+
+void KeyMapCache::save(const String8& filename, uint32_t magic, uint32_t variant,
+        const Vector<int32_t>& words) {
+#if HAVE_ANDROID_OS
+    struct stat sourceStat;
+    if (stat(filename.string(), &sourceStat)) {
+        return;
+    }
+
+    if (mkdir(CACHE_DIR, 0700) && errno != EEXIST) {
+#if DEBUG_CACHE
+        ALOGD("Cannot create %s: %s", CACHE_DIR, strerror(errno));
+#endif
+        return;
+    }
+
+    // Write to a temporary file first, so readers never see a partial file.
+    String8 path(getCachePath(filename));
+    String8 tempPath(path);
+    tempPath.append(".tmp");
+    int fd = ::open(tempPath.string(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+
+    CompiledHeader header;
+    initHeader(&header, magic, variant, sourceStat);
+    header.numWords = words.size();
+
+    const size_t dataSize = words.size() * sizeof(int32_t);
+    bool ok = write(fd, &header, sizeof(header)) == ssize_t(sizeof(header))
+            && write(fd, words.array(), dataSize) == ssize_t(dataSize);
+    close(fd);
+
+    if (!ok || rename(tempPath.string(), path.string())) {
+        ALOGW("Could not save the compiled form of '%s'.", filename.string());
+        unlink(tempPath.string());
+    }
+#endif
+}
+
+} // namespace android
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBINPUT_KEY_MAP_CACHE_H
+#define _LIBINPUT_KEY_MAP_CACHE_H
+
+#include <stdint.h>
+#include <utils/FileMap.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+/*
+ * Caches the compiled form of key layout and key character map files, so that
+ * the text is only tokenized and parsed the first time a file is used.
+ *
+ * The compiled data is an array of int32_t words whose layout is private to each
+ * map type. It is stored under /data/system along with the size, modification time
+ * and inode of the source file, and is only used while these still match.
+ * The cache is only used on the device; host builds always parse the text.
+ */
+class KeyMapCache {
+public:
+    enum {
+        MAGIC_KEY_LAYOUT = 0x31424c4b, // 'KLB1'
+        MAGIC_KEY_CHARACTER_MAP = 0x31424d4b, // 'KMB1'
+    };
+
+    /* Maps the compiled data for the given source file, if there is an up to date one.
+     * The variant distinguishes different compilations of the same source.
+     * Returns NULL if there is none, otherwise the caller must release() the map. */
+    static FileMap* open(const String8& filename, uint32_t magic, uint32_t variant,
+            const int32_t** outWords, size_t* outNumWords);
+
+    /* Stores the compiled data for the given source file. Failures are not fatal,
+     * the file is parsed again next time. */
+    static void save(const String8& filename, uint32_t magic, uint32_t variant,
+            const Vector<int32_t>& words);
+
+    /* Finds the entry with the given code in a compiled array of entries sorted by
+     * their first field. */
+    template <typename T>
+    static const T* find(const T* entries, size_t count, int32_t code) {
+        size_t low = 0;
+        size_t high = count;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (entries[mid].code < code) {
+                low = mid + 1;
+            } else if (entries[mid].code > code) {
+                high = mid;
+            } else {
+                return &entries[mid];
+            }
+        }
+        return NULL;
+    }
+
+private:
+    static String8 getCachePath(const String8& filename);
+};
+
+} // namespace android
+
+#endif // _LIBINPUT_KEY_MAP_CACHE_H
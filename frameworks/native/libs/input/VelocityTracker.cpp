@@ -202,6 +202,7 @@ VelocityTrackerStrategy* VelocityTracker::createStrategy(const char* strategy) {
 void VelocityTracker::clear() {
     mCurrentPointerIdBits.clear();
     mActivePointerId = -1;
+    mEstimatorIdBits.clear();
 
     mStrategy->clear();
 }
@@ -213,6 +214,7 @@ void VelocityTracker::clearPointers(BitSet32 idBits) {
     if (mActivePointerId >= 0 && idBits.hasBit(mActivePointerId)) {
         mActivePointerId = !remainingIdBits.isEmpty() ? remainingIdBits.firstMarkedBit() : -1;
     }
+    mEstimatorIdBits.value &= ~idBits.value;
 
     mStrategy->clearPointers(idBits);
 }
@@ -239,6 +241,8 @@ void VelocityTracker::addMovement(nsecs_t eventTime, BitSet32 idBits, const Posi
         mActivePointerId = idBits.isEmpty() ? -1 : idBits.firstMarkedBit();
     }
 
+    // All the estimators are relative to the time of the newest movement.
+    mEstimatorIdBits.clear();
     mStrategy->addMovement(eventTime, idBits, positions);
 
 #if DEBUG_VELOCITY
@@ -345,7 +349,22 @@ bool VelocityTracker::getVelocity(uint32_t id, float* outVx, float* outVy) const
 }
 
 bool VelocityTracker::getEstimator(uint32_t id, Estimator* outEstimator) const {
-    return mStrategy->getEstimator(id, outEstimator);
+    // Callers typically ask for the velocity of every pointer after each movement,
+    // and sometimes for both its components separately, so the estimators are kept
+    // until the movements change.
+    bool cacheable = id <= MAX_POINTER_ID;
+    if (cacheable && mEstimatorIdBits.hasBit(id)) {
+        *outEstimator = mEstimators[id];
+        return true;
+    }
+    if (!mStrategy->getEstimator(id, outEstimator)) {
+        return false;
+    }
+    if (cacheable) {
+        mEstimators[id] = *outEstimator;
+        mEstimatorIdBits.markBit(id);
+    }
+    return true;
 }
 
 
@@ -356,7 +375,7 @@ const uint32_t LeastSquaresVelocityTrackerStrategy::HISTORY_SIZE;
 
 LeastSquaresVelocityTrackerStrategy::LeastSquaresVelocityTrackerStrategy(
         uint32_t degree, Weighting weighting) :
-        mDegree(degree), mWeighting(weighting) {
+        mDegree(degree), mWeighting(weighting), mFactorSamples(0), mFactorSolvable(false) {
     clear();
 }
 
@@ -366,6 +385,7 @@ LeastSquaresVelocityTrackerStrategy::~LeastSquaresVelocityTrackerStrategy() {
 void LeastSquaresVelocityTrackerStrategy::clear() {
     mIndex = 0;
     mMovements[0].idBits.clear();
+    mFactorSamples = 0;
 }
 
 void LeastSquaresVelocityTrackerStrategy::clearPointers(BitSet32 idBits) {
@@ -386,6 +406,7 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
     for (uint32_t i = 0; i < count; i++) {
         movement.positions[i] = positions[i];
     }
+    mFactorSamples = 0;
 }
 
 /**
@@ -431,18 +452,21 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
  * Finally we solve the system of linear equations given by R1 B = (Qtranspose W Y)
  * to find B.
  *
+ * The decomposition only depends on X and W, so it is done by factorLeastSquares
+ * and shared by all the Y vectors fitted against the same X and W, which are then
+ * solved by solveFactoredLeastSquares.
+ *
  * For efficiency, we lay out A and Q column-wise in memory because we frequently
  * operate on the column vectors.  Conversely, we lay out R row-wise.
  *
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static bool solveLeastSquares(const float* x, const float* y,
-        const float* w, uint32_t m, uint32_t n, float* outB, float* outDet) {
+static bool factorLeastSquares(const float* x, const float* w, uint32_t m, uint32_t n,
+        float* outQ, float* outR) {
 #if DEBUG_STRATEGY
-    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
-            vectorToString(x, m).string(), vectorToString(y, m).string(),
-            vectorToString(w, m).string());
+    ALOGD("factorLeastSquares: m=%d, n=%d, x=%s, w=%s", int(m), int(n),
+            vectorToString(x, m).string(), vectorToString(w, m).string());
 #endif
 
     // Expand the X vector to a matrix A, pre-multiplied by the weights.
@@ -458,8 +482,10 @@ static bool solveLeastSquares(const float* x, const float* y,
 #endif
 
     // Apply the Gram-Schmidt process to A to obtain its QR decomposition.
-    float q[n][m]; // orthonormal basis, column-major order
-    float r[n][n]; // upper triangular matrix, row-major order
+    // Q is the orthonormal basis, in column-major order.
+    // R is the upper triangular matrix, in row-major order.
+    float (*q)[m] = reinterpret_cast<float (*)[m]>(outQ);
+    float (*r)[n] = reinterpret_cast<float (*)[n]>(outR);
     for (uint32_t j = 0; j < n; j++) {
         for (uint32_t h = 0; h < m; h++) {
             q[j][h] = a[j][h];
@@ -504,6 +530,18 @@ static bool solveLeastSquares(const float* x, const float* y,
     }
     ALOGD("  - qr=%s", matrixToString(&qr[0][0], m, n, false /*rowMajor*/).string());
 #endif
+    return true;
+}
+
+static void solveFactoredLeastSquares(const float* inQ, const float* inR,
+        const float* x, const float* y, const float* w, uint32_t m, uint32_t n,
+        float* outB, float* outDet) {
+#if DEBUG_STRATEGY
+    ALOGD("solveFactoredLeastSquares: m=%d, n=%d, y=%s", int(m), int(n),
+            vectorToString(y, m).string());
+#endif
+    const float (*q)[m] = reinterpret_cast<const float (*)[m]>(inQ);
+    const float (*r)[n] = reinterpret_cast<const float (*)[n]>(inR);
 
     // Solve R B = Qt W Y to find B.  This is easy because R is upper triangular.
     // We just work from bottom-right to top-left calculating B's coefficients.
@@ -551,7 +589,6 @@ static bool solveLeastSquares(const float* x, const float* y,
     ALOGD("  - sstot=%f", sstot);
     ALOGD("  - det=%f", *outDet);
 #endif
-    return true;
 }
 
 bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
@@ -597,8 +634,11 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
     if (degree >= 1) {
         float xdet, ydet;
         uint32_t n = degree + 1;
-        if (solveLeastSquares(time, x, w, m, n, outEstimator->xCoeff, &xdet)
-                && solveLeastSquares(time, y, w, m, n, outEstimator->yCoeff, &ydet)) {
+        if (factor(time, w, m, n)) {
+            solveFactoredLeastSquares(mFactorQ, mFactorR, time, x, w, m, n,
+                    outEstimator->xCoeff, &xdet);
+            solveFactoredLeastSquares(mFactorQ, mFactorR, time, y, w, m, n,
+                    outEstimator->yCoeff, &ydet);
             outEstimator->time = newestMovement.eventTime;
             outEstimator->degree = degree;
             outEstimator->confidence = xdet * ydet;
@@ -622,6 +662,17 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
     return true;
 }
 
+bool LeastSquaresVelocityTrackerStrategy::factor(const float* time, const float* w,
+        uint32_t m, uint32_t n) const {
+    // The times and weights of the last m movements are always the same until the
+    // next movement is added, and n follows from m.
+    if (mFactorSamples != m) {
+        mFactorSamples = m;
+        mFactorSolvable = factorLeastSquares(time, w, m, n, mFactorQ, mFactorR);
+    }
+    return mFactorSolvable;
+}
+
 float LeastSquaresVelocityTrackerStrategy::chooseWeight(uint32_t index) const {
     switch (mWeighting) {
     case WEIGHTING_DELTA: {
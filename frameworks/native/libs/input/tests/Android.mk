@@ -6,7 +6,8 @@ include $(CLEAR_VARS)
 test_src_files := \
     InputChannel_test.cpp \
     InputEvent_test.cpp \
-    InputPublisherAndConsumer_test.cpp
+    InputPublisherAndConsumer_test.cpp \
+    VelocityTracker_benchmark.cpp
 
 shared_libraries := \
     libinput \
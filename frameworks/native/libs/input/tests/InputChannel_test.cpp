@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <gtest/gtest.h>
 #include <input/InputTransport.h>
@@ -155,5 +156,69 @@ TEST_F(InputChannelTest, SendSignal_WhenPeerClosed_ReturnsAnError) {
             << "sendMessage should have returned DEAD_OBJECT";
 }
 
+TEST_F(InputChannelTest, OpenSharedRing_SendsMessagesThroughTheRingInOrder) {
+    sp<InputChannel> serverChannel, clientChannel;
+
+    status_t result = InputChannel::openInputChannelPair(String8("channel name"),
+            serverChannel, clientChannel);
+
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    // A message sent before the ring is opened still comes first.
+    InputMessage serverMsg;
+    memset(&serverMsg, 0, sizeof(InputMessage));
+    serverMsg.header.type = InputMessage::TYPE_KEY;
+    serverMsg.body.key.seq = 1;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg))
+            << "server channel should be able to send message to client channel";
+
+    ASSERT_EQ(OK, serverChannel->openSharedRing(2))
+            << "server channel should be able to open a shared ring";
+    EXPECT_EQ(INVALID_OPERATION, serverChannel->openSharedRing(2))
+            << "server channel should not open a second shared ring";
+
+    serverMsg.body.key.seq = 2;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    serverMsg.body.key.seq = 3;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    serverMsg.body.key.seq = 4;
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->sendMessage(&serverMsg))
+            << "sendMessage should have returned WOULD_BLOCK because the ring is full";
+
+    InputMessage clientMsg;
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg))
+                << "client channel should be able to receive message from server channel";
+        EXPECT_EQ(uint32_t(InputMessage::TYPE_KEY), clientMsg.header.type);
+        EXPECT_EQ(seq, clientMsg.body.key.seq)
+                << "client channel should receive the messages in order";
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg))
+            << "receiveMessage should have returned WOULD_BLOCK";
+
+    // The client waits for a doorbell now, the next message must make its fd readable.
+    serverMsg.body.key.seq = 4;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    pollfd pfd;
+    pfd.fd = clientChannel->getFd();
+    pfd.events = POLLIN;
+    EXPECT_EQ(1, poll(&pfd, 1, 0))
+            << "client channel fd should be readable after the doorbell";
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&clientMsg));
+    EXPECT_EQ(4U, clientMsg.body.key.seq);
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&clientMsg))
+            << "receiveMessage should have consumed the doorbell";
+
+    // The replies still go through the socket.
+    InputMessage clientReply;
+    memset(&clientReply, 0, sizeof(InputMessage));
+    clientReply.header.type = InputMessage::TYPE_FINISHED;
+    clientReply.body.finished.seq = 4;
+    ASSERT_EQ(OK, clientChannel->sendMessage(&clientReply));
+    InputMessage serverReply;
+    ASSERT_EQ(OK, serverChannel->receiveMessage(&serverReply));
+    EXPECT_EQ(4U, serverReply.body.finished.seq);
+}
 
 } // namespace android
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VelocityTrackerBenchmark"
+
+#include <stdio.h>
+
+#include <input/VelocityTracker.h>
+#include <utils/BitSet.h>
+#include <utils/Timers.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+// These benchmarks time the velocity computations of a multi-touch gesture,
+// the way applications run them on every move.  They don't fail on slow
+// results, they only print the average time of each operation.
+class VelocityTrackerBenchmark : public testing::Test {
+protected:
+    enum { ITERATIONS = 10000 };
+
+    // 8ms between the moves, as reported by a 120Hz touch panel.
+    static const nsecs_t MOVE_INTERVAL = 8 * 1000000;
+
+    static void report(const char* name, nsecs_t start) {
+        const nsecs_t duration = systemTime() - start;
+        printf("%-40s %8lld ns/op\n", name,
+                (long long)(duration / ITERATIONS));
+    }
+
+    // adds the next move of pointerCount pointers moving along diagonals
+    static void addMove(VelocityTracker& tracker, uint32_t pointerCount, int move) {
+        BitSet32 idBits;
+        VelocityTracker::Position positions[MAX_POINTERS];
+        for (uint32_t i = 0; i < pointerCount; i++) {
+            idBits.markBit(i);
+            positions[i].x = i * 100 + move * 2.0f;
+            positions[i].y = i * 100 + move * 3.0f + (move % 3) * 0.5f;
+        }
+        tracker.addMovement(move * MOVE_INTERVAL, idBits, positions);
+    }
+
+    // runs a gesture of pointerCount pointers, asking for the velocity of each
+    // pointer queriesPerMove times after each move
+    static void runGesture(const char* strategy, uint32_t pointerCount,
+            uint32_t queriesPerMove, const char* name) {
+        VelocityTracker tracker(strategy);
+        float vx = 0, vy = 0;
+        nsecs_t start = systemTime();
+        for (int move = 0; move < ITERATIONS; move++) {
+            addMove(tracker, pointerCount, move);
+            for (uint32_t q = 0; q < queriesPerMove; q++) {
+                for (uint32_t i = 0; i < pointerCount; i++) {
+                    tracker.getVelocity(i, &vx, &vy);
+                }
+            }
+        }
+        report(name, start);
+        EXPECT_NEAR(2.0f * 1000 / 8, vx, 1.0f);
+    }
+};
+
+TEST_F(VelocityTrackerBenchmark, OneFinger) {
+    runGesture("lsq2", 1, 1, "lsq2, 1 pointer");
+    runGesture("lsq2", 1, 2, "lsq2, 1 pointer, 2 queries");
+}
+
+TEST_F(VelocityTrackerBenchmark, TenFingers) {
+    runGesture("lsq2", 10, 1, "lsq2, 10 pointers");
+    runGesture("lsq2", 10, 2, "lsq2, 10 pointers, 2 queries");
+    runGesture("wlsq2-delta", 10, 1, "wlsq2-delta, 10 pointers");
+}
+
+TEST_F(VelocityTrackerBenchmark, OtherStrategies) {
+    runGesture("lsq3", 10, 1, "lsq3, 10 pointers");
+    runGesture("int1", 10, 1, "int1, 10 pointers");
+}
+
+}; // namespace android
@@ -17,6 +17,7 @@
 #define LOG_TAG "Region"
 
 #include <limits.h>
+#include <string.h>
 
 #include <utils/Log.h>
 #include <utils/String8.h>
@@ -267,8 +268,9 @@ Region& Region::subtractSelf(const Rect& r) {
     return operationSelf(r, op_nand);
 }
 Region& Region::operationSelf(const Rect& r, int op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, r);
+    // the rasterizer only writes the destination once the operation is
+    // done, so there is no need to copy the left operand
+    boolean_operation(op, *this, *this, r);
     return *this;
 }
 
@@ -287,8 +289,7 @@ Region& Region::subtractSelf(const Region& rhs) {
     return operationSelf(rhs, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, int op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, rhs);
+    boolean_operation(op, *this, *this, rhs);
     return *this;
 }
 
@@ -358,8 +359,7 @@ Region& Region::subtractSelf(const Region& rhs, int dx, int dy) {
     return operationSelf(rhs, dx, dy, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, int dx, int dy, int op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, rhs, dx, dy);
+    boolean_operation(op, *this, *this, rhs, dx, dy);
     return *this;
 }
 
@@ -387,87 +387,120 @@ const Region Region::operation(const Region& rhs, int dx, int dy, int op) const
 
 // This is our region rasterizer, which merges rects and spans together
 // to obtain an optimal region.
+// Rects are accumulated in a scratch array, on the stack unless the result
+// is large, and copied into the destination only when the rasterizer is
+// destroyed. This way the destination's storage is resized at most once per
+// operation, and the destination can also be one of the operands.
 class Region::rasterizer : public region_operator<Rect>::region_rasterizer 
 {
+    enum { INLINE_CAPACITY = 64 };
+
     Rect bounds;
     Vector<Rect>& storage;
-    Rect* head;
-    Rect* tail;
-    Vector<Rect> span;
-    Rect* cur;
+    // the previous span is [head, span) and the current one [span, count)
+    size_t head;
+    size_t span;
+    size_t count;
+    Rect inlineRects[INLINE_CAPACITY];
+    Vector<Rect> overflow;
 public:
     rasterizer(Region& reg) 
-        : bounds(INT_MAX, 0, INT_MIN, 0), storage(reg.mStorage), head(), tail(), cur() {
-        storage.clear();
+        : bounds(INT_MAX, 0, INT_MIN, 0), storage(reg.mStorage),
+          head(0), span(0), count(0) {
     }
 
     ~rasterizer() {
-        if (span.size()) {
+        if (count > span) {
             flushSpan();
         }
-        if (storage.size()) {
-            bounds.top = storage.itemAt(0).top;
-            bounds.bottom = storage.top().bottom;
-            if (storage.size() == 1) {
-                storage.clear();
-            }
+        Rect const* const rects = editArray();
+        if (count) {
+            bounds.top = rects[0].top;
+            bounds.bottom = rects[count - 1].bottom;
         } else {
             bounds.left  = 0;
             bounds.right = 0;
         }
-        storage.add(bounds);
+        // a single rect is its own bounds
+        const size_t size = count > 1 ? count + 1 : 1;
+        storage.resize(size);
+        Rect* const dst = storage.editArray();
+        if (count > 1) {
+            memcpy(dst, rects, count * sizeof(Rect));
+        }
+        dst[size - 1] = bounds;
     }
     
     virtual void operator()(const Rect& rect) {
         //ALOGD(">>> %3d, %3d, %3d, %3d",
         //        rect.left, rect.top, rect.right, rect.bottom);
-        if (span.size()) {
-            if (cur->top != rect.top) {
+        if (count > span) {
+            Rect& cur(editArray()[count - 1]);
+            if (cur.top != rect.top) {
                 flushSpan();
-            } else if (cur->right == rect.left) {
-                cur->right = rect.right;
+            } else if (cur.right == rect.left) {
+                cur.right = rect.right;
                 return;
             }
         }
-        span.add(rect);
-        cur = span.editArray() + (span.size() - 1);
+        append(rect);
     }
 private:
     template<typename T> 
     static inline T min(T rhs, T lhs) { return rhs < lhs ? rhs : lhs; }
     template<typename T> 
     static inline T max(T rhs, T lhs) { return rhs > lhs ? rhs : lhs; }
+
+    inline Rect* editArray() {
+        return overflow.isEmpty() ? inlineRects : overflow.editArray();
+    }
+    void append(const Rect& rect) {
+        if (overflow.isEmpty()) {
+            if (count < INLINE_CAPACITY) {
+                inlineRects[count++] = rect;
+                return;
+            }
+            overflow.appendArray(inlineRects, count);
+        }
+        overflow.add(rect);
+        count++;
+    }
+    void removeLastSpan() {
+        if (!overflow.isEmpty()) {
+            overflow.removeItemsAt(span, count - span);
+        }
+        count = span;
+    }
     void flushSpan() {
+        Rect* const rects = editArray();
+        const size_t spanSize = count - span;
         bool merge = false;
-        if (tail-head == ssize_t(span.size())) {
-            Rect const* p = span.editArray();
-            Rect const* q = head;
+        if (span - head == spanSize) {
+            Rect const* p = rects + span;
+            Rect const* q = rects + head;
             if (p->top == q->bottom) {
                 merge = true;
-                while (q != tail) {
-                    if ((p->left != q->left) || (p->right != q->right)) {
+                for (size_t i=0 ; i<spanSize ; i++) {
+                    if ((p[i].left != q[i].left) || (p[i].right != q[i].right)) {
                         merge = false;
                         break;
                     }
-                    p++, q++;
                 }
             }
         }
         if (merge) {
-            const int bottom = span[0].bottom;
-            Rect* r = head;
-            while (r != tail) {
-                r->bottom = bottom;
-                r++;
+            const int bottom = rects[span].bottom;
+            for (size_t i=head ; i<span ; i++) {
+                rects[i].bottom = bottom;
             }
+            // the current span now is part of the previous one
+            removeLastSpan();
         } else {
-            bounds.left = min(span.itemAt(0).left, bounds.left);
-            bounds.right = max(span.top().right, bounds.right);
-            storage.appendVector(span);
-            tail = storage.editArray() + storage.size();
-            head = tail - span.size();
+            bounds.left = min(rects[span].left, bounds.left);
+            bounds.right = max(rects[count - 1].right, bounds.right);
+            head = span;
+            span = count;
         }
-        span.clear();
     }
 };
 
@@ -539,6 +572,141 @@ bool Region::validate(const Region& reg, const char* name, bool silent)
     return result;
 }
 
+// ----------------------------------------------------------------------------
+
+static inline bool rects_overlap(const Rect& a, const Rect& b) {
+    return a.left < b.right && b.left < a.right &&
+            a.top < b.bottom && b.top < a.bottom;
+}
+
+static inline bool rect_contains(const Rect& a, const Rect& b) {
+    return a.left <= b.left && a.top <= b.top &&
+            a.right >= b.right && a.bottom >= b.bottom;
+}
+
+// Combines two non-empty rects when the result is a rect (or is empty),
+// returns false otherwise.
+static bool rect_operation(int op, const Rect& lhs, const Rect& rhs,
+        Rect* result)
+{
+    switch (op) {
+        case op_and:
+            if (rects_overlap(lhs, rhs)) {
+                *result = Rect(
+                        lhs.left   > rhs.left   ? lhs.left   : rhs.left,
+                        lhs.top    > rhs.top    ? lhs.top    : rhs.top,
+                        lhs.right  < rhs.right  ? lhs.right  : rhs.right,
+                        lhs.bottom < rhs.bottom ? lhs.bottom : rhs.bottom);
+            }
+            return true;
+        case op_or:
+            if (rect_contains(lhs, rhs)) {
+                *result = lhs;
+                return true;
+            }
+            if (rect_contains(rhs, lhs)) {
+                *result = rhs;
+                return true;
+            }
+            if (lhs.left == rhs.left && lhs.right == rhs.right &&
+                    lhs.top <= rhs.bottom && rhs.top <= lhs.bottom) {
+                *result = Rect(lhs.left,
+                        lhs.top < rhs.top ? lhs.top : rhs.top,
+                        lhs.right,
+                        lhs.bottom > rhs.bottom ? lhs.bottom : rhs.bottom);
+                return true;
+            }
+            if (lhs.top == rhs.top && lhs.bottom == rhs.bottom &&
+                    lhs.left <= rhs.right && rhs.left <= lhs.right) {
+                *result = Rect(
+                        lhs.left < rhs.left ? lhs.left : rhs.left,
+                        lhs.top,
+                        lhs.right > rhs.right ? lhs.right : rhs.right,
+                        lhs.bottom);
+                return true;
+            }
+            return false;
+        case op_nand:
+            if (!rects_overlap(lhs, rhs)) {
+                *result = lhs;
+                return true;
+            }
+            if (rhs.left <= lhs.left && rhs.right >= lhs.right) {
+                // rhs covers a horizontal band of lhs
+                if (rhs.top <= lhs.top) {
+                    *result = Rect(lhs.left, rhs.bottom, lhs.right, lhs.bottom);
+                    return true;
+                }
+                if (rhs.bottom >= lhs.bottom) {
+                    *result = Rect(lhs.left, lhs.top, lhs.right, rhs.top);
+                    return true;
+                }
+            }
+            if (rhs.top <= lhs.top && rhs.bottom >= lhs.bottom) {
+                // rhs covers a vertical band of lhs
+                if (rhs.left <= lhs.left) {
+                    *result = Rect(rhs.right, lhs.top, lhs.right, lhs.bottom);
+                    return true;
+                }
+                if (rhs.right >= lhs.right) {
+                    *result = Rect(lhs.left, lhs.top, rhs.left, lhs.bottom);
+                    return true;
+                }
+            }
+            return false;
+        case op_xor:
+            return lhs == rhs;
+    }
+    return false;
+}
+
+bool Region::quick_boolean_operation(int op, Region& dst,
+        const Region& lhs, const Rect& rhs, bool rhsIsRect)
+{
+    const Rect bounds(lhs.getBounds());
+    bool keepLhs = false;
+    Rect result(0, 0);
+    if (lhs.isEmpty()) {
+        if (op == op_or || op == op_xor) {
+            if (!rhsIsRect) {
+                return false;
+            }
+            result = rhs;
+        }
+    } else if (rhs.isEmpty()) {
+        keepLhs = (op != op_and);
+    } else if (lhs.isRect() && rhsIsRect) {
+        if (!rect_operation(op, bounds, rhs, &result)) {
+            return false;
+        }
+    } else if (!rects_overlap(bounds, rhs)) {
+        if (op == op_nand) {
+            keepLhs = true;
+        } else if (op != op_and) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    if (keepLhs) {
+        if (&dst != &lhs) {
+            dst = lhs;
+        }
+    } else {
+        if (result.isEmpty()) {
+            result = Rect(0, 0);
+        }
+        if (dst.mStorage.size() == 1) {
+            // reuse the storage, this doesn't allocate unless it's shared
+            dst.mStorage.editItemAt(0) = result;
+        } else {
+            dst.set(result);
+        }
+    }
+    return true;
+}
+
 void Region::boolean_operation(int op, Region& dst,
         const Region& lhs,
         const Region& rhs, int dx, int dy)
@@ -549,6 +717,12 @@ void Region::boolean_operation(int op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+    Rect rhs_bounds(rhs.getBounds());
+    rhs_bounds.offsetBy(dx, dy);
+    if (quick_boolean_operation(op, dst, lhs, rhs_bounds, rhs.isRect())) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -659,6 +833,12 @@ void Region::boolean_operation(int op, Region& dst,
         return;
     }
 
+    Rect rhs_bounds(rhs);
+    rhs_bounds.offsetBy(dx, dy);
+    if (quick_boolean_operation(op, dst, lhs, rhs_bounds, true)) {
+        return;
+    }
+
 #if VALIDATE_WITH_CORECG || VALIDATE_REGIONS
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
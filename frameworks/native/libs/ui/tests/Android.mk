@@ -5,6 +5,7 @@ include $(CLEAR_VARS)
 # Build the unit tests.
 test_src_files := \
     Region_test.cpp \
+    Region_benchmark.cpp \
     vec_test.cpp \
     mat_test.cpp
 
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RegionBenchmark"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ui/Region.h>
+#include <ui/Rect.h>
+#include <utils/Timers.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+// These benchmarks time the region operations SurfaceFlinger runs most
+// often. They don't fail on slow results, they only print the average time
+// of each operation.
+class RegionBenchmark : public testing::Test {
+protected:
+    enum { ITERATIONS = 100000 };
+
+    static void report(const char* name, nsecs_t start) {
+        const nsecs_t duration = systemTime() - start;
+        printf("%-40s %8lld ns/op\n", name,
+                (long long)(duration / ITERATIONS));
+    }
+
+    // returns a region made of a grid of count x count squares
+    static Region grid(int count, int size) {
+        Region r;
+        for (int y = 0; y < count; y++) {
+            for (int x = 0; x < count; x++) {
+                r.orSelf(Rect(x * size * 2, y * size * 2,
+                        x * size * 2 + size, y * size * 2 + size));
+            }
+        }
+        return r;
+    }
+};
+
+TEST_F(RegionBenchmark, RectIntersectRect) {
+    const Region screen(Rect(0, 0, 1080, 1920));
+    const Rect layer(100, 100, 900, 1700);
+    Region r;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = screen;
+        r.andSelf(layer);
+    }
+    report("rect & rect", start);
+    EXPECT_TRUE(r.isRect());
+}
+
+TEST_F(RegionBenchmark, RectSubtractRect) {
+    const Region screen(Rect(0, 0, 1080, 1920));
+    const Rect statusBar(0, 0, 1080, 75);
+    Region r;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = screen;
+        r.subtractSelf(statusBar);
+    }
+    report("rect - covering rect", start);
+    EXPECT_TRUE(r.isRect());
+
+    const Rect dialog(100, 500, 980, 1400);
+    start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = screen;
+        r.subtractSelf(dialog);
+    }
+    report("rect - inner rect", start);
+    EXPECT_FALSE(r.isRect());
+}
+
+TEST_F(RegionBenchmark, RectMergeRect) {
+    const Region top(Rect(0, 0, 1080, 960));
+    const Rect bottom(0, 960, 1080, 1920);
+    const Rect corner(900, 1700, 1080, 1920);
+    Region r;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = top;
+        r.orSelf(bottom);
+    }
+    report("rect | adjacent rect", start);
+    EXPECT_TRUE(r.isRect());
+
+    start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = top;
+        r.orSelf(corner);
+    }
+    report("rect | disjoint rect", start);
+    EXPECT_FALSE(r.isRect());
+}
+
+TEST_F(RegionBenchmark, RegionSubtractDisjoint) {
+    const Region covered(grid(4, 50));
+    const Region layer(Rect(600, 600, 1000, 1000));
+    Region r;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = layer;
+        r.subtractSelf(covered);
+    }
+    report("rect - disjoint region", start);
+    EXPECT_TRUE(r.isRect());
+}
+
+TEST_F(RegionBenchmark, RegionOperations) {
+    const Region lhs(grid(4, 50));
+    const Region rhs(grid(4, 60));
+    Region r;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = lhs;
+        r.orSelf(rhs);
+    }
+    report("grid | grid", start);
+
+    start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = lhs;
+        r.subtractSelf(rhs);
+    }
+    report("grid - grid", start);
+
+    start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = lhs.intersect(rhs);
+    }
+    report("grid & grid", start);
+    EXPECT_FALSE(r.isEmpty());
+}
+
+TEST_F(RegionBenchmark, LargeRegionOperations) {
+    const Region lhs(grid(16, 10));
+    const Region rhs(grid(16, 12));
+    Region r;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < ITERATIONS; i++) {
+        r = lhs.merge(rhs);
+    }
+    report("large grid | large grid", start);
+    EXPECT_FALSE(r.isEmpty());
+}
+
+}; // namespace android
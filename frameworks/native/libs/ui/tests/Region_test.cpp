@@ -53,6 +53,75 @@ protected:
         }
         EXPECT_TRUE((original ^ modified).isEmpty());
     }
+
+    static bool covers(const Region& r, int x, int y) {
+        for (const Rect* rect = r.begin(); rect < r.end(); rect++) {
+            if (x >= rect->left && x < rect->right &&
+                    y >= rect->top && y < rect->bottom) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool covers(const Rect& r, int x, int y) {
+        return x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+    }
+
+    static Rect randomRect(int max) {
+        int l = random() % max, t = random() % max;
+        int r = random() % max, b = random() % max;
+        return Rect(l < r ? l : r, t < b ? t : b, l < r ? r : l, t < b ? b : t);
+    }
+
+    void checkOperation(int op, const Region& result,
+            const Region& lhs, const Region& rhs, int size) {
+        for (int y = -1; y <= size; y++) {
+            for (int x = -1; x <= size; x++) {
+                const bool l = covers(lhs, x, y);
+                const bool r = covers(rhs, x, y);
+                bool expected = false;
+                switch (op) {
+                    case 0: expected = l || r; break;
+                    case 1: expected = l && r; break;
+                    case 2: expected = l && !r; break;
+                    case 3: expected = l != r; break;
+                }
+                ASSERT_EQ(expected, covers(result, x, y))
+                        << "op=" << op << " x=" << x << " y=" << y;
+            }
+        }
+        if (result.isEmpty()) {
+            EXPECT_EQ(Rect(0, 0), result.getBounds());
+        }
+    }
+
+    static Region apply(int op, const Region& lhs, const Region& rhs) {
+        switch (op) {
+            case 0: return lhs.merge(rhs);
+            case 1: return lhs.intersect(rhs);
+            case 2: return lhs.subtract(rhs);
+            default: return lhs.mergeExclusive(rhs);
+        }
+    }
+
+    static Region apply(int op, const Region& lhs, const Rect& rhs) {
+        switch (op) {
+            case 0: return lhs.merge(rhs);
+            case 1: return lhs.intersect(rhs);
+            case 2: return lhs.subtract(rhs);
+            default: return lhs.mergeExclusive(rhs);
+        }
+    }
+
+    static void applySelf(int op, Region& lhs, const Region& rhs) {
+        switch (op) {
+            case 0: lhs.orSelf(rhs); break;
+            case 1: lhs.andSelf(rhs); break;
+            case 2: lhs.subtractSelf(rhs); break;
+            default: lhs.xorSelf(rhs); break;
+        }
+    }
 };
 
 TEST_F(RegionTest, MinimalDivision_TJunction) {
@@ -152,5 +221,77 @@ TEST_F(RegionTest, Random_TJunction) {
     }
 }
 
+TEST_F(RegionTest, RectOperations_Random) {
+    srandom(54321);
+
+    for (int iter = 0; iter < ITER_MAX; iter++) {
+        const Rect lhsRect(randomRect(X_MAX));
+        const Rect rhsRect(randomRect(X_MAX));
+        const Region lhs(lhsRect);
+        const Region rhs(rhsRect);
+        for (int op = 0; op < 4; op++) {
+            checkOperation(op, apply(op, lhs, rhs), lhs, rhs, X_MAX);
+            checkOperation(op, apply(op, lhs, rhsRect), lhs, rhs, X_MAX);
+
+            Region self(lhs);
+            applySelf(op, self, rhs);
+            checkOperation(op, self, lhs, rhs, X_MAX);
+        }
+    }
+}
+
+TEST_F(RegionTest, ComplexOperations_Random) {
+    srandom(24680);
+
+    for (int iter = 0; iter < ITER_MAX; iter++) {
+        Region lhs, rhs;
+        for (int i = 0; i < 3; i++) {
+            lhs.orSelf(randomRect(X_MAX));
+            rhs.orSelf(randomRect(X_MAX));
+        }
+        for (int op = 0; op < 4; op++) {
+            checkOperation(op, apply(op, lhs, rhs), lhs, rhs, X_MAX);
+
+            Region self(lhs);
+            applySelf(op, self, rhs);
+            checkOperation(op, self, lhs, rhs, X_MAX);
+        }
+    }
+}
+
+TEST_F(RegionTest, SelfOperations_Aliasing) {
+    Region r(Rect(0, 0, 4, 4));
+    r.orSelf(Rect(2, 2, 8, 8));
+    const Region original(r);
+
+    Region self(original);
+    self.orSelf(self);
+    checkOperation(0, self, original, original, X_MAX);
+
+    self = original;
+    self.andSelf(self);
+    checkOperation(1, self, original, original, X_MAX);
+
+    self = original;
+    self.subtractSelf(self);
+    EXPECT_TRUE(self.isEmpty());
+
+    self = original;
+    self.xorSelf(self);
+    EXPECT_TRUE(self.isEmpty());
+}
+
+TEST_F(RegionTest, LargeOperations) {
+    // more rects than the rasterizer keeps on the stack
+    Region lhs, rhs;
+    for (int i = 0; i < 32; i++) {
+        lhs.orSelf(Rect(i * 2, 0, i * 2 + 1, 64));
+        rhs.orSelf(Rect(0, i * 2, 64, i * 2 + 1));
+    }
+    for (int op = 0; op < 4; op++) {
+        checkOperation(op, apply(op, lhs, rhs), lhs, rhs, 64);
+    }
+}
+
 }; // namespace android
 
@@ -67,6 +67,26 @@ etc1_uint32 etc1_get_encoded_data_size(etc1_uint32 width, etc1_uint32 height);
 int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
         etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut);
 
+// Encoder quality settings for etc1_encode_image_ex. ETC1_QUALITY_HIGH
+// searches all encodings of a block, like etc1_encode_image.
+// ETC1_QUALITY_MEDIUM only tries the modifier tables close to the spread of
+// each sub-block's colors, ETC1_QUALITY_LOW in addition only tries the more
+// promising of the two block orientations.
+
+#define ETC1_QUALITY_LOW 0
+#define ETC1_QUALITY_MEDIUM 1
+#define ETC1_QUALITY_HIGH 2
+
+// Encode an entire image, like etc1_encode_image.
+// quality - one of the ETC1_QUALITY_* values.
+// numThreads - number of threads to use, including the calling thread. Values
+//              below 2 encode the image on the calling thread only.
+// returns non-zero if there is an error.
+
+int etc1_encode_image_ex(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
+        etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut,
+        int quality, int numThreads);
+
 // Decode an entire image.
 // pIn - pointer to encoded data.
 // pOut - pointer to the image data. Will be written such that
@@ -14,6 +14,8 @@ LOCAL_SRC_FILES:= \
     TokenManager.cpp            \
     TextureObjectManager.cpp    \
     BufferObjectManager.cpp     \
+    CompressedTextureCache.cpp  \
+	tiler.cpp                   \
 	array.cpp.arm		        \
 	fp.cpp.arm		            \
 	light.cpp.arm		        \
@@ -0,0 +1,152 @@
+/*
+** Copyright 2013, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "CompressedTextureCache.h"
+
+#ifndef AGL_COMPRESSED_TEXTURE_CACHE_SIZE
+#define AGL_COMPRESSED_TEXTURE_CACHE_SIZE   (4*1024*1024)
+#endif
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+// Larger textures would push out everything else and are unlikely to be
+// uploaded again anyway.
+static const size_t kMaxCacheSize = AGL_COMPRESSED_TEXTURE_CACHE_SIZE;
+static const size_t kMaxEntrySize = kMaxCacheSize / 4;
+
+CompressedTextureCache& CompressedTextureCache::getInstance()
+{
+    static CompressedTextureCache sInstance;
+    return sInstance;
+}
+
+CompressedTextureCache::CompressedTextureCache()
+    : mTotalSize(0), mUseCount(0)
+{
+}
+
+CompressedTextureCache::~CompressedTextureCache()
+{
+    trimLocked(0);
+}
+
+uint32_t CompressedTextureCache::hash(const void* data, size_t size)
+{
+    // FNV-1a over 32-bit words, the tail bytes are mixed in one at a time.
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t h = 2166136261u;
+    size_t i = 0;
+    for ( ; i+4 <= size ; i+=4) {
+        uint32_t w;
+        memcpy(&w, p+i, 4);
+        h = (h ^ w) * 16777619u;
+    }
+    for ( ; i<size ; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+ssize_t CompressedTextureCache::findLocked(uint32_t hash, GLenum format,
+        GLsizei width, GLsizei height, const void* data, size_t size,
+        size_t decodedSize) const
+{
+    const size_t count = mEntries.size();
+    for (size_t i=0 ; i<count ; i++) {
+        const Entry& e(mEntries[i]);
+        if (e.hash == hash && e.format == format &&
+                e.width == width && e.height == height &&
+                e.size == size && e.decodedSize == decodedSize &&
+                !memcmp(e.data, data, size)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CompressedTextureCache::get(GLenum format, GLsizei width, GLsizei height,
+        const void* data, size_t size, void* decoded, size_t decodedSize)
+{
+    if (size + decodedSize > kMaxEntrySize)
+        return false;
+
+    const uint32_t h = hash(data, size);
+    Mutex::Autolock _l(mLock);
+    ssize_t i = findLocked(h, format, width, height, data, size, decodedSize);
+    if (i < 0)
+        return false;
+
+    Entry& e(mEntries.editItemAt(i));
+    e.lastUse = ++mUseCount;
+    memcpy(decoded, e.data + size, decodedSize);
+    return true;
+}
+
+void CompressedTextureCache::put(GLenum format, GLsizei width, GLsizei height,
+        const void* data, size_t size, const void* decoded, size_t decodedSize)
+{
+    const size_t entrySize = size + decodedSize;
+    if (entrySize > kMaxEntrySize)
+        return;
+
+    const uint32_t h = hash(data, size);
+    Mutex::Autolock _l(mLock);
+    if (findLocked(h, format, width, height, data, size, decodedSize) >= 0)
+        return;
+
+    uint8_t* copy = static_cast<uint8_t*>(malloc(entrySize));
+    if (!copy)
+        return;
+    memcpy(copy, data, size);
+    memcpy(copy + size, decoded, decodedSize);
+
+    trimLocked(kMaxCacheSize - entrySize);
+
+    Entry e;
+    e.hash = h;
+    e.format = format;
+    e.width = width;
+    e.height = height;
+    e.size = size;
+    e.decodedSize = decodedSize;
+    e.lastUse = ++mUseCount;
+    e.data = copy;
+    mEntries.add(e);
+    mTotalSize += entrySize;
+}
+
+void CompressedTextureCache::trimLocked(size_t maxSize)
+{
+    // there are only a few entries, a linear search for the oldest is fine
+    while (mTotalSize > maxSize && !mEntries.isEmpty()) {
+        size_t oldest = 0;
+        const size_t count = mEntries.size();
+        for (size_t i=1 ; i<count ; i++) {
+            if (int32_t(mEntries[i].lastUse - mEntries[oldest].lastUse) < 0)
+                oldest = i;
+        }
+        const Entry& e(mEntries[oldest]);
+        mTotalSize -= e.size + e.decodedSize;
+        free(e.data);
+        mEntries.removeAt(oldest);
+    }
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
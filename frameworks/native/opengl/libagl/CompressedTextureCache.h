@@ -0,0 +1,86 @@
+/*
+** Copyright 2013, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_OPENGLES_COMPRESSED_TEXTURE_CACHE_H
+#define ANDROID_OPENGLES_COMPRESSED_TEXTURE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <GLES/gl.h>
+
+namespace android {
+
+// ----------------------------------------------------------------------------
+
+// Keeps the decoded pixels of recently uploaded compressed textures, so that
+// uploading the same compressed data again (the same asset loaded by another
+// activity or context of the process) is a copy instead of a decode.
+// Entries are found by a hash of the compressed data and matched against a
+// copy of it, and the least recently used ones are dropped when the cache
+// grows over its size limit.
+class CompressedTextureCache
+{
+public:
+    static CompressedTextureCache& getInstance();
+
+    // Copies the cached decoded pixels for the given compressed image into
+    // "decoded", which must be decodedSize bytes. Returns false if the image
+    // is not in the cache.
+    bool        get(GLenum format, GLsizei width, GLsizei height,
+                    const void* data, size_t size,
+                    void* decoded, size_t decodedSize);
+
+    // Adds the decoded pixels of a compressed image to the cache.
+    void        put(GLenum format, GLsizei width, GLsizei height,
+                    const void* data, size_t size,
+                    const void* decoded, size_t decodedSize);
+
+private:
+                CompressedTextureCache();
+                ~CompressedTextureCache();
+
+    struct Entry {
+        uint32_t    hash;
+        GLenum      format;
+        GLsizei     width;
+        GLsizei     height;
+        size_t      size;
+        size_t      decodedSize;
+        uint32_t    lastUse;
+        uint8_t*    data;       // the compressed data, then the decoded pixels
+    };
+
+    static uint32_t hash(const void* data, size_t size);
+    ssize_t     findLocked(uint32_t hash, GLenum format, GLsizei width,
+                    GLsizei height, const void* data, size_t size,
+                    size_t decodedSize) const;
+    void        trimLocked(size_t maxSize);
+
+    mutable Mutex   mLock;
+    Vector<Entry>   mEntries;
+    size_t          mTotalSize;
+    uint32_t        mUseCount;
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
+
+#endif // ANDROID_OPENGLES_COMPRESSED_TEXTURE_CACHE_H
@@ -50,6 +50,7 @@ struct ogles_context_t;
 struct matrixx_t;
 struct transform_t;
 struct buffer_t;
+struct tiler_t;
 
 ogles_context_t* getGlContext();
 
@@ -624,6 +625,7 @@ struct ogles_context_t {
     uint32_t                transformTextures : 1;
     EGLSurfaceManager*      surfaceManager;
     EGLBufferObjectManager* bufferObjectManager;
+    tiler_t*                tiler;
 
     GLenum                  error;
 
@@ -44,6 +44,7 @@
 #include "context.h"
 #include "state.h"
 #include "texture.h"
+#include "tiler.h"
 #include "matrix.h"
 
 #undef NELEM
@@ -1869,6 +1870,11 @@ EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface draw)
     if (d->dpy != dpy)
         return setError(EGL_BAD_DISPLAY, EGL_FALSE);
 
+    // finish rendering into the surface before it's posted
+    if (d->ctx != EGL_NO_CONTEXT) {
+        ogles_flush_tiler((ogles_context_t*)d->ctx);
+    }
+
     // post the surface
     d->swapBuffers();
 
@@ -25,6 +25,7 @@
 #include "matrix.h"
 #include "vertex.h"
 #include "fp.h"
+#include "tiler.h"
 #include "TextureObjectManager.h"
 
 extern "C" void iterators0032(const void* that,
@@ -517,7 +518,7 @@ void primitive_point(ogles_context_t* c, vertex_t* v)
     }
 
     // Render our point...
-    c->rasterizer.procs.pointx(c, v->window.v, c->point.size);
+    ogles_pointx(c, v->window.v, c->point.size);
 }
 
 // ----------------------------------------------------------------------------
@@ -558,7 +559,7 @@ void primitive_line(ogles_context_t* c, vertex_t* v0, vertex_t* v1)
     }
 
     // render our line
-    c->rasterizer.procs.linex(c, v0->window.v, v1->window.v, c->line.width);
+    ogles_linex(c, v0->window.v, v1->window.v, c->line.width);
 }
 
 // ----------------------------------------------------------------------------
@@ -625,7 +626,7 @@ void triangle(ogles_context_t* c,
     if (ggl_likely(enables & mask))
         lerp_triangle(c, v0, v1, v2);
 
-    c->rasterizer.procs.trianglex(c, v0->window.v, v1->window.v, v2->window.v);
+    ogles_trianglex(c, v0->window.v, v1->window.v, v2->window.v);
 }
 
 void lerp_triangle(ogles_context_t* c,
@@ -22,6 +22,8 @@
 #include "state.h"
 #include "texture.h"
 #include "TextureObjectManager.h"
+#include "CompressedTextureCache.h"
+#include "tiler.h"
 
 #include <ETC1/etc1.h>
 
@@ -155,6 +157,8 @@ void ogles_unlock_textures(ogles_context_t* c)
             texture_unit_t& u(c->textures.tmu[i]);
             ANativeWindowBuffer* native_buffer = u.texture->buffer;
             if (native_buffer) {
+                // the buffer must not be used once unlocked
+                ogles_flush_tiler(c);
                 c->rasterizer.procs.activeTexture(c, i);
                 hw_module_t const* pModule;
                 if (hw_get_module(GRALLOC_HARDWARE_MODULE_ID, &pModule))
@@ -363,6 +367,9 @@ int createTextureSurface(ogles_context_t* c,
         GLenum format, GLenum type, GLsizei width, GLsizei height,
         GLenum compressedFormat = 0)
 {
+    // the texture's memory may be reallocated
+    ogles_flush_tiler(c);
+
     // find out which texture is bound to the current unit
     const int active = c->textures.active;
     const GLuint name = c->textures.tmu[active].name;
@@ -746,7 +753,7 @@ static void drawTexxOESImp(GLfixed x, GLfixed y, GLfixed z, GLfixed w, GLfixed h
     c->rasterizer.procs.disable(c, GGL_W_LERP);
     c->rasterizer.procs.disable(c, GGL_AA);
     c->rasterizer.procs.shadeModel(c, GL_FLAT);
-    c->rasterizer.procs.recti(c,
+    ogles_recti(c,
             gglFixedToIntRound(x),
             gglFixedToIntRound(y),
             gglFixedToIntRound(x)+w,
@@ -824,7 +831,7 @@ static void drawTexiOES(GLint x, GLint y, GLint z, GLint w, GLint h, ogles_conte
             c->rasterizer.procs.disable(c, GGL_W_LERP);
             c->rasterizer.procs.disable(c, GGL_AA);
             c->rasterizer.procs.shadeModel(c, GL_FLAT);
-            c->rasterizer.procs.recti(c, x, y, x+w, y+h);
+            ogles_recti(c, x, y, x+w, y+h);
 
             ogles_unlock_textures(c);
 
@@ -907,6 +914,8 @@ void glDeleteTextures(GLsizei n, const GLuint *textures)
         return;
     }
 
+    ogles_flush_tiler(c);
+
     // If deleting a bound texture, bind this unit to 0
     for (int t=0 ; t<GGL_TEXTURE_UNIT_COUNT ; t++) {
         if (c->textures.tmu[t].name == 0)
@@ -1130,12 +1139,20 @@ void glCompressedTexImage2D(
             ogles_error(c, error);
             return;
         }
+        CompressedTextureCache& cache(CompressedTextureCache::getInstance());
+        if (cache.get(internalformat, width, height, data, compressedSize,
+                surface->data, size)) {
+            return;
+        }
         if (etc1_decode_image(
                 (const etc1_byte*)data,
                 (etc1_byte*)surface->data,
                 width, height, 3, surface->stride*3) != 0) {
             ogles_error(c, GL_INVALID_OPERATION);
+            return;
         }
+        cache.put(internalformat, width, height, data, compressedSize,
+                surface->data, size);
         return;
     }
 #endif
@@ -1250,6 +1267,8 @@ void glTexSubImage2D(
         return;
     }
 
+    ogles_flush_tiler(c);
+
     // find out which texture is bound to the current unit
     const int active = c->textures.active;
     EGLTextureObject* tex = c->textures.tmu[active].texture;
@@ -1434,6 +1453,8 @@ void glCopyTexSubImage2D(
         return; // okay, but no-op.
     }
 
+    ogles_flush_tiler(c);
+
     // find out which texture is bound to the current unit
     const int active = c->textures.active;
     EGLTextureObject* tex = c->textures.tmu[active].texture;
@@ -1511,6 +1532,8 @@ void glReadPixels(
         return;
     }
 
+    ogles_flush_tiler(c);
+
     const GGLSurface& readSurface = c->rasterizer.state.buffers.read.s;
     if ((x+width > GLint(readSurface.width)) ||
             (y+height > GLint(readSurface.height))) {
@@ -1624,6 +1647,8 @@ void glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
         return;
     }
 
+    ogles_flush_tiler(c);
+
     // bind it to the texture unit
     sp<EGLTextureObject> tex = getAndBindActiveTextureObject(c);
     tex->setImage(native_buffer);
@@ -0,0 +1,841 @@
+/* libs/opengles/tiler.cpp
+**
+** Copyright 2013, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+#include <utils/threads.h>
+
+#include <pixelflinger/pixelflinger.h>
+
+#include "context.h"
+#include "tiler.h"
+
+namespace android {
+
+// ----------------------------------------------------------------------------
+
+static const int kMaxWorkers = 8;
+
+// height of a band, in pixels. small enough to spread a typical
+// primitive over all the workers, large enough to keep the per-band
+// overhead (scissor, edge setup) low.
+static const int kBandHeight = 32;
+
+// commands recorded before the batch is handed over to the workers
+static const size_t kMaxCommands = 4096;
+
+// when the workers are idle, hand them a batch as soon as it has
+// this many drawing commands, instead of waiting for a flush.
+static const size_t kEagerDraws = 64;
+
+enum {
+    // state
+    OP_SCISSOR,
+    OP_ACTIVE_TEXTURE,
+    OP_BIND_TEXTURE,
+    OP_COLOR_BUFFER,
+    OP_READ_BUFFER,
+    OP_DEPTH_BUFFER,
+    OP_BIND_TEXTURE_LOD,
+    OP_ENABLE,
+    OP_DISABLE,
+    OP_ENABLE_DISABLE,
+    OP_SHADE_MODEL,
+    OP_COLOR_4XV,
+    OP_COLOR_GRAD_12XV,
+    OP_Z_GRAD_3XV,
+    OP_W_GRAD_3XV,
+    OP_FOG_GRAD_3XV,
+    OP_FOG_COLOR_3XV,
+    OP_BLEND_FUNC,
+    OP_TEX_ENVI,
+    OP_TEX_ENVXV,
+    OP_TEX_PARAMETERI,
+    OP_TEX_COORD_2I,
+    OP_TEX_COORD_GRAD_SCALE_8XV,
+    OP_TEX_GENI,
+    OP_COLOR_MASK,
+    OP_DEPTH_MASK,
+    OP_STENCIL_MASK,
+    OP_ALPHA_FUNCX,
+    OP_DEPTH_FUNC,
+    OP_LOGIC_OP,
+    OP_CLEAR_COLORX,
+    OP_CLEAR_DEPTHX,
+    OP_CLEAR_STENCIL,
+
+    // drawing, these are binned
+    OP_FIRST_DRAW,
+    OP_POINTX = OP_FIRST_DRAW,
+    OP_LINEX,
+    OP_RECTI,
+    OP_TRIANGLEX,
+    OP_CLEAR,
+};
+
+struct command_t {
+    uint32_t        op;
+    GGLint          top;        // rows touched by a drawing command
+    GGLint          bottom;
+    GGLint          a[4];       // scalar arguments
+    union {
+        GGLfixed    v[12];      // vector arguments
+        GGLSurface  surface;
+    };
+};
+
+struct batch_t {
+    command_t*      commands;
+    size_t          count;
+    size_t          draws;
+};
+
+struct worker_t {
+    tiler_t*        tiler;
+    GGLContext*     ggl;
+    int             index;
+    pthread_t       thread;
+    uint32_t        generation;
+
+    // the scissor requested by the context, and the one last given
+    // to our pixelflinger context.
+    bool            scissorEnabled;
+    GGLint          scissor[4];
+    GGLint          current[4];
+    GGLint          width;
+    GGLint          height;
+};
+
+struct gl::tiler_t {
+    // the pixelflinger procs we replaced in the context
+    GGLContext      procs;
+
+    Mutex           lock;
+    Condition       workCondition;
+    Condition       doneCondition;
+    uint32_t        generation;
+    int             busy;
+    bool            exiting;
+    const batch_t*  published;
+
+    batch_t         batches[2];
+    batch_t*        recording;
+
+    int             numWorkers;
+    worker_t        workers[kMaxWorkers];
+};
+
+// ----------------------------------------------------------------------------
+#if 0
+#pragma mark -
+#pragma mark Replay
+#endif
+
+static void set_scissor(worker_t* w, GGLint l, GGLint t, GGLint r, GGLint b)
+{
+    if (l != w->current[0] || t != w->current[1] ||
+        r != w->current[2] || b != w->current[3]) {
+        w->current[0] = l;
+        w->current[1] = t;
+        w->current[2] = r;
+        w->current[3] = b;
+        w->ggl->scissor(w->ggl, l, t, r-l, b-t);
+    }
+}
+
+static void replay_state(worker_t* w, const command_t& cmd)
+{
+    GGLContext* const ggl = w->ggl;
+    const GGLint* a = cmd.a;
+    switch (cmd.op) {
+    case OP_SCISSOR:
+        // applied per band, see replay_draw()
+        w->scissor[0] = a[0];
+        w->scissor[1] = a[1];
+        w->scissor[2] = a[0] + a[2];
+        w->scissor[3] = a[1] + a[3];
+        break;
+    case OP_ACTIVE_TEXTURE:
+        ggl->activeTexture(ggl, a[0]);
+        break;
+    case OP_BIND_TEXTURE:
+        ggl->bindTexture(ggl, &cmd.surface);
+        break;
+    case OP_COLOR_BUFFER:
+        w->width = cmd.surface.width;
+        w->height = cmd.surface.height;
+        ggl->colorBuffer(ggl, &cmd.surface);
+        break;
+    case OP_READ_BUFFER:
+        ggl->readBuffer(ggl, &cmd.surface);
+        break;
+    case OP_DEPTH_BUFFER:
+        ggl->depthBuffer(ggl, &cmd.surface);
+        break;
+    case OP_BIND_TEXTURE_LOD:
+        ggl->bindTextureLod(ggl, a[0], &cmd.surface);
+        break;
+    case OP_ENABLE:
+    case OP_DISABLE:
+    case OP_ENABLE_DISABLE: {
+        const GGLboolean en = (cmd.op == OP_ENABLE_DISABLE) ? a[1] :
+                              (cmd.op == OP_ENABLE);
+        if (GGLenum(a[0]) == GGL_SCISSOR_TEST) {
+            // our context always scissors, to its band
+            w->scissorEnabled = en;
+        } else {
+            ggl->enableDisable(ggl, a[0], en);
+        }
+        break;
+    }
+    case OP_SHADE_MODEL:
+        ggl->shadeModel(ggl, a[0]);
+        break;
+    case OP_COLOR_4XV:
+        ggl->color4xv(ggl, cmd.v);
+        break;
+    case OP_COLOR_GRAD_12XV:
+        ggl->colorGrad12xv(ggl, cmd.v);
+        break;
+    case OP_Z_GRAD_3XV:
+        ggl->zGrad3xv(ggl, reinterpret_cast<const GGLfixed32*>(cmd.v));
+        break;
+    case OP_W_GRAD_3XV:
+        ggl->wGrad3xv(ggl, cmd.v);
+        break;
+    case OP_FOG_GRAD_3XV:
+        ggl->fogGrad3xv(ggl, cmd.v);
+        break;
+    case OP_FOG_COLOR_3XV:
+        ggl->fogColor3xv(ggl, cmd.v);
+        break;
+    case OP_BLEND_FUNC:
+        ggl->blendFunc(ggl, a[0], a[1]);
+        break;
+    case OP_TEX_ENVI:
+        ggl->texEnvi(ggl, a[0], a[1], a[2]);
+        break;
+    case OP_TEX_ENVXV:
+        ggl->texEnvxv(ggl, a[0], a[1], cmd.v);
+        break;
+    case OP_TEX_PARAMETERI:
+        ggl->texParameteri(ggl, a[0], a[1], a[2]);
+        break;
+    case OP_TEX_COORD_2I:
+        ggl->texCoord2i(ggl, a[0], a[1]);
+        break;
+    case OP_TEX_COORD_GRAD_SCALE_8XV:
+        ggl->texCoordGradScale8xv(ggl, a[0], cmd.v);
+        break;
+    case OP_TEX_GENI:
+        ggl->texGeni(ggl, a[0], a[1], a[2]);
+        break;
+    case OP_COLOR_MASK:
+        ggl->colorMask(ggl, a[0], a[1], a[2], a[3]);
+        break;
+    case OP_DEPTH_MASK:
+        ggl->depthMask(ggl, a[0]);
+        break;
+    case OP_STENCIL_MASK:
+        ggl->stencilMask(ggl, a[0]);
+        break;
+    case OP_ALPHA_FUNCX:
+        ggl->alphaFuncx(ggl, a[0], a[1]);
+        break;
+    case OP_DEPTH_FUNC:
+        ggl->depthFunc(ggl, a[0]);
+        break;
+    case OP_LOGIC_OP:
+        ggl->logicOp(ggl, a[0]);
+        break;
+    case OP_CLEAR_COLORX:
+        ggl->clearColorx(ggl, a[0], a[1], a[2], a[3]);
+        break;
+    case OP_CLEAR_DEPTHX:
+        ggl->clearDepthx(ggl, a[0]);
+        break;
+    case OP_CLEAR_STENCIL:
+        ggl->clearStencil(ggl, a[0]);
+        break;
+    }
+}
+
+static void replay_draw(worker_t* w, const command_t& cmd)
+{
+    GGLContext* const ggl = w->ggl;
+    const int n = w->tiler->numWorkers;
+
+    GGLint l = 0, t = 0, r = w->width, b = w->height;
+    if (w->scissorEnabled) {
+        l = max(l, w->scissor[0]);
+        t = max(t, w->scissor[1]);
+        r = min(r, w->scissor[2]);
+        b = min(b, w->scissor[3]);
+    }
+    const GGLint top = max(t, cmd.top);
+    const GGLint bottom = min(b, cmd.bottom);
+    if (l >= r || top >= bottom)
+        return;
+
+    // first band at or after 'top' that belongs to us
+    int band = top / kBandHeight;
+    band += (w->index - band % n + n) % n;
+
+    for ( ; band*kBandHeight < bottom ; band += n) {
+        const GGLint bt = max(t, band*kBandHeight);
+        const GGLint bb = min(b, (band+1)*kBandHeight);
+        if (bt >= bb)
+            continue;
+        set_scissor(w, l, bt, r, bb);
+        switch (cmd.op) {
+        case OP_POINTX:
+            ggl->pointx(ggl, cmd.v, cmd.a[0]);
+            break;
+        case OP_LINEX:
+            ggl->linex(ggl, cmd.v, cmd.v+4, cmd.a[0]);
+            break;
+        case OP_RECTI:
+            ggl->recti(ggl, cmd.a[0], cmd.a[1], cmd.a[2], cmd.a[3]);
+            break;
+        case OP_TRIANGLEX:
+            ggl->trianglex(ggl, cmd.v, cmd.v+4, cmd.v+8);
+            break;
+        case OP_CLEAR:
+            ggl->clear(ggl, cmd.a[0]);
+            break;
+        }
+    }
+}
+
+static void* worker_loop(void* arg)
+{
+    worker_t* w = static_cast<worker_t*>(arg);
+    tiler_t* t = w->tiler;
+    for (;;) {
+        const batch_t* batch;
+        { // scope for the lock
+            Mutex::Autolock _l(t->lock);
+            while (!t->exiting && w->generation == t->generation) {
+                t->workCondition.wait(t->lock);
+            }
+            if (t->exiting)
+                break;
+            w->generation = t->generation;
+            batch = t->published;
+        }
+
+        const command_t* cmd = batch->commands;
+        const command_t* const end = cmd + batch->count;
+        for ( ; cmd < end ; cmd++) {
+            if (cmd->op >= OP_FIRST_DRAW) {
+                replay_draw(w, *cmd);
+            } else {
+                replay_state(w, *cmd);
+            }
+        }
+
+        Mutex::Autolock _l(t->lock);
+        if (--t->busy == 0) {
+            t->doneCondition.signal();
+        }
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+#if 0
+#pragma mark -
+#pragma mark Recording
+#endif
+
+static void kick(tiler_t* t)
+{
+    batch_t* batch = t->recording;
+    { // scope for the lock
+        Mutex::Autolock _l(t->lock);
+        while (t->busy) {
+            t->doneCondition.wait(t->lock);
+        }
+        t->published = batch;
+        t->busy = t->numWorkers;
+        t->generation++;
+        t->workCondition.broadcast();
+    }
+    // the other batch isn't used by the workers anymore
+    t->recording = (batch == &t->batches[0]) ? &t->batches[1] : &t->batches[0];
+    t->recording->count = 0;
+    t->recording->draws = 0;
+}
+
+static inline command_t* record(ogles_context_t* c, uint32_t op)
+{
+    batch_t* batch = c->tiler->recording;
+    if (ggl_unlikely(batch->count == kMaxCommands)) {
+        kick(c->tiler);
+        batch = c->tiler->recording;
+    }
+    command_t* cmd = batch->commands + batch->count++;
+    cmd->op = op;
+    return cmd;
+}
+
+static void record_draw(ogles_context_t* c, command_t* cmd,
+        GGLcoord top, GGLcoord bottom)
+{
+    // coordinates are 28.4, round outward
+    cmd->top = top >> TRI_FRACTION_BITS;
+    cmd->bottom = (bottom + TRI_ONE - 1) >> TRI_FRACTION_BITS;
+    // allow for the rasterizer rounding the other way
+    cmd->top -= 1;
+    cmd->bottom += 1;
+
+    tiler_t* t = c->tiler;
+    if (++t->recording->draws >= kEagerDraws && !t->busy) {
+        // the workers are idle, give them something to do.
+        // (reading 'busy' without the lock is fine, at worst we're late)
+        kick(t);
+    }
+}
+
+static inline ogles_context_t* context(void* con) {
+    return static_cast<ogles_context_t*>(con);
+}
+
+static inline const GGLContext& procs(void* con) {
+    return context(con)->tiler->procs;
+}
+
+static void tiler_scissor(void* con,
+        GGLint x, GGLint y, GGLsizei w, GGLsizei h) {
+    procs(con).scissor(con, x, y, w, h);
+    command_t* cmd = record(context(con), OP_SCISSOR);
+    cmd->a[0] = x;
+    cmd->a[1] = y;
+    cmd->a[2] = w;
+    cmd->a[3] = h;
+}
+
+static void tiler_activeTexture(void* con, GGLuint tmu) {
+    procs(con).activeTexture(con, tmu);
+    record(context(con), OP_ACTIVE_TEXTURE)->a[0] = tmu;
+}
+
+static void tiler_bindTexture(void* con, const GGLSurface* surface) {
+    procs(con).bindTexture(con, surface);
+    record(context(con), OP_BIND_TEXTURE)->surface = *surface;
+}
+
+static void tiler_colorBuffer(void* con, const GGLSurface* surface) {
+    procs(con).colorBuffer(con, surface);
+    record(context(con), OP_COLOR_BUFFER)->surface = *surface;
+}
+
+static void tiler_readBuffer(void* con, const GGLSurface* surface) {
+    procs(con).readBuffer(con, surface);
+    record(context(con), OP_READ_BUFFER)->surface = *surface;
+}
+
+static void tiler_depthBuffer(void* con, const GGLSurface* surface) {
+    procs(con).depthBuffer(con, surface);
+    record(context(con), OP_DEPTH_BUFFER)->surface = *surface;
+}
+
+static void tiler_bindTextureLod(void* con,
+        GGLuint tmu, const GGLSurface* surface) {
+    procs(con).bindTextureLod(con, tmu, surface);
+    command_t* cmd = record(context(con), OP_BIND_TEXTURE_LOD);
+    cmd->a[0] = tmu;
+    cmd->surface = *surface;
+}
+
+static void tiler_enable(void* con, GGLenum name) {
+    procs(con).enable(con, name);
+    record(context(con), OP_ENABLE)->a[0] = name;
+}
+
+static void tiler_disable(void* con, GGLenum name) {
+    procs(con).disable(con, name);
+    record(context(con), OP_DISABLE)->a[0] = name;
+}
+
+static void tiler_enableDisable(void* con, GGLenum name, GGLboolean en) {
+    procs(con).enableDisable(con, name, en);
+    command_t* cmd = record(context(con), OP_ENABLE_DISABLE);
+    cmd->a[0] = name;
+    cmd->a[1] = en;
+}
+
+static void tiler_shadeModel(void* con, GGLenum mode) {
+    procs(con).shadeModel(con, mode);
+    record(context(con), OP_SHADE_MODEL)->a[0] = mode;
+}
+
+static void tiler_color4xv(void* con, const GGLclampx* color) {
+    procs(con).color4xv(con, color);
+    memcpy(record(context(con), OP_COLOR_4XV)->v, color, 4*sizeof(GGLclampx));
+}
+
+static void tiler_colorGrad12xv(void* con, const GGLcolor* grad) {
+    procs(con).colorGrad12xv(con, grad);
+    memcpy(record(context(con), OP_COLOR_GRAD_12XV)->v, grad, 12*sizeof(GGLcolor));
+}
+
+static void tiler_zGrad3xv(void* con, const GGLfixed32* grad) {
+    procs(con).zGrad3xv(con, grad);
+    memcpy(record(context(con), OP_Z_GRAD_3XV)->v, grad, 3*sizeof(GGLfixed32));
+}
+
+static void tiler_wGrad3xv(void* con, const GGLfixed* grad) {
+    procs(con).wGrad3xv(con, grad);
+    memcpy(record(context(con), OP_W_GRAD_3XV)->v, grad, 3*sizeof(GGLfixed));
+}
+
+static void tiler_fogGrad3xv(void* con, const GGLfixed* grad) {
+    procs(con).fogGrad3xv(con, grad);
+    memcpy(record(context(con), OP_FOG_GRAD_3XV)->v, grad, 3*sizeof(GGLfixed));
+}
+
+static void tiler_fogColor3xv(void* con, const GGLclampx* color) {
+    procs(con).fogColor3xv(con, color);
+    memcpy(record(context(con), OP_FOG_COLOR_3XV)->v, color, 3*sizeof(GGLclampx));
+}
+
+static void tiler_blendFunc(void* con, GGLenum src, GGLenum dst) {
+    procs(con).blendFunc(con, src, dst);
+    command_t* cmd = record(context(con), OP_BLEND_FUNC);
+    cmd->a[0] = src;
+    cmd->a[1] = dst;
+}
+
+static void tiler_texEnvi(void* con,
+        GGLenum target, GGLenum pname, GGLint param) {
+    procs(con).texEnvi(con, target, pname, param);
+    command_t* cmd = record(context(con), OP_TEX_ENVI);
+    cmd->a[0] = target;
+    cmd->a[1] = pname;
+    cmd->a[2] = param;
+}
+
+static void tiler_texEnvxv(void* con,
+        GGLenum target, GGLenum pname, const GGLfixed* params) {
+    procs(con).texEnvxv(con, target, pname, params);
+    command_t* cmd = record(context(con), OP_TEX_ENVXV);
+    cmd->a[0] = target;
+    cmd->a[1] = pname;
+    const size_t n = (pname == GGL_TEXTURE_ENV_COLOR) ? 4 : 1;
+    memcpy(cmd->v, params, n*sizeof(GGLfixed));
+}
+
+static void tiler_texParameteri(void* con,
+        GGLenum target, GGLenum pname, GGLint param) {
+    procs(con).texParameteri(con, target, pname, param);
+    command_t* cmd = record(context(con), OP_TEX_PARAMETERI);
+    cmd->a[0] = target;
+    cmd->a[1] = pname;
+    cmd->a[2] = param;
+}
+
+static void tiler_texCoord2i(void* con, GGLint s, GGLint t) {
+    procs(con).texCoord2i(con, s, t);
+    command_t* cmd = record(context(con), OP_TEX_COORD_2I);
+    cmd->a[0] = s;
+    cmd->a[1] = t;
+}
+
+static void tiler_texCoordGradScale8xv(void* con,
+        GGLint tmu, const int32_t* grad8) {
+    procs(con).texCoordGradScale8xv(con, tmu, grad8);
+    command_t* cmd = record(context(con), OP_TEX_COORD_GRAD_SCALE_8XV);
+    cmd->a[0] = tmu;
+    memcpy(cmd->v, grad8, 8*sizeof(int32_t));
+}
+
+static void tiler_texGeni(void* con,
+        GGLenum coord, GGLenum pname, GGLint param) {
+    procs(con).texGeni(con, coord, pname, param);
+    command_t* cmd = record(context(con), OP_TEX_GENI);
+    cmd->a[0] = coord;
+    cmd->a[1] = pname;
+    cmd->a[2] = param;
+}
+
+static void tiler_colorMask(void* con,
+        GGLboolean r, GGLboolean g, GGLboolean b, GGLboolean a) {
+    procs(con).colorMask(con, r, g, b, a);
+    command_t* cmd = record(context(con), OP_COLOR_MASK);
+    cmd->a[0] = r;
+    cmd->a[1] = g;
+    cmd->a[2] = b;
+    cmd->a[3] = a;
+}
+
+static void tiler_depthMask(void* con, GGLboolean flag) {
+    procs(con).depthMask(con, flag);
+    record(context(con), OP_DEPTH_MASK)->a[0] = flag;
+}
+
+static void tiler_stencilMask(void* con, GGLuint mask) {
+    procs(con).stencilMask(con, mask);
+    record(context(con), OP_STENCIL_MASK)->a[0] = mask;
+}
+
+static void tiler_alphaFuncx(void* con, GGLenum func, GGLclampx ref) {
+    procs(con).alphaFuncx(con, func, ref);
+    command_t* cmd = record(context(con), OP_ALPHA_FUNCX);
+    cmd->a[0] = func;
+    cmd->a[1] = ref;
+}
+
+static void tiler_depthFunc(void* con, GGLenum func) {
+    procs(con).depthFunc(con, func);
+    record(context(con), OP_DEPTH_FUNC)->a[0] = func;
+}
+
+static void tiler_logicOp(void* con, GGLenum opcode) {
+    procs(con).logicOp(con, opcode);
+    record(context(con), OP_LOGIC_OP)->a[0] = opcode;
+}
+
+static void tiler_clearColorx(void* con,
+        GGLclampx r, GGLclampx g, GGLclampx b, GGLclampx a) {
+    procs(con).clearColorx(con, r, g, b, a);
+    command_t* cmd = record(context(con), OP_CLEAR_COLORX);
+    cmd->a[0] = r;
+    cmd->a[1] = g;
+    cmd->a[2] = b;
+    cmd->a[3] = a;
+}
+
+static void tiler_clearDepthx(void* con, GGLclampx depth) {
+    procs(con).clearDepthx(con, depth);
+    record(context(con), OP_CLEAR_DEPTHX)->a[0] = depth;
+}
+
+static void tiler_clearStencil(void* con, GGLint s) {
+    procs(con).clearStencil(con, s);
+    record(context(con), OP_CLEAR_STENCIL)->a[0] = s;
+}
+
+// ----------------------------------------------------------------------------
+
+void ogles_tiler_pointx(ogles_context_t* c, const GGLcoord* v, GGLcoord r)
+{
+    command_t* cmd = record(c, OP_POINTX);
+    memcpy(cmd->v, v, 4*sizeof(GGLcoord));
+    cmd->a[0] = r;
+    record_draw(c, cmd, v[1] - r, v[1] + r);
+}
+
+void ogles_tiler_linex(ogles_context_t* c,
+        const GGLcoord* v0, const GGLcoord* v1, GGLcoord width)
+{
+    command_t* cmd = record(c, OP_LINEX);
+    memcpy(cmd->v,   v0, 4*sizeof(GGLcoord));
+    memcpy(cmd->v+4, v1, 4*sizeof(GGLcoord));
+    cmd->a[0] = width;
+    record_draw(c, cmd, min(v0[1], v1[1]) - width, max(v0[1], v1[1]) + width);
+}
+
+void ogles_tiler_recti(ogles_context_t* c,
+        GGLint l, GGLint t, GGLint r, GGLint b)
+{
+    command_t* cmd = record(c, OP_RECTI);
+    cmd->a[0] = l;
+    cmd->a[1] = t;
+    cmd->a[2] = r;
+    cmd->a[3] = b;
+    record_draw(c, cmd, t << TRI_FRACTION_BITS, b << TRI_FRACTION_BITS);
+}
+
+void ogles_tiler_trianglex(ogles_context_t* c,
+        const GGLcoord* v0, const GGLcoord* v1, const GGLcoord* v2)
+{
+    command_t* cmd = record(c, OP_TRIANGLEX);
+    memcpy(cmd->v,   v0, 4*sizeof(GGLcoord));
+    memcpy(cmd->v+4, v1, 4*sizeof(GGLcoord));
+    memcpy(cmd->v+8, v2, 4*sizeof(GGLcoord));
+    record_draw(c, cmd, min(v0[1], v1[1], v2[1]), max(v0[1], v1[1], v2[1]));
+}
+
+void ogles_tiler_clear(ogles_context_t* c, GGLbitfield mask)
+{
+    command_t* cmd = record(c, OP_CLEAR);
+    cmd->a[0] = mask;
+    cmd->top = 0;
+    cmd->bottom = INT_MAX;
+}
+
+void ogles_flush_tiler(ogles_context_t* c)
+{
+    tiler_t* t = c->tiler;
+    if (!t)
+        return;
+    if (t->recording->count) {
+        kick(t);
+    }
+    Mutex::Autolock _l(t->lock);
+    while (t->busy) {
+        t->doneCondition.wait(t->lock);
+    }
+}
+
+// ----------------------------------------------------------------------------
+#if 0
+#pragma mark -
+#pragma mark Init
+#endif
+
+static int tiler_num_workers()
+{
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.libagl.tiler.threads", value, "0");
+    int n = atoi(value);
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (cpus > 0 && n > cpus)
+        n = cpus;
+    if (n > kMaxWorkers)
+        n = kMaxWorkers;
+    // a single worker would only add latency
+    return (n >= 2) ? n : 0;
+}
+
+void ogles_init_tiler(ogles_context_t* c)
+{
+    // this must happen before the context sets any pixelflinger state,
+    // since the workers only see what's recorded.
+    const int n = tiler_num_workers();
+    if (!n)
+        return;
+
+    tiler_t* t = new tiler_t;
+    t->generation = 0;
+    t->busy = 0;
+    t->exiting = false;
+    t->published = 0;
+    t->numWorkers = 0;
+    for (int i=0 ; i<2 ; i++) {
+        t->batches[i].commands =
+                (command_t*)malloc(kMaxCommands * sizeof(command_t));
+        t->batches[i].count = 0;
+        t->batches[i].draws = 0;
+    }
+    t->recording = &t->batches[0];
+    if (!t->batches[0].commands || !t->batches[1].commands) {
+        free(t->batches[0].commands);
+        free(t->batches[1].commands);
+        delete t;
+        return;
+    }
+
+    for (int i=0 ; i<n ; i++) {
+        worker_t& w(t->workers[t->numWorkers]);
+        w.tiler = t;
+        w.index = t->numWorkers;
+        w.generation = 0;
+        w.scissorEnabled = false;
+        w.width = w.height = 0;
+        w.scissor[0] = w.scissor[1] = 0;
+        w.scissor[2] = w.scissor[3] = INT_MAX;
+        memset(w.current, 0xFF, sizeof(w.current));
+        w.ggl = 0;
+        gglInit(&w.ggl);
+        if (!w.ggl)
+            break;
+        w.ggl->enable(w.ggl, GGL_SCISSOR_TEST);
+        if (pthread_create(&w.thread, NULL, worker_loop, &w)) {
+            gglUninit(w.ggl);
+            break;
+        }
+        t->numWorkers++;
+    }
+    if (t->numWorkers < 2) {
+        c->tiler = t;
+        ogles_uninit_tiler(c);
+        return;
+    }
+
+    // record the state changes, and forward them to the context
+    GGLContext& procs(c->rasterizer.procs);
+    t->procs = procs;
+    procs.scissor               = tiler_scissor;
+    procs.activeTexture         = tiler_activeTexture;
+    procs.bindTexture           = tiler_bindTexture;
+    procs.colorBuffer           = tiler_colorBuffer;
+    procs.readBuffer            = tiler_readBuffer;
+    procs.depthBuffer           = tiler_depthBuffer;
+    procs.bindTextureLod        = tiler_bindTextureLod;
+    procs.enable                = tiler_enable;
+    procs.disable               = tiler_disable;
+    procs.enableDisable         = tiler_enableDisable;
+    procs.shadeModel            = tiler_shadeModel;
+    procs.color4xv              = tiler_color4xv;
+    procs.colorGrad12xv         = tiler_colorGrad12xv;
+    procs.zGrad3xv              = tiler_zGrad3xv;
+    procs.wGrad3xv              = tiler_wGrad3xv;
+    procs.fogGrad3xv            = tiler_fogGrad3xv;
+    procs.fogColor3xv           = tiler_fogColor3xv;
+    procs.blendFunc             = tiler_blendFunc;
+    procs.texEnvi               = tiler_texEnvi;
+    procs.texEnvxv              = tiler_texEnvxv;
+    procs.texParameteri         = tiler_texParameteri;
+    procs.texCoord2i            = tiler_texCoord2i;
+    procs.texCoordGradScale8xv  = tiler_texCoordGradScale8xv;
+    procs.texGeni               = tiler_texGeni;
+    procs.colorMask             = tiler_colorMask;
+    procs.depthMask             = tiler_depthMask;
+    procs.stencilMask           = tiler_stencilMask;
+    procs.alphaFuncx            = tiler_alphaFuncx;
+    procs.depthFunc             = tiler_depthFunc;
+    procs.logicOp               = tiler_logicOp;
+    procs.clearColorx           = tiler_clearColorx;
+    procs.clearDepthx           = tiler_clearDepthx;
+    procs.clearStencil          = tiler_clearStencil;
+
+    c->tiler = t;
+    ALOGD("context %p: rendering with %d tiler threads", c, t->numWorkers);
+}
+
+void ogles_uninit_tiler(ogles_context_t* c)
+{
+    tiler_t* t = c->tiler;
+    if (!t)
+        return;
+
+    ogles_flush_tiler(c);
+    { // scope for the lock
+        Mutex::Autolock _l(t->lock);
+        t->exiting = true;
+        t->workCondition.broadcast();
+    }
+    for (int i=0 ; i<t->numWorkers ; i++) {
+        pthread_join(t->workers[i].thread, NULL);
+        gglUninit(t->workers[i].ggl);
+    }
+    free(t->batches[0].commands);
+    free(t->batches[1].commands);
+    delete t;
+    c->tiler = 0;
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
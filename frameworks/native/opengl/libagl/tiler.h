@@ -0,0 +1,97 @@
+/* libs/opengles/tiler.h
+**
+** Copyright 2013, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef ANDROID_OPENGLES_TILER_H
+#define ANDROID_OPENGLES_TILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "context.h"
+
+namespace android {
+
+/*
+ * The tiler is an optional, per context, multi-threaded rasterizer backend.
+ * When it's enabled, the pixelflinger calls made by the context are recorded
+ * instead of executed and replayed by a pool of worker threads, each with
+ * its own pixelflinger context. The framebuffer is split in bands of rows,
+ * every worker owns a set of bands and only draws the primitives that touch
+ * them, with its scissor clipped to the band. Primitives are drawn in the
+ * order they were issued in every band, so the result is the same as
+ * rendering on the calling thread.
+ *
+ * The number of workers is taken from the debug.libagl.tiler.threads
+ * property when the context is created, 0 (the default) disables the tiler.
+ *
+ * Anything that reads or writes pixels outside of pixelflinger, or releases
+ * memory the recorded commands may still refer to (textures, surfaces),
+ * must call ogles_flush_tiler() first.
+ */
+
+void ogles_init_tiler(ogles_context_t* c);
+void ogles_uninit_tiler(ogles_context_t* c);
+
+// Waits until everything recorded so far has been rendered.
+void ogles_flush_tiler(ogles_context_t* c);
+
+void ogles_tiler_pointx(ogles_context_t* c, const GGLcoord* v, GGLcoord r);
+void ogles_tiler_linex(ogles_context_t* c,
+        const GGLcoord* v0, const GGLcoord* v1, GGLcoord width);
+void ogles_tiler_recti(ogles_context_t* c,
+        GGLint l, GGLint t, GGLint r, GGLint b);
+void ogles_tiler_trianglex(ogles_context_t* c,
+        const GGLcoord* v0, const GGLcoord* v1, const GGLcoord* v2);
+void ogles_tiler_clear(ogles_context_t* c, GGLbitfield mask);
+
+// ----------------------------------------------------------------------------
+// These must be used instead of the corresponding pixelflinger procs.
+// pixelflinger replaces its drawing procs when its state changes, so they
+// can't be intercepted like the state procs are.
+
+inline void ogles_pointx(ogles_context_t* c, const GGLcoord* v, GGLcoord r) {
+    if (ggl_unlikely(c->tiler))     ogles_tiler_pointx(c, v, r);
+    else                            c->rasterizer.procs.pointx(c, v, r);
+}
+
+inline void ogles_linex(ogles_context_t* c,
+        const GGLcoord* v0, const GGLcoord* v1, GGLcoord width) {
+    if (ggl_unlikely(c->tiler))     ogles_tiler_linex(c, v0, v1, width);
+    else                            c->rasterizer.procs.linex(c, v0, v1, width);
+}
+
+inline void ogles_recti(ogles_context_t* c,
+        GGLint l, GGLint t, GGLint r, GGLint b) {
+    if (ggl_unlikely(c->tiler))     ogles_tiler_recti(c, l, t, r, b);
+    else                            c->rasterizer.procs.recti(c, l, t, r, b);
+}
+
+inline void ogles_trianglex(ogles_context_t* c,
+        const GGLcoord* v0, const GGLcoord* v1, const GGLcoord* v2) {
+    if (ggl_unlikely(c->tiler))     ogles_tiler_trianglex(c, v0, v1, v2);
+    else                            c->rasterizer.procs.trianglex(c, v0, v1, v2);
+}
+
+inline void ogles_clear(ogles_context_t* c, GGLbitfield mask) {
+    if (ggl_unlikely(c->tiler))     ogles_tiler_clear(c, mask);
+    else                            c->rasterizer.procs.clear(c, mask);
+}
+
+}; // namespace android
+
+#endif // ANDROID_OPENGLES_TILER_H
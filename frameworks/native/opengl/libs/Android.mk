@@ -156,6 +156,11 @@ LOCAL_SRC_FILES:= 		\
 	ETC1/etc1.cpp 	\
 #
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_SRC_FILES += ETC1/etc1_neon.cpp.neon
+    LOCAL_CFLAGS += -DETC1_NEON
+endif
+
 LOCAL_LDLIBS := -lpthread -ldl
 LOCAL_MODULE:= libETC1
 
@@ -171,8 +171,10 @@ void setGLHooksThreadSpecific(gl_hooks_t const *value) {
         setGlTraceThreadSpecific(value);
         setGlThreadSpecific(&gHooksTrace);
     } else if (getEGLDebugLevel() > 0 && value != &gHooksNoContext) {
+        // Outside of the traced frames GL calls go straight to the driver,
+        // eglSwapBuffers switches the hooks at frame boundaries.
         setGlTraceThreadSpecific(value);
-        setGlThreadSpecific(GLTrace_getGLHooks());
+        setGlThreadSpecific(GLTrace_isCapturing() ? GLTrace_getGLHooks() : value);
     } else {
         setGlTraceThreadSpecific(NULL);
         setGlThreadSpecific(value);
@@ -1069,6 +1069,11 @@ EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface draw)
         }
 
         GLTrace_eglSwapBuffers(dpy, draw);
+
+        // the next frame may enter or leave the range of traced frames
+        EGLContext ctx = egl_tls_t::getContext();
+        egl_context_t * const c = get_context(ctx);
+        if (c) setGLHooksThreadSpecific(c->cnx->hooks[c->version]);
     } else if (trace_hooks != NULL) {
         // tracing is now disabled, so switch back to the non trace version
         EGLContext ctx = egl_tls_t::getContext();
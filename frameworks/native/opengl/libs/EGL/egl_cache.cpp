@@ -20,7 +20,11 @@
 #include "egl_display.h"
 #include "egldefs.h"
 
+#include <cutils/atomic.h>
+#include <cutils/properties.h>
+
 #include <fcntl.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -43,9 +47,31 @@ static const size_t maxKeySize = MAX_EGL_CACHE_KEY_SIZE;
 static const size_t maxValueSize = MAX_EGL_CACHE_ENTRY_SIZE;
 static const size_t maxTotalSize = MAX_EGL_CACHE_SIZE;
 
-// Cache file header
-static const char* cacheFileMagic = "EGL$";
-static const size_t cacheFileHeaderSize = 8;
+// The cache is split into this many shards by key hash, each with its own
+// lock and its own slot in the cache file.
+static const size_t numShards = 4;
+
+// Each shard gets an equal part of the total size, but has to be able to hold
+// the largest possible entry.
+static const size_t shardMaxSize =
+        maxTotalSize / numShards > maxKeySize + maxValueSize ?
+        maxTotalSize / numShards : maxKeySize + maxValueSize;
+
+// Cache file layout: a header holding the magic, the number of shards and
+// the size of a slot, followed by one fixed size slot per shard.  A slot
+// starts with the CRC and the size of the flattened BlobCache that follows
+// it; a size of 0 marks an empty or partially written slot.  Slots leave
+// room for the flattened BlobCache to be twice the shard's size limit.
+static const char* cacheFileMagic = "EGLS";
+static const size_t cacheFileHeaderSize = 16;
+static const size_t slotHeaderSize = 8;
+static const size_t slotSize =
+        (slotHeaderSize + 2 * shardMaxSize + 3) & ~size_t(3);
+static const size_t cacheFileSize = cacheFileHeaderSize + numShards * slotSize;
+
+// The property naming the system-wide, read-only cache file.  The file has
+// the same format as the per-application cache files.
+static const char* systemCacheFileProperty = "ro.egl.system_blob_cache";
 
 // The time in seconds to wait before saving newly inserted cache entries.
 static const unsigned int deferredSaveDelay = 4;
@@ -73,8 +99,11 @@ static EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize,
 // egl_cache_t definition
 //
 egl_cache_t::egl_cache_t() :
-        mInitialized(false),
-        mBlobCache(NULL) {
+        mInitialized(0),
+        mShards(new shard_t[numShards]),
+        mSavePending(0),
+        mCacheFd(-1),
+        mCacheMap(NULL) {
 }
 
 egl_cache_t::~egl_cache_t() {
@@ -121,81 +150,116 @@ void egl_cache_t::initialize(egl_display_t *display) {
         }
     }
 
-    mInitialized = true;
+    // Load the cache contents before anyone can see the initialized state,
+    // the system cache shards are read without locking from then on.
+    loadBlobCacheLocked();
+    android_atomic_release_store(1, &mInitialized);
 }
 
 void egl_cache_t::terminate() {
     Mutex::Autolock lock(mMutex);
+    android_atomic_release_store(0, &mInitialized);
     saveBlobCacheLocked();
-    mBlobCache = NULL;
+    unmapCacheFileLocked();
+    for (size_t i = 0; i < numShards; i++) {
+        Mutex::Autolock shardLock(mShards[i].mutex);
+        mShards[i].blobCache = NULL;
+        mShards[i].dirty = false;
+    }
 }
 
 void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
         const void* value, EGLsizeiANDROID valueSize) {
-    Mutex::Autolock lock(mMutex);
-
     if (keySize < 0 || valueSize < 0) {
         ALOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
         return;
     }
 
-    if (mInitialized) {
-        sp<BlobCache> bc = getBlobCacheLocked();
-        bc->set(key, keySize, value, valueSize);
-
-        if (!mSavePending) {
-            class DeferredSaveThread : public Thread {
-            public:
-                DeferredSaveThread() : Thread(false) {}
-
-                virtual bool threadLoop() {
-                    sleep(deferredSaveDelay);
-                    egl_cache_t* c = egl_cache_t::get();
-                    Mutex::Autolock lock(c->mMutex);
-                    if (c->mInitialized) {
-                        c->saveBlobCacheLocked();
-                    }
-                    c->mSavePending = false;
-                    return false;
-                }
-            };
+    if (!android_atomic_acquire_load(&mInitialized)) {
+        return;
+    }
 
-            // The thread will hold a strong ref to itself until it has finished
-            // running, so there's no need to keep a ref around.
-            sp<Thread> deferredSaveThread(new DeferredSaveThread());
-            mSavePending = true;
-            deferredSaveThread->run();
+    shard_t& shard(getShard(key, keySize));
+    {
+        Mutex::Autolock lock(shard.mutex);
+        if (shard.blobCache == NULL) {
+            return;
         }
+        shard.blobCache->set(key, keySize, value, valueSize);
+        shard.dirty = true;
+    }
+
+    if (android_atomic_cmpxchg(0, 1, &mSavePending) == 0) {
+        class DeferredSaveThread : public Thread {
+        public:
+            DeferredSaveThread() : Thread(false) {}
+
+            virtual bool threadLoop() {
+                sleep(deferredSaveDelay);
+                egl_cache_t* c = egl_cache_t::get();
+                Mutex::Autolock lock(c->mMutex);
+                // Clear the flag first, so that entries inserted while this
+                // save is in progress get a save of their own.
+                android_atomic_release_store(0, &c->mSavePending);
+                if (android_atomic_acquire_load(&c->mInitialized)) {
+                    c->saveBlobCacheLocked();
+                }
+                return false;
+            }
+        };
+
+        // The thread will hold a strong ref to itself until it has finished
+        // running, so there's no need to keep a ref around.
+        sp<Thread> deferredSaveThread(new DeferredSaveThread());
+        deferredSaveThread->run();
     }
 }
 
 EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize,
         void* value, EGLsizeiANDROID valueSize) {
-    Mutex::Autolock lock(mMutex);
-
     if (keySize < 0 || valueSize < 0) {
         ALOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
         return 0;
     }
 
-    if (mInitialized) {
-        sp<BlobCache> bc = getBlobCacheLocked();
-        return bc->get(key, keySize, value, valueSize);
+    if (!android_atomic_acquire_load(&mInitialized)) {
+        return 0;
+    }
+
+    shard_t& shard(getShard(key, keySize));
+    {
+        Mutex::Autolock lock(shard.mutex);
+        if (shard.blobCache != NULL) {
+            size_t size = shard.blobCache->get(key, keySize, value, valueSize);
+            if (size > 0) {
+                return size;
+            }
+        }
+    }
+
+    if (shard.systemBlobCache != NULL) {
+        return shard.systemBlobCache->get(key, keySize, value, valueSize);
     }
     return 0;
 }
 
 void egl_cache_t::setCacheFilename(const char* filename) {
     Mutex::Autolock lock(mMutex);
-    mFilename = filename;
+    if (mFilename != filename) {
+        unmapCacheFileLocked();
+        mFilename = filename;
+    }
 }
 
-sp<BlobCache> egl_cache_t::getBlobCacheLocked() {
-    if (mBlobCache == NULL) {
-        mBlobCache = new BlobCache(maxKeySize, maxValueSize, maxTotalSize);
-        loadBlobCacheLocked();
+egl_cache_t::shard_t& egl_cache_t::getShard(const void* key,
+        EGLsizeiANDROID keySize) {
+    // FNV-1a
+    const uint8_t* k = reinterpret_cast<const uint8_t*>(key);
+    uint32_t hash = 2166136261u;
+    for (EGLsizeiANDROID i = 0; i < keySize; i++) {
+        hash = (hash ^ k[i]) * 16777619u;
     }
-    return mBlobCache;
+    return mShards[hash % numShards];
 }
 
 static uint32_t crc32c(const uint8_t* buf, size_t len) {
@@ -214,137 +278,252 @@ static uint32_t crc32c(const uint8_t* buf, size_t len) {
     return r;
 }
 
+static bool isCacheFileHeaderValid(const uint8_t* buf) {
+    const uint32_t* header = reinterpret_cast<const uint32_t*>(buf);
+    return memcmp(buf, cacheFileMagic, 4) == 0 &&
+            header[1] == numShards && header[2] == slotSize;
+}
+
+// Returns the slot of the given shard in a mapped cache file.
+static uint8_t* getSlot(uint8_t* buf, size_t shard) {
+    return buf + cacheFileHeaderSize + shard * slotSize;
+}
+
+// Loads the contents of a slot into "bc", returning false if the slot is
+// empty or invalid.
+static bool loadSlot(const uint8_t* slot, const sp<BlobCache>& bc) {
+    const uint32_t* slotHeader = reinterpret_cast<const uint32_t*>(slot);
+    size_t cacheSize = slotHeader[1];
+    if (cacheSize == 0) {
+        return false;
+    }
+    if (cacheSize > slotSize - slotHeaderSize) {
+        ALOGE("cache file slot is too large: %zu", cacheSize);
+        return false;
+    }
+    if (crc32c(slot + slotHeaderSize, cacheSize) != slotHeader[0]) {
+        ALOGE("cache file failed CRC check");
+        return false;
+    }
+
+    status_t err = bc->unflatten(slot + slotHeaderSize, cacheSize);
+    if (err != OK) {
+        ALOGE("error reading cache contents: %s (%d)", strerror(-err),
+                -err);
+        return false;
+    }
+    return true;
+}
+
 void egl_cache_t::saveBlobCacheLocked() {
-    if (mFilename.length() > 0 && mBlobCache != NULL) {
-        size_t cacheSize = mBlobCache->getFlattenedSize();
-        size_t headerSize = cacheFileHeaderSize;
-        const char* fname = mFilename.string();
-
-        // Try to create the file with no permissions so we can write it
-        // without anyone trying to read it.
-        int fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
-        if (fd == -1) {
-            if (errno == EEXIST) {
-                // The file exists, delete it and try again.
-                if (unlink(fname) == -1) {
-                    // No point in retrying if the unlink failed.
-                    ALOGE("error unlinking cache file %s: %s (%d)", fname,
-                            strerror(errno), errno);
-                    return;
-                }
-                // Retry now that we've unlinked the file.
-                fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
+    if (!mapCacheFileLocked()) {
+        return;
+    }
+
+    // Keep other processes of the same application from loading or writing
+    // the file while the slots are being rewritten.
+    flock(mCacheFd, LOCK_EX);
+
+    for (size_t i = 0; i < numShards; i++) {
+        shard_t& shard(mShards[i]);
+        uint8_t* slot = getSlot(mCacheMap, i);
+        uint32_t* slotHeader = reinterpret_cast<uint32_t*>(slot);
+        size_t cacheSize;
+
+        {
+            Mutex::Autolock lock(shard.mutex);
+            if (!shard.dirty || shard.blobCache == NULL) {
+                continue;
             }
-            if (fd == -1) {
-                ALOGE("error creating cache file %s: %s (%d)", fname,
-                        strerror(errno), errno);
-                return;
+            shard.dirty = false;
+
+            // Mark the slot as empty until it is completely written, so that
+            // it is dropped on load if we die in between.
+            slotHeader[1] = 0;
+
+            cacheSize = shard.blobCache->getFlattenedSize();
+            if (cacheSize > slotSize - slotHeaderSize) {
+                ALOGE("cache shard is too large to save: %zu", cacheSize);
+                continue;
+            }
+
+            status_t err = shard.blobCache->flatten(slot + slotHeaderSize,
+                    cacheSize);
+            if (err != OK) {
+                ALOGE("error writing cache contents: %s (%d)", strerror(-err),
+                        -err);
+                continue;
             }
         }
 
-        size_t fileSize = headerSize + cacheSize;
+        // Only this thread writes to the slots, so the CRC can be computed
+        // without holding up users of the shard.
+        slotHeader[0] = crc32c(slot + slotHeaderSize, cacheSize);
+        slotHeader[1] = cacheSize;
+    }
 
-        uint8_t* buf = new uint8_t [fileSize];
-        if (!buf) {
-            ALOGE("error allocating buffer for cache contents: %s (%d)",
-                    strerror(errno), errno);
-            close(fd);
-            unlink(fname);
-            return;
-        }
+    flock(mCacheFd, LOCK_UN);
+}
 
-        status_t err = mBlobCache->flatten(buf + headerSize, cacheSize);
-        if (err != OK) {
-            ALOGE("error writing cache contents: %s (%d)", strerror(-err),
-                    -err);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
-        }
+void egl_cache_t::loadBlobCacheLocked() {
+    for (size_t i = 0; i < numShards; i++) {
+        Mutex::Autolock lock(mShards[i].mutex);
+        mShards[i].blobCache = new BlobCache(maxKeySize, maxValueSize,
+                shardMaxSize);
+        mShards[i].dirty = false;
+    }
 
-        // Write the file magic and CRC
-        memcpy(buf, cacheFileMagic, 4);
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        *crc = crc32c(buf + headerSize, cacheSize);
+    // The system cache does not change while we are running, so it is only
+    // loaded once.
+    static bool systemCacheLoaded = false;
+    if (!systemCacheLoaded) {
+        loadSystemBlobCacheLocked();
+        systemCacheLoaded = true;
+    }
 
-        if (write(fd, buf, fileSize) == -1) {
-            ALOGE("error writing cache file: %s (%d)", strerror(errno),
-                    errno);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
-        }
+    if (!mapCacheFileLocked()) {
+        return;
+    }
 
-        delete [] buf;
-        fchmod(fd, S_IRUSR);
-        close(fd);
+    flock(mCacheFd, LOCK_SH);
+    for (size_t i = 0; i < numShards; i++) {
+        Mutex::Autolock lock(mShards[i].mutex);
+        loadSlot(getSlot(mCacheMap, i), mShards[i].blobCache);
     }
+    flock(mCacheFd, LOCK_UN);
 }
 
-void egl_cache_t::loadBlobCacheLocked() {
-    if (mFilename.length() > 0) {
-        size_t headerSize = cacheFileHeaderSize;
-
-        int fd = open(mFilename.string(), O_RDONLY, 0);
-        if (fd == -1) {
-            if (errno != ENOENT) {
-                ALOGE("error opening cache file %s: %s (%d)", mFilename.string(),
-                        strerror(errno), errno);
-            }
-            return;
-        }
+void egl_cache_t::loadSystemBlobCacheLocked() {
+    char fname[PROPERTY_VALUE_MAX];
+    if (property_get(systemCacheFileProperty, fname, NULL) <= 0) {
+        return;
+    }
 
-        struct stat statBuf;
-        if (fstat(fd, &statBuf) == -1) {
-            ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
-            close(fd);
-            return;
-        }
+    int fd = open(fname, O_RDONLY, 0);
+    if (fd == -1) {
+        ALOGE("error opening system cache file %s: %s (%d)", fname,
+                strerror(errno), errno);
+        return;
+    }
 
-        // Sanity check the size before trying to mmap it.
-        size_t fileSize = statBuf.st_size;
-        if (fileSize > maxTotalSize * 2) {
-            ALOGE("cache file is too large: %#llx", statBuf.st_size);
-            close(fd);
-            return;
-        }
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1 || size_t(statBuf.st_size) != cacheFileSize) {
+        ALOGE("system cache file %s has the wrong size", fname);
+        close(fd);
+        return;
+    }
 
-        uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(NULL, fileSize,
-                PROT_READ, MAP_PRIVATE, fd, 0));
-        if (buf == MAP_FAILED) {
-            ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
-                    errno);
-            close(fd);
-            return;
-        }
+    uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(NULL, cacheFileSize,
+            PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (buf == MAP_FAILED) {
+        ALOGE("error mmaping system cache file: %s (%d)", strerror(errno),
+                errno);
+        return;
+    }
 
-        // Check the file magic and CRC
-        size_t cacheSize = fileSize - headerSize;
-        if (memcmp(buf, cacheFileMagic, 4) != 0) {
-            ALOGE("cache file has bad mojo");
-            close(fd);
-            return;
+    if (!isCacheFileHeaderValid(buf)) {
+        ALOGE("system cache file has bad mojo");
+        munmap(buf, cacheFileSize);
+        return;
+    }
+
+    for (size_t i = 0; i < numShards; i++) {
+        sp<BlobCache> bc(new BlobCache(maxKeySize, maxValueSize,
+                shardMaxSize));
+        if (loadSlot(getSlot(buf, i), bc)) {
+            mShards[i].systemBlobCache = bc;
         }
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        if (crc32c(buf + headerSize, cacheSize) != *crc) {
-            ALOGE("cache file failed CRC check");
-            close(fd);
-            return;
+    }
+
+    munmap(buf, cacheFileSize);
+}
+
+bool egl_cache_t::mapCacheFileLocked() {
+    if (mCacheMap != NULL) {
+        return true;
+    }
+    if (mFilename.length() == 0) {
+        return false;
+    }
+
+    const char* fname = mFilename.string();
+    int fd = open(fname, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd == -1 && errno == EACCES) {
+        // Older versions left the file read-only, replace it.
+        if (unlink(fname) == 0) {
+            fd = open(fname, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
         }
+    }
+    if (fd == -1) {
+        ALOGE("error opening cache file %s: %s (%d)", fname,
+                strerror(errno), errno);
+        return false;
+    }
+
+    flock(fd, LOCK_EX);
+
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1) {
+        ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
+        flock(fd, LOCK_UN);
+        close(fd);
+        return false;
+    }
+
+    bool valid = false;
+    if (size_t(statBuf.st_size) == cacheFileSize) {
+        uint8_t header[cacheFileHeaderSize];
+        valid = pread(fd, header, cacheFileHeaderSize, 0) ==
+                ssize_t(cacheFileHeaderSize) &&
+                isCacheFileHeaderValid(header);
+    }
+
+    if (!valid) {
+        // Write the whole file rather than just extending it, so that its
+        // blocks are allocated up front and storing to the mapping cannot
+        // fail for lack of disk space.
+        uint8_t* buf = new uint8_t[cacheFileSize];
+        memset(buf, 0, cacheFileSize);
+        memcpy(buf, cacheFileMagic, 4);
+        uint32_t* header = reinterpret_cast<uint32_t*>(buf);
+        header[1] = numShards;
+        header[2] = slotSize;
 
-        status_t err = mBlobCache->unflatten(buf + headerSize, cacheSize);
-        if (err != OK) {
-            ALOGE("error reading cache contents: %s (%d)", strerror(-err),
-                    -err);
-            munmap(buf, fileSize);
+        bool written = ftruncate(fd, 0) == 0 &&
+                pwrite(fd, buf, cacheFileSize, 0) == ssize_t(cacheFileSize);
+        delete [] buf;
+        if (!written) {
+            ALOGE("error writing cache file: %s (%d)", strerror(errno),
+                    errno);
+            ftruncate(fd, 0);
+            flock(fd, LOCK_UN);
             close(fd);
-            return;
+            return false;
         }
+    }
 
-        munmap(buf, fileSize);
+    flock(fd, LOCK_UN);
+
+    void* map = mmap(NULL, cacheFileSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    if (map == MAP_FAILED) {
+        ALOGE("error mmaping cache file: %s (%d)", strerror(errno), errno);
         close(fd);
+        return false;
+    }
+
+    mCacheFd = fd;
+    mCacheMap = reinterpret_cast<uint8_t*>(map);
+    return true;
+}
+
+void egl_cache_t::unmapCacheFileLocked() {
+    if (mCacheMap != NULL) {
+        munmap(mCacheMap, cacheFileSize);
+        close(mCacheFd);
+        mCacheMap = NULL;
+        mCacheFd = -1;
     }
 }
 
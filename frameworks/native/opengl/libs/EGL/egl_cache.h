@@ -44,9 +44,10 @@ public:
     // operations.
     void initialize(egl_display_t* display);
 
-    // terminate puts the egl_cache_t back into the uninitialized state.  When
-    // in this state the getBlob and setBlob methods will return without
-    // performing any cache operations.
+    // terminate saves any modified cache contents to disk and puts the
+    // egl_cache_t back into the uninitialized state.  When in this state the
+    // getBlob and setBlob methods will return without performing any cache
+    // operations.
     void terminate();
 
     // setBlob attempts to insert a new key/value blob pair into the cache.
@@ -74,32 +75,70 @@ private:
     egl_cache_t(const egl_cache_t&); // not implemented
     void operator=(const egl_cache_t&); // not implemented
 
-    // getBlobCacheLocked returns the BlobCache object being used to store the
-    // key/value blob pairs.  If the BlobCache object has not yet been created,
-    // this will do so, loading the serialized cache contents from disk if
-    // possible.
-    sp<BlobCache> getBlobCacheLocked();
-
-    // saveBlobCache attempts to save the current contents of mBlobCache to
-    // disk.
+    // shard_t is one part of the cache.  Keys are spread over the shards by
+    // their hash, and each shard has its own lock so that threads setting or
+    // getting blobs rarely wait for each other, or for a save that is in
+    // progress on another shard.
+    struct shard_t {
+        shard_t() : dirty(false) {}
+
+        // mutex protects blobCache and dirty.
+        Mutex mutex;
+
+        // blobCache is the cache in which the key/value blob pairs of this
+        // shard are stored.  It is created by initialize and released by
+        // terminate.
+        sp<BlobCache> blobCache;
+
+        // systemBlobCache holds the entries of this shard found in the
+        // system-wide cache file, if any.  It is only written by initialize
+        // before the cache enters the initialized state and never changes
+        // afterwards, so it is read without holding mutex.
+        sp<BlobCache> systemBlobCache;
+
+        // dirty indicates whether blobCache has been modified since it was
+        // last saved to disk.
+        bool dirty;
+    };
+
+    // getShard returns the shard that holds the given key.
+    shard_t& getShard(const void* key, EGLsizeiANDROID keySize);
+
+    // saveBlobCacheLocked writes the shards that have been modified since
+    // they were last saved into their slots of the cache file.  Each shard is
+    // locked only while it is being flattened into the mapped file.
     void saveBlobCacheLocked();
 
-    // loadBlobCache attempts to load the saved cache contents from disk into
-    // mBlobCache.
+    // loadBlobCacheLocked creates an empty BlobCache for each shard, and
+    // fills it with the saved contents of its slot in the cache file if
+    // possible.
     void loadBlobCacheLocked();
 
+    // loadSystemBlobCacheLocked loads the read-only system-wide cache named
+    // by the ro.egl.system_blob_cache property into the shards.  Lookups that
+    // miss in the per-application cache fall back to it.
+    void loadSystemBlobCacheLocked();
+
+    // mapCacheFileLocked opens and maps the cache file named by mFilename,
+    // creating it with an empty slot for each shard if it does not exist or
+    // is not in the expected format.  It returns false if the cache file
+    // cannot be used.
+    bool mapCacheFileLocked();
+
+    // unmapCacheFileLocked unmaps and closes the cache file, if it is mapped.
+    void unmapCacheFileLocked();
+
     // mInitialized indicates whether the egl_cache_t is in the initialized
-    // state.  It is initialized to false at construction time, and gets set to
-    // true when initialize is called.  It is set back to false when terminate
-    // is called.  When in this state, the cache behaves as normal.  When not,
-    // the getBlob and setBlob methods will return without performing any cache
-    // operations.
-    bool mInitialized;
+    // state.  It is initialized to 0 at construction time, gets set to 1 when
+    // initialize is called, and is set back to 0 when terminate is called.
+    // When in this state, the cache behaves as normal.  When not, the getBlob and setBlob methods will return without
+    // performing any cache operations.  It is read without holding mMutex,
+    // using an acquire load.
+    volatile int32_t mInitialized;
 
-    // mBlobCache is the cache in which the key/value blob pairs are stored.  It
-    // is initially NULL, and will be initialized by getBlobCacheLocked the
-    // first time it's needed.
-    sp<BlobCache> mBlobCache;
+    // mShards is the array of shards in which the key/value blob pairs are
+    // stored.  It is allocated at construction time and never freed.
+    shard_t* mShards;
 
     // mFilename is the name of the file for storing cache contents in between
     // program invocations.  It is initialized to an empty string at
@@ -111,12 +150,21 @@ private:
     // mSavePending indicates whether or not a deferred save operation is
     // pending.  Each time a key/value pair is inserted into the cache via
     // setBlob, a deferred save is initiated if one is not already pending.
-    // This will wait some amount of time and then trigger a save of the cache
-    // contents to disk.
-    bool mSavePending;
-
-    // mMutex is the mutex used to prevent concurrent access to the member
-    // variables. It must be locked whenever the member variables are accessed.
+    // This will wait some amount of time and then write the modified shards
+    // to disk.  It is updated atomically so that setBlob does not need to
+    // take mMutex.
+    volatile int32_t mSavePending;
+
+    // mCacheFd and mCacheMap are the file descriptor and the shared mapping
+    // of the cache file, or -1 and NULL if it has not been mapped yet.  The
+    // mapping is kept for as long as mFilename does not change, so saving a
+    // shard only writes that shard's pages.
+    int mCacheFd;
+    uint8_t* mCacheMap;
+
+    // mMutex serializes initialize, terminate, setCacheFilename and saves to
+    // disk, and must be held whenever mFilename, mCacheFd or mCacheMap are
+    // accessed.  The shards have their own locks, see shard_t.
     mutable Mutex mMutex;
 
     // sCache is the singleton egl_cache_t object.
@@ -14,8 +14,13 @@
 
 #include <ETC1/etc1.h>
 
+#include <pthread.h>
 #include <string.h>
 
+#ifdef ETC1_NEON
+#include "etc1_neon.h"
+#endif
+
 /* From http://www.khronos.org/registry/gles/extensions/OES/OES_compressed_ETC1_RGB8_texture.txt
 
  The number of bits that represent a 4x4 texel block is 64 bits if
@@ -163,34 +168,17 @@ inline int convertDiff(int base, int diff) {
     return convert5To8((0x1f & base) + kLookup[0x7 & diff]);
 }
 
+// Computes the 4 colors the pixels of a sub-block can take, in the order of
+// the pixel index values, so that decoding a pixel is a lookup.
+
 static
-void decode_subblock(etc1_byte* pOut, int r, int g, int b, const int* table,
-        etc1_uint32 low, bool second, bool flipped) {
-    int baseX = 0;
-    int baseY = 0;
-    if (second) {
-        if (flipped) {
-            baseY = 2;
-        } else {
-            baseX = 2;
-        }
-    }
-    for (int i = 0; i < 8; i++) {
-        int x, y;
-        if (flipped) {
-            x = baseX + (i >> 1);
-            y = baseY + (i & 1);
-        } else {
-            x = baseX + (i >> 2);
-            y = baseY + (i & 3);
-        }
-        int k = y + (x * 4);
-        int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
-        int delta = table[offset];
-        etc1_byte* q = pOut + 3 * (x + 4 * y);
-        *q++ = clamp(r + delta);
-        *q++ = clamp(g + delta);
-        *q++ = clamp(b + delta);
+void decode_subblock_colors(etc1_byte* pColors, int r, int g, int b,
+        const int* table) {
+    for (int i = 0; i < 4; i++) {
+        int delta = table[i];
+        *pColors++ = clamp(r + delta);
+        *pColors++ = clamp(g + delta);
+        *pColors++ = clamp(b + delta);
     }
 }
 
@@ -226,8 +214,22 @@ void etc1_decode_block(const etc1_byte* pIn, etc1_byte* pOut) {
     const int* tableA = kModifierTable + tableIndexA * 4;
     const int* tableB = kModifierTable + tableIndexB * 4;
     bool flipped = (high & 1) != 0;
-    decode_subblock(pOut, r1, g1, b1, tableA, low, false, flipped);
-    decode_subblock(pOut, r2, g2, b2, tableB, low, true, flipped);
+
+    etc1_byte colors[2][12];
+    decode_subblock_colors(colors[0], r1, g1, b1, tableA);
+    decode_subblock_colors(colors[1], r2, g2, b2, tableB);
+
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            int k = y + (x * 4);
+            int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
+            const etc1_byte* c = colors[flipped ? y >> 1 : x >> 1] + offset * 3;
+            etc1_byte* q = pOut + 3 * (x + 4 * y);
+            q[0] = c[0];
+            q[1] = c[1];
+            q[2] = c[2];
+        }
+    }
 }
 
 typedef struct {
@@ -236,6 +238,17 @@ typedef struct {
     etc1_uint32 score; // Lower is more accurate
 } etc_compressed;
 
+// The valid pixels of a 2 x 4 or 4 x 2 sub-block, with the bit index of each
+// pixel in the low word of the encoded block. Gathered once per block so
+// that the search over modifier tables does not walk the block again.
+typedef struct {
+    etc1_byte r[8];
+    etc1_byte g[8];
+    etc1_byte b[8];
+    int bitIndex[8];
+    int count;
+} etc_subblock;
+
 static
 inline void take_best(etc_compressed* a, const etc_compressed* b) {
     if (a->score > b->score) {
@@ -244,11 +257,9 @@ inline void take_best(etc_compressed* a, const etc_compressed* b) {
 }
 
 static
-void etc_average_colors_subblock(const etc1_byte* pIn, etc1_uint32 inMask,
-        etc1_byte* pColors, bool flipped, bool second) {
-    int r = 0;
-    int g = 0;
-    int b = 0;
+void etc_gather_subblock(const etc1_byte* pIn, etc1_uint32 inMask,
+        etc_subblock* pSubblock, bool flipped, bool second) {
+    int count = 0;
 
     if (flipped) {
         int by = 0;
@@ -261,9 +272,11 @@ void etc_average_colors_subblock(const etc1_byte* pIn, etc1_uint32 inMask,
                 int i = x + 4 * yy;
                 if (inMask & (1 << i)) {
                     const etc1_byte* p = pIn + i * 3;
-                    r += *(p++);
-                    g += *(p++);
-                    b += *(p++);
+                    pSubblock->r[count] = p[0];
+                    pSubblock->g[count] = p[1];
+                    pSubblock->b[count] = p[2];
+                    pSubblock->bitIndex[count] = yy + x * 4;
+                    count++;
                 }
             }
         }
@@ -278,13 +291,30 @@ void etc_average_colors_subblock(const etc1_byte* pIn, etc1_uint32 inMask,
                 int i = xx + 4 * y;
                 if (inMask & (1 << i)) {
                     const etc1_byte* p = pIn + i * 3;
-                    r += *(p++);
-                    g += *(p++);
-                    b += *(p++);
+                    pSubblock->r[count] = p[0];
+                    pSubblock->g[count] = p[1];
+                    pSubblock->b[count] = p[2];
+                    pSubblock->bitIndex[count] = y + xx * 4;
+                    count++;
                 }
             }
         }
     }
+    pSubblock->count = count;
+}
+
+static
+void etc_average_colors_subblock(const etc_subblock* pSubblock,
+        etc1_byte* pColors) {
+    int r = 0;
+    int g = 0;
+    int b = 0;
+
+    for (int i = 0; i < pSubblock->count; i++) {
+        r += pSubblock->r[i];
+        g += pSubblock->g[i];
+        b += pSubblock->b[i];
+    }
     pColors[0] = (etc1_byte)((r + 4) >> 3);
     pColors[1] = (etc1_byte)((g + 4) >> 3);
     pColors[2] = (etc1_byte)((b + 4) >> 3);
@@ -296,13 +326,10 @@ inline int square(int x) {
 }
 
 static etc1_uint32 chooseModifier(const etc1_byte* pBaseColors,
-        const etc1_byte* pIn, etc1_uint32 *pLow, int bitIndex,
+        int pixelR, int pixelG, int pixelB, etc1_uint32 *pLow, int bitIndex,
         const int* pModifierTable) {
     etc1_uint32 bestScore = ~0;
     int bestIndex = 0;
-    int pixelR = pIn[0];
-    int pixelG = pIn[1];
-    int pixelB = pIn[2];
     int r = pBaseColors[0];
     int g = pBaseColors[1];
     int b = pBaseColors[2];
@@ -331,41 +358,39 @@ static etc1_uint32 chooseModifier(const etc1_byte* pBaseColors,
     return bestScore;
 }
 
+#ifdef ETC1_NEON
+static bool hasNeon() {
+    // Computing this more than once is harmless.
+    static int sHasNeon = -1;
+    if (sHasNeon < 0) {
+        sHasNeon = etc1_cpu_has_neon() ? 1 : 0;
+    }
+    return sHasNeon != 0;
+}
+#endif
+
 static
-void etc_encode_subblock_helper(const etc1_byte* pIn, etc1_uint32 inMask,
-        etc_compressed* pCompressed, bool flipped, bool second,
-        const etc1_byte* pBaseColors, const int* pModifierTable) {
+void etc_encode_subblock_helper(const etc_subblock* pSubblock,
+        etc_compressed* pCompressed, const etc1_byte* pBaseColors,
+        const int* pModifierTable) {
     int score = pCompressed->score;
-    if (flipped) {
-        int by = 0;
-        if (second) {
-            by = 2;
-        }
-        for (int y = 0; y < 2; y++) {
-            int yy = by + y;
-            for (int x = 0; x < 4; x++) {
-                int i = x + 4 * yy;
-                if (inMask & (1 << i)) {
-                    score += chooseModifier(pBaseColors, pIn + i * 3,
-                            &pCompressed->low, yy + x * 4, pModifierTable);
-                }
-            }
-        }
-    } else {
-        int bx = 0;
-        if (second) {
-            bx = 2;
-        }
-        for (int y = 0; y < 4; y++) {
-            for (int x = 0; x < 2; x++) {
-                int xx = bx + x;
-                int i = xx + 4 * y;
-                if (inMask & (1 << i)) {
-                    score += chooseModifier(pBaseColors, pIn + i * 3,
-                            &pCompressed->low, y + xx * 4, pModifierTable);
-                }
-            }
+#ifdef ETC1_NEON
+    if (pSubblock->count == 8 && hasNeon()) {
+        etc1_byte indices[8];
+        score += etc1_score_subblock_neon(pSubblock->r, pSubblock->g,
+                pSubblock->b, pBaseColors, pModifierTable, indices);
+        for (int i = 0; i < 8; i++) {
+            pCompressed->low |= (((indices[i] >> 1) << 16) | (indices[i] & 1))
+                    << pSubblock->bitIndex[i];
         }
+        pCompressed->score = score;
+        return;
+    }
+#endif
+    for (int i = 0; i < pSubblock->count; i++) {
+        score += chooseModifier(pBaseColors, pSubblock->r[i], pSubblock->g[i],
+                pSubblock->b[i], &pCompressed->low, pSubblock->bitIndex[i],
+                pModifierTable);
     }
     pCompressed->score = score;
 }
@@ -429,9 +454,44 @@ static void etc_encodeBaseColors(etc1_byte* pBaseColors,
     pBaseColors[5] = b2;
 }
 
+// Picks the range of modifier tables to try for a sub-block. The highest
+// quality tries all of them, the others only the tables around the one whose
+// large modifier best covers the spread of the pixels around the base color.
+static void etc_choose_tables(const etc_subblock* pSubblock,
+        const etc1_byte* pBaseColors, int quality, int* pFirst, int* pLast) {
+    if (quality >= ETC1_QUALITY_HIGH) {
+        *pFirst = 0;
+        *pLast = 7;
+        return;
+    }
+
+    int maxDelta = 0;
+    for (int i = 0; i < pSubblock->count; i++) {
+        // the weights of the error metric in chooseModifier
+        int delta = (3 * (pSubblock->r[i] - pBaseColors[0])
+                + 6 * (pSubblock->g[i] - pBaseColors[1])
+                + (pSubblock->b[i] - pBaseColors[2])) / 10;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        if (delta > maxDelta) {
+            maxDelta = delta;
+        }
+    }
+
+    int table = 0;
+    while (table < 7 && kModifierTable[table * 4 + 1] < maxDelta) {
+        table++;
+    }
+
+    *pFirst = table > 0 ? table - 1 : 0;
+    *pLast = table < 7 ? table + 1 : 7;
+}
+
 static
-void etc_encode_block_helper(const etc1_byte* pIn, etc1_uint32 inMask,
-        const etc1_byte* pColors, etc_compressed* pCompressed, bool flipped) {
+void etc_encode_block_helper(const etc_subblock* pSubblocks,
+        const etc1_byte* pColors, etc_compressed* pCompressed, bool flipped,
+        int quality) {
     pCompressed->score = ~0;
     pCompressed->high = (flipped ? 1 : 0);
     pCompressed->low = 0;
@@ -442,26 +502,30 @@ void etc_encode_block_helper(const etc1_byte* pIn, etc1_uint32 inMask,
 
     int originalHigh = pCompressed->high;
 
-    const int* pModifierTable = kModifierTable;
-    for (int i = 0; i < 8; i++, pModifierTable += 4) {
+    int first, last;
+    etc_choose_tables(&pSubblocks[0], pBaseColors, quality, &first, &last);
+    const int* pModifierTable = kModifierTable + first * 4;
+    for (int i = first; i <= last; i++, pModifierTable += 4) {
         etc_compressed temp;
         temp.score = 0;
         temp.high = originalHigh | (i << 5);
         temp.low = 0;
-        etc_encode_subblock_helper(pIn, inMask, &temp, flipped, false,
-                pBaseColors, pModifierTable);
+        etc_encode_subblock_helper(&pSubblocks[0], &temp, pBaseColors,
+                pModifierTable);
         take_best(pCompressed, &temp);
     }
-    pModifierTable = kModifierTable;
+
+    etc_choose_tables(&pSubblocks[1], pBaseColors + 3, quality, &first, &last);
+    pModifierTable = kModifierTable + first * 4;
     etc_compressed firstHalf = *pCompressed;
-    for (int i = 0; i < 8; i++, pModifierTable += 4) {
+    for (int i = first; i <= last; i++, pModifierTable += 4) {
         etc_compressed temp;
         temp.score = firstHalf.score;
         temp.high = firstHalf.high | (i << 2);
         temp.low = firstHalf.low;
-        etc_encode_subblock_helper(pIn, inMask, &temp, flipped, true,
-                pBaseColors + 3, pModifierTable);
-        if (i == 0) {
+        etc_encode_subblock_helper(&pSubblocks[1], &temp, pBaseColors + 3,
+                pModifierTable);
+        if (i == first) {
             *pCompressed = temp;
         } else {
             take_best(pCompressed, &temp);
@@ -469,6 +533,19 @@ void etc_encode_block_helper(const etc1_byte* pIn, etc1_uint32 inMask,
     }
 }
 
+// Returns the squared error of approximating a sub-block by its average,
+// used to pick the orientation without encoding both.
+static etc1_uint32 etc_subblock_error(const etc_subblock* pSubblock,
+        const etc1_byte* pColors) {
+    etc1_uint32 error = 0;
+    for (int i = 0; i < pSubblock->count; i++) {
+        error += 3 * square(pSubblock->r[i] - pColors[0])
+                + 6 * square(pSubblock->g[i] - pColors[1])
+                + square(pSubblock->b[i] - pColors[2]);
+    }
+    return error;
+}
+
 static void writeBigEndian(etc1_byte* pOut, etc1_uint32 d) {
     pOut[0] = (etc1_byte)(d >> 24);
     pOut[1] = (etc1_byte)(d >> 16);
@@ -476,54 +553,90 @@ static void writeBigEndian(etc1_byte* pOut, etc1_uint32 d) {
     pOut[3] = (etc1_byte) d;
 }
 
-// Input is a 4 x 4 square of 3-byte pixels in form R, G, B
-// inmask is a 16-bit mask where bit (1 << (x + y * 4)) tells whether the corresponding (x,y)
-// pixel is valid or not. Invalid pixel color values are ignored when compressing.
-// Output is an ETC1 compressed version of the data.
+static void etc_encode_block_quality(const etc1_byte* pIn, etc1_uint32 inMask,
+        etc1_byte* pOut, int quality) {
+    etc_subblock subblocks[2];
+    etc_subblock flippedSubblocks[2];
+    etc_gather_subblock(pIn, inMask, &subblocks[0], false, false);
+    etc_gather_subblock(pIn, inMask, &subblocks[1], false, true);
+    etc_gather_subblock(pIn, inMask, &flippedSubblocks[0], true, false);
+    etc_gather_subblock(pIn, inMask, &flippedSubblocks[1], true, true);
 
-void etc1_encode_block(const etc1_byte* pIn, etc1_uint32 inMask,
-        etc1_byte* pOut) {
     etc1_byte colors[6];
     etc1_byte flippedColors[6];
-    etc_average_colors_subblock(pIn, inMask, colors, false, false);
-    etc_average_colors_subblock(pIn, inMask, colors + 3, false, true);
-    etc_average_colors_subblock(pIn, inMask, flippedColors, true, false);
-    etc_average_colors_subblock(pIn, inMask, flippedColors + 3, true, true);
+    etc_average_colors_subblock(&subblocks[0], colors);
+    etc_average_colors_subblock(&subblocks[1], colors + 3);
+    etc_average_colors_subblock(&flippedSubblocks[0], flippedColors);
+    etc_average_colors_subblock(&flippedSubblocks[1], flippedColors + 3);
 
     etc_compressed a, b;
-    etc_encode_block_helper(pIn, inMask, colors, &a, false);
-    etc_encode_block_helper(pIn, inMask, flippedColors, &b, true);
-    take_best(&a, &b);
+    if (quality > ETC1_QUALITY_LOW) {
+        etc_encode_block_helper(subblocks, colors, &a, false, quality);
+        etc_encode_block_helper(flippedSubblocks, flippedColors, &b, true,
+                quality);
+        take_best(&a, &b);
+    } else if (etc_subblock_error(&subblocks[0], colors)
+            + etc_subblock_error(&subblocks[1], colors + 3)
+            <= etc_subblock_error(&flippedSubblocks[0], flippedColors)
+            + etc_subblock_error(&flippedSubblocks[1], flippedColors + 3)) {
+        etc_encode_block_helper(subblocks, colors, &a, false, quality);
+    } else {
+        etc_encode_block_helper(flippedSubblocks, flippedColors, &a, true,
+                quality);
+    }
     writeBigEndian(pOut, a.high);
     writeBigEndian(pOut + 4, a.low);
 }
 
+// Input is a 4 x 4 square of 3-byte pixels in form R, G, B
+// inmask is a 16-bit mask where bit (1 << (x + y * 4)) tells whether the corresponding (x,y)
+// pixel is valid or not. Invalid pixel color values are ignored when compressing.
+// Output is an ETC1 compressed version of the data.
+
+void etc1_encode_block(const etc1_byte* pIn, etc1_uint32 inMask,
+        etc1_byte* pOut) {
+    etc_encode_block_quality(pIn, inMask, pOut, ETC1_QUALITY_HIGH);
+}
+
 // Return the size of the encoded image data (does not include size of PKM header).
 
 etc1_uint32 etc1_get_encoded_data_size(etc1_uint32 width, etc1_uint32 height) {
     return (((width + 3) & ~3) * ((height + 3) & ~3)) >> 1;
 }
 
-// Encode an entire image.
-// pIn - pointer to the image data. Formatted such that the Red component of
-//       pixel (x,y) is at pIn + pixelSize * x + stride * y + redOffset;
-// pOut - pointer to encoded data. Must be large enough to store entire encoded image.
-
-int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
-        etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut) {
-    if (pixelSize < 2 || pixelSize > 3) {
-        return -1;
-    }
+typedef struct {
+    const etc1_byte* pIn;
+    etc1_uint32 width;
+    etc1_uint32 height;
+    etc1_uint32 pixelSize;
+    etc1_uint32 stride;
+    etc1_byte* pOut;
+    int quality;
+    volatile int nextBlockRow; // next row of blocks to encode
+} etc_encode_job;
+
+// Encodes rows of blocks until there are none left, several threads can work
+// on the same job.
+static void etc_encode_rows(etc_encode_job* pJob) {
     static const unsigned short kYMask[] = { 0x0, 0xf, 0xff, 0xfff, 0xffff };
     static const unsigned short kXMask[] = { 0x0, 0x1111, 0x3333, 0x7777,
             0xffff };
     etc1_byte block[ETC1_DECODED_BLOCK_SIZE];
-    etc1_byte encoded[ETC1_ENCODED_BLOCK_SIZE];
 
+    etc1_uint32 width = pJob->width;
+    etc1_uint32 height = pJob->height;
+    etc1_uint32 pixelSize = pJob->pixelSize;
     etc1_uint32 encodedWidth = (width + 3) & ~3;
     etc1_uint32 encodedHeight = (height + 3) & ~3;
+    etc1_uint32 encodedRowSize = (encodedWidth >> 2) * ETC1_ENCODED_BLOCK_SIZE;
+
+    while (true) {
+        etc1_uint32 y = 4 * __sync_fetch_and_add(&pJob->nextBlockRow, 1);
+        if (y >= encodedHeight) {
+            break;
+        }
+        etc1_byte* pOut = pJob->pOut + (y >> 2) * encodedRowSize;
 
-    for (etc1_uint32 y = 0; y < encodedHeight; y += 4) {
         etc1_uint32 yEnd = height - y;
         if (yEnd > 4) {
             yEnd = 4;
@@ -537,7 +650,8 @@ int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 heigh
             int mask = ymask & kXMask[xEnd];
             for (etc1_uint32 cy = 0; cy < yEnd; cy++) {
                 etc1_byte* q = block + (cy * 4) * 3;
-                const etc1_byte* p = pIn + pixelSize * x + stride * (y + cy);
+                const etc1_byte* p = pJob->pIn + pixelSize * x
+                        + pJob->stride * (y + cy);
                 if (pixelSize == 3) {
                     memcpy(q, p, xEnd * 3);
                 } else {
@@ -550,11 +664,75 @@ int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 heigh
                     }
                 }
             }
-            etc1_encode_block(block, mask, encoded);
-            memcpy(pOut, encoded, sizeof(encoded));
-            pOut += sizeof(encoded);
+            etc_encode_block_quality(block, mask, pOut, pJob->quality);
+            pOut += ETC1_ENCODED_BLOCK_SIZE;
         }
     }
+}
+
+static void* etc_encode_thread(void* arg) {
+    etc_encode_rows((etc_encode_job*) arg);
+    return NULL;
+}
+
+// Encode an entire image.
+// pIn - pointer to the image data. Formatted such that the Red component of
+//       pixel (x,y) is at pIn + pixelSize * x + stride * y + redOffset;
+// pOut - pointer to encoded data. Must be large enough to store entire encoded image.
+
+int etc1_encode_image(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
+        etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut) {
+    return etc1_encode_image_ex(pIn, width, height, pixelSize, stride, pOut,
+            ETC1_QUALITY_HIGH, 1);
+}
+
+// Encode an entire image with the given quality, using numThreads threads
+// including the calling one. Rows of blocks are handed out to the threads
+// as they become idle.
+
+int etc1_encode_image_ex(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
+        etc1_uint32 pixelSize, etc1_uint32 stride, etc1_byte* pOut,
+        int quality, int numThreads) {
+    if (pixelSize < 2 || pixelSize > 3) {
+        return -1;
+    }
+    if (quality < ETC1_QUALITY_LOW || quality > ETC1_QUALITY_HIGH) {
+        return -1;
+    }
+
+    etc_encode_job job;
+    job.pIn = pIn;
+    job.width = width;
+    job.height = height;
+    job.pixelSize = pixelSize;
+    job.stride = stride;
+    job.pOut = pOut;
+    job.quality = quality;
+    job.nextBlockRow = 0;
+
+    // More threads than rows of blocks would have nothing to do.
+    int numBlockRows = (int) ((height + 3) >> 2);
+    if (numThreads > numBlockRows) {
+        numThreads = numBlockRows;
+    }
+
+    static const int kMaxThreads = 16;
+    pthread_t threads[kMaxThreads];
+    int numStarted = 0;
+    while (numStarted < numThreads - 1 && numStarted < kMaxThreads) {
+        if (pthread_create(&threads[numStarted], NULL, etc_encode_thread,
+                &job) != 0) {
+            // the remaining threads will pick up the work
+            break;
+        }
+        numStarted++;
+    }
+
+    etc_encode_rows(&job);
+
+    for (int i = 0; i < numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
     return 0;
 }
 
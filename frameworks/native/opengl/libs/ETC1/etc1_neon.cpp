@@ -0,0 +1,99 @@
+// Copyright 2009 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "etc1_neon.h"
+
+#include <arm_neon.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef AT_HWCAP
+#define AT_HWCAP    16
+#endif
+#ifndef HWCAP_NEON
+#define HWCAP_NEON  (1 << 12)
+#endif
+
+static inline int clamp(int x) {
+    return x >= 0 ? (x < 255 ? x : 255) : 0;
+}
+
+// Adds the score of one modifier for 4 pixels to the running best scores,
+// keeping the first modifier on ties like chooseModifier does.
+static inline void take_best(int16x4_t dr, int16x4_t dg, int16x4_t db,
+        uint32_t index, uint32x4_t* pBest, uint32x4_t* pIndex) {
+    int32x4_t score = vmull_s16(vmul_n_s16(dg, 6), dg);
+    score = vmlal_s16(score, vmul_n_s16(dr, 3), dr);
+    score = vmlal_s16(score, db, db);
+
+    uint32x4_t s = vreinterpretq_u32_s32(score);
+    uint32x4_t less = vcltq_u32(s, *pBest);
+    *pBest = vbslq_u32(less, s, *pBest);
+    *pIndex = vbslq_u32(less, vdupq_n_u32(index), *pIndex);
+}
+
+etc1_uint32 etc1_score_subblock_neon(const etc1_byte* pR, const etc1_byte* pG,
+        const etc1_byte* pB, const etc1_byte* pBaseColors,
+        const int* pModifierTable, etc1_byte* pIndices) {
+    int16x8_t r = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pR)));
+    int16x8_t g = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pG)));
+    int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pB)));
+
+    uint32x4_t bestLo = vdupq_n_u32(~0u);
+    uint32x4_t bestHi = vdupq_n_u32(~0u);
+    uint32x4_t indexLo = vdupq_n_u32(0);
+    uint32x4_t indexHi = vdupq_n_u32(0);
+
+    for (int i = 0; i < 4; i++) {
+        int modifier = pModifierTable[i];
+        int16x8_t dr = vsubq_s16(vdupq_n_s16(clamp(pBaseColors[0] + modifier)), r);
+        int16x8_t dg = vsubq_s16(vdupq_n_s16(clamp(pBaseColors[1] + modifier)), g);
+        int16x8_t db = vsubq_s16(vdupq_n_s16(clamp(pBaseColors[2] + modifier)), b);
+
+        take_best(vget_low_s16(dr), vget_low_s16(dg), vget_low_s16(db), i,
+                &bestLo, &indexLo);
+        take_best(vget_high_s16(dr), vget_high_s16(dg), vget_high_s16(db), i,
+                &bestHi, &indexHi);
+    }
+
+    uint16x8_t indices = vcombine_u16(vmovn_u32(indexLo), vmovn_u32(indexHi));
+    vst1_u8(pIndices, vmovn_u16(indices));
+
+    uint64x2_t sum = vpaddlq_u32(vaddq_u32(bestLo, bestHi));
+    return (etc1_uint32) (vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+// bionic has no getauxval(); read the aux vector directly
+bool etc1_cpu_has_neon() {
+    unsigned long entry[2];
+    bool neon = false;
+    int fd = open("/proc/self/auxv", O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    while (read(fd, entry, sizeof(entry)) == (ssize_t)sizeof(entry)) {
+        if (entry[0] == AT_HWCAP) {
+            neon = (entry[1] & HWCAP_NEON) != 0;
+            break;
+        }
+        if (entry[0] == 0) {
+            break;
+        }
+    }
+    close(fd);
+
+    return neon;
+}
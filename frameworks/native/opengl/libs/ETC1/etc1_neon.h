@@ -0,0 +1,34 @@
+// Copyright 2009 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __etc1_neon_h__
+#define __etc1_neon_h__
+
+#include <ETC1/etc1.h>
+
+// Returns whether the CPU we are running on supports NEON.
+
+bool etc1_cpu_has_neon();
+
+// Score the 8 pixels of a full sub-block, given in planar form, against the
+// base color pBaseColors modified by each entry of the 4 entry modifier
+// table pModifierTable. The index of the best modifier for each pixel is
+// stored in pIndices and the sum of the best scores is returned. Gives the
+// same results as chooseModifier in etc1.cpp.
+
+etc1_uint32 etc1_score_subblock_neon(const etc1_byte* pR, const etc1_byte* pG,
+        const etc1_byte* pB, const etc1_byte* pBaseColors,
+        const int* pModifierTable, etc1_byte* pIndices);
+
+#endif
@@ -64,6 +64,10 @@ GLTraceState::GLTraceState(TCPStream *stream) {
     mCollectFbOnGlDraw = false;
     mCollectTextureDataOnGlTexImage = false;
     pthread_rwlock_init(&mTraceOptionsRwLock, NULL);
+
+    mFirstFrame = 0;
+    mNumFrames = 0;
+    mFrameNumber = 0;
 }
 
 GLTraceState::~GLTraceState() {
@@ -114,10 +118,24 @@ bool GLTraceState::shouldCollectTextureDataOnGlTexImage() {
     return safeGetValue(&mCollectTextureDataOnGlTexImage, &mTraceOptionsRwLock);
 }
 
+void GLTraceState::setFramesToCapture(int first, int count) {
+    mFirstFrame = first;
+    mNumFrames = count;
+}
+
+bool GLTraceState::isCapturing() {
+    int frame = mFrameNumber;
+    return frame >= mFirstFrame && (mNumFrames == 0 || frame - mFirstFrame < mNumFrames);
+}
+
+void GLTraceState::endFrame() {
+    __sync_fetch_and_add(&mFrameNumber, 1);
+}
+
 GLTraceContext *GLTraceState::createTraceContext(int version, EGLContext eglContext) {
     int id = __sync_fetch_and_add(&mTraceContextIds, 1);
 
-    const size_t DEFAULT_BUFFER_SIZE = 8192;
+    const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
     BufferedOutputStream *stream = new BufferedOutputStream(mStream, DEFAULT_BUFFER_SIZE);
     GLTraceContext *traceContext = new GLTraceContext(id, version, this, stream);
     mPerContextState[eglContext] = traceContext;
@@ -207,12 +225,13 @@ void GLTraceContext::getCompressedFB(void **fb, unsigned *fbsize, unsigned *fbwi
 void GLTraceContext::traceGLMessage(GLMessage *msg) {
     mBufferedOutputStream->send(msg);
 
+    // Flushing only hands the buffer to the writer thread, but is still
+    // limited to frame and context boundaries so that messages are sent in
+    // large batches.
     GLMessage_Function func = msg->function();
     if (func == GLMessage::eglSwapBuffers
         || func == GLMessage::eglCreateContext
-        || func == GLMessage::eglMakeCurrent
-        || func == GLMessage::glDrawArrays
-        || func == GLMessage::glDrawElements) {
+        || func == GLMessage::eglMakeCurrent) {
         mBufferedOutputStream->flush();
     }
 }
@@ -96,6 +96,13 @@ class GLTraceState {
     bool mCollectTextureDataOnGlTexImage;
     pthread_rwlock_t mTraceOptionsRwLock;
 
+    /* Frames to capture: [mFirstFrame, mFirstFrame + mNumFrames), or all
+       frames from mFirstFrame on if mNumFrames is 0. mFrameNumber counts the
+       eglSwapBuffers calls so far. */
+    int mFirstFrame;
+    int mNumFrames;
+    volatile int mFrameNumber;
+
     /* helper methods to get/set values using provided lock for mutual exclusion. */
     void safeSetValue(bool *ptr, bool value, pthread_rwlock_t *lock);
     bool safeGetValue(bool *ptr, pthread_rwlock_t *lock);
@@ -117,6 +124,11 @@ public:
     bool shouldCollectFbOnEglSwap();
     bool shouldCollectFbOnGlDraw();
     bool shouldCollectTextureDataOnGlTexImage();
+
+    /* Methods to limit tracing to a range of frames. */
+    void setFramesToCapture(int first, int count);
+    bool isCapturing();
+    void endFrame();
 };
 
 void setupTraceContextThreadSpecific(GLTraceContext *context);
@@ -15,6 +15,7 @@
  */
 
 #include <arpa/inet.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <cutils/log.h>
 #include <cutils/properties.h>
@@ -140,6 +141,17 @@ int GLTrace_start() {
     // initialize tracing state
     sGLTraceState = new GLTraceState(stream);
 
+    // "first,count" limits tracing to count frames starting at frame first,
+    // a count of 0 traces all frames from there on
+    char frames[PROPERTY_VALUE_MAX];
+    int firstFrame, numFrames;
+    property_get("debug.egl.trace.frames", frames, "");
+    if (sscanf(frames, "%d,%d", &firstFrame, &numFrames) == 2
+            && firstFrame >= 0 && numFrames >= 0) {
+        ALOGD("tracing %d frames starting at frame %d", numFrames, firstFrame);
+        sGLTraceState->setFramesToCapture(firstFrame, numFrames);
+    }
+
     pthread_create(&sReceiveThreadId, NULL, commandReceiveTask, sGLTraceState);
 
 done:
@@ -200,7 +212,24 @@ void GLTrace_eglReleaseThread() {
 }
 
 void GLTrace_eglSwapBuffers(void *dpy, void *draw) {
-    gltrace::GLTrace_eglSwapBuffers(dpy, draw);
+    pthread_mutex_lock(&sGlTraceStateLock);
+    GLTraceState *state = sGLTraceState;
+    pthread_mutex_unlock(&sGlTraceStateLock);
+
+    if (state == NULL) return;
+
+    if (state->isCapturing()) {
+        gltrace::GLTrace_eglSwapBuffers(dpy, draw);
+    }
+    state->endFrame();
+}
+
+bool GLTrace_isCapturing() {
+    pthread_mutex_lock(&sGlTraceStateLock);
+    GLTraceState *state = sGLTraceState;
+    pthread_mutex_unlock(&sGlTraceStateLock);
+
+    return state != NULL && state->isCapturing();
 }
 
 gl_hooks_t *GLTrace_getGLHooks() {
@@ -94,13 +94,38 @@ int acceptClientConnection(char *sockname) {
 TCPStream::TCPStream(int socket) {
     mSocket = socket;
     pthread_mutex_init(&mSocketWriteMutex, NULL);
+
+    pthread_mutex_init(&mQueueMutex, NULL);
+    pthread_cond_init(&mQueueCond, NULL);
+    pthread_cond_init(&mSentCond, NULL);
+    mClosing = false;
+    mError = false;
+    mWriterStarted = pthread_create(&mWriterThread, NULL, writerTask, this) == 0;
+    if (!mWriterStarted) {
+        ALOGE("Error creating trace writer thread, sending synchronously");
+    }
 }
 
 TCPStream::~TCPStream() {
+    closeStream();
+
+    pthread_cond_destroy(&mSentCond);
+    pthread_cond_destroy(&mQueueCond);
+    pthread_mutex_destroy(&mQueueMutex);
     pthread_mutex_destroy(&mSocketWriteMutex);
 }
 
 void TCPStream::closeStream() {
+    if (mWriterStarted) {
+        pthread_mutex_lock(&mQueueMutex);
+        mClosing = true;
+        pthread_cond_signal(&mQueueCond);
+        pthread_mutex_unlock(&mQueueMutex);
+
+        pthread_join(mWriterThread, NULL);
+        mWriterStarted = false;
+    }
+
     if (mSocket > 0) {
         close(mSocket);
         mSocket = 0;
@@ -113,10 +138,82 @@ int TCPStream::send(void *buf, size_t len) {
     }
 
     pthread_mutex_lock(&mSocketWriteMutex);
-    int n = write(mSocket, buf, len);
+    size_t totalWritten = 0;
+    while (totalWritten < len) {
+        int n = write(mSocket, (uint8_t*)buf + totalWritten, len - totalWritten);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        totalWritten += n;
+    }
     pthread_mutex_unlock(&mSocketWriteMutex);
 
-    return n;
+    return totalWritten == len ? 0 : -1;
+}
+
+void *TCPStream::writerTask(void *arg) {
+    ((TCPStream *)arg)->writeQueuedBuffers();
+    return NULL;
+}
+
+void TCPStream::writeQueuedBuffers() {
+    pthread_mutex_lock(&mQueueMutex);
+
+    while (true) {
+        while (mQueue.empty() && !mClosing) {
+            pthread_cond_wait(&mQueueCond, &mQueueMutex);
+        }
+
+        if (mQueue.empty()) {
+            // closing, and everything queued has been sent
+            break;
+        }
+
+        OutputBuffer *buf = mQueue.front();
+        mQueue.pop();
+        bool error = mError;
+
+        pthread_mutex_unlock(&mQueueMutex);
+        if (!error && send((void *)buf->data.data(), buf->data.size()) < 0) {
+            ALOGE("Error sending trace data, dropping further messages");
+            error = true;
+        }
+        pthread_mutex_lock(&mQueueMutex);
+
+        mError = error;
+        buf->inFlight = false;
+        pthread_cond_broadcast(&mSentCond);
+    }
+
+    pthread_mutex_unlock(&mQueueMutex);
+}
+
+int TCPStream::sendAsync(OutputBuffer *buf) {
+    if (!mWriterStarted) {
+        return send((void *)buf->data.data(), buf->data.size());
+    }
+
+    pthread_mutex_lock(&mQueueMutex);
+    int status = mError ? -1 : 0;
+    if (!mError && !mClosing) {
+        buf->inFlight = true;
+        mQueue.push(buf);
+        pthread_cond_signal(&mQueueCond);
+    }
+    pthread_mutex_unlock(&mQueueMutex);
+
+    return status;
+}
+
+void TCPStream::waitUntilSent(OutputBuffer *buf) {
+    pthread_mutex_lock(&mQueueMutex);
+    while (buf->inFlight) {
+        pthread_cond_wait(&mSentCond, &mQueueMutex);
+    }
+    pthread_mutex_unlock(&mQueueMutex);
 }
 
 int TCPStream::receive(void *data, size_t len) {
@@ -142,31 +239,45 @@ BufferedOutputStream::BufferedOutputStream(TCPStream *stream, size_t bufferSize)
     mStream = stream;
 
     mBufferSize = bufferSize;
-    mStringBuffer = "";
-    mStringBuffer.reserve(bufferSize);
+    for (int i = 0; i < NUM_BUFFERS; i++) {
+        mBuffers[i].data.reserve(bufferSize);
+    }
+    mCurrentBuffer = 0;
 }
 
 int BufferedOutputStream::flush() {
-    if (mStringBuffer.size() == 0) {
+    OutputBuffer *buf = &mBuffers[mCurrentBuffer];
+    if (buf->data.size() == 0) {
         return 0;
     }
 
-    int n = mStream->send((void *)mStringBuffer.data(), mStringBuffer.size());
-    mStringBuffer.clear();
+    int n = mStream->sendAsync(buf);
+
+    // continue in the next buffer of the ring once it has been sent
+    mCurrentBuffer = (mCurrentBuffer + 1) % NUM_BUFFERS;
+    buf = &mBuffers[mCurrentBuffer];
+    mStream->waitUntilSent(buf);
+    buf->data.clear();
+
     return n;
 }
 
 void BufferedOutputStream::enqueueMessage(GLMessage *msg) {
+    std::string *buffer = &mBuffers[mCurrentBuffer].data;
     const uint32_t len = msg->ByteSize();
 
-    mStringBuffer.append((const char *)&len, sizeof(len));    // append header
-    msg->AppendToString(&mStringBuffer);                      // append message
+    buffer->append((const char *)&len, sizeof(len));    // append header
+
+    // append message, reusing the size computed above
+    size_t offset = buffer->size();
+    buffer->resize(offset + len);
+    msg->SerializeWithCachedSizesToArray((uint8_t *)&(*buffer)[offset]);
 }
 
 int BufferedOutputStream::send(GLMessage *msg) {
     enqueueMessage(msg);
 
-    if (mStringBuffer.size() > mBufferSize) {
+    if (mBuffers[mCurrentBuffer].data.size() > mBufferSize) {
         return flush();
     }
 
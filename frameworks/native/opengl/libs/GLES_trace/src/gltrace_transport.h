@@ -19,11 +19,24 @@
 
 #include <pthread.h>
 
+#include <queue>
+
 #include "gltrace.pb.h"
 
 namespace android {
 namespace gltrace {
 
+/**
+ * OutputBuffer holds encoded messages waiting to be sent. Buffers are filled
+ * by a BufferedOutputStream and written out by the TCPStream's writer thread.
+ */
+struct OutputBuffer {
+    std::string data;
+    bool inFlight;              /* queued or being written, guarded by the TCPStream */
+
+    OutputBuffer() : inFlight(false) {}
+};
+
 /**
  * TCPStream provides a TCP based communication channel from the device to
  * the host for transferring GLMessages.
@@ -31,17 +44,41 @@ namespace gltrace {
 class TCPStream {
     int mSocket;
     pthread_mutex_t mSocketWriteMutex;
+
+    /* Buffers are written to the socket by a separate thread, so that tracing
+       threads do not wait for the host to read the data. */
+    pthread_t mWriterThread;
+    pthread_mutex_t mQueueMutex;
+    pthread_cond_t mQueueCond;          /* signalled when a buffer is queued */
+    pthread_cond_t mSentCond;           /* signalled when a buffer has been sent */
+    std::queue<OutputBuffer *> mQueue;
+    bool mWriterStarted;
+    bool mClosing;
+    bool mError;
+
+    static void *writerTask(void *arg);
+    void writeQueuedBuffers();
 public:
     /** Create a TCP based communication channel over @socket */
     TCPStream(int socket);
     ~TCPStream();
 
-    /** Close the channel. */
+    /** Close the channel, after any queued buffers have been sent. */
     void closeStream();
 
     /** Send @data of size @len to host. . Returns -1 on error, 0 on success. */
     int send(void *data, size_t len);
 
+    /**
+     * Queue the contents of @buf to be sent to the host by the writer thread.
+     * @buf must not be modified until waitUntilSent() has returned for it.
+     * Returns -1 if the channel failed earlier, 0 otherwise.
+     */
+    int sendAsync(OutputBuffer *buf);
+
+    /** Wait until @buf is no longer queued or being written. */
+    void waitUntilSent(OutputBuffer *buf);
+
     /**
      * Receive @len bytes of data into @buf from the remote end. This is a blocking call.
      * Returns -1 on failure, 0 on success.
@@ -51,13 +88,18 @@ public:
 
 /**
  * BufferedOutputStream provides buffering of data sent to the underlying
- * unbuffered channel.
+ * channel. Messages are encoded into a small ring of buffers: a full buffer
+ * is handed to the channel's writer thread and encoding continues in the
+ * next one, only waiting if that one has not been sent yet.
  */
 class BufferedOutputStream {
+    enum { NUM_BUFFERS = 4 };
+
     TCPStream *mStream;
 
     size_t mBufferSize;
-    std::string mStringBuffer;
+    OutputBuffer mBuffers[NUM_BUFFERS];
+    int mCurrentBuffer;
 
     /** Enqueue message into internal buffer. */
     void enqueueMessage(GLMessage *msg);
@@ -74,7 +116,10 @@ public:
      */
     int send(GLMessage *msg);
 
-    /** Send any buffered messages, returns -1 on error, 0 on success. */
+    /**
+     * Hand any buffered messages to the channel, returns -1 on error, 0 on
+     * success. The messages are sent asynchronously.
+     */
     int flush();
 };
 
@@ -33,6 +33,11 @@ void GLTrace_eglSwapBuffers(void*, void*);
 int GLTrace_start();
 void GLTrace_stop();
 
+/* Returns whether the current frame is in the range of frames to be traced,
+   see debug.egl.trace.frames. GL calls outside of it need not be routed
+   through the trace hooks. */
+bool GLTrace_isCapturing();
+
 /* Obtain the gl_hooks structure filled with the trace implementation for all GL functions. */
 gl_hooks_t *GLTrace_getGLHooks();
 
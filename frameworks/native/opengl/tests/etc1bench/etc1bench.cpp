@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the speed and quality of the ETC1 encoder settings.
+//
+// usage: test-opengl-etc1bench [image.ppm] [max threads]
+//
+// Without an image, a synthetic 1024 x 1024 image with smooth color changes,
+// edges and noise is used. The ETC1_QUALITY_HIGH single threaded row is what
+// etc1_encode_image does.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ETC1/etc1.h>
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Reads a binary (P6) PPM file with 8 bit samples.
+static etc1_byte* readPPM(const char* name, etc1_uint32* width, etc1_uint32* height) {
+    FILE* f = fopen(name, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    unsigned w, h, maxval;
+    etc1_byte* pixels = NULL;
+    if (fscanf(f, "P6 %u %u %u", &w, &h, &maxval) == 3 && maxval == 255
+            && fgetc(f) != EOF) {
+        pixels = new etc1_byte[w * h * 3];
+        if (fread(pixels, 3, w * h, f) != w * h) {
+            delete[] pixels;
+            pixels = NULL;
+        }
+    }
+    fclose(f);
+
+    *width = w;
+    *height = h;
+    return pixels;
+}
+
+static etc1_byte clampByte(double x) {
+    return x < 0 ? 0 : (x > 255 ? 255 : (etc1_byte) x);
+}
+
+static etc1_byte* makeImage(etc1_uint32 width, etc1_uint32 height) {
+    etc1_byte* pixels = new etc1_byte[width * height * 3];
+    srand(1);
+    for (etc1_uint32 y = 0; y < height; y++) {
+        for (etc1_uint32 x = 0; x < width; x++) {
+            etc1_byte* p = pixels + (x + y * width) * 3;
+            int noise = rand() % 13 - 6;
+            // smooth color variations, with some sharp edges
+            double edge = ((x / 96 + y / 64) % 3 == 0) ? 60 : 0;
+            p[0] = clampByte(128 + 100 * sin(x / 23.0) * cos(y / 17.0) + noise);
+            p[1] = clampByte(128 + 90 * sin((x + y) / 31.0) - edge + noise);
+            p[2] = clampByte(128 + 80 * cos(x / 11.0 + y / 29.0) + edge);
+        }
+    }
+    return pixels;
+}
+
+static double psnr(const etc1_byte* a, const etc1_byte* b, size_t size) {
+    double sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        int d = a[i] - b[i];
+        sum += d * d;
+    }
+    if (sum == 0) {
+        return INFINITY;
+    }
+    return 10 * log10(255.0 * 255.0 * size / sum);
+}
+
+int main(int argc, char** argv) {
+    etc1_uint32 width = 1024;
+    etc1_uint32 height = 1024;
+    etc1_byte* pixels;
+    if (argc > 1) {
+        pixels = readPPM(argv[1], &width, &height);
+        if (pixels == NULL) {
+            fprintf(stderr, "cannot read %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        pixels = makeImage(width, height);
+    }
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 4;
+
+    etc1_uint32 stride = width * 3;
+    etc1_byte* encoded = new etc1_byte[etc1_get_encoded_data_size(width, height)];
+    etc1_byte* decoded = new etc1_byte[width * height * 3];
+
+    static const char* kQualityNames[] = { "low", "medium", "high" };
+
+    printf("%u x %u\n", width, height);
+    printf("quality  threads   MPix/s    PSNR\n");
+    for (int quality = ETC1_QUALITY_HIGH; quality >= ETC1_QUALITY_LOW; quality--) {
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            // repeat small images so that the timing means something
+            int iterations = 0;
+            double start = now();
+            double elapsed;
+            do {
+                etc1_encode_image_ex(pixels, width, height, 3, stride, encoded,
+                        quality, threads);
+                iterations++;
+                elapsed = now() - start;
+            } while (elapsed < 0.5);
+
+            etc1_decode_image(encoded, decoded, width, height, 3, stride);
+            printf("%-8s %7d %8.2f %7.2f\n", kQualityNames[quality], threads,
+                    (double) width * height * iterations / elapsed / 1e6,
+                    psnr(pixels, decoded, width * height * 3));
+        }
+    }
+
+    delete[] decoded;
+    delete[] encoded;
+    delete[] pixels;
+    return 0;
+}
@@ -0,0 +1,17 @@
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	tilerbench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libutils \
+	libEGL \
+	libGLESv1_CM
+
+LOCAL_MODULE:= test-opengl-tilerbench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
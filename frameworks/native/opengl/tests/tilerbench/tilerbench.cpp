@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the time the software renderer (libagl) takes to compose a few
+ * typical UI frames, in the spirit of cmds/flatland which does the same for
+ * GLES 2.0 GPUs. Rendering goes to a pbuffer, so no display is needed.
+ *
+ * Run it once with the tiler disabled and once with
+ *   setprop debug.libagl.tiler.threads <n>
+ * to compare. The property is read when the context is created.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+#include <GLES/gl.h>
+#include <GLES/glext.h>
+
+#include <cutils/properties.h>
+#include <utils/Timers.h>
+
+struct Layer {
+    float x, y, w, h;   // in units of the screen size
+    bool opaque;
+};
+
+struct Scenario {
+    const char* name;
+    int numLayers;
+    Layer layers[6];
+};
+
+static const Scenario scenarios[] = {
+    { "Single Static Window", 3, {
+        { 0.0f, 0.00f, 1.0f, 1.00f, true  },    // app
+        { 0.0f, 0.00f, 1.0f, 0.05f, false },    // status bar
+        { 0.0f, 0.92f, 1.0f, 0.08f, false },    // navigation bar
+    } },
+    { "App -> Home Transition", 5, {
+        { 0.0f, 0.00f, 1.0f, 1.00f, true  },    // wallpaper
+        { 0.0f, 0.05f, 1.0f, 0.87f, false },    // launcher
+        { 0.1f, 0.10f, 0.8f, 0.80f, false },    // app, shrinking
+        { 0.0f, 0.00f, 1.0f, 0.05f, false },    // status bar
+        { 0.0f, 0.92f, 1.0f, 0.08f, false },    // navigation bar
+    } },
+    { "Dialog Over App", 5, {
+        { 0.0f, 0.00f, 1.0f, 1.00f, true  },    // app
+        { 0.0f, 0.00f, 1.0f, 1.00f, false },    // dim layer
+        { 0.1f, 0.30f, 0.8f, 0.40f, false },    // dialog
+        { 0.0f, 0.00f, 1.0f, 0.05f, false },    // status bar
+        { 0.0f, 0.92f, 1.0f, 0.08f, false },    // navigation bar
+    } },
+};
+
+static const struct {
+    int w, h;
+} resolutions[] = {
+    {  480,  800 },
+    {  720, 1280 },
+    { 1080, 1920 },
+};
+
+static const int kTextureSize = 256;
+static const int kFrames = 20;
+
+static GLuint createTexture(bool opaque) {
+    uint32_t* pixels = new uint32_t[kTextureSize * kTextureSize];
+    for (int y = 0; y < kTextureSize; y++) {
+        for (int x = 0; x < kTextureSize; x++) {
+            uint32_t a = opaque ? 0xff : ((x ^ y) & 0x80) ? 0xc0 : 0x40;
+            uint32_t r = x, g = y, b = (x + y) / 2;
+            // premultiplied, as the UI toolkit produces them
+            if (!opaque) {
+                r = r * a / 255;
+                g = g * a / 255;
+                b = b * a / 255;
+            }
+            pixels[x + y * kTextureSize] = (a << 24) | (b << 16) | (g << 8) | r;
+        }
+    }
+
+    GLuint name;
+    glGenTextures(1, &name);
+    glBindTexture(GL_TEXTURE_2D, name);
+    glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kTextureSize, kTextureSize, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    delete[] pixels;
+    return name;
+}
+
+static void drawLayer(const Layer& l, int w, int h) {
+    const GLfloat x0 = l.x * w, x1 = (l.x + l.w) * w;
+    const GLfloat y0 = l.y * h, y1 = (l.y + l.h) * h;
+    const GLfloat vertices[4][2] = {
+        { x0, y0 }, { x0, y1 }, { x1, y1 }, { x1, y0 },
+    };
+    static const GLfloat texCoords[4][2] = {
+        { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 },
+    };
+
+    if (l.opaque) {
+        glDisable(GL_BLEND);
+    } else {
+        glEnable(GL_BLEND);
+    }
+    glVertexPointer(2, GL_FLOAT, 0, vertices);
+    glTexCoordPointer(2, GL_FLOAT, 0, texCoords);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+}
+
+static double runScenario(EGLDisplay dpy, EGLConfig config,
+        const Scenario& s, int w, int h) {
+    const EGLint surfaceAttribs[] = {
+        EGL_WIDTH, w,
+        EGL_HEIGHT, h,
+        EGL_NONE
+    };
+    EGLSurface surface = eglCreatePbufferSurface(dpy, config, surfaceAttribs);
+    EGLContext context = eglCreateContext(dpy, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "couldn't create a %dx%d pbuffer\n", w, h);
+        exit(1);
+    }
+    eglMakeCurrent(dpy, surface, surface, context);
+
+    GLuint opaqueTexture = createTexture(true);
+    GLuint blendedTexture = createTexture(false);
+
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrthof(0, w, h, 0, 0, 1);
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvx(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DITHER);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    nsecs_t best = 0;
+    for (int frame = 0; frame < kFrames; frame++) {
+        nsecs_t start = systemTime();
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (int i = 0; i < s.numLayers; i++) {
+            const Layer& l = s.layers[i];
+            glBindTexture(GL_TEXTURE_2D,
+                    l.opaque ? opaqueTexture : blendedTexture);
+            drawLayer(l, w, h);
+        }
+        glFinish();
+        nsecs_t t = systemTime() - start;
+        if (frame == 0 || t < best) {
+            best = t;
+        }
+    }
+
+    glDeleteTextures(1, &opaqueTexture);
+    glDeleteTextures(1, &blendedTexture);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(dpy, context);
+    eglDestroySurface(dpy, surface);
+
+    return best / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 5,
+        EGL_GREEN_SIZE, 6,
+        EGL_BLUE_SIZE, 5,
+        EGL_NONE
+    };
+
+    EGLDisplay dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    eglInitialize(dpy, NULL, NULL);
+
+    EGLConfig config;
+    EGLint numConfigs;
+    if (!eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs) ||
+            numConfigs < 1) {
+        fprintf(stderr, "couldn't find a pbuffer EGLConfig\n");
+        return 1;
+    }
+
+    char threads[PROPERTY_VALUE_MAX];
+    property_get("debug.libagl.tiler.threads", threads, "0");
+    printf("debug.libagl.tiler.threads: %s\n", threads);
+    printf(" %-24s | Resolution  | Time (ms)\n", "Scenario");
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        for (size_t j = 0; j < sizeof(resolutions) / sizeof(resolutions[0]); j++) {
+            double ms = runScenario(dpy, config, scenarios[i],
+                    resolutions[j].w, resolutions[j].h);
+            printf(" %-24s | %4d x %4d | %7.3f\n", scenarios[i].name,
+                    resolutions[j].w, resolutions[j].h, ms);
+        }
+    }
+
+    eglTerminate(dpy);
+    return 0;
+}
@@ -126,6 +126,45 @@ static mat<TYPE, 3, 3> crossMatrix(const vec<TYPE, 3>& p, OTHER_TYPE diag) {
     return r;
 }
 
+/*
+ * Fixed-size 3x3 products used by predict() and update(). The generic mat<>
+ * operators build a temporary for every transpose and partial product; these
+ * are fully unrolled so the operands stay in registers and the compiler can
+ * vectorize the rows. Matrices are stored column-major: m[column][row].
+ */
+
+// a*b
+static inline mat33_t mul(const mat33_t& a, const mat33_t& b) {
+    mat33_t r;
+    for (size_t c=0 ; c<3 ; c++) {
+        for (size_t i=0 ; i<3 ; i++) {
+            r[c][i] = a[0][i]*b[c][0] + a[1][i]*b[c][1] + a[2][i]*b[c][2];
+        }
+    }
+    return r;
+}
+
+// a*transpose(b)
+static inline mat33_t mulABt(const mat33_t& a, const mat33_t& b) {
+    mat33_t r;
+    for (size_t c=0 ; c<3 ; c++) {
+        for (size_t i=0 ; i<3 ; i++) {
+            r[c][i] = a[0][i]*b[0][c] + a[1][i]*b[1][c] + a[2][i]*b[2][c];
+        }
+    }
+    return r;
+}
+
+// transpose(a)*b
+static inline mat33_t mulAtB(const mat33_t& a, const mat33_t& b) {
+    mat33_t r;
+    for (size_t c=0 ; c<3 ; c++) {
+        for (size_t i=0 ; i<3 ; i++) {
+            r[c][i] = a[i][0]*b[c][0] + a[i][1]*b[c][1] + a[i][2]*b[c][2];
+        }
+    }
+    return r;
+}
 
 template<typename TYPE, size_t SIZE>
 class Covariance {
@@ -425,7 +464,22 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    // P = Phi*P*Phi' + GQGt, expanded on the 3x3 blocks. Since Phi01 is
+    // zero and Phi11 is the identity, this takes 6 block products instead
+    // of the 16 of the full 6x6 product:
+    //
+    //  T    = Phi00*P10 + Phi10*P11
+    //  P00' = (Phi00*P00 + Phi10*P01)*Phi00' + T*Phi10'
+    //  P10' = T
+    //  P11' = P11
+    const mat33_t& Phi00(Phi[0][0]);
+    const mat33_t& Phi10(Phi[1][0]);
+    const mat33_t T(mul(Phi00, P[1][0]) + mul(Phi10, P[1][1]));
+    const mat33_t M(mul(Phi00, P[0][0]) + mulABt(Phi10, P[1][0]));
+    P[0][0] = mulABt(M, Phi00) + mulABt(T, Phi10) + GQGt[0][0];
+    P[1][0] = T + GQGt[1][0];
+    P[0][1] = transpose(P[1][0]);
+    P[1][1] += GQGt[1][1];
 
     checkState();
 }
@@ -446,9 +500,9 @@ void Fusion::update(const vec3_t& z, const vec3_t& Bi, float sigma) {
     const mat33_t R(sigma*sigma);
     const mat33_t S(scaleCovariance(L, P[0][0]) + R);
     const mat33_t Si(invert(S));
-    const mat33_t LtSi(transpose(L)*Si);
-    K[0] = P[0][0] * LtSi;
-    K[1] = transpose(P[1][0])*LtSi;
+    const mat33_t LtSi(mulAtB(L, Si));
+    K[0] = mul(P[0][0], LtSi);
+    K[1] = mulAtB(P[1][0], LtSi);
 
     // update...
     // P = (I-K*H) * P
@@ -457,11 +511,11 @@ void Fusion::update(const vec3_t& z, const vec3_t& Bi, float sigma) {
     // | K1 |                 | K1*L  0 |   | P01  P11 |   | K1*L*P00  K1*L*P10 |
     // Note: the Joseph form is numerically more stable and given by:
     //     P = (I-KH) * P * (I-KH)' + K*R*R'
-    const mat33_t K0L(K[0] * L);
-    const mat33_t K1L(K[1] * L);
-    P[0][0] -= K0L*P[0][0];
-    P[1][1] -= K1L*P[1][0];
-    P[1][0] -= K0L*P[1][0];
+    const mat33_t K0L(mul(K[0], L));
+    const mat33_t K1L(mul(K[1], L));
+    P[0][0] -= mul(K0L, P[0][0]);
+    P[1][1] -= mul(K1L, P[1][0]);
+    P[1][0] -= mul(K0L, P[1][0]);
     P[0][1] = transpose(P[1][0]);
 
     const vec3_t e(z - Bb);
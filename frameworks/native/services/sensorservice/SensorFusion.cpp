@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+
+#include <cutils/properties.h>
+
 #include "SensorDevice.h"
 #include "SensorFusion.h"
 #include "SensorService.h"
@@ -21,12 +25,30 @@
 namespace android {
 // ---------------------------------------------------------------------------
 
+/*
+ * Rate at which accelerometer and magnetometer samples are fed to the
+ * filter's update step. The magnetometer already runs at 50 Hz; at high
+ * accelerometer rates most acc updates barely move the estimate, so they
+ * are decimated down to this rate. Set ro.sensors.fusion.update_rate to 0
+ * to update on every sample.
+ */
+static const char* const kUpdateRateProperty = "ro.sensors.fusion.update_rate";
+static const char* const kDefaultUpdateRateHz = "100";
+
 ANDROID_SINGLETON_STATIC_INSTANCE(SensorFusion)
 
 SensorFusion::SensorFusion()
     : mSensorDevice(SensorDevice::getInstance()),
-      mEnabled(false), mGyroTime(0)
+      mEnabled(false), mGyroTime(0), mUpdatePeriodNs(0),
+      mNextAccUpdate(0), mNextMagUpdate(0)
 {
+    char value[PROPERTY_VALUE_MAX];
+    property_get(kUpdateRateProperty, value, kDefaultUpdateRateHz);
+    const int updateRateHz = atoi(value);
+    if (updateRateHz > 0) {
+        mUpdatePeriodNs = 1000000000LL/updateRateHz;
+    }
+
     sensor_t const* list;
     Sensor uncalibratedGyro;
     ssize_t count = mSensorDevice.getSensorList(&list);
@@ -73,15 +95,37 @@ void SensorFusion::process(const sensors_event_t& event) {
         }
         mGyroTime = event.timestamp;
     } else if (event.type == SENSOR_TYPE_MAGNETIC_FIELD) {
-        const vec3_t mag(event.data);
-        mFusion.handleMag(mag);
+        if (isUpdateDue(event.timestamp, mNextMagUpdate)) {
+            const vec3_t mag(event.data);
+            mFusion.handleMag(mag);
+        }
     } else if (event.type == SENSOR_TYPE_ACCELEROMETER) {
-        const vec3_t acc(event.data);
-        mFusion.handleAcc(acc);
+        if (isUpdateDue(event.timestamp, mNextAccUpdate)) {
+            const vec3_t acc(event.data);
+            mFusion.handleAcc(acc);
+        }
+        // the attitude follows the gyro even when the update is skipped
         mAttitude = mFusion.getAttitude();
     }
 }
 
+bool SensorFusion::isUpdateDue(nsecs_t timestamp, nsecs_t& nextUpdate) const {
+    // every sample counts while the filter is initializing
+    if (mUpdatePeriodNs == 0 || !mFusion.hasEstimate()) {
+        return true;
+    }
+    if (timestamp < nextUpdate) {
+        return false;
+    }
+    // step by whole periods so sample jitter doesn't lower the rate, but
+    // resynchronize after a gap
+    nextUpdate += mUpdatePeriodNs;
+    if (nextUpdate <= timestamp) {
+        nextUpdate = timestamp + mUpdatePeriodNs;
+    }
+    return true;
+}
+
 template <typename T> inline T min(T a, T b) { return a<b ? a : b; }
 template <typename T> inline T max(T a, T b) { return a>b ? a : b; }
 
@@ -112,6 +156,8 @@ status_t SensorFusion::activate(void* ident, bool enabled) {
         if (newState) {
             mFusion.init();
             mGyroTime = 0;
+            mNextAccUpdate = 0;
+            mNextMagUpdate = 0;
         }
     }
     return NO_ERROR;
@@ -140,11 +186,13 @@ int32_t SensorFusion::getMinDelay() const {
 void SensorFusion::dump(String8& result) {
     const Fusion& fusion(mFusion);
     result.appendFormat("9-axis fusion %s (%d clients), gyro-rate=%7.2fHz, "
+            "update-rate=%7.2fHz, "
             "q=< %g, %g, %g, %g > (%g), "
             "b=< %g, %g, %g >\n",
             mEnabled ? "enabled" : "disabled",
             mClients.size(),
             mEstimatedGyroRate,
+            mUpdatePeriodNs ? 1000000000.0f/mUpdatePeriodNs : 0.0f,
             fusion.getAttitude().x,
             fusion.getAttitude().y,
             fusion.getAttitude().z,
@@ -47,10 +47,17 @@ class SensorFusion : public Singleton<SensorFusion> {
     float mEstimatedGyroRate;
     nsecs_t mTargetDelayNs;
     nsecs_t mGyroTime;
+    // Minimum period between accelerometer / magnetometer updates of the
+    // filter, 0 to update on every sample. The gyro still drives predict()
+    // at its full rate.
+    nsecs_t mUpdatePeriodNs;
+    nsecs_t mNextAccUpdate;
+    nsecs_t mNextMagUpdate;
     vec4_t mAttitude;
     SortedVector<void*> mClients;
 
     SensorFusion();
+    bool isUpdateDue(nsecs_t timestamp, nsecs_t& nextUpdate) const;
 
 public:
     void process(const sensors_event_t& event);
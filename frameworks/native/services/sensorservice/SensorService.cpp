@@ -590,6 +590,17 @@ status_t SensorService::enable(const sp<SensorEventConnection>& connection,
         samplingPeriodNs = minDelayNs;
     }
 
+    // A sensor without a h/w FIFO cannot honor a report latency by itself. For continuous
+    // sensors run it unbatched and hold its events on the connection until the latency expires,
+    // so the client is woken up once per batch instead of once per sample.
+    nsecs_t softBatchLatencyNs = 0;
+    if (maxBatchReportLatencyNs > 0 && minDelayNs > 0 &&
+            sensor->getSensor().getFifoMaxEventCount() == 0) {
+        softBatchLatencyNs = maxBatchReportLatencyNs;
+        maxBatchReportLatencyNs = 0;
+    }
+    connection->setSoftBatchLatency(handle, softBatchLatencyNs);
+
     ALOGD_IF(DEBUG_CONNECTIONS, "Calling batch handle==%d flags=%d rate=%lld timeout== %lld",
              handle, reservedFlags, samplingPeriodNs, maxBatchReportLatencyNs);
 
@@ -729,11 +740,19 @@ SensorService::SensorEventConnection::SensorEventConnection(
     : mService(service), mUid(uid)
 {
     const SensorDevice& device(SensorDevice::getInstance());
+    size_t bufferSize;
     if (device.getHalDeviceVersion() >= SENSORS_DEVICE_API_VERSION_1_1) {
         // Increase socket buffer size to 1MB for batching capabilities.
-        mChannel = new BitTube(service->mSocketBufferSize);
+        bufferSize = service->mSocketBufferSize;
     } else {
-        mChannel = new BitTube(SOCKET_BUFFER_SIZE_NON_BATCHED);
+        bufferSize = SOCKET_BUFFER_SIZE_NON_BATCHED;
+    }
+    mChannel = new BitTube(bufferSize);
+    // A software batch goes out as one packet: keep it to half the socket buffer and within
+    // what the receiving SensorEventQueue reads at once.
+    mSoftBatchMaxEvents = bufferSize / (2 * sizeof(sensors_event_t));
+    if (mSoftBatchMaxEvents > size_t(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT)) {
+        mSoftBatchMaxEvents = SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT;
     }
 }
 
@@ -751,11 +770,16 @@ void SensorService::SensorEventConnection::dump(String8& result) {
     Mutex::Autolock _l(mConnectionLock);
     for (size_t i = 0; i < mSensorInfo.size(); ++i) {
         const FlushInfo& flushInfo = mSensorInfo.valueAt(i);
-        result.appendFormat("\t %s | status: %s | pending flush events %d\n",
+        result.appendFormat("\t %s | status: %s | pending flush events %d"
+                            " | soft batch latency %lld\n",
                             mService->getSensorName(mSensorInfo.keyAt(i)).string(),
                             flushInfo.mFirstFlushPending ? "First flush pending" :
                                                            "active",
-                            flushInfo.mPendingFlushEventsToSend);
+                            flushInfo.mPendingFlushEventsToSend,
+                            flushInfo.mSoftBatchLatencyNs);
+    }
+    if (!mSoftBatch.isEmpty()) {
+        result.appendFormat("\t %d events held in soft batch\n", mSoftBatch.size());
     }
 }
 
@@ -770,6 +794,8 @@ bool SensorService::SensorEventConnection::addSensor(int32_t handle) {
 
 bool SensorService::SensorEventConnection::removeSensor(int32_t handle) {
     Mutex::Autolock _l(mConnectionLock);
+    // Deliver what has been held back so far before the batching parameters change.
+    drainSoftBatchLocked();
     if (mSensorInfo.removeItem(handle) >= 0) {
         return true;
     }
@@ -796,6 +822,16 @@ void SensorService::SensorEventConnection::setFirstFlushPending(int32_t handle,
     }
 }
 
+void SensorService::SensorEventConnection::setSoftBatchLatency(int32_t handle,
+                                nsecs_t latencyNs) {
+    Mutex::Autolock _l(mConnectionLock);
+    ssize_t index = mSensorInfo.indexOfKey(handle);
+    if (index >= 0) {
+        FlushInfo& flushInfo = mSensorInfo.editValueAt(index);
+        flushInfo.mSoftBatchLatencyNs = latencyNs;
+    }
+}
+
 status_t SensorService::SensorEventConnection::sendEvents(
         sensors_event_t const* buffer, size_t numEvents,
         sensors_event_t* scratch)
@@ -849,6 +885,10 @@ status_t SensorService::SensorEventConnection::sendEvents(
         // flush complete events to be sent.
         for (size_t i = 0; i < mSensorInfo.size(); ++i) {
             FlushInfo& flushInfo = mSensorInfo.editValueAt(i);
+            if (flushInfo.mPendingFlushEventsToSend > 0) {
+                // Events batched before the flush request must reach the client first.
+                drainSoftBatchLocked();
+            }
             while (flushInfo.mPendingFlushEventsToSend > 0) {
                 flushCompleteEvent.meta_data.sensor = mSensorInfo.keyAt(i);
                 ssize_t size = SensorEventQueue::write(mChannel, &flushCompleteEvent, 1);
@@ -869,6 +909,13 @@ status_t SensorService::SensorEventConnection::sendEvents(
         return status_t(NO_ERROR);
     }
 
+    {
+        Mutex::Autolock _l(mConnectionLock);
+        if (softBatchEventsLocked(scratch, count)) {
+            return status_t(NO_ERROR);
+        }
+    }
+
     // NOTE: ASensorEvent and sensors_event_t are the same type
     ssize_t size = SensorEventQueue::write(mChannel,
             reinterpret_cast<ASensorEvent const*>(scratch), count);
@@ -900,6 +947,52 @@ void SensorService::SensorEventConnection::countFlushCompleteEventsLocked(
     return;
 }
 
+nsecs_t SensorService::SensorEventConnection::getSoftBatchLatencyLocked() const {
+    nsecs_t latencyNs = 0;
+    for (size_t i = 0; i < mSensorInfo.size(); ++i) {
+        const nsecs_t sensorLatencyNs = mSensorInfo.valueAt(i).mSoftBatchLatencyNs;
+        if (sensorLatencyNs == 0) {
+            return 0;
+        }
+        if (latencyNs == 0 || sensorLatencyNs < latencyNs) {
+            latencyNs = sensorLatencyNs;
+        }
+    }
+    return latencyNs;
+}
+
+bool SensorService::SensorEventConnection::softBatchEventsLocked(
+                sensors_event_t const* events, size_t count) {
+    const nsecs_t latencyNs = getSoftBatchLatencyLocked();
+    bool hasFlushComplete = false;
+    for (size_t i = 0; i < count && !hasFlushComplete; ++i) {
+        hasFlushComplete = events[i].type == SENSOR_TYPE_META_DATA;
+    }
+    if (latencyNs == 0 || hasFlushComplete || mSoftBatch.size() + count > mSoftBatchMaxEvents) {
+        drainSoftBatchLocked();
+        return false;
+    }
+    mSoftBatch.appendArray(events, count);
+    const nsecs_t spanNs = mSoftBatch[mSoftBatch.size() - 1].timestamp - mSoftBatch[0].timestamp;
+    if (spanNs >= latencyNs || mSoftBatch.size() == mSoftBatchMaxEvents) {
+        drainSoftBatchLocked();
+    }
+    return true;
+}
+
+void SensorService::SensorEventConnection::drainSoftBatchLocked() {
+    if (mSoftBatch.isEmpty()) {
+        return;
+    }
+    // NOTE: ASensorEvent and sensors_event_t are the same type
+    ssize_t size = SensorEventQueue::write(mChannel,
+            reinterpret_cast<ASensorEvent const*>(mSoftBatch.array()), mSoftBatch.size());
+    // The batch never holds flush complete events, so there is nothing to count if the
+    // destination is full and the events are dropped.
+    ALOGD_IF(DEBUG_CONNECTIONS && size < 0, "dropping %d batched events ", mSoftBatch.size());
+    mSoftBatch.clear();
+}
+
 sp<BitTube> SensorService::SensorEventConnection::getSensorChannel() const
 {
     return mChannel;
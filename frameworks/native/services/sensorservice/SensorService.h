@@ -84,6 +84,14 @@ class SensorService :
         // Increment mPendingFlushEventsToSend in mSensorInfo. These flush complete events will be
         // sent separately before the next batch of events.
         void countFlushCompleteEventsLocked(sensors_event_t* scratch, int numEventsDropped);
+        // Smallest software batching latency over all sensors of this connection, or 0 if any
+        // of them must be delivered as soon as it arrives.
+        nsecs_t getSoftBatchLatencyLocked() const;
+        // Append events to mSoftBatch when this connection batches in software and write the
+        // batch out once it spans the report latency. Returns false if the caller must write
+        // the events itself; any events already batched have been written by then.
+        bool softBatchEventsLocked(sensors_event_t const* events, size_t count);
+        void drainSoftBatchLocked();
 
         sp<SensorService> const mService;
         sp<BitTube> mChannel;
@@ -97,10 +105,19 @@ class SensorService :
             // Every activate is preceded by a flush. Only after the first flush complete is
             // received, the events for the sensor are sent on that *connection*.
             bool mFirstFlushPending;
-            FlushInfo() : mPendingFlushEventsToSend(0), mFirstFlushPending(false) {}
+            // Report latency requested for a sensor without a hardware FIFO. Its events are
+            // held in mSoftBatch instead of the h/w FIFO.
+            nsecs_t mSoftBatchLatencyNs;
+            FlushInfo() : mPendingFlushEventsToSend(0), mFirstFlushPending(false),
+                          mSoftBatchLatencyNs(0) {}
         };
         // protected by SensorService::mLock. Key for this vector is the sensor handle.
         KeyedVector<int, FlushInfo> mSensorInfo;
+        // Events held back for software batching, protected by mConnectionLock. Never holds
+        // flush complete events and never grows beyond mSoftBatchMaxEvents, which fits in a
+        // single write to mChannel.
+        Vector<sensors_event_t> mSoftBatch;
+        size_t mSoftBatchMaxEvents;
 
     public:
         SensorEventConnection(const sp<SensorService>& service, uid_t uid);
@@ -112,6 +129,7 @@ class SensorService :
         bool addSensor(int32_t handle);
         bool removeSensor(int32_t handle);
         void setFirstFlushPending(int32_t handle, bool value);
+        void setSoftBatchLatency(int32_t handle, nsecs_t latencyNs);
         void dump(String8& result);
 
         uid_t getUid() const { return mUid; }
@@ -3,11 +3,13 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:= \
     Client.cpp \
+    CompositionScheduler.cpp \
     DisplayDevice.cpp \
     DispSync.cpp \
     EventControlThread.cpp \
     EventThread.cpp \
     FrameTracker.cpp \
+    LatchScheduler.cpp \
     Layer.cpp \
     LayerDim.cpp \
     MessageQueue.cpp \
@@ -55,6 +57,10 @@ ifeq ($(TARGET_FORCE_HWC_FOR_VIRTUAL_DISPLAYS),true)
     LOCAL_CFLAGS += -DFORCE_HWC_COPY_FOR_VIRTUAL_DISPLAYS
 endif
 
+ifeq ($(TARGET_ASYNC_VIRTUAL_DISPLAYS),true)
+    LOCAL_CFLAGS += -DASYNC_VIRTUAL_DISPLAYS
+endif
+
 ifneq ($(NUM_FRAMEBUFFER_SURFACE_BUFFERS),)
   LOCAL_CFLAGS += -DNUM_FRAMEBUFFER_SURFACE_BUFFERS=$(NUM_FRAMEBUFFER_SURFACE_BUFFERS)
 endif
@@ -155,5 +155,9 @@ status_t Client::destroySurface(const sp<IBinder>& handle) {
     return mFlinger->onLayerRemoved(this, handle);
 }
 
+status_t Client::setCursorPosition(const sp<IBinder>& handle, float x, float y) {
+    return mFlinger->setCursorPosition(this, handle, x, y);
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
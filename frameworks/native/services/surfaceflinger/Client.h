@@ -60,6 +60,9 @@ private:
 
     virtual status_t destroySurface(const sp<IBinder>& handle);
 
+    virtual status_t setCursorPosition(const sp<IBinder>& handle,
+            float x, float y);
+
     virtual status_t onTransact(
         uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags);
 
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+// This is needed for stdint.h to define INT64_MAX in C++
+#define __STDC_LIMIT_MACROS
+
+#include <cutils/log.h>
+
+#include <ui/Fence.h>
+
+#include <utils/String8.h>
+#include <utils/Trace.h>
+
+#include "CompositionScheduler.h"
+
+namespace android {
+
+// This is the smallest margin added to the longest recent composition.  It
+// covers the jitter of the SurfaceFlinger wakeup.
+static const nsecs_t minMargin = 1000000;
+
+// This is how much the margin grows each time a frame misses its vsync, and
+// shrinks back once enough frames were presented on time.
+static const nsecs_t marginStep = 1000000;
+static const nsecs_t maxMargin = 8000000;
+static const uint32_t framesOnTimeBeforeShrink = 120;
+
+// This is the number of frames between two updates of the phase offset when
+// no frame misses its vsync.
+static const uint32_t framesBetweenUpdates = 30;
+
+// The phase offset isn't moved by less than this, to avoid needlessly
+// reprogramming the DispSync thread.
+static const nsecs_t minPhaseOffsetChange = 250000;
+
+CompositionScheduler::CompositionScheduler(nsecs_t defaultPhaseOffset) :
+        mDefaultPhaseOffset(defaultPhaseOffset),
+        mNumMissedFrames(0) {
+    reset();
+}
+
+void CompositionScheduler::reset() {
+    Mutex::Autolock lock(mMutex);
+    mPeriod = 0;
+    mPhaseOffset = mDefaultPhaseOffset;
+    mBudget = 0;
+    mExpectedPresentTime = 0;
+    mSampleOffset = 0;
+    mNumSamples = 0;
+    for (size_t i = 0; i < NUM_PRESENT_FENCES; i++) {
+        mPresentFences[i].clear();
+        mPresentExpectedTimes[i] = 0;
+    }
+    mPresentFenceOffset = 0;
+    mMargin = minMargin;
+    mFramesOnTime = 0;
+    mFramesSinceUpdate = 0;
+    mMissedFrame = false;
+}
+
+void CompositionScheduler::beginFrame(nsecs_t expectedPresentTime) {
+    Mutex::Autolock lock(mMutex);
+    mExpectedPresentTime = expectedPresentTime;
+}
+
+void CompositionScheduler::endFrame(nsecs_t endTime,
+        const sp<Fence>& presentFence) {
+    Mutex::Autolock lock(mMutex);
+    if (mExpectedPresentTime == 0) {
+        // this composition wasn't triggered by a vsync event
+        return;
+    }
+
+    if (mBudget > 0) {
+        // measure from the time we should have woken up at, so that the
+        // wakeup latency is accounted for
+        const nsecs_t wakeupTime = mExpectedPresentTime - mBudget;
+        mSamples[mSampleOffset] = endTime > wakeupTime ? endTime - wakeupTime : 0;
+        mSampleOffset = (mSampleOffset + 1) % NUM_SAMPLES;
+        if (mNumSamples < NUM_SAMPLES) {
+            mNumSamples++;
+        }
+        ATRACE_INT64("CompositionTime", mSamples[(mSampleOffset +
+                NUM_SAMPLES - 1) % NUM_SAMPLES]);
+    }
+
+    if (presentFence != NULL && presentFence->isValid()) {
+        // a fence that didn't signal by the time its slot is reused is
+        // simply dropped
+        mPresentFences[mPresentFenceOffset] = presentFence;
+        mPresentExpectedTimes[mPresentFenceOffset] = mExpectedPresentTime;
+        mPresentFenceOffset = (mPresentFenceOffset + 1) % NUM_PRESENT_FENCES;
+    }
+
+    mExpectedPresentTime = 0;
+    mFramesSinceUpdate++;
+}
+
+void CompositionScheduler::processFencesLocked() {
+    for (size_t i = 0; i < NUM_PRESENT_FENCES; i++) {
+        const sp<Fence>& f(mPresentFences[i]);
+        if (f == NULL) {
+            continue;
+        }
+
+        const nsecs_t t = f->getSignalTime();
+        if (t == INT64_MAX) {
+            continue;
+        }
+        mPresentFences[i].clear();
+        if (t < 0) {
+            continue;
+        }
+
+        if (t > mPresentExpectedTimes[i] + mPeriod / 2) {
+            // the frame missed its vsync, we need to wake up earlier
+            mNumMissedFrames++;
+            mMissedFrame = true;
+            mFramesOnTime = 0;
+            mMargin += marginStep;
+            if (mMargin > maxMargin) {
+                mMargin = maxMargin;
+            }
+        } else if (++mFramesOnTime >= framesOnTimeBeforeShrink) {
+            mFramesOnTime = 0;
+            mMargin -= marginStep;
+            if (mMargin < minMargin) {
+                mMargin = minMargin;
+            }
+        }
+    }
+}
+
+nsecs_t CompositionScheduler::computeBudgetLocked() const {
+    nsecs_t longest = 0;
+    for (size_t i = 0; i < mNumSamples; i++) {
+        if (mSamples[i] > longest) {
+            longest = mSamples[i];
+        }
+    }
+    return longest + mMargin;
+}
+
+bool CompositionScheduler::computePhaseOffset(nsecs_t period,
+        nsecs_t* outPhaseOffset) {
+    Mutex::Autolock lock(mMutex);
+    if (period <= 0) {
+        return false;
+    }
+
+    const bool periodChanged = period != mPeriod;
+    mPeriod = period;
+    processFencesLocked();
+
+    if (!periodChanged && !mMissedFrame &&
+            mFramesSinceUpdate < framesBetweenUpdates) {
+        return false;
+    }
+    mFramesSinceUpdate = 0;
+    mMissedFrame = false;
+
+    // the budget of the configured phase offset, in ]0, period]
+    nsecs_t defaultPhase = mDefaultPhaseOffset % period;
+    if (defaultPhase < 0) {
+        defaultPhase += period;
+    }
+    const nsecs_t defaultBudget = period - defaultPhase;
+
+    // wait until we know the cost of enough compositions before moving
+    // away from the configured phase offset
+    nsecs_t budget = defaultBudget;
+    if (mNumSamples == NUM_SAMPLES) {
+        const nsecs_t needed = computeBudgetLocked();
+        if (needed < budget) {
+            budget = needed;
+        }
+    }
+
+    const nsecs_t phaseOffset = mDefaultPhaseOffset + (defaultBudget - budget);
+    const nsecs_t change = phaseOffset - mPhaseOffset;
+    if (!periodChanged && change < minPhaseOffsetChange &&
+            change > -minPhaseOffsetChange) {
+        return false;
+    }
+
+    mBudget = budget;
+    mPhaseOffset = phaseOffset;
+    *outPhaseOffset = phaseOffset;
+    ATRACE_INT64("SfPhaseOffset", phaseOffset);
+    return true;
+}
+
+void CompositionScheduler::dump(String8& result) const {
+    Mutex::Autolock lock(mMutex);
+    nsecs_t longest = 0;
+    for (size_t i = 0; i < mNumSamples; i++) {
+        if (mSamples[i] > longest) {
+            longest = mSamples[i];
+        }
+    }
+    result.appendFormat("Composition scheduler: phase offset=%lld (default=%lld), "
+            "budget=%lld, longest composition=%lld, margin=%lld, missed frames=%u\n",
+            mPhaseOffset, mDefaultPhaseOffset, mBudget, longest, mMargin,
+            mNumMissedFrames);
+}
+
+} // namespace android
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_COMPOSITIONSCHEDULER_H
+#define ANDROID_COMPOSITIONSCHEDULER_H
+
+#include <stddef.h>
+
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class String8;
+class Fence;
+
+// CompositionScheduler learns how long SurfaceFlinger takes to compose a
+// frame and computes the phase offset at which SurfaceFlinger should wake up
+// to still make the next vsync.  Waking up later than the configured phase
+// offset gives applications more time to queue the buffers latched in the
+// same vsync period, which reduces the touch-to-display latency.
+//
+// The time budget of a frame is the time between the SurfaceFlinger wakeup
+// and the vsync the frame is expected to be presented at.  It is computed
+// from the longest of the recent compositions plus a safety margin.  The
+// margin grows every time a frame misses its vsync, according to the
+// present fences, and slowly shrinks back while frames are on time.  The
+// budget never exceeds the one of the configured phase offset.
+//
+// All methods other than dump must be called from the main thread.
+class CompositionScheduler {
+
+public:
+    // NUM_SAMPLES is the number of recent compositions the budget is
+    // computed from.
+    enum { NUM_SAMPLES = 32 };
+
+    // NUM_PRESENT_FENCES is the number of present fences that can be waited
+    // on to detect the frames that missed their vsync.
+    enum { NUM_PRESENT_FENCES = 8 };
+
+    // defaultPhaseOffset is the configured phase offset of the SurfaceFlinger
+    // vsync events, the earliest SurfaceFlinger ever wakes up.
+    CompositionScheduler(nsecs_t defaultPhaseOffset);
+
+    // beginFrame records the time at which the frame about to be composed
+    // is expected to be presented.
+    void beginFrame(nsecs_t expectedPresentTime);
+
+    // endFrame records the time at which the composition of the current
+    // frame ended and the fence that will signal when it is presented.
+    void endFrame(nsecs_t endTime, const sp<Fence>& presentFence);
+
+    // computePhaseOffset computes the phase offset of the SurfaceFlinger
+    // vsync events for the given refresh period.  It returns true if the
+    // phase offset changed since the previous call.
+    bool computePhaseOffset(nsecs_t period, nsecs_t* outPhaseOffset);
+
+    // reset forgets about the recent compositions and restores the
+    // configured phase offset, for instance when the display is turned on.
+    void reset();
+
+    // dump appends the state of the scheduler to the result string.
+    void dump(String8& result) const;
+
+private:
+    // processFencesLocked checks the present fences that signaled since the
+    // last call and updates the margin accordingly.
+    void processFencesLocked();
+
+    // computeBudgetLocked returns the budget needed by the recent
+    // compositions, including the margin.
+    nsecs_t computeBudgetLocked() const;
+
+    const nsecs_t mDefaultPhaseOffset;
+
+    // mPeriod is the refresh period used to compute the current phase
+    // offset.
+    nsecs_t mPeriod;
+
+    // mPhaseOffset is the current phase offset of the SurfaceFlinger vsync
+    // events and mBudget the corresponding time budget.
+    nsecs_t mPhaseOffset;
+    nsecs_t mBudget;
+
+    // mExpectedPresentTime is the expected present time of the frame being
+    // composed, or 0 if beginFrame wasn't called for it.
+    nsecs_t mExpectedPresentTime;
+
+    // mSamples is a circular buffer of the durations of the recent
+    // compositions, measured from the nominal wakeup time.
+    nsecs_t mSamples[NUM_SAMPLES];
+    size_t mSampleOffset;
+    size_t mNumSamples;
+
+    // mPresentFences and mPresentExpectedTimes store the present fences that
+    // haven't signaled yet along with the time they were expected to.
+    sp<Fence> mPresentFences[NUM_PRESENT_FENCES];
+    nsecs_t mPresentExpectedTimes[NUM_PRESENT_FENCES];
+    size_t mPresentFenceOffset;
+
+    // mMargin is the time added to the longest recent composition.
+    nsecs_t mMargin;
+
+    // mFramesOnTime is the number of frames presented on time since the
+    // margin last changed.
+    uint32_t mFramesOnTime;
+
+    // mFramesSinceUpdate is the number of frames composed since the phase
+    // offset was last computed.
+    uint32_t mFramesSinceUpdate;
+
+    // mNumMissedFrames is the total number of frames that missed their
+    // vsync.
+    uint32_t mNumMissedFrames;
+    bool mMissedFrame;
+
+    // mMutex is used to protect access to all member variables.
+    mutable Mutex mMutex;
+};
+
+}
+
+#endif // ANDROID_COMPOSITIONSCHEDULER_H
@@ -193,6 +193,22 @@ public:
         return BAD_VALUE;
     }
 
+    status_t changePhaseOffset(const sp<DispSync::Callback>& callback, nsecs_t phase) {
+        Mutex::Autolock lock(mMutex);
+
+        for (size_t i = 0; i < mEventListeners.size(); i++) {
+            if (mEventListeners[i].mCallback == callback) {
+                // computeListenerNextEventTimeLocked keeps the next event at
+                // least half a period after mLastEventTime, whatever the phase
+                mEventListeners.editItemAt(i).mPhase = phase;
+                mCond.signal();
+                return NO_ERROR;
+            }
+        }
+
+        return BAD_VALUE;
+    }
+
     // This method is only here to handle the runningWithoutSyncFramework
     // case.
     bool hasAnyEventListeners() {
@@ -400,6 +416,44 @@ status_t DispSync::removeEventListener(const sp<Callback>& callback) {
     return mThread->removeEventListener(callback);
 }
 
+status_t DispSync::changePhaseOffset(const sp<Callback>& callback,
+        nsecs_t phase) {
+    Mutex::Autolock lock(mMutex);
+    return mThread->changePhaseOffset(callback, phase);
+}
+
+nsecs_t DispSync::getPeriod() {
+    Mutex::Autolock lock(mMutex);
+    return mPeriod;
+}
+
+nsecs_t DispSync::computeNextRefresh(int periodOffset) const {
+    Mutex::Autolock lock(mMutex);
+    if (mPeriod == 0) {
+        return 0;
+    }
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t vsync = (((now - mPhase) / mPeriod) + periodOffset + 1) * mPeriod
+            + mPhase;
+    return vsync - presentTimeOffset;
+}
+
+void DispSync::computeFrameTimeline(nsecs_t compositionPhaseOffset,
+        nsecs_t* outDeadline, nsecs_t* outPresentTime) const {
+    Mutex::Autolock lock(mMutex);
+    if (mPeriod == 0) {
+        *outDeadline = 0;
+        *outPresentTime = 0;
+        return;
+    }
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t phase = mPhase + compositionPhaseOffset;
+    nsecs_t composition = ((now - phase) / mPeriod + 1) * mPeriod + phase;
+    nsecs_t vsync = ((composition - mPhase) / mPeriod + 1) * mPeriod + mPhase;
+    *outDeadline = composition;
+    *outPresentTime = vsync - presentTimeOffset;
+}
+
 void DispSync::setPeriod(nsecs_t period) {
     Mutex::Autolock lock(mMutex);
     mPeriod = period;
@@ -99,6 +99,29 @@ public:
     // DispSync object.
     status_t removeEventListener(const sp<Callback>& callback);
 
+    // changePhaseOffset changes the phase offset of an already-registered
+    // event callback.  The callback is never called less than half a period
+    // after its previous call, so moving the phase can't cause an extra
+    // event.
+    status_t changePhaseOffset(const sp<Callback>& callback, nsecs_t phase);
+
+    // getPeriod returns the period of the modeled vsync events, or 0 if the
+    // model isn't initialized yet.
+    nsecs_t getPeriod();
+
+    // computeNextRefresh returns the time at which a present fence signals
+    // for the first vsync event after now, plus the given number of
+    // periods.  It returns 0 if the model isn't initialized yet.
+    nsecs_t computeNextRefresh(int periodOffset) const;
+
+    // computeFrameTimeline returns the timeline of a frame started now: the
+    // deadline is the first composition after now, running at the given
+    // phase offset from vsync, and the present time is when that
+    // composition's present fence is expected to signal. Both are 0 if the
+    // model isn't initialized yet.
+    void computeFrameTimeline(nsecs_t compositionPhaseOffset,
+            nsecs_t* outDeadline, nsecs_t* outPresentTime) const;
+
 private:
 
     void updateModelLocked();
@@ -70,6 +70,11 @@ DisplayDevice::DisplayDevice(
       mIsSecure(isSecure),
       mSecureLayerVisible(false),
       mScreenAcquired(false),
+      mFrameSkipped(false),
+      mReuseFramebuffer(false),
+      mReusedFramebufferCount(0),
+      mHasBufferAge(false),
+      mBufferHistoryCount(0),
       mLayerStack(NO_LAYER_STACK),
       mOrientation()
 {
@@ -100,6 +105,12 @@ DisplayDevice::DisplayDevice(
     eglQuerySurface(display, surface, EGL_WIDTH,  &mDisplayWidth);
     eglQuerySurface(display, surface, EGL_HEIGHT, &mDisplayHeight);
 
+    // virtual displays' consumers aren't required to preserve the content
+    // of the buffers they return
+    const char* const extensions = eglQueryString(display, EGL_EXTENSIONS);
+    mHasBufferAge = mType < DisplayDevice::DISPLAY_VIRTUAL &&
+            extensions && strstr(extensions, "EGL_EXT_buffer_age");
+
     mDisplay = display;
     mSurface = surface;
     mFormat  = format;
@@ -199,7 +210,9 @@ void DisplayDevice::flip(const Region& dirty) const
 }
 
 status_t DisplayDevice::beginFrame() const {
-    return mDisplaySurface->beginFrame();
+    status_t result = mDisplaySurface->beginFrame();
+    mFrameSkipped = (result == WOULD_BLOCK);
+    return result;
 }
 
 status_t DisplayDevice::prepareFrame(const HWComposer& hwc) const {
@@ -232,7 +245,15 @@ void DisplayDevice::swapBuffers(HWComposer& hwc) const {
             (hwc.hasGlesComposition(mHwcDisplayId) &&
              (hwc.supportsFramebufferTarget() || mType >= DISPLAY_VIRTUAL))) {
         EGLBoolean success = eglSwapBuffers(mDisplay, mSurface);
-        if (!success) {
+        if (success) {
+            for (size_t i=BUFFER_HISTORY_SIZE-1 ; i>0 ; i--) {
+                mBufferHistory[i] = mBufferHistory[i-1];
+            }
+            mBufferHistory[0] = mFrameDamage;
+            if (mBufferHistoryCount < BUFFER_HISTORY_SIZE) {
+                mBufferHistoryCount++;
+            }
+        } else {
             EGLint error = eglGetError();
             if (error == EGL_CONTEXT_LOST ||
                     mType == DisplayDevice::DISPLAY_PRIMARY) {
@@ -245,6 +266,8 @@ void DisplayDevice::swapBuffers(HWComposer& hwc) const {
         }
     }
 
+    mFrameDamage.clear();
+
     status_t result = mDisplaySurface->advanceFrame();
     if (result != NO_ERROR) {
         ALOGE("[%s] failed pushing new frame to HWC: %d",
@@ -280,7 +303,7 @@ EGLBoolean DisplayDevice::makeCurrent(EGLDisplay dpy, EGLContext ctx) const {
 void DisplayDevice::setViewportAndProjection() const {
     size_t w = mDisplayWidth;
     size_t h = mDisplayHeight;
-    mFlinger->getRenderEngine().setViewportAndProjection(w, h, w, h, false);
+    mFlinger->getRenderEngine().setViewportAndProjection(w, h, Rect(w, h), h, false);
 }
 
 // ----------------------------------------------------------------------------
@@ -319,6 +342,50 @@ Region DisplayDevice::getDirtyRegion(bool repaintEverything) const {
 
 // ----------------------------------------------------------------------------
 
+bool DisplayDevice::setCompositionPlan(const Vector<int32_t>& plan) {
+    bool same = plan.size() == mCompositionPlan.size();
+    for (size_t i=0 ; same && i<plan.size() ; i++) {
+        same = plan[i] == mCompositionPlan[i];
+    }
+    mCompositionPlan = plan;
+    return same;
+}
+
+void DisplayDevice::setReuseFramebuffer(bool reuse) {
+    mReuseFramebuffer = reuse;
+    if (reuse) {
+        mReusedFramebufferCount++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+Region DisplayDevice::getRepaintRegion(const Region& dirty) const {
+    mFrameDamage = dirty;
+
+    EGLint age = 0;
+    if (mHasBufferAge) {
+        eglQuerySurface(mDisplay, mSurface, EGL_BUFFER_AGE_EXT, &age);
+    }
+
+    // an age of N means the back buffer was last composed N frames ago,
+    // it is missing the damage of the N-1 frames swapped since then
+    if (age <= 0 || uint32_t(age) > mBufferHistoryCount) {
+        return Region(getBounds());
+    }
+    Region region(dirty);
+    for (EGLint i=0 ; i<age-1 ; i++) {
+        region.orSelf(mBufferHistory[i]);
+    }
+    return region;
+}
+
+void DisplayDevice::invalidateBufferHistory() const {
+    mBufferHistoryCount = 0;
+}
+
+// ----------------------------------------------------------------------------
+
 bool DisplayDevice::canDraw() const {
     return mScreenAcquired;
 }
@@ -461,12 +528,12 @@ void DisplayDevice::dump(String8& result) const {
     result.appendFormat(
         "+ DisplayDevice: %s\n"
         "   type=%x, hwcId=%d, layerStack=%u, (%4dx%4d), ANativeWindow=%p, orient=%2d (type=%08x), "
-        "flips=%u, isSecure=%d, secureVis=%d, acquired=%d, numLayers=%u\n"
+        "flips=%u, fbReused=%u, skipped=%d, isSecure=%d, secureVis=%d, acquired=%d, numLayers=%u\n"
         "   v:[%d,%d,%d,%d], f:[%d,%d,%d,%d], s:[%d,%d,%d,%d],"
         "transform:[[%0.3f,%0.3f,%0.3f][%0.3f,%0.3f,%0.3f][%0.3f,%0.3f,%0.3f]]\n",
         mDisplayName.string(), mType, mHwcDisplayId,
         mLayerStack, mDisplayWidth, mDisplayHeight, mNativeWindow.get(),
-        mOrientation, tr.getType(), getPageFlipCount(),
+        mOrientation, tr.getType(), getPageFlipCount(), mReusedFramebufferCount, mFrameSkipped,
         mIsSecure, mSecureLayerVisible, mScreenAcquired, mVisibleLayersSortedByZ.size(),
         mViewport.left, mViewport.top, mViewport.right, mViewport.bottom,
         mFrame.left, mFrame.top, mFrame.right, mFrame.bottom,
@@ -124,6 +124,8 @@ public:
     const wp<IBinder>&      getDisplayToken() const { return mDisplayToken; }
 
     status_t beginFrame() const;
+    // true if the display surface asked to skip the frame being composed
+    bool isFrameSkipped() const { return mFrameSkipped; }
     status_t prepareFrame(const HWComposer& hwc) const;
 
     void swapBuffers(HWComposer& hwc) const;
@@ -154,6 +156,30 @@ public:
     // release HWC resources (if any) for removable displays
     void disconnect(HWComposer& hwc);
 
+    /* ------------------------------------------------------------------------
+     * Composition plan caching
+     */
+    // records the composition types the h/w composer picked for the visible
+    // layers in this frame, returns whether they're the same as last frame's
+    bool setCompositionPlan(const Vector<int32_t>& plan);
+    // whether the framebuffer target composed with GLES in a previous frame
+    // is still valid and can be presented again without composing
+    void setReuseFramebuffer(bool reuse);
+    bool getReuseFramebuffer() const { return mReuseFramebuffer; }
+
+    /* ------------------------------------------------------------------------
+     * Partial updates
+     */
+    // returns the region of the back buffer that must be recomposed for it
+    // to reflect the given dirty region, that is the dirty region and what
+    // changed since the back buffer was last composed, or the whole screen
+    // if the age of the back buffer is unknown.
+    Region getRepaintRegion(const Region& dirty) const;
+    // forgets about the content of the buffers, for instance because the
+    // holes punched for the h/w composer moved. They'll be recomposed
+    // entirely when they're next drawn into.
+    void invalidateBufferHistory() const;
+
     /* ------------------------------------------------------------------------
      * Debugging
      */
@@ -197,6 +223,25 @@ private:
     // Whether the screen is blanked;
     mutable int mScreenAcquired;
 
+    // Whether the display sits out the current frame
+    mutable bool mFrameSkipped;
+
+    // composition types of the visible layers in the last frame
+    Vector<int32_t> mCompositionPlan;
+    bool mReuseFramebuffer;
+    // number of frames that reused the framebuffer target
+    uint32_t mReusedFramebufferCount;
+
+    // damage of the last frames swapped, most recent first, used along with
+    // EGL_EXT_buffer_age to recompose only what changed in the back buffer
+    enum { BUFFER_HISTORY_SIZE = 4 };
+    bool mHasBufferAge;
+    mutable Region mBufferHistory[BUFFER_HISTORY_SIZE];
+    // number of frames swapped since the history was invalidated
+    mutable uint32_t mBufferHistoryCount;
+    // damage of the frame being composed
+    mutable Region mFrameDamage;
+
 
     /*
      * Transaction state
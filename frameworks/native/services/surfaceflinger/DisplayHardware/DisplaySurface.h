@@ -33,6 +33,9 @@ public:
     // beginFrame is called at the beginning of the composition loop, before
     // the configuration is known. The DisplaySurface should do anything it
     // needs to do to enable HWComposer to decide how to compose the frame.
+    // It returns WOULD_BLOCK if the display has to sit out this frame, in
+    // which case nothing is composed for it and the calls to advanceFrame and
+    // onFrameCommitted for the frame are no-ops.
     virtual status_t beginFrame() = 0;
 
     // prepareFrame is called after the composition configuration is known but
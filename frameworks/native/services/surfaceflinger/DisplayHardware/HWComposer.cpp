@@ -557,10 +557,77 @@ status_t HWComposer::createWorkList(int32_t id, size_t numLayers) {
         disp.list->retireFenceFd = -1;
         disp.list->flags = HWC_GEOMETRY_CHANGED;
         disp.list->numHwLayers = numLayers;
+        disp.geometryDiffed = false;
     }
     return NO_ERROR;
 }
 
+void HWComposer::getLayerGeometry(const hwc_layer_1_t& l, const void* owner,
+        LayerGeometry* g) {
+    g->owner = owner;
+    g->flags = l.flags;
+    g->transform = l.transform;
+    g->blending = l.blending;
+    memcpy(g->frame, &l.displayFrame, sizeof(g->frame));
+    memcpy(g->crop, &l.sourceCropf, sizeof(g->crop));
+    g->planeAlpha = l.planeAlpha;
+    g->visible.clear();
+    g->visible.appendArray(l.visibleRegionScreen.rects, l.visibleRegionScreen.numRects);
+    g->compositionType = 0;
+    g->hints = 0;
+}
+
+bool HWComposer::sameVisibleRegion(const hwc_layer_1_t& l, const LayerGeometry& g) {
+    const hwc_region_t& visible(l.visibleRegionScreen);
+    return visible.numRects == g.visible.size() && (visible.numRects == 0 ||
+            !memcmp(visible.rects, g.visible.array(),
+                    visible.numRects * sizeof(hwc_rect_t)));
+}
+
+bool HWComposer::diffWorkList(int32_t id, const Vector< sp<Layer> >& layers) {
+    if (!mHwc || uint32_t(id)>31 || !mAllocatedDisplayIDs.hasBit(id)) {
+        return true;
+    }
+    DisplayData& disp(mDisplayData[id]);
+    if (!disp.list) {
+        return true;
+    }
+    disp.geometryDiffed = true;
+
+    const size_t count = disp.list->numHwLayers - (disp.framebufferTarget ? 1 : 0);
+    bool changed = !disp.geometryValid ||
+            disp.geometry.size() != count || layers.size() != count;
+    for (size_t i=0 ; !changed && i<count ; i++) {
+        const hwc_layer_1_t& l(disp.list->hwLayers[i]);
+        const LayerGeometry& last(disp.geometry[i]);
+        changed = layers[i].get() != last.owner || l.flags != last.flags ||
+                l.transform != last.transform || l.blending != last.blending ||
+                memcmp(&l.displayFrame, last.frame, sizeof(last.frame)) ||
+                memcmp(&l.sourceCropf, last.crop, sizeof(last.crop)) ||
+                l.planeAlpha != last.planeAlpha ||
+                !sameVisibleRegion(l, last);
+    }
+
+    if (changed) {
+        disp.geometry.resize(count);
+        for (size_t i=0 ; i<count ; i++) {
+            getLayerGeometry(disp.list->hwLayers[i],
+                    i < layers.size() ? layers[i].get() : NULL,
+                    &disp.geometry.editItemAt(i));
+        }
+        disp.list->flags |= HWC_GEOMETRY_CHANGED;
+    } else {
+        // the HWC starts from its own decisions of the last prepare()
+        for (size_t i=0 ; i<count ; i++) {
+            hwc_layer_1_t& l = disp.list->hwLayers[i];
+            l.compositionType = disp.geometry[i].compositionType;
+            l.hints = disp.geometry[i].hints;
+        }
+        disp.list->flags &= ~HWC_GEOMETRY_CHANGED;
+    }
+    return changed;
+}
+
 status_t HWComposer::setFramebufferTarget(int32_t id,
         const sp<Fence>& acquireFence, const sp<GraphicBuffer>& buf) {
     if (uint32_t(id)>31 || !mAllocatedDisplayIDs.hasBit(id)) {
@@ -602,7 +669,7 @@ status_t HWComposer::prepare() {
             ALOGW("WARNING: disp %d: connected, non-null list, layers=%d",
                   i, disp.list->numHwLayers);
         }
-        mLists[i] = disp.list;
+        mLists[i] = disp.skipFrame ? NULL : disp.list;
         if (mLists[i]) {
             if (hwcHasApiVersion(mHwc, HWC_DEVICE_API_VERSION_1_3)) {
                 mLists[i]->outbuf = disp.outbufHandle;
@@ -634,6 +701,14 @@ status_t HWComposer::prepare() {
             disp.hasFbComp = false;
             disp.hasOvComp = false;
             if (disp.list) {
+                // remember the composition types for diffWorkList(). a list
+                // that was rebuilt without being diffed has no geometry.
+                const size_t count = disp.list->numHwLayers -
+                        (disp.framebufferTarget ? 1 : 0);
+                disp.geometryValid = mLists[i] &&
+                        disp.geometry.size() == count &&
+                        (disp.geometryDiffed ||
+                         !(disp.list->flags & HWC_GEOMETRY_CHANGED));
                 for (size_t i=0 ; i<disp.list->numHwLayers ; i++) {
                     hwc_layer_1_t& l = disp.list->hwLayers[i];
 
@@ -643,6 +718,11 @@ status_t HWComposer::prepare() {
                     if (l.flags & HWC_SKIP_LAYER) {
                         l.compositionType = HWC_FRAMEBUFFER;
                     }
+                    if (disp.geometryValid && i < count) {
+                        LayerGeometry& g(disp.geometry.editItemAt(i));
+                        g.compositionType = l.compositionType;
+                        g.hints = l.hints;
+                    }
                     if (l.compositionType == HWC_FRAMEBUFFER) {
                         disp.hasFbComp = true;
                     }
@@ -657,6 +737,10 @@ status_t HWComposer::prepare() {
                 disp.hasFbComp = true;
             }
         }
+    } else {
+        for (size_t i=0 ; i<mNumDisplays ; i++) {
+            mDisplayData[i].geometryValid = false;
+        }
     }
     return (status_t)err;
 }
@@ -702,7 +786,7 @@ status_t HWComposer::commit() {
 
         for (size_t i=VIRTUAL_DISPLAY_ID_BASE; i<mNumDisplays; i++) {
             DisplayData& disp(mDisplayData[i]);
-            if (disp.outbufHandle) {
+            if (mLists[i] && disp.outbufHandle) {
                 mLists[i]->outbuf = disp.outbufHandle;
                 mLists[i]->outbufAcquireFenceFd =
                         disp.outbufAcquireFence->dup();
@@ -755,6 +839,9 @@ void HWComposer::disconnectDisplay(int disp) {
     dd.lastRetireFence = Fence::NO_FENCE;
     dd.lastDisplayFence = Fence::NO_FENCE;
     dd.outbufAcquireFence = Fence::NO_FENCE;
+    dd.skipFrame = false;
+    dd.geometry.clear();
+    dd.geometryValid = false;
 }
 
 int HWComposer::getVisualID() const {
@@ -816,6 +903,16 @@ status_t HWComposer::setOutputBuffer(int32_t id, const sp<Fence>& acquireFence,
     return NO_ERROR;
 }
 
+status_t HWComposer::setSkipFrame(int32_t id, bool skip) {
+    if (uint32_t(id)>31 || !mAllocatedDisplayIDs.hasBit(id))
+        return BAD_INDEX;
+    if (id < VIRTUAL_DISPLAY_ID_BASE)
+        return INVALID_OPERATION;
+
+    mDisplayData[id].skipFrame = skip;
+    return NO_ERROR;
+}
+
 sp<Fence> HWComposer::getLastRetireFence(int32_t id) {
     if (uint32_t(id)>31 || !mAllocatedDisplayIDs.hasBit(id))
         return Fence::NO_FENCE;
@@ -1156,6 +1253,8 @@ HWComposer::DisplayData::DisplayData()
     framebufferTarget(NULL), fbTargetHandle(0),
     lastRetireFence(Fence::NO_FENCE), lastDisplayFence(Fence::NO_FENCE),
     outbufHandle(NULL), outbufAcquireFence(Fence::NO_FENCE),
+    skipFrame(false),
+    geometryValid(false), geometryDiffed(false),
     events(0)
 {}
 
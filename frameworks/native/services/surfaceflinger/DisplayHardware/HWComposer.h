@@ -48,6 +48,7 @@ namespace android {
 class GraphicBuffer;
 class Fence;
 class FloatRect;
+class Layer;
 class Region;
 class String8;
 class SurfaceFlinger;
@@ -108,6 +109,14 @@ public:
     // create a work list for numLayers layer. sets HWC_GEOMETRY_CHANGED.
     status_t createWorkList(int32_t id, size_t numLayers);
 
+    // compares the geometry of a work list filled after createWorkList()
+    // with the one last prepared. when the same layers have the same
+    // geometry and visible regions, HWC_GEOMETRY_CHANGED is cleared and the
+    // composition types of the last prepare() are restored, so the HWC keeps
+    // its overlays. must be called after the per-frame data is set, which
+    // sets the visible regions. returns whether the geometry changed.
+    bool diffWorkList(int32_t id, const Vector< sp<Layer> >& layers);
+
     bool supportsFramebufferTarget() const;
 
     // does this display have layers handled by HWC
@@ -143,6 +152,11 @@ public:
     // displays, writes to the output buffer are complete.
     sp<Fence> getLastRetireFence(int32_t id);
 
+    // Leave a virtual display out of the next prepare/set cycle, for
+    // instance when it has no output buffer for this frame. Returns
+    // INVALID_OPERATION if id is not a virtual display.
+    status_t setSkipFrame(int32_t id, bool skip);
+
     /*
      * Interface to hardware composer's layers functionality.
      * This abstracts the HAL interface to layers which can evolve in
@@ -305,6 +319,23 @@ private:
             const sp<Fence>& acquireFence, const sp<GraphicBuffer>& buf);
 
 
+    // the geometry of a layer as it was last given to the HWC
+    struct LayerGeometry {
+        const void* owner;
+        uint32_t flags;
+        uint32_t transform;
+        int32_t blending;
+        int32_t frame[4];
+        uint32_t crop[4];   // sourceCropf or sourceCrop, depending on version
+        uint8_t planeAlpha;
+        Vector<hwc_rect_t> visible;     // visibleRegionScreen
+        int32_t compositionType;
+        uint32_t hints;
+    };
+    static void getLayerGeometry(const hwc_layer_1& l, const void* owner,
+            LayerGeometry* g);
+    static bool sameVisibleRegion(const hwc_layer_1& l, const LayerGeometry& g);
+
     struct DisplayData {
         DisplayData();
         ~DisplayData();
@@ -326,6 +357,11 @@ private:
                                     // effect on screen
         buffer_handle_t outbufHandle;
         sp<Fence> outbufAcquireFence;
+        bool skipFrame;
+        // geometry of the layers in list, valid once prepare() saw it
+        Vector<LayerGeometry> geometry;
+        bool geometryValid;
+        bool geometryDiffed;
 
         // protected by mEventControlLock
         int32_t events;
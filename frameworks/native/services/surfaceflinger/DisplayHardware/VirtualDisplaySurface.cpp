@@ -15,6 +15,9 @@
  */
 
 // #define LOG_NDEBUG 0
+// This is needed for stdint.h to define INT64_MAX in C++
+#define __STDC_LIMIT_MACROS
+
 #include "VirtualDisplaySurface.h"
 #include "HWComposer.h"
 
@@ -28,6 +31,12 @@ static const bool sForceHwcCopy = true;
 static const bool sForceHwcCopy = false;
 #endif
 
+#if defined(ASYNC_VIRTUAL_DISPLAYS)
+static const bool sAsyncOutput = true;
+#else
+static const bool sAsyncOutput = false;
+#endif
+
 #define VDS_LOGE(msg, ...) ALOGE("[%s] "msg, \
         mDisplayName.string(), ##__VA_ARGS__)
 #define VDS_LOGW_IF(cond, msg, ...) ALOGW_IF(cond, "[%s] "msg, \
@@ -55,6 +64,9 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc, int32_t dispId,
     mDisplayName(name),
     mOutputUsage(GRALLOC_USAGE_HW_COMPOSER),
     mProducerSlotSource(0),
+    mFrameCount(0),
+    mSkippedFrameCount(0),
+    mSkipFrame(false),
     mDbgState(DBG_STATE_IDLE),
     mDbgLastCompositionType(COMPOSITION_UNKNOWN)
 {
@@ -98,6 +110,15 @@ status_t VirtualDisplaySurface::beginFrame() {
 
     VDS_LOGW_IF(mDbgState != DBG_STATE_IDLE,
             "Unexpected beginFrame() in %s state", dbgStateStr());
+
+    mSkipFrame = sAsyncOutput && isOutputBusy();
+    mHwc.setSkipFrame(mDisplayId, mSkipFrame);
+    if (mSkipFrame) {
+        // Don't dequeue a buffer, HWC is still writing to the previous ones.
+        VDS_LOGV("beginFrame: output busy, skipping frame");
+        mSkippedFrameCount++;
+        return WOULD_BLOCK;
+    }
     mDbgState = DBG_STATE_BEGUN;
 
     uint32_t transformHint, numPendingBuffers;
@@ -108,7 +129,7 @@ status_t VirtualDisplaySurface::beginFrame() {
 }
 
 status_t VirtualDisplaySurface::prepareFrame(CompositionType compositionType) {
-    if (mDisplayId < 0)
+    if (mDisplayId < 0 || mSkipFrame)
         return NO_ERROR;
 
     VDS_LOGW_IF(mDbgState != DBG_STATE_BEGUN,
@@ -160,7 +181,7 @@ status_t VirtualDisplaySurface::compositionComplete() {
 }
 
 status_t VirtualDisplaySurface::advanceFrame() {
-    if (mDisplayId < 0)
+    if (mDisplayId < 0 || mSkipFrame)
         return NO_ERROR;
 
     if (mCompositionType == COMPOSITION_HWC) {
@@ -205,7 +226,7 @@ status_t VirtualDisplaySurface::advanceFrame() {
 }
 
 void VirtualDisplaySurface::onFrameCommitted() {
-    if (mDisplayId < 0)
+    if (mDisplayId < 0 || mSkipFrame)
         return;
 
     VDS_LOGW_IF(mDbgState != DBG_STATE_HWC,
@@ -239,12 +260,18 @@ void VirtualDisplaySurface::onFrameCommitted() {
         if (result == NO_ERROR) {
             updateQueueBufferOutput(qbo);
         }
+        mRetireFences[mFrameCount % MAX_FRAMES_IN_FLIGHT] = outFence;
+        mFrameCount++;
     }
 
     resetPerFrameState();
 }
 
 void VirtualDisplaySurface::dump(String8& result) const {
+    if (sAsyncOutput) {
+        result.appendFormat("   VDS: frames=%u skipped=%u\n",
+                mFrameCount, mSkippedFrameCount);
+    }
 }
 
 status_t VirtualDisplaySurface::requestBuffer(int pslot,
@@ -447,6 +474,14 @@ status_t VirtualDisplaySurface::disconnect(int api) {
     return mSource[SOURCE_SINK]->disconnect(api);
 }
 
+void VirtualDisplaySurface::allocateBuffers(bool /* async */,
+        uint32_t /* w */, uint32_t /* h */, uint32_t /* format */,
+        uint32_t /* usage */, int /* count */) {
+    // The buffers come from the sink or the scratch BufferQueue depending on
+    // the composition type of each frame, and their geometry is fixed by the
+    // display, so there is nothing worth allocating ahead of time.
+}
+
 void VirtualDisplaySurface::updateQueueBufferOutput(
         const QueueBufferOutput& qbo) {
     uint32_t w, h, transformHint, numPendingBuffers;
@@ -462,6 +497,13 @@ void VirtualDisplaySurface::resetPerFrameState() {
     mOutputProducerSlot = -1;
 }
 
+bool VirtualDisplaySurface::isOutputBusy() const {
+    // The slot is empty until MAX_FRAMES_IN_FLIGHT frames have been queued,
+    // and invalid fences report -1
+    const sp<Fence>& fence(mRetireFences[mFrameCount % MAX_FRAMES_IN_FLIGHT]);
+    return fence != NULL && fence->getSignalTime() == INT64_MAX;
+}
+
 status_t VirtualDisplaySurface::refreshOutputBuffer() {
     if (mOutputProducerSlot >= 0) {
         mSource[SOURCE_SINK]->cancelBuffer(
@@ -66,6 +66,14 @@ class HWComposer;
  * buffer for HWC, and a separate buffer is dequeued from the sink and used as
  * the HWC output buffer. When HWC composition is complete, the scratch buffer
  * is released and the output buffer is queued to the sink.
+ *
+ * When built with TARGET_ASYNC_VIRTUAL_DISPLAYS, the output is
+ * double-buffered: a frame is only composed once the h/w composer has
+ * finished writing the output of the frame before the previous one, which
+ * is known from its retire fence without waiting on it. Otherwise the
+ * display sits out the frame, and is composed again on a later vsync. A
+ * virtual display is then composed at the rate its output is produced,
+ * rather than piling work onto every refresh of the primary display.
  */
 class VirtualDisplaySurface : public DisplaySurface,
                               public BnGraphicBufferProducer,
@@ -105,6 +113,8 @@ private:
     virtual status_t connect(const sp<IBinder>& token,
             int api, bool producerControlledByApp, QueueBufferOutput* output);
     virtual status_t disconnect(int api);
+    virtual void allocateBuffers(bool async, uint32_t w, uint32_t h,
+            uint32_t format, uint32_t usage, int count);
 
     //
     // Utility methods
@@ -115,6 +125,7 @@ private:
     void updateQueueBufferOutput(const QueueBufferOutput& qbo);
     void resetPerFrameState();
     status_t refreshOutputBuffer();
+    bool isOutputBusy() const;
 
     // Both the sink and scratch buffer pools have their own set of slots
     // ("source slots", or "sslot"). We have to merge these into the single
@@ -159,6 +170,14 @@ private:
     // to the sink, we have to return the previous version.
     QueueBufferOutput mQueueBufferOutput;
 
+    // Retire fences of the last frames queued to the sink, indexed by
+    // mFrameCount modulo MAX_FRAMES_IN_FLIGHT. The entry for the current
+    // frame holds the fence of the frame MAX_FRAMES_IN_FLIGHT frames earlier.
+    enum { MAX_FRAMES_IN_FLIGHT = 2 };
+    sp<Fence> mRetireFences[MAX_FRAMES_IN_FLIGHT];
+    uint32_t mFrameCount;
+    uint32_t mSkippedFrameCount;
+
     //
     // Intra-frame state
     //
@@ -167,6 +186,9 @@ private:
     // Valid after prepareFrame(), cleared in onFrameCommitted.
     CompositionType mCompositionType;
 
+    // Whether the display sits out the current frame. Set in beginFrame().
+    bool mSkipFrame;
+
     // Details of the current sink buffer. These become valid when a buffer is
     // dequeued from the sink, and are used when queueing the buffer.
     uint32_t mSinkBufferWidth, mSinkBufferHeight;
@@ -47,6 +47,8 @@ EventThread::EventThread(const sp<VSyncSource>& src)
         mVSyncEvent[i].header.id = 0;
         mVSyncEvent[i].header.timestamp = 0;
         mVSyncEvent[i].vsync.count =  0;
+        mVSyncEvent[i].vsync.expectedPresentTime = 0;
+        mVSyncEvent[i].vsync.deadline = 0;
     }
 }
 
@@ -111,12 +113,15 @@ void EventThread::onScreenAcquired() {
     }
 }
 
-void EventThread::onVSyncEvent(nsecs_t timestamp) {
+void EventThread::onVSyncEvent(nsecs_t timestamp, nsecs_t expectedPresentTime,
+        nsecs_t deadline) {
     Mutex::Autolock _l(mLock);
     mVSyncEvent[0].header.type = DisplayEventReceiver::DISPLAY_EVENT_VSYNC;
     mVSyncEvent[0].header.id = 0;
     mVSyncEvent[0].header.timestamp = timestamp;
     mVSyncEvent[0].vsync.count++;
+    mVSyncEvent[0].vsync.expectedPresentTime = expectedPresentTime;
+    mVSyncEvent[0].vsync.deadline = deadline;
     mCondition.broadcast();
 }
 
@@ -155,6 +160,15 @@ bool EventThread::threadLoop() {
             // Right-now we don't have the ability to do this.
             ALOGW("EventThread: dropping event (%08x) for connection %p",
                     event.header.type, conn.get());
+            if (event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+                // The missed vsync is coalesced into the next one, which
+                // carries the up to date count and deadline. A one-shot
+                // request is re-armed so that it isn't lost.
+                Mutex::Autolock _l(mLock);
+                if (conn->count == -1) {
+                    conn->count = 0;
+                }
+            }
         } else if (err < 0) {
             // handle any other error on the pipe as fatal. the only
             // reasonable thing to do is to clean-up this connection.
@@ -283,6 +297,8 @@ Vector< sp<EventThread::Connection> > EventThread::waitForEvent(
                     mVSyncEvent[0].header.id = DisplayDevice::DISPLAY_PRIMARY;
                     mVSyncEvent[0].header.timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
                     mVSyncEvent[0].vsync.count++;
+                    mVSyncEvent[0].vsync.expectedPresentTime = 0;
+                    mVSyncEvent[0].vsync.deadline = 0;
                 }
             } else {
                 // Nobody is interested in vsync, so we just want to sleep.
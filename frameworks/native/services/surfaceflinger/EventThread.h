@@ -45,7 +45,9 @@ public:
     class Callback: public virtual RefBase {
     public:
         virtual ~Callback() {}
-        virtual void onVSyncEvent(nsecs_t when) = 0;
+        // expectedPresentTime and deadline are 0 if they can't be predicted
+        virtual void onVSyncEvent(nsecs_t when, nsecs_t expectedPresentTime,
+                nsecs_t deadline) = 0;
     };
 
     virtual ~VSyncSource() {}
@@ -102,7 +104,8 @@ private:
     virtual bool        threadLoop();
     virtual void        onFirstRef();
 
-    virtual void onVSyncEvent(nsecs_t timestamp);
+    virtual void onVSyncEvent(nsecs_t timestamp, nsecs_t expectedPresentTime,
+            nsecs_t deadline);
 
     void removeDisplayEventConnection(const wp<Connection>& connection);
     void enableVSyncLocked();
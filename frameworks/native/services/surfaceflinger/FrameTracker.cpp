@@ -40,6 +40,11 @@ void FrameTracker::setDesiredPresentTime(nsecs_t presentTime) {
     mFrameRecords[mOffset].desiredPresentTime = presentTime;
 }
 
+void FrameTracker::setExpectedPresentTime(nsecs_t expectedPresentTime) {
+    Mutex::Autolock lock(mMutex);
+    mFrameRecords[mOffset].expectedPresentTime = expectedPresentTime;
+}
+
 void FrameTracker::setFrameReadyTime(nsecs_t readyTime) {
     Mutex::Autolock lock(mMutex);
     mFrameRecords[mOffset].frameReadyTime = readyTime;
@@ -76,6 +81,7 @@ void FrameTracker::advanceFrame() {
     // Advance to the next frame.
     mOffset = (mOffset+1) % NUM_FRAME_RECORDS;
     mFrameRecords[mOffset].desiredPresentTime = INT64_MAX;
+    mFrameRecords[mOffset].expectedPresentTime = 0;
     mFrameRecords[mOffset].frameReadyTime = INT64_MAX;
     mFrameRecords[mOffset].actualPresentTime = INT64_MAX;
 
@@ -102,6 +108,7 @@ void FrameTracker::clear() {
     Mutex::Autolock lock(mMutex);
     for (size_t i = 0; i < NUM_FRAME_RECORDS; i++) {
         mFrameRecords[i].desiredPresentTime = 0;
+        mFrameRecords[i].expectedPresentTime = 0;
         mFrameRecords[i].frameReadyTime = 0;
         mFrameRecords[i].actualPresentTime = 0;
         mFrameRecords[i].frameReadyFence.clear();
@@ -219,4 +226,95 @@ void FrameTracker::dump(String8& result) const {
     result.append("\n");
 }
 
+void FrameTracker::dumpPresentError(String8& result) const {
+    Mutex::Autolock lock(mMutex);
+    processFencesLocked();
+
+    // the error is positive when the frame was presented late
+    int numFrames = 0;
+    int numLateFrames = 0;
+    nsecs_t errorSum = 0;
+    nsecs_t minError = INT64_MAX;
+    nsecs_t maxError = 0;
+    for (size_t i = 0; i < NUM_FRAME_RECORDS; i++) {
+        const FrameRecord& record(mFrameRecords[i]);
+        if (record.expectedPresentTime == 0 || !isFrameValidLocked(i)) {
+            continue;
+        }
+        const nsecs_t error = record.actualPresentTime - record.expectedPresentTime;
+        if (numFrames == 0 || error > maxError) {
+            maxError = error;
+        }
+        if (error < minError) {
+            minError = error;
+        }
+        if (mDisplayPeriod > 0 && error > mDisplayPeriod / 2) {
+            numLateFrames++;
+        }
+        errorSum += error;
+        numFrames++;
+    }
+
+    if (numFrames == 0) {
+        result.append("frames=0\n");
+        return;
+    }
+    result.appendFormat("frames=%d, late=%d, error avg=%lld min=%lld max=%lld\n",
+            numFrames, numLateFrames, errorSum / numFrames, minError, maxError);
+}
+
+void FrameTracker::dumpJudder(String8& result) const {
+    Mutex::Autolock lock(mMutex);
+    processFencesLocked();
+
+    // the latency of each frame is compared with the lowest latency of the
+    // frames presented just before it, so a constant latency isn't counted
+    const size_t window = 8;
+    nsecs_t latencies[window];
+    size_t numLatencies = 0;
+
+    int numFrames = 0;
+    int numJudderFrames = 0;
+    nsecs_t firstPresentTime = 0;
+    nsecs_t lastPresentTime = 0;
+    for (size_t i = 1; i <= NUM_FRAME_RECORDS; i++) {
+        const size_t idx = (mOffset + i) % NUM_FRAME_RECORDS;
+        const FrameRecord& record(mFrameRecords[idx]);
+        if (record.desiredPresentTime == 0 || !isFrameValidLocked(idx)) {
+            continue;
+        }
+        const nsecs_t latency = record.actualPresentTime - record.desiredPresentTime;
+        if (numLatencies > 0 && mDisplayPeriod > 0) {
+            nsecs_t minLatency = latencies[0];
+            for (size_t j = 1; j < numLatencies && j < window; j++) {
+                if (latencies[j] < minLatency) {
+                    minLatency = latencies[j];
+                }
+            }
+            if (latency - minLatency >= mDisplayPeriod) {
+                numJudderFrames++;
+            }
+        }
+        latencies[numLatencies % window] = latency;
+        numLatencies++;
+
+        if (numFrames == 0) {
+            firstPresentTime = record.actualPresentTime;
+        }
+        lastPresentTime = record.actualPresentTime;
+        numFrames++;
+    }
+
+    if (numFrames < 2 || mDisplayPeriod <= 0) {
+        result.appendFormat("frames=%d\n", numFrames);
+        return;
+    }
+
+    // the average number of refresh periods each frame was shown for
+    const double cadence = double(lastPresentTime - firstPresentTime) /
+            double(mDisplayPeriod) / double(numFrames - 1);
+    result.appendFormat("frames=%d, judder=%d, cadence=%.2f vsyncs\n",
+            numFrames, numJudderFrames, cadence);
+}
+
 } // namespace android
@@ -52,6 +52,10 @@ public:
     // conditions.
     void setDesiredPresentTime(nsecs_t desiredPresentTime);
 
+    // setExpectedPresentTime sets the time at which SurfaceFlinger expected
+    // the current frame to be presented when composing it.
+    void setExpectedPresentTime(nsecs_t expectedPresentTime);
+
     // setFrameReadyTime sets the time at which the current frame became ready
     // to be presented to the user.  For example, if the frame contents is
     // being written to memory by some asynchronous hardware, this would be
@@ -88,13 +92,26 @@ public:
     // dump appends the current frame display time history to the result string.
     void dump(String8& result) const;
 
+    // dumpPresentError appends statistics about the difference between the
+    // actual and the expected present times of the recent frames to the
+    // result string.
+    void dumpPresentError(String8& result) const;
+
+    // dumpJudder appends statistics about the regularity of the presentation
+    // of the recent frames to the result string.  A frame is counted as
+    // judder when it was presented at least one refresh period later,
+    // relative to its desired present time, than the recent frames.
+    void dumpJudder(String8& result) const;
+
 private:
     struct FrameRecord {
         FrameRecord() :
             desiredPresentTime(0),
+            expectedPresentTime(0),
             frameReadyTime(0),
             actualPresentTime(0) {}
         nsecs_t desiredPresentTime;
+        nsecs_t expectedPresentTime;
         nsecs_t frameReadyTime;
         nsecs_t actualPresentTime;
         sp<Fence> frameReadyFence;
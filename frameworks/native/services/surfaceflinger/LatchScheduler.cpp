@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <utils/String8.h>
+
+#include "LatchScheduler.h"
+
+namespace android {
+
+// The threshold is only used once this many frames were seen.
+static const size_t minSamples = 4;
+
+// Timestamps further apart than this are considered a discontinuity, such as
+// a seek, and the cadence is learned again.
+static const nsecs_t maxFrameInterval = 200000000;
+
+static int compareNsecs(const void* a, const void* b) {
+    const nsecs_t lhs = *static_cast<const nsecs_t*>(a);
+    const nsecs_t rhs = *static_cast<const nsecs_t*>(b);
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+LatchScheduler::LatchScheduler() :
+        mNumMoves(0) {
+    resetLocked();
+}
+
+void LatchScheduler::addFrame(nsecs_t timestamp, bool isAutoTimestamp) {
+    Mutex::Autolock lock(mMutex);
+
+    // Timestamps generated when the buffer is queued say nothing about the
+    // cadence of the content.
+    if (isAutoTimestamp) {
+        resetLocked();
+        return;
+    }
+
+    if (mNumSamples > 0) {
+        const size_t last = (mOffset + NUM_SAMPLES - 1) % NUM_SAMPLES;
+        const nsecs_t interval = timestamp - mTimestamps[last];
+        if (interval <= 0 || interval > maxFrameInterval) {
+            resetLocked();
+        }
+    }
+
+    mTimestamps[mOffset] = timestamp;
+    mOffset = (mOffset + 1) % NUM_SAMPLES;
+    if (mNumSamples < NUM_SAMPLES) {
+        mNumSamples++;
+    }
+
+    if (mNumSamples > 1) {
+        const size_t first = (mOffset + NUM_SAMPLES - mNumSamples) % NUM_SAMPLES;
+        mFramePeriod = (timestamp - mTimestamps[first]) / nsecs_t(mNumSamples - 1);
+    }
+}
+
+nsecs_t LatchScheduler::computeExpectedPresent(nsecs_t presentTime, nsecs_t period) {
+    Mutex::Autolock lock(mMutex);
+
+    if (period <= 0 || mNumSamples < minSamples) {
+        return presentTime;
+    }
+
+    // The phases of the recent frames relative to the vsync grid, sorted.
+    nsecs_t phases[NUM_SAMPLES];
+    for (size_t i = 0; i < mNumSamples; i++) {
+        nsecs_t phase = (mTimestamps[i] - presentTime) % period;
+        phases[i] = phase < 0 ? phase + period : phase;
+    }
+    qsort(phases, mNumSamples, sizeof(nsecs_t), compareNsecs);
+
+    // Keep the current threshold as long as all the frames are clear of it.
+    const nsecs_t clearance = period / 8;
+    if (mThresholdValid) {
+        const nsecs_t thresholdPhase = mThreshold < 0 ? mThreshold + period : mThreshold;
+        bool clear = true;
+        for (size_t i = 0; i < mNumSamples && clear; i++) {
+            nsecs_t distance = llabs(phases[i] - thresholdPhase);
+            if (distance > period / 2) {
+                distance = period - distance;
+            }
+            clear = distance >= clearance;
+        }
+        if (clear) {
+            return presentTime + mThreshold;
+        }
+    }
+
+    // Find the largest gap between consecutive phases, wrapping around.
+    nsecs_t gapStart = phases[mNumSamples - 1];
+    nsecs_t gapLength = phases[0] + period - phases[mNumSamples - 1];
+    for (size_t i = 1; i < mNumSamples; i++) {
+        const nsecs_t length = phases[i] - phases[i - 1];
+        if (length > gapLength) {
+            gapStart = phases[i - 1];
+            gapLength = length;
+        }
+    }
+
+    // Move the threshold to the middle of the gap, by at most half a period
+    // from the vsync either way.
+    nsecs_t threshold = (gapStart + gapLength / 2) % period;
+    if (threshold > period / 2) {
+        threshold -= period;
+    }
+    if (!mThresholdValid || threshold != mThreshold) {
+        mNumMoves++;
+    }
+    mThreshold = threshold;
+    mThresholdValid = true;
+    return presentTime + mThreshold;
+}
+
+void LatchScheduler::reset() {
+    Mutex::Autolock lock(mMutex);
+    resetLocked();
+}
+
+void LatchScheduler::resetLocked() {
+    mOffset = 0;
+    mNumSamples = 0;
+    mFramePeriod = 0;
+    mThreshold = 0;
+    mThresholdValid = false;
+}
+
+void LatchScheduler::dump(String8& result) const {
+    Mutex::Autolock lock(mMutex);
+    result.appendFormat("latch threshold=%lld (%s), frame period=%lld, moves=%u\n",
+            mThreshold, mThresholdValid ? "active" : "inactive", mFramePeriod,
+            mNumMoves);
+}
+
+} // namespace android
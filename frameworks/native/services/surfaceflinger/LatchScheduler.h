@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_LATCHSCHEDULER_H
+#define ANDROID_LATCHSCHEDULER_H
+
+#include <stddef.h>
+
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class String8;
+
+// LatchScheduler chooses the expected present time a layer passes to
+// BufferQueue when latching a buffer.  BufferQueue acquires the buffers whose
+// timestamp is before the expected present time, and drops the older ones.
+//
+// When the content frame rate is not a multiple of the refresh rate, for
+// instance 24p video on a 60Hz display, the timestamps of some frames fall
+// close to a vsync.  A little jitter in the timestamps or in the wakeup then
+// changes the vsync a frame is latched at, and the regular 3:2 pulldown turns
+// into runs of 3:3 and 2:2 frames that are seen as judder.
+//
+// The scheduler keeps the timestamps of the recent frames and computes their
+// phases relative to the vsync grid.  It moves the latch threshold, by up to
+// half a refresh period, to the middle of the largest gap between these
+// phases, so the frames are always latched at the same point of the cadence.
+// The threshold only moves again once a recent frame comes too close to it.
+//
+// All methods other than dump must be called from the main thread.
+class LatchScheduler {
+
+public:
+    // NUM_SAMPLES is the number of recent frame timestamps the threshold is
+    // computed from.
+    enum { NUM_SAMPLES = 16 };
+
+    LatchScheduler();
+
+    // computeExpectedPresent returns the expected present time to latch a
+    // buffer with, given the vsync time the next frame is presented at and
+    // the refresh period.
+    nsecs_t computeExpectedPresent(nsecs_t presentTime, nsecs_t period);
+
+    // addFrame records the timestamp of a latched buffer.
+    void addFrame(nsecs_t timestamp, bool isAutoTimestamp);
+
+    // reset forgets about the recent frames.
+    void reset();
+
+    // dump appends the state of the scheduler to the result string.
+    void dump(String8& result) const;
+
+private:
+    void resetLocked();
+
+    // mTimestamps is a circular buffer of the timestamps of the recent
+    // frames.
+    nsecs_t mTimestamps[NUM_SAMPLES];
+    size_t mOffset;
+    size_t mNumSamples;
+
+    // mFramePeriod is the average interval between the recent frames.
+    nsecs_t mFramePeriod;
+
+    // mThreshold is the offset of the latch threshold from the vsync, and
+    // mThresholdValid whether it was computed for the current samples.
+    nsecs_t mThreshold;
+    bool mThresholdValid;
+
+    // mNumMoves is the number of times the threshold moved.
+    uint32_t mNumMoves;
+
+    // mMutex is used to protect access to all member variables.
+    mutable Mutex mMutex;
+};
+
+}
+
+#endif // ANDROID_LATCHSCHEDULER_H
@@ -77,6 +77,7 @@ Layer::Layer(SurfaceFlinger* flinger, const sp<Client>& client,
         mMesh(Mesh::TRIANGLE_FAN, 4, 2, 2),
         mSecure(false),
         mProtectedByApp(false),
+        mCursorLayer(false),
         mHasSurface(false),
         mClientRef(client)
 {
@@ -119,6 +120,7 @@ void Layer::onFirstRef() {
     mSurfaceFlingerConsumer->setConsumerUsageBits(getEffectiveUsage(0));
     mSurfaceFlingerConsumer->setFrameAvailableListener(this);
     mSurfaceFlingerConsumer->setName(mName);
+    mSurfaceFlingerConsumer->setUseSlotTextures(true);
 
 #ifdef TARGET_DISABLE_TRIPLE_BUFFERING
 #warning "disabling triple buffering"
@@ -137,6 +139,11 @@ Layer::~Layer() {
         c->detachLayer(this);
     }
     mFlinger->deleteTextureAsync(mTextureName);
+    Vector<uint32_t> slotTextures;
+    mSurfaceFlingerConsumer->takeSlotTextureNames(&slotTextures);
+    for (size_t i = 0; i < slotTextures.size(); i++) {
+        mFlinger->deleteTextureAsync(slotTextures[i]);
+    }
     mFrameTracker.logAndResetStats(mName);
 }
 
@@ -190,6 +197,7 @@ status_t Layer::setBuffers( uint32_t w, uint32_t h,
     mSecure = (flags & ISurfaceComposerClient::eSecure) ? true : false;
     mProtectedByApp = (flags & ISurfaceComposerClient::eProtectedByApp) ? true : false;
     mOpaqueLayer = (flags & ISurfaceComposerClient::eOpaque);
+    mCursorLayer = (flags & ISurfaceComposerClient::eCursorWindow) ? true : false;
     mCurrentOpacity = getOpacityForFormat(format);
 
     mSurfaceFlingerConsumer->setDefaultBufferSize(w, h);
@@ -531,7 +539,10 @@ void Layer::onDraw(const sp<const DisplayDevice>& hw, const Region& clip) const
             memcpy(textureMatrix, texTransform.asArray(), sizeof(textureMatrix));
         }
 
-        // Set things up for texturing.
+        // Set things up for texturing.  Each buffer slot has a texture of
+        // its own, so the texture name follows the current buffer.
+        mTexture.init(Texture::TEXTURE_EXTERNAL,
+                mSurfaceFlingerConsumer->getCurrentTextureName());
         mTexture.setDimensions(mActiveBuffer->getWidth(), mActiveBuffer->getHeight());
         mTexture.setFiltering(useFiltering);
         mTexture.setMatrix(textureMatrix);
@@ -905,6 +916,7 @@ void Layer::onPostComposition() {
     if (mFrameLatencyNeeded) {
         nsecs_t desiredPresentTime = mSurfaceFlingerConsumer->getTimestamp();
         mFrameTracker.setDesiredPresentTime(desiredPresentTime);
+        mFrameTracker.setExpectedPresentTime(mFlinger->getExpectedPresentTime());
 
         sp<Fence> frameReadyFence = mSurfaceFlingerConsumer->getCurrentFence();
         if (frameReadyFence->isValid()) {
@@ -1064,7 +1076,9 @@ Region Layer::latchBuffer(bool& recomputeVisibleRegions)
 
         Reject r(mDrawingState, getCurrentState(), recomputeVisibleRegions);
 
-        status_t updateResult = mSurfaceFlingerConsumer->updateTexImage(&r);
+        status_t updateResult = mSurfaceFlingerConsumer->updateTexImage(&r,
+                mFlinger->getExpectedPresentTime(),
+                mFlinger->getHwComposer().getRefreshPeriod(HWC_DISPLAY_PRIMARY));
         if (updateResult == BufferQueue::PRESENT_LATER) {
             // Producer doesn't want buffer to be displayed yet.  Signal a
             // layer update so we check again at the next opportunity.
@@ -1130,6 +1144,19 @@ Region Layer::latchBuffer(bool& recomputeVisibleRegions)
         const Layer::State& s(getDrawingState());
         Region dirtyRegion(Rect(s.active.w, s.active.h));
 
+        // the damage of the buffer is only meaningful in layer space when
+        // the buffer maps onto the layer unscaled and untransformed, and
+        // when nothing else about the layer changed
+        const Region damage(mSurfaceFlingerConsumer->getCurrentSurfaceDamage());
+        const Rect bufferBounds(mActiveBuffer->getWidth(), mActiveBuffer->getHeight());
+        if (!damage.isEmpty() && !recomputeVisibleRegions &&
+                oldActiveBuffer != NULL && mCurrentTransform == 0 &&
+                !mSurfaceFlingerConsumer->getTransformToDisplayInverse() &&
+                (mCurrentCrop.isEmpty() || mCurrentCrop == bufferBounds) &&
+                bufferBounds == Rect(s.active.w, s.active.h)) {
+            dirtyRegion.andSelf(damage);
+        }
+
         // transform the dirty region to window-manager space
         outDirtyRegion = (s.transform.transform(dirtyRegion));
     }
@@ -1218,6 +1245,17 @@ void Layer::dumpStats(String8& result) const {
     mFrameTracker.dump(result);
 }
 
+void Layer::dumpPresentError(String8& result) const {
+    mFrameTracker.dumpPresentError(result);
+}
+
+void Layer::dumpJudder(String8& result) const {
+    mFrameTracker.dumpJudder(result);
+    if (mSurfaceFlingerConsumer != 0) {
+        mSurfaceFlingerConsumer->dumpLatchScheduler(result);
+    }
+}
+
 void Layer::clearStats() {
     mFrameTracker.clear();
 }
@@ -158,6 +158,12 @@ public:
      */
     virtual bool isSecure() const           { return mSecure; }
 
+    /*
+     * isCursor - true if this surface is a pointer cursor, which may be
+     * moved without a transaction.
+     */
+    virtual bool isCursor() const           { return mCursorLayer; }
+
     /*
      * isProtected - true if the layer may contain protected content in the
      * GRALLOC_USAGE_PROTECTED sense.
@@ -282,6 +288,8 @@ public:
     /* always call base class first */
     void dump(String8& result, Colorizer& colorizer) const;
     void dumpStats(String8& result) const;
+    void dumpPresentError(String8& result) const;
+    void dumpJudder(String8& result) const;
     void clearStats();
     void logFrameStats();
 
@@ -366,6 +374,7 @@ private:
     // page-flip thread (currently main thread)
     bool mSecure; // no screenshots
     bool mProtectedByApp; // application requires protected path to external sink
+    bool mCursorLayer;
 
     // protected by mLock
     mutable Mutex mLock;
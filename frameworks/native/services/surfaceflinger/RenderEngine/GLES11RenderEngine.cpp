@@ -17,6 +17,7 @@
 #include <GLES/gl.h>
 #include <GLES/glext.h>
 
+#include <ui/Rect.h>
 #include <utils/String8.h>
 #include <cutils/compiler.h>
 
@@ -72,13 +73,19 @@ size_t GLES11RenderEngine::getMaxViewportDims() const {
 }
 
 void GLES11RenderEngine::setViewportAndProjection(
-        size_t vpw, size_t vph, size_t w, size_t h, bool yswap) {
+        size_t vpw, size_t vph, const Rect& sourceCrop, size_t hwh, bool yswap) {
+    // the layers are drawn with the origin in the left-bottom corner
+    const float l = sourceCrop.left;
+    const float r = sourceCrop.right;
+    const float b = hwh - sourceCrop.bottom;
+    const float t = hwh - sourceCrop.top;
+
     glViewport(0, 0, vpw, vph);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     // put the origin in the left-bottom corner
-    if (yswap)  glOrthof(0, w, h, 0, 0, 1);
-    else        glOrthof(0, w, 0, h, 0, 1);
+    if (yswap)  glOrthof(l, r, t, b, 0, 1);
+    else        glOrthof(l, r, b, t, 0, 1);
     glMatrixMode(GL_MODELVIEW);
 }
 
@@ -71,6 +71,7 @@ public:
     void genTextures(size_t count, uint32_t* names);
     void deleteTextures(size_t count, uint32_t const* names);
     void readPixels(size_t l, size_t b, size_t w, size_t h, uint32_t* pixels);
+    void flush();
 
     class BindImageAsFramebuffer {
         RenderEngine& mEngine;
@@ -84,7 +85,10 @@ public:
 
     // set-up
     virtual void checkErrors() const;
-    virtual void setViewportAndProjection(size_t vpw, size_t vph, size_t w, size_t h, bool yswap) = 0;
+    // maps sourceCrop, in the coordinates of a display of height hwh, to a
+    // vpw x vph viewport
+    virtual void setViewportAndProjection(size_t vpw, size_t vph,
+            const Rect& sourceCrop, size_t hwh, bool yswap) = 0;
     virtual void setupLayerBlending(bool premultipliedAlpha, bool opaque, int alpha) = 0;
     virtual void setupDimLayerBlending(int alpha) = 0;
     virtual void setupLayerTexturing(const Texture& texture) = 0;
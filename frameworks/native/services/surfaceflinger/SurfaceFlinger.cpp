@@ -57,6 +57,7 @@
 #include "Client.h"
 #include "clz.h"
 #include "Colorizer.h"
+#include "CompositionScheduler.h"
 #include "DdmConnection.h"
 #include "DisplayDevice.h"
 #include "DispSync.h"
@@ -141,6 +142,7 @@ SurfaceFlinger::SurfaceFlinger()
         mVisibleRegionsDirty(false),
         mHwWorkListDirty(false),
         mAnimCompositionPending(false),
+        mExpectedPresentTime(0),
         mDebugRegion(0),
         mDebugDDMS(0),
         mDebugDisableHWC(0),
@@ -150,6 +152,7 @@ SurfaceFlinger::SurfaceFlinger()
         mDebugInTransaction(0),
         mLastTransactionTime(0),
         mBootFinished(false),
+        mCompositionScheduler(sfVsyncPhaseOffsetNs),
         mPrimaryHWVsyncEnabled(false),
         mHWVsyncAvailable(false),
         mDaltonize(false)
@@ -162,6 +165,9 @@ SurfaceFlinger::SurfaceFlinger()
     property_get("ro.bq.gpu_to_cpu_unsupported", value, "0");
     mGpuToCpuSupported = !atoi(value);
 
+    property_get("debug.sf.adaptive_phase", value, "0");
+    mAdaptivePhaseOffset = atoi(value);
+
     property_get("debug.sf.showupdates", value, "0");
     mDebugRegion = atoi(value);
 
@@ -175,6 +181,7 @@ SurfaceFlinger::SurfaceFlinger()
     }
     ALOGI_IF(mDebugRegion, "showupdates enabled");
     ALOGI_IF(mDebugDDMS, "DDMS debugging enabled");
+    ALOGI_IF(mAdaptivePhaseOffset, "adaptive SurfaceFlinger phase offset enabled");
 }
 
 void SurfaceFlinger::onFirstRef()
@@ -442,19 +449,29 @@ status_t SurfaceFlinger::selectEGLConfig(EGLDisplay display, EGLint nativeVisual
 
 class DispSyncSource : public VSyncSource, private DispSync::Callback {
 public:
-    DispSyncSource(DispSync* dispSync, nsecs_t phaseOffset, bool traceVsync) :
+    // The frame deadlines of the events are the next event of
+    // compositionSource, or of this source if it's NULL
+    DispSyncSource(DispSync* dispSync, nsecs_t phaseOffset, bool traceVsync,
+            const sp<DispSyncSource>& compositionSource = NULL) :
             mValue(0),
             mPhaseOffset(phaseOffset),
             mTraceVsync(traceVsync),
-            mDispSync(dispSync) {}
+            mDispSync(dispSync),
+            mCompositionSource(compositionSource) {}
 
     virtual ~DispSyncSource() {}
 
     virtual void setVSyncEnabled(bool enable) {
-        // Do NOT lock the mutex here so as to avoid any mutex ordering issues
-        // with locking it in the onDispSyncEvent callback.
+        // Do NOT hold the mutex while calling into DispSync so as to avoid
+        // any mutex ordering issues with locking it in the onDispSyncEvent
+        // callback.
         if (enable) {
-            status_t err = mDispSync->addEventListener(mPhaseOffset,
+            nsecs_t phaseOffset;
+            {
+                Mutex::Autolock lock(mMutex);
+                phaseOffset = mPhaseOffset;
+            }
+            status_t err = mDispSync->addEventListener(phaseOffset,
                     static_cast<DispSync::Callback*>(this));
             if (err != NO_ERROR) {
                 ALOGE("error registering vsync callback: %s (%d)",
@@ -477,6 +494,23 @@ public:
         mCallback = callback;
     }
 
+    nsecs_t getPhaseOffset() {
+        Mutex::Autolock lock(mMutex);
+        return mPhaseOffset;
+    }
+
+    // moves the events to a new phase offset, it is used when they're next
+    // enabled if they're currently disabled
+    void setPhaseOffset(nsecs_t phaseOffset) {
+        {
+            Mutex::Autolock lock(mMutex);
+            mPhaseOffset = phaseOffset;
+        }
+        // fails harmlessly if the events are disabled
+        mDispSync->changePhaseOffset(static_cast<DispSync::Callback*>(this),
+                phaseOffset);
+    }
+
 private:
     virtual void onDispSyncEvent(nsecs_t when) {
         sp<VSyncSource::Callback> callback;
@@ -491,16 +525,22 @@ private:
         }
 
         if (callback != NULL) {
-            callback->onVSyncEvent(when);
+            nsecs_t compositionPhaseOffset = mCompositionSource != NULL ?
+                    mCompositionSource->getPhaseOffset() : getPhaseOffset();
+            nsecs_t deadline, expectedPresentTime;
+            mDispSync->computeFrameTimeline(compositionPhaseOffset,
+                    &deadline, &expectedPresentTime);
+            callback->onVSyncEvent(when, expectedPresentTime, deadline);
         }
     }
 
     int mValue;
 
-    const nsecs_t mPhaseOffset;
+    nsecs_t mPhaseOffset;
     const bool mTraceVsync;
 
     DispSync* mDispSync;
+    const sp<DispSyncSource> mCompositionSource;
     sp<VSyncSource::Callback> mCallback;
     Mutex mMutex;
 };
@@ -601,12 +641,12 @@ void SurfaceFlinger::init() {
     getDefaultDisplayDevice()->makeCurrent(mEGLDisplay, mEGLContext);
 
     // start the EventThread
+    mSFVsyncSource = new DispSyncSource(&mPrimaryDispSync,
+            sfVsyncPhaseOffsetNs, false);
     sp<VSyncSource> vsyncSrc = new DispSyncSource(&mPrimaryDispSync,
-            vsyncPhaseOffsetNs, true);
+            vsyncPhaseOffsetNs, true, mSFVsyncSource);
     mEventThread = new EventThread(vsyncSrc);
-    sp<VSyncSource> sfVsyncSrc = new DispSyncSource(&mPrimaryDispSync,
-            sfVsyncPhaseOffsetNs, false);
-    mSFEventThread = new EventThread(sfVsyncSrc);
+    mSFEventThread = new EventThread(mSFVsyncSource);
     mEventQueue.setEventThread(mSFEventThread);
 
     mEventControlThread = new EventControlThread(this);
@@ -870,6 +910,12 @@ void SurfaceFlinger::onMessageReceived(int32_t what) {
         handleMessageTransaction();
         break;
     case MessageQueue::INVALIDATE:
+        // the frame composed in response to this vsync event is presented
+        // at the next vsync
+        mExpectedPresentTime = mPrimaryDispSync.computeNextRefresh(0);
+        if (mAdaptivePhaseOffset) {
+            mCompositionScheduler.beginFrame(mExpectedPresentTime);
+        }
         handleMessageTransaction();
         handleMessageInvalidate();
         signalRefresh();
@@ -911,7 +957,7 @@ void SurfaceFlinger::doDebugFlashRegions()
     const bool repaintEverything = mRepaintEverything;
     for (size_t dpy=0 ; dpy<mDisplays.size() ; dpy++) {
         const sp<DisplayDevice>& hw(mDisplays[dpy]);
-        if (hw->canDraw()) {
+        if (hw->canDraw() && !hw->isFrameSkipped()) {
             // transform the dirty region into this screen's coordinate space
             const Region dirtyRegion(hw->getDirtyRegion(repaintEverything));
             if (!dirtyRegion.isEmpty()) {
@@ -994,8 +1040,21 @@ void SurfaceFlinger::postComposition()
             nsecs_t presentTime = hwc.getRefreshTimestamp(HWC_DISPLAY_PRIMARY);
             mAnimFrameTracker.setActualPresentTime(presentTime);
         }
+        mAnimFrameTracker.setExpectedPresentTime(mExpectedPresentTime);
         mAnimFrameTracker.advanceFrame();
     }
+
+    if (mAdaptivePhaseOffset && presentFence->isValid()) {
+        // wake up just early enough for the next compositions, we need the
+        // present fences to tell whether the frames make their vsync
+        mCompositionScheduler.endFrame(systemTime(), presentFence);
+        nsecs_t phaseOffset;
+        if (mCompositionScheduler.computePhaseOffset(
+                mPrimaryDispSync.getPeriod(), &phaseOffset)) {
+            mSFVsyncSource->setPhaseOffset(phaseOffset);
+        }
+    }
+    mExpectedPresentTime = 0;
 }
 
 void SurfaceFlinger::rebuildLayerStacks() {
@@ -1046,6 +1105,9 @@ void SurfaceFlinger::setUpHWComposer() {
 
     HWComposer& hwc(getHwComposer());
     if (hwc.initCheck() == NO_ERROR) {
+        const bool geometryChanged = mHwWorkListDirty;
+        BitSet32 rebuiltWorkLists;
+
         // build the h/w work list
         if (CC_UNLIKELY(mHwWorkListDirty)) {
             mHwWorkListDirty = false;
@@ -1066,6 +1128,7 @@ void SurfaceFlinger::setUpHWComposer() {
                                 cur->setSkip(true);
                             }
                         }
+                        rebuiltWorkLists.markBit(id);
                     }
                 }
             }
@@ -1089,6 +1152,12 @@ void SurfaceFlinger::setUpHWComposer() {
                     const sp<Layer>& layer(currentLayers[i]);
                     layer->setPerFrameData(hw, *cur);
                 }
+                // a transaction doesn't necessarily change what the HWC
+                // sees, let it keep its overlays when it doesn't. this needs
+                // the visible regions, which are part of the per-frame data.
+                if (rebuiltWorkLists.hasBit(id)) {
+                    hwc.diffWorkList(id, currentLayers);
+                }
             }
         }
 
@@ -1096,23 +1165,77 @@ void SurfaceFlinger::setUpHWComposer() {
         ALOGE_IF(err, "HWComposer::prepare failed (%s)", strerror(-err));
 
         for (size_t dpy=0 ; dpy<mDisplays.size() ; dpy++) {
-            sp<const DisplayDevice> hw(mDisplays[dpy]);
+            const sp<DisplayDevice>& hw(mDisplays[dpy]);
+            hw->setReuseFramebuffer(canReuseFramebuffer(hw, geometryChanged));
             hw->prepareFrame(hwc);
         }
     }
 }
 
+bool SurfaceFlinger::canReuseFramebuffer(const sp<DisplayDevice>& hw,
+        bool geometryChanged) const {
+    // The HWC must still prepare every frame, but when the layer stack
+    // geometry and the composition types are unchanged and only layers
+    // composed by the HWC have new content, the GLES composition of the
+    // previous frame is still valid.
+    HWComposer& hwc(getHwComposer());
+    const int32_t id = hw->getHwcDisplayId();
+    if (id < 0 || !hwc.supportsFramebufferTarget() ||
+            hw->getDisplayType() >= DisplayDevice::DISPLAY_VIRTUAL) {
+        return false;
+    }
+
+    Vector<int32_t> plan;
+    Region glesRegion;
+    const Transform& tr(hw->getTransform());
+    const Vector< sp<Layer> >& currentLayers(hw->getVisibleLayersSortedByZ());
+    const size_t count = currentLayers.size();
+    HWComposer::LayerListIterator cur = hwc.begin(id);
+    const HWComposer::LayerListIterator end = hwc.end(id);
+    for (size_t i=0 ; cur!=end && i<count ; ++i, ++cur) {
+        const int32_t type = cur->getCompositionType();
+        plan.add(type);
+        if (type == HWC_FRAMEBUFFER) {
+            glesRegion.orSelf(tr.transform(currentLayers[i]->visibleRegion));
+        }
+    }
+
+    const bool samePlan = hw->setCompositionPlan(plan);
+    if (!samePlan || geometryChanged) {
+        // the framebuffer layers and the holes punched for the HWC layers
+        // moved, the content of the framebuffer target buffers is stale
+        hw->invalidateBufferHistory();
+    }
+    if (!samePlan || geometryChanged || !hw->canDraw() ||
+            !hwc.hasGlesComposition(id) || mDebugRegion || mRepaintEverything) {
+        return false;
+    }
+
+    const Region dirty(hw->getDirtyRegion(false));
+    return dirty.intersect(glesRegion).isEmpty();
+}
+
 void SurfaceFlinger::doComposition() {
     ATRACE_CALL();
     const bool repaintEverything = android_atomic_and(0, &mRepaintEverything);
+    bool frameSkipped = false;
     for (size_t dpy=0 ; dpy<mDisplays.size() ; dpy++) {
         const sp<DisplayDevice>& hw(mDisplays[dpy]);
-        if (hw->canDraw()) {
+        if (hw->isFrameSkipped()) {
+            // the display keeps its dirty region for the next frame
+            if (repaintEverything) {
+                hw->dirtyRegion.set(hw->bounds());
+            }
+            frameSkipped = true;
+        } else if (hw->canDraw()) {
             // transform the dirty region into this screen's coordinate space
             const Region dirtyRegion(hw->getDirtyRegion(repaintEverything));
 
-            // repaint the framebuffer (if needed)
-            doDisplayComposition(hw, dirtyRegion);
+            // repaint the framebuffer (if needed), the HWC presents the
+            // framebuffer target of the previous frame again otherwise
+            if (CC_LIKELY(!hw->getReuseFramebuffer())) {
+                doDisplayComposition(hw, dirtyRegion);
+            }
 
             hw->dirtyRegion.clear();
             hw->flip(hw->swapRegion);
@@ -1122,6 +1245,12 @@ void SurfaceFlinger::doComposition() {
         hw->compositionComplete();
     }
     postFramebuffer();
+
+    if (frameSkipped) {
+        // a display sitting out this frame is composed again on the next
+        // vsync, so that its latest content is not lost
+        signalLayerUpdate();
+    }
 }
 
 void SurfaceFlinger::postFramebuffer()
@@ -1675,10 +1804,18 @@ void SurfaceFlinger::doDisplayComposition(const sp<const DisplayDevice>& hw,
             // This is needed because PARTIAL_UPDATES only takes one
             // rectangle instead of a region (see DisplayDevice::flip())
             dirtyRegion.set(hw->swapRegion.bounds());
+        } else if (canRepaintPartially()) {
+            // the back buffer still holds the content it was composed with,
+            // only what changed since then must be redrawn. Layers ignore
+            // the clip region when drawing, so the area redrawn is scissored
+            // and must be a rectangle
+            dirtyRegion.set(hw->getRepaintRegion(dirtyRegion).bounds());
+            hw->swapRegion = dirtyRegion;
         } else {
             // we need to redraw everything (the whole screen)
             dirtyRegion.set(hw->bounds());
             hw->swapRegion = dirtyRegion;
+            hw->invalidateBufferHistory();
         }
     }
 
@@ -1698,6 +1835,18 @@ void SurfaceFlinger::doDisplayComposition(const sp<const DisplayDevice>& hw,
     hw->swapBuffers(getHwComposer());
 }
 
+bool SurfaceFlinger::canRepaintPartially() const
+{
+    // on legacy h/w composers, the framebuffer is swapped behind our back
+    // and we can't keep track of what the buffers hold. Color transforms
+    // are applied to the whole screen at once.
+    HWComposer& hwc(getHwComposer());
+    if (hwc.initCheck() == NO_ERROR && !hwc.supportsFramebufferTarget()) {
+        return false;
+    }
+    return !mDaltonize && !mDebugRegion;
+}
+
 void SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& hw, const Region& dirty)
 {
     RenderEngine& engine(getRenderEngine());
@@ -1714,6 +1863,16 @@ void SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& hw, const
             return;
         }
 
+        // when only part of the screen is recomposed, leave the rest of the
+        // framebuffer untouched
+        const Rect& bounds(hw->getBounds());
+        const Rect dirtyBounds(dirty.getBounds());
+        const uint32_t height = hw->getHeight();
+        if (dirtyBounds != bounds) {
+            engine.setScissor(dirtyBounds.left, height - dirtyBounds.bottom,
+                    dirtyBounds.getWidth(), dirtyBounds.getHeight());
+        }
+
         // Never touch the framebuffer if we don't have any framebuffer layers
         const bool hasHwcComposition = hwc.hasHwcComposition(id);
         if (hasHwcComposition) {
@@ -1749,15 +1908,14 @@ void SurfaceFlinger::doComposeSurfaces(const sp<const DisplayDevice>& hw, const
             // just to be on the safe side, we don't set the
             // scissor on the main display. It should never be needed
             // anyways (though in theory it could since the API allows it).
-            const Rect& bounds(hw->getBounds());
-            const Rect& scissor(hw->getScissor());
+            Rect scissor(hw->getScissor());
             if (scissor != bounds) {
                 // scissor doesn't match the screen's dimensions, so we
                 // need to clear everything outside of it and enable
                 // the GL scissor so we don't draw anything where we shouldn't
 
                 // enable scissor for this frame
-                const uint32_t height = hw->getHeight();
+                scissor.intersect(dirtyBounds, &scissor);
                 engine.setScissor(scissor.left, height - scissor.bottom,
                         scissor.getWidth(), scissor.getHeight());
             }
@@ -1946,6 +2104,24 @@ void SurfaceFlinger::setTransactionState(
     }
 }
 
+status_t SurfaceFlinger::setCursorPosition(const sp<Client>& client,
+        const sp<IBinder>& handle, float x, float y)
+{
+    // Cursor moves come at input rate. They only update the position of the
+    // layer and schedule a traversal, instead of going through
+    // setTransactionState() which may wait for previous transactions.
+    sp<Layer> layer(client->getLayerUser(handle));
+    if (layer == 0 || !layer->isCursor()) {
+        return BAD_VALUE;
+    }
+
+    Mutex::Autolock _l(mStateLock);
+    if (layer->setPosition(x, y)) {
+        setTransactionFlags(eTraversalNeeded);
+    }
+    return NO_ERROR;
+}
+
 uint32_t SurfaceFlinger::setDisplayStateLocked(const DisplayState& s)
 {
     ssize_t dpyIdx = mCurrentState.displays.indexOfKey(s.token);
@@ -2236,6 +2412,7 @@ void SurfaceFlinger::onScreenReleased(const sp<const DisplayDevice>& hw) {
     if (type < DisplayDevice::NUM_BUILTIN_DISPLAY_TYPES) {
         if (type == DisplayDevice::DISPLAY_PRIMARY) {
             disableHardwareVsync(true); // also cancels any in-progress resync
+            mCompositionScheduler.reset();
 
             // FIXME: eventthread only knows about the main display right now
             mEventThread->onScreenReleased();
@@ -2346,6 +2523,28 @@ status_t SurfaceFlinger::dump(int fd, const Vector<String16>& args)
                 clearStatsLocked(args, index, result);
                 dumpAll = false;
             }
+
+            if ((index < numArgs) &&
+                    (args[index] == String16("--present-error"))) {
+                index++;
+                dumpPresentErrorLocked(args, index, result);
+                dumpAll = false;
+            }
+
+            if ((index < numArgs) &&
+                    (args[index] == String16("--judder"))) {
+                index++;
+                dumpJudderLocked(args, index, result);
+                dumpAll = false;
+            }
+
+            if ((index < numArgs) &&
+                    (args[index] == String16("--binder"))) {
+                index++;
+                ProcessState::self()->dumpThreadPool(result);
+                IPCThreadState::dumpTransactionStats(result);
+                dumpAll = false;
+            }
         }
 
         if (dumpAll) {
@@ -2398,6 +2597,55 @@ void SurfaceFlinger::dumpStatsLocked(const Vector<String16>& args, size_t& index
     }
 }
 
+void SurfaceFlinger::dumpPresentErrorLocked(const Vector<String16>& args,
+        size_t& index, String8& result) const
+{
+    String8 name;
+    if (index < args.size()) {
+        name = String8(args[index]);
+        index++;
+    }
+
+    // the error between the actual and the expected present time of the
+    // recent frames of each layer, in nanoseconds
+    if (name.isEmpty()) {
+        result.append("<win-anim>: ");
+        mAnimFrameTracker.dumpPresentError(result);
+    }
+
+    const LayerVector& currentLayers = mCurrentState.layersSortedByZ;
+    const size_t count = currentLayers.size();
+    for (size_t i=0 ; i<count ; i++) {
+        const sp<Layer>& layer(currentLayers[i]);
+        if (name.isEmpty() || (name == layer->getName())) {
+            result.appendFormat("%s: ", layer->getName().string());
+            layer->dumpPresentError(result);
+        }
+    }
+}
+
+void SurfaceFlinger::dumpJudderLocked(const Vector<String16>& args,
+        size_t& index, String8& result) const
+{
+    String8 name;
+    if (index < args.size()) {
+        name = String8(args[index]);
+        index++;
+    }
+
+    // how regularly the recent frames of each layer were presented, and
+    // where the layer latches its buffers relative to the vsync
+    const LayerVector& currentLayers = mCurrentState.layersSortedByZ;
+    const size_t count = currentLayers.size();
+    for (size_t i=0 ; i<count ; i++) {
+        const sp<Layer>& layer(currentLayers[i]);
+        if (name.isEmpty() || (name == layer->getName())) {
+            result.appendFormat("%s: ", layer->getName().string());
+            layer->dumpJudder(result);
+        }
+    }
+}
+
 void SurfaceFlinger::clearStatsLocked(const Vector<String16>& args, size_t& index,
         String8& result)
 {
@@ -2489,6 +2737,10 @@ void SurfaceFlinger::dumpAllLocked(const Vector<String16>& args, size_t& index,
     result.append(SyncFeatures::getInstance().toString());
     result.append("\n");
 
+    if (mAdaptivePhaseOffset) {
+        mCompositionScheduler.dump(result);
+    }
+
     /*
      * Dump the visible layer list
      */
@@ -2838,7 +3090,7 @@ public:
 
 status_t SurfaceFlinger::captureScreen(const sp<IBinder>& display,
         const sp<IGraphicBufferProducer>& producer,
-        uint32_t reqWidth, uint32_t reqHeight,
+        Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
         uint32_t minLayerZ, uint32_t maxLayerZ) {
 
     if (CC_UNLIKELY(display == 0))
@@ -2863,6 +3115,7 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& display,
         SurfaceFlinger* flinger;
         sp<IBinder> display;
         sp<IGraphicBufferProducer> producer;
+        Rect sourceCrop;
         uint32_t reqWidth, reqHeight;
         uint32_t minLayerZ,maxLayerZ;
         status_t result;
@@ -2870,10 +3123,10 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& display,
         MessageCaptureScreen(SurfaceFlinger* flinger,
                 const sp<IBinder>& display,
                 const sp<IGraphicBufferProducer>& producer,
-                uint32_t reqWidth, uint32_t reqHeight,
+                Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
                 uint32_t minLayerZ, uint32_t maxLayerZ)
             : flinger(flinger), display(display), producer(producer),
-              reqWidth(reqWidth), reqHeight(reqHeight),
+              sourceCrop(sourceCrop), reqWidth(reqWidth), reqHeight(reqHeight),
               minLayerZ(minLayerZ), maxLayerZ(maxLayerZ),
               result(PERMISSION_DENIED)
         {
@@ -2884,8 +3137,8 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& display,
         virtual bool handler() {
             Mutex::Autolock _l(flinger->mStateLock);
             sp<const DisplayDevice> hw(flinger->getDisplayDevice(display));
-            result = flinger->captureScreenImplLocked(hw,
-                    producer, reqWidth, reqHeight, minLayerZ, maxLayerZ);
+            result = flinger->captureScreenImplLocked(hw, producer,
+                    sourceCrop, reqWidth, reqHeight, minLayerZ, maxLayerZ);
             static_cast<GraphicProducerWrapper*>(producer->asBinder().get())->exit(result);
             return true;
         }
@@ -2907,7 +3160,7 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& display,
     // which does the marshaling work forwards to our "fake remote" above.
     sp<MessageBase> msg = new MessageCaptureScreen(this,
             display, IGraphicBufferProducer::asInterface( wrapper ),
-            reqWidth, reqHeight, minLayerZ, maxLayerZ);
+            sourceCrop, reqWidth, reqHeight, minLayerZ, maxLayerZ);
 
     status_t res = postMessageAsync(msg);
     if (res == NO_ERROR) {
@@ -2919,7 +3172,7 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& display,
 
 void SurfaceFlinger::renderScreenImplLocked(
         const sp<const DisplayDevice>& hw,
-        uint32_t reqWidth, uint32_t reqHeight,
+        Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
         uint32_t minLayerZ, uint32_t maxLayerZ,
         bool yswap)
 {
@@ -2927,15 +3180,15 @@ void SurfaceFlinger::renderScreenImplLocked(
     RenderEngine& engine(getRenderEngine());
 
     // get screen geometry
-    const uint32_t hw_w = hw->getWidth();
     const uint32_t hw_h = hw->getHeight();
-    const bool filtering = reqWidth != hw_w || reqWidth != hw_h;
+    const bool filtering = reqWidth != uint32_t(sourceCrop.width()) ||
+            reqHeight != uint32_t(sourceCrop.height());
 
     // make sure to clear all GL error flags
     engine.checkErrors();
 
     // set-up our viewport
-    engine.setViewportAndProjection(reqWidth, reqHeight, hw_w, hw_h, yswap);
+    engine.setViewportAndProjection(reqWidth, reqHeight, sourceCrop, hw_h, yswap);
     engine.disableTexturing();
 
     // redraw the screen entirely...
@@ -2966,7 +3219,7 @@ void SurfaceFlinger::renderScreenImplLocked(
 status_t SurfaceFlinger::captureScreenImplLocked(
         const sp<const DisplayDevice>& hw,
         const sp<IGraphicBufferProducer>& producer,
-        uint32_t reqWidth, uint32_t reqHeight,
+        Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
         uint32_t minLayerZ, uint32_t maxLayerZ)
 {
     ATRACE_CALL();
@@ -2975,14 +3228,24 @@ status_t SurfaceFlinger::captureScreenImplLocked(
     const uint32_t hw_w = hw->getWidth();
     const uint32_t hw_h = hw->getHeight();
 
+    // an empty crop captures the whole display
+    if (sourceCrop.isEmpty()) {
+        sourceCrop = hw->getBounds();
+    } else if (!sourceCrop.intersect(hw->getBounds(), &sourceCrop)) {
+        ALOGE("source crop [%d, %d, %d, %d] is outside of the display",
+                sourceCrop.left, sourceCrop.top,
+                sourceCrop.right, sourceCrop.bottom);
+        return BAD_VALUE;
+    }
+
     if ((reqWidth > hw_w) || (reqHeight > hw_h)) {
         ALOGE("size mismatch (%d, %d) > (%d, %d)",
                 reqWidth, reqHeight, hw_w, hw_h);
         return BAD_VALUE;
     }
 
-    reqWidth  = (!reqWidth)  ? hw_w : reqWidth;
-    reqHeight = (!reqHeight) ? hw_h : reqHeight;
+    reqWidth  = (!reqWidth)  ? sourceCrop.width()  : reqWidth;
+    reqHeight = (!reqHeight) ? sourceCrop.height() : reqHeight;
 
     // create a surface (because we're a producer, and we need to
     // dequeue/queue a buffer)
@@ -3002,6 +3265,7 @@ status_t SurfaceFlinger::captureScreenImplLocked(
 
         if (err == NO_ERROR) {
             ANativeWindowBuffer* buffer;
+            int syncFd = -1;
             /* TODO: Once we have the sync framework everywhere this can use
              * server-side waits on the fence that dequeueBuffer returns.
              */
@@ -3020,28 +3284,36 @@ status_t SurfaceFlinger::captureScreenImplLocked(
                         // via an FBO, which means we didn't have to create
                         // an EGLSurface and therefore we're not
                         // dependent on the context's EGLConfig.
-                        renderScreenImplLocked(hw, reqWidth, reqHeight,
+                        renderScreenImplLocked(hw, sourceCrop, reqWidth, reqHeight,
                                 minLayerZ, maxLayerZ, true);
 
-                        // Create a sync point and wait on it, so we know the buffer is
-                        // ready before we pass it along.  We can't trivially call glFlush(),
-                        // so we use a wait flag instead.
-                        // TODO: pass a sync fd to queueBuffer() and let the consumer wait.
-                        EGLSyncKHR sync = eglCreateSyncKHR(mEGLDisplay, EGL_SYNC_FENCE_KHR, NULL);
-                        if (sync != EGL_NO_SYNC_KHR) {
-                            EGLint result = eglClientWaitSyncKHR(mEGLDisplay, sync,
-                                    EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 2000000000 /*2 sec*/);
-                            EGLint eglErr = eglGetError();
-                            eglDestroySyncKHR(mEGLDisplay, sync);
-                            if (result == EGL_TIMEOUT_EXPIRED_KHR) {
-                                ALOGW("captureScreen: fence wait timed out");
+                        // Pass a native fence along with the buffer, so that the
+                        // consumer waits for rendering to complete rather than
+                        // holding up composition here.
+                        if (SyncFeatures::getInstance().useNativeFenceSync()) {
+                            syncFd = createNativeFenceLocked();
+                        }
+
+                        if (syncFd < 0) {
+                            // Create a sync point and wait on it, so we know the buffer is
+                            // ready before we pass it along.  We can't trivially call glFlush(),
+                            // so we use a wait flag instead.
+                            EGLSyncKHR sync = eglCreateSyncKHR(mEGLDisplay, EGL_SYNC_FENCE_KHR, NULL);
+                            if (sync != EGL_NO_SYNC_KHR) {
+                                EGLint result = eglClientWaitSyncKHR(mEGLDisplay, sync,
+                                        EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 2000000000 /*2 sec*/);
+                                EGLint eglErr = eglGetError();
+                                eglDestroySyncKHR(mEGLDisplay, sync);
+                                if (result == EGL_TIMEOUT_EXPIRED_KHR) {
+                                    ALOGW("captureScreen: fence wait timed out");
+                                } else {
+                                    ALOGW_IF(eglErr != EGL_SUCCESS,
+                                            "captureScreen: error waiting on EGL fence: %#x", eglErr);
+                                }
                             } else {
-                                ALOGW_IF(eglErr != EGL_SUCCESS,
-                                        "captureScreen: error waiting on EGL fence: %#x", eglErr);
+                                ALOGW("captureScreen: error creating EGL fence: %#x", eglGetError());
+                                // not fatal
                             }
-                        } else {
-                            ALOGW("captureScreen: error creating EGL fence: %#x", eglGetError());
-                            // not fatal
                         }
 
                         if (DEBUG_SCREENSHOTS) {
@@ -3061,7 +3333,7 @@ status_t SurfaceFlinger::captureScreenImplLocked(
                 } else {
                     result = BAD_VALUE;
                 }
-                window->queueBuffer(window, buffer, -1);
+                window->queueBuffer(window, buffer, syncFd);
             }
         } else {
             result = BAD_VALUE;
@@ -3072,6 +3344,25 @@ status_t SurfaceFlinger::captureScreenImplLocked(
     return result;
 }
 
+int SurfaceFlinger::createNativeFenceLocked() {
+    EGLSyncKHR sync = eglCreateSyncKHR(mEGLDisplay,
+            EGL_SYNC_NATIVE_FENCE_ANDROID, NULL);
+    if (sync == EGL_NO_SYNC_KHR) {
+        ALOGW("captureScreen: error creating native fence: %#x", eglGetError());
+        return -1;
+    }
+
+    // the fence fd is only available once the commands have been flushed
+    getRenderEngine().flush();
+    int fenceFd = eglDupNativeFenceFDANDROID(mEGLDisplay, sync);
+    eglDestroySyncKHR(mEGLDisplay, sync);
+    if (fenceFd == EGL_NO_NATIVE_FENCE_FD_ANDROID) {
+        ALOGW("captureScreen: error duplicating native fence: %#x", eglGetError());
+        return -1;
+    }
+    return fenceFd;
+}
+
 void SurfaceFlinger::checkScreenshot(size_t w, size_t s, size_t h, void const* vaddr,
         const sp<const DisplayDevice>& hw, uint32_t minLayerZ, uint32_t maxLayerZ) {
     if (DEBUG_SCREENSHOTS) {
@@ -47,6 +47,7 @@
 #include <private/gui/LayerState.h>
 
 #include "Barrier.h"
+#include "CompositionScheduler.h"
 #include "DisplayDevice.h"
 #include "DispSync.h"
 #include "FrameTracker.h"
@@ -61,6 +62,7 @@ namespace android {
 
 class Client;
 class DisplayEventConnection;
+class DispSyncSource;
 class EventThread;
 class IGraphicBufferAlloc;
 class Layer;
@@ -201,7 +203,7 @@ private:
     virtual sp<IDisplayEventConnection> createDisplayEventConnection();
     virtual status_t captureScreen(const sp<IBinder>& display,
             const sp<IGraphicBufferProducer>& producer,
-            uint32_t reqWidth, uint32_t reqHeight,
+            Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
             uint32_t minLayerZ, uint32_t maxLayerZ);
     // called when screen needs to turn off
     virtual void blank(const sp<IBinder>& display);
@@ -261,6 +263,8 @@ private:
     void commitTransaction();
     uint32_t setClientStateLocked(const sp<Client>& client, const layer_state_t& s);
     uint32_t setDisplayStateLocked(const DisplayState& s);
+    status_t setCursorPosition(const sp<Client>& client, const sp<IBinder>& handle,
+            float x, float y);
 
     /* ------------------------------------------------------------------------
      * Layer management
@@ -304,14 +308,18 @@ private:
 
     void renderScreenImplLocked(
             const sp<const DisplayDevice>& hw,
-            uint32_t reqWidth, uint32_t reqHeight,
+            Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
             uint32_t minLayerZ, uint32_t maxLayerZ,
             bool yswap);
 
+    // returns a native fence fd that signals when the GL commands issued so
+    // far have completed, or -1
+    int createNativeFenceLocked();
+
     status_t captureScreenImplLocked(
             const sp<const DisplayDevice>& hw,
             const sp<IGraphicBufferProducer>& producer,
-            uint32_t reqWidth, uint32_t reqHeight,
+            Rect sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
             uint32_t minLayerZ, uint32_t maxLayerZ);
 
     /* ------------------------------------------------------------------------
@@ -356,6 +364,10 @@ private:
 
     HWComposer& getHwComposer() const { return *mHwc; }
 
+    // returns the time at which the frame being composed is expected to be
+    // presented on the primary display, or 0 if unknown
+    nsecs_t getExpectedPresentTime() const { return mExpectedPresentTime; }
+
     /* ------------------------------------------------------------------------
      * Compositing
      */
@@ -368,9 +380,11 @@ private:
     void postComposition();
     void rebuildLayerStacks();
     void setUpHWComposer();
+    bool canReuseFramebuffer(const sp<DisplayDevice>& hw, bool geometryChanged) const;
     void doComposition();
     void doDebugFlashRegions();
     void doDisplayComposition(const sp<const DisplayDevice>& hw, const Region& dirtyRegion);
+    bool canRepaintPartially() const;
     void doComposeSurfaces(const sp<const DisplayDevice>& hw, const Region& dirty);
 
     void postFramebuffer();
@@ -392,6 +406,10 @@ private:
      */
     void listLayersLocked(const Vector<String16>& args, size_t& index, String8& result) const;
     void dumpStatsLocked(const Vector<String16>& args, size_t& index, String8& result) const;
+    void dumpPresentErrorLocked(const Vector<String16>& args, size_t& index,
+            String8& result) const;
+    void dumpJudderLocked(const Vector<String16>& args, size_t& index,
+            String8& result) const;
     void clearStatsLocked(const Vector<String16>& args, size_t& index, String8& result);
     void dumpAllLocked(const Vector<String16>& args, size_t& index, String8& result) const;
     bool startDdmConnection();
@@ -427,8 +445,10 @@ private:
     RenderEngine* mRenderEngine;
     nsecs_t mBootTime;
     bool mGpuToCpuSupported;
+    bool mAdaptivePhaseOffset;
     sp<EventThread> mEventThread;
     sp<EventThread> mSFEventThread;
+    sp<DispSyncSource> mSFVsyncSource;
     sp<EventControlThread> mEventControlThread;
     EGLContext mEGLContext;
     EGLConfig mEGLConfig;
@@ -442,6 +462,7 @@ private:
     bool mVisibleRegionsDirty;
     bool mHwWorkListDirty;
     bool mAnimCompositionPending;
+    nsecs_t mExpectedPresentTime;
 
     // this may only be written from the main thread with mStateLock held
     // it may be read from other threads with mStateLock held
@@ -462,6 +483,7 @@ private:
     mutable MessageQueue mEventQueue;
     FrameTracker mAnimFrameTracker;
     DispSync mPrimaryDispSync;
+    CompositionScheduler mCompositionScheduler;
 
     // protected by mDestroyedLayerLock;
     mutable Mutex mDestroyedLayerLock;
@@ -28,7 +28,8 @@ namespace android {
 
 // ---------------------------------------------------------------------------
 
-status_t SurfaceFlingerConsumer::updateTexImage(BufferRejecter* rejecter)
+status_t SurfaceFlingerConsumer::updateTexImage(BufferRejecter* rejecter,
+        nsecs_t presentTime, nsecs_t period)
 {
     ATRACE_CALL();
     ALOGV("updateTexImage");
@@ -50,7 +51,10 @@ status_t SurfaceFlingerConsumer::updateTexImage(BufferRejecter* rejecter)
     // Acquire the next buffer.
     // In asynchronous mode the list is guaranteed to be one buffer
     // deep, while in synchronous mode we use the oldest buffer.
-    err = acquireBufferLocked(&item, computeExpectedPresent());
+    const nsecs_t expectedPresent = (presentTime > 0 && period > 0) ?
+            mLatchScheduler.computeExpectedPresent(presentTime, period) :
+            computeExpectedPresent();
+    err = acquireBufferLocked(&item, expectedPresent);
     if (err != NO_ERROR) {
         if (err == BufferQueue::NO_BUFFER_AVAILABLE) {
             err = NO_ERROR;
@@ -73,6 +77,8 @@ status_t SurfaceFlingerConsumer::updateTexImage(BufferRejecter* rejecter)
         return NO_ERROR;
     }
 
+    mLatchScheduler.addFrame(item.mTimestamp, item.mIsAutoTimestamp);
+
     // Release the previous buffer.
     err = updateAndReleaseLocked(item);
     if (err != NO_ERROR) {
@@ -125,6 +131,11 @@ bool SurfaceFlingerConsumer::getTransformToDisplayInverse() const {
 // vsync, we'll hold the frame when we really want to display it.  We
 // want to use an expected-presentation time that is slightly late to
 // avoid this sort of edge case.
+void SurfaceFlingerConsumer::dumpLatchScheduler(String8& result) const
+{
+    mLatchScheduler.dump(result);
+}
+
 nsecs_t SurfaceFlingerConsumer::computeExpectedPresent()
 {
     // Don't yet have an easy way to get actual buffer flip time for
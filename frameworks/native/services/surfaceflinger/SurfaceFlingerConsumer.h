@@ -19,6 +19,8 @@
 
 #include <gui/GLConsumer.h>
 
+#include "LatchScheduler.h"
+
 namespace android {
 // ----------------------------------------------------------------------------
 
@@ -54,6 +56,10 @@ public:
     // must be called from SF main thread
     bool getTransformToDisplayInverse() const;
 
+    // dumpLatchScheduler appends the state of the LatchScheduler to the
+    // result string.
+    void dumpLatchScheduler(String8& result) const;
+
 private:
     nsecs_t computeExpectedPresent();
 
@@ -61,6 +67,10 @@ private:
     // it is displayed onto. This is applied after GLConsumer::mCurrentTransform.
     // This must be set/read from SurfaceFlinger's main thread.
     bool mTransformToDisplayInverse;
+
+    // mLatchScheduler learns the cadence of the queued frames and places
+    // the latch threshold where it is not crossed by their jitter.
+    LatchScheduler mLatchScheduler;
 };
 
 // ----------------------------------------------------------------------------
@@ -185,6 +185,9 @@ void Allocation::copy1DRangeFrom(uint32_t off, size_t count, const void *data) {
         return;
     }
 
+    if (isBackingStore(data, off, 0, 0)) {
+        return;
+    }
     tryDispatch(mRS, RS::dispatch->Allocation1DData(mRS->getContext(), getIDSafe(), off, mSelectedLOD,
                                                     count, data, count * mType->getElement()->getSizeBytes()));
 }
@@ -235,6 +238,9 @@ void Allocation::validate2DRange(uint32_t xoff, uint32_t yoff, uint32_t w, uint3
 void Allocation::copy2DRangeFrom(uint32_t xoff, uint32_t yoff, uint32_t w, uint32_t h,
                                  const void *data) {
     validate2DRange(xoff, yoff, w, h);
+    if (isBackingStore(data, xoff, yoff, h > 1 ? w * mType->getElement()->getSizeBytes() : 0)) {
+        return;
+    }
     tryDispatch(mRS, RS::dispatch->Allocation2DData(mRS->getContext(), getIDSafe(), xoff,
                                                     yoff, mSelectedLOD, mSelectedFace,
                                                     w, h, data, w * h * mType->getElement()->getSizeBytes(),
@@ -262,6 +268,9 @@ void Allocation::copy2DRangeTo(uint32_t xoff, uint32_t yoff, uint32_t w, uint32_
 void Allocation::copy2DStridedFrom(uint32_t xoff, uint32_t yoff, uint32_t w, uint32_t h,
                                    const void *data, size_t stride) {
     validate2DRange(xoff, yoff, w, h);
+    if (isBackingStore(data, xoff, yoff, h > 1 ? stride : 0)) {
+        return;
+    }
     tryDispatch(mRS, RS::dispatch->Allocation2DData(mRS->getContext(), getIDSafe(), xoff, yoff,
                                                     mSelectedLOD, mSelectedFace, w, h, data,
                                                     w * h * mType->getElement()->getSizeBytes(), stride));
@@ -283,6 +292,78 @@ void Allocation::copy2DStridedTo(void* data, size_t stride) {
     copy2DStridedTo(0, 0, mCurrentDimX, mCurrentDimY, data, stride);
 }
 
+void * Allocation::getPointer(size_t *stride) {
+    if ((mUsage & RS_ALLOCATION_USAGE_SHARED) == 0) {
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Allocation does not have USAGE_SHARED.");
+        return NULL;
+    }
+
+    void *p = NULL;
+    size_t s = 0;
+    if (mRS->getError() == RS_SUCCESS) {
+        p = RS::dispatch->AllocationGetPointer(mRS->getContext(), getIDSafe(), mSelectedLOD,
+                                               mSelectedFace, mSelectedZ, &s, sizeof(s));
+    }
+    if (stride != NULL) {
+        *stride = s;
+    }
+    return p;
+}
+
+// Returns true if data already is the backing store of the region starting at
+// xoff, yoff, as when it was written through getPointer(). Copying it onto
+// itself can then be skipped, as long as no other usage needs to see the
+// change. A stride of 0 means a single row.
+bool Allocation::isBackingStore(const void *data, uint32_t xoff, uint32_t yoff, size_t stride) {
+    const uint32_t usage = RS_ALLOCATION_USAGE_SCRIPT | RS_ALLOCATION_USAGE_SHARED;
+    if ((mUsage & RS_ALLOCATION_USAGE_SHARED) == 0 || (mUsage & ~usage) != 0 ||
+        mRS->getError() != RS_SUCCESS) {
+        return false;
+    }
+
+    size_t allocStride = 0;
+    const uint8_t *p = (const uint8_t *)RS::dispatch->AllocationGetPointer(
+            mRS->getContext(), getIDSafe(), mSelectedLOD, mSelectedFace, mSelectedZ,
+            &allocStride, sizeof(allocStride));
+    if (p == NULL || (stride != 0 && stride != allocStride)) {
+        return false;
+    }
+    return data == p + yoff * allocStride + xoff * mType->getElement()->getSizeBytes();
+}
+
+void Allocation::copy1DRangeFromAsync(uint32_t off, size_t count, const void *data,
+                                      CompletionFunc_t func, void *userData) {
+    if(count < 1) {
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Count must be >= 1.");
+        return;
+    }
+    if((off + count) > mCurrentCount) {
+        ALOGE("Overflow, Available count %zu, got %zu at offset %zu.", mCurrentCount, count, off);
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Invalid copy specified");
+        return;
+    }
+
+    if (!isBackingStore(data, off, 0, 0)) {
+        const size_t sizeBytes = count * mType->getElement()->getSizeBytes();
+        tryDispatch(mRS, RS::dispatch->AllocationDataAsync(mRS->getContext(), getIDSafe(), off, 0,
+                                                           mSelectedLOD, mSelectedFace, count, 1,
+                                                           (uintptr_t)data, sizeBytes, sizeBytes));
+    }
+    mRS->finishAsync(func, userData);
+}
+
+void Allocation::copy2DRangeFromAsync(uint32_t xoff, uint32_t yoff, uint32_t w, uint32_t h,
+                                      const void *data, CompletionFunc_t func, void *userData) {
+    validate2DRange(xoff, yoff, w, h);
+    const size_t stride = w * mType->getElement()->getSizeBytes();
+    if (!isBackingStore(data, xoff, yoff, h > 1 ? stride : 0)) {
+        tryDispatch(mRS, RS::dispatch->AllocationDataAsync(mRS->getContext(), getIDSafe(), xoff, yoff,
+                                                           mSelectedLOD, mSelectedFace, w, h,
+                                                           (uintptr_t)data, h * stride, stride));
+    }
+    mRS->finishAsync(func, userData);
+}
+
 void Allocation::validate3DRange(uint32_t xoff, uint32_t yoff, uint32_t zoff, uint32_t w,
                                  uint32_t h, uint32_t d) {
     if (mAdaptedAllocation != NULL) {
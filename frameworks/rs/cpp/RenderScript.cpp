@@ -37,6 +37,9 @@ pthread_mutex_t RS::gInitMutex = PTHREAD_MUTEX_INITIALIZER;
 dispatchTable* RS::dispatch = NULL;
 static int gInitError = 0;
 
+// Message id reserved for the completion messages of finishAsync().
+static const uint32_t COMPLETION_MESSAGE_ID = 0x7fff0001;
+
 RS::RS() {
     mDev = NULL;
     mContext = NULL;
@@ -45,6 +48,9 @@ RS::RS() {
     mMessageRun = false;
     mInit = false;
     mCurrentError = RS_SUCCESS;
+    mNextCompletionToken = 0;
+    mBatchDepth = 0;
+    pthread_mutex_init(&mCompletionLock, NULL);
 
     memset(&mElements, 0, sizeof(mElements));
     memset(&mSamplers, 0, sizeof(mSamplers));
@@ -64,6 +70,7 @@ RS::~RS() {
         RS::dispatch->DeviceDestroy(mDev);
         mDev = NULL;
     }
+    pthread_mutex_destroy(&mCompletionLock);
 }
 
 bool RS::init(uint32_t flags) {
@@ -147,6 +154,11 @@ static bool loadSymbols(void* handle) {
         ALOGE("Couldn't initialize RS::dispatch->ContextDeinitToClient");
         return false;
     }
+    RS::dispatch->ContextSetBatching = (ContextSetBatchingFnPtr)dlsym(handle, "rsContextSetBatching");
+    if (RS::dispatch->ContextSetBatching == NULL) {
+        ALOGE("Couldn't initialize RS::dispatch->ContextSetBatching");
+        return false;
+    }
     RS::dispatch->TypeCreate = (TypeCreateFnPtr)dlsym(handle, "rsTypeCreate");
     if (RS::dispatch->TypeCreate == NULL) {
         ALOGE("Couldn't initialize RS::dispatch->TypeCreate");
@@ -172,6 +184,11 @@ static bool loadSymbols(void* handle) {
         ALOGE("Couldn't initialize RS::dispatch->AllocationGetSurface");
         return false;
     }
+    RS::dispatch->AllocationGetPointer = (AllocationGetPointerFnPtr)dlsym(handle, "rsAllocationGetPointer");
+    if (RS::dispatch->AllocationGetPointer == NULL) {
+        ALOGE("Couldn't initialize RS::dispatch->AllocationGetPointer");
+        return false;
+    }
     RS::dispatch->AllocationSetSurface = (AllocationSetSurfaceFnPtr)dlsym(handle, "rsAllocationSetSurface");
     if (RS::dispatch->AllocationSetSurface == NULL) {
         ALOGE("Couldn't initialize RS::dispatch->AllocationSetSurface");
@@ -232,6 +249,11 @@ static bool loadSymbols(void* handle) {
         ALOGE("Couldn't initialize RS::dispatch->Allocation2DData");
         return false;
     }
+    RS::dispatch->AllocationDataAsync = (AllocationDataAsyncFnPtr)dlsym(handle, "rsAllocationDataAsync");
+    if (RS::dispatch->AllocationDataAsync == NULL) {
+        ALOGE("Couldn't initialize RS::dispatch->AllocationDataAsync");
+        return false;
+    }
     RS::dispatch->Allocation3DData = (Allocation3DDataFnPtr)dlsym(handle, "rsAllocation3DData");
     if (RS::dispatch->Allocation3DData == NULL) {
         ALOGE("Couldn't initialize RS::dispatch->Allocation3DData");
@@ -561,6 +583,9 @@ void * RS::threadProc(void *vrsc) {
             usleep(1000);
             break;
         case RS_MESSAGE_TO_CLIENT_USER:
+            if (rs->runCompletion(usrID, rbuf, receiveLen)) {
+                break;
+            }
             if(rs->mMessageFunc != NULL) {
                 rs->mMessageFunc(usrID, rbuf, receiveLen);
             } else {
@@ -591,3 +616,60 @@ void RS::setMessageHandler(MessageHandlerFunc_t func) {
 void RS::finish() {
     RS::dispatch->ContextFinish(mContext);
 }
+
+void RS::beginBatch() {
+    if (mBatchDepth++ == 0) {
+        tryDispatch(this, RS::dispatch->ContextSetBatching(mContext, 1));
+    }
+}
+
+void RS::endBatch() {
+    if (mBatchDepth == 0) {
+        throwError(RS_ERROR_INVALID_PARAMETER, "endBatch() without beginBatch()");
+        return;
+    }
+    if (--mBatchDepth == 0) {
+        tryDispatch(this, RS::dispatch->ContextSetBatching(mContext, 0));
+    }
+}
+
+void RS::finishAsync(CompletionFunc_t func, void *userData) {
+    Completion c;
+    c.func = func;
+    c.userData = userData;
+
+    pthread_mutex_lock(&mCompletionLock);
+    c.token = mNextCompletionToken++;
+    mCompletions.push_back(c);
+    pthread_mutex_unlock(&mCompletionLock);
+
+    // The message is played in order after the commands already sent, and
+    // comes back to the message thread once they are done.
+    tryDispatch(this, RS::dispatch->ContextSendMessage(mContext, COMPLETION_MESSAGE_ID,
+                                                       (const uint8_t *)&c.token, sizeof(c.token)));
+}
+
+bool RS::runCompletion(uint32_t usrID, const void *data, size_t len) {
+    if (usrID != COMPLETION_MESSAGE_ID || len != sizeof(uint32_t)) {
+        return false;
+    }
+    const uint32_t token = *(const uint32_t *)data;
+
+    Completion c;
+    bool found = false;
+    pthread_mutex_lock(&mCompletionLock);
+    for (size_t i = 0; i < mCompletions.size(); i++) {
+        if (mCompletions[i].token == token) {
+            c = mCompletions[i];
+            mCompletions.erase(mCompletions.begin() + i);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mCompletionLock);
+
+    if (found) {
+        c.func(c.userData);
+    }
+    return found;
+}
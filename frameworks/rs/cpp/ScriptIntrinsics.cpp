@@ -569,6 +569,36 @@ ScriptIntrinsicLUT::~ScriptIntrinsicLUT() {
 
 }
 
+sp<ScriptIntrinsicResize> ScriptIntrinsicResize::create(sp<RS> rs, sp<const Element> e) {
+    if ((e->isCompatible(Element::U8_4(rs)) == false) &&
+        (e->isCompatible(Element::U8(rs)) == false)) {
+        rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in resize");
+        return NULL;
+    }
+    return new ScriptIntrinsicResize(rs, e);
+}
+
+ScriptIntrinsicResize::ScriptIntrinsicResize(sp<RS> rs, sp<const Element> e)
+    : ScriptIntrinsic(rs, RS_SCRIPT_INTRINSIC_ID_RESIZE, e) {
+
+}
+
+void ScriptIntrinsicResize::setInput(sp<Allocation> in) {
+    if (in->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in resize input");
+        return;
+    }
+    Script::setVar(0, in);
+}
+
+void ScriptIntrinsicResize::forEach_bicubic(sp<Allocation> out) {
+    if (out->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in resize output");
+        return;
+    }
+    Script::forEach(0, NULL, out, NULL, 0);
+}
+
 sp<ScriptIntrinsicYuvToRGB> ScriptIntrinsicYuvToRGB::create(sp<RS> rs, sp<const Element> e) {
     if (!(e->isCompatible(Element::U8_4(rs)))) {
         rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for YuvToRGB");
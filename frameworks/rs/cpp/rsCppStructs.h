@@ -35,6 +35,7 @@ namespace RSC {
 
 typedef void (*ErrorHandlerFunc_t)(uint32_t errorNum, const char *errorText);
 typedef void (*MessageHandlerFunc_t)(uint32_t msgNum, const void *msgData, size_t msgLen);
+typedef void (*CompletionFunc_t)(void *userData);
 
 class RS;
 class BaseObj;
@@ -138,6 +139,29 @@ class Sampler;
      */
     void finish();
 
+    /**
+     * Starts batching commands. Until the matching endBatch(), commands are
+     * queued without waking the RenderScript thread, so that a sequence of
+     * small kernel launches and copies is played back in one go. Calls that
+     * return data from RenderScript still flush the batch. Batches may nest.
+     */
+    void beginBatch();
+
+    /**
+     * Ends batching started by beginBatch(), and sends the queued commands
+     * once the outermost batch ends.
+     */
+    void endBatch();
+
+    /**
+     * Calls func on the message thread once all the commands sent so far
+     * have completed. Unlike finish(), this does not block the caller.
+     *
+     * @param[in] func function to call
+     * @param[in] userData argument passed to func
+     */
+    void finishAsync(CompletionFunc_t func, void *userData);
+
     RsContext getContext() { return mContext; }
     void throwError(RSError error, const char *errMsg);
 
@@ -165,6 +189,19 @@ class Sampler;
     MessageHandlerFunc_t mMessageFunc;
     bool mInit;
 
+    // Callbacks of finishAsync(), waiting for their completion message.
+    struct Completion {
+        uint32_t token;
+        CompletionFunc_t func;
+        void *userData;
+    };
+    bool runCompletion(uint32_t usrID, const void *data, size_t len);
+
+    pthread_mutex_t mCompletionLock;
+    std::vector<Completion> mCompletions;
+    uint32_t mNextCompletionToken;
+    uint32_t mBatchDepth;
+
     struct {
         sp<const Element> U8;
         sp<const Element> U8_2;
@@ -321,6 +358,7 @@ protected:
     virtual void updateFromNative();
 
     void validate2DRange(uint32_t xoff, uint32_t yoff, uint32_t w, uint32_t h);
+    bool isBackingStore(const void *data, uint32_t xoff, uint32_t yoff, size_t stride);
     void validate3DRange(uint32_t xoff, uint32_t yoff, uint32_t zoff,
                          uint32_t w, uint32_t h, uint32_t d);
 
@@ -463,6 +501,44 @@ public:
      */
     void copy2DStridedTo(void *data, size_t stride);
 
+    /**
+     * Get a pointer to the backing store of the selected LOD, face and Z
+     * slice of an Allocation with USAGE_SHARED. Writes through the pointer
+     * are seen by scripts without a copy. Call RS::finish() first if
+     * commands that change the Allocation may still be queued.
+     * @param[out] stride optional, receives the stride of a row in bytes
+     * @return pointer to the data, or NULL on error
+     */
+    void * getPointer(size_t *stride = NULL);
+
+    /**
+     * Copy an array into part of this Allocation without waiting for the
+     * copy to be done. data must stay valid until func is called on the
+     * message thread.
+     * @param[in] off offset of first Element to be overwritten
+     * @param[in] count number of Elements to copy
+     * @param[in] data array from which to copy
+     * @param[in] func function called once the copy is done
+     * @param[in] userData argument passed to func
+     */
+    void copy1DRangeFromAsync(uint32_t off, size_t count, const void *data,
+                              CompletionFunc_t func, void *userData);
+
+    /**
+     * Copy from an array into a rectangular region in this Allocation without
+     * waiting for the copy to be done. The array is assumed to be tightly
+     * packed, and must stay valid until func is called on the message thread.
+     * @param[in] xoff X offset of region to update in this Allocation
+     * @param[in] yoff Y offset of region to update in this Allocation
+     * @param[in] w Width of region to update
+     * @param[in] h Height of region to update
+     * @param[in] data Array from which to copy
+     * @param[in] func function called once the copy is done
+     * @param[in] userData argument passed to func
+     */
+    void copy2DRangeFromAsync(uint32_t xoff, uint32_t yoff, uint32_t w, uint32_t h,
+                              const void *data, CompletionFunc_t func, void *userData);
+
 
     /**
      * Copy from an array into a 3D region in this Allocation. The
@@ -1817,6 +1893,35 @@ class ScriptIntrinsicLUT : public ScriptIntrinsic {
     virtual ~ScriptIntrinsicLUT();
 };
 
+/**
+ * Intrinsic for resizing an image with bicubic interpolation. The
+ * input is sampled at the center of each output element, so that
+ * resizing to the same size copies the input.
+ */
+class ScriptIntrinsicResize : public ScriptIntrinsic {
+ private:
+    ScriptIntrinsicResize(sp<RS> rs, sp<const Element> e);
+ public:
+    /**
+     * Supported Element types are U8 and U8_4.
+     * @param[in] rs RenderScript context
+     * @param[in] e Element
+     * @return new ScriptIntrinsicResize
+     */
+    static sp<ScriptIntrinsicResize> create(sp<RS> rs, sp<const Element> e);
+    /**
+     * Sets the input of the resize. The input may have any size.
+     * @param[in] in input Allocation
+     */
+    void setInput(sp<Allocation> in);
+    /**
+     * Resizes the input to the size of the output with Catmull-Rom
+     * bicubic interpolation.
+     * @param[in] out output Allocation
+     */
+    void forEach_bicubic(sp<Allocation> out);
+};
+
 /**
  * Intrinsic for converting an Android YUV buffer to RGB.
  *
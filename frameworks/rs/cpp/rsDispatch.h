@@ -35,11 +35,13 @@ typedef RsMessageToClientType (*ContextPeekMessageFnPtr) (RsContext, size_t*, si
 typedef void (*ContextSendMessageFnPtr) (RsContext, uint32_t, const uint8_t*, size_t);
 typedef void (*ContextInitToClientFnPtr) (RsContext);
 typedef void (*ContextDeinitToClientFnPtr) (RsContext);
+typedef void (*ContextSetBatchingFnPtr) (RsContext, uint32_t);
 typedef RsType (*TypeCreateFnPtr) (RsContext, RsElement, uint32_t, uint32_t, uint32_t, bool, bool, uint32_t);
 typedef RsAllocation (*AllocationCreateTypedFnPtr) (RsContext, RsType, RsAllocationMipmapControl, uint32_t, uintptr_t);
 typedef RsAllocation (*AllocationCreateFromBitmapFnPtr) (RsContext, RsType, RsAllocationMipmapControl, const void*, size_t, uint32_t);
 typedef RsAllocation (*AllocationCubeCreateFromBitmapFnPtr) (RsContext, RsType, RsAllocationMipmapControl, const void*, size_t, uint32_t);
 typedef RsNativeWindow (*AllocationGetSurfaceFnPtr) (RsContext, RsAllocation);
+typedef void* (*AllocationGetPointerFnPtr) (RsContext, RsAllocation, uint32_t, RsAllocationCubemapFace, uint32_t, size_t*, size_t);
 typedef void (*AllocationSetSurfaceFnPtr) (RsContext, RsAllocation, RsNativeWindow);
 typedef void (*ContextFinishFnPtr) (RsContext);
 typedef void (*ContextDumpFnPtr) (RsContext, int32_t);
@@ -52,6 +54,7 @@ typedef void (*AllocationCopyToBitmapFnPtr) (RsContext, RsAllocation, void*, siz
 typedef void (*Allocation1DDataFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, const void*, size_t);
 typedef void (*Allocation1DElementDataFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, const void*, size_t, size_t);
 typedef void (*Allocation2DDataFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, RsAllocationCubemapFace, uint32_t, uint32_t, const void*, size_t, size_t);
+typedef void (*AllocationDataAsyncFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, RsAllocationCubemapFace, uint32_t, uint32_t, uintptr_t, size_t, size_t);
 typedef void (*Allocation3DDataFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, const void*, size_t, size_t);
 typedef void (*AllocationGenerateMipmapsFnPtr) (RsContext, RsAllocation);
 typedef void (*AllocationReadFnPtr) (RsContext, RsAllocation, void*, size_t);
@@ -106,11 +109,13 @@ typedef struct {
     ContextSendMessageFnPtr ContextSendMessage;
     ContextInitToClientFnPtr ContextInitToClient;
     ContextDeinitToClientFnPtr ContextDeinitToClient;
+    ContextSetBatchingFnPtr ContextSetBatching;
     TypeCreateFnPtr TypeCreate;
     AllocationCreateTypedFnPtr AllocationCreateTyped;
     AllocationCreateFromBitmapFnPtr AllocationCreateFromBitmap;
     AllocationCubeCreateFromBitmapFnPtr AllocationCubeCreateFromBitmap;
     AllocationGetSurfaceFnPtr AllocationGetSurface;
+    AllocationGetPointerFnPtr AllocationGetPointer;
     AllocationSetSurfaceFnPtr AllocationSetSurface;
     ContextFinishFnPtr ContextFinish;
     ContextDumpFnPtr ContextDump;
@@ -123,6 +128,7 @@ typedef struct {
     Allocation1DDataFnPtr Allocation1DData;
     Allocation1DElementDataFnPtr Allocation1DElementData;
     Allocation2DDataFnPtr Allocation2DData;
+    AllocationDataAsyncFnPtr AllocationDataAsync;
     Allocation3DDataFnPtr Allocation3DData;
     AllocationGenerateMipmapsFnPtr AllocationGenerateMipmaps;
     AllocationReadFnPtr AllocationRead;
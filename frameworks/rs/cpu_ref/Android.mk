@@ -29,6 +29,7 @@ LOCAL_SRC_FILES:= \
 	rsCpuIntrinsicConvolve5x5.cpp \
 	rsCpuIntrinsicHistogram.cpp \
 	rsCpuIntrinsicLUT.cpp \
+	rsCpuIntrinsicResize.cpp \
 	rsCpuIntrinsicYuvToRGB.cpp
 
 ifeq ($(ARCH_ARM_HAVE_NEON),true)
@@ -53,6 +53,10 @@ typedef void (*outer_foreach_t)(
     uint32_t instep, uint32_t outstep);
 
 
+// The largest number of slices of a launch, so that a range of slices fits
+// in the 16 bit halves of an int32_t.
+static const uint32_t MAX_SLICES = 0xffff;
+
 static pthread_key_t gThreadTLSKey = 0;
 static uint32_t gThreadTLSKeyCount = 0;
 static pthread_mutex_t gInitMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -161,22 +165,29 @@ void * RsdCpuReferenceImpl::helperThreadProc(void *vrsc) {
 }
 
 void RsdCpuReferenceImpl::launchThreads(WorkerCallback_t cbk, void *data) {
-    mWorkers.mLaunchData = data;
-    mWorkers.mLaunchCallback = cbk;
-
     // fast path for very small launches
     MTLaunchStruct *mtls = (MTLaunchStruct *)data;
     if (mtls && mtls->fep.dimY <= 1 && mtls->xEnd <= mtls->xStart + mtls->mSliceSize) {
-        if (mWorkers.mLaunchCallback) {
-            mWorkers.mLaunchCallback(mWorkers.mLaunchData, 0);
+        if (cbk) {
+            cbk(data, 0);
         }
         return;
     }
 
-    mWorkers.mRunningCount = mWorkers.mCount;
+    launchWorkers(cbk, data, mWorkers.mCount);
+}
+
+// Runs cbk on the calling thread and on the first helperCount helper threads,
+// and waits for all of them to return.
+void RsdCpuReferenceImpl::launchWorkers(WorkerCallback_t cbk, void *data,
+                                        uint32_t helperCount) {
+    mWorkers.mLaunchData = data;
+    mWorkers.mLaunchCallback = cbk;
+
+    mWorkers.mRunningCount = helperCount;
     __sync_synchronize();
 
-    for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
+    for (uint32_t ct = 0; ct < helperCount; ct++) {
         mWorkers.mLaunchSignals[ct].set();
     }
 
@@ -279,6 +290,7 @@ bool RsdCpuReferenceImpl::init(uint32_t version_major, uint32_t version_minor,
     mWorkers.mNativeThreadId = (pid_t *) calloc(mWorkers.mCount, sizeof(pid_t));
     mWorkers.mLaunchSignals = new Signal[mWorkers.mCount];
     mWorkers.mLaunchCallback = NULL;
+    mWorkers.mSliceRanges = new int32_t[mWorkers.mCount + 1];
 
     mWorkers.mCompleteSignal.init();
 
@@ -330,6 +342,7 @@ RsdCpuReferenceImpl::~RsdCpuReferenceImpl() {
         pthread_join(mWorkers.mThreadId[ct], &res);
     }
     rsAssert(__sync_fetch_and_or(&mWorkers.mRunningCount, 0) == 0);
+    delete[] mWorkers.mSliceRanges;
 
     // Global structure cleanup.
     lockMutex();
@@ -343,6 +356,72 @@ RsdCpuReferenceImpl::~RsdCpuReferenceImpl() {
 
 typedef void (*rs_t)(const void *, void *, const void *, uint32_t, uint32_t, uint32_t, uint32_t);
 
+static inline int32_t packSliceRange(uint32_t begin, uint32_t end) {
+    return (int32_t)((begin << 16) | end);
+}
+
+static inline uint32_t sliceRangeSize(int32_t range) {
+    uint32_t begin = (uint32_t)range >> 16;
+    uint32_t end = (uint32_t)range & 0xffff;
+    return end > begin ? end - begin : 0;
+}
+
+// Takes the next slice for worker idx.  Each worker runs the slices of its
+// own range from the front, and once it is empty steals the back half of the
+// largest range left, so that the workers stay busy until the very end even
+// when the rows don't all take the same time.  The ranges only ever hold the
+// slices not taken yet, which is why comparing and swapping the values is
+// enough.  Returns false once there is nothing left to take.
+static bool takeSlice(MTLaunchStruct *mtls, uint32_t idx, uint32_t *outSlice) {
+    volatile int32_t *ranges = mtls->mSliceRanges;
+    volatile int32_t *own = &ranges[idx];
+
+    for (;;) {
+        int32_t range = *own;
+        if (!sliceRangeSize(range)) {
+            break;
+        }
+        uint32_t begin = (uint32_t)range >> 16;
+        if (__sync_bool_compare_and_swap(own, range,
+                packSliceRange(begin + 1, (uint32_t)range & 0xffff))) {
+            *outSlice = begin;
+            return true;
+        }
+    }
+
+    for (;;) {
+        uint32_t victim = 0;
+        uint32_t victimSize = 0;
+        int32_t victimRange = 0;
+        for (uint32_t ct = 0; ct < mtls->mSliceRangeCount; ct++) {
+            int32_t range = ranges[ct];
+            uint32_t size = sliceRangeSize(range);
+            if (size > victimSize) {
+                victim = ct;
+                victimSize = size;
+                victimRange = range;
+            }
+        }
+        if (!victimSize) {
+            return false;
+        }
+
+        uint32_t begin = (uint32_t)victimRange >> 16;
+        uint32_t end = (uint32_t)victimRange & 0xffff;
+        uint32_t mid = end - (victimSize + 1) / 2;
+        if (__sync_bool_compare_and_swap(&ranges[victim], victimRange,
+                packSliceRange(begin, mid))) {
+            // Run the first stolen slice and leave the others in our range,
+            // where they can be stolen again.  Nobody else writes to an empty
+            // range.
+            *own = packSliceRange(mid + 1, end);
+            __sync_synchronize();
+            *outSlice = mid;
+            return true;
+        }
+    }
+}
+
 static void wc_xy(void *usr, uint32_t idx) {
     MTLaunchStruct *mtls = (MTLaunchStruct *)usr;
     RsForEachStubParamStruct p;
@@ -351,14 +430,11 @@ static void wc_xy(void *usr, uint32_t idx) {
     uint32_t sig = mtls->sig;
 
     outer_foreach_t fn = (outer_foreach_t) mtls->kernel;
-    while (1) {
-        uint32_t slice = (uint32_t)__sync_fetch_and_add(&mtls->mSliceNum, 1);
+    uint32_t slice;
+    while (takeSlice(mtls, idx, &slice)) {
         uint32_t yStart = mtls->yStart + slice * mtls->mSliceSize;
         uint32_t yEnd = yStart + mtls->mSliceSize;
         yEnd = rsMin(yEnd, mtls->yEnd);
-        if (yEnd <= yStart) {
-            return;
-        }
 
         //ALOGE("usr idx %i, x %i,%i  y %i,%i", idx, mtls->xStart, mtls->xEnd, yStart, yEnd);
         //ALOGE("usr ptr in %p,  out %p", mtls->fep.ptrIn, mtls->fep.ptrOut);
@@ -381,14 +457,11 @@ static void wc_x(void *usr, uint32_t idx) {
     uint32_t sig = mtls->sig;
 
     outer_foreach_t fn = (outer_foreach_t) mtls->kernel;
-    while (1) {
-        uint32_t slice = (uint32_t)__sync_fetch_and_add(&mtls->mSliceNum, 1);
+    uint32_t slice;
+    while (takeSlice(mtls, idx, &slice)) {
         uint32_t xStart = mtls->xStart + slice * mtls->mSliceSize;
         uint32_t xEnd = xStart + mtls->mSliceSize;
         xEnd = rsMin(xEnd, mtls->xEnd);
-        if (xEnd <= xStart) {
-            return;
-        }
 
         //ALOGE("usr slice %i idx %i, x %i,%i", slice, idx, xStart, xEnd);
         //ALOGE("usr ptr in %p,  out %p", mtls->fep.ptrIn, mtls->fep.ptrOut);
@@ -399,6 +472,32 @@ static void wc_x(void *usr, uint32_t idx) {
     }
 }
 
+// Splits the sliceCount slices of mtls evenly between as many workers as
+// there are slices, up to one per thread, so that small launches don't wake
+// threads with nothing to do, and runs cbk on them.
+void RsdCpuReferenceImpl::launchSlices(WorkerCallback_t cbk, MTLaunchStruct *mtls,
+                                       uint32_t sliceCount) {
+    if (!sliceCount) {
+        return;
+    }
+    uint32_t workerCount = rsMin(sliceCount, mWorkers.mCount + 1);
+    for (uint32_t ct = 0; ct <= mWorkers.mCount; ct++) {
+        uint32_t begin = rsMin(sliceCount, ct * sliceCount / workerCount);
+        uint32_t end = rsMin(sliceCount, (ct + 1) * sliceCount / workerCount);
+        mWorkers.mSliceRanges[ct] = packSliceRange(begin, end);
+    }
+    mtls->mSliceRanges = mWorkers.mSliceRanges;
+    mtls->mSliceRangeCount = workerCount;
+
+    if (workerCount <= 1) {
+        cbk(mtls, 0);
+    } else {
+        launchWorkers(cbk, mtls, workerCount - 1);
+    }
+    mtls->mSliceRanges = NULL;
+    mtls->mSliceRangeCount = 0;
+}
+
 void RsdCpuReferenceImpl::launchThreads(const Allocation * ain, Allocation * aout,
                                      const RsScriptCall *sc, MTLaunchStruct *mtls) {
 
@@ -408,7 +507,7 @@ void RsdCpuReferenceImpl::launchThreads(const Allocation * ain, Allocation * aou
         const size_t targetByteChunk = 16 * 1024;
         mInForEach = true;
         if (mtls->fep.dimY > 1) {
-            uint32_t s1 = mtls->fep.dimY / ((mWorkers.mCount + 1) * 4);
+            uint32_t s1 = mtls->fep.dimY / ((mWorkers.mCount + 1) * 8);
             uint32_t s2 = 0;
 
             // This chooses our slice size to rate limit atomic ops to
@@ -424,10 +523,15 @@ void RsdCpuReferenceImpl::launchThreads(const Allocation * ain, Allocation * aou
                 mtls->mSliceSize = 1;
             }
 
+            uint32_t rows = mtls->yEnd - mtls->yStart;
+            if (rows > mtls->mSliceSize * MAX_SLICES) {
+                mtls->mSliceSize = (rows + MAX_SLICES - 1) / MAX_SLICES;
+            }
+
          //   mtls->mSliceSize = 2;
-            launchThreads(wc_xy, mtls);
+            launchSlices(wc_xy, mtls, (rows + mtls->mSliceSize - 1) / mtls->mSliceSize);
         } else {
-            uint32_t s1 = mtls->fep.dimX / ((mWorkers.mCount + 1) * 4);
+            uint32_t s1 = mtls->fep.dimX / ((mWorkers.mCount + 1) * 8);
             uint32_t s2 = 0;
 
             // This chooses our slice size to rate limit atomic ops to
@@ -443,7 +547,12 @@ void RsdCpuReferenceImpl::launchThreads(const Allocation * ain, Allocation * aou
                 mtls->mSliceSize = 1;
             }
 
-            launchThreads(wc_x, mtls);
+            uint32_t columns = mtls->xEnd - mtls->xStart;
+            if (columns > mtls->mSliceSize * MAX_SLICES) {
+                mtls->mSliceSize = (columns + MAX_SLICES - 1) / MAX_SLICES;
+            }
+
+            launchSlices(wc_x, mtls, (columns + mtls->mSliceSize - 1) / mtls->mSliceSize);
         }
         mInForEach = false;
 
@@ -522,6 +631,8 @@ extern RsdCpuScriptImpl * rsdIntrinsic_Blend(RsdCpuReferenceImpl *ctx,
                                              const Script *s, const Element *e);
 extern RsdCpuScriptImpl * rsdIntrinsic_Histogram(RsdCpuReferenceImpl *ctx,
                                                  const Script *s, const Element *e);
+extern RsdCpuScriptImpl * rsdIntrinsic_Resize(RsdCpuReferenceImpl *ctx,
+                                              const Script *s, const Element *e);
 
 RsdCpuReference::CpuScript * RsdCpuReferenceImpl::createIntrinsic(const Script *s,
                                     RsScriptIntrinsicID iid, Element *e) {
@@ -555,6 +666,9 @@ RsdCpuReference::CpuScript * RsdCpuReferenceImpl::createIntrinsic(const Script *
     case RS_SCRIPT_INTRINSIC_ID_HISTOGRAM:
         i = rsdIntrinsic_Histogram(this, s, e);
         break;
+    case RS_SCRIPT_INTRINSIC_ID_RESIZE:
+        i = rsdIntrinsic_Resize(this, s, e);
+        break;
 
     default:
         rsAssert(0);
@@ -59,7 +59,10 @@ typedef struct {
     Allocation * aout;
 
     uint32_t mSliceSize;
-    volatile int mSliceNum;
+    // The slices not taken yet, one range per worker packed as
+    // (begin << 16) | end, see takeSlice() in rsCpuCore.cpp.
+    volatile int32_t *mSliceRanges;
+    uint32_t mSliceRangeCount;
     bool isThreadable;
 
     uint32_t xStart;
@@ -86,6 +89,8 @@ public:
     bool init(uint32_t version_major, uint32_t version_minor, sym_lookup_t, script_lookup_t);
     virtual void setPriority(int32_t priority);
     virtual void launchThreads(WorkerCallback_t cbk, void *data);
+    void launchWorkers(WorkerCallback_t cbk, void *data, uint32_t helperCount);
+    void launchSlices(WorkerCallback_t cbk, MTLaunchStruct *mtls, uint32_t sliceCount);
     static void * helperThreadProc(void *vrsc);
     RsdCpuScriptImpl * setTLS(RsdCpuScriptImpl *sc);
 
@@ -154,6 +159,7 @@ protected:
         Signal *mLaunchSignals;
         WorkerCallback_t mLaunchCallback;
         void *mLaunchData;
+        int32_t *mSliceRanges;
     };
     Workers mWorkers;
     bool mExit;
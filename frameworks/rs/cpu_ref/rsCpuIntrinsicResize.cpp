@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "rsCpuIntrinsic.h"
+#include "rsCpuIntrinsicInlines.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+namespace android {
+namespace renderscript {
+
+
+class RsdCpuScriptIntrinsicResize : public RsdCpuScriptIntrinsic {
+public:
+    virtual void populateScript(Script *);
+    virtual void invokeFreeChildren();
+
+    virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
+
+    virtual void preLaunch(uint32_t slot, const Allocation * ain,
+                           Allocation * aout, const void * usr,
+                           uint32_t usrLen, const RsScriptCall *sc);
+
+    virtual ~RsdCpuScriptIntrinsicResize();
+    RsdCpuScriptIntrinsicResize(RsdCpuReferenceImpl *ctx, const Script *s, const Element *e);
+
+protected:
+    ObjectBaseRef<Allocation> mAlloc;
+    float mScaleX;
+    float mScaleY;
+
+    static void kernelU4(const RsForEachStubParamStruct *p,
+                         uint32_t xstart, uint32_t xend,
+                         uint32_t instep, uint32_t outstep);
+    static void kernelU1(const RsForEachStubParamStruct *p,
+                         uint32_t xstart, uint32_t xend,
+                         uint32_t instep, uint32_t outstep);
+};
+
+}
+}
+
+
+void RsdCpuScriptIntrinsicResize::setGlobalObj(uint32_t slot, ObjectBase *data) {
+    rsAssert(slot == 0);
+    mAlloc.set(static_cast<Allocation *>(data));
+}
+
+// Catmull-Rom interpolation between p1 and p2, x is between 0 and 1.  It
+// returns p1 exactly for x = 0, so a resize to the same size is a copy.
+static inline float4 cubicInterpolate(float4 p0, float4 p1, float4 p2, float4 p3, float x) {
+    return p1 + 0.5f * x * (p2 - p0 + x * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3
+            + x * (3.f * (p1 - p2) + p3 - p0)));
+}
+
+static inline float cubicInterpolate(float p0, float p1, float p2, float p3, float x) {
+    return p1 + 0.5f * x * (p2 - p0 + x * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3
+            + x * (3.f * (p1 - p2) + p3 - p0)));
+}
+
+// Maps the center of the output pixel i to the input, and returns the
+// index of the input pixel at or left of it, and the distance to it.
+static inline int32_t sourceCoord(uint32_t i, float scale, float *outFrac) {
+    float s = ((float)i + 0.5f) * scale - 0.5f;
+    int32_t start = (int32_t)floorf(s);
+    *outFrac = s - start;
+    return start;
+}
+
+void RsdCpuScriptIntrinsicResize::kernelU4(const RsForEachStubParamStruct *p,
+                                           uint32_t xstart, uint32_t xend,
+                                           uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicResize *cp = (RsdCpuScriptIntrinsicResize *)p->usr;
+    if (!cp->mAlloc.get()) {
+        ALOGE("Resize executed without input, skipping");
+        return;
+    }
+    const uchar *pin = (const uchar *)cp->mAlloc->mHal.drvState.lod[0].mallocPtr;
+    const int srcWidth = cp->mAlloc->mHal.drvState.lod[0].dimX;
+    const int srcHeight = rsMax((uint32_t)1, cp->mAlloc->mHal.drvState.lod[0].dimY);
+    const size_t stride = cp->mAlloc->mHal.drvState.lod[0].stride;
+
+    // The four input rows around the output row are the same for all of it.
+    float yf;
+    int32_t starty = sourceCoord(p->y, cp->mScaleY, &yf);
+    const uchar4 *rows[4];
+    for (int32_t i = 0; i < 4; i++) {
+        rows[i] = (const uchar4 *)(pin + clamp(starty + i - 1, 0, srcHeight - 1) * stride);
+    }
+
+    uchar4 *out = (uchar4 *)p->out;
+    for (uint32_t x = xstart; x < xend; x++) {
+        float xf;
+        int32_t startx = sourceCoord(x, cp->mScaleX, &xf);
+        int32_t xs[4];
+        for (int32_t i = 0; i < 4; i++) {
+            xs[i] = clamp(startx + i - 1, 0, srcWidth - 1);
+        }
+
+        float4 r[4];
+        for (int32_t i = 0; i < 4; i++) {
+            const uchar4 *row = rows[i];
+            r[i] = cubicInterpolate(convert_float4(row[xs[0]]), convert_float4(row[xs[1]]),
+                                    convert_float4(row[xs[2]]), convert_float4(row[xs[3]]),
+                                    xf);
+        }
+        float4 v = cubicInterpolate(r[0], r[1], r[2], r[3], yf);
+        *out = convert_uchar4(clamp(v + 0.5f, 0.f, 255.f));
+        out++;
+    }
+}
+
+void RsdCpuScriptIntrinsicResize::kernelU1(const RsForEachStubParamStruct *p,
+                                           uint32_t xstart, uint32_t xend,
+                                           uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicResize *cp = (RsdCpuScriptIntrinsicResize *)p->usr;
+    if (!cp->mAlloc.get()) {
+        ALOGE("Resize executed without input, skipping");
+        return;
+    }
+    const uchar *pin = (const uchar *)cp->mAlloc->mHal.drvState.lod[0].mallocPtr;
+    const int srcWidth = cp->mAlloc->mHal.drvState.lod[0].dimX;
+    const int srcHeight = rsMax((uint32_t)1, cp->mAlloc->mHal.drvState.lod[0].dimY);
+    const size_t stride = cp->mAlloc->mHal.drvState.lod[0].stride;
+
+    float yf;
+    int32_t starty = sourceCoord(p->y, cp->mScaleY, &yf);
+    const uchar *rows[4];
+    for (int32_t i = 0; i < 4; i++) {
+        rows[i] = pin + clamp(starty + i - 1, 0, srcHeight - 1) * stride;
+    }
+
+    uchar *out = (uchar *)p->out;
+    for (uint32_t x = xstart; x < xend; x++) {
+        float xf;
+        int32_t startx = sourceCoord(x, cp->mScaleX, &xf);
+        int32_t xs[4];
+        for (int32_t i = 0; i < 4; i++) {
+            xs[i] = clamp(startx + i - 1, 0, srcWidth - 1);
+        }
+
+        float r[4];
+        for (int32_t i = 0; i < 4; i++) {
+            const uchar *row = rows[i];
+            r[i] = cubicInterpolate((float)row[xs[0]], (float)row[xs[1]],
+                                    (float)row[xs[2]], (float)row[xs[3]], xf);
+        }
+        float v = cubicInterpolate(r[0], r[1], r[2], r[3], yf);
+        *out = (uchar)clamp(v + 0.5f, 0.f, 255.f);
+        out++;
+    }
+}
+
+void RsdCpuScriptIntrinsicResize::preLaunch(uint32_t slot, const Allocation * ain,
+                                            Allocation * aout, const void * usr,
+                                            uint32_t usrLen, const RsScriptCall *sc) {
+    mRootPtr = NULL;
+    if (!mAlloc.get()) {
+        ALOGE("Resize executed without input, skipping");
+        return;
+    }
+
+    const Element *e = mAlloc->getType()->getElement();
+    if (e->getType() == RS_TYPE_UNSIGNED_8) {
+        switch (e->getVectorSize()) {
+        case 1:
+            mRootPtr = &kernelU1;
+            break;
+        case 4:
+            mRootPtr = &kernelU4;
+            break;
+        }
+    }
+    rsAssert(mRootPtr);
+
+    const uint32_t srcHeight = rsMax((uint32_t)1, mAlloc->mHal.drvState.lod[0].dimY);
+    const uint32_t dstHeight = rsMax((uint32_t)1, aout->mHal.drvState.lod[0].dimY);
+    mScaleX = (float)mAlloc->mHal.drvState.lod[0].dimX / aout->mHal.drvState.lod[0].dimX;
+    mScaleY = (float)srcHeight / dstHeight;
+}
+
+RsdCpuScriptIntrinsicResize::RsdCpuScriptIntrinsicResize(RsdCpuReferenceImpl *ctx,
+                                                         const Script *s, const Element *e)
+            : RsdCpuScriptIntrinsic(ctx, s, e, RS_SCRIPT_INTRINSIC_ID_RESIZE) {
+
+    mRootPtr = NULL;
+    mScaleX = 1.f;
+    mScaleY = 1.f;
+}
+
+RsdCpuScriptIntrinsicResize::~RsdCpuScriptIntrinsicResize() {
+}
+
+void RsdCpuScriptIntrinsicResize::populateScript(Script *s) {
+    s->mHal.info.exportedVariableCount = 1;
+}
+
+void RsdCpuScriptIntrinsicResize::invokeFreeChildren() {
+    mAlloc.clear();
+}
+
+
+RsdCpuScriptImpl * rsdIntrinsic_Resize(RsdCpuReferenceImpl *ctx, const Script *s,
+                                       const Element *e) {
+
+    return new RsdCpuScriptIntrinsicResize(ctx, s, e);
+}
@@ -210,6 +210,10 @@ static bool is_force_recompile() {
 #endif  // RS_SERVER
 }
 
+// Compiled scripts that ship with the system, shared by all applications.
+// bcc only loads them if they were built from the same bitcode and libraries.
+const static char *SYSTEM_SCRIPT_CACHE_DIR = "/system/lib/rscache";
+
 //#define EXTERNAL_BCC_COMPILER 1
 #ifdef EXTERNAL_BCC_COMPILER
 const static char *BCC_EXE_PATH = "/system/bin/bcc";
@@ -362,6 +366,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
 
 #ifndef RS_COMPATIBILITY_LIB
     bcc::RSExecutable *exec = NULL;
+    bool fromSystemCache = false;
 
     mCompilerContext = NULL;
     mCompilerDriver = NULL;
@@ -396,6 +401,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     bcinfo::MetadataExtractor ME((const char *) bitcode, bitcodeSize);
     if (!ME.extract()) {
         ALOGE("Could not extract metadata from bitcode");
+        mCtx->unlockMutex();
         return false;
     }
 
@@ -413,6 +419,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
         break;
     default:
         ALOGE("Unknown precision for bitcode");
+        mCtx->unlockMutex();
         return false;
     }
 
@@ -432,15 +439,29 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
         mCompilerDriver->setDebugContext(true);
         // Skip the cache lookup
     } else if (!is_force_recompile()) {
-        // Attempt to just load the script from cache first if we can.
-        exec = mCompilerDriver->loadScript(cacheDir, resName,
-                                           (const char *)bitcode, bitcodeSize);
+        // Attempt to just load the script from cache first if we can,
+        // starting with the scripts compiled for the whole system.
+        if (access(SYSTEM_SCRIPT_CACHE_DIR, R_OK | X_OK) == 0) {
+            exec = mCompilerDriver->loadScript(SYSTEM_SCRIPT_CACHE_DIR, resName,
+                                               (const char *)bitcode,
+                                               bitcodeSize);
+            fromSystemCache = (exec != NULL);
+        }
+        if (exec == NULL) {
+            exec = mCompilerDriver->loadScript(cacheDir, resName,
+                                               (const char *)bitcode,
+                                               bitcodeSize);
+        }
     }
 
     if (exec == NULL) {
 #ifdef EXTERNAL_BCC_COMPILER
+        // The compiler runs in its own process and only touches files under
+        // cacheDir, so scripts of other contexts can be set up meanwhile.
+        mCtx->unlockMutex();
         bool built = compileBitcode(cacheDir, resName, (const char *)bitcode,
                                     bitcodeSize, core_lib);
+        mCtx->lockMutex();
 #else
         bool built = mCompilerDriver->build(*mCompilerContext, cacheDir,
                                             resName, (const char *)bitcode,
@@ -463,7 +484,8 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     mExecutable = exec;
 
     exec->setThreadable(mIsThreadable);
-    if (!exec->syncInfo()) {
+    // The system cache is read-only.
+    if (!fromSystemCache && !exec->syncInfo()) {
         ALOGW("bcc: FAILS to synchronize the RS info file to the disk");
     }
 
@@ -818,7 +840,8 @@ void RsdCpuScriptImpl::forEachMtlsSetup(const Allocation * ain, Allocation * aou
     mtls->fep.usr = usr;
     mtls->fep.usrLen = usrLen;
     mtls->mSliceSize = 1;
-    mtls->mSliceNum = 0;
+    mtls->mSliceRanges = NULL;
+    mtls->mSliceRangeCount = 0;
 
     mtls->fep.ptrIn = NULL;
     mtls->fep.eStrideIn = 0;
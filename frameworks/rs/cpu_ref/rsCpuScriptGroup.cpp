@@ -48,6 +48,30 @@ typedef void (*ScriptGroupRootFunc_t)(const RsForEachStubParamStruct *p,
                                       uint32_t xstart, uint32_t xend,
                                       uint32_t instep, uint32_t outstep);
 
+// The number of bytes of the intermediate allocations each thread writes
+// and reads back before moving on, small enough to stay in the L1 cache.
+static const uint32_t TILE_BYTES = 8 * 1024;
+
+// Returns where the tile starting at x tileStart of a kernel input or output
+// is.  The inputs and outputs of the group are read and written in place.
+// The intermediates only hold one tile per thread, in row lid, or in slot
+// lid of a 1D allocation, so they are reused for every tile the thread runs.
+static uint8_t * getTilePtr(const Allocation *a, bool ext,
+                            const RsForEachStubParamStruct *p,
+                            uint32_t tileStart, uint32_t tileSize, uint32_t step) {
+    uint8_t *ptr = (uint8_t *)a->mHal.drvState.lod[0].mallocPtr;
+    if (ext) {
+        return ptr + a->mHal.drvState.lod[0].stride * p->y + step * tileStart;
+    }
+    if (a->mHal.drvState.lod[0].dimY > p->lid) {
+        return ptr + a->mHal.drvState.lod[0].stride * p->lid;
+    }
+    if (a->mHal.drvState.lod[0].dimX >= (p->lid + 1) * tileSize) {
+        return ptr + step * tileSize * p->lid;
+    }
+    return ptr;
+}
+
 void CpuScriptGroupImpl::scriptGroupRoot(const RsForEachStubParamStruct *p,
                                          uint32_t xstart, uint32_t xend,
                                          uint32_t instep, uint32_t outstep) {
@@ -57,47 +81,43 @@ void CpuScriptGroupImpl::scriptGroupRoot(const RsForEachStubParamStruct *p,
     RsForEachStubParamStruct *mp = (RsForEachStubParamStruct *)p;
     const void *oldUsr = p->usr;
 
-    for(size_t ct=0; ct < sl->count; ct++) {
-        ScriptGroupRootFunc_t func;
-        func = (ScriptGroupRootFunc_t)sl->fnPtrs[ct];
-        mp->usr = sl->usrPtrs[ct];
-
-        mp->ptrIn = NULL;
-        mp->in = NULL;
-        mp->ptrOut = NULL;
-        mp->out = NULL;
-
-        uint32_t istep = 0;
-        uint32_t ostep = 0;
-
-        if (sl->ins[ct]) {
-            mp->ptrIn = (const uint8_t *)sl->ins[ct]->mHal.drvState.lod[0].mallocPtr;
-            istep = sl->ins[ct]->mHal.state.elementSizeBytes;
-            mp->in = mp->ptrIn;
-            if (sl->inExts[ct]) {
-                mp->in = mp->ptrIn + sl->ins[ct]->mHal.drvState.lod[0].stride * p->y;
-            } else {
-                if (sl->ins[ct]->mHal.drvState.lod[0].dimY > p->lid) {
-                    mp->in = mp->ptrIn + sl->ins[ct]->mHal.drvState.lod[0].stride * p->lid;
-                }
+    // Run the whole chain of kernels on one tile of the row at a time, so that
+    // the intermediates a kernel writes are still in the cache when the next
+    // one reads them.
+    uint32_t tileEnd;
+    for (uint32_t tileStart = xstart; tileStart < xend; tileStart = tileEnd) {
+        tileEnd = xend - tileStart > sl->tileSize ? tileStart + sl->tileSize : xend;
+
+        for(size_t ct=0; ct < sl->count; ct++) {
+            ScriptGroupRootFunc_t func;
+            func = (ScriptGroupRootFunc_t)sl->fnPtrs[ct];
+            mp->usr = sl->usrPtrs[ct];
+
+            mp->ptrIn = NULL;
+            mp->in = NULL;
+            mp->ptrOut = NULL;
+            mp->out = NULL;
+
+            uint32_t istep = 0;
+            uint32_t ostep = 0;
+
+            if (sl->ins[ct]) {
+                mp->ptrIn = (const uint8_t *)sl->ins[ct]->mHal.drvState.lod[0].mallocPtr;
+                istep = sl->ins[ct]->mHal.state.elementSizeBytes;
+                mp->in = getTilePtr(sl->ins[ct], sl->inExts[ct], p, tileStart,
+                                    sl->tileSize, istep);
             }
-        }
 
-        if (sl->outs[ct]) {
-            mp->ptrOut = (uint8_t *)sl->outs[ct]->mHal.drvState.lod[0].mallocPtr;
-            mp->out = mp->ptrOut;
-            ostep = sl->outs[ct]->mHal.state.elementSizeBytes;
-            if (sl->outExts[ct]) {
-                mp->out = mp->ptrOut + sl->outs[ct]->mHal.drvState.lod[0].stride * p->y;
-            } else {
-                if (sl->outs[ct]->mHal.drvState.lod[0].dimY > p->lid) {
-                    mp->out = mp->ptrOut + sl->outs[ct]->mHal.drvState.lod[0].stride * p->lid;
-                }
+            if (sl->outs[ct]) {
+                mp->ptrOut = (uint8_t *)sl->outs[ct]->mHal.drvState.lod[0].mallocPtr;
+                ostep = sl->outs[ct]->mHal.state.elementSizeBytes;
+                mp->out = getTilePtr(sl->outs[ct], sl->outExts[ct], p, tileStart,
+                                     sl->tileSize, ostep);
             }
-        }
 
-        //ALOGE("kernel %i %p,%p  %p,%p", ct, mp->ptrIn, mp->in, mp->ptrOut, mp->out);
-        func(p, xstart, xend, istep, ostep);
+            //ALOGE("kernel %i %p,%p  %p,%p", ct, mp->ptrIn, mp->in, mp->ptrOut, mp->out);
+            func(p, tileStart, tileEnd, istep, ostep);
+        }
     }
     //ALOGE("script group root");
 
@@ -230,6 +250,20 @@ void CpuScriptGroupImpl::execute() {
         sl.inExts = inExts.array();
         sl.outExts = outExts.array();
 
+        // The tiles are as long as the intermediates of one tile fit in
+        // TILE_BYTES, rounded to a multiple of 4 elements for the vectorized
+        // kernels.
+        uint32_t intermediateBytes = 0;
+        for (size_t ct=0; ct < kernels.size(); ct++) {
+            if (outs[ct] && !outExts[ct]) {
+                intermediateBytes += outs[ct]->mHal.state.elementSizeBytes;
+            }
+        }
+        sl.tileSize = 0xffffffff;
+        if (intermediateBytes) {
+            sl.tileSize = rsMax((uint32_t)16, (TILE_BYTES / intermediateBytes) & ~3);
+        }
+
         Script *s = kernels[0]->mScript;
         RsdCpuScriptImpl *si = (RsdCpuScriptImpl *)mCtx->lookupScript(s);
         si->forEachMtlsSetup(ins[0], outs[0], NULL, 0, NULL, &mtls);
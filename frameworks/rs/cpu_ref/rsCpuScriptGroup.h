@@ -48,6 +48,9 @@ protected:
         size_t const *usrSizes;
         uint32_t const *sigs;
         const void *const* fnPtrs;
+        // The number of elements of a row each kernel runs on before the
+        // next kernel of the chain does.
+        uint32_t tileSize;
 
         const ScriptKernelID *const* kernels;
     };
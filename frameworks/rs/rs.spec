@@ -31,6 +31,11 @@ ContextDeinitToClient {
     direct
 }
 
+ContextSetBatching {
+    direct
+    param uint32_t enable
+}
+
 TypeCreate {
     direct
     param RsElement e
@@ -76,6 +81,16 @@ AllocationGetSurface {
     ret RsNativeWindow
 }
 
+AllocationGetPointer {
+    direct
+    param RsAllocation va
+    param uint32_t lod
+    param RsAllocationCubemapFace face
+    param uint32_t z
+    param size_t *stride
+    ret void *
+}
+
 AllocationSetSurface {
     param RsAllocation alloc
     param RsNativeWindow sur
@@ -159,6 +174,19 @@ Allocation2DData {
     param size_t stride
     }
 
+AllocationDataAsync {
+    param RsAllocation va
+    param uint32_t xoff
+    param uint32_t yoff
+    param uint32_t lod
+    param RsAllocationCubemapFace face
+    param uint32_t w
+    param uint32_t h
+    param uintptr_t data
+    param size_t sizeBytes
+    param size_t stride
+    }
+
 Allocation3DData {
     param RsAllocation va
     param uint32_t xoff
@@ -562,6 +562,19 @@ void rsi_Allocation2DData(Context *rsc, RsAllocation va, uint32_t xoff, uint32_t
     a->data(rsc, xoff, yoff, lod, face, w, h, data, sizeBytes, stride);
 }
 
+// Unlike the other data commands the client does not wait for this one to be
+// played, it keeps the data valid until it is told the copy is done.
+void rsi_AllocationDataAsync(Context *rsc, RsAllocation va, uint32_t xoff, uint32_t yoff, uint32_t lod,
+                             RsAllocationCubemapFace face, uint32_t w, uint32_t h, uintptr_t data,
+                             size_t sizeBytes, size_t stride) {
+    Allocation *a = static_cast<Allocation *>(va);
+    if (a->getType()->getDimY() == 0) {
+        a->data(rsc, xoff, lod, w, (const void *)data, sizeBytes);
+    } else {
+        a->data(rsc, xoff, yoff, lod, face, w, h, (const void *)data, sizeBytes, stride);
+    }
+}
+
 void rsi_Allocation3DData(Context *rsc, RsAllocation va, uint32_t xoff, uint32_t yoff, uint32_t zoff, uint32_t lod,
                           uint32_t w, uint32_t h, uint32_t d, const void *data, size_t sizeBytes, size_t stride) {
     Allocation *a = static_cast<Allocation *>(va);
@@ -701,6 +714,32 @@ void * rsi_AllocationGetSurface(Context *rsc, RsAllocation valloc) {
     return s;
 }
 
+void * rsi_AllocationGetPointer(Context *rsc, RsAllocation valloc, uint32_t lod,
+                                RsAllocationCubemapFace face, uint32_t z,
+                                size_t *stride, size_t strideLen) {
+    Allocation *alloc = static_cast<Allocation *>(valloc);
+    // Only shared allocations keep the client visible copy in their backing
+    // store, for the others the driver may hold the data elsewhere.
+    if (!(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_SHARED)) {
+        rsc->setError(RS_ERROR_BAD_VALUE, "Allocation is not USAGE_SHARED");
+        return NULL;
+    }
+    if (lod >= alloc->mHal.drvState.lodCount) {
+        rsc->setError(RS_ERROR_BAD_VALUE, "LOD out of range");
+        return NULL;
+    }
+
+    const Allocation::Hal::DrvState::LodState &l = alloc->mHal.drvState.lod[lod];
+    uint8_t *p = (uint8_t *)l.mallocPtr;
+    p += face * alloc->mHal.drvState.faceOffset;
+    p += z * rsMax(l.dimY, 1u) * l.stride;
+
+    if (strideLen >= sizeof(size_t)) {
+        *stride = l.stride;
+    }
+    return p;
+}
+
 void rsi_AllocationSetSurface(Context *rsc, RsAllocation valloc, RsNativeWindow sur) {
     Allocation *alloc = static_cast<Allocation *>(valloc);
     alloc->setSurface(rsc, sur);
@@ -900,6 +900,10 @@ void rsi_ContextDeinitToClient(Context *rsc) {
     rsc->deinitToClient();
 }
 
+void rsi_ContextSetBatching(Context *rsc, uint32_t enable) {
+    rsc->mIO.setBatching(enable != 0);
+}
+
 void rsi_ContextSendMessage(Context *rsc, uint32_t id, const uint8_t *data, size_t len) {
     rsc->sendMessageToClient(data, RS_MESSAGE_TO_CLIENT_USER, id, len, true);
 }
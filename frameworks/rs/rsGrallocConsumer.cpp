@@ -35,7 +35,9 @@ GrallocConsumer::GrallocConsumer(Allocation *a, const sp<IGraphicBufferConsumer>
 {
     mAlloc = a;
     mConsumer->setConsumerUsageBits(GRALLOC_USAGE_SW_READ_OFTEN);
-    mConsumer->setMaxAcquiredBufferCount(2);
+    // One buffer is in use by the scripts, one is being locked in its place
+    // and one more is needed to look for a later frame.
+    mConsumer->setMaxAcquiredBufferCount(3);
 
     uint32_t y = a->mHal.drvState.lod[0].dimY;
     if (y < 1) y = 1;
@@ -57,13 +59,8 @@ status_t GrallocConsumer::lockNextBuffer() {
     Mutex::Autolock _l(mMutex);
     status_t err;
 
-    if (mAcquiredBuffer.mSlot != BufferQueue::INVALID_BUFFER_SLOT) {
-        err = releaseAcquiredBufferLocked();
-        if (err) {
-            return err;
-        }
-    }
-
+    // The buffer in use stays locked until the next one is, so that the
+    // allocation keeps pointing at valid memory when there is no new frame.
     BufferQueue::BufferItem b;
 
     err = acquireBufferLocked(&b, 0);
@@ -76,6 +73,15 @@ status_t GrallocConsumer::lockNextBuffer() {
         }
     }
 
+    // Skip to the latest frame.  A script slower than the producer would
+    // otherwise fall further behind with every frame.
+    BufferQueue::BufferItem next;
+    while (acquireBufferLocked(&next, 0) == OK) {
+        releaseBufferLocked(b.mBuf, mSlots[b.mBuf].mGraphicBuffer,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR);
+        b = next;
+    }
+
     int buf = b.mBuf;
 
     if (b.mFence.get()) {
@@ -83,6 +89,8 @@ status_t GrallocConsumer::lockNextBuffer() {
         if (err != OK) {
             ALOGE("Failed to wait for fence of acquired buffer: %s (%d)",
                     strerror(-err), err);
+            releaseBufferLocked(buf, mSlots[buf].mGraphicBuffer,
+                    EGL_NO_DISPLAY, EGL_NO_SYNC_KHR);
             return err;
         }
     }
@@ -100,6 +108,8 @@ status_t GrallocConsumer::lockNextBuffer() {
         if (err != OK) {
             ALOGE("Unable to lock YCbCr buffer for CPU reading: %s (%d)",
                     strerror(-err), err);
+            releaseBufferLocked(buf, mSlots[buf].mGraphicBuffer,
+                    EGL_NO_DISPLAY, EGL_NO_SYNC_KHR);
             return err;
         }
         bufferPointer = ycbcr.y;
@@ -112,10 +122,18 @@ status_t GrallocConsumer::lockNextBuffer() {
         if (err != OK) {
             ALOGE("Unable to lock buffer for CPU reading: %s (%d)",
                     strerror(-err), err);
+            releaseBufferLocked(buf, mSlots[buf].mGraphicBuffer,
+                    EGL_NO_DISPLAY, EGL_NO_SYNC_KHR);
             return err;
         }
     }
 
+    if (mAcquiredBuffer.mSlot != BufferQueue::INVALID_BUFFER_SLOT) {
+        // the new buffer is locked already, an error unlocking the old one
+        // is only logged
+        releaseAcquiredBufferLocked();
+    }
+
     size_t lockedIdx = 0;
     assert(mAcquiredBuffer.mSlot == BufferQueue::INVALID_BUFFER_SLOT);
 
@@ -164,10 +182,11 @@ status_t GrallocConsumer::unlockBuffer() {
 status_t GrallocConsumer::releaseAcquiredBufferLocked() {
     status_t err;
 
+    // the slot is released even if the unlock fails, otherwise it would
+    // never be given back to the producer
     err = mAcquiredBuffer.mGraphicBuffer->unlock();
     if (err != OK) {
         ALOGE("%s: Unable to unlock graphic buffer", __FUNCTION__);
-        return err;
     }
     int buf = mAcquiredBuffer.mSlot;
 
@@ -184,7 +203,7 @@ status_t GrallocConsumer::releaseAcquiredBufferLocked() {
     mAcquiredBuffer.mSlot = BufferQueue::INVALID_BUFFER_SLOT;
     mAcquiredBuffer.mBufferPointer = NULL;
     mAcquiredBuffer.mGraphicBuffer.clear();
-    return OK;
+    return err;
 }
 
 } // namespace renderscript
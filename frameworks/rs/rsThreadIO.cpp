@@ -32,7 +32,11 @@ using namespace android::renderscript;
 ThreadIO::ThreadIO() {
     mRunning = true;
     mPureFifo = false;
+    mBatching = false;
     mMaxInlineSize = 1024;
+    mRingHead = 0;
+    mRingTail = 0;
+    mCoreIdle = 0;
 }
 
 ThreadIO::~ThreadIO() {
@@ -60,7 +64,60 @@ void * ThreadIO::coreHeader(uint32_t cmdID, size_t dataLen) {
 }
 
 void ThreadIO::coreCommit() {
-    mToCore.writeAsync(&mSendBuffer, mSendLen);
+    if (isPureFifo()) {
+        mToCore.writeAsync(&mSendBuffer, mSendLen);
+        return;
+    }
+
+    // Keep the commands 8 byte aligned in the ring.
+    const size_t len = (mSendLen + 7) & ~7;
+    const uint32_t head = mRingHead;
+    while (RING_SIZE - (head - mRingTail) < len) {
+        // The ring is full, wait for the core thread to play some commands.
+        ringDoorbell();
+        usleep(100);
+    }
+    __sync_synchronize();
+    ringWrite(head, mSendBuffer, mSendLen);
+    __sync_synchronize();
+    mRingHead = head + len;
+    if (!mBatching) {
+        ringDoorbell();
+    }
+}
+
+void ThreadIO::setBatching(bool batching) {
+    mBatching = batching;
+    if (!batching && !isPureFifo()) {
+        ringDoorbell();
+    }
+}
+
+void ThreadIO::ringDoorbell() {
+    // Pairs with the barrier of the core thread between setting mCoreIdle
+    // and checking the ring, so that either the core thread sees the new
+    // command or this thread sees it idle.
+    __sync_synchronize();
+    if (mCoreIdle && __sync_bool_compare_and_swap(&mCoreIdle, 1, 0)) {
+        CoreCmdHeader hdr;
+        hdr.cmdID = DOORBELL_CMD_ID;
+        hdr.bytes = 0;
+        mToCore.writeAsync(&hdr, sizeof(hdr));
+    }
+}
+
+void ThreadIO::ringWrite(uint32_t pos, const void *data, size_t len) {
+    const size_t offset = pos & (RING_SIZE - 1);
+    const size_t first = rsMin(len, RING_SIZE - offset);
+    memcpy(&mRing[offset], data, first);
+    memcpy(&mRing[0], (const uint8_t *)data + first, len - first);
+}
+
+void ThreadIO::ringRead(uint32_t pos, void *data, size_t len) {
+    const size_t offset = pos & (RING_SIZE - 1);
+    const size_t first = rsMin(len, RING_SIZE - offset);
+    memcpy(data, &mRing[offset], first);
+    memcpy((uint8_t *)data + first, &mRing[0], len - first);
 }
 
 void ThreadIO::clientShutdown() {
@@ -94,6 +151,11 @@ void ThreadIO::coreGetReturn(void *data, size_t dataLen) {
         dataLen = sizeof(buf);
     }
 
+    // The core thread has to play the batched commands before the one
+    // waiting for this return.
+    if (!isPureFifo()) {
+        ringDoorbell();
+    }
     mToCore.writeWaitReturn(data, dataLen);
 }
 
@@ -101,11 +163,52 @@ void ThreadIO::setTimeoutCallback(void (*cb)(void *), void *dat, uint64_t timeou
     //mToCore.setTimeoutCallback(cb, dat, timeout);
 }
 
+void ThreadIO::playLocalCommand(Context *con, const CoreCmdHeader *cmd, const void *data) {
+    if (con->props.mLogTimes) {
+        con->timerSet(Context::RS_TIMER_INTERNAL);
+    }
+    //ALOGV("playCoreCommands 3 %i %i", cmd->cmdID, cmd->bytes);
+
+    if (cmd->cmdID >= (sizeof(gPlaybackFuncs) / sizeof(void *))) {
+        rsAssert(cmd->cmdID < (sizeof(gPlaybackFuncs) / sizeof(void *)));
+        ALOGE("playCoreCommands error con %p, cmd %i", con, cmd->cmdID);
+    }
+
+    gPlaybackFuncs[cmd->cmdID](con, data, cmd->bytes);
+
+    if (con->props.mLogTimes) {
+        con->timerSet(Context::RS_TIMER_IDLE);
+    }
+}
+
+bool ThreadIO::playRingCommands(Context *con, uint8_t *buf, size_t bufLen) {
+    bool ret = false;
+    const CoreCmdHeader *cmd = (const CoreCmdHeader *)&buf[0];
+
+    uint32_t tail = mRingTail;
+    while (mRunning && tail != mRingHead) {
+        __sync_synchronize();
+        ringRead(tail, buf, sizeof(CoreCmdHeader));
+        rsAssert(cmd->bytes <= bufLen - sizeof(CoreCmdHeader));
+        ringRead(tail + sizeof(CoreCmdHeader), &buf[sizeof(CoreCmdHeader)], cmd->bytes);
+
+        // The command is copied out, its space can be reused by the client
+        // while it is played.
+        tail += (sizeof(CoreCmdHeader) + cmd->bytes + 7) & ~7;
+        __sync_synchronize();
+        mRingTail = tail;
+
+        playLocalCommand(con, cmd, &buf[sizeof(CoreCmdHeader)]);
+        ret = true;
+    }
+    return ret;
+}
+
 bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
     bool ret = false;
     const bool isLocal = !isPureFifo();
 
-    uint8_t buf[2 * 1024];
+    uint8_t buf[2 * 1024] __attribute__((aligned(sizeof(double))));
     const CoreCmdHeader *cmd = (const CoreCmdHeader *)&buf[0];
     const void * data = (const void *)&buf[sizeof(CoreCmdHeader)];
 
@@ -127,7 +230,27 @@ bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
 
     int waitTime = -1;
     while (mRunning) {
+        if (isLocal) {
+            if (playRingCommands(con, buf, sizeof(buf))) {
+                ret = true;
+                if (waitFd < 0) {
+                    waitTime = 0;
+                }
+            }
+
+            // From here on the client rings the doorbell for new commands.
+            mCoreIdle = 1;
+            __sync_synchronize();
+            if (mRingTail != mRingHead) {
+                mCoreIdle = 0;
+                continue;
+            }
+        }
+
         int pr = poll(p, pollCount, waitTime);
+        if (isLocal) {
+            mCoreIdle = 0;
+        }
         if (pr <= 0) {
             break;
         }
@@ -135,38 +258,38 @@ bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
         if (p[0].revents) {
             size_t r = 0;
             if (isLocal) {
+                // The commands written directly to the socket come after the
+                // ones already in the ring.
+                if (playRingCommands(con, buf, sizeof(buf))) {
+                    ret = true;
+                }
+
                 r = mToCore.read(&buf[0], sizeof(CoreCmdHeader));
                 mToCore.read(&buf[sizeof(CoreCmdHeader)], cmd->bytes);
                 if (r != sizeof(CoreCmdHeader)) {
                     // exception or timeout occurred.
                     break;
                 }
+                if (cmd->cmdID != DOORBELL_CMD_ID) {
+                    playLocalCommand(con, cmd, data);
+                }
             } else {
                 r = mToCore.read((void *)&cmd->cmdID, sizeof(cmd->cmdID));
-            }
 
-
-            ret = true;
-            if (con->props.mLogTimes) {
-                con->timerSet(Context::RS_TIMER_INTERNAL);
-            }
-            //ALOGV("playCoreCommands 3 %i %i", cmd->cmdID, cmd->bytes);
-
-            if (cmd->cmdID >= (sizeof(gPlaybackFuncs) / sizeof(void *))) {
-                rsAssert(cmd->cmdID < (sizeof(gPlaybackFuncs) / sizeof(void *)));
-                ALOGE("playCoreCommands error con %p, cmd %i", con, cmd->cmdID);
-            }
-
-            if (isLocal) {
-                gPlaybackFuncs[cmd->cmdID](con, data, cmd->bytes);
-            } else {
+                if (con->props.mLogTimes) {
+                    con->timerSet(Context::RS_TIMER_INTERNAL);
+                }
+                if (cmd->cmdID >= (sizeof(gPlaybackFuncs) / sizeof(void *))) {
+                    rsAssert(cmd->cmdID < (sizeof(gPlaybackFuncs) / sizeof(void *)));
+                    ALOGE("playCoreCommands error con %p, cmd %i", con, cmd->cmdID);
+                }
                 gPlaybackRemoteFuncs[cmd->cmdID](con, this);
+                if (con->props.mLogTimes) {
+                    con->timerSet(Context::RS_TIMER_IDLE);
+                }
             }
 
-            if (con->props.mLogTimes) {
-                con->timerSet(Context::RS_TIMER_IDLE);
-            }
-
+            ret = true;
             if (waitFd < 0) {
                 // If we don't have a secondary wait object we should stop blocking now
                 // that at least one command has been processed.
@@ -41,6 +41,11 @@ public:
         return mPureFifo;
     }
 
+    // While batching, committed commands are left in the ring without waking
+    // the core thread, until the ring fills, the client waits for a return
+    // or batching is turned off.
+    void setBatching(bool batching);
+
     // Plays back commands from the client.
     // Returns true if any commands were processed.
     bool playCoreCommands(Context *con, int waitFd);
@@ -79,8 +84,32 @@ protected:
     } ClientCmdHeader;
     ClientCmdHeader mLastClientHeader;
 
+    // The local commands go through mRing, a ring buffer with one producer,
+    // the client, and one consumer, the core thread.  Only the core thread
+    // waiting for commands is woken up, by a doorbell command written to
+    // mToCore.  Commands written to mToCore with coreWrite() may come from
+    // any thread, they are played after the commands already in the ring.
+    enum {
+        RING_SIZE = 64 * 1024,
+        DOORBELL_CMD_ID = 0xffffffff
+    };
+
+    void ringDoorbell();
+    void ringRead(uint32_t pos, void *data, size_t len);
+    void ringWrite(uint32_t pos, const void *data, size_t len);
+    bool playRingCommands(Context *con, uint8_t *buf, size_t bufLen);
+    void playLocalCommand(Context *con, const CoreCmdHeader *cmd, const void *data);
+
+    // Bytes written to and read from the ring since the start.  The
+    // positions in the ring are these modulo RING_SIZE.
+    volatile uint32_t mRingHead;
+    volatile uint32_t mRingTail;
+    // Set by the core thread while it waits for commands.
+    volatile int32_t mCoreIdle;
+
     bool mRunning;
     bool mPureFifo;
+    bool mBatching;
     size_t mMaxInlineSize;
 
     FifoSocket mToClient;
@@ -90,6 +119,7 @@ protected:
 
     size_t mSendLen;
     uint8_t mSendBuffer[2 * 1024] __attribute__((aligned(sizeof(double))));
+    uint8_t mRing[RING_SIZE];
 
 };
 
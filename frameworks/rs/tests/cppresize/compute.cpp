@@ -0,0 +1,179 @@
+#include "RenderScript.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+using namespace android;
+using namespace RSC;
+
+static long long now() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return (long long)t.tv_sec * 1000000 + t.tv_usec;
+}
+
+static int clampi(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static double cubic(double p0, double p1, double p2, double p3, double x) {
+    return p1 + 0.5 * x * (p2 - p0 + x * (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3
+            + x * (3.0 * (p1 - p2) + p3 - p0)));
+}
+
+// Plain C version of the intrinsic, in double precision.
+static void referenceResize(const unsigned char *in, int inW, int inH,
+                            unsigned char *out, int outW, int outH, int vecSize) {
+    double scaleX = (double)inW / outW;
+    double scaleY = (double)inH / outH;
+    for (int y = 0; y < outH; y++) {
+        double sy = (y + 0.5) * scaleY - 0.5;
+        int starty = (int)floor(sy);
+        double yf = sy - starty;
+        for (int x = 0; x < outW; x++) {
+            double sx = (x + 0.5) * scaleX - 0.5;
+            int startx = (int)floor(sx);
+            double xf = sx - startx;
+            for (int c = 0; c < vecSize; c++) {
+                double r[4];
+                for (int j = 0; j < 4; j++) {
+                    const unsigned char *row = in + clampi(starty + j - 1, 0, inH - 1) * inW * vecSize;
+                    double p[4];
+                    for (int i = 0; i < 4; i++) {
+                        p[i] = row[clampi(startx + i - 1, 0, inW - 1) * vecSize + c];
+                    }
+                    r[j] = cubic(p[0], p[1], p[2], p[3], xf);
+                }
+                double v = cubic(r[0], r[1], r[2], r[3], yf) + 0.5;
+                out[(y * outW + x) * vecSize + c] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+            }
+        }
+    }
+}
+
+static sp<Allocation> createImage(sp<RS> rs, sp<const Element> e, int w, int h) {
+    Type::Builder tb(rs, e);
+    tb.setX(w);
+    tb.setY(h);
+    return Allocation::createTyped(rs, tb.create());
+}
+
+// Resizes in from inW x inH to outW x outH with the intrinsic and with the C
+// version, and returns the largest difference.  Both are timed over iters runs.
+static int runResize(sp<RS> rs, sp<const Element> e, int vecSize, const unsigned char *in,
+                     int inW, int inH, int outW, int outH, int iters,
+                     unsigned char *out) {
+    sp<Allocation> ain = createImage(rs, e, inW, inH);
+    sp<Allocation> aout = createImage(rs, e, outW, outH);
+    ain->copy2DRangeFrom(0, 0, inW, inH, in);
+
+    sp<ScriptIntrinsicResize> resize = ScriptIntrinsicResize::create(rs, e);
+    resize->setInput(ain);
+    resize->forEach_bicubic(aout);
+    rs->finish();
+
+    long long start = now();
+    for (int i = 0; i < iters; i++) {
+        resize->forEach_bicubic(aout);
+    }
+    rs->finish();
+    long long rsTime = now() - start;
+    aout->copy2DRangeTo(0, 0, outW, outH, out);
+
+    unsigned char *expected = new unsigned char[outW * outH * vecSize];
+    start = now();
+    for (int i = 0; i < iters; i++) {
+        referenceResize(in, inW, inH, expected, outW, outH, vecSize);
+    }
+    long long refTime = now() - start;
+
+    int maxDiff = 0;
+    for (int i = 0; i < outW * outH * vecSize; i++) {
+        int diff = abs((int)out[i] - (int)expected[i]);
+        if (diff > maxDiff) {
+            maxDiff = diff;
+        }
+    }
+    delete [] expected;
+
+    printf("U8_%i %ix%i -> %ix%i: intrinsic %lld us, C %lld us, max diff %i\n",
+           vecSize, inW, inH, outW, outH, rsTime / iters, refTime / iters, maxDiff);
+    return maxDiff;
+}
+
+int main(int argc, char** argv)
+{
+    sp<RS> rs = new RS();
+    bool r = rs->init();
+    if (!r) {
+        printf("Init failed\n");
+        return 1;
+    }
+
+    int iters = 10;
+    if (argc > 1) {
+        iters = atoi(argv[1]);
+    }
+
+    bool failed = false;
+    const int maxW = 1024;
+    const int maxH = 768;
+    unsigned char *in = new unsigned char[maxW * maxH * 4];
+    unsigned char *out = new unsigned char[maxW * maxH * 4];
+
+    for (int vecSize = 1; vecSize <= 4; vecSize += 3) {
+        sp<const Element> e = vecSize == 1 ? Element::U8(rs) : Element::U8_4(rs);
+
+        // Resizing to the same size is a copy.
+        srand(1);
+        for (int i = 0; i < 64 * 48 * vecSize; i++) {
+            in[i] = rand() & 0xff;
+        }
+        runResize(rs, e, vecSize, in, 64, 48, 64, 48, 1, out);
+        if (memcmp(in, out, 64 * 48 * vecSize)) {
+            printf("Identity resize of U8_%i changed the image\n", vecSize);
+            failed = true;
+        }
+
+        // A constant image stays constant.
+        memset(in, 0x5a, 64 * 48 * vecSize);
+        runResize(rs, e, vecSize, in, 64, 48, 37, 101, 1, out);
+        for (int i = 0; i < 37 * 101 * vecSize; i++) {
+            if (out[i] != 0x5a) {
+                printf("Resize of a constant U8_%i image changed it\n", vecSize);
+                failed = true;
+                break;
+            }
+        }
+
+        // Smooth gradients with some noise, downscaled and upscaled.  The
+        // float intrinsic may round differently from the double C version.
+        for (int y = 0; y < maxH; y++) {
+            for (int x = 0; x < maxW; x++) {
+                for (int c = 0; c < vecSize; c++) {
+                    in[(y * maxW + x) * vecSize + c] =
+                            (x * (c + 1) + y * 2 + (rand() & 15)) & 0xff;
+                }
+            }
+        }
+        if (runResize(rs, e, vecSize, in, maxW, maxH, 640, 480, iters, out) > 1) {
+            failed = true;
+        }
+        if (runResize(rs, e, vecSize, in, 320, 240, maxW, maxH, iters, out) > 1) {
+            failed = true;
+        }
+    }
+
+    delete [] in;
+    delete [] out;
+
+    if (failed) {
+        printf("TEST FAILED!\n");
+    } else {
+        printf("TEST PASSED!\n");
+    }
+
+    return failed;
+}
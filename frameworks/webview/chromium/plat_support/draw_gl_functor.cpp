@@ -87,6 +87,14 @@ class DrawGLFunctor : public Functor {
     gl_info->dirtyRight = aw_info.dirty_right;
     gl_info->dirtyBottom = aw_info.dirty_bottom;
 
+    // Outside of draws chromium only does resource work, such as texture
+    // uploads, so the clip, blend and clear color state of the app are left
+    // alone and hwui does not need to query and restore them.
+    if (what == DrawGlInfo::kModeProcess) {
+      gl_info->modifiedState = DrawGlInfo::kStateViewport |
+          DrawGlInfo::kStateFramebuffer | DrawGlInfo::kStateTexture;
+    }
+
     // Calculate the return code.
     status_t res = DrawGlInfo::kStatusDone;
     if (aw_info.status_mask & AwDrawGLInfo::kStatusMaskDraw)
@@ -17,31 +17,124 @@
 // Provides the implementation of the GraphicBuffer interface in
 // renderer compostior
 
+#define LOG_TAG "webviewchromium_plat_support"
+
 #include "graphic_buffer_impl.h"
 
 #include <utils/Errors.h>
+#include <utils/Log.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
 
 namespace android {
 
-GraphicBufferImpl::GraphicBufferImpl(uint32_t w, uint32_t h)
-  : mBuffer(new android::GraphicBuffer(w, h, PIXEL_FORMAT_RGBA_8888,
-       android::GraphicBuffer::USAGE_HW_TEXTURE |
-       android::GraphicBuffer::USAGE_SW_READ_OFTEN |
-       android::GraphicBuffer::USAGE_SW_WRITE_OFTEN)) {
+namespace {
+
+const uint32_t kBufferUsage = android::GraphicBuffer::USAGE_HW_TEXTURE |
+    android::GraphicBuffer::USAGE_SW_READ_OFTEN |
+    android::GraphicBuffer::USAGE_SW_WRITE_OFTEN;
+
+// Number of buffers of the tile size kept allocated ahead of time.
+const size_t kPoolSize = 4;
+
+sp<android::GraphicBuffer> AllocateBuffer(uint32_t w, uint32_t h) {
+  sp<android::GraphicBuffer> buffer(new android::GraphicBuffer(
+      w, h, PIXEL_FORMAT_RGBA_8888, kBufferUsage));
+  if (buffer->initCheck() != NO_ERROR) {
+    return NULL;
+  }
+  return buffer;
+}
+
+// Tiles are uploaded into buffers that all have the same size. The pool
+// allocates buffers of the size last asked for on its own thread, so that
+// the upload does not wait for gralloc, and keeps released buffers of that
+// size for the next tiles.
+class BufferPool : public Thread {
+ public:
+  BufferPool() : Thread(false), width_(0), height_(0), started_(false) {}
+
+  sp<android::GraphicBuffer> Obtain(uint32_t w, uint32_t h) {
+    {
+      Mutex::Autolock lock(lock_);
+      if (w != width_ || h != height_) {
+        width_ = w;
+        height_ = h;
+        buffers_.clear();
+      }
+      if (!started_) {
+        started_ = run("WebViewTilePool", PRIORITY_BACKGROUND) == NO_ERROR;
+      }
+      condition_.signal();
+      if (!buffers_.isEmpty()) {
+        sp<android::GraphicBuffer> buffer(buffers_.top());
+        buffers_.pop();
+        return buffer;
+      }
+    }
+    return AllocateBuffer(w, h);
+  }
+
+  void Recycle(const sp<android::GraphicBuffer>& buffer) {
+    Mutex::Autolock lock(lock_);
+    if (buffer->getWidth() == width_ && buffer->getHeight() == height_ &&
+        buffers_.size() < kPoolSize) {
+      buffers_.push(buffer);
+    }
+  }
+
+ private:
+  virtual bool threadLoop() {
+    uint32_t w, h;
+    {
+      Mutex::Autolock lock(lock_);
+      while (!exitPending() && (width_ == 0 || buffers_.size() >= kPoolSize)) {
+        condition_.wait(lock_);
+      }
+      if (exitPending()) {
+        return false;
+      }
+      w = width_;
+      h = height_;
+    }
+
+    sp<android::GraphicBuffer> buffer(AllocateBuffer(w, h));
+    if (buffer == NULL) {
+      ALOGE("Failed to allocate a %ux%u tile buffer", w, h);
+      return false;
+    }
+    Recycle(buffer);
+    return true;
+  }
+
+  Mutex lock_;
+  Condition condition_;
+  uint32_t width_;
+  uint32_t height_;
+  bool started_;
+  Vector<sp<android::GraphicBuffer> > buffers_;
+};
+
+sp<BufferPool> g_buffer_pool(new BufferPool());
+
+}  // namespace
+
+GraphicBufferImpl::GraphicBufferImpl(const sp<android::GraphicBuffer>& buffer)
+  : mBuffer(buffer) {
 }
 
 GraphicBufferImpl::~GraphicBufferImpl() {
+  g_buffer_pool->Recycle(mBuffer);
 }
 
 // static
 int GraphicBufferImpl::Create(int w, int h) {
-  GraphicBufferImpl* buffer = new GraphicBufferImpl(
-      static_cast<uint32_t>(w), static_cast<uint32_t>(h));
-  if (buffer->InitCheck() != NO_ERROR) {
-    delete buffer;
+  sp<android::GraphicBuffer> buffer(g_buffer_pool->Obtain(
+      static_cast<uint32_t>(w), static_cast<uint32_t>(h)));
+  if (buffer == NULL) {
     return 0;
   }
-  return reinterpret_cast<int>(buffer);
+  return reinterpret_cast<int>(new GraphicBufferImpl(buffer));
 }
 
 // static
@@ -97,10 +190,6 @@ status_t GraphicBufferImpl::Unmap() {
   return mBuffer->unlock();
 }
 
-status_t GraphicBufferImpl::InitCheck() const {
-  return mBuffer->initCheck();
-}
-
 void* GraphicBufferImpl::GetNativeBuffer() const {
   return mBuffer->getNativeBuffer();
 }
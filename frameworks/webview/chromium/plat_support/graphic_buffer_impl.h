@@ -40,10 +40,9 @@ class GraphicBufferImpl {
  private:
   status_t Map(AwMapMode mode, void** vaddr);
   status_t Unmap();
-  status_t InitCheck() const;
   void* GetNativeBuffer() const;
   uint32_t GetStride() const;
-  GraphicBufferImpl(uint32_t w, uint32_t h);
+  GraphicBufferImpl(const sp<android::GraphicBuffer>& buffer);
 
   sp<android::GraphicBuffer> mBuffer;
 };
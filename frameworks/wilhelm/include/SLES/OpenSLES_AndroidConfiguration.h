@@ -64,6 +64,13 @@ extern "C" {
 /*      same as android.media.AudioManager.STREAM_NOTIFICATION */
 #define SL_ANDROID_STREAM_NOTIFICATION ((SLint32) 0x00000005)
 
+/** Audio playback output latency */
+/** Audio playback output latency key, read-only, an SLuint32 in milliseconds.
+ *  Only available on a realized player of PCM data from a buffer queue. It is the latency
+ *  from the time data is handed to the buffer queue callback until it reaches the audio
+ *  hardware, and depends on whether the player got a low latency (fast) track. */
+#define SL_ANDROID_KEY_OUTPUT_LATENCY ((const SLchar*) "androidOutputLatency")
+
 
 
 #ifdef __cplusplus
@@ -17,6 +17,114 @@
 /* ThreadPool */
 
 #include "sles_allinclusive.h"
+#include <time.h>
+
+static long long ThreadPool_nowNs(void)
+{
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 0;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Circular buffer of closures for one priority, protected by the thread pool mutex
+
+static SLresult ClosureQueue_init(ClosureQueue *queue, unsigned maxClosures)
+{
+    if (CLOSURE_TYPICAL >= maxClosures) {
+        queue->mClosureArray = queue->mClosureTypical;
+    } else {
+        queue->mClosureArray = (Closure **) malloc((maxClosures + 1) * sizeof(Closure *));
+        if (NULL == queue->mClosureArray) {
+            return SL_RESULT_RESOURCE_ERROR;
+        }
+    }
+    queue->mClosureFront = queue->mClosureArray;
+    queue->mClosureRear = queue->mClosureArray;
+    return SL_RESULT_SUCCESS;
+}
+
+static void ClosureQueue_deinit(ClosureQueue *queue)
+{
+    if (queue->mClosureTypical != queue->mClosureArray && NULL != queue->mClosureArray) {
+        free(queue->mClosureArray);
+    }
+    queue->mClosureArray = NULL;
+    queue->mClosureFront = NULL;
+    queue->mClosureRear = NULL;
+}
+
+static SLboolean ClosureQueue_isEmpty(const ClosureQueue *queue)
+{
+    return queue->mClosureFront == queue->mClosureRear;
+}
+
+// Returns SL_BOOLEAN_FALSE if the circular buffer is full
+static SLboolean ClosureQueue_push(ClosureQueue *queue, unsigned maxClosures, Closure *closure)
+{
+    Closure **oldRear = queue->mClosureRear;
+    Closure **newRear = oldRear;
+    if (++newRear == &queue->mClosureArray[maxClosures + 1])
+        newRear = queue->mClosureArray;
+    if (newRear == queue->mClosureFront) {
+        return SL_BOOLEAN_FALSE;
+    }
+    assert(NULL == *oldRear);
+    *oldRear = closure;
+    queue->mClosureRear = newRear;
+    if (++queue->mStats.mDepth > queue->mStats.mMaxDepth) {
+        queue->mStats.mMaxDepth = queue->mStats.mDepth;
+    }
+    return SL_BOOLEAN_TRUE;
+}
+
+// Must not be called when the circular buffer is empty
+static Closure *ClosureQueue_pop(ClosureQueue *queue, unsigned maxClosures)
+{
+    Closure **oldFront = queue->mClosureFront;
+    assert(oldFront != queue->mClosureRear);
+    Closure **newFront = oldFront;
+    if (++newFront == &queue->mClosureArray[maxClosures + 1]) {
+        newFront = queue->mClosureArray;
+    }
+    Closure *pClosure = *oldFront;
+    assert(NULL != pClosure);
+    *oldFront = NULL;
+    queue->mClosureFront = newFront;
+    assert(0 < queue->mStats.mDepth);
+    --queue->mStats.mDepth;
+    return pClosure;
+}
+
+// Called by a worker thread after it has executed a closure
+
+static void ThreadPool_finish(ThreadPool *tp, const Closure *closure, long long startNs)
+{
+    long long runNs = ThreadPool_nowNs() - startNs;
+    int ok;
+    ok = pthread_mutex_lock(&tp->mMutex);
+    assert(0 == ok);
+    ThreadPoolStats *stats = &tp->mQueues[closure->mPriority].mStats;
+    ++stats->mExecuted;
+    stats->mTotalRunNs += runNs;
+    if (runNs > stats->mMaxRunNs) {
+        stats->mMaxRunNs = runNs;
+    }
+    if (CLOSURE_PRIORITY_NORMAL == closure->mPriority) {
+        assert(0 < tp->mRunningNormal);
+        --tp->mRunningNormal;
+        // an idle worker thread may now be allowed to take the next normal priority closure
+        if (0 < tp->mWaitingNotEmpty &&
+                !ClosureQueue_isEmpty(&tp->mQueues[CLOSURE_PRIORITY_NORMAL])) {
+            tp->mWaitingNotEmpty = 0;
+            ok = pthread_cond_broadcast(&tp->mCondNotEmpty);
+            assert(0 == ok);
+        }
+    }
+    ok = pthread_mutex_unlock(&tp->mMutex);
+    assert(0 == ok);
+}
 
 // Entry point for each worker thread
 
@@ -33,6 +141,7 @@ static void *ThreadPool_start(void *context)
         // make a copy of parameters, then free the parameters
         const Closure closure = *pClosure;
         free(pClosure);
+        long long startNs = ThreadPool_nowNs();
         // extract parameters and call the right method depending on kind
         ClosureKind kind = closure.mKind;
         void *context1 = closure.mContext1;
@@ -68,6 +177,7 @@ static void *ThreadPool_start(void *context)
             assert(false);
             break;
         }
+        ThreadPool_finish(tp, &closure, startNs);
     }
     return NULL;
 }
@@ -121,18 +231,14 @@ SLresult ThreadPool_init(ThreadPool *tp, unsigned maxClosures, unsigned maxThrea
         maxThreads = THREAD_TYPICAL;
     tp->mMaxThreads = maxThreads;
 
-    // initialize circular buffer for closures
-    if (CLOSURE_TYPICAL >= maxClosures) {
-        tp->mClosureArray = tp->mClosureTypical;
-    } else {
-        tp->mClosureArray = (Closure **) malloc((maxClosures + 1) * sizeof(Closure *));
-        if (NULL == tp->mClosureArray) {
-            result = SL_RESULT_RESOURCE_ERROR;
+    // initialize a circular buffer of closures for each priority
+    unsigned priority;
+    for (priority = 0; priority < CLOSURE_PRIORITY_COUNT; ++priority) {
+        result = ClosureQueue_init(&tp->mQueues[priority], maxClosures);
+        if (SL_RESULT_SUCCESS != result)
             goto fail;
-        }
     }
-    tp->mClosureFront = tp->mClosureArray;
-    tp->mClosureRear = tp->mClosureArray;
+    tp->mRunningNormal = 0;
 
     // initialize thread pool
     if (THREAD_TYPICAL >= maxThreads) {
@@ -187,23 +293,28 @@ static void ThreadPool_deinit_internal(ThreadPool *tp, unsigned initialized, uns
             assert(ok == 0);
         }
 
-        // Empty out the circular buffer of closures
+        // Empty out the circular buffers of closures
         ok = pthread_mutex_lock(&tp->mMutex);
         assert(0 == ok);
-        Closure **oldFront = tp->mClosureFront;
-        while (oldFront != tp->mClosureRear) {
-            Closure **newFront = oldFront;
-            if (++newFront == &tp->mClosureArray[tp->mMaxClosures + 1])
-                newFront = tp->mClosureArray;
-            Closure *pClosure = *oldFront;
-            assert(NULL != pClosure);
-            *oldFront = NULL;
-            tp->mClosureFront = newFront;
-            ok = pthread_mutex_unlock(&tp->mMutex);
-            assert(0 == ok);
-            free(pClosure);
-            ok = pthread_mutex_lock(&tp->mMutex);
-            assert(0 == ok);
+        unsigned priority;
+        for (priority = 0; priority < CLOSURE_PRIORITY_COUNT; ++priority) {
+            ClosureQueue *queue = &tp->mQueues[priority];
+            const ThreadPoolStats *stats = &queue->mStats;
+            SL_LOGV("ThreadPool lane %u: executed=%llu maxDepth=%u avgWait=%lld maxWait=%lld "
+                    "avgRun=%lld maxRun=%lld ns, %u dropped", priority, stats->mExecuted,
+                    stats->mMaxDepth,
+                    stats->mExecuted ? stats->mTotalWaitNs / (long long) stats->mExecuted : 0LL,
+                    stats->mMaxWaitNs,
+                    stats->mExecuted ? stats->mTotalRunNs / (long long) stats->mExecuted : 0LL,
+                    stats->mMaxRunNs, stats->mDepth);
+            while (!ClosureQueue_isEmpty(queue)) {
+                Closure *pClosure = ClosureQueue_pop(queue, tp->mMaxClosures);
+                ok = pthread_mutex_unlock(&tp->mMutex);
+                assert(0 == ok);
+                free(pClosure);
+                ok = pthread_mutex_lock(&tp->mMutex);
+                assert(0 == ok);
+            }
         }
         ok = pthread_mutex_unlock(&tp->mMutex);
         assert(0 == ok);
@@ -225,10 +336,10 @@ static void ThreadPool_deinit_internal(ThreadPool *tp, unsigned initialized, uns
     }
     tp->mInitialized = INITIALIZED_NONE;
 
-    // release the closure circular buffer
-    if (tp->mClosureTypical != tp->mClosureArray && NULL != tp->mClosureArray) {
-        free(tp->mClosureArray);
-        tp->mClosureArray = NULL;
+    // release the closure circular buffers
+    unsigned priority;
+    for (priority = 0; priority < CLOSURE_PRIORITY_COUNT; ++priority) {
+        ClosureQueue_deinit(&tp->mQueues[priority]);
     }
 
     // release the thread pool
@@ -244,14 +355,25 @@ void ThreadPool_deinit(ThreadPool *tp)
     ThreadPool_deinit_internal(tp, tp->mInitialized, tp->mMaxThreads);
 }
 
-// Enqueue a closure to be executed later by a worker thread.
+// Enqueue a closure to be executed later by a worker thread, at normal priority.
 // Note that this raw interface requires an explicit "kind" and full parameter list.
 // There are convenience methods below that make this easier to use.
 SLresult ThreadPool_add(ThreadPool *tp, ClosureKind kind, ClosureHandler_generic handler,
         void *context1, void *context2, void *context3, int parameter1, int parameter2)
+{
+    return ThreadPool_add_priority(tp, CLOSURE_PRIORITY_NORMAL, kind, handler,
+            context1, context2, context3, parameter1, parameter2);
+}
+
+// Enqueue a closure on the lane for the given priority.
+// High priority closures are dequeued before any normal priority closure.
+SLresult ThreadPool_add_priority(ThreadPool *tp, ClosurePriority priority, ClosureKind kind,
+        ClosureHandler_generic handler,
+        void *context1, void *context2, void *context3, int parameter1, int parameter2)
 {
     assert(NULL != tp);
     assert(NULL != handler);
+    assert(CLOSURE_PRIORITY_COUNT > (unsigned) priority);
     Closure *closure = (Closure *) malloc(sizeof(Closure));
     if (NULL == closure) {
         return SL_RESULT_RESOURCE_ERROR;
@@ -276,6 +398,9 @@ SLresult ThreadPool_add(ThreadPool *tp, ClosureKind kind, ClosureHandler_generic
     closure->mContext3 = context3;
     closure->mParameter1 = parameter1;
     closure->mParameter2 = parameter2;
+    closure->mPriority = priority;
+    closure->mEnqueueTimeNs = ThreadPool_nowNs();
+    ClosureQueue *queue = &tp->mQueues[priority];
     int ok;
     ok = pthread_mutex_lock(&tp->mMutex);
     assert(0 == ok);
@@ -287,19 +412,17 @@ SLresult ThreadPool_add(ThreadPool *tp, ClosureKind kind, ClosureHandler_generic
         return SL_RESULT_PRECONDITIONS_VIOLATED;
     }
     for (;;) {
-        Closure **oldRear = tp->mClosureRear;
-        Closure **newRear = oldRear;
-        if (++newRear == &tp->mClosureArray[tp->mMaxClosures + 1])
-            newRear = tp->mClosureArray;
         // if closure circular buffer is full, then wait for it to become non-full
-        if (newRear == tp->mClosureFront) {
+        if (!ClosureQueue_push(queue, tp->mMaxClosures, closure)) {
             ++tp->mWaitingNotFull;
             ok = pthread_cond_wait(&tp->mCondNotFull, &tp->mMutex);
             assert(0 == ok);
             // can't enqueue while thread pool shutting down
             if (tp->mShutdown) {
-                assert(0 < tp->mWaitingNotFull);
-                --tp->mWaitingNotFull;
+                // a worker thread may already have cleared the count when it woke us
+                if (0 < tp->mWaitingNotFull) {
+                    --tp->mWaitingNotFull;
+                }
                 ok = pthread_mutex_unlock(&tp->mMutex);
                 assert(0 == ok);
                 free(closure);
@@ -307,13 +430,11 @@ SLresult ThreadPool_add(ThreadPool *tp, ClosureKind kind, ClosureHandler_generic
             }
             continue;
         }
-        assert(NULL == *oldRear);
-        *oldRear = closure;
-        tp->mClosureRear = newRear;
-        // if a worker thread was waiting to dequeue, then suggest that it try again
+        // if a worker thread was waiting to dequeue, then suggest that it try again;
+        // wake them all, because the reserved worker thread can't take normal priority work
         if (0 < tp->mWaitingNotEmpty) {
-            --tp->mWaitingNotEmpty;
-            ok = pthread_cond_signal(&tp->mCondNotEmpty);
+            tp->mWaitingNotEmpty = 0;
+            ok = pthread_cond_broadcast(&tp->mCondNotEmpty);
             assert(0 == ok);
         }
         break;
@@ -336,9 +457,16 @@ Closure *ThreadPool_remove(ThreadPool *tp)
             pClosure = NULL;
             break;
         }
-        Closure **oldFront = tp->mClosureFront;
-        // if closure circular buffer is empty, then wait for it to become non-empty
-        if (oldFront == tp->mClosureRear) {
+        ClosureQueue *queue = &tp->mQueues[CLOSURE_PRIORITY_HIGH];
+        if (ClosureQueue_isEmpty(queue)) {
+            queue = &tp->mQueues[CLOSURE_PRIORITY_NORMAL];
+            // keep one worker thread free for high priority closures, if there is more than one
+            if (1 < tp->mMaxThreads && tp->mRunningNormal + 1 >= tp->mMaxThreads) {
+                queue = NULL;
+            }
+        }
+        // if there is no closure this thread may execute, then wait for one
+        if (NULL == queue || ClosureQueue_isEmpty(queue)) {
             ++tp->mWaitingNotEmpty;
             ok = pthread_cond_wait(&tp->mCondNotEmpty, &tp->mMutex);
             assert(0 == ok);
@@ -346,18 +474,20 @@ Closure *ThreadPool_remove(ThreadPool *tp)
             continue;
         }
         // dequeue the closure at front of circular buffer
-        Closure **newFront = oldFront;
-        if (++newFront == &tp->mClosureArray[tp->mMaxClosures + 1]) {
-            newFront = tp->mClosureArray;
+        pClosure = ClosureQueue_pop(queue, tp->mMaxClosures);
+        if (CLOSURE_PRIORITY_NORMAL == pClosure->mPriority) {
+            ++tp->mRunningNormal;
         }
-        pClosure = *oldFront;
-        assert(NULL != pClosure);
-        *oldFront = NULL;
-        tp->mClosureFront = newFront;
-        // if a client thread was waiting to enqueue, then suggest that it try again
+        long long waitNs = ThreadPool_nowNs() - pClosure->mEnqueueTimeNs;
+        queue->mStats.mTotalWaitNs += waitNs;
+        if (waitNs > queue->mStats.mMaxWaitNs) {
+            queue->mStats.mMaxWaitNs = waitNs;
+        }
+        // if a client thread was waiting to enqueue, then suggest that it try again;
+        // wake them all, because they may be waiting on either lane
         if (0 < tp->mWaitingNotFull) {
-            --tp->mWaitingNotFull;
-            ok = pthread_cond_signal(&tp->mCondNotFull);
+            tp->mWaitingNotFull = 0;
+            ok = pthread_cond_broadcast(&tp->mCondNotFull);
             assert(0 == ok);
         }
         break;
@@ -367,6 +497,20 @@ Closure *ThreadPool_remove(ThreadPool *tp)
     return pClosure;
 }
 
+// Returns a snapshot of the statistics for the lane of the given priority
+void ThreadPool_getStats(ThreadPool *tp, ClosurePriority priority, ThreadPoolStats *stats)
+{
+    assert(NULL != tp);
+    assert(CLOSURE_PRIORITY_COUNT > (unsigned) priority);
+    assert(NULL != stats);
+    int ok;
+    ok = pthread_mutex_lock(&tp->mMutex);
+    assert(0 == ok);
+    *stats = tp->mQueues[priority].mStats;
+    ok = pthread_mutex_unlock(&tp->mMutex);
+    assert(0 == ok);
+}
+
 // Convenience methods for applications
 SLresult ThreadPool_add_ppi(ThreadPool *tp, ClosureHandler_ppi handler,
         void *context1, void *context2, int parameter1)
@@ -24,6 +24,14 @@ typedef enum {
     CLOSURE_KIND_PIIPP  // void *, int, int, void *, void *
 } ClosureKind;
 
+/** Priority of a closure; each priority has its own FIFO lane */
+
+typedef enum {
+    CLOSURE_PRIORITY_NORMAL,    // object realize and resume, may run for a long time
+    CLOSURE_PRIORITY_HIGH,      // application callbacks, latency sensitive
+    CLOSURE_PRIORITY_COUNT
+} ClosurePriority;
+
 /** Closure handlers */
 
 typedef void (*ClosureHandler_generic)(void *p1, void *p2, void *p3, int i1, int i2);
@@ -45,8 +53,33 @@ typedef struct {
     void *mContext3;
     int mParameter1;
     int mParameter2;
+    ClosurePriority mPriority;
+    long long mEnqueueTimeNs;   ///< When the closure was added, CLOCK_MONOTONIC
 } Closure;
 
+/** \brief Statistics of one lane, see ThreadPool_getStats */
+
+typedef struct {
+    unsigned mDepth;                ///< Number of closures currently queued
+    unsigned mMaxDepth;             ///< Highest number of closures ever queued at once
+    unsigned long long mExecuted;   ///< Number of closures that have run to completion
+    long long mTotalWaitNs;         ///< Sum over executed closures of time spent queued
+    long long mMaxWaitNs;           ///< Longest time a closure spent queued
+    long long mTotalRunNs;          ///< Sum over executed closures of time spent running
+    long long mMaxRunNs;            ///< Longest time a closure spent running
+} ThreadPoolStats;
+
+/** \brief ClosureQueue is the bounded FIFO of closures for one priority */
+
+typedef struct {
+    Closure **mClosureArray;    ///< The circular buffer of closures
+    Closure **mClosureFront, **mClosureRear;
+    /// Saves a malloc in the typical case
+#define CLOSURE_TYPICAL 15
+    Closure *mClosureTypical[CLOSURE_TYPICAL+1];
+    ThreadPoolStats mStats;
+} ClosureQueue;
+
 /** \brief ThreadPool manages a pool of worker threads that execute Closures */
 
 typedef struct {
@@ -57,13 +90,13 @@ typedef struct {
     SLboolean mShutdown;   ///< Whether shutdown of thread pool has been requested
     unsigned mWaitingNotFull;   ///< Number of client threads waiting to enqueue
     unsigned mWaitingNotEmpty;  ///< Number of worker threads waiting to dequeue
-    unsigned mMaxClosures;  ///< Number of slots in circular buffer for closures, not counting spare
+    unsigned mMaxClosures;  ///< Number of slots in each circular buffer, not counting spare
     unsigned mMaxThreads;   ///< Number of worker threads
-    Closure **mClosureArray;    ///< The circular buffer of closures
-    Closure **mClosureFront, **mClosureRear;
-    /// Saves a malloc in the typical case
-#define CLOSURE_TYPICAL 15
-    Closure *mClosureTypical[CLOSURE_TYPICAL+1];
+    /// Worker threads take high priority closures first. With more than one worker thread,
+    /// one of them is kept out of normal priority work, so that a slow normal priority
+    /// closure never delays a high priority one.
+    ClosureQueue mQueues[CLOSURE_PRIORITY_COUNT];
+    unsigned mRunningNormal;    ///< Number of normal priority closures being executed
     pthread_t *mThreadArray;    ///< The worker threads
 #ifdef ANDROID
 // Note: if you set THREAD_TYPICAL to a non-zero value because you
@@ -88,7 +121,12 @@ extern void ThreadPool_deinit(ThreadPool *tp);
 extern SLresult ThreadPool_add(ThreadPool *tp, ClosureKind kind,
         ClosureHandler_generic,
         void *cntxt1, void *cntxt2, void *cntxt3, int param1, int param2);
+extern SLresult ThreadPool_add_priority(ThreadPool *tp, ClosurePriority priority,
+        ClosureKind kind, ClosureHandler_generic,
+        void *cntxt1, void *cntxt2, void *cntxt3, int param1, int param2);
 extern Closure *ThreadPool_remove(ThreadPool *tp);
+extern void ThreadPool_getStats(ThreadPool *tp, ClosurePriority priority,
+        ThreadPoolStats *stats);
 extern SLresult ThreadPool_add_ppi(ThreadPool *tp, ClosureHandler_ppi handler,
         void *cntxt1, void *cntxt2, int param1);
 extern SLresult ThreadPool_add_ppii(ThreadPool *tp, ClosureHandler_ppii handler,
@@ -29,6 +29,7 @@
 template class android::KeyedVector<SLuint32, android::AudioEffect* > ;
 
 #define KEY_STREAM_TYPE_PARAMSIZE  sizeof(SLint32)
+#define KEY_OUTPUT_LATENCY_PARAMSIZE  sizeof(SLuint32)
 
 #define AUDIOTRACK_MIN_PLAYBACKRATE_PERMILLE  500
 #define AUDIOTRACK_MAX_PLAYBACKRATE_PERMILLE 2000
@@ -514,6 +515,18 @@ SLresult audioPlayer_getStreamType(CAudioPlayer* ap, SLint32 *pType) {
 }
 
 
+//-----------------------------------------------------------------------------
+static SLresult audioPlayer_getOutputLatency(CAudioPlayer* ap, SLuint32 *pLatencyMs) {
+    // only a PCM buffer queue player owns an AudioTrack, and only once realized
+    if (ap->mAudioTrack == 0) {
+        *pLatencyMs = 0;
+        return SL_RESULT_PRECONDITIONS_VIOLATED;
+    }
+    *pLatencyMs = ap->mAudioTrack->latency();
+    return SL_RESULT_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 void audioPlayer_auxEffectUpdate(CAudioPlayer* ap) {
     if ((ap->mAudioTrack != 0) && (ap->mAuxEffect != 0)) {
@@ -1108,7 +1121,14 @@ static void audioTrack_callBack_pullFromBuffQueue(int event, void* user, void *i
         // retrieve data from the buffer queue
         interface_lock_exclusive(&ap->mBufferQueue);
 
-        if (ap->mBufferQueue.mState.count != 0) {
+        // pBuff->raw points into the AudioTrack shared memory (or the fast track's), so data
+        // is copied once, directly from the application buffers. Consume as many queued
+        // buffers as fit, rather than one per callback, to save AudioTrack callback round-trips.
+        const size_t requested = pBuff->size;
+        size_t filled = 0;
+        // number of application buffers that were completely consumed
+        unsigned completed = 0;
+        while (ap->mBufferQueue.mState.count != 0 && filled < requested) {
             //SL_LOGV("nbBuffers in queue = %u",ap->mBufferQueue.mState.count);
             assert(ap->mBufferQueue.mFront != ap->mBufferQueue.mRear);
 
@@ -1117,16 +1137,17 @@ static void audioTrack_callBack_pullFromBuffQueue(int event, void* user, void *i
 
             // declared as void * because this code supports both 8-bit and 16-bit PCM data
             void *pSrc = (char *)oldFront->mBuffer + ap->mBufferQueue.mSizeConsumed;
-            if (ap->mBufferQueue.mSizeConsumed + pBuff->size < oldFront->mSize) {
+            size_t available = oldFront->mSize - ap->mBufferQueue.mSizeConsumed;
+            if (filled + available > requested) {
                 // can't consume the whole or rest of the buffer in one shot
-                ap->mBufferQueue.mSizeConsumed += pBuff->size;
-                // leave pBuff->size untouched
+                size_t size = requested - filled;
+                ap->mBufferQueue.mSizeConsumed += size;
                 // consume data
                 // FIXME can we avoid holding the lock during the copy?
-                memcpy (pBuff->raw, pSrc, pBuff->size);
+                memcpy((char *)pBuff->raw + filled, pSrc, size);
+                filled += size;
             } else {
                 // finish consuming the buffer or consume the buffer in one shot
-                pBuff->size = oldFront->mSize - ap->mBufferQueue.mSizeConsumed;
                 ap->mBufferQueue.mSizeConsumed = 0;
 
                 if (newFront ==
@@ -1142,8 +1163,15 @@ static void audioTrack_callBack_pullFromBuffQueue(int event, void* user, void *i
 
                 // consume data
                 // FIXME can we avoid holding the lock during the copy?
-                memcpy (pBuff->raw, pSrc, pBuff->size);
+                memcpy((char *)pBuff->raw + filled, pSrc, available);
+                filled += available;
+                ++completed;
+            }
+        }
 
+        if (filled > 0) {
+            pBuff->size = filled;
+            if (completed > 0) {
                 // data has been consumed, and the buffer queue state has been updated
                 // we will notify the client if applicable
                 callback = ap->mBufferQueue.mCallback;
@@ -1189,7 +1217,10 @@ static void audioTrack_callBack_pullFromBuffQueue(int event, void* user, void *i
             }
         }
         if (NULL != callback) {
-            (*callback)(&ap->mBufferQueue.mItf, callbackPContext);
+            // one callback per completed buffer, as if they had been consumed one at a time
+            while (completed-- > 0) {
+                (*callback)(&ap->mBufferQueue.mItf, callbackPContext);
+            }
         }
     }
     break;
@@ -1318,6 +1349,19 @@ SLresult android_audioPlayer_getConfig(CAudioPlayer* ap, const SLchar *configKey
         }
         *pValueSize = KEY_STREAM_TYPE_PARAMSIZE;
 
+    } else if (strcmp((const char*)configKey, (const char*)SL_ANDROID_KEY_OUTPUT_LATENCY) == 0) {
+
+        // output latency
+        if (NULL == pConfigValue) {
+            result = SL_RESULT_SUCCESS;
+        } else if (KEY_OUTPUT_LATENCY_PARAMSIZE > *pValueSize) {
+            SL_LOGE(ERROR_CONFIG_VALUESIZE_TOO_LOW);
+            result = SL_RESULT_BUFFER_INSUFFICIENT;
+        } else {
+            result = audioPlayer_getOutputLatency(ap, (SLuint32*)pConfigValue);
+        }
+        *pValueSize = KEY_OUTPUT_LATENCY_PARAMSIZE;
+
     } else {
         SL_LOGE(ERROR_CONFIG_UNKNOWN_KEY);
         result = SL_RESULT_PARAMETER_INVALID;
@@ -1452,6 +1496,11 @@ SLresult android_audioPlayer_realize(CAudioPlayer *pAudioPlayer, SLboolean async
             return result;
         }
 
+        bool fast = (pAudioPlayer->mAudioTrack->getFlags() & AUDIO_OUTPUT_FLAG_FAST) != 0;
+        SL_LOGD("AudioTrack for CAudioPlayer %p: %s track, %u frames, latency %u ms",
+                pAudioPlayer, fast ? "fast" : "normal",
+                pAudioPlayer->mAudioTrack->frameCount(), pAudioPlayer->mAudioTrack->latency());
+
         // initialize platform-independent CAudioPlayer fields
 
         pAudioPlayer->mNumChannels = df_pcm->numChannels;
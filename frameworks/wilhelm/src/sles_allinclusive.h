@@ -447,14 +447,18 @@ extern LI_API SLresult liQuerySupportedInterfaces(SLuint32 index, SLInterfaceID
 //  }
 // which replaces:
 //  (*playCallback)(&ap->mPlay.mItf, playContext, SL_PLAYEVENT_HEADATEND);
+// Callbacks go on the high priority lane of the thread pool, ahead of realize and resume.
 #define EnqueueAsyncCallback_ppi(object, handler, p1, p2, i1) \
-        ThreadPool_add_ppi(&(object)->mObject.mEngine->mThreadPool, \
-            (ClosureHandler_ppi) (handler), (p1), (p2), (i1))
+        ThreadPool_add_priority(&(object)->mObject.mEngine->mThreadPool, \
+            CLOSURE_PRIORITY_HIGH, CLOSURE_KIND_PPI, (ClosureHandler_generic) (handler), \
+            (p1), (p2), NULL, (i1), 0)
 #define EnqueueAsyncCallback_ppii(object, handler, p1, p2, i1, i2) \
-        ThreadPool_add_ppii(&(object)->mObject.mEngine->mThreadPool, \
-            (ClosureHandler_ppii) (handler), (p1), (p2), (i1), (i2))
+        ThreadPool_add_priority(&(object)->mObject.mEngine->mThreadPool, \
+            CLOSURE_PRIORITY_HIGH, CLOSURE_KIND_PPII, (ClosureHandler_generic) (handler), \
+            (p1), (p2), NULL, (i1), (i2))
 #define EnqueueAsyncCallback_piipp(object, handler, p1, i1, i2, p2, p3) \
-        ThreadPool_add_piipp(&(object)->mObject.mEngine->mThreadPool, \
-            (ClosureHandler_piipp) (handler), (p1), (i1), (i2), (p2), (p3))
+        ThreadPool_add_priority(&(object)->mObject.mEngine->mThreadPool, \
+            CLOSURE_PRIORITY_HIGH, CLOSURE_KIND_PIIPP, (ClosureHandler_generic) (handler), \
+            (p1), (p2), (p3), (i1), (i2))
 
 #define SL_PREFETCHEVENT_NONE ((SLuint32) 0)    // placeholder for non-existent SL_PREFETCHEVENT_*